@@ -0,0 +1,792 @@
+#include <eosio/chain/abi_compiled_decoder.hpp>
+#include <eosio/chain/asset.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/varint.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <algorithm>
+#include <charconv>
+
+namespace eosio { namespace chain {
+
+   using std::string_view;
+
+   const abi_compiled_decoder::type_id abi_compiled_decoder::invalid_type;
+
+   /// abi_traverse_context that tracks recursion without allocating a scope guard per value
+   struct abi_compiled_decoder::decode_context : public impl::abi_traverse_context {
+      using impl::abi_traverse_context::abi_traverse_context;
+
+      explicit decode_context( const impl::abi_traverse_context& parent ) : impl::abi_traverse_context( parent ) {}
+
+      struct scope {
+         explicit scope( decode_context& c ) : c(c) {
+            ++c.recursion_depth;
+            c.yield( c.recursion_depth );
+         }
+         ~scope() { --c.recursion_depth; }
+
+         decode_context& c;
+      };
+   };
+
+   /// reads the plain JSON from_json takes, anything else throws pack_exception
+   struct abi_compiled_decoder::json_reader {
+      using members = std::vector<std::pair<string_view, string_view>>;
+
+      // values skipped over are not limited by the ABI recursion depth
+      static constexpr size_t max_nesting = 128;
+
+      const char* pos;
+      const char* end;
+
+      explicit json_reader( const string_view& json ) : pos( json.data() ), end( json.data() + json.size() ) {}
+
+      [[noreturn]] static void unsupported( const char* what ) {
+         EOS_THROW( pack_exception, "Unable to encode JSON directly: ${w}", ("w", what) );
+      }
+
+      void skip_ws() {
+         while( pos < end && ( *pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r' ) ) ++pos;
+      }
+
+      bool next_is( char c ) {
+         skip_ws();
+         return pos < end && *pos == c;
+      }
+
+      bool at_end() {
+         skip_ws();
+         return pos == end;
+      }
+
+      void expect( char c ) {
+         if( !next_is( c ) ) unsupported( "unexpected character" );
+         ++pos;
+      }
+
+      bool comma() {
+         if( !next_is( ',' ) ) return false;
+         ++pos;
+         return true;
+      }
+
+      bool literal( const string_view& l ) {
+         skip_ws();
+         if( size_t( end - pos ) < l.size() || string_view( pos, l.size() ) != l ) return false;
+         pos += l.size();
+         return true;
+      }
+
+      string_view string_token() {
+         expect( '"' );
+         const char* start = pos;
+         for( ; pos < end; ++pos ) {
+            const unsigned char c = *pos;
+            if( c == '"' ) {
+               return string_view( start, pos++ - start );
+            }
+            if( c < 0x20 || c > 0x7e || c == '\\' ) unsupported( "string that is not plain ASCII" );
+         }
+         unsupported( "unterminated string" );
+      }
+
+      string_view number_token() {
+         skip_ws();
+         const char* start = pos;
+         if( pos < end && *pos == '-' ) ++pos;
+         const char* digits = pos;
+         while( pos < end && *pos >= '0' && *pos <= '9' ) ++pos;
+         if( pos == digits || ( *digits == '0' && pos - digits > 1 ) ) unsupported( "invalid number" );
+         if( pos < end && ( *pos == '.' || *pos == 'e' || *pos == 'E' ) ) unsupported( "number that is not an integer" );
+         return string_view( start, pos - start );
+      }
+
+      void skip_value( size_t depth ) {
+         if( depth > max_nesting ) unsupported( "nesting too deep" );
+         skip_ws();
+         if( pos == end ) unsupported( "unexpected end" );
+         switch( *pos ) {
+            case '"':
+               string_token();
+               return;
+            case '[':
+               ++pos;
+               if( next_is( ']' ) ) break;
+               do { skip_value( depth + 1 ); } while( comma() );
+               expect( ']' );
+               return;
+            case '{':
+               ++pos;
+               if( next_is( '}' ) ) break;
+               do {
+                  string_token();
+                  expect( ':' );
+                  skip_value( depth + 1 );
+               } while( comma() );
+               expect( '}' );
+               return;
+            case 't':
+               if( !literal( "true" ) ) unsupported( "unexpected token" );
+               return;
+            case 'f':
+               if( !literal( "false" ) ) unsupported( "unexpected token" );
+               return;
+            case 'n':
+               if( !literal( "null" ) ) unsupported( "unexpected token" );
+               return;
+            default:
+               number_token();
+               return;
+         }
+         ++pos; // the closing bracket of an empty array or object
+      }
+
+      /// the JSON text of the next value
+      string_view value() {
+         skip_ws();
+         const char* start = pos;
+         skip_value( 0 );
+         return string_view( start, pos - start );
+      }
+
+      std::vector<string_view> array_items() {
+         std::vector<string_view> items;
+         expect( '[' );
+         if( next_is( ']' ) ) {
+            ++pos;
+            return items;
+         }
+         do { items.push_back( value() ); } while( comma() );
+         expect( ']' );
+         return items;
+      }
+
+      void object_members( members& m ) {
+         expect( '{' );
+         if( next_is( '}' ) ) {
+            ++pos;
+            return;
+         }
+         do {
+            auto key = string_token();
+            expect( ':' );
+            m.emplace_back( key, value() );
+         } while( comma() );
+         expect( '}' );
+         // which of duplicates fc::json keeps is left to it
+         for( size_t i = 1; i < m.size(); ++i ) {
+            for( size_t j = 0; j < i; ++j ) {
+               if( m[i].first == m[j].first ) unsupported( "duplicate key" );
+            }
+         }
+      }
+   };
+
+   namespace {
+
+      void append_quoted( std::string& out, const string_view& s ) {
+         for( char c : s ) {
+            if( c < 0x20 || c > 0x7e || c == '"' || c == '\\' ) {
+               // let fc::json deal with escaping and invalid utf8 so the output matches binary_to_variant
+               out += fc::json::to_string( fc::variant( std::string( s ) ), fc::time_point::maximum() );
+               return;
+            }
+         }
+         out += '"';
+         out.append( s.data(), s.size() );
+         out += '"';
+      }
+
+      // fc::json quotes integers above 0xffffffff, keep its exact formatting outside of the plain range
+      void append_int( std::string& out, int64_t v ) {
+         if( v > int64_t(0xffffffff) || v < -int64_t(0xffffffff) ) {
+            out += fc::json::to_string( fc::variant( v ), fc::time_point::maximum() );
+         } else {
+            out += std::to_string( v );
+         }
+      }
+
+      void append_uint( std::string& out, uint64_t v ) {
+         if( v > 0xffffffff ) {
+            out += fc::json::to_string( fc::variant( v ), fc::time_point::maximum() );
+         } else {
+            out += std::to_string( v );
+         }
+      }
+
+      template<typename T>
+      T unpack_value( fc::datastream<const char*>& ds ) {
+         T v;
+         fc::raw::unpack( ds, v );
+         return v;
+      }
+
+      const std::map<string_view, uint8_t>& builtin_opcodes() {
+         static const std::map<string_view, uint8_t> opcodes = []() {
+            std::map<string_view, uint8_t> m;
+            uint8_t i = 0;
+            for( const char* n : { "bool", "int8", "uint8", "int16", "uint16", "int32", "uint32", "int64", "uint64",
+                                   "varint32", "varuint32", "name", "string", "bytes",
+                                   "checksum160", "checksum256", "checksum512", "asset" } ) {
+               m.emplace( n, i++ );
+            }
+            return m;
+         }();
+         return opcodes;
+      }
+   }
+
+   abi_compiled_decoder::abi_compiled_decoder( const abi_serializer& abis ) {
+      for( const auto& t : abis.built_in_types ) compile( abis, t.first );
+      for( const auto& t : abis.typedefs )       compile( abis, t.first );
+      for( const auto& s : abis.structs )        compile( abis, s.first );
+      for( const auto& v : abis.variants )       compile( abis, v.first );
+      for( const auto& a : abis.actions )        compile( abis, a.second );
+      for( const auto& t : abis.tables )         compile( abis, t.second );
+
+      // arrays and optionals of named types are common enough as a root type to have them ready as well
+      std::vector<std::string> named;
+      for( const auto& t : type_ids ) {
+         if( !abis.is_array( t.first ) && !abis.is_optional( t.first ) ) named.push_back( t.first );
+      }
+      for( const auto& t : named ) {
+         compile( abis, t + "[]" );
+         compile( abis, t + "?" );
+      }
+   }
+
+   abi_compiled_decoder::type_id abi_compiled_decoder::compile( const abi_serializer& abis, const string_view& type ) {
+      auto itr = type_ids.find( type );
+      if( itr != type_ids.end() ) return itr->second;
+
+      auto rtype = abis.resolve_type( type );
+      if( rtype != type ) {
+         type_id id = compile( abis, rtype );
+         type_ids.emplace( std::string( type ), id );
+         return id;
+      }
+
+      // reserve the id first so that recursive structs refer back to it
+      const type_id id = static_cast<type_id>( nodes.size() );
+      nodes.emplace_back();
+      type_ids.emplace( std::string( type ), id );
+
+      node n;
+      n.name = std::string( rtype );
+      auto ftype = abis.fundamental_type( rtype );
+      auto btype = abis.built_in_types.find( ftype );
+      if( abis.is_array( rtype ) ) {
+         n.op = opcode::array;
+         n.elem = compile( abis, ftype );
+      } else if( abis.is_optional( rtype ) ) {
+         n.op = opcode::optional;
+         n.elem = compile( abis, ftype );
+      } else if( btype != abis.built_in_types.end() ) {
+         auto op = builtin_opcodes().find( ftype );
+         n.op = op != builtin_opcodes().end() ? static_cast<opcode>( op->second ) : opcode::generic_builtin;
+         n.unpack = btype->second.first;
+         n.pack = btype->second.second;
+      } else if( auto v_itr = abis.variants.find( rtype ); v_itr != abis.variants.end() ) {
+         n.op = opcode::variant;
+         for( const auto& t : v_itr->second.types ) {
+            alternative a;
+            a.name = t;
+            append_quoted( a.quoted_name, t );
+            a.type = compile( abis, t );
+            n.alternatives.emplace_back( std::move( a ) );
+         }
+      } else if( auto s_itr = abis.structs.find( rtype ); s_itr != abis.structs.end() ) {
+         n.op = opcode::structure;
+         const auto& st = s_itr->second;
+         if( st.base != type_name() ) {
+            n.base = compile( abis, abis.resolve_type( st.base ) );
+            EOS_ASSERT( nodes[n.base].op == opcode::structure, invalid_type_inside_abi,
+                        "Base ${b} of struct ${s} is not a struct", ("b", impl::limit_size(st.base))("s", impl::limit_size(st.name)) );
+         }
+         for( const auto& f : st.fields ) {
+            field cf;
+            cf.name = f.name;
+            append_quoted( cf.key, f.name );
+            cf.key += ':';
+            cf.extension = boost::algorithm::ends_with( f.type, "$" );
+            cf.type = compile( abis, cf.extension ? string_view( f.type ).substr( 0, f.type.size() - 1 ) : string_view( f.type ) );
+            n.fields.emplace_back( std::move( cf ) );
+         }
+      } else {
+         EOS_THROW( invalid_type_inside_abi, "Unknown type ${type}", ("type", impl::limit_size(type)) );
+      }
+
+      nodes[id] = std::move( n );
+      return id;
+   }
+
+   abi_compiled_decoder::type_id abi_compiled_decoder::find_type( const string_view& type )const {
+      auto itr = type_ids.find( type );
+      return itr != type_ids.end() ? itr->second : invalid_type;
+   }
+
+   void abi_compiled_decoder::to_json( type_id t, fc::datastream<const char*>& ds, std::string& out,
+                                       const abi_serializer::yield_function_t& yield )const {
+      EOS_ASSERT( t < nodes.size(), invalid_type_inside_abi, "Invalid compiled type id ${t}", ("t", t) );
+      decode_context ctx( yield );
+      decode( t, ds, out, ctx );
+   }
+
+   void abi_compiled_decoder::to_json( const string_view& type, fc::datastream<const char*>& ds, std::string& out,
+                                       const abi_serializer::yield_function_t& yield )const {
+      type_id t = find_type( type );
+      EOS_ASSERT( t != invalid_type, invalid_type_inside_abi, "Unknown type ${type}", ("type", impl::limit_size(type)) );
+      decode_context ctx( yield );
+      decode( t, ds, out, ctx );
+   }
+
+   std::string abi_compiled_decoder::to_json( const string_view& type, const bytes& binary,
+                                              const abi_serializer::yield_function_t& yield )const {
+      type_id t = find_type( type );
+      EOS_ASSERT( t != invalid_type, invalid_type_inside_abi, "Unknown type ${type}", ("type", impl::limit_size(type)) );
+      return to_json( t, binary, decode_context( yield ) );
+   }
+
+   std::string abi_compiled_decoder::to_json( type_id t, const bytes& binary, const impl::abi_traverse_context& parent )const {
+      EOS_ASSERT( t < nodes.size(), invalid_type_inside_abi, "Invalid compiled type id ${t}", ("t", t) );
+      std::string out;
+      out.reserve( binary.size() * 2 );
+      fc::datastream<const char*> ds( binary.data(), binary.size() );
+      decode_context ctx( parent );
+      decode_context::scope s( ctx ); // same depth as binary_to_variant of bytes
+      decode( t, ds, out, ctx );
+      return out;
+   }
+
+   bool abi_compiled_decoder::decode( type_id t, fc::datastream<const char*>& ds, std::string& out, decode_context& ctx )const {
+      decode_context::scope s( ctx );
+      const node& n = nodes[t];
+      switch( n.op ) {
+         case opcode::array: {
+            fc::unsigned_int size;
+            try {
+               fc::raw::unpack( ds, size );
+            } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack size of array '${t}'", ("t", n.name) )
+            // every element takes at least one byte, anything else fails below anyway
+            EOS_ASSERT( size.value <= ds.remaining(), unpack_exception,
+                        "Array size ${s} of '${t}' exceeds remaining data", ("s", size.value)("t", n.name) );
+            out += '[';
+            for( decltype(size.value) i = 0; i < size.value; ++i ) {
+               if( i > 0 ) out += ',';
+               EOS_ASSERT( !decode( n.elem, ds, out, ctx ), unpack_exception, "Invalid packed array '${t}'", ("t", n.name) );
+            }
+            out += ']';
+            return false;
+         }
+         case opcode::optional: {
+            char flag;
+            try {
+               fc::raw::unpack( ds, flag );
+            } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack presence flag of optional '${t}'", ("t", n.name) )
+            if( !flag ) {
+               out += "null";
+               return true;
+            }
+            return decode( n.elem, ds, out, ctx );
+         }
+         case opcode::variant: {
+            fc::unsigned_int select;
+            try {
+               fc::raw::unpack( ds, select );
+            } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack tag of variant '${t}'", ("t", n.name) )
+            EOS_ASSERT( (size_t)select < n.alternatives.size(), unpack_exception,
+                        "Unpacked invalid tag (${select}) for variant '${t}'", ("select", select.value)("t", n.name) );
+            const auto& a = n.alternatives[select];
+            out += '[';
+            out += a.quoted_name;
+            out += ',';
+            decode( a.type, ds, out, ctx );
+            out += ']';
+            return false;
+         }
+         case opcode::structure: {
+            size_t num_fields = 0;
+            out += '{';
+            decode_fields( n, ds, out, num_fields, ctx );
+            EOS_ASSERT( num_fields > 0, unpack_exception, "Unable to unpack '${t}' from stream", ("t", n.name) );
+            out += '}';
+            return false;
+         }
+         default:
+            try {
+               decode_builtin( n, ds, out, ctx );
+            } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack built-in type '${t}'", ("t", n.name) )
+            return false;
+      }
+   }
+
+   void abi_compiled_decoder::decode_fields( const node& n, fc::datastream<const char*>& ds, std::string& out,
+                                             size_t& num_fields, decode_context& ctx )const {
+      decode_context::scope s( ctx );
+      if( n.base != invalid_type ) {
+         decode_fields( nodes[n.base], ds, out, num_fields, ctx );
+      }
+      bool encountered_extension = false;
+      for( const auto& f : n.fields ) {
+         encountered_extension |= f.extension;
+         if( !ds.remaining() ) {
+            if( f.extension ) {
+               continue;
+            }
+            if( encountered_extension ) {
+               EOS_THROW( abi_exception, "Encountered field '${f}' without binary extension designation while processing struct '${p}'",
+                          ("f", f.name)("p", n.name) );
+            }
+            EOS_THROW( unpack_exception, "Stream unexpectedly ended; unable to unpack field '${f}' of struct '${p}'",
+                       ("f", f.name)("p", n.name) );
+         }
+         if( num_fields++ > 0 ) out += ',';
+         out += f.key;
+         decode( f.type, ds, out, ctx );
+      }
+   }
+
+   void abi_compiled_decoder::decode_builtin( const node& n, fc::datastream<const char*>& ds, std::string& out, decode_context& ctx )const {
+      switch( n.op ) {
+         case opcode::boolean:     append_uint( out, unpack_value<uint8_t>( ds ) ); break;
+         case opcode::int8:        append_int( out, unpack_value<int8_t>( ds ) ); break;
+         case opcode::uint8:       append_uint( out, unpack_value<uint8_t>( ds ) ); break;
+         case opcode::int16:       append_int( out, unpack_value<int16_t>( ds ) ); break;
+         case opcode::uint16:      append_uint( out, unpack_value<uint16_t>( ds ) ); break;
+         case opcode::int32:       append_int( out, unpack_value<int32_t>( ds ) ); break;
+         case opcode::uint32:      append_uint( out, unpack_value<uint32_t>( ds ) ); break;
+         case opcode::int64:       append_int( out, unpack_value<int64_t>( ds ) ); break;
+         case opcode::uint64:      append_uint( out, unpack_value<uint64_t>( ds ) ); break;
+         case opcode::varint32:    append_int( out, unpack_value<fc::signed_int>( ds ).value ); break;
+         case opcode::varuint32:   append_uint( out, unpack_value<fc::unsigned_int>( ds ).value ); break;
+         case opcode::name: {
+            out += '"';
+            out += unpack_value<chain::name>( ds ).to_string();
+            out += '"';
+            break;
+         }
+         case opcode::string:      append_quoted( out, unpack_value<std::string>( ds ) ); break;
+         case opcode::bytes: {
+            auto b = unpack_value<chain::bytes>( ds );
+            out += '"';
+            if( !b.empty() ) out += fc::to_hex( b.data(), b.size() );
+            out += '"';
+            break;
+         }
+         case opcode::checksum160: out += '"'; out += unpack_value<checksum160_type>( ds ).str(); out += '"'; break;
+         case opcode::checksum256: out += '"'; out += unpack_value<checksum256_type>( ds ).str(); out += '"'; break;
+         case opcode::checksum512: out += '"'; out += unpack_value<checksum512_type>( ds ).str(); out += '"'; break;
+         case opcode::asset:       append_quoted( out, unpack_value<chain::asset>( ds ).to_string() ); break;
+         default:
+            out += fc::json::to_string( n.unpack( ds, false, false, ctx.get_yield_function() ), fc::time_point::maximum() );
+            break;
+      }
+   }
+
+   fc::variant abi_compiled_decoder::to_variant( type_id t, fc::datastream<const char*>& ds,
+                                                 const abi_serializer::yield_function_t& yield )const {
+      EOS_ASSERT( t < nodes.size(), invalid_type_inside_abi, "Invalid compiled type id ${t}", ("t", t) );
+      decode_context ctx( yield );
+      return decode_variant( t, ds, ctx );
+   }
+
+   fc::variant abi_compiled_decoder::to_variant( const string_view& type, const bytes& binary,
+                                                 const abi_serializer::yield_function_t& yield )const {
+      return to_variant( type, binary, decode_context( yield ) );
+   }
+
+   fc::variant abi_compiled_decoder::to_variant( const string_view& type, const bytes& binary,
+                                                 const impl::abi_traverse_context& parent )const {
+      type_id t = find_type( type );
+      EOS_ASSERT( t != invalid_type, invalid_type_inside_abi, "Unknown type ${type}", ("type", impl::limit_size(type)) );
+      return to_variant( t, binary, parent );
+   }
+
+   fc::variant abi_compiled_decoder::to_variant( type_id t, const bytes& binary, const impl::abi_traverse_context& parent )const {
+      EOS_ASSERT( t < nodes.size(), invalid_type_inside_abi, "Invalid compiled type id ${t}", ("t", t) );
+      fc::datastream<const char*> ds( binary.data(), binary.size() );
+      decode_context ctx( parent );
+      decode_context::scope s( ctx ); // same depth as binary_to_variant of bytes
+      return decode_variant( t, ds, ctx );
+   }
+
+   fc::variant abi_compiled_decoder::decode_variant( type_id t, fc::datastream<const char*>& ds, decode_context& ctx )const {
+      decode_context::scope s( ctx );
+      const node& n = nodes[t];
+      switch( n.op ) {
+         case opcode::array:
+         case opcode::optional: {
+            const node& elem = nodes[n.elem];
+            if( elem.unpack ) {
+               // as in binary_to_variant, built-in types unpack whole arrays and optionals of themselves
+               try {
+                  return elem.unpack( ds, n.op == opcode::array, n.op == opcode::optional, ctx.get_yield_function() );
+               } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack built-in type '${t}'", ("t", n.name) )
+            }
+            if( n.op == opcode::optional ) {
+               char flag;
+               try {
+                  fc::raw::unpack( ds, flag );
+               } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack presence flag of optional '${t}'", ("t", n.name) )
+               return flag ? decode_variant( n.elem, ds, ctx ) : fc::variant();
+            }
+            fc::unsigned_int size;
+            try {
+               fc::raw::unpack( ds, size );
+            } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack size of array '${t}'", ("t", n.name) )
+            EOS_ASSERT( size.value <= ds.remaining(), unpack_exception,
+                        "Array size ${s} of '${t}' exceeds remaining data", ("s", size.value)("t", n.name) );
+            fc::variants vars;
+            vars.reserve( size.value );
+            for( decltype(size.value) i = 0; i < size.value; ++i ) {
+               auto v = decode_variant( n.elem, ds, ctx );
+               EOS_ASSERT( !v.is_null(), unpack_exception, "Invalid packed array '${t}'", ("t", n.name) );
+               vars.emplace_back( std::move( v ) );
+            }
+            return fc::variant( std::move( vars ) );
+         }
+         case opcode::variant: {
+            fc::unsigned_int select;
+            try {
+               fc::raw::unpack( ds, select );
+            } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack tag of variant '${t}'", ("t", n.name) )
+            EOS_ASSERT( (size_t)select < n.alternatives.size(), unpack_exception,
+                        "Unpacked invalid tag (${select}) for variant '${t}'", ("select", select.value)("t", n.name) );
+            const auto& a = n.alternatives[select];
+            return fc::variants{ fc::variant( a.name ), decode_variant( a.type, ds, ctx ) };
+         }
+         case opcode::structure: {
+            fc::mutable_variant_object obj;
+            decode_fields( n, ds, obj, ctx );
+            EOS_ASSERT( obj.size() > 0, unpack_exception, "Unable to unpack '${t}' from stream", ("t", n.name) );
+            return fc::variant( std::move( obj ) );
+         }
+         default:
+            try {
+               return n.unpack( ds, false, false, ctx.get_yield_function() );
+            } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack built-in type '${t}'", ("t", n.name) )
+      }
+   }
+
+   void abi_compiled_decoder::decode_fields( const node& n, fc::datastream<const char*>& ds, fc::mutable_variant_object& obj,
+                                             decode_context& ctx )const {
+      decode_context::scope s( ctx );
+      if( n.base != invalid_type ) {
+         decode_fields( nodes[n.base], ds, obj, ctx );
+      }
+      bool encountered_extension = false;
+      for( const auto& f : n.fields ) {
+         encountered_extension |= f.extension;
+         if( !ds.remaining() ) {
+            if( f.extension ) {
+               continue;
+            }
+            if( encountered_extension ) {
+               EOS_THROW( abi_exception, "Encountered field '${f}' without binary extension designation while processing struct '${p}'",
+                          ("f", f.name)("p", n.name) );
+            }
+            EOS_THROW( unpack_exception, "Stream unexpectedly ended; unable to unpack field '${f}' of struct '${p}'",
+                       ("f", f.name)("p", n.name) );
+         }
+         obj( f.name, decode_variant( f.type, ds, ctx ) );
+      }
+   }
+
+   bytes abi_compiled_decoder::from_json( const string_view& type, const string_view& json,
+                                          const abi_serializer::yield_function_t& yield )const {
+      type_id t = find_type( type );
+      EOS_ASSERT( t != invalid_type, invalid_type_inside_abi, "Unknown type ${type}", ("type", impl::limit_size(type)) );
+      // the same buffer as variant_to_binary, so that the same values are too large
+      bytes temp( 1024*1024 );
+      fc::datastream<char*> ds( temp.data(), temp.size() );
+      json_reader in( json );
+      decode_context ctx( yield );
+      decode_context::scope s( ctx );
+      encode( t, in, ds, true, ctx );
+      EOS_ASSERT( in.at_end(), pack_exception, "Unexpected data after the JSON value of ${type}", ("type", impl::limit_size(type)) );
+      temp.resize( ds.tellp() );
+      return temp;
+   }
+
+   bool abi_compiled_decoder::split_json_object( const string_view& json, std::vector<std::pair<string_view, string_view>>& members ) {
+      try {
+         json_reader in( json );
+         in.object_members( members );
+         return in.at_end();
+      } catch( const pack_exception& ) {
+         return false;
+      }
+   }
+
+   void abi_compiled_decoder::encode( type_id t, json_reader& in, fc::datastream<char*>& ds, bool allow_extensions,
+                                      decode_context& ctx )const {
+      decode_context::scope s( ctx );
+      const node& n = nodes[t];
+      switch( n.op ) {
+         case opcode::array: {
+            const auto items = in.array_items();
+            fc::raw::pack( ds, fc::unsigned_int( static_cast<uint32_t>( items.size() ) ) );
+            for( const auto& item : items ) {
+               json_reader r( item );
+               encode( n.elem, r, ds, false, ctx );
+            }
+            return;
+         }
+         case opcode::optional: {
+            const char flag = !in.literal( "null" );
+            fc::raw::pack( ds, flag );
+            if( flag ) encode( n.elem, in, ds, allow_extensions, ctx );
+            return;
+         }
+         case opcode::variant: {
+            in.expect( '[' );
+            const auto type = in.string_token();
+            in.expect( ',' );
+            auto a = std::find_if( n.alternatives.begin(), n.alternatives.end(), [&type]( const alternative& alt ) {
+               return alt.quoted_name.size() == type.size() + 2 && string_view( alt.quoted_name ).substr( 1, type.size() ) == type;
+            } );
+            EOS_ASSERT( a != n.alternatives.end(), pack_exception, "Specified type '${t}' in input array is not valid within the variant '${p}'",
+                        ("t", impl::limit_size(type))("p", n.name) );
+            fc::raw::pack( ds, fc::unsigned_int( static_cast<uint32_t>( a - n.alternatives.begin() ) ) );
+            encode( a->type, in, ds, allow_extensions, ctx );
+            in.expect( ']' );
+            return;
+         }
+         case opcode::structure: {
+            json_reader::members members;
+            if( in.next_is( '{' ) ) {
+               in.object_members( members );
+               encode_fields( n, members, ds, allow_extensions, ctx );
+               return;
+            }
+            EOS_ASSERT( in.next_is( '[' ), pack_exception, "Unexpected input encountered while processing struct '${p}'", ("p", n.name) );
+            EOS_ASSERT( n.base == invalid_type, pack_exception,
+                        "Using input array to specify the fields of the derived struct '${p}'; input arrays are currently only allowed for structs without a base",
+                        ("p", n.name) );
+            const auto items = in.array_items();
+            for( size_t i = 0; i < n.fields.size(); ++i ) {
+               const auto& f = n.fields[i];
+               if( i < items.size() ) {
+                  json_reader r( items[i] );
+                  encode( f.type, r, ds, allow_extensions && i + 1 == n.fields.size(), ctx );
+               } else if( f.extension && allow_extensions ) {
+                  break;
+               } else {
+                  EOS_THROW( pack_exception, "Early end to input array specifying the fields of struct '${p}'; require input for field '${f}'",
+                             ("p", n.name)("f", f.name) );
+               }
+            }
+            return;
+         }
+         default:
+            encode_builtin( n, in, ds, ctx );
+            return;
+      }
+   }
+
+   void abi_compiled_decoder::encode_fields( const node& n, const std::vector<std::pair<string_view, string_view>>& members,
+                                             fc::datastream<char*>& ds, bool allow_extensions, decode_context& ctx )const {
+      decode_context::scope s( ctx );
+      if( n.base != invalid_type ) {
+         encode_fields( nodes[n.base], members, ds, false, ctx );
+      }
+      bool disallow_additional_fields = false;
+      for( size_t i = 0; i < n.fields.size(); ++i ) {
+         const auto& f = n.fields[i];
+         auto m = std::find_if( members.begin(), members.end(), [&f]( const auto& member ) { return member.first == f.name; } );
+         if( m != members.end() ) {
+            EOS_ASSERT( !disallow_additional_fields, pack_exception, "Unexpected field '${f}' found in input object while processing struct '${p}'",
+                        ("f", f.name)("p", n.name) );
+            json_reader r( m->second );
+            encode( f.type, r, ds, allow_extensions && i + 1 == n.fields.size(), ctx );
+         } else if( f.extension && allow_extensions ) {
+            disallow_additional_fields = true;
+         } else {
+            EOS_THROW( pack_exception, "Missing field '${f}' in input object while processing struct '${p}'", ("f", f.name)("p", n.name) );
+         }
+      }
+   }
+
+   namespace {
+      template<typename T>
+      bool pack_integer( const string_view& token, fc::datastream<char*>& ds ) {
+         // fc::json reads negative integers as int64 and others as uint64, from_variant then casts them to T
+         T v;
+         if( token[0] == '-' ) {
+            int64_t i = 0;
+            auto r = std::from_chars( token.data(), token.data() + token.size(), i );
+            if( r.ec != std::errc() ) return false;
+            v = static_cast<T>( i );
+         } else {
+            uint64_t u = 0;
+            auto r = std::from_chars( token.data(), token.data() + token.size(), u );
+            if( r.ec != std::errc() ) return false;
+            v = static_cast<T>( u );
+         }
+         fc::raw::pack( ds, v );
+         return true;
+      }
+
+      bool is_hex( const string_view& s ) {
+         return s.size() % 2 == 0 && std::all_of( s.begin(), s.end(), []( char c ) {
+            return ( c >= '0' && c <= '9' ) || ( c >= 'a' && c <= 'f' ) || ( c >= 'A' && c <= 'F' );
+         } );
+      }
+
+      void pack_string( const string_view& s, fc::datastream<char*>& ds ) {
+         fc::raw::pack( ds, fc::unsigned_int( static_cast<uint32_t>( s.size() ) ) );
+         if( !s.empty() ) ds.write( s.data(), s.size() );
+      }
+   }
+
+   void abi_compiled_decoder::encode_builtin( const node& n, json_reader& in, fc::datastream<char*>& ds, decode_context& ctx )const {
+      in.skip_ws();
+      const bool is_string = in.pos < in.end && *in.pos == '"';
+      const bool is_number = in.pos < in.end && ( *in.pos == '-' || ( *in.pos >= '0' && *in.pos <= '9' ) );
+      const char* start = in.pos;
+      switch( n.op ) {
+         case opcode::boolean:
+            if( in.literal( "true" ) )  { fc::raw::pack( ds, uint8_t(1) ); return; }
+            if( in.literal( "false" ) ) { fc::raw::pack( ds, uint8_t(0) ); return; }
+            break;
+         case opcode::int8:   if( is_number && pack_integer<int8_t>( in.number_token(), ds ) ) return; break;
+         case opcode::uint8:  if( is_number && pack_integer<uint8_t>( in.number_token(), ds ) ) return; break;
+         case opcode::int16:  if( is_number && pack_integer<int16_t>( in.number_token(), ds ) ) return; break;
+         case opcode::uint16: if( is_number && pack_integer<uint16_t>( in.number_token(), ds ) ) return; break;
+         case opcode::int32:  if( is_number && pack_integer<int32_t>( in.number_token(), ds ) ) return; break;
+         case opcode::uint32: if( is_number && pack_integer<uint32_t>( in.number_token(), ds ) ) return; break;
+         case opcode::int64:  if( is_number && pack_integer<int64_t>( in.number_token(), ds ) ) return; break;
+         case opcode::uint64: if( is_number && pack_integer<uint64_t>( in.number_token(), ds ) ) return; break;
+         case opcode::name:
+            if( is_string ) { fc::raw::pack( ds, chain::name( in.string_token() ) ); return; }
+            break;
+         case opcode::string:
+            if( is_string ) { pack_string( in.string_token(), ds ); return; }
+            break;
+         case opcode::bytes:
+            if( is_string ) {
+               const auto hex = in.string_token();
+               if( is_hex( hex ) ) {
+                  bytes b( hex.size() / 2 );
+                  if( !b.empty() ) fc::from_hex( std::string( hex ), b.data(), b.size() );
+                  fc::raw::pack( ds, b );
+                  return;
+               }
+            }
+            break;
+         case opcode::asset:
+            if( is_string ) { fc::raw::pack( ds, chain::asset::from_string( std::string( in.string_token() ) ) ); return; }
+            break;
+         default:
+            break;
+      }
+      // any other form the serializer may still accept, such as integers given as strings, goes through its pack function
+      in.pos = start;
+      const auto text = in.value();
+      n.pack( fc::json::from_string( std::string( text ) ), ds, false, false, ctx.get_yield_function() );
+   }
+
+} } // eosio::chain
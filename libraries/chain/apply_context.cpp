@@ -10,6 +10,7 @@
 #include <eosio/chain/account_object.hpp>
 #include <eosio/chain/code_object.hpp>
 #include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/span_trace.hpp>
 #include <boost/container/flat_set.hpp>
 
 using boost::container::flat_set;
@@ -34,6 +35,7 @@ apply_context::apply_context(controller& con, transaction_context& trx_ctx, uint
 :control(con)
 ,db(con.mutable_db())
 ,trx_context(trx_ctx)
+,arena(trx_ctx.arena)
 ,recurse_depth(depth)
 ,first_receiver_action_ordinal(action_ordinal)
 ,action_ordinal(action_ordinal)
@@ -42,20 +44,29 @@ apply_context::apply_context(controller& con, transaction_context& trx_ctx, uint
 ,idx256(*this)
 ,idx_double(*this)
 ,idx_long_double(*this)
+,keyval_cache(arena)
+,kv_iterators(arena_allocator<char>(arena))
+,_notified(arena_allocator<char>(arena))
+,_inline_actions(arena_allocator<char>(arena))
+,_cfa_inline_actions(arena_allocator<char>(arena))
 {
    action_trace& trace = trx_ctx.get_action_trace(action_ordinal);
    act = &trace.act;
    receiver = trace.receiver;
    context_free = trace.context_free;
+   _trace_row_accesses = con.trace_row_accesses();
 }
 
 void apply_context::exec_one()
 {
-   auto start = fc::time_point::now();
+   scoped_span span( "apply_context::exec_one" );
+   // left unset, and the trace without its timing, when no one reads it
+   const auto start = control.full_traces() ? fc::time_point::now() : fc::time_point();
+   if( trx_context.profile_usage ) _profile_start = start != fc::time_point() ? start : fc::time_point::now();
 
    action_receipt r;
    r.receiver         = receiver;
-   r.act_digest       = digest_type::hash(*act);
+   r.act_digest       = _act_digest;
 
    const auto& cfg = control.get_global_properties().configuration;
    const account_metadata_object* receiver_account = nullptr;
@@ -69,6 +80,7 @@ void apply_context::exec_one()
                control.check_contract_list( receiver );
                control.check_action_list( act->account, act->name );
             }
+            scoped_span native_span( "apply_context::native_handler" );
             (*native)( *this );
          }
 
@@ -84,6 +96,7 @@ void apply_context::exec_one()
                control.check_action_list( act->account, act->name );
             }
             try {
+               scoped_span wasm_span( "wasm_interface::apply" );
                control.get_wasm_interface().apply( receiver_account->code_hash, receiver_account->vm_type, receiver_account->vm_version, *this );
             } catch( const wasm_exit& ) {}
          }
@@ -155,17 +168,35 @@ void apply_context::exec_one()
 
 void apply_context::finalize_trace( action_trace& trace, const fc::time_point& start )
 {
-   trace.account_ram_deltas = std::move( _account_ram_deltas );
+   if( trx_context.profile_usage ) {
+      int64_t ram_delta = 0;
+      for( const auto& d : _account_ram_deltas ) ram_delta += d.delta;
+      trx_context.profiled_actions.push_back( { receiver, trace.act.name,
+                                                { 1, (fc::time_point::now() - _profile_start).count(), 0, _db_intrinsics, ram_delta } } );
+   }
+   _db_intrinsics = 0;
+
+   if( start != fc::time_point() ) {
+      trace.account_ram_deltas = std::move( _account_ram_deltas );
+      trace.elapsed = fc::time_point::now() - start;
+   }
    _account_ram_deltas.clear();
 
    trace.console = std::move( _pending_console_output );
    _pending_console_output.clear();
 
-   trace.elapsed = fc::time_point::now() - start;
+   if( !_row_accesses.empty() ) {
+      std::sort( _row_accesses.begin(), _row_accesses.end() );
+      _row_accesses.erase( std::unique( _row_accesses.begin(), _row_accesses.end() ), _row_accesses.end() );
+      trace.row_accesses = std::move( _row_accesses );
+      _row_accesses.clear();
+   }
 }
 
 void apply_context::exec()
 {
+   // the notifications are copies of the action, so they share its digest
+   _act_digest = digest_type::hash(*act);
    _notified.emplace_back( receiver, action_ordinal );
    exec_one();
    for( uint32_t i = 1; i < _notified.size(); ++i ) {
@@ -173,6 +204,10 @@ void apply_context::exec()
       exec_one();
    }
 
+   if( control.records_state_access() ) {
+      record_state_access();
+   }
+
    if( _cfa_inline_actions.size() > 0 || _inline_actions.size() > 0 ) {
       EOS_ASSERT( recurse_depth < control.get_global_properties().configuration.max_inline_action_depth,
                   transaction_exception, "max inline action depth per transaction reached" );
@@ -188,6 +223,18 @@ void apply_context::exec()
 
 } /// exec()
 
+/// the rows the action and its notifications used, under the contract of the action since that is what a block shows
+void apply_context::record_state_access()const {
+   std::vector<const void*> objects;
+   keyval_cache.append_objects( objects );
+   idx64.append_objects( objects );
+   idx128.append_objects( objects );
+   idx256.append_objects( objects );
+   idx_double.append_objects( objects );
+   idx_long_double.append_objects( objects );
+   control.record_state_access( act->account, objects );
+}
+
 bool apply_context::is_account( const account_name& account )const {
    return nullptr != db.find<account_object,by_name>( account );
 }
@@ -298,7 +345,7 @@ void apply_context::execute_inline( action&& a ) {
    if( !control.skip_auth_check() && !privileged ) {
       try {
          control.get_authorization_manager()
-                .check_authorization( {a},
+                .check_authorization( &a, 1,
                                       {},
                                       {{receiver, config::eosio_code_name}},
                                       control.pending_block_time() - trx_context.published,
@@ -669,6 +716,8 @@ int apply_context::db_store_i64( name scope, name table, const account_name& pay
 }
 
 int apply_context::db_store_i64( name code, name scope, name table, const account_name& payer, uint64_t id, const char* buffer, size_t buffer_size ) {
+   ++_db_intrinsics;
+   scoped_span span( "apply_context::db_store_i64" );
 //   require_write_lock( scope );
    const auto& tab = find_or_create_table( code, scope, table, payer );
    auto tableid = tab.id;
@@ -678,7 +727,7 @@ int apply_context::db_store_i64( name code, name scope, name table, const accoun
    const auto& obj = db.create<key_value_object>( [&]( auto& o ) {
       o.t_id        = tableid;
       o.primary_key = id;
-      o.value.assign( buffer, buffer_size );
+      o.value.assign_compact( buffer, buffer_size );
       o.payer       = payer;
    });
 
@@ -689,11 +738,15 @@ int apply_context::db_store_i64( name code, name scope, name table, const accoun
    int64_t billable_size = (int64_t)(buffer_size + config::billable_size_v<key_value_object>);
    update_db_usage( payer, billable_size);
 
+   record_row_access( tab, id, true );
+
    keyval_cache.cache_table( tab );
    return keyval_cache.add( obj );
 }
 
 void apply_context::db_update_i64( int iterator, account_name payer, const char* buffer, size_t buffer_size ) {
+   ++_db_intrinsics;
+   scoped_span span( "apply_context::db_update_i64" );
    const key_value_object& obj = keyval_cache.get( iterator );
 
    const auto& table_obj = keyval_cache.get_table( obj.t_id );
@@ -701,6 +754,8 @@ void apply_context::db_update_i64( int iterator, account_name payer, const char*
 
 //   require_write_lock( table_obj.scope );
 
+   record_row_access( table_obj, obj.primary_key, true );
+
    const int64_t overhead = config::billable_size_v<key_value_object>;
    int64_t old_size = (int64_t)(obj.value.size() + overhead);
    int64_t new_size = (int64_t)(buffer_size + overhead);
@@ -718,12 +773,14 @@ void apply_context::db_update_i64( int iterator, account_name payer, const char*
    }
 
    db.modify( obj, [&]( auto& o ) {
-     o.value.assign( buffer, buffer_size );
+     o.value.assign_compact( buffer, buffer_size );
      o.payer = payer;
    });
 }
 
 void apply_context::db_remove_i64( int iterator ) {
+   ++_db_intrinsics;
+   scoped_span span( "apply_context::db_remove_i64" );
    const key_value_object& obj = keyval_cache.get( iterator );
 
    const auto& table_obj = keyval_cache.get_table( obj.t_id );
@@ -733,6 +790,8 @@ void apply_context::db_remove_i64( int iterator ) {
 
    update_db_usage( obj.payer,  -(obj.value.size() + config::billable_size_v<key_value_object>) );
 
+   record_row_access( table_obj, obj.primary_key, true );
+
    db.modify( table_obj, [&]( auto& t ) {
       --t.count;
    });
@@ -746,7 +805,10 @@ void apply_context::db_remove_i64( int iterator ) {
 }
 
 int apply_context::db_get_i64( int iterator, char* buffer, size_t buffer_size ) {
+   ++_db_intrinsics;
+   scoped_span span( "apply_context::db_get_i64" );
    const key_value_object& obj = keyval_cache.get( iterator );
+   if( _trace_row_accesses ) record_row_access( keyval_cache.get_table( obj.t_id ), obj.primary_key, false );
 
    auto s = obj.value.size();
    if( buffer_size == 0 ) return s;
@@ -758,6 +820,7 @@ int apply_context::db_get_i64( int iterator, char* buffer, size_t buffer_size )
 }
 
 int apply_context::db_next_i64( int iterator, uint64_t& primary ) {
+   ++_db_intrinsics;
    if( iterator < -1 ) return -1; // cannot increment past end iterator of table
 
    const auto& obj = keyval_cache.get( iterator ); // Check for iterator != -1 happens in this call
@@ -769,10 +832,41 @@ int apply_context::db_next_i64( int iterator, uint64_t& primary ) {
    if( itr == idx.end() || itr->t_id != obj.t_id ) return keyval_cache.get_end_iterator_by_table_id(obj.t_id);
 
    primary = itr->primary_key;
-   return keyval_cache.add( *itr );
+   return add_keyval_read( *itr );
+}
+
+int apply_context::db_get_range_i64( int iterator, int& next_iterator, char* buffer, size_t buffer_size, uint32_t max_rows ) {
+   ++_db_intrinsics;
+   const key_value_object& obj = keyval_cache.get( iterator );
+   const auto& idx = db.get_index<key_value_index, by_scope_primary>();
+
+   auto itr = idx.iterator_to( obj );
+   uint32_t rows = 0;
+   size_t offset = 0;
+   for( ; itr != idx.end() && itr->t_id == obj.t_id && rows < max_rows; ++itr, ++rows ) {
+      const uint32_t value_size = itr->value.size();
+      const size_t row_size = sizeof(uint64_t) + sizeof(uint32_t) + value_size;
+      if( row_size > buffer_size - offset ) break;
+
+      memcpy( buffer + offset, &itr->primary_key, sizeof(uint64_t) );
+      memcpy( buffer + offset + sizeof(uint64_t), &value_size, sizeof(uint32_t) );
+      memcpy( buffer + offset + sizeof(uint64_t) + sizeof(uint32_t), itr->value.data(), value_size );
+      offset += row_size;
+      if( _trace_row_accesses ) record_row_access( keyval_cache.get_table( obj.t_id ), itr->primary_key, false );
+   }
+
+   if( rows == 0 ) {
+      next_iterator = iterator;
+   } else if( itr == idx.end() || itr->t_id != obj.t_id ) {
+      next_iterator = keyval_cache.get_end_iterator_by_table_id( obj.t_id );
+   } else {
+      next_iterator = keyval_cache.add( *itr );
+   }
+   return rows;
 }
 
 int apply_context::db_previous_i64( int iterator, uint64_t& primary ) {
+   ++_db_intrinsics;
    const auto& idx = db.get_index<key_value_index, by_scope_primary>();
 
    if( iterator < -1 ) // is end iterator
@@ -788,7 +882,7 @@ int apply_context::db_previous_i64( int iterator, uint64_t& primary ) {
       if( itr->t_id != tab->id ) return -1; // Empty table
 
       primary = itr->primary_key;
-      return keyval_cache.add(*itr);
+      return add_keyval_read( *itr );
    }
 
    const auto& obj = keyval_cache.get(iterator); // Check for iterator != -1 happens in this call
@@ -801,12 +895,17 @@ int apply_context::db_previous_i64( int iterator, uint64_t& primary ) {
    if( itr->t_id != obj.t_id ) return -1; // cannot decrement past beginning iterator of table
 
    primary = itr->primary_key;
-   return keyval_cache.add(*itr);
+   return add_keyval_read( *itr );
 }
 
 int apply_context::db_find_i64( name code, name scope, name table, uint64_t id ) {
+   ++_db_intrinsics;
+   scoped_span span( "apply_context::db_find_i64" );
    //require_read_lock( code, scope ); // redundant?
 
+   // the absence of a row is read as well
+   record_row_access( code, scope, table, id, false );
+
    const auto* tab = find_table( code, scope, table );
    if( !tab ) return -1;
 
@@ -819,6 +918,8 @@ int apply_context::db_find_i64( name code, name scope, name table, uint64_t id )
 }
 
 int apply_context::db_lowerbound_i64( name code, name scope, name table, uint64_t id ) {
+   ++_db_intrinsics;
+   scoped_span span( "apply_context::db_lowerbound_i64" );
    //require_read_lock( code, scope ); // redundant?
 
    const auto* tab = find_table( code, scope, table );
@@ -831,10 +932,11 @@ int apply_context::db_lowerbound_i64( name code, name scope, name table, uint64_
    if( itr == idx.end() ) return table_end_itr;
    if( itr->t_id != tab->id ) return table_end_itr;
 
-   return keyval_cache.add( *itr );
+   return add_keyval_read( *itr );
 }
 
 int apply_context::db_upperbound_i64( name code, name scope, name table, uint64_t id ) {
+   ++_db_intrinsics;
    //require_read_lock( code, scope ); // redundant?
 
    const auto* tab = find_table( code, scope, table );
@@ -847,10 +949,11 @@ int apply_context::db_upperbound_i64( name code, name scope, name table, uint64_
    if( itr == idx.end() ) return table_end_itr;
    if( itr->t_id != tab->id ) return table_end_itr;
 
-   return keyval_cache.add( *itr );
+   return add_keyval_read( *itr );
 }
 
 int apply_context::db_end_i64( name code, name scope, name table ) {
+   ++_db_intrinsics;
    //require_read_lock( code, scope ); // redundant?
 
    const auto* tab = find_table( code, scope, table );
@@ -859,6 +962,179 @@ int apply_context::db_end_i64( name code, name scope, name table ) {
    return keyval_cache.cache_table( *tab );
 }
 
+void apply_context::kv_set( const char* key, uint32_t key_size, const char* value, uint32_t value_size, account_name payer ) {
+   ++_db_intrinsics;
+   scoped_span span( "apply_context::kv_set" );
+   EOS_ASSERT( key_size <= config::max_kv_key_size, kv_limit_exceeded,
+               "key of ${s} bytes is longer than the ${m} allowed", ("s", key_size)("m", config::max_kv_key_size) );
+   EOS_ASSERT( value_size <= config::max_kv_value_size, kv_limit_exceeded,
+               "value of ${s} bytes is longer than the ${m} allowed", ("s", value_size)("m", config::max_kv_value_size) );
+   EOS_ASSERT( payer != account_name(), invalid_table_payer, "must specify a valid account to pay for new record" );
+
+   const auto& idx = db.get_index<kv_index, by_kv_key>();
+   auto itr = idx.find( boost::make_tuple( receiver, std::string_view( key, key_size ) ) );
+   const int64_t new_size = (int64_t)(key_size + value_size + config::billable_size_v<kv_object>);
+
+   if( itr == idx.end() ) {
+      db.create<kv_object>( [&]( auto& o ) {
+         o.contract = receiver;
+         o.kv_key.assign_compact( key, key_size );
+         o.kv_value.assign_compact( value, value_size );
+         o.payer    = payer;
+      });
+      update_db_usage( payer, new_size );
+      return;
+   }
+
+   const int64_t old_size = (int64_t)(key_size + itr->kv_value.size() + config::billable_size_v<kv_object>);
+   if( itr->payer != payer ) {
+      // refund the existing payer
+      update_db_usage( itr->payer, -(old_size) );
+      // charge the new payer
+      update_db_usage( payer, new_size );
+   } else if( old_size != new_size ) {
+      // charge/refund the existing payer the difference
+      update_db_usage( payer, new_size - old_size );
+   }
+
+   db.modify( *itr, [&]( auto& o ) {
+      o.kv_value.assign_compact( value, value_size );
+      o.payer = payer;
+   });
+}
+
+int apply_context::kv_erase( const char* key, uint32_t key_size ) {
+   ++_db_intrinsics;
+   const auto& idx = db.get_index<kv_index, by_kv_key>();
+   auto itr = idx.find( boost::make_tuple( receiver, std::string_view( key, key_size ) ) );
+   if( itr == idx.end() ) return 0;
+
+   update_db_usage( itr->payer, -(int64_t)(itr->kv_key.size() + itr->kv_value.size() + config::billable_size_v<kv_object>) );
+   db.remove( *itr );
+   return 1;
+}
+
+int apply_context::kv_get( account_name contract, const char* key, uint32_t key_size, char* value, uint32_t value_size ) {
+   ++_db_intrinsics;
+   scoped_span span( "apply_context::kv_get" );
+   const auto& idx = db.get_index<kv_index, by_kv_key>();
+   auto itr = idx.find( boost::make_tuple( contract, std::string_view( key, key_size ) ) );
+   if( itr == idx.end() ) return -1;
+
+   const auto s = itr->kv_value.size();
+   if( value_size == 0 ) return s;
+
+   memcpy( value, itr->kv_value.data(), std::min<size_t>( value_size, s ) );
+   return s;
+}
+
+apply_context::kv_iterator& apply_context::get_kv_iterator( int itr ) {
+   EOS_ASSERT( itr >= 0 && (size_t)itr < kv_iterators.size() && kv_iterators[itr], invalid_table_iterator,
+               "not a valid key-value iterator" );
+   return *kv_iterators[itr];
+}
+
+template<typename Itr>
+int apply_context::kv_it_position( kv_iterator& it, const Itr& itr ) {
+   const auto& idx = db.get_index<kv_index, by_kv_key>();
+   if( itr == idx.end() || itr->contract != it.contract || itr->kv_key.size() < it.prefix.size()
+         || memcmp( itr->kv_key.data(), it.prefix.data(), it.prefix.size() ) != 0 ) {
+      it.key.clear();
+      it.at_end = true;
+      return -1;
+   }
+   it.key.assign( itr->kv_key.data(), itr->kv_key.size() );
+   it.at_end = false;
+   return 0;
+}
+
+int apply_context::kv_it_create( account_name contract, const char* prefix, uint32_t prefix_size ) {
+   ++_db_intrinsics;
+   EOS_ASSERT( prefix_size <= config::max_kv_key_size, kv_limit_exceeded,
+               "prefix of ${s} bytes is longer than the ${m} allowed", ("s", prefix_size)("m", config::max_kv_key_size) );
+
+   auto slot = std::find_if( kv_iterators.begin(), kv_iterators.end(), []( const auto& it ) { return !it; } );
+   if( slot == kv_iterators.end() ) {
+      EOS_ASSERT( kv_iterators.size() < config::max_kv_iterators, kv_limit_exceeded,
+                  "more than ${m} key-value iterators are open", ("m", config::max_kv_iterators) );
+      slot = kv_iterators.emplace( kv_iterators.end() );
+   }
+   const int itr = slot - kv_iterators.begin();
+   slot->emplace( kv_iterator{ contract, std::string( prefix, prefix_size ), {}, true } );
+
+   const auto& idx = db.get_index<kv_index, by_kv_key>();
+   kv_it_position( **slot, idx.lower_bound( boost::make_tuple( contract, std::string_view( prefix, prefix_size ) ) ) );
+   return itr;
+}
+
+void apply_context::kv_it_destroy( int itr ) {
+   ++_db_intrinsics;
+   get_kv_iterator( itr );
+   kv_iterators[itr].reset();
+}
+
+int apply_context::kv_it_lower_bound( int itr, const char* key, uint32_t key_size ) {
+   ++_db_intrinsics;
+   auto& it = get_kv_iterator( itr );
+   const auto& idx = db.get_index<kv_index, by_kv_key>();
+
+   // no key before the prefix can start with it
+   std::string_view k( key, key_size );
+   if( k < std::string_view( it.prefix ) ) k = it.prefix;
+   return kv_it_position( it, idx.lower_bound( boost::make_tuple( it.contract, k ) ) );
+}
+
+int apply_context::kv_it_next( int itr ) {
+   ++_db_intrinsics;
+   auto& it = get_kv_iterator( itr );
+   if( it.at_end ) return -1;
+
+   const auto& idx = db.get_index<kv_index, by_kv_key>();
+   return kv_it_position( it, idx.upper_bound( boost::make_tuple( it.contract, std::string_view( it.key ) ) ) );
+}
+
+int apply_context::kv_it_prev( int itr ) {
+   ++_db_intrinsics;
+   auto& it = get_kv_iterator( itr );
+   const auto& idx = db.get_index<kv_index, by_kv_key>();
+
+   auto next = idx.end();
+   if( !it.at_end ) {
+      next = idx.lower_bound( boost::make_tuple( it.contract, std::string_view( it.key ) ) );
+   } else {
+      // the keys starting with the prefix end where the shortest key greater than all of them starts
+      std::string past_prefix = it.prefix;
+      while( !past_prefix.empty() && static_cast<uint8_t>(past_prefix.back()) == 0xff ) past_prefix.pop_back();
+      if( past_prefix.empty() ) {
+         next = idx.upper_bound( boost::make_tuple( it.contract ) );
+      } else {
+         past_prefix.back() = static_cast<char>( static_cast<uint8_t>(past_prefix.back()) + 1 );
+         next = idx.lower_bound( boost::make_tuple( it.contract, std::string_view( past_prefix ) ) );
+      }
+   }
+
+   if( next == idx.begin() ) return kv_it_position( it, idx.end() );
+   return kv_it_position( it, std::prev( next ) );
+}
+
+int apply_context::kv_it_key( int itr, char* dest, uint32_t size ) {
+   ++_db_intrinsics;
+   const auto& it = get_kv_iterator( itr );
+   if( it.at_end ) return -1;
+   if( size == 0 ) return it.key.size();
+
+   memcpy( dest, it.key.data(), std::min<size_t>( size, it.key.size() ) );
+   return it.key.size();
+}
+
+int apply_context::kv_it_value( int itr, char* dest, uint32_t size ) {
+   ++_db_intrinsics;
+   const auto& it = get_kv_iterator( itr );
+   if( it.at_end ) return -1;
+
+   return kv_get( it.contract, it.key.data(), it.key.size(), dest, size );
+}
+
 uint64_t apply_context::next_global_sequence() {
    const auto& p = control.get_dynamic_global_properties();
    db.modify( p, [&]( auto& dgp ) {
@@ -0,0 +1,96 @@
+#include <eosio/chain/async_log.hpp>
+
+#include <fc/log/logger_config.hpp>
+
+#include <chrono>
+
+namespace eosio { namespace chain {
+
+namespace {
+   // the background thread polls the ring, the logging threads never wait on it
+   constexpr auto idle_wait = std::chrono::milliseconds(2);
+}
+
+static_assert( (async_log::ring_size & (async_log::ring_size - 1)) == 0, "ring_size must be a power of 2" );
+
+async_log& async_log::instance() {
+   static async_log log;
+   return log;
+}
+
+async_log::async_log()
+: _ring( new slot[ring_size] )
+{
+   for( size_t i = 0; i < ring_size; ++i ) _ring[i].sequence.store( i, std::memory_order_relaxed );
+   _thread = std::thread( [this]() {
+      fc::set_os_thread_name( "async_log" );
+      run();
+   } );
+}
+
+async_log::~async_log() {
+   _stopped = true;
+   _thread.join();
+}
+
+async_log::slot* async_log::acquire() {
+   size_t pos = _enqueue_pos.load( std::memory_order_relaxed );
+   while( true ) {
+      slot& s = _ring[pos & (ring_size - 1)];
+      const size_t seq = s.sequence.load( std::memory_order_acquire );
+      const auto dif = static_cast<std::ptrdiff_t>( seq ) - static_cast<std::ptrdiff_t>( pos );
+      if( dif == 0 ) {
+         if( _enqueue_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) return &s;
+      } else if( dif < 0 ) {
+         ++_dropped;
+         return nullptr;
+      } else {
+         pos = _enqueue_pos.load( std::memory_order_relaxed );
+      }
+   }
+}
+
+void async_log::publish( slot* s ) {
+   // acquire left the sequence at the slot's position, the record is readable at position + 1
+   s->sequence.store( s->sequence.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+}
+
+bool async_log::write_one() {
+   const size_t pos = _dequeue_pos.load( std::memory_order_relaxed );
+   slot& s = _ring[pos & (ring_size - 1)];
+   if( s.sequence.load( std::memory_order_acquire ) != pos + 1 ) return false;
+
+   try {
+      fc::mutable_variant_object args;
+      s.write_args( &s.args, args );
+      fc::log_context context( s.level, s.file, s.line, s.method );
+      s.logger->log( fc::log_message( context, s.format, std::move( args ) ) );
+   } catch( ... ) {
+      // a record that cannot be written is lost, later records are still written
+   }
+
+   s.sequence.store( pos + ring_size, std::memory_order_release );
+   _dequeue_pos.store( pos + 1, std::memory_order_release );
+   return true;
+}
+
+void async_log::run() {
+   while( true ) {
+      if( write_one() ) continue;
+      // records posted before stop are still written
+      if( _stopped ) {
+         if( !write_one() ) return;
+         continue;
+      }
+      std::this_thread::sleep_for( idle_wait );
+   }
+}
+
+void async_log::flush() {
+   const size_t target = _enqueue_pos.load( std::memory_order_acquire );
+   while( _dequeue_pos.load( std::memory_order_acquire ) < target ) {
+      std::this_thread::sleep_for( idle_wait );
+   }
+}
+
+} } // eosio::chain
@@ -0,0 +1,98 @@
+#include <eosio/chain/async_signal_queue.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <fc/log/logger_config.hpp>
+
+namespace eosio { namespace chain {
+
+async_signal_queue::async_signal_queue( std::string name, size_t max_size, overflow_policy policy )
+: _name( std::move( name ) )
+, _max_size( max_size )
+, _policy( policy )
+{
+   EOS_ASSERT( max_size > 0, misc_exception, "async signal queue ${n} must hold at least one handler", ("n", _name) );
+   _thread = std::thread( [this]() {
+      fc::set_os_thread_name( _name );
+      run();
+   } );
+}
+
+async_signal_queue::~async_signal_queue() {
+   stop();
+}
+
+void async_signal_queue::post( std::function<void()> handler ) {
+   {
+      std::unique_lock<std::mutex> g( _mtx );
+      if( _stopped ) return;
+      if( _handlers.size() >= _max_size ) {
+         if( _policy == overflow_policy::drop ) {
+            if( _dropped++ == 0 )
+               wlog( "async signal queue ${n} is full, dropping signals", ("n", _name) );
+            return;
+         }
+         _ran.wait( g, [this]() { return _handlers.size() < _max_size || _stopped; } );
+         if( _stopped ) return;
+      }
+      _handlers.emplace_back( std::move( handler ) );
+   }
+   _posted.notify_one();
+}
+
+void async_signal_queue::flush() {
+   std::unique_lock<std::mutex> g( _mtx );
+   _ran.wait( g, [this]() { return (_handlers.empty() && !_running) || _done; } );
+}
+
+void async_signal_queue::stop() {
+   {
+      std::lock_guard<std::mutex> g( _mtx );
+      if( _stopped ) return;
+      _stopped = true;
+   }
+   _posted.notify_one();
+   _ran.notify_all();
+   _thread.join();
+}
+
+size_t async_signal_queue::size()const {
+   std::lock_guard<std::mutex> g( _mtx );
+   return _handlers.size();
+}
+
+void async_signal_queue::run() {
+   std::unique_lock<std::mutex> g( _mtx );
+   while( true ) {
+      _posted.wait( g, [this]() { return !_handlers.empty() || _stopped; } );
+      // the handlers posted before stop still run
+      if( _handlers.empty() ) {
+         _done = true;
+         _ran.notify_all();
+         return;
+      }
+      auto handler = std::move( _handlers.front() );
+      _handlers.pop_front();
+      _running = true;
+      g.unlock();
+      try {
+         handler();
+      } catch( const fc::exception& e ) {
+         elog( "async signal queue ${n} handler threw: ${e}", ("n", _name)("e", e.to_detail_string()) );
+      } catch( const std::exception& e ) {
+         elog( "async signal queue ${n} handler threw: ${e}", ("n", _name)("e", e.what()) );
+      } catch( ... ) {
+         elog( "async signal queue ${n} handler threw", ("n", _name) );
+      }
+      g.lock();
+      _running = false;
+      _ran.notify_all();
+   }
+}
+
+async_signal_queue::overflow_policy to_overflow_policy( const std::string& policy ) {
+   if( policy == "block" ) return async_signal_queue::overflow_policy::block;
+   if( policy == "drop" ) return async_signal_queue::overflow_policy::drop;
+   EOS_THROW( misc_exception, "unknown overflow policy ${p}, block or drop expected", ("p", policy) );
+}
+
+} } // eosio::chain
@@ -110,6 +110,7 @@ namespace eosio { namespace chain {
    }
 
    void authorization_manager::read_from_snapshot( const snapshot_reader_ptr& snapshot ) {
+      authorizations_changed();
       authorization_index_set::walk_indices([this, &snapshot]( auto utils ){
          using section_t = typename decltype(utils)::index_t::value_type;
 
@@ -145,6 +146,8 @@ namespace eosio { namespace chain {
          creation_time = _control.pending_block_time();
       }
 
+      authorizations_changed();
+
       const auto& perm_usage = _db.create<permission_usage_object>([&](auto& p) {
          p.last_used = creation_time;
       });
@@ -176,6 +179,8 @@ namespace eosio { namespace chain {
          creation_time = _control.pending_block_time();
       }
 
+      authorizations_changed();
+
       const auto& perm_usage = _db.create<permission_usage_object>([&](auto& p) {
          p.last_used = creation_time;
       });
@@ -196,6 +201,7 @@ namespace eosio { namespace chain {
          EOS_ASSERT(k.key.which() < _db.get<protocol_state_object>().num_supported_key_types, unactivated_key_type,
            "Unactivated key type used when modifying permission");
 
+      authorizations_changed();
       _db.modify( permission, [&](permission_object& po) {
          po.auth = auth;
          po.last_updated = _control.pending_block_time();
@@ -208,10 +214,21 @@ namespace eosio { namespace chain {
       EOS_ASSERT( range.first == range.second, action_validate_exception,
                   "Cannot remove a permission which has children. Remove the children first.");
 
+      authorizations_changed();
       _db.get_mutable_index<permission_usage_index>().remove_object( permission.usage_id._id );
       _db.remove( permission );
    }
 
+   void authorization_manager::permission_links_changed() {
+      authorizations_changed();
+   }
+
+   void authorization_manager::authorizations_changed() {
+      std::lock_guard<std::mutex> g( _authorization_cache_mtx );
+      _authorization_cache.clear();
+      ++_revision;
+   }
+
    void authorization_manager::update_permission_usage( const permission_object& permission ) {
       const auto& puo = _db.get<permission_usage_object, by_id>( permission.usage_id );
       _db.modify( puo, [&](permission_usage_object& p) {
@@ -226,13 +243,13 @@ namespace eosio { namespace chain {
    const permission_object*  authorization_manager::find_permission( const permission_level& level )const
    { try {
       EOS_ASSERT( !level.actor.empty() && !level.permission.empty(), invalid_permission, "Invalid permission" );
-      return _db.find<permission_object, by_owner>( boost::make_tuple(level.actor,level.permission) );
+      return _db.find<permission_object, by_owner_name>( boost::make_tuple(level.actor,level.permission) );
    } EOS_RETHROW_EXCEPTIONS( chain::permission_query_exception, "Failed to retrieve permission: ${level}", ("level", level) ) }
 
    const permission_object&  authorization_manager::get_permission( const permission_level& level )const
    { try {
       EOS_ASSERT( !level.actor.empty() && !level.permission.empty(), invalid_permission, "Invalid permission" );
-      return _db.get<permission_object, by_owner>( boost::make_tuple(level.actor,level.permission) );
+      return _db.get<permission_object, by_owner_name>( boost::make_tuple(level.actor,level.permission) );
    } EOS_RETHROW_EXCEPTIONS( chain::permission_query_exception, "Failed to retrieve permission: ${level}", ("level", level) ) }
 
    optional<permission_name> authorization_manager::lookup_linked_permission( account_name authorizer_account,
@@ -433,12 +450,74 @@ namespace eosio { namespace chain {
       return (itr->delay_until - itr->published);
    }
 
+   bool authorization_manager::is_cached_authorization( const permission_level& permission,
+                                                        const flat_set<public_key_type>& provided_keys,
+                                                        fc::microseconds provided_delay,
+                                                        uint16_t max_authority_depth )const
+   {
+      std::lock_guard<std::mutex> g( _authorization_cache_mtx );
+      auto itr = _authorization_cache.find( permission );
+      if( itr == _authorization_cache.end() ) return false;
+
+      const auto& cached = itr->second;
+      if( cached.provided_delay != provided_delay || cached.max_authority_depth != max_authority_depth
+          || cached.provided_keys != provided_keys )
+         return false;
+
+      for( const auto& p : cached.permissions ) {
+         const auto* po = _db.find<permission_object>( p.first );
+         if( po == nullptr || po->last_updated != p.second ) {
+            _authorization_cache.erase( itr );
+            return false;
+         }
+      }
+      return true;
+   }
+
+   void authorization_manager::cache_authorization( const permission_level& permission,
+                                                    const flat_set<public_key_type>& provided_keys,
+                                                    fc::microseconds provided_delay,
+                                                    uint16_t max_authority_depth,
+                                                    vector<std::pair<permission_id_type, time_point>>&& permissions )const
+   {
+      // a permission last updated in a reversible block can be replaced by one with the same id and last_updated
+      const auto lib_time = _control.last_irreversible_block_time();
+      for( const auto& p : permissions ) {
+         if( p.second > lib_time ) return;
+      }
+
+      std::lock_guard<std::mutex> g( _authorization_cache_mtx );
+      if( _authorization_cache.size() >= max_cached_authorizations )
+         _authorization_cache.clear();
+
+      auto& cached = _authorization_cache[permission];
+      cached.provided_keys = provided_keys;
+      cached.provided_delay = provided_delay;
+      cached.max_authority_depth = max_authority_depth;
+      cached.permissions = std::move( permissions );
+   }
+
    void noop_checktime() {}
 
    std::function<void()> authorization_manager::_noop_checktime{&noop_checktime};
 
    void
    authorization_manager::check_authorization( const vector<action>&                actions,
+                                               const flat_set<public_key_type>&     provided_keys,
+                                               const flat_set<permission_level>&    provided_permissions,
+                                               fc::microseconds                     provided_delay,
+                                               const std::function<void()>&         checktime,
+                                               bool                                 allow_unused_keys,
+                                               const flat_set<permission_level>&    satisfied_authorizations
+                                             )const
+   {
+      check_authorization( actions.data(), actions.size(), provided_keys, provided_permissions, provided_delay,
+                           checktime, allow_unused_keys, satisfied_authorizations );
+   }
+
+   void
+   authorization_manager::check_authorization( const action*                        actions,
+                                               size_t                               num_actions,
                                                const flat_set<public_key_type>&     provided_keys,
                                                const flat_set<permission_level>&    provided_permissions,
                                                fc::microseconds                     provided_delay,
@@ -453,8 +532,15 @@ namespace eosio { namespace chain {
 
       auto effective_provided_delay =  (provided_delay >= delay_max_limit) ? fc::microseconds::maximum() : provided_delay;
 
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
-                                        _control.get_global_properties().configuration.max_authority_depth,
+      const uint16_t max_authority_depth = _control.get_global_properties().configuration.max_authority_depth;
+
+      vector<std::pair<permission_id_type, time_point>> visited_permissions;
+      auto checker = make_auth_checker( [&](const permission_level& p){
+                                           const auto& perm = get_permission(p);
+                                           visited_permissions.emplace_back( perm.id, perm.last_updated );
+                                           return perm.auth;
+                                        },
+                                        max_authority_depth,
                                         provided_keys,
                                         provided_permissions,
                                         effective_provided_delay,
@@ -463,7 +549,8 @@ namespace eosio { namespace chain {
 
       map<permission_level, fc::microseconds> permissions_to_satisfy;
 
-      for( const auto& act : actions ) {
+      for( size_t i = 0; i < num_actions; ++i ) {
+         const action& act = actions[i];
          bool special_case = false;
          fc::microseconds delay = effective_provided_delay;
 
@@ -510,6 +597,13 @@ namespace eosio { namespace chain {
          }
       }
 
+      // A single declared authorization satisfied by the provided keys alone may already have been checked
+      const bool cacheable = provided_permissions.empty() && permissions_to_satisfy.size() == 1;
+      if( cacheable && is_cached_authorization( permissions_to_satisfy.begin()->first, provided_keys,
+                                                permissions_to_satisfy.begin()->second, max_authority_depth ) ) {
+         return;
+      }
+
       // Now verify that all the declared authorizations are satisfied:
 
       // Although this can be made parallel (especially for input transactions) with the optimistic assumption that the
@@ -538,6 +632,12 @@ namespace eosio { namespace chain {
                      "transaction bears irrelevant signatures from these keys: ${keys}",
                      ("keys", checker.unused_keys()) );
       }
+
+      // the keys used by several authorizations do not tell which authorization used which key, so only one is cached
+      if( cacheable && checker.all_keys_used() ) {
+         cache_authorization( permissions_to_satisfy.begin()->first, provided_keys, permissions_to_satisfy.begin()->second,
+                              max_authority_depth, std::move( visited_permissions ) );
+      }
    }
 
    void
@@ -585,23 +685,9 @@ namespace eosio { namespace chain {
                                                                        fc::microseconds provided_delay
                                                                      )const
    {
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
-                                        _control.get_global_properties().configuration.max_authority_depth,
-                                        candidate_keys,
-                                        {},
-                                        provided_delay,
-                                        _noop_checktime
-                                      );
-
-      for (const auto& act : trx.actions ) {
-         for (const auto& declared_auth : act.authorization) {
-            EOS_ASSERT( checker.satisfied(declared_auth), unsatisfied_authorization,
-                        "transaction declares authority '${auth}', but does not have signatures for it.",
-                        ("auth", declared_auth) );
-         }
-      }
-
-      return checker.used_keys();
+      return get_required_keys( trx, candidate_keys, provided_delay,
+                                [&](const permission_level& p){ return get_permission(p).auth; },
+                                _control.get_global_properties().configuration.max_authority_depth );
    }
 
 } } /// namespace eosio::chain
@@ -1,10 +1,25 @@
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/merkle.hpp>
 #include <fstream>
 #include <fc/bitutil.hpp>
 #include <fc/io/cfile.hpp>
 #include <fc/io/raw.hpp>
-
+#include <fc/log/logger_config.hpp>
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
 
 #define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
@@ -12,6 +27,11 @@
 #define LOG_WRITE_C "ab+"
 #define LOG_RW_C "rb+"
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #ifndef _WIN32
 #define FC_FOPEN(p, m) fopen(p, m)
 #else
@@ -31,11 +51,122 @@ namespace eosio { namespace chain {
     *            this is in the form of an first_block_num that is written immediately after the version
     * Version 3: improvement on version 2 to not require the genesis state be provided when not starting
     *            from block 1
+    * Version 4: same header as version 3, each block is stored as its uncompressed block_header followed by
+    *            the compressed remainder of the signed_block
     */
-   const uint32_t block_log::max_supported_version = 3;
+   const uint32_t block_log::max_supported_version = 4;
 
    namespace detail {
       using unique_file = std::unique_ptr<FILE, decltype(&fclose)>;
+      namespace bio = boost::iostreams;
+
+      constexpr uint32_t first_compressed_version = 4;
+
+      enum class block_compression : uint8_t {
+         none = 0,
+         zlib = 1
+      };
+
+      class decompress_limiter {
+      public:
+         using char_type = char;
+         using category = bio::multichar_output_filter_tag;
+
+         explicit decompress_limiter( size_t limit ) : _limit(limit) {}
+
+         template<typename Sink>
+         size_t write(Sink& sink, const char* s, size_t count) {
+            EOS_ASSERT( _total + count <= _limit, block_log_exception, "Decompressed block exceeds its recorded size" );
+            _total += count;
+            return bio::write(sink, s, count);
+         }
+
+      private:
+         size_t _limit;
+         size_t _total = 0;
+      };
+
+      /// serialize b the way it is stored in a block log of the given version
+      std::vector<char> pack_block_entry( const signed_block& b, uint32_t version ) {
+         auto data = fc::raw::pack(b);
+         if( version < first_compressed_version )
+            return data;
+
+         const size_t header_size = fc::raw::pack_size( static_cast<const block_header&>(b) );
+         std::vector<char> compressed;
+         {
+            bio::filtering_ostream comp;
+            comp.push(bio::zlib_compressor(bio::zlib::default_compression));
+            comp.push(bio::back_inserter(compressed));
+            bio::write(comp, data.data() + header_size, data.size() - header_size);
+            bio::close(comp);
+         }
+
+         const uint32_t uncompressed_size = data.size() - header_size;
+         const uint32_t stored_size = compressed.size();
+         constexpr size_t prefix_size = sizeof(uint8_t) + sizeof(uncompressed_size) + sizeof(stored_size);
+         data.resize( header_size + prefix_size + stored_size );
+         fc::datastream<char*> ds( data.data() + header_size, data.size() - header_size );
+         fc::raw::pack( ds, static_cast<uint8_t>(block_compression::zlib) );
+         fc::raw::pack( ds, uncompressed_size );
+         fc::raw::pack( ds, stored_size );
+         ds.write( compressed.data(), compressed.size() );
+         return data;
+      }
+
+      /// read the stored remainder of a compressed block entry positioned right after its block_header
+      template<typename Stream>
+      std::vector<char> unpack_block_entry_rest( Stream& stream, uint32_t block_num ) {
+         uint8_t compression = 0;
+         uint32_t uncompressed_size = 0;
+         uint32_t stored_size = 0;
+         fc::raw::unpack( stream, compression );
+         fc::raw::unpack( stream, uncompressed_size );
+         fc::raw::unpack( stream, stored_size );
+
+         std::vector<char> stored( stored_size );
+         stream.read( stored.data(), stored.size() );
+
+         std::vector<char> rest;
+         switch( static_cast<block_compression>(compression) ) {
+            case block_compression::none:
+               rest = std::move( stored );
+               break;
+            case block_compression::zlib: {
+               rest.reserve( uncompressed_size );
+               bio::filtering_ostream decomp;
+               decomp.push(bio::zlib_decompressor());
+               decomp.push(decompress_limiter(uncompressed_size));
+               decomp.push(bio::back_inserter(rest));
+               bio::write(decomp, stored.data(), stored.size());
+               bio::close(decomp);
+               break;
+            }
+            default:
+               EOS_THROW( block_log_exception, "Unknown block compression ${c} for block ${num}",
+                          ("c", compression)("num", block_num) );
+         }
+         EOS_ASSERT( rest.size() == uncompressed_size, block_log_exception,
+                     "Block ${num} decompressed to ${act} bytes, expected ${exp} bytes",
+                     ("num", block_num)("act", rest.size())("exp", uncompressed_size) );
+         return rest;
+      }
+
+      /// read one block, as written by pack_block_entry, from stream
+      template<typename Stream>
+      void unpack_block_entry( Stream& stream, signed_block& b, uint32_t version ) {
+         if( version < first_compressed_version ) {
+            fc::raw::unpack( stream, b );
+            return;
+         }
+
+         fc::raw::unpack( stream, static_cast<block_header&>(b) );
+         const auto rest = unpack_block_entry_rest( stream, b.block_num() );
+         fc::datastream<const char*> ds( rest.data(), rest.size() );
+         fc::raw::unpack( ds, b.producer_signature );
+         fc::raw::unpack( ds, b.transactions );
+         fc::raw::unpack( ds, b.block_extensions );
+      }
 
       class block_log_impl {
          public:
@@ -48,6 +179,38 @@ namespace eosio { namespace chain {
             uint32_t                 version = 0;
             uint32_t                 first_block_num = 0;
 
+            /// a blocks.log segment that was split off into the retained directory
+            struct retained_segment {
+               uint32_t              first_block_num = 0;
+               uint32_t              last_block_num = 0;
+               fc::path              block_file_name;
+               fc::path              index_file_name;
+            };
+
+            fc::path                 data_dir;
+            block_log_config         config;
+            fc::path                 retained_dir;
+            fc::path                 archive_dir;
+            /// guards the retained members, which const reads update when they open another segment
+            mutable std::mutex       retained_mtx;
+            std::map<uint32_t, retained_segment> retained; ///< keyed by last block number of the segment
+            fc::cfile                retained_block_file;  ///< last read segment, kept open for sequential reads
+            fc::cfile                retained_index_file;
+            uint32_t                 retained_open_first = 0;
+            uint32_t                 retained_version = 0;
+            std::shared_ptr<boost::iostreams::mapped_file_source> block_file_mapping; ///< read only view of blocks.log
+
+            /// background writer, used when config.write_queue_size > 0
+            std::thread                   writer;
+            std::mutex                    write_mtx;
+            std::condition_variable       write_cv;      ///< signals the writer that blocks are queued or it should stop
+            std::condition_variable       written_cv;    ///< signals appending threads that queued blocks were written
+            std::deque<signed_block_ptr>  pending;       ///< appended but not yet written, stays queued until written
+            bool                          stop_writer = false;
+            std::exception_ptr            writer_error;
+            uint64_t                      written_end = 0; ///< size of blocks.log after the last written batch
+            uint32_t                      blocks_since_sync = 0;
+
             inline void check_open_files() {
                if( !open_files ) {
                   reopen();
@@ -56,15 +219,20 @@ namespace eosio { namespace chain {
             void reopen();
 
             void close() {
+               stop_writing();
                if( block_file.is_open() )
                   block_file.close();
                if( index_file.is_open() )
                   index_file.close();
                open_files = false;
+               block_file_mapping.reset();
             }
 
+            /// @return mapping of blocks.log that covers at least the first size bytes
+            const std::shared_ptr<boost::iostreams::mapped_file_source>& map_block_file( uint64_t size );
+
             template<typename T>
-            void reset( const T& t, const signed_block_ptr& genesis_block, uint32_t first_block_num );
+            void reset( const T& t, const signed_block_ptr& genesis_block, uint32_t first_block_num, uint32_t new_version );
 
             void write( const genesis_state& gs );
 
@@ -74,10 +242,139 @@ namespace eosio { namespace chain {
 
             uint64_t append(const signed_block_ptr& b);
 
+            /// pack b and write it with its position to the end of bf and idx, @return position of b
+            uint64_t write_block( fc::cfile& bf, fc::cfile& idx, const signed_block& b );
+            void sync_on_cadence( fc::cfile& bf, fc::cfile& idx, uint32_t blocks );
+            void write_loop();
+            /// wait for the writer to write all queued blocks, rethrows a failure of the writer
+            void wait_for_writes();
+            /// write all queued blocks and join the writer thread
+            void stop_writing();
+            /// @return block queued for the writer, nullptr if block_num is not queued
+            signed_block_ptr find_pending( uint32_t block_num );
+            bool is_written( uint32_t block_num );
+
+            void load_retained();
+            void split_log();
+            void clear_retained();
+            /// prune_retained, close_retained and open_retained expect retained_mtx to be held
+            void prune_retained();
+            void close_retained();
+            /// @return position of block_num in the opened retained segment, block_log::npos if not retained
+            uint64_t open_retained( uint32_t block_num );
+
             template <typename ChainContext, typename Lambda>
             static fc::optional<ChainContext> extract_chain_context( const fc::path& data_dir, Lambda&& lambda );
       };
 
+      uint64_t detail::block_log_impl::write_block( fc::cfile& bf, fc::cfile& idx, const signed_block& b ) {
+         bf.seek_end(0);
+         idx.seek_end(0);
+         uint64_t pos = bf.tellp();
+         EOS_ASSERT(idx.tellp() == sizeof(uint64_t) * (b.block_num() - first_block_num),
+                   block_log_append_fail,
+                   "Append to index file occuring at wrong position.",
+                   ("position", (uint64_t) idx.tellp())
+                   ("expected", (b.block_num() - first_block_num) * sizeof(uint64_t)));
+         auto data = pack_block_entry(b, version);
+         bf.write(data.data(), data.size());
+         bf.write((char*)&pos, sizeof(pos));
+         idx.write((char*)&pos, sizeof(pos));
+         return pos;
+      }
+
+      void detail::block_log_impl::sync_on_cadence( fc::cfile& bf, fc::cfile& idx, uint32_t blocks ) {
+         if( config.fsync_interval == 0 )
+            return;
+         blocks_since_sync += blocks;
+         if( blocks_since_sync >= config.fsync_interval ) {
+            bf.sync();
+            idx.sync();
+            blocks_since_sync = 0;
+         }
+      }
+
+      void detail::block_log_impl::write_loop() {
+         fc::cfile bf;
+         fc::cfile idx;
+         try {
+            bf.set_file_path( block_file.get_file_path() );
+            idx.set_file_path( index_file.get_file_path() );
+            bf.open( LOG_WRITE_C );
+            idx.open( LOG_WRITE_C );
+
+            std::vector<signed_block_ptr> batch;
+            while( true ) {
+               {
+                  std::unique_lock<std::mutex> g( write_mtx );
+                  write_cv.wait( g, [this]() { return !pending.empty() || stop_writer; } );
+                  if( pending.empty() )
+                     break;
+                  batch.assign( pending.begin(), pending.end() );
+               }
+
+               for( const auto& b : batch )
+                  write_block( bf, idx, *b );
+               bf.flush();
+               idx.flush();
+               sync_on_cadence( bf, idx, batch.size() );
+
+               std::lock_guard<std::mutex> g( write_mtx );
+               pending.erase( pending.begin(), pending.begin() + batch.size() );
+               written_end = bf.tellp();
+               written_cv.notify_all();
+            }
+         } catch( ... ) {
+            std::lock_guard<std::mutex> g( write_mtx );
+            writer_error = std::current_exception();
+            written_cv.notify_all();
+         }
+      }
+
+      void detail::block_log_impl::wait_for_writes() {
+         std::unique_lock<std::mutex> g( write_mtx );
+         written_cv.wait( g, [this]() { return pending.empty() || writer_error; } );
+         if( writer_error )
+            std::rethrow_exception( writer_error );
+      }
+
+      void detail::block_log_impl::stop_writing() {
+         if( !writer.joinable() )
+            return;
+         {
+            std::lock_guard<std::mutex> g( write_mtx );
+            stop_writer = true;
+            write_cv.notify_one();
+         }
+         writer.join();
+         stop_writer = false;
+         if( writer_error ) {
+            try {
+               std::rethrow_exception( writer_error );
+            } FC_LOG_AND_DROP()
+            elog( "Block log writer failed, ${n} blocks starting at ${num} were not written",
+                  ("n", pending.size())("num", pending.empty() ? 0 : pending.front()->block_num()) );
+            writer_error = nullptr;
+            pending.clear();
+            // blocks.log ends with the last block written, which is the head found when opened again
+            head.reset();
+            head_id = {};
+         }
+      }
+
+      signed_block_ptr detail::block_log_impl::find_pending( uint32_t block_num ) {
+         std::lock_guard<std::mutex> g( write_mtx );
+         if( pending.empty() || block_num < pending.front()->block_num() )
+            return {};
+         const size_t i = block_num - pending.front()->block_num();
+         return i < pending.size() ? pending[i] : signed_block_ptr();
+      }
+
+      bool detail::block_log_impl::is_written( uint32_t block_num ) {
+         std::lock_guard<std::mutex> g( write_mtx );
+         return pending.empty() || block_num < pending.front()->block_num();
+      }
+
       void detail::block_log_impl::reopen() {
          close();
 
@@ -147,6 +444,58 @@ namespace eosio { namespace chain {
          constexpr static uint64_t          _max_buffer_length        = file_location_to_buffer_location(_buffer_bytes);
       };
 
+      /*
+       *  @brief rebuilds blocks.index with one thread per region of blocks.log
+       *
+       *  Every thread finds the first trailing position field at or after the end of its region, by checking
+       *  candidates against the block numbers of the entry they point to and of the entries around it. It then
+       *  follows the trailing positions back to the start of its region, like reverse_iterator does, and writes
+       *  the positions of the blocks that start inside its region. The parts are only accepted when they cover
+       *  every block exactly once.
+       */
+      class parallel_index_builder {
+      public:
+         parallel_index_builder(const fc::path& block_file_name, const fc::path& index_file_name,
+                                uint32_t version, uint32_t first_block_num, uint32_t last_block_num);
+         /// @return false if the regions could not be stitched together, the index file is then incomplete
+         bool build(uint32_t num_threads);
+         constexpr static uint64_t          _min_region_size          = 1ULL << 26;
+      private:
+         struct region_result {
+            uint32_t                        lowest_block = 0;
+            uint32_t                        highest_block = 0;
+            uint32_t                        blocks = 0;
+         };
+
+         /// positioned reads of blocks.log through a buffered window
+         class reader {
+         public:
+            reader(const std::string& block_file_name, uint64_t eof);
+            /// @return pointer to size bytes at pos, valid until the next call
+            const char* at(uint64_t pos, size_t size, bool backward);
+            uint64_t    read_pos(uint64_t pos, bool backward);
+            uint32_t    read_block_num(uint64_t block_pos, bool backward);
+         private:
+            unique_file                     _file;
+            const std::string               _block_file_name;
+            const uint64_t                  _eof;
+            std::unique_ptr<char[]>         _buffer_ptr;
+            uint64_t                        _start = 0;
+            uint64_t                        _end = 0;
+         };
+
+         bool is_trailer(reader& r, uint64_t pos);
+         region_result build_region(uint64_t region_start, uint64_t region_end);
+
+         const std::string                  _block_file_name;
+         const std::string                  _block_index_name;
+         const uint32_t                     _version;
+         const uint32_t                     _first_block_num;
+         const uint32_t                     _last_block_num;
+         uint64_t                           _first_block_pos = 0;
+         uint64_t                           _eof = 0;
+      };
+
       /*
        *  @brief datastream adapter that adapts FILE* for use with fc unpack
        *
@@ -181,8 +530,9 @@ namespace eosio { namespace chain {
       };
    }
 
-   block_log::block_log(const fc::path& data_dir)
+   block_log::block_log(const fc::path& data_dir, const block_log_config& config)
    :my(new detail::block_log_impl()) {
+      my->config = config;
       open(data_dir);
    }
 
@@ -192,7 +542,8 @@ namespace eosio { namespace chain {
 
    block_log::~block_log() {
       if (my) {
-         flush();
+         my->stop_writing();
+         my->flush();
          my->close();
          my.reset();
       }
@@ -206,6 +557,7 @@ namespace eosio { namespace chain {
 
       my->block_file.set_file_path( data_dir / "blocks.log" );
       my->index_file.set_file_path( data_dir / "blocks.index" );
+      my->data_dir = data_dir;
 
       my->reopen();
 
@@ -284,9 +636,146 @@ namespace eosio { namespace chain {
          fc::remove_all( my->index_file.get_file_path() );
          my->reopen();
       }
+
+      my->load_retained();
+   }
+
+   void detail::block_log_impl::load_retained() {
+      std::lock_guard<std::mutex> g( retained_mtx );
+      close_retained();
+      retained.clear();
+      retained_dir = config.retained_dir.is_relative() ? data_dir / config.retained_dir : config.retained_dir;
+      archive_dir = config.archive_dir.is_relative() && !config.archive_dir.empty() ? data_dir / config.archive_dir
+                                                                                    : config.archive_dir;
+      if( config.stride > 0 && !fc::is_directory(retained_dir) )
+         fc::create_directories(retained_dir);
+      if( first_block_num <= 1 || !fc::is_directory(retained_dir) )
+         return;
+
+      std::map<uint32_t, retained_segment> found;
+      for( boost::filesystem::directory_iterator enditr, itr{retained_dir}; itr != enditr; ++itr ) {
+         const auto& p = itr->path();
+         uint32_t first = 0, last = 0;
+         char tail = 0;
+         if( p.extension() != ".log" ||
+             sscanf( p.stem().generic_string().c_str(), "blocks-%u-%u%c", &first, &last, &tail ) != 2 ||
+             first == 0 || first > last )
+            continue;
+         auto index_name = p;
+         index_name.replace_extension( ".index" );
+         if( !boost::filesystem::is_regular_file(index_name) ) {
+            wlog( "Ignoring retained block log ${f} without index", ("f", p.generic_string()) );
+            continue;
+         }
+         found[last] = retained_segment{ first, last, fc::path(p), fc::path(index_name) };
+      }
+
+      // only segments that reach the current blocks.log without gaps can be served
+      uint32_t next = first_block_num;
+      for( auto itr = found.find( next - 1 ); itr != found.end(); itr = found.find( next - 1 ) ) {
+         next = itr->second.first_block_num;
+         retained.insert( *itr );
+         if( next == 1 ) break;
+      }
+      if( !retained.empty() )
+         ilog( "Retained block logs contain blocks ${first} through ${last}",
+               ("first", retained.begin()->second.first_block_num)("last", first_block_num - 1) );
+   }
+
+   void detail::block_log_impl::split_log() {
+      const uint32_t last = head->block_num();
+      const auto chain_id = block_log::extract_chain_id( data_dir );
+      const std::string name = "blocks-" + std::to_string(first_block_num) + "-" + std::to_string(last);
+      retained_segment segment{ first_block_num, last, retained_dir / (name + ".log"), retained_dir / (name + ".index") };
+
+      flush();
+      close();
+      fc::rename( block_file.get_file_path(), segment.block_file_name );
+      fc::rename( index_file.get_file_path(), segment.index_file_name );
+      ilog( "Split block log, blocks ${first} through ${last} moved to ${f}",
+            ("first", first_block_num)("last", last)("f", segment.block_file_name.generic_string()) );
+      {
+         std::lock_guard<std::mutex> g( retained_mtx );
+         retained[last] = std::move(segment);
+      }
+
+      reset( chain_id, signed_block_ptr(), last + 1, config.version );
+      std::lock_guard<std::mutex> g( retained_mtx );
+      prune_retained();
+   }
+
+   void detail::block_log_impl::clear_retained() {
+      std::lock_guard<std::mutex> g( retained_mtx );
+      close_retained();
+      retained.clear();
+   }
+
+   void detail::block_log_impl::prune_retained() {
+      while( retained.size() > config.max_retained_files ) {
+         const auto segment = retained.begin()->second;
+         if( retained_open_first == segment.first_block_num )
+            close_retained();
+         retained.erase( retained.begin() );
+         if( archive_dir.empty() ) {
+            fc::remove( segment.block_file_name );
+            fc::remove( segment.index_file_name );
+            ilog( "Removed retained block log ${f}", ("f", segment.block_file_name.generic_string()) );
+         } else {
+            if( !fc::is_directory(archive_dir) )
+               fc::create_directories(archive_dir);
+            fc::rename( segment.block_file_name, archive_dir / segment.block_file_name.filename() );
+            fc::rename( segment.index_file_name, archive_dir / segment.index_file_name.filename() );
+            ilog( "Moved retained block log ${f} to ${dir}",
+                  ("f", segment.block_file_name.generic_string())("dir", archive_dir.generic_string()) );
+         }
+      }
+   }
+
+   void detail::block_log_impl::close_retained() {
+      if( retained_block_file.is_open() )
+         retained_block_file.close();
+      if( retained_index_file.is_open() )
+         retained_index_file.close();
+      retained_open_first = 0;
+   }
+
+   uint64_t detail::block_log_impl::open_retained( uint32_t block_num ) {
+      auto itr = retained.lower_bound( block_num );
+      if( itr == retained.end() || block_num < itr->second.first_block_num )
+         return block_log::npos;
+      const auto& segment = itr->second;
+      if( retained_open_first != segment.first_block_num ) {
+         close_retained();
+         retained_block_file.set_file_path( segment.block_file_name );
+         retained_index_file.set_file_path( segment.index_file_name );
+         retained_block_file.open( "rb" );
+         retained_index_file.open( "rb" );
+         retained_version = 0;
+         retained_block_file.read( (char*)&retained_version, sizeof(retained_version) );
+         EOS_ASSERT( block_log::is_supported_version(retained_version), block_log_unsupported_version,
+                     "Unsupported version ${v} of retained block log ${f}",
+                     ("v", retained_version)("f", segment.block_file_name.generic_string()) );
+         retained_open_first = segment.first_block_num;
+      }
+      retained_index_file.seek( sizeof(uint64_t) * (block_num - segment.first_block_num) );
+      uint64_t pos;
+      retained_index_file.read( (char*)&pos, sizeof(pos) );
+      return pos;
+   }
+
+   const std::shared_ptr<boost::iostreams::mapped_file_source>& detail::block_log_impl::map_block_file( uint64_t size ) {
+      if( !block_file_mapping || block_file_mapping->size() < size ) {
+         // views handed out earlier keep the previous mapping alive
+         block_file_mapping = std::make_shared<boost::iostreams::mapped_file_source>( block_file.get_file_path().generic_string() );
+         EOS_ASSERT( block_file_mapping->size() >= size, block_log_exception,
+                     "Block log ${f} is smaller than expected", ("f", block_file.get_file_path().generic_string()) );
+      }
+      return block_file_mapping;
    }
 
    uint64_t block_log::append(const signed_block_ptr& b) {
+      if( my->config.stride > 0 && my->head && my->head->block_num() % my->config.stride == 0 )
+         my->split_log();
       return my->append(b);
    }
 
@@ -296,22 +785,37 @@ namespace eosio { namespace chain {
 
          check_open_files();
 
-         block_file.seek_end(0);
-         index_file.seek_end(0);
-         uint64_t pos = block_file.tellp();
-         EOS_ASSERT(index_file.tellp() == sizeof(uint64_t) * (b->block_num() - first_block_num),
-                   block_log_append_fail,
-                   "Append to index file occuring at wrong position.",
-                   ("position", (uint64_t) index_file.tellp())
-                   ("expected", (b->block_num() - first_block_num) * sizeof(uint64_t)));
-         auto data = fc::raw::pack(*b);
-         block_file.write(data.data(), data.size());
-         block_file.write((char*)&pos, sizeof(pos));
-         index_file.write((char*)&pos, sizeof(pos));
+         if( config.write_queue_size > 0 ) {
+            const uint32_t expected = head ? head->block_num() + 1 : first_block_num;
+            EOS_ASSERT( b->block_num() == expected, block_log_append_fail,
+                        "Append to block log of block ${num} out of order, expected block ${expected}",
+                        ("num", b->block_num())("expected", expected) );
+
+            std::unique_lock<std::mutex> g( write_mtx );
+            if( !writer.joinable() && !writer_error ) {
+               written_end = fc::file_size( block_file.get_file_path() );
+               writer = std::thread( [this]() {
+                  fc::set_os_thread_name( "blocklog" );
+                  write_loop();
+               } );
+            }
+            // bounded queue, block the appending thread only once the writer fell behind by write_queue_size blocks
+            written_cv.wait( g, [this]() { return pending.size() < config.write_queue_size || writer_error; } );
+            if( writer_error )
+               std::rethrow_exception( writer_error );
+            pending.push_back( b );
+            write_cv.notify_one();
+            head = b;
+            head_id = b->id();
+            return block_log::npos;
+         }
+
+         uint64_t pos = write_block( block_file, index_file, *b );
          head = b;
          head_id = b->id();
 
          flush();
+         sync_on_cadence( block_file, index_file, 1 );
 
          return pos;
       }
@@ -319,6 +823,7 @@ namespace eosio { namespace chain {
    }
 
    void block_log::flush() {
+      my->wait_for_writes();
       my->flush();
    }
 
@@ -328,7 +833,9 @@ namespace eosio { namespace chain {
    }
 
    template<typename T>
-   void detail::block_log_impl::reset( const T& t, const signed_block_ptr& first_block, uint32_t first_bnum ) {
+   void detail::block_log_impl::reset( const T& t, const signed_block_ptr& first_block, uint32_t first_bnum, uint32_t new_version ) {
+      EOS_ASSERT( new_version >= 3 && block_log::is_supported_version(new_version), block_log_unsupported_version,
+                  "Cannot create a block log with version ${v}", ("v", new_version) );
       close();
 
       fc::remove_all( block_file.get_file_path() );
@@ -336,11 +843,12 @@ namespace eosio { namespace chain {
 
       reopen();
 
-      version = 0; // version of 0 is invalid; it indicates that subsequent data was not properly written to the block log
+      const uint32_t unset_version = 0; // version of 0 is invalid; it indicates that subsequent data was not properly written to the block log
+      version = new_version;            // the format blocks get appended in
       first_block_num = first_bnum;
 
       block_file.seek_end(0);
-      block_file.write((char*)&version, sizeof(version));
+      block_file.write((char*)&unset_version, sizeof(unset_version));
       block_file.write((char*)&first_block_num, sizeof(first_block_num));
 
       write(t);
@@ -362,7 +870,6 @@ namespace eosio { namespace chain {
       static_assert( block_log::max_supported_version > 0, "a version number of zero is not supported" );
 
       // going back to write correct version to indicate that all block log header data writes completed successfully
-      version = block_log::max_supported_version;
       block_file.seek( 0 );
       block_file.write( (char*)&version, sizeof(version) );
       block_file.seek( pos );
@@ -370,13 +877,15 @@ namespace eosio { namespace chain {
    }
 
    void block_log::reset( const genesis_state& gs, const signed_block_ptr& first_block ) {
-      my->reset(gs, first_block, 1);
+      my->clear_retained();
+      my->reset(gs, first_block, 1, my->config.version);
    }
 
    void block_log::reset( const chain_id_type& chain_id, uint32_t first_block_num ) {
       EOS_ASSERT( first_block_num > 1, block_log_exception,
                   "Block log version ${ver} needs to be created with a genesis state if starting from block number 1." );
-      my->reset(chain_id, signed_block_ptr(), first_block_num);
+      my->clear_retained();
+      my->reset(chain_id, signed_block_ptr(), first_block_num, my->config.version);
    }
 
    void detail::block_log_impl::write( const genesis_state& gs ) {
@@ -394,7 +903,7 @@ namespace eosio { namespace chain {
       my->block_file.seek(pos);
       signed_block_ptr result = std::make_shared<signed_block>();
       auto ds = my->block_file.create_datastream();
-      fc::raw::unpack(ds, *result);
+      detail::unpack_block_entry(ds, *result, my->version);
       return result;
    }
 
@@ -409,6 +918,21 @@ namespace eosio { namespace chain {
    signed_block_ptr block_log::read_block_by_num(uint32_t block_num)const {
       try {
          signed_block_ptr b;
+         if (block_num < my->first_block_num) {
+            std::lock_guard<std::mutex> g( my->retained_mtx );
+            uint64_t pos = my->open_retained(block_num);
+            if (pos != npos) {
+               my->retained_block_file.seek(pos);
+               b = std::make_shared<signed_block>();
+               auto ds = my->retained_block_file.create_datastream();
+               detail::unpack_block_entry(ds, *b, my->retained_version);
+               EOS_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
+                          "Wrong block was read from retained block log.", ("returned", b->block_num())("expected", block_num));
+            }
+            return b;
+         }
+         if ((b = my->find_pending(block_num)))
+            return b;
          uint64_t pos = get_block_pos(block_num);
          if (pos != npos) {
             b = read_block(pos);
@@ -419,8 +943,95 @@ namespace eosio { namespace chain {
       } FC_LOG_AND_RETHROW()
    }
 
+   packed_block_view block_log::read_packed_block_by_num(uint32_t block_num)const {
+      try {
+         packed_block_view result;
+         if (block_num < my->first_block_num) {
+            // retained segments are rarely read, so they are not mapped
+            if (auto b = read_block_by_num(block_num)) {
+               auto packed = std::make_shared<std::vector<char>>(fc::raw::pack(*b));
+               result.data = packed->data();
+               result.size = packed->size();
+               result.owner = std::move(packed);
+            }
+            return result;
+         }
+
+         if (auto b = my->find_pending(block_num)) {
+            auto packed = std::make_shared<std::vector<char>>(fc::raw::pack(*b));
+            result.data = packed->data();
+            result.size = packed->size();
+            result.owner = std::move(packed);
+            return result;
+         }
+
+         const uint64_t pos = get_block_pos(block_num);
+         if (pos == npos)
+            return result;
+         // every entry is followed by its position, the next entry starts right after that
+         uint64_t end = npos;
+         if (block_num < block_header::num_from_id(my->head_id)) {
+            const uint64_t next_pos = get_block_pos(block_num + 1);
+            if (next_pos != npos) {
+               end = next_pos - sizeof(uint64_t);
+            } else {
+               // next block is still being written by the background writer
+               std::lock_guard<std::mutex> g(my->write_mtx);
+               end = my->written_end - sizeof(uint64_t);
+            }
+         } else {
+            my->block_file.seek_end(0);
+            end = my->block_file.tellp() - sizeof(uint64_t);
+         }
+         EOS_ASSERT(pos + trim_data::blknum_offset + sizeof(uint32_t) <= end, block_log_exception,
+                    "Block ${num} in block log is malformed", ("num", block_num));
+
+         const auto& mapping = my->map_block_file(end);
+         const char* const entry = mapping->data() + pos;
+         uint32_t previous_num;
+         memcpy(&previous_num, entry + trim_data::blknum_offset, sizeof(previous_num));
+         EOS_ASSERT(fc::endian_reverse_u32(previous_num) + 1 == block_num, reversible_blocks_exception,
+                    "Wrong block was read from block log.", ("returned", fc::endian_reverse_u32(previous_num) + 1)("expected", block_num));
+
+         if (my->version < detail::first_compressed_version) {
+            result.data = entry;
+            result.size = end - pos;
+            result.owner = mapping;
+            return result;
+         }
+
+         fc::datastream<const char*> ds(entry, end - pos);
+         block_header bh;
+         fc::raw::unpack(ds, bh);
+         const size_t header_size = ds.tellp();
+         const auto rest = detail::unpack_block_entry_rest(ds, block_num);
+         auto packed = std::make_shared<std::vector<char>>(header_size + rest.size());
+         memcpy(packed->data(), entry, header_size);
+         memcpy(packed->data() + header_size, rest.data(), rest.size());
+         result.data = packed->data();
+         result.size = packed->size();
+         result.owner = std::move(packed);
+         return result;
+      } FC_LOG_AND_RETHROW()
+   }
+
    block_id_type block_log::read_block_id_by_num(uint32_t block_num)const {
       try {
+         if (block_num < my->first_block_num) {
+            std::lock_guard<std::mutex> g( my->retained_mtx );
+            uint64_t pos = my->open_retained(block_num);
+            if (pos == npos)
+               return {};
+            block_header bh;
+            my->retained_block_file.seek(pos);
+            auto ds = my->retained_block_file.create_datastream();
+            fc::raw::unpack(ds, bh);
+            EOS_ASSERT(bh.block_num() == block_num, reversible_blocks_exception,
+                       "Wrong block header was read from retained block log.", ("returned", bh.block_num())("expected", block_num));
+            return bh.id();
+         }
+         if (auto b = my->find_pending(block_num))
+            return b->id();
          uint64_t pos = get_block_pos(block_num);
          if (pos != npos) {
             block_header bh;
@@ -437,6 +1048,8 @@ namespace eosio { namespace chain {
       my->check_open_files();
       if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num >= my->first_block_num))
          return npos;
+      if (!my->is_written(block_num))
+         return npos;
       my->index_file.seek(sizeof(uint64_t) * (block_num - my->first_block_num));
       uint64_t pos;
       my->index_file.read((char*)&pos, sizeof(pos));
@@ -474,6 +1087,13 @@ namespace eosio { namespace chain {
       return my->first_block_num;
    }
 
+   uint32_t block_log::first_retained_block_num() const {
+      std::lock_guard<std::mutex> g( my->retained_mtx );
+      if (!my->retained.empty())
+         return my->retained.begin()->second.first_block_num;
+      return my->first_block_num;
+   }
+
    void block_log::construct_index() {
       ilog("Reconstructing Block Log Index...");
       my->close();
@@ -485,12 +1105,31 @@ namespace eosio { namespace chain {
 
       my->close();
 
-      block_log::construct_index(my->block_file.get_file_path(), my->index_file.get_file_path());
+      block_log::construct_index(my->block_file.get_file_path(), my->index_file.get_file_path(), std::thread::hardware_concurrency());
 
       my->reopen();
    } // construct_index
 
-   void block_log::construct_index(const fc::path& block_file_name, const fc::path& index_file_name) {
+   void block_log::construct_index(const fc::path& block_file_name, const fc::path& index_file_name, uint32_t num_threads) {
+      if (num_threads > 1) {
+         uint32_t version = 0, first_block_num = 0, num_blocks = 0;
+         {
+            detail::reverse_iterator block_log_iter;
+            num_blocks = block_log_iter.open(block_file_name);
+            version = block_log_iter.version();
+            first_block_num = block_log_iter.first_block_num();
+         }
+         // version 1 logs without a totem and small logs are not worth splitting
+         if (num_blocks > 0 && version > 1 &&
+             fc::file_size(block_file_name) > 2 * detail::parallel_index_builder::_min_region_size) {
+            ilog("Will read existing blocks.log file ${file} with up to ${t} threads", ("file", block_file_name.generic_string())("t", num_threads));
+            detail::parallel_index_builder builder(block_file_name, index_file_name, version, first_block_num, first_block_num + num_blocks - 1);
+            if (builder.build(num_threads))
+               return;
+            wlog("Parallel reconstruction of ${file} failed, falling back to a sequential scan", ("file", index_file_name.generic_string()));
+         }
+      }
+
       detail::reverse_iterator block_log_iter;
 
       ilog("Will read existing blocks.log file ${file}", ("file", block_file_name.generic_string()));
@@ -515,6 +1154,141 @@ namespace eosio { namespace chain {
       index.complete();
    }
 
+   block_log_verification block_log::verify(const fc::path& block_dir, uint32_t num_threads) {
+      const auto block_file_name = block_dir / "blocks.log";
+      const auto index_file_name = block_dir / "blocks.index";
+      EOS_ASSERT( fc::is_regular_file(block_file_name), block_log_not_found,
+                  "Block log not found in '${blocks_dir}'", ("blocks_dir", block_dir) );
+      EOS_ASSERT( fc::is_regular_file(index_file_name), block_log_exception,
+                  "Block index not found in '${blocks_dir}', create it with --make-index", ("blocks_dir", block_dir) );
+
+      block_log_verification result;
+      if (fc::file_size(block_file_name) == 0)
+         return result;
+      const boost::iostreams::mapped_file_source blocks(block_file_name.generic_string());
+      const uint64_t index_size = fc::file_size(index_file_name);
+      EOS_ASSERT( index_size % sizeof(uint64_t) == 0, block_log_exception,
+                  "Block index '${index}' size ${s} is not a multiple of 8", ("index", index_file_name.generic_string())("s", index_size) );
+      const uint32_t num_blocks = index_size / sizeof(uint64_t);
+      if (num_blocks == 0)
+         return result;
+      const boost::iostreams::mapped_file_source index(index_file_name.generic_string());
+      const char* const data = blocks.data();
+      const uint64_t eof = blocks.size();
+
+      uint32_t version = 0;
+      EOS_ASSERT( eof >= sizeof(version), block_log_exception, "Block log '${file}' is truncated", ("file", block_file_name.generic_string()) );
+      memcpy(&version, data, sizeof(version));
+      EOS_ASSERT( is_supported_version(version), block_log_unsupported_version,
+                  "Unsupported version of block log. Block log version is ${version} while code supports version(s) [${min},${max}]",
+                  ("version", version)("min", block_log::min_supported_version)("max", block_log::max_supported_version) );
+      uint32_t first_block_num = 1;
+      if (version > 1) {
+         EOS_ASSERT( eof >= sizeof(version) + sizeof(first_block_num), block_log_exception,
+                     "Block log '${file}' is truncated", ("file", block_file_name.generic_string()) );
+         memcpy(&first_block_num, data + sizeof(version), sizeof(first_block_num));
+      }
+      result.first_block_num = first_block_num;
+      result.last_block_num = first_block_num + num_blocks - 1;
+
+      auto position = [&](uint32_t i) {
+         uint64_t pos;
+         memcpy(&pos, index.data() + i * sizeof(pos), sizeof(pos));
+         return pos;
+      };
+
+      struct range_result {
+         block_id_type            first_previous;  ///< previous of the first block of the range
+         block_id_type            last_id;
+         uint32_t                 verified = 0;
+         fc::optional<uint32_t>   corrupt;         ///< offset in the log of the first corrupt block of the range
+         std::string              error;
+      };
+
+      // the blocks [begin, end) of the log, each is followed by its position and the next block starts right after
+      auto verify_range = [&](uint32_t begin, uint32_t end, range_result& r) {
+         for (uint32_t i = begin; i < end; ++i) {
+            try {
+               const uint64_t pos = position(i);
+               const uint64_t next = i + 1 < num_blocks ? position(i + 1) : eof;
+               EOS_ASSERT( pos < next && next <= eof && next - pos >= sizeof(uint64_t), block_log_exception,
+                           "index position ${p} is past the next block at ${n}", ("p", pos)("n", next) );
+               uint64_t trailer;
+               memcpy(&trailer, data + next - sizeof(trailer), sizeof(trailer));
+               EOS_ASSERT( trailer == pos, block_log_exception,
+                           "block is followed by position ${t}, the index gives ${p}", ("t", trailer)("p", pos) );
+
+               signed_block b;
+               fc::datastream<const char*> ds(data + pos, next - pos - sizeof(trailer));
+               detail::unpack_block_entry(ds, b, version);
+               EOS_ASSERT( ds.remaining() == 0, block_log_exception, "${n} bytes follow the block", ("n", ds.remaining()) );
+               EOS_ASSERT( b.block_num() == first_block_num + i, block_log_exception,
+                           "block has block number ${n}", ("n", b.block_num()) );
+
+               vector<digest_type> trx_digests;
+               trx_digests.reserve( b.transactions.size() );
+               for( const auto& t : b.transactions )
+                  trx_digests.emplace_back( t.digest() );
+               EOS_ASSERT( merkle( move(trx_digests) ) == b.transaction_mroot, block_log_exception,
+                           "transactions do not match transaction_mroot ${m}", ("m", b.transaction_mroot) );
+
+               if (i == begin) {
+                  r.first_previous = b.previous;
+               } else {
+                  EOS_ASSERT( b.previous == r.last_id, block_log_exception,
+                              "previous ${p} is not the id of the block before it ${id}", ("p", b.previous)("id", r.last_id) );
+               }
+               r.last_id = b.id();
+               ++r.verified;
+            } catch (const fc::exception& e) {
+               r.corrupt = i;
+               r.error = e.top_message();
+               return;
+            } catch (const std::exception& e) {
+               r.corrupt = i;
+               r.error = e.what();
+               return;
+            }
+         }
+      };
+
+      num_threads = std::max<uint32_t>(1, std::min(num_threads, num_blocks));
+      const uint32_t range_size = (num_blocks + num_threads - 1) / num_threads;
+      const uint32_t num_ranges = (num_blocks + range_size - 1) / range_size;
+      ilog("Verifying ${n} blocks of '${file}' in ${r} ranges", ("n", num_blocks)("file", block_file_name.generic_string())("r", num_ranges));
+      std::vector<range_result> ranges(num_ranges);
+      std::vector<std::thread> threads;
+      threads.reserve(num_ranges);
+      for (uint32_t i = 0; i < num_ranges; ++i) {
+         threads.emplace_back([&, i]() {
+            verify_range(i * range_size, std::min<uint64_t>(num_blocks, (i + 1ULL) * range_size), ranges[i]);
+         });
+      }
+      for (auto& t : threads)
+         t.join();
+
+      // a log starting at genesis has nothing before block 1, otherwise the previous of its first block is unknown
+      for (uint32_t i = 0; i < num_ranges; ++i) {
+         const auto& r = ranges[i];
+         const uint32_t begin = i * range_size;
+         if (r.verified > 0 && (i > 0 || first_block_num == 1)) {
+            const block_id_type expected = i > 0 ? ranges[i - 1].last_id : block_id_type();
+            if (r.first_previous != expected) {
+               result.first_corrupt_block = first_block_num + begin;
+               result.error = "previous " + r.first_previous.str() + " is not the id of the block before it " + expected.str();
+               return result;
+            }
+         }
+         result.blocks_verified += r.verified;
+         if (r.corrupt) {
+            result.first_corrupt_block = first_block_num + *r.corrupt;
+            result.error = r.error;
+            return result;
+         }
+      }
+      return result;
+   }
+
    fc::path block_log::repair_log( const fc::path& data_dir, uint32_t truncate_at_block ) {
       ilog("Recovering Block Log...");
       EOS_ASSERT( fc::is_directory(data_dir) && fc::is_regular_file(data_dir / "blocks.log"), block_log_not_found,
@@ -621,7 +1395,7 @@ namespace eosio { namespace chain {
          signed_block tmp;
 
          try {
-            fc::raw::unpack(old_block_stream, tmp);
+            detail::unpack_block_entry(old_block_stream, tmp, version);
          } catch( ... ) {
             except_ptr = std::current_exception();
             incomplete_block_data.resize( end_pos - pos );
@@ -651,7 +1425,7 @@ namespace eosio { namespace chain {
             break;
          }
 
-         auto data = fc::raw::pack(tmp);
+         auto data = detail::pack_block_entry(tmp, version);
          new_block_stream.write( data.data(), data.size() );
          new_block_stream.write( reinterpret_cast<char*>(&pos), sizeof(pos) );
          block_num = tmp.block_num();
@@ -944,6 +1718,229 @@ namespace eosio { namespace chain {
       }
    }
 
+   detail::parallel_index_builder::parallel_index_builder(const fc::path& block_file_name, const fc::path& index_file_name,
+                                                          uint32_t version, uint32_t first_block_num, uint32_t last_block_num)
+   : _block_file_name(block_file_name.generic_string())
+   , _block_index_name(index_file_name.generic_string())
+   , _version(version)
+   , _first_block_num(first_block_num)
+   , _last_block_num(last_block_num) {
+      unique_file file(FC_FOPEN(_block_file_name.c_str(), "rb"), &fclose);
+      EOS_ASSERT( file, block_log_exception, "Could not open Block log file at '${blocks_log}'", ("blocks_log", _block_file_name) );
+
+      // skip the header, see block_log::repair_log for the layout
+      uint32_t v = 0;
+      auto size = fread((void*)&v, sizeof(v), 1, file.get());
+      EOS_ASSERT( size == 1 && v == _version, block_log_exception, "Block log file at '${blocks_log}' changed", ("blocks_log", _block_file_name) );
+      fileptr_datastream ds(file.get(), _block_file_name);
+      if (_version != 1) {
+         uint32_t first = 0;
+         ds.read((char*)&first, sizeof(first));
+      }
+      if (block_log::contains_genesis_state(_version, _first_block_num)) {
+         genesis_state gs;
+         fc::raw::unpack(ds, gs);
+      } else {
+         chain_id_type chain_id;
+         ds >> chain_id;
+      }
+      if (_version != 1) {
+         uint64_t totem = 0;
+         ds.read((char*)&totem, sizeof(totem));
+         EOS_ASSERT( totem == block_log::npos, block_log_exception,
+                     "Expected separator between block log header and blocks was not found in '${blocks_log}'", ("blocks_log", _block_file_name) );
+      }
+      _first_block_pos = ftell(file.get());
+
+      auto status = fseek(file.get(), 0, SEEK_END);
+      EOS_ASSERT( status == 0, block_log_exception, "Could not seek in '${blocks_log}'", ("blocks_log", _block_file_name) );
+      _eof = ftell(file.get());
+   }
+
+   detail::parallel_index_builder::reader::reader(const std::string& block_file_name, uint64_t eof)
+   : _file(FC_FOPEN(block_file_name.c_str(), "rb"), &fclose)
+   , _block_file_name(block_file_name)
+   , _eof(eof)
+   , _buffer_ptr(std::make_unique<char[]>(reverse_iterator::_buf_len)) {
+      EOS_ASSERT( _file, block_log_exception, "Could not open Block log file at '${blocks_log}'", ("blocks_log", _block_file_name) );
+   }
+
+   const char* detail::parallel_index_builder::reader::at(uint64_t pos, size_t size, bool backward) {
+      EOS_ASSERT( pos + size <= _eof, block_log_exception, "Read past the end of '${blocks_log}'", ("blocks_log", _block_file_name) );
+      if (pos < _start || pos + size > _end) {
+         // keep the window ahead of the walking direction
+         if (backward) {
+            _end = pos + size;
+            _start = _end > reverse_iterator::_buf_len ? _end - reverse_iterator::_buf_len : 0;
+         } else {
+            // candidates are checked against the entries before them as well
+            constexpr uint64_t behind = reverse_iterator::_buf_len / 4;
+            _start = pos > behind ? pos - behind : 0;
+            _end = std::min<uint64_t>(_eof, _start + reverse_iterator::_buf_len);
+         }
+         auto status = fseek(_file.get(), _start, SEEK_SET);
+         EOS_ASSERT( status == 0, block_log_exception, "Could not seek in '${blocks_log}' to position: ${pos}", ("blocks_log", _block_file_name)("pos", _start) );
+         auto read = fread((void*)_buffer_ptr.get(), _end - _start, 1, _file.get());
+         EOS_ASSERT( read == 1, block_log_exception, "blocks.log read fails" );
+      }
+      return _buffer_ptr.get() + (pos - _start);
+   }
+
+   uint64_t detail::parallel_index_builder::reader::read_pos(uint64_t pos, bool backward) {
+      uint64_t result;
+      memcpy(&result, at(pos, sizeof(result), backward), sizeof(result));
+      return result;
+   }
+
+   uint32_t detail::parallel_index_builder::reader::read_block_num(uint64_t block_pos, bool backward) {
+      uint32_t previous_num;
+      memcpy(&previous_num, at(block_pos + trim_data::blknum_offset, sizeof(previous_num), backward), sizeof(previous_num));
+      return fc::endian_reverse_u32(previous_num) + 1; // big endian number of the previous block
+   }
+
+   bool detail::parallel_index_builder::is_trailer(reader& r, uint64_t pos) {
+      constexpr uint64_t min_entry = trim_data::blknum_offset + sizeof(uint32_t);
+      const uint64_t block_pos = r.read_pos(pos, false);
+      if (block_pos < _first_block_pos || block_pos + min_entry > pos)
+         return false;
+      const uint32_t num = r.read_block_num(block_pos, false);
+      if (num < _first_block_num || num > _last_block_num)
+         return false;
+      // the entry before has to be the previous block and end right where this one starts
+      if (block_pos == _first_block_pos) {
+         if (num != _first_block_num)
+            return false;
+      } else {
+         if (num == _first_block_num || block_pos < _first_block_pos + sizeof(uint64_t))
+            return false;
+         const uint64_t prev_pos = r.read_pos(block_pos - sizeof(uint64_t), false);
+         if (prev_pos < _first_block_pos || prev_pos + min_entry > block_pos - sizeof(uint64_t) ||
+             r.read_block_num(prev_pos, false) != num - 1)
+            return false;
+      }
+      // and the entry after has to be the next block
+      const uint64_t next_pos = pos + sizeof(uint64_t);
+      if (next_pos == _eof)
+         return num == _last_block_num;
+      return next_pos + min_entry <= _eof && r.read_block_num(next_pos, false) == num + 1;
+   }
+
+   detail::parallel_index_builder::region_result
+   detail::parallel_index_builder::build_region(uint64_t region_start, uint64_t region_end) {
+      reader r(_block_file_name, _eof);
+
+      uint64_t trailer = _eof - sizeof(uint64_t);
+      for (uint64_t pos = region_end; pos + sizeof(uint64_t) < _eof; ++pos) {
+         if (is_trailer(r, pos)) {
+            trailer = pos;
+            break;
+         }
+      }
+
+      unique_file index(FC_FOPEN(_block_index_name.c_str(), "rb+"), &fclose);
+      EOS_ASSERT( index, block_log_exception, "Could not open Block index file at '${blocks_index}'", ("blocks_index", _block_index_name) );
+      std::vector<uint64_t> positions; // in descending block order
+      positions.reserve(index_writer::_buffer_bytes / sizeof(uint64_t));
+      region_result result;
+      auto write_positions = [&]() {
+         if (positions.empty())
+            return;
+         std::reverse(positions.begin(), positions.end());
+         const uint64_t offset = sizeof(uint64_t) * (result.lowest_block - _first_block_num);
+         auto status = fseek(index.get(), offset, SEEK_SET);
+         EOS_ASSERT( status == 0, block_log_exception, "Could not seek in '${blocks_index}' to position: ${pos}", ("blocks_index", _block_index_name)("pos", offset) );
+         auto written = fwrite((void*)positions.data(), positions.size() * sizeof(uint64_t), 1, index.get());
+         EOS_ASSERT( written == 1, block_log_exception, "Writing Block Index file '${file}' failed at location: ${loc}", ("file", _block_index_name)("loc", offset) );
+         positions.clear();
+      };
+
+      uint32_t expected_num = 0;
+      while (true) {
+         const uint64_t block_pos = r.read_pos(trailer, true);
+         if (block_pos < region_start)
+            break;
+         EOS_ASSERT( block_pos >= _first_block_pos && block_pos < trailer, block_log_exception,
+                     "Block log file at '${blocks_log}' formatting is incorrect, indicates position ${pos} at ${trailer}",
+                     ("blocks_log", _block_file_name)("pos", block_pos)("trailer", trailer) );
+         const uint32_t num = r.read_block_num(block_pos, true);
+         EOS_ASSERT( expected_num == 0 || num == expected_num, block_log_exception,
+                     "Block log file at '${blocks_log}' has block ${num} where block ${expected} was expected",
+                     ("blocks_log", _block_file_name)("num", num)("expected", expected_num) );
+         if (block_pos < region_end) {
+            if (result.blocks == 0)
+               result.highest_block = num;
+            result.lowest_block = num;
+            ++result.blocks;
+            positions.push_back(block_pos);
+            if (positions.size() == positions.capacity())
+               write_positions();
+         }
+         if (block_pos == _first_block_pos)
+            break;
+         expected_num = num - 1;
+         trailer = block_pos - sizeof(uint64_t);
+      }
+      write_positions();
+      return result;
+   }
+
+   bool detail::parallel_index_builder::build(uint32_t num_threads) {
+      const uint64_t blocks_size = _eof - _first_block_pos;
+      const uint64_t region_size = std::max<uint64_t>(_min_region_size, blocks_size / num_threads + 1);
+      const uint32_t num_regions = (blocks_size + region_size - 1) / region_size;
+      const uint32_t num_blocks = _last_block_num - _first_block_num + 1;
+      ilog("Reconstructing ${n} block positions from ${r} regions of ${s} bytes", ("n", num_blocks)("r", num_regions)("s", region_size));
+
+      {
+         // allocate 8 bytes for each block position to store
+         unique_file index(FC_FOPEN(_block_index_name.c_str(), "w"), &fclose);
+         EOS_ASSERT( index, block_log_exception, "Could not open Block index file at '${blocks_index}'", ("blocks_index", _block_index_name) );
+      }
+      boost::filesystem::resize_file(_block_index_name, sizeof(uint64_t) * num_blocks);
+
+      std::vector<region_result> results(num_regions);
+      std::vector<std::exception_ptr> errors(num_regions);
+      std::vector<std::thread> threads;
+      threads.reserve(num_regions);
+      for (uint32_t i = 0; i < num_regions; ++i) {
+         threads.emplace_back([&, i]() {
+            try {
+               const uint64_t start = _first_block_pos + i * region_size;
+               const uint64_t end = std::min(_eof, start + region_size);
+               results[i] = build_region(start, end);
+            } catch (...) {
+               errors[i] = std::current_exception();
+            }
+         });
+      }
+      for (auto& t : threads)
+         t.join();
+
+      uint32_t next = _first_block_num;
+      for (uint32_t i = 0; i < num_regions; ++i) {
+         if (errors[i]) {
+            try {
+               std::rethrow_exception(errors[i]);
+            } FC_LOG_AND_DROP()
+            return false;
+         }
+         if (results[i].blocks == 0)
+            continue;
+         if (results[i].lowest_block != next ||
+             results[i].highest_block - results[i].lowest_block + 1 != results[i].blocks) {
+            wlog("Region ${i} of '${blocks_log}' holds blocks ${l} to ${h}, expected it to start at ${n}",
+                 ("i", i)("blocks_log", _block_file_name)("l", results[i].lowest_block)("h", results[i].highest_block)("n", next));
+            return false;
+         }
+         next = results[i].highest_block + 1;
+      }
+      if (next != _last_block_num + 1) {
+         wlog("Regions of '${blocks_log}' end at block ${n}, expected ${l}", ("blocks_log", _block_file_name)("n", next - 1)("l", _last_block_num));
+         return false;
+      }
+      return true;
+   }
+
    bool block_log::contains_genesis_state(uint32_t version, uint32_t first_block_num) {
       return version <= 2 || first_block_num == 1;
    }
@@ -985,9 +1982,10 @@ namespace eosio { namespace chain {
       new_block_file.close();
       new_block_file.open( LOG_RW_C );
 
-      static_assert( block_log::max_supported_version == 3,
-                     "Code was written to support version 3 format, need to update this code for latest format." );
-      uint32_t version = block_log::max_supported_version;
+      static_assert( block_log::max_supported_version == 4,
+                     "Code was written to support version 4 format, need to update this code for latest format." );
+      // blocks are copied as is, so keep their format; versions before 3 store blocks like version 3 does
+      uint32_t version = std::max(original_block_log.version, 3u);
       new_block_file.seek(0);
       new_block_file.write((char*)&version, sizeof(version));
       new_block_file.write((char*)&truncate_at_block, sizeof(truncate_at_block));
@@ -1065,6 +2063,151 @@ namespace eosio { namespace chain {
       return true;
    }
 
+   namespace detail {
+      /// copy size bytes at in_pos of in to out_pos of out, leaves the file positions undefined
+      void copy_file_range(FILE* in, uint64_t in_pos, FILE* out, uint64_t out_pos, uint64_t size) {
+         EOS_ASSERT( fflush(out) == 0, block_log_exception, "flush of output block log failed" );
+#if defined(__linux__) && defined(SYS_copy_file_range)
+         // copied within the kernel, or by the file system without reading the data at all
+         loff_t in_off = in_pos, out_off = out_pos;
+         while (size > 0) {
+            const auto copied = syscall(SYS_copy_file_range, fileno(in), &in_off, fileno(out), &out_off,
+                                        std::min<uint64_t>(size, 1ULL << 30), 0u);
+            if (copied <= 0) {
+               EOS_ASSERT( copied < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP),
+                           block_log_exception, "copy_file_range failed: ${e}", ("e", copied == 0 ? "unexpected end of file" : strerror(errno)) );
+               break; // not supported between these files, copy the rest through a buffer
+            }
+            size -= copied;
+         }
+         in_pos = in_off;
+         out_pos = out_off;
+#endif
+         auto buffer = std::make_unique<char[]>(reverse_iterator::_buf_len);
+         EOS_ASSERT( fseek(in, in_pos, SEEK_SET) == 0 && fseek(out, out_pos, SEEK_SET) == 0, block_log_exception,
+                     "block log seek failed" );
+         while (size > 0) {
+            const size_t n = std::min<uint64_t>(size, reverse_iterator::_buf_len);
+            EOS_ASSERT( fread(buffer.get(), n, 1, in) == 1, block_log_exception, "blocks.log read failed" );
+            EOS_ASSERT( fwrite(buffer.get(), n, 1, out) == 1, block_log_exception, "blocks.log write failed" );
+            size -= n;
+         }
+      }
+   }
+
+   void block_log::extract_blocklog(const fc::path& block_dir, const fc::path& output_dir,
+                                    uint32_t first_block_num, uint32_t last_block_num) {
+      EOS_ASSERT( block_dir != output_dir, block_log_exception, "block_dir and output_dir need to be different directories" );
+      trim_data original_block_log(block_dir);
+      const uint32_t first = std::max(first_block_num, original_block_log.first_block);
+      const uint32_t last = std::min(last_block_num, original_block_log.last_block);
+      EOS_ASSERT( first <= last, block_log_exception, "Blocks ${f} to ${l} are not in ${file}, which holds blocks ${first} to ${last}",
+                  ("f", first_block_num)("l", last_block_num)("file", original_block_log.block_file_name.generic_string())
+                  ("first", original_block_log.first_block)("last", original_block_log.last_block) );
+      ilog("Extracting blocks ${f} to ${l} of ${file} to ${dir}",
+           ("f", first)("l", last)("file", original_block_log.block_file_name.generic_string())("dir", output_dir.generic_string()));
+
+      const uint64_t original_start = original_block_log.block_pos(first);
+      const uint64_t original_end = last < original_block_log.last_block ? original_block_log.block_pos(last + 1)
+                                                                         : fc::file_size(original_block_log.block_file_name);
+
+      fc::create_directories(output_dir);
+      const auto new_block_filename = output_dir / "blocks.log";
+      const auto new_index_filename = output_dir / "blocks.index";
+      detail::unique_file new_block_file(FC_FOPEN(new_block_filename.generic_string().c_str(), "wb+"), &fclose);
+      EOS_ASSERT( new_block_file, block_log_exception, "Could not open Block log file at '${file}'", ("file", new_block_filename.generic_string()) );
+      detail::unique_file new_index_file(FC_FOPEN(new_index_filename.generic_string().c_str(), "wb"), &fclose);
+      EOS_ASSERT( new_index_file, block_log_exception, "Could not open Block index file at '${file}'", ("file", new_index_filename.generic_string()) );
+
+      static_assert( block_log::max_supported_version == 4,
+                     "Code was written to support version 4 format, need to update this code for latest format." );
+      // blocks are copied as is, so keep their format; versions before 3 store blocks like version 3 does
+      const uint32_t version = std::max(original_block_log.version, 3u);
+      std::vector<char> header = fc::raw::pack(version);
+      const auto packed_first = fc::raw::pack(first);
+      const auto packed_chain_id = fc::raw::pack(original_block_log.chain_id);
+      const auto totem = fc::raw::pack(block_log::npos);
+      header.insert(header.end(), packed_first.begin(), packed_first.end());
+      header.insert(header.end(), packed_chain_id.begin(), packed_chain_id.end());
+      header.insert(header.end(), totem.begin(), totem.end());
+      EOS_ASSERT( fwrite(header.data(), header.size(), 1, new_block_file.get()) == 1, block_log_exception,
+                  "blocks.log write failed" );
+
+      const uint64_t pos_delta = original_start - header.size();
+      detail::copy_file_range(original_block_log.blk_in, original_start, new_block_file.get(), header.size(),
+                              original_end - original_start);
+
+      // the position following each block is the position of the block itself, which moved by pos_delta
+      constexpr uint32_t positions_per_read = 1U << 16;
+      std::vector<uint64_t> positions(positions_per_read);
+      const uint64_t new_end = original_end - pos_delta;
+      EOS_ASSERT( fseek(original_block_log.ind_in, original_block_log.block_index(first), SEEK_SET) == 0, block_log_exception,
+                  "blocks.index seek failed" );
+      optional<uint64_t> previous_pos;
+      for (uint64_t remaining = last - first + 1; remaining > 0; ) {
+         const uint32_t n = std::min<uint64_t>(remaining, positions_per_read);
+         EOS_ASSERT( fread(positions.data(), sizeof(uint64_t), n, original_block_log.ind_in) == n, block_log_exception,
+                     "blocks.index read failed" );
+         for (uint32_t i = 0; i < n; ++i) {
+            positions[i] -= pos_delta;
+            if (previous_pos) {
+               EOS_ASSERT( fseek(new_block_file.get(), positions[i] - sizeof(uint64_t), SEEK_SET) == 0 &&
+                           fwrite(&*previous_pos, sizeof(uint64_t), 1, new_block_file.get()) == 1,
+                           block_log_exception, "blocks.log write failed" );
+            }
+            previous_pos = positions[i];
+         }
+         EOS_ASSERT( fwrite(positions.data(), sizeof(uint64_t), n, new_index_file.get()) == n, block_log_exception,
+                     "blocks.index write failed" );
+         remaining -= n;
+      }
+      EOS_ASSERT( fseek(new_block_file.get(), new_end - sizeof(uint64_t), SEEK_SET) == 0 &&
+                  fwrite(&*previous_pos, sizeof(uint64_t), 1, new_block_file.get()) == 1,
+                  block_log_exception, "blocks.log write failed" );
+      EOS_ASSERT( fflush(new_block_file.get()) == 0 && fflush(new_index_file.get()) == 0, block_log_exception,
+                  "flush of extracted block log failed" );
+      ilog("Extracted ${n} blocks", ("n", last - first + 1));
+   }
+
+   void block_log::convert_version(const fc::path& block_dir, const fc::path& output_dir, uint32_t new_version) {
+      EOS_ASSERT( new_version >= 3 && is_supported_version(new_version), block_log_unsupported_version,
+                  "Cannot convert block log to version ${v}, supported target versions are [3,${max}]",
+                  ("v", new_version)("max", max_supported_version) );
+      EOS_ASSERT( block_dir != output_dir, block_log_exception,
+                  "block_dir and output_dir need to be different directories" );
+
+      block_log original(block_dir);
+      EOS_ASSERT( original.head(), block_log_exception, "No blocks found in block log ${dir}", ("dir", block_dir.generic_string()) );
+      const uint32_t first = original.first_block_num();
+      const uint32_t last = original.head()->block_num();
+      ilog("Converting blocks ${first} through ${last} of ${dir} from version ${from} to version ${to}",
+           ("first", first)("last", last)("dir", block_dir.generic_string())("from", original.my->version)("to", new_version));
+
+      if (!fc::is_directory(output_dir))
+         fc::create_directories(output_dir);
+
+      detail::block_log_impl converted;
+      converted.block_file.set_file_path( output_dir / "blocks.log" );
+      converted.index_file.set_file_path( output_dir / "blocks.index" );
+
+      // version 3 and later only store the genesis state when starting from block 1
+      if (first == 1) {
+         auto gs = extract_genesis_state(block_dir);
+         EOS_ASSERT( gs, block_log_exception, "Block log ${dir} is missing its genesis state", ("dir", block_dir.generic_string()) );
+         converted.reset(*gs, original.read_block_by_num(first), first, new_version);
+      } else {
+         converted.reset(extract_chain_id(block_dir), signed_block_ptr(), first, new_version);
+         converted.append(original.read_block_by_num(first));
+      }
+
+      for (uint32_t block_num = first + 1; block_num <= last; ++block_num) {
+         converted.append(original.read_block_by_num(block_num));
+         if (block_num % 100000 == 0)
+            ilog("Converted block ${num}", ("num", block_num));
+      }
+      converted.close();
+   }
+
    trim_data::trim_data(fc::path block_dir) {
 
       // code should follow logic in block_log::repair_log
@@ -0,0 +1,29 @@
+#include <eosio/chain/block_signee_cache.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+namespace eosio { namespace chain {
+
+   block_signee_cache& block_signee_cache::instance() {
+      static block_signee_cache cache;
+      return cache;
+   }
+
+   std::set<public_key_type> block_signee_cache::recover( const block_id_type& id, const digest_type& digest,
+                                                          const signature_type& producer_signature,
+                                                          const vector<signature_type>& additional_signatures ) {
+      auto cached = cache.find( { id }, [&]( const entry& e ) {
+         return e.digest == digest && e.producer_signature == producer_signature && e.additional_signatures == additional_signatures;
+      } );
+      if( cached ) return std::move( cached->keys );
+
+      std::set<public_key_type> keys;
+      keys.emplace( producer_signature, digest, true );
+      for( const auto& s : additional_signatures ) {
+         auto res = keys.emplace( s, digest, true );
+         EOS_ASSERT( res.second, wrong_signing_key, "block signed by same key twice", ("key", *res.first) );
+      }
+      cache.put( id, entry{ digest, producer_signature, additional_signatures, keys } );
+      return keys;
+   }
+
+} } // eosio::chain
@@ -0,0 +1,89 @@
+#include <eosio/chain/contract_usage_profiler.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <algorithm>
+
+namespace eosio { namespace chain {
+
+void contract_usage_profiler::configure( const fc::microseconds& window, uint32_t windows ) {
+   EOS_ASSERT( windows == 0 || window.count() > 0, misc_exception, "contract usage window must be positive" );
+   _window_size = window;
+   _windows.clear();
+   _windows.resize( windows );
+}
+
+void contract_usage_profiler::add_transaction( std::vector<action_usage>& actions, int64_t billed_cpu_us, const fc::time_point& now ) {
+   if( !enabled() || actions.empty() ) return;
+
+   int64_t wall_us = 0;
+   for( const auto& a : actions ) wall_us += a.totals.wall_us;
+
+   const int64_t index = window_index( now );
+   auto& w = _windows[index % _windows.size()];
+   if( w.index != index ) {
+      w.index = index;
+      w.actions.clear();
+   }
+
+   int64_t billed_left = billed_cpu_us;
+   for( size_t i = 0; i < actions.size(); ++i ) {
+      auto& a = actions[i];
+      // the last action gets what is left for the shares to add up to what was billed
+      if( i + 1 == actions.size() ) {
+         a.totals.billed_cpu_us = billed_left;
+      } else if( wall_us > 0 ) {
+         a.totals.billed_cpu_us = static_cast<int64_t>( static_cast<__int128>(billed_cpu_us) * a.totals.wall_us / wall_us );
+      } else {
+         a.totals.billed_cpu_us = billed_cpu_us / static_cast<int64_t>(actions.size());
+      }
+      billed_left -= a.totals.billed_cpu_us;
+      w.actions[std::make_pair( a.receiver.to_uint64_t(), a.action.to_uint64_t() )].add( a.totals );
+   }
+}
+
+std::vector<contract_usage_profiler::action_usage>
+contract_usage_profiler::top( size_t limit, uint32_t windows, metric m, const fc::time_point& now )const {
+   std::vector<action_usage> result;
+   if( !enabled() ) return result;
+
+   const int64_t last = window_index( now );
+   const int64_t count = windows == 0 ? _windows.size() : std::min<int64_t>( windows, _windows.size() );
+
+   std::unordered_map<std::pair<uint64_t, uint64_t>, usage, key_hash> totals;
+   for( const auto& w : _windows ) {
+      if( w.index < 0 || w.index > last || w.index <= last - count ) continue;
+      for( const auto& a : w.actions ) {
+         totals[a.first].add( a.second );
+      }
+   }
+
+   result.reserve( totals.size() );
+   for( const auto& t : totals ) {
+      result.push_back( action_usage{ name( t.first.first ), name( t.first.second ), t.second } );
+   }
+
+   auto value = [m]( const action_usage& a ) -> int64_t {
+      switch( m ) {
+         case metric::wall:          return a.totals.wall_us;
+         case metric::billed_cpu:    return a.totals.billed_cpu_us;
+         case metric::db_intrinsics: return static_cast<int64_t>( a.totals.db_intrinsics );
+         case metric::ram_delta:     return a.totals.ram_delta;
+         case metric::calls:         return static_cast<int64_t>( a.totals.calls );
+      }
+      return 0;
+   };
+   const size_t n = std::min( limit, result.size() );
+   std::partial_sort( result.begin(), result.begin() + n, result.end(), [&value]( const action_usage& lhs, const action_usage& rhs ) {
+      return value( lhs ) > value( rhs );
+   });
+   result.resize( n );
+   return result;
+}
+
+fc::time_point contract_usage_profiler::window_start( uint32_t windows, const fc::time_point& now )const {
+   if( !enabled() ) return now;
+   const int64_t count = windows == 0 ? _windows.size() : std::min<int64_t>( windows, _windows.size() );
+   return fc::time_point( fc::microseconds( (window_index( now ) - count + 1) * _window_size.count() ) );
+}
+
+} } /// namespace eosio::chain
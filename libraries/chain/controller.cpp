@@ -14,7 +14,7 @@
 #include <eosio/chain/contract_table_objects.hpp>
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/transaction_object.hpp>
-#include <eosio/chain/reversible_block_object.hpp>
+#include <eosio/chain/reversible_block_log.hpp>
 #include <eosio/chain/genesis_intrinsics.hpp>
 #include <eosio/chain/whitelisted_intrinsics.hpp>
 #include <eosio/chain/database_header_object.hpp>
@@ -23,8 +23,12 @@
 #include <eosio/chain/authorization_manager.hpp>
 #include <eosio/chain/resource_limits.hpp>
 #include <eosio/chain/chain_snapshot.hpp>
+#include <eosio/chain/snapshot_delta.hpp>
 #include <eosio/chain/thread_utils.hpp>
 #include <eosio/chain/platform_timer.hpp>
+#include <eosio/chain/span_trace.hpp>
+#include <eosio/chain/metrics.hpp>
+#include <eosio/chain/state_sequence.hpp>
 
 #include <chainbase/chainbase.hpp>
 #include <fc/io/json.hpp>
@@ -33,6 +37,12 @@
 #include <fc/variant_object.hpp>
 
 #include <new>
+#include <mutex>
+#include <deque>
+#include <limits>
+#include <map>
+#include <thread>
+#include <condition_variable>
 
 namespace eosio { namespace chain {
 
@@ -50,6 +60,7 @@ using controller_index_set = index_set<
    generated_transaction_multi_index,
    table_id_multi_index,
    code_index,
+   kv_index,
    database_header_multi_index
 >;
 
@@ -62,6 +73,13 @@ using contract_database_index_set = index_set<
    index_long_double_index
 >;
 
+static metric_counter transactions_applied_metric( "nodeos_chain_transactions_applied_total",
+                                                   "Transactions applied to a pending or a validated block" );
+static metric_counter transactions_failed_metric( "nodeos_chain_transactions_failed_total",
+                                                  "Transactions that failed to apply" );
+static metric_histogram block_apply_metric( "nodeos_chain_block_apply_us", "Microseconds taken to apply a validated block",
+                                            { 1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000 } );
+
 class maybe_session {
    public:
       maybe_session() = default;
@@ -124,6 +142,8 @@ struct building_block {
    vector<transaction_receipt>           _pending_trx_receipts;
    vector<action_receipt>                _actions;
    optional<checksum256_type>            _transaction_mroot;
+   incremental_merkle                    _trx_merkle;    ///< of the first _trx_merkle._node_count receipts
+   incremental_merkle                    _action_merkle; ///< of the first _action_merkle._node_count actions
 };
 
 struct assembled_block {
@@ -215,6 +235,69 @@ struct pending_state {
    }
 };
 
+/**
+ * Bloom filter over the entries of a whitelist or blacklist of controller::config, rebuilt with its list. A value it
+ * does not contain is certainly not on the list, so the common check of a value that is not on a long blacklist does
+ * not search the list at all; the list itself is only searched for the few values the filter may contain.
+ */
+class list_prefilter {
+public:
+   template<typename Container, typename ToValue>
+   void reset( const Container& entries, ToValue&& to_value ) {
+      bits.clear();
+      mask = 0;
+      if( entries.empty() ) return;
+
+      // about 16 bits an entry: under 0.5% false positives with 3 probes
+      uint64_t size = 64;
+      while( size < entries.size() * 16 ) size *= 2;
+      bits.assign( size / 64, 0 );
+      mask = size - 1;
+      for( const auto& e : entries ) {
+         const uint64_t h = mix( to_value( e ) );
+         for( uint64_t i = 0; i < probes; ++i ) {
+            const uint64_t bit = probe( h, i );
+            bits[bit / 64] |= uint64_t(1) << (bit % 64);
+         }
+      }
+   }
+
+   /// false if value is not on the list, true if it may be
+   bool may_contain( uint64_t value )const {
+      if( bits.empty() ) return false;
+      const uint64_t h = mix( value );
+      for( uint64_t i = 0; i < probes; ++i ) {
+         const uint64_t bit = probe( h, i );
+         if( !(bits[bit / 64] & (uint64_t(1) << (bit % 64))) ) return false;
+      }
+      return true;
+   }
+
+   static uint64_t action_value( account_name code, action_name action ) {
+      return code.to_uint64_t() ^ mix( action.to_uint64_t() );
+   }
+
+private:
+   static constexpr uint64_t probes = 3;
+
+   static uint64_t mix( uint64_t v ) {
+      v ^= v >> 33;
+      v *= 0xff51afd7ed558ccdULL;
+      v ^= v >> 33;
+      v *= 0xc4ceb9fe1a85ec53ULL;
+      v ^= v >> 33;
+      return v;
+   }
+
+   /// double hashing, the upper half of h strides from the lower half
+   uint64_t probe( uint64_t h, uint64_t i )const {
+      return ( (h & 0xffffffff) + i * ((h >> 32) | 1) ) & mask;
+   }
+
+   std::vector<uint64_t> bits;
+   uint64_t              mask = 0;
+};
+
 struct controller_impl {
 
    // LLVM sets the new handler, we need to reset this to throw a bad_alloc exception so we can possibly exit cleanly
@@ -226,8 +309,11 @@ struct controller_impl {
    reset_new_handler              rnh; // placed here to allow for this to be set before constructing the other fields
    controller&                    self;
    chainbase::database            db;
-   chainbase::database            reversible_blocks; ///< a special database to persist blocks that have successfully been applied but are still reversible
+   state_memory                   db_memory;
+   std::unique_ptr<state_sequence_writer> state_seq; ///< with conf.publish_state_sequence
+   reversible_block_log           reversible_blocks; ///< persists blocks that have successfully been applied but are still reversible
    block_log                      blog;
+   mutable std::mutex             blog_read_mtx; ///< block_log reads are not thread safe, replay reads ahead on a thread of its own
    optional<pending_state>        pending;
    block_state_ptr                head;
    fork_database                  fork_db;
@@ -243,8 +329,35 @@ struct controller_impl {
    optional<fc::microseconds>     subjective_cpu_leeway;
    bool                           trusted_producer_light_validation = false;
    uint32_t                       snapshot_head_block = 0;
-   named_thread_pool              thread_pool;
+   uint32_t                       trace_consumers = 0; ///< plugins registered with add_trace_consumer
+   list_prefilter                 actor_whitelist_filter;    ///< of conf.actor_whitelist, rebuilt by reset_list_filters
+   list_prefilter                 actor_blacklist_filter;
+   list_prefilter                 contract_whitelist_filter;
+   list_prefilter                 contract_blacklist_filter;
+   list_prefilter                 action_blacklist_filter;
+   mutable work_stealing_pool     thread_pool; ///< mutable so const snapshot writing can queue work
    platform_timer                 timer;
+   contract_usage_profiler        usage_profiler;
+
+   /// signature recovery started ahead of apply for the conf.block_validation_pipeline_depth blocks after
+   /// prerecover_floor, by block id; one batch entry per packed_transaction receipt, in block order. Accessed from net
+   /// threads, the replay reader and the main thread, guarded by prerecovered_blocks_mtx
+   std::mutex                                  prerecovered_blocks_mtx;
+   std::map<block_id_type, recover_keys_batch> prerecovered_blocks;
+   uint32_t                                    prerecover_floor = 0; ///< highest block number applied or added to the fork database
+
+   /// in irreversible mode, signature recovery started when a block is added to the fork database, so it is done by the
+   /// time the block becomes irreversible and is applied; by block id, main thread only
+   std::map<block_id_type, recover_keys_batch> irreversible_recovering;
+
+   /// authorizations of the packed transactions of the block being applied, checked against the state the block started
+   /// with; they hold for as long as no permission, permission link or authority limit has changed since
+   struct prechecked_authorizations {
+      std::vector<char>  satisfied;               ///< one per packed_transaction receipt, in block order
+      uint64_t           revision = 0;            ///< authorization_manager::revision() they were checked at
+      uint16_t           max_authority_depth = 0;
+      uint32_t           max_transaction_delay = 0;
+   };
 #if defined(EOSIO_EOS_VM_RUNTIME_ENABLED) || defined(EOSIO_EOS_VM_JIT_RUNTIME_ENABLED)
    vm::wasm_allocator                 wasm_alloc;
 #endif
@@ -261,10 +374,7 @@ struct controller_impl {
          prev = fork_db.root();
       }
 
-      if( const auto* b = reversible_blocks.find<reversible_block_object,by_num>(head->block_num) )
-      {
-         reversible_blocks.remove( *b );
-      }
+      reversible_blocks.remove_from( head->block_num );
 
       if ( read_mode == db_read_mode::SPECULATIVE ) {
          EOS_ASSERT( head->block, block_validate_exception, "attempting to pop a block that was sparsely loaded from a snapshot");
@@ -272,7 +382,9 @@ struct controller_impl {
 
       head = prev;
 
+      state_writing();
       db.undo();
+      state_settled();
 
       protocol_features.popped_blocks_to( prev->block_num );
    }
@@ -302,10 +414,9 @@ struct controller_impl {
     db( cfg.state_dir,
         cfg.read_only ? database::read_only : database::read_write,
         cfg.state_size, false, cfg.db_map_mode, cfg.db_hugepage_paths ),
-    reversible_blocks( cfg.blocks_dir/config::reversible_blocks_dir_name,
-        cfg.read_only ? database::read_only : database::read_write,
-        cfg.reversible_cache_size, false, cfg.db_map_mode, cfg.db_hugepage_paths ),
-    blog( cfg.blocks_dir ),
+    db_memory( db, cfg.db_map_mode, cfg.db_memory_options ),
+    reversible_blocks( cfg.blocks_dir/config::reversible_blocks_dir_name, cfg.read_only ),
+    blog( cfg.blocks_dir, cfg.blocks_log_config ),
     fork_db( cfg.state_dir ),
     wasmif( cfg.wasm_runtime, cfg.eosvmoc_tierup, db, cfg.state_dir, cfg.eosvmoc_config ),
     resource_limits( db ),
@@ -314,8 +425,10 @@ struct controller_impl {
     conf( cfg ),
     chain_id( chain_id ),
     read_mode( cfg.read_mode ),
-    thread_pool( "chain", cfg.thread_pool_size )
+    thread_pool( "chain", cfg.thread_pool_size, cfg.thread_pool_cpus )
    {
+      reset_list_filters();
+
       fork_db.open( [this]( block_timestamp_type timestamp,
                             const flat_set<digest_type>& cur_features,
                             const vector<digest_type>& new_features )
@@ -327,7 +440,17 @@ struct controller_impl {
       set_activation_handler<builtin_protocol_feature_t::get_sender>();
       set_activation_handler<builtin_protocol_feature_t::webauthn_key>();
       set_activation_handler<builtin_protocol_feature_t::wtmsig_block_signatures>();
+      set_activation_handler<builtin_protocol_feature_t::batched_db_reads>();
+      set_activation_handler<builtin_protocol_feature_t::kv_database>();
+      set_activation_handler<builtin_protocol_feature_t::sha256_batch>();
+
+      wasmif.set_cache_size( cfg.wasm_cache_size );
 
+      if( cfg.publish_state_sequence ) {
+         EOS_ASSERT( cfg.db_map_mode == pinnable_mapped_file::map_mode::mapped, database_exception,
+                     "publishing the state sequence requires the \"mapped\" database map mode" );
+         state_seq = std::make_unique<state_sequence_writer>( (cfg.state_dir / config::state_sequence_filename).generic_string() );
+      }
       self.irreversible_block.connect([this](const block_state_ptr& bsp) {
          wasmif.current_lib(bsp->block_num);
       });
@@ -364,6 +487,7 @@ struct controller_impl {
     */
    template<typename Signal, typename Arg>
    void emit( const Signal& s, Arg&& a ) {
+      scoped_span span( "controller::emit" ); // the plugins connected to s
       try {
          s( std::forward<Arg>( a ));
       } catch (std::bad_alloc& e) {
@@ -384,7 +508,9 @@ struct controller_impl {
       }
    }
 
-   void log_irreversible() {
+   /// @param max_applied - in irreversible mode, the most blocks applied before returning, the root then being the last
+   ///                      block applied; the remaining irreversible blocks are applied by the next calls
+   void log_irreversible( uint32_t max_applied = std::numeric_limits<uint32_t>::max() ) {
       EOS_ASSERT( fork_db.root(), fork_database_exception, "fork database not properly initialized" );
 
       const auto& log_head = blog.head();
@@ -407,10 +533,11 @@ struct controller_impl {
 
       const auto branch = fork_db.fetch_branch( fork_head->id, fork_head->dpos_irreversible_blocknum );
       try {
-         const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
-
+         uint32_t applied = 0;
          for( auto bitr = branch.rbegin(); bitr != branch.rend(); ++bitr ) {
             if( read_mode == db_read_mode::IRREVERSIBLE ) {
+               if( applied == max_applied ) break;
+               ++applied;
                apply_block( *bitr, controller::block_status::complete, trx_meta_cache_lookup{} );
                head = (*bitr);
                fork_db.mark_valid( head );
@@ -423,11 +550,7 @@ struct controller_impl {
 
             blog.append( (*bitr)->block );
 
-            auto rbitr = rbi.begin();
-            while( rbitr != rbi.end() && rbitr->blocknum <= (*bitr)->block_num ) {
-               reversible_blocks.remove( *rbitr );
-               rbitr = rbi.begin();
-            }
+            reversible_blocks.remove_through( (*bitr)->block_num );
          }
       } catch( fc::exception& ) {
          if( root_id != fork_db.root()->id ) {
@@ -453,7 +576,7 @@ struct controller_impl {
 
       block_header_state genheader;
       genheader.active_schedule                = initial_schedule;
-      genheader.pending_schedule.schedule      = initial_schedule;
+      genheader.pending_schedule.schedule      = genheader.active_schedule;
       // NOTE: if wtmsig block signatures are enabled at genesis time this should be the hash of a producer authority schedule
       genheader.pending_schedule.schedule_hash = fc::sha256::hash(initial_legacy_schedule);
       genheader.header.timestamp               = genesis.initial_timestamp;
@@ -469,6 +592,95 @@ struct controller_impl {
       initialize_database(genesis);
    }
 
+   /**
+    * Blocks of the block log to replay, in order. With a block_validation_pipeline_depth, they are read and unpacked
+    * that many blocks ahead on a thread of their own, which also starts the key recovery of their transactions when
+    * the replay checks authorizations. Otherwise they are read when asked for.
+    */
+   class replay_block_reader {
+   public:
+      replay_block_reader( controller_impl& impl, uint32_t first_block_num )
+      :impl(impl), depth(impl.conf.block_validation_pipeline_depth), next_num(first_block_num)
+      {
+         if( depth == 0 ) return;
+         const bool recover_keys = !impl.self.skip_auth_check();
+         reader = std::thread( [this, recover_keys, block_num = first_block_num]() mutable {
+            fc::set_os_thread_name( "replay" );
+            try {
+               while( true ) {
+                  {
+                     std::unique_lock<std::mutex> g( mtx );
+                     cv.wait( g, [this]() { return stop || blocks.size() < depth; } );
+                     if( stop ) break;
+                  }
+                  signed_block_ptr b;
+                  {
+                     std::lock_guard<std::mutex> g( this->impl.blog_read_mtx );
+                     b = this->impl.blog.read_block_by_num( block_num++ );
+                  }
+                  if( !b ) break;
+                  // every block queued is either being applied or waiting, so no more than depth are recovering
+                  if( recover_keys ) this->impl.start_block_recover_keys( b );
+                  std::lock_guard<std::mutex> g( mtx );
+                  blocks.emplace_back( std::move( b ) );
+                  cv.notify_all();
+               }
+            } catch( ... ) {
+               std::lock_guard<std::mutex> g( mtx );
+               error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> g( mtx );
+            done = true;
+            cv.notify_all();
+         } );
+      }
+
+      ~replay_block_reader() {
+         if( !reader.joinable() ) return;
+         {
+            std::lock_guard<std::mutex> g( mtx );
+            stop = true;
+         }
+         cv.notify_all();
+         reader.join();
+      }
+
+      /// @return the next block, which stays queued until pop, or nullptr past the end of the block log
+      signed_block_ptr next() {
+         if( depth == 0 ) {
+            std::lock_guard<std::mutex> g( impl.blog_read_mtx );
+            return impl.blog.read_block_by_num( next_num );
+         }
+         std::unique_lock<std::mutex> g( mtx );
+         cv.wait( g, [this]() { return !blocks.empty() || done; } );
+         if( blocks.empty() ) {
+            if( error ) std::rethrow_exception( error );
+            return {};
+         }
+         return blocks.front();
+      }
+
+      void pop() {
+         ++next_num;
+         if( depth == 0 ) return;
+         std::lock_guard<std::mutex> g( mtx );
+         blocks.pop_front();
+         cv.notify_all();
+      }
+
+   private:
+      controller_impl&              impl;
+      const uint32_t                depth;
+      uint32_t                      next_num;
+      std::thread                   reader;
+      std::mutex                    mtx;
+      std::condition_variable       cv;
+      std::deque<signed_block_ptr>  blocks; ///< read ahead, front is the one being applied
+      bool                          stop = false;
+      bool                          done = false;
+      std::exception_ptr            error;
+   };
+
    void replay(std::function<bool()> shutdown) {
       auto blog_head = blog.head();
       auto blog_head_time = blog_head->timestamp.to_time_point();
@@ -482,8 +694,10 @@ struct controller_impl {
          ilog( "existing block log, attempting to replay from ${s} to ${n} blocks",
                ("s", start_block_num)("n", blog_head->block_num()) );
          try {
-            while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
+            replay_block_reader reader( *this, start_block_num );
+            while( auto next = reader.next() ) {
                replay_push_block( next, controller::block_status::irreversible );
+               reader.pop();
                if( next->block_num() % 500 == 0 ) {
                   ilog( "${n} of ${head}", ("n", next->block_num())("head", blog_head->block_num()) );
                   if( shutdown() ) break;
@@ -501,11 +715,19 @@ struct controller_impl {
             fork_db.reset( *head );
          } else if( head->block_num != fork_db.root()->block_num ) {
             auto new_root = fork_db.search_on_branch( pending_head->id, head->block_num );
-            EOS_ASSERT( new_root, fork_database_exception, "unexpected error: could not find new LIB in fork database" );
-            ilog( "advancing fork database root to new last irreversible block within existing fork database: ${id}",
-                  ("id", new_root->id) );
-            fork_db.mark_valid( new_root );
-            fork_db.advance_root( new_root->id );
+            if( !new_root || new_root->id != head->id ) {
+               // possible with a fork database restored from a checkpoint whose best branch was later abandoned
+               EOS_ASSERT( fork_db.restored_from_checkpoint(), fork_database_exception,
+                           "unexpected error: could not find new LIB in fork database" );
+               ilog( "last irreversible block not on the best branch of the fork database checkpoint, resetting it with the new root: ${id}",
+                     ("id", head->id) );
+               fork_db.reset( *head );
+            } else {
+               ilog( "advancing fork database root to new last irreversible block within existing fork database: ${id}",
+                     ("id", new_root->id) );
+               fork_db.mark_valid( new_root );
+               fork_db.advance_root( new_root->id );
+            }
          }
 
          // if the irreverible log is played without undo sessions enabled, we need to sync the
@@ -518,9 +740,9 @@ struct controller_impl {
 
       if( !except_ptr && !shutdown() ) {
          int rev = 0;
-         while( auto obj = reversible_blocks.find<reversible_block_object,by_num>(head->block_num+1) ) {
+         while( auto b = reversible_blocks.get_block( head->block_num+1 ) ) {
             ++rev;
-            replay_push_block( obj->get_block(), controller::block_status::validated );
+            replay_push_block( b, controller::block_status::validated );
          }
          ilog( "${n} reversible blocks replayed", ("n",rev) );
       }
@@ -677,31 +899,24 @@ struct controller_impl {
 
       protocol_features.init( db );
 
-      const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
       auto last_block_num = lib_num;
 
       if( read_mode == db_read_mode::IRREVERSIBLE ) {
          // ensure there are no reversible blocks
-         auto itr = rbi.begin();
-         if( itr != rbi.end() ) {
+         if( !reversible_blocks.empty() ) {
             wlog( "read_mode has changed to irreversible: erasing reversible blocks" );
+            reversible_blocks.remove_from( reversible_blocks.first_block_num() );
          }
-         for( ; itr != rbi.end(); itr = rbi.begin() )
-            reversible_blocks.remove( *itr );
       } else {
-         auto itr = rbi.begin();
-         for( ; itr != rbi.end() && itr->blocknum <= lib_num; itr = rbi.begin() )
-            reversible_blocks.remove( *itr );
+         reversible_blocks.remove_through( lib_num );
 
-         EOS_ASSERT( itr == rbi.end() || itr->blocknum == lib_num + 1, reversible_blocks_exception,
+         EOS_ASSERT( reversible_blocks.empty() || reversible_blocks.first_block_num() == lib_num + 1, reversible_blocks_exception,
                      "gap exists between last irreversible block (${lib}) and first reversible block (${first_reversible_block_num})",
-                     ("lib", lib_num)("first_reversible_block_num", itr->blocknum)
+                     ("lib", lib_num)("first_reversible_block_num", reversible_blocks.first_block_num())
          );
 
-         auto ritr = rbi.rbegin();
-
-         if( ritr != rbi.rend() ) {
-            last_block_num = ritr->blocknum;
+         if( !reversible_blocks.empty() ) {
+            last_block_num = reversible_blocks.last_block_num();
          }
 
          EOS_ASSERT( head->block_num <= last_block_num, reversible_blocks_exception,
@@ -711,23 +926,22 @@ struct controller_impl {
 
          auto pending_head = fork_db.pending_head();
 
-         if( ritr != rbi.rend()
+         if( !reversible_blocks.empty()
              && lib_num < pending_head->block_num
              && pending_head->block_num <= last_block_num
          ) {
-            auto rbitr = rbi.find( pending_head->block_num );
-            EOS_ASSERT( rbitr != rbi.end(), reversible_blocks_exception, "pending head block not found in reversible blocks");
-            auto rev_id = rbitr->get_block_id();
-            EOS_ASSERT( rev_id == pending_head->id,
+            auto rev_id = reversible_blocks.get_block_id( pending_head->block_num );
+            EOS_ASSERT( rev_id, reversible_blocks_exception, "pending head block not found in reversible blocks");
+            EOS_ASSERT( *rev_id == pending_head->id,
                         reversible_blocks_exception,
                         "mismatch in block id of pending head block ${num} in reversible blocks database: "
                         "expected: ${expected}, actual: ${actual}",
-                        ("num", pending_head->block_num)("expected", pending_head->id)("actual", rev_id)
+                        ("num", pending_head->block_num)("expected", pending_head->id)("actual", *rev_id)
             );
-         } else if( ritr != rbi.rend() && last_block_num < pending_head->block_num ) {
+         } else if( !reversible_blocks.empty() && last_block_num < pending_head->block_num ) {
             const auto b = fork_db.search_on_branch( pending_head->id, last_block_num );
             FC_ASSERT( b, "unexpected violation of invariants" );
-            auto rev_id = ritr->get_block_id();
+            auto rev_id = *reversible_blocks.get_block_id( last_block_num );
             EOS_ASSERT( rev_id == b->id,
                         reversible_blocks_exception,
                         "mismatch in block id of last block (${num}) in reversible blocks database: "
@@ -758,6 +972,26 @@ struct controller_impl {
             maybe_switch_forks( pending_head, controller::block_status::complete, forked_branch_callback{}, trx_meta_cache_lookup{} );
          }
       }
+
+      state_settled();
+   }
+
+   /// the state is about to leave that of the head block, see state_sequence_writer
+   void state_writing() {
+      if( state_seq ) state_seq->begin_write();
+   }
+
+   /// the state is that of the head block again
+   void state_settled() {
+      if( state_seq ) state_seq->end_write( head->block_num );
+   }
+
+   /// state_writing for the scope, settled on exit unless the state was already being written, for the transactions
+   /// of the read modes applying them to the state of the head block and undoing them right away
+   auto state_writing_scope() {
+      const bool settle = state_seq && !state_seq->writing();
+      state_writing();
+      return fc::make_scoped_exit( [this, settle]() { if( settle ) state_settled(); } );
    }
 
    ~controller_impl() {
@@ -766,8 +1000,6 @@ struct controller_impl {
    }
 
    void add_indices() {
-      reversible_blocks.add_index<reversible_block_index>();
-
       controller_index_set::add_indices(db);
       contract_database_index_set::add_indices(db);
 
@@ -785,29 +1017,96 @@ struct controller_impl {
                   */
    }
 
-   void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
-      snapshot->write_section("contract_tables", [this]( auto& section ) {
-         index_utils<table_id_multi_index>::walk(db, [this, &section]( const table_id_object& table_row ){
-            // add a row for the table
-            section.add_row(table_row, db);
+   /// add the row of table_row followed by a size row and then N data rows for each type of table
+   template<typename Section>
+   void add_contract_table_to_snapshot( Section& section, const table_id_object& table_row ) const {
+      section.add_row(table_row, db);
 
-            // followed by a size row and then N data rows for each type of table
-            contract_database_index_set::walk_indices([this, &section, &table_row]( auto utils ) {
-               using utils_t = decltype(utils);
-               using value_t = typename decltype(utils)::index_t::value_type;
-               using by_table_id = object_to_table_id_tag_t<value_t>;
+      contract_database_index_set::walk_indices([this, &section, &table_row]( auto utils ) {
+         using utils_t = decltype(utils);
+         using value_t = typename decltype(utils)::index_t::value_type;
+         using by_table_id = object_to_table_id_tag_t<value_t>;
 
-               auto tid_key = boost::make_tuple(table_row.id);
-               auto next_tid_key = boost::make_tuple(table_id_object::id_type(table_row.id._id + 1));
+         auto tid_key = boost::make_tuple(table_row.id);
+         auto next_tid_key = boost::make_tuple(table_id_object::id_type(table_row.id._id + 1));
 
-               unsigned_int size = utils_t::template size_range<by_table_id>(db, tid_key, next_tid_key);
-               section.add_row(size, db);
+         unsigned_int size = utils_t::template size_range<by_table_id>(db, tid_key, next_tid_key);
+         section.add_row(size, db);
 
-               utils_t::template walk_range<by_table_id>(db, tid_key, next_tid_key, [this, &section]( const auto &row ) {
-                  section.add_row(row, db);
-               });
+         utils_t::template walk_range<by_table_id>(db, tid_key, next_tid_key, [this, &section]( const auto &row ) {
+            section.add_row(row, db);
+         });
+      });
+   }
+
+   /**
+    *  Packs ranges of tables on the thread pool and appends them to the section in table order. The database is only
+    *  read, so this must not run concurrently with anything that modifies it.
+    */
+   template<typename Section>
+   void add_contract_tables_to_snapshot_parallel( Section& section ) const {
+      constexpr uint64_t rows_per_task = 64*1024;
+      const size_t max_pending = conf.thread_pool_size * 2u;
+
+      using rows_ptr = std::shared_ptr<detail::buffered_snapshot_rows>;
+      std::deque<std::future<rows_ptr>> pending;
+
+      auto start_task = [this, &pending]( table_id_object::id_type first, table_id_object::id_type last ) {
+         pending.emplace_back( async_thread_pool( thread_pool, [this, first, last]() {
+            auto rows = std::make_shared<detail::buffered_snapshot_rows>();
+            index_utils<table_id_multi_index>::walk_range<by_id>(db, first, last, [this, &rows]( const table_id_object& table_row ) {
+               add_contract_table_to_snapshot(*rows, table_row);
+            });
+            return rows;
+         }));
+      };
+
+      const auto& tables = db.get_index<table_id_multi_index>().indices();
+      auto first = tables.begin();
+      uint64_t rows_in_task = 0;
+      for( auto itr = tables.begin(); itr != tables.end(); ) {
+         rows_in_task += itr->count + 1;
+         ++itr;
+         if( rows_in_task >= rows_per_task || itr == tables.end() ) {
+            start_task( first->id, itr == tables.end() ? table_id_object::id_type(std::prev(itr)->id._id + 1) : itr->id );
+            first = itr;
+            rows_in_task = 0;
+
+            // bound the memory held by packed but not yet written tables
+            while( pending.size() >= max_pending ) {
+               section.add_rows( *pending.front().get() );
+               pending.pop_front();
+            }
+         }
+      }
+      while( !pending.empty() ) {
+         section.add_rows( *pending.front().get() );
+         pending.pop_front();
+      }
+   }
+
+   void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
+      // a delta writer compares the rows of every table on its own
+      if( auto delta = dynamic_cast<snapshot_delta_writer*>(snapshot.get()) ) {
+         snapshot->write_section("contract_tables", [this, delta]( auto& ) {
+            index_utils<table_id_multi_index>::walk(db, [this, delta]( const table_id_object& table_row ){
+               detail::buffered_snapshot_rows rows;
+               add_contract_table_to_snapshot( rows, table_row );
+               delta->add_table( table_row.code, table_row.scope, table_row.table, rows );
             });
          });
+         return;
+      }
+
+      const bool parallel = conf.thread_pool_size > 1 && snapshot->supports_packed_rows();
+      snapshot->write_section("contract_tables", [this, parallel]( auto& section ) {
+         if( parallel ) {
+            add_contract_tables_to_snapshot_parallel( section );
+            return;
+         }
+         index_utils<table_id_multi_index>::walk(db, [this, &section]( const table_id_object& table_row ){
+            add_contract_table_to_snapshot( section, table_row );
+         });
       });
    }
 
@@ -960,6 +1259,11 @@ struct controller_impl {
             }
          }
 
+         // the key-value database was added in version 4
+         if (std::is_same<value_t, kv_object>::value && header.version < 4) {
+            return;
+         }
+
          snapshot->read_section<value_t>([this]( auto& section ) {
             bool more = !section.empty();
             while(more) {
@@ -1087,6 +1391,8 @@ struct controller_impl {
    // The returned scoped_exit should not exceed the lifetime of the pending which existed when make_block_restore_point was called.
    fc::scoped_exit<std::function<void()>> make_block_restore_point() {
       auto& bb = pending->_block_stage.get<building_block>();
+      // what is in the block is there to stay unless a restore point made earlier restores it
+      update_pending_merkles( bb );
       auto orig_block_transactions_size = bb._pending_trx_receipts.size();
       auto orig_state_transactions_size = bb._pending_trx_metas.size();
       auto orig_state_actions_size      = bb._actions.size();
@@ -1100,6 +1406,8 @@ struct controller_impl {
          bb._pending_trx_receipts.resize(orig_block_transactions_size);
          bb._pending_trx_metas.resize(orig_state_transactions_size);
          bb._actions.resize(orig_state_actions_size);
+         if( bb._trx_merkle._node_count > bb._pending_trx_receipts.size() ) bb._trx_merkle = incremental_merkle();
+         if( bb._action_merkle._node_count > bb._actions.size() ) bb._action_merkle = incremental_merkle();
       };
 
       return fc::make_scoped_exit( std::move(callback) );
@@ -1204,6 +1512,8 @@ struct controller_impl {
 
    transaction_trace_ptr push_scheduled_transaction( const generated_transaction_object& gto, fc::time_point deadline, uint32_t billed_cpu_time_us, bool explicit_billed_cpu_time = false )
    { try {
+      scoped_span span( "controller::push_scheduled_transaction" );
+      auto writing = state_writing_scope();
 
       const bool validating = !self.is_producing_block();
       EOS_ASSERT( !validating || explicit_billed_cpu_time, transaction_exception, "validating requires explicit billing" );
@@ -1222,15 +1532,16 @@ struct controller_impl {
       // resulting in the GTO being restored and available for a future block to retire.
       int64_t trx_removal_ram_delta = remove_scheduled_transaction(gto);
 
-      fc::datastream<const char*> ds( gtrx.packed_trx.data(), gtrx.packed_trx.size() );
-
       EOS_ASSERT( gtrx.delay_until <= self.pending_block_time(), transaction_exception, "this transaction isn't ready",
                  ("gtrx.delay_until",gtrx.delay_until)("pbt",self.pending_block_time())          );
 
-      signed_transaction dtrx;
-      fc::raw::unpack(ds,static_cast<transaction&>(dtrx) );
-      transaction_metadata_ptr trx = transaction_metadata::create_no_recover_keys( packed_transaction( dtrx ), transaction_metadata::trx_type::scheduled );
+      // unpacked once from the stored bytes, which generated_transaction_object::set packed and so are what packing
+      // it again would make; gtrx keeps its bytes for apply_onerror
+      transaction_metadata_ptr trx = transaction_metadata::create_no_recover_keys(
+            packed_transaction( bytes( gtrx.packed_trx ), vector<signature_type>(), bytes(), packed_transaction::compression_type::none ),
+            transaction_metadata::trx_type::scheduled );
       trx->accepted = true;
+      const signed_transaction& dtrx = trx->packed_trx()->get_signed_transaction();
 
       transaction_trace_ptr trace;
       if( gtrx.expiration < self.pending_block_time() ) {
@@ -1404,14 +1715,17 @@ struct controller_impl {
                                            fc::time_point deadline,
                                            uint32_t billed_cpu_time_us,
                                            bool explicit_billed_cpu_time,
-                                           uint32_t subjective_cpu_bill_us )
+                                           uint32_t subjective_cpu_bill_us,
+                                           bool auth_prechecked = false )
    {
       EOS_ASSERT(deadline != fc::time_point(), transaction_exception, "deadline cannot be uninitialized");
+      scoped_span span( "controller::push_transaction" );
+      auto writing = state_writing_scope();
 
       transaction_trace_ptr trace;
       try {
          auto start = fc::time_point::now();
-         const bool check_auth = !self.skip_auth_check() && !trx->implicit;
+         const bool check_auth = !self.skip_auth_check() && !trx->implicit && !auth_prechecked;
          const fc::microseconds sig_cpu_usage = trx->signature_cpu_usage();
 
          if( !explicit_billed_cpu_time ) {
@@ -1440,6 +1754,9 @@ struct controller_impl {
                trx_context.init_for_implicit_trx();
                trx_context.enforce_whiteblacklist = false;
             } else {
+               EOS_ASSERT( trx->packed_trx()->get_compression() != packed_transaction::compression_type::zstd ||
+                           self.is_builtin_activated( builtin_protocol_feature_t::zstd_transaction_compression ),
+                           unknown_transaction_compression, "zstd transaction compression is not activated" );
                bool skip_recording = replay_head_time && (time_point(trn.expiration) <= *replay_head_time);
                trx_context.init_for_input_trx( trx->packed_trx()->get_unprunable_size(),
                                                trx->packed_trx()->get_prunable_size(),
@@ -1449,6 +1766,7 @@ struct controller_impl {
             trx_context.delay = fc::seconds(trn.delay_sec);
 
             if( check_auth ) {
+               scoped_span auth_span( "authorization_manager::check_authorization" );
                authorization.check_authorization(
                        trn.actions,
                        trx->recovered_keys(),
@@ -1461,6 +1779,17 @@ struct controller_impl {
             trx_context.exec();
             trx_context.finalize(); // Automatically rounds up network and CPU usage in trace and bills payers if successful
 
+            if( trx->dry_run ) {
+               // report what the receipt would have been, but leave no trace of the transaction in the pending block
+               transaction_receipt_header r;
+               r.status = (trx_context.delay == fc::seconds(0)) ? transaction_receipt::executed : transaction_receipt::delayed;
+               r.cpu_usage_us = trx_context.billed_cpu_time_us;
+               r.net_usage_words = trace->net_usage / 8;
+               trace->receipt = r;
+               trx_context.undo();
+               return trace;
+            }
+
             auto restore = make_block_restore_point();
 
             if (!trx->implicit) {
@@ -1497,6 +1826,7 @@ struct controller_impl {
                trx_context.squash();
             }
 
+            transactions_applied_metric.add();
             return trace;
          } catch( const disallowed_transaction_extensions_bad_block_exception& ) {
             throw;
@@ -1509,6 +1839,9 @@ struct controller_impl {
             trace->elapsed = fc::time_point::now() - trx_context.start;
          }
 
+         if( trx->dry_run ) return trace;
+
+         transactions_failed_metric.add();
          emit( self.accepted_transaction, trx );
          emit( self.applied_transaction, std::tie(trace, trn) );
 
@@ -1523,12 +1856,14 @@ struct controller_impl {
                      const optional<block_id_type>& producer_block_id )
    {
       EOS_ASSERT( !pending, block_validate_exception, "pending block already exists" );
+      scoped_span span( "controller::start_block" );
 
       emit( self.block_start, head->block_num + 1 );
 
       auto guard_pending = fc::make_scoped_exit([this, head_block_num=head->block_num](){
          protocol_features.popped_blocks_to( head_block_num );
          pending.reset();
+         state_settled();
       });
 
       if (!self.skip_db_sessions(s)) {
@@ -1549,6 +1884,8 @@ struct controller_impl {
       // modify state of speculative block only if we are in speculative read mode (otherwise we need clean state for head or read-only modes)
       if ( read_mode == db_read_mode::SPECULATIVE || pending->_block_status != controller::block_status::incomplete )
       {
+         state_writing();
+
          const auto& pso = db.get<protocol_state_object>();
 
          auto num_preactivated_protocol_features = pso.preactivated_protocol_features.size();
@@ -1619,7 +1956,7 @@ struct controller_impl {
 
          if( gpo.proposed_schedule_block_num.valid() && // if there is a proposed schedule that was proposed in a block ...
              ( *gpo.proposed_schedule_block_num <= pbhs.dpos_irreversible_blocknum ) && // ... that has now become irreversible ...
-             pbhs.prev_pending_schedule.schedule.producers.size() == 0 // ... and there was room for a new pending schedule prior to any possible promotion
+             pbhs.prev_pending_schedule.schedule->producers.size() == 0 // ... and there was room for a new pending schedule prior to any possible promotion
          )
          {
             // Promote proposed schedule to pending schedule.
@@ -1673,6 +2010,8 @@ struct controller_impl {
    {
       EOS_ASSERT( pending, block_validate_exception, "it is not valid to finalize when there is no pending block");
       EOS_ASSERT( pending->_block_stage.contains<building_block>(), block_validate_exception, "already called finalize_block");
+      scoped_span span( "controller::finalize_block" );
+      state_writing();
 
       try {
 
@@ -1689,11 +2028,12 @@ struct controller_impl {
       resource_limits.process_block_usage(pbhs.block_num);
 
       auto& bb = pending->_block_stage.get<building_block>();
+      update_pending_merkles( bb );
 
       // Create (unsigned) block:
       auto block_ptr = std::make_shared<signed_block>( pbhs.make_block_header(
-         bb._transaction_mroot ? *bb._transaction_mroot : calculate_trx_merkle( bb._pending_trx_receipts ),
-         calculate_action_merkle(),
+         bb._transaction_mroot ? *bb._transaction_mroot : bb._trx_merkle.get_root(),
+         bb._action_merkle.get_root(),
          bb._new_pending_producer_schedule,
          std::move( bb._new_protocol_feature_activations ),
          protocol_features.get_protocol_feature_set()
@@ -1733,6 +2073,7 @@ struct controller_impl {
     * @post regardless of the success of commit block there is no active pending block
     */
    void commit_block( bool add_to_fork_db ) {
+      scoped_span span( "controller::commit_block" );
       auto reset_pending_on_exit = fc::make_scoped_exit([this]{
          pending.reset();
       });
@@ -1749,13 +2090,11 @@ struct controller_impl {
             emit( self.accepted_block_header, bsp );
             head = fork_db.head();
             EOS_ASSERT( bsp == head, fork_database_exception, "committed block did not become the new head in fork database");
+            advance_prerecover_floor( bsp->block_num );
          }
 
          if( !replay_head_time && read_mode != db_read_mode::IRREVERSIBLE ) {
-            reversible_blocks.create<reversible_block_object>( [&]( auto& ubo ) {
-               ubo.blocknum = bsp->block_num;
-               ubo.set_block( bsp->block );
-            });
+            reversible_blocks.append( bsp->block, bsp->id );
          }
 
          emit( self.accepted_block, bsp );
@@ -1763,6 +2102,13 @@ struct controller_impl {
          if( add_to_fork_db ) {
             log_irreversible();
          }
+
+         if( conf.fork_db_checkpoint_interval > 0 && !replay_head_time
+             && bsp->block_num % conf.fork_db_checkpoint_interval == 0 ) {
+            try {
+               fork_db.checkpoint();
+            } FC_LOG_AND_DROP()
+         }
       } catch (...) {
          // dont bother resetting pending, instead abort the block
          reset_pending_on_exit.cancel();
@@ -1772,6 +2118,13 @@ struct controller_impl {
 
       // push the state for pending.
       pending->push();
+
+      if( conf.db_flush_interval > 0 && !replay_head_time && head->block_num % conf.db_flush_interval == 0 ) {
+         // written back on the state_memory thread while the next blocks are applied
+         db_memory.flush();
+      }
+
+      state_settled();
    }
 
    /**
@@ -1856,57 +2209,104 @@ struct controller_impl {
    }
 
 
-   void apply_block( const block_state_ptr& bsp, controller::block_status s, const trx_meta_cache_lookup& trx_lookup )
+   /**
+    * @param revalidating - bsp was validated by this node before on the same parent state, as a block of a branch
+    * switched back to, so the authorizations of its transactions are known to be satisfied and are not checked again
+    */
+   void apply_block( const block_state_ptr& bsp, controller::block_status s, const trx_meta_cache_lookup& trx_lookup,
+                     bool revalidating = false )
    { try {
+      scoped_span span( "controller::apply_block" );
+      const auto apply_start = fc::time_point::now();
       try {
          const signed_block_ptr& b = bsp->block;
          const auto& new_protocol_feature_activations = bsp->get_new_protocol_feature_activations();
 
          auto producer_block_id = b->id();
+         start_block_prefetch( b );
          start_block( b->timestamp, b->confirmed, new_protocol_feature_activations, s, producer_block_id);
 
          const bool existing_trxs_metas = !bsp->trxs_metas().empty();
          const bool pub_keys_recovered = bsp->is_pub_keys_recovered();
          const bool skip_auth_checks = self.skip_auth_check();
-         std::vector<std::tuple<transaction_metadata_ptr, recover_keys_future>> trx_metas;
+         std::vector<transaction_metadata_ptr> trx_metas;
+         recover_keys_batch recovering; // packed transactions without an entry in trx_metas, in block order
          bool use_bsp_cached = false;
          if( pub_keys_recovered || (skip_auth_checks && existing_trxs_metas) ) {
             use_bsp_cached = true;
          } else {
-            trx_metas.reserve( b->transactions.size() );
-            for( const auto& receipt : b->transactions ) {
-               if( receipt.trx.contains<packed_transaction>()) {
-                  const auto& pt = receipt.trx.get<packed_transaction>();
-                  transaction_metadata_ptr trx_meta_ptr = trx_lookup ? trx_lookup( pt.id() ) : transaction_metadata_ptr{};
-                  if( trx_meta_ptr && *trx_meta_ptr->packed_trx() != pt ) trx_meta_ptr = nullptr;
-                  if( trx_meta_ptr && ( skip_auth_checks || !trx_meta_ptr->recovered_keys().empty() ) ) {
-                     trx_metas.emplace_back( std::move( trx_meta_ptr ), recover_keys_future{} );
-                  } else if( skip_auth_checks ) {
-                     trx_metas.emplace_back(
-                           transaction_metadata::create_no_recover_keys( pt, transaction_metadata::trx_type::input ),
-                           recover_keys_future{} );
-                  } else {
-                     auto ptrx = std::make_shared<packed_transaction>( pt );
-                     auto fut = transaction_metadata::start_recover_keys(
-                           std::move( ptrx ), thread_pool.get_executor(), chain_id, microseconds::maximum() );
-                     trx_metas.emplace_back( transaction_metadata_ptr{}, std::move( fut ) );
+            if( !skip_auth_checks ) {
+               auto itr = irreversible_recovering.find( bsp->id );
+               if( itr != irreversible_recovering.end() ) {
+                  recovering = std::move( itr->second );
+                  irreversible_recovering.erase( itr );
+               }
+               if( recovering.empty() ) recovering = take_prerecovered_block( b );
+            }
+            if( !recovering.empty() ) {
+               trx_metas.resize( recovering.size() );
+            } else {
+               trx_metas.reserve( b->transactions.size() );
+               std::vector<packed_transaction_ptr> to_recover;
+               for( const auto& receipt : b->transactions ) {
+                  if( receipt.trx.contains<packed_transaction>()) {
+                     const auto& pt = receipt.trx.get<packed_transaction>();
+                     transaction_metadata_ptr trx_meta_ptr = trx_lookup ? trx_lookup( pt.id() ) : transaction_metadata_ptr{};
+                     if( trx_meta_ptr && *trx_meta_ptr->packed_trx() != pt ) trx_meta_ptr = nullptr;
+                     if( trx_meta_ptr && ( skip_auth_checks || !trx_meta_ptr->recovered_keys().empty() ) ) {
+                        trx_metas.emplace_back( std::move( trx_meta_ptr ) );
+                     } else if( skip_auth_checks ) {
+                        trx_metas.emplace_back(
+                              transaction_metadata::create_no_recover_keys( pt, transaction_metadata::trx_type::input ) );
+                     } else {
+                        trx_metas.emplace_back();
+                        to_recover.emplace_back( std::make_shared<packed_transaction>( pt ) );
+                     }
                   }
                }
+               if( !to_recover.empty() ) {
+                  recovering = transaction_metadata::start_recover_keys( to_recover, thread_pool, chain_id,
+                                                                         microseconds::maximum(), recover_keys_chunks() );
+               }
+            }
+         }
+
+         advance_prerecover_floor( b->block_num() );
+
+         // applying a block is deterministic, so the checks it passed before on this state pass again
+         const bool auth_checked_before = revalidating && !conf.force_all_checks;
+         prechecked_authorizations prechecked;
+         if( conf.parallel_auth_checks && !skip_auth_checks && !auth_checked_before && conf.thread_pool_size > 1 ) {
+            std::vector<transaction_metadata_ptr> metas;
+            size_t idx = 0;
+            size_t rec_idx = 0;
+            for( const auto& receipt : b->transactions ) {
+               if( !receipt.trx.contains<packed_transaction>() ) continue;
+               try {
+                  metas.emplace_back( use_bsp_cached ? bsp->trxs_metas().at( idx )
+                                                     : ( !!trx_metas.at( idx ) ? trx_metas.at( idx ) : recovering.get( rec_idx++ ) ) );
+               } catch( ... ) {
+                  metas.emplace_back(); // recovery failed, reported when the transaction is applied
+               }
+               ++idx;
             }
+            prechecked = precheck_authorizations( metas );
          }
 
          transaction_trace_ptr trace;
 
          size_t packed_idx = 0;
+         size_t recovering_idx = 0;
          for( const auto& receipt : b->transactions ) {
             const auto& trx_receipts = pending->_block_stage.get<building_block>()._pending_trx_receipts;
             auto num_pending_receipts = trx_receipts.size();
             if( receipt.trx.contains<packed_transaction>() ) {
                const auto& trx_meta = ( use_bsp_cached ? bsp->trxs_metas().at( packed_idx )
-                                                       : ( !!std::get<0>( trx_metas.at( packed_idx ) ) ?
-                                                             std::get<0>( trx_metas.at( packed_idx ) )
-                                                             : std::get<1>( trx_metas.at( packed_idx ) ).get() ) );
-               trace = push_transaction( trx_meta, fc::time_point::maximum(), receipt.cpu_usage_us, true, 0 );
+                                                       : ( !!trx_metas.at( packed_idx ) ?
+                                                             trx_metas.at( packed_idx )
+                                                             : recovering.get( recovering_idx++ ) ) );
+               trace = push_transaction( trx_meta, fc::time_point::maximum(), receipt.cpu_usage_us, true, 0,
+                                         auth_checked_before || is_auth_prechecked( prechecked, packed_idx ) );
                ++packed_idx;
             } else if( receipt.trx.contains<transaction_id_type>() ) {
                trace = push_scheduled_transaction( receipt.trx.get<transaction_id_type>(), fc::time_point::maximum(), receipt.cpu_usage_us, true );
@@ -1957,6 +2357,7 @@ struct controller_impl {
          pending->_block_stage = completed_block{ bsp };
 
          commit_block(false);
+         block_apply_metric.observe( (fc::time_point::now() - apply_start).count() );
          return;
       } catch ( const fc::exception& e ) {
          edump((e.to_detail_string()));
@@ -1965,6 +2366,134 @@ struct controller_impl {
       }
    } FC_CAPTURE_AND_RETHROW() } /// apply_block
 
+   /**
+    *  Checks the authorizations of trx_metas on the thread pool against the current state, empty entries are skipped.
+    *  The database is only read, the main thread waits for the checks so nothing modifies it meanwhile.
+    *  Transactions with a canceldelay action are left to be checked when applied: it is authorized by the delayed
+    *  transaction it cancels, which an earlier transaction of the block may execute or cancel.
+    */
+   prechecked_authorizations precheck_authorizations( const std::vector<transaction_metadata_ptr>& trx_metas ) {
+      prechecked_authorizations result;
+      const auto& gpo_config = self.get_global_properties().configuration;
+      result.revision = authorization.revision();
+      result.max_authority_depth = gpo_config.max_authority_depth;
+      result.max_transaction_delay = gpo_config.max_transaction_delay;
+      result.satisfied.resize( trx_metas.size(), false );
+      if( trx_metas.empty() ) return result;
+
+      const size_t chunk_size = (trx_metas.size() + conf.thread_pool_size - 1) / conf.thread_pool_size;
+      std::vector<std::future<void>> checks;
+      for( size_t first = 0; first < trx_metas.size(); first += chunk_size ) {
+         const size_t last = std::min( first + chunk_size, trx_metas.size() );
+         checks.emplace_back( async_thread_pool( thread_pool, [this, &trx_metas, &result, first, last]() {
+            for( size_t i = first; i < last; ++i ) {
+               if( !trx_metas[i] ) continue;
+               const signed_transaction& trn = trx_metas[i]->packed_trx()->get_signed_transaction();
+               if( std::any_of( trn.actions.begin(), trn.actions.end(), []( const action& a ) {
+                      return a.account == config::system_account_name && a.name == canceldelay::get_name();
+                   } ) ) continue;
+               try {
+                  scoped_span span( "authorization_manager::check_authorization" );
+                  authorization.check_authorization( trn.actions, trx_metas[i]->recovered_keys(), {},
+                                                     fc::seconds( trn.delay_sec ), {}, false );
+                  result.satisfied[i] = true;
+               } catch( ... ) {
+                  // checked again when the transaction is applied, which reports the failure
+               }
+            }
+         }));
+      }
+      for( auto& c : checks ) c.get();
+      return result;
+   }
+
+   bool is_auth_prechecked( const prechecked_authorizations& prechecked, size_t packed_idx )const {
+      if( packed_idx >= prechecked.satisfied.size() || !prechecked.satisfied[packed_idx] ) return false;
+      const auto& gpo_config = self.get_global_properties().configuration;
+      return prechecked.revision == authorization.revision()
+             && prechecked.max_authority_depth == gpo_config.max_authority_depth
+             && prechecked.max_transaction_delay == gpo_config.max_transaction_delay;
+   }
+
+   // several chunks per worker so that apply of the first transactions does not wait on a whole worker share
+   size_t recover_keys_chunks()const { return conf.thread_pool_size * 4u; }
+
+   /// reads ahead on the thread pool the pages of the database the contracts of the actions of b used when they last ran
+   void start_block_prefetch( const signed_block_ptr& b ) {
+      if( !db_memory.records_access() || b->transactions.empty() ) return;
+      thread_pool.post( [this, b]() {
+         std::vector<account_name> contracts;
+         for( const auto& receipt : b->transactions ) {
+            if( !receipt.trx.contains<packed_transaction>() ) continue;
+            for( const auto& a : receipt.trx.get<packed_transaction>().get_transaction().actions ) {
+               contracts.push_back( a.account );
+            }
+         }
+         std::sort( contracts.begin(), contracts.end() );
+         contracts.erase( std::unique( contracts.begin(), contracts.end() ), contracts.end() );
+         db_memory.prefetch( contracts );
+      } );
+   }
+
+   /// @return recovery of the keys of the packed transactions of b, in block order, or empty if it has none; thread safe
+   recover_keys_batch start_recover_keys_of( const signed_block_ptr& b ) {
+      std::vector<packed_transaction_ptr> trxs;
+      trxs.reserve( b->transactions.size() );
+      for( const auto& receipt : b->transactions ) {
+         if( receipt.trx.contains<packed_transaction>() ) {
+            trxs.emplace_back( std::make_shared<packed_transaction>( receipt.trx.get<packed_transaction>() ) );
+         }
+      }
+      if( trxs.empty() ) return recover_keys_batch{};
+      return transaction_metadata::start_recover_keys( trxs, thread_pool, chain_id, microseconds::maximum(), recover_keys_chunks() );
+   }
+
+   /// thread safe
+   void start_block_recover_keys( const signed_block_ptr& b ) {
+      if( conf.block_validation_pipeline_depth == 0 || !b || b->transactions.empty() ) return;
+      const auto id = b->id();
+      const uint32_t num = block_header::num_from_id( id );
+
+      // recovery is only queued, so it is started under the lock that makes a block start at most once
+      std::lock_guard<std::mutex> g( prerecovered_blocks_mtx );
+      // blocks up to the floor are in the fork database already; blocks beyond the window, such as those held for
+      // later sync ranges, would take the slots of the blocks applied before them
+      if( num <= prerecover_floor || num > prerecover_floor + conf.block_validation_pipeline_depth ) return;
+      if( prerecovered_blocks.size() >= conf.block_validation_pipeline_depth || prerecovered_blocks.count( id ) ) return;
+      auto recovering = start_recover_keys_of( b );
+      if( !recovering.empty() ) prerecovered_blocks.emplace( id, std::move( recovering ) );
+   }
+
+   /// moves the floor of start_block_recover_keys up to block_num, dropping recoveries of blocks before it, which are
+   /// duplicates or blocks of dropped forks; main thread
+   void advance_prerecover_floor( uint32_t block_num ) {
+      if( conf.block_validation_pipeline_depth == 0 ) return;
+      std::lock_guard<std::mutex> g( prerecovered_blocks_mtx );
+      if( block_num <= prerecover_floor ) return;
+      prerecover_floor = block_num;
+      for( auto itr = prerecovered_blocks.begin(); itr != prerecovered_blocks.end(); ) {
+         if( block_header::num_from_id( itr->first ) < block_num ) itr = prerecovered_blocks.erase( itr );
+         else ++itr;
+      }
+   }
+
+   /// @return recovery started by start_block_recover_keys for the block with the id of b, or empty if none
+   recover_keys_batch take_prerecovered_block( const signed_block_ptr& b ) {
+      recover_keys_batch result;
+      if( conf.block_validation_pipeline_depth == 0 ) return result;
+      const auto id = b->id();
+      {
+         std::lock_guard<std::mutex> g( prerecovered_blocks_mtx );
+         auto itr = prerecovered_blocks.find( id );
+         if( itr != prerecovered_blocks.end() ) {
+            result = std::move( itr->second );
+            prerecovered_blocks.erase( itr );
+         }
+      }
+      advance_prerecover_floor( block_header::num_from_id( id ) );
+      return result;
+   }
+
    std::future<block_state_ptr> create_block_state_future( const signed_block_ptr& b ) {
       EOS_ASSERT( b, block_validate_exception, "null block" );
 
@@ -1978,7 +2507,7 @@ struct controller_impl {
       EOS_ASSERT( prev, unlinkable_block_exception,
                   "unlinkable block ${id}", ("id", id)("previous", b->previous) );
 
-      return async_thread_pool( thread_pool.get_executor(), [b, prev, control=this]() {
+      return async_thread_pool( thread_pool, [b, prev, control=this]() {
          const bool skip_validate_signee = false;
 
          auto trx_mroot = calculate_trx_merkle( b->transactions );
@@ -2024,7 +2553,23 @@ struct controller_impl {
          if( read_mode != db_read_mode::IRREVERSIBLE ) {
             maybe_switch_forks( fork_db.pending_head(), s, forked_branch_cb, trx_lookup );
          } else {
-            log_irreversible();
+            // recover the keys while the block waits to become irreversible, rather than all at once when it does
+            if( !self.skip_auth_check() && !b->transactions.empty() ) {
+               auto recovering = take_prerecovered_block( b );
+               if( recovering.empty() ) recovering = start_recover_keys_of( b );
+               if( !recovering.empty() ) irreversible_recovering[bsp->id] = std::move( recovering );
+            }
+            advance_prerecover_floor( bsp->block_num );
+
+            log_irreversible( conf.irreversible_blocks_per_push ? conf.irreversible_blocks_per_push
+                                                                : std::numeric_limits<uint32_t>::max() );
+
+            // blocks of dropped forks, and those that became irreversible without being applied here
+            const uint32_t lib = fork_db.root()->block_num;
+            for( auto itr = irreversible_recovering.begin(); itr != irreversible_recovering.end(); ) {
+               if( block_header::num_from_id( itr->first ) <= lib ) itr = irreversible_recovering.erase( itr );
+               else ++itr;
+            }
          }
 
       } FC_LOG_AND_RETHROW( )
@@ -2032,7 +2577,6 @@ struct controller_impl {
 
    void replay_push_block( const signed_block_ptr& b, controller::block_status s ) {
       self.validate_db_available_size();
-      self.validate_reversible_available_size();
 
       EOS_ASSERT(!pending, block_validate_exception, "it is not valid to push a block when there is a pending block");
 
@@ -2114,7 +2658,7 @@ struct controller_impl {
             optional<fc::exception> except;
             try {
                apply_block( *ritr, (*ritr)->is_valid() ? controller::block_status::validated
-                                                       : controller::block_status::complete, trx_lookup );
+                                                       : controller::block_status::complete, trx_lookup, (*ritr)->is_valid() );
                fork_db.mark_valid( *ritr );
                head = *ritr;
             } catch (const fc::exception& e) {
@@ -2138,7 +2682,7 @@ struct controller_impl {
 
                // re-apply good blocks
                for( auto ritr = branches.second.rbegin(); ritr != branches.second.rend(); ++ritr ) {
-                  apply_block( *ritr, controller::block_status::validated /* we previously validated these blocks*/, trx_lookup );
+                  apply_block( *ritr, controller::block_status::validated /* we previously validated these blocks*/, trx_lookup, true );
                   head = *ritr;
                }
                throw *except;
@@ -2161,18 +2705,23 @@ struct controller_impl {
          applied_trxs = pending->extract_trx_metas();
          pending.reset();
          protocol_features.popped_blocks_to( head->block_num );
+         state_settled();
       }
       return applied_trxs;
    }
 
-   checksum256_type calculate_action_merkle() {
-      vector<digest_type> action_digests;
-      const auto& actions = pending->_block_stage.get<building_block>()._actions;
-      action_digests.reserve( actions.size() );
-      for( const auto& a : actions )
-         action_digests.emplace_back( a.digest() );
-
-      return merkle( move(action_digests) );
+   /**
+    * Add the receipts and actions added to the pending block since the last call to its merkles, which give the same
+    * roots as merkle() over all of them. This spreads the hashing of the merkles over the block instead of doing it
+    * all in finalize_block.
+    */
+   static void update_pending_merkles( building_block& bb ) {
+      if( !bb._transaction_mroot ) { // otherwise given by the block being applied
+         for( auto i = bb._trx_merkle._node_count; i < bb._pending_trx_receipts.size(); ++i )
+            bb._trx_merkle.append( bb._pending_trx_receipts[i].digest() );
+      }
+      for( auto i = bb._action_merkle._node_count; i < bb._actions.size(); ++i )
+         bb._action_merkle.append( bb._actions[i].digest() );
    }
 
    static checksum256_type calculate_trx_merkle( const vector<transaction_receipt>& trxs ) {
@@ -2185,7 +2734,7 @@ struct controller_impl {
    }
 
    void update_producers_authority() {
-      const auto& producers = pending->get_pending_block_header_state().active_schedule.producers;
+      const auto& producers = pending->get_pending_block_header_state().active_schedule->producers;
 
       auto update_permission = [&]( auto& permission, auto threshold ) {
          auto auth = authority( threshold, {}, {});
@@ -2257,8 +2806,13 @@ struct controller_impl {
          const auto& whitelist = conf.actor_whitelist;
          bool is_subset = true;
 
+         // an actor the filter does not contain is not on the whitelist
+         const bool may_be_subset = std::all_of( actors.begin(), actors.end(), [this]( const account_name& actor ) {
+            return actor_whitelist_filter.may_contain( actor.to_uint64_t() );
+         });
+
          // quick extents check, then brute force the check actors
-         if (*actors.cbegin() >= *whitelist.cbegin() && *actors.crbegin() <= *whitelist.crbegin() ) {
+         if (may_be_subset && *actors.cbegin() >= *whitelist.cbegin() && *actors.crbegin() <= *whitelist.crbegin() ) {
             auto lower_bound = whitelist.cbegin();
             for (const auto& actor: actors) {
                lower_bound = std::lower_bound(lower_bound, whitelist.cend(), actor);
@@ -2296,8 +2850,13 @@ struct controller_impl {
          const auto& blacklist = conf.actor_blacklist;
          bool intersects = false;
 
+         // actors the filter does not contain are not on the blacklist
+         const bool may_intersect = std::any_of( actors.begin(), actors.end(), [this]( const account_name& actor ) {
+            return actor_blacklist_filter.may_contain( actor.to_uint64_t() );
+         });
+
          // quick extents check then brute force check actors
-         if( *actors.cbegin() <= *blacklist.crbegin() && *actors.crbegin() >= *blacklist.cbegin() ) {
+         if( may_intersect && *actors.cbegin() <= *blacklist.crbegin() && *actors.crbegin() >= *blacklist.cbegin() ) {
             auto lower_bound = blacklist.cbegin();
             for (const auto& actor: actors) {
                lower_bound = std::lower_bound(lower_bound, blacklist.cend(), actor);
@@ -2334,13 +2893,26 @@ struct controller_impl {
       }
    }
 
+   /// to be called whenever a whitelist or blacklist of conf changes
+   void reset_list_filters() {
+      auto name_value = []( const account_name& n ) { return n.to_uint64_t(); };
+      actor_whitelist_filter.reset( conf.actor_whitelist, name_value );
+      actor_blacklist_filter.reset( conf.actor_blacklist, name_value );
+      contract_whitelist_filter.reset( conf.contract_whitelist, name_value );
+      contract_blacklist_filter.reset( conf.contract_blacklist, name_value );
+      action_blacklist_filter.reset( conf.action_blacklist, []( const pair<account_name, action_name>& a ) {
+         return list_prefilter::action_value( a.first, a.second );
+      });
+   }
+
    void check_contract_list( account_name code )const {
       if( conf.contract_whitelist.size() > 0 ) {
-         EOS_ASSERT( conf.contract_whitelist.find( code ) != conf.contract_whitelist.end(),
+         EOS_ASSERT( contract_whitelist_filter.may_contain( code.to_uint64_t() ) &&
+                     conf.contract_whitelist.find( code ) != conf.contract_whitelist.end(),
                      contract_whitelist_exception,
                      "account '${code}' is not on the contract whitelist", ("code", code)
                    );
-      } else if( conf.contract_blacklist.size() > 0 ) {
+      } else if( contract_blacklist_filter.may_contain( code.to_uint64_t() ) ) {
          EOS_ASSERT( conf.contract_blacklist.find( code ) == conf.contract_blacklist.end(),
                      contract_blacklist_exception,
                      "account '${code}' is on the contract blacklist", ("code", code)
@@ -2349,7 +2921,7 @@ struct controller_impl {
    }
 
    void check_action_list( account_name code, action_name action )const {
-      if( conf.action_blacklist.size() > 0 ) {
+      if( action_blacklist_filter.may_contain( list_prefilter::action_value( code, action ) ) ) {
          EOS_ASSERT( conf.action_blacklist.find( std::make_pair(code, action) ) == conf.action_blacklist.end(),
                      action_blacklist_exception,
                      "action '${code}::${action}' is on the action blacklist",
@@ -2420,6 +2992,15 @@ resource_limits_manager&         controller::get_mutable_resource_limits_manager
    return my->resource_limits;
 }
 
+const contract_usage_profiler&   controller::get_contract_usage_profiler()const
+{
+   return my->usage_profiler;
+}
+contract_usage_profiler&         controller::get_mutable_contract_usage_profiler()
+{
+   return my->usage_profiler;
+}
+
 const authorization_manager&   controller::get_authorization_manager()const
 {
    return my->authorization;
@@ -2666,7 +3247,6 @@ block_state_ptr controller::finalize_block( const signer_callback_type& signer_c
 
 void controller::commit_block() {
    validate_db_available_size();
-   validate_reversible_available_size();
    my->commit_block(true);
 }
 
@@ -2674,8 +3254,12 @@ vector<transaction_metadata_ptr> controller::abort_block() {
    return my->abort_block();
 }
 
-boost::asio::io_context& controller::get_thread_pool() {
-   return my->thread_pool.get_executor();
+work_stealing_pool& controller::get_thread_pool() {
+   return my->thread_pool;
+}
+
+void controller::start_block_recover_keys( const signed_block_ptr& b ) {
+   my->start_block_recover_keys( b );
 }
 
 std::future<block_state_ptr> controller::create_block_state_future( const signed_block_ptr& b ) {
@@ -2686,7 +3270,6 @@ void controller::push_block( std::future<block_state_ptr>& block_state_future,
                              const forked_branch_callback& forked_branch_cb, const trx_meta_cache_lookup& trx_lookup )
 {
    validate_db_available_size();
-   validate_reversible_available_size();
    my->push_block( block_state_future, forked_branch_cb, trx_lookup );
 }
 
@@ -2728,15 +3311,19 @@ const flat_set<public_key_type>& controller::get_key_blacklist() const {
 
 void controller::set_actor_whitelist( const flat_set<account_name>& new_actor_whitelist ) {
    my->conf.actor_whitelist = new_actor_whitelist;
+   my->reset_list_filters();
 }
 void controller::set_actor_blacklist( const flat_set<account_name>& new_actor_blacklist ) {
    my->conf.actor_blacklist = new_actor_blacklist;
+   my->reset_list_filters();
 }
 void controller::set_contract_whitelist( const flat_set<account_name>& new_contract_whitelist ) {
    my->conf.contract_whitelist = new_contract_whitelist;
+   my->reset_list_filters();
 }
 void controller::set_contract_blacklist( const flat_set<account_name>& new_contract_blacklist ) {
    my->conf.contract_blacklist = new_contract_blacklist;
+   my->reset_list_filters();
 }
 void controller::set_action_blacklist( const flat_set< pair<account_name, action_name> >& new_action_blacklist ) {
    for (auto& act: new_action_blacklist) {
@@ -2744,6 +3331,7 @@ void controller::set_action_blacklist( const flat_set< pair<account_name, action
       EOS_ASSERT(act.second != action_name(), action_type_exception, "Action blacklist - action name should not be empty");
    }
    my->conf.action_blacklist = new_action_blacklist;
+   my->reset_list_filters();
 }
 void controller::set_key_blacklist( const flat_set<public_key_type>& new_key_blacklist ) {
    my->conf.key_blacklist = new_key_blacklist;
@@ -2873,19 +3461,24 @@ signed_block_ptr controller::fetch_block_by_number( uint32_t block_num )const  {
       return blk_state->block;
    }
 
+   std::lock_guard<std::mutex> g( my->blog_read_mtx );
    return my->blog.read_block_by_num(block_num);
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
+packed_block_view controller::fetch_packed_block_by_number( uint32_t block_num )const  { try {
+   std::lock_guard<std::mutex> g( my->blog_read_mtx );
+   return my->blog.read_packed_block_by_num(block_num);
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
 block_state_ptr controller::fetch_block_state_by_id( block_id_type id )const {
    auto state = my->fork_db.get_block(id);
    return state;
 }
 
 block_state_ptr controller::fetch_block_state_by_number( uint32_t block_num )const  { try {
-   const auto& rev_blocks = my->reversible_blocks.get_index<reversible_block_index,by_num>();
-   auto objitr = rev_blocks.find(block_num);
+   auto rev_id = my->reversible_blocks.get_block_id(block_num);
 
-   if( objitr == rev_blocks.end() ) {
+   if( !rev_id ) {
       if( my->read_mode == db_read_mode::IRREVERSIBLE ) {
          return my->fork_db.search_on_branch( my->fork_db.pending_head()->id, block_num );
       } else {
@@ -2893,7 +3486,7 @@ block_state_ptr controller::fetch_block_state_by_number( uint32_t block_num )con
       }
    }
 
-   return my->fork_db.get_block( objitr->get_block_id() );
+   return my->fork_db.get_block( *rev_id );
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
 block_id_type controller::get_block_id_for_num( uint32_t block_num )const { try {
@@ -2908,10 +3501,9 @@ block_id_type controller::get_block_id_for_num( uint32_t block_num )const { try
 
    if( !find_in_blog ) {
       if( my->read_mode != db_read_mode::IRREVERSIBLE ) {
-         const auto& rev_blocks = my->reversible_blocks.get_index<reversible_block_index,by_num>();
-         auto objitr = rev_blocks.find(block_num);
-         if( objitr != rev_blocks.end() ) {
-            return objitr->get_block_id();
+         auto rev_id = my->reversible_blocks.get_block_id(block_num);
+         if( rev_id ) {
+            return *rev_id;
          }
       } else {
          auto bsp = my->fork_db.search_on_branch( my->fork_db.pending_head()->id, block_num );
@@ -2920,7 +3512,11 @@ block_id_type controller::get_block_id_for_num( uint32_t block_num )const { try
       }
    }
 
-   auto id = my->blog.read_block_id_by_num(block_num);
+   block_id_type id;
+   {
+      std::lock_guard<std::mutex> g( my->blog_read_mtx );
+      id = my->blog.read_block_id_by_num(block_num);
+   }
 
    EOS_ASSERT( BOOST_LIKELY( id != block_id_type() ), unknown_block_exception,
                "Could not find block: ${block}", ("block", block_num) );
@@ -3077,6 +3673,32 @@ bool controller::contracts_console()const {
    return my->conf.contracts_console;
 }
 
+bool controller::trace_row_accesses()const {
+   return my->conf.trace_row_accesses;
+}
+
+void controller::add_trace_consumer() {
+   ++my->trace_consumers;
+}
+
+void controller::remove_trace_consumer() {
+   EOS_ASSERT( my->trace_consumers > 0, misc_exception, "no trace consumer to remove" );
+   --my->trace_consumers;
+}
+
+bool controller::records_state_access()const {
+   return my->db_memory.records_access();
+}
+
+void controller::record_state_access( account_name contract, const std::vector<const void*>& objects ) {
+   my->db_memory.record_access( contract, objects );
+}
+
+bool controller::full_traces()const {
+   // transactions of a block being built may be answered with their trace, e.g. by push_transaction
+   return my->trace_consumers > 0 || is_producing_block();
+}
+
 chain_id_type controller::get_chain_id()const {
    return my->chain_id;
 }
@@ -3102,6 +3724,9 @@ const apply_handler* controller::find_apply_handler( account_name receiver, acco
 wasm_interface& controller::get_wasm_interface() {
    return my->wasmif;
 }
+const wasm_interface& controller::get_wasm_interface()const {
+   return my->wasmif;
+}
 
 const account_object& controller::get_account( account_name name )const
 { try {
@@ -3177,12 +3802,6 @@ void controller::validate_db_available_size() const {
    EOS_ASSERT(free >= guard, database_guard_exception, "database free: ${f}, guard size: ${g}", ("f", free)("g",guard));
 }
 
-void controller::validate_reversible_available_size() const {
-   const auto free = my->reversible_blocks.get_segment_manager()->get_free_memory();
-   const auto guard = my->conf.reversible_guard_size;
-   EOS_ASSERT(free >= guard, reversible_guard_exception, "reversible free: ${f}, guard size: ${g}", ("f", free)("g",guard));
-}
-
 bool controller::is_protocol_feature_activated( const digest_type& feature_digest )const {
    if( my->pending )
       return my->pending->is_protocol_feature_activated( feature_digest );
@@ -3192,13 +3811,8 @@ bool controller::is_protocol_feature_activated( const digest_type& feature_diges
 }
 
 bool controller::is_builtin_activated( builtin_protocol_feature_t f )const {
-   uint32_t current_block_num = head_block_num();
-
-   if( my->pending ) {
-      ++current_block_num;
-   }
-
-   return my->protocol_features.is_builtin_activated( f, current_block_num );
+   // the features of the pending block are rolled back with it, so the activated set is that of the current block
+   return my->protocol_features.is_builtin_activated( f );
 }
 
 bool controller::is_known_unexpired_transaction( const transaction_id_type& id) const {
@@ -3336,6 +3950,36 @@ void controller_impl::on_activation<builtin_protocol_feature_t::get_sender>() {
    } );
 }
 
+template<>
+void controller_impl::on_activation<builtin_protocol_feature_t::batched_db_reads>() {
+   db.modify( db.get<protocol_state_object>(), [&]( auto& ps ) {
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "db_get_range_i64" );
+   } );
+}
+
+template<>
+void controller_impl::on_activation<builtin_protocol_feature_t::kv_database>() {
+   db.modify( db.get<protocol_state_object>(), [&]( auto& ps ) {
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_set" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_erase" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_get" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_it_create" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_it_destroy" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_it_lower_bound" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_it_next" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_it_prev" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_it_key" );
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "kv_it_value" );
+   } );
+}
+
+template<>
+void controller_impl::on_activation<builtin_protocol_feature_t::sha256_batch>() {
+   db.modify( db.get<protocol_state_object>(), [&]( auto& ps ) {
+      add_intrinsic_to_whitelist( ps.whitelisted_intrinsics, "sha256_batch" );
+   } );
+}
+
 template<>
 void controller_impl::on_activation<builtin_protocol_feature_t::replace_deferred>() {
    const auto& indx = db.get_index<account_ram_correction_index, by_id>();
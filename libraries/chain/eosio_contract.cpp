@@ -374,6 +374,8 @@ void apply_eosio_linkauth(apply_context& context) {
          );
       }
 
+      context.control.get_mutable_authorization_manager().permission_links_changed();
+
   } FC_CAPTURE_AND_RETHROW((requirement))
 }
 
@@ -394,6 +396,7 @@ void apply_eosio_unlinkauth(apply_context& context) {
    );
 
    db.remove(*link);
+   context.control.get_mutable_authorization_manager().permission_links_changed();
 }
 
 void apply_eosio_canceldelay(apply_context& context) {
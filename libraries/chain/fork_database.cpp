@@ -70,12 +70,19 @@ namespace eosio { namespace chain {
       block_state_ptr       root; // Only uses the block_header_state portion
       block_state_ptr       head;
       fc::path              datadir;
+      bool                  restored_from_checkpoint = false;
 
       void add( const block_state_ptr& n,
                 bool ignore_duplicate, bool validate,
                 const std::function<void( block_timestamp_type,
                                           const flat_set<digest_type>&,
                                           const vector<digest_type>& )>& validator );
+
+      void read( const fc::path& filename,
+                 const std::function<void( block_timestamp_type,
+                                           const flat_set<digest_type>&,
+                                           const vector<digest_type>& )>& validator );
+      void write( const fc::path& filename )const;
    };
 
 
@@ -92,74 +99,23 @@ namespace eosio { namespace chain {
          fc::create_directories(my->datadir);
 
       auto fork_db_dat = my->datadir / config::forkdb_filename;
+      auto checkpoint_dat = my->datadir / config::forkdb_checkpoint_filename;
       if( fc::exists( fork_db_dat ) ) {
-         try {
-            string content;
-            fc::read_file_contents( fork_db_dat, content );
-
-            fc::datastream<const char*> ds( content.data(), content.size() );
-
-            // validate totem
-            uint32_t totem = 0;
-            fc::raw::unpack( ds, totem );
-            EOS_ASSERT( totem == magic_number, fork_database_exception,
-                        "Fork database file '${filename}' has unexpected magic number: ${actual_totem}. Expected ${expected_totem}",
-                        ("filename", fork_db_dat.generic_string())
-                        ("actual_totem", totem)
-                        ("expected_totem", magic_number)
-            );
-
-            // validate version
-            uint32_t version = 0;
-            fc::raw::unpack( ds, version );
-            EOS_ASSERT( version >= min_supported_version && version <= max_supported_version,
-                        fork_database_exception,
-                       "Unsupported version of fork database file '${filename}'. "
-                       "Fork database version is ${version} while code supports version(s) [${min},${max}]",
-                       ("filename", fork_db_dat.generic_string())
-                       ("version", version)
-                       ("min", min_supported_version)
-                       ("max", max_supported_version)
-            );
-
-            block_header_state bhs;
-            fc::raw::unpack( ds, bhs );
-            reset( bhs );
-
-            unsigned_int size; fc::raw::unpack( ds, size );
-            for( uint32_t i = 0, n = size.value; i < n; ++i ) {
-               block_state s;
-               fc::raw::unpack( ds, s );
-               // do not populate transaction_metadatas, they will be created as needed in apply_block with appropriate key recovery
-               s.header_exts = s.block->validate_and_extract_header_extensions();
-               my->add( std::make_shared<block_state>( move( s ) ), false, true, validator );
-            }
-            block_id_type head_id;
-            fc::raw::unpack( ds, head_id );
-
-            if( my->root->id == head_id ) {
-               my->head = my->root;
-            } else {
-               my->head = get_block( head_id );
-               EOS_ASSERT( my->head, fork_database_exception,
-                           "could not find head while reconstructing fork database from file; '${filename}' is likely corrupted",
-                           ("filename", fork_db_dat.generic_string()) );
-            }
-
-            auto candidate = my->index.get<by_lib_block_num>().begin();
-            if( candidate == my->index.get<by_lib_block_num>().end() || !(*candidate)->is_valid() ) {
-               EOS_ASSERT( my->head->id == my->root->id, fork_database_exception,
-                           "head not set to root despite no better option available; '${filename}' is likely corrupted",
-                           ("filename", fork_db_dat.generic_string()) );
-            } else {
-               EOS_ASSERT( !first_preferred( **candidate, *my->head ), fork_database_exception,
-                           "head not set to best available option available; '${filename}' is likely corrupted",
-                           ("filename", fork_db_dat.generic_string()) );
-            }
-         } FC_CAPTURE_AND_RETHROW( (fork_db_dat) )
-
+         my->read( fork_db_dat, validator );
          fc::remove( fork_db_dat );
+      } else if( fc::exists( checkpoint_dat ) ) {
+         // written while running, so the chain state may not have reached any of the blocks marked as validated
+         my->read( checkpoint_dat, validator );
+         rollback_head_to_root();
+         my->restored_from_checkpoint = true;
+         wlog( "restored fork database from checkpoint '${filename}' with root ${root}",
+               ("filename", checkpoint_dat.generic_string())("root", my->root->block_num) );
       }
+      fc::remove( checkpoint_dat );
+   }
+
+   bool fork_database::restored_from_checkpoint()const {
+      return my->restored_from_checkpoint;
    }
 
    void fork_database::close() {
@@ -173,14 +129,92 @@ namespace eosio { namespace chain {
          return;
       }
 
-      std::ofstream out( fork_db_dat.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
-      fc::raw::pack( out, magic_number );
-      fc::raw::pack( out, max_supported_version ); // write out current version which is always max_supported_version
-      fc::raw::pack( out, *static_cast<block_header_state*>(&*my->root) );
-      uint32_t num_blocks_in_fork_db = my->index.size();
+      my->write( fork_db_dat );
+      fc::remove( my->datadir / config::forkdb_checkpoint_filename );
+
+      my->index.clear();
+   }
+
+   void fork_database_impl::read( const fc::path& filename,
+                                  const std::function<void( block_timestamp_type,
+                                                            const flat_set<digest_type>&,
+                                                            const vector<digest_type>& )>& validator )
+   {
+      try {
+         string content;
+         fc::read_file_contents( filename, content );
+
+         fc::datastream<const char*> ds( content.data(), content.size() );
+
+         // validate totem
+         uint32_t totem = 0;
+         fc::raw::unpack( ds, totem );
+         EOS_ASSERT( totem == fork_database::magic_number, fork_database_exception,
+                     "Fork database file '${filename}' has unexpected magic number: ${actual_totem}. Expected ${expected_totem}",
+                     ("filename", filename.generic_string())
+                     ("actual_totem", totem)
+                     ("expected_totem", fork_database::magic_number)
+         );
+
+         // validate version
+         uint32_t version = 0;
+         fc::raw::unpack( ds, version );
+         EOS_ASSERT( version >= fork_database::min_supported_version && version <= fork_database::max_supported_version,
+                     fork_database_exception,
+                    "Unsupported version of fork database file '${filename}'. "
+                    "Fork database version is ${version} while code supports version(s) [${min},${max}]",
+                    ("filename", filename.generic_string())
+                    ("version", version)
+                    ("min", fork_database::min_supported_version)
+                    ("max", fork_database::max_supported_version)
+         );
+
+         block_header_state bhs;
+         fc::raw::unpack( ds, bhs );
+         self.reset( bhs );
+
+         unsigned_int size; fc::raw::unpack( ds, size );
+         for( uint32_t i = 0, n = size.value; i < n; ++i ) {
+            block_state s;
+            fc::raw::unpack( ds, s );
+            // do not populate transaction_metadatas, they will be created as needed in apply_block with appropriate key recovery
+            s.header_exts = s.block->validate_and_extract_header_extensions();
+            add( std::make_shared<block_state>( move( s ) ), false, true, validator );
+         }
+         block_id_type head_id;
+         fc::raw::unpack( ds, head_id );
+
+         if( root->id == head_id ) {
+            head = root;
+         } else {
+            head = self.get_block( head_id );
+            EOS_ASSERT( head, fork_database_exception,
+                        "could not find head while reconstructing fork database from file; '${filename}' is likely corrupted",
+                        ("filename", filename.generic_string()) );
+         }
+
+         auto candidate = index.get<by_lib_block_num>().begin();
+         if( candidate == index.get<by_lib_block_num>().end() || !(*candidate)->is_valid() ) {
+            EOS_ASSERT( head->id == root->id, fork_database_exception,
+                        "head not set to root despite no better option available; '${filename}' is likely corrupted",
+                        ("filename", filename.generic_string()) );
+         } else {
+            EOS_ASSERT( !first_preferred( **candidate, *head ), fork_database_exception,
+                        "head not set to best available option available; '${filename}' is likely corrupted",
+                        ("filename", filename.generic_string()) );
+         }
+      } FC_CAPTURE_AND_RETHROW( (filename) )
+   }
+
+   void fork_database_impl::write( const fc::path& filename )const {
+      std::ofstream out( filename.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
+      fc::raw::pack( out, fork_database::magic_number );
+      fc::raw::pack( out, fork_database::max_supported_version ); // write out current version which is always max_supported_version
+      fc::raw::pack( out, *static_cast<block_header_state*>(&*root) );
+      uint32_t num_blocks_in_fork_db = index.size();
       fc::raw::pack( out, unsigned_int{num_blocks_in_fork_db} );
 
-      const auto& indx = my->index.get<by_lib_block_num>();
+      const auto& indx = index.get<by_lib_block_num>();
 
       auto unvalidated_itr = indx.rbegin();
       auto unvalidated_end = boost::make_reverse_iterator( indx.lower_bound( false ) );
@@ -215,14 +249,21 @@ namespace eosio { namespace chain {
          fc::raw::pack( out, *(*itr) );
       }
 
-      if( my->head ) {
-         fc::raw::pack( out, my->head->id );
+      if( head ) {
+         fc::raw::pack( out, head->id );
       } else {
          elog( "head not set in fork database; '${filename}' will be corrupted",
-               ("filename", fork_db_dat.generic_string()) );
+               ("filename", filename.generic_string()) );
       }
+   }
 
-      my->index.clear();
+   void fork_database::checkpoint() {
+      if( !my->root ) return;
+
+      auto checkpoint_dat = my->datadir / config::forkdb_checkpoint_filename;
+      auto tmp_dat = my->datadir / (std::string(config::forkdb_checkpoint_filename) + ".tmp");
+      my->write( tmp_dat );
+      fc::rename( tmp_dat, checkpoint_dat );
    }
 
    fork_database::~fork_database() {
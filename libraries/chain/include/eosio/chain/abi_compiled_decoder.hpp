@@ -0,0 +1,118 @@
+#pragma once
+#include <eosio/chain/abi_serializer.hpp>
+
+#include <limits>
+
+namespace eosio { namespace chain {
+
+/**
+ *  Decodes the binary representation of ABI types straight to JSON text, without building an fc::variant tree, or to
+ *  the fc::variant abi_serializer::binary_to_variant returns, without resolving the types of every value again.
+ *
+ *  All types known to an abi_serializer are compiled once, on construction, into a flat table of nodes: typedefs are
+ *  resolved, struct field keys are escaped up front and every built-in type is mapped to an opcode. Decoding then only
+ *  walks the table by index. The output is identical to fc::json::to_string of abi_serializer::binary_to_variant, and
+ *  the yield function is called with the same recursion depth so the recursion and deadline limits still apply.
+ *
+ *  The same table encodes JSON text to binary, see from_json.
+ *
+ *  The decoder does not reference the abi_serializer after construction and decoding and encoding are thread safe.
+ */
+class abi_compiled_decoder {
+public:
+   using type_id = uint32_t;
+   static constexpr type_id invalid_type = std::numeric_limits<type_id>::max();
+
+   explicit abi_compiled_decoder( const abi_serializer& abis );
+
+   /// @return id of type, invalid_type if the type is not part of the ABI
+   type_id find_type( const std::string_view& type )const;
+
+   /// append the JSON of one value of type t read from ds to out
+   void to_json( type_id t, fc::datastream<const char*>& ds, std::string& out, const abi_serializer::yield_function_t& yield )const;
+   void to_json( const std::string_view& type, fc::datastream<const char*>& ds, std::string& out, const abi_serializer::yield_function_t& yield )const;
+   std::string to_json( const std::string_view& type, const bytes& binary, const abi_serializer::yield_function_t& yield )const;
+   /// to_json of a value nested in a larger one, such as the data of an action, continuing the recursion depth of ctx
+   std::string to_json( type_id t, const bytes& binary, const impl::abi_traverse_context& ctx )const;
+
+   /// the same fc::variant as abi_serializer::binary_to_variant of one value of type t read from ds
+   fc::variant to_variant( type_id t, fc::datastream<const char*>& ds, const abi_serializer::yield_function_t& yield )const;
+   fc::variant to_variant( const std::string_view& type, const bytes& binary, const abi_serializer::yield_function_t& yield )const;
+   /// to_variant of a value nested in a larger one, such as the data of an action, continuing the recursion depth of ctx
+   fc::variant to_variant( const std::string_view& type, const bytes& binary, const impl::abi_traverse_context& ctx )const;
+   fc::variant to_variant( type_id t, const bytes& binary, const impl::abi_traverse_context& ctx )const;
+
+   /**
+    * Encode the JSON text of one value of type, without parsing it to an fc::variant first. The binary is the same as
+    * abi_serializer::variant_to_binary of fc::json::from_string( json ).
+    *
+    * Only plain JSON is taken: strings without escapes or non ASCII characters, integers without fraction or exponent
+    * and no duplicate keys. Other input, valid or not, throws pack_exception, input variant_to_binary rejects throws
+    * too, and callers are expected to fall back on variant_to_binary, which then reports the error if there is one.
+    * Built-in types without an opcode are still converted through the serializer's pack function.
+    */
+   bytes from_json( const std::string_view& type, const std::string_view& json, const abi_serializer::yield_function_t& yield )const;
+
+   /**
+    * Split the JSON text of an object into its keys and the JSON text of their values, without parsing the values
+    * further than needed to find where they end. Takes the same plain JSON as from_json.
+    *
+    * @return false if json is not such an object
+    */
+   static bool split_json_object( const std::string_view& json, std::vector<std::pair<std::string_view, std::string_view>>& members );
+
+private:
+   enum class opcode : uint8_t {
+      boolean, int8, uint8, int16, uint16, int32, uint32, int64, uint64, varint32, varuint32,
+      name, string, bytes, checksum160, checksum256, checksum512, asset,
+      generic_builtin, ///< any other built-in type, decoded to JSON through its abi_serializer unpack function
+      array, optional, variant, structure
+   };
+
+   struct field {
+      std::string  key;         ///< escaped and quoted field name followed by ':'
+      std::string  name;
+      type_id      type = invalid_type;
+      bool         extension = false;
+   };
+
+   struct alternative {
+      std::string  name;        ///< type name as written in the ABI
+      std::string  quoted_name; ///< escaped and quoted name
+      type_id      type = invalid_type;
+   };
+
+   struct node {
+      opcode                           op = opcode::generic_builtin;
+      std::string                      name;
+      type_id                          elem = invalid_type;   ///< array and optional
+      type_id                          base = invalid_type;   ///< structure
+      std::vector<field>               fields;                ///< structure
+      std::vector<alternative>         alternatives;          ///< variant
+      abi_serializer::unpack_function  unpack;                ///< built-in types
+      abi_serializer::pack_function    pack;                  ///< generic_builtin
+   };
+
+   struct decode_context;
+   struct json_reader;
+
+   type_id compile( const abi_serializer& abis, const std::string_view& type );
+
+   /// @return true if null was written
+   bool decode( type_id t, fc::datastream<const char*>& ds, std::string& out, decode_context& ctx )const;
+   void decode_builtin( const node& n, fc::datastream<const char*>& ds, std::string& out, decode_context& ctx )const;
+   void decode_fields( const node& n, fc::datastream<const char*>& ds, std::string& out, size_t& num_fields, decode_context& ctx )const;
+
+   fc::variant decode_variant( type_id t, fc::datastream<const char*>& ds, decode_context& ctx )const;
+   void decode_fields( const node& n, fc::datastream<const char*>& ds, fc::mutable_variant_object& obj, decode_context& ctx )const;
+
+   void encode( type_id t, json_reader& in, fc::datastream<char*>& ds, bool allow_extensions, decode_context& ctx )const;
+   void encode_builtin( const node& n, json_reader& in, fc::datastream<char*>& ds, decode_context& ctx )const;
+   void encode_fields( const node& n, const std::vector<std::pair<std::string_view, std::string_view>>& members,
+                       fc::datastream<char*>& ds, bool allow_extensions, decode_context& ctx )const;
+
+   std::vector<node>                            nodes;
+   std::map<std::string, type_id, std::less<>>  type_ids;
+};
+
+} } // eosio::chain
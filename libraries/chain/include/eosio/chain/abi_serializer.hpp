@@ -2,6 +2,7 @@
 #include <eosio/chain/abi_def.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <type_traits>
 #include <utility>
 #include <fc/variant_object.hpp>
 #include <fc/scoped_exit.hpp>
@@ -160,6 +161,7 @@ private:
    friend struct impl::abi_from_variant;
    friend struct impl::abi_to_variant;
    friend struct impl::abi_traverse_context_with_path;
+   friend class abi_compiled_decoder;
 };
 
 namespace impl {
@@ -319,6 +321,18 @@ namespace impl {
    template<typename T>
    using require_abi_t = std::enable_if_t<type_requires_abi_v<T>(), int>;
 
+   /// resolved ABIs which have a compiled() abi_compiled_decoder, such as those of the chain_plugin abi_serializer_cache
+   template<typename Resolved, typename = void>
+   struct has_compiled_decoder : std::false_type {};
+   template<typename Resolved>
+   struct has_compiled_decoder<Resolved, std::void_t<decltype( std::declval<const Resolved&>().compiled() )>> : std::true_type {};
+
+   /// resolved ABIs which also have a splicer() taking the JSON text of the action data in place of its variant
+   template<typename Resolved, typename = void>
+   struct has_json_splicer : std::false_type {};
+   template<typename Resolved>
+   struct has_json_splicer<Resolved, std::void_t<decltype( std::declval<const Resolved&>().splicer() )>> : std::true_type {};
+
    struct abi_to_variant {
       /**
        * template which overloads add for types which are not relvant to ABI information
@@ -425,7 +439,7 @@ namespace impl {
                   try {
                      binary_to_variant_context _ctx(*abi, ctx, type);
                      _ctx.short_path = true; // Just to be safe while avoiding the complexity of threading an override boolean all over the place
-                     mvo( "data", abi->_binary_to_variant( type, act.data, _ctx ));
+                     mvo( "data", action_data_to_variant( abi, type, act.data, _ctx ));
                      mvo("hex_data", act.data);
                   } catch(...) {
                      // any failure to serialize data, then leave as not serailzed
@@ -443,6 +457,29 @@ namespace impl {
          out(name, std::move(mvo));
       }
 
+      /**
+       * the action data decoded by the compiled decoder of abi when it has one for type, which gives the same variant,
+       * or straight to JSON text kept by the splicer of abi when it has one
+       */
+      template<typename Resolved>
+      static fc::variant action_data_to_variant( const Resolved& abi, const std::string_view& type, const bytes& data, binary_to_variant_context& ctx )
+      {
+         if constexpr( has_compiled_decoder<Resolved>::value ) {
+            if( const auto* compiled = abi.compiled() ) {
+               const auto t = compiled->find_type( type );
+               if( t != std::decay_t<decltype(*compiled)>::invalid_type ) {
+                  if constexpr( has_json_splicer<Resolved>::value ) {
+                     if( auto* splicer = abi.splicer() ) {
+                        return splicer->add( compiled->to_json( t, data, ctx ) );
+                     }
+                  }
+                  return compiled->to_variant( t, data, ctx );
+               }
+            }
+         }
+         return abi->_binary_to_variant( type, data, ctx );
+      }
+
       /**
        * overload of to_variant_object for packed_transaction
        *
@@ -35,11 +35,12 @@ namespace eosio { namespace chain {
    using account_id_type = account_object::id_type;
 
    struct by_name;
+   /// accounts are only looked up by name, never iterated in name order
    using account_index = chainbase::shared_multi_index_container<
       account_object,
       indexed_by<
          ordered_unique<tag<by_id>, member<account_object, account_object::id_type, &account_object::id>>,
-         ordered_unique<tag<by_name>, member<account_object, account_name, &account_object::name>>
+         hashed_unique<tag<by_name>, member<account_object, account_name, &account_object::name>, std::hash<account_name>>
       >
    >;
 
@@ -71,11 +72,12 @@ namespace eosio { namespace chain {
    };
 
    struct by_name;
+   /// looked up by name only, like account_index
    using account_metadata_index = chainbase::shared_multi_index_container<
       account_metadata_object,
       indexed_by<
          ordered_unique<tag<by_id>, member<account_metadata_object, account_metadata_object::id_type, &account_metadata_object::id>>,
-         ordered_unique<tag<by_name>, member<account_metadata_object, account_name, &account_metadata_object::name>>
+         hashed_unique<tag<by_name>, member<account_metadata_object, account_name, &account_metadata_object::name>, std::hash<account_name>>
       >
    >;
 
@@ -97,3 +97,52 @@ namespace eosio { namespace chain {
 
 FC_REFLECT( eosio::chain::permission_level, (actor)(permission) )
 FC_REFLECT( eosio::chain::action, (account)(name)(authorization)(data) )
+
+namespace fc { namespace raw {
+
+   // A permission_level is packed as its two names, each a host order uint64, which is how it is laid out in memory.
+   // Packing and unpacking it, and the authorization vectors of actions, are therefore single copies on the streams
+   // blocks, transactions and traces go through, rather than a reflection visit per name.
+   static_assert( sizeof(eosio::chain::permission_level) == 2 * sizeof(uint64_t) &&
+                  std::is_trivially_copyable<eosio::chain::permission_level>::value,
+                  "permission_level is expected to be laid out as it is packed" );
+
+   template<>
+   inline void pack( datastream<char*>& s, const eosio::chain::permission_level& p ) {
+      s.write( reinterpret_cast<const char*>(&p), sizeof(p) );
+   }
+
+   template<>
+   inline void pack( datastream<size_t>& s, const eosio::chain::permission_level& p ) {
+      s.skip( sizeof(p) );
+   }
+
+   template<>
+   inline void unpack( datastream<const char*>& s, eosio::chain::permission_level& p ) {
+      s.read( reinterpret_cast<char*>(&p), sizeof(p) );
+   }
+
+   template<>
+   inline void pack( datastream<char*>& s, const std::vector<eosio::chain::permission_level>& v ) {
+      fc::raw::pack( s, unsigned_int( (uint32_t)v.size() ) );
+      s.write( reinterpret_cast<const char*>(v.data()), v.size() * sizeof(eosio::chain::permission_level) );
+   }
+
+   template<>
+   inline void pack( datastream<size_t>& s, const std::vector<eosio::chain::permission_level>& v ) {
+      fc::raw::pack( s, unsigned_int( (uint32_t)v.size() ) );
+      s.skip( v.size() * sizeof(eosio::chain::permission_level) );
+   }
+
+   template<>
+   inline void unpack( datastream<const char*>& s, std::vector<eosio::chain::permission_level>& v ) {
+      unsigned_int size;
+      fc::raw::unpack( s, size );
+      // checked before resizing, so that a size read from the stream does not allocate more than the stream holds
+      FC_ASSERT( size.value <= s.remaining() / sizeof(eosio::chain::permission_level),
+                 "permission_level vector larger than the data left in the stream" );
+      v.resize( size.value );
+      s.read( reinterpret_cast<char*>(v.data()), v.size() * sizeof(eosio::chain::permission_level) );
+   }
+
+} } // fc::raw
@@ -2,6 +2,7 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/transaction.hpp>
 #include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/transaction_arena.hpp>
 #include <fc/utility.hpp>
 #include <sstream>
 #include <algorithm>
@@ -19,7 +20,12 @@ class apply_context {
       template<typename T>
       class iterator_cache {
          public:
-            iterator_cache(){
+            explicit iterator_cache( transaction_arena& a )
+            :_table_cache(arena_allocator<char>(a))
+            ,_end_iterator_to_table(arena_allocator<char>(a))
+            ,_iterator_to_object(arena_allocator<char>(a))
+            ,_object_to_iterator(arena_allocator<char>(a))
+            {
                _end_iterator_to_table.reserve(8);
                _iterator_to_object.reserve(32);
             }
@@ -86,11 +92,21 @@ class apply_context {
                return _iterator_to_object.size() - 1;
             }
 
+            /// objects an iterator was handed out for, in iterator order
+            void append_objects( std::vector<const void*>& objects )const {
+               for( const T* o : _iterator_to_object ) {
+                  if( o ) objects.push_back( o );
+               }
+            }
+
          private:
-            map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
-            vector<const table_id_object*>                  _end_iterator_to_table;
-            vector<const T*>                                _iterator_to_object;
-            map<const T*,int>                               _object_to_iterator;
+            template<typename K, typename V>
+            using arena_map = std::map<K, V, std::less<K>, arena_allocator<std::pair<const K, V>>>;
+
+            arena_map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
+            arena_vector<const table_id_object*>            _end_iterator_to_table;
+            arena_vector<const T*>                          _iterator_to_object;
+            arena_map<const T*,int>                         _object_to_iterator;
 
             /// Precondition: std::numeric_limits<int>::min() < ei < -1
             /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
@@ -171,11 +187,12 @@ class apply_context {
 
             using secondary_key_helper_t = secondary_key_helper<secondary_key_type, secondary_key_proxy_type, secondary_key_proxy_const_type>;
 
-            generic_index( apply_context& c ):context(c){}
+            generic_index( apply_context& c ):context(c),itr_cache(c.arena){}
 
             int store( uint64_t scope, uint64_t table, const account_name& payer,
                        uint64_t id, secondary_key_proxy_const_type value )
             {
+               ++context._db_intrinsics;
                EOS_ASSERT( payer != account_name(), invalid_table_payer, "must specify a valid account to pay for new record" );
 
 //               context.require_write_lock( scope );
@@ -195,11 +212,14 @@ class apply_context {
 
                context.update_db_usage( payer, config::billable_size_v<ObjectType> );
 
+               context.record_row_access( tab, id, true );
+
                itr_cache.cache_table( tab );
                return itr_cache.add( obj );
             }
 
             void remove( int iterator ) {
+               ++context._db_intrinsics;
                const auto& obj = itr_cache.get( iterator );
                context.update_db_usage( obj.payer, -( config::billable_size_v<ObjectType> ) );
 
@@ -208,6 +228,8 @@ class apply_context {
 
 //               context.require_write_lock( table_obj.scope );
 
+               context.record_row_access( table_obj, obj.primary_key, true );
+
                context.db.modify( table_obj, [&]( auto& t ) {
                   --t.count;
                });
@@ -221,6 +243,7 @@ class apply_context {
             }
 
             void update( int iterator, account_name payer, secondary_key_proxy_const_type secondary ) {
+               ++context._db_intrinsics;
                const auto& obj = itr_cache.get( iterator );
 
                const auto& table_obj = itr_cache.get_table( obj.t_id );
@@ -228,6 +251,8 @@ class apply_context {
 
 //               context.require_write_lock( table_obj.scope );
 
+               context.record_row_access( table_obj, obj.primary_key, true );
+
                if( payer == account_name() ) payer = obj.payer;
 
                int64_t billing_size =  config::billable_size_v<ObjectType>;
@@ -244,6 +269,7 @@ class apply_context {
             }
 
             int find_secondary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_const_type secondary, uint64_t& primary ) {
+               ++context._db_intrinsics;
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -254,10 +280,11 @@ class apply_context {
 
                primary = obj->primary_key;
 
-               return itr_cache.add( *obj );
+               return add_read( *obj );
             }
 
             int lowerbound_secondary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_type secondary, uint64_t& primary ) {
+               ++context._db_intrinsics;
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -271,10 +298,11 @@ class apply_context {
                primary = itr->primary_key;
                secondary_key_helper_t::get(secondary, itr->secondary_key);
 
-               return itr_cache.add( *itr );
+               return add_read( *itr );
             }
 
             int upperbound_secondary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_type secondary, uint64_t& primary ) {
+               ++context._db_intrinsics;
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -288,10 +316,11 @@ class apply_context {
                primary = itr->primary_key;
                secondary_key_helper_t::get(secondary, itr->secondary_key);
 
-               return itr_cache.add( *itr );
+               return add_read( *itr );
             }
 
             int end_secondary( uint64_t code, uint64_t scope, uint64_t table ) {
+               ++context._db_intrinsics;
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -299,6 +328,7 @@ class apply_context {
             }
 
             int next_secondary( int iterator, uint64_t& primary ) {
+               ++context._db_intrinsics;
                if( iterator < -1 ) return -1; // cannot increment past end iterator of index
 
                const auto& obj = itr_cache.get(iterator); // Check for iterator != -1 happens in this call
@@ -310,10 +340,11 @@ class apply_context {
                if( itr == idx.end() || itr->t_id != obj.t_id ) return itr_cache.get_end_iterator_by_table_id(obj.t_id);
 
                primary = itr->primary_key;
-               return itr_cache.add(*itr);
+               return add_read( *itr );
             }
 
             int previous_secondary( int iterator, uint64_t& primary ) {
+               ++context._db_intrinsics;
                const auto& idx = context.db.get_index<typename chainbase::get_index_type<ObjectType>::type, by_secondary>();
 
                if( iterator < -1 ) // is end iterator
@@ -329,7 +360,7 @@ class apply_context {
                   if( itr->t_id != tab->id ) return -1; // Empty index
 
                   primary = itr->primary_key;
-                  return itr_cache.add(*itr);
+                  return add_read( *itr );
                }
 
                const auto& obj = itr_cache.get(iterator); // Check for iterator != -1 happens in this call
@@ -342,10 +373,11 @@ class apply_context {
                if( itr->t_id != obj.t_id ) return -1; // cannot decrement past beginning iterator of index
 
                primary = itr->primary_key;
-               return itr_cache.add(*itr);
+               return add_read( *itr );
             }
 
             int find_primary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_type secondary, uint64_t primary ) {
+               ++context._db_intrinsics;
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if( !tab ) return -1;
 
@@ -355,10 +387,11 @@ class apply_context {
                if( !obj ) return table_end_itr;
                secondary_key_helper_t::get(secondary, obj->secondary_key);
 
-               return itr_cache.add( *obj );
+               return add_read( *obj );
             }
 
             int lowerbound_primary( uint64_t code, uint64_t scope, uint64_t table, uint64_t primary ) {
+               ++context._db_intrinsics;
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if (!tab) return -1;
 
@@ -369,10 +402,11 @@ class apply_context {
                if (itr == idx.end()) return table_end_itr;
                if (itr->t_id != tab->id) return table_end_itr;
 
-               return itr_cache.add(*itr);
+               return add_read( *itr );
             }
 
             int upperbound_primary( uint64_t code, uint64_t scope, uint64_t table, uint64_t primary ) {
+               ++context._db_intrinsics;
                auto tab = context.find_table( name(code), name(scope), name(table) );
                if ( !tab ) return -1;
 
@@ -384,10 +418,11 @@ class apply_context {
                if (itr->t_id != tab->id) return table_end_itr;
 
                itr_cache.cache_table(*tab);
-               return itr_cache.add(*itr);
+               return add_read( *itr );
             }
 
             int next_primary( int iterator, uint64_t& primary ) {
+               ++context._db_intrinsics;
                if( iterator < -1 ) return -1; // cannot increment past end iterator of table
 
                const auto& obj = itr_cache.get(iterator); // Check for iterator != -1 happens in this call
@@ -399,10 +434,11 @@ class apply_context {
                if( itr == idx.end() || itr->t_id != obj.t_id ) return itr_cache.get_end_iterator_by_table_id(obj.t_id);
 
                primary = itr->primary_key;
-               return itr_cache.add(*itr);
+               return add_read( *itr );
             }
 
             int previous_primary( int iterator, uint64_t& primary ) {
+               ++context._db_intrinsics;
                const auto& idx = context.db.get_index<typename chainbase::get_index_type<ObjectType>::type, by_primary>();
 
                if( iterator < -1 ) // is end iterator
@@ -418,7 +454,7 @@ class apply_context {
                   if( itr->t_id != tab->id ) return -1; // Empty table
 
                   primary = itr->primary_key;
-                  return itr_cache.add(*itr);
+                  return add_read( *itr );
                }
 
                const auto& obj = itr_cache.get(iterator); // Check for iterator != -1 happens in this call
@@ -431,16 +467,25 @@ class apply_context {
                if( itr->t_id != obj.t_id ) return -1; // cannot decrement past beginning iterator of index
 
                primary = itr->primary_key;
-               return itr_cache.add(*itr);
+               return add_read( *itr );
             }
 
             void get( int iterator, uint64_t& primary, secondary_key_proxy_type secondary ) {
+               ++context._db_intrinsics;
                const auto& obj = itr_cache.get( iterator );
                primary   = obj.primary_key;
                secondary_key_helper_t::get(secondary, obj.secondary_key);
             }
 
+            void append_objects( std::vector<const void*>& objects )const { itr_cache.append_objects( objects ); }
+
          private:
+            /// iterator to a row the action read
+            int add_read( const ObjectType& obj ) {
+               if( context._trace_row_accesses ) context.record_row_access( itr_cache.get_table( obj.t_id ), obj.primary_key, false );
+               return itr_cache.add( obj );
+            }
+
             apply_context&              context;
             iterator_cache<ObjectType>  itr_cache;
       }; /// class generic_index
@@ -520,6 +565,14 @@ class apply_context {
       int  db_lowerbound_i64( name code, name scope, name table, uint64_t id );
       int  db_upperbound_i64( name code, name scope, name table, uint64_t id );
       int  db_end_i64( name code, name scope, name table );
+      /**
+       * Copy the rows of a table from iterator on, in primary key order, until max_rows are copied or the next one
+       * does not fit buffer. Each row is copied as its primary key (8 bytes), the size of its value (4 bytes) and its
+       * value, packed one after the other.
+       * @param next_iterator set to the first row not copied, the end iterator of the table once all are copied
+       * @return number of rows copied
+       */
+      int  db_get_range_i64( int iterator, int& next_iterator, char* buffer, size_t buffer_size, uint32_t max_rows );
 
    private:
 
@@ -529,6 +582,62 @@ class apply_context {
 
       int  db_store_i64( name code, name scope, name table, const account_name& payer, uint64_t id, const char* buffer, size_t buffer_size );
 
+   /// Key-value database methods:
+   public:
+
+      /// add the key of the receiver, or replace its value, billing the RAM of the row to payer
+      void kv_set( const char* key, uint32_t key_size, const char* value, uint32_t value_size, account_name payer );
+      /// @return 1 if the key of the receiver was erased, 0 if it did not exist
+      int  kv_erase( const char* key, uint32_t key_size );
+      /**
+       * Copy up to value_size bytes of the value of a key of contract.
+       * @return size of the whole value, -1 if the key does not exist
+       */
+      int  kv_get( account_name contract, const char* key, uint32_t key_size, char* value, uint32_t value_size );
+
+      /**
+       * Create an iterator over the keys of contract starting with prefix, in key order, positioned at the first of
+       * them. An iterator keeps the key it is positioned at rather than the row, so the rows can be changed or erased
+       * while iterating. Once past the last or before the first key, the iterator is at the end, from which next stays
+       * at the end and prev moves to the last key.
+       * @return the iterator
+       */
+      int  kv_it_create( account_name contract, const char* prefix, uint32_t prefix_size );
+      void kv_it_destroy( int itr );
+      /// The kv_it_* positioning methods return 0 when the iterator is positioned at a key, -1 when it is at the end.
+      int  kv_it_lower_bound( int itr, const char* key, uint32_t key_size );
+      int  kv_it_next( int itr );
+      int  kv_it_prev( int itr );
+      /**
+       * Copy up to size bytes of the key the iterator is positioned at.
+       * @return size of the whole key, -1 if the iterator is at the end
+       */
+      int  kv_it_key( int itr, char* dest, uint32_t size );
+      /**
+       * Copy up to size bytes of the value of the key the iterator is positioned at.
+       * @return size of the whole value, -1 if the iterator is at the end or its key was erased
+       */
+      int  kv_it_value( int itr, char* dest, uint32_t size );
+
+   private:
+
+      struct kv_iterator {
+         account_name   contract;
+         std::string    prefix;
+         std::string    key;      ///< key positioned at, empty at the end
+         bool           at_end = true;
+      };
+
+      /// iterator to a row of the i64 tables the action read
+      int add_keyval_read( const key_value_object& obj ) {
+         if( _trace_row_accesses ) record_row_access( keyval_cache.get_table( obj.t_id ), obj.primary_key, false );
+         return keyval_cache.add( obj );
+      }
+
+      kv_iterator& get_kv_iterator( int itr );
+      template<typename Itr>
+      int          kv_it_position( kv_iterator& it, const Itr& itr );
+
 
    /// Misc methods:
    public:
@@ -544,8 +653,17 @@ class apply_context {
       uint64_t next_auth_sequence( account_name actor );
 
       void add_ram_usage( account_name account, int64_t ram_delta );
+      void record_state_access()const;
       void finalize_trace( action_trace& trace, const fc::time_point& start );
 
+      /// with trace_row_accesses, notes a row of a table the action read or wrote, for its trace
+      void record_row_access( name code, name scope, name table, uint64_t primary_key, bool write ) {
+         if( _trace_row_accesses ) _row_accesses.push_back( row_access{ code, scope, table, primary_key, write } );
+      }
+      void record_row_access( const table_id_object& tab, uint64_t primary_key, bool write ) {
+         record_row_access( tab.code, tab.scope, tab.table, primary_key, write );
+      }
+
       bool is_context_free()const { return context_free; }
       bool is_privileged()const { return privileged; }
       action_name get_receiver()const { return receiver; }
@@ -559,6 +677,7 @@ class apply_context {
       controller&                   control;
       chainbase::database&          db;  ///< database where state is stored
       transaction_context&          trx_context; ///< transaction context in which the action is running
+      transaction_arena&            arena; ///< of trx_context, holds the temporaries below
 
    private:
       const action*                 act = nullptr; ///< action being applied
@@ -569,6 +688,7 @@ class apply_context {
       uint32_t                      action_ordinal = 0;
       bool                          privileged   = false;
       bool                          context_free = false;
+      bool                          _trace_row_accesses = false; ///< of control, cached as it is checked per row
 
    public:
       generic_index<index64_object>                                  idx64;
@@ -580,11 +700,16 @@ class apply_context {
    private:
 
       iterator_cache<key_value_object>    keyval_cache;
-      vector< std::pair<account_name, uint32_t> > _notified; ///< keeps track of new accounts to be notifed of current message
-      vector<uint32_t>                    _inline_actions; ///< action_ordinals of queued inline actions
-      vector<uint32_t>                    _cfa_inline_actions; ///< action_ordinals of queued inline context-free actions
+      arena_vector< fc::optional<kv_iterator> > kv_iterators; ///< indexed by iterator, empty once destroyed
+      arena_vector< std::pair<account_name, uint32_t> > _notified; ///< keeps track of new accounts to be notifed of current message
+      arena_vector<uint32_t>              _inline_actions; ///< action_ordinals of queued inline actions
+      arena_vector<uint32_t>              _cfa_inline_actions; ///< action_ordinals of queued inline context-free actions
       std::string                         _pending_console_output;
       flat_set<account_delta>             _account_ram_deltas; ///< flat_set of account_delta so json is an array of objects
+      vector<row_access>                  _row_accesses; ///< rows read and written by the current action, moved to its trace
+      uint64_t                            _db_intrinsics = 0; ///< database intrinsics called by the current action
+      digest_type                         _act_digest; ///< of act, for the receipts of it and its notifications
+      fc::time_point                      _profile_start; ///< of the current action, with trx_context.profile_usage
 
       //bytes                               _cached_trx;
 };
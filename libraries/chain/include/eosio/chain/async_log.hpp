@@ -0,0 +1,131 @@
+#pragma once
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Log records of hot paths, written to their fc::logger on a background thread.
+    *
+    * The async_dlog, async_ilog, async_wlog and async_elog macros check the level first, so that nothing of a
+    * record of a disabled level is evaluated. A record of an enabled level takes no lock and makes no allocation
+    * on the logging thread: its arguments are copied as they are, as name and value pairs, into a slot of a fixed
+    * size lock-free ring, and converted to variants, formatted and written by the background thread. Arguments must
+    * fit the slot, which is checked at compile time. When the ring is full the record is dropped and counted.
+    *
+    * Records are written with the time and thread name of the background thread, within milliseconds of being
+    * logged when the ring is not backed up, and may be written after records logged synchronously afterwards.
+    */
+   class async_log {
+   public:
+      static constexpr size_t args_size = 192;   ///< bytes of the arguments of a record
+      static constexpr size_t ring_size = 8192;  ///< records, a power of 2
+
+      /// started on first use, the records left are written on destruction
+      static async_log& instance();
+
+      ~async_log();
+
+      async_log( const async_log& ) = delete;
+      async_log& operator=( const async_log& ) = delete;
+
+      /// args are name and value pairs, names being string literals, the logger and format must outlive the record
+      template<typename... Args>
+      void post( fc::logger& l, fc::log_level::values level, const char* file, uint32_t line, const char* method,
+                 const char* format, Args&&... args ) {
+         static_assert( sizeof...(Args) % 2 == 0, "async_log arguments are name and value pairs" );
+         using tuple_type = std::tuple<std::decay_t<Args>...>;
+         static_assert( sizeof(tuple_type) <= args_size, "async_log arguments do not fit a slot" );
+         static_assert( alignof(tuple_type) <= alignof(std::max_align_t), "async_log arguments are over aligned" );
+
+         slot* s = acquire();
+         if( !s ) return;
+         s->logger = &l;
+         s->level = level;
+         s->file = file;
+         s->line = line;
+         s->method = method;
+         s->format = format;
+         new (&s->args) tuple_type( std::forward<Args>(args)... );
+         s->write_args = []( void* a, fc::mutable_variant_object& out ) {
+            struct destroy {
+               tuple_type& t;
+               ~destroy() { t.~tuple_type(); }
+            } d{ *static_cast<tuple_type*>( a ) };
+            write_pairs( d.t, out, std::make_index_sequence<sizeof...(Args) / 2>() );
+         };
+         publish( s );
+      }
+
+      /// wait for the records posted so far to be written
+      void flush();
+
+      uint64_t dropped()const { return _dropped; }
+
+   private:
+      struct slot {
+         std::atomic<size_t>    sequence{0};
+         fc::logger*            logger = nullptr;
+         fc::log_level::values  level = fc::log_level::off;
+         const char*            file = nullptr;
+         uint32_t               line = 0;
+         const char*            method = nullptr;
+         const char*            format = nullptr;
+         void                   (*write_args)( void* args, fc::mutable_variant_object& out ) = nullptr; ///< also destroys them
+         std::aligned_storage_t<args_size, alignof(std::max_align_t)>  args;
+      };
+
+      template<typename Tuple, size_t... I>
+      static void write_pairs( Tuple& t, fc::mutable_variant_object& out, std::index_sequence<I...> ) {
+         ( out( std::get<2*I>( t ), fc::variant( std::move( std::get<2*I+1>( t ) ) ) ), ... );
+      }
+
+      async_log();
+
+      /// reserve a slot, nullptr if the ring is full
+      slot* acquire();
+      void publish( slot* s );
+      /// write the next record on the background thread, false if there is none
+      bool write_one();
+      void run();
+
+      std::unique_ptr<slot[]>  _ring;
+      std::atomic<size_t>      _enqueue_pos{0};
+      std::atomic<size_t>      _dequeue_pos{0};   ///< written by the background thread only
+      std::atomic<uint64_t>    _dropped{0};
+      std::atomic<bool>        _stopped{false};
+      std::thread              _thread;
+   };
+
+   /// the part of an id logged by net_plugin and producer_plugin, cut out of the id when the record is written
+   struct short_id {
+      fc::sha256 id;
+   };
+
+   inline void to_variant( const short_id& s, fc::variant& v ) {
+      v = s.id.str().substr( 8, 16 );
+   }
+
+} } // eosio::chain
+
+#define async_log_( LOGGER, LEVEL, FORMAT, ... ) \
+  FC_MULTILINE_MACRO_BEGIN \
+   if( (LOGGER).is_enabled( fc::log_level::LEVEL ) ) \
+      eosio::chain::async_log::instance().post( LOGGER, fc::log_level::LEVEL, __FILE__, __LINE__, __func__, FORMAT, __VA_ARGS__ ); \
+  FC_MULTILINE_MACRO_END
+
+/// for example async_dlog( logger, "block #${n} ${id}", "n", num, "id", eosio::chain::short_id{id} )
+#define async_dlog( LOGGER, FORMAT, ... ) async_log_( LOGGER, debug, FORMAT, __VA_ARGS__ )
+#define async_ilog( LOGGER, FORMAT, ... ) async_log_( LOGGER, info, FORMAT, __VA_ARGS__ )
+#define async_wlog( LOGGER, FORMAT, ... ) async_log_( LOGGER, warn, FORMAT, __VA_ARGS__ )
+#define async_elog( LOGGER, FORMAT, ... ) async_log_( LOGGER, error, FORMAT, __VA_ARGS__ )
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace eosio { namespace chain {
+
+   /**
+    * The handlers of a plugin subscribed to the controller signals, run on a thread of the plugin's own rather than
+    * within controller::emit, so that the time the plugin takes to process a block is not added to applying it.
+    *
+    * A plugin opting in connects to the signals as before and posts its handling, with copies of the signal
+    * arguments, to its queue. The handlers posted run one at a time, in the order they were posted, so that the
+    * plugin sees the signals in the order they were emitted, across signals too.
+    *
+    * When max_size handlers are waiting the overflow policy applies. block makes post wait for the plugin to catch
+    * up, slowing the controller down to the plugin as a synchronous handler would, only for as long as the queue
+    * stays full. drop discards the handler posted, for plugins which can tell and recover from missing signals.
+    *
+    * A handler throwing is logged and the following handlers still run.
+    */
+   class async_signal_queue {
+   public:
+      enum class overflow_policy {
+         block,
+         drop
+      };
+
+      /// name is given to the thread, max_size must be positive
+      async_signal_queue( std::string name, size_t max_size, overflow_policy policy );
+
+      /// calls stop()
+      ~async_signal_queue();
+
+      async_signal_queue( const async_signal_queue& ) = delete;
+      async_signal_queue& operator=( const async_signal_queue& ) = delete;
+
+      /// called on the thread emitting the signal, ignored once stopped
+      void post( std::function<void()> handler );
+
+      /// wait for the handlers posted so far to run
+      void flush();
+
+      /// run the handlers already posted and join the thread
+      void stop();
+
+      size_t   size()const;
+      uint64_t dropped()const { return _dropped; }
+
+   private:
+      void run();
+
+      const std::string            _name;
+      const size_t                 _max_size;
+      const overflow_policy        _policy;
+      mutable std::mutex           _mtx;
+      std::condition_variable      _posted;      ///< signals the thread of a handler posted or of stop
+      std::condition_variable      _ran;         ///< signals post and flush of handlers run
+      std::deque<std::function<void()>>  _handlers;
+      bool                         _running = false;   ///< a handler taken from _handlers is running
+      bool                         _stopped = false;
+      bool                         _done = false;      ///< the thread ran the last handler
+      std::atomic<uint64_t>        _dropped{0};
+      std::thread                  _thread;
+   };
+
+   /// parse "block" or "drop"
+   async_signal_queue::overflow_policy to_overflow_policy( const std::string& policy );
+
+} } // eosio::chain
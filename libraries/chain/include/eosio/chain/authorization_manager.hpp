@@ -2,10 +2,15 @@
 
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/permission_object.hpp>
+#include <eosio/chain/authority_checker.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/transaction.hpp>
 #include <eosio/chain/snapshot.hpp>
 
 #include <utility>
 #include <functional>
+#include <map>
+#include <mutex>
 
 namespace eosio { namespace chain {
 
@@ -45,6 +50,12 @@ namespace eosio { namespace chain {
 
          void remove_permission( const permission_object& permission );
 
+         /// to be called when a link of an action to its minimum permission is added, modified or removed
+         void permission_links_changed();
+
+         /// @return number of changes to permissions and permission links, a check is only repeated once it changes
+         uint64_t revision()const { return _revision; }
+
          void update_permission_usage( const permission_object& permission );
 
          fc::time_point get_permission_last_used( const permission_object& permission )const;
@@ -73,6 +84,8 @@ namespace eosio { namespace chain {
           *  @param provided_delay - the delay satisfied by the transaction
           *  @param checktime - the function that can be called to track CPU usage and time during the process of checking authorization
           *  @param allow_unused_keys - true if method should not assert on unused keys
+          *
+          *  Can be called from several threads at once as long as the database is not modified meanwhile.
           */
          void
          check_authorization( const vector<action>&                actions,
@@ -84,6 +97,18 @@ namespace eosio { namespace chain {
                               const flat_set<permission_level>&    satisfied_authorizations = flat_set<permission_level>()
                             )const;
 
+         /// the same for the num_actions actions at actions, such as a single inline action without copying it
+         void
+         check_authorization( const action*                        actions,
+                              size_t                               num_actions,
+                              const flat_set<public_key_type>&     provided_keys,
+                              const flat_set<permission_level>&    provided_permissions = flat_set<permission_level>(),
+                              fc::microseconds                     provided_delay = fc::microseconds(0),
+                              const std::function<void()>&         checktime = std::function<void()>(),
+                              bool                                 allow_unused_keys = false,
+                              const flat_set<permission_level>&    satisfied_authorizations = flat_set<permission_level>()
+                            )const;
+
 
          /**
           *  @brief Check authorizations of a permission with provided keys, permission levels, and delay
@@ -111,13 +136,76 @@ namespace eosio { namespace chain {
                                                       fc::microseconds provided_delay = fc::microseconds(0)
                                                     )const;
 
+         /**
+          * get_required_keys with the authorities of the permissions given by permission_to_authority, which throws
+          * permission_query_exception for a permission that does not exist. It need not access the database, as
+          * when the authorities were copied out of it for another thread.
+          */
+         template<typename PermissionToAuthorityFunc>
+         static flat_set<public_key_type> get_required_keys( const transaction& trx,
+                                                             const flat_set<public_key_type>& candidate_keys,
+                                                             fc::microseconds provided_delay,
+                                                             PermissionToAuthorityFunc&& permission_to_authority,
+                                                             uint16_t max_authority_depth )
+         {
+            auto checker = make_auth_checker( std::forward<PermissionToAuthorityFunc>(permission_to_authority),
+                                              max_authority_depth,
+                                              candidate_keys,
+                                              {},
+                                              provided_delay,
+                                              _noop_checktime
+                                            );
+
+            for (const auto& act : trx.actions ) {
+               for (const auto& declared_auth : act.authorization) {
+                  EOS_ASSERT( checker.satisfied(declared_auth), unsatisfied_authorization,
+                              "transaction declares authority '${auth}', but does not have signatures for it.",
+                              ("auth", declared_auth) );
+               }
+            }
+
+            return checker.used_keys();
+         }
+
 
          static std::function<void()> _noop_checktime;
 
       private:
+         /**
+          * A satisfied check of a single authorization against recovered keys alone, with every key used. It holds for
+          * as long as the permissions visited by the check are unchanged, which is only known for permissions last
+          * updated in irreversible blocks as an undo restores the permission with its id and last_updated.
+          */
+         struct cached_authorization {
+            flat_set<public_key_type>                          provided_keys;
+            fc::microseconds                                   provided_delay;
+            uint16_t                                           max_authority_depth = 0;
+            vector<std::pair<permission_id_type, time_point>>  permissions; ///< visited, with their last_updated
+         };
+
+         /// authorizations cached, the cache is cleared once reached
+         static constexpr size_t max_cached_authorizations = 10000;
+
          const controller&    _control;
          chainbase::database& _db;
 
+         uint64_t             _revision = 0;
+
+         mutable std::mutex                                        _authorization_cache_mtx;
+         mutable std::map<permission_level, cached_authorization>  _authorization_cache;
+
+         void authorizations_changed();
+
+         bool is_cached_authorization( const permission_level& permission,
+                                       const flat_set<public_key_type>& provided_keys,
+                                       fc::microseconds provided_delay,
+                                       uint16_t max_authority_depth )const;
+         void cache_authorization( const permission_level& permission,
+                                   const flat_set<public_key_type>& provided_keys,
+                                   fc::microseconds provided_delay,
+                                   uint16_t max_authority_depth,
+                                   vector<std::pair<permission_id_type, time_point>>&& permissions )const;
+
          void             check_updateauth_authorization( const updateauth& update, const vector<permission_level>& auths )const;
          void             check_deleteauth_authorization( const deleteauth& del, const vector<permission_level>& auths )const;
          void             check_linkauth_authorization( const linkauth& link, const vector<permission_level>& auths )const;
@@ -45,6 +45,54 @@ namespace legacy {
 
 using signer_callback_type = std::function<std::vector<signature_type>(const digest_type&)>;
 
+/**
+ * A producer schedule shared by the block header states holding it rather than copied into each of them. A schedule
+ * only changes when a new one is proposed or promoted, so that the many states of a fork database share a few.
+ *
+ * The schedule is immutable, assigning another one replaces it and leaves the states sharing the previous untouched.
+ * Serialized as the producer_authority_schedule it holds.
+ */
+class immutable_schedule {
+public:
+   immutable_schedule() : _schedule( empty() ) {}
+   immutable_schedule( producer_authority_schedule s )
+   :_schedule( std::make_shared<const producer_authority_schedule>( std::move(s) ) )
+   {}
+
+   // a moved from schedule still holds one
+   immutable_schedule( const immutable_schedule& ) = default;
+   immutable_schedule& operator=( const immutable_schedule& ) = default;
+
+   const producer_authority_schedule& operator*()const { return *_schedule; }
+   const producer_authority_schedule* operator->()const { return _schedule.get(); }
+   operator const producer_authority_schedule&()const { return *_schedule; }
+
+   /// the states sharing other share this schedule
+   bool shares( const immutable_schedule& other )const { return _schedule == other._schedule; }
+
+private:
+   static const std::shared_ptr<const producer_authority_schedule>& empty() {
+      static const auto e = std::make_shared<const producer_authority_schedule>();
+      return e;
+   }
+
+   std::shared_ptr<const producer_authority_schedule> _schedule;
+};
+
+template<typename DataStream>
+DataStream& operator << ( DataStream& ds, const immutable_schedule& s ) {
+   fc::raw::pack( ds, *s );
+   return ds;
+}
+
+template<typename DataStream>
+DataStream& operator >> ( DataStream& ds, immutable_schedule& s ) {
+   producer_authority_schedule schedule;
+   fc::raw::unpack( ds, schedule );
+   s = std::move( schedule );
+   return ds;
+}
+
 struct block_header_state;
 
 namespace detail {
@@ -52,7 +100,7 @@ namespace detail {
       uint32_t                          block_num = 0;
       uint32_t                          dpos_proposed_irreversible_blocknum = 0;
       uint32_t                          dpos_irreversible_blocknum = 0;
-      producer_authority_schedule       active_schedule;
+      immutable_schedule                active_schedule;
       incremental_merkle                blockroot_merkle;
       flat_map<account_name,uint32_t>   producer_to_last_produced;
       flat_map<account_name,uint32_t>   producer_to_last_implied_irb;
@@ -63,7 +111,7 @@ namespace detail {
    struct schedule_info {
       uint32_t                          schedule_lib_num = 0; /// last irr block num
       digest_type                       schedule_hash;
-      producer_authority_schedule       schedule;
+      immutable_schedule                schedule;
    };
 
    bool is_builtin_activated( const protocol_feature_activation_set_ptr& pfa,
@@ -143,7 +191,7 @@ struct block_header_state : public detail::block_header_state_common {
                                                         const vector<digest_type>& )>& validator,
                               bool skip_validate_signee = false )const;
 
-   bool                 has_pending_producers()const { return pending_schedule.schedule.producers.size(); }
+   bool                 has_pending_producers()const { return pending_schedule.schedule->producers.size(); }
    uint32_t             calc_dpos_last_irreversible( account_name producer_of_next_block )const;
 
    producer_authority     get_scheduled_producer( block_timestamp_type t )const;
@@ -159,6 +207,20 @@ using block_header_state_ptr = std::shared_ptr<block_header_state>;
 
 } } /// namespace eosio::chain
 
+namespace fc {
+   inline
+   void to_variant( const eosio::chain::immutable_schedule& s, variant& v ) {
+      to_variant( *s, v );
+   }
+
+   inline
+   void from_variant( const variant& v, eosio::chain::immutable_schedule& s ) {
+      eosio::chain::producer_authority_schedule schedule;
+      from_variant( v, schedule );
+      s = std::move( schedule );
+   }
+}
+
 FC_REFLECT( eosio::chain::detail::block_header_state_common,
             (block_num)
             (dpos_proposed_irreversible_blocknum)
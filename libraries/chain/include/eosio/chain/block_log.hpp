@@ -28,17 +28,69 @@ namespace eosio { namespace chain {
     * Blocks can be accessed at random via block number through the index file. Seek to 8 * (block_num - 1)
     * to find the position of the block in the main file.
     *
+    * Starting with version 4 every block is stored compressed. The block header is kept uncompressed in
+    * front of the block so that headers and block numbers can still be read without decompressing:
+    *
+    * +--------------+-------------+-------------------+-------------+-----------------------------------+
+    * | block_header | compression | uncompressed size | stored size | rest of the signed_block (packed) |
+    * +--------------+-------------+-------------------+-------------+-----------------------------------+
+    *
     * The main file is the only file that needs to persist. The index file can be reconstructed during a
     * linear scan of the main file.
     */
 
+   /**
+    * When stride is set the log is split into segments of stride blocks. Once the head block number is a multiple
+    * of stride, the next append moves blocks.log and blocks.index to retained_dir as blocks-<first>-<last>.log and
+    * blocks-<first>-<last>.index and starts a new blocks.log. Only the newest max_retained_files segments are kept,
+    * older ones are moved to archive_dir or deleted if archive_dir is empty. Retained segments are still read by
+    * read_block_by_num and read_block_id_by_num.
+    */
+   struct block_log_config {
+      uint32_t stride             = 0;   ///< blocks per segment, 0 keeps a single ever-growing blocks.log
+      uint32_t max_retained_files = std::numeric_limits<uint32_t>::max();
+      fc::path retained_dir       = "retained"; ///< relative paths are relative to the blocks directory
+      fc::path archive_dir;               ///< relative paths are relative to the blocks directory
+      /// blocks queued for a background writer thread before append blocks, 0 writes on the appending thread
+      uint32_t write_queue_size   = 0;
+      uint32_t fsync_interval     = 0;   ///< fsync blocks.log and blocks.index after this many blocks, 0 to never fsync
+      /// format of new blocks.log files, including split segments; existing logs keep their version
+      uint32_t version            = 3;
+   };
+
+   /**
+    * Packed signed_block read from the block log. For uncompressed block logs data points into a read only memory
+    * mapping of blocks.log, which stays valid for as long as the view is held.
+    */
+   struct packed_block_view {
+      std::shared_ptr<const void> owner;
+      const char*                 data = nullptr;
+      size_t                      size = 0;
+
+      explicit operator bool()const { return data != nullptr; }
+   };
+
+   /// outcome of block_log::verify
+   struct block_log_verification {
+      uint32_t                 first_block_num = 0;
+      uint32_t                 last_block_num = 0;
+      uint32_t                 blocks_verified = 0;   ///< blocks before the first corrupt block
+      fc::optional<uint32_t>   first_corrupt_block;
+      std::string              error;                 ///< what is wrong with first_corrupt_block
+   };
+
    class block_log {
       public:
-         block_log(const fc::path& data_dir);
+         block_log(const fc::path& data_dir, const block_log_config& config = block_log_config());
          block_log(block_log&& other);
          ~block_log();
 
+         /**
+          * @return position of b in blocks.log, block_log::npos if b was queued for the background writer. Queued
+          *         blocks are returned by the read functions and are written before the log is closed.
+          */
          uint64_t append(const signed_block_ptr& b);
+         /// wait for queued blocks to be written, rethrows a failure of the background writer
          void flush();
          void reset( const genesis_state& gs, const signed_block_ptr& genesis_block );
          void reset( const chain_id_type& chain_id, uint32_t first_block_num );
@@ -47,6 +99,8 @@ namespace eosio { namespace chain {
          void             read_block_header(block_header& bh, uint64_t file_pos)const;
          signed_block_ptr read_block_by_num(uint32_t block_num)const;
          block_id_type    read_block_id_by_num(uint32_t block_num)const;
+         /// @return fc::raw::pack of the block without unpacking it, empty view if block_num is not in the log
+         packed_block_view read_packed_block_by_num(uint32_t block_num)const;
          signed_block_ptr read_block_by_id(const block_id_type& id)const {
             return read_block_by_num(block_header::num_from_id(id));
          }
@@ -58,7 +112,10 @@ namespace eosio { namespace chain {
          signed_block_ptr        read_head()const;
          const signed_block_ptr& head()const;
          const block_id_type&    head_id()const;
+         /// first block of blocks.log, retained segments hold the blocks from first_retained_block_num() up to it
          uint32_t                first_block_num() const;
+         /// oldest block readable by read_block_by_num, first_block_num() if no segments are retained
+         uint32_t                first_retained_block_num() const;
 
          static const uint64_t npos = std::numeric_limits<uint64_t>::max();
 
@@ -71,7 +128,20 @@ namespace eosio { namespace chain {
 
          static chain_id_type extract_chain_id( const fc::path& data_dir );
 
-         static void construct_index(const fc::path& block_file_name, const fc::path& index_file_name);
+         /**
+          * @param num_threads - with more than one thread large block logs are split into regions that are indexed
+          *                      in parallel, falling back to a sequential scan if the regions do not line up
+          */
+         static void construct_index(const fc::path& block_file_name, const fc::path& index_file_name, uint32_t num_threads = 1);
+
+         /**
+          * Check every block of blocks.log in block_dir against blocks.index: that it is where the index and its
+          * trailer say, that it unpacks to the expected block number, that its transaction_mroot matches its
+          * transactions and that its previous is the id of the block before it.
+          * @param num_threads - the blocks are split into that many ranges verified in parallel, the linkage of the
+          *                      ranges is checked once they are done
+          */
+         static block_log_verification verify(const fc::path& block_dir, uint32_t num_threads = 1);
 
          static bool contains_genesis_state(uint32_t version, uint32_t first_block_num);
 
@@ -81,6 +151,20 @@ namespace eosio { namespace chain {
 
          static bool trim_blocklog_front(const fc::path& block_dir, const fc::path& temp_dir, uint32_t truncate_at_block);
 
+         /**
+          * Write the blocks first_block_num to last_block_num of the block log in block_dir to a new blocks.log and
+          * blocks.index in output_dir, starting at first_block_num. The blocks are copied by the kernel where it
+          * can, only the positions following each block are rewritten.
+          */
+         static void extract_blocklog(const fc::path& block_dir, const fc::path& output_dir,
+                                      uint32_t first_block_num, uint32_t last_block_num);
+
+         /**
+          * Write a copy of the block log in block_dir to output_dir using the format of new_version. Supports
+          * converting between version 3 and later formats in both directions.
+          */
+         static void convert_version(const fc::path& block_dir, const fc::path& output_dir, uint32_t new_version);
+
    private:
          void open(const fc::path& data_dir);
          void construct_index();
@@ -0,0 +1,46 @@
+#pragma once
+#include <eosio/chain/lru_cache.hpp>
+#include <eosio/chain/types.hpp>
+
+#include <set>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Keys recovered from the signatures of recent block headers, by block id, so that a block received from several
+    * peers, or validated again when switching forks, has its signatures recovered once.
+    *
+    * The block id does not cover the signatures and the signature digest depends on the state the header is applied
+    * to, so an entry also holds what its keys were recovered from, and a block signed differently or applied to
+    * another state is recovered again.
+    */
+   class block_signee_cache {
+   public:
+      static constexpr size_t max_entries = 1024;
+
+      struct entry {
+         digest_type                digest;
+         signature_type             producer_signature;
+         vector<signature_type>     additional_signatures;
+         std::set<public_key_type>  keys;
+      };
+      using cache_type = lru_cache<block_id_type, entry>;
+      using stats = cache_type::stats;
+
+      static block_signee_cache& instance();
+
+      /**
+       * @return the distinct keys recovered from producer_signature and additional_signatures of digest
+       * @throws wrong_signing_key if two of the signatures are of the same key
+       */
+      std::set<public_key_type> recover( const block_id_type& id, const digest_type& digest,
+                                         const signature_type& producer_signature,
+                                         const vector<signature_type>& additional_signatures );
+
+      stats get_stats()const { return cache.get_stats(); }
+
+   private:
+      cache_type  cache{ max_entries };
+   };
+
+} } // eosio::chain
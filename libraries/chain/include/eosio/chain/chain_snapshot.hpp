@@ -16,10 +16,13 @@ struct chain_snapshot_header {
     *         - WebAuthn keys
     *         - wtmsig block siganatures: the block header state changed to include producer authorities and additional signatures
     *         - removed genesis_state and added chain ID to global_property_object
+    *   4: Updated for the key-value database:
+    *         - forwards compatible with versions 2 and 3
+    *         - adds a section for kv_object
     */
 
    static constexpr uint32_t minimum_compatible_version = 2;
-   static constexpr uint32_t current_version = 3;
+   static constexpr uint32_t current_version = 4;
 
    uint32_t version = current_version;
 
@@ -10,11 +10,12 @@ typedef __uint128_t uint128_t;
 
 const static auto default_blocks_dir_name    = "blocks";
 const static auto reversible_blocks_dir_name = "reversible";
-const static auto default_reversible_cache_size = 340*1024*1024ll;/// 1MB * 340 blocks based on 21 producer BFT delay
-const static auto default_reversible_guard_size = 2*1024*1024ll;/// 1MB * 340 blocks based on 21 producer BFT delay
+const static auto reversible_blocks_filename = "reversible.log";
 
 const static auto default_state_dir_name     = "state";
 const static auto forkdb_filename            = "fork_db.dat";
+const static auto forkdb_checkpoint_filename = "fork_db.checkpoint.dat";
+const static auto state_sequence_filename    = "state_sequence.dat";
 const static auto default_state_size            = 1*1024*1024*1024ll;
 const static auto default_state_guard_size      =    128*1024*1024ll;
 
@@ -81,6 +82,8 @@ const static uint16_t   default_max_auth_depth                       = 6;
 const static uint32_t   default_sig_cpu_bill_pct                     = 50 * percent_1; // billable percentage of signature recovery
 const static uint32_t   default_block_cpu_effort_pct                 = 80 * percent_1; // percentage of block time used for producing block
 const static uint16_t   default_controller_thread_pool_size          = 2;
+const static uint16_t   default_block_validation_pipeline_depth      = 0;
+const static uint32_t   default_irreversible_blocks_per_push         = 0;
 const static uint32_t   default_max_variable_signature_length        = 16384u;
 const static uint32_t   default_max_nonprivileged_inline_action_size = 4 * 1024; // 4 KB
 
@@ -97,6 +100,10 @@ const static uint32_t   setcode_ram_bytes_multiplier       = 10;     ///< multip
 
 const static uint32_t   hashing_checktime_block_size       = 10*1024;  /// call checktime from hashing intrinsic once per this number of bytes
 
+const static uint32_t   max_kv_key_size                    = 1024;       ///< largest key of a row of the key-value database
+const static uint32_t   max_kv_value_size                  = 256*1024;   ///< largest value of a row of the key-value database
+const static uint32_t   max_kv_iterators                   = 1024;       ///< key-value iterators an action can have open at once
+
 const static eosio::chain::wasm_interface::vm_type default_wasm_runtime = eosio::chain::wasm_interface::vm_type::wabt;
 const static uint32_t   default_abi_serializer_max_time_us = 15*1000; ///< default deadline for abi serialization methods
 
@@ -5,6 +5,7 @@
 #include <eosio/chain/multi_index_includes.hpp>
 
 #include <array>
+#include <string_view>
 #include <type_traits>
 
 namespace eosio { namespace chain {
@@ -214,6 +215,51 @@ namespace eosio { namespace chain {
       }
    };
 
+   /**
+    * Orders keys of the key-value database byte by byte, each byte taken as unsigned, a key sorting before the keys it
+    * is a prefix of. Also compares against std::string_view so that the keys a contract passes in can be looked up
+    * without copying them.
+    */
+   struct kv_key_less {
+      static std::string_view to_view( const shared_blob& b ) { return { b.data(), b.size() }; }
+      static std::string_view to_view( std::string_view v ) { return v; }
+
+      template<typename L, typename R>
+      bool operator()( const L& lhs, const R& rhs ) const {
+         // std::char_traits<char> compares as unsigned char
+         return to_view( lhs ) < to_view( rhs );
+      }
+   };
+
+   /**
+    * @brief A row of the key-value database: an arbitrary byte string key of a contract, mapped to an arbitrary value
+    */
+   struct kv_object : public chainbase::object<kv_object_type, kv_object> {
+      OBJECT_CTOR(kv_object, (kv_key)(kv_value))
+
+      id_type               id;
+      account_name          contract; //< contract should not be changed within a chainbase modifier lambda
+      shared_blob           kv_key;   //< kv_key should not be changed within a chainbase modifier lambda
+      account_name          payer;
+      shared_blob           kv_value;
+   };
+
+   struct by_kv_key;
+
+   using kv_index = chainbase::shared_multi_index_container<
+      kv_object,
+      indexed_by<
+         ordered_unique<tag<by_id>, member<kv_object, kv_object::id_type, &kv_object::id>>,
+         ordered_unique<tag<by_kv_key>,
+            composite_key< kv_object,
+               member<kv_object, account_name, &kv_object::contract>,
+               member<kv_object, shared_blob, &kv_object::kv_key>
+            >,
+            composite_key_compare< std::less<account_name>, kv_key_less >
+         >
+      >
+   >;
+
    /**
     * helper template to map from an index type to the best tag
     * to use when traversing by table_id
@@ -280,6 +326,12 @@ namespace config {
       static const uint64_t value = 24 + 16 + overhead; ///< 24 bytes for fixed fields + 16 bytes key + overhead
    };
 
+   template<>
+   struct billable_size<kv_object> {
+      static const uint64_t overhead = overhead_per_row_per_index_ram_bytes * 2;  ///< overhead for 2x indices internal-key and contract,key
+      static const uint64_t value = 24 + (8 + 4) * 2 + overhead; ///< 24 bytes for fixed fields, 8 for pointer to and 4 for size of both the key and the value + overhead
+   };
+
 } // namespace config
 
 } }  // namespace eosio::chain
@@ -292,6 +344,7 @@ CHAINBASE_SET_INDEX_TYPE(eosio::chain::index128_object, eosio::chain::index128_i
 CHAINBASE_SET_INDEX_TYPE(eosio::chain::index256_object, eosio::chain::index256_index)
 CHAINBASE_SET_INDEX_TYPE(eosio::chain::index_double_object, eosio::chain::index_double_index)
 CHAINBASE_SET_INDEX_TYPE(eosio::chain::index_long_double_object, eosio::chain::index_long_double_index)
+CHAINBASE_SET_INDEX_TYPE(eosio::chain::kv_object, eosio::chain::kv_index)
 
 FC_REFLECT(eosio::chain::table_id_object, (code)(scope)(table)(payer)(count) )
 FC_REFLECT(eosio::chain::key_value_object, (primary_key)(payer)(value) )
@@ -304,3 +357,5 @@ REFLECT_SECONDARY(eosio::chain::index128_object)
 REFLECT_SECONDARY(eosio::chain::index256_object)
 REFLECT_SECONDARY(eosio::chain::index_double_object)
 REFLECT_SECONDARY(eosio::chain::index_long_double_object)
+
+FC_REFLECT(eosio::chain::kv_object, (contract)(kv_key)(payer)(kv_value) )
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <eosio/chain/name.hpp>
+#include <fc/time.hpp>
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /**
+    * What the actions of each (receiver, action) cost the node, aggregated over rolling windows of wall clock time:
+    * the wall time they ran for, the CPU billed for their transactions, the database intrinsics they called and the
+    * RAM they consumed. Every execution counts, so a transaction applied speculatively and again in a block counts
+    * twice, as the node ran it twice.
+    *
+    * Not thread safe, used on the main thread.
+    */
+   class contract_usage_profiler {
+   public:
+      struct usage {
+         uint64_t  calls = 0;
+         int64_t   wall_us = 0;
+         int64_t   billed_cpu_us = 0;    ///< share of the CPU billed for the transaction, in proportion to wall time
+         uint64_t  db_intrinsics = 0;
+         int64_t   ram_delta = 0;        ///< bytes, added up over the accounts billed
+
+         void add( const usage& u ) {
+            calls += u.calls;
+            wall_us += u.wall_us;
+            billed_cpu_us += u.billed_cpu_us;
+            db_intrinsics += u.db_intrinsics;
+            ram_delta += u.ram_delta;
+         }
+      };
+
+      struct action_usage {
+         account_name  receiver;
+         action_name   action;
+         usage         totals;
+      };
+
+      enum class metric {
+         wall,
+         billed_cpu,
+         db_intrinsics,
+         ram_delta,
+         calls
+      };
+
+      /**
+       * Start aggregating, dropping what was aggregated so far
+       * @param window - length of a window
+       * @param windows - windows kept, 0 disables the profiler
+       */
+      void configure( const fc::microseconds& window, uint32_t windows );
+      bool enabled()const { return !_windows.empty(); }
+
+      /**
+       * Add the actions executed by a transaction, billed billed_cpu_us in total. billed_cpu_us of each action is
+       * computed from it.
+       */
+      void add_transaction( std::vector<action_usage>& actions, int64_t billed_cpu_us, const fc::time_point& now );
+
+      /**
+       * @param windows - the most recent windows aggregated over, 0 for all kept
+       * @return the limit (receiver, action)s with the largest m over the windows, largest first
+       */
+      std::vector<action_usage> top( size_t limit, uint32_t windows, metric m, const fc::time_point& now )const;
+
+      /// start of the oldest window of the last windows, 0 for all kept
+      fc::time_point window_start( uint32_t windows, const fc::time_point& now )const;
+
+   private:
+      struct key_hash {
+         size_t operator()( const std::pair<uint64_t, uint64_t>& k )const {
+            return std::hash<uint64_t>()( k.first ) ^ (std::hash<uint64_t>()( k.second ) * 0x9e3779b97f4a7c15ULL);
+         }
+      };
+
+      struct window {
+         int64_t  index = -1; ///< of the window of time it holds, -1 if none
+         std::unordered_map<std::pair<uint64_t, uint64_t>, usage, key_hash>  actions;
+      };
+
+      int64_t window_index( const fc::time_point& now )const { return now.time_since_epoch().count() / _window_size.count(); }
+
+      fc::microseconds     _window_size;
+      std::vector<window>  _windows; ///< window of index i at i % _windows.size()
+   };
+
+} } /// namespace eosio::chain
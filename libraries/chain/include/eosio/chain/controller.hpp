@@ -1,7 +1,10 @@
 #pragma once
 #include <eosio/chain/block_state.hpp>
+#include <eosio/chain/block_log.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/genesis_state.hpp>
+#include <eosio/chain/state_memory.hpp>
+#include <eosio/chain/contract_usage_profiler.hpp>
 #include <chainbase/pinnable_mapped_file.hpp>
 #include <boost/signals2/signal.hpp>
 
@@ -42,6 +45,7 @@ namespace eosio { namespace chain {
    using trx_meta_cache_lookup = std::function<transaction_metadata_ptr( const transaction_id_type&)>;
 
    class fork_database;
+   class work_stealing_pool;
 
    enum class db_read_mode {
       SPECULATIVE,
@@ -66,18 +70,24 @@ namespace eosio { namespace chain {
             flat_set< pair<account_name, action_name> > action_blacklist;
             flat_set<public_key_type> key_blacklist;
             path                     blocks_dir             =  chain::config::default_blocks_dir_name;
+            block_log_config         blocks_log_config;
             path                     state_dir              =  chain::config::default_state_dir_name;
             uint64_t                 state_size             =  chain::config::default_state_size;
             uint64_t                 state_guard_size       =  chain::config::default_state_guard_size;
-            uint64_t                 reversible_cache_size  =  chain::config::default_reversible_cache_size;
-            uint64_t                 reversible_guard_size  =  chain::config::default_reversible_guard_size;
+            uint32_t                 fork_db_checkpoint_interval = 0; ///< blocks between fork database checkpoints, 0 disables them
             uint32_t                 sig_cpu_bill_pct       =  chain::config::default_sig_cpu_bill_pct;
             uint16_t                 thread_pool_size       =  chain::config::default_controller_thread_pool_size;
+            std::vector<uint16_t>    thread_pool_cpus; ///< cpus the threads of the thread pool are pinned to, in turn, none if empty
+            uint16_t                 block_validation_pipeline_depth = chain::config::default_block_validation_pipeline_depth; ///< also blocks read ahead on replay
+            uint32_t                 irreversible_blocks_per_push = chain::config::default_irreversible_blocks_per_push; ///< in irreversible mode, 0 for no limit
+            bool                     parallel_auth_checks   =  false; ///< check authorizations of received blocks on the thread pool
             uint32_t   max_nonprivileged_inline_action_size =  chain::config::default_max_nonprivileged_inline_action_size;
             bool                     read_only              =  false;
+            bool                     publish_state_sequence = false; ///< for processes reading the state database file, see state_sequence_writer
             bool                     force_all_checks       =  false;
             bool                     disable_replay_opts    =  false;
             bool                     contracts_console      =  false;
+            bool                     trace_row_accesses     =  false; ///< record the table rows each action reads and writes in its trace
             bool                     allow_ram_billing_in_notify = false;
             uint32_t                 maximum_variable_signature_length = chain::config::default_max_variable_signature_length;
             bool                     disable_all_subjective_mitigations = false; //< for testing purposes only
@@ -85,12 +95,15 @@ namespace eosio { namespace chain {
             wasm_interface::vm_type  wasm_runtime = chain::config::default_wasm_runtime;
             eosvmoc::config          eosvmoc_config;
             bool                     eosvmoc_tierup         = false;
+            uint64_t                 wasm_cache_size        = 0; //< bytes of contract code instantiated modules are kept for, 0 for no limit
 
             db_read_mode             read_mode              = db_read_mode::SPECULATIVE;
             validation_mode          block_validation_mode  = validation_mode::FULL;
 
             pinnable_mapped_file::map_mode db_map_mode      = pinnable_mapped_file::map_mode::mapped;
             vector<string>           db_hugepage_paths;
+            state_memory::options    db_memory_options;
+            uint32_t                 db_flush_interval      = 0; ///< blocks between writes of the state database back to its file
 
             flat_set<account_name>   resource_greylist;
             flat_set<account_name>   trusted_producers;
@@ -158,6 +171,14 @@ namespace eosio { namespace chain {
          void sign_block( const signer_callback_type& signer_callback );
          void commit_block();
 
+         /**
+          * Start signature recovery of the transactions of a block that is expected to be applied soon, e.g. while
+          * it waits in the main thread queue during sync. Used by apply_block for the block with the same id. Only
+          * blocks among the next block_validation_pipeline_depth after the highest block applied or added to the
+          * fork database are started, each once. No-op when block_validation_pipeline_depth is 0. Thread safe.
+          */
+         void start_block_recover_keys( const signed_block_ptr& b );
+
          std::future<block_state_ptr> create_block_state_future( const signed_block_ptr& b );
 
          /**
@@ -169,7 +190,7 @@ namespace eosio { namespace chain {
                           const forked_branch_callback& cb,
                           const trx_meta_cache_lookup& trx_lookup );
 
-         boost::asio::io_context& get_thread_pool();
+         work_stealing_pool& get_thread_pool();
 
          const chainbase::database& db()const;
 
@@ -232,6 +253,8 @@ namespace eosio { namespace chain {
          time_point last_irreversible_block_time() const;
 
          signed_block_ptr fetch_block_by_number( uint32_t block_num )const;
+         /// packed block straight from the block log, empty view if block_num is not yet irreversible
+         packed_block_view fetch_packed_block_by_number( uint32_t block_num )const;
          signed_block_ptr fetch_block_by_id( block_id_type id )const;
 
          block_state_ptr fetch_block_state_by_number( uint32_t block_num )const;
@@ -265,7 +288,6 @@ namespace eosio { namespace chain {
          void validate_expiration( const transaction& t )const;
          void validate_tapos( const transaction& t )const;
          void validate_db_available_size() const;
-         void validate_reversible_available_size() const;
 
          bool is_protocol_feature_activated( const digest_type& feature_digest )const;
          bool is_builtin_activated( builtin_protocol_feature_t f )const;
@@ -282,6 +304,27 @@ namespace eosio { namespace chain {
          bool is_trusted_producer( const account_name& producer) const;
 
          bool contracts_console()const;
+         bool trace_row_accesses()const;
+
+         /**
+          * Plugins reading more of the traces emitted with applied_transaction than the actions, their receivers and
+          * the receipts (e.g. timings and RAM deltas) register while they run. Without any, the action traces of the
+          * transactions of a received block only get what consensus and those uses need.
+          */
+         void add_trace_consumer();
+         void remove_trace_consumer();
+         bool full_traces()const;
+
+         /**
+          * With database prefetch, apply_context reports the objects of the database each action used, so that their
+          * pages are read ahead when a received block with actions of the same contracts is applied.
+          */
+         bool records_state_access()const;
+         void record_state_access( account_name contract, const std::vector<const void*>& objects );
+
+         /// what each (receiver, action) costs the node, disabled until configured
+         const contract_usage_profiler&  get_contract_usage_profiler()const;
+         contract_usage_profiler&        get_mutable_contract_usage_profiler();
 
          chain_id_type get_chain_id()const;
 
@@ -323,6 +366,7 @@ namespace eosio { namespace chain {
 
          const apply_handler* find_apply_handler( account_name contract, scope_name scope, action_name act )const;
          wasm_interface& get_wasm_interface();
+         const wasm_interface& get_wasm_interface()const;
 
 
          optional<abi_serializer> get_abi_serializer( account_name n, const abi_serializer::yield_function_t& yield )const {
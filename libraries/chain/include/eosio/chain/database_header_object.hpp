@@ -24,10 +24,13 @@ namespace eosio { namespace chain {
           *         no changes to its format were made so it can be safely added to existing databases
           *   - 2 : shared_authority now holds shared_key_weights & shared_public_keys
           *         change from producer_key to producer_authority for many in-memory structures
+          *   - 3 : accounts and account metadata are indexed by name with hash tables, permissions gain a hashed
+          *         by_owner_name index
+          *   - 4 : the transaction ids of the deduplication list are indexed with a hash table
           */
 
-         static constexpr uint32_t current_version            = 2;
-         static constexpr uint32_t minimum_version            = 2;
+         static constexpr uint32_t current_version            = 4;
+         static constexpr uint32_t minimum_version            = 4;
 
          id_type        id;
          uint32_t       version = current_version;
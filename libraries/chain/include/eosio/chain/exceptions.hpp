@@ -320,6 +320,8 @@ namespace eosio { namespace chain {
                                     3060004, "Contract Query Exception" )
       FC_DECLARE_DERIVED_EXCEPTION( bad_database_version_exception, database_exception,
                                     3060005, "Database is an unknown or unsupported version" )
+      FC_DECLARE_DERIVED_EXCEPTION( state_sequence_exception,       database_exception,
+                                    3060006, "Chain state kept changing while being read" )
 
    FC_DECLARE_DERIVED_EXCEPTION( guard_exception, database_exception,
                                  3060100, "Guard Exception" )
@@ -539,6 +541,8 @@ namespace eosio { namespace chain {
                                     3160009, "No wasm file found" )
       FC_DECLARE_DERIVED_EXCEPTION( abi_file_not_found,          contract_exception,
                                     3160010, "No abi file found" )
+      FC_DECLARE_DERIVED_EXCEPTION( kv_limit_exceeded,          contract_exception,
+                                    3160011, "Key-value database limit exceeded" )
 
    FC_DECLARE_DERIVED_EXCEPTION( producer_exception,           chain_exception,
                                  3170000, "Producer exception" )
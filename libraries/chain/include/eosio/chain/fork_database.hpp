@@ -28,6 +28,15 @@ namespace eosio { namespace chain {
                                               const vector<digest_type>& )>& validator );
          void close();
 
+         /**
+          *  Write the current fork database to a checkpoint file, replacing the previous one. After an unclean shutdown
+          *  open() restores the fork database from the checkpoint with all blocks marked as not validated.
+          */
+         void checkpoint();
+
+         /// whether open() restored the fork database from a checkpoint rather than from a clean close
+         bool restored_from_checkpoint()const;
+
          block_header_state_ptr  get_block_header( const block_id_type& id )const;
          block_state_ptr         get_block( const block_id_type& id )const;
 
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Bounded map evicting its least recently used entries first, for the caches of recovered keys shared by the whole
+    * process. Thread safe; a value is meant to be computed outside of the lock after a missed find and then put, so
+    * a value computed by two threads at the same time is computed twice.
+    */
+   template<typename Key, typename Value>
+   class lru_cache {
+   public:
+      struct stats {
+         uint64_t hits = 0;
+         uint64_t misses = 0;
+      };
+
+      explicit lru_cache( size_t max_entries ) : max_entries( max_entries ) {}
+
+      /**
+       * Counts a hit, or a miss when no value is returned.
+       * @return the value of the first of keys found, if matches returns true for it
+       */
+      template<typename Matches>
+      std::optional<Value> find( std::initializer_list<Key> keys, Matches&& matches ) {
+         std::lock_guard<std::mutex> g( mtx );
+         for( const auto& key : keys ) {
+            auto itr = by_key.find( key );
+            if( itr == by_key.end() ) continue;
+            if( !matches( itr->second->second ) ) break;
+            ++counts.hits;
+            lru.splice( lru.begin(), lru, itr->second );
+            return itr->second->second;
+         }
+         ++counts.misses;
+         return {};
+      }
+
+      std::optional<Value> find( std::initializer_list<Key> keys ) {
+         return find( keys, []( const Value& ) { return true; } );
+      }
+
+      /// inserts or replaces the value of key as the most recently used
+      void put( const Key& key, Value value ) {
+         std::lock_guard<std::mutex> g( mtx );
+         auto itr = by_key.find( key );
+         if( itr != by_key.end() ) {
+            itr->second->second = std::move( value );
+            lru.splice( lru.begin(), lru, itr->second );
+            return;
+         }
+         lru.emplace_front( key, std::move( value ) );
+         by_key.emplace( key, lru.begin() );
+         if( lru.size() > max_entries ) {
+            by_key.erase( lru.back().first );
+            lru.pop_back();
+         }
+      }
+
+      stats get_stats()const {
+         std::lock_guard<std::mutex> g( mtx );
+         return counts;
+      }
+
+   private:
+      using lru_list = std::list<std::pair<Key, Value>>;
+
+      const size_t                                   max_entries;
+      mutable std::mutex                             mtx;
+      lru_list                                       lru; ///< most recently used first
+      std::unordered_map<Key, typename lru_list::iterator> by_key;
+      stats                                          counts;
+   };
+
+} } // eosio::chain
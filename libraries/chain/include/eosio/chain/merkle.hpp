@@ -14,6 +14,12 @@ namespace eosio { namespace chain {
       return make_pair(make_canonical_left(l), make_canonical_right(r));
    };
 
+   /**
+    *  The same as digest_type::hash(make_canonical_pair(l, r)), hashing the 64 bytes of the pair in one call instead of
+    *  packing it into the hash encoder one digest at a time.
+    */
+   digest_type hash_canonical_pair(const digest_type& l, const digest_type& r);
+
    /**
     *  Calculates the merkle root of a set of digests, if ids is odd it will duplicate the last id.
     */
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /**
+    * A counter, gauge or histogram of the node, written with the others in the Prometheus text format by
+    * write_prometheus_metrics. A metric is registered for its lifetime, which is usually that of the process as they
+    * are declared at namespace scope next to the code they count; names must be unique.
+    *
+    * Counters and histograms spread their updates over cells of their own, each thread adding to the cell of its
+    * thread index, so threads counting at once do not share a cache line; the cells are summed when written.
+    * Updating a metric is a relaxed atomic add or store, only registration takes a lock.
+    */
+   class metric {
+   public:
+      /// @param type - counter, gauge or histogram, a string literal
+      metric( std::string name, std::string help, const char* type );
+      virtual ~metric();
+
+      metric( const metric& ) = delete;
+      metric& operator=( const metric& ) = delete;
+
+      const std::string& name()const { return _name; }
+
+      /// write the HELP and TYPE lines and the samples
+      void write( std::ostream& out )const;
+
+   protected:
+      static constexpr size_t num_cells = 16;
+
+      /// the cell of the calling thread
+      static size_t thread_cell();
+
+      virtual void write_samples( std::ostream& out )const = 0;
+
+   private:
+      const std::string  _name;
+      const std::string  _help;
+      const char*        _type;
+   };
+
+   /// a count that only goes up, such as the transactions applied
+   class metric_counter : public metric {
+   public:
+      metric_counter( std::string name, std::string help );
+
+      void add( uint64_t n = 1 ) { _cells[thread_cell()].value.fetch_add( n, std::memory_order_relaxed ); }
+      uint64_t value()const;
+
+   private:
+      void write_samples( std::ostream& out )const override;
+
+      struct alignas(64) cell {
+         std::atomic<uint64_t> value{0};
+      };
+      std::array<cell, num_cells> _cells;
+   };
+
+   /// a value that goes up and down, such as the size of a queue, usually set by the thread owning what it measures
+   class metric_gauge : public metric {
+   public:
+      metric_gauge( std::string name, std::string help );
+
+      void set( int64_t v ) { _value.store( v, std::memory_order_relaxed ); }
+      void add( int64_t d ) { _value.fetch_add( d, std::memory_order_relaxed ); }
+      int64_t value()const { return _value.load( std::memory_order_relaxed ); }
+
+   private:
+      void write_samples( std::ostream& out )const override;
+
+      std::atomic<int64_t> _value{0};
+   };
+
+   /// the count of the observations up to each of the bounds, along with their total count and sum
+   class metric_histogram : public metric {
+   public:
+      static constexpr size_t max_bounds = 15;
+
+      /// @param bounds - ascending upper bounds of the buckets, max_bounds at most; one without bound is added after
+      metric_histogram( std::string name, std::string help, std::vector<int64_t> bounds );
+
+      void observe( int64_t v );
+
+   private:
+      void write_samples( std::ostream& out )const override;
+
+      struct alignas(64) cell {
+         std::array<std::atomic<uint64_t>, max_bounds + 1>  buckets{}; ///< not cumulative, the last without bound
+         std::atomic<int64_t>                               sum{0};
+      };
+      const std::vector<int64_t>   _bounds;
+      std::array<cell, num_cells>  _cells;
+   };
+
+   /// write the metrics registered in the Prometheus text exposition format, in the order of their names
+   void write_prometheus_metrics( std::ostream& out );
+
+} } /// namespace eosio::chain
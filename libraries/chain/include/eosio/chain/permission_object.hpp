@@ -82,6 +82,7 @@ namespace eosio { namespace chain {
 
    struct by_parent;
    struct by_owner;
+   struct by_owner_name;
    struct by_name;
    using permission_index = chainbase::shared_multi_index_container<
       permission_object,
@@ -99,6 +100,14 @@ namespace eosio { namespace chain {
                member<permission_object, permission_name, &permission_object::name>
             >
          >,
+         // the same key as by_owner for the lookups of authorization checks, which need no order
+         hashed_unique<tag<by_owner_name>,
+            composite_key<permission_object,
+               member<permission_object, account_name, &permission_object::owner>,
+               member<permission_object, permission_name, &permission_object::name>
+            >,
+            composite_key_hash<std::hash<account_name>, std::hash<permission_name>>
+         >,
          ordered_unique<tag<by_name>,
             composite_key<permission_object,
                member<permission_object, permission_name, &permission_object::name>,
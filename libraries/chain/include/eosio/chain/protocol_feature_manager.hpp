@@ -1,6 +1,7 @@
 #pragma once
 
 #include <eosio/chain/types.hpp>
+#include <bitset>
 #include <iterator>
 
 namespace eosio { namespace chain {
@@ -23,6 +24,10 @@ enum class builtin_protocol_feature_t : uint32_t {
    ram_restrictions,
    webauthn_key,
    wtmsig_block_signatures,
+   batched_db_reads,
+   kv_database,
+   zstd_transaction_compression,
+   sha256_batch,
 };
 
 struct protocol_feature_subjective_restrictions {
@@ -340,6 +345,19 @@ public:
 
    bool is_builtin_activated( builtin_protocol_feature_t feature_codename, uint32_t current_block_num )const;
 
+   using builtin_protocol_feature_bitset = std::bitset<64>;
+
+   /**
+    * The builtin features activated so far, by the pending block included, indexed by builtin_protocol_feature_t.
+    * Since the features of a pending block that is aborted or of popped blocks are rolled back by popped_blocks_to,
+    * this is is_builtin_activated at the current block number without the search for the activation block number.
+    */
+   const builtin_protocol_feature_bitset& activated_builtins()const { return _activated_builtins; }
+
+   bool is_builtin_activated( builtin_protocol_feature_t feature_codename )const {
+      return _activated_builtins.test( static_cast<size_t>( feature_codename ) );
+   }
+
    void activate_feature( const digest_type& feature_digest, uint32_t current_block_num );
    void popped_blocks_to( uint32_t block_num );
 
@@ -363,6 +381,7 @@ protected:
    vector<protocol_feature_entry>         _activated_protocol_features;
    vector<builtin_protocol_feature_entry> _builtin_protocol_features;
    size_t                                 _head_of_builtin_activation_list = builtin_protocol_feature_entry::no_previous;
+   builtin_protocol_feature_bitset        _activated_builtins;
    bool                                   _initialized = false;
 };
 
@@ -0,0 +1,70 @@
+#pragma once
+#include <eosio/chain/block.hpp>
+
+namespace eosio { namespace chain {
+
+   struct reversible_block_log_impl;
+
+   /**
+    * @class reversible_block_log
+    * @brief persists blocks that have been applied but are not yet irreversible
+    *
+    * Blocks are held in memory, indexed by block number, and every change is appended as a record to a single file in
+    * the reversible blocks directory so that it survives a restart:
+    *
+    *   [magic_number][version] followed by a sequence of [block_num][size][packed signed_block]
+    *
+    * A record replaces the stored block with the same number and every block after it. A record with size 0 only
+    * removes blocks starting at block_num. Removing irreversible blocks is done in memory; the file is rewritten with
+    * just the remaining blocks once the stale records dominate it. A partially written record at the end of the file,
+    * left by a crash, is dropped on open.
+    *
+    * The blocks kept in memory are always a contiguous range of block numbers.
+    */
+   class reversible_block_log {
+      public:
+
+         /**
+          * @param data_dir - directory of the log, created if needed unless read_only
+          * @param read_only - load the stored blocks but never write to the file
+          */
+         explicit reversible_block_log( const fc::path& data_dir, bool read_only = false );
+         ~reversible_block_log();
+
+         /**
+          * Store b as the newest block, removing any stored block numbered b->block_num() or higher.
+          * Blocks not contiguous with b are removed as well.
+          */
+         void append( const signed_block_ptr& b, const block_id_type& id );
+
+         /// remove block_num and all blocks after it
+         void remove_from( uint32_t block_num );
+
+         /// remove all blocks up to and including block_num
+         void remove_through( uint32_t block_num );
+
+         signed_block_ptr         get_block( uint32_t block_num )const;
+         optional<block_id_type>  get_block_id( uint32_t block_num )const;
+
+         bool     empty()const;
+         uint32_t first_block_num()const; ///< 0 if empty
+         uint32_t last_block_num()const;  ///< 0 if empty
+
+         /// calls f on every stored block in ascending block number order
+         void for_each( const std::function<void( const signed_block_ptr&, const block_id_type& )>& f )const;
+
+         /// @return true if a damaged record at the end of the file was dropped on open
+         bool truncated_on_open()const;
+
+         void close();
+
+         static const uint32_t magic_number;
+
+         static const uint32_t min_supported_version;
+         static const uint32_t max_supported_version;
+
+      private:
+         unique_ptr<reversible_block_log_impl> my;
+   };
+
+} } /// eosio::chain
@@ -8,6 +8,10 @@
 
 namespace eosio { namespace chain {
 
+   /**
+    * Object of the chainbase reversible blocks database used by previous versions, only kept to read and convert
+    * such a database. Reversible blocks are now stored in a reversible_block_log.
+    */
    class reversible_block_object : public chainbase::object<reversible_block_object_type, reversible_block_object> {
       OBJECT_CTOR(reversible_block_object,(packedblock) )
 
@@ -0,0 +1,34 @@
+#pragma once
+#include <eosio/chain/lru_cache.hpp>
+#include <eosio/chain/types.hpp>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Keys recovered from recent (digest, signature) pairs, shared by the recovery of transaction signatures and the
+    * recover_key and assert_recover_key intrinsics, so that the same signature checked again during speculative
+    * execution, re-execution after abort_block and block validation costs a lookup.
+    *
+    * A key recovered without the canonical check is not returned to a recovery asking for it, the other way around
+    * the recovered key is the same.
+    */
+   class signature_recovery_cache {
+   public:
+      static constexpr size_t max_entries = 10000;
+
+      /// by hash of the signature, digest and check
+      using cache_type = lru_cache<digest_type, public_key_type>;
+      using stats = cache_type::stats;
+
+      static signature_recovery_cache& instance();
+
+      /// as public_key_type( signature, digest, check_canonical ), which it throws the exceptions of
+      public_key_type recover( const signature_type& signature, const digest_type& digest, bool check_canonical = true );
+
+      stats get_stats()const { return cache.get_stats(); }
+
+   private:
+      cache_type  cache{ max_entries };
+   };
+
+} } // eosio::chain
@@ -5,13 +5,17 @@
 #include <fc/variant_object.hpp>
 #include <boost/core/demangle.hpp>
 #include <ostream>
+#include <sstream>
+#include <deque>
 
 namespace eosio { namespace chain {
    /**
     * History:
     * Version 1: initial version with string identified sections and rows
+    * Version 2: binary snapshots start with the position of a section directory that follows the end marker
     */
-   static const uint32_t current_snapshot_version = 1;
+   static const uint32_t minimum_snapshot_version = 1;
+   static const uint32_t current_snapshot_version = 2;
 
    namespace detail {
       template<typename T>
@@ -67,6 +71,38 @@ namespace eosio { namespace chain {
          std::ostream& inner;
       };
 
+      /// unbuffered stream buffer appending everything written to a string
+      class string_append_buf : public std::streambuf {
+         public:
+            explicit string_append_buf(std::string& s)
+            :out(s)
+            {}
+
+         protected:
+            int_type overflow( int_type c ) override {
+               if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                  out.push_back(traits_type::to_char_type(c));
+               }
+               return traits_type::not_eof(c);
+            }
+
+            std::streamsize xsputn( const char* s, std::streamsize n ) override {
+               out.append(s, n);
+               return n;
+            }
+
+         private:
+            std::string& out;
+      };
+
+      /// stream buffer reading a range of chars owned by someone else
+      class char_range_buf : public std::streambuf {
+         public:
+            void reset( char* begin, char* end ) {
+               setg(begin, begin, end);
+            }
+      };
+
 
       struct abstract_snapshot_row_writer {
          virtual void write(ostream_wrapper& out) const = 0;
@@ -110,6 +146,32 @@ namespace eosio { namespace chain {
       snapshot_row_writer<T> make_row_writer( const T& data) {
          return snapshot_row_writer<T>(data);
       }
+
+      /**
+       * Rows of a section packed into memory, so that parts of a large section can be produced by several threads and
+       * then appended in order through snapshot_writer::section_writer::add_rows. Offers the add_row interface of
+       * snapshot_writer::section_writer.
+       */
+      class buffered_snapshot_rows {
+         public:
+            buffered_snapshot_rows()
+            :out(buffer)
+            {}
+
+            template<typename T>
+            void add_row( const T& row, const chainbase::database& db ) {
+               make_row_writer(snapshot_row_traits<T>::to_snapshot_row(row, db)).write(out);
+               ++num_rows;
+            }
+
+            std::string data()const { return buffer.str(); }
+            uint64_t    rows()const { return num_rows; }
+
+         private:
+            std::ostringstream buffer;
+            ostream_wrapper    out;
+            uint64_t           num_rows = 0;
+      };
    }
 
    class snapshot_writer {
@@ -121,6 +183,17 @@ namespace eosio { namespace chain {
                   _writer.write_row(detail::make_row_writer(detail::snapshot_row_traits<T>::to_snapshot_row(row, db)));
                }
 
+               /// append rows packed ahead of time, only valid if the writer supports_packed_rows()
+               void add_rows( const detail::buffered_snapshot_rows& rows ) {
+                  const auto data = rows.data();
+                  _writer.write_packed_rows(data.data(), data.size(), rows.rows());
+               }
+
+               /// append num_rows rows packed with fc::raw, only valid if the writer supports_packed_rows()
+               void add_packed_rows( const char* data, size_t size, uint64_t num_rows ) {
+                  _writer.write_packed_rows(data, size, num_rows);
+               }
+
             private:
                friend class snapshot_writer;
                section_writer(snapshot_writer& writer)
@@ -144,12 +217,19 @@ namespace eosio { namespace chain {
             write_section(detail::snapshot_section_traits<T>::section_name(), f);
          }
 
+      /// @return true if rows packed with fc::raw can be appended to a section as they are
+      virtual bool supports_packed_rows()const { return false; }
+
       virtual ~snapshot_writer(){};
 
       protected:
+         friend class snapshot_delta_writer;
          virtual void write_start_section( const std::string& section_name ) = 0;
          virtual void write_row( const detail::abstract_snapshot_row_writer& row_writer ) = 0;
          virtual void write_end_section() = 0;
+         virtual void write_packed_rows( const char* data, size_t size, uint64_t num_rows ) {
+            EOS_THROW(snapshot_exception, "Snapshot writer does not support packed rows");
+         }
    };
 
    using snapshot_writer_ptr = std::shared_ptr<snapshot_writer>;
@@ -326,6 +406,42 @@ namespace eosio { namespace chain {
          uint64_t cur_row;
    };
 
+   namespace detail {
+      class json_scanner;
+   }
+
+   /**
+    * Reads the JSON form of a snapshot, as variant_snapshot_writer and fc::json produce it, straight from a stream.
+    * Rows are parsed one at a time, so memory use does not grow with the size of the snapshot. The stream has to be
+    * able to seek: validate() or the first section lookup scans it once to find where the rows of every section start.
+    */
+   class istream_json_snapshot_reader : public snapshot_reader {
+      public:
+         explicit istream_json_snapshot_reader(std::istream& snapshot);
+         ~istream_json_snapshot_reader();
+
+         void validate() const override;
+         bool has_section( const string& section_name ) override;
+         void set_section( const string& section_name ) override;
+         bool read_row( detail::abstract_snapshot_row_reader& row_reader ) override;
+         bool empty ( ) override;
+         void clear_section() override;
+         void return_to_header() override;
+
+      private:
+         void scan() const;
+         void scan_sections( detail::json_scanner& in ) const;
+
+         std::istream&                          snapshot;
+         std::streampos                         header_pos;
+         mutable bool                           scanned = false;
+         mutable uint64_t                       version = 0;
+         mutable std::map<std::string, uint64_t> directory; ///< offset of the rows array of each section
+         std::unique_ptr<detail::json_scanner>  rows_in;   ///< set while a section is read
+         bool                                   cur_empty = true;
+         bool                                   section_done = true;
+   };
+
    class ostream_snapshot_writer : public snapshot_writer {
       public:
          explicit ostream_snapshot_writer(std::ostream& snapshot);
@@ -333,15 +449,24 @@ namespace eosio { namespace chain {
          void write_start_section( const std::string& section_name ) override;
          void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
          void write_end_section( ) override;
+         void write_packed_rows( const char* data, size_t size, uint64_t num_rows ) override;
+         bool supports_packed_rows()const override { return true; }
          void finalize();
 
          static const uint32_t magic_number = 0x30510550;
 
       private:
-         detail::ostream_wrapper snapshot;
-         std::streampos          header_pos;
-         std::streampos          section_pos;
-         uint64_t                row_count;
+         struct section_entry {
+            std::string name;
+            uint64_t    offset = 0; ///< from the start of the snapshot to the section size
+            uint64_t    rows = 0;
+         };
+
+         detail::ostream_wrapper    snapshot;
+         std::streampos             header_pos;
+         std::streampos             section_pos;
+         uint64_t                   row_count;
+         std::vector<section_entry> directory;
 
    };
 
@@ -357,13 +482,31 @@ namespace eosio { namespace chain {
          void clear_section() override;
          void return_to_header() override;
 
+         struct section_location {
+            std::streampos pos;      ///< of the first row
+            uint64_t       size = 0; ///< of the packed rows
+            uint64_t       rows = 0;
+         };
+
+         /// @return where the packed rows of a section are in the stream, requires a version 2 or later snapshot
+         fc::optional<section_location> locate_section( const string& section_name );
+
       private:
+         struct section_entry {
+            uint64_t offset = 0;
+            uint64_t rows = 0;
+         };
+
          bool validate_section() const;
+         void read_header();
+         bool find_section( const string& section_name );
 
          std::istream&  snapshot;
          std::streampos header_pos;
          uint64_t       num_rows;
          uint64_t       cur_row;
+         uint32_t       version = 0; ///< 0 until the header is read
+         std::map<std::string, section_entry> directory; ///< only for version 2 and later
    };
 
    class integrity_hash_snapshot_writer : public snapshot_writer {
@@ -373,6 +516,8 @@ namespace eosio { namespace chain {
          void write_start_section( const std::string& section_name ) override;
          void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
          void write_end_section( ) override;
+         void write_packed_rows( const char* data, size_t size, uint64_t num_rows ) override;
+         bool supports_packed_rows()const override { return true; }
          void finalize();
 
       private:
@@ -380,4 +525,115 @@ namespace eosio { namespace chain {
 
    };
 
-}}
+   /**
+    * Writes a zlib compressed snapshot meant to be stored, copied and streamed:
+    *
+    *   [magic_number][version] then for each section its null terminated name followed by chunks of
+    *   [row count][uncompressed size][stored size][compressed rows], closed by a chunk of all zeros,
+    *   and after the last section an empty name and the integrity hash of all rows
+    *
+    * Each chunk is compressed on its own and ends on a row boundary, so the snapshot is written without seeking and a
+    * reader can pass over a section without decompressing it. The integrity hash is the one integrity_hash_snapshot_writer
+    * and controller::calculate_integrity_hash produce, computed while the rows are written.
+    */
+   class compressed_ostream_snapshot_writer : public snapshot_writer {
+      public:
+         explicit compressed_ostream_snapshot_writer(std::ostream& snapshot);
+
+         void write_start_section( const std::string& section_name ) override;
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_end_section( ) override;
+         void write_packed_rows( const char* data, size_t size, uint64_t num_rows ) override;
+         bool supports_packed_rows()const override { return true; }
+         void finalize();
+
+         /// @return integrity hash of the rows, available once finalized
+         const fc::sha256& integrity_hash()const { return hash; }
+
+         static const uint32_t magic_number = 0x30510551;
+         static const uint32_t current_version = 1;
+         static const uint32_t chunk_size = 1024*1024; ///< uncompressed size at which a chunk is closed
+
+      private:
+         void write_chunk();
+
+         std::ostream&             snapshot;
+         std::string               chunk;
+         detail::string_append_buf chunk_buf;
+         std::ostream              chunk_stream;
+         detail::ostream_wrapper   chunk_out;
+         uint32_t                  chunk_rows = 0;
+         bool                      in_section = false;
+         fc::sha256::encoder       enc;
+         fc::sha256                hash;
+   };
+
+   /**
+    * Reads snapshots written by compressed_ostream_snapshot_writer. The stream is read front to back only, so it can
+    * be a pipe. Sections already passed are found again by position if the stream can seek. Otherwise their compressed
+    * chunks are kept in memory, up to max_kept_size, until the first return_to_header; after that a kept section is
+    * released once it has been read again and sections read from the stream are not kept. This covers reading the
+    * chain id ahead of loading the snapshot.
+    *
+    * validate() only checks the header; every chunk is checked when it is decompressed.
+    */
+   class compressed_istream_snapshot_reader : public snapshot_reader {
+      public:
+         explicit compressed_istream_snapshot_reader(std::istream& snapshot);
+
+         void validate() const override;
+         bool has_section( const string& section_name ) override;
+         void set_section( const string& section_name ) override;
+         bool read_row( detail::abstract_snapshot_row_reader& row_reader ) override;
+         bool empty ( ) override;
+         void clear_section() override;
+         void return_to_header() override;
+
+         /// @return the integrity hash stored at the end of the snapshot, once every section has been passed
+         const fc::optional<fc::sha256>& stored_integrity_hash()const { return trailer_hash; }
+
+         /// limit of the compressed chunks kept in memory for a stream that cannot seek
+         static const size_t max_kept_size = 512*1024*1024;
+
+      private:
+         struct section_entry {
+            std::string    name;
+            std::streampos pos = -1;      ///< position of the first chunk, if the stream can seek
+            std::string    chunks;        ///< compressed chunks, if the stream cannot seek
+            bool           available = true;
+         };
+
+         bool find_section( const string& section_name, bool open );
+         void open_section( std::istream& in, section_entry& entry, section_entry* capture );
+         void finish_section();
+         bool read_chunk();
+         void skip_chunks( std::istream& in, section_entry* capture );
+         void keep( section_entry* capture, const char* data, size_t size );
+
+         std::istream&             snapshot;
+         uint32_t                  actual_magic = 0;
+         uint32_t                  version = 0;
+         bool                      seekable = false;
+         bool                      keeping = false;     ///< keep the chunks of sections read from the stream in memory
+         bool                      rewound = false;
+         bool                      at_end = false;
+         size_t                    kept_size = 0;
+         std::streampos            next_section_pos = -1; ///< only if the stream can seek
+         std::deque<section_entry> sections;              ///< sections seen so far, in order
+         fc::optional<fc::sha256>  trailer_hash;
+
+         // section being read
+         section_entry*            cur_section = nullptr;
+         std::istream*             cur_in = nullptr;
+         section_entry*            cur_capture = nullptr;
+         bool                      cur_empty = true;
+         bool                      section_done = true;
+         detail::char_range_buf    memory_buf;
+         std::istream              memory_in;
+         std::vector<char>         rows;
+         detail::char_range_buf    rows_buf;
+         std::istream              rows_in;
+         uint32_t                  chunk_rows_left = 0;
+   };
+
+}}
\ No newline at end of file
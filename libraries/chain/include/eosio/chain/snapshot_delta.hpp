@@ -0,0 +1,136 @@
+#pragma once
+
+#include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/types.hpp>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Digests of the sections and contract tables of a snapshot, kept by the node that wrote it so that its next snapshot
+    * can be written as a delta. Offsets and sizes refer to the packed rows of a section, which are the same in every
+    * full snapshot of a given state.
+    */
+   struct snapshot_manifest {
+      struct section {
+         std::string  name;
+         fc::sha256   digest;
+         uint64_t     rows = 0;
+      };
+
+      struct table {
+         account_name code;
+         scope_name   scope;
+         table_name   table;
+         fc::sha256   digest;
+         uint64_t     offset = 0; ///< in the packed rows of the contract_tables section
+         uint64_t     size = 0;
+         uint64_t     rows = 0;
+      };
+
+      fc::sha256             integrity_hash; ///< the one controller::calculate_integrity_hash returns for the state
+      std::vector<section>   sections;       ///< in snapshot order
+      std::vector<table>     tables;         ///< contract tables in snapshot order
+   };
+
+   /**
+    * Layout of the full snapshot a delta snapshot produces once applied to its base: every section in order, taken
+    * either from the base or from the delta. The contract_tables section is put together from the list of
+    * snapshot_delta_table rows.
+    */
+   struct snapshot_delta_header {
+      struct section {
+         std::string  name;
+         bool         from_base = false;
+      };
+
+      fc::sha256             base_integrity_hash;
+      fc::sha256             integrity_hash;
+      std::vector<section>   sections;
+   };
+
+   /// a contract table of a delta snapshot, its packed rows are in the contract_tables section of either the base or the delta
+   struct snapshot_delta_table {
+      uint64_t  offset = 0;
+      uint64_t  size = 0;
+      uint64_t  rows = 0;
+      bool      from_base = false;
+   };
+
+   /**
+    * Passes a snapshot on to another writer, either whole or as a delta against the snapshot described by a base
+    * manifest, and builds the manifest of the snapshot written.
+    *
+    * A delta holds the sections whose rows changed and the contract tables whose rows changed, along with a
+    * snapshot_delta_header and the snapshot_delta_table list; everything else is taken from the base when the delta is
+    * applied with apply_snapshot_delta. Sections other than contract_tables are held in memory until they are complete.
+    * Contract tables have to be added one table at a time with add_table, which the controller does when it writes to
+    * a snapshot_delta_writer. The writer passed to must support packed rows.
+    */
+   class snapshot_delta_writer : public snapshot_writer {
+      public:
+         snapshot_delta_writer( const snapshot_writer_ptr& out, const fc::optional<snapshot_manifest>& base );
+
+         void write_start_section( const std::string& section_name ) override;
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_end_section( ) override;
+         void write_packed_rows( const char* data, size_t size, uint64_t num_rows ) override;
+         bool supports_packed_rows()const override { return true; }
+
+         /// add the rows of one table to the contract_tables section
+         void add_table( account_name code, scope_name scope, table_name table, const detail::buffered_snapshot_rows& rows );
+
+         /// write the delta description if this is a delta, the writer passed to still has to be finalized
+         void finalize();
+
+         bool is_delta()const { return base.valid(); }
+
+         /// @return manifest of the snapshot, complete once finalized
+         const snapshot_manifest& manifest()const { return result; }
+
+      private:
+         using table_key = std::tuple<account_name, scope_name, table_name>;
+
+         snapshot_writer_ptr                                         out;
+         fc::optional<snapshot_manifest>                             base;
+         std::map<std::string, const snapshot_manifest::section*>    base_sections;
+         std::map<table_key, const snapshot_manifest::table*>        base_tables;
+         snapshot_manifest                                           result;
+         snapshot_delta_header                                       header;
+         std::vector<snapshot_delta_table>                           tables;
+         fc::sha256::encoder                                         integrity;
+
+         // section being written
+         std::string                section_name;
+         bool                       in_section = false;
+         bool                       in_tables = false;
+         std::string                rows;
+         detail::string_append_buf  rows_buf;
+         std::ostream               rows_stream;
+         detail::ostream_wrapper    rows_out;
+         uint64_t                   row_count = 0;
+         fc::sha256::encoder        tables_enc;
+         uint64_t                   tables_size = 0;       ///< of the packed rows of all contract tables
+         uint64_t                   delta_tables_size = 0; ///< of the packed rows of the contract tables in the delta
+   };
+
+   /**
+    * Write to out the full binary snapshot made of the delta snapshot read from delta applied to the snapshot read from
+    * base. Both have to be binary snapshots of version 2 or later and out is finalized.
+    *
+    * @param base_integrity_hash - if set, the integrity hash the delta has to be based on
+    * @return the integrity hash of the snapshot written, which is checked against the one recorded in the delta
+    */
+   fc::sha256 apply_snapshot_delta( std::istream& base, std::istream& delta, std::ostream& out,
+                                    const fc::optional<fc::sha256>& base_integrity_hash = {} );
+
+   /// @return true if the binary snapshot read from snapshot is a delta snapshot, the read position is restored
+   bool is_snapshot_delta( std::istream& snapshot );
+
+} } /// eosio::chain
+
+FC_REFLECT(eosio::chain::snapshot_manifest::section, (name)(digest)(rows))
+FC_REFLECT(eosio::chain::snapshot_manifest::table, (code)(scope)(table)(digest)(offset)(size)(rows))
+FC_REFLECT(eosio::chain::snapshot_manifest, (integrity_hash)(sections)(tables))
+FC_REFLECT(eosio::chain::snapshot_delta_header::section, (name)(from_base))
+FC_REFLECT(eosio::chain::snapshot_delta_header, (base_integrity_hash)(integrity_hash)(sections))
+FC_REFLECT(eosio::chain::snapshot_delta_table, (offset)(size)(rows)(from_base))
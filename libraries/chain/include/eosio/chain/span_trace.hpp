@@ -0,0 +1,61 @@
+#pragma once
+
+#include <fc/time.hpp>
+
+#include <atomic>
+#include <ostream>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Spans of the hot paths of the controller, transaction_context and apply_context, each recorded into a ring buffer
+    * of the thread it ran on while enabled, so that the cause of a slow block -- authorization, WASM execution, a
+    * database intrinsic, resource accounting, commit or the signals to plugins -- can be seen on a timeline.
+    *
+    * Recording is lock free, a thread only writes its own ring buffer. Disabled, a span costs a relaxed atomic load.
+    */
+   class span_trace {
+   public:
+      /**
+       * Start recording, dropping the spans kept so far
+       * @param spans_per_thread - spans each thread keeps, the oldest are overwritten; 0 disables recording
+       */
+      static void enable( uint32_t spans_per_thread );
+      static void disable();
+      static bool enabled() { return _enabled.load( std::memory_order_relaxed ); }
+
+      /// @param name - a string literal, only the pointer is kept
+      static void record( const char* name, const fc::time_point& start, const fc::microseconds& duration );
+
+      /**
+       * Write the spans kept by all threads in the JSON trace event format of Chrome, which Perfetto reads as well.
+       * Spans overwritten while they are written may come out garbled.
+       */
+      static void write_chrome_trace( std::ostream& out );
+
+   private:
+      static std::atomic<bool> _enabled;
+   };
+
+   /// records a span from its construction to its destruction under name, a string literal
+   class scoped_span {
+   public:
+      explicit scoped_span( const char* name )
+      :_name( span_trace::enabled() ? name : nullptr )
+      {
+         if( _name ) _start = fc::time_point::now();
+      }
+
+      ~scoped_span() {
+         if( _name ) span_trace::record( _name, _start, fc::time_point::now() - _start );
+      }
+
+      scoped_span( const scoped_span& ) = delete;
+      scoped_span& operator=( const scoped_span& ) = delete;
+
+   private:
+      const char*     _name;
+      fc::time_point  _start;
+   };
+
+} } /// namespace eosio::chain
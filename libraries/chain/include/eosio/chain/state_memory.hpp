@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chainbase/pinnable_mapped_file.hpp>
+#include <eosio/chain/name.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace chainbase {
+   class database;
+}
+
+namespace eosio { namespace chain {
+
+   /// NUMA memory policy of the chain state database
+   enum class db_numa_policy {
+      none,        ///< pages are placed on the node of the thread that first touches them
+      interleave,  ///< pages are spread round robin over the nodes
+      bind         ///< pages are placed on the nodes only
+   };
+
+   /**
+    * Places the memory of an open chain state database as configured. Pages of the "heap" and "locked" modes are already
+    * in memory, they are migrated to the nodes of the NUMA policy. Pages of the "mapped" mode are faulted in ahead of use,
+    * which is also how the NUMA policy applies to them since a policy only affects pages allocated afterwards and is
+    * ignored for shared file mappings. Both run on a thread of their own, stopped on destruction, which in "mapped"
+    * mode then stays to write the database back to its file on request.
+    *
+    * Only supported on Linux, the other platforms ignore the options.
+    *
+    * In "mapped" mode it also writes the database back to its file, see flush, and reads ahead the pages
+    * of the contract rows a contract used the last time it ran, see prefetch.
+    */
+   class state_memory {
+   public:
+      struct options {
+         db_numa_policy             numa_policy = db_numa_policy::none;
+         std::vector<uint32_t>      numa_nodes;                      ///< of the policy, all online nodes if empty
+         bool                       transparent_huge_pages = false;  ///< advise the kernel to back the database with them
+         bool                       prefault = false;                ///< fault the pages of the "mapped" mode in
+         uint32_t                   prefetch_pages = 0;              ///< per contract remembered for prefetch, 0 disables it
+      };
+
+      state_memory( chainbase::database& db, chainbase::pinnable_mapped_file::map_mode mode, const options& opts );
+      ~state_memory();
+
+      state_memory( const state_memory& ) = delete;
+      state_memory& operator=( const state_memory& ) = delete;
+
+      /**
+       * Asks the thread of this object to write the pages of the database modified since its last write back to the
+       * file, without waiting for them, the database going on being modified meanwhile. Requests made while a write
+       * is underway make one write after it. Nothing to do in "heap" and "locked" modes.
+       * @return true if requested
+       */
+      bool flush();
+
+      /// whether record_access remembers anything, only in "mapped" mode with prefetch_pages
+      bool records_access()const { return _prefetch_pages > 0; }
+
+      /**
+       * Remembers the pages of objects of the database a contract's action used, in place of those of its previous
+       * action, up to prefetch_pages of them. Thread safe.
+       */
+      void record_access( account_name contract, const std::vector<const void*>& objects );
+
+      /**
+       * Asks the kernel to read the pages remembered for the contracts in, without waiting for them. The pages may
+       * hold other objects by now, which only makes the hint useless. Thread safe.
+       */
+      void prefetch( const std::vector<account_name>& contracts );
+
+   private:
+      void write_back();
+
+      char*              _segment = nullptr;      ///< written from the page it starts in
+      size_t             _segment_size = 0;
+      bool               _mapped = false;
+      std::thread        _thread;
+      std::atomic<bool>  _stop{false};
+      std::mutex              _flush_mtx;
+      std::condition_variable _flush_cv;
+      bool                    _flush_requested = false;
+
+      const uint32_t     _prefetch_pages = 0;
+      std::mutex         _access_mtx;
+      std::unordered_map<account_name, std::vector<uintptr_t>> _access_pages; ///< page addresses, sorted
+   };
+
+} } // eosio::chain
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <eosio/chain/exceptions.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace eosio { namespace chain {
+
+   namespace detail {
+      /// the content of the sequence file, mapped by the writer and its readers
+      struct state_sequence_header {
+         static constexpr uint64_t magic_value = 0x31514553534f45ull; ///< "EOSSEQ1"
+         std::atomic<uint64_t>  magic{0};
+         std::atomic<uint64_t>  sequence{0};        ///< odd while the state is written
+         std::atomic<uint32_t>  head_block_num{0};  ///< of the state, when the sequence is even
+      };
+   }
+
+   /**
+    * Publishes to other processes when the chain state database of this one is the state at a block, so that they can
+    * read it from the database file they map read-only while this one goes on applying blocks to it. The sequence of
+    * a small file next to the database is odd while the state is written and advanced to the next even value, along
+    * with the head block number, once the state is again that of a block; see state_sequence_reader.
+    *
+    * Only meaningful with the "mapped" database map mode, the others writing the database back to its file on
+    * exit only. The sequence is odd from construction until the first end_write. Only the thread writing the state
+    * may call its functions.
+    */
+   class state_sequence_writer {
+   public:
+      /// @param file - created if it does not exist, its sequence carried on otherwise
+      explicit state_sequence_writer( const std::string& file );
+      ~state_sequence_writer();
+
+      state_sequence_writer( const state_sequence_writer& ) = delete;
+      state_sequence_writer& operator=( const state_sequence_writer& ) = delete;
+
+      /// the state is about to be written, no-op if it already is
+      void begin_write();
+
+      /// the state is that of block head_block_num, no-op unless writing
+      void end_write( uint32_t head_block_num );
+
+      bool writing()const { return _header->sequence.load( std::memory_order_relaxed ) & 1; }
+
+   private:
+      detail::state_sequence_header*  _header = nullptr;
+   };
+
+   /**
+    * Reads the chain state database of the process publishing its sequence with state_sequence_writer. A read is
+    * consistent when the sequence was even when it started and is unchanged when it ends, the state having been
+    * that of a block all along. A read racing a write may see half modified objects and indices, so it must only
+    * look the objects up and copy what it needs, leaving anything more to after the read was found consistent.
+    */
+   class state_sequence_reader {
+   public:
+      explicit state_sequence_reader( const std::string& file );
+      ~state_sequence_reader();
+
+      state_sequence_reader( const state_sequence_reader& ) = delete;
+      state_sequence_reader& operator=( const state_sequence_reader& ) = delete;
+
+      /// @return the sequence to give to consistent once the state is read, odd if it is being written
+      uint64_t begin()const { return _header->sequence.load( std::memory_order_acquire ); }
+
+      /// whether what was read since begin returned sequence is the state of a block
+      bool consistent( uint64_t sequence )const {
+         std::atomic_thread_fence( std::memory_order_acquire );
+         return !(sequence & 1) && _header->sequence.load( std::memory_order_relaxed ) == sequence;
+      }
+
+      /// of the state read, valid when read consistently
+      uint32_t head_block_num()const { return _header->head_block_num.load( std::memory_order_relaxed ); }
+
+      /**
+       * Calls f until it ran consistently, at most max_attempts times, yielding the thread while the state is written.
+       * An exception thrown by f is rethrown when the state was that of a block meanwhile, and taken for a sign of a
+       * racing write otherwise.
+       * @return what f returned from its consistent call
+       * @throws state_sequence_exception if no call was consistent
+       */
+      template<typename F>
+      auto read( F&& f, uint32_t max_attempts = 100 ) -> decltype( f() ) {
+         for( uint32_t attempt = 0; attempt < max_attempts; ++attempt ) {
+            const uint64_t sequence = begin();
+            if( sequence & 1 ) {
+               yield();
+               continue;
+            }
+            try {
+               auto result = f();
+               if( consistent( sequence ) ) return result;
+            } catch( ... ) {
+               if( consistent( sequence ) ) throw;
+            }
+         }
+         EOS_THROW( state_sequence_exception, "chain state was written during each of ${n} reads", ("n", max_attempts) );
+      }
+
+   private:
+      static void yield();
+
+      const detail::state_sequence_header*  _header = nullptr;
+   };
+
+} } /// namespace eosio::chain
@@ -4,11 +4,28 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/asio/post.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 namespace eosio { namespace chain {
 
+   /**
+    * The CPUs of cpu options, such as chain-threads-cpu, given once or more. Each spec is a CPU number, a range of
+    * them as 0-3, a list of those as 0-3,8, or node<n> for the CPUs of NUMA node n. Throws plugin_config_exception.
+    */
+   std::vector<uint16_t> parse_cpus( const std::vector<std::string>& specs );
+
+   /// pin the calling thread to any of cpus, nothing if cpus is empty, and log the CPUs it may run on as name
+   void pin_current_thread( const std::string& name, const std::vector<uint16_t>& cpus );
+
    /**
     * Wrapper class for boost asio thread pool and io_context run.
     * Also names threads so that tools like htop can see thread name.
@@ -17,7 +34,8 @@ namespace eosio { namespace chain {
    public:
       // name_prefix is name appended with -## of thread.
       // short name_prefix (6 chars or under) is recommended as console_appender uses 9 chars for thread name
-      named_thread_pool( std::string name_prefix, size_t num_threads );
+      // thread i is pinned to cpus[i % cpus.size()] when cpus are given
+      named_thread_pool( std::string name_prefix, size_t num_threads, std::vector<uint16_t> cpus = {} );
 
       // calls stop()
       ~named_thread_pool();
@@ -44,6 +62,166 @@ namespace eosio { namespace chain {
       return task->get_future();
    }
 
+
+   /**
+    * Thread pool for the tasks of the chain, whose threads do not share a single queue as those of named_thread_pool
+    * share their io_context: each thread has a queue of its own and takes from the queues of the others when its own
+    * is empty. Tasks are queued round-robin, or on the queue of the submitting thread when it is a thread of the pool,
+    * and start in the order they were queued on each queue. A task of up to task_size bytes is moved into the queue
+    * as is, so submitting it allocates nothing.
+    *
+    * There is no io_context to run sockets or timers on, named_thread_pool remains for those.
+    */
+   class work_stealing_pool {
+   public:
+      static constexpr size_t task_size      = 128;  ///< bytes of a task stored in the queue as is, larger ones are allocated
+      static constexpr size_t queue_capacity = 1024; ///< tasks of the queue of a thread
+
+      // name_prefix is name appended with -## of thread, as for named_thread_pool.
+      // thread i is pinned to cpus[i % cpus.size()] when cpus are given
+      work_stealing_pool( std::string name_prefix, size_t num_threads, std::vector<uint16_t> cpus = {} );
+
+      // calls stop()
+      ~work_stealing_pool();
+
+      work_stealing_pool( const work_stealing_pool& ) = delete;
+      work_stealing_pool& operator=( const work_stealing_pool& ) = delete;
+
+      /// f is run on the submitting thread when all the queues are full, and destroyed without running after stop()
+      template<typename F>
+      void post( F&& f ) {
+         task t( std::forward<F>( f ) );
+         if( !push( t ) && !_stopped ) t();
+      }
+
+      // join the threads, the tasks not started are destroyed without running
+      void stop();
+
+      size_t size()const { return _workers.size(); }
+
+   private:
+      /// a move-only callable stored in place
+      class task {
+      public:
+         task() = default;
+
+         template<typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, task>::value>>
+         explicit task( F&& f ) {
+            using T = std::decay_t<F>;
+            if constexpr( sizeof(T) <= task_size && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<T>::value ) {
+               new (&_storage) T( std::forward<F>( f ) );
+               _ops = &ops_of<T>::value;
+            } else {
+               using H = allocated<T>;
+               new (&_storage) H{ std::make_unique<T>( std::forward<F>( f ) ) };
+               _ops = &ops_of<H>::value;
+            }
+         }
+
+         task( task&& o ) noexcept { *this = std::move( o ); }
+
+         task& operator=( task&& o ) noexcept {
+            if( this == &o ) return *this;
+            reset();
+            if( o._ops ) {
+               o._ops->move( &o._storage, &_storage );
+               _ops = o._ops;
+               o.reset();
+            }
+            return *this;
+         }
+
+         ~task() { reset(); }
+
+         explicit operator bool()const { return _ops != nullptr; }
+
+         /// runs the callable once, and destroys it
+         void operator()() {
+            struct destroy {
+               task& t;
+               ~destroy() { t.reset(); }
+            } d{ *this };
+            _ops->invoke( &_storage );
+         }
+
+      private:
+         struct ops {
+            void (*invoke)( void* );
+            void (*move)( void* from, void* to );
+            void (*destroy)( void* );
+         };
+
+         template<typename T>
+         struct ops_of {
+            static constexpr ops value = {
+               []( void* p ) { (*static_cast<T*>( p ))(); },
+               []( void* from, void* to ) { new (to) T( std::move( *static_cast<T*>( from ) ) ); },
+               []( void* p ) { static_cast<T*>( p )->~T(); }
+            };
+         };
+
+         template<typename T>
+         struct allocated {
+            std::unique_ptr<T> f;
+            void operator()() { (*f)(); }
+         };
+
+         void reset() {
+            if( _ops ) _ops->destroy( &_storage );
+            _ops = nullptr;
+         }
+
+         std::aligned_storage_t<task_size, alignof(std::max_align_t)>  _storage;
+         const ops*                                                    _ops = nullptr;
+      };
+
+      struct worker {
+         std::mutex               mtx;   ///< guards the ring below
+         std::unique_ptr<task[]>  ring;
+         size_t                   first = 0;
+         size_t                   count = 0;
+         std::thread              thread;
+      };
+
+      /// false when all the queues are full, or after stop()
+      bool push( task& t );
+      bool push_to( size_t w, task& t );
+      bool pop_from( size_t w, task& t );
+      void run( size_t w );
+
+      std::vector<std::unique_ptr<worker>>  _workers;
+      std::atomic<size_t>                   _next{0};    ///< queue of the next task submitted from outside the pool
+      std::atomic<size_t>                   _queued{0};  ///< in all the queues
+      std::atomic<size_t>                   _sleeping{0};
+      std::atomic<bool>                     _stopped{false};
+      std::mutex                            _sleep_mtx;
+      std::condition_variable               _sleep_cv;
+   };
+
+   namespace detail {
+      template<typename R, typename F>
+      void set_promise( std::promise<R>& p, F& f ) { p.set_value( f() ); }
+
+      template<typename F>
+      void set_promise( std::promise<void>& p, F& f ) { f(); p.set_value(); }
+   }
+
+   // async on thread_pool and return future, the only allocation is of the state of the future
+   template<typename F>
+   auto async_thread_pool( work_stealing_pool& thread_pool, F&& f ) {
+      using result_type = decltype( f() );
+      std::promise<result_type> p;
+      auto fut = p.get_future();
+      thread_pool.post( [p{std::move( p )}, f{std::forward<F>( f )}]() mutable {
+         try {
+            detail::set_promise( p, f );
+         } catch( ... ) {
+            p.set_exception( std::current_exception() );
+         }
+      } );
+      return fut;
+   }
+
 } } // eosio::chain
 
 
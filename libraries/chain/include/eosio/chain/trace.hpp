@@ -16,6 +16,26 @@ namespace eosio { namespace chain {
       friend bool operator<( const account_delta& lhs, const account_delta& rhs ) { return lhs.account < rhs.account; }
    };
 
+   /**
+    * A contract table row an action read or wrote, only recorded when the controller traces row accesses
+    */
+   struct row_access {
+      account_name code;
+      scope_name   scope;
+      table_name   table;
+      uint64_t     primary_key = 0;
+      bool         write = false;
+
+      friend bool operator<( const row_access& lhs, const row_access& rhs ) {
+         return std::tie( lhs.code, lhs.scope, lhs.table, lhs.primary_key, lhs.write )
+              < std::tie( rhs.code, rhs.scope, rhs.table, rhs.primary_key, rhs.write );
+      }
+      friend bool operator==( const row_access& lhs, const row_access& rhs ) {
+         return std::tie( lhs.code, lhs.scope, lhs.table, lhs.primary_key, lhs.write )
+             == std::tie( rhs.code, rhs.scope, rhs.table, rhs.primary_key, rhs.write );
+      }
+   };
+
    struct transaction_trace;
    using transaction_trace_ptr = std::shared_ptr<transaction_trace>;
 
@@ -44,6 +64,7 @@ namespace eosio { namespace chain {
       flat_set<account_delta>         account_ram_deltas;
       fc::optional<fc::exception>     except;
       fc::optional<uint64_t>          error_code;
+      vector<row_access>              row_accesses; ///< sorted, empty unless the controller traces row accesses
    };
 
    struct transaction_trace {
@@ -84,10 +105,13 @@ namespace eosio { namespace chain {
 FC_REFLECT( eosio::chain::account_delta,
             (account)(delta) )
 
+FC_REFLECT( eosio::chain::row_access,
+            (code)(scope)(table)(primary_key)(write) )
+
 FC_REFLECT( eosio::chain::action_trace,
                (action_ordinal)(creator_action_ordinal)(closest_unnotified_ancestor_action_ordinal)(receipt)
                (receiver)(act)(context_free)(elapsed)(console)(trx_id)(block_num)(block_time)
-               (producer_block_id)(account_ram_deltas)(except)(error_code) )
+               (producer_block_id)(account_ram_deltas)(except)(error_code)(row_accesses) )
 
 FC_REFLECT( eosio::chain::transaction_trace, (id)(block_num)(block_time)(producer_block_id)
                                              (receipt)(elapsed)(net_usage)(scheduled)
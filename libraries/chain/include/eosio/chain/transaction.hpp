@@ -137,6 +137,7 @@ namespace eosio { namespace chain {
       enum class compression_type {
          none = 0,
          zlib = 1,
+         zstd = 2, ///< only accepted once ZSTD_TRANSACTION_COMPRESSION is activated
       };
 
       packed_transaction() = default;
@@ -146,14 +147,14 @@ namespace eosio { namespace chain {
       packed_transaction& operator=(packed_transaction&&) = default;
 
       explicit packed_transaction(const signed_transaction& t, compression_type _compression = compression_type::none)
-      :signatures(t.signatures), compression(_compression), unpacked_trx(t), trx_id(unpacked_trx.id())
+      :signatures(t.signatures), compression(_compression), unpacked_trx(std::make_shared<const signed_transaction>(t)), trx_id(unpacked_trx->id())
       {
          local_pack_transaction();
          local_pack_context_free_data();
       }
 
       explicit packed_transaction(signed_transaction&& t, compression_type _compression = compression_type::none)
-      :signatures(t.signatures), compression(_compression), unpacked_trx(std::move(t)), trx_id(unpacked_trx.id())
+      :signatures(t.signatures), compression(_compression), unpacked_trx(std::make_shared<const signed_transaction>(std::move(t))), trx_id(unpacked_trx->id())
       {
          local_pack_transaction();
          local_pack_context_free_data();
@@ -178,10 +179,12 @@ namespace eosio { namespace chain {
       const transaction_id_type& id()const { return trx_id; }
       bytes               get_raw_transaction()const;
 
-      time_point_sec                expiration()const { return unpacked_trx.expiration; }
-      const vector<bytes>&          get_context_free_data()const { return unpacked_trx.context_free_data; }
-      const transaction&            get_transaction()const { return unpacked_trx; }
-      const signed_transaction&     get_signed_transaction()const { return unpacked_trx; }
+      time_point_sec                expiration()const { return unpacked_trx->expiration; }
+      const vector<bytes>&          get_context_free_data()const { return unpacked_trx->context_free_data; }
+      const transaction&            get_transaction()const { return *unpacked_trx; }
+      const signed_transaction&     get_signed_transaction()const { return *unpacked_trx; }
+      /// true when both were copied from the same packed_transaction, and so hold the same unpacked transaction
+      bool                          shares_unpacked( const packed_transaction& other )const { return unpacked_trx == other.unpacked_trx; }
       const vector<signature_type>& get_signatures()const { return signatures; }
       const fc::enum_type<uint8_t,compression_type>& get_compression()const { return compression; }
       const bytes&                  get_packed_context_free_data()const { return packed_context_free_data; }
@@ -189,7 +192,7 @@ namespace eosio { namespace chain {
 
    private:
       void local_unpack_transaction(vector<bytes>&& context_free_data);
-      void local_unpack_context_free_data();
+      vector<bytes> local_unpack_context_free_data()const;
       void local_pack_transaction();
       void local_pack_context_free_data();
 
@@ -204,8 +207,9 @@ namespace eosio { namespace chain {
       bytes                                   packed_trx;
 
    private:
-      // cache unpacked trx, for thread safety do not modify after construction
-      signed_transaction                      unpacked_trx;
+      // cache unpacked trx, for thread safety do not modify after construction. Copies of the packed_transaction,
+      // as the ones held by block receipts and by transaction_metadata, share it rather than unpacking it again.
+      std::shared_ptr<const signed_transaction> unpacked_trx = std::make_shared<const signed_transaction>();
       transaction_id_type                     trx_id;
    };
 
@@ -220,6 +224,6 @@ FC_REFLECT( eosio::chain::transaction_header, (expiration)(ref_block_num)(ref_bl
                                               (max_net_usage_words)(max_cpu_usage_ms)(delay_sec) )
 FC_REFLECT_DERIVED( eosio::chain::transaction, (eosio::chain::transaction_header), (context_free_actions)(actions)(transaction_extensions) )
 FC_REFLECT_DERIVED( eosio::chain::signed_transaction, (eosio::chain::transaction), (signatures)(context_free_data) )
-FC_REFLECT_ENUM( eosio::chain::packed_transaction::compression_type, (none)(zlib))
+FC_REFLECT_ENUM( eosio::chain::packed_transaction::compression_type, (none)(zlib)(zstd))
 // @ignore unpacked_trx
 FC_REFLECT( eosio::chain::packed_transaction, (signatures)(compression)(packed_context_free_data)(packed_trx) )
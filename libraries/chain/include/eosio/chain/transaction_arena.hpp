@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Monotonic memory of the temporaries of a transaction: every allocation is carved out of the current block and
+    * nothing is returned until the arena is destroyed with its transaction_context. The apply_contexts of a transaction
+    * come and go with every action and notification, their iterator caches and queues are allocated from it so that
+    * their memory is not acquired and released again per action.
+    *
+    * Not thread safe, a transaction executes on a single thread.
+    */
+   class transaction_arena {
+   public:
+      static constexpr size_t default_block_size = 16*1024;
+
+      explicit transaction_arena( size_t block_size = default_block_size ) : _block_size(block_size) {}
+
+      transaction_arena( const transaction_arena& ) = delete;
+      transaction_arena& operator=( const transaction_arena& ) = delete;
+
+      void* allocate( size_t size, size_t alignment ) {
+         uintptr_t pos = (_pos + alignment - 1) & ~(alignment - 1);
+         if( pos + size > _end ) {
+            next_block( size + alignment );
+            pos = (_pos + alignment - 1) & ~(alignment - 1);
+         }
+         _pos = pos + size;
+         return reinterpret_cast<void*>( pos );
+      }
+
+      /// bytes held by the arena
+      size_t capacity()const { return _capacity; }
+
+   private:
+      void next_block( size_t min_size ) {
+         // larger requests than a block get a block of their own
+         const size_t size = std::max( _block_size, min_size );
+         _blocks.emplace_back( new char[size] );
+         _pos = reinterpret_cast<uintptr_t>( _blocks.back().get() );
+         _end = _pos + size;
+         _capacity += size;
+      }
+
+      const size_t                          _block_size;
+      std::vector<std::unique_ptr<char[]>>  _blocks;
+      uintptr_t                             _pos = 0; ///< address of the first free byte of the current block
+      uintptr_t                             _end = 0; ///< address past the current block
+      size_t                                _capacity = 0;
+   };
+
+   /// allocator of the standard containers on a transaction_arena, deallocation is left to the arena
+   template<typename T>
+   class arena_allocator {
+   public:
+      using value_type = T;
+
+      explicit arena_allocator( transaction_arena& a ) : _arena(&a) {}
+      template<typename U>
+      arena_allocator( const arena_allocator<U>& o ) : _arena(o._arena) {}
+
+      T* allocate( size_t n ) { return static_cast<T*>( _arena->allocate( n * sizeof(T), alignof(T) ) ); }
+      void deallocate( T*, size_t ) {}
+
+      template<typename U>
+      bool operator==( const arena_allocator<U>& o )const { return _arena == o._arena; }
+      template<typename U>
+      bool operator!=( const arena_allocator<U>& o )const { return _arena != o._arena; }
+
+   private:
+      template<typename U> friend class arena_allocator;
+
+      transaction_arena* _arena;
+   };
+
+   template<typename T>
+   using arena_vector = std::vector<T, arena_allocator<T>>;
+
+} } /// namespace eosio::chain
@@ -2,6 +2,7 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/platform_timer.hpp>
+#include <eosio/chain/transaction_arena.hpp>
 #include <signal.h>
 
 namespace eosio { namespace chain {
@@ -134,6 +135,12 @@ namespace eosio { namespace chain {
 
          transaction_checktime_timer   transaction_timer;
 
+         transaction_arena             arena; ///< temporaries of the apply_contexts of the transaction
+
+         /// with the contract usage profiler enabled, the usage of the actions executed, added to it by finalize
+         bool                                                profile_usage = false;
+         vector<contract_usage_profiler::action_usage>       profiled_actions;
+
       private:
          bool                          is_initialized = false;
 
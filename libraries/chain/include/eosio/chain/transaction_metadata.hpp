@@ -11,6 +11,8 @@ namespace boost { namespace asio {
 namespace eosio { namespace chain {
 
 class transaction_metadata;
+class recover_keys_batch;
+class work_stealing_pool;
 using transaction_metadata_ptr = std::shared_ptr<transaction_metadata>;
 using recover_keys_future = std::future<transaction_metadata_ptr>;
 
@@ -23,7 +25,8 @@ class transaction_metadata {
       enum class trx_type {
          input,
          implicit,
-         scheduled
+         scheduled,
+         dry_run      ///< executed against the pending block and always reverted, never included in a block
       };
 
    private:
@@ -34,6 +37,7 @@ class transaction_metadata {
    public:
       const bool                                                 implicit;
       const bool                                                 scheduled;
+      const bool                                                 dry_run;
       bool                                                       accepted = false;       // not thread safe
       uint32_t                                                   billed_cpu_time_us = 0; // not thread safe
 
@@ -50,12 +54,13 @@ class transaction_metadata {
       // creation of tranaction_metadata restricted to start_recover_keys and create_no_recover_keys below, public for make_shared
       explicit transaction_metadata( const private_type& pt, packed_transaction_ptr ptrx,
                                      fc::microseconds sig_cpu_usage, flat_set<public_key_type> recovered_pub_keys,
-                                     bool _implicit = false, bool _scheduled = false)
+                                     bool _implicit = false, bool _scheduled = false, bool _dry_run = false)
          : _packed_trx( std::move( ptrx ) )
          , _sig_cpu_usage( sig_cpu_usage )
          , _recovered_pub_keys( std::move( recovered_pub_keys ) )
          , implicit( _implicit )
-         , scheduled( _scheduled ) {
+         , scheduled( _scheduled )
+         , dry_run( _dry_run ) {
       }
 
       transaction_metadata() = delete;
@@ -70,11 +75,22 @@ class transaction_metadata {
       fc::microseconds signature_cpu_usage()const { return _sig_cpu_usage; }
       const flat_set<public_key_type>& recovered_keys()const { return _recovered_pub_keys; }
 
-      /// Thread safe.
+      /// Thread safe. ThreadPool is boost::asio::io_context or work_stealing_pool.
       /// @returns transaction_metadata_ptr or exception via future
+      template<typename ThreadPool>
       static recover_keys_future
-      start_recover_keys( packed_transaction_ptr trx, boost::asio::io_context& thread_pool,
+      start_recover_keys( packed_transaction_ptr trx, ThreadPool& thread_pool,
                           const chain_id_type& chain_id, fc::microseconds time_limit,
+                          uint32_t max_variable_sig_size = UINT32_MAX, trx_type t = trx_type::input );
+
+      /// Thread safe.
+      /// Recover keys of all trxs using at most num_chunks thread_pool tasks, one future per chunk.
+      /// Transactions that appear more than once in trxs, with identical signatures, are recovered once.
+      /// @returns batch providing transaction_metadata_ptr, or exception, for each of trxs in order
+      template<typename ThreadPool>
+      static recover_keys_batch
+      start_recover_keys( const std::vector<packed_transaction_ptr>& trxs, ThreadPool& thread_pool,
+                          const chain_id_type& chain_id, fc::microseconds time_limit, size_t num_chunks,
                           uint32_t max_variable_sig_size = UINT32_MAX );
 
       /// @returns constructed transaction_metadata with no key recovery (sig_cpu_usage=0, recovered_pub_keys=empty)
@@ -82,9 +98,36 @@ class transaction_metadata {
       create_no_recover_keys( const packed_transaction& trx, trx_type t ) {
          return std::make_shared<transaction_metadata>( private_type(),
                std::make_shared<packed_transaction>( trx ), fc::microseconds(), flat_set<public_key_type>(),
-                     t == trx_type::implicit, t == trx_type::scheduled );
+                     t == trx_type::implicit, t == trx_type::scheduled, t == trx_type::dry_run );
       }
 
 };
 
+/**
+ * Result of transaction_metadata::start_recover_keys for a batch of transactions.
+ * Not thread safe, intended to be consumed by a single thread.
+ */
+class recover_keys_batch {
+public:
+   recover_keys_batch() = default;
+   recover_keys_batch(recover_keys_batch&&) = default;
+   recover_keys_batch& operator=(recover_keys_batch&&) = default;
+
+   size_t size()const { return _dup_of.size(); }
+   bool empty()const { return _dup_of.empty(); }
+
+   /// blocks until the chunk containing transaction i is recovered
+   /// @throws exception of recovery of any transaction in the chunk
+   const transaction_metadata_ptr& get( size_t i );
+
+private:
+   friend class transaction_metadata;
+
+   std::vector<std::future<std::vector<transaction_metadata_ptr>>> _chunk_futures;
+   std::vector<std::vector<transaction_metadata_ptr>>              _chunk_results;
+   std::vector<std::exception_ptr>                                 _chunk_errors;
+   std::vector<size_t>                                             _dup_of;     ///< index in the unique list for each input transaction
+   size_t                                                          _chunk_size = 1;
+};
+
 } } // eosio::chain
@@ -28,11 +28,13 @@ namespace eosio { namespace chain {
 
    struct by_expiration;
    struct by_trx_id;
+   /// the ids are only checked for duplicates, never iterated in id order, expiration keeps the order removal needs
    using transaction_multi_index = chainbase::shared_multi_index_container<
       transaction_object,
       indexed_by<
          ordered_unique< tag<by_id>, BOOST_MULTI_INDEX_MEMBER(transaction_object, transaction_object::id_type, id)>,
-         ordered_unique< tag<by_trx_id>, BOOST_MULTI_INDEX_MEMBER(transaction_object, transaction_id_type, trx_id)>,
+         hashed_unique< tag<by_trx_id>, BOOST_MULTI_INDEX_MEMBER(transaction_object, transaction_id_type, trx_id),
+                        std::hash<transaction_id_type> >,
          ordered_unique< tag<by_expiration>,
             composite_key< transaction_object,
                BOOST_MULTI_INDEX_MEMBER( transaction_object, time_point_sec, expiration ),
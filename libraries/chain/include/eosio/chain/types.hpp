@@ -108,12 +108,12 @@ namespace eosio { namespace chain {
          shared_blob(const shared_blob& s)
          :shared_string(s.get_allocator())
          {
-            assign(s.c_str(), s.size());
+            assign_compact(s.c_str(), s.size());
          }
 
 
          shared_blob& operator=(const shared_blob& s) {
-            assign(s.c_str(), s.size());
+            assign_compact(s.c_str(), s.size());
             return *this;
          }
 
@@ -127,6 +127,15 @@ namespace eosio { namespace chain {
          shared_blob(const allocator_type& a)
          :shared_string(a)
          {}
+
+         /**
+          * assign without the spare capacity string growth leaves, values shorter than the string's internal buffer
+          * are kept in the object instead of a separate allocation
+          */
+         void assign_compact(const char* data, size_t size) {
+            assign(data, size);
+            if( capacity() > size ) shrink_to_fit();
+         }
    };
 
    using action_name      = name;
@@ -190,6 +199,7 @@ namespace eosio { namespace chain {
       account_ram_correction_object_type,
       code_object_type,
       database_header_object_type,
+      kv_object_type,
       OBJECT_TYPE_COUNT ///< Sentry value which contains the number of different object types
    };
 
@@ -847,4 +847,14 @@ namespace eosio { namespace chain { namespace wasm_injections {
          standard_module_injectors _module_injectors;
    };
 
+   /**
+    * Fuses pairs of operators into the one operator doing both, for an interpreter to dispatch fewer of them:
+    * set_local x followed by get_local x into tee_local x, and tee_local x followed by drop into set_local x.
+    * The locals and the stack are the same after either, so the fused code validates, traps and returns as the
+    * original did. Run after the injections, which locate their injected code by offsets into the original.
+    */
+   struct local_op_fusion {
+      static void fuse( IR::Module& mod );
+   };
+
 }}} // namespace wasm_constraints, chain, eosio
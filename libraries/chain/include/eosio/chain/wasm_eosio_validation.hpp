@@ -337,10 +337,11 @@ namespace eosio { namespace chain { namespace wasm_validations {
 
          void validate() {
             _module_validators.validate( *_module );
+            // the constrainers only check the code, nothing is written to new_code
+            wasm_ops::instruction_stream new_code(0);
             for ( auto& fd : _module->functions.defs ) {
                wasm_ops::EOSIO_OperatorDecoderStream<op_constrainers> decoder(fd.code);
                while ( decoder ) {
-                  wasm_ops::instruction_stream new_code(0);
                   auto op = decoder.decodeOp();
                   op->visit( { _module, &new_code, &fd, decoder.index() } );
                }
@@ -111,6 +111,23 @@ namespace eosio { namespace chain {
          //indicate the current LIB. evicts old cache entries
          void current_lib(const uint32_t lib);
 
+         //compiles the given code with EOS VM OC, waiting until deadline at most. returns the number of them compiled,
+         // 0 when EOS VM OC is not enabled. code that is not on chain or fails to compile is skipped
+         size_t compile_ahead(const std::vector<digest_type>& code_hashes, const fc::time_point& deadline);
+
+         //limits the size of the code instantiated modules are kept for, 0 for no limit
+         void set_cache_size(uint64_t bytes);
+
+         struct cache_stats {
+            uint64_t modules = 0;    //< instantiated modules cached
+            uint64_t bytes = 0;      //< of the code they were built from
+            uint64_t max_bytes = 0;  //< 0 for no limit
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+         };
+         cache_stats get_cache_stats() const;
+
          //Calls apply or error on a given code
          void apply(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, apply_context& context);
 
@@ -129,3 +146,4 @@ namespace eosio{ namespace chain {
 }}
 
 FC_REFLECT_ENUM( eosio::chain::wasm_interface::vm_type, (wabt)(eos_vm)(eos_vm_jit)(eos_vm_oc) )
+FC_REFLECT( eosio::chain::wasm_interface::cache_stats, (modules)(bytes)(max_bytes)(hits)(misses)(evictions) )
@@ -13,8 +13,11 @@
 #include <eosio/chain/transaction_context.hpp>
 #include <eosio/chain/code_object.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/metrics.hpp>
 #include <fc/scoped_exit.hpp>
 
+#include <limits>
+
 #include "IR/Module.h"
 #include "Runtime/Intrinsics.h"
 #include "Platform/Platform.h"
@@ -37,6 +40,10 @@ using boost::multi_index_container;
 
 namespace eosio { namespace chain {
 
+   /// of the instantiation caches of all wasm interfaces, defined in wasm_interface.cpp
+   extern metric_counter wasm_cache_hits_metric;
+   extern metric_counter wasm_cache_misses_metric;
+
    namespace eosvmoc { struct config; }
 
    struct wasm_interface_impl {
@@ -47,10 +54,15 @@ namespace eosio { namespace chain {
          std::unique_ptr<wasm_instantiated_module_interface>  module;
          uint8_t                                              vm_type = 0;
          uint8_t                                              vm_version = 0;
+         size_t                                               size = 0;            //< of the code module was built from
+         int64_t                                              instantiate_us = 0;  //< time it took to build module
+         uint64_t                                             executions = 0;      //< times module was asked for to run
+         double                                               eviction_priority = std::numeric_limits<double>::max(); //< lowest is evicted first
       };
       struct by_hash;
       struct by_first_block_num;
       struct by_last_block_num;
+      struct by_eviction_priority;
 
 #ifdef EOSIO_EOS_VM_OC_RUNTIME_ENABLED
       struct eosvmoc_tier {
@@ -83,6 +95,7 @@ namespace eosio { namespace chain {
          if(eosvmoc_tierup) {
             EOS_ASSERT(vm != wasm_interface::vm_type::eos_vm_oc, wasm_exception, "You can't use EOS VM OC as the base runtime when tier up is activated");
             eosvmoc.emplace(data_dir, eosvmoc_config, d);
+            eosvmoc_tierup_threshold = eosvmoc_config.tierup_threshold;
          }
 #endif
       }
@@ -129,9 +142,65 @@ namespace eosio { namespace chain {
          if(eosvmoc) for(auto it = first_it; it != last_it; it++)
             eosvmoc->cc.free_code(it->code_hash, it->vm_version);
 #endif
+         for(auto it = first_it; it != last_it; it++)
+            cached_bytes -= it->size;
          wasm_instantiation_cache.get<by_last_block_num>().erase(first_it, last_it);
       }
 
+      void set_cache_size(uint64_t bytes) {
+         max_cached_bytes = bytes;
+         evict(0);
+      }
+
+      //GreedyDual-Size: an entry is worth the time it takes to rebuild per byte it holds, plus the worth of the last
+      // entry evicted when it was last used, which ages the entries not used since
+      double eviction_priority(const wasm_cache_entry& e) const {
+         return eviction_inflation + double(std::max<int64_t>(e.instantiate_us, 1)) / double(std::max<size_t>(e.size, 1));
+      }
+
+      //drop instantiated modules until adding bytes fits in the cache. the entries are kept, a module is built again
+      // the next time its code is used
+      void evict(size_t bytes) {
+         if(!max_cached_bytes)
+            return;
+         auto& idx = wasm_instantiation_cache.get<by_eviction_priority>();
+         while(cached_bytes && cached_bytes + bytes > max_cached_bytes) {
+            auto it = idx.begin();
+            if(it == idx.end() || !it->module)
+               break;
+            eviction_inflation = it->eviction_priority;
+            cached_bytes -= it->size;
+            ++evictions;
+            idx.modify(it, [](wasm_cache_entry& e) {
+               e.module.reset();
+               e.size = 0;
+               e.eviction_priority = std::numeric_limits<double>::max();
+            });
+         }
+      }
+
+      wasm_interface::cache_stats get_cache_stats() const {
+         wasm_interface::cache_stats stats;
+         for(const auto& e : wasm_instantiation_cache)
+            if(e.module)
+               ++stats.modules;
+         stats.bytes = cached_bytes;
+         stats.max_bytes = max_cached_bytes;
+         stats.hits = hits;
+         stats.misses = misses;
+         stats.evictions = evictions;
+         return stats;
+      }
+
+      //a contract is queued for compiling by EOS VM OC once it ran eosvmoc_tierup_threshold times on the baseline runtime,
+      // so that the compile threads are not spent on contracts that are rarely used
+      bool is_hot(const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version) const {
+         if(!eosvmoc_tierup_threshold)
+            return true;
+         wasm_cache_index::const_iterator it = wasm_instantiation_cache.find(boost::make_tuple(code_hash, vm_type, vm_version));
+         return it != wasm_instantiation_cache.end() && it->executions >= eosvmoc_tierup_threshold;
+      }
+
       const std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module( const digest_type& code_hash, const uint8_t& vm_type,
                                                                                  const uint8_t& vm_version, transaction_context& trx_context )
       {
@@ -151,7 +220,17 @@ namespace eosio { namespace chain {
                                                    } ).first;
          }
 
-         if(!it->module) {
+         if(it->module) {
+            ++hits;
+            wasm_cache_hits_metric.add();
+            wasm_instantiation_cache.modify(it, [this](wasm_cache_entry& e) {
+               ++e.executions;
+               if(max_cached_bytes)
+                  e.eviction_priority = eviction_priority(e);
+            });
+         } else {
+            ++misses;
+            wasm_cache_misses_metric.add();
             if(!codeobject)
                codeobject = &db.get<code_object,by_code_hash>(boost::make_tuple(code_hash, vm_type, vm_version));
 
@@ -159,37 +238,50 @@ namespace eosio { namespace chain {
                trx_context.resume_billing_timer();
             });
             trx_context.pause_billing_timer();
-            IR::Module module;
+            const auto start = fc::time_point::now();
             std::vector<U8> bytes = {
                 (const U8*)codeobject->code.data(),
                 (const U8*)codeobject->code.data() + codeobject->code.size()};
-            try {
-               Serialization::MemoryInputStream stream((const U8*)bytes.data(),
-                                                       bytes.size());
-               WASM::serialize(stream, module);
-               module.userSections.clear();
-            } catch (const Serialization::FatalSerializationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch (const IR::ValidationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            }
-            if (runtime_interface->inject_module(module)) {
+            std::vector<uint8_t> initial_memory;
+            if(runtime_interface->needs_parsed_module()) {
+               IR::Module module;
                try {
-                  Serialization::ArrayOutputStream outstream;
-                  WASM::serialize(outstream, module);
-                  bytes = outstream.getBytes();
+                  Serialization::MemoryInputStream stream((const U8*)bytes.data(),
+                                                          bytes.size());
+                  WASM::serialize(stream, module);
+                  module.userSections.clear();
                } catch (const Serialization::FatalSerializationException& e) {
-                  EOS_ASSERT(false, wasm_serialization_error,
-                             e.message.c_str());
+                  EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
                } catch (const IR::ValidationException& e) {
-                  EOS_ASSERT(false, wasm_serialization_error,
-                             e.message.c_str());
+                  EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+               }
+               if (runtime_interface->inject_module(module)) {
+                  try {
+                     Serialization::ArrayOutputStream outstream;
+                     WASM::serialize(outstream, module);
+                     bytes = outstream.getBytes();
+                  } catch (const Serialization::FatalSerializationException& e) {
+                     EOS_ASSERT(false, wasm_serialization_error,
+                                e.message.c_str());
+                  } catch (const IR::ValidationException& e) {
+                     EOS_ASSERT(false, wasm_serialization_error,
+                                e.message.c_str());
+                  }
                }
+
+               initial_memory = parse_initial_memory(module);
             }
 
+            const size_t size = bytes.size() + initial_memory.size();
+            evict(size);
             wasm_instantiation_cache.modify(it, [&](auto& c) {
-               c.module = runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module), code_hash, vm_type, vm_version);
+               c.module = runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), std::move(initial_memory), code_hash, vm_type, vm_version);
+               c.size = size;
+               c.instantiate_us = (fc::time_point::now() - start).count();
+               c.eviction_priority = eviction_priority(c);
+               ++c.executions;
             });
+            cached_bytes += size;
          }
          return it->module;
       }
@@ -208,11 +300,20 @@ namespace eosio { namespace chain {
                >
             >,
             ordered_non_unique<tag<by_first_block_num>, member<wasm_cache_entry, uint32_t, &wasm_cache_entry::first_block_num_used>>,
-            ordered_non_unique<tag<by_last_block_num>, member<wasm_cache_entry, uint32_t, &wasm_cache_entry::last_block_num_used>>
+            ordered_non_unique<tag<by_last_block_num>, member<wasm_cache_entry, uint32_t, &wasm_cache_entry::last_block_num_used>>,
+            ordered_non_unique<tag<by_eviction_priority>, member<wasm_cache_entry, double, &wasm_cache_entry::eviction_priority>>
          >
       > wasm_cache_index;
       wasm_cache_index wasm_instantiation_cache;
 
+      uint64_t max_cached_bytes = 0; //< 0 to never evict
+      uint64_t cached_bytes = 0;
+      double   eviction_inflation = 0;
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      uint64_t evictions = 0;
+      uint32_t eosvmoc_tierup_threshold = 0;
+
       const chainbase::database& db;
       const wasm_interface::vm_type wasm_runtime_time;
 
@@ -32,6 +32,7 @@ class eosvmoc_runtime : public eosio::chain::wasm_runtime_interface {
       eosvmoc_runtime(const boost::filesystem::path data_dir, const eosvmoc::config& eosvmoc_config, const chainbase::database& db);
       ~eosvmoc_runtime();
       bool inject_module(IR::Module&) override { return false; }
+      bool needs_parsed_module() const override { return false; }
       std::unique_ptr<wasm_instantiated_module_interface> instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory,
                                                                              const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version) override;
 
@@ -45,6 +45,17 @@ class code_cache_base {
 
       void free_code(const digest_type& code_id, const uint8_t& vm_version);
 
+      struct stats {
+         uint64_t hits = 0;                 //lookups of compiled code
+         uint64_t misses = 0;               //lookups of code not compiled, run by another runtime meanwhile
+         uint64_t evictions = 0;
+         size_t   entries = 0;
+         size_t   free_bytes = 0;           //as last reported by the compile monitor
+         size_t   queued_compiles = 0;
+         size_t   outstanding_compiles = 0;
+      };
+      stats get_stats() const;
+
    protected:
       struct by_hash;
 
@@ -71,19 +82,37 @@ class code_cache_base {
       local::datagram_protocol::socket _compile_monitor_write_socket{_ctx};
       local::datagram_protocol::socket _compile_monitor_read_socket{_ctx};
 
+      //code waiting for a compile thread, by the number of times it was run (uncompiled) since it was queued and
+      //when it last was; the most run is compiled first, code not run for a while is dropped from the queue
+      struct queued_compile {
+         uint64_t       requests = 1;
+         fc::time_point last_request;
+      };
+
       //these are really only useful to the async code cache, but keep them here so
       //free_code can be shared
-      std::unordered_set<code_tuple> _queued_compiles;
+      std::unordered_map<code_tuple, queued_compile> _queued_compiles;
       std::unordered_map<code_tuple, bool> _outstanding_compiles_and_poison;
 
       size_t _free_bytes_eviction_threshold;
       void check_eviction_threshold(size_t free_bytes);
+      //evicts from the least recently used entries those least used and cheapest to compile again
       void run_eviction_round();
 
+      //uses of each entry since it was cached, which weigh its eviction
+      std::unordered_map<code_tuple, uint64_t> _use_counts;
+      const code_descriptor* record_hit(code_cache_index::index<by_hash>::type::iterator it);
+      stats _stats;
+
       void set_on_disk_region_dirty(bool);
 
       template <typename T>
       void serialize_cache_index(fc::datastream<T>& ds);
+
+      //exports are only loaded by a nodeos whose cache format, target and intrinsics are identical to the exporting one
+      bfs::path _export_path;
+      void import_code(const bfs::path& path, char* code_mapping, allocator_t* allocator);
+      void export_code(char* code_mapping, allocator_t* allocator);
 };
 
 class code_cache_async : public code_cache_base {
@@ -92,9 +121,15 @@ class code_cache_async : public code_cache_base {
       ~code_cache_async();
 
       //If code is in cache: returns pointer & bumps to front of MRU list
-      //If code is not in cache, and not blacklisted, and not currently compiling: return nullptr and kick off compile
+      //If code is not in cache, and not blacklisted, and not currently compiling: return nullptr and kick off compile,
+      // unless queue_compile is false
       //otherwise: return nullptr
-      const code_descriptor* const get_descriptor_for_code(const digest_type& code_id, const uint8_t& vm_version);
+      const code_descriptor* const get_descriptor_for_code(const digest_type& code_id, const uint8_t& vm_version, bool queue_compile = true);
+
+      //true if compiling code failed, it is not compiled again
+      bool is_blacklisted(const digest_type& code_id, const uint8_t& vm_version) const {
+         return _blacklist.count(code_tuple{code_id, vm_version});
+      }
 
    private:
       std::thread _monitor_reply_thread;
@@ -103,6 +138,8 @@ class code_cache_async : public code_cache_base {
       std::tuple<size_t, size_t> consume_compile_thread_queue();
       std::unordered_set<code_tuple> _blacklist;
       size_t _threads;
+      //the queued compile run most, after dropping the stale ones; end() if none
+      std::unordered_map<code_tuple, queued_compile>::iterator next_queued_compile();
 };
 
 class code_cache_sync : public code_cache_base {
@@ -13,6 +13,9 @@ namespace eosio { namespace chain { namespace eosvmoc {
 struct config {
    uint64_t cache_size = 1024u*1024u*1024u;
    uint64_t threads    = 1u;
+   uint32_t tierup_threshold = 0; ///< times a contract runs on the baseline runtime before it is compiled, 0 to compile on first use
+   std::vector<boost::filesystem::path> import_paths; ///< code cache exports loaded in to the cache on startup
+   boost::filesystem::path              export_path;  ///< if set, the cache is exported here on shutdown
 };
 
 }}}
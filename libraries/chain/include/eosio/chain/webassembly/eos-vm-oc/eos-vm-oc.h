@@ -35,4 +35,6 @@ struct eos_vm_oc_control_block {
    uintptr_t running_code_base;
    int64_t  first_invalid_memory_address;
    unsigned is_running;
+   int64_t  dirty_linear_memory_pages; //linear memory at and above this page has not been written since it was zeroed
+   uint64_t receiver; //of the running action, read by code compiled with current_receiver inline
 };
\ No newline at end of file
@@ -19,6 +19,10 @@ class code_cache_base;
 class memory;
 struct code_descriptor;
 
+//An executor and the memory it runs code in are only used by one thread at a time, but any number of them can run
+// concurrently on different threads: the running code and the SIGSEGV handler locate the control block through the GS
+// register, which is per thread, and an executor's code mapping is its own, so a checktime expiry only stops its code.
+// The code cache is not thread safe; descriptors have to be obtained on the thread that owns it.
 class executor {
    public:
       executor(const code_cache_base& cc);
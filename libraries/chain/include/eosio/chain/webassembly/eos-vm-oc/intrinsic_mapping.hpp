@@ -248,7 +248,19 @@ constexpr auto intrinsic_table = boost::hana::make_tuple(
    "eosio_injection._eosio_i32_to_f64"_s,
    "eosio_injection._eosio_i64_to_f64"_s,
    "eosio_injection._eosio_ui32_to_f64"_s,
-   "eosio_injection._eosio_ui64_to_f64"_s
+   "eosio_injection._eosio_ui64_to_f64"_s,
+   "env.db_get_range_i64"_s,
+   "env.kv_set"_s,
+   "env.kv_erase"_s,
+   "env.kv_get"_s,
+   "env.kv_it_create"_s,
+   "env.kv_it_destroy"_s,
+   "env.kv_it_lower_bound"_s,
+   "env.kv_it_next"_s,
+   "env.kv_it_prev"_s,
+   "env.kv_it_key"_s,
+   "env.kv_it_value"_s,
+   "env.sha256_batch"_s
 );
 
 }}}
\ No newline at end of file
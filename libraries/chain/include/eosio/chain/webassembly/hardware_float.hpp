@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2_MATH__)
+#include <emmintrin.h>
+#endif
+
+namespace eosio { namespace chain { namespace hardware_float {
+
+   /**
+    * The IEEE 754 basic operations of the softfloat intrinsics, done by SSE2 when that gives the same bits.
+    *
+    * Rounded to nearest even, without flushing subnormals, the result of add, sub, mul, div and sqrt is exactly defined
+    * by IEEE 754 and so identical to softfloat's, except for NaN: its sign and payload differ between implementations.
+    * Each function therefore returns false, for the caller to ask softfloat, when the result is NaN or when the MXCSR
+    * of the thread is not the default one (round to nearest, no FTZ or DAZ, all exceptions masked). The sticky
+    * exception flags of the MXCSR are ignored, the softfloat intrinsics do not expose theirs either.
+    */
+#if defined(__SSE2_MATH__)
+   constexpr uint32_t default_mxcsr      = 0x1f80;
+   constexpr uint32_t mxcsr_control_mask = 0xffc0;
+
+   inline bool enabled() {
+      return (_mm_getcsr() & mxcsr_control_mask) == default_mxcsr;
+   }
+
+   inline bool is_nan( float f ) {
+      uint32_t bits;
+      std::memcpy( &bits, &f, sizeof(bits) );
+      return (bits & 0x7fffffffu) > 0x7f800000u;
+   }
+
+   inline bool is_nan( double d ) {
+      uint64_t bits;
+      std::memcpy( &bits, &d, sizeof(bits) );
+      return (bits & 0x7fffffffffffffffull) > 0x7ff0000000000000ull;
+   }
+
+   template<typename T, typename Op>
+   inline bool apply( T& r, Op&& op ) {
+      if( !enabled() ) return false;
+      r = op();
+      return !is_nan( r );
+   }
+
+   inline bool f32_add( float a, float b, float& r ) { return apply( r, [&]() { return _mm_cvtss_f32( _mm_add_ss( _mm_set_ss(a), _mm_set_ss(b) ) ); } ); }
+   inline bool f32_sub( float a, float b, float& r ) { return apply( r, [&]() { return _mm_cvtss_f32( _mm_sub_ss( _mm_set_ss(a), _mm_set_ss(b) ) ); } ); }
+   inline bool f32_mul( float a, float b, float& r ) { return apply( r, [&]() { return _mm_cvtss_f32( _mm_mul_ss( _mm_set_ss(a), _mm_set_ss(b) ) ); } ); }
+   inline bool f32_div( float a, float b, float& r ) { return apply( r, [&]() { return _mm_cvtss_f32( _mm_div_ss( _mm_set_ss(a), _mm_set_ss(b) ) ); } ); }
+   inline bool f32_sqrt( float a, float& r )         { return apply( r, [&]() { return _mm_cvtss_f32( _mm_sqrt_ss( _mm_set_ss(a) ) ); } ); }
+
+   inline bool f64_add( double a, double b, double& r ) { return apply( r, [&]() { return _mm_cvtsd_f64( _mm_add_sd( _mm_set_sd(a), _mm_set_sd(b) ) ); } ); }
+   inline bool f64_sub( double a, double b, double& r ) { return apply( r, [&]() { return _mm_cvtsd_f64( _mm_sub_sd( _mm_set_sd(a), _mm_set_sd(b) ) ); } ); }
+   inline bool f64_mul( double a, double b, double& r ) { return apply( r, [&]() { return _mm_cvtsd_f64( _mm_mul_sd( _mm_set_sd(a), _mm_set_sd(b) ) ); } ); }
+   inline bool f64_div( double a, double b, double& r ) { return apply( r, [&]() { return _mm_cvtsd_f64( _mm_div_sd( _mm_set_sd(a), _mm_set_sd(b) ) ); } ); }
+   inline bool f64_sqrt( double a, double& r )          { return apply( r, [&]() { return _mm_cvtsd_f64( _mm_sqrt_sd( _mm_set_sd(a), _mm_set_sd(a) ) ); } ); }
+#else
+   inline bool enabled() { return false; }
+
+   inline bool f32_add( float, float, float& )  { return false; }
+   inline bool f32_sub( float, float, float& )  { return false; }
+   inline bool f32_mul( float, float, float& )  { return false; }
+   inline bool f32_div( float, float, float& )  { return false; }
+   inline bool f32_sqrt( float, float& )        { return false; }
+
+   inline bool f64_add( double, double, double& ) { return false; }
+   inline bool f64_sub( double, double, double& ) { return false; }
+   inline bool f64_mul( double, double, double& ) { return false; }
+   inline bool f64_div( double, double, double& ) { return false; }
+   inline bool f64_sqrt( double, double& )        { return false; }
+#endif
+
+} } } // eosio::chain::hardware_float
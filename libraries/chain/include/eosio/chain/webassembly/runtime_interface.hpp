@@ -20,6 +20,9 @@ class wasm_instantiated_module_interface {
 class wasm_runtime_interface {
    public:
       virtual bool inject_module(IR::Module& module) = 0;
+      //false when the runtime neither injects the module nor uses its initial memory, the code is then passed to
+      // instantiate_module as it is, without being parsed first
+      virtual bool needs_parsed_module() const { return true; }
       virtual std::unique_ptr<wasm_instantiated_module_interface> instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory,
                                                                                      const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version) = 0;
 
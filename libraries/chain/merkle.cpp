@@ -32,6 +32,12 @@ bool is_canonical_right(const digest_type& val) {
 }
 
 
+digest_type hash_canonical_pair(const digest_type& l, const digest_type& r) {
+   static_assert( sizeof(digest_type) == sizeof(digest_type::_hash), "digest_type packs as its words" );
+   digest_type pair[2] = { make_canonical_left(l), make_canonical_right(r) };
+   return digest_type::hash( reinterpret_cast<const char*>(pair), sizeof(pair) );
+}
+
 digest_type merkle(vector<digest_type> ids) {
    if( 0 == ids.size() ) { return digest_type(); }
 
@@ -40,7 +46,7 @@ digest_type merkle(vector<digest_type> ids) {
          ids.push_back(ids.back());
 
       for (size_t i = 0; i < ids.size() / 2; i++) {
-         ids[i] = digest_type::hash(make_canonical_pair(ids[2 * i], ids[(2 * i) + 1]));
+         ids[i] = hash_canonical_pair(ids[2 * i], ids[(2 * i) + 1]);
       }
 
       ids.resize(ids.size() / 2);
@@ -0,0 +1,115 @@
+#include <eosio/chain/metrics.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+namespace eosio { namespace chain {
+
+namespace {
+
+   struct metrics_registry {
+      std::mutex                            mtx;
+      std::map<std::string, const metric*>  metrics; ///< by name, the order they are written in
+   };
+
+   /// constructed by the first metric, so it outlives all of them
+   metrics_registry& registry() {
+      static metrics_registry r;
+      return r;
+   }
+
+   std::atomic<size_t> next_thread_cell{0};
+
+}
+
+metric::metric( std::string name, std::string help, const char* type )
+:_name( std::move(name) )
+,_help( std::move(help) )
+,_type( type )
+{
+   auto& r = registry();
+   std::lock_guard<std::mutex> g( r.mtx );
+   EOS_ASSERT( r.metrics.emplace( _name, this ).second, misc_exception, "metric ${n} registered twice", ("n", _name) );
+}
+
+metric::~metric() {
+   auto& r = registry();
+   std::lock_guard<std::mutex> g( r.mtx );
+   r.metrics.erase( _name );
+}
+
+size_t metric::thread_cell() {
+   thread_local const size_t cell = next_thread_cell.fetch_add( 1, std::memory_order_relaxed ) % num_cells;
+   return cell;
+}
+
+void metric::write( std::ostream& out )const {
+   out << "# HELP " << _name << ' ' << _help << '\n';
+   out << "# TYPE " << _name << ' ' << _type << '\n';
+   write_samples( out );
+}
+
+metric_counter::metric_counter( std::string name, std::string help )
+:metric( std::move(name), std::move(help), "counter" )
+{}
+
+uint64_t metric_counter::value()const {
+   uint64_t v = 0;
+   for( const auto& c : _cells ) v += c.value.load( std::memory_order_relaxed );
+   return v;
+}
+
+void metric_counter::write_samples( std::ostream& out )const {
+   out << name() << ' ' << value() << '\n';
+}
+
+metric_gauge::metric_gauge( std::string name, std::string help )
+:metric( std::move(name), std::move(help), "gauge" )
+{}
+
+void metric_gauge::write_samples( std::ostream& out )const {
+   out << name() << ' ' << value() << '\n';
+}
+
+metric_histogram::metric_histogram( std::string name, std::string help, std::vector<int64_t> bounds )
+:metric( std::move(name), std::move(help), "histogram" )
+,_bounds( std::move(bounds) )
+{
+   EOS_ASSERT( _bounds.size() <= max_bounds && std::is_sorted( _bounds.begin(), _bounds.end() ), misc_exception,
+               "histogram ${n} needs at most ${m} ascending bounds", ("n", this->name())("m", max_bounds) );
+}
+
+void metric_histogram::observe( int64_t v ) {
+   auto& c = _cells[thread_cell()];
+   const size_t bucket = std::lower_bound( _bounds.begin(), _bounds.end(), v ) - _bounds.begin();
+   c.buckets[bucket].fetch_add( 1, std::memory_order_relaxed );
+   c.sum.fetch_add( v, std::memory_order_relaxed );
+}
+
+void metric_histogram::write_samples( std::ostream& out )const {
+   std::array<uint64_t, max_bounds + 1> buckets{};
+   int64_t sum = 0;
+   for( const auto& c : _cells ) {
+      for( size_t i = 0; i <= _bounds.size(); ++i ) buckets[i] += c.buckets[i].load( std::memory_order_relaxed );
+      sum += c.sum.load( std::memory_order_relaxed );
+   }
+   uint64_t cumulative = 0;
+   for( size_t i = 0; i < _bounds.size(); ++i ) {
+      cumulative += buckets[i];
+      out << name() << "_bucket{le=\"" << _bounds[i] << "\"} " << cumulative << '\n';
+   }
+   cumulative += buckets[_bounds.size()];
+   out << name() << "_bucket{le=\"+Inf\"} " << cumulative << '\n';
+   out << name() << "_sum " << sum << '\n';
+   out << name() << "_count " << cumulative << '\n';
+}
+
+void write_prometheus_metrics( std::ostream& out ) {
+   auto& r = registry();
+   std::lock_guard<std::mutex> g( r.mtx );
+   for( const auto& m : r.metrics ) m.second->write( out );
+}
+
+} } /// namespace eosio::chain
@@ -5,6 +5,7 @@
 #include <fc/fwd_impl.hpp>
 #include <fc/exception/exception.hpp>
 
+#include <limits>
 #include <mutex>
 
 #include <signal.h>
@@ -13,12 +14,50 @@
 namespace eosio { namespace chain {
 
 static_assert(std::atomic_bool::is_always_lock_free, "Only lock-free atomics AS-safe.");
-
+static_assert(std::atomic<int64_t>::is_always_lock_free, "Only lock-free atomics AS-safe.");
+
+/*
+ * The timer is armed lazily: stop() leaves it armed and start() only arms it when it is not armed for the new
+ * deadline or before it. A timer expiring before the current deadline, as it does when armed for the deadline of
+ * a transaction before, arms itself again from the signal handler for the current deadline. During a block the
+ * deadlines of its transactions come in order, so the timer is armed about once per deadline rather than armed
+ * and disarmed for every transaction.
+ */
 struct platform_timer::impl {
+   constexpr static int64_t none = std::numeric_limits<int64_t>::max();
+
    timer_t timerid;
+   std::atomic<int64_t> deadline_us{none}; ///< of the current start(), none when stopped
+   std::atomic<int64_t> armed_us{none};    ///< of the timer, none when it is not armed
+
+   static int64_t now_us() {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      return int64_t(ts.tv_sec)*1000000 + ts.tv_nsec/1000;
+   }
+
+   bool arm(int64_t us) {
+      armed_us = us;
+      struct itimerspec enable = {{0, 0}, {us/1000000, (us%1000000)*1000}};
+      if(timer_settime(timerid, TIMER_ABSTIME, &enable, NULL) == 0)
+         return true;
+      armed_us = none;
+      return false;
+   }
 
    static void sig_handler(int, siginfo_t* si, void*) {
       platform_timer* self = (platform_timer*)si->si_value.sival_ptr;
+      for(;;) {
+         self->my->armed_us = none;
+         const int64_t deadline = self->my->deadline_us;
+         if(deadline == none)
+            return;
+         if(now_us() >= deadline || !self->my->arm(deadline))
+            break;
+         // handled on another thread, this may have overridden what a start() armed meanwhile for an earlier deadline
+         if(self->my->deadline_us == deadline)
+            return;
+      }
       self->expired = 1;
       self->call_expiration_callback();
    }
@@ -34,7 +73,7 @@ platform_timer::platform_timer() {
       struct sigaction act;
       sigemptyset(&act.sa_mask);
       act.sa_sigaction = impl::sig_handler;
-      act.sa_flags = SA_SIGINFO;
+      act.sa_flags = SA_SIGINFO | SA_RESTART; // the timer may expire unneeded, see impl
       FC_ASSERT(sigaction(SIGRTMIN, &act, NULL) == 0, "failed to aquire SIGRTMIN signal");
       initialized = true;
    }
@@ -55,25 +94,26 @@ platform_timer::~platform_timer() {
 
 void platform_timer::start(fc::time_point tp) {
    if(tp == fc::time_point::maximum()) {
+      my->deadline_us = impl::none;
       expired = 0;
       return;
    }
-   fc::microseconds x = tp.time_since_epoch() - fc::time_point::now().time_since_epoch();
-   if(x.count() <= 0)
+   const int64_t deadline = tp.time_since_epoch().count();
+   if(deadline <= impl::now_us()) {
+      my->deadline_us = impl::none;
+      expired = 1;
+      return;
+   }
+   expired = 0;
+   my->deadline_us = deadline;
+   if(my->armed_us > deadline && !my->arm(deadline)) {
+      my->deadline_us = impl::none;
       expired = 1;
-   else {
-      struct itimerspec enable = {{0, 0}, {0, (int)x.count()*1000}};
-      expired = 0;
-      if(timer_settime(my->timerid, 0, &enable, NULL) != 0)
-         expired = 1;
    }
 }
 
 void platform_timer::stop() {
-   if(expired)
-      return;
-   struct itimerspec disable = {{0, 0}, {0, 0}};
-   timer_settime(my->timerid, 0, &disable, NULL);
+   my->deadline_us = impl::none;
    expired = 1;
 }
 
@@ -183,6 +183,56 @@ and may have additional signatures in a block extension with ID `2`.
 Privileged Contracts:
 may continue to use `set_proposed_producers` as they have;
 may use a new `set_proposed_producers_ex` intrinsic to access extended features.
+*/
+            {}
+         } )
+         (  builtin_protocol_feature_t::batched_db_reads, builtin_protocol_feature_spec{
+            "BATCHED_DB_READS",
+            fc::variant("08aa7bda03d15ffb03c56830c4bf7bc06d9eb572ceab46ec14184e5d7fa09d22").as<digest_type>(),
+            // SHA256 hash of the raw message below within the comment delimiters (do not modify message below).
+/*
+Builtin protocol feature: BATCHED_DB_READS
+
+Adds the db_get_range_i64 intrinsic, which copies consecutive rows of a primary index table, starting at an iterator,
+into a buffer in a single call.
+*/
+            {}
+         } )
+         (  builtin_protocol_feature_t::kv_database, builtin_protocol_feature_spec{
+            "KV_DATABASE",
+            fc::variant("73222af47d0d82cd4c5d49d10ed6eb51c7ae627a1b3aa9116e7242e962dfcab9").as<digest_type>(),
+            // SHA256 hash of the raw message below within the comment delimiters (do not modify message below).
+/*
+Builtin protocol feature: KV_DATABASE
+
+Adds a key-value database with arbitrary byte string keys ordered byte by byte, and the kv_set, kv_erase, kv_get,
+kv_it_create, kv_it_destroy, kv_it_lower_bound, kv_it_next, kv_it_prev, kv_it_key and kv_it_value intrinsics to use it.
+A contract writes only its own keys and can read and iterate over the keys of any contract.
+*/
+            {}
+         } )
+         (  builtin_protocol_feature_t::zstd_transaction_compression, builtin_protocol_feature_spec{
+            "ZSTD_TRANSACTION_COMPRESSION",
+            fc::variant("917f3d19207c2324cbfc814417cdeaa4cddaba1e46b44da105fe3b6a53e72348").as<digest_type>(),
+            // SHA256 hash of the raw message below within the comment delimiters (do not modify message below).
+/*
+Builtin protocol feature: ZSTD_TRANSACTION_COMPRESSION
+
+Allows transactions packed with the zstd compression type (2). The packed transaction and its context free data are
+each a single zstd frame, with a window of at most 1 MiB, which may not decompress to more than 1 MiB, the same limit
+as zlib.
+*/
+            {}
+         } )
+         (  builtin_protocol_feature_t::sha256_batch, builtin_protocol_feature_spec{
+            "SHA256_BATCH",
+            fc::variant("2280f66d7ff7a3446b7a136e470364c5cebfeea87752d3838699f8fd83773698").as<digest_type>(),
+            // SHA256 hash of the raw message below within the comment delimiters (do not modify message below).
+/*
+Builtin protocol feature: SHA256_BATCH
+
+Adds the sha256_batch intrinsic, which hashes a sequence of buffers, each a 4-byte little endian size followed by that
+many bytes, and writes their SHA-256 digests one after the other in a single call.
 */
             {}
          } )
@@ -466,13 +516,23 @@ may use a new `set_proposed_producers_ex` intrinsic to access extended features.
          );
       }
 
+      bool enabled = f.subjective_restrictions.enabled;
+#ifndef EOSIO_ZSTD_COMPRESSION_ENABLED
+      // unable to unpack the transactions it allows, a block activating it is rejected rather than those after it
+      if( enabled && f._codename == builtin_protocol_feature_t::zstd_transaction_compression ) {
+         wlog( "Support for builtin protocol feature '${codename}' is disabled: this build does not support zstd",
+               ("codename", f.builtin_feature_codename) );
+         enabled = false;
+      }
+#endif
+
       auto res = _recognized_protocol_features.insert( protocol_feature{
          feature_digest,
          f.description_digest,
          f.dependencies,
          f.subjective_restrictions.earliest_allowed_activation_time,
          f.subjective_restrictions.preactivation_required,
-         f.subjective_restrictions.enabled,
+         enabled,
          f._codename
       } );
 
@@ -496,6 +556,8 @@ may use a new `set_proposed_producers_ex` intrinsic to access extended features.
    :_protocol_feature_set( std::move(pfs) )
    {
       _builtin_protocol_features.resize( _protocol_feature_set._recognized_builtin_protocol_features.size() );
+      EOS_ASSERT( _builtin_protocol_features.size() <= _activated_builtins.size(), protocol_feature_exception,
+                  "invariant failure: ${n} builtin protocol features do not fit the activated builtin bitset", ("n", _builtin_protocol_features.size()) );
    }
 
    void protocol_feature_manager::init( chainbase::database& db ) {
@@ -677,6 +739,7 @@ may use a new `set_proposed_producers_ex` intrinsic to access extended features.
       _builtin_protocol_features[indx].previous = _head_of_builtin_activation_list;
       _builtin_protocol_features[indx].activation_block_num = current_block_num;
       _head_of_builtin_activation_list = indx;
+      _activated_builtins.set( indx );
    }
 
    void protocol_feature_manager::popped_blocks_to( uint32_t block_num ) {
@@ -686,6 +749,7 @@ may use a new `set_proposed_producers_ex` intrinsic to access extended features.
          auto& e = _builtin_protocol_features[_head_of_builtin_activation_list];
          if( e.activation_block_num <= block_num ) break;
 
+         _activated_builtins.reset( _head_of_builtin_activation_list );
          _head_of_builtin_activation_list = e.previous;
          e.previous = builtin_protocol_feature_entry::no_previous;
          e.activation_block_num = builtin_protocol_feature_entry::not_active;
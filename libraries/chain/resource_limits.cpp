@@ -114,6 +114,9 @@ void resource_limits_manager::update_account_usage(const flat_set<account_name>&
    const auto& config = _db.get<resource_limits_config_object>();
    for( const auto& a : accounts ) {
       const auto& usage = _db.get<resource_usage_object,by_owner>( a );
+      // adding nothing in the slot usage was last added in changes nothing, e.g. for an account already billed in the block
+      if( usage.net_usage.last_ordinal == time_slot && usage.cpu_usage.last_ordinal == time_slot )
+         continue;
       _db.modify( usage, [&]( auto& bu ){
           bu.net_usage.add( 0, time_slot, config.account_net_usage_average_window );
           bu.cpu_usage.add( 0, time_slot, config.account_cpu_usage_average_window );
@@ -0,0 +1,307 @@
+#include <eosio/chain/reversible_block_log.hpp>
+#include <eosio/chain/config.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/io/cfile.hpp>
+#include <fc/io/fstream.hpp>
+#include <boost/filesystem.hpp>
+
+namespace eosio { namespace chain {
+
+   const uint32_t reversible_block_log::magic_number = 0x30510FDC;
+
+   const uint32_t reversible_block_log::min_supported_version = 1;
+   const uint32_t reversible_block_log::max_supported_version = 1;
+
+   /**
+    * History:
+    * Version 1: initial version replacing the chainbase reversible blocks database
+    */
+
+   namespace {
+      constexpr size_t   file_header_size   = 2 * sizeof(uint32_t);
+      constexpr size_t   record_header_size = 2 * sizeof(uint32_t);
+      constexpr uint64_t min_compact_size   = 32*1024*1024; ///< do not bother rewriting files smaller than this
+   }
+
+   struct reversible_block_log_impl {
+      struct entry {
+         signed_block_ptr block;
+         block_id_type    id;
+         uint64_t         pos = 0;  ///< position of the packed block in the file
+         uint32_t         size = 0; ///< size of the packed block
+      };
+
+      reversible_block_log_impl( const fc::path& data_dir, bool read_only )
+      :datadir(data_dir)
+      ,read_only(read_only)
+      {}
+
+      fc::path                   datadir;
+      const bool                 read_only;
+      std::map<uint32_t, entry>  blocks;
+      fc::cfile                  file;
+      uint64_t                   file_size = 0;
+      uint64_t                   live_size = 0; ///< bytes of the file, records included, that belong to stored blocks
+      bool                       truncated = false;
+
+      fc::path log_path()const { return datadir / config::reversible_blocks_filename; }
+
+      void open();
+      void insert( uint32_t block_num, entry e );
+      void erase( std::map<uint32_t, entry>::iterator first, std::map<uint32_t, entry>::iterator last );
+      void write_record( uint32_t block_num, const char* data, uint32_t size );
+      void maybe_compact();
+   };
+
+   void reversible_block_log_impl::insert( uint32_t block_num, entry e ) {
+      erase( blocks.lower_bound( block_num ), blocks.end() );
+      if( !blocks.empty() && blocks.rbegin()->first + 1 != block_num )
+         erase( blocks.begin(), blocks.end() );
+      live_size += record_header_size + e.size;
+      blocks.emplace( block_num, std::move(e) );
+   }
+
+   void reversible_block_log_impl::erase( std::map<uint32_t, entry>::iterator first, std::map<uint32_t, entry>::iterator last ) {
+      for( auto itr = first; itr != last; ++itr )
+         live_size -= record_header_size + itr->second.size;
+      blocks.erase( first, last );
+   }
+
+   void reversible_block_log_impl::write_record( uint32_t block_num, const char* data, uint32_t size ) {
+      file.write( reinterpret_cast<const char*>(&block_num), sizeof(block_num) );
+      file.write( reinterpret_cast<const char*>(&size), sizeof(size) );
+      if( size > 0 )
+         file.write( data, size );
+      file.flush();
+      file_size += record_header_size + size;
+   }
+
+   void reversible_block_log_impl::open() {
+      const auto log_file = log_path();
+      if( !fc::exists( log_file ) ) {
+         if( read_only ) return;
+         if( !fc::is_directory( datadir ) )
+            fc::create_directories( datadir );
+
+         file.set_file_path( log_file );
+         file.open( "wb" );
+         file.write( reinterpret_cast<const char*>(&reversible_block_log::magic_number), sizeof(uint32_t) );
+         file.write( reinterpret_cast<const char*>(&reversible_block_log::max_supported_version), sizeof(uint32_t) );
+         file.flush();
+         file.close();
+         file_size = file_header_size;
+      } else {
+         string content;
+         fc::read_file_contents( log_file, content );
+
+         fc::datastream<const char*> ds( content.data(), content.size() );
+
+         // validate totem
+         uint32_t totem = 0;
+         fc::raw::unpack( ds, totem );
+         EOS_ASSERT( totem == reversible_block_log::magic_number, reversible_blocks_exception,
+                     "Reversible block log '${filename}' has unexpected magic number: ${actual_totem}. Expected ${expected_totem}",
+                     ("filename", log_file.generic_string())
+                     ("actual_totem", totem)
+                     ("expected_totem", reversible_block_log::magic_number)
+         );
+
+         // validate version
+         uint32_t version = 0;
+         fc::raw::unpack( ds, version );
+         EOS_ASSERT( version >= reversible_block_log::min_supported_version && version <= reversible_block_log::max_supported_version,
+                     reversible_blocks_exception,
+                     "Unsupported version of reversible block log '${filename}'. "
+                     "Reversible block log version is ${version} while code supports version(s) [${min},${max}]",
+                     ("filename", log_file.generic_string())
+                     ("version", version)
+                     ("min", reversible_block_log::min_supported_version)
+                     ("max", reversible_block_log::max_supported_version)
+         );
+
+         uint64_t valid_end = file_header_size;
+         while( ds.remaining() > 0 ) {
+            uint32_t block_num = 0;
+            uint32_t size = 0;
+            try {
+               if( ds.remaining() < record_header_size ) break;
+               fc::raw::unpack( ds, block_num );
+               fc::raw::unpack( ds, size );
+               if( ds.remaining() < size ) break;
+
+               if( size == 0 ) {
+                  erase( blocks.lower_bound( block_num ), blocks.end() );
+               } else {
+                  entry e;
+                  e.pos = valid_end + record_header_size;
+                  e.size = size;
+                  fc::datastream<const char*> bds( content.data() + e.pos, size );
+                  auto b = std::make_shared<signed_block>();
+                  fc::raw::unpack( bds, *b );
+                  if( b->block_num() != block_num ) break;
+                  e.id = b->id();
+                  e.block = std::move(b);
+                  insert( block_num, std::move(e) );
+               }
+               ds.skip( size );
+            } catch( const fc::exception& e ) {
+               wlog( "unable to read record of block ${num} from reversible block log: ${details}",
+                     ("num", block_num)("details", e.to_detail_string()) );
+               break;
+            }
+            valid_end += record_header_size + size;
+         }
+
+         if( valid_end < content.size() ) {
+            truncated = true;
+            wlog( "dropping ${n} bytes of a damaged record at the end of reversible block log '${filename}'",
+                  ("n", content.size() - valid_end)("filename", log_file.generic_string()) );
+            if( !read_only )
+               boost::filesystem::resize_file( log_file, valid_end );
+         }
+         file_size = valid_end;
+      }
+
+      if( !read_only ) {
+         file.set_file_path( log_file );
+         file.open( "ab" );
+      }
+   }
+
+   void reversible_block_log_impl::maybe_compact() {
+      if( read_only || file_size < min_compact_size || file_size <= 2 * (file_header_size + live_size) )
+         return;
+
+      const auto log_file = log_path();
+      const auto tmp_file = datadir / (string(config::reversible_blocks_filename) + ".tmp");
+      try {
+         file.close();
+
+         fc::cfile in;
+         in.set_file_path( log_file );
+         in.open( "rb" );
+
+         fc::cfile out;
+         out.set_file_path( tmp_file );
+         out.open( "wb" );
+         out.write( reinterpret_cast<const char*>(&reversible_block_log::magic_number), sizeof(uint32_t) );
+         out.write( reinterpret_cast<const char*>(&reversible_block_log::max_supported_version), sizeof(uint32_t) );
+
+         // copy the packed blocks as they are, the positions are only updated once the new file is in place
+         std::vector<uint64_t> new_pos;
+         new_pos.reserve( blocks.size() );
+         std::vector<char> buf;
+         uint64_t pos = file_header_size;
+         for( const auto& b : blocks ) {
+            buf.resize( b.second.size );
+            in.seek( b.second.pos );
+            in.read( buf.data(), buf.size() );
+            out.write( reinterpret_cast<const char*>(&b.first), sizeof(uint32_t) );
+            out.write( reinterpret_cast<const char*>(&b.second.size), sizeof(uint32_t) );
+            out.write( buf.data(), buf.size() );
+            pos += record_header_size;
+            new_pos.push_back( pos );
+            pos += b.second.size;
+         }
+         out.flush();
+         out.close();
+         in.close();
+
+         fc::rename( tmp_file, log_file );
+
+         auto itr = new_pos.begin();
+         for( auto& b : blocks )
+            b.second.pos = *itr++;
+         file_size = pos;
+      } catch( const fc::exception& e ) {
+         wlog( "unable to compact reversible block log '${filename}': ${details}",
+               ("filename", log_file.generic_string())("details", e.to_detail_string()) );
+         fc::remove( tmp_file );
+      }
+
+      file.set_file_path( log_file );
+      file.open( "ab" );
+   }
+
+
+   reversible_block_log::reversible_block_log( const fc::path& data_dir, bool read_only )
+   :my( new reversible_block_log_impl( data_dir, read_only ) )
+   {
+      my->open();
+   }
+
+   reversible_block_log::~reversible_block_log() {
+      close();
+   }
+
+   void reversible_block_log::close() {
+      if( my->file.is_open() )
+         my->file.close();
+   }
+
+   void reversible_block_log::append( const signed_block_ptr& b, const block_id_type& id ) {
+      EOS_ASSERT( !my->read_only, reversible_blocks_exception, "cannot append to a read only reversible block log" );
+      EOS_ASSERT( my->file.is_open(), reversible_blocks_exception, "reversible block log is closed" );
+
+      const auto data = fc::raw::pack( *b );
+      reversible_block_log_impl::entry e;
+      e.block = b;
+      e.id = id;
+      e.pos = my->file_size + record_header_size;
+      e.size = data.size();
+
+      my->write_record( b->block_num(), data.data(), data.size() );
+      my->insert( b->block_num(), std::move(e) );
+   }
+
+   void reversible_block_log::remove_from( uint32_t block_num ) {
+      auto itr = my->blocks.lower_bound( block_num );
+      if( itr == my->blocks.end() ) return;
+
+      my->erase( itr, my->blocks.end() );
+      if( !my->read_only && my->file.is_open() )
+         my->write_record( block_num, nullptr, 0 );
+   }
+
+   void reversible_block_log::remove_through( uint32_t block_num ) {
+      auto itr = my->blocks.upper_bound( block_num );
+      if( itr == my->blocks.begin() ) return;
+
+      my->erase( my->blocks.begin(), itr );
+      if( my->file.is_open() )
+         my->maybe_compact();
+   }
+
+   signed_block_ptr reversible_block_log::get_block( uint32_t block_num )const {
+      auto itr = my->blocks.find( block_num );
+      return itr != my->blocks.end() ? itr->second.block : signed_block_ptr();
+   }
+
+   optional<block_id_type> reversible_block_log::get_block_id( uint32_t block_num )const {
+      auto itr = my->blocks.find( block_num );
+      if( itr == my->blocks.end() ) return {};
+      return itr->second.id;
+   }
+
+   bool reversible_block_log::empty()const {
+      return my->blocks.empty();
+   }
+
+   uint32_t reversible_block_log::first_block_num()const {
+      return my->blocks.empty() ? 0 : my->blocks.begin()->first;
+   }
+
+   uint32_t reversible_block_log::last_block_num()const {
+      return my->blocks.empty() ? 0 : my->blocks.rbegin()->first;
+   }
+
+   void reversible_block_log::for_each( const std::function<void( const signed_block_ptr&, const block_id_type& )>& f )const {
+      for( const auto& b : my->blocks )
+         f( b.second.block, b.second.id );
+   }
+
+   bool reversible_block_log::truncated_on_open()const {
+      return my->truncated;
+   }
+
+} } /// eosio::chain
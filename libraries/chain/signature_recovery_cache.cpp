@@ -0,0 +1,35 @@
+#include <eosio/chain/signature_recovery_cache.hpp>
+
+#include <fc/io/raw.hpp>
+
+namespace eosio { namespace chain {
+
+   namespace {
+      digest_type recovery_id( const signature_type& signature, const digest_type& digest, bool check_canonical ) {
+         digest_type::encoder enc;
+         fc::raw::pack( enc, signature );
+         fc::raw::pack( enc, digest );
+         fc::raw::pack( enc, check_canonical );
+         return enc.result();
+      }
+   }
+
+   signature_recovery_cache& signature_recovery_cache::instance() {
+      static signature_recovery_cache cache;
+      return cache;
+   }
+
+   public_key_type signature_recovery_cache::recover( const signature_type& signature, const digest_type& digest,
+                                                      bool check_canonical ) {
+      const digest_type id = recovery_id( signature, digest, check_canonical );
+      // a key recovered with the check is the key recovered without it
+      const digest_type checked_id = check_canonical ? id : recovery_id( signature, digest, true );
+      auto cached = check_canonical ? cache.find( { id } ) : cache.find( { id, checked_id } );
+      if( cached ) return *cached;
+
+      public_key_type key( signature, digest, check_canonical );
+      cache.put( id, key );
+      return key;
+   }
+
+} } // eosio::chain
@@ -1,9 +1,69 @@
 #include <eosio/chain/snapshot.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <fc/scoped_exit.hpp>
+#include <fc/io/json.hpp>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+#include <cstring>
 
 namespace eosio { namespace chain {
 
+namespace bio = boost::iostreams;
+
+namespace {
+   class decompress_limiter {
+   public:
+      using char_type = char;
+      using category = bio::multichar_output_filter_tag;
+
+      explicit decompress_limiter( size_t limit ) : _limit(limit) {}
+
+      template<typename Sink>
+      size_t write(Sink& sink, const char* s, size_t count) {
+         EOS_ASSERT( _total + count <= _limit, snapshot_exception, "Compressed snapshot chunk exceeds its recorded size" );
+         _total += count;
+         return bio::write(sink, s, count);
+      }
+
+   private:
+      size_t _limit;
+      size_t _total = 0;
+   };
+
+   /// [row count][uncompressed size][stored size] in front of every chunk of a compressed snapshot
+   struct chunk_header {
+      uint32_t rows = 0;
+      uint32_t uncompressed_size = 0;
+      uint32_t stored_size = 0;
+   };
+
+   constexpr size_t chunk_header_size = 3 * sizeof(uint32_t);
+
+   void read_exact( std::istream& in, char* data, size_t size ) {
+      in.read(data, size);
+      EOS_ASSERT(static_cast<size_t>(in.gcount()) == size, snapshot_exception, "Compressed snapshot ended unexpectedly");
+   }
+
+   void write_chunk_header( std::ostream& out, const chunk_header& h ) {
+      out.write((const char*)&h.rows, sizeof(h.rows));
+      out.write((const char*)&h.uncompressed_size, sizeof(h.uncompressed_size));
+      out.write((const char*)&h.stored_size, sizeof(h.stored_size));
+   }
+
+   chunk_header parse_chunk_header( const char* data ) {
+      chunk_header h;
+      memcpy(&h.rows, data, sizeof(h.rows));
+      memcpy(&h.uncompressed_size, data + sizeof(uint32_t), sizeof(h.uncompressed_size));
+      memcpy(&h.stored_size, data + 2 * sizeof(uint32_t), sizeof(h.stored_size));
+      EOS_ASSERT(h.rows != 0 || (h.uncompressed_size == 0 && h.stored_size == 0), snapshot_exception,
+                 "Compressed snapshot has a malformed chunk");
+      return h;
+   }
+}
+
 variant_snapshot_writer::variant_snapshot_writer(fc::mutable_variant_object& snapshot)
 : snapshot(snapshot)
 {
@@ -47,9 +107,10 @@ void variant_snapshot_reader::validate() const {
    EOS_ASSERT(version.is_integer(), snapshot_validation_exception,
          "Variant snapshot version is not an integer");
 
-   EOS_ASSERT(version.as_uint64() == (uint64_t)current_snapshot_version, snapshot_validation_exception,
-         "Variant snapshot is an unsuppored version.  Expected : ${expected}, Got: ${actual}",
-         ("expected", current_snapshot_version)("actual",o["version"].as_uint64()));
+   EOS_ASSERT(version.as_uint64() >= minimum_snapshot_version && version.as_uint64() <= current_snapshot_version,
+         snapshot_validation_exception,
+         "Variant snapshot is an unsuppored version.  Expected : [${min}, ${max}], Got: ${actual}",
+         ("min", minimum_snapshot_version)("max", current_snapshot_version)("actual",o["version"].as_uint64()));
 
    EOS_ASSERT(o.contains("sections"), snapshot_validation_exception,
          "Variant snapshot has no sections");
@@ -119,6 +180,298 @@ void variant_snapshot_reader::return_to_header() {
    clear_section();
 }
 
+namespace detail {
+   /// reads JSON text from a stream buffer one value at a time, counting the chars read from where it started
+   class json_scanner {
+   public:
+      json_scanner( std::streambuf& buf, uint64_t offset )
+      :buf(buf)
+      ,offset(offset)
+      {}
+
+      int peek() {
+         return buf.sgetc();
+      }
+
+      int get() {
+         auto c = buf.sbumpc();
+         if (c != std::char_traits<char>::eof()) {
+            ++offset;
+         }
+         return c;
+      }
+
+      uint64_t position()const {
+         return offset;
+      }
+
+      void skip_ws() {
+         for (auto c = peek(); c == ' ' || c == '\t' || c == '\n' || c == '\r'; c = peek()) {
+            get();
+         }
+      }
+
+      /// @return the next char that is not white space, without reading it
+      int next() {
+         skip_ws();
+         return peek();
+      }
+
+      void expect( char expected ) {
+         skip_ws();
+         auto c = get();
+         EOS_ASSERT(c == expected, snapshot_exception, "JSON snapshot is malformed at offset ${o}, expected '${e}'",
+                    ("o", offset)("e", std::string(1, expected)));
+      }
+
+      /// skip one value, appending its text to capture if given
+      void read_value( std::string* capture ) {
+         skip_ws();
+         uint32_t depth = 0;
+         do {
+            auto c = get();
+            EOS_ASSERT(c != std::char_traits<char>::eof(), snapshot_exception, "JSON snapshot ended unexpectedly");
+            if (capture) {
+               capture->push_back(static_cast<char>(c));
+            }
+
+            if (c == '"') {
+               read_string_rest(capture);
+            } else if (c == '{' || c == '[') {
+               ++depth;
+            } else if (c == '}' || c == ']') {
+               EOS_ASSERT(depth > 0, snapshot_exception, "JSON snapshot is malformed at offset ${o}", ("o", offset));
+               --depth;
+            } else if (depth == 0) {
+               // number or literal
+               for (auto n = peek(); n != std::char_traits<char>::eof() && !is_delimiter(n); n = peek()) {
+                  get();
+                  if (capture) {
+                     capture->push_back(static_cast<char>(n));
+                  }
+               }
+            }
+         } while (depth > 0);
+      }
+
+      std::string read_string() {
+         EOS_ASSERT(next() == '"', snapshot_exception, "JSON snapshot is malformed at offset ${o}, expected a string", ("o", offset));
+         std::string raw;
+         read_value(&raw);
+         return fc::json::from_string(raw).as_string();
+      }
+
+   private:
+      static bool is_delimiter( int c ) {
+         return c == ',' || c == ']' || c == '}' || c == ':' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+      }
+
+      void read_string_rest( std::string* capture ) {
+         while (true) {
+            auto c = get();
+            EOS_ASSERT(c != std::char_traits<char>::eof(), snapshot_exception, "JSON snapshot ended unexpectedly");
+            if (capture) {
+               capture->push_back(static_cast<char>(c));
+            }
+
+            if (c == '\\') {
+               auto escaped = get();
+               EOS_ASSERT(escaped != std::char_traits<char>::eof(), snapshot_exception, "JSON snapshot ended unexpectedly");
+               if (capture) {
+                  capture->push_back(static_cast<char>(escaped));
+               }
+            } else if (c == '"') {
+               return;
+            }
+         }
+      }
+
+      std::streambuf& buf;
+      uint64_t        offset;
+   };
+}
+
+istream_json_snapshot_reader::istream_json_snapshot_reader(std::istream& snapshot)
+:snapshot(snapshot)
+,header_pos(snapshot.tellg())
+{
+}
+
+istream_json_snapshot_reader::~istream_json_snapshot_reader() = default;
+
+void istream_json_snapshot_reader::scan() const {
+   if (scanned) {
+      return;
+   }
+
+   auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg()](){
+      snapshot.clear();
+      snapshot.seekg(pos);
+   });
+
+   snapshot.clear();
+   snapshot.seekg(header_pos);
+   EOS_ASSERT(snapshot.good(), snapshot_exception, "JSON snapshot stream cannot seek");
+   detail::json_scanner in(*snapshot.rdbuf(), 0);
+
+   bool has_version = false;
+   bool has_sections = false;
+
+   in.expect('{');
+   if (in.next() == '}') {
+      in.get();
+   } else {
+      while (true) {
+         const auto key = in.read_string();
+         in.expect(':');
+
+         if (key == "version") {
+            std::string raw;
+            in.read_value(&raw);
+            const auto v = fc::json::from_string(raw);
+            EOS_ASSERT(v.is_integer(), snapshot_validation_exception, "Variant snapshot version is not an integer");
+            version = v.as_uint64();
+            has_version = true;
+         } else if (key == "sections") {
+            scan_sections(in);
+            has_sections = true;
+         } else {
+            in.read_value(nullptr);
+         }
+
+         in.skip_ws();
+         const auto c = in.get();
+         if (c == ',') {
+            continue;
+         }
+         EOS_ASSERT(c == '}', snapshot_exception, "JSON snapshot is malformed at offset ${o}", ("o", in.position()));
+         break;
+      }
+   }
+
+   EOS_ASSERT(has_version, snapshot_validation_exception, "Variant snapshot has no version");
+   EOS_ASSERT(has_sections, snapshot_validation_exception, "Variant snapshot has no sections");
+   scanned = true;
+}
+
+void istream_json_snapshot_reader::scan_sections( detail::json_scanner& in ) const {
+   EOS_ASSERT(in.next() == '[', snapshot_validation_exception, "Variant snapshot sections is not an array");
+   in.get();
+   if (in.next() == ']') {
+      in.get();
+      return;
+   }
+
+   while (true) {
+      EOS_ASSERT(in.next() == '{', snapshot_validation_exception, "Variant snapshot section is not an object");
+      in.get();
+
+      fc::optional<std::string> name;
+      fc::optional<uint64_t> rows_pos;
+      if (in.next() == '}') {
+         in.get();
+      } else {
+         while (true) {
+            const auto key = in.read_string();
+            in.expect(':');
+
+            if (key == "name") {
+               EOS_ASSERT(in.next() == '"', snapshot_validation_exception, "Variant snapshot section name is not a string");
+               name = in.read_string();
+            } else if (key == "rows") {
+               EOS_ASSERT(in.next() == '[', snapshot_validation_exception, "Variant snapshot section rows is not an array");
+               rows_pos = in.position();
+               in.read_value(nullptr);
+            } else {
+               in.read_value(nullptr);
+            }
+
+            in.skip_ws();
+            const auto c = in.get();
+            if (c == ',') {
+               continue;
+            }
+            EOS_ASSERT(c == '}', snapshot_exception, "JSON snapshot is malformed at offset ${o}", ("o", in.position()));
+            break;
+         }
+      }
+
+      EOS_ASSERT(name, snapshot_validation_exception, "Variant snapshot section has no name");
+      EOS_ASSERT(rows_pos, snapshot_validation_exception, "Variant snapshot section has no rows");
+
+      // like variant_snapshot_reader, the first section with a name is the one read
+      directory.emplace(*name, *rows_pos);
+
+      in.skip_ws();
+      const auto c = in.get();
+      if (c == ',') {
+         continue;
+      }
+      EOS_ASSERT(c == ']', snapshot_exception, "JSON snapshot is malformed at offset ${o}", ("o", in.position()));
+      break;
+   }
+}
+
+void istream_json_snapshot_reader::validate() const {
+   scan();
+
+   EOS_ASSERT(version >= minimum_snapshot_version && version <= current_snapshot_version,
+         snapshot_validation_exception,
+         "Variant snapshot is an unsuppored version.  Expected : [${min}, ${max}], Got: ${actual}",
+         ("min", minimum_snapshot_version)("max", current_snapshot_version)("actual", version));
+}
+
+bool istream_json_snapshot_reader::has_section( const string& section_name ) {
+   scan();
+   return directory.count(section_name) > 0;
+}
+
+void istream_json_snapshot_reader::set_section( const string& section_name ) {
+   scan();
+   clear_section();
+
+   auto itr = directory.find(section_name);
+   EOS_ASSERT(itr != directory.end(), snapshot_exception, "Variant snapshot has no section named ${n}", ("n", section_name));
+
+   snapshot.clear();
+   snapshot.seekg(header_pos + std::streamoff(itr->second));
+   rows_in = std::make_unique<detail::json_scanner>(*snapshot.rdbuf(), itr->second);
+   rows_in->expect('[');
+   cur_empty = rows_in->next() == ']';
+   section_done = cur_empty;
+}
+
+bool istream_json_snapshot_reader::read_row( detail::abstract_snapshot_row_reader& row_reader ) {
+   EOS_ASSERT(rows_in && !section_done, snapshot_exception, "Attempting to read past the end of a variant snapshot section");
+
+   std::string raw;
+   rows_in->read_value(&raw);
+   row_reader.provide(fc::json::from_string(raw));
+
+   rows_in->skip_ws();
+   const auto c = rows_in->get();
+   if (c == ',') {
+      return true;
+   }
+   EOS_ASSERT(c == ']', snapshot_exception, "JSON snapshot is malformed at offset ${o}", ("o", rows_in->position()));
+   section_done = true;
+   return false;
+}
+
+bool istream_json_snapshot_reader::empty ( ) {
+   return cur_empty;
+}
+
+void istream_json_snapshot_reader::clear_section() {
+   rows_in.reset();
+   cur_empty = true;
+   section_done = true;
+}
+
+void istream_json_snapshot_reader::return_to_header() {
+   clear_section();
+}
+
 ostream_snapshot_writer::ostream_snapshot_writer(std::ostream& snapshot)
 :snapshot(snapshot)
 ,header_pos(snapshot.tellp())
@@ -132,6 +485,10 @@ ostream_snapshot_writer::ostream_snapshot_writer(std::ostream& snapshot)
    // write version
    auto version = current_snapshot_version;
    snapshot.write((char*)&version, sizeof(version));
+
+   // write a placeholder for the position of the section directory
+   uint64_t placeholder = std::numeric_limits<uint64_t>::max();
+   snapshot.write((char*)&placeholder, sizeof(placeholder));
 }
 
 void ostream_snapshot_writer::write_start_section( const std::string& section_name )
@@ -139,6 +496,7 @@ void ostream_snapshot_writer::write_start_section( const std::string& section_na
    EOS_ASSERT(section_pos == std::streampos(-1), snapshot_exception, "Attempting to write a new section without closing the previous section");
    section_pos = snapshot.tellp();
    row_count = 0;
+   directory.push_back({section_name, static_cast<uint64_t>(section_pos - header_pos), 0});
 
    uint64_t placeholder = std::numeric_limits<uint64_t>::max();
 
@@ -164,6 +522,12 @@ void ostream_snapshot_writer::write_row( const detail::abstract_snapshot_row_wri
    row_count++;
 }
 
+void ostream_snapshot_writer::write_packed_rows( const char* data, size_t size, uint64_t num_rows ) {
+   EOS_ASSERT(section_pos != std::streampos(-1), snapshot_exception, "Attempting to write rows outside of a section");
+   snapshot.write(data, size);
+   row_count += num_rows;
+}
+
 void ostream_snapshot_writer::write_end_section( ) {
    auto restore = snapshot.tellp();
 
@@ -179,6 +543,7 @@ void ostream_snapshot_writer::write_end_section( ) {
 
    snapshot.seekp(restore);
 
+   directory.back().rows = row_count;
    section_pos = std::streampos(-1);
    row_count = 0;
 }
@@ -188,6 +553,24 @@ void ostream_snapshot_writer::finalize() {
 
    // write a placeholder for the section size
    snapshot.write((char*)&end_marker, sizeof(end_marker));
+
+   // write the section directory: count followed by offset, row count and null terminated name of each section
+   auto directory_pos = snapshot.tellp();
+   uint64_t num_sections = directory.size();
+   snapshot.write((char*)&num_sections, sizeof(num_sections));
+   for( const auto& entry : directory ) {
+      snapshot.write((char*)&entry.offset, sizeof(entry.offset));
+      snapshot.write((char*)&entry.rows, sizeof(entry.rows));
+      snapshot.write(entry.name.data(), entry.name.size());
+      snapshot.put(0);
+   }
+   auto restore = snapshot.tellp();
+
+   // point the header at the directory
+   uint64_t directory_offset = directory_pos - header_pos;
+   snapshot.seekp(header_pos + std::streamoff(sizeof(magic_number) + sizeof(current_snapshot_version)));
+   snapshot.write((char*)&directory_offset, sizeof(directory_offset));
+   snapshot.seekp(restore);
 }
 
 istream_snapshot_reader::istream_snapshot_reader(std::istream& snapshot)
@@ -217,14 +600,35 @@ void istream_snapshot_reader::validate() const {
                  "Binary snapshot has unexpected magic number!");
 
       // validate version
-      auto expected_version = current_snapshot_version;
-      decltype(expected_version) actual_version;
+      decltype(current_snapshot_version) actual_version;
       snapshot.read((char*)&actual_version, sizeof(actual_version));
-      EOS_ASSERT(actual_version == expected_version, snapshot_exception,
-                 "Binary snapshot is an unsuppored version.  Expected : ${expected}, Got: ${actual}",
-                 ("expected", expected_version)("actual", actual_version));
+      EOS_ASSERT(actual_version >= minimum_snapshot_version && actual_version <= current_snapshot_version, snapshot_exception,
+                 "Binary snapshot is an unsuppored version.  Expected : [${min}, ${max}], Got: ${actual}",
+                 ("min", minimum_snapshot_version)("max", current_snapshot_version)("actual", actual_version));
+
+      uint64_t directory_offset = 0;
+      if (actual_version >= 2) {
+         snapshot.read((char*)&directory_offset, sizeof(directory_offset));
+      }
 
       while (validate_section()) {}
+
+      if (actual_version >= 2) {
+         EOS_ASSERT(snapshot.tellg() - header_pos == std::streamoff(directory_offset), snapshot_exception,
+                    "Binary snapshot section directory does not follow the last section");
+
+         uint64_t num_sections = 0;
+         snapshot.read((char*)&num_sections, sizeof(num_sections));
+         for (uint64_t i = 0; i < num_sections; ++i) {
+            uint64_t offset = 0;
+            uint64_t rows = 0;
+            snapshot.read((char*)&offset, sizeof(offset));
+            snapshot.read((char*)&rows, sizeof(rows));
+            EOS_ASSERT(offset < directory_offset, snapshot_exception,
+                       "Binary snapshot section directory points past the sections");
+            while (snapshot.get() != 0) {}
+         }
+      }
    } catch( const std::exception& e ) {  \
       snapshot_exception fce(FC_LOG_MESSAGE( warn, "Binary snapshot validation threw IO exception (${what})",("what",e.what())));
       throw fce;
@@ -246,11 +650,56 @@ bool istream_snapshot_reader::validate_section() const {
    return true;
 }
 
-bool istream_snapshot_reader::has_section( const string& section_name ) {
+void istream_snapshot_reader::read_header() {
+   if (version != 0)
+      return;
+
    auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg()](){
       snapshot.seekg(pos);
    });
 
+   snapshot.seekg(header_pos + std::streamoff(sizeof(ostream_snapshot_writer::magic_number)));
+   snapshot.read((char*)&version, sizeof(version));
+   if (version < 2)
+      return;
+
+   uint64_t directory_offset = 0;
+   snapshot.read((char*)&directory_offset, sizeof(directory_offset));
+   snapshot.seekg(header_pos + std::streamoff(directory_offset));
+
+   uint64_t num_sections = 0;
+   snapshot.read((char*)&num_sections, sizeof(num_sections));
+   for (uint64_t i = 0; i < num_sections; ++i) {
+      section_entry entry;
+      snapshot.read((char*)&entry.offset, sizeof(entry.offset));
+      snapshot.read((char*)&entry.rows, sizeof(entry.rows));
+      std::string name;
+      for (auto c = snapshot.get(); c != 0 && snapshot.good(); c = snapshot.get()) {
+         name.push_back(static_cast<char>(c));
+      }
+      directory.emplace(std::move(name), entry);
+   }
+}
+
+/**
+ * Leaves the stream at the first row of the section and sets num_rows if the section is found, otherwise the stream
+ * position is unspecified.
+ */
+bool istream_snapshot_reader::find_section( const string& section_name ) {
+   read_header();
+
+   if (version >= 2) {
+      auto itr = directory.find(section_name);
+      if (itr == directory.end()) {
+         return false;
+      }
+
+      // skip the section size, row count and name
+      snapshot.seekg(header_pos + std::streamoff(itr->second.offset + 2 * sizeof(uint64_t) + section_name.size() + 1));
+      num_rows = itr->second.rows;
+      return true;
+   }
+
    const std::streamoff header_size = sizeof(ostream_snapshot_writer::magic_number) + sizeof(current_snapshot_version);
 
    auto next_section_pos = header_pos + header_size;
@@ -265,8 +714,8 @@ bool istream_snapshot_reader::has_section( const string& section_name ) {
 
       next_section_pos = snapshot.tellg() + std::streamoff(section_size);
 
-      uint64_t ignore = 0;
-      snapshot.read((char*)&ignore,sizeof(ignore));
+      uint64_t row_count = 0;
+      snapshot.read((char*)&row_count,sizeof(row_count));
 
       bool match = true;
       for(auto c : section_name) {
@@ -277,6 +726,7 @@ bool istream_snapshot_reader::has_section( const string& section_name ) {
       }
 
       if (match && snapshot.get() == 0) {
+         num_rows = row_count;
          return true;
       }
    }
@@ -284,44 +734,56 @@ bool istream_snapshot_reader::has_section( const string& section_name ) {
    return false;
 }
 
-void istream_snapshot_reader::set_section( const string& section_name ) {
+fc::optional<istream_snapshot_reader::section_location> istream_snapshot_reader::locate_section( const string& section_name ) {
+   read_header();
+   EOS_ASSERT(version >= 2, snapshot_exception,
+              "Binary snapshot version ${v} has no section directory, version 2 or later is required", ("v", version));
+
+   auto itr = directory.find(section_name);
+   if (itr == directory.end()) {
+      return {};
+   }
+
    auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg()](){
       snapshot.seekg(pos);
    });
 
-   const std::streamoff header_size = sizeof(ostream_snapshot_writer::magic_number) + sizeof(current_snapshot_version);
-
-   auto next_section_pos = header_pos + header_size;
-
-   while (true) {
-      snapshot.seekg(next_section_pos);
-      uint64_t section_size = 0;
-      snapshot.read((char*)&section_size,sizeof(section_size));
-      if (section_size == std::numeric_limits<uint64_t>::max()) {
-         break;
-      }
+   snapshot.seekg(header_pos + std::streamoff(itr->second.offset));
+   uint64_t section_size = 0;
+   snapshot.read((char*)&section_size, sizeof(section_size));
+
+   // the section size covers the row count, the null terminated name and the rows
+   const uint64_t name_size = section_name.size() + 1;
+   EOS_ASSERT(section_size >= sizeof(uint64_t) + name_size, snapshot_exception,
+              "Binary snapshot section ${n} has an invalid size", ("n", section_name));
+
+   section_location loc;
+   loc.pos = header_pos + std::streamoff(itr->second.offset + 2 * sizeof(uint64_t) + name_size);
+   loc.size = section_size - sizeof(uint64_t) - name_size;
+   loc.rows = itr->second.rows;
+   return loc;
+}
 
-      next_section_pos = snapshot.tellg() + std::streamoff(section_size);
+bool istream_snapshot_reader::has_section( const string& section_name ) {
+   auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg(),rows=num_rows](){
+      snapshot.seekg(pos);
+      num_rows = rows;
+   });
 
-      uint64_t row_count = 0;
-      snapshot.read((char*)&row_count,sizeof(row_count));
+   return find_section(section_name);
+}
 
-      bool match = true;
-      for(auto c : section_name) {
-         if(snapshot.get() != c) {
-            match = false;
-            break;
-         }
-      }
+void istream_snapshot_reader::set_section( const string& section_name ) {
+   auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg()](){
+      snapshot.seekg(pos);
+   });
 
-      if (match && snapshot.get() == 0) {
-         cur_row = 0;
-         num_rows = row_count;
+   if (find_section(section_name)) {
+      cur_row = 0;
 
-         // leave the stream at the right point
-         restore_pos.cancel();
-         return;
-      }
+      // leave the stream at the right point
+      restore_pos.cancel();
+      return;
    }
 
    EOS_THROW(snapshot_exception, "Binary snapshot has no section named ${n}", ("n", section_name));
@@ -360,6 +822,10 @@ void integrity_hash_snapshot_writer::write_row( const detail::abstract_snapshot_
    row_writer.write(enc);
 }
 
+void integrity_hash_snapshot_writer::write_packed_rows( const char* data, size_t size, uint64_t ) {
+   enc.write(data, size);
+}
+
 void integrity_hash_snapshot_writer::write_end_section( ) {
    // no-op for structural details
 }
@@ -368,4 +834,355 @@ void integrity_hash_snapshot_writer::finalize() {
    // no-op for structural details
 }
 
+compressed_ostream_snapshot_writer::compressed_ostream_snapshot_writer(std::ostream& snapshot)
+:snapshot(snapshot)
+,chunk_buf(chunk)
+,chunk_stream(&chunk_buf)
+,chunk_out(chunk_stream)
+{
+   // write magic number
+   auto totem = magic_number;
+   snapshot.write((char*)&totem, sizeof(totem));
+
+   // write version
+   auto version = current_version;
+   snapshot.write((char*)&version, sizeof(version));
+}
+
+void compressed_ostream_snapshot_writer::write_start_section( const std::string& section_name )
+{
+   EOS_ASSERT(!in_section, snapshot_exception, "Attempting to write a new section without closing the previous section");
+   EOS_ASSERT(!section_name.empty(), snapshot_exception, "Attempting to write a section without a name");
+   in_section = true;
+
+   // write the section name (null terminated)
+   snapshot.write(section_name.data(), section_name.size());
+   snapshot.put(0);
+}
+
+void compressed_ostream_snapshot_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
+   const auto start = chunk.size();
+   try {
+      row_writer.write(chunk_out);
+   } catch (...) {
+      chunk.resize(start);
+      throw;
+   }
+   enc.write(chunk.data() + start, chunk.size() - start);
+   ++chunk_rows;
+
+   if (chunk.size() >= chunk_size) {
+      write_chunk();
+   }
+}
+
+void compressed_ostream_snapshot_writer::write_packed_rows( const char* data, size_t size, uint64_t num_rows ) {
+   EOS_ASSERT(in_section, snapshot_exception, "Attempting to write rows outside of a section");
+   if (uint64_t(chunk_rows) + num_rows > std::numeric_limits<uint32_t>::max()) {
+      write_chunk();
+   }
+   EOS_ASSERT(num_rows <= std::numeric_limits<uint32_t>::max(), snapshot_exception, "Too many packed rows for a compressed snapshot chunk");
+
+   chunk.append(data, size);
+   enc.write(data, size);
+   chunk_rows += num_rows;
+
+   if (chunk.size() >= chunk_size) {
+      write_chunk();
+   }
+}
+
+void compressed_ostream_snapshot_writer::write_chunk() {
+   if (chunk_rows == 0) {
+      return;
+   }
+   EOS_ASSERT(chunk.size() <= std::numeric_limits<uint32_t>::max(), snapshot_exception, "Snapshot rows do not fit in a compressed chunk");
+
+   std::vector<char> stored;
+   {
+      bio::filtering_ostream comp;
+      comp.push(bio::zlib_compressor(bio::zlib::default_compression));
+      comp.push(bio::back_inserter(stored));
+      bio::write(comp, chunk.data(), chunk.size());
+      bio::close(comp);
+   }
+
+   write_chunk_header(snapshot, {chunk_rows, static_cast<uint32_t>(chunk.size()), static_cast<uint32_t>(stored.size())});
+   snapshot.write(stored.data(), stored.size());
+
+   chunk.clear();
+   chunk_rows = 0;
+}
+
+void compressed_ostream_snapshot_writer::write_end_section( ) {
+   EOS_ASSERT(in_section, snapshot_exception, "Attempting to close a section that was not started");
+   write_chunk();
+
+   // an empty chunk closes the section
+   write_chunk_header(snapshot, {});
+   in_section = false;
+}
+
+void compressed_ostream_snapshot_writer::finalize() {
+   EOS_ASSERT(!in_section, snapshot_exception, "Attempting to finalize a snapshot with an open section");
+
+   // an empty section name marks the end, followed by the integrity hash
+   snapshot.put(0);
+   hash = enc.result();
+   snapshot.write(hash.data(), hash.data_size());
+}
+
+compressed_istream_snapshot_reader::compressed_istream_snapshot_reader(std::istream& snapshot)
+:snapshot(snapshot)
+,memory_in(&memory_buf)
+,rows_in(&rows_buf)
+{
+   seekable = snapshot.tellg() != std::streampos(-1);
+   keeping = !seekable;
+
+   snapshot.read((char*)&actual_magic, sizeof(actual_magic));
+   snapshot.read((char*)&version, sizeof(version));
+   if (seekable) {
+      next_section_pos = snapshot.tellg();
+   }
+}
+
+void compressed_istream_snapshot_reader::validate() const {
+   EOS_ASSERT(actual_magic == compressed_ostream_snapshot_writer::magic_number, snapshot_exception,
+              "Compressed snapshot has unexpected magic number!");
+   EOS_ASSERT(version >= 1 && version <= compressed_ostream_snapshot_writer::current_version, snapshot_exception,
+              "Compressed snapshot is an unsuppored version.  Expected : [${min}, ${max}], Got: ${actual}",
+              ("min", 1)("max", static_cast<uint32_t>(compressed_ostream_snapshot_writer::current_version))("actual", version));
+}
+
+void compressed_istream_snapshot_reader::keep( section_entry* capture, const char* data, size_t size ) {
+   if (!capture || !capture->available) {
+      return;
+   }
+
+   if (kept_size + size > max_kept_size) {
+      wlog("Compressed snapshot sections exceed ${max} bytes, sections passed from now on cannot be read again",
+           ("max", static_cast<uint64_t>(max_kept_size)));
+      kept_size -= capture->chunks.size();
+      std::string().swap(capture->chunks);
+      capture->available = false;
+      keeping = false;
+      return;
+   }
+
+   capture->chunks.append(data, size);
+   kept_size += size;
+}
+
+void compressed_istream_snapshot_reader::skip_chunks( std::istream& in, section_entry* capture ) {
+   std::vector<char> stored;
+   while (true) {
+      char header[chunk_header_size];
+      read_exact(in, header, sizeof(header));
+      keep(capture, header, sizeof(header));
+
+      auto h = parse_chunk_header(header);
+      if (h.rows == 0) {
+         return;
+      }
+
+      if (seekable) {
+         in.seekg(h.stored_size, std::ios::cur);
+      } else {
+         stored.resize(h.stored_size);
+         read_exact(in, stored.data(), stored.size());
+         keep(capture, stored.data(), stored.size());
+      }
+   }
+}
+
+bool compressed_istream_snapshot_reader::find_section( const string& section_name, bool open ) {
+   validate();
+   finish_section();
+
+   for (auto& entry : sections) {
+      if (entry.name != section_name) {
+         continue;
+      }
+
+      EOS_ASSERT(entry.available, snapshot_exception,
+                 "Section ${n} of a compressed snapshot read from a stream was not kept and cannot be read again",
+                 ("n", section_name));
+      if (open) {
+         if (seekable) {
+            snapshot.seekg(entry.pos);
+            open_section(snapshot, entry, nullptr);
+         } else {
+            memory_buf.reset(entry.chunks.data(), entry.chunks.data() + entry.chunks.size());
+            memory_in.clear();
+            open_section(memory_in, entry, nullptr);
+         }
+      }
+      return true;
+   }
+
+   if (at_end) {
+      return false;
+   }
+
+   // continue with the sections not seen yet
+   if (seekable) {
+      snapshot.seekg(next_section_pos);
+   }
+
+   while (true) {
+      std::string name;
+      std::getline(snapshot, name, '\0');
+      EOS_ASSERT(snapshot.good(), snapshot_exception, "Compressed snapshot ended unexpectedly");
+
+      if (name.empty()) {
+         fc::sha256 hash;
+         read_exact(snapshot, hash.data(), hash.data_size());
+         trailer_hash = hash;
+         at_end = true;
+         return false;
+      }
+
+      auto& entry = sections.emplace_back();
+      entry.name = std::move(name);
+      if (seekable) {
+         entry.pos = snapshot.tellg();
+      }
+
+      const bool match = entry.name == section_name;
+      entry.available = seekable || keeping || match;
+      auto capture = !seekable && entry.available ? &entry : nullptr;
+
+      if (match && open) {
+         open_section(snapshot, entry, capture);
+         return true;
+      }
+
+      skip_chunks(snapshot, capture);
+      if (seekable) {
+         next_section_pos = snapshot.tellg();
+      }
+
+      if (match) {
+         return true;
+      }
+   }
+}
+
+void compressed_istream_snapshot_reader::open_section( std::istream& in, section_entry& entry, section_entry* capture ) {
+   cur_section = &entry;
+   cur_in = &in;
+   cur_capture = capture;
+   section_done = false;
+   chunk_rows_left = 0;
+   cur_empty = !read_chunk();
+}
+
+bool compressed_istream_snapshot_reader::read_chunk() {
+   char header[chunk_header_size];
+   read_exact(*cur_in, header, sizeof(header));
+   keep(cur_capture, header, sizeof(header));
+
+   auto h = parse_chunk_header(header);
+   if (h.rows == 0) {
+      section_done = true;
+      return false;
+   }
+
+   std::vector<char> stored(h.stored_size);
+   read_exact(*cur_in, stored.data(), stored.size());
+   keep(cur_capture, stored.data(), stored.size());
+
+   rows.clear();
+   rows.reserve(h.uncompressed_size);
+   try {
+      bio::filtering_ostream decomp;
+      decomp.push(bio::zlib_decompressor());
+      decomp.push(decompress_limiter(h.uncompressed_size));
+      decomp.push(bio::back_inserter(rows));
+      bio::write(decomp, stored.data(), stored.size());
+      bio::close(decomp);
+   } catch( const bio::zlib_error& e ) {
+      EOS_THROW(snapshot_exception, "Unable to decompress a chunk of snapshot section ${n}: ${what}",
+                ("n", cur_section->name)("what", e.what()));
+   }
+   EOS_ASSERT(rows.size() == h.uncompressed_size, snapshot_exception,
+              "Chunk of snapshot section ${n} decompressed to ${act} bytes, expected ${exp} bytes",
+              ("n", cur_section->name)("act", rows.size())("exp", h.uncompressed_size));
+
+   rows_buf.reset(rows.data(), rows.data() + rows.size());
+   rows_in.clear();
+   chunk_rows_left = h.rows;
+   return true;
+}
+
+void compressed_istream_snapshot_reader::finish_section() {
+   if (!cur_section) {
+      return;
+   }
+
+   if (!section_done) {
+      skip_chunks(*cur_in, cur_capture);
+   }
+
+   if (cur_in == &snapshot) {
+      if (seekable) {
+         next_section_pos = snapshot.tellg();
+      } else if (!cur_capture || !cur_capture->available) {
+         cur_section->available = false;
+      }
+   } else if (rewound) {
+      // the section has been read again after return_to_header, it is not needed any more
+      kept_size -= cur_section->chunks.size();
+      std::string().swap(cur_section->chunks);
+      cur_section->available = false;
+   }
+
+   cur_section = nullptr;
+   cur_in = nullptr;
+   cur_capture = nullptr;
+   cur_empty = true;
+   section_done = true;
+   chunk_rows_left = 0;
+}
+
+bool compressed_istream_snapshot_reader::has_section( const string& section_name ) {
+   return find_section(section_name, false);
+}
+
+void compressed_istream_snapshot_reader::set_section( const string& section_name ) {
+   if (find_section(section_name, true)) {
+      return;
+   }
+
+   EOS_THROW(snapshot_exception, "Compressed snapshot has no section named ${n}", ("n", section_name));
+}
+
+bool compressed_istream_snapshot_reader::read_row( detail::abstract_snapshot_row_reader& row_reader ) {
+   EOS_ASSERT(chunk_rows_left > 0, snapshot_exception, "Attempting to read past the end of a compressed snapshot section");
+
+   row_reader.provide(rows_in);
+   if (--chunk_rows_left > 0) {
+      return true;
+   }
+
+   EOS_ASSERT(rows_in.peek() == std::istream::traits_type::eof(), snapshot_exception,
+              "Chunk of snapshot section ${n} holds more data than its rows", ("n", cur_section->name));
+   return read_chunk();
+}
+
+bool compressed_istream_snapshot_reader::empty ( ) {
+   return cur_empty;
+}
+
+void compressed_istream_snapshot_reader::clear_section() {
+   finish_section();
+}
+
+void compressed_istream_snapshot_reader::return_to_header() {
+   finish_section();
+   rewound = true;
+   keeping = false;
+}
+
 }}
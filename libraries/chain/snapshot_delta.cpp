@@ -0,0 +1,246 @@
+#include <eosio/chain/snapshot_delta.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/scoped_exit.hpp>
+
+namespace eosio { namespace chain {
+
+namespace {
+   const std::string contract_tables_section_name = "contract_tables";
+
+   fc::sha256 digest_of( const char* data, size_t size ) {
+      fc::sha256::encoder enc;
+      enc.write(data, size);
+      return enc.result();
+   }
+
+   void read_exact( std::istream& in, char* data, size_t size ) {
+      in.read(data, size);
+      EOS_ASSERT(static_cast<size_t>(in.gcount()) == size, snapshot_exception, "Snapshot ended unexpectedly");
+   }
+}
+
+snapshot_delta_writer::snapshot_delta_writer( const snapshot_writer_ptr& out, const fc::optional<snapshot_manifest>& base )
+:out(out)
+,base(base)
+,rows_buf(rows)
+,rows_stream(&rows_buf)
+,rows_out(rows_stream)
+{
+   EOS_ASSERT(out && out->supports_packed_rows(), snapshot_exception,
+              "Delta snapshots can only be written to a writer that supports packed rows");
+
+   if (this->base) {
+      for (const auto& s : this->base->sections) {
+         base_sections.emplace(s.name, &s);
+      }
+      for (const auto& t : this->base->tables) {
+         base_tables.emplace(table_key{t.code, t.scope, t.table}, &t);
+      }
+   }
+}
+
+void snapshot_delta_writer::write_start_section( const std::string& name ) {
+   EOS_ASSERT(!in_section, snapshot_exception, "Attempting to write a new section without closing the previous section");
+   in_section = true;
+   section_name = name;
+   rows.clear();
+   row_count = 0;
+
+   if (section_name == contract_tables_section_name) {
+      // contract tables are passed on as they are added, only the unchanged ones are left out
+      in_tables = true;
+      tables_enc.reset();
+      out->write_start_section(section_name);
+   }
+}
+
+void snapshot_delta_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
+   EOS_ASSERT(!in_tables, snapshot_exception, "Rows of contract tables have to be added with add_table");
+   const auto start = rows.size();
+   try {
+      row_writer.write(rows_out);
+   } catch (...) {
+      rows.resize(start);
+      throw;
+   }
+   ++row_count;
+}
+
+void snapshot_delta_writer::write_packed_rows( const char* data, size_t size, uint64_t num_rows ) {
+   EOS_ASSERT(in_section && !in_tables, snapshot_exception, "Rows of contract tables have to be added with add_table");
+   rows.append(data, size);
+   row_count += num_rows;
+}
+
+void snapshot_delta_writer::add_table( account_name code, scope_name scope, table_name table, const detail::buffered_snapshot_rows& table_rows ) {
+   EOS_ASSERT(in_tables, snapshot_exception, "Attempting to add a contract table outside of the contract_tables section");
+
+   const auto data = table_rows.data();
+   integrity.write(data.data(), data.size());
+   tables_enc.write(data.data(), data.size());
+
+   snapshot_manifest::table entry{code, scope, table, digest_of(data.data(), data.size()), tables_size, data.size(), table_rows.rows()};
+   tables_size += entry.size;
+   row_count += entry.rows;
+
+   if (base) {
+      auto itr = base_tables.find(table_key{code, scope, table});
+      if (itr != base_tables.end() && itr->second->digest == entry.digest && itr->second->size == entry.size) {
+         tables.push_back({itr->second->offset, itr->second->size, itr->second->rows, true});
+      } else {
+         tables.push_back({delta_tables_size, entry.size, entry.rows, false});
+         out->write_packed_rows(data.data(), data.size(), entry.rows);
+         delta_tables_size += entry.size;
+      }
+   } else {
+      out->write_packed_rows(data.data(), data.size(), entry.rows);
+   }
+
+   result.tables.emplace_back(std::move(entry));
+}
+
+void snapshot_delta_writer::write_end_section( ) {
+   EOS_ASSERT(in_section, snapshot_exception, "Attempting to close a section that was not started");
+
+   if (in_tables) {
+      out->write_end_section();
+      result.sections.push_back({section_name, tables_enc.result(), row_count});
+      header.sections.push_back({section_name, false});
+   } else {
+      integrity.write(rows.data(), rows.size());
+      snapshot_manifest::section entry{section_name, digest_of(rows.data(), rows.size()), row_count};
+
+      bool from_base = false;
+      if (base) {
+         auto itr = base_sections.find(section_name);
+         from_base = itr != base_sections.end() && itr->second->digest == entry.digest && itr->second->rows == entry.rows;
+      }
+
+      if (!from_base) {
+         out->write_start_section(section_name);
+         out->write_packed_rows(rows.data(), rows.size(), row_count);
+         out->write_end_section();
+      }
+
+      header.sections.push_back({section_name, from_base});
+      result.sections.emplace_back(std::move(entry));
+   }
+
+   in_section = false;
+   in_tables = false;
+   rows.clear();
+   row_count = 0;
+}
+
+void snapshot_delta_writer::finalize() {
+   EOS_ASSERT(!in_section, snapshot_exception, "Attempting to finalize a snapshot with an open section");
+   result.integrity_hash = integrity.result();
+
+   if (!base) {
+      return;
+   }
+
+   header.base_integrity_hash = base->integrity_hash;
+   header.integrity_hash = result.integrity_hash;
+
+   out->write_start_section(detail::snapshot_section_traits<snapshot_delta_table>::section_name());
+   for (const auto& t : tables) {
+      out->write_row(detail::make_row_writer(t));
+   }
+   out->write_end_section();
+
+   out->write_start_section(detail::snapshot_section_traits<snapshot_delta_header>::section_name());
+   out->write_row(detail::make_row_writer(header));
+   out->write_end_section();
+}
+
+fc::sha256 apply_snapshot_delta( std::istream& base_in, std::istream& delta_in, std::ostream& out,
+                                 const fc::optional<fc::sha256>& base_integrity_hash ) {
+   istream_snapshot_reader base(base_in);
+   istream_snapshot_reader delta(delta_in);
+   base.validate();
+   delta.validate();
+
+   EOS_ASSERT(delta.has_section<snapshot_delta_header>(), snapshot_exception, "Snapshot is not a delta snapshot");
+   snapshot_delta_header header;
+   delta.read_section<snapshot_delta_header>([&header]( auto& section ) {
+      section.read_row(header);
+   });
+
+   EOS_ASSERT(!base_integrity_hash || *base_integrity_hash == header.base_integrity_hash, snapshot_exception,
+              "Delta snapshot is based on a snapshot with integrity hash ${expected}, not ${actual}",
+              ("expected", header.base_integrity_hash)("actual", *base_integrity_hash));
+
+   std::vector<snapshot_delta_table> tables;
+   delta.read_section<snapshot_delta_table>([&tables]( auto& section ) {
+      bool more = !section.empty();
+      while (more) {
+         tables.emplace_back();
+         more = section.read_row(tables.back());
+      }
+   });
+
+   auto locate = []( istream_snapshot_reader& reader, const std::string& name, const char* which ) {
+      auto loc = reader.locate_section(name);
+      EOS_ASSERT(loc, snapshot_exception, "The ${which} snapshot has no section named ${n}", ("which", which)("n", name));
+      return *loc;
+   };
+
+   ostream_snapshot_writer writer(out);
+   fc::sha256::encoder enc;
+   std::vector<char> buffer(1024*1024);
+
+   auto copy = [&enc, &buffer]( std::istream& in, std::streampos pos, uint64_t size, uint64_t rows, auto& section ) {
+      in.seekg(pos);
+      while (size > 0) {
+         const auto n = std::min<uint64_t>(size, buffer.size());
+         read_exact(in, buffer.data(), n);
+         enc.write(buffer.data(), n);
+         size -= n;
+         section.add_packed_rows(buffer.data(), n, size == 0 ? rows : 0);
+      }
+   };
+
+   for (const auto& s : header.sections) {
+      writer.write_section(s.name, [&]( auto& section ) {
+         if (s.name == contract_tables_section_name) {
+            const auto base_loc = locate(base, s.name, "base");
+            const auto delta_loc = locate(delta, s.name, "delta");
+            for (const auto& t : tables) {
+               const auto& loc = t.from_base ? base_loc : delta_loc;
+               EOS_ASSERT(t.offset + t.size <= loc.size, snapshot_exception,
+                          "Delta snapshot refers to contract table rows past the end of the ${which} snapshot",
+                          ("which", t.from_base ? "base" : "delta"));
+               copy(t.from_base ? base_in : delta_in, loc.pos + std::streamoff(t.offset), t.size, t.rows, section);
+            }
+         } else {
+            const auto loc = s.from_base ? locate(base, s.name, "base") : locate(delta, s.name, "delta");
+            copy(s.from_base ? base_in : delta_in, loc.pos, loc.size, loc.rows, section);
+         }
+      });
+   }
+   writer.finalize();
+
+   const auto integrity_hash = enc.result();
+   EOS_ASSERT(integrity_hash == header.integrity_hash, snapshot_exception,
+              "Snapshot made from the delta has integrity hash ${actual}, expected ${expected}",
+              ("actual", integrity_hash)("expected", header.integrity_hash));
+   return integrity_hash;
+}
+
+bool is_snapshot_delta( std::istream& snapshot ) {
+   auto restore_pos = fc::make_scoped_exit([&snapshot, pos=snapshot.tellg()](){
+      snapshot.clear();
+      snapshot.seekg(pos);
+   });
+
+   istream_snapshot_reader reader(snapshot);
+   try {
+      reader.validate();
+   } catch( const snapshot_exception& ) {
+      return false;
+   }
+   return reader.has_section<snapshot_delta_header>();
+}
+
+} } /// eosio::chain
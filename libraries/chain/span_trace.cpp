@@ -0,0 +1,128 @@
+#include <eosio/chain/span_trace.hpp>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+namespace eosio { namespace chain {
+
+namespace {
+
+   /// a span is written field by field with relaxed stores, so that span_trace::write_chrome_trace may read it meanwhile
+   struct span_entry {
+      std::atomic<const char*>  name{nullptr};
+      std::atomic<int64_t>      start_us{0};
+      std::atomic<int64_t>      duration_us{0};
+   };
+
+   /// ring buffer of the spans of one thread, only written by that thread
+   struct thread_spans {
+      thread_spans( uint32_t id, uint32_t generation, uint32_t capacity )
+      :id(id), generation(generation), ring(capacity)
+      {
+         char buf[64] = {};
+         pthread_getname_np( pthread_self(), buf, sizeof(buf) );
+         thread_name = buf;
+      }
+
+      const uint32_t               id;
+      const uint32_t               generation;    ///< of span_trace::enable it was created for
+      std::string                  thread_name;
+      std::vector<span_entry>      ring;
+      std::atomic<uint64_t>        written{0};    ///< spans recorded, the next goes to written % ring.size()
+   };
+
+   std::mutex                                  registry_mtx; ///< guards registry and spans_per_thread
+   std::vector<std::shared_ptr<thread_spans>>  registry;
+   uint32_t                                    spans_per_thread = 0;
+   std::atomic<uint32_t>                       generation{0};
+
+   thread_local std::shared_ptr<thread_spans>  local_spans;
+
+   /// the ring buffer of the calling thread for the current generation, registered on first use
+   thread_spans* get_local_spans() {
+      const uint32_t g = generation.load( std::memory_order_acquire );
+      if( local_spans && local_spans->generation == g ) return local_spans.get();
+
+      std::lock_guard<std::mutex> lock( registry_mtx );
+      if( spans_per_thread == 0 ) return nullptr;
+      local_spans = std::make_shared<thread_spans>( registry.size(), generation.load( std::memory_order_relaxed ), spans_per_thread );
+      registry.push_back( local_spans );
+      return local_spans.get();
+   }
+
+   void write_json_string( std::ostream& out, const std::string& s ) {
+      out << '"';
+      for( char c : s ) {
+         if( c == '"' || c == '\\' ) out << '\\' << c;
+         else if( static_cast<unsigned char>(c) >= 0x20 ) out << c;
+      }
+      out << '"';
+   }
+
+}
+
+std::atomic<bool> span_trace::_enabled{false};
+
+void span_trace::enable( uint32_t spans_per_thread_ ) {
+   std::lock_guard<std::mutex> lock( registry_mtx );
+   registry.clear();
+   spans_per_thread = spans_per_thread_;
+   generation.fetch_add( 1, std::memory_order_release );
+   _enabled.store( spans_per_thread_ > 0, std::memory_order_relaxed );
+}
+
+void span_trace::disable() {
+   _enabled.store( false, std::memory_order_relaxed );
+}
+
+void span_trace::record( const char* name, const fc::time_point& start, const fc::microseconds& duration ) {
+   thread_spans* spans = get_local_spans();
+   if( !spans ) return;
+
+   const uint64_t n = spans->written.load( std::memory_order_relaxed );
+   auto& e = spans->ring[n % spans->ring.size()];
+   e.name.store( name, std::memory_order_relaxed );
+   e.start_us.store( start.time_since_epoch().count(), std::memory_order_relaxed );
+   e.duration_us.store( duration.count(), std::memory_order_relaxed );
+   spans->written.store( n + 1, std::memory_order_release );
+}
+
+void span_trace::write_chrome_trace( std::ostream& out ) {
+   std::vector<std::shared_ptr<thread_spans>> threads;
+   {
+      std::lock_guard<std::mutex> lock( registry_mtx );
+      threads = registry;
+   }
+
+   out << "{\"traceEvents\":[";
+   bool first = true;
+   auto separate = [&]() {
+      if( !first ) out << ",\n";
+      first = false;
+   };
+   for( const auto& t : threads ) {
+      separate();
+      out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t->id << ",\"args\":{\"name\":";
+      write_json_string( out, t->thread_name );
+      out << "}}";
+
+      const uint64_t written = t->written.load( std::memory_order_acquire );
+      const uint64_t size = t->ring.size();
+      for( uint64_t i = written > size ? written - size : 0; i < written; ++i ) {
+         const auto& e = t->ring[i % size];
+         const char* name = e.name.load( std::memory_order_relaxed );
+         if( !name ) continue;
+         separate();
+         out << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t->id
+             << ",\"ts\":" << e.start_us.load( std::memory_order_relaxed )
+             << ",\"dur\":" << e.duration_us.load( std::memory_order_relaxed ) << "}";
+      }
+   }
+   out << "]}\n";
+}
+
+} } /// namespace eosio::chain
@@ -0,0 +1,214 @@
+#include <eosio/chain/state_memory.hpp>
+#include <chainbase/chainbase.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/log/logger_config.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <sstream>
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace eosio { namespace chain {
+
+#ifdef __linux__
+namespace {
+   // from <numaif.h>, which would add a dependency on libnuma for three constants
+   constexpr int      mpol_bind       = 2;
+   constexpr int      mpol_interleave = 3;
+   constexpr unsigned mpol_mf_move    = 1u << 1;
+
+   constexpr size_t chunk_size = 64*1024*1024; ///< bytes placed between checks for stop
+
+   /// nodes listed in /sys/devices/system/node/online, e.g. "0-1,3"
+   std::vector<uint32_t> online_numa_nodes() {
+      std::vector<uint32_t> nodes;
+      std::ifstream in( "/sys/devices/system/node/online" );
+      std::string range;
+      while( std::getline( in, range, ',' ) ) {
+         uint32_t first = 0, last = 0;
+         char dash = 0;
+         std::istringstream r( range );
+         if( !(r >> first) ) continue;
+         last = (r >> dash >> last) ? last : first;
+         for( uint32_t n = first; n <= last; ++n ) nodes.push_back( n );
+      }
+      return nodes;
+   }
+
+   struct node_mask {
+      std::vector<unsigned long> bits;
+      unsigned long              max_node = 0; ///< as maxnode of mbind and set_mempolicy
+   };
+
+   node_mask make_node_mask( const std::vector<uint32_t>& nodes ) {
+      constexpr size_t bits_per_word = sizeof(unsigned long) * 8;
+      node_mask m;
+      m.bits.resize( *std::max_element( nodes.begin(), nodes.end() ) / bits_per_word + 1 );
+      for( auto n : nodes ) m.bits[n / bits_per_word] |= 1ul << (n % bits_per_word);
+      m.max_node = m.bits.size() * bits_per_word + 1;
+      return m;
+   }
+}
+#endif
+
+state_memory::state_memory( chainbase::database& db, chainbase::pinnable_mapped_file::map_mode mode, const options& opts )
+:_segment( reinterpret_cast<char*>( db.get_segment_manager() ) )
+,_segment_size( db.get_segment_manager()->get_size() )
+,_mapped( mode == chainbase::pinnable_mapped_file::map_mode::mapped )
+,_prefetch_pages( _mapped ? opts.prefetch_pages : 0 )
+{
+   std::function<void()> place;
+#ifdef __linux__
+   using map_mode = chainbase::pinnable_mapped_file::map_mode;
+
+   // the segment starts past the header of the mapping, only whole pages of it are advised
+   const size_t page_size = sysconf( _SC_PAGESIZE );
+   auto* segment = _segment;
+   char* begin = reinterpret_cast<char*>( (reinterpret_cast<uintptr_t>( segment ) + page_size - 1) & ~(page_size - 1) );
+   char* end   = reinterpret_cast<char*>( reinterpret_cast<uintptr_t>( segment + _segment_size ) & ~(page_size - 1) );
+
+   if( end > begin && opts.transparent_huge_pages ) {
+      if( madvise( begin, end - begin, MADV_HUGEPAGE ) != 0 )
+         wlog( "Unable to use transparent huge pages for the chain state database: ${e}", ("e", strerror(errno)) );
+   }
+
+   const bool migrate = opts.numa_policy != db_numa_policy::none && mode != map_mode::mapped;
+   const bool prefault = mode == map_mode::mapped && (opts.prefault || opts.numa_policy != db_numa_policy::none);
+   const auto nodes = (!migrate && !prefault) || !opts.numa_nodes.empty() ? opts.numa_nodes : online_numa_nodes();
+   if( end > begin && (migrate || prefault) && opts.numa_policy != db_numa_policy::none && nodes.empty() )
+      wlog( "No NUMA nodes found, the NUMA policy of the chain state database is ignored" );
+   if( end > begin && (migrate || prefault) && (opts.prefault || !nodes.empty()) ) {
+      const int policy = opts.numa_policy == db_numa_policy::bind ? mpol_bind : mpol_interleave;
+      const bool use_policy = opts.numa_policy != db_numa_policy::none && !nodes.empty();
+
+      place = [this, begin, end, page_size, migrate, policy, use_policy, mask = use_policy ? make_node_mask( nodes ) : node_mask{}]() {
+         const auto start = fc::time_point::now();
+
+         if( use_policy && !migrate ) {
+            // pages faulted in by this thread are allocated by its policy
+            if( syscall( SYS_set_mempolicy, policy, mask.bits.data(), mask.max_node ) != 0 ) {
+               wlog( "Unable to set the NUMA policy of the chain state database: ${e}", ("e", strerror(errno)) );
+            }
+         }
+
+         for( char* p = begin; p < end && !_stop; p += std::min<size_t>( chunk_size, end - p ) ) {
+            const size_t len = std::min<size_t>( chunk_size, end - p );
+            if( migrate ) {
+               if( syscall( SYS_mbind, p, len, policy, mask.bits.data(), mask.max_node, mpol_mf_move ) != 0 ) {
+                  wlog( "Unable to move the chain state database to its NUMA nodes: ${e}", ("e", strerror(errno)) );
+                  return;
+               }
+            } else {
+               for( char* q = p; q < p + len; q += page_size ) {
+                  (void)*static_cast<volatile char*>( q );
+               }
+            }
+         }
+
+         if( !_stop ) {
+            ilog( "${what} the chain state database in ${t} ms",
+                  ("what", migrate ? "Moved to its NUMA nodes" : "Faulted in")("t", (fc::time_point::now() - start).count() / 1000) );
+         }
+      };
+   }
+#endif
+   if( !place && !_mapped ) return;
+
+   _thread = std::thread( [this, place{std::move(place)}]() {
+      fc::set_os_thread_name( "statemem" );
+      if( place ) place();
+      if( !_mapped ) return;
+
+      // flushes requested while the database is placed, or while one is written, are done at once afterwards
+      std::unique_lock<std::mutex> g( _flush_mtx );
+      while( true ) {
+         _flush_cv.wait( g, [this]() { return _flush_requested || _stop; } );
+         if( _stop ) return;
+         _flush_requested = false;
+         g.unlock();
+         write_back();
+         g.lock();
+      }
+   });
+}
+
+bool state_memory::flush() {
+   if( !_mapped ) return false;
+   {
+      std::lock_guard<std::mutex> g( _flush_mtx );
+      _flush_requested = true;
+   }
+   _flush_cv.notify_one();
+   return true;
+}
+
+void state_memory::write_back() {
+   // the mapping starts at or before the page the segment starts in, with the header of the database in front of it
+   const size_t page_size = sysconf( _SC_PAGESIZE );
+   char* begin = reinterpret_cast<char*>( reinterpret_cast<uintptr_t>( _segment ) & ~(page_size - 1) );
+   const auto start = fc::time_point::now();
+   if( msync( begin, _segment + _segment_size - begin, MS_SYNC ) != 0 ) {
+      wlog( "Unable to write the chain state database back to its file: ${e}", ("e", strerror(errno)) );
+      return;
+   }
+   dlog( "wrote chain state database back in ${t} ms", ("t", (fc::time_point::now() - start).count() / 1000) );
+}
+
+void state_memory::record_access( account_name contract, const std::vector<const void*>& objects ) {
+   if( !records_access() || objects.empty() ) return;
+
+   static const uintptr_t page_mask = ~(uintptr_t( sysconf( _SC_PAGESIZE ) ) - 1);
+   std::vector<uintptr_t> pages;
+   pages.reserve( objects.size() );
+   for( const void* o : objects ) pages.push_back( reinterpret_cast<uintptr_t>( o ) & page_mask );
+   std::sort( pages.begin(), pages.end() );
+   pages.erase( std::unique( pages.begin(), pages.end() ), pages.end() );
+   if( pages.size() > _prefetch_pages ) pages.resize( _prefetch_pages );
+
+   std::lock_guard<std::mutex> g( _access_mtx );
+   _access_pages[contract] = std::move( pages );
+}
+
+void state_memory::prefetch( const std::vector<account_name>& contracts ) {
+   if( !records_access() ) return;
+
+   const size_t page_size = sysconf( _SC_PAGESIZE );
+   std::vector<uintptr_t> pages;
+   {
+      std::lock_guard<std::mutex> g( _access_mtx );
+      for( const auto& c : contracts ) {
+         auto itr = _access_pages.find( c );
+         if( itr != _access_pages.end() ) pages.insert( pages.end(), itr->second.begin(), itr->second.end() );
+      }
+   }
+   std::sort( pages.begin(), pages.end() );
+   pages.erase( std::unique( pages.begin(), pages.end() ), pages.end() );
+
+   // one call per run of adjacent pages
+   for( size_t i = 0; i < pages.size(); ) {
+      size_t j = i + 1;
+      while( j < pages.size() && pages[j] == pages[j-1] + page_size ) ++j;
+      madvise( reinterpret_cast<void*>( pages[i] ), (j - i) * page_size, MADV_WILLNEED );
+      i = j;
+   }
+}
+
+state_memory::~state_memory() {
+   {
+      std::lock_guard<std::mutex> g( _flush_mtx );
+      _stop = true;
+   }
+   _flush_cv.notify_one();
+   if( _thread.joinable() ) _thread.join();
+}
+
+} } // eosio::chain
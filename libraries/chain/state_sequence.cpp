@@ -0,0 +1,93 @@
+#include <eosio/chain/state_sequence.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace eosio { namespace chain {
+
+namespace {
+
+   constexpr size_t file_size = sizeof( detail::state_sequence_header );
+
+   detail::state_sequence_header* map_header( const std::string& file, bool writable ) {
+      const int fd = ::open( file.c_str(), writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644 );
+      EOS_ASSERT( fd >= 0, database_exception, "Unable to open ${f}: ${e}", ("f", file)("e", std::strerror( errno )) );
+
+      struct stat st;
+      bool sized = ::fstat( fd, &st ) == 0 && size_t( st.st_size ) >= file_size;
+      if( !sized && writable ) sized = ::ftruncate( fd, file_size ) == 0;
+      const int size_errno = errno;
+      if( !sized ) {
+         ::close( fd );
+         EOS_THROW( database_exception, "${f} is not a state sequence file: ${e}",
+                    ("f", file)("e", writable ? std::strerror( size_errno ) : "too small") );
+      }
+
+      void* p = ::mmap( nullptr, file_size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0 );
+      const int map_errno = errno;
+      ::close( fd ); // the mapping keeps the file
+      EOS_ASSERT( p != MAP_FAILED, database_exception, "Unable to map ${f}: ${e}", ("f", file)("e", std::strerror( map_errno )) );
+      return static_cast<detail::state_sequence_header*>( p );
+   }
+
+   void unmap_header( const detail::state_sequence_header* h ) {
+      if( h ) ::munmap( const_cast<detail::state_sequence_header*>( h ), file_size );
+   }
+
+}
+
+state_sequence_writer::state_sequence_writer( const std::string& file )
+:_header( map_header( file, true ) )
+{
+   auto& h = *_header;
+   if( h.magic.load( std::memory_order_relaxed ) != detail::state_sequence_header::magic_value ) {
+      h.sequence.store( 1, std::memory_order_relaxed );
+      h.magic.store( detail::state_sequence_header::magic_value, std::memory_order_release );
+   } else if( !writing() ) {
+      begin_write();
+   } // else left odd by a process that stopped while writing
+}
+
+state_sequence_writer::~state_sequence_writer() {
+   unmap_header( _header );
+}
+
+void state_sequence_writer::begin_write() {
+   const uint64_t s = _header->sequence.load( std::memory_order_relaxed );
+   if( s & 1 ) return;
+   _header->sequence.store( s + 1, std::memory_order_relaxed );
+   // the odd sequence is visible before any write to the state
+   std::atomic_thread_fence( std::memory_order_release );
+}
+
+void state_sequence_writer::end_write( uint32_t head_block_num ) {
+   const uint64_t s = _header->sequence.load( std::memory_order_relaxed );
+   if( !(s & 1) ) return;
+   _header->head_block_num.store( head_block_num, std::memory_order_relaxed );
+   _header->sequence.store( s + 1, std::memory_order_release );
+}
+
+state_sequence_reader::state_sequence_reader( const std::string& file )
+:_header( map_header( file, false ) )
+{
+   if( _header->magic.load( std::memory_order_acquire ) != detail::state_sequence_header::magic_value ) {
+      unmap_header( _header );
+      EOS_THROW( database_exception, "${f} is not a state sequence file", ("f", file) );
+   }
+}
+
+state_sequence_reader::~state_sequence_reader() {
+   unmap_header( _header );
+}
+
+void state_sequence_reader::yield() {
+   std::this_thread::yield();
+}
+
+} } /// namespace eosio::chain
@@ -1,21 +1,114 @@
 #include <eosio/chain/thread_utils.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
 #include <fc/log/logger_config.hpp>
 
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include <pthread.h>
+
 namespace eosio { namespace chain {
 
+namespace {
+   /// cpus of a list as 0-3,8, the format of the kernel cpulist files too
+   void parse_cpu_list( const std::string& list, const std::string& spec, std::vector<uint16_t>& cpus ) {
+      std::vector<std::string> parts;
+      boost::split( parts, list, boost::is_any_of( "," ) );
+      for( auto part : parts ) {
+         boost::trim( part );
+         if( part.empty() ) continue;
+         try {
+            const auto dash = part.find( '-' );
+            const unsigned long first = std::stoul( part.substr( 0, dash ) );
+            const unsigned long last = dash == std::string::npos ? first : std::stoul( part.substr( dash + 1 ) );
+            EOS_ASSERT( first <= last && last <= std::numeric_limits<uint16_t>::max(), plugin_config_exception, "Invalid CPUs ${p} in ${s}", ("p", part)("s", spec) );
+            for( auto cpu = first; cpu <= last; ++cpu ) cpus.push_back( cpu );
+         } catch( const std::logic_error& ) {
+            EOS_THROW( plugin_config_exception, "Invalid CPUs ${p} in ${s}", ("p", part)("s", spec) );
+         }
+      }
+   }
+
+   /// the CPUs the calling thread may run on, as a cpu list
+   std::string current_thread_cpus() {
+#if defined(__linux__)
+      cpu_set_t set;
+      CPU_ZERO( &set );
+      if( pthread_getaffinity_np( pthread_self(), sizeof(set), &set ) ) return "unknown";
+      std::string list;
+      for( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+         if( !CPU_ISSET( cpu, &set ) ) continue;
+         int last = cpu;
+         while( last + 1 < CPU_SETSIZE && CPU_ISSET( last + 1, &set ) ) ++last;
+         if( !list.empty() ) list += ",";
+         list += last == cpu ? std::to_string( cpu ) : std::to_string( cpu ) + "-" + std::to_string( last );
+         cpu = last;
+      }
+      return list;
+#else
+      return "unknown";
+#endif
+   }
+}
+
+std::vector<uint16_t> parse_cpus( const std::vector<std::string>& specs ) {
+   std::vector<uint16_t> cpus;
+   for( const auto& spec : specs ) {
+      if( boost::starts_with( spec, "node" ) ) {
+         const std::string path = "/sys/devices/system/node/" + spec + "/cpulist";
+         std::ifstream in( path );
+         EOS_ASSERT( in, plugin_config_exception, "Unknown NUMA node ${s}, unable to read ${p}", ("s", spec)("p", path) );
+         std::string list;
+         std::getline( in, list );
+         parse_cpu_list( list, spec, cpus );
+      } else {
+         parse_cpu_list( spec, spec, cpus );
+      }
+   }
+   const auto num_cpus = std::thread::hardware_concurrency(); // 0 when not known
+   for( auto cpu : cpus ) {
+      EOS_ASSERT( !num_cpus || cpu < num_cpus, plugin_config_exception, "CPU ${c} is not a CPU of this machine", ("c", cpu) );
+   }
+   return cpus;
+}
+
+void pin_current_thread( const std::string& name, const std::vector<uint16_t>& cpus ) {
+   if( cpus.empty() ) return;
+#if defined(__linux__)
+   cpu_set_t set;
+   CPU_ZERO( &set );
+   for( auto cpu : cpus ) {
+      if( cpu < CPU_SETSIZE ) CPU_SET( cpu, &set );
+   }
+   if( int e = pthread_setaffinity_np( pthread_self(), sizeof(set), &set ) ) {
+      wlog( "unable to pin ${t} to its CPUs: ${e}", ("t", name)("e", std::strerror( e )) );
+   }
+   ilog( "${t} runs on CPUs ${c}", ("t", name)("c", current_thread_cpus()) );
+#else
+   wlog( "pinning ${t} to CPUs is not supported on this platform", ("t", name) );
+#endif
+}
+
 
 //
 // named_thread_pool
 //
-named_thread_pool::named_thread_pool( std::string name_prefix, size_t num_threads )
+named_thread_pool::named_thread_pool( std::string name_prefix, size_t num_threads, std::vector<uint16_t> cpus )
 : _thread_pool( num_threads )
 , _ioc( num_threads )
 {
    _ioc_work.emplace( boost::asio::make_work_guard( _ioc ) );
    for( size_t i = 0; i < num_threads; ++i ) {
-      boost::asio::post( _thread_pool, [&ioc = _ioc, name_prefix, i]() {
+      boost::asio::post( _thread_pool, [&ioc = _ioc, name_prefix, i, cpus]() {
          std::string tn = name_prefix + "-" + std::to_string( i );
          fc::set_os_thread_name( tn );
+         if( !cpus.empty() ) pin_current_thread( tn, { cpus[i % cpus.size()] } );
          ioc.run();
       } );
    }
@@ -32,5 +125,118 @@ void named_thread_pool::stop() {
    _thread_pool.stop();
 }
 
+//
+// work_stealing_pool
+//
+namespace {
+   /// the pool and queue of the current thread, when it is a thread of a work_stealing_pool
+   thread_local const void* current_pool = nullptr;
+   thread_local size_t      current_worker = 0;
+}
+
+work_stealing_pool::work_stealing_pool( std::string name_prefix, size_t num_threads, std::vector<uint16_t> cpus ) {
+   _workers.reserve( num_threads );
+   for( size_t i = 0; i < num_threads; ++i ) {
+      _workers.emplace_back( std::make_unique<worker>() );
+      _workers.back()->ring.reset( new task[queue_capacity] );
+   }
+   for( size_t i = 0; i < num_threads; ++i ) {
+      _workers[i]->thread = std::thread( [this, name_prefix, i, cpus]() {
+         std::string tn = name_prefix + "-" + std::to_string( i );
+         fc::set_os_thread_name( tn );
+         if( !cpus.empty() ) pin_current_thread( tn, { cpus[i % cpus.size()] } );
+         run( i );
+      } );
+   }
+}
+
+work_stealing_pool::~work_stealing_pool() {
+   stop();
+}
+
+void work_stealing_pool::stop() {
+   {
+      std::lock_guard<std::mutex> g( _sleep_mtx );
+      _stopped = true;
+   }
+   _sleep_cv.notify_all();
+   for( auto& w : _workers ) {
+      if( w->thread.joinable() ) w->thread.join();
+   }
+   for( auto& w : _workers ) {
+      std::lock_guard<std::mutex> g( w->mtx );
+      for( ; w->count; --w->count, w->first = ( w->first + 1 ) % queue_capacity ) {
+         w->ring[w->first] = task();
+      }
+   }
+   _queued = 0;
+}
+
+bool work_stealing_pool::push( task& t ) {
+   if( _stopped || _workers.empty() ) return false;
+   const size_t n = _workers.size();
+   const size_t start = current_pool == this ? current_worker : _next.fetch_add( 1, std::memory_order_relaxed ) % n;
+   // counted before it is queued, for a thread taking it not to count it first
+   _queued.fetch_add( 1 );
+   for( size_t i = 0; i < n; ++i ) {
+      if( !push_to( ( start + i ) % n, t ) ) continue;
+      if( _sleeping.load() ) {
+         // taking the mutex orders the notification after a sleeping thread checked _queued
+         std::lock_guard<std::mutex> g( _sleep_mtx );
+         _sleep_cv.notify_one();
+      }
+      return true;
+   }
+   _queued.fetch_sub( 1 );
+   return false;
+}
+
+bool work_stealing_pool::push_to( size_t w, task& t ) {
+   auto& q = *_workers[w];
+   std::lock_guard<std::mutex> g( q.mtx );
+   if( q.count == queue_capacity ) return false;
+   q.ring[( q.first + q.count ) % queue_capacity] = std::move( t );
+   ++q.count;
+   return true;
+}
+
+bool work_stealing_pool::pop_from( size_t w, task& t ) {
+   auto& q = *_workers[w];
+   std::unique_lock<std::mutex> g( q.mtx, std::try_to_lock );
+   if( !g.owns_lock() ) {
+      // contended, do not wait on the queue of another thread
+      if( w != current_worker ) return false;
+      g.lock();
+   }
+   if( !q.count ) return false;
+   t = std::move( q.ring[q.first] );
+   q.first = ( q.first + 1 ) % queue_capacity;
+   --q.count;
+   return true;
+}
+
+void work_stealing_pool::run( size_t w ) {
+   current_pool = this;
+   current_worker = w;
+   const size_t n = _workers.size();
+   task t;
+   while( !_stopped ) {
+      bool found = false;
+      for( size_t i = 0; i < n && !found; ++i ) {
+         found = pop_from( ( w + i ) % n, t );
+      }
+      if( found ) {
+         _queued.fetch_sub( 1 );
+         try {
+            t();
+         } FC_LOG_AND_DROP()
+         continue;
+      }
+      std::unique_lock<std::mutex> g( _sleep_mtx );
+      ++_sleeping;
+      _sleep_cv.wait( g, [this]() { return _queued.load() || _stopped; } );
+      --_sleeping;
+   }
+}
 
 } } // eosio::chain
\ No newline at end of file
@@ -7,8 +7,13 @@
 #include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 
+#ifdef EOSIO_ZSTD_COMPRESSION_ENABLED
+#include <zstd.h>
+#endif
+
 #include <eosio/chain/config.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/signature_recovery_cache.hpp>
 #include <eosio/chain/transaction.hpp>
 
 namespace eosio { namespace chain {
@@ -68,7 +73,7 @@ fc::microseconds transaction::get_signature_keys( const vector<signature_type>&
       auto now = fc::time_point::now();
       EOS_ASSERT( now < deadline, tx_cpu_usage_exceeded, "transaction signature verification executed for too long ${time}us",
                   ("time", now - start)("now", now)("deadline", deadline)("start", start) );
-      auto[ itr, successful_insertion ] = recovered_pub_keys.emplace( sig, digest );
+      auto[ itr, successful_insertion ] = recovered_pub_keys.emplace( signature_recovery_cache::instance().recover( sig, digest ) );
       EOS_ASSERT( allow_duplicate_keys || successful_insertion, tx_duplicate_sig,
                   "transaction includes more than one signature signed using the same key associated with public key: ${key}",
                   ("key", *itr ) );
@@ -162,6 +167,9 @@ digest_type packed_transaction::packed_digest()const {
 
 namespace bio = boost::iostreams;
 
+// limit on the decompressed size of a transaction or of its context free data, for zip bomb protections
+static constexpr size_t max_decompressed_size = 1*1024*1024;
+
 template<size_t Limit>
 struct read_limiter {
    using char_type = char;
@@ -194,7 +202,7 @@ static bytes zlib_decompress(const bytes& data) {
       bytes out;
       bio::filtering_ostream decomp;
       decomp.push(bio::zlib_decompressor());
-      decomp.push(read_limiter<1*1024*1024>()); // limit to 1 meg decompressed for zip bomb protections
+      decomp.push(read_limiter<max_decompressed_size>());
       decomp.push(bio::back_inserter(out));
       bio::write(decomp, data.data(), data.size());
       bio::close(decomp);
@@ -207,6 +215,46 @@ static bytes zlib_decompress(const bytes& data) {
    }
 }
 
+static bytes zstd_decompress(const bytes& data) {
+#ifdef EOSIO_ZSTD_COMPRESSION_ENABLED
+   std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx( ZSTD_createDCtx(), &ZSTD_freeDCtx );
+   EOS_ASSERT( ctx, tx_decompression_error, "Unable to create zstd decompression context" );
+   // frames needing a window larger than the limit are rejected rather than allocating it
+   ZSTD_DCtx_setParameter( ctx.get(), ZSTD_d_windowLogMax, 20 );
+   // streamed rather than sized from the frame header, which the sender controls
+   bytes out;
+   ZSTD_inBuffer in{ data.data(), data.size(), 0 };
+   size_t remaining = 0;
+   do {
+      const size_t pos = out.size();
+      out.resize( std::min( pos + ZSTD_DStreamOutSize(), max_decompressed_size + 1 ) );
+      ZSTD_outBuffer o{ out.data(), out.size(), pos };
+      remaining = ZSTD_decompressStream( ctx.get(), &o, &in );
+      EOS_ASSERT( !ZSTD_isError( remaining ), tx_decompression_error, "Invalid zstd data: ${e}", ("e", ZSTD_getErrorName( remaining )) );
+      out.resize( o.pos );
+      EOS_ASSERT( out.size() <= max_decompressed_size, tx_decompression_error, "Exceeded maximum decompressed transaction size" );
+      EOS_ASSERT( remaining == 0 || in.pos < in.size || o.pos > pos, tx_decompression_error, "Truncated zstd data" );
+   } while( remaining != 0 );
+   EOS_ASSERT( in.pos == in.size, tx_decompression_error, "Unexpected data after the zstd frame" );
+   return out;
+#else
+   EOS_THROW( unknown_transaction_compression, "zstd transaction compression is not supported by this build" );
+#endif
+}
+
+static vector<bytes> zstd_decompress_context_free_data(const bytes& data) {
+   if( data.size() == 0 )
+      return vector<bytes>();
+
+   bytes out = zstd_decompress(data);
+   return unpack_context_free_data(out);
+}
+
+static transaction zstd_decompress_transaction(const bytes& data) {
+   bytes out = zstd_decompress(data);
+   return unpack_transaction(out);
+}
+
 static vector<bytes> zlib_decompress_context_free_data(const bytes& data) {
    if( data.size() == 0 )
       return vector<bytes>();
@@ -245,6 +293,29 @@ static bytes zlib_compress_context_free_data(const vector<bytes>& cfd ) {
    return out;
 }
 
+static bytes zstd_compress(const bytes& in) {
+#ifdef EOSIO_ZSTD_COMPRESSION_ENABLED
+   bytes out( ZSTD_compressBound( in.size() ) );
+   const size_t size = ZSTD_compress( out.data(), out.size(), in.data(), in.size(), 19 );
+   EOS_ASSERT( !ZSTD_isError( size ), tx_decompression_error, "zstd compression failed: ${e}", ("e", ZSTD_getErrorName( size )) );
+   out.resize( size );
+   return out;
+#else
+   EOS_THROW( unknown_transaction_compression, "zstd transaction compression is not supported by this build" );
+#endif
+}
+
+static bytes zstd_compress_context_free_data(const vector<bytes>& cfd ) {
+   if( cfd.size() == 0 )
+      return bytes();
+
+   return zstd_compress( pack_context_free_data(cfd) );
+}
+
+static bytes zstd_compress_transaction(const transaction& t) {
+   return zstd_compress( pack_transaction(t) );
+}
+
 static bytes zlib_compress_transaction(const transaction& t) {
    bytes in = pack_transaction(t);
    bytes out;
@@ -264,6 +335,8 @@ bytes packed_transaction::get_raw_transaction() const
             return packed_trx;
          case compression_type::zlib:
             return zlib_decompress(packed_trx);
+         case compression_type::zstd:
+            return zstd_decompress(packed_trx);
          default:
             EOS_THROW(unknown_transaction_compression, "Unknown transaction compression algorithm");
       }
@@ -276,10 +349,7 @@ packed_transaction::packed_transaction( bytes&& packed_txn, vector<signature_typ
 ,packed_context_free_data(std::move(packed_cfd))
 ,packed_trx(std::move(packed_txn))
 {
-   local_unpack_transaction({});
-   if( !packed_context_free_data.empty() ) {
-      local_unpack_context_free_data();
-   }
+   local_unpack_transaction( packed_context_free_data.empty() ? vector<bytes>() : local_unpack_context_free_data() );
 }
 
 packed_transaction::packed_transaction( bytes&& packed_txn, vector<signature_type>&& sigs, vector<bytes>&& cfd, compression_type _compression )
@@ -288,7 +358,7 @@ packed_transaction::packed_transaction( bytes&& packed_txn, vector<signature_typ
 ,packed_trx(std::move(packed_txn))
 {
    local_unpack_transaction( std::move( cfd ) );
-   if( !unpacked_trx.context_free_data.empty() ) {
+   if( !unpacked_trx->context_free_data.empty() ) {
       local_pack_context_free_data();
    }
 }
@@ -297,13 +367,11 @@ packed_transaction::packed_transaction( transaction&& t, vector<signature_type>&
 :signatures(std::move(sigs))
 ,compression(_compression)
 ,packed_context_free_data(std::move(packed_cfd))
-,unpacked_trx(std::move(t), signatures, {})
-,trx_id(unpacked_trx.id())
 {
+   unpacked_trx = std::make_shared<const signed_transaction>( std::move(t), signatures,
+                                                              packed_context_free_data.empty() ? vector<bytes>() : local_unpack_context_free_data() );
+   trx_id = unpacked_trx->id();
    local_pack_transaction();
-   if( !packed_context_free_data.empty() ) {
-      local_unpack_context_free_data();
-   }
 }
 
 void packed_transaction::reflector_init()
@@ -311,9 +379,8 @@ void packed_transaction::reflector_init()
    // called after construction, but always on the same thread and before packed_transaction passed to any other threads
    static_assert(fc::raw::has_feature_reflector_init_on_unpacked_reflected_types,
                  "FC unpack needs to call reflector_init otherwise unpacked_trx will not be initialized");
-   EOS_ASSERT( unpacked_trx.expiration == time_point_sec(), tx_decompression_error, "packed_transaction already unpacked" );
-   local_unpack_transaction({});
-   local_unpack_context_free_data();
+   EOS_ASSERT( unpacked_trx->expiration == time_point_sec(), tx_decompression_error, "packed_transaction already unpacked" );
+   local_unpack_transaction( local_unpack_context_free_data() );
 }
 
 void packed_transaction::local_unpack_transaction(vector<bytes>&& context_free_data)
@@ -321,29 +388,31 @@ void packed_transaction::local_unpack_transaction(vector<bytes>&& context_free_d
    try {
       switch( compression ) {
          case compression_type::none:
-            unpacked_trx = signed_transaction( unpack_transaction( packed_trx ), signatures, std::move(context_free_data) );
+            unpacked_trx = std::make_shared<const signed_transaction>( unpack_transaction( packed_trx ), signatures, std::move(context_free_data) );
             break;
          case compression_type::zlib:
-            unpacked_trx = signed_transaction( zlib_decompress_transaction( packed_trx ), signatures, std::move(context_free_data) );
+            unpacked_trx = std::make_shared<const signed_transaction>( zlib_decompress_transaction( packed_trx ), signatures, std::move(context_free_data) );
+            break;
+         case compression_type::zstd:
+            unpacked_trx = std::make_shared<const signed_transaction>( zstd_decompress_transaction( packed_trx ), signatures, std::move(context_free_data) );
             break;
          default:
             EOS_THROW( unknown_transaction_compression, "Unknown transaction compression algorithm" );
       }
-      trx_id = unpacked_trx.id();
+      trx_id = unpacked_trx->id();
    } FC_CAPTURE_AND_RETHROW( (compression) )
 }
 
-void packed_transaction::local_unpack_context_free_data()
+vector<bytes> packed_transaction::local_unpack_context_free_data()const
 {
    try {
-      EOS_ASSERT(unpacked_trx.context_free_data.empty(), tx_decompression_error, "packed_transaction.context_free_data not empty");
       switch( compression ) {
          case compression_type::none:
-            unpacked_trx.context_free_data = unpack_context_free_data( packed_context_free_data );
-            break;
+            return unpack_context_free_data( packed_context_free_data );
          case compression_type::zlib:
-            unpacked_trx.context_free_data = zlib_decompress_context_free_data( packed_context_free_data );
-            break;
+            return zlib_decompress_context_free_data( packed_context_free_data );
+         case compression_type::zstd:
+            return zstd_decompress_context_free_data( packed_context_free_data );
          default:
             EOS_THROW( unknown_transaction_compression, "Unknown transaction compression algorithm" );
       }
@@ -355,10 +424,13 @@ void packed_transaction::local_pack_transaction()
    try {
       switch(compression) {
          case compression_type::none:
-            packed_trx = pack_transaction(unpacked_trx);
+            packed_trx = pack_transaction(*unpacked_trx);
             break;
          case compression_type::zlib:
-            packed_trx = zlib_compress_transaction(unpacked_trx);
+            packed_trx = zlib_compress_transaction(*unpacked_trx);
+            break;
+         case compression_type::zstd:
+            packed_trx = zstd_compress_transaction(*unpacked_trx);
             break;
          default:
             EOS_THROW(unknown_transaction_compression, "Unknown transaction compression algorithm");
@@ -371,10 +443,13 @@ void packed_transaction::local_pack_context_free_data()
    try {
       switch(compression) {
          case compression_type::none:
-            packed_context_free_data = pack_context_free_data(unpacked_trx.context_free_data);
+            packed_context_free_data = pack_context_free_data(unpacked_trx->context_free_data);
             break;
          case compression_type::zlib:
-            packed_context_free_data = zlib_compress_context_free_data(unpacked_trx.context_free_data);
+            packed_context_free_data = zlib_compress_context_free_data(unpacked_trx->context_free_data);
+            break;
+         case compression_type::zstd:
+            packed_context_free_data = zstd_compress_context_free_data(unpacked_trx->context_free_data);
             break;
          default:
             EOS_THROW(unknown_transaction_compression, "Unknown transaction compression algorithm");
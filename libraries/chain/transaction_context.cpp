@@ -6,6 +6,7 @@
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/transaction_object.hpp>
 #include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/span_trace.hpp>
 
 #pragma push_macro("N")
 #undef N
@@ -66,6 +67,7 @@ namespace eosio { namespace chain {
       trace->block_time = c.pending_block_time();
       trace->producer_block_id = c.pending_producer_block_id();
       executed.reserve( trx.total_actions() );
+      profile_usage = c.get_contract_usage_profiler().enabled();
    }
 
    void transaction_context::disallow_transaction_extensions( const char* error_msg )const {
@@ -79,6 +81,7 @@ namespace eosio { namespace chain {
    void transaction_context::init(uint64_t initial_net_usage)
    {
       EOS_ASSERT( !is_initialized, transaction_exception, "cannot initialize twice" );
+      scoped_span span( "transaction_context::init" );
       const static int64_t large_number_no_overflow = std::numeric_limits<int64_t>::max()/2;
 
       const auto& cfg = control.get_global_properties().configuration;
@@ -266,7 +269,9 @@ namespace eosio { namespace chain {
 
    void transaction_context::exec() {
       EOS_ASSERT( is_initialized, transaction_exception, "must first initialize" );
+      scoped_span span( "transaction_context::exec" );
 
+      trace->action_traces.reserve( (apply_context_free ? trx.context_free_actions.size() : 0) + trx.actions.size() );
       if( apply_context_free ) {
          for( const auto& act : trx.context_free_actions ) {
             schedule_action( act, act.account, true, 0, 0 );
@@ -292,6 +297,7 @@ namespace eosio { namespace chain {
 
    void transaction_context::finalize() {
       EOS_ASSERT( is_initialized, transaction_exception, "must first initialize" );
+      scoped_span span( "transaction_context::finalize" );
 
       if( is_input ) {
          auto& am = control.get_mutable_authorization_manager();
@@ -341,8 +347,15 @@ namespace eosio { namespace chain {
 
       validate_cpu_usage_to_bill( billed_cpu_time_us, account_cpu_limit, true );
 
-      rl.add_transaction_usage( bill_to_accounts, static_cast<uint64_t>(billed_cpu_time_us), net_usage,
-                                block_timestamp_type(control.pending_block_time()).slot ); // Should never fail
+      {
+         scoped_span usage_span( "resource_limits_manager::add_transaction_usage" );
+         rl.add_transaction_usage( bill_to_accounts, static_cast<uint64_t>(billed_cpu_time_us), net_usage,
+                                   block_timestamp_type(control.pending_block_time()).slot ); // Should never fail
+      }
+
+      if( profile_usage ) {
+         control.get_mutable_contract_usage_profiler().add_transaction( profiled_actions, billed_cpu_time_us, now );
+      }
    }
 
    void transaction_context::squash() {
@@ -579,7 +592,10 @@ namespace eosio { namespace chain {
    {
       uint32_t new_action_ordinal = trace->action_traces.size() + 1;
 
-      trace->action_traces.reserve( new_action_ordinal );
+      // Doubling, as reserving only the one more trace would move all of them again for every notification.
+      if( trace->action_traces.capacity() < new_action_ordinal ) {
+         trace->action_traces.reserve( std::max<size_t>( 2 * trace->action_traces.size(), 8 ) );
+      }
 
       const action& provided_action = get_action_trace( action_ordinal ).act;
 
@@ -627,6 +643,7 @@ namespace eosio { namespace chain {
    }
 
    void transaction_context::record_transaction( const transaction_id_type& id, fc::time_point_sec expire ) {
+      scoped_span span( "transaction_context::record_transaction" );
       try {
           control.mutable_db().create<transaction_object>([&](transaction_object& transaction) {
               transaction.trx_id = id;
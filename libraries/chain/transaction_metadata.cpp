@@ -4,22 +4,104 @@
 
 namespace eosio { namespace chain {
 
+template<typename ThreadPool>
 recover_keys_future transaction_metadata::start_recover_keys( packed_transaction_ptr trx,
-                                                              boost::asio::io_context& thread_pool,
+                                                              ThreadPool& thread_pool,
                                                               const chain_id_type& chain_id,
                                                               fc::microseconds time_limit,
-                                                              uint32_t max_variable_sig_size )
+                                                              uint32_t max_variable_sig_size,
+                                                              trx_type t )
 {
-   return async_thread_pool( thread_pool, [trx{std::move(trx)}, chain_id, time_limit, max_variable_sig_size]() mutable {
+   return async_thread_pool( thread_pool, [trx{std::move(trx)}, chain_id, time_limit, max_variable_sig_size, t]() mutable {
          fc::time_point deadline = time_limit == fc::microseconds::maximum() ?
                                    fc::time_point::maximum() : fc::time_point::now() + time_limit;
          check_variable_sig_size( trx, max_variable_sig_size );
          const signed_transaction& trn = trx->get_signed_transaction();
          flat_set<public_key_type> recovered_pub_keys;
          fc::microseconds cpu_usage = trn.get_signature_keys( chain_id, deadline, recovered_pub_keys );
-         return std::make_shared<transaction_metadata>( private_type(), std::move( trx ), cpu_usage, std::move( recovered_pub_keys ) );
+         return std::make_shared<transaction_metadata>( private_type(), std::move( trx ), cpu_usage, std::move( recovered_pub_keys ),
+                                                        t == trx_type::implicit, t == trx_type::scheduled, t == trx_type::dry_run );
       }
    );
 }
 
+template<typename ThreadPool>
+recover_keys_batch transaction_metadata::start_recover_keys( const std::vector<packed_transaction_ptr>& trxs,
+                                                             ThreadPool& thread_pool,
+                                                             const chain_id_type& chain_id,
+                                                             fc::microseconds time_limit,
+                                                             size_t num_chunks,
+                                                             uint32_t max_variable_sig_size )
+{
+   recover_keys_batch result;
+   result._dup_of.reserve( trxs.size() );
+
+   // identical signatures only recover to identical keys over identical digests, i.e. identical transactions
+   std::vector<packed_transaction_ptr> unique_trxs;
+   unique_trxs.reserve( trxs.size() );
+   std::map<transaction_id_type, size_t> first_by_id;
+   for( const auto& trx : trxs ) {
+      auto r = first_by_id.emplace( trx->id(), unique_trxs.size() );
+      if( r.second || *unique_trxs[r.first->second] != *trx ) {
+         if( !r.second ) r.first->second = unique_trxs.size(); // same id, different signatures or context free data
+         result._dup_of.push_back( unique_trxs.size() );
+         unique_trxs.push_back( trx );
+      } else {
+         result._dup_of.push_back( r.first->second );
+      }
+   }
+   if( unique_trxs.empty() ) return result;
+
+   num_chunks = std::max<size_t>( 1, std::min( num_chunks, unique_trxs.size() ) );
+   result._chunk_size = ( unique_trxs.size() + num_chunks - 1 ) / num_chunks;
+   result._chunk_futures.reserve( num_chunks );
+   for( size_t begin = 0; begin < unique_trxs.size(); begin += result._chunk_size ) {
+      size_t end = std::min( begin + result._chunk_size, unique_trxs.size() );
+      std::vector<packed_transaction_ptr> chunk( unique_trxs.begin() + begin, unique_trxs.begin() + end );
+      result._chunk_futures.emplace_back( async_thread_pool( thread_pool,
+            [chunk{std::move(chunk)}, chain_id, time_limit, max_variable_sig_size]() mutable {
+         std::vector<transaction_metadata_ptr> metas;
+         metas.reserve( chunk.size() );
+         for( auto& trx : chunk ) {
+            fc::time_point deadline = time_limit == fc::microseconds::maximum() ?
+                                      fc::time_point::maximum() : fc::time_point::now() + time_limit;
+            check_variable_sig_size( trx, max_variable_sig_size );
+            const signed_transaction& trn = trx->get_signed_transaction();
+            flat_set<public_key_type> recovered_pub_keys;
+            fc::microseconds cpu_usage = trn.get_signature_keys( chain_id, deadline, recovered_pub_keys );
+            metas.emplace_back( std::make_shared<transaction_metadata>( private_type(), std::move( trx ), cpu_usage,
+                                                                        std::move( recovered_pub_keys ) ) );
+         }
+         return metas;
+      } ) );
+   }
+   result._chunk_results.resize( result._chunk_futures.size() );
+   result._chunk_errors.resize( result._chunk_futures.size() );
+
+   return result;
+}
+
+template recover_keys_future transaction_metadata::start_recover_keys( packed_transaction_ptr, boost::asio::io_context&,
+                                                                       const chain_id_type&, fc::microseconds, uint32_t, trx_type );
+template recover_keys_future transaction_metadata::start_recover_keys( packed_transaction_ptr, work_stealing_pool&,
+                                                                       const chain_id_type&, fc::microseconds, uint32_t, trx_type );
+template recover_keys_batch transaction_metadata::start_recover_keys( const std::vector<packed_transaction_ptr>&, boost::asio::io_context&,
+                                                                      const chain_id_type&, fc::microseconds, size_t, uint32_t );
+template recover_keys_batch transaction_metadata::start_recover_keys( const std::vector<packed_transaction_ptr>&, work_stealing_pool&,
+                                                                      const chain_id_type&, fc::microseconds, size_t, uint32_t );
+
+const transaction_metadata_ptr& recover_keys_batch::get( size_t i ) {
+   const size_t u = _dup_of.at( i );
+   const size_t c = u / _chunk_size;
+   if( _chunk_futures.at( c ).valid() ) {
+      try {
+         _chunk_results[c] = _chunk_futures[c].get();
+      } catch( ... ) {
+         _chunk_errors[c] = std::current_exception();
+      }
+   }
+   if( _chunk_errors[c] ) std::rethrow_exception( _chunk_errors[c] );
+   return _chunk_results[c].at( u % _chunk_size );
+}
+
 } } // eosio::chain
@@ -49,4 +49,48 @@ std::queue<std::vector<size_t>>      checktime_block_type::orderings;
 std::queue<std::map<size_t, size_t>> checktime_block_type::bcnt_tables;
 size_t  checktime_function_end::fcnt = 0;
 
+void local_op_fusion::fuse( Module& mod ) {
+   using ops = wasm_ops::op_types<>;
+   for ( auto& fd : mod.functions.defs ) {
+      wasm_ops::EOSIO_OperatorDecoderStream<ops> decoder(fd.code);
+      wasm_ops::instruction_stream code(fd.code.size());
+      ops::set_local_t set_local;
+      ops::tee_local_t tee_local;
+      // set_local or tee_local, packed once the operator after it is known not to fuse with it
+      wasm_ops::instr* held = nullptr;
+
+      while ( decoder ) {
+         auto op = decoder.decodeOp();
+         const auto op_code = op->get_code();
+         if ( held == &set_local && op_code == wasm_ops::get_local_code &&
+              static_cast<ops::get_local_t*>(op)->field == set_local.field ) {
+            tee_local.field = set_local.field;
+            held = &tee_local;
+            continue;
+         }
+         if ( held == &tee_local && op_code == wasm_ops::drop_code ) {
+            set_local.field = tee_local.field;
+            held = &set_local;
+            continue;
+         }
+         if ( held ) {
+            held->pack(&code);
+            held = nullptr;
+         }
+         if ( op_code == wasm_ops::set_local_code ) {
+            set_local.field = static_cast<ops::set_local_t*>(op)->field;
+            held = &set_local;
+         } else if ( op_code == wasm_ops::tee_local_code ) {
+            tee_local.field = static_cast<ops::tee_local_t*>(op)->field;
+            held = &tee_local;
+         } else {
+            op->pack(&code);
+         }
+      }
+      if ( held )
+         held->pack(&code);
+      fd.code = code.get();
+   }
+}
+
 }}} // namespace eosio, chain, injectors
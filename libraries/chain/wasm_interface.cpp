@@ -13,6 +13,8 @@
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/protocol_state_object.hpp>
 #include <eosio/chain/account_object.hpp>
+#include <eosio/chain/signature_recovery_cache.hpp>
+#include <eosio/chain/webassembly/hardware_float.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/crypto/sha256.hpp>
 #include <fc/crypto/sha1.hpp>
@@ -23,6 +25,7 @@
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <fstream>
+#include <thread>
 #include <string.h>
 
 #if defined(EOSIO_EOS_VM_RUNTIME_ENABLED) || defined(EOSIO_EOS_VM_JIT_RUNTIME_ENABLED)
@@ -32,6 +35,9 @@
 namespace eosio { namespace chain {
    using namespace webassembly::common;
 
+   metric_counter wasm_cache_hits_metric( "nodeos_wasm_cache_hits_total", "Actions run with a module instantiated before" );
+   metric_counter wasm_cache_misses_metric( "nodeos_wasm_cache_misses_total", "Modules instantiated to run an action" );
+
    wasm_interface::wasm_interface(vm_type vm, bool eosvmoc_tierup, const chainbase::database& d, const boost::filesystem::path data_dir, const eosvmoc::config& eosvmoc_config)
      : my( new wasm_interface_impl(vm, eosvmoc_tierup, d, data_dir, eosvmoc_config) ) {}
 
@@ -73,12 +79,61 @@ namespace eosio { namespace chain {
       my->current_lib(lib);
    }
 
+   void wasm_interface::set_cache_size(uint64_t bytes) {
+      my->set_cache_size(bytes);
+   }
+
+   wasm_interface::cache_stats wasm_interface::get_cache_stats() const {
+      return my->get_cache_stats();
+   }
+
+   size_t wasm_interface::compile_ahead(const std::vector<digest_type>& code_hashes, const fc::time_point& deadline) {
+      size_t compiled = 0;
+#ifdef EOSIO_EOS_VM_OC_RUNTIME_ENABLED
+      if(!my->eosvmoc)
+         return 0;
+
+      std::vector<std::pair<digest_type, uint8_t>> pending;
+      const auto& idx = my->db.get_index<code_index,by_code_hash>();
+      for(const auto& h : code_hashes) {
+         auto itr = idx.lower_bound(boost::make_tuple(h, 0));
+         if(itr != idx.end() && itr->code_hash == h && itr->vm_type == 0)
+            pending.emplace_back(h, itr->vm_version);
+      }
+
+      // compiles only complete, and the next queued ones start, when the cache is asked for code
+      while(true) {
+         for(auto itr = pending.begin(); itr != pending.end();) {
+            const eosvmoc::code_descriptor* cd = nullptr;
+            bool failed = false;
+            try {
+               cd = my->eosvmoc->cc.get_descriptor_for_code(itr->first, itr->second);
+            } catch(...) {
+               elog("EOS VM OC has encountered an unexpected failure compiling ${h}", ("h", itr->first));
+               failed = true;
+            }
+            if(cd)
+               ++compiled;
+            if(cd || failed || my->eosvmoc->cc.is_blacklisted(itr->first, itr->second))
+               itr = pending.erase(itr);
+            else
+               ++itr;
+         }
+         if(pending.empty() || fc::time_point::now() >= deadline)
+            break;
+         std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+#endif
+      return compiled;
+   }
+
    void wasm_interface::apply( const digest_type& code_hash, const uint8_t& vm_type, const uint8_t& vm_version, apply_context& context ) {
 #ifdef EOSIO_EOS_VM_OC_RUNTIME_ENABLED
       if(my->eosvmoc) {
          const chain::eosvmoc::code_descriptor* cd = nullptr;
          try {
-            cd = my->eosvmoc->cc.get_descriptor_for_code(code_hash, vm_version);
+            //code compiled already, e.g. by warm-up, import or before a restart, is run whatever the threshold
+            cd = my->eosvmoc->cc.get_descriptor_for_code(code_hash, vm_version, my->is_hot(code_hash, vm_type, vm_version));
          }
          catch(...) {
             //swallow errors here, if EOS VM OC has gone in to the weeds we shouldn't bail: continue to try and run baseline
@@ -324,20 +379,28 @@ class softfloat_api : public context_aware_api {
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
-      // float binops
+      // float binops, in hardware when that gives the bits softfloat gives
       float _eosio_f32_add( float a, float b ) {
+         float r;
+         if( hardware_float::f32_add( a, b, r ) ) return r;
          float32_t ret = ::f32_add( to_softfloat32(a), to_softfloat32(b) );
          return *reinterpret_cast<float*>(&ret);
       }
       float _eosio_f32_sub( float a, float b ) {
+         float r;
+         if( hardware_float::f32_sub( a, b, r ) ) return r;
          float32_t ret = ::f32_sub( to_softfloat32(a), to_softfloat32(b) );
          return *reinterpret_cast<float*>(&ret);
       }
       float _eosio_f32_div( float a, float b ) {
+         float r;
+         if( hardware_float::f32_div( a, b, r ) ) return r;
          float32_t ret = ::f32_div( to_softfloat32(a), to_softfloat32(b) );
          return *reinterpret_cast<float*>(&ret);
       }
       float _eosio_f32_mul( float a, float b ) {
+         float r;
+         if( hardware_float::f32_mul( a, b, r ) ) return r;
          float32_t ret = ::f32_mul( to_softfloat32(a), to_softfloat32(b) );
          return *reinterpret_cast<float*>(&ret);
       }
@@ -392,6 +455,8 @@ class softfloat_api : public context_aware_api {
          return from_softfloat32(a);
       }
       float _eosio_f32_sqrt( float a ) {
+         float r;
+         if( hardware_float::f32_sqrt( a, r ) ) return r;
          float32_t ret = ::f32_sqrt( to_softfloat32(a) );
          return from_softfloat32(ret);
       }
@@ -493,20 +558,28 @@ class softfloat_api : public context_aware_api {
          return !::f32_lt( a, b );
       }
 
-      // double binops
+      // double binops, in hardware when that gives the bits softfloat gives
       double _eosio_f64_add( double a, double b ) {
+         double r;
+         if( hardware_float::f64_add( a, b, r ) ) return r;
          float64_t ret = ::f64_add( to_softfloat64(a), to_softfloat64(b) );
          return from_softfloat64(ret);
       }
       double _eosio_f64_sub( double a, double b ) {
+         double r;
+         if( hardware_float::f64_sub( a, b, r ) ) return r;
          float64_t ret = ::f64_sub( to_softfloat64(a), to_softfloat64(b) );
          return from_softfloat64(ret);
       }
       double _eosio_f64_div( double a, double b ) {
+         double r;
+         if( hardware_float::f64_div( a, b, r ) ) return r;
          float64_t ret = ::f64_div( to_softfloat64(a), to_softfloat64(b) );
          return from_softfloat64(ret);
       }
       double _eosio_f64_mul( double a, double b ) {
+         double r;
+         if( hardware_float::f64_mul( a, b, r ) ) return r;
          float64_t ret = ::f64_mul( to_softfloat64(a), to_softfloat64(b) );
          return from_softfloat64(ret);
       }
@@ -555,6 +628,8 @@ class softfloat_api : public context_aware_api {
          return from_softfloat64(a);
       }
       double _eosio_f64_sqrt( double a ) {
+         double r;
+         if( hardware_float::f64_sqrt( a, r ) ) return r;
          float64_t ret = ::f64_sqrt( to_softfloat64(a) );
          return from_softfloat64(ret);
       }
@@ -821,7 +896,7 @@ class crypto_api : public context_aware_api {
             EOS_ASSERT(s.variable_size() <= context.control.configured_subjective_signature_length_limit(),
                        sig_variable_size_limit_exception, "signature variable length component size greater than subjective maximum");
 
-         auto check = fc::crypto::public_key( s, digest, false );
+         auto check = signature_recovery_cache::instance().recover( s, digest, false );
          EOS_ASSERT( check == p, crypto_api_exception, "Error expected key different than recovered key" );
       }
 
@@ -840,7 +915,7 @@ class crypto_api : public context_aware_api {
                        sig_variable_size_limit_exception, "signature variable length component size greater than subjective maximum");
 
 
-         auto recovered = fc::crypto::public_key(s, digest, false);
+         auto recovered = signature_recovery_cache::instance().recover( s, digest, false );
 
          // the key types newer than the first 2 may be varible in length
          if (s.which() >= config::genesis_num_supported_key_types ) {
@@ -909,6 +984,33 @@ class crypto_api : public context_aware_api {
       void ripemd160(array_ptr<char> data, uint32_t datalen, fc::ripemd160& hash_val) {
          hash_val = encode<fc::ripemd160::encoder>( data, datalen );
       }
+
+      /**
+       * data is buffers one after the other, each a 4-byte little endian size followed by that many bytes; the digests
+       * of the buffers are written one after the other to hashes, and their number returned
+       */
+      int sha256_batch(array_ptr<char> data, uint32_t datalen, array_ptr<char> hashes, uint32_t hashes_len) {
+         std::vector<fc::sha256> results;
+         char* pos = data;
+         uint32_t left = datalen;
+         while( left ) {
+            uint32_t size = 0;
+            EOS_ASSERT( left >= sizeof(size), crypto_api_exception, "sha256_batch buffer size truncated" );
+            memcpy( &size, pos, sizeof(size) );
+            pos += sizeof(size);
+            left -= sizeof(size);
+            EOS_ASSERT( size <= left, crypto_api_exception, "sha256_batch buffer truncated" );
+            results.emplace_back( encode<fc::sha256::encoder>( pos, size ) );
+            pos += size;
+            left -= size;
+            context.trx_context.checktime();
+         }
+         EOS_ASSERT( results.size() * sizeof(fc::sha256) <= hashes_len, crypto_api_exception,
+                     "sha256_batch destination too small for ${n} digests", ("n", results.size()) );
+         // written once all are computed, the destination may overlap the buffers
+         if( !results.empty() ) memcpy( hashes, results.data(), results.size() * sizeof(fc::sha256) );
+         return results.size();
+      }
 };
 
 class permission_api : public context_aware_api {
@@ -1416,6 +1518,9 @@ class database_api : public context_aware_api {
       int db_next_i64( int itr, uint64_t& primary ) {
          return context.db_next_i64(itr, primary);
       }
+      int db_get_range_i64( int itr, int& next_itr, array_ptr<char> buffer, uint32_t buffer_size, uint32_t max_rows ) {
+         return context.db_get_range_i64( itr, next_itr, buffer, buffer_size, max_rows );
+      }
       int db_previous_i64( int itr, uint64_t& primary ) {
          return context.db_previous_i64(itr, primary);
       }
@@ -1432,6 +1537,37 @@ class database_api : public context_aware_api {
          return context.db_end_i64( name(code), name(scope), name(table) );
       }
 
+      void kv_set( array_ptr<const char> key, uint32_t key_size, array_ptr<const char> value, uint32_t value_size, uint64_t payer ) {
+         context.kv_set( key, key_size, value, value_size, account_name(payer) );
+      }
+      int kv_erase( array_ptr<const char> key, uint32_t key_size ) {
+         return context.kv_erase( key, key_size );
+      }
+      int kv_get( uint64_t contract, array_ptr<const char> key, uint32_t key_size, array_ptr<char> value, uint32_t value_size ) {
+         return context.kv_get( account_name(contract), key, key_size, value, value_size );
+      }
+      int kv_it_create( uint64_t contract, array_ptr<const char> prefix, uint32_t prefix_size ) {
+         return context.kv_it_create( account_name(contract), prefix, prefix_size );
+      }
+      void kv_it_destroy( int itr ) {
+         context.kv_it_destroy( itr );
+      }
+      int kv_it_lower_bound( int itr, array_ptr<const char> key, uint32_t key_size ) {
+         return context.kv_it_lower_bound( itr, key, key_size );
+      }
+      int kv_it_next( int itr ) {
+         return context.kv_it_next( itr );
+      }
+      int kv_it_prev( int itr ) {
+         return context.kv_it_prev( itr );
+      }
+      int kv_it_key( int itr, array_ptr<char> dest, uint32_t size ) {
+         return context.kv_it_key( itr, dest, size );
+      }
+      int kv_it_value( int itr, array_ptr<char> dest, uint32_t size ) {
+         return context.kv_it_value( itr, dest, size );
+      }
+
       DB_API_METHOD_WRAPPERS_SIMPLE_SECONDARY(idx64,  uint64_t)
       DB_API_METHOD_WRAPPERS_SIMPLE_SECONDARY(idx128, uint128_t)
       DB_API_METHOD_WRAPPERS_ARRAY_SECONDARY(idx256, 2, uint128_t)
@@ -1547,10 +1683,20 @@ class compiler_builtins : public context_aware_api {
       compiler_builtins( apply_context& ctx )
       :context_aware_api(ctx,true){}
 
+      // native 128-bit shifts, which shift 128 or more bits to 0 as fc::uint128 did; EOS VM OC emits these and __multi3
+      // inline, keep the two in step
+      static unsigned __int128 shift_left_u128(uint64_t low, uint64_t high, uint32_t shift) {
+         if( shift >= 128 ) return 0;
+         return ((unsigned __int128)high << 64 | low) << shift;
+      }
+
+      static unsigned __int128 shift_right_u128(uint64_t low, uint64_t high, uint32_t shift) {
+         if( shift >= 128 ) return 0;
+         return ((unsigned __int128)high << 64 | low) >> shift;
+      }
+
       void __ashlti3(__int128& ret, uint64_t low, uint64_t high, uint32_t shift) {
-         fc::uint128_t i(high, low);
-         i <<= shift;
-         ret = (unsigned __int128)i;
+         ret = shift_left_u128( low, high, shift );
       }
 
       void __ashrti3(__int128& ret, uint64_t low, uint64_t high, uint32_t shift) {
@@ -1562,15 +1708,11 @@ class compiler_builtins : public context_aware_api {
       }
 
       void __lshlti3(__int128& ret, uint64_t low, uint64_t high, uint32_t shift) {
-         fc::uint128_t i(high, low);
-         i <<= shift;
-         ret = (unsigned __int128)i;
+         ret = shift_left_u128( low, high, shift );
       }
 
       void __lshrti3(__int128& ret, uint64_t low, uint64_t high, uint32_t shift) {
-         fc::uint128_t i(high, low);
-         i >>= shift;
-         ret = (unsigned __int128)i;
+         ret = shift_right_u128( low, high, shift );
       }
 
       void __divti3(__int128& ret, uint64_t la, uint64_t ha, uint64_t lb, uint64_t hb) {
@@ -1915,6 +2057,17 @@ REGISTER_INTRINSICS( database_api,
    (db_lowerbound_i64,   int(int64_t,int64_t,int64_t,int64_t)         )
    (db_upperbound_i64,   int(int64_t,int64_t,int64_t,int64_t)         )
    (db_end_i64,          int(int64_t,int64_t,int64_t)                 )
+   (db_get_range_i64,    int(int, int, int, int, int)                 )
+   (kv_set,              void(int, int, int, int, int64_t)            )
+   (kv_erase,            int(int, int)                                )
+   (kv_get,              int(int64_t, int, int, int, int)             )
+   (kv_it_create,        int(int64_t, int, int)                       )
+   (kv_it_destroy,       void(int)                                    )
+   (kv_it_lower_bound,   int(int, int, int)                           )
+   (kv_it_next,          int(int)                                     )
+   (kv_it_prev,          int(int)                                     )
+   (kv_it_key,           int(int, int, int)                           )
+   (kv_it_value,         int(int, int, int)                           )
 
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx64)
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx128)
@@ -1934,6 +2087,7 @@ REGISTER_INTRINSICS(crypto_api,
    (sha256,                 void(int, int, int)           )
    (sha512,                 void(int, int, int)           )
    (ripemd160,              void(int, int, int)           )
+   (sha256_batch,           int(int, int, int, int)       )
 );
 
 
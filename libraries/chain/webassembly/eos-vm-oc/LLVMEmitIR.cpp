@@ -689,6 +689,82 @@ namespace LLVMJIT
 		// Call operators
 		//
 
+#if LLVM_VERSION_MAJOR < 10
+   #define LOAD_STORE_ALIGNMENT_PARAM 1
+#elif LLVM_VERSION_MAJOR == 10
+   #define LOAD_STORE_ALIGNMENT_PARAM llvm::MaybeAlign(1)
+#else
+   #define LOAD_STORE_ALIGNMENT_PARAM llvm::Align(1)
+#endif
+
+		// Builds an i128 out of the low and high i64 halves of a 128-bit compiler builtin argument.
+		llvm::Value* emitI128(llvm::Value* low,llvm::Value* high)
+		{
+			llvm::Type* llvmI128Type = llvm::Type::getInt128Ty(context);
+			return irBuilder.CreateOr(
+				irBuilder.CreateShl(irBuilder.CreateZExt(high,llvmI128Type),llvm::ConstantInt::get(llvmI128Type,64)),
+				irBuilder.CreateZExt(low,llvmI128Type));
+		}
+
+		// Stores an i128 where a 128-bit compiler builtin returns its result, low half first.
+		void emitStoreI128(llvm::Value* address,llvm::Value* value)
+		{
+			llvm::Type* llvmI128Type = llvm::Type::getInt128Ty(context);
+			auto low = irBuilder.CreateTrunc(value,llvmI64Type);
+			auto high = irBuilder.CreateTrunc(irBuilder.CreateLShr(value,llvm::ConstantInt::get(llvmI128Type,64)),llvmI64Type);
+			auto lowStore = irBuilder.CreateStore(low,coerceByteIndexToPointer(address,0,llvmI64Type));
+			lowStore->setVolatile(true);
+			lowStore->setAlignment(LOAD_STORE_ALIGNMENT_PARAM);
+			auto highStore = irBuilder.CreateStore(high,coerceByteIndexToPointer(address,8,llvmI64Type));
+			highStore->setVolatile(true);
+			highStore->setAlignment(LOAD_STORE_ALIGNMENT_PARAM);
+		}
+
+		// A host function call fails when the wasm call depth is exhausted, so must an intrinsic emitted inline.
+		void emitHostCallDepthCheck()
+		{
+			auto depth = irBuilder.CreateLoad(moduleContext.depthCounter);
+			emitConditionalTrapIntrinsic(irBuilder.CreateICmpEQ(depth, emitLiteral((I32)1)), "eosvmoc_internal.depth_assert", FunctionType::get(), {});
+		}
+
+		// Emits intrinsics inline instead of calling the host functions, computing what the host functions compute:
+		// current_receiver from the control block, and the 128-bit multiply and shift compiler builtins. Division and
+		// remainder are left to the host functions for their divide by zero exception.
+		bool emitInlineIntrinsic(const std::string& moduleName,const std::string& exportName)
+		{
+			if(moduleName != "env") { return false; }
+			llvm::Type* llvmI128Type = llvm::Type::getInt128Ty(context);
+			if(exportName == "current_receiver")
+			{
+				emitHostCallDepthCheck();
+				auto receiver = irBuilder.CreateLoad(emitLiteralPointer((void*)OFFSET_OF_CONTROL_BLOCK_MEMBER(receiver), llvmI64Type->getPointerTo(256)));
+				push(receiver);
+				return true;
+			}
+			if(exportName == "__multi3")
+			{
+				emitHostCallDepthCheck();
+				auto hb = pop(); auto lb = pop(); auto ha = pop(); auto la = pop();
+				auto ret = pop();
+				emitStoreI128(ret,irBuilder.CreateMul(emitI128(la,ha),emitI128(lb,hb)));
+				return true;
+			}
+			if(exportName == "__ashlti3" || exportName == "__lshlti3" || exportName == "__lshrti3")
+			{
+				emitHostCallDepthCheck();
+				auto shift = irBuilder.CreateZExt(pop(),llvmI128Type);
+				auto high = pop(); auto low = pop();
+				auto ret = pop();
+				auto value = emitI128(low,high);
+				// shifting by 128 or more gives 0, as fc::uint128 does
+				auto shifted = exportName == "__lshrti3" ? irBuilder.CreateLShr(value,shift) : irBuilder.CreateShl(value,shift);
+				auto inRange = irBuilder.CreateICmpULT(shift,llvm::ConstantInt::get(llvmI128Type,128));
+				emitStoreI128(ret,irBuilder.CreateSelect(inRange,shifted,llvm::ConstantInt::get(llvmI128Type,0)));
+				return true;
+			}
+			return false;
+		}
+
 		void call(CallImm imm)
 		{
 			// Map the callee function index to either an imported function pointer or a function in this module.
@@ -697,6 +773,8 @@ namespace LLVMJIT
 			bool isExit = false;
 			if(imm.functionIndex < moduleContext.importedFunctionOffsets.size())
 			{
+				if(emitInlineIntrinsic(module.functions.imports[imm.functionIndex].moduleName,
+				                       module.functions.imports[imm.functionIndex].exportName)) { return; }
 				calleeType = module.types[module.functions.imports[imm.functionIndex].type.index];
 				llvm::Value* ic = irBuilder.CreateLoad( emitLiteralPointer((void*)(OFFSET_OF_FIRST_INTRINSIC-moduleContext.importedFunctionOffsets[imm.functionIndex]*8), llvmI64Type->getPointerTo(256)) );
 				callee = irBuilder.CreateIntToPtr(ic, asLLVMType(calleeType)->getPointerTo());
@@ -905,14 +983,6 @@ namespace LLVMJIT
 
 		llvm::Value* identityConversion(llvm::Value* value,llvm::Type* type) { return value; }
 
-#if LLVM_VERSION_MAJOR < 10
-   #define LOAD_STORE_ALIGNMENT_PARAM 1
-#elif LLVM_VERSION_MAJOR == 10
-   #define LOAD_STORE_ALIGNMENT_PARAM llvm::MaybeAlign(1)
-#else
-   #define LOAD_STORE_ALIGNMENT_PARAM llvm::Align(1)
-#endif
-
 		EMIT_LOAD_OP(i32,load8_s,llvmI8Type,0,irBuilder.CreateSExt,LOAD_STORE_ALIGNMENT_PARAM)  EMIT_LOAD_OP(i32,load8_u,llvmI8Type,0,irBuilder.CreateZExt,LOAD_STORE_ALIGNMENT_PARAM)
 		EMIT_LOAD_OP(i32,load16_s,llvmI16Type,1,irBuilder.CreateSExt,LOAD_STORE_ALIGNMENT_PARAM) EMIT_LOAD_OP(i32,load16_u,llvmI16Type,1,irBuilder.CreateZExt,LOAD_STORE_ALIGNMENT_PARAM)
 		EMIT_LOAD_OP(i64,load8_s,llvmI8Type,0,irBuilder.CreateSExt,LOAD_STORE_ALIGNMENT_PARAM)  EMIT_LOAD_OP(i64,load8_u,llvmI8Type,0,irBuilder.CreateZExt,LOAD_STORE_ALIGNMENT_PARAM)
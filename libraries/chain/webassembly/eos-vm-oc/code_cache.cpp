@@ -19,6 +19,14 @@
 #include "WASM/WASM.h"
 #include "LLVMJIT.h"
 
+#pragma push_macro("N")
+#undef N
+#include "llvm/Support/Host.h"
+#pragma pop_macro("N")
+
+#include <algorithm>
+#include <fstream>
+
 using namespace IR;
 using namespace Runtime;
 
@@ -39,6 +47,34 @@ static constexpr size_t descriptor_ptr_from_file_start = header_offset + offseto
 
 static_assert(sizeof(code_cache_header) <= header_size, "code_cache_header too big");
 
+static constexpr uint64_t export_id = 0x58434f4d56534f45ULL; //"EOSVMOCX" little endian
+
+//compiled code as it is exported, independent of where it was in the exporting code cache
+struct exported_code {
+   code_descriptor   descriptor; //code_begin and initdata_begin are unused
+   std::vector<char> code;
+   std::vector<char> initdata;
+};
+
+}}}
+
+FC_REFLECT(eosio::chain::eosvmoc::exported_code, (descriptor)(code)(initdata));
+
+namespace eosio { namespace chain { namespace eosvmoc {
+
+//compiled code refers to intrinsics by ordinal and is generated for the process triple with no CPU specific features,
+// so it runs on any nodeos agreeing on these
+static fc::sha256 export_compatibility_key() {
+   fc::sha256::encoder enc;
+   fc::raw::pack(enc, header_id);
+   fc::raw::pack(enc, llvm::sys::getProcessTriple());
+   for(const auto& [name, entry] : get_intrinsic_map()) {
+      fc::raw::pack(enc, name);
+      fc::raw::pack(enc, static_cast<uint64_t>(entry.ordinal));
+   }
+   return enc.result();
+}
+
 code_cache_async::code_cache_async(const bfs::path data_dir, const eosvmoc::config& eosvmoc_config, const chainbase::database& db) :
    code_cache_base(data_dir, eosvmoc_config, db),
    _result_queue(eosvmoc_config.threads * 2),
@@ -102,11 +138,13 @@ std::tuple<size_t, size_t> code_cache_async::consume_compile_thread_queue() {
       _outstanding_compiles_and_poison.erase(result.code);
       bytes_remaining = result.cache_free_bytes;
    });
+   if(gotsome)
+      _stats.free_bytes = bytes_remaining;
 
    return {gotsome, bytes_remaining};
 }
 
-const code_descriptor* const code_cache_async::get_descriptor_for_code(const digest_type& code_id, const uint8_t& vm_version) {
+const code_descriptor* const code_cache_async::get_descriptor_for_code(const digest_type& code_id, const uint8_t& vm_version, bool queue_compile) {
    //if there are any outstanding compiles, process the result queue now
    if(_outstanding_compiles_and_poison.size()) {
       auto [count_processed, bytes_remaining] = consume_compile_thread_queue();
@@ -115,16 +153,19 @@ const code_descriptor* const code_cache_async::get_descriptor_for_code(const dig
          check_eviction_threshold(bytes_remaining);
 
       while(count_processed && _queued_compiles.size()) {
-         auto nextup = _queued_compiles.begin();
+         auto nextup = next_queued_compile();
+         if(nextup == _queued_compiles.end())
+            break;
+         const code_tuple ct = nextup->first;
 
          //it's not clear this check is required: if apply() was called for code then it existed in the code_index; and then
          // if we got notification of it no longer existing we would have removed it from queued_compiles
-         const code_object* const codeobject = _db.find<code_object,by_code_hash>(boost::make_tuple(nextup->code_id, 0, nextup->vm_version));
+         const code_object* const codeobject = _db.find<code_object,by_code_hash>(boost::make_tuple(ct.code_id, 0, ct.vm_version));
          if(codeobject) {
-            _outstanding_compiles_and_poison.emplace(*nextup, false);
+            _outstanding_compiles_and_poison.emplace(ct, false);
             std::vector<wrapped_fd> fds_to_pass;
             fds_to_pass.emplace_back(memfd_for_bytearray(codeobject->code));
-            FC_ASSERT(write_message_with_fds(_compile_monitor_write_socket, compile_wasm_message{ *nextup }, fds_to_pass), "EOS VM failed to communicate to OOP manager");
+            FC_ASSERT(write_message_with_fds(_compile_monitor_write_socket, compile_wasm_message{ ct }, fds_to_pass), "EOS VM failed to communicate to OOP manager");
             --count_processed;
          }
          _queued_compiles.erase(nextup);
@@ -133,10 +174,9 @@ const code_descriptor* const code_cache_async::get_descriptor_for_code(const dig
 
    //check for entry in cache
    code_cache_index::index<by_hash>::type::iterator it = _cache_index.get<by_hash>().find(boost::make_tuple(code_id, vm_version));
-   if(it != _cache_index.get<by_hash>().end()) {
-      _cache_index.relocate(_cache_index.begin(), _cache_index.project<0>(it));
-      return &*it;
-   }
+   if(it != _cache_index.get<by_hash>().end())
+      return record_hit(it);
+   ++_stats.misses;
 
    const code_tuple ct = code_tuple{code_id, vm_version};
 
@@ -146,11 +186,16 @@ const code_descriptor* const code_cache_async::get_descriptor_for_code(const dig
       it->second = false;
       return nullptr;
    }
-   if(_queued_compiles.find(ct) != _queued_compiles.end())
+   if(auto it = _queued_compiles.find(ct); it != _queued_compiles.end()) {
+      ++it->second.requests;
+      it->second.last_request = fc::time_point::now();
+      return nullptr;
+   }
+   if(!queue_compile)
       return nullptr;
 
    if(_outstanding_compiles_and_poison.size() >= _threads) {
-      _queued_compiles.emplace(ct);
+      _queued_compiles.emplace(ct, queued_compile{1, fc::time_point::now()});
       return nullptr;
    }
 
@@ -165,6 +210,24 @@ const code_descriptor* const code_cache_async::get_descriptor_for_code(const dig
    return nullptr;
 }
 
+std::unordered_map<code_tuple, code_cache_base::queued_compile>::iterator code_cache_async::next_queued_compile() {
+   //one-off code, such as a burst of new deployments that are each run once, is left to the other runtime
+   constexpr auto stale_after = fc::seconds(60);
+   const fc::time_point stale = fc::time_point::now() - stale_after;
+
+   auto best = _queued_compiles.end();
+   for(auto it = _queued_compiles.begin(); it != _queued_compiles.end();) {
+      if(it->second.last_request < stale) {
+         it = _queued_compiles.erase(it);
+         continue;
+      }
+      if(best == _queued_compiles.end() || it->second.requests > best->second.requests)
+         best = it;
+      ++it;
+   }
+   return best;
+}
+
 code_cache_sync::~code_cache_sync() {
    //it's exceedingly critical that we wait for the compile monitor to be done with all its work
    //This is easy in the sync case
@@ -177,10 +240,9 @@ code_cache_sync::~code_cache_sync() {
 const code_descriptor* const code_cache_sync::get_descriptor_for_code_sync(const digest_type& code_id, const uint8_t& vm_version) {
    //check for entry in cache
    code_cache_index::index<by_hash>::type::iterator it = _cache_index.get<by_hash>().find(boost::make_tuple(code_id, vm_version));
-   if(it != _cache_index.get<by_hash>().end()) {
-      _cache_index.relocate(_cache_index.begin(), _cache_index.project<0>(it));
-      return &*it;
-   }
+   if(it != _cache_index.get<by_hash>().end())
+      return record_hit(it);
+   ++_stats.misses;
 
    const code_object* const codeobject = _db.find<code_object,by_code_hash>(boost::make_tuple(code_id, 0, vm_version));
    if(!codeobject) //should be impossible right?
@@ -197,6 +259,7 @@ const code_descriptor* const code_cache_sync::get_descriptor_for_code_sync(const
    wasm_compilation_result_message result = message.get<wasm_compilation_result_message>();
    EOS_ASSERT(result.result.contains<code_descriptor>(), wasm_execution_error, "failed to compile wasm");
 
+   _stats.free_bytes = result.cache_free_bytes;
    check_eviction_threshold(result.cache_free_bytes);
 
    return &*_cache_index.push_front(std::move(result.result.get<code_descriptor>())).first;
@@ -273,6 +336,14 @@ code_cache_base::code_cache_base(const boost::filesystem::path data_dir, const e
 
       ilog("EOS VM Optimized Compiler code cache loaded with ${c} entries; ${f} of ${t} bytes free", ("c", number_entries)("f", allocator->get_free_memory())("t", allocator->get_size()));
    }
+
+   for(const bfs::path& p : eosvmoc_config.import_paths) {
+      try {
+         import_code(p, code_mapping, allocator);
+      } FC_LOG_AND_DROP();
+   }
+   _export_path = eosvmoc_config.export_path;
+   _stats.free_bytes = allocator->get_free_memory();
    munmap(code_mapping, eosvmoc_config.cache_size);
 
    _free_bytes_eviction_threshold = eosvmoc_config.cache_size * .1;
@@ -304,6 +375,10 @@ void code_cache_base::serialize_cache_index(fc::datastream<T>& ds) {
 }
 
 code_cache_base::~code_cache_base() {
+   const stats st = get_stats();
+   ilog("EOS VM OC code cache: ${h} hits, ${m} misses, ${e} evictions, ${n} entries",
+        ("h", st.hits)("m", st.misses)("e", st.evictions)("n", st.entries));
+
    //reopen the code cache in our process
    struct stat st;
    if(fstat(_cache_fd, &st))
@@ -314,6 +389,12 @@ code_cache_base::~code_cache_base() {
 
    allocator_t* allocator = reinterpret_cast<allocator_t*>(code_mapping);
 
+   if(!_export_path.empty()) {
+      try {
+         export_code(code_mapping, allocator);
+      } FC_LOG_AND_DROP();
+   }
+
    //serialize out the cache index
    fc::datastream<size_t> dssz;
    serialize_cache_index(dssz);
@@ -350,12 +431,101 @@ code_cache_base::~code_cache_base() {
 
 }
 
+void code_cache_base::import_code(const bfs::path& path, char* code_mapping, allocator_t* allocator) {
+   std::ifstream in(path.generic_string(), std::ifstream::binary);
+   EOS_ASSERT(in.good(), database_exception, "unable to open EOS VM OC code cache export ${p}", ("p", path.generic_string()));
+
+   uint64_t id = 0;
+   fc::sha256 key;
+   in.read((char*)&id, sizeof(id));
+   in.read(key.data(), key.data_size());
+   EOS_ASSERT(!in.fail() && id == export_id, bad_database_version_exception,
+              "${p} is not an EOS VM OC code cache export", ("p", path.generic_string()));
+   EOS_ASSERT(key == export_compatibility_key(), bad_database_version_exception,
+              "EOS VM OC code cache export ${p} was made by an incompatible nodeos", ("p", path.generic_string()));
+
+   unsigned imported = 0, present = 0;
+   std::vector<char> packed;
+   uint64_t size;
+   while(in.read((char*)&size, sizeof(size))) {
+      EOS_ASSERT(size <= allocator->get_size(), database_exception, "EOS VM OC code cache export ${p} is corrupt", ("p", path.generic_string()));
+      packed.resize(size);
+      in.read(packed.data(), size);
+      EOS_ASSERT(!in.fail(), database_exception, "EOS VM OC code cache export ${p} ended unexpectedly", ("p", path.generic_string()));
+      exported_code e = fc::raw::unpack<exported_code>(packed);
+
+      if(e.descriptor.codegen_version != 0 ||
+         _cache_index.get<by_hash>().count(boost::make_tuple(e.descriptor.code_hash, e.descriptor.vm_version))) {
+         ++present;
+         continue;
+      }
+
+      void* code_ptr = allocator->allocate(e.code.size());
+      void* mem_ptr = allocator->allocate(e.initdata.size());
+      if(code_ptr == nullptr || mem_ptr == nullptr) {
+         allocator->deallocate(code_ptr);
+         allocator->deallocate(mem_ptr);
+         wlog("EOS VM OC code cache is full, the rest of ${p} is not imported", ("p", path.generic_string()));
+         break;
+      }
+      memcpy(code_ptr, e.code.data(), e.code.size());
+      memcpy(mem_ptr, e.initdata.data(), e.initdata.size());
+
+      e.descriptor.code_begin = (char*)code_ptr - code_mapping;
+      e.descriptor.initdata_begin = (char*)mem_ptr - code_mapping;
+      e.descriptor.initdata_size = e.initdata.size();
+      _cache_index.push_back(std::move(e.descriptor));
+      ++imported;
+   }
+
+   ilog("Imported ${c} compiled contracts from EOS VM OC code cache export ${p}, ${s} were already cached",
+        ("c", imported)("p", path.generic_string())("s", present));
+}
+
+void code_cache_base::export_code(char* code_mapping, allocator_t* allocator) {
+   //written aside and renamed, an export being read is never partially written
+   bfs::path tmp_path = _export_path;
+   tmp_path += ".tmp";
+   std::ofstream out(tmp_path.generic_string(), std::ofstream::binary | std::ofstream::trunc);
+   EOS_ASSERT(out.good(), database_exception, "unable to create EOS VM OC code cache export ${p}", ("p", tmp_path.generic_string()));
+
+   const fc::sha256 key = export_compatibility_key();
+   out.write((const char*)&export_id, sizeof(export_id));
+   out.write(key.data(), key.data_size());
+
+   //most recently used first, as importing keeps the order
+   for(const code_descriptor& cd : _cache_index) {
+      exported_code e{cd};
+      e.descriptor.code_begin = 0;
+      e.descriptor.initdata_begin = 0;
+      //the size of the code is not kept, its allocation is at least as large
+      const char* code = code_mapping + cd.code_begin;
+      e.code.assign(code, code + allocator->size(code));
+      const char* initdata = code_mapping + cd.initdata_begin;
+      e.initdata.assign(initdata, initdata + cd.initdata_size);
+
+      const std::vector<char> packed = fc::raw::pack(e);
+      const uint64_t size = packed.size();
+      out.write((const char*)&size, sizeof(size));
+      out.write(packed.data(), packed.size());
+   }
+
+   out.close();
+   if(out.fail()) {
+      bfs::remove(tmp_path);
+      EOS_THROW(database_exception, "failed writing EOS VM OC code cache export ${p}", ("p", tmp_path.generic_string()));
+   }
+   bfs::rename(tmp_path, _export_path);
+   ilog("Exported ${c} compiled contracts to EOS VM OC code cache export ${p}", ("c", _cache_index.size())("p", _export_path.generic_string()));
+}
+
 void code_cache_base::free_code(const digest_type& code_id, const uint8_t& vm_version) {
    code_cache_index::index<by_hash>::type::iterator it = _cache_index.get<by_hash>().find(boost::make_tuple(code_id, vm_version));
    if(it != _cache_index.get<by_hash>().end()) {
       write_message_with_fds(_compile_monitor_write_socket, evict_wasms_message{ {*it} });
       _cache_index.get<by_hash>().erase(it);
    }
+   _use_counts.erase({code_id, vm_version});
 
    //if it's in the queued list, erase it
    _queued_compiles.erase({code_id, vm_version});
@@ -368,15 +538,56 @@ void code_cache_base::free_code(const digest_type& code_id, const uint8_t& vm_ve
       compiling_it->second = true;
 }
 
+const code_descriptor* code_cache_base::record_hit(code_cache_index::index<by_hash>::type::iterator it) {
+   ++_stats.hits;
+   ++_use_counts[code_tuple{it->code_hash, it->vm_version}];
+   _cache_index.relocate(_cache_index.begin(), _cache_index.project<0>(it));
+   return &*it;
+}
+
 void code_cache_base::run_eviction_round() {
+   //a contract compiled again costs in proportion to its size, each time it is used after being evicted; of the least
+   // recently used entries, those with the lowest uses times size go
+   constexpr unsigned candidates = 100;
+   constexpr unsigned evicted = 25;
+
+   struct candidate {
+      code_cache_index::iterator it;
+      uint64_t                   weight;
+   };
+   std::vector<candidate> lru;
+   auto it = _cache_index.end();
+   //the most recently used entry, which is about to run, is never evicted
+   while(lru.size() < candidates && it != _cache_index.begin() && std::next(_cache_index.begin()) != it) {
+      --it;
+      const code_object* const codeobject = _db.find<code_object,by_code_hash>(boost::make_tuple(it->code_hash, 0, it->vm_version));
+      const uint64_t size = codeobject ? codeobject->code.size() : 0;
+      const auto uses = _use_counts.find(code_tuple{it->code_hash, it->vm_version});
+      lru.push_back({it, (1 + (uses == _use_counts.end() ? 0 : uses->second)) * size});
+   }
+   const size_t count = std::min<size_t>(evicted, lru.size());
+   std::partial_sort(lru.begin(), lru.begin() + count, lru.end(), [](const candidate& a, const candidate& b) {
+      return a.weight < b.weight;
+   });
+
    evict_wasms_message evict_msg;
-   for(unsigned int i = 0; i < 25 && _cache_index.size() > 1; ++i) {
-      evict_msg.codes.emplace_back(_cache_index.back());
-      _cache_index.pop_back();
+   for(size_t i = 0; i < count; ++i) {
+      evict_msg.codes.emplace_back(*lru[i].it);
+      _use_counts.erase(code_tuple{lru[i].it->code_hash, lru[i].it->vm_version});
+      _cache_index.erase(lru[i].it);
    }
+   _stats.evictions += count;
    write_message_with_fds(_compile_monitor_write_socket, evict_msg);
 }
 
+code_cache_base::stats code_cache_base::get_stats() const {
+   stats st = _stats;
+   st.entries = _cache_index.size();
+   st.queued_compiles = _queued_compiles.size();
+   st.outstanding_compiles = _outstanding_compiles_and_poison.size();
+   return st;
+}
+
 void code_cache_base::check_eviction_threshold(size_t free_bytes) {
    if(free_bytes < _free_bytes_eviction_threshold)
       run_eviction_round();
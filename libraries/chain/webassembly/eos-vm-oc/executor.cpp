@@ -153,22 +153,27 @@ void executor::execute(const code_descriptor& code, const memory& mem, apply_con
       mapping_is_executable = true;
    }
 
-   //prepare initial memory, mutable globals, and table data
+   control_block* const cb = mem.get_control_block();
+
+   //prepare initial memory, mutable globals, and table data. only the pages written by previous executions need
+   // zeroing, grow_memory likewise zeroes only the dirty pages it grows in to
    if(code.starting_memory_pages > 0 ) {
       arch_prctl(ARCH_SET_GS, (unsigned long*)(mem.zero_page_memory_base()+code.starting_memory_pages*memory::stride));
-      memset(mem.full_page_memory_base(), 0, 64u*1024u*code.starting_memory_pages);
+      memset(mem.full_page_memory_base(), 0, 64u*1024u*std::min<int64_t>(code.starting_memory_pages, cb->dirty_linear_memory_pages));
+      if(code.starting_memory_pages >= cb->dirty_linear_memory_pages)
+         cb->dirty_linear_memory_pages = 0;
    }
    else
       arch_prctl(ARCH_SET_GS, (unsigned long*)mem.zero_page_memory_base());
    memcpy(mem.full_page_memory_base() - code.initdata_prologue_size, code_mapping + code.initdata_begin, code.initdata_size);
 
-   control_block* const cb = mem.get_control_block();
    cb->magic = signal_sentinel;
    cb->execution_thread_code_start = (uintptr_t)code_mapping;
    cb->execution_thread_code_length = code_mapping_size;
    cb->execution_thread_memory_start = (uintptr_t)mem.start_of_memory_slices();
    cb->execution_thread_memory_length = mem.size_of_memory_slice_mapping();
    cb->ctx = &context;
+   cb->receiver = context.get_receiver().to_uint64_t();
    executors_exception_ptr = nullptr;
    cb->eptr = &executors_exception_ptr;
    cb->current_call_depth_remaining = eosio::chain::wasm_constraints::maximum_call_depth+2;
@@ -189,6 +194,7 @@ void executor::execute(const code_descriptor& code, const memory& mem, apply_con
 
    auto cleanup = fc::make_scoped_exit([cb, &tt=context.trx_context.transaction_timer](){
       cb->is_running = false;
+      cb->dirty_linear_memory_pages = std::max(cb->dirty_linear_memory_pages, cb->current_linear_memory_pages);
       cb->bounce_buffers->clear();
       tt.set_expiration_callback(nullptr, nullptr);
    });
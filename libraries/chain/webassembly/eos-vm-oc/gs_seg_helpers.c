@@ -24,8 +24,12 @@ int32_t eos_vm_oc_grow_memory(int32_t grow, int32_t max) {
    cb_ptr->current_linear_memory_pages += grow_amount;
    cb_ptr->first_invalid_memory_address += grow_amount*64*1024;
 
-   if(grow_amount > 0)
-      memset(cb_ptr->full_linear_memory_start + previous_page_count*64u*1024u, 0, grow_amount*64u*1024u);
+   if(grow_amount > 0 && (int64_t)previous_page_count < cb_ptr->dirty_linear_memory_pages) {
+      uint64_t dirty_end = previous_page_count + grow_amount;
+      if((int64_t)dirty_end > cb_ptr->dirty_linear_memory_pages)
+         dirty_end = cb_ptr->dirty_linear_memory_pages;
+      memset(cb_ptr->full_linear_memory_start + previous_page_count*64u*1024u, 0, (dirty_end - previous_page_count)*64u*1024u);
+   }
 
    return (int32_t)previous_page_count;
 }
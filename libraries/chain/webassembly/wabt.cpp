@@ -77,6 +77,7 @@ wabt_runtime::wabt_runtime() {}
 bool wabt_runtime::inject_module(IR::Module& module) {
    wasm_injections::wasm_binary_injection<true> injector(module);
    injector.inject();
+   wasm_injections::local_op_fusion::fuse(module);
    return true;
 }
 
@@ -161,6 +161,18 @@ namespace eosio { namespace testing {
          void              init(controller::config config, protocol_feature_set&& pfs);
          void              execute_setup_policy(const setup_policy policy);
 
+         /// whether the test binary was given --setup-snapshots, which makes the testers start from setup_snapshot
+         static bool                setup_from_snapshots();
+         /**
+          * A snapshot of a chain set up with policy, made once per process by the first tester asking for it, so that
+          * the others start from it in milliseconds instead of deploying contracts and activating features again.
+          * Unlike a chain set up in place it has no blocks before the snapshot, and the block holding the end of the
+          * setup is already produced.
+          */
+         static snapshot_reader_ptr setup_snapshot( setup_policy policy,
+                                                    optional<uint32_t> genesis_max_inline_action_size = optional<uint32_t>{},
+                                                    optional<uint32_t> config_max_nonprivileged_inline_action_size = optional<uint32_t>{} );
+
          void              close();
          template <typename Lambda>
          void              open( protocol_feature_set&& pfs, fc::optional<chain_id_type> expected_chain_id, Lambda lambda );
@@ -396,8 +408,6 @@ namespace eosio { namespace testing {
             cfg.state_dir  = tempdir.path() / config::default_state_dir_name;
             cfg.state_size = 1024*1024*16;
             cfg.state_guard_size = 0;
-            cfg.reversible_cache_size = 1024*1024*8;
-            cfg.reversible_guard_size = 0;
             cfg.contracts_console = true;
             cfg.eosvmoc_config.cache_size = 1024*1024*8;
 
@@ -429,6 +439,11 @@ namespace eosio { namespace testing {
          void             _start_block(fc::time_point block_time);
          signed_block_ptr _finish_block();
 
+         /// init with config from the setup_snapshot of policy, taking the producers' last blocks from it as well
+         void             init_from_setup_snapshot( controller::config config, setup_policy policy,
+                                                    optional<uint32_t> genesis_max_inline_action_size = optional<uint32_t>{},
+                                                    optional<uint32_t> config_max_nonprivileged_inline_action_size = optional<uint32_t>{} );
+
       // Fields:
       protected:
          // tempdir field must come before control so that during destruction the tempdir is deleted only after controller finishes
@@ -533,6 +548,12 @@ namespace eosio { namespace testing {
          config_validator(vcfg);
          vcfg.trusted_producers = trusted_producers;
 
+         if( setup_from_snapshots() ) {
+            validating_node = create_validating_node(vcfg, setup_snapshot(setup_policy::full));
+            init_from_setup_snapshot(def_conf.first, setup_policy::full);
+            return;
+         }
+
          validating_node = create_validating_node(vcfg, def_conf.second, true);
 
          init(def_conf.first, def_conf.second);
@@ -561,6 +582,15 @@ namespace eosio { namespace testing {
          return validating_node;
       }
 
+      static unique_ptr<controller> create_validating_node(controller::config vcfg, const snapshot_reader_ptr& snapshot) {
+         const auto chain_id = controller::extract_chain_id(*snapshot);
+         snapshot->return_to_header();
+         unique_ptr<controller> validating_node = std::make_unique<controller>(vcfg, make_protocol_feature_set(), chain_id);
+         validating_node->add_indices();
+         validating_node->startup( []() { return false; }, snapshot );
+         return validating_node;
+      }
+
       validating_tester(const fc::temp_directory& tempdir, bool use_genesis) {
          auto def_conf = default_config(tempdir);
          vcfg = def_conf.first;
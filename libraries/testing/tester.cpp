@@ -10,6 +10,8 @@
 #include <boost/iostreams/filter/gzip.hpp>
 
 #include <fstream>
+#include <list>
+#include <sstream>
 
 #include <contracts.hpp>
 
@@ -150,11 +152,92 @@ namespace eosio { namespace testing {
      return control->head_block_id() == other.control->head_block_id();
    }
 
+   namespace {
+      struct setup_snapshot_entry {
+         setup_policy                       policy;
+         optional<uint32_t>                 genesis_max_inline_action_size;
+         optional<uint32_t>                 config_max_nonprivileged_inline_action_size;
+         std::string                        snapshot;
+         map<account_name, block_id_type>   last_produced_block;
+      };
+
+      /// Boost.Test runs the test cases of a process one after another, so this needs no lock
+      std::list<setup_snapshot_entry> setup_snapshots;
+
+      const setup_snapshot_entry& find_setup_snapshot( setup_policy policy, optional<uint32_t> genesis_max_inline_action_size,
+                                                       optional<uint32_t> config_max_nonprivileged_inline_action_size ) {
+         for( const auto& e : setup_snapshots ) {
+            if( e.policy == policy && e.genesis_max_inline_action_size == genesis_max_inline_action_size
+                && e.config_max_nonprivileged_inline_action_size == config_max_nonprivileged_inline_action_size ) {
+               return e;
+            }
+         }
+
+         tester chain( setup_policy::none, db_read_mode::SPECULATIVE, genesis_max_inline_action_size,
+                       config_max_nonprivileged_inline_action_size );
+         chain.execute_setup_policy( policy );
+         // a snapshot cannot be taken of a pending block
+         chain.produce_block();
+         chain.control->abort_block();
+
+         std::ostringstream out;
+         auto writer = std::make_shared<ostream_snapshot_writer>( out );
+         chain.control->write_snapshot( writer );
+         writer->finalize();
+
+         setup_snapshots.push_back( { policy, genesis_max_inline_action_size, config_max_nonprivileged_inline_action_size,
+                                      out.str(), chain.get_last_produced_block_map() } );
+         return setup_snapshots.back();
+      }
+
+      /// keeps the stream it reads alive
+      struct string_snapshot_reader : istream_snapshot_reader {
+         explicit string_snapshot_reader( const std::shared_ptr<std::istringstream>& in )
+         :istream_snapshot_reader( *in )
+         ,in( in )
+         {}
+
+         std::shared_ptr<std::istringstream> in;
+      };
+   }
+
+   bool base_tester::setup_from_snapshots() {
+      static const bool enabled = []() {
+         const auto& suite = boost::unit_test::framework::master_test_suite();
+         for( int i = 0; i < suite.argc; ++i ) {
+            if( suite.argv[i] == std::string( "--setup-snapshots" ) ) return true;
+         }
+         return false;
+      }();
+      return enabled;
+   }
+
+   snapshot_reader_ptr base_tester::setup_snapshot( setup_policy policy, optional<uint32_t> genesis_max_inline_action_size,
+                                                    optional<uint32_t> config_max_nonprivileged_inline_action_size ) {
+      const auto& e = find_setup_snapshot( policy, genesis_max_inline_action_size, config_max_nonprivileged_inline_action_size );
+      return std::make_shared<string_snapshot_reader>( std::make_shared<std::istringstream>( e.snapshot ) );
+   }
+
+   void base_tester::init_from_setup_snapshot( controller::config config, setup_policy policy,
+                                               optional<uint32_t> genesis_max_inline_action_size,
+                                               optional<uint32_t> config_max_nonprivileged_inline_action_size ) {
+      const auto& e = find_setup_snapshot( policy, genesis_max_inline_action_size, config_max_nonprivileged_inline_action_size );
+      init( config, std::make_shared<string_snapshot_reader>( std::make_shared<std::istringstream>( e.snapshot ) ) );
+      last_produced_block = e.last_produced_block;
+   }
+
    void base_tester::init(const setup_policy policy, db_read_mode read_mode, optional<uint32_t> genesis_max_inline_action_size, optional<uint32_t> config_max_nonprivileged_inline_action_size) {
       auto def_conf = default_config(tempdir, genesis_max_inline_action_size, config_max_nonprivileged_inline_action_size);
       def_conf.first.read_mode = read_mode;
-      cfg = def_conf.first;
 
+      // only the speculative mode snapshots the head the setup left, the others would start at an older block
+      if( policy != setup_policy::none && read_mode == db_read_mode::SPECULATIVE && setup_from_snapshots() ) {
+         init_from_setup_snapshot( def_conf.first, policy, genesis_max_inline_action_size,
+                                   config_max_nonprivileged_inline_action_size );
+         return;
+      }
+
+      cfg = def_conf.first;
       open(def_conf.second);
       execute_setup_policy(policy);
    }
@@ -466,7 +549,7 @@ namespace eosio { namespace testing {
    void base_tester::produce_min_num_of_blocks_to_spend_time_wo_inactive_prod(const fc::microseconds target_elapsed_time) {
       fc::microseconds elapsed_time;
       while (elapsed_time < target_elapsed_time) {
-         for(uint32_t i = 0; i < control->head_block_state()->active_schedule.producers.size(); i++) {
+         for(uint32_t i = 0; i < control->head_block_state()->active_schedule->producers.size(); i++) {
             const auto time_to_skip = fc::milliseconds(config::producer_repetitions * config::block_interval_ms);
             produce_block(time_to_skip);
             elapsed_time += time_to_skip;
@@ -1,7 +1,14 @@
 #include <eosio/chain_api_plugin/chain_api_plugin.hpp>
+#include <eosio/chain/contract_types.hpp>
 #include <eosio/chain/exceptions.hpp>
 
 #include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <set>
 
 namespace eosio {
 
@@ -14,15 +21,326 @@ public:
    chain_api_plugin_impl(controller& db)
       : db(db) {}
 
+   /// cached responses are answered from the head block, and for code and ABIs also from the pending block
+   void invalidate_cached_responses_on_change( http_plugin& http ) {
+      accepted_block_connection.emplace( db.accepted_block.connect( [&http]( const chain::block_state_ptr& ) {
+         http.invalidate_cached_responses();
+      } ) );
+      irreversible_block_connection.emplace( db.irreversible_block.connect( [&http]( const chain::block_state_ptr& ) {
+         http.invalidate_cached_responses();
+      } ) );
+      applied_transaction_connection.emplace( db.applied_transaction.connect(
+            [&http]( std::tuple<const chain::transaction_trace_ptr&, const chain::signed_transaction&> t ) {
+         const auto& trace = std::get<0>(t);
+         if( !trace || trace->except ) return;
+         for( const auto& at : trace->action_traces ) {
+            if( at.receiver == chain::config::system_account_name && at.act.account == chain::config::system_account_name &&
+                ( at.act.name == chain::setcode::get_name() || at.act.name == chain::setabi::get_name() ) ) {
+               http.invalidate_cached_responses();
+               return;
+            }
+         }
+      } ) );
+   }
+
+   /**
+    * Clients subscribe to chain.head to be notified of every accepted block, and to chain.table_rows to be
+    * notified of the rows of a table changed by each block, instead of polling get_info and get_table_rows
+    */
+   void add_subscriptions( http_plugin& http, chain_apis::read_only ro_api ) {
+      http.add_subscription_handler( "chain.head", [this]( const fc::variant&, const subscription_ptr& sub ) {
+         if( db.head_block_state() ) {
+            sub->send( head_notification( db.head_block_state() ) );
+         }
+         head_subscriptions.push_back( sub );
+      } );
+      http.add_subscription_handler( "chain.table_rows", [this]( const fc::variant& params, const subscription_ptr& sub ) {
+         const auto& p = params.get_object();
+         table_subscriptions.emplace_back( std::make_tuple( p["code"].as<chain::name>(), p["scope"].as<chain::name>(), p["table"].as<chain::name>() ), sub );
+      } );
+      subscriptions_block_connection.emplace( db.accepted_block.connect( [this, ro_api, &http]( const chain::block_state_ptr& bsp ) {
+         notify_subscriptions( bsp, ro_api, http );
+      } ) );
+   }
+
+   fc::variant head_notification( const chain::block_state_ptr& bsp ) const {
+      return fc::mutable_variant_object()
+         ( "head_block_num", bsp->block_num )
+         ( "head_block_id", bsp->id )
+         ( "head_block_time", bsp->header.timestamp.to_time_point() )
+         ( "head_block_producer", bsp->header.producer )
+         ( "last_irreversible_block_num", db.last_irreversible_block_num() )
+         ( "last_irreversible_block_id", db.last_irreversible_block_id() );
+   }
+
+   /// the rows are read from the undo session of the block here, and decoded with their ABI on an http thread
+   void notify_subscriptions( const chain::block_state_ptr& bsp, const chain_apis::read_only& ro_api, http_plugin& http ) {
+      head_subscriptions.erase( std::remove_if( head_subscriptions.begin(), head_subscriptions.end(),
+                                                []( const subscription_ptr& s ) { return !s->active(); } ),
+                                head_subscriptions.end() );
+      if( !head_subscriptions.empty() ) {
+         const auto head = head_notification( bsp );
+         for( const auto& s : head_subscriptions ) {
+            s->send( head );
+         }
+      }
+
+      table_subscriptions.erase( std::remove_if( table_subscriptions.begin(), table_subscriptions.end(),
+                                                 []( const auto& s ) { return !s.second->active(); } ),
+                                 table_subscriptions.end() );
+      if( table_subscriptions.empty() ) return;
+      std::set<table_key> tables;
+      for( const auto& s : table_subscriptions ) {
+         tables.insert( s.first );
+      }
+      auto deltas = std::make_shared<chain_apis::read_only::get_table_deltas_collected>( ro_api.collect_table_deltas( tables ) );
+      if( deltas->rows.empty() ) return;
+      http.post_http_thread_pool( [deltas, subs=table_subscriptions, block_num=bsp->block_num, block_id=bsp->id]() {
+         try {
+            auto decoded = deltas->decode();
+            std::map<table_key, fc::variants> rows;
+            for( size_t i = 0; i < decoded.size(); ++i ) {
+               const auto& r = deltas->rows[i];
+               rows[std::make_tuple( r.code, r.scope, r.table )].emplace_back( std::move( decoded[i] ) );
+            }
+            for( const auto& s : subs ) {
+               auto itr = rows.find( s.first );
+               if( itr == rows.end() ) continue;
+               s.second->send( fc::mutable_variant_object()
+                                  ( "block_num", block_num )
+                                  ( "block_id", block_id )
+                                  ( "rows", itr->second ) );
+            }
+         } FC_LOG_AND_DROP()
+      } );
+   }
+
+   /**
+    * Render the get_block response of every accepted block to JSON on an http thread, for requests of recent
+    * blocks to be answered from the http threads with the JSON as is
+    */
+   void render_accepted_blocks( http_plugin& http, chain_apis::read_only ro_api ) {
+      block_cache_connection.emplace( db.accepted_block.connect( [this, ro_api, &http]( const chain::block_state_ptr& bsp ) {
+         {
+            std::lock_guard<std::mutex> g( block_cache_mtx );
+            // the blocks numbered after it were switched out by a fork
+            block_cache_by_num.erase( block_cache_by_num.upper_bound( bsp->block_num ), block_cache_by_num.end() );
+            block_cache_by_num[bsp->block_num] = bsp->id;
+            while( block_cache_by_num.size() > block_cache_size ) {
+               block_cache_by_num.erase( block_cache_by_num.begin() );
+            }
+         }
+         auto block = std::make_shared<chain_apis::read_only::get_block_collected>( ro_api.collect_block( bsp->block ) );
+         http.post_http_thread_pool( [this, block, id=bsp->id]() {
+            try {
+               store_block_json( id, std::make_shared<const std::string>( block->to_json( fc::time_point::maximum() ) ) );
+            } FC_LOG_AND_DROP()
+         } );
+      } ) );
+   }
+
+   void store_block_json( const chain::block_id_type& id, std::shared_ptr<const std::string> json ) {
+      std::lock_guard<std::mutex> g( block_cache_mtx );
+      if( block_cache.count( id ) ) return;
+      block_cache_order.push_front( id );
+      block_cache.emplace( id, std::make_pair( std::move( json ), block_cache_order.begin() ) );
+      if( block_cache.size() > block_cache_size ) {
+         block_cache.erase( block_cache_order.back() );
+         block_cache_order.pop_back();
+      }
+   }
+
+   /// @return the rendered get_block response of the block numbered or identified by block_num_or_id, null if it is not cached
+   std::shared_ptr<const std::string> find_block_json( const std::string& block_num_or_id ) {
+      fc::optional<chain::block_id_type> id;
+      try {
+         const auto block_num = fc::to_uint64( block_num_or_id );
+         std::lock_guard<std::mutex> g( block_cache_mtx );
+         auto itr = block_cache_by_num.find( block_num );
+         if( itr != block_cache_by_num.end() ) id = itr->second;
+      } catch( ... ) {
+         try {
+            id = fc::variant( block_num_or_id ).as<chain::block_id_type>();
+         } catch( ... ) {
+            // reported by get_block on the main thread
+         }
+      }
+      if( !id ) return {};
+
+      std::lock_guard<std::mutex> g( block_cache_mtx );
+      auto itr = block_cache.find( *id );
+      if( itr == block_cache.end() ) return {};
+      block_cache_order.splice( block_cache_order.begin(), block_cache_order, itr->second.second );
+      return itr->second.first;
+   }
+
+   /**
+    * Answer get_producers from the http threads, from a ranking of the rows of the producers table kept by the order
+    * of the prototalvote index. The rows changed by each accepted block are read from its undo session on the main
+    * thread, decoded on an http thread and applied in the order of their blocks. All the rows are collected again
+    * after a fork switch, which undoes blocks without a signal, and after a setcode or setabi of the system contract.
+    */
+   void rank_producers( http_plugin& http, chain_apis::read_only ro_api ) {
+      ranking_block_connection.emplace( db.accepted_block.connect( [this, ro_api, &http]( const chain::block_state_ptr& bsp ) {
+         const bool changed_only = ranking_last_block == bsp->header.previous && !ranking_abi_changed && !ranking_failed;
+         ranking_last_block = bsp->id;
+         ranking_abi_changed = false;
+         ranking_failed = false;
+         collect_ranking( ro_api, http, changed_only );
+      } ) );
+      ranking_transaction_connection.emplace( db.applied_transaction.connect(
+            [this]( std::tuple<const chain::transaction_trace_ptr&, const chain::signed_transaction&> t ) {
+         const auto& trace = std::get<0>(t);
+         if( !trace || trace->except ) return;
+         for( const auto& at : trace->action_traces ) {
+            if( at.receiver == chain::config::system_account_name && at.act.account == chain::config::system_account_name &&
+                ( at.act.name == chain::setcode::get_name() || at.act.name == chain::setabi::get_name() ) ) {
+               ranking_abi_changed = true;
+               return;
+            }
+         }
+      } ) );
+      if( db.head_block_state() ) ranking_last_block = db.head_block_id();
+      collect_ranking( ro_api, http, false );
+   }
+
+   struct ranking_update {
+      bool                                                  available = false;
+      bool                                                  complete = false;
+      std::vector<chain_apis::read_only::get_producers_decoded_row> rows;
+      fc::optional<double>                                  total_producer_vote_weight;
+   };
+
+   void collect_ranking( const chain_apis::read_only& ro_api, http_plugin& http, bool changed_only ) {
+      auto collected = std::make_shared<chain_apis::read_only::get_producers_collected>( ro_api.collect_producers( changed_only ) );
+      if( !collected->complete && collected->rows.empty() && !collected->global ) return;
+      const uint64_t seq = ++ranking_collected_seq;
+      http.post_http_thread_pool( [this, collected, seq]() {
+         ranking_update update{ collected->available, collected->complete };
+         try {
+            update.rows = collected->decode();
+            update.total_producer_vote_weight = collected->decode_total_producer_vote_weight();
+         } catch( const fc::exception& e ) {
+            elog( "unable to rank producers: ${e}", ("e", e.to_detail_string()) );
+            // unavailable until the next block collects all the rows again
+            update = ranking_update{ false, true };
+            ranking_failed = true;
+         }
+         apply_ranking( seq, std::move( update ) );
+      } );
+   }
+
+   /// updates are decoded concurrently, each is applied once those of the blocks before it are
+   void apply_ranking( uint64_t seq, ranking_update update ) {
+      std::lock_guard<std::mutex> g( ranking_mtx );
+      ranking_pending.emplace( seq, std::move( update ) );
+      for( auto itr = ranking_pending.begin(); itr != ranking_pending.end() && itr->first == ranking_applied_seq + 1;
+           itr = ranking_pending.erase( itr ) ) {
+         ++ranking_applied_seq;
+         auto& u = itr->second;
+         if( u.complete ) {
+            ranked_producers.clear();
+            ranking.clear();
+            ranking_available = u.available;
+         }
+         for( auto& row : u.rows ) {
+            auto existing = ranked_producers.find( row.owner );
+            if( existing != ranked_producers.end() ) {
+               ranking.erase( std::make_pair( existing->second.total_votes_key, row.owner ) );
+               ranked_producers.erase( existing );
+            }
+            if( !row.present ) continue;
+            ranking.emplace( row.total_votes_key, row.owner );
+            ranked_producers.emplace( row.owner, std::move( row ) );
+         }
+         if( u.total_producer_vote_weight ) total_producer_vote_weight = *u.total_producer_vote_weight;
+      }
+   }
+
+   /// @return the get_producers response from the ranking, nothing if it is not available
+   fc::optional<chain_apis::read_only::get_producers_result> find_producers( const chain_apis::read_only::get_producers_params& p ) {
+      const auto lower = chain::name{p.lower_bound}.to_uint64_t();
+      std::lock_guard<std::mutex> g( ranking_mtx );
+      if( !ranking_available ) return {};
+
+      chain_apis::read_only::get_producers_result result;
+      auto itr = ranking.begin();
+      if( lower ) {
+         // from the first producer named lower or after, by rank from there as the prototalvote index is walked
+         auto first = ranked_producers.lower_bound( lower );
+         itr = first == ranked_producers.end() ? ranking.end() : ranking.find( std::make_pair( first->second.total_votes_key, first->first ) );
+      }
+      for( ; itr != ranking.end(); ++itr ) {
+         if( result.rows.size() >= p.limit ) {
+            result.more = chain::name{itr->second}.to_string();
+            break;
+         }
+         const auto& row = ranked_producers.at( itr->second );
+         result.rows.emplace_back( p.json ? row.json : row.hex );
+      }
+      result.total_producer_vote_weight = total_producer_vote_weight;
+      return result;
+   }
+
    controller& db;
+
+   /// during deferred transaction waves the same transactions are polled page after page
+   chain_apis::read_only::scheduled_transactions_cache scheduled_transactions{10000};
+
+   /// wallets ask for the keys of the same few accounts for every transaction they sign
+   chain_apis::read_only::permission_tree_cache required_keys_permissions{10000};
+
+   bool                                             producers_cache = true;
+   chain::block_id_type                             ranking_last_block; ///< main thread only, as ranking_abi_changed
+   bool                                             ranking_abi_changed = false;
+   std::atomic<bool>                                ranking_failed{false};
+   uint64_t                                         ranking_collected_seq = 0;
+   std::mutex                                       ranking_mtx; ///< guards the members below up to total_producer_vote_weight
+   uint64_t                                         ranking_applied_seq = 0;
+   std::map<uint64_t, ranking_update>               ranking_pending; ///< by sequence, decoded before an earlier update
+   bool                                             ranking_available = false;
+   std::map<uint64_t, chain_apis::read_only::get_producers_decoded_row> ranked_producers; ///< by owner
+   std::set<std::pair<double, uint64_t>>            ranking; ///< total_votes_key and owner, in the order of get_producers
+   double                                           total_producer_vote_weight = 0;
+   fc::optional<boost::signals2::scoped_connection> ranking_block_connection;
+   fc::optional<boost::signals2::scoped_connection> ranking_transaction_connection;
+
+   size_t                                           block_cache_size = 0;
+   std::mutex                                       block_cache_mtx; ///< guards block_cache_by_num, block_cache_order and block_cache
+   std::map<uint32_t, chain::block_id_type>         block_cache_by_num; ///< of the blocks accepted last, in the current fork
+   std::list<chain::block_id_type>                  block_cache_order; ///< most recently used first
+   std::map<chain::block_id_type, std::pair<std::shared_ptr<const std::string>, std::list<chain::block_id_type>::iterator>> block_cache;
+   fc::optional<boost::signals2::scoped_connection> block_cache_connection;
+
+   fc::optional<boost::signals2::scoped_connection> accepted_block_connection;
+   fc::optional<boost::signals2::scoped_connection> irreversible_block_connection;
+   fc::optional<boost::signals2::scoped_connection> applied_transaction_connection;
+
+   using table_key = std::tuple<chain::name, chain::name, chain::name>; ///< code, scope, table
+   std::vector<subscription_ptr>                            head_subscriptions;
+   std::vector<std::pair<table_key, subscription_ptr>>      table_subscriptions;
+   fc::optional<boost::signals2::scoped_connection>         subscriptions_block_connection;
 };
 
 
 chain_api_plugin::chain_api_plugin(){}
 chain_api_plugin::~chain_api_plugin(){}
 
-void chain_api_plugin::set_program_options(options_description&, options_description&) {}
-void chain_api_plugin::plugin_initialize(const variables_map&) {}
+void chain_api_plugin::set_program_options(options_description&, options_description& cfg) {
+   cfg.add_options()
+         ("get-block-cache-size", bpo::value<uint32_t>()->default_value(0),
+          "Number of recently accepted blocks whose get_block responses are rendered to JSON on the http threads as they are accepted, "
+          "and answered from the http threads without the main thread, 0 to disable")
+         ("get-producers-cache", bpo::value<bool>()->default_value(true),
+          "Rank the producers as the blocks changing them are accepted, for get_producers to be answered from the http threads "
+          "without the main thread")
+         ;
+}
+
+void chain_api_plugin::plugin_initialize(const variables_map& options) {
+   block_cache_size = options.at( "get-block-cache-size" ).as<uint32_t>();
+   producers_cache = options.at( "get-producers-cache" ).as<bool>();
+}
 
 struct async_result_visitor : public fc::visitor<fc::variant> {
    template<typename T>
@@ -46,6 +364,23 @@ namespace {
         }
       } EOS_RETHROW_EXCEPTIONS(chain::invalid_http_request, "Unable to parse valid input from POST body");
    }
+
+   /// params of a binary request, fc::raw packed
+   template<typename T>
+   T unpack_params(const std::string& body) {
+      try {
+        try {
+           return fc::raw::unpack<T>(body.data(), body.size());
+        } catch (const chain::chain_exception& e) { // EOS_RETHROW_EXCEPTIONS does not re-type these so, re-code it
+          throw fc::exception(e);
+        }
+      } EOS_RETHROW_EXCEPTIONS(chain::invalid_http_request, "Unable to unpack valid input from POST body");
+   }
+
+   /// response of a binary request, sent by http_plugin as is
+   fc::variant binary_result(std::vector<char> data) {
+      return fc::variant(fc::blob{std::move(data)});
+   }
 }
 
 #define CALL(api_name, api_handle, api_namespace, call_name, http_response_code) \
@@ -61,6 +396,20 @@ namespace {
           } \
        }}
 
+/// the call takes the POST body as is, for calls that parse it themselves
+#define CALL_WITH_BODY(api_name, api_handle, api_namespace, call_name, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle](string, string body, url_response_callback cb) mutable { \
+          api_handle.validate(); \
+          try { \
+             if (body.empty()) body = "{}"; \
+             fc::variant result( api_handle.call_name(body) ); \
+             cb(http_response_code, std::move(result)); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+          } \
+       }}
+
 #define CALL_WITH_400(api_name, api_handle, api_namespace, call_name, http_response_code) \
 {std::string("/v1/" #api_name "/" #call_name), \
    [api_handle](string, string body, url_response_callback cb) mutable { \
@@ -99,11 +448,14 @@ namespace {
 #define CHAIN_RO_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, ro_api, chain_apis::read_only, call_name, call_result, http_response_code)
 #define CHAIN_RW_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, rw_api, chain_apis::read_write, call_name, call_result, http_response_code)
 
+#define CHAIN_RO_CALL_WITH_BODY(call_name, http_response_code) CALL_WITH_BODY(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
 #define CHAIN_RO_CALL_WITH_400(call_name, http_response_code) CALL_WITH_400(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
 
 void chain_api_plugin::plugin_startup() {
    ilog( "starting chain_api_plugin" );
    my.reset(new chain_api_plugin_impl(app().get_plugin<chain_plugin>().chain()));
+   my->block_cache_size = block_cache_size;
+   my->producers_cache = producers_cache;
    auto& chain = app().get_plugin<chain_plugin>();
    auto ro_api = chain.get_read_only_api();
    auto rw_api = chain.get_read_write_api();
@@ -111,42 +463,234 @@ void chain_api_plugin::plugin_startup() {
    auto& _http_plugin = app().get_plugin<http_plugin>();
    ro_api.set_shorten_abi_errors( !_http_plugin.verbose_errors() );
 
-   _http_plugin.add_api({
+   // these are polled over and over with the same requests, their responses are answered from the cache, when
+   // http-response-cache-size is set, until the next block
+   my->invalidate_cached_responses_on_change( _http_plugin );
+   _http_plugin.add_cached_api({
       CHAIN_RO_CALL(get_info, 200)}, appbase::priority::medium_high);
+   _http_plugin.add_cached_api({
+      CHAIN_RO_CALL(get_account, 200),
+      CHAIN_RO_CALL(get_code_hash, 200),
+      CHAIN_RO_CALL(get_abi, 200)
+   });
    _http_plugin.add_api({
       CHAIN_RO_CALL(get_activated_protocol_features, 200),
-      CHAIN_RO_CALL(get_block, 200),
       CHAIN_RO_CALL(get_block_header_state, 200),
-      CHAIN_RO_CALL(get_account, 200),
       CHAIN_RO_CALL(get_code, 200),
-      CHAIN_RO_CALL(get_code_hash, 200),
-      CHAIN_RO_CALL(get_abi, 200),
       CHAIN_RO_CALL(get_raw_code_and_abi, 200),
       CHAIN_RO_CALL(get_raw_abi, 200),
-      CHAIN_RO_CALL(get_table_rows, 200),
+      CHAIN_RO_CALL(get_abi_cache_stats, 200),
+      CHAIN_RO_CALL(get_wasm_cache_stats, 200),
       CHAIN_RO_CALL(get_table_by_scope, 200),
+      CHAIN_RO_CALL(get_kv_rows, 200),
       CHAIN_RO_CALL(get_currency_balance, 200),
+      CHAIN_RO_CALL(get_currency_balances, 200),
+      CHAIN_RO_CALL(get_accounts, 200),
       CHAIN_RO_CALL(get_currency_stats, 200),
-      CHAIN_RO_CALL(get_producers, 200),
       CHAIN_RO_CALL(get_producer_schedule, 200),
-      CHAIN_RO_CALL(get_scheduled_transactions, 200),
-      CHAIN_RO_CALL(abi_json_to_bin, 200),
+      CHAIN_RO_CALL_WITH_BODY(abi_json_to_bin, 200),
       CHAIN_RO_CALL(abi_bin_to_json, 200),
-      CHAIN_RO_CALL(get_required_keys, 200),
       CHAIN_RO_CALL(get_transaction_id, 200),
       CHAIN_RW_CALL_ASYNC(push_block, chain_apis::read_write::push_block_results, 202),
       CHAIN_RW_CALL_ASYNC(push_transaction, chain_apis::read_write::push_transaction_results, 202),
       CHAIN_RW_CALL_ASYNC(push_transactions, chain_apis::read_write::push_transactions_results, 202),
-      CHAIN_RW_CALL_ASYNC(send_transaction, chain_apis::read_write::send_transaction_results, 202)
+      CHAIN_RW_CALL_ASYNC(send_transaction, chain_apis::read_write::send_transaction_results, 202),
+      CHAIN_RW_CALL_ASYNC(compute_transaction, chain_apis::read_write::compute_transaction_results, 200)
    });
 
+   // rows are collected on the main thread, ABI decoding of the rows to JSON is done on an http thread
+   _http_plugin.add_cached_json_handler( "/v1/chain/get_table_rows",
+      [ro_api, &_http_plugin](string, string body, url_response_callback cb, url_json_response_callback json_cb) mutable {
+         ro_api.validate();
+         try {
+            if (body.empty()) body = "{}";
+            auto rows = std::make_shared<chain_apis::read_only::get_table_rows_collected>(
+                  ro_api.collect_table_rows( fc::json::from_string(body).as<chain_apis::read_only::get_table_rows_params>() ) );
+            _http_plugin.post_http_thread_pool( [rows, body, cb, json_cb, &_http_plugin]() {
+               try {
+                  json_cb( 200, std::make_shared<const string>( rows->to_json( fc::time_point::now() + _http_plugin.get_max_response_time() ) ) );
+               } catch (...) {
+                  http_plugin::handle_exception("chain", "get_table_rows", body, cb);
+               }
+            } );
+         } catch (...) {
+            http_plugin::handle_exception("chain", "get_table_rows", body, cb);
+         }
+      } );
+
+   // the page and the ABIs of its actions are read on the main thread, its transactions are decoded on an http thread
+   _http_plugin.add_handler( "/v1/chain/get_scheduled_transactions",
+      [ro_api, &_http_plugin, impl=my.get()](string, string body, url_response_callback cb) mutable {
+         ro_api.validate();
+         try {
+            if (body.empty()) body = "{}";
+            auto trxs = std::make_shared<chain_apis::read_only::get_scheduled_transactions_collected>(
+                  ro_api.collect_scheduled_transactions( fc::json::from_string(body).as<chain_apis::read_only::get_scheduled_transactions_params>() ) );
+            _http_plugin.post_http_thread_pool( [trxs, body, cb, impl]() {
+               try {
+                  cb( 200, fc::variant( trxs->decode( &impl->scheduled_transactions ) ) );
+               } catch (...) {
+                  http_plugin::handle_exception("chain", "get_scheduled_transactions", body, cb);
+               }
+            } );
+         } catch (...) {
+            http_plugin::handle_exception("chain", "get_scheduled_transactions", body, cb);
+         }
+      } );
+
+   // the ABIs and the permissions in reach are read on the main thread, the keys are found on an http thread
+   _http_plugin.add_handler( "/v1/chain/get_required_keys",
+      [ro_api, &_http_plugin, impl=my.get()](string, string body, url_response_callback cb) mutable {
+         ro_api.validate();
+         try {
+            if (body.empty()) body = "{}";
+            auto query = std::make_shared<chain_apis::read_only::get_required_keys_collected>(
+                  ro_api.collect_required_keys( fc::json::from_string(body).as<chain_apis::read_only::get_required_keys_params>(),
+                                                &impl->required_keys_permissions ) );
+            _http_plugin.post_http_thread_pool( [query, body, cb]() {
+               try {
+                  cb( 200, fc::variant( query->compute() ) );
+               } catch (...) {
+                  http_plugin::handle_exception("chain", "get_required_keys", body, cb);
+               }
+            } );
+         } catch (...) {
+            http_plugin::handle_exception("chain", "get_required_keys", body, cb);
+         }
+      } );
+
+   // the block and the ABIs of its actions are read on the main thread, the block is formatted to JSON on an http thread
+   auto get_block = [ro_api, &_http_plugin](string, string body, url_response_callback cb, url_json_response_callback json_cb) mutable {
+      ro_api.validate();
+      try {
+         if (body.empty()) body = "{}";
+         auto block = std::make_shared<chain_apis::read_only::get_block_collected>(
+               ro_api.collect_block( fc::json::from_string(body).as<chain_apis::read_only::get_block_params>() ) );
+         _http_plugin.post_http_thread_pool( [block, body, cb, json_cb, &_http_plugin]() {
+            try {
+               json_cb( 200, std::make_shared<const string>( block->to_json( fc::time_point::now() + _http_plugin.get_max_response_time() ) ) );
+            } catch (...) {
+               http_plugin::handle_exception("chain", "get_block", body, cb);
+            }
+         } );
+      } catch (...) {
+         http_plugin::handle_exception("chain", "get_block", body, cb);
+      }
+   };
+   if( my->block_cache_size ) {
+      // explorers request the same recent blocks over and over, their JSON is rendered once as they are accepted
+      my->render_accepted_blocks( _http_plugin, ro_api );
+      _http_plugin.add_async_json_handler( "/v1/chain/get_block",
+         [impl=my.get(), get_block](string url, string body, url_response_callback cb, url_json_response_callback json_cb) {
+            try {
+               auto params = fc::json::from_string(body.empty() ? "{}" : body).as<chain_apis::read_only::get_block_params>();
+               if( auto json = impl->find_block_json( params.block_num_or_id ) ) {
+                  return json_cb( 200, std::move( json ) );
+               }
+            } catch (...) {
+               // reported by get_block on the main thread
+            }
+            app().post( appbase::priority::medium_low, [get_block, url=std::move(url), body=std::move(body), cb=std::move(cb),
+                                                         json_cb=std::move(json_cb)]() mutable {
+               get_block( std::move( url ), std::move( body ), std::move( cb ), std::move( json_cb ) );
+            } );
+         } );
+   } else {
+      _http_plugin.add_json_handler( "/v1/chain/get_block", get_block );
+   }
+
+   const api_description get_producers_api{ CHAIN_RO_CALL(get_producers, 200) };
+   if( my->producers_cache ) {
+      // wallets and explorers poll the ranking, it is answered on the main thread until it is first collected
+      my->rank_producers( _http_plugin, ro_api );
+      _http_plugin.add_async_handler( "/v1/chain/get_producers",
+         [impl=my.get(), get_producers=get_producers_api.begin()->second](string url, string body, url_response_callback cb) {
+            try {
+               auto params = fc::json::from_string(body.empty() ? "{}" : body).as<chain_apis::read_only::get_producers_params>();
+               if( auto result = impl->find_producers( params ) ) {
+                  return cb( 200, fc::variant( *result ) );
+               }
+            } catch (...) {
+               // reported by get_producers on the main thread
+            }
+            app().post( appbase::priority::medium_low, [get_producers, url=std::move(url), body=std::move(body), cb=std::move(cb)]() mutable {
+               get_producers( std::move( url ), std::move( body ), std::move( cb ) );
+            } );
+         } );
+   } else {
+      _http_plugin.add_api( get_producers_api );
+   }
+
+   // application/octet-stream requests carry their params fc::raw packed and are answered with fc::raw packed
+   // results, without ABI decoding or variant conversion on either side
+   _http_plugin.add_binary_handler( "/v1/chain/get_block",
+      [ro_api](string, string body, url_response_callback cb) mutable {
+         ro_api.validate();
+         try {
+            auto params = unpack_params<chain_apis::read_only::get_block_params>(body);
+            cb( 200, binary_result( ro_api.get_packed_block( params ) ) );
+         } catch (...) {
+            http_plugin::handle_exception("chain", "get_block", fc::to_hex(body.data(), body.size()), cb);
+         }
+      } );
+
+   _http_plugin.add_binary_handler( "/v1/chain/get_table_rows",
+      [ro_api](string, string body, url_response_callback cb) mutable {
+         ro_api.validate();
+         try {
+            auto params = unpack_params<chain_apis::read_only::get_table_rows_params>(body);
+            params.json = false;
+            cb( 200, binary_result( ro_api.collect_table_rows( params ).pack() ) );
+         } catch (...) {
+            http_plugin::handle_exception("chain", "get_table_rows", fc::to_hex(body.data(), body.size()), cb);
+         }
+      } );
+
+   // binary transactions are already packed, so push_transaction and send_transaction differ only in the trace
+   // formatting of their JSON responses, both answer with the fc::raw packed trace
+   auto make_send_packed_handler = [rw_api](const char* call_name) {
+      return [rw_api, call_name](string, string body, url_response_callback cb) mutable {
+         rw_api.validate();
+         try {
+            auto trx = std::make_shared<chain::packed_transaction>( unpack_params<chain::packed_transaction>(body) );
+            rw_api.send_packed_transaction( trx,
+               [cb, call_name, body](const fc::static_variant<fc::exception_ptr, chain::transaction_trace_ptr>& result) {
+                  if (result.contains<fc::exception_ptr>()) {
+                     try {
+                        result.get<fc::exception_ptr>()->dynamic_rethrow_exception();
+                     } catch (...) {
+                        http_plugin::handle_exception("chain", call_name, fc::to_hex(body.data(), body.size()), cb);
+                     }
+                  } else {
+                     cb( 202, binary_result( fc::raw::pack( *result.get<chain::transaction_trace_ptr>() ) ) );
+                  }
+               });
+         } catch (...) {
+            http_plugin::handle_exception("chain", call_name, fc::to_hex(body.data(), body.size()), cb);
+         }
+      };
+   };
+   _http_plugin.add_binary_handler( "/v1/chain/push_transaction", make_send_packed_handler("push_transaction") );
+   _http_plugin.add_binary_handler( "/v1/chain/send_transaction", make_send_packed_handler("send_transaction") );
+
    if (chain.account_queries_enabled()) {
       _http_plugin.add_async_api({
          CHAIN_RO_CALL_WITH_400(get_accounts_by_authorizers, 200),
       });
    }
+
+   my->add_subscriptions( _http_plugin, ro_api );
 }
 
-void chain_api_plugin::plugin_shutdown() {}
+void chain_api_plugin::plugin_shutdown() {
+   if( my ) {
+      my->block_cache_connection.reset();
+      my->ranking_block_connection.reset();
+      my->ranking_transaction_connection.reset();
+      my->subscriptions_block_connection.reset();
+      my->head_subscriptions.clear();
+      my->table_subscriptions.clear();
+   }
+}
 
 }
@@ -25,6 +25,8 @@ namespace eosio {
 
       private:
         unique_ptr<class chain_api_plugin_impl> my;
+        size_t                                  block_cache_size = 0;
+        bool                                    producers_cache = true;
    };
 
 }
@@ -15,6 +15,9 @@ namespace eosio { namespace chain { namespace plugin_interface {
    template<typename T>
    using next_function = std::function<void(const fc::static_variant<fc::exception_ptr, T>&)>;
 
+   /// called with the index of each transaction of a batch and its result
+   using batch_next_function = std::function<void(size_t, const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>&)>;
+
    struct chain_plugin_interface;
 
    namespace channels {
@@ -46,6 +49,10 @@ namespace eosio { namespace chain { namespace plugin_interface {
          // synchronously push a block/trx to a single provider
          using block_sync            = method_decl<chain_plugin_interface, bool(const signed_block_ptr&, const std::optional<block_id_type>&), first_provider_policy>;
          using transaction_async     = method_decl<chain_plugin_interface, void(const packed_transaction_ptr&, bool, next_function<transaction_trace_ptr>), first_provider_policy>;
+         // recover the keys of all trxs in parallel and then queue them together, in order, to a single provider
+         using transaction_batch_async = method_decl<chain_plugin_interface, void(const std::vector<packed_transaction_ptr>&, bool, const batch_next_function&), first_provider_policy>;
+         // execute a trx against the pending block without including it in the block, trace returned via next
+         using transaction_dry_run_async = method_decl<chain_plugin_interface, void(const packed_transaction_ptr&, next_function<transaction_trace_ptr>), first_provider_policy>;
       }
    }
 
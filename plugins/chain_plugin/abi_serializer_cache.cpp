@@ -0,0 +1,134 @@
+#include <eosio/chain_plugin/abi_serializer_cache.hpp>
+#include <eosio/chain/account_object.hpp>
+#include <eosio/chain/contract_types.hpp>
+#include <eosio/chain/controller.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/io/json.hpp>
+
+#include <charconv>
+#include <random>
+
+namespace eosio::chain_apis {
+   using namespace eosio::chain;
+
+   json_splicer::json_splicer() {
+      std::random_device rd;
+      uint32_t random[4] = { rd(), rd(), rd(), rd() };
+      tag = "\"eosio-json-" + fc::to_hex( reinterpret_cast<const char*>( random ), sizeof( random ) ) + "-";
+   }
+
+   fc::variant json_splicer::add( std::string json ) {
+      parts.emplace_back( std::move( json ) );
+      return fc::variant( tag.substr( 1 ) + std::to_string( parts.size() - 1 ) );
+   }
+
+   std::string json_splicer::to_string( const fc::variant& v, const fc::time_point& deadline )const {
+      std::string json = fc::json::to_string( v, deadline );
+      if( parts.empty() ) return json;
+
+      size_t size = json.size();
+      for( const auto& p : parts ) size += p.size();
+      std::string out;
+      out.reserve( size );
+      const char* const end = json.data() + json.size();
+      size_t pos = 0;
+      for( auto found = json.find( tag ); found != std::string::npos; found = json.find( tag, pos ) ) {
+         size_t index = 0;
+         const auto r = std::from_chars( json.data() + found + tag.size(), end, index );
+         EOS_ASSERT( r.ec == std::errc() && r.ptr < end && *r.ptr == '"' && index < parts.size(), plugin_exception,
+                     "Malformed JSON placeholder" );
+         out.append( json, pos, found - pos );
+         out += parts[index];
+         pos = r.ptr + 1 - json.data();
+      }
+      out.append( json, pos, std::string::npos );
+      return out;
+   }
+
+   fc::variant abi_serializer_cache::entry::binary_to_variant( const std::string_view& type, const bytes& binary,
+                                                               const abi_serializer::yield_function_t& yield, bool short_path )const {
+      if( compiled && compiled->find_type( type ) != abi_compiled_decoder::invalid_type ) {
+         return compiled->to_variant( type, binary, yield );
+      }
+      return serializer.binary_to_variant( type, binary, yield, short_path );
+   }
+
+   abi_serializer_cache::abi_serializer_cache( size_t max_entries )
+   : max_entries( max_entries )
+   {
+   }
+
+   abi_serializer_cache::entry_ptr
+   abi_serializer_cache::get( const controller& db, const name& account, const abi_serializer::yield_function_t& yield ) {
+      const auto& d = db.db();
+      const auto* meta = d.find<account_metadata_object, by_name>( account );
+      if( meta == nullptr ) return {};
+      const uint64_t abi_sequence = meta->abi_sequence;
+
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         auto itr = by_account.find( account );
+         if( itr != by_account.end() && itr->second->abi_sequence == abi_sequence ) {
+            ++hits;
+            lru.splice( lru.begin(), lru, itr->second );
+            return itr->second->e;
+         }
+         ++misses;
+      }
+
+      const auto* accnt = d.find<account_object, by_name>( account );
+      if( accnt == nullptr ) return {};
+      abi_def abi;
+      if( !abi_serializer::to_abi( accnt->abi, abi ) ) return {};
+      auto e = std::make_shared<const entry>( std::move( abi ), yield );
+
+      if( max_entries == 0 ) return e;
+
+      std::lock_guard<std::mutex> g( mtx );
+      auto itr = by_account.find( account );
+      if( itr != by_account.end() ) {
+         itr->second->abi_sequence = abi_sequence;
+         itr->second->e = e;
+         lru.splice( lru.begin(), lru, itr->second );
+      } else {
+         lru.push_front( node{ account, abi_sequence, e } );
+         by_account.emplace( account, lru.begin() );
+         while( lru.size() > max_entries ) {
+            by_account.erase( lru.back().account );
+            lru.pop_back();
+         }
+      }
+      return e;
+   }
+
+   void abi_serializer_cache::invalidate( const name& account ) {
+      std::lock_guard<std::mutex> g( mtx );
+      auto itr = by_account.find( account );
+      if( itr != by_account.end() ) {
+         lru.erase( itr->second );
+         by_account.erase( itr );
+      }
+   }
+
+   void abi_serializer_cache::invalidate( const transaction_trace_ptr& trace ) {
+      if( !trace || trace->except ) return;
+      for( const auto& at : trace->action_traces ) {
+         if( at.receiver == config::system_account_name &&
+             at.act.account == config::system_account_name && at.act.name == setabi::get_name() ) {
+            try {
+               invalidate( at.act.data_as<setabi>().account );
+            } FC_LOG_AND_DROP()
+         }
+      }
+   }
+
+   abi_serializer_cache::stats abi_serializer_cache::get_stats()const {
+      std::lock_guard<std::mutex> g( mtx );
+      stats s;
+      s.hits = hits;
+      s.misses = misses;
+      s.entries = lru.size();
+      s.max_entries = max_entries;
+      return s;
+   }
+}
@@ -13,6 +13,7 @@
 #include <boost/bimap/multiset_of.hpp>
 #include <boost/bimap/set_of.hpp>
 
+#include <future>
 #include <shared_mutex>
 
 using namespace eosio;
@@ -153,11 +154,24 @@ namespace eosio::chain_apis {
             time_to_block_num.emplace(block_p->timestamp.to_time_point(), block_num);
          }
 
+         std::vector<std::pair<const permission_info*, const chain::permission_object*>> permissions;
+         permissions.reserve(index.size());
          for (const auto& po : index ) {
             uint32_t last_updated_height = last_updated_time_to_height(po.last_updated);
             const auto& pi = permission_info_index.emplace( permission_info{ po.owner, po.name, last_updated_height, po.auth.threshold } ).first;
-            add_to_bimaps(*pi, po);
+            permissions.emplace_back(&*pi, &po);
          }
+
+         // the two bimaps only share the permission infos, which no longer change, so they are built at the same time
+         auto names = std::async(std::launch::async, [this, &permissions]() {
+            for (const auto& p : permissions) {
+               add_to_name_bimap(*p.first, *p.second);
+            }
+         });
+         for (const auto& p : permissions) {
+            add_to_key_bimap(*p.first, *p.second);
+         }
+         names.get();
          auto duration = fc::time_point::now() - start;
          ilog("Finished building account query DB in ${sec}", ("sec", (duration.count() / 1'000'000.0 )));
       }
@@ -168,11 +182,18 @@ namespace eosio::chain_apis {
        * @param po - the chain data associted with this permission
        */
       void add_to_bimaps( const permission_info& pi, const chain::permission_object& po ) {
+         add_to_name_bimap(pi, po);
+         add_to_key_bimap(pi, po);
+      }
+
+      void add_to_name_bimap( const permission_info& pi, const chain::permission_object& po ) {
          // For each account, add this permission info's non-owning reference to the bimap for accounts
          for (const auto& a : po.auth.accounts) {
             name_bimap.insert(name_bimap_t::value_type {{a.permission, a.weight}, pi});
          }
+      }
 
+      void add_to_key_bimap( const permission_info& pi, const chain::permission_object& po ) {
          // for each key, add this permission info's non-owning reference to the bimap for keys
          for (const auto& k: po.auth.keys) {
             chain::public_key_type key = k.key;
@@ -8,10 +8,13 @@
 #include <eosio/chain/wasm_interface.hpp>
 #include <eosio/chain/resource_limits.hpp>
 #include <eosio/chain/reversible_block_object.hpp>
+#include <eosio/chain/reversible_block_log.hpp>
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/snapshot_delta.hpp>
+#include <eosio/chain/thread_utils.hpp>
 
 #include <eosio/chain/eosio_contract.hpp>
 
@@ -25,6 +28,8 @@
 #include <fc/variant.hpp>
 #include <signal.h>
 #include <cstdlib>
+#include <deque>
+#include <set>
 
 // reflect chainbase::environment for --print-build-info option
 FC_REFLECT_ENUM( chainbase::environment::os_t,
@@ -154,6 +159,12 @@ public:
    fc::optional<vm_type>            wasm_runtime;
    fc::microseconds                 abi_serializer_max_time_us;
    fc::optional<bfs::path>          snapshot_path;
+   std::unique_ptr<std::ifstream>   snapshot_stream; ///< compressed and JSON snapshots are read once, from initialize to startup
+   snapshot_reader_ptr              snapshot_reader;
+   fc::optional<bfs::path>          merged_snapshot_path; ///< snapshot made from --snapshot-delta or --compact-state-db, removed once loaded
+   std::vector<account_name>        eosvmoc_warmup_accounts;
+   std::vector<digest_type>         eosvmoc_warmup_code_hashes;
+   fc::microseconds                 eosvmoc_warmup_max_wait;
 
 
    // retained references to channels for easy publication
@@ -185,6 +196,7 @@ public:
 
 
    fc::optional<chain_apis::account_query_db>                        _account_query_db;
+   fc::optional<chain_apis::abi_serializer_cache>                    _abi_serializer_cache;
 };
 
 chain_plugin::chain_plugin()
@@ -229,6 +241,22 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
    cfg.add_options()
          ("blocks-dir", bpo::value<bfs::path>()->default_value("blocks"),
           "the location of the blocks directory (absolute path or relative to application data dir)")
+         ("blocks-log-stride", bpo::value<uint32_t>()->default_value(0),
+          "split the block log into segments once the head block number is a multiple of this stride, 0 keeps a single blocks.log")
+         ("max-retained-block-files", bpo::value<uint32_t>()->default_value(std::numeric_limits<uint32_t>::max()),
+          "maximum number of split block log segments to keep, older segments are moved to blocks-archive-dir or deleted")
+         ("blocks-retained-dir", bpo::value<bfs::path>()->default_value("retained"),
+          "the location of the split block log segments (absolute path or relative to blocks dir)")
+         ("blocks-archive-dir", bpo::value<bfs::path>()->default_value(""),
+          "the location to move block log segments beyond max-retained-block-files to (absolute path or relative to blocks dir), empty to delete them")
+         ("block-log-write-queue-size", bpo::value<uint32_t>()->default_value(0),
+          "number of irreversible blocks queued for a background thread that writes the block log, 0 writes them while applying blocks")
+         ("block-log-fsync-interval", bpo::value<uint32_t>()->default_value(0),
+          "fsync the block log after this many blocks are written, 0 leaves syncing to the operating system")
+         ("blocks-log-version", bpo::value<uint32_t>()->default_value(3),
+          "format of newly created block logs and split segments: 3, or 4 to store blocks compressed. Existing block logs keep their format")
+         ("fork-db-checkpoint-interval", bpo::value<uint32_t>()->default_value(0),
+          "write a checkpoint of the fork database every this many blocks so it survives an unclean shutdown, 0 only writes it on exit")
          ("protocol-features-dir", bpo::value<bfs::path>()->default_value("protocol_features"),
           "the location of the protocol_features directory (absolute path or relative to application config dir)")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
@@ -242,18 +270,34 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
 #endif
          })->default_value(eosio::chain::config::default_wasm_runtime, default_wasm_runtime_str), wasm_runtime_opt.c_str()
          )
+         ("wasm-cache-size-mb", bpo::value<uint64_t>()->default_value(0),
+          "Maximum size (in MiB) of the contract code instantiated WASM modules are kept for, the least worth keeping are dropped and built again when next used, 0 for no limit")
          ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_us / 1000),
           "Override default maximum ABI serialization time allowed in ms")
+         ("abi-serializer-cache-size", bpo::value<uint32_t>()->default_value(256),
+          "Number of contract ABI serializers kept ready for API calls, 0 to disable the cache")
          ("chain-state-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024  * 1024)), "Maximum size (in MiB) of the chain state database")
          ("chain-state-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the chain state database drops below this size (in MiB).")
-         ("reversible-blocks-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_cache_size / (1024  * 1024)), "Maximum size (in MiB) of the reversible blocks database")
-         ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
+         ("reversible-blocks-db-size-mb", bpo::value<uint64_t>(), "(DEPRECATED) no longer used, reversible blocks are kept in a log that grows as needed")
+         ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>(), "(DEPRECATED) no longer used, reversible blocks are kept in a log that grows as needed")
          ("signature-cpu-billable-pct", bpo::value<uint32_t>()->default_value(config::default_sig_cpu_bill_pct / config::percent_1),
           "Percentage of actual signature recovery cpu to bill. Whole number percentages, e.g. 50 for 50%")
          ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in controller thread pool")
+         ("chain-threads-cpu", bpo::value<vector<string>>()->composing()->multitoken(),
+          "CPUs to pin the worker threads of the controller thread pool to in turn, one CPU per thread, as a CPU number, a range such as 0-3, a list of those such as 0-3,8, or node<n> for the CPUs of NUMA node n; may be given more than once, unpinned if not given")
+         ("main-thread-cpu", bpo::value<vector<string>>()->composing()->multitoken(),
+          "CPUs to pin the main thread to, which applies blocks and transactions, as for chain-threads-cpu; the thread may run on any of them, unpinned if not given")
+         ("validation-pipeline-depth", bpo::value<uint16_t>()->default_value(config::default_block_validation_pipeline_depth),
+          "Number of received blocks for which transaction signature recovery is started before they are applied, also the number of blocks read ahead of replay from the block log on a thread of their own, 0 to disable")
+         ("irreversible-blocks-per-push", bpo::value<uint32_t>()->default_value(config::default_irreversible_blocks_per_push),
+          "In irreversible mode, the most blocks that became irreversible applied for each block received, the others being applied with the next blocks, 0 for no limit")
+         ("parallel-auth-checks", bpo::bool_switch()->default_value(false),
+          "Check the authorizations of the transactions of a received block on the controller thread pool before applying it")
          ("contracts-console", bpo::bool_switch()->default_value(false),
           "print contract's output to console")
+         ("trace-row-accesses", bpo::bool_switch()->default_value(false),
+          "Record the contract table rows each action reads and writes in its trace")
          ("actor-whitelist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
           "Account added to actor whitelist (may specify multiple times)")
          ("actor-blacklist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
@@ -295,8 +339,24 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "In \"locked\" mode database is preloaded and locked in to memory.\n"
 #endif
          )
+         ("publish-state-sequence", bpo::bool_switch()->default_value(false),
+          "Publish in state/state_sequence.dat when the state database is that of a block, for processes reading the database file while this node writes it; requires database-map-mode = mapped")
 #ifdef __linux__
          ("database-hugepage-path", bpo::value<vector<string>>()->composing(), "Optional path for database hugepages when in \"locked\" mode (may specify multiple times)")
+         ("database-numa-policy", bpo::value<string>()->default_value("none"),
+          "NUMA memory policy of the database (\"none\", \"interleave\", or \"bind\").\n"
+          "With \"interleave\" pages are spread over the nodes of database-numa-node, with \"bind\" they are only placed on them.\n"
+          "In \"mapped\" mode it applies to the pages faulted in at startup, which it implies.\n")
+         ("database-numa-node", bpo::value<vector<uint32_t>>()->composing(),
+          "NUMA node of the database memory policy, all online nodes if none is given (may specify multiple times)")
+         ("database-transparent-huge-pages", bpo::bool_switch()->default_value(false),
+          "Advise the kernel to back the database with transparent huge pages")
+         ("database-flush-interval", bpo::value<uint32_t>()->default_value(0),
+          "Write the database back to its file every this many blocks when in \"mapped\" mode, 0 leaves it to the kernel")
+         ("database-prefault", bpo::bool_switch()->default_value(false),
+          "Fault the database in on a background thread at startup when in \"mapped\" mode")
+         ("database-prefetch-pages", bpo::value<uint32_t>()->default_value(0),
+          "Pages of the database rows each contract last used that are remembered and read ahead when a received block with actions of the contract is applied, when in \"mapped\" mode, 0 to disable")
 #endif
 
 #ifdef EOSIO_EOS_VM_OC_RUNTIME_ENABLED
@@ -307,7 +367,19 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
                   EOS_ASSERT(false, plugin_exception, "");
                }
          }), "Number of threads to use for EOS VM OC tier-up")
+         ("eos-vm-oc-tierup-threshold", bpo::value<uint32_t>()->default_value(eosvmoc::config().tierup_threshold),
+          "Number of times a contract is run by the wasm-runtime before EOS VM OC compiles it, 0 to compile it when first used")
          ("eos-vm-oc-enable", bpo::bool_switch(), "Enable EOS VM OC tier-up runtime")
+         ("eos-vm-oc-import-cache", bpo::value<vector<bfs::path>>()->composing(),
+          "EOS VM OC code cache export whose compiled contracts are added to the code cache on startup, only import exports from a trusted source (may specify multiple times)")
+         ("eos-vm-oc-export-cache", bpo::value<bfs::path>(),
+          "File the compiled contracts of the EOS VM OC code cache are exported to on shutdown, for other nodes to import")
+         ("eos-vm-oc-warmup-account", bpo::value<vector<string>>()->composing()->multitoken(),
+          "Account whose contract is compiled by EOS VM OC on startup, before blocks and transactions are processed (may specify multiple times)")
+         ("eos-vm-oc-warmup-code-hash", bpo::value<vector<string>>()->composing()->multitoken(),
+          "Code hash of a contract compiled by EOS VM OC on startup, before blocks and transactions are processed (may specify multiple times)")
+         ("eos-vm-oc-warmup-max-wait-sec", bpo::value<uint32_t>()->default_value(60),
+          "Maximum time (in seconds) startup waits for the EOS VM OC warm-up compiles, the ones not done by then complete while running")
 #endif
          ("enable-account-queries", bpo::value<bool>()->default_value(false), "enable queries to find accounts by various metadata.")
          ("max-nonprivileged-inline-action-size", bpo::value<uint32_t>()->default_value(config::default_max_nonprivileged_inline_action_size), "maximum allowed size (in bytes) of an inline action for a nonprivileged account")
@@ -346,13 +418,18 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "clear chain state database, recover as many blocks as possible from the block log, and then replay those blocks")
          ("delete-all-blocks", bpo::bool_switch()->default_value(false),
           "clear chain state database and block log")
+         ("compact-state-db", bpo::bool_switch()->default_value(false),
+          "rewrite the chain state database densely from a snapshot of its last irreversible block on startup, "
+          "reversible blocks are dropped and fetched again from peers")
          ("truncate-at-block", bpo::value<uint32_t>()->default_value(0),
           "stop hard replay / block log recovery at this block number (if set to non-zero number)")
          ("import-reversible-blocks", bpo::value<bfs::path>(),
           "replace reversible block database with blocks imported from specified file and then exit")
          ("export-reversible-blocks", bpo::value<bfs::path>(),
            "export reversible block database in portable format into specified file and then exit")
-         ("snapshot", bpo::value<bfs::path>(), "File to read Snapshot State from")
+         ("snapshot", bpo::value<bfs::path>(), "File to read Snapshot State from. A compressed snapshot can also be read from a pipe")
+         ("snapshot-delta", bpo::value<vector<bfs::path>>()->composing(),
+          "Delta snapshot to apply on top of --snapshot before loading it. May be given several times, in the order the deltas were taken")
          ;
 
 }
@@ -404,6 +481,86 @@ void clear_chainbase_files( const fc::path& p ) {
    fc::remove( p / "shared_memory.meta" );
 }
 
+/// @return true if p holds a snapshot written by compressed_ostream_snapshot_writer, anything but a regular file is taken to be a stream of one
+bool is_compressed_snapshot( const bfs::path& p ) {
+   if( !bfs::is_regular_file( p ) )
+      return true;
+
+   std::ifstream in( p.generic_string(), (std::ios::in | std::ios::binary) );
+   uint32_t totem = 0;
+   in.read( (char*)&totem, sizeof(totem) );
+   return totem == compressed_ostream_snapshot_writer::magic_number;
+}
+
+/// @return true if the regular file p holds the JSON form of a snapshot
+bool is_json_snapshot( const bfs::path& p ) {
+   if( !bfs::is_regular_file( p ) )
+      return false;
+
+   std::ifstream in( p.generic_string(), (std::ios::in | std::ios::binary) );
+   char c = 0;
+   in >> c;
+   return in && c == '{';
+}
+
+/// apply deltas to the snapshot base one after the other, @return path of the resulting snapshot, written to dir
+bfs::path apply_snapshot_deltas( const bfs::path& base, const vector<bfs::path>& deltas, const bfs::path& dir ) {
+   EOS_ASSERT( !is_compressed_snapshot( base ), plugin_config_exception,
+               "Snapshot deltas can only be applied to an uncompressed snapshot" );
+   fc::create_directories( dir );
+
+   const bfs::path merged[2] = { dir / "snapshot-merged-0.bin", dir / "snapshot-merged-1.bin" };
+   bfs::path current = base;
+   fc::optional<fc::sha256> integrity_hash;
+   for( size_t i = 0; i < deltas.size(); ++i ) {
+      EOS_ASSERT( fc::is_regular_file( deltas[i] ), plugin_config_exception,
+                  "Cannot load snapshot delta, ${name} does not exist", ("name", deltas[i].generic_string()) );
+      ilog( "Applying snapshot delta ${delta}", ("delta", deltas[i].generic_string()) );
+
+      const auto& next = merged[i % 2];
+      {
+         std::ifstream base_in( current.generic_string(), (std::ios::in | std::ios::binary) );
+         std::ifstream delta_in( deltas[i].generic_string(), (std::ios::in | std::ios::binary) );
+         std::ofstream out( next.generic_string(), (std::ios::out | std::ios::binary) );
+         integrity_hash = apply_snapshot_delta( base_in, delta_in, out, integrity_hash );
+      }
+      current = next;
+   }
+
+   // the other merged file was an intermediate step
+   if( deltas.size() > 1 )
+      fc::remove( merged[deltas.size() % 2] );
+
+   return current;
+}
+
+/**
+ * write a snapshot of the existing state database of cfg to its state directory and clear the state database,
+ * @return path of the snapshot, loading it rebuilds the database without the free space left between its objects
+ */
+bfs::path compact_state_db( const controller::config& cfg, const protocol_feature_set& pfs, const chain_id_type& chain_id ) {
+   const bfs::path snapshot = cfg.state_dir / "snapshot-compact.bin";
+   {
+      // in irreversible mode the state is rolled back to the end of the block log, the snapshot has to be within it
+      auto irreversible_cfg = cfg;
+      irreversible_cfg.read_mode = db_read_mode::IRREVERSIBLE;
+      controller chain( irreversible_cfg, protocol_feature_set( pfs ), chain_id );
+      chain.add_indices();
+      chain.startup( [](){ return app().is_quiting(); } );
+
+      ilog( "Compacting chain state database at block ${n}", ("n", chain.head_block_num()) );
+      std::ofstream out( snapshot.generic_string(), (std::ios::out | std::ios::binary) );
+      auto writer = std::make_shared<ostream_snapshot_writer>( out );
+      chain.write_snapshot( writer );
+      writer->finalize();
+      out.flush();
+      EOS_ASSERT( out.good(), plugin_config_exception,
+                  "Unable to write the snapshot to compact the chain state database to ${name}", ("name", snapshot.generic_string()) );
+   }
+   clear_chainbase_files( cfg.state_dir );
+   return snapshot;
+}
+
 optional<builtin_protocol_feature> read_builtin_protocol_feature( const fc::path& p  ) {
    try {
       return fc::json::from_file<builtin_protocol_feature>( p );
@@ -612,14 +769,13 @@ chain_plugin::do_hard_replay(const variables_map& options) {
              options.at( "fix-reversible-blocks" ).as<bool>()) {
             // Do not try to recover reversible blocks if the directory does not exist, unless the option was explicitly provided.
             if( !recover_reversible_blocks( backup_dir / config::reversible_blocks_dir_name,
-                                            my->chain_config->reversible_cache_size,
                                             my->chain_config->blocks_dir / config::reversible_blocks_dir_name,
                                             options.at( "truncate-at-block" ).as<uint32_t>())) {
                ilog( "Reversible blocks database was not corrupted. Copying from backup to blocks directory." );
                fc::copy( backup_dir / config::reversible_blocks_dir_name,
                          my->chain_config->blocks_dir / config::reversible_blocks_dir_name );
-               fc::copy( backup_dir / config::reversible_blocks_dir_name / "shared_memory.bin",
-                         my->chain_config->blocks_dir / config::reversible_blocks_dir_name / "shared_memory.bin" );
+               fc::copy( backup_dir / config::reversible_blocks_dir_name / config::reversible_blocks_filename,
+                         my->chain_config->blocks_dir / config::reversible_blocks_dir_name / config::reversible_blocks_filename );
             }
          }
 }
@@ -732,8 +888,21 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if(options.count("abi-serializer-max-time-ms"))
          my->abi_serializer_max_time_us = fc::microseconds(options.at("abi-serializer-max-time-ms").as<uint32_t>() * 1000);
 
+      my->_abi_serializer_cache.emplace( options.at("abi-serializer-cache-size").as<uint32_t>() );
+
       my->chain_config->blocks_dir = my->blocks_dir;
+      my->chain_config->blocks_log_config.stride = options.at( "blocks-log-stride" ).as<uint32_t>();
+      my->chain_config->blocks_log_config.max_retained_files = options.at( "max-retained-block-files" ).as<uint32_t>();
+      my->chain_config->blocks_log_config.retained_dir = options.at( "blocks-retained-dir" ).as<bfs::path>();
+      my->chain_config->blocks_log_config.archive_dir = options.at( "blocks-archive-dir" ).as<bfs::path>();
+      my->chain_config->blocks_log_config.write_queue_size = options.at( "block-log-write-queue-size" ).as<uint32_t>();
+      my->chain_config->blocks_log_config.fsync_interval = options.at( "block-log-fsync-interval" ).as<uint32_t>();
+      my->chain_config->blocks_log_config.version = options.at( "blocks-log-version" ).as<uint32_t>();
+      EOS_ASSERT( my->chain_config->blocks_log_config.version >= 3 &&
+                  block_log::is_supported_version( my->chain_config->blocks_log_config.version ),
+                  plugin_config_exception, "blocks-log-version must be 3 or 4" );
       my->chain_config->state_dir = app().data_dir() / config::default_state_dir_name;
+      my->chain_config->fork_db_checkpoint_interval = options.at( "fork-db-checkpoint-interval" ).as<uint32_t>();
       my->chain_config->read_only = my->readonly;
 
       if( options.count( "chain-state-db-size-mb" ))
@@ -742,12 +911,8 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( options.count( "chain-state-db-guard-size-mb" ))
          my->chain_config->state_guard_size = options.at( "chain-state-db-guard-size-mb" ).as<uint64_t>() * 1024 * 1024;
 
-      if( options.count( "reversible-blocks-db-size-mb" ))
-         my->chain_config->reversible_cache_size =
-               options.at( "reversible-blocks-db-size-mb" ).as<uint64_t>() * 1024 * 1024;
-
-      if( options.count( "reversible-blocks-db-guard-size-mb" ))
-         my->chain_config->reversible_guard_size = options.at( "reversible-blocks-db-guard-size-mb" ).as<uint64_t>() * 1024 * 1024;
+      if( options.count( "reversible-blocks-db-size-mb" ) || options.count( "reversible-blocks-db-guard-size-mb" ))
+         wlog( "reversible-blocks-db-size-mb and reversible-blocks-db-guard-size-mb are deprecated and ignored" );
 
       if( options.count( "max-nonprivileged-inline-action-size" ))
          my->chain_config->max_nonprivileged_inline_action_size = options.at( "max-nonprivileged-inline-action-size" ).as<uint32_t>();
@@ -758,6 +923,23 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                      "chain-threads ${num} must be greater than 0", ("num", my->chain_config->thread_pool_size) );
       }
 
+      if( options.count( "chain-threads-cpu" )) {
+         my->chain_config->thread_pool_cpus = parse_cpus( options.at( "chain-threads-cpu" ).as<vector<string>>() );
+      }
+
+      // plugins are initialized on the main thread
+      if( options.count( "main-thread-cpu" )) {
+         pin_current_thread( "main", parse_cpus( options.at( "main-thread-cpu" ).as<vector<string>>() ) );
+      }
+
+      if( options.count( "validation-pipeline-depth" ))
+         my->chain_config->block_validation_pipeline_depth = options.at( "validation-pipeline-depth" ).as<uint16_t>();
+
+      if( options.count( "irreversible-blocks-per-push" ))
+         my->chain_config->irreversible_blocks_per_push = options.at( "irreversible-blocks-per-push" ).as<uint32_t>();
+
+      my->chain_config->parallel_auth_checks = options.at( "parallel-auth-checks" ).as<bool>();
+
       my->chain_config->sig_cpu_bill_pct = options.at("signature-cpu-billable-pct").as<uint32_t>();
       EOS_ASSERT( my->chain_config->sig_cpu_bill_pct >= 0 && my->chain_config->sig_cpu_bill_pct <= 100, plugin_config_exception,
                   "signature-cpu-billable-pct must be 0 - 100, ${pct}", ("pct", my->chain_config->sig_cpu_bill_pct) );
@@ -765,10 +947,12 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
       if( my->wasm_runtime )
          my->chain_config->wasm_runtime = *my->wasm_runtime;
+      my->chain_config->wasm_cache_size = options.at( "wasm-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
 
       my->chain_config->force_all_checks = options.at( "force-all-checks" ).as<bool>();
       my->chain_config->disable_replay_opts = options.at( "disable-replay-opts" ).as<bool>();
       my->chain_config->contracts_console = options.at( "contracts-console" ).as<bool>();
+      my->chain_config->trace_row_accesses = options.at( "trace-row-accesses" ).as<bool>();
       my->chain_config->allow_ram_billing_in_notify = options.at( "disable-ram-billing-notify-checks" ).as<bool>();
       my->chain_config->maximum_variable_signature_length = options.at( "maximum-variable-signature-length" ).as<uint32_t>();
 
@@ -840,14 +1024,12 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
             wlog( "The --truncate-at-block option does not work for a regular replay of the blockchain." );
          clear_chainbase_files( my->chain_config->state_dir );
          if( options.at( "fix-reversible-blocks" ).as<bool>()) {
-            if( !recover_reversible_blocks( my->chain_config->blocks_dir / config::reversible_blocks_dir_name,
-                                            my->chain_config->reversible_cache_size )) {
+            if( !recover_reversible_blocks( my->chain_config->blocks_dir / config::reversible_blocks_dir_name )) {
                ilog( "Reversible blocks database was not corrupted." );
             }
          }
       } else if( options.at( "fix-reversible-blocks" ).as<bool>()) {
          if( !recover_reversible_blocks( my->chain_config->blocks_dir / config::reversible_blocks_dir_name,
-                                         my->chain_config->reversible_cache_size,
                                          optional<fc::path>(),
                                          options.at( "truncate-at-block" ).as<uint32_t>())) {
             ilog( "Reversible blocks database verified to not be corrupted. Now exiting..." );
@@ -862,8 +1044,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          ilog("Importing reversible blocks from '${file}'", ("file", reversible_blocks_file.generic_string()) );
          fc::remove_all( my->chain_config->blocks_dir/config::reversible_blocks_dir_name );
 
-         import_reversible_blocks( my->chain_config->blocks_dir/config::reversible_blocks_dir_name,
-                                   my->chain_config->reversible_cache_size, reversible_blocks_file );
+         import_reversible_blocks( my->chain_config->blocks_dir/config::reversible_blocks_dir_name, reversible_blocks_file );
 
          EOS_THROW( node_management_success, "imported reversible blocks" );
       }
@@ -872,19 +1053,49 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          wlog("The --import-reversible-blocks option should be used by itself.");
       }
 
+      if( fc::exists( my->chain_config->blocks_dir / config::reversible_blocks_dir_name / "shared_memory.bin" ) ) {
+         ilog( "Converting reversible blocks database of a previous version to a reversible block log" );
+         recover_reversible_blocks( my->chain_config->blocks_dir / config::reversible_blocks_dir_name );
+      }
+
+      EOS_ASSERT( options.count( "snapshot" ) || !options.count( "snapshot-delta" ), plugin_config_exception,
+                  "--snapshot-delta requires the base snapshot to be given with --snapshot" );
+
       fc::optional<chain_id_type> chain_id;
       if (options.count( "snapshot" )) {
          my->snapshot_path = options.at( "snapshot" ).as<bfs::path>();
          EOS_ASSERT( fc::exists(*my->snapshot_path), plugin_config_exception,
                      "Cannot load snapshot, ${name} does not exist", ("name", my->snapshot_path->generic_string()) );
 
+         if( options.count( "snapshot-delta" ) ) {
+            my->snapshot_path = apply_snapshot_deltas( *my->snapshot_path, options.at( "snapshot-delta" ).as<vector<bfs::path>>(),
+                                                       my->chain_config->state_dir );
+            my->merged_snapshot_path = my->snapshot_path;
+         }
+
          // recover genesis information from the snapshot
          // used for validation code below
-         auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
-         istream_snapshot_reader reader(infile);
-         reader.validate();
-         chain_id = controller::extract_chain_id(reader);
-         infile.close();
+         if( is_compressed_snapshot( *my->snapshot_path ) ) {
+            // the stream may be a pipe, keep it open and hand the partly read snapshot to startup
+            my->snapshot_stream = std::make_unique<std::ifstream>( my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary) );
+            my->snapshot_reader = std::make_shared<compressed_istream_snapshot_reader>( *my->snapshot_stream );
+            my->snapshot_reader->validate();
+            chain_id = controller::extract_chain_id( *my->snapshot_reader );
+            my->snapshot_reader->return_to_header();
+         } else if( is_json_snapshot( *my->snapshot_path ) ) {
+            // rows are parsed as they are read, the snapshot is never loaded as a whole
+            my->snapshot_stream = std::make_unique<std::ifstream>( my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary) );
+            my->snapshot_reader = std::make_shared<istream_json_snapshot_reader>( *my->snapshot_stream );
+            my->snapshot_reader->validate();
+            chain_id = controller::extract_chain_id( *my->snapshot_reader );
+            my->snapshot_reader->return_to_header();
+         } else {
+            auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
+            istream_snapshot_reader reader(infile);
+            reader.validate();
+            chain_id = controller::extract_chain_id(reader);
+            infile.close();
+         }
 
          EOS_ASSERT( options.count( "genesis-timestamp" ) == 0,
                  plugin_config_exception,
@@ -1053,9 +1264,31 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       }
 
       my->chain_config->db_map_mode = options.at("database-map-mode").as<pinnable_mapped_file::map_mode>();
+      my->chain_config->publish_state_sequence = options.at("publish-state-sequence").as<bool>();
+      EOS_ASSERT( !my->chain_config->publish_state_sequence || my->chain_config->db_map_mode == pinnable_mapped_file::map_mode::mapped,
+                  plugin_config_exception, "publish-state-sequence requires database-map-mode = mapped" );
 #ifdef __linux__
       if( options.count("database-hugepage-path") )
          my->chain_config->db_hugepage_paths = options.at("database-hugepage-path").as<std::vector<std::string>>();
+
+      {
+         auto& db_memory = my->chain_config->db_memory_options;
+         const auto policy = options.at("database-numa-policy").as<string>();
+         if( policy == "interleave" ) {
+            db_memory.numa_policy = db_numa_policy::interleave;
+         } else if( policy == "bind" ) {
+            db_memory.numa_policy = db_numa_policy::bind;
+         } else {
+            EOS_ASSERT( policy == "none", plugin_config_exception,
+                        "database-numa-policy must be \"none\", \"interleave\", or \"bind\", not \"${p}\"", ("p", policy) );
+         }
+         if( options.count("database-numa-node") )
+            db_memory.numa_nodes = options.at("database-numa-node").as<vector<uint32_t>>();
+         db_memory.transparent_huge_pages = options.at("database-transparent-huge-pages").as<bool>();
+         db_memory.prefault = options.at("database-prefault").as<bool>();
+         db_memory.prefetch_pages = options.at("database-prefetch-pages").as<uint32_t>();
+      }
+      my->chain_config->db_flush_interval = options.at("database-flush-interval").as<uint32_t>();
 #endif
 
 #ifdef EOSIO_EOS_VM_OC_RUNTIME_ENABLED
@@ -1063,12 +1296,37 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          my->chain_config->eosvmoc_config.cache_size = options.at( "eos-vm-oc-cache-size-mb" ).as<uint64_t>() * 1024u * 1024u;
       if( options.count("eos-vm-oc-compile-threads") )
          my->chain_config->eosvmoc_config.threads = options.at("eos-vm-oc-compile-threads").as<uint64_t>();
+      if( options.count("eos-vm-oc-tierup-threshold") )
+         my->chain_config->eosvmoc_config.tierup_threshold = options.at("eos-vm-oc-tierup-threshold").as<uint32_t>();
       if( options["eos-vm-oc-enable"].as<bool>() )
          my->chain_config->eosvmoc_tierup = true;
+      if( options.count("eos-vm-oc-import-cache") )
+         my->chain_config->eosvmoc_config.import_paths = options.at("eos-vm-oc-import-cache").as<std::vector<bfs::path>>();
+      if( options.count("eos-vm-oc-export-cache") )
+         my->chain_config->eosvmoc_config.export_path = options.at("eos-vm-oc-export-cache").as<bfs::path>();
+      if( options.count("eos-vm-oc-warmup-account") ) {
+         for( const auto& a : options.at("eos-vm-oc-warmup-account").as<std::vector<std::string>>() )
+            my->eosvmoc_warmup_accounts.emplace_back( a );
+      }
+      if( options.count("eos-vm-oc-warmup-code-hash") ) {
+         for( const auto& h : options.at("eos-vm-oc-warmup-code-hash").as<std::vector<std::string>>() ) {
+            try {
+               my->eosvmoc_warmup_code_hashes.emplace_back( h );
+            } EOS_RETHROW_EXCEPTIONS( plugin_config_exception, "Invalid eos-vm-oc-warmup-code-hash ${h}", ("h", h) )
+         }
+      }
+      my->eosvmoc_warmup_max_wait = fc::seconds( options.at("eos-vm-oc-warmup-max-wait-sec").as<uint32_t>() );
 #endif
 
       my->account_queries_enabled = options.at("enable-account-queries").as<bool>();
 
+      if( options.at( "compact-state-db" ).as<bool>() ) {
+         EOS_ASSERT( !my->snapshot_path && !my->genesis, plugin_config_exception,
+                     "--compact-state-db requires an existing chain state database and cannot be used with --snapshot" );
+         my->snapshot_path = compact_state_db( *my->chain_config, pfs, *chain_id );
+         my->merged_snapshot_path = my->snapshot_path;
+      }
+
       my->chain.emplace( *my->chain_config, std::move(pfs), *chain_id );
 
       // set up method providers
@@ -1131,6 +1389,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                if (my->_account_query_db) {
                   my->_account_query_db->cache_transaction_trace(std::get<0>(t));
                }
+               my->_abi_serializer_cache->invalidate(std::get<0>(t));
                my->applied_transaction_channel.publish( priority::low, std::get<0>(t) );
             } );
 
@@ -1145,11 +1404,17 @@ void chain_plugin::plugin_startup()
                "read-mode = irreversible. transactions should not be enabled by enable_accept_transactions" );
    try {
       auto shutdown = [](){ return app().is_quiting(); };
-      if (my->snapshot_path) {
+      if (my->snapshot_reader) {
+         my->chain->startup(shutdown, my->snapshot_reader);
+         my->snapshot_reader.reset();
+         my->snapshot_stream.reset();
+      } else if (my->snapshot_path) {
          auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
          auto reader = std::make_shared<istream_snapshot_reader>(infile);
          my->chain->startup(shutdown, reader);
          infile.close();
+         if( my->merged_snapshot_path )
+            fc::remove( *my->merged_snapshot_path );
       } else if( my->genesis ) {
          my->chain->startup(shutdown, *my->genesis);
       } else {
@@ -1174,6 +1439,29 @@ void chain_plugin::plugin_startup()
       ilog("Blockchain started; head block is #${num}", ("num", my->chain->head_block_num()));
    }
 
+#ifdef EOSIO_EOS_VM_OC_RUNTIME_ENABLED
+   if( my->chain_config->eosvmoc_tierup && (my->eosvmoc_warmup_accounts.size() || my->eosvmoc_warmup_code_hashes.size()) ) {
+      std::vector<digest_type> code_hashes = my->eosvmoc_warmup_code_hashes;
+      const auto& db = my->chain->db();
+      for( const auto& a : my->eosvmoc_warmup_accounts ) {
+         const auto* metadata = db.find<account_metadata_object,by_name>( a );
+         if( metadata && metadata->code_hash != digest_type() ) {
+            code_hashes.push_back( metadata->code_hash );
+         } else {
+            wlog( "eos-vm-oc-warmup-account ${a} has no contract", ("a", a) );
+         }
+      }
+      std::sort( code_hashes.begin(), code_hashes.end() );
+      code_hashes.erase( std::unique( code_hashes.begin(), code_hashes.end() ), code_hashes.end() );
+
+      const auto start = fc::time_point::now();
+      ilog( "Compiling ${n} contracts with EOS VM OC", ("n", code_hashes.size()) );
+      const auto compiled = my->chain->get_wasm_interface().compile_ahead( code_hashes, start + my->eosvmoc_warmup_max_wait );
+      ilog( "Compiled ${c} of ${n} contracts with EOS VM OC in ${t} ms",
+            ("c", compiled)("n", code_hashes.size())("t", (fc::time_point::now() - start).count() / 1000) );
+   }
+#endif
+
    my->chain_config.reset();
 
    if (my->account_queries_enabled) {
@@ -1199,10 +1487,12 @@ void chain_plugin::plugin_shutdown() {
    my->chain.reset();
 }
 
-chain_apis::read_write::read_write(controller& db, const fc::microseconds& abi_serializer_max_time, bool api_accept_transactions)
+chain_apis::read_write::read_write(controller& db, const fc::microseconds& abi_serializer_max_time, bool api_accept_transactions,
+                                   abi_serializer_cache* abi_cache)
 : db(db)
 , abi_serializer_max_time(abi_serializer_max_time)
 , api_accept_transactions(api_accept_transactions)
+, abi_cache(abi_cache)
 {
 }
 
@@ -1212,7 +1502,7 @@ void chain_apis::read_write::validate() const {
 }
 
 chain_apis::read_only chain_plugin::get_read_only_api() const {
-   return chain_apis::read_only(chain(), my->_account_query_db, get_abi_serializer_max_time());
+   return chain_apis::read_only(chain(), my->_account_query_db, get_abi_serializer_max_time(), get_abi_serializer_cache());
 }
 
 
@@ -1229,26 +1519,44 @@ bool chain_plugin::block_is_on_preferred_chain(const block_id_type& block_id) {
    return b && b->id() == block_id;
 }
 
-bool chain_plugin::recover_reversible_blocks( const fc::path& db_dir, uint32_t cache_size,
-                                              optional<fc::path> new_db_dir, uint32_t truncate_at_block ) {
-   try {
-      chainbase::database reversible( db_dir, database::read_only); // Test if dirty
-      // If it reaches here, then the reversible database is not dirty
-
-      if( truncate_at_block == 0 )
-         return false;
-
-      reversible.add_index<reversible_block_index>();
-      const auto& ubi = reversible.get_index<reversible_block_index,by_num>();
+namespace {
+   /**
+    *  Calls f on the blocks of a reversible blocks directory in ascending order until f returns false. The directory
+    *  holds either a reversible block log or a chainbase reversible blocks database written by a previous version.
+    */
+   void read_reversible_blocks( const fc::path& reversible_dir, const std::function<bool(const signed_block_ptr&)>& f ) {
+      if( fc::exists( reversible_dir / "shared_memory.bin" ) ) {
+         chainbase::database reversible( reversible_dir, database::read_only, 0, true );
+         reversible.add_index<reversible_block_index>();
+         const auto& ubi = reversible.get_index<reversible_block_index,by_num>();
+         for( auto itr = ubi.begin(); itr != ubi.end(); ++itr ) {
+            if( !f( itr->get_block() ) )
+               break;
+         }
+      } else {
+         reversible_block_log reversible( reversible_dir, true );
+         bool done = false;
+         reversible.for_each( [&]( const signed_block_ptr& b, const block_id_type& ) {
+            if( !done )
+               done = !f( b );
+         });
+      }
+   }
+}
 
-      auto itr = ubi.rbegin();
-      if( itr != ubi.rend() && itr->blocknum <= truncate_at_block )
-         return false; // Because we are not going to be truncating the reversible database at all.
-   } catch( const std::runtime_error& ) {
-   } catch( ... ) {
-      throw;
+bool chain_plugin::recover_reversible_blocks( const fc::path& db_dir, optional<fc::path> new_db_dir, uint32_t truncate_at_block ) {
+   if( !fc::exists( db_dir / "shared_memory.bin" ) ) {
+      try {
+         reversible_block_log reversible( db_dir, true );
+         // If it reaches here, then the reversible block log is readable
+         if( !reversible.truncated_on_open() ) {
+            if( truncate_at_block == 0 || reversible.last_block_num() <= truncate_at_block )
+               return false; // Because we are not going to be truncating the reversible block log at all.
+         }
+      } catch( const fc::exception& ) {
+      }
    }
-   // Reversible block database is dirty (or incompatible). So back it up (unless already moved) and then create a new one.
+   // Reversible blocks are damaged, incompatible or from a previous version. So back them up (unless already moved) and then create a new log.
 
    auto reversible_dir = fc::canonical( db_dir );
    if( reversible_dir.filename().generic_string() == "." ) {
@@ -1279,17 +1587,7 @@ bool chain_plugin::recover_reversible_blocks( const fc::path& db_dir, uint32_t c
 
    ilog( "Reconstructing '${reversible_dir}' from backed up reversible directory", ("reversible_dir", reversible_dir) );
 
-   optional<chainbase::database> old_reversible;
-
-   try {
-      old_reversible = chainbase::database( backup_dir, database::read_only, 0, true );
-   } catch (const std::runtime_error &) {
-      // since we are allowing for dirty, it must be incompatible
-      ilog( "Did not recover any reversible blocks since reversible database incompatible");
-      return true;
-   }
-
-   chainbase::database  new_reversible( reversible_dir, database::read_write, cache_size );
+   reversible_block_log new_reversible( reversible_dir );
    std::fstream         reversible_blocks;
    reversible_blocks.open( (reversible_dir.parent_path() / std::string("portable-reversible-blocks-").append( now ) ).generic_string().c_str(),
                            std::ios::out | std::ios::binary );
@@ -1297,38 +1595,38 @@ bool chain_plugin::recover_reversible_blocks( const fc::path& db_dir, uint32_t c
    uint32_t num = 0;
    uint32_t start = 0;
    uint32_t end = 0;
-   old_reversible->add_index<reversible_block_index>();
-   new_reversible.add_index<reversible_block_index>();
-   const auto& ubi = old_reversible->get_index<reversible_block_index,by_num>();
-   auto itr = ubi.begin();
-   if( itr != ubi.end() ) {
-      start = itr->blocknum;
-      end = start - 1;
-   }
-   if( truncate_at_block > 0 && start > truncate_at_block ) {
-      ilog( "Did not recover any reversible blocks since the specified block number to stop at (${stop}) is less than first block in the reversible database (${start}).", ("stop", truncate_at_block)("start", start) );
-      return true;
-   }
    try {
-      for( ; itr != ubi.end(); ++itr ) {
-         EOS_ASSERT( itr->blocknum == end + 1, gap_in_reversible_blocks_db,
+      read_reversible_blocks( backup_dir, [&]( const signed_block_ptr& b ) {
+         if( num == 0 ) {
+            start = b->block_num();
+            end = start - 1;
+            if( truncate_at_block > 0 && start > truncate_at_block )
+               return false;
+         }
+         EOS_ASSERT( b->block_num() == end + 1, gap_in_reversible_blocks_db,
                      "gap in reversible block database between ${end} and ${blocknum}",
-                     ("end", end)("blocknum", itr->blocknum)
+                     ("end", end)("blocknum", b->block_num())
                    );
-         reversible_blocks.write( itr->packedblock.data(), itr->packedblock.size() );
-         new_reversible.create<reversible_block_object>( [&]( auto& ubo ) {
-            ubo.blocknum = itr->blocknum;
-            ubo.set_block( itr->get_block() ); // get_block and set_block rather than copying the packed data acts as additional validation
-         });
-         end = itr->blocknum;
+         auto packed = fc::raw::pack( *b );
+         reversible_blocks.write( packed.data(), packed.size() );
+         new_reversible.append( b, b->id() );
+         end = b->block_num();
          ++num;
-         if( end == truncate_at_block )
-            break;
-      }
+         return end != truncate_at_block;
+      });
    } catch( const gap_in_reversible_blocks_db& e ) {
       wlog( "${details}", ("details", e.to_detail_string()) );
+   } catch( const std::runtime_error& ) {
+      // since we are allowing for dirty, it must be incompatible
+      ilog( "Did not recover any reversible blocks since reversible database incompatible");
+      return true;
    } catch( ... ) {}
 
+   if( num == 0 && start > 0 ) {
+      ilog( "Did not recover any reversible blocks since the specified block number to stop at (${stop}) is less than first block in the reversible database (${start}).", ("stop", truncate_at_block)("start", start) );
+      return true;
+   }
+
    if( end == truncate_at_block )
       ilog( "Stopped recovery of reversible blocks early at specified block number: ${stop}", ("stop", truncate_at_block) );
 
@@ -1344,10 +1642,9 @@ bool chain_plugin::recover_reversible_blocks( const fc::path& db_dir, uint32_t c
 }
 
 bool chain_plugin::import_reversible_blocks( const fc::path& reversible_dir,
-                                             uint32_t cache_size,
                                              const fc::path& reversible_blocks_file ) {
    std::fstream         reversible_blocks;
-   chainbase::database  new_reversible( reversible_dir, database::read_write, cache_size );
+   reversible_block_log new_reversible( reversible_dir );
    reversible_blocks.open( reversible_blocks_file.generic_string().c_str(), std::ios::in | std::ios::binary );
 
    reversible_blocks.seekg( 0, std::ios::end );
@@ -1357,12 +1654,11 @@ bool chain_plugin::import_reversible_blocks( const fc::path& reversible_dir,
    uint32_t num = 0;
    uint32_t start = 0;
    uint32_t end = 0;
-   new_reversible.add_index<reversible_block_index>();
    try {
       while( reversible_blocks.tellg() < end_pos ) {
-         signed_block tmp;
-         fc::raw::unpack(reversible_blocks, tmp);
-         num = tmp.block_num();
+         auto tmp = std::make_shared<signed_block>();
+         fc::raw::unpack(reversible_blocks, *tmp);
+         num = tmp->block_num();
 
          if( start == 0 ) {
             start = num;
@@ -1373,10 +1669,7 @@ bool chain_plugin::import_reversible_blocks( const fc::path& reversible_dir,
                       );
          }
 
-         new_reversible.create<reversible_block_object>( [&]( auto& ubo ) {
-            ubo.blocknum = num;
-            ubo.set_block( std::make_shared<signed_block>(std::move(tmp)) );
-         });
+         new_reversible.append( tmp, tmp->id() );
          end = num;
       }
    } catch( gap_in_reversible_blocks_db& e ) {
@@ -1394,33 +1687,28 @@ bool chain_plugin::import_reversible_blocks( const fc::path& reversible_dir,
 
 bool chain_plugin::export_reversible_blocks( const fc::path& reversible_dir,
                                              const fc::path& reversible_blocks_file ) {
-   chainbase::database  reversible( reversible_dir, database::read_only, 0, true );
    std::fstream         reversible_blocks;
    reversible_blocks.open( reversible_blocks_file.generic_string().c_str(), std::ios::out | std::ios::binary );
 
    uint32_t num = 0;
    uint32_t start = 0;
    uint32_t end = 0;
-   reversible.add_index<reversible_block_index>();
-   const auto& ubi = reversible.get_index<reversible_block_index,by_num>();
-   auto itr = ubi.begin();
-   if( itr != ubi.end() ) {
-      start = itr->blocknum;
-      end = start - 1;
-   }
    try {
-      for( ; itr != ubi.end(); ++itr ) {
-         EOS_ASSERT( itr->blocknum == end + 1, gap_in_reversible_blocks_db,
+      read_reversible_blocks( reversible_dir, [&]( const signed_block_ptr& b ) {
+         if( num == 0 ) {
+            start = b->block_num();
+            end = start - 1;
+         }
+         EOS_ASSERT( b->block_num() == end + 1, gap_in_reversible_blocks_db,
                      "gap in reversible block database between ${end} and ${blocknum}",
-                     ("end", end)("blocknum", itr->blocknum)
+                     ("end", end)("blocknum", b->block_num())
                    );
-         signed_block tmp;
-         fc::datastream<const char *> ds( itr->packedblock.data(), itr->packedblock.size() );
-         fc::raw::unpack(ds, tmp); // Verify that packed block has not been corrupted.
-         reversible_blocks.write( itr->packedblock.data(), itr->packedblock.size() );
-         end = itr->blocknum;
+         auto packed = fc::raw::pack( *b );
+         reversible_blocks.write( packed.data(), packed.size() );
+         end = b->block_num();
          ++num;
-      }
+         return true;
+      });
    } catch( const gap_in_reversible_blocks_db& e ) {
       wlog( "${details}", ("details", e.to_detail_string()) );
    } catch( ... ) {}
@@ -1449,6 +1737,10 @@ fc::microseconds chain_plugin::get_abi_serializer_max_time() const {
    return my->abi_serializer_max_time_us;
 }
 
+chain_apis::abi_serializer_cache* chain_plugin::get_abi_serializer_cache() const {
+   return my->_abi_serializer_cache ? &*my->_abi_serializer_cache : nullptr;
+}
+
 bool chain_plugin::api_accept_transactions() const{
    return my->api_accept_transactions;
 }
@@ -1466,9 +1758,6 @@ void chain_plugin::log_guard_exception(const chain::guard_exception&e ) {
    if (e.code() == chain::database_guard_exception::code_value) {
       elog("Database has reached an unsafe level of usage, shutting down to avoid corrupting the database.  "
            "Please increase the value set for \"chain-state-db-size-mb\" and restart the process!");
-   } else if (e.code() == chain::reversible_guard_exception::code_value) {
-      elog("Reversible block database has reached an unsafe level of usage, shutting down to avoid corrupting the database.  "
-           "Please increase the value set for \"reversible-blocks-db-size-mb\" and restart the process!");
    }
 
    dlog("Details: ${details}", ("details", e.to_detail_string()));
@@ -1483,7 +1772,7 @@ void chain_plugin::handle_guard_exception(const chain::guard_exception& e) {
 }
 
 void chain_plugin::handle_db_exhaustion() {
-   elog("database memory exhausted: increase chain-state-db-size-mb and/or reversible-blocks-db-size-mb");
+   elog("database memory exhausted: increase chain-state-db-size-mb");
    //return 1 -- it's what programs/nodeos/main.cpp considers "BAD_ALLOC"
    std::_Exit(1);
 }
@@ -1738,6 +2027,16 @@ abi_def get_abi( const controller& db, const name& account ) {
    return abi;
 }
 
+abi_serializer_cache::entry_ptr get_abi_serializer( const controller& db, abi_serializer_cache* cache, const name& account,
+                                                    const abi_serializer::yield_function_t& yield ) {
+   if( cache ) return cache->get( db, account, yield );
+   const auto* accnt = db.db().find<account_object, by_name>( account );
+   if( accnt == nullptr ) return {};
+   abi_def abi;
+   if( !abi_serializer::to_abi( accnt->abi, abi ) ) return {};
+   return std::make_shared<const abi_serializer_cache::entry>( std::move( abi ), yield );
+}
+
 string get_table_type( const abi_def& abi, const name& table_name ) {
    for( const auto& t : abi.tables ) {
       if( t.name == table_name ){
@@ -1747,8 +2046,39 @@ string get_table_type( const abi_def& abi, const name& table_name ) {
    EOS_ASSERT( false, chain::contract_table_query_exception, "Table ${table} is not specified in the ABI", ("table",table_name) );
 }
 
+string read_only::encode_cursor( const table_cursor& c ) {
+   return fc::to_hex( fc::raw::pack( c ) );
+}
+
+read_only::table_cursor read_only::decode_cursor( const string& cursor, uint64_t index ) {
+   table_cursor c;
+   try {
+      EOS_ASSERT( cursor.size() % 2 == 0, chain::contract_table_query_exception, "Odd number of hex digits" );
+      vector<char> bytes( cursor.size() / 2 );
+      fc::from_hex( cursor, bytes.data(), bytes.size() );
+      c = fc::raw::unpack<table_cursor>( bytes );
+   } EOS_RETHROW_EXCEPTIONS( chain::contract_table_query_exception, "Invalid cursor: ${c}", ("c", cursor) )
+   EOS_ASSERT( c.index == index, chain::contract_table_query_exception, "Cursor ${c} is not of this table index", ("c", cursor) );
+   return c;
+}
+
 read_only::get_table_rows_result read_only::get_table_rows( const read_only::get_table_rows_params& p )const {
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
+   return collect_table_rows( p ).decode();
+}
+
+read_only::get_table_rows_collected read_only::collect_table_rows( const read_only::get_table_rows_params& p )const {
+   get_table_rows_collected result;
+   result.params = p;
+   if( p.json ) {
+      result.abi = get_abi_serializer( db, abi_cache, p.code, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+   }
+   abi_def plain_abi;
+   if( !result.abi ) {
+      plain_abi = eosio::chain_apis::get_abi( db, p.code );
+   }
+   const abi_def& abi = result.abi ? result.abi->abi : plain_abi;
+   result.abi_serializer_max_time = abi_serializer_max_time;
+   result.shorten_abi_errors = shorten_abi_errors;
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
    bool primary = false;
@@ -1757,62 +2087,199 @@ read_only::get_table_rows_result read_only::get_table_rows( const read_only::get
       EOS_ASSERT( p.table == table_with_index, chain::contract_table_query_exception, "Invalid table name ${t}", ( "t", p.table ));
       auto table_type = get_table_type( abi, p.table );
       if( table_type == KEYi64 || p.key_type == "i64" || p.key_type == "name" ) {
-         return get_table_rows_ex<key_value_index>(p,abi);
+         get_table_rows_ex<key_value_index>(p, result);
+         return result;
       }
       EOS_ASSERT( false, chain::contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type)("abi",abi));
    } else {
       EOS_ASSERT( !p.key_type.empty(), chain::contract_table_query_exception, "key type required for non-primary index" );
 
       if (p.key_type == chain_apis::i64 || p.key_type == "name") {
-         return get_table_rows_by_seckey<index64_index, uint64_t>(p, abi, [](uint64_t v)->uint64_t {
+         get_table_rows_by_seckey<index64_index, uint64_t>(p, result, [](uint64_t v)->uint64_t {
             return v;
          });
+         return result;
       }
       else if (p.key_type == chain_apis::i128) {
-         return get_table_rows_by_seckey<index128_index, uint128_t>(p, abi, [](uint128_t v)->uint128_t {
+         get_table_rows_by_seckey<index128_index, uint128_t>(p, result, [](uint128_t v)->uint128_t {
             return v;
          });
+         return result;
       }
       else if (p.key_type == chain_apis::i256) {
          if ( p.encode_type == chain_apis::hex) {
             using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-            return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+            get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, result, conv::function());
+            return result;
          }
          using  conv = keytype_converter<chain_apis::i256>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, result, conv::function());
+         return result;
       }
       else if (p.key_type == chain_apis::float64) {
-         return get_table_rows_by_seckey<index_double_index, double>(p, abi, [](double v)->float64_t {
+         get_table_rows_by_seckey<index_double_index, double>(p, result, [](double v)->float64_t {
             float64_t f = *(float64_t *)&v;
             return f;
          });
+         return result;
       }
       else if (p.key_type == chain_apis::float128) {
          if ( p.encode_type == chain_apis::hex) {
-            return get_table_rows_by_seckey<index_long_double_index, uint128_t>(p, abi, [](uint128_t v)->float128_t{
+            get_table_rows_by_seckey<index_long_double_index, uint128_t>(p, result, [](uint128_t v)->float128_t{
                return *reinterpret_cast<float128_t *>(&v);
             });
+            return result;
          }
-         return get_table_rows_by_seckey<index_long_double_index, double>(p, abi, [](double v)->float128_t{
+         get_table_rows_by_seckey<index_long_double_index, double>(p, result, [](double v)->float128_t{
             float64_t f = *(float64_t *)&v;
             float128_t f128;
             f64_to_f128M(f, &f128);
             return f128;
          });
+         return result;
       }
       else if (p.key_type == chain_apis::sha256) {
          using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, result, conv::function());
+         return result;
       }
       else if(p.key_type == chain_apis::ripemd160) {
          using  conv = keytype_converter<chain_apis::ripemd160,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, result, conv::function());
+         return result;
       }
       EOS_ASSERT(false, chain::contract_table_query_exception,  "Unsupported secondary index type: ${t}", ("t", p.key_type));
    }
 #pragma GCC diagnostic pop
 }
 
+vector<char> read_only::get_table_rows_collected::pack()const {
+   fc::datastream<size_t> ps;
+   fc::raw::pack( ps, rows );
+   fc::raw::pack( ps, more );
+   fc::raw::pack( ps, next_key );
+   fc::raw::pack( ps, next_cursor );
+   vector<char> result( ps.tellp() );
+   fc::datastream<char*> ds( result.data(), result.size() );
+   fc::raw::pack( ds, rows );
+   fc::raw::pack( ds, more );
+   fc::raw::pack( ds, next_key );
+   fc::raw::pack( ds, next_cursor );
+   return result;
+}
+
+namespace {
+   /// the rows of collected, those the compiled decoder decodes added to splicer as JSON if it is set
+   read_only::get_table_rows_result decode_table_rows( const read_only::get_table_rows_collected& collected, json_splicer* splicer ) {
+      const auto& [params, abi, rows, more, next_key, next_cursor, abi_serializer_max_time, shorten_abi_errors] = collected;
+      read_only::get_table_rows_result result;
+      result.more = more;
+      result.next_key = next_key;
+      result.next_cursor = next_cursor;
+      result.rows.reserve( rows.size() );
+
+      const bool show_payer = params.show_payer && *params.show_payer;
+      const auto type = abi ? abi->serializer.get_table_type( params.table ) : type_name();
+      const auto compiled_type = abi && abi->compiled ? abi->compiled->find_type( type ) : abi_compiled_decoder::invalid_type;
+      for( const auto& row : rows ) {
+         fc::variant data_var;
+         if( splicer && compiled_type != abi_compiled_decoder::invalid_type ) {
+            data_var = splicer->add( abi->compiled->to_json( compiled_type, row.first,
+                                                             impl::abi_traverse_context( abi_serializer::create_yield_function( abi_serializer_max_time ) ) ) );
+         } else if( abi ) {
+            data_var = abi->binary_to_variant( type, row.first, abi_serializer::create_yield_function( abi_serializer_max_time ), shorten_abi_errors );
+         } else {
+            data_var = fc::variant( row.first );
+         }
+
+         if( show_payer ) {
+            result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", row.second) );
+         } else {
+            result.rows.emplace_back( std::move(data_var) );
+         }
+      }
+      return result;
+   }
+}
+
+read_only::get_table_rows_result read_only::get_table_rows_collected::decode()const {
+   return decode_table_rows( *this, nullptr );
+}
+
+std::string read_only::get_table_rows_collected::to_json( const fc::time_point& deadline )const {
+   json_splicer splicer;
+   return splicer.to_string( fc::variant( decode_table_rows( *this, &splicer ) ), deadline );
+}
+
+read_only::get_table_deltas_collected read_only::collect_table_deltas( const std::set<std::tuple<name, name, name>>& tables )const {
+   get_table_deltas_collected result;
+   result.abi_serializer_max_time = abi_serializer_max_time;
+   result.shorten_abi_errors = shorten_abi_errors;
+   const auto& d = db.db();
+   const auto& index = d.get_index<key_value_index>();
+   if( tables.empty() || index.stack().empty() ) return result;
+
+   // a row removed by the block may have taken its table with it
+   const auto& table_id_index = d.get_index<chain::table_id_multi_index>();
+   std::map<uint64_t, const chain::table_id_object*> removed_table_id;
+   if( !table_id_index.stack().empty() ) {
+      for( const auto& rem : table_id_index.stack().back().removed_values )
+         removed_table_id[rem.first._id] = &rem.second;
+   }
+
+   auto add_row = [&]( bool present, const chain::key_value_object& row ) {
+      const chain::table_id_object* t_id = table_id_index.find( row.t_id._id );
+      if( t_id == nullptr ) {
+         auto itr = removed_table_id.find( row.t_id._id );
+         if( itr == removed_table_id.end() ) return;
+         t_id = itr->second;
+      }
+      if( tables.count( std::make_tuple( t_id->code, t_id->scope, t_id->table ) ) == 0 ) return;
+      if( result.abis.count( t_id->code ) == 0 ) {
+         result.abis.emplace( t_id->code, get_abi_serializer( db, abi_cache, t_id->code, abi_serializer::create_yield_function( abi_serializer_max_time ) ) );
+      }
+      result.rows.push_back( { t_id->code, t_id->scope, t_id->table, row.primary_key, row.payer, present,
+                               vector<char>( row.value.data(), row.value.data() + row.value.size() ) } );
+   };
+
+   const auto& undo = index.stack().back();
+   for( const auto& old : undo.old_values )
+      add_row( true, index.get( old.first ) );
+   for( const auto& rem : undo.removed_values )
+      add_row( false, rem.second );
+   for( auto id : undo.new_ids )
+      add_row( true, index.get( id ) );
+   return result;
+}
+
+fc::variants read_only::get_table_deltas_collected::decode()const {
+   fc::variants result;
+   result.reserve( rows.size() );
+   for( const auto& row : rows ) {
+      fc::variant value;
+      const auto itr = abis.find( row.code );
+      if( itr != abis.end() && itr->second ) {
+         try {
+            value = itr->second->binary_to_variant( itr->second->serializer.get_table_type( row.table ), row.value, abi_serializer::create_yield_function( abi_serializer_max_time ), shorten_abi_errors );
+         } catch( const fc::exception& e ) {
+            dlog( "unable to decode row of ${c} ${t}: ${e}", ("c", row.code)("t", row.table)("e", e.to_string()) );
+         }
+      }
+      if( value.is_null() ) {
+         value = fc::variant( row.value );
+      }
+      result.emplace_back( fc::mutable_variant_object()
+                              ( "code", row.code )
+                              ( "scope", row.scope )
+                              ( "table", row.table )
+                              ( "primary_key", row.primary_key )
+                              ( "payer", row.payer )
+                              ( "present", row.present )
+                              ( "value", std::move( value ) ) );
+   }
+   return result;
+}
+
 read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_only::get_table_by_scope_params& p )const {
    read_only::get_table_by_scope_result result;
    const auto& d = db.db();
@@ -1832,6 +2299,17 @@ read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_o
       std::get<1>(upper_bound_lookup_tuple) = name(scope);
    }
 
+   // the cursor of a table is its (scope, table), the index of the cursor is the code
+   if( p.cursor.size() ) {
+      const auto c = decode_cursor( p.cursor, p.code.to_uint64_t() );
+      EOS_ASSERT( c.secondary_key.size() == sizeof(uint64_t), chain::contract_table_query_exception, "Cursor ${c} is not of a scope", ("c", p.cursor) );
+      uint64_t scope = 0;
+      memcpy( &scope, c.secondary_key.data(), sizeof(scope) );
+      auto& bound = ( p.reverse && *p.reverse ) ? upper_bound_lookup_tuple : lower_bound_lookup_tuple;
+      std::get<1>(bound) = name(scope);
+      std::get<2>(bound) = name(c.primary_key);
+   }
+
    if( upper_bound_lookup_tuple < lower_bound_lookup_tuple )
       return result;
 
@@ -1847,6 +2325,7 @@ read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_o
       }
       if( itr != end_itr ) {
          result.more = itr->scope.to_string();
+         result.next_cursor = encode_cursor( { p.code.to_uint64_t(), key_bytes( itr->scope.to_uint64_t() ), itr->table.to_uint64_t() } );
       }
    };
 
@@ -1861,13 +2340,60 @@ read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_o
    return result;
 }
 
+read_only::get_kv_rows_result read_only::get_kv_rows( const read_only::get_kv_rows_params& p )const {
+   read_only::get_kv_rows_result result;
+   const auto& d = db.db();
+
+   const auto& idx = d.get_index<chain::kv_index, chain::by_kv_key>();
+   const std::string_view prefix( p.prefix.data(), p.prefix.size() );
+   std::string_view lower( p.lower_bound.data(), p.lower_bound.size() );
+   if( lower < prefix ) lower = prefix;
+
+   auto end_time = fc::time_point::now() + fc::microseconds(1000 * 10); /// 10ms max time
+   for( auto itr = idx.lower_bound( boost::make_tuple( p.code, lower ) ); itr != idx.end() && itr->contract == p.code; ++itr ) {
+      const std::string_view key( itr->kv_key.data(), itr->kv_key.size() );
+      if( key.substr( 0, prefix.size() ) != prefix ) break;
+      if( result.rows.size() >= p.limit || fc::time_point::now() > end_time ) {
+         result.more = bytes( key.begin(), key.end() );
+         break;
+      }
+      result.rows.push_back( {bytes( key.begin(), key.end() ), itr->payer, bytes( itr->kv_value.begin(), itr->kv_value.end() )} );
+   }
+
+   return result;
+}
+
 vector<asset> read_only::get_currency_balance( const read_only::get_currency_balance_params& p )const {
 
    const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
    (void)get_table_type( abi, name("accounts") );
 
+   return currency_balances( p.code, p.account, p.symbol );
+}
+
+vector<read_only::get_currency_balances_row> read_only::get_currency_balances( const read_only::get_currency_balances_params& p )const {
+   EOS_ASSERT( p.accounts.size() <= max_batched_accounts, chain::contract_table_query_exception,
+               "At most ${max} accounts may be requested at once", ("max", max_batched_accounts) );
+
+   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
+   (void)get_table_type( abi, name("accounts") );
+
+   // in name order the tables of the accounts, scoped by them, are next to each other in the index
+   auto accounts = p.accounts;
+   std::sort( accounts.begin(), accounts.end() );
+   accounts.erase( std::unique( accounts.begin(), accounts.end() ), accounts.end() );
+
+   vector<get_currency_balances_row> results;
+   results.reserve( accounts.size() );
+   for( const auto& account : accounts ) {
+      results.push_back( { account, currency_balances( p.code, account, p.symbol ) } );
+   }
+   return results;
+}
+
+vector<asset> read_only::currency_balances( name code, name account, const optional<string>& symbol )const {
    vector<asset> results;
-   walk_key_value_table(p.code, p.account, N(accounts), [&](const key_value_object& obj){
+   walk_key_value_table(code, account, N(accounts), [&](const key_value_object& obj){
       EOS_ASSERT( obj.value.size() >= sizeof(asset), chain::asset_type_exception, "Invalid data on table");
 
       asset cursor;
@@ -1876,12 +2402,12 @@ vector<asset> read_only::get_currency_balance( const read_only::get_currency_bal
 
       EOS_ASSERT( cursor.get_symbol().valid(), chain::asset_type_exception, "Invalid asset");
 
-      if( !p.symbol || boost::iequals(cursor.symbol_name(), *p.symbol) ) {
+      if( !symbol || boost::iequals(cursor.symbol_name(), *symbol) ) {
         results.emplace_back(cursor);
       }
 
       // return false if we are looking for one and found it, true otherwise
-      return !(p.symbol && boost::iequals(cursor.symbol_name(), *p.symbol));
+      return !(symbol && boost::iequals(cursor.symbol_name(), *symbol));
    });
 
    return results;
@@ -2001,6 +2527,99 @@ read_only::get_producers_result read_only::get_producers( const read_only::get_p
    return result;
 }
 
+read_only::get_producers_collected read_only::collect_producers( bool changed_only )const {
+   get_producers_collected result;
+   result.abi_serializer_max_time = abi_serializer_max_time;
+   result.shorten_abi_errors = shorten_abi_errors;
+   const auto& d = db.db();
+
+   static const uint8_t secondary_index_num = 0;
+   const auto* const table_id = d.find<chain::table_id_object, chain::by_code_scope_table>(
+           boost::make_tuple(config::system_account_name, config::system_account_name, N(producers)));
+   const auto* const secondary_table_id = d.find<chain::table_id_object, chain::by_code_scope_table>(
+           boost::make_tuple(config::system_account_name, config::system_account_name, name(N(producers).to_uint64_t() | secondary_index_num)));
+   const auto* const global_table_id = d.find<chain::table_id_object, chain::by_code_scope_table>(
+           boost::make_tuple(config::system_account_name, config::system_account_name, N(global)));
+   result.abi = get_abi_serializer( db, abi_cache, config::system_account_name, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+   if( !table_id || !secondary_table_id || !global_table_id || !result.abi ) {
+      result.complete = true;
+      return result;
+   }
+   result.available = true;
+
+   const auto& kv_index = d.get_index<key_value_index>();
+   const auto& secondary_index_by_primary = d.get_index<index_double_index>().indices().get<by_primary>();
+
+   auto add_row = [&]( bool present, const chain::key_value_object& row ) {
+      if( row.t_id == global_table_id->id && row.primary_key == N(global).to_uint64_t() ) {
+         if( present ) result.global.emplace( row.value.data(), row.value.data() + row.value.size() );
+         return;
+      }
+      if( row.t_id != table_id->id ) return;
+      get_producers_collected_row r{ row.primary_key, 0, present };
+      if( present ) {
+         auto sec = secondary_index_by_primary.find( boost::make_tuple( secondary_table_id->id, row.primary_key ) );
+         if( sec == secondary_index_by_primary.end() ) {
+            r.present = false;
+         } else {
+            r.total_votes_key = from_softfloat64( sec->secondary_key );
+            r.value.assign( row.value.data(), row.value.data() + row.value.size() );
+         }
+      }
+      result.rows.emplace_back( std::move( r ) );
+   };
+
+   if( changed_only && !kv_index.stack().empty() ) {
+      const auto& undo = kv_index.stack().back();
+      for( const auto& old : undo.old_values )
+         add_row( true, kv_index.get( old.first ) );
+      for( const auto& rem : undo.removed_values )
+         add_row( false, rem.second );
+      for( auto id : undo.new_ids )
+         add_row( true, kv_index.get( id ) );
+      return result;
+   }
+
+   result.complete = true;
+   const auto& by_scope = d.get_index<key_value_index, by_scope_primary>();
+   for( auto itr = by_scope.lower_bound( boost::make_tuple( table_id->id ) ); itr != by_scope.end() && itr->t_id == table_id->id; ++itr )
+      add_row( true, *itr );
+   auto global = by_scope.find( boost::make_tuple( global_table_id->id, N(global).to_uint64_t() ) );
+   if( global != by_scope.end() ) add_row( true, *global );
+   return result;
+}
+
+vector<read_only::get_producers_decoded_row> read_only::get_producers_collected::decode()const {
+   vector<get_producers_decoded_row> result;
+   result.reserve( rows.size() );
+   for( const auto& row : rows ) {
+      get_producers_decoded_row r{ row.owner, row.total_votes_key, row.present };
+      if( row.present ) {
+         r.hex = fc::variant( row.value );
+         try {
+            r.json = abi->serializer.binary_to_variant( abi->serializer.get_table_type( N(producers) ), row.value,
+                                                   abi_serializer::create_yield_function( abi_serializer_max_time ), shorten_abi_errors );
+         } catch( const fc::exception& e ) {
+            dlog( "unable to decode producers row ${o}: ${e}", ("o", name{row.owner})("e", e.to_string()) );
+            r.json = r.hex;
+         }
+      }
+      result.emplace_back( std::move( r ) );
+   }
+   return result;
+}
+
+optional<double> read_only::get_producers_collected::decode_total_producer_vote_weight()const {
+   if( !global ) return {};
+   try {
+      return abi->serializer.binary_to_variant( abi->serializer.get_table_type( N(global) ), *global,
+                                                abi_serializer::create_yield_function( abi_serializer_max_time ), shorten_abi_errors )["total_producer_vote_weight"].as_double();
+   } catch( const fc::exception& e ) {
+      dlog( "unable to decode the global row: ${e}", ("e", e.to_string()) );
+      return {};
+   }
+}
+
 read_only::get_producer_schedule_result read_only::get_producer_schedule( const read_only::get_producer_schedule_params& p ) const {
    read_only::get_producer_schedule_result result;
    to_variant(db.active_producers(), result.active);
@@ -2015,16 +2634,8 @@ read_only::get_producer_schedule_result read_only::get_producer_schedule( const
 template<typename Api>
 struct resolver_factory {
    static auto make(const Api* api, abi_serializer::yield_function_t yield) {
-      return [api, yield{std::move(yield)}](const account_name &name) -> optional<abi_serializer> {
-         const auto* accnt = api->db.db().template find<account_object, by_name>(name);
-         if (accnt != nullptr) {
-            abi_def abi;
-            if (abi_serializer::to_abi(accnt->abi, abi)) {
-               return abi_serializer(abi, yield);
-            }
-         }
-
-         return optional<abi_serializer>();
+      return [api, yield{std::move(yield)}](const account_name &name) -> abi_serializer_cache::resolved {
+         return abi_serializer_cache::resolved{ get_abi_serializer( api->db, api->abi_cache, name, yield ) };
       };
    }
 };
@@ -2037,6 +2648,11 @@ auto make_resolver(const Api* api, abi_serializer::yield_function_t yield) {
 
 read_only::get_scheduled_transactions_result
 read_only::get_scheduled_transactions( const read_only::get_scheduled_transactions_params& p ) const {
+   return collect_scheduled_transactions( p ).decode();
+}
+
+read_only::get_scheduled_transactions_collected
+read_only::collect_scheduled_transactions( const read_only::get_scheduled_transactions_params& p ) const {
    const auto& d = db.db();
 
    const auto& idx_by_delay = d.get_index<generated_transaction_multi_index,by_delay>();
@@ -2065,38 +2681,32 @@ read_only::get_scheduled_transactions( const read_only::get_scheduled_transactio
       }
    })();
 
-   read_only::get_scheduled_transactions_result result;
-
-   auto resolver = make_resolver(this, abi_serializer::create_yield_function( abi_serializer_max_time ));
+   get_scheduled_transactions_collected result;
+   result.json = p.json;
+   result.abi_serializer_max_time = abi_serializer_max_time;
+   const auto yield = abi_serializer::create_yield_function( abi_serializer_max_time );
+   auto add_abis = [&]( const vector<action>& actions ) {
+      for( const auto& a : actions ) {
+         if( result.abis.count( a.account ) ) continue;
+         result.abis.emplace( a.account, get_abi_serializer( db, abi_cache, a.account, yield ) );
+      }
+   };
 
    uint32_t remaining = p.limit;
    auto time_limit = fc::time_point::now() + fc::microseconds(1000 * 10); /// 10ms max time
    while (itr != idx_by_delay.end() && remaining > 0 && time_limit > fc::time_point::now()) {
-      auto row = fc::mutable_variant_object()
-              ("trx_id", itr->trx_id)
-              ("sender", itr->sender)
-              ("sender_id", itr->sender_id)
-              ("payer", itr->payer)
-              ("delay_until", itr->delay_until)
-              ("expiration", itr->expiration)
-              ("published", itr->published)
-      ;
-
+      get_scheduled_transactions_collected::row row{ itr->trx_id, itr->sender, itr->sender_id, itr->payer,
+                                                     itr->delay_until, itr->expiration, itr->published,
+                                                     bytes(itr->packed_trx.begin(), itr->packed_trx.end()) };
       if (p.json) {
-         fc::variant pretty_transaction;
-
-         transaction trx;
-         fc::datastream<const char*> ds( itr->packed_trx.data(), itr->packed_trx.size() );
-         fc::raw::unpack(ds,trx);
-
-         abi_serializer::to_variant(trx, pretty_transaction, resolver, abi_serializer::create_yield_function( abi_serializer_max_time ));
-         row("transaction", pretty_transaction);
-      } else {
-         auto packed_transaction = bytes(itr->packed_trx.begin(), itr->packed_trx.end());
-         row("transaction", packed_transaction);
+         row.trx.emplace();
+         fc::datastream<const char*> ds( row.packed_trx.data(), row.packed_trx.size() );
+         fc::raw::unpack(ds, *row.trx);
+         add_abis( row.trx->context_free_actions );
+         add_abis( row.trx->actions );
       }
 
-      result.transactions.emplace_back(std::move(row));
+      result.rows.emplace_back(std::move(row));
       ++itr;
       remaining--;
    }
@@ -2108,7 +2718,71 @@ read_only::get_scheduled_transactions( const read_only::get_scheduled_transactio
    return result;
 }
 
+fc::optional<fc::variant>
+read_only::scheduled_transactions_cache::find( const transaction_id_type& id, const vector<abi_serializer_cache::entry_ptr>& abis )const {
+   std::lock_guard<std::mutex> g( mtx );
+   auto itr = entries.find( id );
+   if( itr == entries.end() || itr->second.abis != abis ) return {};
+   return itr->second.json;
+}
+
+void read_only::scheduled_transactions_cache::insert( const transaction_id_type& id, vector<abi_serializer_cache::entry_ptr> abis,
+                                                      fc::variant json ) {
+   std::lock_guard<std::mutex> g( mtx );
+   // retired transactions are not removed one by one, all go at once
+   if( entries.size() >= max_entries ) entries.clear();
+   entries[id] = entry{ std::move( abis ), std::move( json ) };
+}
+
+read_only::get_scheduled_transactions_result
+read_only::get_scheduled_transactions_collected::decode( scheduled_transactions_cache* cache )const {
+   auto resolver = [this]( const account_name& account ) -> abi_serializer_cache::resolved {
+      auto itr = abis.find( account );
+      return abi_serializer_cache::resolved{ itr != abis.end() ? itr->second : abi_serializer_cache::entry_ptr() };
+   };
+
+   get_scheduled_transactions_result result;
+   result.transactions.reserve( rows.size() );
+   for( const auto& r : rows ) {
+      auto row = fc::mutable_variant_object()
+              ("trx_id", r.trx_id)
+              ("sender", r.sender)
+              ("sender_id", r.sender_id)
+              ("payer", r.payer)
+              ("delay_until", r.delay_until)
+              ("expiration", r.expiration)
+              ("published", r.published)
+      ;
+
+      if (json) {
+         vector<abi_serializer_cache::entry_ptr> trx_abis;
+         if( cache ) {
+            for( const auto* actions : { &r.trx->context_free_actions, &r.trx->actions } ) {
+               for( const auto& a : *actions ) trx_abis.push_back( resolver( a.account ).e );
+            }
+         }
+         fc::optional<fc::variant> pretty_transaction = cache ? cache->find( r.trx_id, trx_abis ) : fc::optional<fc::variant>();
+         if( !pretty_transaction ) {
+            pretty_transaction.emplace();
+            abi_serializer::to_variant(*r.trx, *pretty_transaction, resolver, abi_serializer::create_yield_function( abi_serializer_max_time ));
+            if( cache ) cache->insert( r.trx_id, std::move( trx_abis ), *pretty_transaction );
+         }
+         row("transaction", std::move( *pretty_transaction ));
+      } else {
+         row("transaction", r.packed_trx);
+      }
+
+      result.transactions.emplace_back(std::move(row));
+   }
+   result.more = more;
+   return result;
+}
+
 fc::variant read_only::get_block(const read_only::get_block_params& params) const {
+   return collect_block( params ).format();
+}
+
+static signed_block_ptr fetch_block(const controller& db, const read_only::get_block_params& params) {
    signed_block_ptr block;
    optional<uint64_t> block_num;
 
@@ -2130,17 +2804,65 @@ fc::variant read_only::get_block(const read_only::get_block_params& params) cons
    }
 
    EOS_ASSERT( block, unknown_block_exception, "Could not find block: ${block}", ("block", params.block_num_or_id));
+   return block;
+}
 
-   fc::variant pretty_output;
-   abi_serializer::to_variant(*block, pretty_output, make_resolver(this, abi_serializer::create_yield_function( abi_serializer_max_time )),
-                              abi_serializer::create_yield_function( abi_serializer_max_time ));
+vector<char> read_only::get_packed_block(const read_only::get_block_params& params) const {
+   return fc::raw::pack( *fetch_block( db, params ) );
+}
 
-   uint32_t ref_block_prefix = block->id()._hash[1];
+read_only::get_block_collected read_only::collect_block(const read_only::get_block_params& params) const {
+   return collect_block( fetch_block( db, params ) );
+}
 
-   return fc::mutable_variant_object(pretty_output.get_object())
-           ("id", block->id())
-           ("block_num",block->block_num())
-           ("ref_block_prefix", ref_block_prefix);
+read_only::get_block_collected read_only::collect_block(const signed_block_ptr& block) const {
+   get_block_collected result;
+   result.block = block;
+   result.abi_serializer_max_time = abi_serializer_max_time;
+   const auto yield = abi_serializer::create_yield_function( abi_serializer_max_time );
+   auto add_abis = [&]( const vector<action>& actions ) {
+      for( const auto& a : actions ) {
+         if( result.abis.count( a.account ) ) continue;
+         result.abis.emplace( a.account, get_abi_serializer( db, abi_cache, a.account, yield ) );
+      }
+   };
+   for( const auto& receipt : block->transactions ) {
+      if( receipt.trx.contains<packed_transaction>() ) {
+         const auto& trx = receipt.trx.get<packed_transaction>().get_transaction();
+         add_abis( trx.context_free_actions );
+         add_abis( trx.actions );
+      }
+   }
+   return result;
+}
+
+namespace {
+   /// the action data the compiled decoders decode added to splicer as JSON if it is set
+   fc::variant format_block( const read_only::get_block_collected& collected, json_splicer* splicer ) {
+      auto resolver = [&collected, splicer]( const account_name& account ) -> abi_serializer_cache::resolved {
+         auto itr = collected.abis.find( account );
+         return abi_serializer_cache::resolved{ itr != collected.abis.end() ? itr->second : abi_serializer_cache::entry_ptr(), splicer };
+      };
+      const auto& block = collected.block;
+      fc::variant pretty_output;
+      abi_serializer::to_variant(*block, pretty_output, resolver, abi_serializer::create_yield_function( collected.abi_serializer_max_time ));
+
+      uint32_t ref_block_prefix = block->id()._hash[1];
+
+      return fc::mutable_variant_object(pretty_output.get_object())
+              ("id", block->id())
+              ("block_num",block->block_num())
+              ("ref_block_prefix", ref_block_prefix);
+   }
+}
+
+fc::variant read_only::get_block_collected::format() const {
+   return format_block( *this, nullptr );
+}
+
+std::string read_only::get_block_collected::to_json( const fc::time_point& deadline ) const {
+   json_splicer splicer;
+   return splicer.to_string( format_block( *this, &splicer ), deadline );
 }
 
 fc::variant read_only::get_block_header_state(const get_block_header_state_params& params) const {
@@ -2177,7 +2899,72 @@ void read_write::push_block(read_write::push_block_params&& params, next_functio
    } CATCH_AND_CALL(next);
 }
 
+fc::variant read_write::format_push_trace(const transaction_trace_ptr& trx_trace_ptr) const {
+   fc::variant output;
+   try {
+      output = db.to_variant_with_abi( *trx_trace_ptr, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+
+      // Create map of (closest_unnotified_ancestor_action_ordinal, global_sequence) with action trace
+      std::map< std::pair<uint32_t, uint64_t>, fc::mutable_variant_object > act_traces_map;
+      for( const auto& act_trace : output["action_traces"].get_array() ) {
+         if (act_trace["receipt"].is_null() && act_trace["except"].is_null()) continue;
+         auto closest_unnotified_ancestor_action_ordinal =
+               act_trace["closest_unnotified_ancestor_action_ordinal"].as<fc::unsigned_int>().value;
+         auto global_sequence = act_trace["receipt"].is_null() ?
+                                    std::numeric_limits<uint64_t>::max() :
+                                    act_trace["receipt"]["global_sequence"].as<uint64_t>();
+         act_traces_map.emplace( std::make_pair( closest_unnotified_ancestor_action_ordinal,
+                                                 global_sequence ),
+                                 act_trace.get_object() );
+      }
+
+      std::function<vector<fc::variant>(uint32_t)> convert_act_trace_to_tree_struct =
+      [&](uint32_t closest_unnotified_ancestor_action_ordinal) {
+         vector<fc::variant> restructured_act_traces;
+         auto it = act_traces_map.lower_bound(
+                     std::make_pair( closest_unnotified_ancestor_action_ordinal, 0)
+         );
+         for( ;
+            it != act_traces_map.end() && it->first.first == closest_unnotified_ancestor_action_ordinal; ++it )
+         {
+            auto& act_trace_mvo = it->second;
+
+            auto action_ordinal = act_trace_mvo["action_ordinal"].as<fc::unsigned_int>().value;
+            act_trace_mvo["inline_traces"] = convert_act_trace_to_tree_struct(action_ordinal);
+            if (act_trace_mvo["receipt"].is_null()) {
+               act_trace_mvo["receipt"] = fc::mutable_variant_object()
+                  ("abi_sequence", 0)
+                  ("act_digest", digest_type::hash(trx_trace_ptr->action_traces[action_ordinal-1].act))
+                  ("auth_sequence", flat_map<account_name,uint64_t>())
+                  ("code_sequence", 0)
+                  ("global_sequence", 0)
+                  ("receiver", act_trace_mvo["receiver"])
+                  ("recv_sequence", 0);
+            }
+            restructured_act_traces.push_back( std::move(act_trace_mvo) );
+         }
+         return restructured_act_traces;
+      };
+
+      fc::mutable_variant_object output_mvo(output);
+      output_mvo["action_traces"] = convert_act_trace_to_tree_struct(0);
+
+      output = output_mvo;
+   } catch( chain::abi_exception& ) {
+      output = *trx_trace_ptr;
+   }
+   return output;
+}
+
 void read_write::push_transaction(const read_write::push_transaction_params& params, next_function<read_write::push_transaction_results> next) {
+   push_transaction( params, false, std::move( next ) );
+}
+
+void read_write::compute_transaction(const read_write::compute_transaction_params& params, next_function<read_write::compute_transaction_results> next) {
+   push_transaction( params, true, std::move( next ) );
+}
+
+void read_write::push_transaction(const read_write::push_transaction_params& params, bool dry_run, next_function<read_write::push_transaction_results> next) {
    try {
       auto pretty_input = std::make_shared<packed_transaction>();
       auto resolver = make_resolver(this, abi_serializer::create_yield_function( abi_serializer_max_time ));
@@ -2185,73 +2972,23 @@ void read_write::push_transaction(const read_write::push_transaction_params& par
          abi_serializer::from_variant(params, *pretty_input, std::move( resolver ), abi_serializer::create_yield_function( abi_serializer_max_time ));
       } EOS_RETHROW_EXCEPTIONS(chain::packed_transaction_type_exception, "Invalid packed transaction")
 
-      app().get_method<incoming::methods::transaction_async>()(pretty_input, true,
-            [this, next](const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result) -> void {
+      auto on_result = [this, next](const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result) -> void {
          if (result.contains<fc::exception_ptr>()) {
             next(result.get<fc::exception_ptr>());
          } else {
             auto trx_trace_ptr = result.get<transaction_trace_ptr>();
 
             try {
-               fc::variant output;
-               try {
-                  output = db.to_variant_with_abi( *trx_trace_ptr, abi_serializer::create_yield_function( abi_serializer_max_time ) );
-
-                  // Create map of (closest_unnotified_ancestor_action_ordinal, global_sequence) with action trace
-                  std::map< std::pair<uint32_t, uint64_t>, fc::mutable_variant_object > act_traces_map;
-                  for( const auto& act_trace : output["action_traces"].get_array() ) {
-                     if (act_trace["receipt"].is_null() && act_trace["except"].is_null()) continue;
-                     auto closest_unnotified_ancestor_action_ordinal =
-                           act_trace["closest_unnotified_ancestor_action_ordinal"].as<fc::unsigned_int>().value;
-                     auto global_sequence = act_trace["receipt"].is_null() ?
-                                                std::numeric_limits<uint64_t>::max() :
-                                                act_trace["receipt"]["global_sequence"].as<uint64_t>();
-                     act_traces_map.emplace( std::make_pair( closest_unnotified_ancestor_action_ordinal,
-                                                             global_sequence ),
-                                             act_trace.get_object() );
-                  }
-
-                  std::function<vector<fc::variant>(uint32_t)> convert_act_trace_to_tree_struct =
-                  [&](uint32_t closest_unnotified_ancestor_action_ordinal) {
-                     vector<fc::variant> restructured_act_traces;
-                     auto it = act_traces_map.lower_bound(
-                                 std::make_pair( closest_unnotified_ancestor_action_ordinal, 0)
-                     );
-                     for( ;
-                        it != act_traces_map.end() && it->first.first == closest_unnotified_ancestor_action_ordinal; ++it )
-                     {
-                        auto& act_trace_mvo = it->second;
-
-                        auto action_ordinal = act_trace_mvo["action_ordinal"].as<fc::unsigned_int>().value;
-                        act_trace_mvo["inline_traces"] = convert_act_trace_to_tree_struct(action_ordinal);
-                        if (act_trace_mvo["receipt"].is_null()) {
-                           act_trace_mvo["receipt"] = fc::mutable_variant_object()
-                              ("abi_sequence", 0)
-                              ("act_digest", digest_type::hash(trx_trace_ptr->action_traces[action_ordinal-1].act))
-                              ("auth_sequence", flat_map<account_name,uint64_t>())
-                              ("code_sequence", 0)
-                              ("global_sequence", 0)
-                              ("receiver", act_trace_mvo["receiver"])
-                              ("recv_sequence", 0);
-                        }
-                        restructured_act_traces.push_back( std::move(act_trace_mvo) );
-                     }
-                     return restructured_act_traces;
-                  };
-
-                  fc::mutable_variant_object output_mvo(output);
-                  output_mvo["action_traces"] = convert_act_trace_to_tree_struct(0);
-
-                  output = output_mvo;
-               } catch( chain::abi_exception& ) {
-                  output = *trx_trace_ptr;
-               }
-
-               const chain::transaction_id_type& id = trx_trace_ptr->id;
-               next(read_write::push_transaction_results{id, output});
+               next(read_write::push_transaction_results{trx_trace_ptr->id, format_push_trace(trx_trace_ptr)});
             } CATCH_AND_CALL(next);
          }
-      });
+      };
+
+      if( dry_run ) {
+         app().get_method<incoming::methods::transaction_dry_run_async>()(pretty_input, std::move( on_result ));
+      } else {
+         app().get_method<incoming::methods::transaction_async>()(pretty_input, true, std::move( on_result ));
+      }
    } catch ( boost::interprocess::bad_alloc& ) {
       chain_plugin::handle_db_exhaustion();
    } catch ( const std::bad_alloc& ) {
@@ -2259,35 +2996,60 @@ void read_write::push_transaction(const read_write::push_transaction_params& par
    } CATCH_AND_CALL(next);
 }
 
-static void push_recurse(read_write* rw, int index, const std::shared_ptr<read_write::push_transactions_params>& params, const std::shared_ptr<read_write::push_transactions_results>& results, const next_function<read_write::push_transactions_results>& next) {
-   auto wrapped_next = [=](const fc::static_variant<fc::exception_ptr, read_write::push_transaction_results>& result) {
-      if (result.contains<fc::exception_ptr>()) {
-         const auto& e = result.get<fc::exception_ptr>();
-         results->emplace_back( read_write::push_transaction_results{ transaction_id_type(), fc::mutable_variant_object( "error", e->to_detail_string() ) } );
-      } else {
-         const auto& r = result.get<read_write::push_transaction_results>();
-         results->emplace_back( r );
-      }
-
-      size_t next_index = index + 1;
-      if (next_index < params->size()) {
-         push_recurse(rw, next_index, params, results, next );
-      } else {
-         next(*results);
-      }
-   };
-
-   rw->push_transaction(params->at(index), wrapped_next);
-}
-
 void read_write::push_transactions(const read_write::push_transactions_params& params, next_function<read_write::push_transactions_results> next) {
    try {
       EOS_ASSERT( params.size() <= 1000, too_many_tx_at_once, "Attempt to push too many transactions at once" );
-      auto params_copy = std::make_shared<read_write::push_transactions_params>(params.begin(), params.end());
-      auto result = std::make_shared<read_write::push_transactions_results>();
-      result->reserve(params.size());
+      auto results = std::make_shared<read_write::push_transactions_results>( params.size() );
+      auto error_result = []( const fc::exception& e ) {
+         return read_write::push_transaction_results{ transaction_id_type(), fc::mutable_variant_object( "error", e.to_detail_string() ) };
+      };
 
-      push_recurse(this, 0, params_copy, result, next);
+      // only the ABI conversion is on the main thread, the batch has its keys recovered in parallel and is then
+      // applied in order
+      std::vector<packed_transaction_ptr> trxs;
+      std::vector<size_t> indexes; ///< index in params of each of trxs
+      trxs.reserve( params.size() );
+      indexes.reserve( params.size() );
+      auto resolver = make_resolver(this, abi_serializer::create_yield_function( abi_serializer_max_time ));
+      for( size_t i = 0; i < params.size(); ++i ) {
+         try {
+            auto pretty_input = std::make_shared<packed_transaction>();
+            try {
+               abi_serializer::from_variant(params[i], *pretty_input, resolver, abi_serializer::create_yield_function( abi_serializer_max_time ));
+            } EOS_RETHROW_EXCEPTIONS(chain::packed_transaction_type_exception, "Invalid packed transaction")
+            trxs.emplace_back( std::move( pretty_input ) );
+            indexes.push_back( i );
+         } catch( const fc::exception& e ) {
+            (*results)[i] = error_result( e );
+         }
+      }
+
+      if( trxs.empty() ) {
+         next( *results );
+         return;
+      }
+
+      // results are delivered on the main thread
+      auto remaining = std::make_shared<size_t>( trxs.size() );
+      app().get_method<incoming::methods::transaction_batch_async>()( trxs, true,
+            [this, results, remaining, indexes, error_result, next]( size_t i, const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result ) {
+         auto& r = (*results)[indexes[i]];
+         if( result.contains<fc::exception_ptr>() ) {
+            r = error_result( *result.get<fc::exception_ptr>() );
+         } else {
+            const auto& trx_trace_ptr = result.get<transaction_trace_ptr>();
+            try {
+               r = read_write::push_transaction_results{ trx_trace_ptr->id, format_push_trace( trx_trace_ptr ) };
+            } catch( const fc::exception& e ) {
+               r = error_result( e );
+            } catch( const std::exception& e ) {
+               r = error_result( fc::exception( FC_LOG_MESSAGE( error, e.what() ) ) );
+            }
+         }
+         if( --*remaining == 0 ) {
+            next( *results );
+         }
+      } );
    } catch ( boost::interprocess::bad_alloc& ) {
       chain_plugin::handle_db_exhaustion();
    } catch ( const std::bad_alloc& ) {
@@ -2331,6 +3093,16 @@ void read_write::send_transaction(const read_write::send_transaction_params& par
    } CATCH_AND_CALL(next);
 }
 
+void read_write::send_packed_transaction(const packed_transaction_ptr& trx, next_function<transaction_trace_ptr> next) {
+   try {
+      app().get_method<incoming::methods::transaction_async>()(trx, true, std::move( next ));
+   } catch ( boost::interprocess::bad_alloc& ) {
+      chain_plugin::handle_db_exhaustion();
+   } catch ( const std::bad_alloc& ) {
+      chain_plugin::handle_bad_alloc();
+   } CATCH_AND_CALL(next);
+}
+
 read_only::get_abi_results read_only::get_abi( const get_abi_params& params )const {
    get_abi_results result;
    result.account_name = params.account_name;
@@ -2412,10 +3184,59 @@ read_only::get_raw_abi_results read_only::get_raw_abi( const get_raw_abi_params&
    return result;
 }
 
+read_only::get_abi_cache_stats_results read_only::get_abi_cache_stats( const get_abi_cache_stats_params& )const {
+   if( abi_cache ) return abi_cache->get_stats();
+   return {};
+}
+
+read_only::get_wasm_cache_stats_results read_only::get_wasm_cache_stats( const get_wasm_cache_stats_params& )const {
+   return db.get_wasm_interface().get_cache_stats();
+}
+
 read_only::get_account_results read_only::get_account( const get_account_params& params )const {
    get_account_results result;
    result.account_name = params.account_name;
+   fill_account( result, make_account_lookup( params.expected_core_symbol ) );
+   return result;
+}
+
+read_only::get_accounts_results read_only::get_accounts( const get_accounts_params& params )const {
+   EOS_ASSERT( params.account_names.size() <= max_batched_accounts, chain::contract_table_query_exception,
+               "At most ${max} accounts may be requested at once", ("max", max_batched_accounts) );
+
+   // in name order the rows of the accounts are next to each other in each index
+   auto account_names = params.account_names;
+   std::sort( account_names.begin(), account_names.end() );
+   account_names.erase( std::unique( account_names.begin(), account_names.end() ), account_names.end() );
+
+   const auto lookup = make_account_lookup( params.expected_core_symbol );
+   get_accounts_results results;
+   results.accounts.reserve( account_names.size() );
+   for( const auto& n : account_names ) {
+      if( !db.db().find<account_object,by_name>( n ) ) {
+         results.missing.push_back( n );
+         continue;
+      }
+      results.accounts.emplace_back();
+      results.accounts.back().account_name = n;
+      fill_account( results.accounts.back(), lookup );
+   }
+   return results;
+}
 
+read_only::account_lookup read_only::make_account_lookup( const optional<symbol>& expected_core_symbol )const {
+   const auto& d = db.db();
+   account_lookup lookup;
+   lookup.abi = get_abi_serializer( db, abi_cache, config::system_account_name, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+   if( !lookup.abi ) return lookup;
+
+   lookup.core_symbol = expected_core_symbol.valid() ? *expected_core_symbol : extract_core_symbol();
+   lookup.voters = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, config::system_account_name, N(voters) ));
+   lookup.rexbal = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, config::system_account_name, N(rexbal) ));
+   return lookup;
+}
+
+void read_only::fill_account( get_account_results& result, const account_lookup& lookup )const {
    const auto& d = db.db();
    const auto& rm = db.get_resource_limits_manager();
 
@@ -2437,8 +3258,8 @@ read_only::get_account_results read_only::get_account( const get_account_params&
    result.ram_usage = rm.get_account_ram_usage( result.account_name );
 
    const auto& permissions = d.get_index<permission_index,by_owner>();
-   auto perm = permissions.lower_bound( boost::make_tuple( params.account_name ) );
-   while( perm != permissions.end() && perm->owner == params.account_name ) {
+   auto perm = permissions.lower_bound( boost::make_tuple( result.account_name ) );
+   while( perm != permissions.end() && perm->owner == result.account_name ) {
       /// TODO: lookup perm->parent name
       name parent;
 
@@ -2455,20 +3276,13 @@ read_only::get_account_results read_only::get_account( const get_account_params&
       ++perm;
    }
 
-   const auto& code_account = db.db().get<account_object,by_name>( config::system_account_name );
-
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+   if( lookup.abi ) {
+      const abi_serializer& abis = lookup.abi->serializer;
 
       const auto token_code = N(eosio.token);
+      const auto& core_symbol = lookup.core_symbol;
 
-      auto core_symbol = extract_core_symbol();
-
-      if (params.expected_core_symbol.valid())
-         core_symbol = *(params.expected_core_symbol);
-
-      const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( token_code, params.account_name, N(accounts) ));
+      const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( token_code, result.account_name, N(accounts) ));
       if( t_id != nullptr ) {
          const auto &idx = d.get_index<key_value_index, by_scope_primary>();
          auto it = idx.find(boost::make_tuple( t_id->id, core_symbol.to_symbol_code() ));
@@ -2483,10 +3297,10 @@ read_only::get_account_results read_only::get_account( const get_account_params&
          }
       }
 
-      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, params.account_name, N(userres) ));
+      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, result.account_name, N(userres) ));
       if (t_id != nullptr) {
          const auto &idx = d.get_index<key_value_index, by_scope_primary>();
-         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name.to_uint64_t() ));
+         auto it = idx.find(boost::make_tuple( t_id->id, result.account_name.to_uint64_t() ));
          if ( it != idx.end() ) {
             vector<char> data;
             copy_inline_row(*it, data);
@@ -2494,10 +3308,10 @@ read_only::get_account_results read_only::get_account( const get_account_params&
          }
       }
 
-      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, params.account_name, N(delband) ));
+      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, result.account_name, N(delband) ));
       if (t_id != nullptr) {
          const auto &idx = d.get_index<key_value_index, by_scope_primary>();
-         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name.to_uint64_t() ));
+         auto it = idx.find(boost::make_tuple( t_id->id, result.account_name.to_uint64_t() ));
          if ( it != idx.end() ) {
             vector<char> data;
             copy_inline_row(*it, data);
@@ -2505,10 +3319,10 @@ read_only::get_account_results read_only::get_account( const get_account_params&
          }
       }
 
-      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, params.account_name, N(refunds) ));
+      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, result.account_name, N(refunds) ));
       if (t_id != nullptr) {
          const auto &idx = d.get_index<key_value_index, by_scope_primary>();
-         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name.to_uint64_t() ));
+         auto it = idx.find(boost::make_tuple( t_id->id, result.account_name.to_uint64_t() ));
          if ( it != idx.end() ) {
             vector<char> data;
             copy_inline_row(*it, data);
@@ -2516,10 +3330,10 @@ read_only::get_account_results read_only::get_account( const get_account_params&
          }
       }
 
-      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, config::system_account_name, N(voters) ));
+      t_id = lookup.voters;
       if (t_id != nullptr) {
          const auto &idx = d.get_index<key_value_index, by_scope_primary>();
-         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name.to_uint64_t() ));
+         auto it = idx.find(boost::make_tuple( t_id->id, result.account_name.to_uint64_t() ));
          if ( it != idx.end() ) {
             vector<char> data;
             copy_inline_row(*it, data);
@@ -2527,10 +3341,10 @@ read_only::get_account_results read_only::get_account( const get_account_params&
          }
       }
 
-      t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple( config::system_account_name, config::system_account_name, N(rexbal) ));
+      t_id = lookup.rexbal;
       if (t_id != nullptr) {
          const auto &idx = d.get_index<key_value_index, by_scope_primary>();
-         auto it = idx.find(boost::make_tuple( t_id->id, params.account_name.to_uint64_t() ));
+         auto it = idx.find(boost::make_tuple( t_id->id, result.account_name.to_uint64_t() ));
          if( it != idx.end() ) {
             vector<char> data;
             copy_inline_row(*it, data);
@@ -2538,7 +3352,6 @@ read_only::get_account_results read_only::get_account( const get_account_params&
          }
       }
    }
-   return result;
 }
 
 static variant action_abi_to_variant( const abi_def& abi, type_name action_type ) {
@@ -2554,9 +3367,10 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
    const auto code_account = db.db().find<account_object,by_name>( params.code );
    EOS_ASSERT(code_account != nullptr, contract_query_exception, "Contract can't be found ${contract}", ("contract", params.code));
 
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account->abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+   const auto abi_entry = get_abi_serializer( db, abi_cache, params.code, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+   if( abi_entry ) {
+      const abi_def& abi = abi_entry->abi;
+      const abi_serializer& abis = abi_entry->serializer;
       auto action_type = abis.get_action_type(params.action);
       EOS_ASSERT(!action_type.empty(), action_validate_exception, "Unknown action ${action} in contract ${contract}", ("action", params.action)("contract", params.code));
       try {
@@ -2571,13 +3385,42 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
 } FC_RETHROW_EXCEPTIONS( warn, "code: ${code}, action: ${action}, args: ${args}",
                          ("code", params.code)( "action", params.action )( "args", params.args ))
 
+read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const string& body )const {
+   std::vector<std::pair<std::string_view, std::string_view>> members;
+   if( abi_compiled_decoder::split_json_object( body, members ) ) {
+      std::string_view code, action, args;
+      for( const auto& m : members ) {
+         if( m.first == "code" ) code = m.second;
+         else if( m.first == "action" ) action = m.second;
+         else if( m.first == "args" ) args = m.second;
+      }
+      auto is_string = []( const std::string_view& v ) { return v.size() >= 2 && v.front() == '"'; };
+      if( is_string( code ) && is_string( action ) && !args.empty() ) {
+         try {
+            const name code_name( code.substr( 1, code.size() - 2 ) );
+            const name action_name( action.substr( 1, action.size() - 2 ) );
+            const auto yield = abi_serializer::create_yield_function( abi_serializer_max_time );
+            const auto abi_entry = get_abi_serializer( db, abi_cache, code_name, yield );
+            if( abi_entry && abi_entry->compiled ) {
+               const auto action_type = abi_entry->serializer.get_action_type( action_name );
+               if( !action_type.empty() ) {
+                  return abi_json_to_bin_result{ abi_entry->compiled->from_json( action_type, args, yield ) };
+               }
+            }
+         } catch( const fc::exception& ) {
+            // the variant path reports the error, if there is one
+         }
+      }
+   }
+   return abi_json_to_bin( fc::json::from_string( body ).as<abi_json_to_bin_params>() );
+}
+
 read_only::abi_bin_to_json_result read_only::abi_bin_to_json( const read_only::abi_bin_to_json_params& params )const {
    abi_bin_to_json_result result;
-   const auto& code_account = db.db().get<account_object,by_name>( params.code );
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer::create_yield_function( abi_serializer_max_time ) );
-      result.args = abis.binary_to_variant( abis.get_action_type( params.action ), params.binargs, abi_serializer::create_yield_function( abi_serializer_max_time ), shorten_abi_errors );
+   db.db().get<account_object,by_name>( params.code );
+   const auto abi_entry = get_abi_serializer( db, abi_cache, params.code, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+   if( abi_entry ) {
+      result.args = abi_entry->binary_to_variant( abi_entry->serializer.get_action_type( params.action ), params.binargs, abi_serializer::create_yield_function( abi_serializer_max_time ), shorten_abi_errors );
    } else {
       EOS_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
    }
@@ -2585,15 +3428,114 @@ read_only::abi_bin_to_json_result read_only::abi_bin_to_json( const read_only::a
 }
 
 read_only::get_required_keys_result read_only::get_required_keys( const get_required_keys_params& params )const {
+   return collect_required_keys( params ).compute();
+}
+
+namespace {
+   const permission_object* find_permission( const controller& db, const permission_level& level ) {
+      try {
+         return db.get_authorization_manager().find_permission( level );
+      } catch( const permission_query_exception& ) {
+         // an invalid level, which the checker skips as it does one that does not exist
+         return nullptr;
+      }
+   }
+
+   std::shared_ptr<const authority> find_authority( const controller& db, const permission_level& level ) {
+      const auto* po = find_permission( db, level );
+      return po ? std::make_shared<const authority>( po->auth.to_authority() ) : std::shared_ptr<const authority>();
+   }
+}
+
+std::shared_ptr<const authority> read_only::permission_tree_cache::get( const controller& db, const permission_level& level ) {
+   const auto& authorization = db.get_authorization_manager();
+   if( authorization.revision() != revision ) {
+      entries.clear();
+      revision = authorization.revision();
+   }
+   auto itr = entries.find( level );
+   if( itr != entries.end() ) return itr->second;
+
+   const auto* po = find_permission( db, level );
+   if( !po ) return {};
+   auto auth = std::make_shared<const authority>( po->auth.to_authority() );
+   if( po->last_updated <= db.last_irreversible_block_time() ) {
+      if( entries.size() >= max_entries ) entries.clear();
+      entries.emplace( level, auth );
+   }
+   return auth;
+}
+
+read_only::get_required_keys_collected
+read_only::collect_required_keys( get_required_keys_params params, permission_tree_cache* cache )const {
+   get_required_keys_collected result;
+   result.max_authority_depth = db.get_global_properties().configuration.max_authority_depth;
+   result.abi_serializer_max_time = abi_serializer_max_time;
+
+   // only the accounts and authorizations of the actions are read here, the transaction is converted by compute(),
+   // which reports it as invalid when these cannot be read either
+   vector<action> actions;
+   try {
+      const auto& trx = params.transaction.get_object();
+      for( const char* field : { "context_free_actions", "actions" } ) {
+         auto itr = trx.find( field );
+         if( itr == trx.end() ) continue;
+         for( const auto& a : itr->value().get_array() ) {
+            const auto& act = a.get_object();
+            action converted;
+            converted.account = act["account"].as<account_name>();
+            if( auto auth = act.find( "authorization" ); auth != act.end() ) {
+               converted.authorization = auth->value().as<vector<permission_level>>();
+            }
+            actions.emplace_back( std::move( converted ) );
+         }
+      }
+   } catch( const fc::exception& ) {
+   }
+
+   const auto yield = abi_serializer::create_yield_function( abi_serializer_max_time );
+   // the permissions in reach of the checker, nearest first so each is visited at the least depth it is reached at
+   std::deque<std::pair<permission_level, uint16_t>> pending;
+   for( const auto& a : actions ) {
+      if( !result.abis.count( a.account ) ) {
+         result.abis.emplace( a.account, get_abi_serializer( db, abi_cache, a.account, yield ) );
+      }
+      for( const auto& level : a.authorization ) pending.emplace_back( level, 0 );
+   }
+   std::set<permission_level> visited;
+   while( !pending.empty() ) {
+      auto [level, depth] = pending.front();
+      pending.pop_front();
+      if( depth >= result.max_authority_depth || !visited.insert( level ).second ) continue;
+      auto auth = cache ? cache->get( db, level ) : find_authority( db, level );
+      if( !auth ) continue;
+      for( const auto& p : auth->accounts ) pending.emplace_back( p.permission, depth + 1 );
+      result.authorities.emplace( level, std::move( auth ) );
+   }
+
+   result.params = std::move( params );
+   return result;
+}
+
+read_only::get_required_keys_result read_only::get_required_keys_collected::compute()const {
+   auto resolver = [this]( const account_name& account ) -> abi_serializer_cache::resolved {
+      auto itr = abis.find( account );
+      return abi_serializer_cache::resolved{ itr != abis.end() ? itr->second : abi_serializer_cache::entry_ptr() };
+   };
    transaction pretty_input;
-   auto resolver = make_resolver(this, abi_serializer::create_yield_function( abi_serializer_max_time ));
    try {
       abi_serializer::from_variant(params.transaction, pretty_input, resolver, abi_serializer::create_yield_function( abi_serializer_max_time ));
    } EOS_RETHROW_EXCEPTIONS(chain::transaction_type_exception, "Invalid transaction")
 
-   auto required_keys_set = db.get_authorization_manager().get_required_keys( pretty_input, params.available_keys, fc::seconds( pretty_input.delay_sec ));
    get_required_keys_result result;
-   result.required_keys = required_keys_set;
+   result.required_keys = authorization_manager::get_required_keys( pretty_input, params.available_keys,
+         fc::seconds( pretty_input.delay_sec ),
+         [this]( const permission_level& level ) -> const authority& {
+            auto itr = authorities.find( level );
+            EOS_ASSERT( itr != authorities.end(), permission_query_exception, "Failed to retrieve permission: ${level}", ("level", level) );
+            return *itr->second;
+         },
+         max_authority_depth );
    return result;
 }
 
@@ -0,0 +1,142 @@
+#pragma once
+#include <eosio/chain/abi_compiled_decoder.hpp>
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/trace.hpp>
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace eosio { namespace chain {
+   class controller;
+} }
+
+namespace eosio::chain_apis {
+   /**
+    * JSON text rendered ahead of the variant it is part of, which holds a placeholder string in its place until
+    * to_string serializes the variant. The placeholders carry a random tag, so strings of the variant itself are not
+    * mistaken for them. Not thread safe.
+    */
+   class json_splicer {
+   public:
+      json_splicer();
+
+      /// @return the placeholder of json
+      fc::variant add( std::string json );
+
+      /// fc::json::to_string of v, with the placeholders of this splicer replaced by their JSON
+      std::string to_string( const fc::variant& v, const fc::time_point& deadline )const;
+
+   private:
+      std::string               tag;   ///< quote and prefix of the placeholders, followed by the index of their JSON
+      std::vector<std::string>  parts;
+   };
+
+   /**
+    * LRU cache of ready to use abi_serializer instances for the RPC calls of chain_plugin and history_plugin.
+    *
+    * Entries are keyed by account and validated against the account's current abi_sequence on every lookup, so a
+    * new setabi or a state revert that changes the sequence results in a rebuild. Traces of applied setabi actions
+    * additionally evict the account, which covers a fork switch that reaches the same abi_sequence with another ABI.
+    *
+    * Lookups read the chain state and so must be done from the main thread. Returned entries are immutable and may be
+    * used from any thread for as long as they are held.
+    */
+   class abi_serializer_cache {
+   public:
+      struct entry {
+         entry( chain::abi_def a, const chain::abi_serializer::yield_function_t& yield )
+         : abi( std::move(a) )
+         , serializer( abi, yield )
+         {
+            try {
+               compiled.emplace( serializer );
+            } catch( const fc::exception& ) {
+               // the serializer is then used alone
+            }
+         }
+
+         /// abi_serializer::binary_to_variant, by the compiled decoder when it has the type
+         fc::variant binary_to_variant( const std::string_view& type, const chain::bytes& binary,
+                                        const chain::abi_serializer::yield_function_t& yield, bool short_path )const;
+
+         chain::abi_def                              abi;
+         chain::abi_serializer                       serializer;
+         /// decodes table rows and action data, and encodes abi_json_to_bin args without a variant
+         std::optional<chain::abi_compiled_decoder>  compiled;
+      };
+      using entry_ptr = std::shared_ptr<const entry>;
+
+      /**
+       * Result of a resolver lookup, usable wherever abi_serializer::to_variant and from_variant expect an
+       * optional<abi_serializer>
+       */
+      struct resolved {
+         entry_ptr     e;
+         json_splicer* json = nullptr; ///< takes the JSON of the action data the compiled decoder decodes, if set
+
+         bool valid()const { return static_cast<bool>(e); }
+         /// used by abi_serializer::to_variant to decode action data
+         const chain::abi_compiled_decoder* compiled()const { return e->compiled ? &*e->compiled : nullptr; }
+         json_splicer* splicer()const { return json; }
+         const chain::abi_serializer* operator->()const { return &e->serializer; }
+         const chain::abi_serializer& operator*()const { return e->serializer; }
+      };
+
+      struct stats {
+         uint64_t hits = 0;
+         uint64_t misses = 0;
+         uint64_t entries = 0;
+         uint64_t max_entries = 0;
+      };
+
+      /**
+       * @param max_entries - number of serializers to retain, 0 disables caching
+       */
+      explicit abi_serializer_cache( size_t max_entries );
+
+      /**
+       * @param db - controller to read the account ABI from
+       * @param account - account of the ABI
+       * @param yield - yield function used when a new abi_serializer has to be built
+       * @return serializer for the current ABI of account or nullptr if the account does not exist or has no ABI
+       */
+      entry_ptr get( const chain::controller& db, const chain::name& account, const chain::abi_serializer::yield_function_t& yield );
+
+      /**
+       * @return resolver for abi_serializer::to_variant and from_variant backed by this cache, the controller and
+       *         the cache must outlive the resolver
+       */
+      auto make_resolver( const chain::controller& db, chain::abi_serializer::yield_function_t yield ) {
+         return [this, &db, yield{std::move(yield)}]( const chain::name& account ) -> resolved {
+            return resolved{ get( db, account, yield ) };
+         };
+      }
+
+      /// drop the cached serializer of an account
+      void invalidate( const chain::name& account );
+
+      /// evict all accounts that have their ABI set by a setabi action in trace
+      void invalidate( const chain::transaction_trace_ptr& trace );
+
+      stats get_stats()const;
+
+   private:
+      struct node {
+         chain::name  account;
+         uint64_t     abi_sequence = 0;
+         entry_ptr    e;
+      };
+      using lru_list = std::list<node>;
+
+      const size_t                                              max_entries;
+      mutable std::mutex                                        mtx;
+      lru_list                                                  lru; ///< most recently used first
+      std::unordered_map<chain::name, lru_list::iterator>       by_account;
+      uint64_t                                                  hits = 0;
+      uint64_t                                                  misses = 0;
+   };
+}
+
+FC_REFLECT( eosio::chain_apis::abi_serializer_cache::stats, (hits)(misses)(entries)(max_entries) )
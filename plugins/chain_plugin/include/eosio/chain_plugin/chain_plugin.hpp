@@ -17,9 +17,13 @@
 #include <boost/multiprecision/cpp_int.hpp>
 
 #include <eosio/chain_plugin/account_query_db.hpp>
+#include <eosio/chain_plugin/abi_serializer_cache.hpp>
 
 #include <fc/static_variant.hpp>
 
+#include <map>
+#include <mutex>
+
 namespace fc { class variant; }
 
 namespace eosio {
@@ -82,13 +86,15 @@ class read_only {
    const controller& db;
    const fc::optional<account_query_db>& aqdb;
    const fc::microseconds abi_serializer_max_time;
+   abi_serializer_cache* abi_cache = nullptr;
    bool  shorten_abi_errors = true;
 
 public:
    static const string KEYi64;
 
-   read_only(const controller& db, const fc::optional<account_query_db>& aqdb, const fc::microseconds& abi_serializer_max_time)
-      : db(db), aqdb(aqdb), abi_serializer_max_time(abi_serializer_max_time) {}
+   read_only(const controller& db, const fc::optional<account_query_db>& aqdb, const fc::microseconds& abi_serializer_max_time,
+             abi_serializer_cache* abi_cache = nullptr)
+      : db(db), aqdb(aqdb), abi_serializer_max_time(abi_serializer_max_time), abi_cache(abi_cache) {}
 
    void validate() const {}
 
@@ -175,6 +181,22 @@ public:
    };
    get_account_results get_account( const get_account_params& params )const;
 
+   /// of an account list of get_accounts and get_currency_balances
+   static constexpr uint32_t max_batched_accounts = 1000;
+
+   struct get_accounts_params {
+      vector<name>     account_names;
+      optional<symbol> expected_core_symbol;
+   };
+
+   struct get_accounts_results {
+      vector<get_account_results> accounts; ///< in account name order, once each
+      vector<name>                missing;  ///< of account_names, those that do not exist
+   };
+
+   /// get_account of up to max_batched_accounts accounts, looking up the system ABI and tables once for all of them
+   get_accounts_results get_accounts( const get_accounts_params& params )const;
+
 
    struct get_code_results {
       name                   account_name;
@@ -236,6 +258,14 @@ public:
    get_raw_code_and_abi_results get_raw_code_and_abi( const get_raw_code_and_abi_params& params)const;
    get_raw_abi_results get_raw_abi( const get_raw_abi_params& params)const;
 
+   using get_abi_cache_stats_params = empty;
+   using get_abi_cache_stats_results = abi_serializer_cache::stats;
+   get_abi_cache_stats_results get_abi_cache_stats( const get_abi_cache_stats_params& params )const;
+
+   using get_wasm_cache_stats_params = empty;
+   using get_wasm_cache_stats_results = chain::wasm_interface::cache_stats;
+   get_wasm_cache_stats_results get_wasm_cache_stats( const get_wasm_cache_stats_params& params )const;
+
 
 
    struct abi_json_to_bin_params {
@@ -248,6 +278,8 @@ public:
    };
 
    abi_json_to_bin_result abi_json_to_bin( const abi_json_to_bin_params& params )const;
+   /// from the JSON text of abi_json_to_bin_params, args are encoded without building a variant when they are plain JSON
+   abi_json_to_bin_result abi_json_to_bin( const string& body )const;
 
 
    struct abi_bin_to_json_params {
@@ -272,6 +304,42 @@ public:
 
    get_required_keys_result get_required_keys( const get_required_keys_params& params)const;
 
+   /**
+    * The authorities of permissions for get_required_keys, kept while authorization_manager::revision() is
+    * unchanged. Only permissions last updated in irreversible blocks are kept, as an undo restores a permission
+    * without a change of revision. Only the main thread may use it.
+    */
+   class permission_tree_cache {
+   public:
+      explicit permission_tree_cache( size_t max_entries ) : max_entries( max_entries ) {}
+
+      /// the authority of level, nullptr if there is no such permission
+      std::shared_ptr<const authority> get( const controller& db, const permission_level& level );
+
+   private:
+      const size_t                                                    max_entries;
+      uint64_t                                                        revision = 0;
+      std::map<permission_level, std::shared_ptr<const authority>>   entries;
+   };
+
+   /**
+    * A get_required_keys query with the ABIs of its actions and the authorities of the permissions its declared
+    * authorizations may visit, copied out of the database. compute() does not access the database and may be
+    * called from any thread.
+    */
+   struct get_required_keys_collected {
+      get_required_keys_params                                         params;
+      std::map<account_name, abi_serializer_cache::entry_ptr>          abis; ///< nullptr for accounts without an ABI
+      std::map<permission_level, std::shared_ptr<const authority>>    authorities; ///< those that exist
+      uint16_t                                                         max_authority_depth = 0;
+      fc::microseconds                                                 abi_serializer_max_time;
+
+      get_required_keys_result compute()const;
+   };
+
+   /// main thread part of get_required_keys, call compute() on the result to finish the query
+   get_required_keys_collected collect_required_keys( get_required_keys_params params, permission_tree_cache* cache = nullptr )const;
+
    using get_transaction_id_params = transaction;
    using get_transaction_id_result = transaction_id_type;
 
@@ -283,6 +351,29 @@ public:
 
    fc::variant get_block(const get_block_params& params) const;
 
+   /**
+    * A block of a get_block query and the ABIs of the accounts of its actions, read from the database.
+    * format() does not access the database and may be called from any thread.
+    */
+   struct get_block_collected {
+      signed_block_ptr                                                 block;
+      std::map<account_name, abi_serializer_cache::entry_ptr>          abis; ///< nullptr for accounts without an ABI
+      fc::microseconds                                                 abi_serializer_max_time;
+
+      fc::variant format()const;
+      /// fc::json::to_string of format(), the action data the compiled decoders decode written as JSON directly
+      std::string to_json( const fc::time_point& deadline )const;
+   };
+
+   /// main thread part of get_block, call format() on the result to finish the query
+   get_block_collected collect_block(const get_block_params& params) const;
+
+   /// collect_block of a block at hand, such as one just accepted
+   get_block_collected collect_block(const signed_block_ptr& block) const;
+
+   /// get_block for binary requests, the block fc::raw packed, without ABI decoding or variant conversion
+   vector<char> get_packed_block(const get_block_params& params) const;
+
    struct get_block_header_state_params {
       string block_num_or_id;
    };
@@ -303,16 +394,71 @@ public:
       string      encode_type{"dec"}; //dec, hex , default=dec
       optional<bool>  reverse;
       optional<bool>  show_payer; // show RAM pyer
+      string      cursor; // next_cursor of the previous page, resumes from its exact row in place of lower_bound (upper_bound if reverse)
     };
 
    struct get_table_rows_result {
       vector<fc::variant> rows; ///< one row per item, either encoded as hex String or JSON object
       bool                more = false; ///< true if last element in data is not the end and sizeof data() < limit
       string              next_key; ///< fill lower_bound with this value to fetch more rows
+      string              next_cursor; ///< fill cursor with this value to fetch more rows, unlike next_key not ambiguous between equal secondary keys
    };
 
    get_table_rows_result get_table_rows( const get_table_rows_params& params )const;
 
+   /**
+    * Rows of a get_table_rows query copied out of the database, not yet ABI decoded.
+    * decode() does not access the database and may be called from any thread.
+    */
+   struct get_table_rows_collected {
+      get_table_rows_params                   params;
+      abi_serializer_cache::entry_ptr         abi; ///< set only for json queries
+      vector<std::pair<vector<char>, name>>   rows; ///< row data and payer
+      bool                                    more = false;
+      string                                  next_key;
+      string                                  next_cursor;
+      fc::microseconds                        abi_serializer_max_time;
+      bool                                    shorten_abi_errors = true;
+
+      get_table_rows_result decode()const;
+      /// fc::json::to_string of decode(), the rows the compiled decoder decodes written as JSON directly
+      std::string to_json( const fc::time_point& deadline )const;
+
+      /// for binary requests, rows, more, next_key and next_cursor fc::raw packed, the rows not decoded
+      vector<char> pack()const;
+   };
+
+   /// main thread part of get_table_rows, call decode() on the result to finish the query
+   get_table_rows_collected collect_table_rows( const get_table_rows_params& params )const;
+
+   struct table_delta_row {
+      name           code;
+      name           scope;
+      name           table;
+      uint64_t       primary_key = 0;
+      name           payer;
+      bool           present = true; ///< false for a removed row
+      vector<char>   value;
+   };
+
+   struct get_table_deltas_collected {
+      vector<table_delta_row>                                  rows;
+      std::map<account_name, abi_serializer_cache::entry_ptr>  abis; ///< of the codes of rows, nullptr for a code without an ABI
+      fc::microseconds                                         abi_serializer_max_time;
+      bool                                                     shorten_abi_errors = true;
+
+      /// rows in order, their values decoded with the ABI of their code, as hex if it does not decode them
+      fc::variants decode()const;
+   };
+
+   /**
+    * main thread part of the table subscriptions, the rows of tables changed by the last accepted block, read from
+    * the undo session of the block as state_history_plugin does. Call decode() on the result off the main thread.
+    *
+    * @param tables - (code, scope, table) of the tables whose rows are collected
+    */
+   get_table_deltas_collected collect_table_deltas( const std::set<std::tuple<name, name, name>>& tables )const;
+
    struct get_table_by_scope_params {
       name        code; // mandatory
       name        table; // optional, act as filter
@@ -320,6 +466,7 @@ public:
       string      upper_bound; // upper bound of scope, optional
       uint32_t    limit = 10;
       optional<bool>  reverse;
+      string      cursor; // next_cursor of the previous page, resumes from its exact table in place of lower_bound (upper_bound if reverse)
    };
    struct get_table_by_scope_result_row {
       name        code;
@@ -331,10 +478,30 @@ public:
    struct get_table_by_scope_result {
       vector<get_table_by_scope_result_row> rows;
       string      more; ///< fill lower_bound with this value to fetch more rows
+      string      next_cursor; ///< fill cursor with this value to fetch more rows, without the tables of the scope already returned
    };
 
    get_table_by_scope_result get_table_by_scope( const get_table_by_scope_params& params )const;
 
+   struct get_kv_rows_params {
+      name        code; // mandatory
+      bytes       prefix; // only keys starting with it, optional
+      bytes       lower_bound; // first key, optional
+      uint32_t    limit = 10;
+   };
+   struct get_kv_rows_result_row {
+      bytes       key;
+      name        payer;
+      bytes       value;
+   };
+   struct get_kv_rows_result {
+      vector<get_kv_rows_result_row> rows;
+      optional<bytes> more; ///< fill lower_bound with this value to fetch more rows
+   };
+
+   /// rows of the key-value database of a contract in key order, keys and values as hex
+   get_kv_rows_result get_kv_rows( const get_kv_rows_params& params )const;
+
    struct get_currency_balance_params {
       name             code;
       name             account;
@@ -343,6 +510,20 @@ public:
 
    vector<asset> get_currency_balance( const get_currency_balance_params& params )const;
 
+   struct get_currency_balances_params {
+      name             code;
+      vector<name>     accounts;
+      optional<string> symbol;
+   };
+
+   struct get_currency_balances_row {
+      name             account;
+      vector<asset>    balances;
+   };
+
+   /// get_currency_balance of up to max_batched_accounts accounts, in account name order, once each
+   vector<get_currency_balances_row> get_currency_balances( const get_currency_balances_params& params )const;
+
    struct get_currency_stats_params {
       name           code;
       string         symbol;
@@ -371,6 +552,42 @@ public:
 
    get_producers_result get_producers( const get_producers_params& params )const;
 
+   struct get_producers_collected_row {
+      uint64_t       owner = 0;
+      double         total_votes_key = 0; ///< of the prototalvote index, producers are ranked by it
+      bool           present = true;      ///< false for a removed row
+      vector<char>   value;
+   };
+
+   struct get_producers_decoded_row {
+      uint64_t       owner = 0;
+      double         total_votes_key = 0;
+      bool           present = true;
+      fc::variant    json;                ///< the row decoded, its value as hex if it does not decode
+      fc::variant    hex;
+   };
+
+   struct get_producers_collected {
+      bool                                   available = false; ///< false when there is no producers table
+      bool                                   complete = false;  ///< all the rows, otherwise those changed by the last block
+      vector<get_producers_collected_row>    rows;
+      optional<vector<char>>                 global;            ///< the global row, when complete or changed
+      abi_serializer_cache::entry_ptr        abi;               ///< of the system contract
+      fc::microseconds                       abi_serializer_max_time;
+      bool                                   shorten_abi_errors = true;
+
+      vector<get_producers_decoded_row> decode()const;
+      /// total_producer_vote_weight of the global row, if collected and decoded
+      optional<double> decode_total_producer_vote_weight()const;
+   };
+
+   /**
+    * main thread part of the producer ranking of chain_api_plugin, which answers get_producers off the main thread.
+    * The changed rows are read from the undo session of the last accepted block as collect_table_deltas does, all of
+    * them when changed_only is false or there is no undo session. Call decode() on the result off the main thread.
+    */
+   get_producers_collected collect_producers( bool changed_only )const;
+
    struct get_producer_schedule_params {
    };
 
@@ -395,6 +612,59 @@ public:
 
    get_scheduled_transactions_result get_scheduled_transactions( const get_scheduled_transactions_params& params ) const;
 
+   /**
+    * The JSON of transactions get_scheduled_transactions decoded, by transaction id, with the ABIs they were decoded
+    * with so that one set since is not missed. It is emptied once max_entries are kept. Safe to use from any thread.
+    */
+   class scheduled_transactions_cache {
+   public:
+      explicit scheduled_transactions_cache( size_t max_entries ) : max_entries( max_entries ) {}
+
+      /// the JSON of id if it was decoded with abis
+      fc::optional<fc::variant> find( const transaction_id_type& id, const vector<abi_serializer_cache::entry_ptr>& abis )const;
+      void insert( const transaction_id_type& id, vector<abi_serializer_cache::entry_ptr> abis, fc::variant json );
+
+   private:
+      struct entry {
+         vector<abi_serializer_cache::entry_ptr>  abis;
+         fc::variant                              json;
+      };
+
+      const size_t                               max_entries;
+      mutable std::mutex                         mtx;
+      std::map<transaction_id_type, entry>       entries;
+   };
+
+   /**
+    * The page of a get_scheduled_transactions query copied out of the database with the ABIs of its actions.
+    * decode() does not access the database and may be called from any thread.
+    */
+   struct get_scheduled_transactions_collected {
+      struct row {
+         transaction_id_type        trx_id;
+         account_name               sender;
+         uint128_t                  sender_id = 0;
+         account_name               payer;
+         time_point                 delay_until;
+         time_point                 expiration;
+         time_point                 published;
+         bytes                      packed_trx;
+         fc::optional<transaction>  trx; ///< unpacked for json queries
+      };
+
+      bool                                                      json = false;
+      vector<row>                                               rows;
+      string                                                    more;
+      std::map<account_name, abi_serializer_cache::entry_ptr>   abis; ///< nullptr for accounts without an ABI
+      fc::microseconds                                          abi_serializer_max_time;
+
+      /// the transactions JSON decoded are taken from cache when it has them and added to it otherwise
+      get_scheduled_transactions_result decode( scheduled_transactions_cache* cache = nullptr )const;
+   };
+
+   /// main thread part of get_scheduled_transactions, call decode() on the result to finish the query
+   get_scheduled_transactions_collected collect_scheduled_transactions( const get_scheduled_transactions_params& params ) const;
+
    static void copy_inline_row(const chain::key_value_object& obj, vector<char>& data) {
       data.resize( obj.value.size() );
       memcpy( data.data(), obj.value.data(), obj.value.size() );
@@ -421,15 +691,35 @@ public:
 
    static uint64_t get_table_index_name(const read_only::get_table_rows_params& p, bool& primary);
 
+   /**
+    * The position of a row in a table index, given to clients as an opaque cursor so the next page starts at the
+    * row itself, instead of at a key to convert again that may be shared by several rows of a secondary index
+    */
+   struct table_cursor {
+      uint64_t       index = 0; ///< the table with its index position, as from get_table_index_name
+      vector<char>   secondary_key; ///< bytes of the secondary key, empty for the primary index
+      uint64_t       primary_key = 0;
+   };
+
+   static string encode_cursor( const table_cursor& c );
+
+   /// @throws contract_table_query_exception if cursor is malformed or of another index
+   static table_cursor decode_cursor( const string& cursor, uint64_t index );
+
+   template<typename T>
+   static vector<char> key_bytes( const T& key ) {
+      static_assert( std::is_trivially_copyable<T>::value, "keys of a cursor are copied as bytes" );
+      vector<char> bytes( sizeof(T) );
+      memcpy( bytes.data(), &key, sizeof(T) );
+      return bytes;
+   }
+
    template <typename IndexType, typename SecKeyType, typename ConvFn>
-   read_only::get_table_rows_result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_def& abi, ConvFn conv )const {
-      read_only::get_table_rows_result result;
+   void get_table_rows_by_seckey( const read_only::get_table_rows_params& p, get_table_rows_collected& result, ConvFn conv )const {
       const auto& d = db.db();
 
       name scope{ convert_to_type<uint64_t>(p.scope, "scope") };
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer::create_yield_function( abi_serializer_max_time ) );
       bool primary = false;
       const uint64_t table_with_index = get_table_index_name(p, primary);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
@@ -468,36 +758,33 @@ public:
             }
          }
 
+         if( p.cursor.size() ) {
+            const auto c = decode_cursor( p.cursor, table_with_index );
+            EOS_ASSERT( c.secondary_key.size() == sizeof(secondary_key_type), chain::contract_table_query_exception,
+                        "Cursor ${c} is not of key type ${t}", ("c", p.cursor)("t", p.key_type) );
+            auto& bound = ( p.reverse && *p.reverse ) ? upper_bound_lookup_tuple : lower_bound_lookup_tuple;
+            memcpy( &std::get<1>(bound), c.secondary_key.data(), sizeof(secondary_key_type) );
+            std::get<2>(bound) = c.primary_key;
+         }
+
          if( upper_bound_lookup_tuple < lower_bound_lookup_tuple )
-            return result;
+            return;
 
          auto walk_table_row_range = [&]( auto itr, auto end_itr ) {
             auto cur_time = fc::time_point::now();
             auto end_time = cur_time + fc::microseconds(1000 * 10); /// 10ms max time
-            vector<char> data;
             for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++itr, cur_time = fc::time_point::now() ) {
                const auto* itr2 = d.find<chain::key_value_object, chain::by_scope_primary>( boost::make_tuple(t_id->id, itr->primary_key) );
                if( itr2 == nullptr ) continue;
-               copy_inline_row(*itr2, data);
-
-               fc::variant data_var;
-               if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer::create_yield_function( abi_serializer_max_time ), shorten_abi_errors );
-               } else {
-                  data_var = fc::variant( data );
-               }
-
-               if( p.show_payer && *p.show_payer ) {
-                  result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", itr->payer) );
-               } else {
-                  result.rows.emplace_back( std::move(data_var) );
-               }
+               result.rows.emplace_back( vector<char>(), itr->payer );
+               copy_inline_row(*itr2, result.rows.back().first);
 
                ++count;
             }
             if( itr != end_itr ) {
                result.more = true;
                result.next_key = convert_to_string(itr->secondary_key, p.key_type, p.encode_type, "next_key - next lower bound");
+               result.next_cursor = encode_cursor( { table_with_index, key_bytes( itr->secondary_key ), itr->primary_key } );
             }
          };
 
@@ -509,18 +796,14 @@ public:
             walk_table_row_range( lower, upper );
          }
       }
-      return result;
    }
 
    template <typename IndexType>
-   read_only::get_table_rows_result get_table_rows_ex( const read_only::get_table_rows_params& p, const abi_def& abi )const {
-      read_only::get_table_rows_result result;
+   void get_table_rows_ex( const read_only::get_table_rows_params& p, get_table_rows_collected& result )const {
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer::create_yield_function( abi_serializer_max_time ));
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, name(scope), p.table));
       if( t_id != nullptr ) {
          const auto& idx = d.get_index<IndexType, chain::by_scope_primary>();
@@ -547,32 +830,27 @@ public:
             }
          }
 
+         if( p.cursor.size() ) {
+            const auto c = decode_cursor( p.cursor, p.table.to_uint64_t() );
+            EOS_ASSERT( c.secondary_key.empty(), chain::contract_table_query_exception, "Cursor ${c} is not of the primary index", ("c", p.cursor) );
+            auto& bound = ( p.reverse && *p.reverse ) ? upper_bound_lookup_tuple : lower_bound_lookup_tuple;
+            std::get<1>(bound) = c.primary_key;
+         }
+
          if( upper_bound_lookup_tuple < lower_bound_lookup_tuple  )
-            return result;
+            return;
 
          auto walk_table_row_range = [&]( auto itr, auto end_itr ) {
             auto cur_time = fc::time_point::now();
             auto end_time = cur_time + fc::microseconds(1000 * 10); /// 10ms max time
-            vector<char> data;
             for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++count, ++itr, cur_time = fc::time_point::now() ) {
-               copy_inline_row(*itr, data);
-
-               fc::variant data_var;
-               if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer::create_yield_function( abi_serializer_max_time ), shorten_abi_errors );
-               } else {
-                  data_var = fc::variant( data );
-               }
-
-               if( p.show_payer && *p.show_payer ) {
-                  result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", itr->payer) );
-               } else {
-                  result.rows.emplace_back( std::move(data_var) );
-               }
+               result.rows.emplace_back( vector<char>(), itr->payer );
+               copy_inline_row(*itr, result.rows.back().first);
             }
             if( itr != end_itr ) {
                result.more = true;
                result.next_key = convert_to_string(itr->primary_key, p.key_type, p.encode_type, "next_key - next lower bound");
+               result.next_cursor = encode_cursor( { p.table.to_uint64_t(), {}, itr->primary_key } );
             }
          };
 
@@ -584,7 +862,6 @@ public:
             walk_table_row_range( lower, upper );
          }
       }
-      return result;
    }
 
    using get_accounts_by_authorizers_result = account_query_db::get_accounts_by_authorizers_result;
@@ -594,14 +871,30 @@ public:
    chain::symbol extract_core_symbol()const;
 
    friend struct resolver_factory<read_only>;
+
+private:
+   /// what get_account looks up once for any number of accounts
+   struct account_lookup {
+      abi_serializer_cache::entry_ptr        abi; ///< of the system contract, null without one
+      chain::symbol                          core_symbol;
+      const chain::table_id_object*          voters = nullptr;
+      const chain::table_id_object*          rexbal = nullptr;
+   };
+
+   account_lookup make_account_lookup( const optional<symbol>& expected_core_symbol )const;
+   void fill_account( get_account_results& result, const account_lookup& lookup )const;
+   /// the balances of the accounts table of code scoped by account, of symbol if it is set
+   vector<asset> currency_balances( name code, name account, const optional<string>& symbol )const;
 };
 
 class read_write {
    controller& db;
    const fc::microseconds abi_serializer_max_time;
    const bool api_accept_transactions;
+   abi_serializer_cache* abi_cache = nullptr;
 public:
-   read_write(controller& db, const fc::microseconds& abi_serializer_max_time, bool api_accept_transactions);
+   read_write(controller& db, const fc::microseconds& abi_serializer_max_time, bool api_accept_transactions,
+              abi_serializer_cache* abi_cache = nullptr);
    void validate() const;
 
    using push_block_params = chain::signed_block;
@@ -624,7 +917,21 @@ public:
    using send_transaction_results = push_transaction_results;
    void send_transaction(const send_transaction_params& params, chain::plugin_interface::next_function<send_transaction_results> next);
 
+   /// send_transaction for binary requests, of an already unpacked transaction, the trace is returned without ABI decoding
+   void send_packed_transaction(const chain::packed_transaction_ptr& trx, chain::plugin_interface::next_function<chain::transaction_trace_ptr> next);
+
+   /// execute against the pending block and return the trace, the transaction is neither included in a block nor relayed
+   using compute_transaction_params = push_transaction_params;
+   using compute_transaction_results = push_transaction_results;
+   void compute_transaction(const compute_transaction_params& params, chain::plugin_interface::next_function<compute_transaction_results> next);
+
    friend resolver_factory<read_write>;
+
+private:
+   void push_transaction(const push_transaction_params& params, bool dry_run, chain::plugin_interface::next_function<push_transaction_results> next);
+
+   /// the trace with ABI decoded action data and its action traces nested as inline_traces
+   fc::variant format_push_trace(const chain::transaction_trace_ptr& trx_trace_ptr) const;
 };
 
  //support for --key_types [sha256,ripemd160] and --encoding [dec/hex]
@@ -711,7 +1018,7 @@ public:
    void plugin_startup();
    void plugin_shutdown();
 
-   chain_apis::read_write get_read_write_api() { return chain_apis::read_write(chain(), get_abi_serializer_max_time(), api_accept_transactions()); }
+   chain_apis::read_write get_read_write_api() { return chain_apis::read_write(chain(), get_abi_serializer_max_time(), api_accept_transactions(), get_abi_serializer_cache()); }
    chain_apis::read_only get_read_only_api() const;
 
    bool accept_block( const chain::signed_block_ptr& block, const chain::block_id_type& id );
@@ -720,13 +1027,11 @@ public:
    bool block_is_on_preferred_chain(const chain::block_id_type& block_id);
 
    static bool recover_reversible_blocks( const fc::path& db_dir,
-                                          uint32_t cache_size,
                                           optional<fc::path> new_db_dir = optional<fc::path>(),
                                           uint32_t truncate_at_block = 0
                                         );
 
    static bool import_reversible_blocks( const fc::path& reversible_dir,
-                                         uint32_t cache_size,
                                          const fc::path& reversible_blocks_file
                                        );
 
@@ -741,6 +1046,16 @@ public:
 
    chain::chain_id_type get_chain_id() const;
    fc::microseconds get_abi_serializer_max_time() const;
+   /// shared cache of abi_serializer instances, nullptr before plugin_initialize()
+   chain_apis::abi_serializer_cache* get_abi_serializer_cache() const;
+
+   /// same as controller::to_variant_with_abi but resolves ABIs through the shared abi_serializer cache
+   template<typename T>
+   fc::variant to_variant_with_abi( const T& obj, const chain::abi_serializer::yield_function_t& yield ) const {
+      fc::variant pretty_output;
+      chain::abi_serializer::to_variant( obj, pretty_output, get_abi_serializer_cache()->make_resolver( chain(), yield ), yield );
+      return pretty_output;
+   }
    bool api_accept_transactions() const;
    // set true by other plugins if any plugin allows transactions
    bool accept_transactions() const;
@@ -775,14 +1090,20 @@ FC_REFLECT(eosio::chain_apis::read_only::get_block_header_state_params, (block_n
 
 FC_REFLECT( eosio::chain_apis::read_write::push_transaction_results, (transaction_id)(processed) )
 
-FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_params, (json)(code)(scope)(table)(table_key)(lower_bound)(upper_bound)(limit)(key_type)(index_position)(encode_type)(reverse)(show_payer) )
-FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_result, (rows)(more)(next_key) );
+FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_params, (json)(code)(scope)(table)(table_key)(lower_bound)(upper_bound)(limit)(key_type)(index_position)(encode_type)(reverse)(show_payer)(cursor) )
+FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_result, (rows)(more)(next_key)(next_cursor) );
+FC_REFLECT( eosio::chain_apis::read_only::table_cursor, (index)(secondary_key)(primary_key) )
 
-FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_params, (code)(table)(lower_bound)(upper_bound)(limit)(reverse) )
+FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_params, (code)(table)(lower_bound)(upper_bound)(limit)(reverse)(cursor) )
 FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_result_row, (code)(scope)(table)(payer)(count));
-FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_result, (rows)(more) );
+FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_result, (rows)(more)(next_cursor) );
+FC_REFLECT( eosio::chain_apis::read_only::get_kv_rows_params, (code)(prefix)(lower_bound)(limit) )
+FC_REFLECT( eosio::chain_apis::read_only::get_kv_rows_result_row, (key)(payer)(value) );
+FC_REFLECT( eosio::chain_apis::read_only::get_kv_rows_result, (rows)(more) );
 
 FC_REFLECT( eosio::chain_apis::read_only::get_currency_balance_params, (code)(account)(symbol));
+FC_REFLECT( eosio::chain_apis::read_only::get_currency_balances_params, (code)(accounts)(symbol));
+FC_REFLECT( eosio::chain_apis::read_only::get_currency_balances_row, (account)(balances));
 FC_REFLECT( eosio::chain_apis::read_only::get_currency_stats_params, (code)(symbol));
 FC_REFLECT( eosio::chain_apis::read_only::get_currency_stats_result, (supply)(max_supply)(issuer));
 
@@ -804,6 +1125,8 @@ FC_REFLECT( eosio::chain_apis::read_only::get_code_results, (account_name)(code_
 FC_REFLECT( eosio::chain_apis::read_only::get_code_hash_results, (account_name)(code_hash) )
 FC_REFLECT( eosio::chain_apis::read_only::get_abi_results, (account_name)(abi) )
 FC_REFLECT( eosio::chain_apis::read_only::get_account_params, (account_name)(expected_core_symbol) )
+FC_REFLECT( eosio::chain_apis::read_only::get_accounts_params, (account_names)(expected_core_symbol) )
+FC_REFLECT( eosio::chain_apis::read_only::get_accounts_results, (accounts)(missing) )
 FC_REFLECT( eosio::chain_apis::read_only::get_code_params, (account_name)(code_as_wasm) )
 FC_REFLECT( eosio::chain_apis::read_only::get_code_hash_params, (account_name) )
 FC_REFLECT( eosio::chain_apis::read_only::get_abi_params, (account_name) )
@@ -0,0 +1,157 @@
+#define BOOST_TEST_MODULE abi_serializer_cache
+#include <boost/test/unit_test.hpp>
+#include <eosio/testing/tester.hpp>
+#include <eosio/chain_plugin/abi_serializer_cache.hpp>
+
+using namespace eosio;
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace eosio::chain_apis;
+
+namespace {
+
+const char* abi_v1 = R"=====(
+{
+   "version": "eosio::abi/1.0",
+   "structs": [{ "name": "hi", "base": "", "fields": [{ "name": "user", "type": "name" }] }],
+   "actions": [{ "name": "hi", "type": "hi", "ricardian_contract": "" }]
+}
+)=====";
+
+const char* abi_v2 = R"=====(
+{
+   "version": "eosio::abi/1.0",
+   "structs": [{ "name": "bye", "base": "", "fields": [{ "name": "user", "type": "name" }] }],
+   "actions": [{ "name": "bye", "type": "bye", "ricardian_contract": "" }]
+}
+)=====";
+
+const char* abi_v3 = R"=====(
+{
+   "version": "eosio::abi/1.1",
+   "types": [{ "new_type_name": "account", "type": "name" }],
+   "structs": [
+      { "name": "base", "base": "", "fields": [{ "name": "owner", "type": "account" }] },
+      { "name": "note", "base": "base", "fields": [
+         { "name": "quantity", "type": "asset" },
+         { "name": "memo", "type": "string" },
+         { "name": "tags", "type": "uint16[]" },
+         { "name": "at", "type": "time_point_sec?" },
+         { "name": "v", "type": "v" },
+         { "name": "ext", "type": "uint32$" }
+      ] }
+   ],
+   "variants": [{ "name": "v", "types": ["uint8", "base"] }],
+   "actions": [{ "name": "note", "type": "note", "ricardian_contract": "" }],
+   "tables": [{ "name": "notes", "type": "note", "index_type": "i64", "key_names": [], "key_types": [] }]
+}
+)=====";
+
+auto yield() { return abi_serializer::create_yield_function( fc::microseconds::maximum() ); }
+
+}
+
+BOOST_AUTO_TEST_SUITE(abi_serializer_cache_tests)
+
+BOOST_FIXTURE_TEST_CASE(hit_and_setabi_test, tester) { try {
+   abi_serializer_cache cache( 8 );
+
+   BOOST_CHECK( !cache.get( *control, N(nobody), yield() ) );
+
+   create_account( N(alice) );
+   produce_block();
+   BOOST_CHECK( !cache.get( *control, N(alice), yield() ) );
+
+   set_abi( N(alice), abi_v1 );
+   produce_block();
+   auto e1 = cache.get( *control, N(alice), yield() );
+   BOOST_REQUIRE( e1 );
+   BOOST_CHECK_EQUAL( "hi", e1->serializer.get_action_type( N(hi) ) );
+   BOOST_CHECK( e1 == cache.get( *control, N(alice), yield() ) );
+
+   set_abi( N(alice), abi_v2 );
+   produce_block();
+   auto e2 = cache.get( *control, N(alice), yield() );
+   BOOST_REQUIRE( e2 );
+   BOOST_CHECK( e1 != e2 );
+   BOOST_CHECK_EQUAL( "bye", e2->serializer.get_action_type( N(bye) ) );
+   BOOST_CHECK( e2->serializer.get_action_type( N(hi) ).empty() );
+
+   auto stats = cache.get_stats();
+   BOOST_CHECK_EQUAL( 1u, stats.hits );
+   BOOST_CHECK_EQUAL( 1u, stats.entries );
+
+   cache.invalidate( N(alice) );
+   BOOST_CHECK_EQUAL( 0u, cache.get_stats().entries );
+   BOOST_CHECK( e2 != cache.get( *control, N(alice), yield() ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE(eviction_test, tester) { try {
+   abi_serializer_cache cache( 1 );
+
+   create_accounts( {N(alice), N(bob)} );
+   set_abi( N(alice), abi_v1 );
+   set_abi( N(bob), abi_v2 );
+   produce_block();
+
+   auto a = cache.get( *control, N(alice), yield() );
+   BOOST_REQUIRE( a );
+   BOOST_REQUIRE( cache.get( *control, N(bob), yield() ) );
+   BOOST_CHECK_EQUAL( 1u, cache.get_stats().entries );
+
+   // alice was evicted by bob, a held entry stays usable
+   BOOST_CHECK( a != cache.get( *control, N(alice), yield() ) );
+   BOOST_CHECK_EQUAL( "hi", a->serializer.get_action_type( N(hi) ) );
+   BOOST_CHECK_EQUAL( 0u, cache.get_stats().hits );
+   BOOST_CHECK_EQUAL( 3u, cache.get_stats().misses );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE(compiled_decoder_test, tester) { try {
+   abi_serializer_cache cache( 8 );
+
+   create_account( N(alice) );
+   set_abi( N(alice), abi_v3 );
+   produce_block();
+
+   auto e = cache.get( *control, N(alice), yield() );
+   BOOST_REQUIRE( e );
+   BOOST_REQUIRE( e->compiled );
+
+   const auto data = e->serializer.variant_to_binary( "note", fc::json::from_string( R"=====({"owner": "bob",
+      "quantity": "1.0000 SYS", "memo": "a \"quoted\" memo", "tags": [1, 65535], "at": "2021-12-20T15:30:21",
+      "v": ["base", {"owner": "carol"}]})=====" ), yield() );
+   auto to_json = []( const fc::variant& v ) { return fc::json::to_string( v, fc::time_point::maximum() ); };
+
+   // table rows and abi_bin_to_json
+   BOOST_CHECK_EQUAL( to_json( e->serializer.binary_to_variant( "note", data, yield() ) ),
+                      to_json( e->binary_to_variant( "note", data, yield(), true ) ) );
+   BOOST_CHECK_THROW( e->binary_to_variant( "note", bytes{1, 2}, yield(), true ), fc::exception );
+
+   // the action data of blocks and traces, including data the ABI does not decode
+   signed_transaction trx;
+   trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, N(alice), N(note), data );
+   trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, N(alice), N(note), bytes{1, 2} );
+   fc::variant by_serializer, by_compiled;
+   abi_serializer::to_variant( trx, by_serializer, [&]( const name& ) -> fc::optional<abi_serializer> { return e->serializer; }, yield() );
+   abi_serializer::to_variant( trx, by_compiled, cache.make_resolver( *control, yield() ), yield() );
+   BOOST_CHECK_EQUAL( to_json( by_serializer ), to_json( by_compiled ) );
+   BOOST_CHECK( by_compiled["actions"].get_array().at( 0 )["data"].is_object() );
+
+   // the JSON of the compiled decoder spliced in place of the variant, as get_block sends it
+   json_splicer splicer;
+   fc::variant by_splicer;
+   abi_serializer::to_variant( trx, by_splicer, [&]( const name& account ) {
+      return abi_serializer_cache::resolved{ cache.get( *control, account, yield() ), &splicer };
+   }, yield() );
+   BOOST_CHECK( by_splicer["actions"].get_array().at( 0 )["data"].is_string() );
+   BOOST_CHECK_EQUAL( to_json( by_serializer ), splicer.to_string( by_splicer, fc::time_point::maximum() ) );
+
+   // strings alike the placeholders are kept
+   json_splicer other;
+   const auto placeholder = other.add( "{}" );
+   const auto v = fc::variant( fc::mutable_variant_object( "a", placeholder )( "b", splicer.add( "[]" ) ) );
+   BOOST_CHECK_EQUAL( splicer.to_string( v, fc::time_point::maximum() ),
+                      R"=====({"a":")=====" + placeholder.as_string() + R"=====(","b":[]})=====" );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
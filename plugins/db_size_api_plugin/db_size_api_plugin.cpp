@@ -2,11 +2,182 @@
 #include <fc/io/json.hpp>
 #include <eosio/db_size_api_plugin/db_size_api_plugin.hpp>
 
+#include <eosio/chain/account_object.hpp>
+#include <eosio/chain/block_summary_object.hpp>
+#include <eosio/chain/code_object.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/database_header_object.hpp>
+#include <eosio/chain/database_utils.hpp>
+#include <eosio/chain/generated_transaction_object.hpp>
+#include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/permission_link_object.hpp>
+#include <eosio/chain/permission_object.hpp>
+#include <eosio/chain/protocol_state_object.hpp>
+#include <eosio/chain/resource_limits_private.hpp>
+#include <eosio/chain/transaction_object.hpp>
+
+#include <boost/core/demangle.hpp>
+#include <boost/signals2/connection.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+
 namespace eosio {
 
 static appbase::abstract_plugin& _db_size_api_plugin = app().register_plugin<db_size_api_plugin>();
 
 using namespace eosio;
+using namespace eosio::chain;
+
+namespace {
+   /// the indices of the chain, as the controller, authorization_manager and resource_limits_manager add them
+   using db_size_index_set = index_set<
+      account_index,
+      account_metadata_index,
+      account_ram_correction_index,
+      global_property_multi_index,
+      protocol_state_multi_index,
+      dynamic_global_property_multi_index,
+      block_summary_multi_index,
+      transaction_multi_index,
+      generated_transaction_multi_index,
+      table_id_multi_index,
+      code_index,
+      kv_index,
+      database_header_multi_index,
+      key_value_index,
+      index64_index,
+      index128_index,
+      index256_index,
+      index_double_index,
+      index_long_double_index,
+      permission_index,
+      permission_usage_index,
+      permission_link_index,
+      resource_limits::resource_limits_index,
+      resource_limits::resource_usage_index,
+      resource_limits::resource_limits_state_index,
+      resource_limits::resource_limits_config_index
+   >;
+
+   /// the name chainbase gives an index in row_count_per_index
+   template<typename Index>
+   std::string index_name() {
+      return boost::core::demangle( typeid(typename Index::value_type).name() );
+   }
+}
+
+/**
+ * Sums the blob payloads of the rows and finds the accounts using the most RAM by scanning a bounded number of rows
+ * after each accepted block, on the main thread, so that get only reports the totals of the last complete scan.
+ */
+class db_size_api_plugin_impl {
+public:
+   static constexpr size_t top_ram_accounts = 20;
+
+   uint32_t                                             scan_rows_per_block = 0;
+   fc::optional<boost::signals2::scoped_connection>     accepted_block_connection;
+
+   /// node size of each index of the chain, by name
+   std::map<std::string, uint64_t>                      node_sizes;
+
+   // the last complete scan
+   std::map<std::string, uint64_t>                      payload_bytes;
+   vector<db_size_account_ram>                          top_ram;
+   uint32_t                                             scan_block_num = 0;
+
+   db_size_api_plugin_impl() {
+      db_size_index_set::walk_indices( [this]( auto utils ) {
+         using index_t = typename decltype(utils)::index_t;
+         node_sizes[index_name<index_t>()] = sizeof(typename index_t::final_node_type);
+      } );
+
+      stages.emplace_back( make_stage<account_index>( [this]( const account_object& a ) {
+         scanning_payload[index_name<account_index>()] += a.abi.size();
+      } ) );
+      stages.emplace_back( make_stage<code_index>( [this]( const code_object& c ) {
+         scanning_payload[index_name<code_index>()] += c.code.size();
+      } ) );
+      stages.emplace_back( make_stage<key_value_index>( [this]( const key_value_object& kv ) {
+         scanning_payload[index_name<key_value_index>()] += kv.value.size();
+      } ) );
+      stages.emplace_back( make_stage<kv_index>( [this]( const kv_object& kv ) {
+         scanning_payload[index_name<kv_index>()] += kv.kv_key.size() + kv.kv_value.size();
+      } ) );
+      stages.emplace_back( make_stage<generated_transaction_multi_index>( [this]( const generated_transaction_object& gto ) {
+         scanning_payload[index_name<generated_transaction_multi_index>()] += gto.packed_trx.size();
+      } ) );
+      stages.emplace_back( make_stage<resource_limits::resource_usage_index>( [this]( const resource_limits::resource_usage_object& ru ) {
+         // a min heap of the largest
+         auto by_ram = []( const db_size_account_ram& a, const db_size_account_ram& b ) { return a.ram_usage > b.ram_usage; };
+         if( scanning_top_ram.size() < top_ram_accounts ) {
+            scanning_top_ram.push_back( {ru.owner, ru.ram_usage} );
+            std::push_heap( scanning_top_ram.begin(), scanning_top_ram.end(), by_ram );
+         } else if( ru.ram_usage > scanning_top_ram.front().ram_usage ) {
+            std::pop_heap( scanning_top_ram.begin(), scanning_top_ram.end(), by_ram );
+            scanning_top_ram.back() = {ru.owner, ru.ram_usage};
+            std::push_heap( scanning_top_ram.begin(), scanning_top_ram.end(), by_ram );
+         }
+      } ) );
+   }
+
+   /// continue the scan for scan_rows_per_block rows
+   void scan( const chainbase::database& db, uint32_t head_block_num ) {
+      uint32_t budget = scan_rows_per_block;
+      while( budget ) {
+         if( !stages[stage]( db, next_id, budget ) ) return;
+         next_id = 0;
+         if( ++stage < stages.size() ) continue;
+
+         payload_bytes = std::move( scanning_payload );
+         scanning_payload.clear();
+         std::sort_heap( scanning_top_ram.begin(), scanning_top_ram.end(),
+                         []( const db_size_account_ram& a, const db_size_account_ram& b ) { return a.ram_usage > b.ram_usage; } );
+         top_ram = std::move( scanning_top_ram );
+         scanning_top_ram.clear();
+         scan_block_num = head_block_num;
+         stage = 0;
+      }
+   }
+
+private:
+   /// scans rows of an index from next_id on, within budget, true once the last row is scanned
+   using stage_t = std::function<bool( const chainbase::database& db, int64_t& next_id, uint32_t& budget )>;
+
+   template<typename Index, typename F>
+   static stage_t make_stage( F&& f ) {
+      return [f = std::forward<F>(f)]( const chainbase::database& db, int64_t& next_id, uint32_t& budget ) {
+         const auto& idx = db.get_index<Index, by_id>();
+         auto itr = idx.lower_bound( typename Index::value_type::id_type( next_id ) );
+         for( ; itr != idx.end() && budget; ++itr, --budget ) f( *itr );
+         if( itr == idx.end() ) return true;
+         next_id = itr->id._id;
+         return false;
+      };
+   }
+
+   vector<stage_t>                  stages;
+   size_t                           stage = 0;
+   int64_t                          next_id = 0;
+   std::map<std::string, uint64_t>  scanning_payload;
+   vector<db_size_account_ram>      scanning_top_ram;
+};
+
+db_size_api_plugin::db_size_api_plugin() : my( new db_size_api_plugin_impl ) {}
+
+db_size_api_plugin::~db_size_api_plugin() = default;
+
+void db_size_api_plugin::set_program_options(options_description& cli, options_description& cfg) {
+   cfg.add_options()
+         ("db-size-scan-rows-per-block", bpo::value<uint32_t>()->default_value(10000),
+          "Rows scanned after each accepted block to total the blob payload bytes of the indices and find the accounts using the most RAM; 0 disables the scan.")
+         ;
+}
+
+void db_size_api_plugin::plugin_initialize(const variables_map& options) {
+   my->scan_rows_per_block = options.at( "db-size-scan-rows-per-block" ).as<uint32_t>();
+}
 
 #define CALL(api_name, api_handle, call_name, INVOKE, http_response_code) \
 {std::string("/v1/" #api_name "/" #call_name), \
@@ -25,12 +196,23 @@ using namespace eosio;
 
 
 void db_size_api_plugin::plugin_startup() {
+   if( my->scan_rows_per_block ) {
+      controller& chain = app().get_plugin<chain_plugin>().chain();
+      my->accepted_block_connection.emplace( chain.accepted_block.connect( [this, &chain]( const block_state_ptr& bsp ) {
+         my->scan( chain.db(), bsp->block_num );
+      } ) );
+   }
+
    app().get_plugin<http_plugin>().add_api({
        CALL(db_size, this, get,
             INVOKE_R_V(this, get), 200),
    });
 }
 
+void db_size_api_plugin::plugin_shutdown() {
+   my->accepted_block_connection.reset();
+}
+
 db_size_stats db_size_api_plugin::get() {
    const chainbase::database& db = app().get_plugin<chain_plugin>().chain().db();
    db_size_stats ret;
@@ -39,9 +221,22 @@ db_size_stats db_size_api_plugin::get() {
    ret.size = db.get_segment_manager()->get_size();
    ret.used_bytes = ret.size - ret.free_bytes;
 
+   uint64_t accounted = 0;
    chainbase::database::database_index_row_count_multiset indices = db.row_count_per_index();
-   for(const auto& i : indices)
-      ret.indices.emplace_back(db_size_index_count{i.second, i.first});
+   for(const auto& i : indices) {
+      db_size_index_count c{i.second, i.first};
+      if( auto itr = my->node_sizes.find( c.index ); itr != my->node_sizes.end() ) {
+         c.node_size = itr->second;
+         c.node_bytes = c.row_count * c.node_size;
+      }
+      if( auto itr = my->payload_bytes.find( c.index ); itr != my->payload_bytes.end() )
+         c.payload_bytes = itr->second;
+      accounted += c.node_bytes + c.payload_bytes;
+      ret.indices.emplace_back( std::move( c ) );
+   }
+   ret.unaccounted_bytes = ret.used_bytes > accounted ? ret.used_bytes - accounted : 0;
+   ret.scan_block_num = my->scan_block_num;
+   ret.top_ram_accounts = my->top_ram;
 
    return ret;
 }
@@ -12,6 +12,14 @@ using namespace appbase;
 struct db_size_index_count {
    string   index;
    uint64_t row_count;
+   uint64_t node_size = 0;      ///< bytes of the node of a row, 0 if the index is not one of the chain's
+   uint64_t node_bytes = 0;     ///< row_count nodes
+   uint64_t payload_bytes = 0;  ///< of the blobs of the rows, as of the last complete scan
+};
+
+struct db_size_account_ram {
+   chain::name account;
+   uint64_t    ram_usage = 0;
 };
 
 struct db_size_stats {
@@ -19,30 +27,37 @@ struct db_size_stats {
    uint64_t                    used_bytes;
    uint64_t                    size;
    vector<db_size_index_count> indices;
+   /// used bytes less the node and payload bytes: allocation overhead, undo state and fragmentation
+   uint64_t                    unaccounted_bytes = 0;
+   /// head block when the last scan of blob payloads and RAM usage completed, 0 if none has yet
+   uint32_t                    scan_block_num = 0;
+   vector<db_size_account_ram> top_ram_accounts;  ///< largest RAM usage first
 };
 
 class db_size_api_plugin : public plugin<db_size_api_plugin> {
 public:
    APPBASE_PLUGIN_REQUIRES((http_plugin) (chain_plugin))
 
-   db_size_api_plugin() = default;
+   db_size_api_plugin();
    db_size_api_plugin(const db_size_api_plugin&) = delete;
    db_size_api_plugin(db_size_api_plugin&&) = delete;
    db_size_api_plugin& operator=(const db_size_api_plugin&) = delete;
    db_size_api_plugin& operator=(db_size_api_plugin&&) = delete;
-   virtual ~db_size_api_plugin() override = default;
+   virtual ~db_size_api_plugin() override;
 
-   virtual void set_program_options(options_description& cli, options_description& cfg) override {}
-   void plugin_initialize(const variables_map& vm) {}
+   virtual void set_program_options(options_description& cli, options_description& cfg) override;
+   void plugin_initialize(const variables_map& vm);
    void plugin_startup();
-   void plugin_shutdown() {}
+   void plugin_shutdown();
 
    db_size_stats get();
 
 private:
+   std::unique_ptr<class db_size_api_plugin_impl> my;
 };
 
 }
 
-FC_REFLECT( eosio::db_size_index_count, (index)(row_count) )
-FC_REFLECT( eosio::db_size_stats, (free_bytes)(used_bytes)(size)(indices) )
\ No newline at end of file
+FC_REFLECT( eosio::db_size_index_count, (index)(row_count)(node_size)(node_bytes)(payload_bytes) )
+FC_REFLECT( eosio::db_size_account_ram, (account)(ram_usage) )
+FC_REFLECT( eosio::db_size_stats, (free_bytes)(used_bytes)(size)(indices)(unaccounted_bytes)(scan_block_num)(top_ram_accounts) )
\ No newline at end of file
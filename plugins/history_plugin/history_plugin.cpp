@@ -350,6 +350,7 @@ namespace eosio {
          db.add_index<account_control_history_multi_index>();
          db.add_index<public_key_history_multi_index>();
 
+         chain.add_trace_consumer();
          my->applied_transaction_connection.emplace(
                chain.applied_transaction.connect( [&]( std::tuple<const transaction_trace_ptr&, const signed_transaction&> t ) {
                   my->on_applied_transaction( std::get<0>(t) );
@@ -361,6 +362,8 @@ namespace eosio {
    }
 
    void history_plugin::plugin_shutdown() {
+      if( my->applied_transaction_connection )
+         my->chain_plug->chain().remove_trace_consumer();
       my->applied_transaction_connection.reset();
    }
 
@@ -368,6 +371,31 @@ namespace eosio {
 
 
    namespace history_apis {
+      namespace {
+         /**
+          * Unpack the receipts of an irreversible block one at a time straight from the block log, until one is
+          * accepted by f, so that the transactions after it are never unpacked
+          * @return the timestamp of the block, empty if it is not in the block log yet
+          */
+         template<typename F>
+         fc::optional<block_timestamp_type> find_receipt_in_block_log( const controller& chain, uint32_t block_num, F&& f ) {
+            const auto packed = chain.fetch_packed_block_by_number( block_num );
+            if( !packed ) return {};
+
+            fc::datastream<const char*> ds( packed.data, packed.size );
+            signed_block_header header;
+            fc::raw::unpack( ds, header );
+            fc::unsigned_int receipt_count;
+            fc::raw::unpack( ds, receipt_count );
+            for( uint32_t i = 0; i < receipt_count.value; ++i ) {
+               transaction_receipt receipt;
+               fc::raw::unpack( ds, receipt );
+               if( f( receipt ) ) break;
+            }
+            return header.timestamp;
+         }
+      }
+
       read_only::get_actions_result read_only::get_actions( const read_only::get_actions_params& params )const {
          edump((params));
         auto& chain = history->chain_plug->chain();
@@ -424,7 +452,7 @@ namespace eosio {
                                  start_itr->action_sequence_num,
                                  start_itr->account_sequence_num,
                                  a.block_num, a.block_time,
-                                 chain.to_variant_with_abi(t, abi_serializer::create_yield_function( abi_serializer_max_time ))
+                                 history->chain_plug->to_variant_with_abi(t, abi_serializer::create_yield_function( abi_serializer_max_time ))
                                  });
 
            end_time = fc::time_point::now();
@@ -484,68 +512,83 @@ namespace eosio {
               fc::datastream<const char*> ds( itr->packed_action_trace.data(), itr->packed_action_trace.size() );
               action_trace t;
               fc::raw::unpack( ds, t );
-              result.traces.emplace_back( chain.to_variant_with_abi(t, abi_serializer::create_yield_function( abi_serializer_max_time )) );
+              result.traces.emplace_back( history->chain_plug->to_variant_with_abi(t, abi_serializer::create_yield_function( abi_serializer_max_time )) );
 
               ++itr;
             }
 
-            auto blk = chain.fetch_block_by_number( result.block_num );
-            if( blk || chain.is_building_block() ) {
-               const vector<transaction_receipt>& receipts = blk ? blk->transactions : chain.get_pending_trx_receipts();
-               for (const auto &receipt: receipts) {
-                    if (receipt.trx.contains<packed_transaction>()) {
-                        auto &pt = receipt.trx.get<packed_transaction>();
-                        if (pt.id() == result.id) {
-                            fc::mutable_variant_object r("receipt", receipt);
-                            r("trx", chain.to_variant_with_abi(pt.get_signed_transaction(), abi_serializer::create_yield_function( abi_serializer_max_time )));
-                            result.trx = move(r);
-                            break;
-                        }
-                    } else {
-                        auto &id = receipt.trx.get<transaction_id_type>();
-                        if (id == result.id) {
-                            fc::mutable_variant_object r("receipt", receipt);
-                            result.trx = move(r);
-                            break;
-                        }
-                    }
+            auto set_trx = [&]( const transaction_receipt& receipt ) -> bool {
+               if (receipt.trx.contains<packed_transaction>()) {
+                  auto &pt = receipt.trx.get<packed_transaction>();
+                  if (pt.id() == result.id) {
+                     fc::mutable_variant_object r("receipt", receipt);
+                     r("trx", history->chain_plug->to_variant_with_abi(pt.get_signed_transaction(), abi_serializer::create_yield_function( abi_serializer_max_time )));
+                     result.trx = move(r);
+                     return true;
+                  }
+               } else {
+                  auto &id = receipt.trx.get<transaction_id_type>();
+                  if (id == result.id) {
+                     fc::mutable_variant_object r("receipt", receipt);
+                     result.trx = move(r);
+                     return true;
+                  }
+               }
+               return false;
+            };
+
+            // irreversible blocks are read from the block log only up to the transaction
+            if( !find_receipt_in_block_log( chain, result.block_num, set_trx ) ) {
+               auto blk = chain.fetch_block_by_number( result.block_num );
+               if( blk || chain.is_building_block() ) {
+                  const vector<transaction_receipt>& receipts = blk ? blk->transactions : chain.get_pending_trx_receipts();
+                  for (const auto &receipt: receipts) {
+                     if( set_trx( receipt ) ) break;
+                  }
                }
             }
          } else {
-            auto blk = chain.fetch_block_by_number(*p.block_num_hint);
             bool found = false;
-            if (blk) {
-               for (const auto& receipt: blk->transactions) {
-                  if (receipt.trx.contains<packed_transaction>()) {
-                     auto& pt = receipt.trx.get<packed_transaction>();
-                     const auto& id = pt.id();
-                     if( txn_id_matched(id) ) {
-                        result.id = id;
-                        result.last_irreversible_block = chain.last_irreversible_block_num();
-                        result.block_num = *p.block_num_hint;
-                        result.block_time = blk->timestamp;
-                        fc::mutable_variant_object r("receipt", receipt);
-                        r("trx", chain.to_variant_with_abi(pt.get_signed_transaction(), abi_serializer::create_yield_function( abi_serializer_max_time )));
-                        result.trx = move(r);
-                        found = true;
-                        break;
-                     }
-                  } else {
-                     auto& id = receipt.trx.get<transaction_id_type>();
-                     if( txn_id_matched(id) ) {
-                        result.id = id;
-                        result.last_irreversible_block = chain.last_irreversible_block_num();
-                        result.block_num = *p.block_num_hint;
-                        result.block_time = blk->timestamp;
-                        fc::mutable_variant_object r("receipt", receipt);
-                        result.trx = move(r);
-                        found = true;
-                        break;
-                     }
+            auto set_trx = [&]( const transaction_receipt& receipt ) -> bool {
+               if (receipt.trx.contains<packed_transaction>()) {
+                  auto& pt = receipt.trx.get<packed_transaction>();
+                  const auto& id = pt.id();
+                  if( txn_id_matched(id) ) {
+                     result.id = id;
+                     fc::mutable_variant_object r("receipt", receipt);
+                     r("trx", history->chain_plug->to_variant_with_abi(pt.get_signed_transaction(), abi_serializer::create_yield_function( abi_serializer_max_time )));
+                     result.trx = move(r);
+                     found = true;
+                  }
+               } else {
+                  auto& id = receipt.trx.get<transaction_id_type>();
+                  if( txn_id_matched(id) ) {
+                     result.id = id;
+                     fc::mutable_variant_object r("receipt", receipt);
+                     result.trx = move(r);
+                     found = true;
+                  }
+               }
+               return found;
+            };
+
+            auto block_time = find_receipt_in_block_log( chain, *p.block_num_hint, set_trx );
+            if( !block_time ) {
+               auto blk = chain.fetch_block_by_number(*p.block_num_hint);
+               if (blk) {
+                  block_time = blk->timestamp;
+                  for (const auto& receipt: blk->transactions) {
+                     if( set_trx( receipt ) ) break;
                   }
                }
             }
 
+            if (found) {
+               result.last_irreversible_block = chain.last_irreversible_block_num();
+               result.block_num = *p.block_num_hint;
+               result.block_time = *block_time;
+            }
+
             if (!found) {
                EOS_THROW(tx_not_found, "Transaction ${id} not found in history or in block number ${n}", ("id",p.id)("n", *p.block_num_hint));
             }
@@ -2,6 +2,7 @@
 #include <eosio/chain/exceptions.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <fstream>
+#include <future>
 
 namespace eosio {
 
@@ -51,11 +52,31 @@ void http_client_plugin::plugin_initialize(const variables_map& options) {
 }
 
 void http_client_plugin::plugin_startup() {
-
+   // one thread, as the client is not thread safe
+   thread_pool.emplace( "httpc", 1 );
 }
 
 void http_client_plugin::plugin_shutdown() {
+   if( thread_pool ) thread_pool->stop();
+}
+
+void http_client_plugin::post( const fc::url& url, fc::variant payload, const fc::time_point& deadline, post_callback next ) {
+   EOS_ASSERT( thread_pool, chain::plugin_exception, "http_client_plugin is not started" );
+   boost::asio::post( thread_pool->get_executor(), [this, url, payload{std::move(payload)}, deadline, next{std::move(next)}]() {
+      try {
+         next( my->post_sync( url, payload, deadline ) );
+      } CATCH_AND_CALL( next );
+   });
+}
 
+fc::variant http_client_plugin::post_sync( const fc::url& url, const fc::variant& payload, const fc::time_point& deadline ) {
+   // owned by the callback, so that the wait ends with a broken promise if the thread is stopped before calling it
+   auto result = std::make_shared<std::promise<post_result>>();
+   auto f = result->get_future();
+   post( url, payload, deadline, [result]( const post_result& r ) { result->set_value( r ); } );
+   const post_result r = f.get();
+   if( r.contains<fc::exception_ptr>() ) r.get<fc::exception_ptr>()->dynamic_rethrow_exception();
+   return r.get<fc::variant>();
 }
 
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include <appbase/application.hpp>
+#include <eosio/chain/thread_utils.hpp>
 #include <fc/network/http/http_client.hpp>
+#include <fc/static_variant.hpp>
 
 namespace eosio {
    using namespace appbase;
@@ -9,6 +11,9 @@ namespace eosio {
    class http_client_plugin : public appbase::plugin<http_client_plugin>
    {
       public:
+        using post_result   = fc::static_variant<fc::exception_ptr, fc::variant>;
+        using post_callback = std::function<void(const post_result&)>;
+
         http_client_plugin();
         virtual ~http_client_plugin();
 
@@ -19,12 +24,24 @@ namespace eosio {
         void plugin_startup();
         void plugin_shutdown();
 
+        /**
+         * Posts payload to url from the thread of the plugin and calls next there with the response or the error, so
+         * the caller does not wait on the peer. The connections the client keeps open are used by one call at a time,
+         * in the order of the calls.
+         */
+        void post( const fc::url& url, fc::variant payload, const fc::time_point& deadline, post_callback next );
+
+        /// post, waiting for the response
+        fc::variant post_sync( const fc::url& url, const fc::variant& payload, const fc::time_point& deadline );
+
+        /// the client that post uses from its thread, only to be changed before plugin_startup
         http_client& get_client() {
            return *my;
         }
 
       private:
-        std::unique_ptr<http_client> my;
+        std::unique_ptr<http_client>                     my;
+        fc::optional<eosio::chain::named_thread_pool>    thread_pool;
    };
 
 }
@@ -3,6 +3,7 @@
 #include <eosio/http_plugin/local_endpoint.hpp>
 #endif
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/metrics.hpp>
 #include <eosio/chain/thread_utils.hpp>
 
 #include <fc/network/ip.hpp>
@@ -11,8 +12,17 @@
 #include <fc/io/json.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/crypto/openssl.hpp>
+#include <fc/crypto/sha256.hpp>
 
+#include <boost/algorithm/string.hpp>
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
 #include <boost/optional.hpp>
 
 #include <websocketpp/config/asio_client.hpp>
@@ -23,8 +33,14 @@
 #include <websocketpp/logger/stub.hpp>
 
 #include <thread>
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <limits>
+#include <list>
 #include <regex>
+#include <unordered_map>
 
 const fc::string logger_name("http_plugin");
 fc::logger logger;
@@ -34,6 +50,8 @@ namespace eosio {
    static appbase::abstract_plugin& _http_plugin = app().register_plugin<http_plugin>();
 
    namespace asio = boost::asio;
+   namespace beast = boost::beast;
+   namespace bio = boost::iostreams;
 
    using std::map;
    using std::vector;
@@ -54,6 +72,10 @@ namespace eosio {
 
    static http_plugin_defaults current_http_plugin_defaults;
 
+   static chain::metric_counter requests_metric( "nodeos_http_requests_total", "Requests dispatched to a url handler" );
+   static chain::metric_counter busy_metric( "nodeos_http_busy_total", "Requests refused with 429 - busy" );
+   static chain::metric_gauge bytes_in_flight_metric( "nodeos_http_bytes_in_flight", "Bytes of requests and responses in flight" );
+
    void http_plugin::set_defaults(const http_plugin_defaults config) {
       current_http_plugin_defaults = config;
    }
@@ -134,6 +156,11 @@ namespace eosio {
          virtual ~abstract_conn() {}
          virtual bool verify_max_bytes_in_flight() = 0;
          virtual void handle_exception() = 0;
+         virtual bool accepts_gzip() = 0;
+         /// @return the address of the client, empty if it has none (unix socket)
+         virtual std::string remote_address() = 0;
+         virtual void append_header(const std::string& name, const std::string& value) = 0;
+         virtual void replace_header(const std::string& name, const std::string& value) = 0;
          virtual void send_response(std::string, int) = 0;
       };
 
@@ -142,11 +169,120 @@ namespace eosio {
       template<typename T>
       using connection_ptr = typename websocketpp::server<T>::connection_ptr;
 
+      /**
+       * virtualized wrapper for the websocket connections of the clients subscribed to topics
+       */
+      struct abstract_ws_conn {
+         virtual ~abstract_ws_conn() {}
+         /// may be called from any thread
+         virtual void send_text(std::string text) = 0;
+         /// @return the bytes of the messages sent not yet written to the socket
+         virtual size_t buffered_amount() = 0;
+         /// may be called from any thread
+         virtual void close(const std::string& reason) = 0;
+
+         /// stop notifying the subscriptions of the connection, once it is closed
+         void close_subscriptions() {
+            std::lock_guard<std::mutex> g( mtx );
+            for( auto& s : subscriptions ) {
+               *s.second = false;
+            }
+            subscriptions.clear();
+         }
+
+         std::mutex                                        mtx; ///< guards subscriptions
+         map<uint64_t, std::shared_ptr<std::atomic<bool>>> subscriptions; ///< id -> still subscribed
+      };
+
+      using abstract_ws_conn_ptr = std::shared_ptr<abstract_ws_conn>;
+
+      /**
+       * a websocket connection of a websocketpp server, whose send and close may be called from any thread
+       */
+      template<typename T>
+      struct websocketpp_ws_conn : public abstract_ws_conn {
+         websocketpp_ws_conn(websocketpp::server<T>& ws, connection_hdl hdl)
+         :ws(ws)
+         ,hdl(std::move(hdl))
+         {}
+
+         void send_text(std::string text) override {
+            websocketpp::lib::error_code ec;
+            ws.send( hdl, text, websocketpp::frame::opcode::text, ec );
+         }
+
+         size_t buffered_amount() override {
+            websocketpp::lib::error_code ec;
+            auto con = ws.get_con_from_hdl( hdl, ec );
+            return ec ? 0 : con->get_buffered_amount();
+         }
+
+         void close(const std::string& reason) override {
+            websocketpp::lib::error_code ec;
+            ws.close( hdl, websocketpp::close::status::policy_violation, reason, ec );
+         }
+
+         websocketpp::server<T>& ws;
+         connection_hdl          hdl;
+      };
+
       /**
        * internal url handler that contains more parameters than the handlers provided by external systems
        */
       using internal_url_handler = std::function<void(abstract_conn_ptr, string, string, url_response_callback)>;
 
+      /**
+       * a response of a cached url handler, kept as the JSON sent so a hit is not serialized again
+       */
+      struct cached_response {
+         int                           code = 0;
+         std::shared_ptr<const string> json;
+         std::shared_ptr<const string> gzip_json; ///< set if the response was large enough to be compressed
+      };
+
+      /**
+       * @param accept_encoding - the value of the Accept-Encoding header of a request
+       * @return true if it lists gzip and does not exclude it with q=0
+       */
+      static bool accepts_gzip( const string& accept_encoding ) {
+         static const auto excluded_expr = regex( "^q=0(\\.0*)?$" );
+         vector<string> codings;
+         boost::split( codings, accept_encoding, boost::is_any_of( "," ) );
+         for( const auto& c : codings ) {
+            auto params = c.find( ';' );
+            if( !boost::iequals( boost::trim_copy( c.substr( 0, params ) ), "gzip" ) ) continue;
+            return params == string::npos || !std::regex_match( boost::erase_all_copy( c.substr( params + 1 ), " " ), excluded_expr );
+         }
+         return false;
+      }
+
+      /// the integers of the framed unix socket protocol are little endian
+      template<typename T>
+      static T get_le( const char* p ) {
+         T v = 0;
+         for( size_t i = 0; i < sizeof(T); ++i ) {
+            v |= T( uint8_t( p[i] ) ) << ( 8 * i );
+         }
+         return v;
+      }
+
+      template<typename T>
+      static void put_le( char* p, T v ) {
+         for( size_t i = 0; i < sizeof(T); ++i ) {
+            p[i] = char( ( v >> ( 8 * i ) ) & 0xff );
+         }
+      }
+
+      static string gzip_compress( const string& data, int level ) {
+         string out;
+         bio::filtering_ostream comp;
+         comp.push( bio::gzip_compressor( bio::gzip_params( level ) ) );
+         comp.push( bio::back_inserter( out ) );
+         bio::write( comp, data.data(), data.size() );
+         bio::close( comp );
+         return out;
+      }
+
       /**
        * Helper method to calculate the "in flight" size of a string
        * @param s - the string
@@ -178,6 +314,33 @@ namespace eosio {
    using websocket_server_tls_type =  websocketpp::server<detail::asio_with_stub_log<websocketpp::transport::asio::tls_socket::endpoint>>;
    using ssl_context_ptr =  websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context>;
    using http_plugin_impl_ptr = std::shared_ptr<class http_plugin_impl>;
+   class beast_http_listener;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+   class framed_unix_listener;
+#endif
+
+   /**
+    * The cost of an admitted request counted against the in flight limits, released when the request is answered
+    */
+   struct request_admission {
+      request_admission(http_plugin_impl_ptr impl, string url, string client, uint32_t cost)
+      :impl(std::move(impl)), url(std::move(url)), client(std::move(client)), cost(cost) {}
+      ~request_admission();
+
+      http_plugin_impl_ptr impl;
+      string               url;
+      string               client;
+      uint32_t             cost;
+   };
+
+   /**
+    * Per client admission state, for the per client limits
+    */
+   struct client_admission {
+      uint32_t                              in_flight = 0;
+      double                                tokens = 0; ///< cost that may still be spent, refilled every second
+      std::chrono::steady_clock::time_point last_refill;
+   };
 
    static bool verbose_http_errors = false;
 
@@ -193,6 +356,7 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
 
          // key -> priority, url_handler
          map<string,detail::internal_url_handler>  url_handlers;
+         map<string,detail::internal_url_handler>  binary_url_handlers; ///< for application/octet-stream requests
          optional<tcp::endpoint>  listen_endpoint;
          string                   access_control_allow_origin;
          string                   access_control_allow_headers;
@@ -202,11 +366,44 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
 
          websocket_server_type    server;
 
+         bool                                 keep_alive = false; ///< serve listen_endpoint with beast_listener instead of server
+         std::chrono::seconds                 keep_alive_timeout{60};
+         std::shared_ptr<beast_http_listener> beast_listener;
+
          uint16_t                                    thread_pool_size = 2;
+         std::vector<uint16_t>                       thread_pool_cpus;
          optional<eosio::chain::named_thread_pool>   thread_pool;
          std::atomic<size_t>                         bytes_in_flight{0};
          size_t                                      max_bytes_in_flight = 0;
          fc::microseconds                            max_response_time{30*1000};
+         fc::microseconds                            main_thread_budget; ///< 0 never yields the main thread
+         fc::microseconds                            main_thread_used;   ///< by the handlers run one after another, main thread only
+         fc::time_point                              main_thread_last_end;
+         bool                                        main_thread_yielded = false; ///< handlers were queued again at the lowest priority
+         size_t                                      compression_min_size = 0; ///< 0 disables compression
+
+         static constexpr uint32_t                   rows_per_cost_unit = 100;
+         static constexpr size_t                     max_idle_clients = 10000;
+         map<string, uint32_t>                       endpoint_max_in_flight; ///< url -> max cost in flight
+         uint32_t                                    client_max_in_flight = 0;
+         uint32_t                                    client_max_cost_per_sec = 0;
+         std::mutex                                  admission_mtx; ///< guards endpoint_in_flight and clients
+         map<string, uint32_t>                       endpoint_in_flight;
+         std::unordered_map<string, client_admission> clients;
+         int                                         compression_level = 1;
+
+         size_t                                      response_cache_size = 0;
+         std::mutex                                  response_cache_mtx; ///< guards response_cache_generation, response_cache_order and response_cache
+         uint64_t                                    response_cache_generation = 0; ///< bumped by every invalidation
+         std::list<string>                           response_cache_order; ///< most recently used first
+         std::unordered_map<string, std::pair<detail::cached_response, std::list<string>::iterator>> response_cache;
+
+         static constexpr const char*                            subscribe_url = "/v1/subscribe";
+         map<string, std::pair<int, subscription_handler>>       subscription_handlers; ///< topic -> priority, handler
+         uint32_t                                                max_subscriptions_per_connection = 32;
+         size_t                                                  max_subscription_buffer = 1024*1024;
+         std::mutex                                              ws_conns_mtx; ///< guards ws_conns
+         map<connection_hdl, detail::abstract_ws_conn_ptr, std::owner_less<connection_hdl>> ws_conns; ///< of the websocketpp servers
 
          optional<tcp::endpoint>  https_listen_endpoint;
          string                   https_cert_chain;
@@ -218,6 +415,9 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
 #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
          optional<asio::local::stream_protocol::endpoint> unix_endpoint;
          websocket_local_server_type unix_server;
+
+         optional<asio::local::stream_protocol::endpoint> framed_unix_endpoint;
+         std::shared_ptr<framed_unix_listener>            framed_listener;
 #endif
 
          bool                     validate_host = true;
@@ -277,8 +477,8 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
             return ctx;
          }
 
-         template<class T>
-         static void handle_exception(detail::connection_ptr<T> con) {
+         template<class C>
+         static void handle_exception(const C& con) {
             string err = "Internal Service error, http: ";
             const auto deadline = fc::time_point::now() + fc::exception::format_time_limit;
             try {
@@ -337,20 +537,132 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
             auto bytes_in_flight_size = bytes_in_flight.load();
             if( bytes_in_flight_size > max_bytes_in_flight ) {
                fc_dlog( logger, "429 - too many bytes in flight: ${bytes}", ("bytes", bytes_in_flight_size) );
-               error_results::error_info ei;
-               ei.code = websocketpp::http::status_code::too_many_requests;
-               ei.name = "Busy";
-               ei.what = "Too many bytes in flight: " + std::to_string( bytes_in_flight_size );
-               error_results results{websocketpp::http::status_code::too_many_requests, "Busy", ei};
-               con->set_body( fc::json::to_string( results, fc::time_point::maximum() ));
-               con->set_status( websocketpp::http::status_code::too_many_requests );
-               con->send_http_response();
+               send_busy( con, "Too many bytes in flight: " + std::to_string( bytes_in_flight_size ) );
                return false;
             }
 
             return true;
          }
 
+         template<typename T>
+         static void send_busy( const T& con, string what ) {
+            error_results::error_info ei;
+            ei.code = websocketpp::http::status_code::too_many_requests;
+            ei.name = "Busy";
+            ei.what = std::move( what );
+            error_results results{websocketpp::http::status_code::too_many_requests, "Busy", ei};
+            con->set_body( fc::json::to_string( results, fc::time_point::maximum() ));
+            con->set_status( websocketpp::http::status_code::too_many_requests );
+            con->send_http_response();
+            busy_metric.add();
+         }
+
+         bool admission_enabled() const {
+            return !endpoint_max_in_flight.empty() || client_max_in_flight || client_max_cost_per_sec;
+         }
+
+         /**
+          * @return the cost of a request, one unit plus one per rows_per_cost_unit of its limit parameter
+          */
+         static uint32_t request_cost( const string& body ) {
+            if( body.empty() ) return 1;
+            try {
+               auto v = fc::json::from_string( body );
+               if( v.is_object() ) {
+                  const auto& obj = v.get_object();
+                  auto itr = obj.find( "limit" );
+                  if( itr != obj.end() ) {
+                     return 1 + static_cast<uint32_t>( std::min<uint64_t>( itr->value().as_uint64() / rows_per_cost_unit,
+                                                                            std::numeric_limits<uint32_t>::max() - 1 ) );
+                  }
+               }
+            } catch( ... ) {
+               // the url handler reports the malformed request
+            }
+            return 1;
+         }
+
+         /**
+          * Count a request of client to url against the in flight and rate limits
+          *
+          * @param reason - set to why the request is refused if it is
+          * @return the admission to hold until the request is answered, null if the request is refused
+          */
+         std::shared_ptr<request_admission> admit( const string& url, const string& body, const string& client, string& reason ) {
+            auto ep_itr = endpoint_max_in_flight.find( url );
+            uint32_t cost = request_cost( body );
+            // a request costing more than a limit allows is still served once the endpoint, or client, is idle
+            if( ep_itr != endpoint_max_in_flight.end() ) {
+               cost = std::min( cost, ep_itr->second );
+            }
+            if( client_max_cost_per_sec ) {
+               cost = std::min( cost, client_max_cost_per_sec );
+            }
+            const bool client_limited = !client.empty() && (client_max_in_flight || client_max_cost_per_sec);
+
+            std::lock_guard<std::mutex> g( admission_mtx );
+            uint32_t* ep_in_flight = nullptr;
+            if( ep_itr != endpoint_max_in_flight.end() ) {
+               ep_in_flight = &endpoint_in_flight[url];
+               if( *ep_in_flight + cost > ep_itr->second ) {
+                  reason = "Too many requests in flight for " + url;
+                  return {};
+               }
+            }
+            client_admission* c = nullptr;
+            if( client_limited ) {
+               c = &clients[client];
+               if( client_max_in_flight && c->in_flight >= client_max_in_flight ) {
+                  reason = "Too many requests in flight from " + client;
+                  return {};
+               }
+               if( client_max_cost_per_sec ) {
+                  const auto now = std::chrono::steady_clock::now();
+                  const double elapsed = std::chrono::duration<double>( now - c->last_refill ).count();
+                  c->tokens = std::min<double>( client_max_cost_per_sec, c->tokens + elapsed * client_max_cost_per_sec );
+                  c->last_refill = now;
+                  if( c->tokens < cost ) {
+                     reason = "Request rate exceeded for " + client;
+                     return {};
+                  }
+                  c->tokens -= cost;
+               }
+            }
+
+            if( ep_in_flight ) *ep_in_flight += cost;
+            if( c ) ++c->in_flight;
+            return std::make_shared<request_admission>( shared_from_this(), ep_in_flight ? url : string(), client_limited ? client : string(), cost );
+         }
+
+         void release( const request_admission& a ) {
+            std::lock_guard<std::mutex> g( admission_mtx );
+            if( !a.url.empty() ) {
+               endpoint_in_flight[a.url] -= a.cost;
+            }
+            if( !a.client.empty() ) {
+               auto itr = clients.find( a.client );
+               if( itr != clients.end() ) {
+                  --itr->second.in_flight;
+                  // without a rate limit an idle client has no state worth keeping, with one it is kept until
+                  // there are too many
+                  if( itr->second.in_flight == 0 && !client_max_cost_per_sec ) {
+                     clients.erase( itr );
+                  } else if( clients.size() > max_idle_clients ) {
+                     for( auto c = clients.begin(); c != clients.end(); ) {
+                        c = c->second.in_flight == 0 ? clients.erase( c ) : std::next( c );
+                     }
+                  }
+               }
+            }
+         }
+
+         template<class T>
+         static string client_address( const detail::connection_ptr<T>& con ) {
+            boost::system::error_code ec;
+            const auto ep = con->get_socket().lowest_layer().remote_endpoint( ec );
+            return ec ? string() : ep.address().to_string();
+         }
+
          /**
           * child struct, implementing abstract connection for various underlying connection types
           * that ties it to an http_plugin_impl
@@ -377,7 +689,23 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
             }
 
             void handle_exception()override {
-               http_plugin_impl::handle_exception<T>(_conn);
+               http_plugin_impl::handle_exception(_conn);
+            }
+
+            bool accepts_gzip() override {
+               return detail::accepts_gzip( _conn->get_request_header( "Accept-Encoding" ) );
+            }
+
+            void append_header(const std::string& name, const std::string& value) override {
+               _conn->append_header( name, value );
+            }
+
+            void replace_header(const std::string& name, const std::string& value) override {
+               _conn->replace_header( name, value );
+            }
+
+            std::string remote_address() override {
+               return http_plugin_impl::client_address<T>( _conn );
             }
 
             void send_response(std::string body, int code) override {
@@ -416,11 +744,13 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
             {
                _count = detail::in_flight_sizeof(_object);
                _impl->bytes_in_flight += _count;
+               bytes_in_flight_metric.add( _count );
             }
 
             ~in_flight() {
                if (_count) {
                   _impl->bytes_in_flight -= _count;
+                  bytes_in_flight_metric.add( -int64_t( _count ) );
                }
             }
 
@@ -497,7 +827,7 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
 
                // post to the app thread taking shared ownership of next (via std::shared_ptr),
                // sole ownership of the tracked body and the passed in parameters
-               app().post( priority, [next_ptr, conn=std::move(conn), r=std::move(r), tracked_b, wrapped_then=std::move(wrapped_then)]() mutable {
+               post_to_app_thread( my, priority, [next_ptr, conn=std::move(conn), r=std::move(r), tracked_b, wrapped_then=std::move(wrapped_then)]() mutable {
                   try {
                      // call the `next` url_handler and wrap the response handler
                      (*next_ptr)( std::move( r ), std::move(*(*tracked_b)), std::move(wrapped_then)) ;
@@ -508,6 +838,38 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
             };
          }
 
+         /**
+          * Run handler on the app thread at priority. Once the handlers run there one after another have taken
+          * main_thread_budget, the following ones are queued again at the lowest priority, so that the blocks,
+          * transactions and other work queued meanwhile run before them. The budget starts over with the first
+          * handler run after yielding, or after the app thread went for main_thread_budget without running one.
+          *
+          * A handler already running is not interrupted, its own time is bounded by http-max-response-time-ms and
+          * the abi-serializer-max-time-ms of the calls.
+          */
+         static void post_to_app_thread( const http_plugin_impl_ptr& my, int priority, std::function<void()> handler, bool requeued = false ) {
+            app().post( priority, [my, requeued, handler=std::move(handler)]() mutable {
+               if( my->main_thread_budget != fc::microseconds() ) {
+                  const auto now = fc::time_point::now();
+                  if( ( requeued && my->main_thread_yielded ) ||
+                      now - my->main_thread_last_end >= my->main_thread_budget ) {
+                     my->main_thread_used = fc::microseconds();
+                     my->main_thread_yielded = false;
+                  }
+                  if( my->main_thread_used >= my->main_thread_budget ) {
+                     my->main_thread_yielded = true;
+                     post_to_app_thread( my, appbase::priority::lowest, std::move(handler), true );
+                     return;
+                  }
+                  handler();
+                  my->main_thread_last_end = fc::time_point::now();
+                  my->main_thread_used += my->main_thread_last_end - now;
+               } else {
+                  handler();
+               }
+            } );
+         }
+
          /**
           * Make an internal_url_handler that will run the url_handler directly
           *
@@ -515,6 +877,39 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
           * @param next - the next handler for responses
           * @return the constructed internal_url_handler
           */
+         static detail::internal_url_handler make_http_thread_json_url_handler( url_json_handler next, http_plugin_impl_ptr my ) {
+            return [my=std::move(my), next=std::move(next)]( detail::abstract_conn_ptr conn, string r, string b, url_response_callback then ) {
+               // then is held until the response is sent, as it holds the admission of the request
+               url_json_response_callback json_then = [my, conn, then]( int code, std::shared_ptr<const string> json ) {
+                  boost::asio::post( my->thread_pool->get_executor(), [my, conn, then, code, json=std::move(json)]() {
+                     try {
+                        my->send_json_response( conn, code, *json, {} );
+                     } catch( ... ) {
+                        conn->handle_exception();
+                     }
+                  } );
+               };
+               try {
+                  next(std::move(r), std::move(b), std::move(then), std::move(json_then));
+               } catch( ... ) {
+                  conn->handle_exception();
+               }
+            };
+         }
+
+         static detail::internal_url_handler make_http_thread_text_url_handler( std::function<string()> text, string content_type,
+                                                                                http_plugin_impl_ptr my ) {
+            return [my=std::move(my), text=std::move(text), content_type=std::move(content_type)]
+                       ( detail::abstract_conn_ptr conn, string, string, url_response_callback then ) {
+               try {
+                  conn->replace_header( "Content-type", content_type );
+                  my->send_json_response( conn, 200, text(), {} );
+               } catch( ... ) {
+                  conn->handle_exception();
+               }
+            };
+         }
+
          static detail::internal_url_handler make_http_thread_url_handler(url_handler next) {
             return [next=std::move(next)]( detail::abstract_conn_ptr conn, string r, string b, url_response_callback then ) {
                try {
@@ -525,16 +920,180 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
              };
          }
 
+         /**
+          * Make an internal_url_handler that sends the cached response to the same url and body when there is one,
+          * and otherwise runs next and caches its response if it succeeds
+          *
+          * @param next - the handler computing responses that are not cached
+          * @param my - the http_plugin_impl
+          * @return the constructed internal_url_handler
+          */
+         static detail::internal_url_handler make_cached_url_handler( detail::internal_url_handler next, http_plugin_impl_ptr my ) {
+            return [my=std::move(my), next=std::move(next)]( detail::abstract_conn_ptr conn, string r, string b, url_response_callback then ) {
+               string key = cache_key_of( r, b );
+               uint64_t generation = 0;
+               if( my->send_cached_response( conn, key, generation ) ) {
+                  return;
+               }
+
+               // the passed in response handler is held until the response, it may carry the admission of the request
+               auto cached_then = my->make_http_response_handler( conn, std::make_pair( std::move( key ), generation ) );
+               url_response_callback then_caching = [cached_then=std::move(cached_then), then=std::move(then)]( int code, fc::variant resp ) {
+                  cached_then( code, std::move( resp ) );
+               };
+               next( std::move( conn ), std::move( r ), std::move( b ), std::move( then_caching ) );
+            };
+         }
+
+         /**
+          * Make an internal_url_handler that will run the url_json_handler on the app() thread, as
+          * make_app_thread_url_handler does, and send the JSON it responds with from the http thread pool. If cached,
+          * the successful responses are cached and sent again as make_cached_url_handler does.
+          *
+          * @pre b.size() has been added to bytes_in_flight by caller
+          * @param priority - priority to post to the app thread at
+          * @param next - the next handler for responses
+          * @param cached - whether to cache the responses
+          * @param my - the http_plugin_impl
+          * @return the constructed internal_url_handler
+          */
+         static detail::internal_url_handler make_app_thread_json_url_handler( int priority, url_json_handler next, bool cached,
+                                                                               http_plugin_impl_ptr my ) {
+            auto next_ptr = std::make_shared<url_json_handler>(std::move(next));
+            return [my=std::move(my), priority, cached, next_ptr=std::move(next_ptr)]
+                       ( detail::abstract_conn_ptr conn, string r, string b, url_response_callback then ) {
+               optional<std::pair<string, uint64_t>> cache_key;
+               if( cached ) {
+                  string key = cache_key_of( r, b );
+                  uint64_t generation = 0;
+                  if( my->send_cached_response( conn, key, generation ) ) {
+                     return;
+                  }
+                  cache_key.emplace( std::move( key ), generation );
+               }
+
+               auto tracked_b = make_in_flight<string>(std::move(b), my);
+               if (!conn->verify_max_bytes_in_flight()) {
+                  return;
+               }
+
+               // the passed in response handler is held until the response, it may carry the admission of the request
+               url_response_callback wrapped_then = [tracked_b, then, variant_then=my->make_http_response_handler( conn, cache_key )]
+                                                       ( int code, fc::variant resp ) {
+                  variant_then( code, std::move( resp ) );
+               };
+               url_json_response_callback json_then = [my, conn, tracked_b, then, cache_key]( int code, std::shared_ptr<const string> json ) {
+                  boost::asio::post( my->thread_pool->get_executor(), [my, conn, then, cache_key, code, json=std::move(json)]() {
+                     try {
+                        my->send_json_response( conn, code, *json, cache_key );
+                     } catch( ... ) {
+                        conn->handle_exception();
+                     }
+                  } );
+               };
+
+               post_to_app_thread( my, priority, [next_ptr, conn=std::move(conn), r=std::move(r), tracked_b,
+                                                  wrapped_then=std::move(wrapped_then), json_then=std::move(json_then)]() mutable {
+                  try {
+                     (*next_ptr)( std::move( r ), std::move(*(*tracked_b)), std::move(wrapped_then), std::move(json_then) );
+                  } catch( ... ) {
+                     conn->handle_exception();
+                  }
+               } );
+            };
+         }
+
+         /// the response cache key of a request to url r with body b
+         static string cache_key_of( const string& r, const string& b ) {
+            return r + "#" + fc::sha256::hash( b ).str();
+         }
+
+         /**
+          * send the cached response of key to conn if there is one
+          *
+          * @param generation - set to the generation of the cache at the time of the lookup
+          * @return true if the cached response was sent, or failed to be sent
+          */
+         bool send_cached_response( const detail::abstract_conn_ptr& conn, const string& key, uint64_t& generation ) {
+            auto cached = find_cached_response( key, generation );
+            if( !cached ) {
+               return false;
+            }
+            try {
+               const bool gzip = cached->gzip_json && conn->accepts_gzip();
+               auto tracked_json = make_in_flight( string( gzip ? *cached->gzip_json : *cached->json ), shared_from_this() );
+               append_encoding_headers( conn, gzip );
+               conn->send_response( std::move( *(*tracked_json) ), cached->code );
+            } catch( ... ) {
+               conn->handle_exception();
+            }
+            return true;
+         }
+
+         /**
+          * @param generation - set to the generation of the cache at the time of the lookup
+          * @return the cached response of key if there is one
+          */
+         optional<detail::cached_response> find_cached_response( const string& key, uint64_t& generation ) {
+            std::lock_guard<std::mutex> g( response_cache_mtx );
+            generation = response_cache_generation;
+            auto itr = response_cache.find( key );
+            if( itr == response_cache.end() ) {
+               return {};
+            }
+            response_cache_order.splice( response_cache_order.begin(), response_cache_order, itr->second.second );
+            return itr->second.first;
+         }
+
+         /**
+          * cache the response of key unless the cache was invalidated since generation was looked up, as the
+          * response may then have been computed from replaced state
+          */
+         void store_cached_response( const string& key, uint64_t generation, int code, const string& json, const string& gzip_json ) {
+            auto cached = detail::cached_response{ code, std::make_shared<const string>( json ),
+                                                   gzip_json.empty() ? nullptr : std::make_shared<const string>( gzip_json ) };
+            std::lock_guard<std::mutex> g( response_cache_mtx );
+            if( generation != response_cache_generation || response_cache.count( key ) ) {
+               return;
+            }
+            response_cache_order.push_front( key );
+            response_cache.emplace( key, std::make_pair( std::move( cached ), response_cache_order.begin() ) );
+            if( response_cache.size() > response_cache_size ) {
+               response_cache.erase( response_cache_order.back() );
+               response_cache_order.pop_back();
+            }
+         }
+
+         /**
+          * Append the headers of a response to conn sent gzip compressed or not
+          */
+         void append_encoding_headers( const detail::abstract_conn_ptr& conn, bool gzip ) {
+            if( compression_min_size ) {
+               conn->append_header( "Vary", "Accept-Encoding" );
+            }
+            if( gzip ) {
+               conn->append_header( "Content-Encoding", "gzip" );
+            }
+         }
+
+         void invalidate_cached_responses() {
+            std::lock_guard<std::mutex> g( response_cache_mtx );
+            ++response_cache_generation;
+            response_cache.clear();
+            response_cache_order.clear();
+         }
+
          /**
           * Construct a lambda appropriate for url_response_callback that will
           * JSON-stringify the provided response
           *
           * @param con - pointer for the connection this response should be sent to
+          * @param cache_key - the response cache key and generation to cache a successful response under, if any
           * @return lambda suitable for url_response_callback
           */
-         template<typename T>
-         auto make_http_response_handler( detail::abstract_conn_ptr abstract_conn_ptr) {
-            return [my=shared_from_this(), abstract_conn_ptr]( int code, fc::variant response ) {
+         url_response_callback make_http_response_handler( detail::abstract_conn_ptr abstract_conn_ptr,
+                                                           optional<std::pair<string, uint64_t>> cache_key = {} ) {
+            return [my=shared_from_this(), abstract_conn_ptr, cache_key=std::move(cache_key)]( int code, fc::variant response ) {
                auto tracked_response = make_in_flight(std::move(response), my);
                if (!abstract_conn_ptr->verify_max_bytes_in_flight()) {
                   return;
@@ -542,11 +1101,22 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
 
                // post  back to an HTTP thread to to allow the response handler to be called from any thread
                boost::asio::post( my->thread_pool->get_executor(),
-                                  [my, abstract_conn_ptr, code, tracked_response=std::move(tracked_response)]() {
+                                  [my, abstract_conn_ptr, code, cache_key, tracked_response=std::move(tracked_response)]() mutable {
                   try {
-                     std::string json = fc::json::to_string( *(*tracked_response), fc::time_point::now() + my->max_response_time );
-                     auto tracked_json = make_in_flight(std::move(json), my);
-                     abstract_conn_ptr->send_response(std::move(*(*tracked_json)), code);
+                     const auto& response = *(*tracked_response);
+                     std::string json;
+                     // the response of a binary url handler is a blob, sent as is
+                     if( response.is_blob() ) {
+                        const auto& data = response.get_blob().data;
+                        json.assign( data.begin(), data.end() );
+                        abstract_conn_ptr->replace_header( "Content-type", "application/octet-stream" );
+                     } else {
+                        json = fc::json::to_string( response, fc::time_point::now() + my->max_response_time );
+                     }
+                     // release the variant before handing off the body so the two are not held, or counted as
+                     // in flight, side by side while the response is written
+                     tracked_response.reset();
+                     my->send_json_response( abstract_conn_ptr, code, std::move( json ), cache_key );
                   } catch( ... ) {
                      abstract_conn_ptr->handle_exception();
                   }
@@ -554,6 +1124,29 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
             };
          }
 
+         /**
+          * Send json as the response of abstract_conn_ptr, compressed if it is large enough for compression to pay
+          * off. Called on an http thread.
+          *
+          * @param cache_key - the response cache key and generation to cache a successful response under, if any
+          */
+         void send_json_response( const detail::abstract_conn_ptr& abstract_conn_ptr, int code, std::string json,
+                                  const optional<std::pair<string, uint64_t>>& cache_key ) {
+            std::string gzip_json;
+            if( compression_min_size && json.size() >= compression_min_size && abstract_conn_ptr->accepts_gzip() ) {
+               gzip_json = detail::gzip_compress( json, compression_level );
+            }
+            if( cache_key && code == 200 ) {
+               store_cached_response( cache_key->first, cache_key->second, code, json, gzip_json );
+            }
+            append_encoding_headers( abstract_conn_ptr, !gzip_json.empty() );
+            if( !gzip_json.empty() ) {
+               json = std::move( gzip_json );
+            }
+            auto tracked_json = make_in_flight(std::move(json), shared_from_this());
+            abstract_conn_ptr->send_response(std::move(*(*tracked_json)), code);
+         }
+
          template<class T>
          void handle_http_request(detail::connection_ptr<T> con) {
             try {
@@ -562,18 +1155,7 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
                if(!allow_host<T>(req, con))
                   return;
 
-               if( !access_control_allow_origin.empty()) {
-                  con->append_header( "Access-Control-Allow-Origin", access_control_allow_origin );
-               }
-               if( !access_control_allow_headers.empty()) {
-                  con->append_header( "Access-Control-Allow-Headers", access_control_allow_headers );
-               }
-               if( !access_control_max_age.empty()) {
-                  con->append_header( "Access-Control-Max-Age", access_control_max_age );
-               }
-               if( access_control_allow_credentials ) {
-                  con->append_header( "Access-Control-Allow-Credentials", "true" );
-               }
+               add_access_control_headers( con );
 
                if(req.get_method() == "OPTIONS") {
                   con->set_status(websocketpp::http::status_code::ok);
@@ -586,21 +1168,70 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
                auto abstract_conn_ptr = make_abstract_conn_ptr<T>(con, shared_from_this());
                if( !verify_max_bytes_in_flight( con )) return;
 
-               std::string resource = con->get_uri()->get_resource();
-               auto handler_itr = url_handlers.find( resource );
-               if( handler_itr != url_handlers.end()) {
-                  std::string body = con->get_request_body();
-                  handler_itr->second( abstract_conn_ptr, std::move( resource ), std::move( body ), make_http_response_handler<T>(abstract_conn_ptr) );
-               } else {
-                  fc_dlog( logger, "404 - not found: ${ep}", ("ep", resource) );
-                  error_results results{websocketpp::http::status_code::not_found,
-                                        "Not Found", error_results::error_info(fc::exception( FC_LOG_MESSAGE( error, "Unknown Endpoint" )), verbose_http_errors )};
-                  con->set_body( fc::json::to_string( results, fc::time_point::now() + max_response_time ));
-                  con->set_status( websocketpp::http::status_code::not_found );
-                  con->send_http_response();
-               }
+               dispatch_request( con, std::move( abstract_conn_ptr ), con->get_uri()->get_resource(), con->get_request_body() );
             } catch( ... ) {
-               handle_exception<T>( con );
+               handle_exception( con );
+            }
+         }
+
+         /**
+          * Append the configured Access-Control headers to the response of con
+          */
+         template<class C>
+         void add_access_control_headers( const C& con ) {
+            if( !access_control_allow_origin.empty()) {
+               con->append_header( "Access-Control-Allow-Origin", access_control_allow_origin );
+            }
+            if( !access_control_allow_headers.empty()) {
+               con->append_header( "Access-Control-Allow-Headers", access_control_allow_headers );
+            }
+            if( !access_control_max_age.empty()) {
+               con->append_header( "Access-Control-Max-Age", access_control_max_age );
+            }
+            if( access_control_allow_credentials ) {
+               con->append_header( "Access-Control-Allow-Credentials", "true" );
+            }
+         }
+
+         /**
+          * Run the url handler of resource, or respond 404 - not found to con if there is none
+          */
+         template<class C>
+         void dispatch_request( const C& con, detail::abstract_conn_ptr abstract_conn_ptr, std::string resource, std::string body ) {
+            const bool binary = boost::istarts_with( con->get_request_header( "Content-Type" ), "application/octet-stream" );
+            const auto& handlers = binary ? binary_url_handlers : url_handlers;
+            auto handler_itr = handlers.find( resource );
+            if( handler_itr != handlers.end()) {
+               requests_metric.add();
+               auto then = make_http_response_handler(abstract_conn_ptr);
+               // refuse before any work is queued for the request
+               if( admission_enabled() ) {
+                  string reason;
+                  auto admitted = admit( resource, body, abstract_conn_ptr->remote_address(), reason );
+                  if( !admitted ) {
+                     fc_dlog( logger, "429 - ${r}", ("r", reason) );
+                     send_busy( con, std::move( reason ) );
+                     return;
+                  }
+                  then = [then=std::move(then), admitted=std::move(admitted)]( int code, fc::variant resp ) {
+                     then( code, std::move( resp ) );
+                  };
+               }
+               handler_itr->second( abstract_conn_ptr, std::move( resource ), std::move( body ), std::move( then ) );
+            } else if( binary && url_handlers.count( resource )) {
+               fc_dlog( logger, "415 - no binary handler: ${ep}", ("ep", resource) );
+               error_results results{websocketpp::http::status_code::unsupported_media_type,
+                                     "Unsupported Media Type", error_results::error_info(fc::exception( FC_LOG_MESSAGE( error, "Endpoint does not accept application/octet-stream" )), verbose_http_errors )};
+               con->set_body( fc::json::to_string( results, fc::time_point::now() + max_response_time ));
+               con->set_status( websocketpp::http::status_code::unsupported_media_type );
+               con->send_http_response();
+            } else {
+               fc_dlog( logger, "404 - not found: ${ep}", ("ep", resource) );
+               error_results results{websocketpp::http::status_code::not_found,
+                                     "Not Found", error_results::error_info(fc::exception( FC_LOG_MESSAGE( error, "Unknown Endpoint" )), verbose_http_errors )};
+               con->set_body( fc::json::to_string( results, fc::time_point::now() + max_response_time ));
+               con->set_status( websocketpp::http::status_code::not_found );
+               con->send_http_response();
             }
          }
 
@@ -615,6 +1246,7 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
                ws.set_http_handler([&](connection_hdl hdl) {
                   handle_http_request<detail::asio_with_stub_log<T>>(ws.get_con_from_hdl(hdl));
                });
+               add_subscription_handlers( ws );
             } catch ( const fc::exception& e ){
                fc_elog( logger, "http: ${e}", ("e", e.to_detail_string()) );
             } catch ( const std::exception& e ){
@@ -629,6 +1261,114 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
             valid_hosts.emplace(host + ":" + port);
             valid_hosts.emplace(host + ":" + resolved_port_str);
          }
+
+         /**
+          * Browsers open websockets to any origin, the Origin they send is checked against
+          * access-control-allow-origin as CORS would
+          *
+          * @return the status to refuse a websocket upgrade request with, 0 to accept it
+          */
+         int check_subscription_request( const string& resource, const string& origin ) const {
+            if( subscription_handlers.empty() || resource != subscribe_url ) {
+               return websocketpp::http::status_code::not_found;
+            }
+            if( !origin.empty() && access_control_allow_origin != "*" && origin != access_control_allow_origin ) {
+               return websocketpp::http::status_code::forbidden;
+            }
+            return 0;
+         }
+
+         /**
+          * Serve the websocket connections to subscribe_url of ws
+          */
+         template<class T>
+         void add_subscription_handlers( websocketpp::server<T>& ws ) {
+            ws.set_max_message_size( max_body_size );
+            // captures `this` & ws, my needs to live as long as server is handling requests
+            ws.set_validate_handler([&](connection_hdl hdl) {
+               auto con = ws.get_con_from_hdl( hdl );
+               if( !allow_host<T>( con->get_request(), con ) )
+                  return false;
+               const int status = check_subscription_request( con->get_uri()->get_resource(), con->get_request_header( "Origin" ) );
+               if( status ) {
+                  con->set_status( static_cast<websocketpp::http::status_code::value>( status ) );
+                  return false;
+               }
+               return true;
+            });
+            ws.set_open_handler([&](connection_hdl hdl) {
+               std::lock_guard<std::mutex> g( ws_conns_mtx );
+               ws_conns.emplace( hdl, std::make_shared<detail::websocketpp_ws_conn<T>>( ws, hdl ) );
+            });
+            ws.set_message_handler([this](connection_hdl hdl, typename websocketpp::server<T>::message_ptr msg) {
+               detail::abstract_ws_conn_ptr conn;
+               {
+                  std::lock_guard<std::mutex> g( ws_conns_mtx );
+                  auto itr = ws_conns.find( hdl );
+                  if( itr == ws_conns.end() ) return;
+                  conn = itr->second;
+               }
+               handle_ws_message( conn, msg->get_payload() );
+            });
+            auto on_close = [this](connection_hdl hdl) {
+               detail::abstract_ws_conn_ptr conn;
+               {
+                  std::lock_guard<std::mutex> g( ws_conns_mtx );
+                  auto itr = ws_conns.find( hdl );
+                  if( itr == ws_conns.end() ) return;
+                  conn = std::move( itr->second );
+                  ws_conns.erase( itr );
+               }
+               conn->close_subscriptions();
+            };
+            ws.set_close_handler( on_close );
+            ws.set_fail_handler( on_close );
+         }
+
+         /**
+          * Handle a subscribe or unsubscribe message of conn, an object with the id the client gives the
+          * subscription, and for subscribe its topic and params
+          */
+         void handle_ws_message( const detail::abstract_ws_conn_ptr& conn, const string& payload );
+
+         /// a client too slow to read its notifications is disconnected, rather than buffering them without bound
+         void send_ws_message( const detail::abstract_ws_conn_ptr& conn, const fc::variant& msg ) {
+            if( conn->buffered_amount() > max_subscription_buffer ) {
+               fc_dlog( logger, "closing websocket connection with ${b} bytes buffered", ("b", conn->buffered_amount()) );
+               conn->close( "Too many notifications waiting to be sent" );
+               return;
+            }
+            try {
+               conn->send_text( fc::json::to_string( msg, fc::time_point::now() + max_response_time ) );
+            } catch( const fc::exception& e ) {
+               fc_elog( logger, "unable to send websocket message: ${e}", ("e", e.to_detail_string()) );
+            }
+         }
+
+         /// respond to the message of subscription id with the exception being handled
+         void send_ws_error( const detail::abstract_ws_conn_ptr& conn, uint64_t id ) {
+            error_results::error_info ei;
+            try {
+               throw;
+            } catch( const fc::exception& e ) {
+               ei = error_results::error_info( e, verbose_http_errors );
+            } catch( const std::exception& e ) {
+               ei = error_results::error_info( fc::exception( FC_LOG_MESSAGE( error, e.what() ) ), verbose_http_errors );
+            } catch( ... ) {
+               ei = error_results::error_info( fc::exception( FC_LOG_MESSAGE( error, "Unknown Exception" ) ), verbose_http_errors );
+            }
+            error_results results{websocketpp::http::status_code::bad_request, "Invalid Request", std::move( ei )};
+            send_ws_message( conn, fc::mutable_variant_object()( "id", id )( "error", results ) );
+         }
+
+         void drop_subscription( const detail::abstract_ws_conn_ptr& conn, uint64_t id, const std::shared_ptr<std::atomic<bool>>& subscribed ) {
+            std::lock_guard<std::mutex> g( conn->mtx );
+            *subscribed = false;
+            auto itr = conn->subscriptions.find( id );
+            if( itr != conn->subscriptions.end() && itr->second == subscribed ) {
+               conn->subscriptions.erase( itr );
+            }
+         }
    };
 
 #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
@@ -636,6 +1376,645 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
    bool http_plugin_impl::allow_host<detail::asio_local_with_stub_log>(const detail::asio_local_with_stub_log::request_type& req, websocketpp::server<detail::asio_local_with_stub_log>::connection_ptr con) {
       return true;
    }
+
+   template<>
+   string http_plugin_impl::client_address<detail::asio_local_with_stub_log>(const detail::connection_ptr<detail::asio_local_with_stub_log>&) {
+      return {};
+   }
+#endif
+
+   request_admission::~request_admission() {
+      impl->release( *this );
+   }
+
+   /**
+    * A subscription of a websocket client, its notifications are converted to JSON on an http thread
+    */
+   class ws_subscription : public subscription {
+      public:
+         ws_subscription( http_plugin_impl_ptr impl, const detail::abstract_ws_conn_ptr& conn, uint64_t id, std::shared_ptr<std::atomic<bool>> subscribed )
+         :impl(std::move(impl))
+         ,conn(conn)
+         ,id(id)
+         ,subscribed(std::move(subscribed))
+         {}
+
+         void send( fc::variant data ) override {
+            if( !active() || !impl->thread_pool ) return;
+            asio::post( impl->thread_pool->get_executor(), [impl=impl, conn=conn, id=id, subscribed=subscribed, data=std::move(data)]() {
+               auto c = conn.lock();
+               if( !c || !*subscribed ) return;
+               impl->send_ws_message( c, fc::mutable_variant_object()( "id", id )( "data", data ) );
+            } );
+         }
+
+         bool active() const override {
+            return *subscribed && !conn.expired();
+         }
+
+      private:
+         http_plugin_impl_ptr                      impl;
+         std::weak_ptr<detail::abstract_ws_conn>   conn;
+         uint64_t                                  id;
+         std::shared_ptr<std::atomic<bool>>        subscribed;
+   };
+
+   void http_plugin_impl::handle_ws_message( const detail::abstract_ws_conn_ptr& conn, const string& payload ) {
+      uint64_t id = 0;
+      try {
+         const auto v = fc::json::from_string( payload );
+         const auto& msg = v.get_object();
+         id = msg["id"].as_uint64();
+         const auto method = msg["method"].as_string();
+         if( method == "unsubscribe" ) {
+            {
+               std::lock_guard<std::mutex> g( conn->mtx );
+               auto itr = conn->subscriptions.find( id );
+               EOS_ASSERT( itr != conn->subscriptions.end(), chain::invalid_http_request, "No subscription ${id}", ("id", id) );
+               *itr->second = false;
+               conn->subscriptions.erase( itr );
+            }
+            send_ws_message( conn, fc::mutable_variant_object()( "id", id )( "result", "unsubscribed" ) );
+            return;
+         }
+         EOS_ASSERT( method == "subscribe", chain::invalid_http_request, "Unknown method ${m}", ("m", method) );
+
+         const auto topic = msg["topic"].as_string();
+         auto handler_itr = subscription_handlers.find( topic );
+         EOS_ASSERT( handler_itr != subscription_handlers.end(), chain::invalid_http_request, "Unknown topic ${t}", ("t", topic) );
+         auto subscribed = std::make_shared<std::atomic<bool>>( true );
+         {
+            std::lock_guard<std::mutex> g( conn->mtx );
+            EOS_ASSERT( conn->subscriptions.size() < max_subscriptions_per_connection, chain::invalid_http_request,
+                        "Too many subscriptions, at most ${n} per connection", ("n", max_subscriptions_per_connection) );
+            EOS_ASSERT( conn->subscriptions.emplace( id, subscribed ).second, chain::invalid_http_request,
+                        "Subscription ${id} already exists", ("id", id) );
+         }
+
+         auto sub = std::make_shared<ws_subscription>( shared_from_this(), conn, id, subscribed );
+         auto params = msg.contains( "params" ) ? msg["params"] : fc::variant();
+         app().post( handler_itr->second.first,
+                     [impl=shared_from_this(), handler=handler_itr->second.second, params=std::move(params), sub, conn, id, subscribed]() {
+            try {
+               handler( params, sub );
+               // sent before any notification, which send posts to an http thread
+               impl->send_ws_message( conn, fc::mutable_variant_object()( "id", id )( "result", "subscribed" ) );
+            } catch( ... ) {
+               impl->drop_subscription( conn, id, subscribed );
+               impl->send_ws_error( conn, id );
+            }
+         } );
+      } catch( ... ) {
+         send_ws_error( conn, id );
+      }
+   }
+
+   /**
+    * A websocket connection to the subscribe url, upgraded from a beast_http_session. Messages are read one at a
+    * time and written in the order sent.
+    */
+   class beast_ws_session : public detail::abstract_ws_conn, public std::enable_shared_from_this<beast_ws_session> {
+      public:
+         beast_ws_session( tcp::socket socket, http_plugin_impl_ptr impl )
+         :ws(std::move(socket))
+         ,strand(impl->thread_pool->get_executor().get_executor())
+         ,impl(std::move(impl))
+         {}
+
+         void run( beast::http::request<beast::http::string_body> req ) {
+            upgrade_request = std::move( req );
+            asio::dispatch( strand, [self=shared_from_this()]() {
+               self->ws.read_message_max( self->impl->max_body_size );
+               self->ws.async_accept( self->upgrade_request, asio::bind_executor( self->strand, [self]( const boost::system::error_code& ec ) {
+                  if( ec ) {
+                     fc_dlog( logger, "websocket handshake failed: ${m}", ("m", ec.message()) );
+                     return;
+                  }
+                  self->do_read();
+               } ) );
+            } );
+         }
+
+         void send_text( std::string text ) override {
+            buffered += text.size();
+            asio::post( strand, [self=shared_from_this(), text=std::move(text)]() mutable {
+               self->write_queue.push_back( std::move( text ) );
+               if( self->write_queue.size() == 1 ) self->do_write();
+            } );
+         }
+
+         size_t buffered_amount() override { return buffered; }
+
+         void close( const std::string& reason ) override {
+            asio::post( strand, [self=shared_from_this(), reason]() {
+               fc_dlog( logger, "closing websocket connection: ${r}", ("r", reason) );
+               boost::system::error_code ignored;
+               self->ws.next_layer().close( ignored );
+            } );
+         }
+
+      private:
+         void do_read() {
+            ws.async_read( buffer, asio::bind_executor( strand, [self=shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+               if( ec ) {
+                  if( ec != beast::websocket::error::closed && ec != asio::error::operation_aborted ) {
+                     fc_dlog( logger, "closing websocket connection: ${m}", ("m", ec.message()) );
+                  }
+                  return self->close_subscriptions();
+               }
+               const auto payload = beast::buffers_to_string( self->buffer.data() );
+               self->buffer.consume( self->buffer.size() );
+               self->impl->handle_ws_message( self, payload );
+               self->do_read();
+            } ) );
+         }
+
+         void do_write() {
+            ws.text( true );
+            ws.async_write( asio::buffer( write_queue.front() ), asio::bind_executor( strand, [self=shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+               self->buffered -= self->write_queue.front().size();
+               self->write_queue.pop_front();
+               if( ec ) {
+                  // sends after the failure are tried, and fail, on their own
+                  for( const auto& m : self->write_queue ) self->buffered -= m.size();
+                  self->write_queue.clear();
+                  return;
+               }
+               if( !self->write_queue.empty() ) self->do_write();
+            } ) );
+         }
+
+         beast::websocket::stream<tcp::socket>                     ws;
+         asio::strand<asio::io_context::executor_type>             strand;
+         http_plugin_impl_ptr                                      impl;
+         beast::http::request<beast::http::string_body>            upgrade_request;
+         beast::flat_buffer                                        buffer;
+         std::deque<std::string>                                   write_queue;
+         std::atomic<size_t>                                       buffered{0};
+   };
+
+   /**
+    * An http connection served with Boost.Beast, which unlike websocketpp keeps the connection open between
+    * requests. Requests are read and answered one at a time, so pipelined requests are answered in order.
+    *
+    * The response is built through the same set_status/set_body/append_header/send_http_response calls as a
+    * websocketpp connection, so the http_plugin_impl helpers serve both.
+    */
+   class beast_http_session : public detail::abstract_conn, public std::enable_shared_from_this<beast_http_session> {
+      public:
+         beast_http_session( tcp::socket socket, http_plugin_impl_ptr impl )
+         :socket(std::move(socket))
+         ,strand(impl->thread_pool->get_executor().get_executor())
+         ,idle_timer(impl->thread_pool->get_executor())
+         ,impl(std::move(impl))
+         {}
+
+         void run() {
+            asio::dispatch( strand, [self=shared_from_this()]() { self->do_read(); } );
+         }
+
+         bool verify_max_bytes_in_flight() override {
+            return impl->verify_max_bytes_in_flight( shared_from_this() );
+         }
+
+         void handle_exception() override {
+            http_plugin_impl::handle_exception( shared_from_this() );
+         }
+
+         void send_response( std::string body, int code ) override {
+            set_body( std::move( body ) );
+            set_status( code );
+            send_http_response();
+         }
+
+         // only the one producing the response of the current request calls these, no further request is read
+         // until the response is written
+         void set_status( int code ) { res.result( static_cast<unsigned>( code ) ); }
+         void set_body( std::string body ) { res.body() = std::move( body ); }
+         void append_header( const std::string& name, const std::string& value ) override { res.insert( name, value ); }
+         void replace_header( const std::string& name, const std::string& value ) override { res.set( name, value ); }
+
+         std::string get_request_header( const std::string& name ) const {
+            const auto value = parser->get()[name];
+            return std::string( value.data(), value.size() );
+         }
+
+         bool accepts_gzip() override { return gzip_accepted; }
+
+         std::string remote_address() override {
+            boost::system::error_code ec;
+            const auto ep = socket.remote_endpoint( ec );
+            return ec ? std::string() : ep.address().to_string();
+         }
+
+         /// may be called from any thread
+         void send_http_response() {
+            asio::post( strand, [self=shared_from_this()]() { self->do_write(); } );
+         }
+
+      private:
+         void do_read() {
+            parser.emplace();
+            parser->body_limit( impl->max_body_size );
+            res = {};
+
+            idle_timer.expires_after( impl->keep_alive_timeout );
+            idle_timer.async_wait( asio::bind_executor( strand, [self=shared_from_this()]( const boost::system::error_code& ec ) {
+               if( ec != asio::error::operation_aborted && self->idle_timer.expiry() <= std::chrono::steady_clock::now() ) {
+                  boost::system::error_code ignored;
+                  self->socket.close( ignored );
+               }
+            } ) );
+
+            beast::http::async_read( socket, buffer, *parser,
+                                     asio::bind_executor( strand, [self=shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+               self->on_read( ec );
+            } ) );
+         }
+
+         void on_read( const boost::system::error_code& ec ) {
+            idle_timer.cancel();
+            if( ec ) {
+               // end_of_stream is the client closing between requests
+               if( ec != beast::http::error::end_of_stream && ec != asio::error::operation_aborted ) {
+                  fc_dlog( logger, "closing http connection: ${m}", ("m", ec.message()) );
+               }
+               return close();
+            }
+
+            auto& req = parser->get();
+            keep_alive = req.keep_alive();
+            const auto accept_encoding = req[beast::http::field::accept_encoding];
+            gzip_accepted = detail::accepts_gzip( std::string( accept_encoding.data(), accept_encoding.size() ) );
+            res.version( req.version() );
+            try {
+               if( !allow_host( req ) ) {
+                  set_status( websocketpp::http::status_code::bad_request );
+                  return send_http_response();
+               }
+
+               if( beast::websocket::is_upgrade( req ) ) {
+                  const auto target = req.target();
+                  const auto origin = req[beast::http::field::origin];
+                  const int status = impl->check_subscription_request( std::string( target.data(), target.size() ),
+                                                                       std::string( origin.data(), origin.size() ) );
+                  if( status ) {
+                     set_status( status );
+                     return send_http_response();
+                  }
+                  // the socket now belongs to the websocket session, nothing further is read here
+                  return std::make_shared<beast_ws_session>( std::move( socket ), impl )->run( parser->release() );
+               }
+
+               impl->add_access_control_headers( shared_from_this() );
+
+               if( req.method() == beast::http::verb::options ) {
+                  set_status( websocketpp::http::status_code::ok );
+                  return send_http_response();
+               }
+
+               append_header( "Content-type", "application/json" );
+               if( !impl->verify_max_bytes_in_flight( shared_from_this() ) ) return;
+
+               auto self = shared_from_this();
+               const auto target = req.target();
+               impl->dispatch_request( self, self, std::string( target.data(), target.size() ), std::move( req.body() ) );
+            } catch( ... ) {
+               handle_exception();
+            }
+         }
+
+         bool allow_host( const beast::http::request<beast::http::string_body>& req ) {
+            boost::system::error_code ec;
+            const auto local_endpoint = socket.local_endpoint( ec );
+            if( ec ) return false;
+            auto local_socket_host_port = local_endpoint.address().to_string() + ":" + std::to_string( local_endpoint.port() );
+
+            const auto host = req[beast::http::field::host];
+            const std::string host_str( host.data(), host.size() );
+            return !host_str.empty() && impl->host_is_valid( host_str, local_socket_host_port, false );
+         }
+
+         void do_write() {
+            res.keep_alive( keep_alive );
+            res.prepare_payload();
+            beast::http::async_write( socket, res,
+                                      asio::bind_executor( strand, [self=shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+               if( ec || !self->keep_alive ) {
+                  return self->close();
+               }
+               self->do_read();
+            } ) );
+         }
+
+         void close() {
+            boost::system::error_code ignored;
+            socket.shutdown( tcp::socket::shutdown_send, ignored );
+         }
+
+         tcp::socket                                               socket;
+         asio::strand<asio::io_context::executor_type>             strand;
+         asio::steady_timer                                        idle_timer;
+         http_plugin_impl_ptr                                      impl;
+         beast::flat_buffer                                        buffer;
+         optional<beast::http::request_parser<beast::http::string_body>> parser;
+         beast::http::response<beast::http::string_body>           res;
+         bool                                                      keep_alive = false;
+         bool                                                      gzip_accepted = false;
+   };
+
+   /**
+    * Accepts the connections of an http endpoint served by beast_http_session
+    */
+   class beast_http_listener : public std::enable_shared_from_this<beast_http_listener> {
+      public:
+         explicit beast_http_listener( http_plugin_impl_ptr impl )
+         :acceptor(impl->thread_pool->get_executor())
+         ,impl(std::move(impl))
+         {}
+
+         void listen( const tcp::endpoint& ep ) {
+            acceptor.open( ep.protocol() );
+            acceptor.set_option( tcp::acceptor::reuse_address( true ) );
+            acceptor.bind( ep );
+            acceptor.listen( asio::socket_base::max_listen_connections );
+            do_accept();
+         }
+
+         /// @pre the thread pool of the acceptor is stopped
+         void close() {
+            boost::system::error_code ignored;
+            acceptor.close( ignored );
+         }
+
+      private:
+         void do_accept() {
+            acceptor.async_accept( [self=shared_from_this()]( const boost::system::error_code& ec, tcp::socket socket ) {
+               if( ec ) {
+                  if( ec == asio::error::operation_aborted || !self->acceptor.is_open() ) return;
+                  fc_elog( logger, "error accepting http connection: ${m}", ("m", ec.message()) );
+               } else {
+                  std::make_shared<beast_http_session>( std::move( socket ), self->impl )->run();
+               }
+               self->do_accept();
+            } );
+         }
+
+         tcp::acceptor        acceptor;
+         http_plugin_impl_ptr impl;
+   };
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+   class framed_unix_session;
+
+   /**
+    * A request read from a framed unix socket connection, answered through the same calls as an http connection so
+    * the url handlers and http_plugin_impl helpers serve it unchanged. Requests of a connection are dispatched as they
+    * are read and may be answered in any order, the id of a response is the id of its request.
+    */
+   class framed_unix_request : public detail::abstract_conn, public std::enable_shared_from_this<framed_unix_request> {
+      public:
+         framed_unix_request( std::shared_ptr<framed_unix_session> session, http_plugin_impl_ptr impl, uint32_t id, bool binary )
+         :session(std::move(session))
+         ,impl(std::move(impl))
+         ,id(id)
+         ,binary_request(binary)
+         {}
+
+         bool verify_max_bytes_in_flight() override {
+            return impl->verify_max_bytes_in_flight( shared_from_this() );
+         }
+
+         void handle_exception() override {
+            http_plugin_impl::handle_exception( shared_from_this() );
+         }
+
+         bool accepts_gzip() override { return false; }
+
+         std::string remote_address() override { return {}; }
+
+         // a frame has no headers, only whether its body is binary
+         void append_header( const std::string&, const std::string& ) override {}
+         void replace_header( const std::string& name, const std::string& value ) override {
+            if( boost::iequals( name, "Content-type" ) ) {
+               binary_response = boost::istarts_with( value, "application/octet-stream" );
+            }
+         }
+
+         std::string get_request_header( const std::string& name ) const {
+            if( boost::iequals( name, "Content-Type" ) ) {
+               return binary_request ? "application/octet-stream" : "application/json";
+            }
+            return {};
+         }
+
+         void send_response( std::string body, int code ) override {
+            set_body( std::move( body ) );
+            set_status( code );
+            send_http_response();
+         }
+
+         void set_status( int code ) { status = code; }
+         void set_body( std::string b ) { body = std::move( b ); }
+
+         /// may be called from any thread
+         void send_http_response();
+
+      private:
+         std::shared_ptr<framed_unix_session> session;
+         http_plugin_impl_ptr                 impl;
+         const uint32_t                       id;
+         const bool                           binary_request;
+         bool                                 binary_response = false;
+         int                                  status = websocketpp::http::status_code::ok;
+         std::string                          body;
+   };
+
+   /**
+    * A connection to framed-unix-socket-path, a lightweight alternative to http on a unix socket for local tools.
+    * Each request is a frame of an 11 byte header, the u32 id, u8 flags, u16 url size and u32 body size, followed by
+    * the url and body. Each response is a frame of an 11 byte header, the u32 id of the request, u16 status, u8 flags
+    * and u32 body size, followed by the body. Integers are little endian, flag 1 marks a binary (fc::raw packed)
+    * body, as application/octet-stream does over http.
+    *
+    * The body is read once into the string handed to the url handler, and the body of the response is written from
+    * the string of the handler, without http parsing, headers or copies in between.
+    */
+   class framed_unix_session : public std::enable_shared_from_this<framed_unix_session> {
+      public:
+         static constexpr size_t  header_size = 11;
+         static constexpr uint8_t binary_flag = 1;
+         static constexpr size_t  max_url_size = 1024;
+
+         framed_unix_session( asio::local::stream_protocol::socket socket, http_plugin_impl_ptr impl )
+         :socket(std::move(socket))
+         ,strand(impl->thread_pool->get_executor().get_executor())
+         ,impl(std::move(impl))
+         {}
+
+         void run() {
+            asio::dispatch( strand, [self=shared_from_this()]() { self->do_read_header(); } );
+         }
+
+         /// may be called from any thread
+         void write_response( uint32_t id, int status, bool binary, std::string body ) {
+            asio::post( strand, [self=shared_from_this(), id, status, binary, body=std::move(body)]() mutable {
+               pending_response r;
+               detail::put_le<uint32_t>( &r.header[0], id );
+               detail::put_le<uint16_t>( &r.header[4], static_cast<uint16_t>( status ) );
+               r.header[6] = binary ? binary_flag : 0;
+               detail::put_le<uint32_t>( &r.header[7], static_cast<uint32_t>( body.size() ) );
+               r.body = std::move( body );
+               self->write_queue.push_back( std::move( r ) );
+               if( self->write_queue.size() == 1 ) self->do_write();
+            } );
+         }
+
+      private:
+         void do_read_header() {
+            asio::async_read( socket, asio::buffer( header ),
+                              asio::bind_executor( strand, [self=shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+               if( ec ) {
+                  if( ec != asio::error::eof && ec != asio::error::operation_aborted ) {
+                     fc_dlog( logger, "closing framed unix socket connection: ${m}", ("m", ec.message()) );
+                  }
+                  return self->close();
+               }
+               self->on_header();
+            } ) );
+         }
+
+         void on_header() {
+            const auto id = detail::get_le<uint32_t>( &header[0] );
+            const bool binary = header[4] & binary_flag;
+            const auto url_size = detail::get_le<uint16_t>( &header[5] );
+            const auto body_size = detail::get_le<uint32_t>( &header[7] );
+            // the rest of the stream can not be trusted to be framed, so the connection is closed once answered
+            if( url_size > max_url_size || body_size > impl->max_body_size ) {
+               fc_dlog( logger, "413 - framed request too large: ${u} byte url, ${b} byte body", ("u", url_size)("b", body_size) );
+               error_results results{websocketpp::http::status_code::request_entity_too_large, "Payload Too Large",
+                                     error_results::error_info( fc::exception( FC_LOG_MESSAGE( error, "Request too large" ) ), verbose_http_errors )};
+               closing = true;
+               write_response( id, websocketpp::http::status_code::request_entity_too_large, false,
+                               fc::json::to_string( results, fc::time_point::maximum() ) );
+               return;
+            }
+
+            url.resize( url_size );
+            body.resize( body_size );
+            std::array<asio::mutable_buffer, 2> buffers{{ asio::buffer( url ), asio::buffer( body ) }};
+            asio::async_read( socket, buffers,
+                              asio::bind_executor( strand, [self=shared_from_this(), id, binary]( const boost::system::error_code& ec, size_t ) {
+               if( ec ) {
+                  return self->close();
+               }
+               self->on_request( id, binary );
+               self->do_read_header();
+            } ) );
+         }
+
+         void on_request( uint32_t id, bool binary ) {
+            auto req = std::make_shared<framed_unix_request>( shared_from_this(), impl, id, binary );
+            try {
+               if( !req->verify_max_bytes_in_flight() ) return;
+               impl->dispatch_request( req, req, std::move( url ), std::move( body ) );
+            } catch( ... ) {
+               req->handle_exception();
+            }
+         }
+
+         void do_write() {
+            auto& r = write_queue.front();
+            std::array<asio::const_buffer, 2> buffers{{ asio::buffer( r.header ), asio::buffer( r.body ) }};
+            asio::async_write( socket, buffers,
+                               asio::bind_executor( strand, [self=shared_from_this()]( const boost::system::error_code& ec, size_t ) {
+               self->write_queue.pop_front();
+               if( ec ) {
+                  return self->close();
+               }
+               if( !self->write_queue.empty() ) {
+                  self->do_write();
+               } else if( self->closing ) {
+                  self->close();
+               }
+            } ) );
+         }
+
+         void close() {
+            boost::system::error_code ignored;
+            socket.close( ignored );
+         }
+
+         struct pending_response {
+            std::array<char, header_size> header;
+            std::string                   body;
+         };
+
+         asio::local::stream_protocol::socket           socket;
+         asio::strand<asio::io_context::executor_type>  strand;
+         http_plugin_impl_ptr                           impl;
+         std::array<char, header_size>                  header;
+         std::string                                    url;
+         std::string                                    body;
+         std::deque<pending_response>                   write_queue;
+         bool                                           closing = false; ///< close once the responses queued are written
+   };
+
+   void framed_unix_request::send_http_response() {
+      session->write_response( id, status, binary_response, std::move( body ) );
+   }
+
+   /**
+    * Accepts the connections of framed-unix-socket-path
+    */
+   class framed_unix_listener : public std::enable_shared_from_this<framed_unix_listener> {
+      public:
+         explicit framed_unix_listener( http_plugin_impl_ptr impl )
+         :acceptor(impl->thread_pool->get_executor())
+         ,impl(std::move(impl))
+         {}
+
+         void listen( const asio::local::stream_protocol::endpoint& ep ) {
+            {
+               boost::system::error_code test_ec;
+               asio::local::stream_protocol::socket test_socket( acceptor.get_executor() );
+               test_socket.connect( ep, test_ec );
+               // a service is already running on that socket, don't touch it
+               EOS_ASSERT( test_ec, chain::http_exception, "Framed unix socket ${p} is in use", ("p", ep.path()) );
+               // the socket exists but no one is home, remove it and continue on
+               if( test_ec == boost::system::errc::connection_refused )
+                  ::unlink( ep.path().c_str() );
+            }
+            acceptor.open( ep.protocol() );
+            acceptor.bind( ep );
+            acceptor.listen( asio::socket_base::max_listen_connections );
+            do_accept();
+         }
+
+         /// @pre the thread pool of the acceptor is stopped
+         void close() {
+            boost::system::error_code ec;
+            const auto ep = acceptor.local_endpoint( ec );
+            acceptor.close( ec );
+            if( !ep.path().empty() ) ::unlink( ep.path().c_str() );
+         }
+
+      private:
+         void do_accept() {
+            acceptor.async_accept( [self=shared_from_this()]( const boost::system::error_code& ec, asio::local::stream_protocol::socket socket ) {
+               if( ec ) {
+                  if( ec == asio::error::operation_aborted || !self->acceptor.is_open() ) return;
+                  fc_elog( logger, "error accepting framed unix socket connection: ${m}", ("m", ec.message()) );
+               } else {
+                  std::make_shared<framed_unix_session>( std::move( socket ), self->impl )->run();
+               }
+               self->do_accept();
+            } );
+         }
+
+         asio::local::stream_protocol::acceptor acceptor;
+         http_plugin_impl_ptr                   impl;
+   };
 #endif
 
    http_plugin::http_plugin():my(new http_plugin_impl()){
@@ -653,6 +2032,9 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
          cfg.add_options()
             ("unix-socket-path", bpo::value<string>(),
              "The filename (relative to data-dir) to create a unix socket for HTTP RPC; set blank to disable.");
+      cfg.add_options()
+            ("framed-unix-socket-path", bpo::value<string>(),
+             "The filename (relative to data-dir) to create a unix socket serving the RPC API with framed requests, without http, for local tools; leave blank to disable.");
 #endif
 
       if(current_http_plugin_defaults.default_http_port)
@@ -712,6 +2094,8 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
              "Maximum size in megabytes http_plugin should use for processing http requests. 503 error response when exceeded." )
             ("http-max-response-time-ms", bpo::value<uint32_t>()->default_value(30),
              "Maximum time for processing a request.")
+            ("http-main-thread-budget-ms", bpo::value<uint32_t>()->default_value(0),
+             "Main thread time in milliseconds that requests may take one after another before the requests waiting are queued behind the blocks, transactions and other main thread work, 0 to never yield.")
             ("verbose-http-errors", bpo::bool_switch()->default_value(false),
              "Append the error log to HTTP responses")
             ("http-validate-host", boost::program_options::value<bool>()->default_value(true),
@@ -720,6 +2104,30 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
              "Additionaly acceptable values for the \"Host\" header of incoming HTTP requests, can be specified multiple times.  Includes http/s_server_address by default.")
             ("http-threads", bpo::value<uint16_t>()->default_value( my->thread_pool_size ),
              "Number of worker threads in http thread pool")
+            ("http-threads-cpu", bpo::value<std::vector<string>>()->composing()->multitoken(),
+             "CPUs to pin the worker threads of the http thread pool to in turn, as for chain-threads-cpu, unpinned if not given")
+            ("http-keep-alive", bpo::bool_switch()->default_value(false),
+             "Keep connections to http-server-address open between requests, answering pipelined requests in order, instead of closing them after each response")
+            ("http-keep-alive-timeout-sec", bpo::value<uint32_t>()->default_value(60),
+             "Seconds an idle connection to http-server-address is kept open when http-keep-alive is set")
+            ("http-compression-min-size", bpo::value<uint32_t>()->default_value(0),
+             "Minimum size in bytes of a response to gzip compress on the http threads for requests with Accept-Encoding: gzip, 0 to disable compression")
+            ("http-compression-level", bpo::value<uint32_t>()->default_value(1),
+             "gzip compression level of responses, from 1 (fastest) to 9 (smallest), bounding the http thread time spent compressing")
+            ("http-max-in-flight-per-endpoint", bpo::value<vector<string>>()->composing(),
+             "Maximum cost of the requests in flight for an endpoint, as <url>=<cost>, where a request costs 1 plus 1 per 100 of its limit parameter. "
+             "429 error response when exceeded. Can be specified multiple times.")
+            ("http-max-in-flight-per-client", bpo::value<uint32_t>()->default_value(0),
+             "Maximum number of requests in flight from one client IP address, 0 for no limit. 429 error response when exceeded.")
+            ("http-max-cost-per-sec-per-client", bpo::value<uint32_t>()->default_value(0),
+             "Maximum cost of the requests from one client IP address per second, 0 for no limit. 429 error response when exceeded.")
+            ("http-response-cache-size", bpo::value<uint32_t>()->default_value(0),
+             "Number of responses of cacheable endpoints, such as chain get_info and get_account, kept and answered from the http threads until the next block, 0 to disable. "
+             "Cached responses do not reflect transactions applied to the pending block since they were computed.")
+            ("http-max-subscriptions-per-connection", bpo::value<uint32_t>()->default_value(32),
+             "Maximum number of subscriptions of one websocket connection to /v1/subscribe")
+            ("http-max-subscription-buffer-kb", bpo::value<uint32_t>()->default_value(1024),
+             "Maximum size in kilobytes of the notifications waiting to be sent to a websocket connection to /v1/subscribe, the connection is closed when exceeded")
             ;
    }
 
@@ -758,6 +2166,12 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
                sock_path = app().data_dir() / sock_path;
             my->unix_endpoint = asio::local::stream_protocol::endpoint(sock_path.string());
          }
+         if( options.count( "framed-unix-socket-path" ) && !options.at( "framed-unix-socket-path" ).as<string>().empty()) {
+            boost::filesystem::path sock_path = options.at("framed-unix-socket-path").as<string>();
+            if (sock_path.is_relative())
+               sock_path = app().data_dir() / sock_path;
+            my->framed_unix_endpoint = asio::local::stream_protocol::endpoint(sock_path.string());
+         }
 #endif
 
          if( options.count( "https-server-address" ) && options.at( "https-server-address" ).as<string>().length()) {
@@ -799,9 +2213,39 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
          my->thread_pool_size = options.at( "http-threads" ).as<uint16_t>();
          EOS_ASSERT( my->thread_pool_size > 0, chain::plugin_config_exception,
                      "http-threads ${num} must be greater than 0", ("num", my->thread_pool_size));
+         if( options.count( "http-threads-cpu" ) )
+            my->thread_pool_cpus = chain::parse_cpus( options.at( "http-threads-cpu" ).as<std::vector<string>>() );
 
          my->max_bytes_in_flight = options.at( "http-max-bytes-in-flight-mb" ).as<uint32_t>() * 1024 * 1024;
          my->max_response_time = fc::microseconds( options.at("http-max-response-time-ms").as<uint32_t>() * 1000 );
+         my->main_thread_budget = fc::milliseconds( options.at( "http-main-thread-budget-ms" ).as<uint32_t>() );
+         my->response_cache_size = options.at( "http-response-cache-size" ).as<uint32_t>();
+         my->compression_min_size = options.at( "http-compression-min-size" ).as<uint32_t>();
+
+         if( options.count( "http-max-in-flight-per-endpoint" )) {
+            for( const auto& limit : options.at( "http-max-in-flight-per-endpoint" ).as<vector<string>>()) {
+               auto eq = limit.rfind( '=' );
+               EOS_ASSERT( eq != string::npos && eq > 0, chain::plugin_config_exception,
+                           "http-max-in-flight-per-endpoint ${l} is not <url>=<cost>", ("l", limit));
+               uint64_t cost = 0;
+               try {
+                  cost = std::stoull( limit.substr( eq + 1 ));
+               } catch( ... ) {}
+               EOS_ASSERT( cost > 0 && cost <= std::numeric_limits<uint32_t>::max(), chain::plugin_config_exception,
+                           "http-max-in-flight-per-endpoint ${l} must have a cost greater than 0", ("l", limit));
+               my->endpoint_max_in_flight[limit.substr( 0, eq )] = cost;
+            }
+         }
+         my->client_max_in_flight = options.at( "http-max-in-flight-per-client" ).as<uint32_t>();
+         my->client_max_cost_per_sec = options.at( "http-max-cost-per-sec-per-client" ).as<uint32_t>();
+         const auto compression_level = options.at( "http-compression-level" ).as<uint32_t>();
+         EOS_ASSERT( compression_level >= 1 && compression_level <= 9, chain::plugin_config_exception,
+                     "http-compression-level ${l} must be from 1 to 9", ("l", compression_level));
+         my->compression_level = compression_level;
+         my->keep_alive = options.at( "http-keep-alive" ).as<bool>();
+         my->keep_alive_timeout = std::chrono::seconds( options.at( "http-keep-alive-timeout-sec" ).as<uint32_t>() );
+         my->max_subscriptions_per_connection = options.at( "http-max-subscriptions-per-connection" ).as<uint32_t>();
+         my->max_subscription_buffer = size_t(options.at( "http-max-subscription-buffer-kb" ).as<uint32_t>()) * 1024;
 
          //watch out for the returns above when adding new code here
       } FC_LOG_AND_RETHROW()
@@ -813,14 +2257,20 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
       app().post(appbase::priority::high, [this] ()
       {
          try {
-            my->thread_pool.emplace( "http", my->thread_pool_size );
+            my->thread_pool.emplace( "http", my->thread_pool_size, my->thread_pool_cpus );
             if(my->listen_endpoint) {
                try {
-                  my->create_server_for_endpoint(*my->listen_endpoint, my->server);
-
-                  fc_ilog( logger, "start listening for http requests" );
-                  my->server.listen(*my->listen_endpoint);
-                  my->server.start_accept();
+                  if( my->keep_alive ) {
+                     fc_ilog( logger, "start listening for http requests on persistent connections" );
+                     my->beast_listener = std::make_shared<beast_http_listener>( my );
+                     my->beast_listener->listen( *my->listen_endpoint );
+                  } else {
+                     my->create_server_for_endpoint(*my->listen_endpoint, my->server);
+
+                     fc_ilog( logger, "start listening for http requests" );
+                     my->server.listen(*my->listen_endpoint);
+                     my->server.start_accept();
+                  }
                } catch ( const fc::exception& e ){
                   fc_elog( logger, "http service failed to start: ${e}", ("e", e.to_detail_string()) );
                   throw;
@@ -844,6 +2294,7 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
                   my->unix_server.set_http_handler([this](connection_hdl hdl) {
                      my->handle_http_request<detail::asio_local_with_stub_log>( my->unix_server.get_con_from_hdl(hdl));
                   });
+                  my->add_subscription_handlers( my->unix_server );
                   my->unix_server.start_accept();
                } catch ( const fc::exception& e ){
                   fc_elog( logger, "unix socket service (${path}) failed to start: ${e}", ("e", e.to_detail_string())("path",my->unix_endpoint->path()) );
@@ -856,6 +2307,22 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
                   throw;
                }
             }
+            if(my->framed_unix_endpoint) {
+               try {
+                  fc_ilog( logger, "start listening for framed requests on ${path}", ("path",my->framed_unix_endpoint->path()) );
+                  my->framed_listener = std::make_shared<framed_unix_listener>( my );
+                  my->framed_listener->listen( *my->framed_unix_endpoint );
+               } catch ( const fc::exception& e ){
+                  fc_elog( logger, "framed unix socket service (${path}) failed to start: ${e}", ("e", e.to_detail_string())("path",my->framed_unix_endpoint->path()) );
+                  throw;
+               } catch ( const std::exception& e ){
+                  fc_elog( logger, "framed unix socket service (${path}) failed to start: ${e}", ("e", e.what())("path",my->framed_unix_endpoint->path()) );
+                  throw;
+               } catch (...) {
+                  fc_elog( logger, "error thrown from framed unix socket (${path}) io service", ("path",my->framed_unix_endpoint->path()) );
+                  throw;
+               }
+            }
 #endif
             if(my->https_listen_endpoint) {
                try {
@@ -914,11 +2381,31 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
 
       if( my->thread_pool ) {
          my->thread_pool->stop();
+         // the acceptor has to go before the io_context of the thread pool
+         if( my->beast_listener ) {
+            my->beast_listener->close();
+            my->beast_listener.reset();
+         }
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+         if( my->framed_listener ) {
+            my->framed_listener->close();
+            my->framed_listener.reset();
+         }
+#endif
          my->thread_pool.reset();
       }
 
       // release http_plugin_impl_ptr shared_ptrs captured in url handlers
       my->url_handlers.clear();
+      my->binary_url_handlers.clear();
+      my->subscription_handlers.clear();
+      {
+         std::lock_guard<std::mutex> g( my->ws_conns_mtx );
+         for( auto& c : my->ws_conns ) {
+            c.second->close_subscriptions();
+         }
+         my->ws_conns.clear();
+      }
 
       app().post( 0, [me = my](){} ); // keep my pointer alive until queue is drained
    }
@@ -928,11 +2415,63 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
       my->url_handlers[url] = my->make_app_thread_url_handler(priority, handler, my);
    }
 
+   void http_plugin::add_binary_handler(const string& url, const url_handler& handler, int priority) {
+      fc_ilog( logger, "add binary api url: ${c}", ("c", url) );
+      my->binary_url_handlers[url] = my->make_app_thread_url_handler(priority, handler, my);
+   }
+
+   void http_plugin::add_cached_handler(const string& url, const url_handler& handler, int priority) {
+      if( !my->response_cache_size ) {
+         add_handler( url, handler, priority );
+         return;
+      }
+      fc_ilog( logger, "add cached api url: ${c}", ("c", url) );
+      my->url_handlers[url] = my->make_cached_url_handler( my->make_app_thread_url_handler(priority, handler, my), my );
+   }
+
+   void http_plugin::add_json_handler(const string& url, const url_json_handler& handler, int priority) {
+      fc_ilog( logger, "add api url: ${c}", ("c", url) );
+      my->url_handlers[url] = my->make_app_thread_json_url_handler(priority, handler, false, my);
+   }
+
+   void http_plugin::add_cached_json_handler(const string& url, const url_json_handler& handler, int priority) {
+      const bool cached = my->response_cache_size != 0;
+      fc_ilog( logger, cached ? "add cached api url: ${c}" : "add api url: ${c}", ("c", url) );
+      my->url_handlers[url] = my->make_app_thread_json_url_handler(priority, handler, cached, my);
+   }
+
+   void http_plugin::invalidate_cached_responses() {
+      my->invalidate_cached_responses();
+   }
+
+   void http_plugin::add_subscription_handler(const string& topic, const subscription_handler& handler, int priority) {
+      fc_ilog( logger, "add subscription topic: ${t}", ("t", topic) );
+      my->subscription_handlers[topic] = std::make_pair( priority, handler );
+   }
+
+   void http_plugin::add_async_json_handler(const string& url, const url_json_handler& handler) {
+      fc_ilog( logger, "add api url: ${c}", ("c", url) );
+      my->url_handlers[url] = my->make_http_thread_json_url_handler(handler, my);
+   }
+
+   void http_plugin::add_async_text_handler(const string& url, std::function<string()> text, const string& content_type) {
+      fc_ilog( logger, "add api url: ${c}", ("c", url) );
+      my->url_handlers[url] = my->make_http_thread_text_url_handler(std::move(text), content_type, my);
+   }
+
    void http_plugin::add_async_handler(const string& url, const url_handler& handler) {
       fc_ilog( logger, "add api url: ${c}", ("c", url) );
       my->url_handlers[url] = my->make_http_thread_url_handler(handler);
    }
 
+   void http_plugin::post_http_thread_pool( std::function<void()> f ) {
+      if( my->thread_pool ) {
+         boost::asio::post( my->thread_pool->get_executor(), std::move( f ) );
+      } else {
+         f();
+      }
+   }
+
    void http_plugin::handle_exception( const char *api_name, const char *call_name, const string& body, url_response_callback cb ) {
       try {
          try {
@@ -27,6 +27,22 @@ namespace eosio {
     **/
    using url_handler = std::function<void(string,string,url_response_callback)>;
 
+   /**
+    * @brief A callback provided to a url_json_handler to respond with a body already
+    * serialized to JSON, which is sent as is
+    *
+    * Arguments: response_code, response_json
+    */
+   using url_json_response_callback = std::function<void(int,std::shared_ptr<const string>)>;
+
+   /**
+    * @brief Callback type for a URL handler that may respond with either callback, url_response_callback for
+    * variants such as errors and url_json_response_callback for JSON it keeps serialized
+    *
+    * Arguments: url, request_body, response_callback, json_response_callback
+    **/
+   using url_json_handler = std::function<void(string,string,url_response_callback,url_json_response_callback)>;
+
    /**
     * @brief An API, containing URLs and handlers
     *
@@ -36,6 +52,32 @@ namespace eosio {
     */
    using api_description = std::map<string, url_handler>;
 
+   /**
+    * @brief A subscription of a websocket client to a topic
+    *
+    * The client is sent notifications until it unsubscribes or disconnects
+    */
+   struct subscription {
+      virtual ~subscription() {}
+
+      /// send data to the client as a notification of the subscription, may be called from any thread
+      virtual void send( fc::variant data ) = 0;
+
+      /// @return false once the client unsubscribed or disconnected, the subscription can then be dropped
+      virtual bool active() const = 0;
+   };
+   using subscription_ptr = std::shared_ptr<subscription>;
+
+   /**
+    * @brief Callback type for a subscription handler
+    *
+    * Called from the appbase application io_service thread with the params of a subscribe message. The handler
+    * keeps the subscription to notify the client of changes, or throws to refuse it.
+    *
+    * Arguments: params, subscription
+    */
+   using subscription_handler = std::function<void(const fc::variant&, const subscription_ptr&)>;
+
    struct http_plugin_defaults {
       //If empty, unix socket support will be completely disabled. If not empty,
       // unix socket support is enabled with the given default path (treated relative
@@ -83,12 +125,54 @@ namespace eosio {
               add_handler(call.first, call.second, priority);
         }
 
+        /**
+         * add a handler as add_handler does, for the requests to url with Content-Type: application/octet-stream.
+         * The body is fc::raw packed, and the handler responds with a fc::blob variant sent as is, or with a variant
+         * sent as JSON on error.
+         */
+        void add_binary_handler(const string& url, const url_handler&, int priority = appbase::priority::medium_low);
+
+        /**
+         * add a handler as add_handler does, whose successful responses are kept by url and body and sent from the
+         * http threads until invalidate_cached_responses(), when http-response-cache-size is set
+         */
+        void add_cached_handler(const string& url, const url_handler&, int priority = appbase::priority::medium_low);
+        void add_cached_api(const api_description& api, int priority = appbase::priority::medium_low) {
+           for (const auto& call : api)
+              add_cached_handler(call.first, call.second, priority);
+        }
+
+        /// add a handler run on the app thread as add_handler does, which may respond with serialized JSON
+        void add_json_handler(const string& url, const url_json_handler&, int priority = appbase::priority::medium_low);
+
+        /// add a handler as add_json_handler does, whose successful responses are cached as add_cached_handler does
+        void add_cached_json_handler(const string& url, const url_json_handler&, int priority = appbase::priority::medium_low);
+
+        /// drop every cached response, for the plugins adding cached handlers to call when the state they answer from changes
+        void invalidate_cached_responses();
+
+        /**
+         * add a handler for the subscribe messages to topic, sent by the websocket clients connected to
+         * /v1/subscribe
+         */
+        void add_subscription_handler(const string& topic, const subscription_handler&, int priority = appbase::priority::medium_low);
+
         void add_async_handler(const string& url, const url_handler& handler);
+
+        /// add a handler called on an http thread as add_async_handler does, which may respond with serialized JSON
+        void add_async_json_handler(const string& url, const url_json_handler& handler);
+
+        /// add a handler called on an http thread responding 200 with the text returned by text, sent as content_type
+        void add_async_text_handler(const string& url, std::function<string()> text,
+                                    const string& content_type = "text/plain; version=0.0.4");
         void add_async_api(const api_description& api) {
            for (const auto& call : api)
               add_handler(call.first, call.second);
         }
 
+        /// run f on an http thread, used by handlers to finish expensive work after leaving the main thread
+        void post_http_thread_pool( std::function<void()> f );
+
         // standard exception handling for api handlers
         static void handle_exception( const char *api_name, const char *call_name, const string& body, url_response_callback cb );
 
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <eosio/http_plugin/http_plugin.hpp>
+
+#include <appbase/application.hpp>
+
+namespace eosio {
+
+using namespace appbase;
+
+/**
+ * Serves the metrics of the node, see eosio/chain/metrics.hpp, at /v1/metrics in the Prometheus text format. The
+ * response is written on an http thread from the counters as they are, it never waits on the main thread.
+ */
+class metrics_plugin : public plugin<metrics_plugin> {
+public:
+   APPBASE_PLUGIN_REQUIRES((http_plugin))
+
+   metrics_plugin();
+   metrics_plugin(const metrics_plugin&) = delete;
+   metrics_plugin(metrics_plugin&&) = delete;
+   metrics_plugin& operator=(const metrics_plugin&) = delete;
+   metrics_plugin& operator=(metrics_plugin&&) = delete;
+   virtual ~metrics_plugin() override;
+
+   virtual void set_program_options(options_description& cli, options_description& cfg) override {}
+   void plugin_initialize(const variables_map& vm);
+   void plugin_startup();
+   void plugin_shutdown();
+};
+
+}
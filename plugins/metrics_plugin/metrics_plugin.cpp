@@ -0,0 +1,26 @@
+#include <eosio/metrics_plugin/metrics_plugin.hpp>
+#include <eosio/chain/metrics.hpp>
+
+#include <sstream>
+
+namespace eosio {
+
+static appbase::abstract_plugin& _metrics_plugin = app().register_plugin<metrics_plugin>();
+
+metrics_plugin::metrics_plugin() {}
+
+metrics_plugin::~metrics_plugin() = default;
+
+void metrics_plugin::plugin_initialize(const variables_map& options) {}
+
+void metrics_plugin::plugin_startup() {
+   app().get_plugin<http_plugin>().add_async_text_handler( "/v1/metrics", []() {
+      std::ostringstream out;
+      chain::write_prometheus_metrics( out );
+      return out.str();
+   } );
+}
+
+void metrics_plugin::plugin_shutdown() {}
+
+}
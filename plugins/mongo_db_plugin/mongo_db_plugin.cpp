@@ -15,6 +15,7 @@
 #include <boost/chrono.hpp>
 #include <boost/signals2/connection.hpp>
 
+#include <optional>
 #include <queue>
 #include <thread>
 #include <mutex>
@@ -60,6 +61,80 @@ struct filter_entry {
    }
 };
 
+/**
+ * The writes of a batch into one collection, executed as a single unordered bulk write. When a document is
+ * upserted again the writes appended before are executed first, so the upserts of one document apply in order.
+ */
+class collection_bulk {
+public:
+   collection_bulk( mongocxx::collection& collection, const std::string& collection_name )
+   :collection( collection )
+   ,collection_name( collection_name )
+   {}
+
+   void insert( bsoncxx::document::view_or_value doc ) {
+      mongocxx::model::insert_one insert_op{ std::move( doc ) };
+      get_bulk().append( insert_op );
+      ++size;
+   }
+
+   /// @param key : identifies the upserted document within the batch
+   void upsert( const std::string& key, bsoncxx::document::view_or_value filter, bsoncxx::document::view_or_value update ) {
+      if( upserted.count( key ) ) {
+         execute();
+      }
+      mongocxx::model::update_one update_op{ std::move( filter ), std::move( update ) };
+      update_op.upsert( true );
+      get_bulk().append( update_op );
+      upserted.insert( key );
+      ++size;
+   }
+
+   /// @throws mongo_db_insert_fail if the bulk write failed
+   void execute() {
+      if( size == 0 ) return;
+      auto b = std::move( *bulk );
+      bulk.reset();
+      upserted.clear();
+      const size_t written = size;
+      size = 0;
+      if( !b.execute() ) {
+         EOS_ASSERT( false, chain::mongo_db_insert_fail, "Bulk write of ${n} documents into ${c} failed",
+                     ("n", written)("c", collection_name) );
+      }
+   }
+
+private:
+   mongocxx::bulk_write& get_bulk() {
+      if( !bulk ) {
+         mongocxx::options::bulk_write bulk_opts;
+         bulk_opts.ordered( false );
+         bulk.emplace( collection.create_bulk_write( bulk_opts ) );
+      }
+      return *bulk;
+   }
+
+   mongocxx::collection&             collection;
+   const std::string                 collection_name;
+   std::optional<mongocxx::bulk_write> bulk;
+   std::set<std::string>             upserted;
+   size_t                            size = 0;
+};
+
+namespace {
+
+void handle_mongo_exception( const std::string& desc, int line_num );
+
+void execute_bulk( collection_bulk& bulk, const std::string& desc ) {
+   try {
+      bulk.execute();
+   } catch( ... ) {
+      handle_mongo_exception( desc, __LINE__ );
+   }
+}
+
+} // anonymous namespace
+
 class mongo_db_plugin_impl {
 public:
    mongo_db_plugin_impl();
@@ -76,11 +151,12 @@ public:
    void applied_irreversible_block(const chain::block_state_ptr&);
    void accepted_transaction(const chain::transaction_metadata_ptr&);
    void applied_transaction(const chain::transaction_trace_ptr&);
-   void process_accepted_transaction(const chain::transaction_metadata_ptr&);
-   void _process_accepted_transaction(const chain::transaction_metadata_ptr&);
-   void process_applied_transaction(const chain::transaction_trace_ptr&);
-   void _process_applied_transaction(const chain::transaction_trace_ptr&);
-   void process_accepted_block( const chain::block_state_ptr& );
+   void process_accepted_transaction(const chain::transaction_metadata_ptr&, collection_bulk& trans);
+   void _process_accepted_transaction(const chain::transaction_metadata_ptr&, collection_bulk& trans);
+   void process_applied_transaction(const chain::transaction_trace_ptr&, collection_bulk& trans_traces, collection_bulk& action_traces);
+   void _process_applied_transaction(const chain::transaction_trace_ptr&, collection_bulk& trans_traces, collection_bulk& action_traces);
+   void process_accepted_block( const chain::block_state_ptr&, collection_bulk& block_states, collection_bulk& blocks );
+   void _process_accepted_block( const chain::block_state_ptr&, collection_bulk& block_states, collection_bulk& blocks );
    void _process_accepted_block( const chain::block_state_ptr& );
    void process_irreversible_block(const chain::block_state_ptr&);
    void _process_irreversible_block(const chain::block_state_ptr&);
@@ -90,7 +166,7 @@ public:
 
    void purge_abi_cache();
 
-   bool add_action_trace( mongocxx::bulk_write& bulk_action_traces, const chain::action_trace& atrace,
+   bool add_action_trace( collection_bulk& bulk_action_traces, const chain::action_trace& atrace,
                           const chain::transaction_trace_ptr& t,
                           bool executed, const std::chrono::milliseconds& now,
                           bool& write_ttrace );
@@ -148,7 +224,7 @@ public:
    mongocxx::collection _account_controls;
 
    size_t max_queue_size = 0;
-   int queue_sleep_time = 0;
+   fc::time_point last_queue_size_warning; ///< only accessed by the main thread
    size_t abi_cache_size = 0;
    std::deque<chain::transaction_metadata_ptr> transaction_metadata_queue;
    std::deque<chain::transaction_metadata_ptr> transaction_metadata_process_queue;
@@ -287,22 +363,19 @@ bool mongo_db_plugin_impl::filter_include( const transaction& trx ) const
 template<typename Queue, typename Entry>
 void mongo_db_plugin_impl::queue( Queue& queue, const Entry& e ) {
    std::unique_lock<std::mutex> lock( mtx );
-   auto queue_size = queue.size();
-   if( queue_size > max_queue_size ) {
-      lock.unlock();
-      condition.notify_one();
-      queue_sleep_time += 10;
-      if( queue_sleep_time > 1000 )
-         wlog("queue size: ${q}", ("q", queue_size));
-      std::this_thread::sleep_for( std::chrono::milliseconds( queue_sleep_time ));
-      lock.lock();
-   } else {
-      queue_sleep_time -= 10;
-      if( queue_sleep_time < 0 ) queue_sleep_time = 0;
-   }
    queue.emplace_back( e );
+   auto queue_size = queue.size();
    lock.unlock();
    condition.notify_one();
+
+   // never wait for the consume thread here, it would hold up the application of blocks
+   if( queue_size > max_queue_size ) {
+      auto now = fc::time_point::now();
+      if( now - last_queue_size_warning > fc::seconds( 10 ) ) {
+         wlog("queue size: ${q}, mongodb is not keeping up", ("q", queue_size));
+         last_queue_size_warning = now;
+      }
+   }
 }
 
 void mongo_db_plugin_impl::accepted_transaction( const chain::transaction_metadata_ptr& t ) {
@@ -442,11 +515,15 @@ void mongo_db_plugin_impl::consume_blocks() {
          // process transactions
          auto start_time = fc::time_point::now();
          auto size = transaction_trace_process_queue.size();
+         collection_bulk trans_traces_bulk( _trans_traces, trans_traces_col );
+         collection_bulk action_traces_bulk( _action_traces, action_traces_col );
          while (!transaction_trace_process_queue.empty()) {
             const auto& t = transaction_trace_process_queue.front();
-            process_applied_transaction(t);
+            process_applied_transaction(t, trans_traces_bulk, action_traces_bulk);
             transaction_trace_process_queue.pop_front();
          }
+         execute_bulk( trans_traces_bulk, "trans_traces insert" );
+         execute_bulk( action_traces_bulk, "action traces insert" );
          auto time = fc::time_point::now() - start_time;
          auto per = size > 0 ? time.count()/size : 0;
          if( time > fc::microseconds(500000) ) // reduce logging, .5 secs
@@ -454,11 +531,13 @@ void mongo_db_plugin_impl::consume_blocks() {
 
          start_time = fc::time_point::now();
          size = transaction_metadata_process_queue.size();
+         collection_bulk trans_bulk( _trans, trans_col );
          while (!transaction_metadata_process_queue.empty()) {
             const auto& t = transaction_metadata_process_queue.front();
-            process_accepted_transaction(t);
+            process_accepted_transaction(t, trans_bulk);
             transaction_metadata_process_queue.pop_front();
          }
+         execute_bulk( trans_bulk, "trans insert" );
          time = fc::time_point::now() - start_time;
          per = size > 0 ? time.count()/size : 0;
          if( time > fc::microseconds(500000) ) // reduce logging, .5 secs
@@ -467,11 +546,16 @@ void mongo_db_plugin_impl::consume_blocks() {
          // process blocks
          start_time = fc::time_point::now();
          size = block_state_process_queue.size();
+         collection_bulk block_states_bulk( _block_states, block_states_col );
+         collection_bulk blocks_bulk( _blocks, blocks_col );
          while (!block_state_process_queue.empty()) {
             const auto& bs = block_state_process_queue.front();
-            process_accepted_block( bs );
+            process_accepted_block( bs, block_states_bulk, blocks_bulk );
             block_state_process_queue.pop_front();
          }
+         // executed ahead of the irreversible blocks, which update these documents
+         execute_bulk( block_states_bulk, "block_states insert" );
+         execute_bulk( blocks_bulk, "blocks insert" );
          time = fc::time_point::now() - start_time;
          per = size > 0 ? time.count()/size : 0;
          if( time > fc::microseconds(500000) ) // reduce logging, .5 secs
@@ -680,10 +764,10 @@ fc::variant mongo_db_plugin_impl::to_variant_with_abi( const T& obj ) {
    return pretty_output;
 }
 
-void mongo_db_plugin_impl::process_accepted_transaction( const chain::transaction_metadata_ptr& t ) {
+void mongo_db_plugin_impl::process_accepted_transaction( const chain::transaction_metadata_ptr& t, collection_bulk& trans ) {
    try {
       if( start_block_reached ) {
-         _process_accepted_transaction( t );
+         _process_accepted_transaction( t, trans );
       }
    } catch (fc::exception& e) {
       elog("FC Exception while processing accepted transaction metadata: ${e}", ("e", e.to_detail_string()));
@@ -694,10 +778,11 @@ void mongo_db_plugin_impl::process_accepted_transaction( const chain::transactio
    }
 }
 
-void mongo_db_plugin_impl::process_applied_transaction( const chain::transaction_trace_ptr& t ) {
+void mongo_db_plugin_impl::process_applied_transaction( const chain::transaction_trace_ptr& t, collection_bulk& trans_traces,
+                                                        collection_bulk& action_traces ) {
    try {
       // always call since we need to capture setabi on accounts even if not storing transaction traces
-      _process_applied_transaction( t );
+      _process_applied_transaction( t, trans_traces, action_traces );
    } catch (fc::exception& e) {
       elog("FC Exception while processing applied transaction trace: ${e}", ("e", e.to_detail_string()));
    } catch (std::exception& e) {
@@ -721,10 +806,10 @@ void mongo_db_plugin_impl::process_irreversible_block(const chain::block_state_p
   }
 }
 
-void mongo_db_plugin_impl::process_accepted_block( const chain::block_state_ptr& bs ) {
+void mongo_db_plugin_impl::process_accepted_block( const chain::block_state_ptr& bs, collection_bulk& block_states, collection_bulk& blocks ) {
    try {
       if( start_block_reached ) {
-         _process_accepted_block( bs );
+         _process_accepted_block( bs, block_states, blocks );
       }
    } catch (fc::exception& e) {
       elog("FC Exception while processing accepted block trace ${e}", ("e", e.to_string()));
@@ -735,7 +820,7 @@ void mongo_db_plugin_impl::process_accepted_block( const chain::block_state_ptr&
    }
 }
 
-void mongo_db_plugin_impl::_process_accepted_transaction( const chain::transaction_metadata_ptr& t ) {
+void mongo_db_plugin_impl::_process_accepted_transaction( const chain::transaction_metadata_ptr& t, collection_bulk& trans ) {
    using namespace bsoncxx::types;
    using bsoncxx::builder::basic::kvp;
    using bsoncxx::builder::basic::make_document;
@@ -800,12 +885,8 @@ void mongo_db_plugin_impl::_process_accepted_transaction( const chain::transacti
    trans_doc.append( kvp( "createdAt", b_date{now} ) );
 
    try {
-      mongocxx::options::update update_opts{};
-      update_opts.upsert( true );
-      if( !_trans.update_one( make_document( kvp( "trx_id", trx_id_str ) ),
-                              make_document( kvp( "$set", trans_doc.view() ) ), update_opts ) ) {
-         EOS_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert trans ${id}", ("id", trx_id) );
-      }
+      trans.upsert( trx_id_str, make_document( kvp( "trx_id", trx_id_str ) ),
+                    make_document( kvp( "$set", trans_doc.view() ) ) );
    } catch( ... ) {
       handle_mongo_exception( "trans insert", __LINE__ );
    }
@@ -813,7 +894,7 @@ void mongo_db_plugin_impl::_process_accepted_transaction( const chain::transacti
 }
 
 bool
-mongo_db_plugin_impl::add_action_trace( mongocxx::bulk_write& bulk_action_traces, const chain::action_trace& atrace,
+mongo_db_plugin_impl::add_action_trace( collection_bulk& bulk_action_traces, const chain::action_trace& atrace,
                                         const chain::transaction_trace_ptr& t,
                                         bool executed, const std::chrono::milliseconds& now,
                                         bool& write_ttrace )
@@ -848,8 +929,7 @@ mongo_db_plugin_impl::add_action_trace( mongocxx::bulk_write& bulk_action_traces
       }
       action_traces_doc.append( kvp( "createdAt", b_date{now} ) );
 
-      mongocxx::model::insert_one insert_op{action_traces_doc.view()};
-      bulk_action_traces.append( insert_op );
+      bulk_action_traces.insert( action_traces_doc.extract() );
       added = true;
    }
 
@@ -857,7 +937,8 @@ mongo_db_plugin_impl::add_action_trace( mongocxx::bulk_write& bulk_action_traces
 }
 
 
-void mongo_db_plugin_impl::_process_applied_transaction( const chain::transaction_trace_ptr& t ) {
+void mongo_db_plugin_impl::_process_applied_transaction( const chain::transaction_trace_ptr& t, collection_bulk& trans_traces,
+                                                         collection_bulk& bulk_action_traces ) {
    using namespace bsoncxx::types;
    using bsoncxx::builder::basic::kvp;
 
@@ -866,16 +947,12 @@ void mongo_db_plugin_impl::_process_applied_transaction( const chain::transactio
    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
          std::chrono::microseconds{fc::time_point::now().time_since_epoch().count()});
 
-   mongocxx::options::bulk_write bulk_opts;
-   bulk_opts.ordered(false);
-   mongocxx::bulk_write bulk_action_traces = _action_traces.create_bulk_write(bulk_opts);
-   bool write_atraces = false;
    bool write_ttrace = false; // filters apply to transaction_traces as well
    bool executed = t->receipt.valid() && t->receipt->status == chain::transaction_receipt_header::executed;
 
    for( const auto& atrace : t->action_traces ) {
       try {
-         write_atraces |= add_action_trace( bulk_action_traces, atrace, t, executed, now, write_ttrace );
+         add_action_trace( bulk_action_traces, atrace, t, executed, now, write_ttrace );
       } catch(...) {
          handle_mongo_exception("add action traces", __LINE__);
       }
@@ -898,41 +975,27 @@ void mongo_db_plugin_impl::_process_applied_transaction( const chain::transactio
          }
          trans_traces_doc.append( kvp( "createdAt", b_date{now} ) );
 
-         try {
-            if( !_trans_traces.insert_one( trans_traces_doc.view() ) ) {
-               EOS_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert trans ${id}", ("id", t->id) );
-            }
-         } catch( ... ) {
-            handle_mongo_exception( "trans_traces insert: " + t->id.str(), __LINE__ );
-         }
+         trans_traces.insert( trans_traces_doc.extract() );
       } catch( ... ) {
          handle_mongo_exception( "trans_traces serialization: " + t->id.str(), __LINE__ );
       }
    }
-
-   // insert action_traces
-   if( write_atraces ) {
-      try {
-         if( !bulk_action_traces.execute() ) {
-            EOS_ASSERT( false, chain::mongo_db_insert_fail,
-                        "Bulk action traces insert failed for transaction trace: ${id}", ("id", t->id) );
-         }
-      } catch( ... ) {
-         handle_mongo_exception( "action traces insert", __LINE__ );
-      }
-   }
-
 }
 
 void mongo_db_plugin_impl::_process_accepted_block( const chain::block_state_ptr& bs ) {
+   collection_bulk block_states( _block_states, block_states_col );
+   collection_bulk blocks( _blocks, blocks_col );
+   _process_accepted_block( bs, block_states, blocks );
+   execute_bulk( block_states, "block_states insert: " + bs->id.str() );
+   execute_bulk( blocks, "blocks insert: " + bs->id.str() );
+}
+
+void mongo_db_plugin_impl::_process_accepted_block( const chain::block_state_ptr& bs, collection_bulk& block_states, collection_bulk& blocks ) {
    using namespace bsoncxx::types;
    using namespace bsoncxx::builder;
    using bsoncxx::builder::basic::kvp;
    using bsoncxx::builder::basic::make_document;
 
-   mongocxx::options::update update_opts{};
-   update_opts.upsert( true );
-
    auto block_num = bs->block_num;
    if( block_num % 1000 == 0 )
       ilog( "block_num: ${b}", ("b", block_num) );
@@ -962,15 +1025,11 @@ void mongo_db_plugin_impl::_process_accepted_block( const chain::block_state_ptr
 
       try {
          if( update_blocks_via_block_num ) {
-            if( !_block_states.update_one( make_document( kvp( "block_num", b_int32{static_cast<int32_t>(block_num)} ) ),
-                                           make_document( kvp( "$set", block_state_doc.view() ) ), update_opts ) ) {
-               EOS_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert block_state ${num}", ("num", block_num) );
-            }
+            block_states.upsert( std::to_string( block_num ), make_document( kvp( "block_num", b_int32{static_cast<int32_t>(block_num)} ) ),
+                                 make_document( kvp( "$set", block_state_doc.view() ) ) );
          } else {
-            if( !_block_states.update_one( make_document( kvp( "block_id", block_id_str ) ),
-                                           make_document( kvp( "$set", block_state_doc.view() ) ), update_opts ) ) {
-               EOS_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert block_state ${bid}", ("bid", block_id) );
-            }
+            block_states.upsert( block_id_str, make_document( kvp( "block_id", block_id_str ) ),
+                                 make_document( kvp( "$set", block_state_doc.view() ) ) );
          }
       } catch( ... ) {
          handle_mongo_exception( "block_states insert: " + block_id_str, __LINE__ );
@@ -995,15 +1054,11 @@ void mongo_db_plugin_impl::_process_accepted_block( const chain::block_state_ptr
 
       try {
          if( update_blocks_via_block_num ) {
-            if( !_blocks.update_one( make_document( kvp( "block_num", b_int32{static_cast<int32_t>(block_num)} ) ),
-                                     make_document( kvp( "$set", block_doc.view() ) ), update_opts ) ) {
-               EOS_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert block ${num}", ("num", block_num) );
-            }
+            blocks.upsert( std::to_string( block_num ), make_document( kvp( "block_num", b_int32{static_cast<int32_t>(block_num)} ) ),
+                           make_document( kvp( "$set", block_doc.view() ) ) );
          } else {
-            if( !_blocks.update_one( make_document( kvp( "block_id", block_id_str ) ),
-                                     make_document( kvp( "$set", block_doc.view() ) ), update_opts ) ) {
-               EOS_ASSERT( false, chain::mongo_db_insert_fail, "Failed to insert block ${bid}", ("bid", block_id) );
-            }
+            blocks.upsert( block_id_str, make_document( kvp( "block_id", block_id_str ) ),
+                           make_document( kvp( "$set", block_doc.view() ) ) );
          }
       } catch( ... ) {
          handle_mongo_exception( "blocks insert: " + block_id_str, __LINE__ );
@@ -1510,7 +1565,7 @@ void mongo_db_plugin::set_program_options(options_description& cli, options_desc
 {
    cfg.add_options()
          ("mongodb-queue-size,q", bpo::value<uint32_t>()->default_value(1024),
-         "The target queue size between nodeos and MongoDB plugin thread.")
+         "The target queue size between nodeos and MongoDB plugin thread. Past it a warning is logged, nodeos is not slowed down.")
          ("mongodb-abi-cache-size", bpo::value<uint32_t>()->default_value(2048),
           "The maximum size of the abi cache for serializing data.")
          ("mongodb-wipe", bpo::bool_switch()->default_value(false),
@@ -1657,6 +1712,7 @@ void mongo_db_plugin::plugin_initialize(const variables_map& options)
                chain.accepted_transaction.connect( [&]( const chain::transaction_metadata_ptr& t ) {
                   my->accepted_transaction( t );
                } ));
+         chain.add_trace_consumer();
          my->applied_transaction_connection.emplace(
                chain.applied_transaction.connect( [&]( std::tuple<const chain::transaction_trace_ptr&, const chain::signed_transaction&> t ) {
                   my->applied_transaction( std::get<0>(t) );
@@ -1682,6 +1738,8 @@ void mongo_db_plugin::plugin_shutdown()
    my->accepted_block_connection.reset();
    my->irreversible_block_connection.reset();
    my->accepted_transaction_connection.reset();
+   if( my->applied_transaction_connection )
+      app().find_plugin<chain_plugin>()->chain().remove_trace_consumer();
    my->applied_transaction_connection.reset();
 
    my.reset();
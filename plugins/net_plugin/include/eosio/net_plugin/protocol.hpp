@@ -135,6 +135,43 @@ namespace eosio {
       uint32_t end_block{0};
    };
 
+   /// receipt of a transaction in a compact_block_message, with the id standing in for the packed transaction
+   struct compact_transaction_receipt : transaction_receipt_header {
+      transaction_id_type  id;
+      bool                 packed = true; ///< false if the receipt of the block holds just the id
+   };
+
+   /**
+    * A signed_block without its packed transactions, sent to peers of protocol proto_compact_block or later that are
+    * relayed the transactions ahead of the block. The receiver rebuilds the block from the transactions it has and
+    * requests the others with a request_message of their ids in req_trx and the block id in req_blocks, mode none; it
+    * gets back the transactions, or the signed_block if the peer no longer has them all.
+    */
+   struct compact_block_message {
+      signed_block_header                  header;
+      vector<compact_transaction_receipt>  transactions;
+      extensions_type                      block_extensions;
+   };
+
+   /**
+    * Asks a peer of protocol proto_snapshot_bootstrap or later for the bytes from offset of the compressed snapshot it
+    * serves to bootstrap new nodes, answered by a snapshot_chunk_message. block_id is empty for the newest one, and that
+    * of its first chunk for the next ones so that they all come from the same snapshot.
+    */
+   struct snapshot_request_message {
+      block_id_type  block_id;
+      uint64_t       offset{0};
+   };
+
+   /// size is 0 when the peer serves no snapshot, or no longer that of the block_id requested
+   struct snapshot_chunk_message {
+      block_id_type  block_id;
+      fc::sha256     integrity_hash; ///< stored at the end of the snapshot
+      uint64_t       size{0};        ///< of the whole snapshot
+      uint64_t       offset{0};
+      vector<char>   data;
+   };
+
    using net_message = static_variant<handshake_message,
                                       chain_size_message,
                                       go_away_message,
@@ -143,7 +180,10 @@ namespace eosio {
                                       request_message,
                                       sync_request_message,
                                       signed_block,         // which = 7
-                                      packed_transaction>;  // which = 8
+                                      packed_transaction,   // which = 8
+                                      compact_block_message,
+                                      snapshot_request_message,
+                                      snapshot_chunk_message>;
 
 } // namespace eosio
 
@@ -162,6 +202,10 @@ FC_REFLECT( eosio::time_message, (org)(rec)(xmt)(dst) )
 FC_REFLECT( eosio::notice_message, (known_trx)(known_blocks) )
 FC_REFLECT( eosio::request_message, (req_trx)(req_blocks) )
 FC_REFLECT( eosio::sync_request_message, (start_block)(end_block) )
+FC_REFLECT_DERIVED( eosio::compact_transaction_receipt, (eosio::chain::transaction_receipt_header), (id)(packed) )
+FC_REFLECT( eosio::compact_block_message, (header)(transactions)(block_extensions) )
+FC_REFLECT( eosio::snapshot_request_message, (block_id)(offset) )
+FC_REFLECT( eosio::snapshot_chunk_message, (block_id)(integrity_hash)(size)(offset)(data) )
 
 /**
  *
@@ -7,8 +7,12 @@
 #include <eosio/chain/block.hpp>
 #include <eosio/chain/plugin_interface.hpp>
 #include <eosio/chain/thread_utils.hpp>
+#include <eosio/chain/async_log.hpp>
 #include <eosio/producer_plugin/producer_plugin.hpp>
 #include <eosio/chain/contract_types.hpp>
+#include <eosio/chain/merkle.hpp>
+#include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/metrics.hpp>
 
 #include <fc/network/message_buffer.hpp>
 #include <fc/network/ip.hpp>
@@ -19,12 +23,18 @@
 #include <fc/reflect/variant.hpp>
 #include <fc/crypto/rand.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
 
+#include <array>
 #include <atomic>
+#include <deque>
+#include <fstream>
+#include <set>
 #include <shared_mutex>
 
 using namespace eosio::chain::plugin_interface;
@@ -32,6 +42,12 @@ using namespace eosio::chain::plugin_interface;
 namespace eosio {
    static appbase::abstract_plugin& _net_plugin = app().register_plugin<net_plugin>();
 
+   static chain::metric_gauge client_connections_metric( "nodeos_net_client_connections", "Connections accepted from p2p clients" );
+   static chain::metric_gauge peer_connections_metric( "nodeos_net_peer_connections", "Connections to the configured peers" );
+   static chain::metric_gauge write_queue_bytes_metric( "nodeos_net_write_queue_bytes", "Bytes queued to be written to the connections" );
+   static chain::metric_counter bytes_sent_metric( "nodeos_net_bytes_sent_total", "Bytes written to the connections" );
+   static chain::metric_counter bytes_received_metric( "nodeos_net_bytes_received_total", "Bytes read from the connections" );
+
    using std::vector;
 
    using boost::asio::ip::tcp;
@@ -43,6 +59,7 @@ namespace eosio {
    using fc::time_point_sec;
    using eosio::chain::transaction_id_type;
    using eosio::chain::sha256_less;
+   using eosio::chain::short_id;
 
    class connection;
 
@@ -90,6 +107,39 @@ namespace eosio {
       >
    node_transaction_index;
 
+   /**
+    * Thread safe. Bloom filter of the ids of the transactions seen, checked before node_transaction_index so that a
+    * transaction new to us is recognized without taking local_txns_mtx. The filter rotates between two generations:
+    * ids are added to the current one and the other is cleared and made current once every transaction in it has
+    * expired, so it never forgets an id the exact index still holds.
+    */
+   class transaction_filter {
+   public:
+      /// @param size_bytes of both generations, 0 disables the filter
+      explicit transaction_filter( size_t size_bytes );
+
+      void add( const transaction_id_type& id, time_point_sec expires );
+      /// @return false if id was definitely not added since it expired, always true if disabled
+      bool may_contain( const transaction_id_type& id ) const;
+      /// rotate generations if the other one only holds transactions expired by now
+      void expire( time_point_sec now );
+
+   private:
+      static constexpr uint32_t num_hashes = 4;
+
+      struct generation {
+         std::unique_ptr<std::atomic<uint64_t>[]>  words;
+         std::atomic<uint32_t>                     max_expires{0}; ///< seconds since epoch
+      };
+
+      template<typename Function>
+      void for_each_bit( const transaction_id_type& id, Function f ) const;
+
+      size_t                    num_words = 0; ///< per generation
+      std::array<generation, 2> gens;
+      std::atomic<uint32_t>     current{0};
+   };
+
    struct peer_block_state {
       block_id_type id;
       uint32_t      block_num = 0;
@@ -120,6 +170,35 @@ namespace eosio {
       >
       > peer_block_state_index;
 
+   struct cached_transaction {
+      transaction_id_type     id;
+      time_point_sec          expires;
+      uint32_t                block_num = 0; ///< block the transaction was included in
+      packed_transaction_ptr  trx;
+   };
+
+   typedef multi_index_container<
+      cached_transaction,
+      indexed_by<
+         ordered_unique< tag<by_id>, member<cached_transaction, transaction_id_type, &cached_transaction::id>, sha256_less >,
+         ordered_non_unique< tag<by_expiry>, member<cached_transaction, fc::time_point_sec, &cached_transaction::expires> >,
+         ordered_non_unique< tag<by_block_num>, member<cached_transaction, uint32_t, &cached_transaction::block_num> >
+      >
+      > cached_transaction_index;
+
+   struct block_buffer_state {
+      block_id_type                       id;
+      std::shared_ptr<std::vector<char>>  buffer; ///< serialized signed_block net_message, header included
+   };
+
+   typedef multi_index_container<
+      block_buffer_state,
+      indexed_by<
+         sequenced<>, // least recently used first
+         ordered_unique< tag<by_block_id>, member<block_buffer_state, block_id_type, &block_buffer_state::id>, sha256_less >
+      >
+      > block_buffer_index;
+
 
    struct update_block_num {
       uint32_t new_bnum;
@@ -145,16 +224,39 @@ namespace eosio {
       connection_ptr sync_source;
       std::atomic<stages> sync_state{in_sync};
 
+      struct sync_range {
+         connection_ptr source; // null while no peer is asked for the range
+         uint32_t       start = 0;
+         uint32_t       end = 0;
+      };
+
+      struct held_block {
+         connection_ptr    source;
+         block_id_type     id;
+         signed_block_ptr  block;
+      };
+
+      // parallel sync, only used with sync_peer_count > 1 in lib_catchup
+      const uint32_t                    sync_peer_count;
+      std::deque<sync_range>            sync_ranges;      // requested ranges in block order, the first one is applied next
+      std::map<uint32_t, held_block>    sync_held_blocks; // blocks of later ranges waiting for the first range to be applied
+
    private:
       constexpr static auto stage_str( stages s );
       bool set_state( stages s );
       bool is_sync_required( uint32_t fork_head_block_num );
       void request_next_chunk( std::unique_lock<std::mutex> g_sync, const connection_ptr& conn = connection_ptr() );
+      void request_parallel_chunks( std::unique_lock<std::mutex> g_sync, const connection_ptr& conn, const connection_ptr& skip = connection_ptr() );
+      bool parallel_sync() const { return sync_peer_count > 1 && sync_state == lib_catchup; }
+      std::deque<sync_range>::iterator find_sync_range( const connection_ptr& c );
+      void drop_held_blocks( const sync_range& r );
+      void release_held_blocks();
+      void reset_parallel_sync();
       void start_sync( const connection_ptr& c, uint32_t target );
       bool verify_catchup( const connection_ptr& c, uint32_t num, const block_id_type& id );
 
    public:
-      explicit sync_manager( uint32_t span );
+      sync_manager( uint32_t span, uint32_t peer_count );
       static void send_handshakes();
       bool syncing_with_peer() const { return sync_state == lib_catchup; }
       void sync_reset_lib_num( const connection_ptr& conn );
@@ -162,6 +264,8 @@ namespace eosio {
       void rejected_block( const connection_ptr& c, uint32_t blk_num );
       void sync_recv_block( const connection_ptr& c, const block_id_type& blk_id, uint32_t blk_num, bool blk_applied );
       void sync_update_expected( const connection_ptr& c, const block_id_type& blk_id, uint32_t blk_num, bool blk_applied );
+      /// @return true if the block belongs to a later range of a parallel sync and is held until the ranges before it are applied
+      bool hold_sync_block( const connection_ptr& c, const block_id_type& blk_id, const signed_block_ptr& b );
       void recv_handshake( const connection_ptr& c, const handshake_message& msg );
       void sync_recv_notice( const connection_ptr& c, const notice_message& msg );
    };
@@ -169,14 +273,26 @@ namespace eosio {
    class dispatch_manager {
       mutable std::mutex      blk_state_mtx;
       peer_block_state_index  blk_state;
+      /// received whole and not yet applied or rejected, with the connections whose copies were dropped meanwhile;
+      /// guarded by blk_state_mtx
+      std::map<block_id_type, std::vector<uint32_t>> blks_in_flight;
       mutable std::mutex      local_txns_mtx;
       node_transaction_index  local_txns;
+      transaction_filter      seen_txns;
+      mutable std::mutex        trx_cache_mtx;
+      cached_transaction_index  trx_cache;
+      std::mutex              blk_buffers_mtx;
+      block_buffer_index      blk_buffers;
+      size_t                  blk_buffers_size = 0;
+      const size_t            max_blk_buffers_size;
 
    public:
       boost::asio::io_context::strand  strand;
 
-      explicit dispatch_manager(boost::asio::io_context& io_context)
-      : strand( io_context ) {}
+      dispatch_manager(boost::asio::io_context& io_context, size_t max_block_buffers_size, size_t trx_filter_size)
+      : seen_txns( trx_filter_size )
+      , max_blk_buffers_size( max_block_buffers_size )
+      , strand( io_context ) {}
 
       void bcast_transaction(const packed_transaction& trx);
       void rejected_transaction(const packed_transaction_ptr& trx, uint32_t head_blk_num);
@@ -191,15 +307,41 @@ namespace eosio {
       void retry_fetch(const connection_ptr& conn);
 
       bool add_peer_block( const block_id_type& blkid, uint32_t connection_id );
+
+      /**
+       * Serialized net_message of block blkid, shared by every connection it is broadcast or synced to. create is called
+       * to pack the block when it is not cached. The least recently used buffers are dropped once the cache holds more
+       * than max_block_buffers_size bytes.
+       */
+      std::shared_ptr<std::vector<char>> get_block_buffer( const block_id_type& blkid,
+                                                           const std::function<std::shared_ptr<std::vector<char>>()>& create );
+      /// @return the cached net_message of block blkid, null if not cached
+      std::shared_ptr<std::vector<char>> find_block_buffer( const block_id_type& blkid );
       bool peer_has_block(const block_id_type& blkid, uint32_t connection_id) const;
       bool have_block(const block_id_type& blkid) const;
 
+      /**
+       * Claim the unpack and apply of block blkid received whole, so that the copies other peers send meanwhile are
+       * dropped without being unpacked. Until release_block, have_block does not yet know the block. The connections
+       * whose copies are dropped are remembered, rejected_block requests the block from them again.
+       * @return false if a copy of the block was claimed already
+       */
+      bool claim_block( const block_id_type& blkid, uint32_t connection_id );
+      /// the claimed block was applied or dropped
+      void release_block( const block_id_type& blkid );
+
       bool add_peer_txn( const node_transaction_state& nts );
       void update_txns_block_num( const signed_block_ptr& sb );
       void update_txns_block_num( const transaction_id_type& id, uint32_t blk_num );
       bool peer_has_txn( const transaction_id_type& tid, uint32_t connection_id ) const;
       bool have_txn( const transaction_id_type& tid ) const;
       void expire_txns( uint32_t lib_num );
+
+      /// keep a transaction accepted by this node so blocks including it can be sent and received as compact blocks
+      void cache_transaction( const packed_transaction_ptr& trx );
+      packed_transaction_ptr find_transaction( const transaction_id_type& tid ) const;
+      /// @return serialized compact_block_message of b, null if a transaction of b is not cached
+      std::shared_ptr<std::vector<char>> create_compact_block_buffer( const signed_block& b ) const;
    };
 
    class net_plugin_impl : public std::enable_shared_from_this<net_plugin_impl> {
@@ -238,6 +380,7 @@ namespace eosio {
       uint32_t                              max_client_count = 0;
       uint32_t                              max_nodes_per_host = 1;
       bool                                  p2p_accept_transactions = true;
+      fc::path                              snapshot_bootstrap_dir; ///< empty to serve no snapshot
 
       /// Peer clock may be no more than 1 second skewed from our clock, including network latency.
       const std::chrono::system_clock::duration peer_authentication_interval{std::chrono::seconds{1}};
@@ -269,6 +412,11 @@ namespace eosio {
       compat::channels::transaction_ack::channel_type::handle  incoming_transaction_ack_subscription;
 
       uint16_t                                  thread_pool_size = 2;
+      std::vector<uint16_t>                     thread_pool_cpus;
+      size_t                                    block_buffer_cache_size = def_block_buffer_cache_size_mb*1024*1024;
+      size_t                                    trx_filter_size = def_trx_filter_size_mb*1024*1024;
+      std::chrono::microseconds                 trx_flush_interval{def_trx_flush_interval_us};
+      uint32_t                                  trx_flush_size = def_trx_flush_size;
       optional<eosio::chain::named_thread_pool> thread_pool;
 
    private:
@@ -280,8 +428,25 @@ namespace eosio {
       block_id_type                 chain_head_blk_id;
       block_id_type                 chain_fork_head_blk_id;
 
+      /**
+       * Thread safe, updated with the chain info. What transactions received are checked against before they are passed on
+       * to the chain, see check_transaction.
+       *  @{
+       */
+      std::atomic<uint32_t>         max_trx_lifetime_sec{0};
+      std::atomic<uint32_t>         max_trx_net_usage{0};
+      /// ref_block_prefix of the last block applied with each value of the low 16 bits of the block number, 0 if unknown
+      std::array<std::atomic<uint32_t>, 0x10000> ref_block_prefixes{};
+      /** @} */
+
    public:
       void update_chain_info();
+      /**
+       * Thread safe. The checks the chain would fail a transaction on that can be made without it: expiration, TAPoS
+       * and size.
+       * @return nullptr if trx is worth passing on to the chain, the reason it is not otherwise
+       */
+      const char* check_transaction( const packed_transaction& trx ) const;
       //         lib_num, head_block_num, fork_head_blk_num, lib_id, head_blk_id, fork_head_blk_id
       std::tuple<uint32_t, uint32_t, uint32_t, block_id_type, block_id_type, block_id_type> get_chain_info() const;
 
@@ -387,10 +552,17 @@ namespace eosio {
    constexpr auto     def_txn_expire_wait = std::chrono::seconds(3);
    constexpr auto     def_resp_expected_wait = std::chrono::seconds(5);
    constexpr auto     def_sync_fetch_span = 100;
+   constexpr auto     def_sync_peer_count = 1;
+   constexpr auto     def_trx_flush_interval_us = 0; // 0 writes every transaction right away
+   constexpr auto     def_trx_flush_size = 64*1024;
+   constexpr auto     def_block_buffer_cache_size_mb = 64;
+   constexpr auto     def_trx_filter_size_mb = 8;
+   constexpr auto     def_snapshot_chunk_size = 1024*1024;
 
    constexpr auto     message_header_size = 4;
    constexpr uint32_t signed_block_which = 7;        // see protocol net_message
    constexpr uint32_t packed_transaction_which = 8;  // see protocol net_message
+   constexpr uint32_t compact_block_which = 9;       // see protocol net_message
 
    /**
     *  For a while, network version was a 16 bit value equal to the second set of 16 bits
@@ -413,8 +585,10 @@ namespace eosio {
    constexpr uint16_t proto_base = 0;
    constexpr uint16_t proto_explicit_sync = 1;
    constexpr uint16_t block_id_notify = 2; // reserved. feature was removed. next net_version should be 3
+   constexpr uint16_t proto_compact_block = 3; // compact_block_message, request_message for transactions
+   constexpr uint16_t proto_snapshot_bootstrap = 4; // snapshot_request_message, see eosio-bootstrap
 
-   constexpr uint16_t net_version = proto_explicit_sync;
+   constexpr uint16_t net_version = proto_snapshot_bootstrap;
 
    /**
     * Index by start_block_num
@@ -430,13 +604,31 @@ namespace eosio {
       time_point   start_time; ///< time request made or received
    };
 
+   /// a compact_block_message waiting for the transactions requested from the peer that sent it
+   struct pending_compact_block {
+      block_id_type                                                        id;
+      compact_block_message                                                msg;
+      std::set<transaction_id_type, sha256_less>                           missing;
+      std::map<transaction_id_type, packed_transaction_ptr, sha256_less>  received;
+   };
+
    // thread safe
+   /// the queues of writes to a connection, see queued_buffer::fill_out_buffer
+   enum class write_lane : uint8_t {
+      control,     ///< handshakes, notices, requests and everything else
+      block,       ///< blocks broadcast as they are produced or received, and what a peer needs to complete them
+      sync,        ///< blocks requested by a syncing peer
+      transaction  ///< relayed transactions
+   };
+
    class queued_buffer : boost::noncopyable {
    public:
       void clear_write_queue() {
          std::lock_guard<std::mutex> g( _mtx );
-         _write_queue.clear();
-         _sync_write_queue.clear();
+         for( auto& q : _write_queues ) {
+            q.clear();
+         }
+         write_queue_bytes_metric.add( -int64_t( _write_queue_size ) );
          _write_queue_size = 0;
       }
 
@@ -460,34 +652,33 @@ namespace eosio {
       bool ready_to_send() const {
          std::lock_guard<std::mutex> g( _mtx );
          // if out_queue is not empty then async_write is in progress
-         return ((!_sync_write_queue.empty() || !_write_queue.empty()) && _out_queue.empty());
+         return _write_queue_size > 0 && _out_queue.empty();
       }
 
       // @param callback must not callback into queued_buffer
       bool add_write_queue( const std::shared_ptr<vector<char>>& buff,
                             std::function<void( boost::system::error_code, std::size_t )> callback,
-                            bool to_sync_queue ) {
+                            write_lane lane ) {
          std::lock_guard<std::mutex> g( _mtx );
-         if( to_sync_queue ) {
-            _sync_write_queue.push_back( {buff, callback} );
-         } else {
-            _write_queue.push_back( {buff, callback} );
-         }
+         _write_queues[static_cast<size_t>(lane)].push_back( {buff, callback} );
          _write_queue_size += buff->size();
+         write_queue_bytes_metric.add( buff->size() );
          if( _write_queue_size > 2 * def_max_write_queue_size ) {
             return false;
          }
          return true;
       }
 
+      /**
+       * Control messages and broadcast blocks are always written in full. Sync blocks and transactions only get a
+       * limited share of each write, so a block queued while a write is in progress waits for at most that much.
+       */
       void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs ) {
          std::lock_guard<std::mutex> g( _mtx );
-         if( _sync_write_queue.size() > 0 ) { // always send msgs from sync_write_queue first
-            fill_out_buffer( bufs, _sync_write_queue );
-         } else { // postpone real_time write_queue if sync queue is not empty
-            fill_out_buffer( bufs, _write_queue );
-            EOS_ASSERT( _write_queue_size == 0, plugin_exception, "write queue size expected to be zero" );
-         }
+         fill_out_buffer( bufs, write_lane::control, std::numeric_limits<size_t>::max() );
+         fill_out_buffer( bufs, write_lane::block, std::numeric_limits<size_t>::max() );
+         fill_out_buffer( bufs, write_lane::sync, max_sync_write_size );
+         fill_out_buffer( bufs, write_lane::transaction, max_trx_write_size );
       }
 
       void out_callback( boost::system::error_code ec, std::size_t w ) {
@@ -498,13 +689,20 @@ namespace eosio {
       }
 
    private:
+      static constexpr size_t max_sync_write_size = 1024*1024;
+      static constexpr size_t max_trx_write_size = 128*1024;
+
       struct queued_write;
-      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs,
-                            deque<queued_write>& w_queue ) {
-         while ( w_queue.size() > 0 ) {
+      /// move messages of lane to the out queue until max_size bytes are reached, at least one if any
+      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs, write_lane lane, size_t max_size ) {
+         auto& w_queue = _write_queues[static_cast<size_t>(lane)];
+         size_t size = 0;
+         while ( w_queue.size() > 0 && size < max_size ) {
             auto& m = w_queue.front();
             bufs.push_back( boost::asio::buffer( *m.buff ));
+            size += m.buff->size();
             _write_queue_size -= m.buff->size();
+            write_queue_bytes_metric.add( -int64_t( m.buff->size() ) );
             _out_queue.emplace_back( m );
             w_queue.pop_front();
          }
@@ -516,11 +714,10 @@ namespace eosio {
          std::function<void( boost::system::error_code, std::size_t )> callback;
       };
 
-      mutable std::mutex  _mtx;
-      uint32_t            _write_queue_size{0};
-      deque<queued_write> _write_queue;
-      deque<queued_write> _sync_write_queue; // sync_write_queue will be sent first
-      deque<queued_write> _out_queue;
+      mutable std::mutex               _mtx;
+      uint32_t                         _write_queue_size{0}; // of all write queues
+      std::array<deque<queued_write>, 4> _write_queues;      // by write_lane
+      deque<queued_write>              _out_queue;
 
    }; // queued_buffer
 
@@ -564,6 +761,35 @@ namespace eosio {
       block_status_monitor& operator=( block_status_monitor&& ) = delete;
    };
 
+   /**
+    * Thread safe. How well a peer serves us: its round trip time from time_message exchanges, the share of the
+    * transactions it sends that are new to us and the share of its blocks that reach us first. Counts are halved as
+    * they grow so the score follows the peer's recent behavior.
+    */
+   class peer_score {
+   public:
+      /// @param rtt_ns round trip time of a time_message exchange
+      void rtt( int64_t rtt_ns );
+      void transaction( bool duplicate );
+      /// @param first true if no other peer delivered the block before
+      void block( bool first );
+      void reset();
+
+      /// in [0,3], higher is better, peers not measured yet are in the middle
+      double score() const;
+
+      int64_t rtt_ns() const { return rtt_ns_; }
+
+   private:
+      static constexpr uint32_t max_count = 1024;
+
+      std::atomic<int64_t>  rtt_ns_{0};          ///< smoothed round trip time, 0 until measured
+      std::atomic<uint32_t> unique_trxs_{0};
+      std::atomic<uint32_t> duplicate_trxs_{0};
+      std::atomic<uint32_t> first_blocks_{0};
+      std::atomic<uint32_t> blocks_{0};
+   };
+
    class connection : public std::enable_shared_from_this<connection> {
    public:
       explicit connection( string endpoint );
@@ -612,16 +838,23 @@ namespace eosio {
       int16_t                 sent_handshake_count = 0;
       std::atomic<bool>       connecting{true};
       std::atomic<bool>       syncing{false};
-      uint16_t                protocol_version = 0;
+      std::atomic<uint16_t>   protocol_version = 0;
       uint16_t                consecutive_rejected_blocks = 0;
       block_status_monitor    block_status_monitor_;
+      peer_score              score_;
       std::atomic<uint16_t>   consecutive_immediate_connection_close = 0;
 
       std::mutex                            response_expected_timer_mtx;
       boost::asio::steady_timer             response_expected_timer;
 
+      boost::asio::steady_timer             trx_flush_timer; // only accessed through strand
+      bool                                  trx_flush_pending = false; // only accessed through strand
+      std::atomic<uint32_t>                 trx_queued_size{0}; // bytes of transactions held back for trx_flush_timer
+
       std::atomic<go_away_reason>           no_retry{no_reason};
 
+      optional<pending_compact_block>       pending_compact; // only accessed through strand
+
       mutable std::mutex          conn_mtx; //< mtx for last_req .. local_endpoint_port
       optional<request_message>   last_req;
       handshake_message           last_handshake_recv;
@@ -706,9 +939,14 @@ namespace eosio {
 
       void enqueue( const net_message &msg );
       void enqueue_block( const signed_block_ptr& sb, bool to_sync_queue = false);
+      /// enqueue sb, packed once and shared through the block buffer cache of the dispatcher
+      void enqueue_block( const signed_block_ptr& sb, const block_id_type& id, bool to_sync_queue = false);
+      void enqueue_packed_block( uint32_t num, const block_id_type& id, const packed_block_view& packed );
       void enqueue_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
                            go_away_reason close_after_send,
-                           bool to_sync_queue = false);
+                           write_lane lane = write_lane::control);
+      /// enqueue a relayed transaction, written together with the ones that follow it within p2p-trx-flush-interval-us
+      void enqueue_transaction_buffer( const std::shared_ptr<std::vector<char>>& send_buffer );
       void cancel_sync(go_away_reason);
       void flush_queues();
       bool enqueue_sync_block();
@@ -722,7 +960,7 @@ namespace eosio {
 
       void queue_write(const std::shared_ptr<vector<char>>& buff,
                        std::function<void(boost::system::error_code, std::size_t)> callback,
-                       bool to_sync_queue = false);
+                       write_lane lane);
       void do_queue_write();
 
       static bool is_valid( const handshake_message& msg );
@@ -752,9 +990,18 @@ namespace eosio {
       void handle_message( const block_id_type& id, signed_block_ptr msg );
       void handle_message( const packed_transaction& msg ) = delete; // packed_transaction_ptr overload used instead
       void handle_message( packed_transaction_ptr msg );
+      void handle_message( const compact_block_message& msg );
+      void handle_message( const snapshot_request_message& msg );
+      void handle_message( const snapshot_chunk_message& msg );
 
       void process_signed_block( const block_id_type& id, signed_block_ptr msg );
 
+      /// @return true if trx is one the pending compact block waits for
+      bool add_compact_block_transaction( const packed_transaction_ptr& trx );
+      void complete_compact_block();
+      void request_block( const block_id_type& id );
+      void send_transactions( const vector<transaction_id_type>& ids, const vector<block_id_type>& blk_ids );
+
       fc::variant_object get_logger_variant()  {
          fc::mutable_variant_object mvo;
          mvo( "_name", peer_name());
@@ -822,6 +1069,24 @@ namespace eosio {
          fc_dlog( logger, "handle sync_request_message" );
          c->handle_message( msg );
       }
+
+      void operator()( const compact_block_message& msg ) const {
+         // continue call to handle_message on connection strand
+         fc_dlog( logger, "handle compact_block_message" );
+         c->handle_message( msg );
+      }
+
+      void operator()( const snapshot_request_message& msg ) const {
+         // continue call to handle_message on connection strand
+         fc_dlog( logger, "handle snapshot_request_message" );
+         c->handle_message( msg );
+      }
+
+      void operator()( const snapshot_chunk_message& msg ) const {
+         // continue call to handle_message on connection strand
+         fc_dlog( logger, "handle snapshot_chunk_message" );
+         c->handle_message( msg );
+      }
    };
 
    template<typename Function>
@@ -841,6 +1106,31 @@ namespace eosio {
       }
    }
 
+   /// like for_each_connection but best scoring peers first, f is called without holding connections_mtx
+   template<typename Function>
+   void for_each_connection_by_score( Function f ) {
+      std::vector<std::pair<double, connection_ptr>> conns;
+      {
+         std::shared_lock<std::shared_mutex> g( my_impl->connections_mtx );
+         conns.reserve( my_impl->connections.size() );
+         for( auto& c : my_impl->connections ) {
+            conns.emplace_back( c->score_.score(), c );
+         }
+      }
+      std::stable_sort( conns.begin(), conns.end(), []( const auto& a, const auto& b ) { return a.first > b.first; } );
+      for( auto& c : conns ) {
+         if( !f( c.second ) ) return;
+      }
+   }
+
+   /// like for_each_block_connection but best scoring peers first, f is called without holding connections_mtx
+   template<typename Function>
+   void for_each_block_connection_by_score( Function f ) {
+      for_each_connection_by_score( [&f]( auto& c ) {
+         return c->is_transactions_only_connection() || f( c );
+      } );
+   }
+
    //---------------------------------------------------------------------------
 
    connection::connection( string endpoint )
@@ -849,6 +1139,7 @@ namespace eosio {
         socket( new tcp::socket( my_impl->thread_pool->get_executor() ) ),
         connection_id( ++my_impl->current_connection_id ),
         response_expected_timer( my_impl->thread_pool->get_executor() ),
+        trx_flush_timer( my_impl->thread_pool->get_executor() ),
         last_handshake_recv(),
         last_handshake_sent()
    {
@@ -861,6 +1152,7 @@ namespace eosio {
         socket( new tcp::socket( my_impl->thread_pool->get_executor() ) ),
         connection_id( ++my_impl->current_connection_id ),
         response_expected_timer( my_impl->thread_pool->get_executor() ),
+        trx_flush_timer( my_impl->thread_pool->get_executor() ),
         last_handshake_recv(),
         last_handshake_sent()
    {
@@ -963,6 +1255,7 @@ namespace eosio {
       self->connecting = false;
       self->syncing = false;
       self->block_status_monitor_.reset();
+      self->score_.reset();
       ++self->consecutive_immediate_connection_close;
       bool has_last_req = false;
       {
@@ -977,6 +1270,9 @@ namespace eosio {
          my_impl->dispatcher->retry_fetch( self->shared_from_this() );
       }
       self->peer_requested.reset();
+      self->pending_compact.reset();
+      self->trx_flush_timer.cancel();
+      self->trx_queued_size = 0;
       self->sent_handshake_count = 0;
       if( !shutdown) my_impl->sync_master->sync_reset_lib_num( self->shared_from_this() );
       fc_ilog( logger, "closing '${a}', ${p}", ("a", self->peer_address())("p", self->peer_name()) );
@@ -1073,8 +1369,8 @@ namespace eosio {
             if( b ) {
                fc_dlog( logger, "found block for id at num ${n}", ("n", b->block_num()) );
                my_impl->dispatcher->add_peer_block( blkid, c->connection_id );
-               c->strand.post( [c, b{std::move(b)}]() {
-                  c->enqueue_block( b );
+               c->strand.post( [c, blkid, b{std::move(b)}]() {
+                  c->enqueue_block( b, blkid );
                } );
             } else {
                fc_ilog( logger, "fetch block by id returned null, id ${id} for ${p}",
@@ -1131,8 +1427,8 @@ namespace eosio {
 
    void connection::queue_write(const std::shared_ptr<vector<char>>& buff,
                                 std::function<void(boost::system::error_code, std::size_t)> callback,
-                                bool to_sync_queue) {
-      if( !buffer_queue.add_write_queue( buff, callback, to_sync_queue )) {
+                                write_lane lane) {
+      if( !buffer_queue.add_write_queue( buff, callback, lane )) {
          fc_wlog( logger, "write_queue full ${s} bytes, giving up on connection ${p}",
                   ("s", buffer_queue.write_queue_size())("p", peer_name()) );
          close();
@@ -1148,6 +1444,7 @@ namespace eosio {
 
       std::vector<boost::asio::const_buffer> bufs;
       buffer_queue.fill_out_buffer( bufs );
+      trx_queued_size = 0; // any held back transactions go out with this write
 
       strand.post( [c{std::move(c)}, bufs{std::move(bufs)}]() {
          boost::asio::async_write( *c->socket, bufs,
@@ -1173,6 +1470,7 @@ namespace eosio {
                }
 
                c->buffer_queue.out_callback( ec, w );
+               bytes_sent_metric.add( w );
 
                c->enqueue_sync_block();
                c->do_queue_write();
@@ -1221,13 +1519,32 @@ namespace eosio {
          connection_ptr c = weak.lock();
          if( !c ) return;
          controller& cc = my_impl->chain_plug->chain();
+         block_id_type id;
+         std::shared_ptr<std::vector<char>> send_buffer;
+         packed_block_view packed;
          signed_block_ptr sb;
          try {
-            sb = cc.fetch_block_by_number( num );
+            id = cc.get_block_id_for_num( num );
+            send_buffer = my_impl->dispatcher->find_block_buffer( id );
+            if( !send_buffer ) {
+               // irreversible blocks are forwarded as stored in the block log, without unpacking them
+               packed = cc.fetch_packed_block_by_number( num );
+               if( !packed )
+                  sb = cc.fetch_block_by_number( num );
+            }
          } FC_LOG_AND_DROP();
-         if( sb ) {
-            c->strand.post( [c, sb{std::move(sb)}]() {
-               c->enqueue_block( sb, true );
+         if( send_buffer ) {
+            c->strand.post( [c, num, send_buffer{std::move(send_buffer)}]() {
+               fc_dlog( logger, "enqueue cached block ${num}", ("num", num) );
+               c->enqueue_buffer( send_buffer, no_reason, write_lane::sync );
+            });
+         } else if( packed ) {
+            c->strand.post( [c, num, id, packed{std::move(packed)}]() {
+               c->enqueue_packed_block( num, id, packed );
+            });
+         } else if( sb ) {
+            c->strand.post( [c, id, sb{std::move(sb)}]() {
+               c->enqueue_block( sb, id, true );
             });
          } else {
             c->strand.post( [c, num]() {
@@ -1259,7 +1576,13 @@ namespace eosio {
       ds.write( header, header_size );
       fc::raw::pack( ds, m );
 
-      enqueue_buffer( send_buffer, close_after_send );
+      write_lane lane = write_lane::control;
+      if( m.contains<signed_block>() || m.contains<compact_block_message>() ) {
+         lane = write_lane::block;
+      } else if( m.contains<packed_transaction>() ) {
+         lane = write_lane::transaction;
+      }
+      enqueue_buffer( send_buffer, close_after_send, lane );
    }
 
    template< typename T>
@@ -1295,15 +1618,48 @@ namespace eosio {
       return create_send_buffer( packed_transaction_which, trx );
    }
 
+   static std::shared_ptr<std::vector<char>> create_send_buffer( const packed_block_view& packed ) {
+      // matches create_send_buffer( signed_block_which, signed_block ) but copies the already packed block
+      const uint32_t which_size = fc::raw::pack_size( unsigned_int( signed_block_which ) );
+      const uint32_t payload_size = which_size + packed.size;
+
+      const char* const header = reinterpret_cast<const char* const>(&payload_size); // avoid variable size encoding of uint32_t
+      constexpr size_t header_size = sizeof( payload_size );
+      static_assert( header_size == message_header_size, "invalid message_header_size" );
+      const size_t buffer_size = header_size + payload_size;
+
+      auto send_buffer = std::make_shared<vector<char>>( buffer_size );
+      fc::datastream<char*> ds( send_buffer->data(), buffer_size );
+      ds.write( header, header_size );
+      fc::raw::pack( ds, unsigned_int( signed_block_which ) );
+      ds.write( packed.data, packed.size );
+
+      return send_buffer;
+   }
+
+   void connection::enqueue_packed_block( uint32_t num, const block_id_type& id, const packed_block_view& packed ) {
+      fc_dlog( logger, "enqueue packed block ${num}", ("num", num) );
+      verify_strand_in_this_thread( strand, __func__, __LINE__ );
+      enqueue_buffer( my_impl->dispatcher->get_block_buffer( id, [&packed]() { return create_send_buffer( packed ); } ),
+                      no_reason, write_lane::sync );
+   }
+
    void connection::enqueue_block( const signed_block_ptr& sb, bool to_sync_queue) {
       fc_dlog( logger, "enqueue block ${num}", ("num", sb->block_num()) );
       verify_strand_in_this_thread( strand, __func__, __LINE__ );
-      enqueue_buffer( create_send_buffer( sb ), no_reason, to_sync_queue);
+      enqueue_buffer( create_send_buffer( sb ), no_reason, to_sync_queue ? write_lane::sync : write_lane::block );
+   }
+
+   void connection::enqueue_block( const signed_block_ptr& sb, const block_id_type& id, bool to_sync_queue) {
+      fc_dlog( logger, "enqueue block ${num}", ("num", sb->block_num()) );
+      verify_strand_in_this_thread( strand, __func__, __LINE__ );
+      enqueue_buffer( my_impl->dispatcher->get_block_buffer( id, [&sb]() { return create_send_buffer( sb ); } ),
+                      no_reason, to_sync_queue ? write_lane::sync : write_lane::block );
    }
 
    void connection::enqueue_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
                                     go_away_reason close_after_send,
-                                    bool to_sync_queue)
+                                    write_lane lane)
    {
       connection_ptr self = shared_from_this();
       queue_write(send_buffer,
@@ -1316,7 +1672,37 @@ namespace eosio {
                            return;
                         }
                   },
-                  to_sync_queue);
+                  lane);
+   }
+
+   // called from connection strand
+   void connection::enqueue_transaction_buffer( const std::shared_ptr<std::vector<char>>& send_buffer ) {
+      verify_strand_in_this_thread( strand, __func__, __LINE__ );
+      if( my_impl->trx_flush_interval.count() == 0 ) {
+         enqueue_buffer( send_buffer, no_reason, write_lane::transaction );
+         return;
+      }
+
+      if( !buffer_queue.add_write_queue( send_buffer, []( boost::system::error_code, std::size_t ) {}, write_lane::transaction )) {
+         fc_wlog( logger, "write_queue full ${s} bytes, giving up on connection ${p}",
+                  ("s", buffer_queue.write_queue_size())("p", peer_name()) );
+         close();
+         return;
+      }
+      if( (trx_queued_size += send_buffer->size()) >= my_impl->trx_flush_size ) {
+         do_queue_write();
+         return;
+      }
+      if( trx_flush_pending ) return;
+
+      trx_flush_pending = true;
+      trx_flush_timer.expires_from_now( my_impl->trx_flush_interval );
+      trx_flush_timer.async_wait( boost::asio::bind_executor( strand, [c = shared_from_this()]( boost::system::error_code ec ) {
+         c->trx_flush_pending = false;
+         if( !ec ) {
+            c->do_queue_write();
+         }
+      } ) );
    }
 
    // thread safe
@@ -1396,6 +1782,45 @@ namespace eosio {
       events_ = 0;
    }
 
+   void peer_score::rtt( int64_t rtt_ns ) {
+      if( rtt_ns < 0 ) return;
+      const int64_t prev = rtt_ns_;
+      rtt_ns_ = prev == 0 ? rtt_ns : (prev * 7 + rtt_ns) / 8;
+   }
+
+   void peer_score::transaction( bool duplicate ) {
+      if( duplicate ) ++duplicate_trxs_; else ++unique_trxs_;
+      if( unique_trxs_ + duplicate_trxs_ > max_count ) {
+         unique_trxs_ = unique_trxs_ / 2;
+         duplicate_trxs_ = duplicate_trxs_ / 2;
+      }
+   }
+
+   void peer_score::block( bool first ) {
+      if( first ) ++first_blocks_;
+      if( ++blocks_ > max_count ) {
+         first_blocks_ = first_blocks_ / 2;
+         blocks_ = blocks_ / 2;
+      }
+   }
+
+   void peer_score::reset() {
+      rtt_ns_ = 0;
+      unique_trxs_ = 0;
+      duplicate_trxs_ = 0;
+      first_blocks_ = 0;
+      blocks_ = 0;
+   }
+
+   double peer_score::score() const {
+      constexpr double half_score_rtt_ns = 50*1000*1000; // 50ms
+      const int64_t rtt = rtt_ns_;
+      const double latency = rtt == 0 ? 0.5 : 1.0 / (1.0 + rtt / half_score_rtt_ns);
+      const double unique = (unique_trxs_ + 1.0) / (unique_trxs_ + duplicate_trxs_ + 2.0);
+      const double first = (first_blocks_ + 1.0) / (blocks_ + 2.0);
+      return latency + unique + first;
+   }
+
    void block_status_monitor::rejected() {
       const auto now = fc::time_point::now();
 
@@ -1417,13 +1842,14 @@ namespace eosio {
    }
    //-----------------------------------------------------------
 
-    sync_manager::sync_manager( uint32_t req_span )
+    sync_manager::sync_manager( uint32_t req_span, uint32_t peer_count )
       :sync_known_lib_num( 0 )
       ,sync_last_requested_num( 0 )
       ,sync_next_expected_num( 1 )
       ,sync_req_span( req_span )
       ,sync_source()
       ,sync_state(in_sync)
+      ,sync_peer_count( peer_count )
    {
    }
 
@@ -1456,6 +1882,13 @@ namespace eosio {
          if( c->last_handshake_recv.last_irreversible_block_num > sync_known_lib_num ) {
             sync_known_lib_num = c->last_handshake_recv.last_irreversible_block_num;
          }
+      } else if( parallel_sync() ) {
+         auto r = find_sync_range( c );
+         if( r != sync_ranges.end() ) {
+            drop_held_blocks( *r );
+            r->source.reset();
+            request_parallel_chunks( std::move(g), connection_ptr() );
+         }
       } else if( c == sync_source ) {
          sync_last_requested_num = 0;
          request_next_chunk( std::move(g) );
@@ -1472,6 +1905,11 @@ namespace eosio {
       fc_dlog( logger, "sync_last_requested_num: ${r}, sync_next_expected_num: ${e}, sync_known_lib_num: ${k}, sync_req_span: ${s}",
                ("r", sync_last_requested_num)("e", sync_next_expected_num)("k", sync_known_lib_num)("s", sync_req_span) );
 
+      if( parallel_sync() ) {
+         request_parallel_chunks( std::move(g_sync), conn );
+         return;
+      }
+
       if( fork_head_block_num < sync_last_requested_num && sync_source && sync_source->current() ) {
          fc_ilog( logger, "ignoring request, head is ${h} last req = ${r} source is ${p}",
                   ("h", fork_head_block_num)( "r", sync_last_requested_num )( "p", sync_source->peer_name() ) );
@@ -1565,6 +2003,128 @@ namespace eosio {
       }
    }
 
+   // call with g_sync locked
+   void sync_manager::request_parallel_chunks( std::unique_lock<std::mutex> g_sync, const connection_ptr& conn, const connection_ptr& skip ) {
+      while( !sync_ranges.empty() && sync_ranges.front().end < sync_next_expected_num ) {
+         sync_ranges.pop_front();
+      }
+      if( sync_ranges.empty() ) {
+         sync_last_requested_num = sync_next_expected_num - 1;
+      }
+
+      while( sync_ranges.size() < sync_peer_count && sync_last_requested_num < sync_known_lib_num ) {
+         sync_range r;
+         r.start = sync_last_requested_num + 1;
+         r.end = std::min( sync_known_lib_num, r.start + sync_req_span - 1 );
+         sync_last_requested_num = r.end;
+         sync_ranges.push_back( std::move(r) );
+      }
+
+      // each range goes to a different peer that has it irreversible; a range left without a peer stops later ranges
+      // from being requested as their blocks could only be held
+      auto usable = [this, &skip]( const connection_ptr& c, uint32_t end ) {
+         if( !c || c == skip || !c->current() || c->is_transactions_only_connection() ) return false;
+         if( find_sync_range( c ) != sync_ranges.end() ) return false;
+         std::lock_guard<std::mutex> g_conn( c->conn_mtx );
+         return c->last_handshake_recv.last_irreversible_block_num >= end;
+      };
+
+      std::vector<std::tuple<connection_ptr, uint32_t, uint32_t>> requests;
+      {
+         std::shared_lock<std::shared_mutex> g( my_impl->connections_mtx );
+         for( auto& r : sync_ranges ) {
+            if( r.source ) continue;
+            r.start = std::max( r.start, sync_next_expected_num );
+            if( usable( conn, r.end ) ) {
+               r.source = conn;
+            } else {
+               double best = -1;
+               for( const auto& c : my_impl->connections ) {
+                  const double score = c->score_.score();
+                  if( score > best && usable( c, r.end ) ) {
+                     r.source = c;
+                     best = score;
+                  }
+               }
+            }
+            if( !r.source ) break;
+            requests.emplace_back( r.source, r.start, r.end );
+         }
+      }
+
+      sync_source = sync_ranges.empty() ? connection_ptr() : sync_ranges.front().source;
+      if( !sync_ranges.empty() && !sync_source ) {
+         uint32_t lib_block_num = 0;
+         std::tie( lib_block_num, std::ignore, std::ignore,
+                   std::ignore, std::ignore, std::ignore ) = my_impl->get_chain_info();
+         fc_elog( logger, "Unable to continue syncing at this time");
+         sync_known_lib_num = lib_block_num;
+         sync_last_requested_num = 0;
+         reset_parallel_sync();
+         set_state( in_sync );
+         return;
+      }
+      g_sync.unlock();
+
+      for( auto& req : requests ) {
+         connection_ptr c = std::get<0>( req );
+         c->strand.post( [c, start = std::get<1>( req ), end = std::get<2>( req )]() {
+            fc_ilog( logger, "requesting range ${s} to ${e}, from ${n}", ("n", c->peer_name())( "s", start )( "e", end ) );
+            c->request_sync_blocks( start, end );
+         } );
+      }
+   }
+
+   // call with sync_mtx locked
+   std::deque<sync_manager::sync_range>::iterator sync_manager::find_sync_range( const connection_ptr& c ) {
+      return std::find_if( sync_ranges.begin(), sync_ranges.end(), [&c]( const auto& r ) { return r.source == c; } );
+   }
+
+   // call with sync_mtx locked
+   void sync_manager::drop_held_blocks( const sync_range& r ) {
+      sync_held_blocks.erase( sync_held_blocks.lower_bound( r.start ), sync_held_blocks.upper_bound( r.end ) );
+   }
+
+   // call with sync_mtx locked, posting before unlocking keeps the blocks ahead of any received later for the same range
+   void sync_manager::release_held_blocks() {
+      if( sync_ranges.empty() ) return;
+      auto end = sync_held_blocks.upper_bound( sync_ranges.front().end );
+      for( auto i = sync_held_blocks.begin(); i != end; ++i ) {
+         app().post( priority::medium, [hb = std::move( i->second )]() mutable {
+            hb.source->process_signed_block( hb.id, std::move( hb.block ) );
+         } );
+      }
+      sync_held_blocks.erase( sync_held_blocks.begin(), end );
+   }
+
+   // call with sync_mtx locked
+   void sync_manager::reset_parallel_sync() {
+      sync_ranges.clear();
+      sync_held_blocks.clear();
+   }
+
+   // called from connection strand
+   bool sync_manager::hold_sync_block( const connection_ptr& c, const block_id_type& blk_id, const signed_block_ptr& b ) {
+      if( sync_peer_count <= 1 ) return false;
+      std::lock_guard<std::mutex> g( sync_mtx );
+      if( !parallel_sync() || sync_ranges.empty() ) return false;
+      const uint32_t blk_num = b->block_num();
+      if( blk_num <= sync_ranges.front().end ) return false;
+      auto r = find_sync_range( c );
+      if( r == sync_ranges.end() || blk_num < r->start || blk_num > r->end ) return false;
+
+      fc_dlog( logger, "holding block ${bn} from ${p} until ${e} is applied",
+               ("bn", blk_num)("p", c->peer_name())("e", sync_ranges.front().end) );
+      sync_held_blocks[blk_num] = held_block{ c, blk_id, b };
+      // the peer is done once the whole range is held, otherwise keep waiting on it as for any other sync block
+      if( blk_num == r->end ) {
+         c->cancel_wait();
+      } else {
+         c->sync_wait();
+      }
+      return true;
+   }
+
    // static, thread safe
    void sync_manager::send_handshakes() {
       for_each_connection( []( auto& ci ) {
@@ -1602,6 +2162,7 @@ namespace eosio {
       }
 
       if( sync_state == in_sync ) {
+         reset_parallel_sync();
          set_state( lib_catchup );
       }
       sync_next_expected_num = std::max( lib_num + 1, sync_next_expected_num );
@@ -1618,7 +2179,15 @@ namespace eosio {
       fc_ilog( logger, "reassign_fetch, our last req is ${cc}, next expected is ${ne} peer ${p}",
                ("cc", sync_last_requested_num)( "ne", sync_next_expected_num )( "p", c->peer_name() ) );
 
-      if( c == sync_source ) {
+      if( parallel_sync() ) {
+         auto r = find_sync_range( c );
+         if( r != sync_ranges.end() ) {
+            c->cancel_sync(reason);
+            drop_held_blocks( *r );
+            r->source.reset();
+            request_parallel_chunks( std::move(g), connection_ptr(), c );
+         }
+      } else if( c == sync_source ) {
          c->cancel_sync(reason);
          sync_last_requested_num = 0;
          request_next_chunk( std::move(g) );
@@ -1813,6 +2382,7 @@ namespace eosio {
          std::unique_lock<std::mutex> g( sync_mtx );
          sync_last_requested_num = 0;
          sync_source.reset();
+         reset_parallel_sync();
          g.unlock();
          c->close();
       } else {
@@ -1884,9 +2454,19 @@ namespace eosio {
       } else if( state == lib_catchup ) {
          if( blk_num == sync_known_lib_num ) {
             fc_dlog( logger, "All caught up with last known last irreversible block resending handshake" );
+            reset_parallel_sync();
             set_state( in_sync );
             g_sync.unlock();
             send_handshakes();
+         } else if( parallel_sync() ) {
+            if( !sync_ranges.empty() && blk_num >= sync_ranges.front().end ) {
+               sync_ranges.pop_front();
+               release_held_blocks();
+               request_next_chunk( std::move( g_sync ) );
+            } else {
+               g_sync.unlock();
+               c->sync_wait();
+            }
          } else if( blk_num == sync_last_requested_num ) {
             request_next_chunk( std::move( g_sync) );
          } else {
@@ -1914,6 +2494,34 @@ namespace eosio {
       return added;
    }
 
+   std::shared_ptr<std::vector<char>> dispatch_manager::find_block_buffer( const block_id_type& blkid ) {
+      std::lock_guard<std::mutex> g( blk_buffers_mtx );
+      auto& index = blk_buffers.get<by_block_id>();
+      auto itr = index.find( blkid );
+      if( itr == index.end() ) return {};
+      blk_buffers.relocate( blk_buffers.end(), blk_buffers.project<0>( itr ) );
+      return itr->buffer;
+   }
+
+   std::shared_ptr<std::vector<char>> dispatch_manager::get_block_buffer( const block_id_type& blkid,
+                                                                          const std::function<std::shared_ptr<std::vector<char>>()>& create ) {
+      if( auto buffer = find_block_buffer( blkid ) ) return buffer;
+
+      // pack without holding the lock, a connection racing to pack the same block keeps the one inserted first
+      auto buffer = create();
+      if( buffer->size() > max_blk_buffers_size ) return buffer;
+
+      std::lock_guard<std::mutex> g( blk_buffers_mtx );
+      auto r = blk_buffers.push_back( {blkid, buffer} );
+      if( !r.second ) return r.first->buffer;
+      blk_buffers_size += buffer->size();
+      while( blk_buffers_size > max_blk_buffers_size ) {
+         blk_buffers_size -= blk_buffers.front().buffer->size();
+         blk_buffers.pop_front();
+      }
+      return buffer;
+   }
+
    bool dispatch_manager::peer_has_block( const block_id_type& blkid, uint32_t connection_id ) const {
       std::lock_guard<std::mutex> g(blk_state_mtx);
       const auto blk_itr = blk_state.get<by_id>().find( std::make_tuple( connection_id, std::ref( blkid )));
@@ -1931,7 +2539,80 @@ namespace eosio {
       return false;
    }
 
+   bool dispatch_manager::claim_block( const block_id_type& blkid, uint32_t connection_id ) {
+      std::lock_guard<std::mutex> g( blk_state_mtx );
+      auto res = blks_in_flight.emplace( blkid, std::vector<uint32_t>{} );
+      if( !res.second ) {
+         auto& dropped = res.first->second;
+         if( std::find( dropped.begin(), dropped.end(), connection_id ) == dropped.end() ) {
+            dropped.push_back( connection_id );
+         }
+      }
+      return res.second;
+   }
+
+   void dispatch_manager::release_block( const block_id_type& blkid ) {
+      std::lock_guard<std::mutex> g( blk_state_mtx );
+      blks_in_flight.erase( blkid );
+   }
+
+   transaction_filter::transaction_filter( size_t size_bytes )
+   : num_words( size_bytes / sizeof(uint64_t) / gens.size() )
+   {
+      if( num_words > 0 ) {
+         for( auto& g : gens )
+            g.words.reset( new std::atomic<uint64_t>[num_words]() );
+      }
+   }
+
+   template<typename Function>
+   void transaction_filter::for_each_bit( const transaction_id_type& id, Function f ) const {
+      // the id is a hash already, two of its words give every position by double hashing
+      const uint64_t num_bits = num_words * 64;
+      const uint64_t h1 = id._hash[0];
+      const uint64_t h2 = id._hash[1] | 1;
+      for( uint32_t i = 0; i < num_hashes; ++i ) {
+         const uint64_t bit = (h1 + i * h2) % num_bits;
+         f( bit / 64, uint64_t(1) << (bit % 64) );
+      }
+   }
+
+   void transaction_filter::add( const transaction_id_type& id, time_point_sec expires ) {
+      if( num_words == 0 ) return;
+      auto& g = gens[current.load() % gens.size()];
+      for_each_bit( id, [&g]( size_t word, uint64_t mask ) {
+         g.words[word].fetch_or( mask, std::memory_order_relaxed );
+      } );
+      uint32_t max_expires = g.max_expires;
+      while( expires.sec_since_epoch() > max_expires && !g.max_expires.compare_exchange_weak( max_expires, expires.sec_since_epoch() ) )
+         ;
+   }
+
+   bool transaction_filter::may_contain( const transaction_id_type& id ) const {
+      if( num_words == 0 ) return true;
+      for( const auto& g : gens ) {
+         bool found = true;
+         for_each_bit( id, [&g, &found]( size_t word, uint64_t mask ) {
+            found = found && (g.words[word].load( std::memory_order_relaxed ) & mask) != 0;
+         } );
+         if( found ) return true;
+      }
+      return false;
+   }
+
+   void transaction_filter::expire( time_point_sec now ) {
+      if( num_words == 0 ) return;
+      const uint32_t cur = current;
+      auto& other = gens[(cur + 1) % gens.size()];
+      if( other.max_expires >= now.sec_since_epoch() ) return;
+      for( size_t i = 0; i < num_words; ++i )
+         other.words[i].store( 0, std::memory_order_relaxed );
+      other.max_expires = 0;
+      current = cur + 1;
+   }
+
    bool dispatch_manager::add_peer_txn( const node_transaction_state& nts ) {
+      seen_txns.add( nts.id, nts.expires );
       std::lock_guard<std::mutex> g( local_txns_mtx );
       auto tptr = local_txns.get<by_id>().find( std::make_tuple( std::ref( nts.id ), nts.connection_id ) );
       bool added = (tptr == local_txns.end());
@@ -1944,7 +2625,7 @@ namespace eosio {
    // thread safe
    void dispatch_manager::update_txns_block_num( const signed_block_ptr& sb ) {
       update_block_num ubn( sb->block_num() );
-      std::lock_guard<std::mutex> g( local_txns_mtx );
+      std::unique_lock<std::mutex> g( local_txns_mtx );
       for( const auto& recpt : sb->transactions ) {
          const transaction_id_type& id = (recpt.trx.which() == 0) ? recpt.trx.get<transaction_id_type>()
                                                                   : recpt.trx.get<packed_transaction>().id();
@@ -1953,6 +2634,17 @@ namespace eosio {
             local_txns.modify( itr, ubn );
          }
       }
+      g.unlock();
+
+      std::lock_guard<std::mutex> g_cache( trx_cache_mtx );
+      auto& index = trx_cache.get<by_id>();
+      for( const auto& recpt : sb->transactions ) {
+         if( recpt.trx.which() == 0 ) continue;
+         auto itr = index.find( recpt.trx.get<packed_transaction>().id() );
+         if( itr != index.end() ) {
+            index.modify( itr, [bnum = sb->block_num()]( auto& ct ) { ct.block_num = bnum; } );
+         }
+      }
    }
 
    // thread safe
@@ -1972,6 +2664,8 @@ namespace eosio {
    }
 
    bool dispatch_manager::have_txn( const transaction_id_type& tid ) const {
+      if( !seen_txns.may_contain( tid ) )
+         return false;
       std::lock_guard<std::mutex> g( local_txns_mtx );
       const auto tptr = local_txns.get<by_id>().find( tid );
       return tptr != local_txns.end();
@@ -1995,6 +2689,53 @@ namespace eosio {
       g.unlock();
 
       fc_dlog( logger, "expire_local_txns size ${s} removed ${r}", ("s", start_size)( "r", start_size - end_size ) );
+
+      seen_txns.expire( time_point::now() );
+
+      std::lock_guard<std::mutex> g_cache( trx_cache_mtx );
+      auto& old_cached = trx_cache.get<by_expiry>();
+      old_cached.erase( old_cached.lower_bound( fc::time_point_sec( 0 ) ), old_cached.upper_bound( time_point::now() ) );
+      auto& stale_cached = trx_cache.get<by_block_num>();
+      stale_cached.erase( stale_cached.lower_bound( 1 ), stale_cached.upper_bound( lib_num ) );
+   }
+
+   // thread safe
+   void dispatch_manager::cache_transaction( const packed_transaction_ptr& trx ) {
+      std::lock_guard<std::mutex> g( trx_cache_mtx );
+      trx_cache.insert( {trx->id(), trx->expiration(), 0, trx} );
+   }
+
+   // thread safe
+   packed_transaction_ptr dispatch_manager::find_transaction( const transaction_id_type& tid ) const {
+      std::lock_guard<std::mutex> g( trx_cache_mtx );
+      auto itr = trx_cache.get<by_id>().find( tid );
+      return itr != trx_cache.get<by_id>().end() ? itr->trx : packed_transaction_ptr();
+   }
+
+   // thread safe
+   std::shared_ptr<std::vector<char>> dispatch_manager::create_compact_block_buffer( const signed_block& b ) const {
+      compact_block_message msg;
+      msg.header = b;
+      msg.block_extensions = b.block_extensions;
+      msg.transactions.reserve( b.transactions.size() );
+      {
+         std::lock_guard<std::mutex> g( trx_cache_mtx );
+         const auto& index = trx_cache.get<by_id>();
+         for( const auto& r : b.transactions ) {
+            compact_transaction_receipt cr;
+            static_cast<transaction_receipt_header&>( cr ) = r;
+            if( r.trx.contains<transaction_id_type>() ) {
+               cr.id = r.trx.get<transaction_id_type>();
+               cr.packed = false;
+            } else {
+               // only transactions this node can send if asked for them
+               cr.id = r.trx.get<packed_transaction>().id();
+               if( index.find( cr.id ) == index.end() ) return {};
+            }
+            msg.transactions.emplace_back( std::move( cr ) );
+         }
+      }
+      return create_send_buffer( compact_block_which, msg );
    }
 
    void dispatch_manager::expire_blocks( uint32_t lib_num ) {
@@ -2010,7 +2751,8 @@ namespace eosio {
       if( my_impl->sync_master->syncing_with_peer() ) return;
       
       bool have_connection = false;
-      for_each_block_connection( [&have_connection]( auto& cp ) {
+      bool have_compact_connection = false;
+      for_each_block_connection( [&have_connection, &have_compact_connection]( auto& cp ) {
          peer_dlog( cp, "socket_is_open ${s}, connecting ${c}, syncing ${ss}",
                     ("s", cp->socket_is_open())("c", cp->connecting.load())("ss", cp->syncing.load()) );
 
@@ -2018,17 +2760,32 @@ namespace eosio {
             return true;
          }
          have_connection = true;
-         return false;
+         have_compact_connection |= cp->protocol_version >= proto_compact_block;
+         return true;
       } );
 
       if( !have_connection ) return;
-      std::shared_ptr<std::vector<char>> send_buffer = create_send_buffer( b );
+      std::shared_ptr<std::vector<char>> compact_buffer;
+      if( have_compact_connection ) {
+         compact_buffer = create_compact_block_buffer( *b );
+      }
+      std::shared_ptr<std::vector<char>> full_buffer;
 
-      for_each_block_connection( [this, &id, bnum = b->block_num(), &send_buffer]( auto& cp ) {
+      // best connected peers first, they pass the block on the soonest
+      for_each_block_connection_by_score( [this, &id, &b, &compact_buffer, &full_buffer]( auto& cp ) {
          if( !cp->current() ) {
             return true;
          }
-         cp->strand.post( [this, cp, id, bnum, send_buffer]() {
+         std::shared_ptr<std::vector<char>> send_buffer;
+         if( compact_buffer && cp->protocol_version >= proto_compact_block ) {
+            send_buffer = compact_buffer;
+         } else {
+            if( !full_buffer ) {
+               full_buffer = get_block_buffer( id, [&b]() { return create_send_buffer( b ); } );
+            }
+            send_buffer = full_buffer;
+         }
+         cp->strand.post( [this, cp, id, bnum = b->block_num(), send_buffer]() {
             std::unique_lock<std::mutex> g_conn( cp->conn_mtx );
             bool has_block = cp->last_handshake_recv.last_irreversible_block_num >= bnum;
             g_conn.unlock();
@@ -2038,7 +2795,7 @@ namespace eosio {
                   return;
                }
                fc_dlog( logger, "bcast block ${b} to ${p}", ("b", bnum)("p", cp->peer_name()) );
-               cp->enqueue_buffer( send_buffer, no_reason );
+               cp->enqueue_buffer( send_buffer, no_reason, write_lane::block );
             }
          });
          return true;
@@ -2063,7 +2820,29 @@ namespace eosio {
    }
 
    void dispatch_manager::rejected_block(const block_id_type& id) {
-      fc_dlog( logger, "rejected block ${id}", ("id", id) );
+      async_dlog( logger, "rejected block ${id}", "id", id );
+      std::vector<uint32_t> dropped;
+      {
+         std::lock_guard<std::mutex> g( blk_state_mtx );
+         auto itr = blks_in_flight.find( id );
+         if( itr == blks_in_flight.end() ) return;
+         dropped = std::move( itr->second );
+         blks_in_flight.erase( itr );
+      }
+      if( dropped.empty() ) return;
+
+      // the id does not cover the producer signature, the rejected copy may have been a bogus one of a valid block:
+      // whichever of the copies dropped meanwhile arrives first is applied, the others are dropped and remembered again
+      fc_dlog( logger, "requesting rejected block ${id}... from the ${n} peers whose copies were dropped",
+               ("id", id.str().substr(8,16))("n", dropped.size()) );
+      for_each_block_connection( [&id, &dropped]( auto& cp ) {
+         if( std::find( dropped.begin(), dropped.end(), cp->connection_id ) != dropped.end() ) {
+            cp->strand.post( [cp, id]() {
+               cp->request_block( id );
+            } );
+         }
+         return true;
+      } );
    }
 
    void dispatch_manager::bcast_transaction(const packed_transaction& trx) {
@@ -2072,7 +2851,7 @@ namespace eosio {
       node_transaction_state nts = {id, trx_expiration, 0, 0};
 
       std::shared_ptr<std::vector<char>> send_buffer;
-      for_each_connection( [this, &trx, &nts, &send_buffer]( auto& cp ) {
+      for_each_connection_by_score( [this, &trx, &nts, &send_buffer]( auto& cp ) {
          if( cp->is_blocks_only_connection() || !cp->current() ) {
             return true;
          }
@@ -2086,14 +2865,14 @@ namespace eosio {
 
          cp->strand.post( [cp, send_buffer]() {
             fc_dlog( logger, "sending trx to ${n}", ("n", cp->peer_name()) );
-            cp->enqueue_buffer( send_buffer, no_reason );
+            cp->enqueue_transaction_buffer( send_buffer );
          } );
          return true;
       } );
    }
 
    void dispatch_manager::rejected_transaction(const packed_transaction_ptr& trx, uint32_t head_blk_num) {
-      fc_dlog( logger, "not sending rejected transaction ${tid}", ("tid", trx->id()) );
+      async_dlog( logger, "not sending rejected transaction ${tid}", "tid", trx->id() );
       // keep rejected transaction around for awhile so we don't broadcast it
       // update its block number so it will be purged when current block number is lib
       if( trx->expiration() > fc::time_point::now() ) { // no need to update blk_num if already expired
@@ -2187,7 +2966,7 @@ namespace eosio {
 
       string::size_type colon = peer_address().find(':');
       if (colon == std::string::npos || colon == 0) {
-         fc_elog( logger, "Invalid peer address. must be \"host:port[:<blk>|<trx>]\": ${p}", ("p", peer_address()) );
+         fc_elog( logger, "Invalid peer address. must be \"host:port[:<blk>|<trx>|<split>]\": ${p}", ("p", peer_address()) );
          return false;
       }
 
@@ -2374,6 +3153,7 @@ namespace eosio {
                      }
                      EOS_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
                      conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
+                     bytes_received_metric.add( bytes_transferred );
                      while (conn->pending_message_buffer.bytes_to_read() > 0) {
                         uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
 
@@ -2444,6 +3224,67 @@ namespace eosio {
       }
    }
 
+   static bool has_webauthn_signature( const signed_block& b ) {
+      auto is_webauthn_sig = []( const fc::crypto::signature& s ) {
+         return s.which() == fc::crypto::signature::storage_type::position<fc::crypto::webauthn::signature>();
+      };
+      bool has_webauthn_sig = is_webauthn_sig( b.producer_signature );
+
+      constexpr auto additional_sigs_eid = additional_block_signatures_extension::extension_id();
+      auto exts = b.validate_and_extract_extensions();
+      if( exts.count( additional_sigs_eid ) ) {
+         const auto &additional_sigs = exts.lower_bound( additional_sigs_eid )->second.get<additional_block_signatures_extension>().signatures;
+         has_webauthn_sig |= std::any_of( additional_sigs.begin(), additional_sigs.end(), is_webauthn_sig );
+      }
+      return has_webauthn_sig;
+   }
+
+   /**
+    * Reads the id and expiration of the packed_transaction at ds without unpacking it, the id being the digest of the
+    * packed transaction when it is not compressed. Nothing is returned for a compressed transaction or sizes that do
+    * not fit in the message; a transaction encoded other than the way it packs is only found once unpacked.
+    */
+   template<typename Stream>
+   static optional<std::pair<transaction_id_type, time_point_sec>> peek_transaction_id( Stream& ds, uint32_t message_length ) {
+      char buf[1024];
+      auto skip = [&ds, &buf]( uint32_t n, transaction_id_type::encoder* enc ) {
+         while( n > 0 ) {
+            const uint32_t s = std::min<uint32_t>( n, sizeof(buf) );
+            ds.read( buf, s );
+            if( enc ) enc->write( buf, s );
+            n -= s;
+         }
+      };
+
+      unsigned_int num_sigs;
+      fc::raw::unpack( ds, num_sigs );
+      if( num_sigs.value > message_length ) return {};
+      for( uint32_t i = 0; i < num_sigs.value; ++i ) {
+         signature_type sig;
+         fc::raw::unpack( ds, sig );
+      }
+
+      fc::enum_type<uint8_t, packed_transaction::compression_type> compression;
+      fc::raw::unpack( ds, compression );
+      if( compression != packed_transaction::compression_type::none ) return {};
+
+      unsigned_int cfd_size;
+      fc::raw::unpack( ds, cfd_size );
+      if( cfd_size.value > message_length ) return {};
+      skip( cfd_size.value, nullptr );
+
+      unsigned_int trx_size;
+      fc::raw::unpack( ds, trx_size );
+      if( trx_size.value > message_length || trx_size.value < sizeof(uint32_t) ) return {};
+
+      uint32_t expiration = 0; // transaction_header::expiration, seconds
+      ds.read( reinterpret_cast<char*>( &expiration ), sizeof(expiration) );
+      transaction_id_type::encoder enc;
+      enc.write( reinterpret_cast<const char*>( &expiration ), sizeof(expiration) );
+      skip( trx_size.value - sizeof(expiration), &enc );
+      return std::make_pair( enc.result(), time_point_sec( expiration ) );
+   }
+
    // called from connection strand
    bool connection::process_next_message( uint32_t message_length ) {
       try {
@@ -2460,6 +3301,7 @@ namespace eosio {
             if( my_impl->dispatcher->have_block( blk_id ) ) {
                fc_dlog( logger, "canceling wait on ${p}, already received block ${num}, id ${id}...",
                         ("p", peer_name())("num", blk_num)("id", blk_id.str().substr(8,16)) );
+               score_.block( false );
                my_impl->sync_master->sync_recv_block( shared_from_this(), blk_id, blk_num, false );
                cancel_wait();
 
@@ -2491,25 +3333,32 @@ namespace eosio {
                }
             }
 
-            auto ds = pending_message_buffer.create_datastream();
-            fc::raw::unpack( ds, which ); // throw away
-            shared_ptr<signed_block> ptr = std::make_shared<signed_block>();
-            fc::raw::unpack( ds, *ptr );
+            // a block relayed by several peers at once is unpacked from the first copy only
+            if( !my_impl->dispatcher->claim_block( blk_id, connection_id ) ) {
+               fc_dlog( logger, "${p} sent block ${num}, id ${id}... already being applied, dropping it",
+                        ("p", peer_name())("num", blk_num)("id", blk_id.str().substr(8,16)) );
+               my_impl->dispatcher->add_peer_block( blk_id, connection_id );
+               score_.block( false );
+               my_impl->sync_master->sync_recv_block( shared_from_this(), blk_id, blk_num, false );
+               cancel_wait();
 
-            auto is_webauthn_sig = []( const fc::crypto::signature& s ) {
-               return s.which() == fc::crypto::signature::storage_type::position<fc::crypto::webauthn::signature>();
-            };
-            bool has_webauthn_sig = is_webauthn_sig( ptr->producer_signature );
+               pending_message_buffer.advance_read_ptr( message_length );
+               return true;
+            }
 
-            constexpr auto additional_sigs_eid = additional_block_signatures_extension::extension_id();
-            auto exts = ptr->validate_and_extract_extensions();
-            if( exts.count( additional_sigs_eid ) ) {
-               const auto &additional_sigs = exts.lower_bound( additional_sigs_eid )->second.get<additional_block_signatures_extension>().signatures;
-               has_webauthn_sig |= std::any_of( additional_sigs.begin(), additional_sigs.end(), is_webauthn_sig );
+            shared_ptr<signed_block> ptr = std::make_shared<signed_block>();
+            try {
+               auto ds = pending_message_buffer.create_datastream();
+               fc::raw::unpack( ds, which ); // throw away
+               fc::raw::unpack( ds, *ptr );
+            } catch( ... ) {
+               my_impl->dispatcher->release_block( blk_id );
+               throw;
             }
 
-            if( has_webauthn_sig ) {
+            if( has_webauthn_signature( *ptr ) ) {
                fc_dlog( logger, "WebAuthn signed block received from ${p}, closing connection", ("p", peer_name()));
+               my_impl->dispatcher->release_block( blk_id );
                close();
                return false;
             }
@@ -2517,16 +3366,33 @@ namespace eosio {
             handle_message( blk_id, std::move( ptr ) );
 
          } else if( which == packed_transaction_which ) {
-            if( !my_impl->p2p_accept_transactions ) {
+            if( !my_impl->p2p_accept_transactions && !pending_compact ) {
                fc_dlog( logger, "p2p-accept-transaction=false - dropping txn" );
                pending_message_buffer.advance_read_ptr( message_length );
                return true;
             }
 
+            // under a flood most transactions are ones already received from another peer, drop those without copying
+            // them out of the message buffer
+            auto peeked = peek_transaction_id( peek_ds, message_length );
+            if( peeked && !(pending_compact && pending_compact->missing.count( peeked->first )) &&
+                my_impl->dispatcher->have_txn( peeked->first ) ) {
+               my_impl->dispatcher->add_peer_txn( {peeked->first, peeked->second, 0, connection_id} );
+               score_.transaction( true );
+               async_dlog( logger, "got a duplicate transaction - dropping ${id}", "id", peeked->first );
+               pending_message_buffer.advance_read_ptr( message_length );
+               return true;
+            }
+
             auto ds = pending_message_buffer.create_datastream();
             fc::raw::unpack( ds, which ); // throw away
             shared_ptr<packed_transaction> ptr = std::make_shared<packed_transaction>();
             fc::raw::unpack( ds, *ptr );
+            if( !my_impl->p2p_accept_transactions ) {
+               // only the transactions of a compact block are used
+               add_compact_block_transaction( ptr );
+               return true;
+            }
             handle_message( std::move( ptr ) );
 
          } else {
@@ -2558,6 +3424,33 @@ namespace eosio {
       chain_fork_head_blk_id = cc.fork_db_pending_head_block_id();
       fc_dlog( logger, "updating chain info lib ${lib}, head ${head}, fork ${fork}",
                ("lib", chain_lib_num)("head", chain_head_blk_num)("fork", chain_fork_head_blk_num) );
+
+      const auto& config = cc.get_global_properties().configuration;
+      max_trx_lifetime_sec = config.max_transaction_lifetime;
+      max_trx_net_usage = config.max_transaction_net_usage;
+      ref_block_prefixes[chain_head_blk_num & 0xffff] = chain_head_blk_id._hash[1];
+   }
+
+   const char* net_plugin_impl::check_transaction( const packed_transaction& trx ) const {
+      const auto& header = trx.get_transaction();
+      const auto now = fc::time_point::now();
+      if( fc::time_point( header.expiration ) < now ) {
+         return "expired";
+      }
+      // checked by the chain against the time of the pending block which may be up to a block interval ahead
+      const uint32_t max_lifetime = max_trx_lifetime_sec;
+      if( max_lifetime > 0 && fc::time_point( header.expiration ) > now + fc::seconds( max_lifetime ) + fc::milliseconds( chain::config::block_interval_ms ) ) {
+         return "expiration too far in the future";
+      }
+      const uint32_t max_net_usage = max_trx_net_usage;
+      if( max_net_usage > 0 && trx.get_unprunable_size() + trx.get_prunable_size() > max_net_usage ) {
+         return "larger than max transaction net usage";
+      }
+      const uint32_t prefix = ref_block_prefixes[header.ref_block_num];
+      if( prefix != 0 && prefix != header.ref_block_prefix ) {
+         return "invalid reference block";
+      }
+      return nullptr;
    }
 
    //         lib_num, head_blk_num, fork_head_blk_num, lib_id, head_blk_id, fork_head_blk_id
@@ -2679,7 +3572,7 @@ namespace eosio {
          protocol_version = my_impl->to_protocol_version(msg.network_version);
          if( protocol_version != net_version ) {
             fc_ilog( logger, "Local network version: ${nv} Remote version: ${mnv}",
-                     ("nv", net_version)( "mnv", protocol_version ) );
+                     ("nv", net_version)( "mnv", protocol_version.load() ) );
          }
 
          g_conn.lock();
@@ -2779,6 +3672,8 @@ namespace eosio {
 
       double offset = (double(rec - org) + double(msg.xmt - dst)) / 2;
       double NsecPerUsec{1000};
+      if( org != 0 )
+         score_.rtt( (dst - org) - (msg.xmt - rec) );
 
       if( logger.is_enabled( fc::log_level::all ) )
          logger.log( FC_LOG_MESSAGE( all, "Clock offset is ${o}ns (${us}us)",
@@ -2887,6 +3782,11 @@ namespace eosio {
          // no break
       case normal :
          if( !msg.req_trx.ids.empty() ) {
+            if( msg.req_trx.mode == normal && protocol_version >= proto_compact_block ) {
+               // transactions of a compact block
+               send_transactions( msg.req_trx.ids, msg.req_blocks.ids );
+               break;
+            }
             fc_elog( logger, "Invalid request_message, req_trx.ids.size ${s}", ("s", msg.req_trx.ids.size()) );
             close();
             return;
@@ -2907,6 +3807,83 @@ namespace eosio {
       }
    }
 
+   /// the snapshot-<id>.bin of dir written by compressed_ostream_snapshot_writer of block_id, the newest one if empty
+   fc::optional<std::pair<block_id_type, fc::path>> find_bootstrap_snapshot( const fc::path& dir, const block_id_type& block_id ) {
+      const auto is_compressed = []( const fc::path& p ) {
+         std::ifstream in( p.generic_string(), (std::ios::in | std::ios::binary) );
+         uint32_t totem = 0;
+         in.read( (char*)&totem, sizeof(totem) );
+         return in && totem == compressed_ostream_snapshot_writer::magic_number;
+      };
+
+      if( block_id != block_id_type() ) {
+         const auto p = dir / ("snapshot-" + block_id.str() + ".bin");
+         if( fc::is_regular_file( p ) && is_compressed( p ) ) return std::make_pair( block_id, p );
+         return {};
+      }
+
+      fc::optional<std::pair<block_id_type, fc::path>> newest;
+      for( fc::directory_iterator itr( dir ), end; itr != end; ++itr ) {
+         const auto name = itr->filename().generic_string();
+         // snapshot-<64 hex digits>.bin, not the pending, incomplete or delta ones
+         const size_t id_size = 2 * sizeof(block_id_type);
+         if( name.size() != 9 + id_size + 4 || name.compare( 0, 9, "snapshot-" ) != 0 || name.compare( 9 + id_size, 4, ".bin" ) != 0 )
+            continue;
+         block_id_type id;
+         try {
+            id = block_id_type( name.substr( 9, id_size ) );
+         } catch( ... ) {
+            continue;
+         }
+         if( newest && block_header::num_from_id( id ) <= block_header::num_from_id( newest->first ) ) continue;
+         if( !is_compressed( *itr ) ) continue;
+         newest = std::make_pair( id, *itr );
+      }
+      return newest;
+   }
+
+   void connection::handle_message( const snapshot_request_message& msg ) {
+      peer_dlog( this, "received snapshot_request_message for ${id} at ${o}", ("id", msg.block_id)("o", msg.offset) );
+      snapshot_chunk_message chunk;
+      chunk.offset = msg.offset;
+      if( protocol_version < proto_snapshot_bootstrap || my_impl->snapshot_bootstrap_dir.empty() ) {
+         enqueue( chunk );
+         return;
+      }
+
+      try {
+         if( auto snapshot = find_bootstrap_snapshot( my_impl->snapshot_bootstrap_dir, msg.block_id ) ) {
+            std::ifstream in( snapshot->second.generic_string(), (std::ios::in | std::ios::binary) );
+            in.seekg( 0, std::ios::end );
+            const uint64_t size = in.tellg();
+            if( size >= sizeof(chunk.integrity_hash) && msg.offset <= size ) {
+               // the integrity hash closes the snapshot, see compressed_ostream_snapshot_writer
+               in.seekg( size - sizeof(chunk.integrity_hash) );
+               in.read( chunk.integrity_hash.data(), sizeof(chunk.integrity_hash) );
+               chunk.data.resize( std::min<uint64_t>( def_snapshot_chunk_size, size - msg.offset ) );
+               in.seekg( msg.offset );
+               in.read( chunk.data.data(), chunk.data.size() );
+               if( in ) {
+                  chunk.block_id = snapshot->first;
+                  chunk.size = size;
+               } else {
+                  chunk.data.clear();
+               }
+            }
+         }
+      } catch( const fc::exception& e ) {
+         peer_wlog( this, "unable to read bootstrap snapshot: ${e}", ("e", e.to_detail_string()) );
+         chunk = snapshot_chunk_message();
+         chunk.offset = msg.offset;
+      }
+      enqueue( chunk );
+   }
+
+   void connection::handle_message( const snapshot_chunk_message& ) {
+      // only eosio-bootstrap requests snapshots
+      peer_dlog( this, "ignoring snapshot_chunk_message" );
+   }
+
    size_t calc_trx_size( const packed_transaction_ptr& trx ) {
       // transaction is stored packed and unpacked, double packed_size and size of signed as an approximation of use
       return (trx->get_packed_transaction().size() * 2 + sizeof(trx->get_signed_transaction())) * 2 +
@@ -2918,6 +3895,8 @@ namespace eosio {
       const auto& tid = trx->id();
       peer_dlog( this, "received packed_transaction ${id}", ("id", tid) );
 
+      add_compact_block_transaction( trx );
+
       uint32_t trx_in_progress_sz = this->trx_in_progress_size.load();
       if( trx_in_progress_sz > def_max_trx_in_progress_size ) {
          char reason[72];
@@ -2929,23 +3908,31 @@ namespace eosio {
       bool have_trx = my_impl->dispatcher->have_txn( tid );
       node_transaction_state nts = {tid, trx->expiration(), 0, connection_id};
       my_impl->dispatcher->add_peer_txn( nts );
+      score_.transaction( have_trx );
 
       if( have_trx ) {
-         fc_dlog( logger, "got a duplicate transaction - dropping ${id}", ("id", tid) );
+         async_dlog( logger, "got a duplicate transaction - dropping ${id}", "id", tid );
+         return;
+      }
+
+      if( const char* reason = my_impl->check_transaction( *trx ) ) {
+         async_dlog( logger, "dropping transaction ${id}: ${r}", "id", tid, "r", reason );
+         my_impl->producer_plug->log_failed_transaction( tid, reason );
          return;
       }
 
+      // signatures are recovered on the producer thread pool, the application thread only sees the transaction once
+      // they are, so it is not posted there first
       trx_in_progress_size += calc_trx_size( trx );
-      app().post( priority::low, [trx{std::move(trx)}, weak = weak_from_this()]() {
-         my_impl->chain_plug->accept_transaction( trx,
-            [weak, trx](const static_variant<fc::exception_ptr, transaction_trace_ptr>& result) mutable {
+      my_impl->chain_plug->accept_transaction( trx,
+         [weak = weak_from_this(), trx](const static_variant<fc::exception_ptr, transaction_trace_ptr>& result) mutable {
          // next (this lambda) called from application thread
          if (result.contains<fc::exception_ptr>()) {
             fc_dlog( logger, "bad packed_transaction : ${m}", ("m", result.get<fc::exception_ptr>()->what()) );
          } else {
             const transaction_trace_ptr& trace = result.get<transaction_trace_ptr>();
             if( !trace->except ) {
-               fc_dlog( logger, "chain accepted transaction, bcast ${id}", ("id", trace->id) );
+               async_dlog( logger, "chain accepted transaction, bcast ${id}", "id", trace->id );
             } else {
                fc_elog( logger, "bad packed_transaction : ${m}", ("m", trace->except->what()));
             }
@@ -2954,18 +3941,146 @@ namespace eosio {
          if( conn ) {
             conn->trx_in_progress_size -= calc_trx_size( trx );
          }
-        });
       });
    }
 
    // called from connection strand
    void connection::handle_message( const block_id_type& id, signed_block_ptr ptr ) {
       peer_dlog( this, "received signed_block ${id}", ("id", ptr->block_num() ) );
+      // overlap signature recovery with the apply of blocks queued ahead of this one
+      my_impl->chain_plug->chain().start_block_recover_keys( ptr );
+      if( my_impl->sync_master->hold_sync_block( shared_from_this(), id, ptr ) ) {
+         // a held block is only waited on from its own peer
+         my_impl->dispatcher->release_block( id );
+         return;
+      }
       app().post(priority::medium, [ptr{std::move(ptr)}, id, c = shared_from_this()]() mutable {
          c->process_signed_block( id, std::move( ptr ) );
       });
    }
 
+   // called from connection strand
+   void connection::handle_message( const compact_block_message& msg ) {
+      const block_id_type blk_id = msg.header.calculate_id();
+      const uint32_t blk_num = msg.header.block_num();
+      peer_dlog( this, "received compact_block ${num}", ("num", blk_num) );
+      if( my_impl->dispatcher->have_block( blk_id ) ) {
+         score_.block( false );
+         my_impl->sync_master->sync_recv_block( shared_from_this(), blk_id, blk_num, false );
+         return;
+      }
+
+      if( pending_compact ) {
+         // only one block waits for transactions at a time, get the earlier one whole
+         request_block( pending_compact->id );
+      }
+      pending_compact = pending_compact_block{ blk_id, msg };
+      for( const auto& r : msg.transactions ) {
+         if( r.packed && !my_impl->dispatcher->find_transaction( r.id ) ) {
+            pending_compact->missing.insert( r.id );
+         }
+      }
+      if( pending_compact->missing.empty() ) {
+         complete_compact_block();
+         return;
+      }
+
+      peer_dlog( this, "requesting ${n} transactions of compact_block ${num}", ("n", pending_compact->missing.size())("num", blk_num) );
+      request_message req;
+      req.req_trx.mode = normal;
+      req.req_trx.ids.assign( pending_compact->missing.begin(), pending_compact->missing.end() );
+      req.req_blocks.ids.push_back( blk_id );
+      enqueue( req );
+   }
+
+   // called from connection strand
+   bool connection::add_compact_block_transaction( const packed_transaction_ptr& trx ) {
+      if( !pending_compact || pending_compact->missing.erase( trx->id() ) == 0 ) {
+         return false;
+      }
+      pending_compact->received.emplace( trx->id(), trx );
+      if( pending_compact->missing.empty() ) {
+         complete_compact_block();
+      }
+      return true;
+   }
+
+   // called from connection strand
+   void connection::complete_compact_block() {
+      pending_compact_block pending = std::move( *pending_compact );
+      pending_compact.reset();
+
+      auto b = std::make_shared<signed_block>( pending.msg.header );
+      b->block_extensions = std::move( pending.msg.block_extensions );
+      b->transactions.reserve( pending.msg.transactions.size() );
+      for( const auto& r : pending.msg.transactions ) {
+         transaction_receipt receipt;
+         static_cast<transaction_receipt_header&>( receipt ) = r;
+         if( r.packed ) {
+            auto itr = pending.received.find( r.id );
+            packed_transaction_ptr trx = itr != pending.received.end() ? itr->second : my_impl->dispatcher->find_transaction( r.id );
+            if( !trx ) {
+               peer_dlog( this, "transaction ${id} of compact_block ${num} no longer available", ("id", r.id)("num", b->block_num()) );
+               request_block( pending.id );
+               return;
+            }
+            receipt.trx = *trx;
+         } else {
+            receipt.trx = r.id;
+         }
+         b->transactions.emplace_back( std::move( receipt ) );
+      }
+
+      // a transaction with the same id but other signatures or compression changes the merkle root
+      vector<digest_type> trx_digests;
+      trx_digests.reserve( b->transactions.size() );
+      for( const auto& r : b->transactions ) {
+         trx_digests.emplace_back( r.digest() );
+      }
+      if( merkle( std::move( trx_digests ) ) != b->transaction_mroot ) {
+         peer_dlog( this, "compact_block ${num} rebuilt with different transactions", ("num", b->block_num()) );
+         request_block( pending.id );
+         return;
+      }
+
+      if( has_webauthn_signature( *b ) ) {
+         fc_dlog( logger, "WebAuthn signed block received from ${p}, closing connection", ("p", peer_name()));
+         close();
+         return;
+      }
+
+      handle_message( pending.id, std::move( b ) );
+   }
+
+   // called from connection strand
+   void connection::request_block( const block_id_type& id ) {
+      request_message req;
+      req.req_blocks.mode = normal;
+      req.req_blocks.ids.push_back( id );
+      enqueue( req );
+   }
+
+   // called from connection strand
+   void connection::send_transactions( const vector<transaction_id_type>& ids, const vector<block_id_type>& blk_ids ) {
+      vector<packed_transaction_ptr> trxs;
+      trxs.reserve( ids.size() );
+      for( const auto& id : ids ) {
+         auto trx = my_impl->dispatcher->find_transaction( id );
+         if( !trx ) {
+            peer_dlog( this, "requested transaction ${id} not available", ("id", id) );
+            if( !blk_ids.empty() ) {
+               blk_send( blk_ids.back() );
+            }
+            return;
+         }
+         trxs.emplace_back( std::move( trx ) );
+      }
+      // the peer waits for these to complete a block
+      for( const auto& trx : trxs ) {
+         enqueue_buffer( create_send_buffer( *trx ), no_reason, write_lane::block );
+      }
+   }
+
    // called from application thread
    void connection::process_signed_block( const block_id_type& blk_id, signed_block_ptr msg ) {
       controller& cc = my_impl->chain_plug->chain();
@@ -2974,14 +4089,18 @@ namespace eosio {
       connection_ptr c = shared_from_this();
 
       // if we have closed connection then stop processing
-      if( !c->socket_is_open() )
+      if( !c->socket_is_open() ) {
+         my_impl->dispatcher->release_block( blk_id );
          return;
+      }
 
       try {
          if( cc.fetch_block_by_id(blk_id) ) {
+            c->score_.block( false );
             c->strand.post( [sync_master = my_impl->sync_master.get(),
                              dispatcher = my_impl->dispatcher.get(), c, blk_id, blk_num]() {
                dispatcher->add_peer_block( blk_id, c->connection_id );
+               dispatcher->release_block( blk_id );
                sync_master->sync_recv_block( c, blk_id, blk_num, false );
             });
             return;
@@ -2999,7 +4118,10 @@ namespace eosio {
       try {
          bool accepted = my_impl->chain_plug->accept_block(msg, blk_id);
          my_impl->update_chain_info();
-         if( !accepted ) return;
+         if( !accepted ) {
+            my_impl->dispatcher->release_block( blk_id );
+            return;
+         }
          reason = no_reason;
       } catch( const unlinkable_block_exception &ex) {
          peer_elog(c, "unlinkable_block_exception #${n} ${id}...: ${m}", ("n", blk_num)("id", blk_id.str().substr(8,16))("m",ex.to_string()));
@@ -3016,9 +4138,11 @@ namespace eosio {
       }
 
       if( reason == no_reason ) {
+         c->score_.block( true );
          boost::asio::post( my_impl->thread_pool->get_executor(), [dispatcher = my_impl->dispatcher.get(), cid=c->connection_id, blk_id, msg]() {
-            fc_dlog( logger, "accepted signed_block : #${n} ${id}...", ("n", msg->block_num())("id", blk_id.str().substr(8,16)) );
+            async_dlog( logger, "accepted signed_block : #${n} ${id}...", "n", msg->block_num(), "id", short_id{blk_id} );
             dispatcher->add_peer_block( blk_id, cid );
+            dispatcher->release_block( blk_id );
             dispatcher->update_txns_block_num( msg );
          });
          c->strand.post( [sync_master = my_impl->sync_master.get(), dispatcher = my_impl->dispatcher.get(), c, blk_id, blk_num]() {
@@ -3153,6 +4277,11 @@ namespace eosio {
          ++it;
       }
       g.unlock();
+      if( !from ) {
+         // a full pass
+         client_connections_metric.set( num_clients );
+         peer_connections_metric.set( num_peers );
+      }
       if( num_clients > 0 || num_peers > 0 )
          fc_ilog( logger, "p2p client connections: ${num}/${max}, peer connections: ${pnum}/${pmax}",
                   ("num", num_clients)("max", max_client_count)("pnum", num_peers)("pmax", supplied_peers.size()) );
@@ -3167,7 +4296,7 @@ namespace eosio {
       update_chain_info();
       controller& cc = chain_plug->chain();
       dispatcher->strand.post( [this, bs]() {
-         fc_dlog( logger, "signaled accepted_block, blk num = ${num}, id = ${id}", ("num", bs->block_num)("id", bs->id) );
+         async_dlog( logger, "signaled accepted_block, blk num = ${num}, id = ${id}", "num", bs->block_num, "id", bs->id );
          dispatcher->bcast_block( bs->block, bs->id );
       });
    }
@@ -3179,7 +4308,7 @@ namespace eosio {
       if( cc.is_trusted_producer(block->producer) ) {
          dispatcher->strand.post( [this, block]() {
             auto id = block->id();
-            fc_dlog( logger, "signaled pre_accepted_block, blk num = ${num}, id = ${id}", ("num", block->block_num())("id", id) );
+            async_dlog( logger, "signaled pre_accepted_block, blk num = ${num}, id = ${id}", "num", block->block_num(), "id", id );
             dispatcher->bcast_block( block, id );
          });
       }
@@ -3187,7 +4316,7 @@ namespace eosio {
 
    // called from application thread
    void net_plugin_impl::on_irreversible_block( const block_state_ptr& block) {
-      fc_dlog( logger, "on_irreversible_block, blk num = ${num}, id = ${id}", ("num", block->block_num)("id", block->id) );
+      async_dlog( logger, "on_irreversible_block, blk num = ${num}, id = ${id}", "num", block->block_num, "id", block->id );
       update_chain_info();
    }
 
@@ -3202,7 +4331,8 @@ namespace eosio {
             std::tie( std::ignore, head_blk_num, std::ignore, std::ignore, std::ignore, std::ignore ) = get_chain_info();
             dispatcher->rejected_transaction(results.second->packed_trx(), head_blk_num);
          } else {
-            fc_dlog( logger, "signaled ACK, trx-id = ${id}", ("id", id) );
+            async_dlog( logger, "signaled ACK, trx-id = ${id}", "id", id );
+            dispatcher->cache_transaction(results.second->packed_trx());
             dispatcher->bcast_transaction(*results.second->packed_trx());
          }
       });
@@ -3340,14 +4470,19 @@ namespace eosio {
          ( "p2p-server-address", bpo::value<string>(), "An externally accessible host:port for identifying this node. Defaults to p2p-listen-endpoint.")
          ( "p2p-peer-address", bpo::value< vector<string> >()->composing(),
            "The public endpoint of a peer node to connect to. Use multiple p2p-peer-address options as needed to compose a network.\n"
-           "  Syntax: host:port[:<trx>|<blk>]\n"
+           "  Syntax: host:port[:<trx>|<blk>|<split>]\n"
            "  The optional 'trx' and 'blk' indicates to node that only transactions 'trx' or blocks 'blk' should be sent."
+           "  'split' opens both a 'blk' and a 'trx' connection to the peer so a stalled transaction stream does not hold up blocks,"
+           " the peer needs a p2p-max-nodes-per-host of at least 2.\n"
            "  Examples:\n"
            "    p2p.eos.io:9876\n"
            "    p2p.trx.eos.io:9876:trx\n"
-           "    p2p.blk.eos.io:9876:blk\n")
+           "    p2p.blk.eos.io:9876:blk\n"
+           "    p2p.bp.eos.io:9876:split\n")
          ( "p2p-max-nodes-per-host", bpo::value<int>()->default_value(def_max_nodes_per_host), "Maximum number of client nodes from any single IP address")
          ( "p2p-accept-transactions", bpo::value<bool>()->default_value(true), "Allow transactions received over p2p network to be evaluated and relayed if valid.")
+         ( "p2p-snapshot-bootstrap-dir", bpo::value<boost::filesystem::path>(),
+           "Serve the newest compressed snapshot-<id>.bin of this directory (absolute path or relative to application data dir) to the eosio-bootstrap of new nodes, for example the snapshots dir of producer_plugin with snapshot-compression and snapshot-block-interval.")
          ( "agent-name", bpo::value<string>()->default_value("\"EOS Test Agent\""), "The name supplied to identify this node amongst the peers.")
          ( "allowed-connection", bpo::value<vector<string>>()->multitoken()->default_value({"any"}, "any"), "Can be 'any' or 'producers' or 'specified' or 'none'. If 'specified', peer-key must be specified at least once. If only 'producers', peer-key is not required. 'producers' and 'specified' may be combined.")
          ( "peer-key", bpo::value<vector<string>>()->composing()->multitoken(), "Optional public key of peer allowed to connect.  May be used multiple times.")
@@ -3358,7 +4493,19 @@ namespace eosio {
          ( "max-cleanup-time-msec", bpo::value<int>()->default_value(10), "max connection cleanup time per cleanup call in millisec")
          ( "net-threads", bpo::value<uint16_t>()->default_value(my->thread_pool_size),
            "Number of worker threads in net_plugin thread pool" )
+         ( "net-threads-cpu", bpo::value<vector<string>>()->composing()->multitoken(),
+           "CPUs to pin the worker threads of the net_plugin thread pool to in turn, as for chain-threads-cpu, unpinned if not given" )
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
+         ( "p2p-trx-flush-interval-us", bpo::value<uint32_t>()->default_value(def_trx_flush_interval_us),
+           "Microseconds relayed transactions are held back so the ones that follow are written to a peer together, 0 to write each right away")
+         ( "p2p-trx-flush-size", bpo::value<uint32_t>()->default_value(def_trx_flush_size),
+           "Bytes of held back transactions that are written to a peer without waiting for p2p-trx-flush-interval-us")
+         ( "sync-peer-count", bpo::value<uint32_t>()->default_value(def_sync_peer_count),
+           "number of peers that blocks are requested from at the same time while catching up to the last irreversible block, each serving its own range of sync-fetch-span blocks")
+         ( "block-buffer-cache-size-mb", bpo::value<uint32_t>()->default_value(def_block_buffer_cache_size_mb),
+           "Maximum size in MiB of the serialized blocks kept to be sent to other peers, so each block is packed only once")
+         ( "p2p-trx-filter-size-mb", bpo::value<uint32_t>()->default_value(def_trx_filter_size_mb),
+           "Size in MiB of the filter that recognizes transactions not seen before without a lookup in the transaction index, 0 to disable")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable experimental socket read watermark optimization")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
@@ -3383,7 +4530,9 @@ namespace eosio {
       try {
          peer_log_format = options.at( "peer-log-format" ).as<string>();
 
-         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>()));
+         const auto sync_peer_count = options.at( "sync-peer-count" ).as<uint32_t>();
+         EOS_ASSERT( sync_peer_count > 0, chain::plugin_config_exception, "sync-peer-count must be greater than 0" );
+         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>(), sync_peer_count ));
 
          my->connector_period = std::chrono::seconds( options.at( "connection-cleanup-period" ).as<int>());
          my->max_cleanup_time_ms = options.at("max-cleanup-time-msec").as<int>();
@@ -3392,6 +4541,12 @@ namespace eosio {
          my->max_client_count = options.at( "max-clients" ).as<int>();
          my->max_nodes_per_host = options.at( "p2p-max-nodes-per-host" ).as<int>();
          my->p2p_accept_transactions = options.at( "p2p-accept-transactions" ).as<bool>();
+         if( options.count( "p2p-snapshot-bootstrap-dir" ) ) {
+            auto dir = options.at( "p2p-snapshot-bootstrap-dir" ).as<boost::filesystem::path>();
+            my->snapshot_bootstrap_dir = dir.is_relative() ? app().data_dir() / dir : dir;
+            EOS_ASSERT( fc::is_directory( my->snapshot_bootstrap_dir ), chain::plugin_config_exception,
+                        "p2p-snapshot-bootstrap-dir ${d} is not a directory", ("d", my->snapshot_bootstrap_dir.generic_string()) );
+         }
 
          my->use_socket_read_watermark = options.at( "use-socket-read-watermark" ).as<bool>();
 
@@ -3407,6 +4562,12 @@ namespace eosio {
          }
 
          my->thread_pool_size = options.at( "net-threads" ).as<uint16_t>();
+         if( options.count( "net-threads-cpu" ) )
+            my->thread_pool_cpus = chain::parse_cpus( options.at( "net-threads-cpu" ).as<vector<string>>() );
+         my->block_buffer_cache_size = size_t(options.at( "block-buffer-cache-size-mb" ).as<uint32_t>()) * 1024*1024;
+         my->trx_filter_size = size_t(options.at( "p2p-trx-filter-size-mb" ).as<uint32_t>()) * 1024*1024;
+         my->trx_flush_interval = std::chrono::microseconds( options.at( "p2p-trx-flush-interval-us" ).as<uint32_t>() );
+         my->trx_flush_size = options.at( "p2p-trx-flush-size" ).as<uint32_t>();
          EOS_ASSERT( my->thread_pool_size > 0, chain::plugin_config_exception,
                      "net-threads ${num} must be greater than 0", ("num", my->thread_pool_size) );
 
@@ -3482,9 +4643,9 @@ namespace eosio {
 
       my->producer_plug = app().find_plugin<producer_plugin>();
 
-      my->thread_pool.emplace( "net", my->thread_pool_size );
+      my->thread_pool.emplace( "net", my->thread_pool_size, my->thread_pool_cpus );
 
-      my->dispatcher.reset( new dispatch_manager( my_impl->thread_pool->get_executor() ) );
+      my->dispatcher.reset( new dispatch_manager( my_impl->thread_pool->get_executor(), my->block_buffer_cache_size, my->trx_filter_size ) );
 
       if( !my->p2p_accept_transactions && my->p2p_address.size() ) {
          fc_ilog( logger, "\n"
@@ -3617,6 +4778,7 @@ namespace eosio {
          }
 
          app().post( 0, [me = my](){} ); // keep my pointer alive until queue is drained
+         chain::async_log::instance().flush();
          fc_ilog( logger, "exit shutdown" );
       }
       FC_CAPTURE_AND_RETHROW()
@@ -3625,7 +4787,25 @@ namespace eosio {
    /**
     *  Used to trigger a new connection from RPC API
     */
+   namespace {
+      /// @return host without the split connection type, empty if host is not of that type
+      string split_peer_address( const string& host ) {
+         static const string split_suffix = ":split";
+         if( host.size() <= split_suffix.size() ||
+             host.compare( host.size() - split_suffix.size(), split_suffix.size(), split_suffix ) != 0 )
+            return {};
+         return host.substr( 0, host.size() - split_suffix.size() );
+      }
+   }
+
    string net_plugin::connect( const string& host ) {
+      const auto split = split_peer_address( host );
+      if( !split.empty() ) {
+         auto blk = connect( split + ":blk" );
+         auto trx = connect( split + ":trx" );
+         return blk == trx ? blk : "blocks: " + blk + ", transactions: " + trx;
+      }
+
       std::lock_guard<std::shared_mutex> g( my->connections_mtx );
       if( my->find_connection( host ) )
          return "already connected";
@@ -3640,6 +4820,13 @@ namespace eosio {
    }
 
    string net_plugin::disconnect( const string& host ) {
+      const auto split = split_peer_address( host );
+      if( !split.empty() ) {
+         auto blk = disconnect( split + ":blk" );
+         auto trx = disconnect( split + ":trx" );
+         return blk == trx ? blk : "blocks: " + blk + ", transactions: " + trx;
+      }
+
       std::lock_guard<std::shared_mutex> g( my->connections_mtx );
       for( auto itr = my->connections.begin(); itr != my->connections.end(); ++itr ) {
          if( (*itr)->peer_address() == host ) {
@@ -124,6 +124,14 @@ void producer_api_plugin::plugin_startup() {
                                  producer_plugin::get_supported_protocol_features_params), 201),
        CALL(producer, producer, get_account_ram_corrections,
             INVOKE_R_R(producer, get_account_ram_corrections, producer_plugin::get_account_ram_corrections_params), 201),
+       CALL(producer, producer, get_incoming_transactions,
+            INVOKE_R_R(producer, get_incoming_transactions, producer_plugin::get_incoming_transactions_params), 201),
+       CALL(producer, producer, get_block_timelines,
+            INVOKE_R_R(producer, get_block_timelines, producer_plugin::get_block_timelines_params), 201),
+       CALL(producer, producer, get_contract_usage,
+            INVOKE_R_R(producer, get_contract_usage, producer_plugin::get_contract_usage_params), 201),
+       CALL(producer, producer, write_trace_spans,
+            INVOKE_R_V(producer, write_trace_spans), 201),
    }, appbase::priority::medium_high);
 }
 
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <eosio/chain/exceptions.hpp>
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace eosio {
+
+/**
+ * A std::streambuf writing a file from a thread of its own, so that the thread filling it never waits on the disk
+ * unless max_queued_chunks chunks are already waiting for it. Bytes are buffered in chunks of chunk_size, queued in
+ * order and written with pwrite at their offset, which also supports seeking back to patch what was written before;
+ * reading is not supported.
+ *
+ * Once finish is called nothing more may be written: the thread writes what is queued, syncs and closes the file, and
+ * then calls the done function with the first error, if any. Only the thread filling it may call its functions.
+ */
+class background_file_buf : public std::streambuf {
+public:
+   static constexpr size_t chunk_size = 1024*1024;
+   static constexpr size_t max_queued_chunks = 64;
+
+   using done_function = std::function<void( const std::string& error )>; ///< error is empty on success
+
+   explicit background_file_buf( const std::string& path )
+   : _fd( ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 ) )
+   {
+      EOS_ASSERT( _fd >= 0, chain::snapshot_exception, "Unable to open ${p}: ${e}", ("p", path)("e", std::strerror( errno )) );
+      reset_put_area();
+      _thread = std::thread( [this]() { run(); } );
+   }
+
+   /// what is queued is still written, what is buffered is dropped unless finish was called
+   ~background_file_buf() override {
+      {
+         std::lock_guard<std::mutex> g( _mtx );
+         _finished = true;
+      }
+      _cv.notify_all();
+      _thread.join();
+   }
+
+   background_file_buf( const background_file_buf& ) = delete;
+   background_file_buf& operator=( const background_file_buf& ) = delete;
+
+   void finish( done_function done ) {
+      queue_chunk();
+      {
+         std::lock_guard<std::mutex> g( _mtx );
+         _done = std::move( done );
+         _finished = true;
+      }
+      _cv.notify_all();
+   }
+
+protected:
+   int_type overflow( int_type c ) override {
+      queue_chunk();
+      if( !traits_type::eq_int_type( c, traits_type::eof() ) ) {
+         *pptr() = traits_type::to_char_type( c );
+         pbump( 1 );
+      }
+      return traits_type::not_eof( c );
+   }
+
+   int sync() override {
+      queue_chunk();
+      return 0;
+   }
+
+   pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which ) override {
+      if( !(which & std::ios_base::out) ) return pos_type( off_type( -1 ) );
+      const uint64_t current = _offset + (pptr() - pbase());
+      // tellp, which must not cut the chunk
+      if( dir == std::ios_base::cur && off == 0 ) return pos_type( off_type( current ) );
+
+      _end = std::max( _end, current );
+      const off_type target = off + (dir == std::ios_base::beg ? 0 : dir == std::ios_base::cur ? current : _end);
+      if( target < 0 ) return pos_type( off_type( -1 ) );
+      queue_chunk();
+      _offset = target;
+      return pos_type( target );
+   }
+
+   pos_type seekpos( pos_type pos, std::ios_base::openmode which ) override {
+      return seekoff( off_type( pos ), std::ios_base::beg, which );
+   }
+
+private:
+   struct chunk {
+      uint64_t           offset = 0;
+      std::vector<char>  data;
+   };
+
+   void reset_put_area() {
+      _buffer.resize( chunk_size );
+      setp( _buffer.data(), _buffer.data() + _buffer.size() );
+   }
+
+   /// hands the put area to the thread, waiting while max_queued_chunks are queued
+   void queue_chunk() {
+      const size_t size = pptr() - pbase();
+      if( !size ) return;
+      chunk c{ _offset, std::move( _buffer ) };
+      c.data.resize( size );
+      _offset += size;
+      _end = std::max( _end, _offset );
+      {
+         std::unique_lock<std::mutex> g( _mtx );
+         _cv.wait( g, [this]() { return _queue.size() < max_queued_chunks; } );
+         _queue.emplace_back( std::move( c ) );
+      }
+      _cv.notify_all();
+      _buffer = std::vector<char>();
+      reset_put_area();
+   }
+
+   void write( const chunk& c ) {
+      size_t written = 0;
+      while( written < c.data.size() && _error.empty() ) {
+         const ssize_t r = ::pwrite( _fd, c.data.data() + written, c.data.size() - written, c.offset + written );
+         if( r < 0 && errno == EINTR ) continue;
+         if( r < 0 ) _error = std::strerror( errno );
+         else written += r;
+      }
+   }
+
+   void run() {
+      std::unique_lock<std::mutex> g( _mtx );
+      while( true ) {
+         _cv.wait( g, [this]() { return !_queue.empty() || _finished; } );
+         if( _queue.empty() ) break;
+         chunk c = std::move( _queue.front() );
+         _queue.pop_front();
+         g.unlock();
+         _cv.notify_all();
+         write( c );
+         g.lock();
+      }
+      done_function done = std::move( _done );
+      g.unlock();
+
+      if( _error.empty() && ::fsync( _fd ) != 0 ) _error = std::strerror( errno );
+      if( ::close( _fd ) != 0 && _error.empty() ) _error = std::strerror( errno );
+      if( done ) done( _error );
+   }
+
+   int                      _fd = -1;
+   std::vector<char>        _buffer;       ///< the put area
+   uint64_t                 _offset = 0;   ///< in the file of the put area
+   uint64_t                 _end = 0;      ///< of the bytes written so far
+
+   std::mutex               _mtx;
+   std::condition_variable  _cv;
+   std::deque<chunk>        _queue;
+   bool                     _finished = false;
+   done_function            _done;
+   std::string              _error;        ///< written by the thread only
+   std::thread              _thread;
+};
+
+} // eosio
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+
+#include <array>
+#include <vector>
+
+namespace eosio {
+
+/**
+ * Where the time went while building each of the last blocks produced, kept in a ring buffer of fixed size so that
+ * recording a block does not allocate. Not thread safe.
+ */
+class block_timeline_log {
+public:
+   enum class phase {
+      start,      ///< aborting the previous pending block and starting the block
+      expire,     ///< purging expired persisted, blacklisted and subjectively billed transactions
+      reapply,    ///< re-applying previously applied transactions
+      scheduled,  ///< scheduled transactions, and the incoming ones interleaved with them
+      incoming,   ///< incoming transactions
+      finalize,   ///< finalizing the block, signing excluded
+      sign,
+      commit      ///< committing the block, which hands it to the network
+   };
+   static constexpr size_t num_phases = static_cast<size_t>(phase::commit) + 1;
+
+   static const char* to_string( phase p ) {
+      static const char* names[num_phases] = { "start", "expire", "reapply", "scheduled", "incoming", "finalize", "sign", "commit" };
+      return names[static_cast<size_t>(p)];
+   }
+
+   struct phase_time {
+      int64_t   time_us = 0;
+      uint32_t  transactions = 0; ///< added to the block
+   };
+
+   struct entry {
+      uint32_t                             block_num = 0;
+      chain::block_id_type                 id;
+      fc::time_point                       block_time;
+      fc::time_point                       started;    ///< when the block was started
+      fc::time_point                       produced;   ///< when it was committed
+      std::array<phase_time, num_phases>   phases;
+   };
+
+   /// @param capacity blocks kept, 0 to keep none
+   explicit block_timeline_log( size_t capacity = 0 ) { set_capacity( capacity ); }
+
+   void set_capacity( size_t capacity ) {
+      _entries.assign( capacity, entry{} );
+      _next = 0;
+      _size = 0;
+      _building = false;
+   }
+
+   /// @return true while a block started with start is recorded
+   bool building() const { return _building; }
+
+   void start( uint32_t block_num, const fc::time_point& block_time, const fc::time_point& now ) {
+      if( _entries.empty() ) return;
+      _current = entry{};
+      _current.block_num = block_num;
+      _current.block_time = block_time;
+      _current.started = now;
+      _building = true;
+   }
+
+   void add( phase p, const fc::microseconds& elapsed, uint32_t transactions ) {
+      if( !_building ) return;
+      auto& t = _current.phases[static_cast<size_t>(p)];
+      t.time_us += elapsed.count();
+      t.transactions += transactions;
+   }
+
+   /// keep the block being recorded, produced as id
+   void finish( const chain::block_id_type& id, const fc::time_point& now ) {
+      if( !_building ) return;
+      _current.id = id;
+      _current.produced = now;
+      _entries[_next] = _current;
+      _next = (_next + 1) % _entries.size();
+      if( _size < _entries.size() ) ++_size;
+      _building = false;
+   }
+
+   /// drop the block being recorded, it is not produced
+   void abort() { _building = false; }
+
+   size_t size() const { return _size; }
+
+   /// call f with up to limit of the blocks kept, most recent first
+   template<typename F>
+   void for_each( size_t limit, F&& f ) const {
+      for( size_t i = 1; i <= std::min( limit, _size ); ++i ) {
+         f( _entries[(_next + _entries.size() - i) % _entries.size()] );
+      }
+   }
+
+private:
+   std::vector<entry>   _entries;
+   size_t               _next = 0;   ///< entry the next finished block goes to
+   size_t               _size = 0;
+   entry                _current;
+   bool                 _building = false;
+};
+
+} //eosio
@@ -47,6 +47,10 @@ public:
       std::string          snapshot_name;
    };
 
+   struct trace_spans_information {
+      std::string          file_name;
+   };
+
    struct scheduled_protocol_feature_activations {
       std::vector<chain::digest_type> protocol_features_to_activate;
    };
@@ -68,6 +72,66 @@ public:
       optional<account_name>   more;
    };
 
+   struct get_incoming_transactions_params {
+      uint32_t limit = 10;
+   };
+
+   struct incoming_transaction {
+      chain::transaction_id_type id;
+      account_name               first_authorizer;
+      double                     score = 0;
+   };
+
+   struct get_incoming_transactions_result {
+      uint64_t                           size = 0;
+      uint64_t                           size_in_bytes = 0;
+      std::vector<incoming_transaction>  transactions; ///< in the order they are applied
+   };
+
+   struct get_block_timelines_params {
+      uint32_t limit = 10;
+   };
+
+   struct block_timeline_phase {
+      std::string  name;
+      int64_t      time_us = 0;
+      uint32_t     transactions = 0; ///< added to the block during the phase
+   };
+
+   struct block_timeline {
+      uint32_t                           block_num = 0;
+      chain::block_id_type               id;
+      fc::time_point                     block_time;
+      fc::time_point                     started;
+      fc::time_point                     produced;
+      std::vector<block_timeline_phase>  phases;
+   };
+
+   struct get_block_timelines_result {
+      std::vector<block_timeline>  timelines; ///< most recent first
+   };
+
+   struct get_contract_usage_params {
+      uint32_t     limit = 10;
+      uint32_t     windows = 0;                ///< most recent windows aggregated over, 0 for all
+      std::string  sort_by = "billed_cpu";     ///< wall, billed_cpu, db_intrinsics, ram_delta or calls
+   };
+
+   struct contract_usage {
+      account_name  receiver;
+      action_name   action;
+      uint64_t      calls = 0;
+      int64_t       wall_us = 0;
+      int64_t       billed_cpu_us = 0;
+      uint64_t      db_intrinsics = 0;
+      int64_t       ram_delta = 0;
+   };
+
+   struct get_contract_usage_result {
+      fc::time_point               window_start;
+      std::vector<contract_usage>  actions; ///< largest sort_by first
+   };
+
    template<typename T>
    using next_function = std::function<void(const fc::static_variant<fc::exception_ptr, T>&)>;
 
@@ -103,6 +167,9 @@ public:
    integrity_hash_information get_integrity_hash() const;
    void create_snapshot(next_function<snapshot_information> next);
 
+   /// write the spans of the hot paths of the controller kept so far as a Chrome trace, also done on SIGUSR1
+   trace_spans_information write_trace_spans() const;
+
    scheduled_protocol_feature_activations get_scheduled_protocol_feature_activations() const;
    void schedule_protocol_feature_activations(const scheduled_protocol_feature_activations& schedule);
 
@@ -110,6 +177,15 @@ public:
 
    get_account_ram_corrections_result  get_account_ram_corrections( const get_account_ram_corrections_params& params ) const;
 
+   /// the incoming transactions waiting to be applied, highest incoming-transaction-priority score first
+   get_incoming_transactions_result get_incoming_transactions( const get_incoming_transactions_params& params ) const;
+
+   /// time spent in each phase of building the last blocks produced
+   get_block_timelines_result get_block_timelines( const get_block_timelines_params& params ) const;
+
+   /// the (receiver, action)s which cost the node the most over the last contract-usage-windows
+   get_contract_usage_result get_contract_usage( const get_contract_usage_params& params ) const;
+
    void log_failed_transaction(const transaction_id_type& trx_id, const char* reason) const;
 
  private:
@@ -123,7 +199,18 @@ FC_REFLECT(eosio::producer_plugin::greylist_params, (accounts));
 FC_REFLECT(eosio::producer_plugin::whitelist_blacklist, (actor_whitelist)(actor_blacklist)(contract_whitelist)(contract_blacklist)(action_blacklist)(key_blacklist) )
 FC_REFLECT(eosio::producer_plugin::integrity_hash_information, (head_block_id)(integrity_hash))
 FC_REFLECT(eosio::producer_plugin::snapshot_information, (head_block_id)(snapshot_name))
+FC_REFLECT(eosio::producer_plugin::trace_spans_information, (file_name))
 FC_REFLECT(eosio::producer_plugin::scheduled_protocol_feature_activations, (protocol_features_to_activate))
 FC_REFLECT(eosio::producer_plugin::get_supported_protocol_features_params, (exclude_disabled)(exclude_unactivatable))
 FC_REFLECT(eosio::producer_plugin::get_account_ram_corrections_params, (lower_bound)(upper_bound)(limit)(reverse))
 FC_REFLECT(eosio::producer_plugin::get_account_ram_corrections_result, (rows)(more))
+FC_REFLECT(eosio::producer_plugin::get_incoming_transactions_params, (limit))
+FC_REFLECT(eosio::producer_plugin::incoming_transaction, (id)(first_authorizer)(score))
+FC_REFLECT(eosio::producer_plugin::get_incoming_transactions_result, (size)(size_in_bytes)(transactions))
+FC_REFLECT(eosio::producer_plugin::get_block_timelines_params, (limit))
+FC_REFLECT(eosio::producer_plugin::block_timeline_phase, (name)(time_us)(transactions))
+FC_REFLECT(eosio::producer_plugin::block_timeline, (block_num)(id)(block_time)(started)(produced)(phases))
+FC_REFLECT(eosio::producer_plugin::get_block_timelines_result, (timelines))
+FC_REFLECT(eosio::producer_plugin::get_contract_usage_params, (limit)(windows)(sort_by))
+FC_REFLECT(eosio::producer_plugin::contract_usage, (receiver)(action)(calls)(wall_us)(billed_cpu_us)(db_intrinsics)(ram_delta))
+FC_REFLECT(eosio::producer_plugin::get_contract_usage_result, (window_start)(actions))
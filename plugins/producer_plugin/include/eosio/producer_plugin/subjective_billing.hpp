@@ -13,6 +13,12 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
 namespace eosio {
 
 namespace bmi = boost::multi_index;
@@ -22,6 +28,12 @@ using chain::block_state_ptr;
 using chain::packed_transaction;
 namespace config = chain::config;
 
+/**
+ * Subjective CPU bill of the first authorizers of transactions: the CPU of their transactions that may still make it
+ * into a block, and a decaying accumulation of the CPU of their transactions that expired or failed.
+ *
+ * Accounts are kept in shards, so get_subjective_bill can be called from any thread while the main thread bills.
+ */
 class subjective_billing {
 private:
 
@@ -45,21 +57,31 @@ private:
    using decaying_accumulator = chain::resource_limits::impl::exponential_decay_accumulator<>;
 
    struct subjective_billing_info {
-      uint64_t              pending_cpu_us;        // tracked cpu us for transactions that may still succeed in a block
+      uint64_t              pending_cpu_us = 0;    // tracked cpu us for transactions that may still succeed in a block
+      uint64_t              in_block_cpu_us = 0;   // part of pending_cpu_us accounted for in the pending block
       decaying_accumulator  expired_accumulator;   // accumulator used to account for transactions that have expired
 
-      bool empty(uint32_t time_ordinal) {
-         return pending_cpu_us == 0 && expired_accumulator.value_at(time_ordinal, expired_accumulator_average_window) == 0;
+      bool empty(uint32_t time_ordinal) const {
+         return pending_cpu_us == 0 && in_block_cpu_us == 0 &&
+                expired_accumulator.value_at(time_ordinal, expired_accumulator_average_window) == 0;
       }
    };
 
-   using account_subjective_bill_cache = std::map<account_name, subjective_billing_info>;
-   using block_subjective_bill_cache = std::map<account_name, uint64_t>;
+   /// accounts are spread over shards by a hash of their name, each shard has its own lock
+   struct account_shard {
+      mutable std::mutex                                             mtx;
+      std::unordered_map<account_name, subjective_billing_info>      accounts;
+   };
+
+   static constexpr size_t num_account_shards = 64;
 
-   bool                                      _disabled = false;
-   trx_cache_index                           _trx_cache_index;
-   account_subjective_bill_cache             _account_subjective_bill_cache;
-   block_subjective_bill_cache               _block_subjective_bill_cache;
+   std::atomic<bool>                               _disabled{false};
+   std::mutex                                      _trx_cache_mtx;  ///< locked before any account shard
+   trx_cache_index                                 _trx_cache_index;
+   std::array<account_shard, num_account_shards>   _account_shards;
+   std::vector<account_name>                       _in_block_accounts; ///< with in_block_cpu_us, guarded by _trx_cache_mtx
+   /// (ordinal at which an expired accumulator has decayed to 0, account), in ordinal order
+   std::deque<std::pair<uint32_t, account_name>>   _decay_queue;
 
 private:
    uint32_t time_ordinal_for( const fc::time_point& t ) const {
@@ -68,40 +90,72 @@ private:
       return ordinal;
    }
 
+   static size_t shard_index( const account_name& a ) {
+      static_assert( num_account_shards == 64, "shard_index takes the top 6 bits of the hash" );
+      // the low bits of most names are zero, spread them with a multiplicative hash
+      return (a.to_uint64_t() * 0x9E3779B97F4A7C15ull) >> 58;
+   }
+   account_shard& shard_for( const account_name& a ) { return _account_shards[shard_index( a )]; }
+   const account_shard& shard_for( const account_name& a ) const { return _account_shards[shard_index( a )]; }
+
+   /// _trx_cache_mtx, which guards _decay_queue, and the shard of account have to be locked
+   void add_expired( subjective_billing_info& info, const account_name& account, uint64_t bill, uint32_t time_ordinal ) {
+      const bool new_ordinal = info.expired_accumulator.last_ordinal < time_ordinal || info.expired_accumulator.value_ex == 0;
+      info.expired_accumulator.add(bill, time_ordinal, expired_accumulator_average_window);
+      if( new_ordinal ) {
+         _decay_queue.emplace_back( time_ordinal + expired_accumulator_average_window, account );
+      }
+   }
+
    void remove_subjective_billing( const trx_cache_entry& entry, uint32_t time_ordinal ) {
-      auto aitr = _account_subjective_bill_cache.find( entry.account );
-      if( aitr != _account_subjective_bill_cache.end() ) {
-         aitr->second.pending_cpu_us -= entry.subjective_cpu_bill;
-         EOS_ASSERT( aitr->second.pending_cpu_us >= 0, chain::tx_resource_exhaustion,
+      auto& shard = shard_for( entry.account );
+      std::lock_guard<std::mutex> g( shard.mtx );
+      auto aitr = shard.accounts.find( entry.account );
+      if( aitr != shard.accounts.end() ) {
+         EOS_ASSERT( aitr->second.pending_cpu_us >= entry.subjective_cpu_bill, chain::tx_resource_exhaustion,
                      "Logic error in subjective account billing ${a}", ("a", entry.account) );
-         if( aitr->second.empty(time_ordinal) ) _account_subjective_bill_cache.erase( aitr );
+         aitr->second.pending_cpu_us -= entry.subjective_cpu_bill;
+         if( aitr->second.empty(time_ordinal) ) shard.accounts.erase( aitr );
       }
    }
 
    void transition_to_expired( const trx_cache_entry& entry, uint32_t time_ordinal ) {
-      auto aitr = _account_subjective_bill_cache.find( entry.account );
-      if( aitr != _account_subjective_bill_cache.end() ) {
+      auto& shard = shard_for( entry.account );
+      std::lock_guard<std::mutex> g( shard.mtx );
+      auto aitr = shard.accounts.find( entry.account );
+      if( aitr != shard.accounts.end() ) {
          aitr->second.pending_cpu_us -= entry.subjective_cpu_bill;
-         aitr->second.expired_accumulator.add(entry.subjective_cpu_bill, time_ordinal, expired_accumulator_average_window);
+         add_expired( aitr->second, entry.account, entry.subjective_cpu_bill, time_ordinal );
+      }
+   }
+
+   /// erase the accounts whose expired accumulator has decayed away, _trx_cache_mtx has to be locked
+   void remove_decayed( uint32_t time_ordinal ) {
+      while( !_decay_queue.empty() && _decay_queue.front().first <= time_ordinal ) {
+         const auto& account = _decay_queue.front().second;
+         auto& shard = shard_for( account );
+         {
+            std::lock_guard<std::mutex> g( shard.mtx );
+            auto aitr = shard.accounts.find( account );
+            if( aitr != shard.accounts.end() && aitr->second.empty(time_ordinal) ) shard.accounts.erase( aitr );
+         }
+         _decay_queue.pop_front();
       }
    }
 
    void remove_subjective_billing( const block_state_ptr& bsp, uint32_t time_ordinal ) {
+      std::lock_guard<std::mutex> g( _trx_cache_mtx );
       if( !_trx_cache_index.empty() ) {
          for( const auto& receipt : bsp->block->transactions ) {
             if( receipt.trx.contains<packed_transaction>() ) {
                const auto& pt = receipt.trx.get<packed_transaction>();
-               remove_subjective_billing( pt.id(), time_ordinal );
+               remove_subjective_billing_locked( pt.id(), time_ordinal );
             }
          }
       }
    }
 
-public: // public for tests
-   static constexpr uint32_t subjective_time_interval_ms = 5'000;
-   static constexpr uint32_t expired_accumulator_average_window = config::account_cpu_usage_average_window_ms / subjective_time_interval_ms;
-
-   void remove_subjective_billing( const transaction_id_type& trx_id, uint32_t time_ordinal ) {
+   void remove_subjective_billing_locked( const transaction_id_type& trx_id, uint32_t time_ordinal ) {
       auto& idx = _trx_cache_index.get<by_id>();
       auto itr = idx.find( trx_id );
       if( itr != idx.end() ) {
@@ -110,6 +164,25 @@ public: // public for tests
       }
    }
 
+public: // public for tests
+   static constexpr uint32_t subjective_time_interval_ms = 5'000;
+   static constexpr uint32_t expired_accumulator_average_window = config::account_cpu_usage_average_window_ms / subjective_time_interval_ms;
+
+   void remove_subjective_billing( const transaction_id_type& trx_id, uint32_t time_ordinal ) {
+      std::lock_guard<std::mutex> g( _trx_cache_mtx );
+      remove_subjective_billing_locked( trx_id, time_ordinal );
+   }
+
+   /// number of accounts with a subjective bill
+   size_t num_accounts() const {
+      size_t n = 0;
+      for( const auto& shard : _account_shards ) {
+         std::lock_guard<std::mutex> g( shard.mtx );
+         n += shard.accounts.size();
+      }
+      return n;
+   }
+
 public:
    void disable() { _disabled = true; }
 
@@ -119,15 +192,20 @@ public:
    {
       if( !_disabled ) {
          uint32_t bill = std::max<int64_t>( 0, elapsed.count() );
+         std::lock_guard<std::mutex> g( _trx_cache_mtx );
          auto p = _trx_cache_index.emplace(
                trx_cache_entry{id,
                                first_auth,
                                bill,
                                expire} );
          if( p.second ) {
-            _account_subjective_bill_cache[first_auth].pending_cpu_us += bill;
+            auto& shard = shard_for( first_auth );
+            std::lock_guard<std::mutex> sg( shard.mtx );
+            auto& info = shard.accounts[first_auth];
+            info.pending_cpu_us += bill;
             if( in_pending_block ) {
-               _block_subjective_bill_cache[first_auth] += bill;
+               if( info.in_block_cpu_us == 0 ) _in_block_accounts.push_back( first_auth );
+               info.in_block_cpu_us += bill;
             }
          }
       }
@@ -138,35 +216,37 @@ public:
       if( !_disabled ) {
          uint32_t bill = std::max<int64_t>( 0, elapsed.count() );
          const auto time_ordinal = time_ordinal_for(now);
-         _account_subjective_bill_cache[first_auth].expired_accumulator.add(bill, time_ordinal, expired_accumulator_average_window);
+         std::lock_guard<std::mutex> g( _trx_cache_mtx ); // guards _decay_queue
+         auto& shard = shard_for( first_auth );
+         std::lock_guard<std::mutex> sg( shard.mtx );
+         add_expired( shard.accounts[first_auth], first_auth, bill, time_ordinal );
       }
    }
 
+   /// may be called from any thread
    uint32_t get_subjective_bill( const account_name& first_auth, const fc::time_point& now ) const {
       if( _disabled ) return 0;
       const auto time_ordinal = time_ordinal_for(now);
-      const subjective_billing_info* sub_bill_info = nullptr;
-      auto aitr = _account_subjective_bill_cache.find( first_auth );
-      if( aitr != _account_subjective_bill_cache.end() ) {
-         sub_bill_info = &aitr->second;
-      }
-      uint64_t in_block_pending_cpu_us = 0;
-      auto bitr = _block_subjective_bill_cache.find( first_auth );
-      if( bitr != _block_subjective_bill_cache.end() ) {
-         in_block_pending_cpu_us = bitr->second;
-      }
+      const auto& shard = shard_for( first_auth );
+      std::lock_guard<std::mutex> g( shard.mtx );
+      auto aitr = shard.accounts.find( first_auth );
+      if( aitr == shard.accounts.end() ) return 0;
 
-      if (sub_bill_info) {
-         EOS_ASSERT(sub_bill_info->pending_cpu_us >= in_block_pending_cpu_us, chain::tx_resource_exhaustion, "Logic error subjective billing ${a}", ("a", first_auth) );
-         uint32_t sub_bill = sub_bill_info->pending_cpu_us - in_block_pending_cpu_us + sub_bill_info->expired_accumulator.value_at(time_ordinal, expired_accumulator_average_window );
-         return sub_bill;
-      } else {
-         return 0;
-      }
+      const auto& sub_bill_info = aitr->second;
+      EOS_ASSERT(sub_bill_info.pending_cpu_us >= sub_bill_info.in_block_cpu_us, chain::tx_resource_exhaustion, "Logic error subjective billing ${a}", ("a", first_auth) );
+      uint32_t sub_bill = sub_bill_info.pending_cpu_us - sub_bill_info.in_block_cpu_us + sub_bill_info.expired_accumulator.value_at(time_ordinal, expired_accumulator_average_window );
+      return sub_bill;
    }
 
    void abort_block() {
-      _block_subjective_bill_cache.clear();
+      std::lock_guard<std::mutex> g( _trx_cache_mtx );
+      for( const auto& a : _in_block_accounts ) {
+         auto& shard = shard_for( a );
+         std::lock_guard<std::mutex> sg( shard.mtx );
+         auto aitr = shard.accounts.find( a );
+         if( aitr != shard.accounts.end() ) aitr->second.in_block_cpu_us = 0;
+      }
+      _in_block_accounts.clear();
    }
 
    void on_block( const block_state_ptr& bsp, const fc::time_point& now ) {
@@ -177,9 +257,11 @@ public:
 
    bool remove_expired( fc::logger& log, const fc::time_point& pending_block_time, const fc::time_point& now, const fc::time_point& deadline ) {
       bool exhausted = false;
+      const auto time_ordinal = time_ordinal_for(now);
+      std::lock_guard<std::mutex> g( _trx_cache_mtx );
+      remove_decayed( time_ordinal );
       auto& idx = _trx_cache_index.get<by_expiry>();
       if( !idx.empty() ) {
-         const auto time_ordinal = time_ordinal_for(now);
          const auto orig_count = _trx_cache_index.size();
          uint32_t num_expired = 0;
 
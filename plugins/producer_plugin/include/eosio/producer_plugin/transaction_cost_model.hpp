@@ -0,0 +1,66 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/transaction.hpp>
+
+#include <map>
+
+namespace eosio {
+
+/**
+ * Estimates the CPU a transaction takes to execute from the transactions with the same actions executed before.
+ * Keeps an exponentially weighted moving average of the CPU of each (contract, action), a transaction's CPU being
+ * shared equally between its actions. Not thread safe.
+ */
+class transaction_cost_model {
+public:
+   /// executions of an action needed before it is estimated
+   static constexpr uint32_t min_samples = 3;
+   /// actions tracked, executions of other actions are ignored once reached
+   static constexpr size_t max_actions = 100000;
+
+   /// record the CPU of a successful execution of trx
+   void add( const chain::transaction& trx, const fc::microseconds& elapsed ) {
+      if( trx.actions.empty() || elapsed.count() < 0 ) return;
+      const int64_t share_us = elapsed.count() / trx.actions.size();
+      for( const auto& a : trx.actions ) {
+         auto itr = _costs.find( {a.account, a.name} );
+         if( itr == _costs.end() ) {
+            if( _costs.size() >= max_actions ) continue;
+            _costs.emplace( action_key{a.account, a.name}, cost{share_us, 1} );
+         } else {
+            auto& c = itr->second;
+            c.cpu_us = (c.cpu_us * (weight - 1) + share_us) / weight;
+            if( c.samples < min_samples ) ++c.samples;
+         }
+      }
+   }
+
+   /// @return estimated CPU of trx, empty if one of its actions has not been executed min_samples times
+   fc::optional<fc::microseconds> estimate( const chain::transaction& trx ) const {
+      if( trx.actions.empty() ) return {};
+      int64_t cpu_us = 0;
+      for( const auto& a : trx.actions ) {
+         auto itr = _costs.find( {a.account, a.name} );
+         if( itr == _costs.end() || itr->second.samples < min_samples ) return {};
+         cpu_us += itr->second.cpu_us;
+      }
+      return fc::microseconds( cpu_us );
+   }
+
+   size_t size() const { return _costs.size(); }
+
+private:
+   static constexpr int64_t weight = 8; ///< a new execution counts for 1/weight of the average
+
+   using action_key = std::pair<chain::account_name, chain::action_name>;
+
+   struct cost {
+      int64_t   cpu_us = 0;
+      uint32_t  samples = 0; ///< up to min_samples
+   };
+
+   std::map<action_key, cost> _costs;
+};
+
+} //eosio
@@ -1,9 +1,16 @@
 #include <eosio/producer_plugin/producer_plugin.hpp>
+#include <eosio/producer_plugin/background_file_buf.hpp>
+#include <eosio/producer_plugin/block_timeline_log.hpp>
 #include <eosio/producer_plugin/subjective_billing.hpp>
+#include <eosio/producer_plugin/transaction_cost_model.hpp>
 #include <eosio/chain/plugin_interface.hpp>
+#include <eosio/chain/async_log.hpp>
 #include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/metrics.hpp>
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/snapshot_delta.hpp>
+#include <eosio/chain/span_trace.hpp>
 #include <eosio/chain/transaction_object.hpp>
 #include <eosio/chain/thread_utils.hpp>
 #include <eosio/chain/unapplied_transaction_queue.hpp>
@@ -17,6 +24,7 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <iostream>
+#include <mutex>
 #include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <boost/range/adaptor/map.hpp>
@@ -25,6 +33,7 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
 #include <boost/signals2/connection.hpp>
 
 namespace bmi = boost::multi_index;
@@ -81,6 +90,10 @@ static appbase::abstract_plugin& _producer_plugin = app().register_plugin<produc
 using namespace eosio::chain;
 using namespace eosio::chain::plugin_interface;
 
+static metric_counter blocks_produced_metric( "nodeos_producer_blocks_produced_total", "Blocks produced and signed" );
+static metric_gauge unapplied_transactions_metric( "nodeos_producer_unapplied_transactions",
+                                                   "Transactions queued to be applied, as of the last block started" );
+
 namespace {
    bool exception_is_exhausted(const fc::exception& e, bool deadline_is_subjective) {
       auto code = e.code();
@@ -112,19 +125,21 @@ class pending_snapshot {
 public:
    using next_t = producer_plugin::next_function<producer_plugin::snapshot_information>;
 
-   pending_snapshot(const block_id_type& block_id, next_t& next, std::string pending_path, std::string final_path)
+   pending_snapshot(const block_id_type& block_id, next_t& next, std::string pending_path, std::string final_path,
+                    std::shared_ptr<background_file_buf> writer)
    : block_id(block_id)
    , next(next)
    , pending_path(pending_path)
    , final_path(final_path)
+   , writer(std::move(writer))
    {}
 
    uint32_t get_height() const {
       return block_header::num_from_id(block_id);
    }
 
-   static bfs::path get_final_path(const block_id_type& block_id, const bfs::path& snapshots_dir) {
-      return snapshots_dir / fc::format_string("snapshot-${id}.bin", fc::mutable_variant_object()("id", block_id));
+   static bfs::path get_final_path(const block_id_type& block_id, const bfs::path& snapshots_dir, bool delta = false) {
+      return snapshots_dir / fc::format_string(delta ? "snapshot-delta-${id}.bin" : "snapshot-${id}.bin", fc::mutable_variant_object()("id", block_id));
    }
 
    static bfs::path get_pending_path(const block_id_type& block_id, const bfs::path& snapshots_dir) {
@@ -160,6 +175,8 @@ public:
    next_t            next;
    std::string       pending_path;
    std::string       final_path;
+   /// writing the snapshot to its temp path in the background, reset once it is at pending_path
+   std::shared_ptr<background_file_buf> writer;
 };
 
 using pending_snapshot_index = multi_index_container<
@@ -202,6 +219,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
       using signature_provider_type = std::function<chain::signature_type(chain::digest_type)>;
       std::map<chain::public_key_type, signature_provider_type> _signature_providers;
+      std::set<chain::public_key_type>                          _local_signature_providers; ///< sign in process, can be called from any thread
       std::set<chain::account_name>                             _producers;
       boost::asio::deadline_timer                               _timer;
       using producer_watermark = std::pair<uint32_t, block_timestamp_type>;
@@ -212,12 +230,16 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
       std::atomic<int32_t>                                      _max_transaction_time_ms; // modified by app thread, read by net_plugin thread pool
       fc::microseconds                                          _max_irreversible_block_age_us;
+      fc::microseconds                                          _max_reapply_head_block_age_us;
       int32_t                                                   _produce_time_offset_us = 0;
       int32_t                                                   _last_block_time_offset_us = 0;
       uint32_t                                                  _max_block_cpu_usage_threshold_us = 0;
       uint32_t                                                  _max_block_net_usage_threshold_bytes = 0;
       int32_t                                                   _max_scheduled_transaction_time_per_block_ms = 0;
+      int32_t                                                   _max_scheduled_transaction_scan_per_block = -1;
       bool                                                      _disable_persist_until_expired = false;
+      bool                                                      _pre_execute_next_block = false;
+      bool                                                      _pre_executing = false; // pending block started ahead of its production window
       fc::time_point                                            _irreversible_block_time;
       fc::microseconds                                          _keosd_provider_timeout_us;
 
@@ -233,10 +255,41 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
       incoming::methods::block_sync::method_type::handle        _incoming_block_sync_provider;
       incoming::methods::transaction_async::method_type::handle _incoming_transaction_async_provider;
+      incoming::methods::transaction_batch_async::method_type::handle _incoming_transaction_batch_async_provider;
+      incoming::methods::transaction_dry_run_async::method_type::handle _incoming_transaction_dry_run_async_provider;
 
       transaction_id_with_expiry_index                         _blacklisted_transactions;
       pending_snapshot_index                                   _pending_snapshot_index;
       subjective_billing                                       _subjective_billing;
+      transaction_cost_model                                   _cost_model;
+      block_timeline_log                                       _block_timelines;
+
+      /// adds the time spent and the transactions added to the block being produced to a phase of its timeline
+      class timeline_phase {
+      public:
+         timeline_phase( producer_plugin_impl& impl, block_timeline_log::phase p )
+         : _impl( impl.building_timeline() ? &impl : nullptr ), _phase( p ) {
+            if( _impl ) {
+               _start = fc::time_point::now();
+               _receipts = _impl->chain_plug->chain().get_pending_trx_receipts().size();
+            }
+         }
+         ~timeline_phase() {
+            if( !_impl ) return;
+            const auto& chain = _impl->chain_plug->chain();
+            const size_t receipts = chain.is_building_block() ? chain.get_pending_trx_receipts().size() : _receipts;
+            _impl->_block_timelines.add( _phase, fc::time_point::now() - _start, receipts > _receipts ? receipts - _receipts : 0 );
+         }
+      private:
+         producer_plugin_impl*      _impl;
+         block_timeline_log::phase  _phase;
+         fc::time_point             _start;
+         size_t                     _receipts = 0;
+      };
+
+      bool building_timeline() const {
+         return _block_timelines.building() && chain_plug->chain().is_building_block();
+      }
 
       fc::optional<scoped_connection>                          _accepted_block_connection;
       fc::optional<scoped_connection>                          _accepted_block_header_connection;
@@ -257,9 +310,63 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       // keep a expected ratio between defer txn and incoming txn
       double _incoming_defer_ratio = 1.0; // 1:1
 
+      /// where to start the next scan of scheduled transactions, the ones before it in by_delay order are blacklisted
+      struct scheduled_scan_start {
+         block_id_type             head_id;     ///< head the scan was made on
+         fc::time_point            delay_until; ///< of the last blacklisted transaction
+         generated_transaction_object::id_type id;
+      };
+      fc::optional<scheduled_scan_start> _scheduled_scan_start;
+
+      enum class incoming_priority {
+         fifo,           ///< in arrival order
+         subjective_cpu, ///< least subjectively billed first authorizer first
+         cpu_allowance   ///< first authorizer with the most CPU available, less its subjective bill, first
+      };
+      incoming_priority _incoming_priority = incoming_priority::fifo;
+
       // path to write the snapshots to
       bfs::path _snapshots_dir;
 
+      // path to write the trace spans to, with the signal that writes them
+      bfs::path _trace_spans_dir;
+      uint32_t _trace_spans_per_thread = 0;
+      optional<boost::asio::signal_set> _trace_spans_signal;
+
+      void handle_trace_spans_signal() {
+         _trace_spans_signal->async_wait( [this]( const boost::system::error_code& ec, int ) {
+            if( ec ) return;
+            try {
+               ilog( "Wrote trace spans to ${f}", ("f", write_trace_spans()) );
+            } FC_LOG_AND_DROP()
+            handle_trace_spans_signal();
+         });
+      }
+
+      std::string write_trace_spans() const {
+         EOS_ASSERT( _trace_spans_per_thread > 0, plugin_config_exception, "trace-spans-per-thread is 0, no spans are recorded" );
+         if( !fc::exists( _trace_spans_dir ) ) {
+            fc::create_directories( _trace_spans_dir );
+         }
+         const auto path = _trace_spans_dir / ("trace-spans-" + std::to_string( fc::time_point::now().time_since_epoch().count() ) + ".json");
+         std::ofstream out( path.generic_string() );
+         EOS_ASSERT( out, plugin_exception, "could not open ${f}", ("f", path.generic_string()) );
+         chain::span_trace::write_chrome_trace( out );
+         out.close();
+         EOS_ASSERT( out, plugin_exception, "could not write ${f}", ("f", path.generic_string()) );
+         return path.generic_string();
+      }
+
+      // write snapshots with compressed_ostream_snapshot_writer
+      bool _compress_snapshots = false;
+
+      // write snapshots as deltas against the previous snapshot taken by this node
+      bool _snapshot_deltas = false;
+      fc::optional<snapshot_manifest> _last_snapshot_manifest;
+
+      // create a snapshot after each block of a number multiple of it, 0 for none
+      uint32_t _snapshot_block_interval = 0;
+
       void consider_new_watermark( account_name producer, uint32_t block_num, block_timestamp_type timestamp) {
          auto itr = _producer_watermarks.find( producer );
          if( itr != _producer_watermarks.end() ) {
@@ -281,6 +388,19 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       void on_block( const block_state_ptr& bsp ) {
          _unapplied_transactions.clear_applied( bsp );
          _subjective_billing.on_block( bsp, fc::time_point::now() );
+
+         if( _snapshot_block_interval && bsp->block_num % _snapshot_block_interval == 0 ) {
+            // not while the controller is still committing the block
+            app().post( priority::medium, []() {
+               app().get_plugin<producer_plugin>().create_snapshot( []( const fc::static_variant<fc::exception_ptr, producer_plugin::snapshot_information>& result ) {
+                  if( result.contains<fc::exception_ptr>() ) {
+                     elog( "Unable to create scheduled snapshot: ${e}", ("e", result.get<fc::exception_ptr>()->to_detail_string()) );
+                  } else {
+                     ilog( "Created scheduled snapshot ${n}", ("n", result.get<producer_plugin::snapshot_information>().snapshot_name) );
+                  }
+               } );
+            } );
+         }
       }
 
       void on_block_header( const block_state_ptr& bsp ) {
@@ -289,22 +409,59 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
       void on_irreversible_block( const signed_block_ptr& lib ) {
          _irreversible_block_time = lib->timestamp.to_time_point();
-         const chain::controller& chain = chain_plug->chain();
+         promote_snapshots( lib->block_num() );
+      }
 
-         // promote any pending snapshots
+      /// finalize the pending snapshots written of blocks up to lib_height
+      void promote_snapshots( uint32_t lib_height ) {
+         const chain::controller& chain = chain_plug->chain();
          auto& snapshots_by_height = _pending_snapshot_index.get<by_height>();
-         uint32_t lib_height = lib->block_num();
 
-         while (!snapshots_by_height.empty() && snapshots_by_height.begin()->get_height() <= lib_height) {
-            const auto& pending = snapshots_by_height.begin();
+         for( auto pending = snapshots_by_height.begin(); pending != snapshots_by_height.end() && pending->get_height() <= lib_height; ) {
+            if( pending->writer ) {
+               // promoted once written
+               ++pending;
+               continue;
+            }
             auto next = pending->next;
 
+            if( _snapshot_deltas && !chain.fetch_block_by_id( pending->block_id ) ) {
+               // later deltas cannot be applied without this snapshot, start over with a full one
+               _last_snapshot_manifest.reset();
+            }
+
             try {
                next(pending->finalize(chain));
             } CATCH_AND_CALL(next);
 
-            snapshots_by_height.erase(snapshots_by_height.begin());
+            pending = snapshots_by_height.erase(pending);
+         }
+      }
+
+      /// on the main thread once the writer of the pending snapshot of block_id is done, error being empty on success
+      void on_snapshot_written( const block_id_type& block_id, const std::string& error ) {
+         auto& pending_by_id = _pending_snapshot_index.get<by_id>();
+         auto pending = pending_by_id.find( block_id );
+         if( pending == pending_by_id.end() ) return;
+
+         const auto temp_path = pending_snapshot::get_temp_path( block_id, _snapshots_dir );
+         boost::system::error_code ec;
+         if( error.empty() ) bfs::rename( temp_path, pending->pending_path, ec );
+         if( !error.empty() || ec ) {
+            auto next = pending->next;
+            bfs::remove( temp_path, ec );
+            if( _snapshot_deltas ) _last_snapshot_manifest.reset();
+            try {
+               EOS_THROW( snapshot_finalization_exception,
+                          "Unable to write snapshot of block number ${bn}: ${message}",
+                          ("bn", pending->get_height())("message", error.empty() ? ec.message() : error) );
+            } CATCH_AND_CALL(next);
+            pending_by_id.erase( pending );
+            return;
          }
+
+         pending_by_id.modify( pending, []( auto& entry ) { entry.writer.reset(); } );
+         promote_snapshots( chain_plug->chain().last_irreversible_block_num() );
       }
 
       void abort_block() {
@@ -312,6 +469,8 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
          _unapplied_transactions.add_aborted( chain.abort_block() );
          _subjective_billing.abort_block();
+         _block_timelines.abort();
+         _pre_executing = false;
       }
 
       bool on_incoming_block(const signed_block_ptr& block, const std::optional<block_id_type>& block_id) {
@@ -325,7 +484,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          const auto& id = block_id ? *block_id : block->id();
          auto blk_num = block->block_num();
 
-         fc_dlog(_log, "received incoming block ${n} ${id}", ("n", blk_num)("id", id));
+         async_dlog(_log, "received incoming block ${n} ${id}", "n", blk_num, "id", id);
 
          EOS_ASSERT( block->timestamp < (fc::time_point::now() + fc::seconds( 7 )), block_from_the_future,
                      "received a block from the future, ignoring it: ${id}", ("id", id) );
@@ -386,90 +545,299 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          return true;
       }
 
+      /**
+       * Transactions waiting for a block to be applied in, highest score first and in arrival order among equal scores.
+       * Once the queue is full a transaction is only added if it scores higher than the lowest scoring ones, which are
+       * then dropped with resource exhaustion.
+       */
       class incoming_transaction_queue {
+      public:
+         using scorer_type = std::function<double( const transaction_metadata_ptr& )>;
+
+      private:
+         struct entry {
+            transaction_metadata_ptr             trx;
+            bool                                 persist_until_expired = false;
+            next_function<transaction_trace_ptr> next;
+            double                               score = 0;
+            int64_t                              seq = 0;
+         };
+
+         struct by_priority;
+
+         typedef multi_index_container<
+            entry,
+            indexed_by<
+               bmi::ordered_unique< tag<by_priority>,
+                  bmi::composite_key< entry,
+                     member<entry, double, &entry::score>,
+                     member<entry, int64_t, &entry::seq>
+                  >,
+                  bmi::composite_key_compare< std::greater<double>, std::less<int64_t> >
+               >
+            >
+         > entry_index;
+
          uint64_t max_incoming_transaction_queue_size = 0;
          uint64_t size_in_bytes = 0;
-         std::deque<std::tuple<transaction_metadata_ptr, bool, next_function<transaction_trace_ptr>>> _incoming_transactions;
+         int64_t  front_seq = 0;
+         int64_t  back_seq = 0;
+         scorer_type scorer;
+         entry_index _incoming_transactions;
 
       private:
          static uint64_t calc_size( const transaction_metadata_ptr& trx ) {
             return trx->packed_trx()->get_unprunable_size() + trx->packed_trx()->get_prunable_size() + sizeof( *trx );
          }
 
-         void add_size( const transaction_metadata_ptr& trx ) {
-            auto size = calc_size( trx );
+         void add( const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next, int64_t seq ) {
+            const auto size = calc_size( trx );
+            const double score = scorer ? scorer( trx ) : 0;
+            auto& idx = _incoming_transactions.get<by_priority>();
+            while( size_in_bytes + size >= max_incoming_transaction_queue_size && !idx.empty() && std::prev( idx.end() )->score < score ) {
+               auto lowest = std::prev( idx.end() );
+               auto ex = std::static_pointer_cast<fc::exception>( std::make_shared<tx_resource_exhaustion>(
+                     FC_LOG_MESSAGE( error, "Transaction dropped from the incoming queue for higher scoring transactions" ) ) );
+               log_rejected_transaction( lowest->trx->id(), ex );
+               auto evicted_next = lowest->next;
+               size_in_bytes -= calc_size( lowest->trx );
+               idx.erase( lowest );
+               evicted_next( ex );
+            }
             EOS_ASSERT( size_in_bytes + size < max_incoming_transaction_queue_size, tx_resource_exhaustion, "Transaction exceeded producer resource limit" );
             size_in_bytes += size;
+            idx.insert( entry{ trx, persist_until_expired, std::move( next ), score, seq } );
          }
 
       public:
          void set_max_incoming_transaction_queue_size( uint64_t v ) { max_incoming_transaction_queue_size = v; }
+         /// score of a transaction when it is added, none queues transactions in arrival order
+         void set_scorer( scorer_type s ) { scorer = std::move( s ); }
 
          void add( const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next ) {
-            add_size( trx );
-            _incoming_transactions.emplace_back( trx, persist_until_expired, std::move( next ) );
+            add( trx, persist_until_expired, std::move( next ), ++back_seq );
          }
 
+         /// ahead of the transactions with the same score
          void add_front( const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next ) {
-            add_size( trx );
-            _incoming_transactions.emplace_front( trx, persist_until_expired, std::move( next ) );
+            add( trx, persist_until_expired, std::move( next ), --front_seq );
          }
 
+         /// @return the highest scoring transaction
          auto pop_front() {
             EOS_ASSERT( !_incoming_transactions.empty(), producer_exception, "logic error, front() called on empty incoming_transactions" );
-            auto intrx = _incoming_transactions.front();
-            _incoming_transactions.pop_front();
-            const transaction_metadata_ptr& trx = std::get<0>( intrx );
-            size_in_bytes -= calc_size( trx );
+            auto& idx = _incoming_transactions.get<by_priority>();
+            const auto& front = *idx.begin();
+            auto intrx = std::make_tuple( front.trx, front.persist_until_expired, front.next );
+            size_in_bytes -= calc_size( front.trx );
+            idx.erase( idx.begin() );
             return intrx;
          }
 
+         /// calls f( trx, score ) on at most limit transactions in the order they are popped
+         template<typename Function>
+         void for_each( size_t limit, Function&& f ) const {
+            for( const auto& e : _incoming_transactions.get<by_priority>() ) {
+               if( limit-- == 0 ) break;
+               f( e.trx, e.score );
+            }
+         }
+
          bool empty()const { return _incoming_transactions.empty(); }
          size_t size()const { return _incoming_transactions.size(); }
+         uint64_t size_bytes()const { return size_in_bytes; }
       };
 
       incoming_transaction_queue _pending_incoming_transactions;
 
-      void on_incoming_transaction_async(const packed_transaction_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
+      /**
+       * Hand-off of recovered transactions from the producer thread pool to the main thread.
+       * Producers only post a drain to the main thread when the queue goes from empty to non-empty, so a burst of
+       * transactions costs one app().post per drain instead of one per transaction. The lock is only held to
+       * append or to swap out the whole queue.
+       */
+      class recovered_transaction_queue {
+      public:
+         struct entry {
+            recover_keys_future                  trx;
+            bool                                 persist_until_expired = false;
+            next_function<transaction_trace_ptr> next;
+            transaction_id_type                  id;
+            uint64_t                             size = 0;
+         };
+
+         void set_max_size( uint64_t v ) { max_size = v; }
+
+         /// thread safe
+         /// @param schedule_drain set to true if caller is responsible for scheduling pop_all() on the main thread
+         /// @return false, without moving from e, if e does not fit in the queue
+         bool push( entry& e, bool& schedule_drain ) {
+            std::lock_guard<std::mutex> g( mtx );
+            if( size_in_bytes + e.size >= max_size ) return false;
+            schedule_drain = !drain_scheduled;
+            drain_scheduled = true;
+            size_in_bytes += e.size;
+            queue.emplace_back( std::move( e ) );
+            return true;
+         }
+
+         /// thread safe
+         std::deque<entry> pop_all() {
+            std::deque<entry> result;
+            std::lock_guard<std::mutex> g( mtx );
+            std::swap( result, queue );
+            size_in_bytes = 0;
+            drain_scheduled = false;
+            return result;
+         }
+
+      private:
+         std::mutex          mtx;
+         std::deque<entry>   queue;
+         uint64_t            size_in_bytes = 0;
+         uint64_t            max_size = 0;
+         bool                drain_scheduled = false;
+      };
+
+      recovered_transaction_queue _recovered_transactions;
+
+      // called from application thread
+      double incoming_priority_score( const transaction_metadata_ptr& trx ) const {
+         const auto first_auth = trx->packed_trx()->get_transaction().first_authorizer();
+         const double bill = _subjective_billing.get_subjective_bill( first_auth, fc::time_point::now() );
+         if( _incoming_priority == incoming_priority::subjective_cpu ) {
+            return -bill;
+         }
+         try {
+            const auto& rl = chain_plug->chain().get_resource_limits_manager();
+            return double( rl.get_account_cpu_limit( first_auth ).first ) - bill;
+         } catch( const fc::exception& ) {
+            // unknown first authorizer, the transaction fails anyway
+            return std::numeric_limits<double>::lowest();
+         }
+      }
+
+      static void log_rejected_transaction( const transaction_id_type& trx_id, const fc::exception_ptr& ex ) {
+         fc_dlog(_trx_successful_trace_log, "[TRX_TRACE] Speculative execution is REJECTING tx: ${txid} : ${why} ",
+                ("txid", trx_id)("why",ex->what()));
+         fc_dlog(_trx_failed_trace_log, "[TRX_TRACE] Speculative execution is REJECTING tx: ${txid} : ${why} ",
+                ("txid", trx_id)("why",ex->what()));
+      }
+
+      void on_incoming_transaction_async(const packed_transaction_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next,
+                                         transaction_metadata::trx_type trx_type = transaction_metadata::trx_type::input) {
          chain::controller& chain = chain_plug->chain();
          const auto max_trx_time_ms = _max_transaction_time_ms.load();
          fc::microseconds max_trx_cpu_usage = max_trx_time_ms < 0 ? fc::microseconds::maximum() : fc::milliseconds( max_trx_time_ms );
 
          auto future = transaction_metadata::start_recover_keys( trx, _thread_pool->get_executor(),
-                chain.get_chain_id(), fc::microseconds( max_trx_cpu_usage ), chain.configured_subjective_signature_length_limit() );
-
-         auto trx_id = trx->id();
-         boost::asio::post(_thread_pool->get_executor(), [self = this, future{std::move(future)}, persist_until_expired,
-                                                          next{std::move(next)}, trx_id]() mutable {
-            if( future.valid() ) {
-               future.wait();
-               app().post( priority::low, [self, future{std::move(future)}, persist_until_expired, next{std::move( next )}, trx_id]() mutable {
-                  auto exception_handler = [&next, trx_id](fc::exception_ptr ex) {
-                     fc_dlog(_trx_successful_trace_log, "[TRX_TRACE] Speculative execution is REJECTING tx: ${txid} : ${why} ",
-                            ("txid", trx_id)("why",ex->what()));
-                     fc_dlog(_trx_failed_trace_log, "[TRX_TRACE] Speculative execution is REJECTING tx: ${txid} : ${why} ",
-                            ("txid", trx_id)("why",ex->what()));
-                     next(ex);
-                  };
-                  try {
-                     auto result = future.get();
-                     if( !self->process_incoming_transaction_async( result, persist_until_expired, next ) ) {
-                        if( self->_pending_block_mode == pending_block_mode::producing ) {
-                           self->schedule_maybe_produce_block( true );
-                        }
-                     }
-                  } CATCH_AND_CALL(exception_handler);
+                chain.get_chain_id(), fc::microseconds( max_trx_cpu_usage ), chain.configured_subjective_signature_length_limit(), trx_type );
+
+         recovered_transaction_queue::entry e{ std::move( future ), persist_until_expired, std::move( next ), trx->id(),
+                                               trx->get_unprunable_size() + trx->get_prunable_size() + sizeof( transaction_metadata ) };
+         boost::asio::post(_thread_pool->get_executor(), [self = this, e{std::move(e)}]() mutable {
+            if( e.trx.valid() ) {
+               e.trx.wait();
+               bool schedule_drain = false;
+               if( self->_recovered_transactions.push( e, schedule_drain ) ) {
+                  if( schedule_drain ) {
+                     app().post( priority::low, [self]() {
+                        self->process_recovered_transactions();
+                     } );
+                  }
+               } else {
+                  post_resource_exhaustion( std::move( e ) );
+               }
+            }
+         });
+      }
+
+      /// recover the keys of all of trxs in parallel, then queue them together and in order for the main thread
+      void on_incoming_transaction_batch_async(const std::vector<packed_transaction_ptr>& trxs, bool persist_until_expired,
+                                               const batch_next_function& next) {
+         chain::controller& chain = chain_plug->chain();
+         const auto max_trx_time_ms = _max_transaction_time_ms.load();
+         fc::microseconds max_trx_cpu_usage = max_trx_time_ms < 0 ? fc::microseconds::maximum() : fc::milliseconds( max_trx_time_ms );
+
+         // one recovery task per transaction, so a bad signature only fails its own transaction
+         auto entries = std::make_shared<std::vector<recovered_transaction_queue::entry>>();
+         entries->reserve( trxs.size() );
+         for( size_t i = 0; i < trxs.size(); ++i ) {
+            const auto& trx = trxs[i];
+            auto future = transaction_metadata::start_recover_keys( trx, _thread_pool->get_executor(),
+                   chain.get_chain_id(), fc::microseconds( max_trx_cpu_usage ), chain.configured_subjective_signature_length_limit() );
+            entries->emplace_back( recovered_transaction_queue::entry{ std::move( future ), persist_until_expired,
+                  [next, i]( const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result ) { next( i, result ); },
+                  trx->id(), trx->get_unprunable_size() + trx->get_prunable_size() + sizeof( transaction_metadata ) } );
+         }
+
+         // queued after the recovery tasks, so it never waits on a recovery that no thread has started
+         boost::asio::post(_thread_pool->get_executor(), [self = this, entries]() {
+            for( auto& e : *entries ) {
+               e.trx.wait();
+            }
+            bool schedule_drain = false;
+            for( auto& e : *entries ) {
+               bool drain = false;
+               if( self->_recovered_transactions.push( e, drain ) ) {
+                  schedule_drain = schedule_drain || drain;
+               } else {
+                  post_resource_exhaustion( std::move( e ) );
+               }
+            }
+            if( schedule_drain ) {
+               app().post( priority::low, [self]() {
+                  self->process_recovered_transactions();
                } );
             }
          });
       }
 
+      /// reject e, which did not fit in the recovered transaction queue, on the main thread
+      static void post_resource_exhaustion( recovered_transaction_queue::entry&& e ) {
+         app().post( priority::low, [e{std::move(e)}]() mutable {
+            auto ex = std::static_pointer_cast<fc::exception>( std::make_shared<tx_resource_exhaustion>(
+                  FC_LOG_MESSAGE( error, "Transaction exceeded producer resource limit" ) ) );
+            log_rejected_transaction( e.id, ex );
+            e.next( ex );
+         } );
+      }
+
+      // called from application thread
+      // @param execute if false only queue to _pending_incoming_transactions, to be processed in order by start_block
+      void process_recovered_transactions( bool execute = true ) {
+         auto recovered = _recovered_transactions.pop_all();
+         if( recovered.empty() ) return;
+         std::optional<timeline_phase> phase;
+         if( execute ) phase.emplace( *this, block_timeline_log::phase::incoming );
+         bool exhausted = !execute;
+         for( auto& e : recovered ) {
+            auto exception_handler = [&e](fc::exception_ptr ex) {
+               log_rejected_transaction( e.id, ex );
+               e.next(ex);
+            };
+            try {
+               auto result = e.trx.get();
+               if( exhausted ) {
+                  // no need to attempt the rest in this block, they will be processed in the next start_block
+                  _pending_incoming_transactions.add( result, e.persist_until_expired, e.next );
+               } else if( !process_incoming_transaction_async( result, e.persist_until_expired, e.next ) ) {
+                  exhausted = true;
+               }
+            } CATCH_AND_CALL(exception_handler);
+         }
+         if( execute && exhausted && _pending_block_mode == pending_block_mode::producing ) {
+            schedule_maybe_produce_block( true );
+         }
+      }
+
       bool process_incoming_transaction_async(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
          bool exhausted = false;
          chain::controller& chain = chain_plug->chain();
 
          auto send_response = [this, &trx, &chain, &next](const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& response) {
             next(response);
+            if (trx->dry_run) return; // never relayed
             if (response.contains<fc::exception_ptr>()) {
                _transaction_ack_channel.publish(priority::low, std::pair<fc::exception_ptr, transaction_metadata_ptr>(response.get<fc::exception_ptr>(), trx));
                if (_pending_block_mode == pending_block_mode::producing) {
@@ -494,13 +862,13 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
             } else {
                _transaction_ack_channel.publish(priority::low, std::pair<fc::exception_ptr, transaction_metadata_ptr>(nullptr, trx));
                if (_pending_block_mode == pending_block_mode::producing) {
-                  fc_dlog(_trx_successful_trace_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} is ACCEPTING tx: ${txid}",
-                          ("block_num", chain.head_block_num() + 1)
-                          ("prod", get_pending_block_producer())
-                          ("txid", trx->id()));
+                  async_dlog(_trx_successful_trace_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} is ACCEPTING tx: ${txid}",
+                             "block_num", chain.head_block_num() + 1,
+                             "prod", get_pending_block_producer(),
+                             "txid", trx->id());
                } else {
-                  fc_dlog(_trx_successful_trace_log, "[TRX_TRACE] Speculative execution is ACCEPTING tx: ${txid}",
-                          ("txid", trx->id()));
+                  async_dlog(_trx_successful_trace_log, "[TRX_TRACE] Speculative execution is ACCEPTING tx: ${txid}",
+                             "txid", trx->id());
                }
             }
          };
@@ -544,6 +912,9 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
                sub_bill = _subjective_billing.get_subjective_bill( first_auth, fc::time_point::now() );
 
             auto trace = chain.push_transaction( trx, deadline, trx->billed_cpu_time_us, false, sub_bill );
+            if( !trace->except ) {
+               _cost_model.add( trx->packed_trx()->get_transaction(), trace->elapsed );
+            }
             if( trace->except ) {
                if( exception_is_exhausted( *trace->except, deadline_is_subjective )) {
                   _pending_incoming_transactions.add( trx, persist_until_expired, next );
@@ -559,9 +930,15 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
                   exhausted = block_is_exhausted();
                } else {
                   _subjective_billing.subjective_bill_failure( first_auth, trace->elapsed, fc::time_point::now() );
-                  auto e_ptr = trace->except->dynamic_copy_exception();
-                  send_response( e_ptr );
+                  if( trx->dry_run ) {
+                     send_response( trace ); // failure trace is the result of a dry run
+                  } else {
+                     auto e_ptr = trace->except->dynamic_copy_exception();
+                     send_response( e_ptr );
+                  }
                }
+            } else if( trx->dry_run ) {
+               send_response( trace );
             } else {
                if( persist_until_expired && !_disable_persist_until_expired ) {
                   // if this trx didnt fail/soft-fail and the persist flag is set, store its ID so that we can
@@ -705,20 +1082,50 @@ void producer_plugin::set_program_options(
           "Threshold of NET block production to consider block full; when within threshold of max-block-net-usage block can be produced immediately")
          ("max-scheduled-transaction-time-per-block-ms", boost::program_options::value<int32_t>()->default_value(100),
           "Maximum wall-clock time, in milliseconds, spent retiring scheduled transactions in any block before returning to normal transaction processing.")
+         ("max-scheduled-transaction-scan-per-block", bpo::value<int32_t>()->default_value(-1),
+          "Maximum number of scheduled transactions looked at, executed or skipped, in any block before returning to normal transaction processing (-1 for unlimited).")
          ("subjective-cpu-leeway-us", boost::program_options::value<int32_t>()->default_value( config::default_subjective_cpu_leeway_us ),
           "Time in microseconds allowed for a transaction that starts with insufficient CPU quota to complete and cover its CPU usage.")
          ("incoming-defer-ratio", bpo::value<double>()->default_value(1.0),
           "ratio between incoming transactions and deferred transactions when both are queued for execution")
          ("incoming-transaction-queue-size-mb", bpo::value<uint16_t>()->default_value( 1024 ),
           "Maximum size (in MiB) of the incoming transaction queue. Exceeding this value will subjectively drop transaction with resource exhaustion.")
+         ("incoming-transaction-priority", bpo::value<string>()->default_value("fifo"),
+          "Order in which queued incoming transactions are applied, and dropped from the lowest once the queue is full:\n"
+          "   fifo             \tin arrival order\n"
+          "   subjective-cpu   \tleast subjectively billed first authorizer first\n"
+          "   cpu-allowance    \tfirst authorizer with the most CPU available, less its subjective bill, first\n")
+         ("block-timeline-size", bpo::value<uint32_t>()->default_value(120),
+          "Number of blocks produced for which the time spent in each phase of building them is kept for the get_block_timelines API (0 to keep none).")
          ("disable-api-persisted-trx", bpo::bool_switch()->default_value(false),
           "Disable the re-apply of API transactions.")
+         ("max-reapply-head-block-age", bpo::value<int32_t>()->default_value( 10 ),
+          "Maximum age (in seconds) of the head block for previously applied API transactions to be re-applied to a speculative block built on it. "
+          "Older head blocks are followed by more blocks waiting to be applied, each aborting the speculative block again, so the transactions are kept until the node catches up. "
+          "(-1 for always re-applying)")
+         ("pre-execute-next-block", bpo::bool_switch()->default_value(false),
+          "Start our next block as soon as the block before it is received, before its production window opens, so that it is produced with the transactions applied while waiting.")
          ("disable-subjective-billing", bpo::bool_switch()->default_value(false),
           "Disable subjective billing.")
          ("producer-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in producer thread pool")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
           "the location of the snapshots directory (absolute path or relative to application data dir)")
+         ("trace-spans-per-thread", bpo::value<uint32_t>()->default_value(0),
+          "Spans of the hot paths of block and transaction processing each thread keeps, written as a Chrome trace by write_trace_spans and on SIGUSR1 (0 to record none).")
+         ("trace-spans-dir", bpo::value<bfs::path>()->default_value("trace-spans"),
+          "the location of the trace spans directory (absolute path or relative to application data dir)")
+         ("contract-usage-windows", bpo::value<uint32_t>()->default_value(0),
+          "Number of windows of contract-usage-window-sec over which the wall time, billed CPU, database intrinsics and RAM of the actions of each contract are aggregated for the get_contract_usage API (0 to aggregate none).")
+         ("contract-usage-window-sec", bpo::value<uint32_t>()->default_value(60),
+          "Length in seconds of a window of contract-usage-windows.")
+         ("snapshot-compression", bpo::bool_switch()->default_value(false),
+          "Write compressed snapshots that can be streamed into --snapshot, and log their integrity hash.")
+         ("snapshot-deltas", bpo::bool_switch()->default_value(false),
+          "Write every snapshot after the first one taken since startup as snapshot-delta-<id>.bin, holding only what changed since the previous snapshot. "
+          "Deltas are not compressed and are loaded with --snapshot-delta on top of their base.")
+         ("snapshot-block-interval", bpo::value<uint32_t>()->default_value(0),
+          "Create a snapshot of the head block after each block of a number multiple of this, written in the background like those of the create_snapshot API and named once irreversible (0 for none).")
          ;
    config_file_options.add(producer_options);
 }
@@ -781,7 +1188,7 @@ make_keosd_signature_provider(const std::shared_ptr<producer_plugin_impl>& impl,
          fc::variant params;
          fc::to_variant(std::make_pair(digest, pubkey), params);
          auto deadline = impl->_keosd_provider_timeout_us.count() >= 0 ? fc::time_point::now() + impl->_keosd_provider_timeout_us : fc::time_point::maximum();
-         return app().get_plugin<http_client_plugin>().get_client().post_sync(keosd_url, params, deadline).as<chain::signature_type>();
+         return app().get_plugin<http_client_plugin>().post_sync(keosd_url, params, deadline).as<chain::signature_type>();
       } else {
          return signature_type();
       }
@@ -810,6 +1217,7 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
          try {
             auto key_id_to_wif_pair = dejsonify<std::pair<public_key_type, private_key_type>>(key_id_to_wif_pair_string);
             my->_signature_providers[key_id_to_wif_pair.first] = make_key_signature_provider(key_id_to_wif_pair.second);
+            my->_local_signature_providers.insert(key_id_to_wif_pair.first);
             auto blanked_privkey = std::string(key_id_to_wif_pair.second.to_string().size(), '*' );
             wlog("\"private-key\" is DEPRECATED, use \"signature-provider=${pub}=KEY:${priv}\"", ("pub",key_id_to_wif_pair.first)("priv", blanked_privkey));
          } catch ( fc::exception& e ) {
@@ -836,8 +1244,10 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
 
             if (spec_type_str == "KEY") {
                my->_signature_providers[pubkey] = make_key_signature_provider(private_key_type(spec_data));
+               my->_local_signature_providers.insert(pubkey);
             } else if (spec_type_str == "KEOSD") {
                my->_signature_providers[pubkey] = make_keosd_signature_provider(my, spec_data, pubkey);
+               my->_local_signature_providers.erase(pubkey);
             }
 
          } catch (...) {
@@ -880,6 +1290,7 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
    my->_max_block_net_usage_threshold_bytes = options.at( "max-block-net-usage-threshold-bytes" ).as<uint32_t>();
 
    my->_max_scheduled_transaction_time_per_block_ms = options.at("max-scheduled-transaction-time-per-block-ms").as<int32_t>();
+   my->_max_scheduled_transaction_scan_per_block = options.at("max-scheduled-transaction-scan-per-block").as<int32_t>();
 
    if( options.at( "subjective-cpu-leeway-us" ).as<int32_t>() != config::default_subjective_cpu_leeway_us ) {
       chain.set_subjective_cpu_leeway( fc::microseconds( options.at( "subjective-cpu-leeway-us" ).as<int32_t>() ) );
@@ -895,10 +1306,31 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
                "incoming-transaction-queue-size-mb ${mb} must be greater than 0", ("mb", max_incoming_transaction_queue_size) );
 
    my->_pending_incoming_transactions.set_max_incoming_transaction_queue_size( max_incoming_transaction_queue_size );
+   my->_recovered_transactions.set_max_size( max_incoming_transaction_queue_size );
 
    my->_incoming_defer_ratio = options.at("incoming-defer-ratio").as<double>();
 
+   const auto incoming_priority = options.at("incoming-transaction-priority").as<string>();
+   if( incoming_priority == "fifo" ) {
+      my->_incoming_priority = producer_plugin_impl::incoming_priority::fifo;
+   } else if( incoming_priority == "subjective-cpu" ) {
+      my->_incoming_priority = producer_plugin_impl::incoming_priority::subjective_cpu;
+   } else if( incoming_priority == "cpu-allowance" ) {
+      my->_incoming_priority = producer_plugin_impl::incoming_priority::cpu_allowance;
+   } else {
+      EOS_THROW( plugin_config_exception, "incoming-transaction-priority ${p} must be fifo, subjective-cpu or cpu-allowance",
+                 ("p", incoming_priority) );
+   }
+   if( my->_incoming_priority != producer_plugin_impl::incoming_priority::fifo ) {
+      my->_pending_incoming_transactions.set_scorer( [impl = my.get()]( const transaction_metadata_ptr& trx ) {
+         return impl->incoming_priority_score( trx );
+      } );
+   }
+
+   my->_block_timelines.set_capacity( options.at("block-timeline-size").as<uint32_t>() );
    my->_disable_persist_until_expired = options.at("disable-api-persisted-trx").as<bool>();
+   my->_max_reapply_head_block_age_us = fc::seconds(options.at("max-reapply-head-block-age").as<int32_t>());
+   my->_pre_execute_next_block = options.at("pre-execute-next-block").as<bool>();
    if( options.at("disable-subjective-billing").as<bool>() ) my->_subjective_billing.disable();
 
    auto thread_pool_size = options.at( "producer-threads" ).as<uint16_t>();
@@ -921,6 +1353,19 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
                   "No such directory '${dir}'", ("dir", my->_snapshots_dir.generic_string()) );
    }
 
+   auto tsd = options.at( "trace-spans-dir" ).as<bfs::path>();
+   my->_trace_spans_dir = tsd.is_relative() ? app().data_dir() / tsd : tsd;
+   my->_trace_spans_per_thread = options.at( "trace-spans-per-thread" ).as<uint32_t>();
+
+   const auto usage_windows = options.at( "contract-usage-windows" ).as<uint32_t>();
+   const auto usage_window_sec = options.at( "contract-usage-window-sec" ).as<uint32_t>();
+   EOS_ASSERT( usage_windows == 0 || usage_window_sec > 0, plugin_config_exception, "contract-usage-window-sec must be positive" );
+   chain.get_mutable_contract_usage_profiler().configure( fc::seconds( usage_window_sec ), usage_windows );
+
+   my->_compress_snapshots = options.at( "snapshot-compression" ).as<bool>();
+   my->_snapshot_deltas = options.at( "snapshot-deltas" ).as<bool>();
+   my->_snapshot_block_interval = options.at( "snapshot-block-interval" ).as<uint32_t>();
+
    my->_incoming_block_subscription = app().get_channel<incoming::channels::block>().subscribe(
          [this](const signed_block_ptr& block) {
       try {
@@ -945,6 +1390,16 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
       return my->on_incoming_transaction_async(trx, persist_until_expired, next );
    });
 
+   my->_incoming_transaction_batch_async_provider = app().get_method<incoming::methods::transaction_batch_async>().register_provider(
+         [this](const std::vector<packed_transaction_ptr>& trxs, bool persist_until_expired, const batch_next_function& next) -> void {
+      return my->on_incoming_transaction_batch_async(trxs, persist_until_expired, next );
+   });
+
+   my->_incoming_transaction_dry_run_async_provider = app().get_method<incoming::methods::transaction_dry_run_async>().register_provider(
+         [this](const packed_transaction_ptr& trx, next_function<transaction_trace_ptr> next) -> void {
+      return my->on_incoming_transaction_async(trx, false, next, transaction_metadata::trx_type::dry_run );
+   });
+
    if (options.count("greylist-account")) {
       std::vector<std::string> greylist = options["greylist-account"].as<std::vector<std::string>>();
       greylist_params param;
@@ -1000,6 +1455,12 @@ void producer_plugin::plugin_startup()
       }
    }
 
+   if( my->_trace_spans_per_thread > 0 ) {
+      chain::span_trace::enable( my->_trace_spans_per_thread );
+      my->_trace_spans_signal.emplace( app().get_io_service(), SIGUSR1 );
+      my->handle_trace_spans_signal();
+   }
+
    my->schedule_production_loop();
 
    ilog("producer plugin:  plugin_startup() end");
@@ -1021,6 +1482,16 @@ void producer_plugin::plugin_shutdown() {
       my->_thread_pool->stop();
    }
 
+   // waits for the snapshots still being written
+   my->_pending_snapshot_index.clear();
+
+   if( my->_trace_spans_signal ) {
+      boost::system::error_code ec;
+      my->_trace_spans_signal->cancel( ec );
+      chain::span_trace::disable();
+   }
+
+   chain::async_log::instance().flush();
    app().post( 0, [me = my](){} ); // keep my pointer alive until queue is drained
 }
 
@@ -1175,11 +1646,16 @@ producer_plugin::integrity_hash_information producer_plugin::get_integrity_hash(
    return {chain.head_block_id(), chain.calculate_integrity_hash()};
 }
 
+producer_plugin::trace_spans_information producer_plugin::write_trace_spans() const {
+   return {my->write_trace_spans()};
+}
+
 void producer_plugin::create_snapshot(producer_plugin::next_function<producer_plugin::snapshot_information> next) {
    chain::controller& chain = my->chain_plug->chain();
 
    auto head_id = chain.head_block_id();
-   const auto& snapshot_path = pending_snapshot::get_final_path(head_id, my->_snapshots_dir);
+   const bool delta = my->_snapshot_deltas && my->_last_snapshot_manifest;
+   const auto& snapshot_path = pending_snapshot::get_final_path(head_id, my->_snapshots_dir, delta);
    const auto& temp_path     = pending_snapshot::get_temp_path(head_id, my->_snapshots_dir);
 
    // maintain legacy exception if the snapshot exists
@@ -1189,7 +1665,24 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
       return;
    }
 
-   auto write_snapshot = [&]( const bfs::path& p ) -> void {
+   // determine if this snapshot is already in-flight
+   auto& pending_by_id = my->_pending_snapshot_index.get<by_id>();
+   auto existing = pending_by_id.find(head_id);
+   if( existing != pending_by_id.end() ) {
+      // if a snapshot at this block is already pending, attach this requests handler to it
+      pending_by_id.modify(existing, [&next]( auto& entry ){
+         entry.next = [prev = entry.next, next](const fc::static_variant<fc::exception_ptr, producer_plugin::snapshot_information>& res){
+            prev(res);
+            next(res);
+         };
+      });
+      return;
+   }
+
+   // The state is walked here, on the main thread, since nothing may modify it meanwhile. The file is written by the
+   // thread of the background_file_buf, and renamed to its pending path back on the main thread once synced. The
+   // result is returned when the snapshot is also irreversible, right away in irreversible mode.
+   try {
       auto reschedule = fc::make_scoped_exit([this](){
          my->schedule_production_loop();
       });
@@ -1201,65 +1694,39 @@ void producer_plugin::create_snapshot(producer_plugin::next_function<producer_pl
          reschedule.cancel();
       }
 
-      bfs::create_directory( p.parent_path() );
+      bfs::create_directory( temp_path.parent_path() );
 
       // create the snapshot
-      auto snap_out = std::ofstream(p.generic_string(), (std::ios::out | std::ios::binary));
-      auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
-      chain.write_snapshot(writer);
-      writer->finalize();
-      snap_out.flush();
-      snap_out.close();
-   };
-
-   // If in irreversible mode, create snapshot and return path to snapshot immediately.
-   if( chain.get_read_mode() == db_read_mode::IRREVERSIBLE ) {
-      try {
-         write_snapshot( temp_path );
-
-         boost::system::error_code ec;
-         bfs::rename(temp_path, snapshot_path, ec);
-         EOS_ASSERT(!ec, snapshot_finalization_exception,
-               "Unable to finalize valid snapshot of block number ${bn}: [code: ${ec}] ${message}",
-               ("bn", chain.head_block_num())
-               ("ec", ec.value())
-               ("message", ec.message()));
-
-         next( producer_plugin::snapshot_information{head_id, snapshot_path.generic_string()} );
-      } CATCH_AND_CALL (next);
-      return;
-   }
-
-   // Otherwise, the result will be returned when the snapshot becomes irreversible.
+      auto writer_buf = std::make_shared<background_file_buf>(temp_path.generic_string());
+      std::ostream snap_out(writer_buf.get());
+      if (my->_snapshot_deltas) {
+         auto out = std::make_shared<ostream_snapshot_writer>(snap_out);
+         auto writer = std::make_shared<snapshot_delta_writer>(out, my->_last_snapshot_manifest);
+         chain.write_snapshot(writer);
+         writer->finalize();
+         out->finalize();
+         my->_last_snapshot_manifest = writer->manifest();
+      } else if (my->_compress_snapshots) {
+         auto writer = std::make_shared<compressed_ostream_snapshot_writer>(snap_out);
+         chain.write_snapshot(writer);
+         writer->finalize();
+         ilog("Wrote compressed snapshot of block ${bn} with integrity hash ${h}",
+              ("bn", chain.head_block_num())("h", writer->integrity_hash()));
+      } else {
+         auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
+         chain.write_snapshot(writer);
+         writer->finalize();
+      }
 
-   // determine if this snapshot is already in-flight
-   auto& pending_by_id = my->_pending_snapshot_index.get<by_id>();
-   auto existing = pending_by_id.find(head_id);
-   if( existing != pending_by_id.end() ) {
-      // if a snapshot at this block is already pending, attach this requests handler to it
-      pending_by_id.modify(existing, [&next]( auto& entry ){
-         entry.next = [prev = entry.next, next](const fc::static_variant<fc::exception_ptr, producer_plugin::snapshot_information>& res){
-            prev(res);
-            next(res);
-         };
-      });
-   } else {
       const auto& pending_path = pending_snapshot::get_pending_path(head_id, my->_snapshots_dir);
-
-      try {
-         write_snapshot( temp_path ); // create a new pending snapshot
-
-         boost::system::error_code ec;
-         bfs::rename(temp_path, pending_path, ec);
-         EOS_ASSERT(!ec, snapshot_finalization_exception,
-               "Unable to promote temp snapshot to pending for block number ${bn}: [code: ${ec}] ${message}",
-               ("bn", chain.head_block_num())
-               ("ec", ec.value())
-               ("message", ec.message()));
-
-         my->_pending_snapshot_index.emplace(head_id, next, pending_path.generic_string(), snapshot_path.generic_string());
-      } CATCH_AND_CALL (next);
-   }
+      my->_pending_snapshot_index.emplace(head_id, next, pending_path.generic_string(), snapshot_path.generic_string(), writer_buf);
+
+      writer_buf->finish( [weak_my = std::weak_ptr<producer_plugin_impl>(my), head_id]( const std::string& error ) {
+         app().post( priority::medium, [weak_my, head_id, error]() {
+            if( auto my = weak_my.lock() ) my->on_snapshot_written( head_id, error );
+         } );
+      } );
+   } CATCH_AND_CALL (next);
 }
 
 producer_plugin::scheduled_protocol_feature_activations
@@ -1323,6 +1790,55 @@ fc::variants producer_plugin::get_supported_protocol_features( const get_support
    return results;
 }
 
+producer_plugin::get_incoming_transactions_result
+producer_plugin::get_incoming_transactions( const get_incoming_transactions_params& params ) const {
+   get_incoming_transactions_result result;
+   result.size = my->_pending_incoming_transactions.size();
+   result.size_in_bytes = my->_pending_incoming_transactions.size_bytes();
+   my->_pending_incoming_transactions.for_each( params.limit, [&result]( const transaction_metadata_ptr& trx, double score ) {
+      result.transactions.push_back( {trx->id(), trx->packed_trx()->get_transaction().first_authorizer(), score} );
+   } );
+   return result;
+}
+
+producer_plugin::get_block_timelines_result
+producer_plugin::get_block_timelines( const get_block_timelines_params& params ) const {
+   get_block_timelines_result result;
+   my->_block_timelines.for_each( params.limit, [&result]( const block_timeline_log::entry& e ) {
+      block_timeline t{e.block_num, e.id, e.block_time, e.started, e.produced, {}};
+      t.phases.reserve( block_timeline_log::num_phases );
+      for( size_t i = 0; i < block_timeline_log::num_phases; ++i ) {
+         const auto p = static_cast<block_timeline_log::phase>( i );
+         t.phases.push_back( {block_timeline_log::to_string( p ), e.phases[i].time_us, e.phases[i].transactions} );
+      }
+      result.timelines.emplace_back( std::move( t ) );
+   } );
+   return result;
+}
+
+producer_plugin::get_contract_usage_result
+producer_plugin::get_contract_usage( const get_contract_usage_params& params ) const {
+   using metric = chain::contract_usage_profiler::metric;
+   static const std::map<std::string, metric> metrics = {
+      {"wall", metric::wall}, {"billed_cpu", metric::billed_cpu}, {"db_intrinsics", metric::db_intrinsics},
+      {"ram_delta", metric::ram_delta}, {"calls", metric::calls}
+   };
+   auto m = metrics.find( params.sort_by );
+   EOS_ASSERT( m != metrics.end(), producer_exception, "unknown sort_by '${s}'", ("s", params.sort_by) );
+
+   const auto& profiler = my->chain_plug->chain().get_contract_usage_profiler();
+   EOS_ASSERT( profiler.enabled(), producer_exception, "contract-usage-windows is 0, no contract usage is aggregated" );
+
+   const auto now = fc::time_point::now();
+   get_contract_usage_result result;
+   result.window_start = profiler.window_start( params.windows, now );
+   for( const auto& a : profiler.top( params.limit, params.windows, m->second, now ) ) {
+      result.actions.push_back( {a.receiver, a.action, a.totals.calls, a.totals.wall_us, a.totals.billed_cpu_us,
+                                 a.totals.db_intrinsics, a.totals.ram_delta} );
+   }
+   return result;
+}
+
 producer_plugin::get_account_ram_corrections_result
 producer_plugin::get_account_ram_corrections( const get_account_ram_corrections_params& params ) const {
    get_account_ram_corrections_result result;
@@ -1370,7 +1886,7 @@ producer_plugin::get_account_ram_corrections( const get_account_ram_corrections_
 optional<fc::time_point> producer_plugin_impl::calculate_next_block_time(const account_name& producer_name, const block_timestamp_type& current_block_time) const {
    chain::controller& chain = chain_plug->chain();
    const auto& hbs = chain.head_block_state();
-   const auto& active_schedule = hbs->active_schedule.producers;
+   const auto& active_schedule = hbs->active_schedule->producers;
 
    // determine if this producer is in the active schedule and if so, where
    auto itr = std::find_if(active_schedule.begin(), active_schedule.end(), [&](const auto& asp){ return asp.producer_name == producer_name; });
@@ -1444,6 +1960,7 @@ fc::time_point producer_plugin_impl::calculate_block_deadline( const fc::time_po
 producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
    chain::controller& chain = chain_plug->chain();
 
+   unapplied_transactions_metric.set( _unapplied_transactions.size() );
    if( !chain_plug->accept_transactions() )
       return start_block_result::waiting_for_block;
 
@@ -1512,13 +2029,20 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
          return start_block_result::waiting_for_block;
    }
 
+   // pending block started ahead of the production window of block_time and still on head
+   const bool pre_executed = _pre_executing && chain.is_building_block() && chain.pending_block_time() == block_time &&
+                             _pending_block_mode == pending_block_mode::producing;
+   bool pre_execute = false;
    if (_pending_block_mode == pending_block_mode::producing) {
       const auto start_block_time = block_time - fc::microseconds( config::block_interval_us );
       if( now < start_block_time ) {
          fc_dlog(_log, "Not producing block waiting for production window ${n} ${bt}", ("n", hbs->block_num + 1)("bt", block_time) );
          // start_block_time instead of block_time because schedule_delayed_production_loop calculates next block time from given time
          schedule_delayed_production_loop(weak_from_this(), calculate_producer_wake_up_time(start_block_time));
-         return start_block_result::waiting_for_production;
+         if( !_pre_execute_next_block || pre_executed )
+            return start_block_result::waiting_for_production;
+         // the block is the one right after head, start it now and keep it at the start of the window
+         pre_execute = true;
       }
    } else if (previous_pending_mode == pending_block_mode::producing) {
       // just produced our last block of our round
@@ -1528,69 +2052,80 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
       return start_block_result::waiting_for_production;
    }
 
-   fc_dlog(_log, "Starting block #${n} at ${time} producer ${p}",
-           ("n", hbs->block_num + 1)("time", now)("p", scheduled_producer.producer_name));
+   if( pre_executed ) {
+      fc_dlog(_log, "Continuing block #${n} started ahead of its production window, producer ${p}",
+              ("n", hbs->block_num + 1)("p", scheduled_producer.producer_name));
+      _pre_executing = false;
+   } else {
+      fc_dlog(_log, "Starting block #${n} at ${time} producer ${p}",
+              ("n", hbs->block_num + 1)("time", now)("p", scheduled_producer.producer_name));
+
+      try {
+         uint16_t blocks_to_confirm = 0;
 
-   try {
-      uint16_t blocks_to_confirm = 0;
-
-      if (_pending_block_mode == pending_block_mode::producing) {
-         // determine how many blocks this producer can confirm
-         // 1) if it is not a producer from this node, assume no confirmations (we will discard this block anyway)
-         // 2) if it is a producer on this node that has never produced, the conservative approach is to assume no
-         //    confirmations to make sure we don't double sign after a crash TODO: make these watermarks durable?
-         // 3) if it is a producer on this node where this node knows the last block it produced, safely set it -UNLESS-
-         // 4) the producer on this node's last watermark is higher (meaning on a different fork)
-         if (current_watermark) {
-            auto watermark_bn = current_watermark->first;
-            if (watermark_bn < hbs->block_num) {
-               blocks_to_confirm = (uint16_t)(std::min<uint32_t>(std::numeric_limits<uint16_t>::max(), (uint32_t)(hbs->block_num - watermark_bn)));
+         if (_pending_block_mode == pending_block_mode::producing) {
+            // determine how many blocks this producer can confirm
+            // 1) if it is not a producer from this node, assume no confirmations (we will discard this block anyway)
+            // 2) if it is a producer on this node that has never produced, the conservative approach is to assume no
+            //    confirmations to make sure we don't double sign after a crash TODO: make these watermarks durable?
+            // 3) if it is a producer on this node where this node knows the last block it produced, safely set it -UNLESS-
+            // 4) the producer on this node's last watermark is higher (meaning on a different fork)
+            if (current_watermark) {
+               auto watermark_bn = current_watermark->first;
+               if (watermark_bn < hbs->block_num) {
+                  blocks_to_confirm = (uint16_t)(std::min<uint32_t>(std::numeric_limits<uint16_t>::max(), (uint32_t)(hbs->block_num - watermark_bn)));
+               }
             }
-         }
 
-         // can not confirm irreversible blocks
-         blocks_to_confirm = (uint16_t)(std::min<uint32_t>(blocks_to_confirm, (uint32_t)(hbs->block_num - hbs->dpos_irreversible_blocknum)));
-      }
+            // can not confirm irreversible blocks
+            blocks_to_confirm = (uint16_t)(std::min<uint32_t>(blocks_to_confirm, (uint32_t)(hbs->block_num - hbs->dpos_irreversible_blocknum)));
+         }
 
-      abort_block();
+         abort_block();
 
-      auto features_to_activate = chain.get_preactivated_protocol_features();
-      if( _pending_block_mode == pending_block_mode::producing && _protocol_features_to_activate.size() > 0 ) {
-         bool drop_features_to_activate = false;
-         try {
-            chain.validate_protocol_features( _protocol_features_to_activate );
-         } catch( const fc::exception& e ) {
-            wlog( "protocol features to activate are no longer all valid: ${details}",
-                  ("details",e.to_detail_string()) );
-            drop_features_to_activate = true;
-         }
+         auto features_to_activate = chain.get_preactivated_protocol_features();
+         if( _pending_block_mode == pending_block_mode::producing && _protocol_features_to_activate.size() > 0 ) {
+            bool drop_features_to_activate = false;
+            try {
+               chain.validate_protocol_features( _protocol_features_to_activate );
+            } catch( const fc::exception& e ) {
+               wlog( "protocol features to activate are no longer all valid: ${details}",
+                     ("details",e.to_detail_string()) );
+               drop_features_to_activate = true;
+            }
 
-         if( drop_features_to_activate ) {
-            _protocol_features_to_activate.clear();
-         } else {
-            auto protocol_features_to_activate = _protocol_features_to_activate; // do a copy as pending_block might be aborted
-            if( features_to_activate.size() > 0 ) {
-               protocol_features_to_activate.reserve( protocol_features_to_activate.size()
-                                                         + features_to_activate.size() );
-               std::set<digest_type> set_of_features_to_activate( protocol_features_to_activate.begin(),
-                                                                  protocol_features_to_activate.end() );
-               for( const auto& f : features_to_activate ) {
-                  auto res = set_of_features_to_activate.insert( f );
-                  if( res.second ) {
-                     protocol_features_to_activate.push_back( f );
+            if( drop_features_to_activate ) {
+               _protocol_features_to_activate.clear();
+            } else {
+               auto protocol_features_to_activate = _protocol_features_to_activate; // do a copy as pending_block might be aborted
+               if( features_to_activate.size() > 0 ) {
+                  protocol_features_to_activate.reserve( protocol_features_to_activate.size()
+                                                            + features_to_activate.size() );
+                  std::set<digest_type> set_of_features_to_activate( protocol_features_to_activate.begin(),
+                                                                     protocol_features_to_activate.end() );
+                  for( const auto& f : features_to_activate ) {
+                     auto res = set_of_features_to_activate.insert( f );
+                     if( res.second ) {
+                        protocol_features_to_activate.push_back( f );
+                     }
                   }
+                  features_to_activate.clear();
                }
-               features_to_activate.clear();
+               std::swap( features_to_activate, protocol_features_to_activate );
+               _protocol_features_signaled = true;
+               ilog( "signaling activation of the following protocol features in block ${num}: ${features_to_activate}",
+                     ("num", hbs->block_num + 1)("features_to_activate", features_to_activate) );
             }
-            std::swap( features_to_activate, protocol_features_to_activate );
-            _protocol_features_signaled = true;
-            ilog( "signaling activation of the following protocol features in block ${num}: ${features_to_activate}",
-                  ("num", hbs->block_num + 1)("features_to_activate", features_to_activate) );
          }
-      }
 
-      chain.start_block( block_time, blocks_to_confirm, features_to_activate );
-   } LOG_AND_DROP();
+         if( _pending_block_mode == pending_block_mode::producing ) {
+            _block_timelines.start( hbs->block_num + 1, block_time, now );
+         }
+         chain.start_block( block_time, blocks_to_confirm, features_to_activate );
+         _block_timelines.add( block_timeline_log::phase::start, fc::time_point::now() - now, 0 );
+         _pre_executing = pre_execute;
+      } LOG_AND_DROP();
+   }
 
    if( chain.is_building_block() ) {
       const auto& pending_block_signing_authority = chain.pending_block_signing_authority();
@@ -1602,20 +2137,33 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
       }
 
       try {
-         if( !remove_expired_persisted_trxs( preprocess_deadline ) )
-            return start_block_result::exhausted;
-         if( !remove_expired_blacklisted_trxs( preprocess_deadline ) )
-            return start_block_result::exhausted;
-         if( !_subjective_billing.remove_expired( _log, chain.pending_block_time(), fc::time_point::now(), preprocess_deadline ) )
-            return start_block_result::exhausted;
+         {
+            timeline_phase phase( *this, block_timeline_log::phase::expire );
+            if( !remove_expired_persisted_trxs( preprocess_deadline ) )
+               return start_block_result::exhausted;
+            if( !remove_expired_blacklisted_trxs( preprocess_deadline ) )
+               return start_block_result::exhausted;
+            if( !_subjective_billing.remove_expired( _log, chain.pending_block_time(), fc::time_point::now(), preprocess_deadline ) )
+               return start_block_result::exhausted;
+         }
+
+         // pick up transactions recovered since the last drain so they are processed in this block slice
+         process_recovered_transactions( false );
 
          // limit execution of pending incoming to once per block
          size_t pending_incoming_process_limit = _pending_incoming_transactions.size();
 
-         if( !process_unapplied_trxs( preprocess_deadline ) )
-            return start_block_result::exhausted;
+         // while catching up the next block aborts a speculative block right away, re-applying to it is wasted
+         const bool catching_up = _max_reapply_head_block_age_us.count() >= 0 &&
+                                  now - hbs->header.timestamp.to_time_point() > _max_reapply_head_block_age_us;
+         if( _pending_block_mode == pending_block_mode::producing || !catching_up ) {
+            timeline_phase phase( *this, block_timeline_log::phase::reapply );
+            if( !process_unapplied_trxs( preprocess_deadline ) )
+               return start_block_result::exhausted;
+         }
 
          if (_pending_block_mode == pending_block_mode::producing) {
+            timeline_phase phase( *this, block_timeline_log::phase::scheduled );
             auto scheduled_trx_deadline = preprocess_deadline;
             if (_max_scheduled_transaction_time_per_block_ms >= 0) {
                scheduled_trx_deadline = std::min<fc::time_point>(
@@ -1632,6 +2180,7 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
          if (preprocess_deadline <= fc::time_point::now() || block_is_exhausted()) {
             return start_block_result::exhausted;
          } else {
+            timeline_phase phase( *this, block_timeline_log::phase::incoming );
             if( !process_incoming_trxs( preprocess_deadline, pending_incoming_process_limit ) )
                return start_block_result::exhausted;
             return start_block_result::succeeded;
@@ -1724,6 +2273,8 @@ bool producer_plugin_impl::remove_expired_blacklisted_trxs( const fc::time_point
          blacklist_by_expiry.erase(blacklist_by_expiry.begin());
          num_expired++;
       }
+      // expired scheduled transactions are no longer skipped, they have to be retired
+      if( num_expired > 0 ) _scheduled_scan_start.reset();
 
       fc_dlog(_log, "Processed ${n} blacklisted transactions, Expired ${expired}",
               ("n", orig_count)("expired", num_expired));
@@ -1902,21 +2453,45 @@ void producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
    const auto& sch_idx = chain.db().get_index<generated_transaction_multi_index,by_delay>();
    const auto scheduled_trxs_size = sch_idx.size();
    auto sch_itr = sch_idx.begin();
+
+   // skip the blacklisted transactions a previous scan on this head or its parent found at the front, transactions
+   // scheduled since come after them as the ids of a chain only increase
+   const auto& head_id = chain.head_block_id();
+   if( _scheduled_scan_start && (_scheduled_scan_start->head_id == head_id ||
+                                 _scheduled_scan_start->head_id == chain.head_block_state()->header.previous) ) {
+      sch_itr = sch_idx.upper_bound( boost::make_tuple( _scheduled_scan_start->delay_until, _scheduled_scan_start->id ) );
+      _scheduled_scan_start->head_id = head_id;
+   } else {
+      _scheduled_scan_start.reset();
+   }
+   bool at_front = true; // all transactions looked at so far are blacklisted
+   int32_t num_scanned = 0;
+
    while( sch_itr != sch_idx.end() ) {
       if( sch_itr->delay_until > pending_block_time) break;    // not scheduled yet
       if( exhausted || deadline <= fc::time_point::now() ) {
          exhausted = true;
          break;
       }
+      if( _max_scheduled_transaction_scan_per_block >= 0 && num_scanned >= _max_scheduled_transaction_scan_per_block ) {
+         exhausted = true;
+         break;
+      }
+      ++num_scanned;
       if( sch_itr->published >= pending_block_time ) {
+         at_front = false;
          ++sch_itr;
          continue; // do not allow schedule and execute in same block
       }
 
       if (blacklist_by_id.find(sch_itr->trx_id) != blacklist_by_id.end()) {
+         if( at_front ) {
+            _scheduled_scan_start = scheduled_scan_start{head_id, sch_itr->delay_until, sch_itr->id};
+         }
          ++sch_itr;
          continue;
       }
+      at_front = false;
 
       const transaction_id_type trx_id = sch_itr->trx_id; // make copy since reference could be invalidated
       const auto sch_expiration = sch_itr->expiration;
@@ -1982,8 +2557,8 @@ void producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
 
    if( scheduled_trxs_size > 0 ) {
       fc_dlog( _log,
-               "Processed ${m} of ${n} scheduled transactions, Applied ${applied}, Failed/Dropped ${failed}",
-               ( "m", num_processed )( "n", scheduled_trxs_size )( "applied", num_applied )( "failed", num_failed ) );
+               "Processed ${m} of ${n} scheduled transactions, Applied ${applied}, Failed/Dropped ${failed}, Scanned ${s}",
+               ( "m", num_processed )( "n", scheduled_trxs_size )( "applied", num_applied )( "failed", num_failed )( "s", num_scanned ) );
    }
 }
 
@@ -1993,20 +2568,44 @@ bool producer_plugin_impl::process_incoming_trxs( const fc::time_point& deadline
    if (!_pending_incoming_transactions.empty()) {
       size_t processed = 0;
       fc_dlog(_log, "Processing ${n} pending transactions", ("n", pending_incoming_process_limit));
+      // transactions estimated not to fit in what is left of the block are put back for the next one instead of
+      // being executed until they run out of time, smaller ones after them are tried; the block is taken for full
+      // once max_skipped of them come in a row
+      constexpr size_t max_skipped = 100;
+      size_t skipped_in_a_row = 0;
+      std::vector<decltype(_pending_incoming_transactions.pop_front())> skipped;
+      const auto& rl = chain_plug->chain().get_resource_limits_manager();
       while (pending_incoming_process_limit && _pending_incoming_transactions.size()) {
-         if (deadline <= fc::time_point::now()) {
+         const auto now = fc::time_point::now();
+         if (deadline <= now) {
             exhausted = true;
             break;
          }
          auto e = _pending_incoming_transactions.pop_front();
          --pending_incoming_process_limit;
+         if( _pending_block_mode == pending_block_mode::producing ) {
+            const auto estimate = _cost_model.estimate( std::get<0>(e)->packed_trx()->get_transaction() );
+            if( estimate && (now + *estimate > deadline || uint64_t(estimate->count()) > rl.get_block_cpu_limit()) ) {
+               skipped.emplace_back( std::move( e ) );
+               if( ++skipped_in_a_row >= max_skipped ) {
+                  exhausted = true;
+                  break;
+               }
+               continue;
+            }
+         }
+         skipped_in_a_row = 0;
          ++processed;
          if( !process_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e)) ) {
             exhausted = true;
             break;
          }
       }
-      fc_dlog(_log, "Processed ${n} pending transactions, ${p} left", ("n", processed)("p", _pending_incoming_transactions.size()));
+      for( auto ritr = skipped.rbegin(); ritr != skipped.rend(); ++ritr ) {
+         _pending_incoming_transactions.add_front( std::get<0>(*ritr), std::get<1>(*ritr), std::get<2>(*ritr) );
+      }
+      fc_dlog(_log, "Processed ${n} pending transactions, skipped ${s} estimated not to fit, ${p} left",
+              ("n", processed)("s", skipped.size())("p", _pending_incoming_transactions.size()));
    }
    return !exhausted;
 }
@@ -2054,8 +2653,8 @@ void producer_plugin_impl::schedule_production_loop() {
          // nothing to do until more blocks arrive
       }
 
-   } else if (result == start_block_result::waiting_for_production) {
-      // scheduled in start_block()
+   } else if (result == start_block_result::waiting_for_production || _pre_executing) {
+      // scheduled in start_block(), a block started ahead of its production window is produced once the window opens
 
    } else if (_pending_block_mode == pending_block_mode::producing) {
       schedule_maybe_produce_block( result == start_block_result::exhausted );
@@ -2076,6 +2675,12 @@ void producer_plugin_impl::schedule_maybe_produce_block( bool exhausted ) {
    // we succeeded but block may be exhausted
    static const boost::posix_time::ptime epoch( boost::gregorian::date( 1970, 1, 1 ) );
    auto deadline = calculate_block_deadline( chain.pending_block_time() );
+   // a block started ahead of its production window is never produced before the window opens
+   const auto start_block_time = chain.pending_block_time() - fc::microseconds( config::block_interval_us );
+   if( exhausted && start_block_time > fc::time_point::now() ) {
+      exhausted = false;
+      deadline = start_block_time;
+   }
 
    if( !exhausted && deadline > fc::time_point::now() ) {
       // ship this block off no later than its deadline
@@ -2184,13 +2789,16 @@ void producer_plugin_impl::produce_block() {
 
    const auto& auth = chain.pending_block_signing_authority();
    std::vector<std::reference_wrapper<const signature_provider_type>> relevant_providers;
+   std::vector<bool> relevant_provider_is_local;
 
    relevant_providers.reserve(_signature_providers.size());
+   relevant_provider_is_local.reserve(_signature_providers.size());
 
    producer_authority::for_each_key(auth, [&](const public_key_type& key){
       const auto& iter = _signature_providers.find(key);
       if (iter != _signature_providers.end()) {
          relevant_providers.emplace_back(iter->second);
+         relevant_provider_is_local.push_back(_local_signature_providers.count(key) > 0);
       }
    });
 
@@ -2202,21 +2810,52 @@ void producer_plugin_impl::produce_block() {
    }
 
    //idump( (fc::time_point::now() - chain.pending_block_time()) );
+   const auto finalize_start = fc::time_point::now();
+   fc::microseconds sign_time;
    chain.finalize_block( [&]( const digest_type& d ) {
       auto debug_logger = maybe_make_debug_time_logger();
+      const auto sign_start = fc::time_point::now();
       vector<signature_type> sigs;
       sigs.reserve(relevant_providers.size());
 
-      // sign with all relevant public keys
-      for (const auto& p : relevant_providers) {
-         sigs.emplace_back(p.get()(d));
+      if (relevant_providers.size() == 1) {
+         sigs.emplace_back(relevant_providers.front().get()(d));
+      } else {
+         // sign with all relevant public keys at once: local keys on the thread pool, while the others, which wait on
+         // keosd, are called one after the other from this thread as the http client is not shared between threads
+         vector<std::future<signature_type>> local_sigs(relevant_providers.size());
+         for (size_t i = 0; i < relevant_providers.size(); ++i) {
+            if (relevant_provider_is_local[i]) {
+               local_sigs[i] = async_thread_pool(_thread_pool->get_executor(), [p = relevant_providers[i], d]() {
+                  return p.get()(d);
+               });
+            }
+         }
+         vector<signature_type> remote_sigs(relevant_providers.size());
+         for (size_t i = 0; i < relevant_providers.size(); ++i) {
+            if (!relevant_provider_is_local[i]) {
+               remote_sigs[i] = relevant_providers[i].get()(d);
+            }
+         }
+         for (size_t i = 0; i < relevant_providers.size(); ++i) {
+            sigs.emplace_back(relevant_provider_is_local[i] ? local_sigs[i].get() : std::move(remote_sigs[i]));
+         }
       }
+      sign_time = fc::time_point::now() - sign_start;
       return sigs;
    } );
 
+   const auto commit_start = fc::time_point::now();
+   _block_timelines.add( block_timeline_log::phase::finalize, commit_start - finalize_start - sign_time, 0 );
+   _block_timelines.add( block_timeline_log::phase::sign, sign_time, 0 );
+
    chain.commit_block();
 
    block_state_ptr new_bs = chain.head_block_state();
+   const auto produced = fc::time_point::now();
+   _block_timelines.add( block_timeline_log::phase::commit, produced - commit_start, 0 );
+   _block_timelines.finish( new_bs->id, produced );
+   blocks_produced_metric.add();
 
    ilog("Produced block ${id}... #${n} @ ${t} signed by ${p} [trxs: ${count}, lib: ${lib}, confirmed: ${confs}]",
         ("p",new_bs->header.producer)("id",new_bs->id.str().substr(8,16))
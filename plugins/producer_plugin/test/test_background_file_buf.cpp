@@ -0,0 +1,85 @@
+#define BOOST_TEST_MODULE background_file_buf
+#include <boost/test/included/unit_test.hpp>
+
+#include <eosio/producer_plugin/background_file_buf.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <future>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+
+namespace {
+
+using namespace eosio;
+
+std::string read_file( const fc::path& p ) {
+   std::ifstream in( p.generic_string(), std::ios::binary );
+   return std::string( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+}
+
+/// writes the same to a background_file_buf and a stringstream, seeking back to patch as the snapshot writers do
+template<typename Stream>
+void write_patched( Stream& out ) {
+   const std::string row( 1000, 'r' );
+   for( int section = 0; section < 5; ++section ) {
+      const auto size_pos = out.tellp();
+      uint64_t size = 0;
+      out.write( reinterpret_cast<const char*>( &size ), sizeof(size) );
+      // more than background_file_buf::chunk_size per section
+      for( int i = 0; i < 1500; ++i ) {
+         out.put( char( 'a' + section ) );
+         out.write( row.data(), row.size() );
+         size += row.size() + 1;
+      }
+      const auto restore = out.tellp();
+      out.seekp( size_pos );
+      out.write( reinterpret_cast<const char*>( &size ), sizeof(size) );
+      out.seekp( restore );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE( background_file_buf_test )
+
+BOOST_AUTO_TEST_CASE( matches_stringstream ) {
+   fc::temp_directory dir;
+   const auto path = dir.path() / "out.bin";
+
+   std::ostringstream expected;
+   write_patched( expected );
+
+   std::promise<std::string> written;
+   {
+      background_file_buf buf( path.generic_string() );
+      std::ostream out( &buf );
+      write_patched( out );
+      buf.finish( [&written]( const std::string& error ) { written.set_value( error ); } );
+      BOOST_CHECK_EQUAL( "", written.get_future().get() );
+   }
+
+   BOOST_CHECK( read_file( path ) == expected.str() );
+}
+
+BOOST_AUTO_TEST_CASE( destroyed_without_finish ) {
+   fc::temp_directory dir;
+   const auto path = dir.path() / "out.bin";
+   {
+      background_file_buf buf( path.generic_string() );
+      std::ostream out( &buf );
+      out << "queued";
+      out.flush();
+      out << "dropped";
+   }
+   BOOST_CHECK_EQUAL( "queued", read_file( path ) );
+}
+
+BOOST_AUTO_TEST_CASE( open_failure ) {
+   fc::temp_directory dir;
+   BOOST_CHECK_THROW( background_file_buf( (dir.path() / "missing" / "out.bin").generic_string() ), chain::snapshot_exception );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
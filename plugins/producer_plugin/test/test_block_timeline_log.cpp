@@ -0,0 +1,62 @@
+#define BOOST_TEST_MODULE block_timeline_log
+#include <boost/test/included/unit_test.hpp>
+
+#include <eosio/producer_plugin/block_timeline_log.hpp>
+
+namespace {
+
+using namespace eosio;
+using phase = block_timeline_log::phase;
+
+BOOST_AUTO_TEST_SUITE( block_timeline_log_test )
+
+BOOST_AUTO_TEST_CASE( ring_test ) {
+   block_timeline_log log( 2 );
+   const auto now = fc::time_point::now();
+
+   // nothing is recorded before start or after abort
+   log.add( phase::start, fc::microseconds( 5 ), 0 );
+   log.finish( chain::block_id_type(), now );
+   BOOST_CHECK_EQUAL( 0u, log.size() );
+
+   log.start( 1, now, now );
+   log.add( phase::reapply, fc::microseconds( 7 ), 2 );
+   log.abort();
+   log.finish( chain::block_id_type(), now );
+   BOOST_CHECK_EQUAL( 0u, log.size() );
+
+   for( uint32_t n = 1; n <= 3; ++n ) {
+      log.start( n, now, now );
+      BOOST_CHECK( log.building() );
+      log.add( phase::incoming, fc::microseconds( 100 * n ), n );
+      log.add( phase::incoming, fc::microseconds( 10 ), 1 );
+      log.finish( chain::block_id_type(), now + fc::microseconds( n ) );
+      BOOST_CHECK( !log.building() );
+   }
+   BOOST_CHECK_EQUAL( 2u, log.size() );
+
+   std::vector<uint32_t> block_nums;
+   log.for_each( 10, [&]( const block_timeline_log::entry& e ) {
+      block_nums.push_back( e.block_num );
+      const auto& incoming = e.phases[static_cast<size_t>(phase::incoming)];
+      BOOST_CHECK_EQUAL( int64_t(100 * e.block_num + 10), incoming.time_us );
+      BOOST_CHECK_EQUAL( e.block_num + 1, incoming.transactions );
+      BOOST_CHECK_EQUAL( 0, e.phases[static_cast<size_t>(phase::reapply)].time_us );
+   } );
+   BOOST_CHECK( (block_nums == std::vector<uint32_t>{3, 2}) );
+
+   block_nums.clear();
+   log.for_each( 1, [&]( const block_timeline_log::entry& e ) { block_nums.push_back( e.block_num ); } );
+   BOOST_CHECK( (block_nums == std::vector<uint32_t>{3}) );
+
+   // disabled
+   block_timeline_log none;
+   none.start( 1, now, now );
+   BOOST_CHECK( !none.building() );
+   none.finish( chain::block_id_type(), now );
+   BOOST_CHECK_EQUAL( 0u, none.size() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
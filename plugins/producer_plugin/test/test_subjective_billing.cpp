@@ -157,6 +157,27 @@ BOOST_AUTO_TEST_CASE( subjective_bill_test ) {
       BOOST_CHECK_EQUAL( 0, sub_bill.get_subjective_bill(a, endtime) );
       BOOST_CHECK_EQUAL( 0, sub_bill.get_subjective_bill(b, endtime) );
    }
+   { // accounts are dropped once their expired bill has decayed away
+      subjective_billing sub_bill;
+
+      sub_bill.subjective_bill_failure(a, fc::microseconds(1024), now);
+      sub_bill.subjective_bill_failure(b, fc::microseconds(1024), now);
+      sub_bill.subjective_bill_failure(b, fc::microseconds(1024), halftime);
+      sub_bill.subjective_bill( id1, endtime + fc::seconds(1), c, fc::microseconds( 1024 ), false );
+      BOOST_CHECK_EQUAL( 3u, sub_bill.num_accounts() );
+
+      sub_bill.remove_expired( log, now, halftime, fc::time_point::maximum() );
+      BOOST_CHECK_EQUAL( 3u, sub_bill.num_accounts() );
+
+      sub_bill.remove_expired( log, now, endtime, fc::time_point::maximum() );
+      BOOST_CHECK_EQUAL( 2u, sub_bill.num_accounts() ); // b failed again at halftime, c is not expired
+      BOOST_CHECK_EQUAL( 0, sub_bill.get_subjective_bill(a, endtime) );
+      BOOST_CHECK_EQUAL( 768, sub_bill.get_subjective_bill(b, endtime) );
+      BOOST_CHECK_EQUAL( 1024, sub_bill.get_subjective_bill(c, endtime) );
+
+      sub_bill.remove_subjective_billing( id1, 0 );
+      BOOST_CHECK_EQUAL( 1u, sub_bill.num_accounts() );
+   }
 
 }
 
@@ -0,0 +1,62 @@
+#define BOOST_TEST_MODULE transaction_cost_model
+#include <boost/test/included/unit_test.hpp>
+
+#include <eosio/producer_plugin/transaction_cost_model.hpp>
+
+#include <eosio/testing/tester.hpp>
+
+namespace {
+
+using namespace eosio;
+using namespace eosio::chain;
+
+transaction make_transaction( std::initializer_list<std::pair<account_name, action_name>> acts ) {
+   transaction trx;
+   for( const auto& a : acts ) {
+      trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, a.first, a.second, bytes{} );
+   }
+   return trx;
+}
+
+BOOST_AUTO_TEST_SUITE( transaction_cost_model_test )
+
+BOOST_AUTO_TEST_CASE( estimate_test ) {
+   transaction_cost_model model;
+   const auto transfer = make_transaction( {{N(eosio.token), N(transfer)}} );
+   const auto issue = make_transaction( {{N(eosio.token), N(issue)}} );
+   const auto both = make_transaction( {{N(eosio.token), N(transfer)}, {N(eosio.token), N(issue)}} );
+
+   // not estimated until executed min_samples times
+   for( uint32_t i = 1; i < transaction_cost_model::min_samples; ++i ) {
+      model.add( transfer, fc::microseconds( 800 ) );
+      BOOST_CHECK( !model.estimate( transfer ) );
+   }
+   model.add( transfer, fc::microseconds( 800 ) );
+   BOOST_REQUIRE( model.estimate( transfer ) );
+   BOOST_CHECK_EQUAL( 800, model.estimate( transfer )->count() );
+
+   // every action has to be known
+   BOOST_CHECK( !model.estimate( issue ) );
+   BOOST_CHECK( !model.estimate( both ) );
+   BOOST_CHECK( !model.estimate( transaction() ) );
+
+   // the cpu of a transaction is shared between its actions
+   for( uint32_t i = 0; i < transaction_cost_model::min_samples; ++i ) {
+      model.add( make_transaction( {{N(eosio.token), N(issue)}, {N(eosio.token), N(issue)}} ), fc::microseconds( 400 ) );
+   }
+   BOOST_REQUIRE( model.estimate( issue ) );
+   BOOST_CHECK_EQUAL( 200, model.estimate( issue )->count() );
+   BOOST_CHECK_EQUAL( 1000, model.estimate( both )->count() );
+   BOOST_CHECK_EQUAL( 2u, model.size() );
+
+   // moves towards recent executions
+   for( int i = 0; i < 100; ++i ) {
+      model.add( transfer, fc::microseconds( 100 ) );
+   }
+   BOOST_CHECK_LT( model.estimate( transfer )->count(), 110 );
+   BOOST_CHECK_GE( model.estimate( transfer )->count(), 100 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
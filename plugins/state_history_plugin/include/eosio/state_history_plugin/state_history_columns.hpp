@@ -0,0 +1,55 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+
+namespace eosio {
+
+/**
+ * The actions of the transaction traces of a block in columns, written to trace_columns.log next to the trace history
+ * when trace-history-columns is set. Each column of an entry is compressed on its own, a scan or projection only
+ * decompresses the columns it uses. The payload of an entry is a std::vector<bytes> of the zlib compressed fc::raw
+ * packed columns, in the order of trace_column; columns added later are appended.
+ *
+ * Offsets are into the packed traces of the block, the decompressed entry of trace_history.log.
+ */
+enum class trace_column : uint8_t {
+   trx_offset,      ///< uint32_t per transaction trace, of the transaction trace
+   trx_size,        ///< uint32_t per transaction trace
+   action_trx,      ///< uint32_t per action trace, index of its transaction trace in the block
+   action_ordinal,  ///< uint32_t per action trace
+   receiver,        ///< name per action trace
+   account,         ///< name per action trace
+   name,            ///< name per action trace
+   auth_count,      ///< uint32_t per action trace, of its authorizations in auth_actor and auth_permission
+   auth_actor,      ///< name per authorization
+   auth_permission, ///< name per authorization
+   data_offset,     ///< uint32_t per action trace, of the action data
+   data_size,       ///< uint32_t per action trace
+};
+static constexpr size_t num_trace_columns = static_cast<size_t>(trace_column::data_size) + 1;
+
+struct trace_columns {
+   std::vector<uint32_t> trx_offset;
+   std::vector<uint32_t> trx_size;
+   std::vector<uint32_t> action_trx;
+   std::vector<uint32_t> action_ordinal;
+   std::vector<uint64_t> receiver;
+   std::vector<uint64_t> account;
+   std::vector<uint64_t> name;
+   std::vector<uint32_t> auth_count;
+   std::vector<uint64_t> auth_actor;
+   std::vector<uint64_t> auth_permission;
+   std::vector<uint32_t> data_offset;
+   std::vector<uint32_t> data_size;
+
+   /// the columns of the packed traces of a block
+   static trace_columns from_traces(const chain::bytes& traces);
+
+   /// @return the payload of the entry of these columns, compressed at level
+   chain::bytes pack(int level) const;
+
+   /// @return the requested columns of the payload of an entry, the others are left empty
+   static trace_columns unpack(const chain::bytes& payload, const std::vector<trace_column>& columns);
+};
+
+} // namespace eosio
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/types.hpp>
+
+#include <zlib.h>
+
+namespace eosio {
+
+/// @param dictionary preset dictionary, the result can only be decompressed with it
+inline chain::bytes zlib_compress_bytes(const chain::bytes& in, int level, const chain::bytes* dictionary) {
+   z_stream zs = {};
+   EOS_ASSERT(deflateInit(&zs, level) == Z_OK, chain::plugin_exception, "unable to initialize zlib compression");
+   if (dictionary)
+      deflateSetDictionary(&zs, (const Bytef*)dictionary->data(), dictionary->size());
+   chain::bytes out(deflateBound(&zs, in.size()) + 16);
+   zs.next_in   = (Bytef*)in.data();
+   zs.avail_in  = in.size();
+   zs.next_out  = (Bytef*)out.data();
+   zs.avail_out = out.size();
+   auto r       = deflate(&zs, Z_FINISH);
+   deflateEnd(&zs);
+   EOS_ASSERT(r == Z_STREAM_END, chain::plugin_exception, "zlib compression failed: ${r}", ("r", r));
+   out.resize(zs.total_out);
+   return out;
+}
+
+inline chain::bytes zlib_decompress(const chain::bytes& in, const chain::bytes* dictionary) {
+   z_stream zs = {};
+   EOS_ASSERT(inflateInit(&zs) == Z_OK, chain::plugin_exception, "unable to initialize zlib decompression");
+   chain::bytes out(std::max<size_t>(in.size() * 4, 1024));
+   zs.next_in  = (Bytef*)in.data();
+   zs.avail_in = in.size();
+   int r       = Z_OK;
+   while (r != Z_STREAM_END) {
+      if (zs.total_out == out.size())
+         out.resize(out.size() * 2);
+      zs.next_out  = (Bytef*)out.data() + zs.total_out;
+      zs.avail_out = out.size() - zs.total_out;
+      r            = inflate(&zs, Z_NO_FLUSH);
+      if (r == Z_NEED_DICT && dictionary)
+         r = inflateSetDictionary(&zs, (const Bytef*)dictionary->data(), dictionary->size());
+      if (r != Z_OK && r != Z_STREAM_END && !(r == Z_BUF_ERROR && zs.avail_out == 0)) {
+         inflateEnd(&zs);
+         EOS_ASSERT(r != Z_NEED_DICT, chain::plugin_exception, "missing the preset dictionary of a state history entry");
+         EOS_THROW(chain::plugin_exception, "zlib decompression failed: ${r}", ("r", r));
+      }
+   }
+   inflateEnd(&zs);
+   out.resize(zs.total_out);
+   return out;
+}
+
+/// @param payload of the entry of block_num, the size of the compressed bytes followed by them
+/// @return the packed traces or deltas
+inline chain::bytes unpack_entry_payload(const chain::bytes& payload, uint32_t block_num, const chain::bytes* dictionary) {
+   uint32_t s = 0;
+   EOS_ASSERT(payload.size() >= sizeof(s), chain::plugin_exception, "corrupt entry of block ${b}", ("b", block_num));
+   memcpy(&s, payload.data(), sizeof(s));
+   EOS_ASSERT(payload.size() - sizeof(s) >= s, chain::plugin_exception, "corrupt entry of block ${b}", ("b", block_num));
+   return zlib_decompress(chain::bytes(payload.begin() + sizeof(s), payload.begin() + sizeof(s) + s), dictionary);
+}
+
+} // namespace eosio
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <eosio/state_history_plugin/state_history_columns.hpp>
+#include <eosio/state_history_plugin/state_history_plugin.hpp>
+
+namespace eosio {
+
+/// @param deltas packed std::vector<table_delta> of a block
+/// @return deltas without the rows filter does not match, and without the tables left empty
+bytes filter_deltas(const bytes& deltas, const blocks_filter& filter);
+
+/// @param traces packed transaction traces of a block
+/// @return traces without the transactions none of whose actions filter matches
+bytes filter_traces(const bytes& traces, const blocks_filter& filter);
+
+/// as filter_traces, matching the actions by the account and name columns of the traces instead of parsing them
+/// @param columns of traces, with at least trx_offset, trx_size, action_trx, account and name
+bytes filter_traces(const bytes& traces, const trace_columns& columns, const blocks_filter& filter);
+
+} // namespace eosio
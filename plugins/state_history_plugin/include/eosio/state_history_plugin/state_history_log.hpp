@@ -4,10 +4,23 @@
 #include <fstream>
 #include <stdint.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include <eosio/chain/block_header.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/types.hpp>
 #include <fc/log/logger.hpp>
+#include <fc/filesystem.hpp>
 #include <fc/io/cfile.hpp>
 
 namespace eosio {
@@ -26,13 +39,23 @@ namespace eosio {
  * each entry:
  *    state_history_log_header
  *    payload
+ *
+ * The payload of a version 0 entry is zlib compressed, that of a version 1 entry is zlib compressed with the preset
+ * dictionary of its log.
+ *
+ * Writes, and the get_entry reads used by them, go through buffered files. Readers use read_entry and
+ * read_block_id, which read with pread from descriptors of their own and so may run concurrently with each other,
+ * but not with a write. The indexes are read through read only mappings, and the ids of the last written blocks are
+ * kept in memory, so read_block_id of a recent block does not read the files at all.
+ *
+ * With a stride the log is split into retained segments, see state_history_log_config.
  */
 
 inline uint64_t       ship_magic(uint32_t version) { return N(ship).to_uint64_t() | version; }
 inline bool           is_ship(uint64_t magic) { return (magic & 0xffff'ffff'0000'0000) == N(ship).to_uint64_t(); }
 inline uint32_t       get_ship_version(uint64_t magic) { return magic; }
-inline bool           is_ship_supported_version(uint64_t magic) { return get_ship_version(magic) == 0; }
-static const uint32_t ship_current_version = 0;
+static const uint32_t ship_current_version = 1;
+inline bool           is_ship_supported_version(uint64_t magic) { return get_ship_version(magic) <= ship_current_version; }
 
 struct state_history_log_header {
    uint64_t             magic        = ship_magic(ship_current_version);
@@ -43,28 +66,97 @@ static const int state_history_log_header_serial_size = sizeof(state_history_log
                                                         sizeof(state_history_log_header::block_id) +
                                                         sizeof(state_history_log_header::payload_size);
 
+/**
+ * When stride is set the log is split into segments ending at multiples of stride. Once the last block of a segment
+ * is irreversible, its entries are moved to retained_dir as <name>-<first>-<last>.log and <name>-<first>-<last>.index
+ * and the log restarts with the entries after it. Only the newest max_retained_files segments are kept, older ones
+ * are moved to archive_dir or deleted if archive_dir is empty. Retained segments are still read by read_entry and
+ * read_block_id, so retained_dir may be on cheaper storage.
+ */
+struct state_history_log_config {
+   uint32_t                stride             = 0; ///< blocks per segment, 0 keeps a single ever-growing log
+   uint32_t                max_retained_files = std::numeric_limits<uint32_t>::max();
+   boost::filesystem::path retained_dir;           ///< required with a stride
+   boost::filesystem::path archive_dir;
+   bool                    read_only = false; ///< for tools, the log is neither recovered, split nor pruned
+};
+
 class state_history_log {
  private:
-   const char* const    name = "";
-   std::string          log_filename;
-   std::string          index_filename;
-   fc::cfile            log;
-   fc::cfile            index;
-   uint32_t             _begin_block = 0;
-   uint32_t             _end_block   = 0;
-   chain::block_id_type last_block_id;
+   /// a segment split off into the retained directory, read only
+   struct retained_segment {
+      uint32_t    begin_block = 0;
+      uint32_t    end_block   = 0;
+      std::string log_filename;
+      std::string index_filename;
+      int         log_fd   = -1;
+      int         index_fd = -1;
+      const char* index_map = nullptr; ///< the whole index, null if it could not be mapped
+      size_t      index_map_size = 0;
+   };
+
+   /// descriptors of the log or segment holding a block
+   struct read_files {
+      int         log_fd      = -1;
+      int         index_fd    = -1;
+      const char* index_map   = nullptr;
+      uint32_t    begin_block = 0;
+      uint32_t    end_block   = 0;
+   };
+
+   static constexpr size_t   index_map_chunk  = 64 * 1024 * 1024; ///< the index of the log is mapped in multiples of it
+   static constexpr uint32_t num_recent_ids   = 1024;
+
+   struct recent_id {
+      uint32_t             block_num = 0;
+      chain::block_id_type id;
+   };
+
+   const char* const             name = "";
+   std::string                   log_filename;
+   std::string                   index_filename;
+   state_history_log_config      config;
+   fc::cfile                     log;
+   fc::cfile                     index;
+   uint32_t                      _begin_block = 0;
+   uint32_t                      _end_block   = 0;
+   chain::block_id_type          last_block_id;
+   int                           log_fd   = -1; ///< for pread
+   int                           index_fd = -1;
+   const char*                   index_map = nullptr; ///< of index_fd, may extend past the end of the index
+   size_t                        index_map_size = 0;
+   std::vector<retained_segment> retained; ///< oldest first, without gaps up to _begin_block
+   std::vector<recent_id>        recent_ids = std::vector<recent_id>(num_recent_ids); ///< by block_num % num_recent_ids
 
  public:
-   state_history_log(const char* const name, std::string log_filename, std::string index_filename)
+   state_history_log(const char* const name, std::string log_filename, std::string index_filename,
+                     state_history_log_config config = {})
        : name(name)
        , log_filename(std::move(log_filename))
-       , index_filename(std::move(index_filename)) {
+       , index_filename(std::move(index_filename))
+       , config(std::move(config)) {
       open_log();
       open_index();
+      open_read_fds();
+      load_retained();
+      if (!this->config.read_only)
+         prune_retained();
    }
 
-   uint32_t begin_block() const { return _begin_block; }
-   uint32_t end_block() const { return _end_block; }
+   ~state_history_log() {
+      close_read_fds();
+      for (auto& segment : retained)
+         close_segment(segment);
+   }
+
+   state_history_log(const state_history_log&) = delete;
+   state_history_log& operator=(const state_history_log&) = delete;
+
+   /// retained segments included
+   uint32_t begin_block() const { return retained.empty() ? _begin_block : retained.front().begin_block; }
+   uint32_t end_block() const {
+      return _begin_block != _end_block || retained.empty() ? _end_block : retained.back().end_block;
+   }
 
    void read_header(state_history_log_header& header, bool assert_version = true) {
       char bytes[state_history_log_header_serial_size];
@@ -103,6 +195,8 @@ class state_history_log {
          }
       }
 
+      EOS_ASSERT(retained.empty() || block_num >= retained.back().end_block, chain::plugin_exception,
+                 "fork change in retained segment of ${name}.log", ("name", name));
       if (block_num < _end_block)
          truncate(block_num);
       log.seek_end(0);
@@ -120,6 +214,11 @@ class state_history_log {
          _begin_block = block_num;
       _end_block    = block_num + 1;
       last_block_id = header.block_id;
+      recent_ids[block_num % num_recent_ids] = {block_num, header.block_id};
+      // visible to pread and the mapping
+      log.flush();
+      index.flush();
+      map_index();
    }
 
    // returns cfile positioned at payload
@@ -131,12 +230,51 @@ class state_history_log {
       return log;
    }
 
-   chain::block_id_type get_block_id(uint32_t block_num) {
+   chain::block_id_type get_block_id(uint32_t block_num) { return read_block_id(block_num); }
+
+   /// header and payload of the entry of block_num
+   void read_entry(uint32_t block_num, state_history_log_header& header, chain::bytes& payload) const {
+      auto     files = files_of(block_num);
+      uint64_t pos   = read_header_at(files, block_num, header);
+      payload.resize(header.payload_size);
+      pread_all(files.log_fd, payload.data(), payload.size(), pos + state_history_log_header_serial_size);
+   }
+
+   chain::block_id_type read_block_id(uint32_t block_num) const {
+      const auto& recent = recent_ids[block_num % num_recent_ids];
+      if (recent.block_num == block_num && block_num >= begin_block() && block_num < end_block())
+         return recent.id;
       state_history_log_header header;
-      get_entry(block_num, header);
+      read_header_at(files_of(block_num), block_num, header);
       return header.block_id;
    }
 
+   /// hint the kernel to read the entries of up to count blocks from block_num ahead of their use, within its segment
+   void read_ahead(uint32_t block_num, uint32_t count) const {
+#ifdef POSIX_FADV_WILLNEED
+      if (block_num < begin_block() || block_num >= end_block() || !count)
+         return;
+      auto     files = files_of(block_num);
+      uint64_t begin = read_pos(files, block_num);
+      uint64_t end   = 0;
+      if (block_num + count < files.end_block)
+         end = read_pos(files, block_num + count);
+      posix_fadvise(files.log_fd, begin, end ? end - begin : 0, POSIX_FADV_WILLNEED);
+#endif
+   }
+
+   /// split off the segments whose last block is at most irreversible_block, see state_history_log_config
+   void split(uint32_t irreversible_block) {
+      if (!config.stride || config.read_only)
+         return;
+      while (_begin_block != _end_block) {
+         uint32_t last = (_begin_block / config.stride + 1) * config.stride;
+         if (last >= _end_block || last > irreversible_block)
+            return;
+         split_at(last + 1);
+      }
+   }
+
  private:
    bool get_last_block(uint64_t size) {
       state_history_log_header header;
@@ -198,7 +336,8 @@ class state_history_log {
 
    void open_log() {
       log.set_file_path( log_filename );
-      log.open( "a+b" ); // std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::app
+      // std::ios_base::binary | std::ios_base::in, and | std::ios_base::out | std::ios_base::app unless read only
+      log.open( config.read_only ? "rb" : "a+b" );
       log.seek_end(0);
       uint64_t size = log.tellp();
       if (size >= state_history_log_header_serial_size) {
@@ -210,8 +349,11 @@ class state_history_log {
                     chain::plugin_exception, "corrupt ${name}.log (1)", ("name", name));
          _begin_block  = chain::block_header::num_from_id(header.block_id);
          last_block_id = header.block_id;
-         if (!get_last_block(size))
+         if (!get_last_block(size)) {
+            EOS_ASSERT(!config.read_only, chain::plugin_exception,
+                       "${name}.log needs to be recovered, which it is not when read only", ("name", name));
             recover_blocks(size);
+         }
          ilog("${name}.log has blocks ${b}-${e}", ("name", name)("b", _begin_block)("e", _end_block - 1));
       } else {
          EOS_ASSERT(!size, chain::plugin_exception, "corrupt ${name}.log (5)", ("name", name));
@@ -221,10 +363,13 @@ class state_history_log {
 
    void open_index() {
       index.set_file_path( index_filename );
-      index.open( "a+b" ); // std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::app
+      // std::ios_base::binary | std::ios_base::in, and | std::ios_base::out | std::ios_base::app unless read only
+      index.open( config.read_only ? "rb" : "a+b" );
       index.seek_end(0);
       if (index.tellp() == (static_cast<int>(_end_block) - _begin_block) * sizeof(uint64_t))
          return;
+      EOS_ASSERT(!config.read_only, chain::plugin_exception,
+                 "${name}.index needs to be regenerated, which it is not when read only", ("name", name));
       ilog("Regenerate ${name}.index", ("name", name));
       index.close();
       index.open( "w+b" ); // std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::trunc
@@ -259,6 +404,74 @@ class state_history_log {
       }
    }
 
+   void pread_all(int fd, char* data, size_t size, uint64_t pos) const {
+      while (size) {
+         auto r = ::pread(fd, data, size, pos);
+         if (r < 0 && errno == EINTR)
+            continue;
+         EOS_ASSERT(r > 0, chain::plugin_exception, "unable to read ${name}.log: ${e}",
+                    ("name", name)("e", r < 0 ? strerror(errno) : "unexpected end of file"));
+         data += r;
+         size -= r;
+         pos += r;
+      }
+   }
+
+   read_files files_of(uint32_t block_num) const {
+      EOS_ASSERT(block_num >= begin_block() && block_num < end_block(), chain::plugin_exception,
+                 "read non-existing block in ${name}.log", ("name", name));
+      if (_begin_block != _end_block && block_num >= _begin_block)
+         return {log_fd, index_fd, index_map, _begin_block, _end_block};
+      auto it = std::upper_bound(retained.begin(), retained.end(), block_num,
+                                 [](uint32_t b, const retained_segment& segment) { return b < segment.end_block; });
+      return {it->log_fd, it->index_fd, it->index_map, it->begin_block, it->end_block};
+   }
+
+   uint64_t read_pos(const read_files& files, uint32_t block_num) const {
+      uint64_t pos;
+      uint64_t offset = uint64_t(block_num - files.begin_block) * sizeof(pos);
+      if (files.index_map)
+         memcpy(&pos, files.index_map + offset, sizeof(pos));
+      else
+         pread_all(files.index_fd, (char*)&pos, sizeof(pos), offset);
+      return pos;
+   }
+
+   /// maps the index of the log if it outgrew its mapping, it is read with pread if it can not be mapped
+   void map_index() {
+      uint64_t size = uint64_t(_end_block - _begin_block) * sizeof(uint64_t);
+      if (index_map && size <= index_map_size)
+         return;
+      unmap_index();
+      size_t map_size = (size / index_map_chunk + 1) * index_map_chunk;
+      void*  p        = ::mmap(nullptr, map_size, PROT_READ, MAP_SHARED, index_fd, 0);
+      if (p == MAP_FAILED) {
+         wlog("unable to map ${name}.index: ${e}", ("name", name)("e", strerror(errno)));
+         return;
+      }
+      index_map      = static_cast<const char*>(p);
+      index_map_size = map_size;
+   }
+
+   void unmap_index() {
+      if (index_map)
+         ::munmap(const_cast<char*>(index_map), index_map_size);
+      index_map      = nullptr;
+      index_map_size = 0;
+   }
+
+   /// @return position of the entry of block_num
+   uint64_t read_header_at(const read_files& files, uint32_t block_num, state_history_log_header& header) const {
+      uint64_t pos = read_pos(files, block_num);
+      char     bytes[state_history_log_header_serial_size];
+      pread_all(files.log_fd, bytes, sizeof(bytes), pos);
+      fc::datastream<const char*> ds(bytes, sizeof(bytes));
+      fc::raw::unpack(ds, header);
+      EOS_ASSERT(is_ship(header.magic) && is_ship_supported_version(header.magic), chain::plugin_exception,
+                 "corrupt ${name}.log (0)", ("name", name));
+      return pos;
+   }
+
    uint64_t get_pos(uint32_t block_num) {
       uint64_t pos;
       index.seek((block_num - _begin_block) * sizeof(pos));
@@ -266,6 +479,166 @@ class state_history_log {
       return pos;
    }
 
+   void open_read_fds() {
+      log_fd   = ::open(log_filename.c_str(), O_RDONLY | O_CLOEXEC);
+      index_fd = ::open(index_filename.c_str(), O_RDONLY | O_CLOEXEC);
+      EOS_ASSERT(log_fd >= 0 && index_fd >= 0, chain::plugin_exception, "unable to open ${name}.log for reading: ${e}",
+                 ("name", name)("e", strerror(errno)));
+      map_index();
+   }
+
+   void close_read_fds() {
+      unmap_index();
+      if (log_fd >= 0)
+         ::close(log_fd);
+      if (index_fd >= 0)
+         ::close(index_fd);
+      log_fd = index_fd = -1;
+   }
+
+   static void close_segment(retained_segment& segment) {
+      if (segment.index_map)
+         ::munmap(const_cast<char*>(segment.index_map), segment.index_map_size);
+      segment.index_map      = nullptr;
+      segment.index_map_size = 0;
+      if (segment.log_fd >= 0)
+         ::close(segment.log_fd);
+      if (segment.index_fd >= 0)
+         ::close(segment.index_fd);
+      segment.log_fd = segment.index_fd = -1;
+   }
+
+   void open_segment(retained_segment& segment) {
+      segment.log_fd   = ::open(segment.log_filename.c_str(), O_RDONLY | O_CLOEXEC);
+      segment.index_fd = ::open(segment.index_filename.c_str(), O_RDONLY | O_CLOEXEC);
+      if (segment.log_fd < 0 || segment.index_fd < 0) {
+         auto e = strerror(errno);
+         close_segment(segment);
+         EOS_THROW(chain::plugin_exception, "unable to open ${f} for reading: ${e}", ("f", segment.log_filename)("e", e));
+      }
+      size_t size = uint64_t(segment.end_block - segment.begin_block) * sizeof(uint64_t);
+      void*  p    = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, segment.index_fd, 0);
+      if (p != MAP_FAILED) {
+         segment.index_map      = static_cast<const char*>(p);
+         segment.index_map_size = size;
+      }
+   }
+
+   void load_retained() {
+      if (!config.stride && (config.retained_dir.empty() || !boost::filesystem::is_directory(config.retained_dir)))
+         return;
+      EOS_ASSERT(!config.retained_dir.empty(), chain::plugin_exception, "${name}.log has a stride without a retained dir",
+                 ("name", name));
+      if (!boost::filesystem::is_directory(config.retained_dir)) {
+         if (config.read_only)
+            return;
+         boost::filesystem::create_directories(config.retained_dir);
+      }
+
+      std::map<uint32_t, retained_segment> found; ///< keyed by end block
+      const std::string                    format = std::string(name) + "-%u-%u%c";
+      for (boost::filesystem::directory_iterator enditr, itr{config.retained_dir}; itr != enditr; ++itr) {
+         const auto& p     = itr->path();
+         uint32_t    first = 0, last = 0;
+         char        tail  = 0;
+         if (p.extension() != ".log" || sscanf(p.stem().generic_string().c_str(), format.c_str(), &first, &last, &tail) != 2 ||
+             first > last)
+            continue;
+         auto index_name = p;
+         index_name.replace_extension(".index");
+         if (!boost::filesystem::is_regular_file(index_name) ||
+             boost::filesystem::file_size(index_name) != uint64_t(last - first + 1) * sizeof(uint64_t)) {
+            wlog("Ignoring retained ${f} without a matching index", ("f", p.generic_string()));
+            continue;
+         }
+         found[last + 1] = retained_segment{first, last + 1, p.generic_string(), index_name.generic_string()};
+      }
+      if (found.empty())
+         return;
+
+      // only segments that reach the log without gaps can be served, or the newest ones if the log is empty
+      uint32_t next = _begin_block != _end_block ? _begin_block : found.rbegin()->first;
+      std::vector<retained_segment> segments;
+      for (auto itr = found.find(next); itr != found.end(); itr = found.find(next)) {
+         next = itr->second.begin_block;
+         segments.push_back(itr->second);
+      }
+      std::reverse(segments.begin(), segments.end());
+      for (auto& segment : segments) {
+         open_segment(segment);
+         retained.push_back(segment);
+      }
+      if (!retained.empty())
+         ilog("retained ${name} segments have blocks ${b}-${e}",
+              ("name", name)("b", retained.front().begin_block)("e", retained.back().end_block - 1));
+   }
+
+   void prune_retained() {
+      while (retained.size() > config.max_retained_files) {
+         auto segment = retained.front();
+         close_segment(segment);
+         retained.erase(retained.begin());
+         auto index_name = boost::filesystem::path(segment.index_filename);
+         auto log_name   = boost::filesystem::path(segment.log_filename);
+         if (config.archive_dir.empty()) {
+            fc::remove(log_name);
+            fc::remove(index_name);
+            ilog("Removed retained ${f}", ("f", segment.log_filename));
+         } else {
+            if (!boost::filesystem::is_directory(config.archive_dir))
+               boost::filesystem::create_directories(config.archive_dir);
+            fc::rename(log_name, config.archive_dir / log_name.filename());
+            fc::rename(index_name, config.archive_dir / index_name.filename());
+            ilog("Moved retained ${f} to ${dir}", ("f", segment.log_filename)("dir", config.archive_dir.generic_string()));
+         }
+      }
+   }
+
+   /// moves the entries before block_num to a retained segment, those after it stay in the log
+   void split_at(uint32_t block_num) {
+      // the entries after the segment are reversible, they are written again to the new log
+      std::vector<std::pair<state_history_log_header, chain::bytes>> moved(_end_block - block_num);
+      for (uint32_t b = block_num; b < _end_block; ++b)
+         read_entry(b, moved[b - block_num].first, moved[b - block_num].second);
+      chain::block_id_type prev_id = get_block_id(block_num - 1);
+
+      const std::string prefix = std::string(name) + "-" + std::to_string(_begin_block) + "-" + std::to_string(block_num - 1);
+      retained_segment segment{_begin_block, block_num, (config.retained_dir / (prefix + ".log")).generic_string(),
+                               (config.retained_dir / (prefix + ".index")).generic_string()};
+      log.flush();
+      index.flush();
+      if (block_num < _end_block)
+         truncate_files(block_num);
+      log.close();
+      index.close();
+      close_read_fds();
+      fc::rename(log_filename, segment.log_filename);
+      fc::rename(index_filename, segment.index_filename);
+      open_segment(segment);
+      retained.push_back(segment);
+      ilog("split ${name}.log, blocks ${b}-${e} moved to ${f}",
+           ("name", name)("b", segment.begin_block)("e", segment.end_block - 1)("f", segment.log_filename));
+
+      _begin_block = _end_block = 0;
+      open_log();
+      open_index();
+      open_read_fds();
+      for (auto& entry : moved) {
+         write_entry(entry.first, prev_id, [&](auto& stream) { stream.write(entry.second.data(), entry.second.size()); });
+         prev_id = entry.first.block_id;
+      }
+      prune_retained();
+   }
+
+   void truncate_files(uint32_t block_num) {
+      uint64_t pos = get_pos(block_num);
+      log.seek(0);
+      index.seek(0);
+      boost::filesystem::resize_file(log_filename, pos);
+      boost::filesystem::resize_file(index_filename, (block_num - _begin_block) * sizeof(uint64_t));
+      _end_block = block_num;
+   }
+
    void truncate(uint32_t block_num) {
       log.flush();
       index.flush();
@@ -278,13 +651,8 @@ class state_history_log {
          boost::filesystem::resize_file(index_filename, 0);
          _begin_block = _end_block = 0;
       } else {
-         num_removed  = _end_block - block_num;
-         uint64_t pos = get_pos(block_num);
-         log.seek(0);
-         index.seek(0);
-         boost::filesystem::resize_file(log_filename, pos);
-         boost::filesystem::resize_file(index_filename, (block_num - _begin_block) * sizeof(uint64_t));
-         _end_block = block_num;
+         num_removed = _end_block - block_num;
+         truncate_files(block_num);
       }
       log.flush();
       index.flush();
@@ -1,6 +1,8 @@
 #pragma once
 #include <appbase/application.hpp>
 
+#include <algorithm>
+
 #include <eosio/chain_plugin/chain_plugin.hpp>
 
 template <typename T>
@@ -98,6 +100,35 @@ struct get_blocks_request_v0 {
    bool                        fetch_deltas           = false;
 };
 
+/// matches a name if it is in include, or include is empty, and is not in exclude
+struct name_filter {
+   std::vector<chain::name> include = {};
+   std::vector<chain::name> exclude = {};
+
+   bool empty() const { return include.empty() && exclude.empty(); }
+   bool match(chain::name n) const {
+      return (include.empty() || std::find(include.begin(), include.end(), n) != include.end()) &&
+             std::find(exclude.begin(), exclude.end(), n) == exclude.end();
+   }
+};
+
+/// rows of contract tables are kept if their code, table and scope match, transaction traces if one of their actions
+/// matches by account and name. Other tables are dropped once contracts, tables or scopes are filtered.
+struct blocks_filter {
+   name_filter contracts = {};
+   name_filter tables    = {};
+   name_filter scopes    = {};
+   name_filter actions   = {};
+
+   bool empty() const { return contracts.empty() && tables.empty() && scopes.empty() && actions.empty(); }
+   bool filters_deltas() const { return !contracts.empty() || !tables.empty() || !scopes.empty(); }
+   bool filters_traces() const { return !contracts.empty() || !actions.empty(); }
+};
+
+struct get_blocks_request_v1 : get_blocks_request_v0 {
+   blocks_filter filter = {};
+};
+
 struct get_blocks_ack_request_v0 {
    uint32_t num_messages = 0;
 };
@@ -112,7 +143,8 @@ struct get_blocks_result_v0 {
    fc::optional<bytes>          deltas;
 };
 
-using state_request = fc::static_variant<get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0>;
+using state_request = fc::static_variant<get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0,
+                                         get_blocks_request_v1>;
 using state_result  = fc::static_variant<get_status_result_v0, get_blocks_result_v0>;
 
 class state_history_plugin : public plugin<state_history_plugin> {
@@ -140,5 +172,8 @@ FC_REFLECT(eosio::block_position, (block_num)(block_id));
 FC_REFLECT_EMPTY(eosio::get_status_request_v0);
 FC_REFLECT(eosio::get_status_result_v0, (head)(last_irreversible)(trace_begin_block)(trace_end_block)(chain_state_begin_block)(chain_state_end_block));
 FC_REFLECT(eosio::get_blocks_request_v0, (start_block_num)(end_block_num)(max_messages_in_flight)(have_positions)(irreversible_only)(fetch_block)(fetch_traces)(fetch_deltas));
+FC_REFLECT(eosio::name_filter, (include)(exclude));
+FC_REFLECT(eosio::blocks_filter, (contracts)(tables)(scopes)(actions));
+FC_REFLECT_DERIVED(eosio::get_blocks_request_v1, (eosio::get_blocks_request_v0), (filter));
 FC_REFLECT(eosio::get_blocks_ack_request_v0, (num_messages));
 // clang-format on
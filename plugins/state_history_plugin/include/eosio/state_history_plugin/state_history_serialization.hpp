@@ -186,6 +186,16 @@ operator<<(datastream<ST>&
    return ds;
 }
 
+template <typename ST>
+datastream<ST>& operator<<(datastream<ST>& ds, const history_serial_wrapper<eosio::chain::kv_object>& obj) {
+   fc::raw::pack(ds, fc::unsigned_int(0));
+   fc::raw::pack(ds, as_type<uint64_t>(obj.obj.contract.to_uint64_t()));
+   fc::raw::pack(ds, as_type<eosio::chain::shared_string>(obj.obj.kv_key));
+   fc::raw::pack(ds, as_type<uint64_t>(obj.obj.payer.to_uint64_t()));
+   fc::raw::pack(ds, as_type<eosio::chain::shared_string>(obj.obj.kv_value));
+   return ds;
+}
+
 template <typename ST, typename T>
 void serialize_secondary_index_data(datastream<ST>& ds, const T& obj) {
    fc::raw::pack(ds, obj);
@@ -549,6 +559,16 @@ datastream<ST>& operator<<(datastream<ST>& ds, const history_serial_wrapper<eosi
    return ds;
 }
 
+template <typename ST>
+datastream<ST>& operator<<(datastream<ST>& ds, const history_serial_wrapper<eosio::chain::row_access>& obj) {
+   fc::raw::pack(ds, as_type<uint64_t>(obj.obj.code.to_uint64_t()));
+   fc::raw::pack(ds, as_type<uint64_t>(obj.obj.scope.to_uint64_t()));
+   fc::raw::pack(ds, as_type<uint64_t>(obj.obj.table.to_uint64_t()));
+   fc::raw::pack(ds, as_type<uint64_t>(obj.obj.primary_key));
+   fc::raw::pack(ds, as_type<bool>(obj.obj.write));
+   return ds;
+}
+
 inline fc::optional<uint64_t> cap_error_code( const fc::optional<uint64_t>& error_code ) {
    fc::optional<uint64_t> result;
 
@@ -568,7 +588,9 @@ inline fc::optional<uint64_t> cap_error_code( const fc::optional<uint64_t>& erro
 template <typename ST>
 datastream<ST>& operator<<(datastream<ST>& ds, const history_context_wrapper<bool, eosio::chain::action_trace>& obj) {
    bool  debug_mode = obj.context;
-   fc::raw::pack(ds, fc::unsigned_int(0));
+   // action_trace_v1 only for the traces of a node tracing row accesses, so that other clients keep reading v0
+   bool  with_row_accesses = !obj.obj.row_accesses.empty();
+   fc::raw::pack(ds, fc::unsigned_int(with_row_accesses ? 1 : 0));
    fc::raw::pack(ds, as_type<fc::unsigned_int>(obj.obj.action_ordinal));
    fc::raw::pack(ds, as_type<fc::unsigned_int>(obj.obj.creator_action_ordinal));
    fc::raw::pack(ds, bool(obj.obj.receipt));
@@ -595,6 +617,8 @@ datastream<ST>& operator<<(datastream<ST>& ds, const history_context_wrapper<boo
    fc::raw::pack(ds, as_type<fc::optional<std::string>>(e));
    fc::raw::pack(ds, as_type<fc::optional<uint64_t>>(debug_mode ? obj.obj.error_code
                                                                 : cap_error_code(obj.obj.error_code)));
+   if (with_row_accesses)
+      history_serialize_container(ds, obj.db, as_type<std::vector<eosio::chain::row_access>>(obj.obj.row_accesses));
 
    return ds;
 }
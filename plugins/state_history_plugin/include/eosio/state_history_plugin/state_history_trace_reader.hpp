@@ -0,0 +1,135 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+#include <fc/io/raw.hpp>
+
+namespace eosio {
+
+/// reading fields of the entries of the history logs without unpacking them into structs
+namespace raw_reader {
+using input_stream = fc::datastream<const char*>;
+
+template <typename T>
+void skip(input_stream& ds) {
+   T v;
+   fc::raw::unpack(ds, v);
+}
+
+template <typename T>
+T read(input_stream& ds) {
+   T v;
+   fc::raw::unpack(ds, v);
+   return v;
+}
+} // namespace raw_reader
+
+/**
+ * Reads the transaction traces of a trace history entry as packed by state_history_plugin, transaction_trace_v0 and
+ * action_trace_v0, calling on_action for each action trace. The actions of a failed deferred transaction trace are
+ * reported as those of the transaction trace that contains it.
+ */
+struct trace_reader {
+   using input_stream = raw_reader::input_stream;
+
+   struct action_info {
+      uint32_t                                      action_ordinal = 0;
+      chain::name                                   receiver;
+      chain::name                                   account;
+      chain::name                                   name;
+      std::vector<std::pair<uint64_t, uint64_t>>    authorization; ///< actor and permission
+      uint32_t                                      data_offset = 0; ///< of the action data in the entry
+      uint32_t                                      data_size   = 0;
+   };
+
+   template <typename T>
+   static void skip(input_stream& ds) { raw_reader::skip<T>(ds); }
+
+   template <typename T>
+   static T read(input_stream& ds) { return raw_reader::read<T>(ds); }
+
+   using name_pairs = std::vector<std::pair<uint64_t, uint64_t>>;
+
+   const char* entry_begin = nullptr;
+
+   template <typename F>
+   void read_action_trace(input_stream& ds, F& on_action) const {
+      action_info info;
+      skip<fc::unsigned_int>(ds); // variant
+      info.action_ordinal = read<fc::unsigned_int>(ds).value;
+      skip<fc::unsigned_int>(ds); // creator_action_ordinal
+      if (read<bool>(ds)) {       // receipt
+         skip<fc::unsigned_int>(ds);
+         skip<uint64_t>(ds);      // receiver
+         skip<chain::digest_type>(ds);
+         skip<uint64_t>(ds);      // global_sequence
+         skip<uint64_t>(ds);      // recv_sequence
+         skip<name_pairs>(ds);    // auth_sequence
+         skip<fc::unsigned_int>(ds);
+         skip<fc::unsigned_int>(ds);
+      }
+      info.receiver      = chain::name{read<uint64_t>(ds)};
+      info.account       = chain::name{read<uint64_t>(ds)};
+      info.name          = chain::name{read<uint64_t>(ds)};
+      info.authorization = read<name_pairs>(ds);
+      uint32_t size      = read<fc::unsigned_int>(ds).value;
+      info.data_offset   = ds.pos() - entry_begin;
+      info.data_size     = size;
+      ds.skip(size);
+      skip<bool>(ds);             // context_free
+      skip<int64_t>(ds);          // elapsed
+      skip<std::string>(ds);      // console
+      skip<std::vector<std::pair<uint64_t, int64_t>>>(ds);
+      skip<fc::optional<std::string>>(ds);
+      skip<fc::optional<uint64_t>>(ds);
+      on_action(info);
+   }
+
+   template <typename F>
+   void read_transaction_trace(input_stream& ds, F& on_action) const {
+      skip<fc::unsigned_int>(ds); // variant
+      skip<chain::transaction_id_type>(ds);
+      skip<uint8_t>(ds);          // status
+      skip<uint32_t>(ds);         // cpu_usage_us
+      skip<fc::unsigned_int>(ds); // net_usage_words
+      skip<int64_t>(ds);          // elapsed
+      skip<uint64_t>(ds);         // net_usage
+      skip<bool>(ds);             // scheduled
+      for (uint32_t n = read<fc::unsigned_int>(ds).value; n; --n)
+         read_action_trace(ds, on_action);
+      if (read<bool>(ds))         // account_ram_delta
+         skip<std::pair<uint64_t, int64_t>>(ds);
+      skip<fc::optional<std::string>>(ds);
+      skip<fc::optional<uint64_t>>(ds);
+      if (read<bool>(ds))         // failed_dtrx_trace
+         read_transaction_trace(ds, on_action);
+      if (read<bool>(ds)) {       // partial
+         skip<fc::unsigned_int>(ds);
+         skip<uint32_t>(ds);      // expiration
+         skip<uint16_t>(ds);      // ref_block_num
+         skip<uint32_t>(ds);      // ref_block_prefix
+         skip<fc::unsigned_int>(ds);
+         skip<uint8_t>(ds);       // max_cpu_usage_ms
+         skip<fc::unsigned_int>(ds);
+         skip<chain::extensions_type>(ds);
+         skip<std::vector<chain::signature_type>>(ds);
+         skip<std::vector<chain::bytes>>(ds);
+      }
+   }
+
+   /// calls on_transaction(index, begin, end) after the actions of each transaction trace of traces were passed to
+   /// on_action(index, action_info)
+   template <typename A, typename T>
+   void read_traces(const chain::bytes& traces, A&& on_action, T&& on_transaction) {
+      entry_begin = traces.data();
+      input_stream ds(traces.data(), traces.size());
+      uint32_t     num = read<fc::unsigned_int>(ds).value;
+      for (uint32_t i = 0; i < num; ++i) {
+         auto begin  = ds.pos();
+         auto action = [&](const action_info& info) { on_action(i, info); };
+         read_transaction_trace(ds, action);
+         on_transaction(i, begin, ds.pos());
+      }
+   }
+};
+
+} // namespace eosio
@@ -0,0 +1,81 @@
+#include <eosio/state_history_plugin/state_history_columns.hpp>
+#include <eosio/state_history_plugin/state_history_compression.hpp>
+#include <eosio/state_history_plugin/state_history_trace_reader.hpp>
+
+namespace eosio {
+using namespace chain;
+
+namespace {
+
+/// calls f with each column of c, in the order of trace_column
+template <typename C, typename F>
+void for_each_column(C& c, F f) {
+   f(trace_column::trx_offset, c.trx_offset);
+   f(trace_column::trx_size, c.trx_size);
+   f(trace_column::action_trx, c.action_trx);
+   f(trace_column::action_ordinal, c.action_ordinal);
+   f(trace_column::receiver, c.receiver);
+   f(trace_column::account, c.account);
+   f(trace_column::name, c.name);
+   f(trace_column::auth_count, c.auth_count);
+   f(trace_column::auth_actor, c.auth_actor);
+   f(trace_column::auth_permission, c.auth_permission);
+   f(trace_column::data_offset, c.data_offset);
+   f(trace_column::data_size, c.data_size);
+}
+
+} // namespace
+
+trace_columns trace_columns::from_traces(const bytes& traces) {
+   trace_columns result;
+   trace_reader{}.read_traces(
+       traces,
+       [&](uint32_t trx, const trace_reader::action_info& action) {
+          result.action_trx.push_back(trx);
+          result.action_ordinal.push_back(action.action_ordinal);
+          result.receiver.push_back(action.receiver.to_uint64_t());
+          result.account.push_back(action.account.to_uint64_t());
+          result.name.push_back(action.name.to_uint64_t());
+          result.auth_count.push_back(action.authorization.size());
+          for (auto& auth : action.authorization) {
+             result.auth_actor.push_back(auth.first);
+             result.auth_permission.push_back(auth.second);
+          }
+          result.data_offset.push_back(action.data_offset);
+          result.data_size.push_back(action.data_size);
+       },
+       [&](uint32_t, const char* begin, const char* end) {
+          result.trx_offset.push_back(begin - traces.data());
+          result.trx_size.push_back(end - begin);
+       });
+   return result;
+}
+
+bytes trace_columns::pack(int level) const {
+   std::vector<bytes> columns;
+   columns.reserve(num_trace_columns);
+   for_each_column(*this, [&](trace_column, const auto& column) {
+      columns.push_back(zlib_compress_bytes(fc::raw::pack(column), level, nullptr));
+   });
+   return fc::raw::pack(columns);
+}
+
+trace_columns trace_columns::unpack(const bytes& payload, const std::vector<trace_column>& wanted) {
+   std::vector<bytes> columns;
+   fc::datastream<const char*> ds(payload.data(), payload.size());
+   fc::raw::unpack(ds, columns);
+
+   trace_columns result;
+   for_each_column(result, [&](trace_column c, auto& column) {
+      if (std::find(wanted.begin(), wanted.end(), c) == wanted.end())
+         return;
+      auto index = static_cast<size_t>(c);
+      EOS_ASSERT(index < columns.size(), plugin_exception, "trace columns entry has no column ${c}", ("c", index));
+      auto                        data = zlib_decompress(columns[index], nullptr);
+      fc::datastream<const char*> cds(data.data(), data.size());
+      fc::raw::unpack(cds, column);
+   });
+   return result;
+}
+
+} // namespace eosio
@@ -0,0 +1,97 @@
+#include <eosio/state_history_plugin/state_history_filter.hpp>
+#include <eosio/state_history_plugin/state_history_serialization.hpp>
+#include <eosio/state_history_plugin/state_history_trace_reader.hpp>
+
+namespace eosio {
+using namespace chain;
+
+namespace {
+
+using raw_reader::input_stream;
+using raw_reader::read;
+using raw_reader::skip;
+
+/// true if filter matches a row of a contract table, whose code, scope and table follow the version of the row
+bool match_row(const std::string& table, const bytes& row, const blocks_filter& filter) {
+   static const std::string contract_prefix = "contract_";
+   if (table.compare(0, contract_prefix.size(), contract_prefix))
+      return !filter.filters_deltas();
+   input_stream ds(row.data(), row.size());
+   skip<fc::unsigned_int>(ds);
+   name code{read<uint64_t>(ds)};
+   if (table == "contract_kv")
+      return filter.contracts.match(code) && filter.tables.empty() && filter.scopes.empty();
+   name scope{read<uint64_t>(ds)};
+   name tbl{read<uint64_t>(ds)};
+   return filter.contracts.match(code) && filter.scopes.match(scope) && filter.tables.match(tbl);
+}
+
+} // namespace
+
+bytes filter_deltas(const bytes& deltas, const blocks_filter& filter) {
+   if (!filter.filters_deltas())
+      return deltas;
+   input_stream             ds(deltas.data(), deltas.size());
+   std::vector<table_delta> result;
+   for (uint32_t n = read<fc::unsigned_int>(ds).value; n; --n) {
+      table_delta delta;
+      fc::raw::unpack(ds, delta.struct_version);
+      fc::raw::unpack(ds, delta.name);
+      for (uint32_t r = read<fc::unsigned_int>(ds).value; r; --r) {
+         std::pair<bool, bytes> row;
+         fc::raw::unpack(ds, row);
+         if (match_row(delta.name, row.second, filter))
+            delta.rows.obj.push_back(std::move(row));
+      }
+      if (!delta.rows.obj.empty())
+         result.push_back(std::move(delta));
+   }
+   return fc::raw::pack(result);
+}
+
+bytes filter_traces(const bytes& traces, const blocks_filter& filter) {
+   if (!filter.filters_traces())
+      return traces;
+   bytes    kept;
+   uint32_t num_kept = 0;
+   bool     matched  = false;
+   trace_reader{}.read_traces(
+       traces,
+       [&](uint32_t, const trace_reader::action_info& action) {
+          matched = matched || (filter.contracts.match(action.account) && filter.actions.match(action.name));
+       },
+       [&](uint32_t, const char* begin, const char* end) {
+          if (matched) {
+             kept.insert(kept.end(), begin, end);
+             ++num_kept;
+          }
+          matched = false;
+       });
+   bytes result = fc::raw::pack(fc::unsigned_int(num_kept));
+   result.insert(result.end(), kept.begin(), kept.end());
+   return result;
+}
+
+bytes filter_traces(const bytes& traces, const trace_columns& columns, const blocks_filter& filter) {
+   if (!filter.filters_traces())
+      return traces;
+   std::vector<bool> matched(columns.trx_offset.size());
+   for (size_t i = 0; i < columns.action_trx.size(); ++i) {
+      if (filter.contracts.match(name{columns.account[i]}) && filter.actions.match(name{columns.name[i]}))
+         matched.at(columns.action_trx[i]) = true;
+   }
+   bytes    result;
+   uint32_t num_kept = std::count(matched.begin(), matched.end(), true);
+   result           = fc::raw::pack(fc::unsigned_int(num_kept));
+   for (size_t i = 0; i < matched.size(); ++i) {
+      if (!matched[i])
+         continue;
+      EOS_ASSERT(uint64_t(columns.trx_offset[i]) + columns.trx_size[i] <= traces.size(), plugin_exception,
+                 "trace columns do not match their traces");
+      result.insert(result.end(), traces.begin() + columns.trx_offset[i],
+                    traces.begin() + columns.trx_offset[i] + columns.trx_size[i]);
+   }
+   return result;
+}
+
+} // namespace eosio
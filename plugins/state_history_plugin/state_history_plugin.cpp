@@ -1,4 +1,8 @@
 #include <eosio/chain/config.hpp>
+#include <eosio/chain/metrics.hpp>
+#include <eosio/chain/thread_utils.hpp>
+#include <eosio/state_history_plugin/state_history_compression.hpp>
+#include <eosio/state_history_plugin/state_history_filter.hpp>
 #include <eosio/state_history_plugin/state_history_log.hpp>
 #include <eosio/state_history_plugin/state_history_serialization.hpp>
 
@@ -8,13 +12,25 @@
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
-#include <boost/iostreams/device/back_inserter.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
 #include <boost/signals2/connection.hpp>
 
-using tcp    = boost::asio::ip::tcp;
-namespace ws = boost::beast::websocket;
+#include <fc/log/logger_config.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+
+#include <zlib.h>
+
+using tcp         = boost::asio::ip::tcp;
+namespace ws      = boost::beast::websocket;
+using strand_type = boost::asio::strand<boost::asio::io_context::executor_type>;
 
 extern const char* const state_history_plugin_abi;
 
@@ -24,6 +40,9 @@ using boost::signals2::scoped_connection;
 
 static appbase::abstract_plugin& _state_history_plugin = app().register_plugin<state_history_plugin>();
 
+static metric_gauge sessions_metric( "nodeos_ship_sessions", "Websocket sessions of state history clients" );
+static metric_counter blocks_stored_metric( "nodeos_ship_blocks_total", "Accepted blocks whose traces and state were queued for the logs" );
+
 template <typename F>
 auto catch_and_log(F f) {
    try {
@@ -37,27 +56,6 @@ auto catch_and_log(F f) {
    }
 }
 
-namespace bio = boost::iostreams;
-static bytes zlib_compress_bytes(bytes in) {
-   bytes                  out;
-   bio::filtering_ostream comp;
-   comp.push(bio::zlib_compressor(bio::zlib::default_compression));
-   comp.push(bio::back_inserter(out));
-   bio::write(comp, in.data(), in.size());
-   bio::close(comp);
-   return out;
-}
-
-static bytes zlib_decompress(const bytes& in) {
-   bytes                  out;
-   bio::filtering_ostream decomp;
-   decomp.push(bio::zlib_decompressor());
-   decomp.push(bio::back_inserter(out));
-   bio::write(decomp, in.data(), in.size());
-   bio::close(decomp);
-   return out;
-}
-
 template <typename T>
 bool include_delta(const T& old, const T& curr) {
    return true;
@@ -114,6 +112,8 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    chain_plugin*                                              chain_plug = nullptr;
    fc::optional<state_history_log>                            trace_log;
    fc::optional<state_history_log>                            chain_state_log;
+   fc::optional<state_history_log>                            trace_columns_log; ///< written with trace_log, if enabled
+   bool                                                       trace_columns_gap_logged = false;
    bool                                                       trace_debug_mode = false;
    bool                                                       stopping = false;
    fc::optional<scoped_connection>                            applied_transaction_connection;
@@ -125,17 +125,278 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    std::map<transaction_id_type, augmented_transaction_trace> cached_traces;
    fc::optional<augmented_transaction_trace>                  onblock_trace;
 
-   void get_log_entry(state_history_log& log, uint32_t block_num, fc::optional<bytes>& result) {
-      if (block_num < log.begin_block() || block_num >= log.end_block())
+   /// packed traces or deltas of a block, compressed and written to its log by the writer thread
+   struct log_entry {
+      state_history_log*   log = nullptr;
+      const char*          what = "";
+      block_id_type        block_id;
+      block_id_type        prev_id;
+      uint32_t             irreversible_block = 0; ///< when queued, the log is split up to it
+      bytes                packed;
+   };
+   std::shared_mutex                                          log_mtx; ///< guards the logs
+   fc::optional<named_thread_pool>                            thread_pool; ///< runs the sockets and log reads of sessions
+   uint32_t                                                   read_ahead_blocks = 8;
+   uint32_t                                                   session_pipeline  = 4; ///< results in flight per session
+   std::mutex                                                 write_mtx;
+   std::condition_variable                                    write_cv;
+   std::deque<log_entry>                                      write_queue; ///< the front entry is being written
+   size_t                                                     max_write_queue = 64;
+   bool                                                       stop_writing = false;
+   std::atomic<bool>                                          update_posted{false};
+   std::thread                                                writer_thread;
+   int                                                        compression_level = Z_DEFAULT_COMPRESSION;
+   uint32_t                                                   dictionary_blocks = 0; ///< 0 to not train dictionaries
+
+   static constexpr size_t max_dictionary_size = 32 * 1024; ///< the zlib window, more is not used
+
+   /**
+    * preset dictionary of the entries of a log, trained by the writer thread from the starts of the first
+    * dictionary_blocks entries written without one and kept in a file next to the log
+    */
+   struct log_dictionary {
+      std::string                  filename;
+      std::shared_ptr<const bytes> dictionary; ///< null until trained or loaded, guarded by log_mtx
+      bytes                        samples;    ///< of the writer thread
+      uint32_t                     num_samples = 0;
+   };
+   std::map<const state_history_log*, log_dictionary>        dictionaries;
+
+   /// filter of a session, packed as the key of its entries in filter_cache
+   struct session_filter {
+      blocks_filter filter;
+      bytes         packed;
+   };
+
+   struct filtered_entry_key {
+      bytes                    filter;
+      const state_history_log* log = nullptr;
+      block_id_type            block_id;
+
+      friend bool operator<(const filtered_entry_key& a, const filtered_entry_key& b) {
+         return std::tie(a.log, a.block_id, a.filter) < std::tie(b.log, b.block_id, b.filter);
+      }
+   };
+   using filter_cache_lru = std::list<filtered_entry_key>; ///< least recently used first
+
+   /// entries filtered for sessions, shared by those with the same filter and kept by block id across forks
+   std::mutex                                                 filter_cache_mtx;
+   filter_cache_lru                                           filter_cache_order;
+   std::map<filtered_entry_key, std::pair<bytes, filter_cache_lru::iterator>> filter_cache;
+   size_t                                                     max_filter_cache = 1024; ///< entries, 0 to not cache
+
+   fc::optional<bytes> find_filtered_entry(const filtered_entry_key& key) {
+      std::lock_guard<std::mutex> g(filter_cache_mtx);
+      auto                        it = filter_cache.find(key);
+      if (it == filter_cache.end())
+         return {};
+      filter_cache_order.splice(filter_cache_order.end(), filter_cache_order, it->second.second);
+      return it->second.first;
+   }
+
+   void add_filtered_entry(filtered_entry_key key, const bytes& entry) {
+      if (!max_filter_cache)
+         return;
+      std::lock_guard<std::mutex> g(filter_cache_mtx);
+      if (filter_cache.count(key))
+         return;
+      while (filter_cache.size() >= max_filter_cache) {
+         filter_cache.erase(filter_cache_order.front());
+         filter_cache_order.pop_front();
+      }
+      auto pos = filter_cache_order.insert(filter_cache_order.end(), key);
+      filter_cache.emplace(std::move(key), std::make_pair(entry, pos));
+   }
+
+   void load_dictionary(const state_history_log& log, const bfs::path& filename) {
+      auto& dict    = dictionaries[&log];
+      dict.filename = filename.string();
+      if (!bfs::exists(filename))
+         return;
+      bytes d(bfs::file_size(filename));
+      std::ifstream in(dict.filename, std::ios::in | std::ios::binary);
+      in.read(d.data(), d.size());
+      EOS_ASSERT(in && !d.empty(), plugin_exception, "unable to read ${f}", ("f", dict.filename));
+      dict.dictionary = std::make_shared<const bytes>(std::move(d));
+   }
+
+   void add_dictionary_sample(log_dictionary& dict, const bytes& packed) {
+      const size_t sample_size = max_dictionary_size / dictionary_blocks;
+      dict.samples.insert(dict.samples.end(), packed.begin(), packed.begin() + std::min(sample_size, packed.size()));
+      if (++dict.num_samples < dictionary_blocks)
+         return;
+
+      {
+         std::ofstream out(dict.filename, std::ios::out | std::ios::binary | std::ios::trunc);
+         out.write(dict.samples.data(), dict.samples.size());
+         out.flush();
+         EOS_ASSERT(out, plugin_exception, "unable to write ${f}", ("f", dict.filename));
+      }
+      ilog("Trained the ${n} bytes compression dictionary ${f}", ("n", dict.samples.size())("f", dict.filename));
+      std::unique_lock<std::shared_mutex> g(log_mtx);
+      dict.dictionary = std::make_shared<const bytes>(std::move(dict.samples));
+   }
+
+   void start_writer() {
+      writer_thread = std::thread([this] {
+         fc::set_os_thread_name("shipwr");
+         std::unique_lock<std::mutex> g(write_mtx);
+         while (true) {
+            write_cv.wait(g, [&] { return !write_queue.empty() || stop_writing; });
+            if (write_queue.empty())
+               return;
+            const auto& entry = write_queue.front();
+            g.unlock();
+            catch_and_log([&] { write_log_entry(entry); });
+            g.lock();
+            write_queue.pop_front();
+            write_cv.notify_all();
+            if (!update_posted.exchange(true)) {
+               app().post(priority::medium, [self = shared_from_this()] { self->on_entries_written(); });
+            }
+         }
+      });
+   }
+
+   /// writes all queued entries, then stops the writer thread
+   void stop_writer() {
+      {
+         std::lock_guard<std::mutex> g(write_mtx);
+         stop_writing = true;
+      }
+      write_cv.notify_all();
+      if (writer_thread.joinable())
+         writer_thread.join();
+   }
+
+   /// waits while the queue is full, so block processing never runs ahead of the logs by more than max_write_queue
+   void queue_log_entry(state_history_log& log, const char* what, const block_state_ptr& block_state, bytes packed) {
+      std::unique_lock<std::mutex> g(write_mtx);
+      write_cv.wait(g, [&] { return write_queue.size() < max_write_queue; });
+      write_queue.push_back({&log, what, block_state->block->id(), block_state->block->previous,
+                             block_state->dpos_irreversible_blocknum, std::move(packed)});
+      write_cv.notify_all();
+   }
+
+   void write_log_entry(const log_entry& entry) {
+      // only this thread changes the dictionaries
+      auto&       dict       = dictionaries.at(entry.log);
+      const auto* dictionary = dictionary_blocks ? dict.dictionary.get() : nullptr;
+      auto        bin        = zlib_compress_bytes(entry.packed, compression_level, dictionary);
+      EOS_ASSERT(bin.size() == (uint32_t)bin.size(), plugin_exception, "${what} is too big", ("what", entry.what));
+      if (dictionary_blocks && !dict.dictionary)
+         add_dictionary_sample(dict, entry.packed);
+
+      state_history_log_header header{.magic        = ship_magic(dictionary ? 1 : 0),
+                                      .block_id     = entry.block_id,
+                                      .payload_size = sizeof(uint32_t) + bin.size()};
+      std::unique_lock<std::shared_mutex> g(log_mtx);
+      entry.log->write_entry(header, entry.prev_id, [&](auto& stream) {
+         uint32_t s = (uint32_t)bin.size();
+         stream.write((char*)&s, sizeof(s));
+         if (!bin.empty())
+            stream.write(bin.data(), bin.size());
+      });
+      entry.log->split(entry.irreversible_block);
+      if (trace_columns_log && entry.log == &*trace_log) {
+         g.unlock();
+         write_trace_columns(entry);
+      }
+   }
+
+   void write_trace_columns(const log_entry& entry) {
+      // only this thread changes the logs. The columns are not written past a block they missed, e.g. while
+      // trace-history-columns was not set; filters of the blocks without them parse the traces
+      auto block_num = block_header::num_from_id(entry.block_id);
+      if (trace_columns_log->begin_block() != trace_columns_log->end_block() &&
+          block_num > trace_columns_log->end_block()) {
+         if (!trace_columns_gap_logged)
+            wlog("trace_columns.log ends at block ${e}, not writing the columns of block ${b} and after",
+                 ("e", trace_columns_log->end_block())("b", block_num));
+         trace_columns_gap_logged = true;
+         return;
+      }
+      auto bin = trace_columns::from_traces(entry.packed).pack(compression_level);
+      EOS_ASSERT(bin.size() == (uint32_t)bin.size(), plugin_exception, "trace columns are too big");
+      state_history_log_header header{.magic = ship_magic(0), .block_id = entry.block_id, .payload_size = bin.size()};
+      std::unique_lock<std::shared_mutex> g(log_mtx);
+      trace_columns_log->write_entry(header, entry.prev_id, [&](auto& stream) { stream.write(bin.data(), bin.size()); });
+      trace_columns_log->split(entry.irreversible_block);
+   }
+
+   /// @return number of the first block with an entry not yet written to log, or to any log if null, max if none
+   uint32_t first_unwritten_block(const state_history_log* log = nullptr) {
+      std::lock_guard<std::mutex> g(write_mtx);
+      uint32_t result = std::numeric_limits<uint32_t>::max();
+      for (const auto& entry : write_queue) {
+         if (!log || entry.log == log)
+            result = std::min(result, block_header::num_from_id(entry.block_id));
+      }
+      return result;
+   }
+
+   void on_entries_written() {
+      update_posted = false;
+      if (stopping)
          return;
+      for (auto& s : sessions) {
+         auto& p = s.second;
+         if (p)
+            p->send_update(true);
+      }
+   }
+
+   /// called from the thread pool, the entries of the next read_ahead_blocks blocks are read ahead
+   void get_log_entry(state_history_log& log, uint32_t block_num, fc::optional<bytes>& result,
+                      const session_filter* filter = nullptr) {
+      state_history_log_header     header;
+      bytes                        payload;
+      std::shared_ptr<const bytes> dictionary;
+      {
+         std::shared_lock<std::shared_mutex> g(log_mtx);
+         if (block_num < log.begin_block() || block_num >= log.end_block())
+            return;
+         log.read_entry(block_num, header, payload);
+         log.read_ahead(block_num + 1, read_ahead_blocks);
+         if (get_ship_version(header.magic) >= 1)
+            dictionary = dictionaries.at(&log).dictionary;
+      }
+      fc::optional<filtered_entry_key> key;
+      if (filter) {
+         key    = filtered_entry_key{filter->packed, &log, header.block_id};
+         result = find_filtered_entry(*key);
+         if (result)
+            return;
+      }
+      result = unpack_entry_payload(payload, block_num, dictionary.get());
+      if (filter) {
+         if (trace_log && &log == &*trace_log)
+            result = filter_trace_entry(*result, block_num, header.block_id, filter->filter);
+         else
+            result = filter_deltas(*result, filter->filter);
+         add_filtered_entry(std::move(*key), *result);
+      }
+   }
+
+   /// filters traces by their columns when trace_columns.log has those of the same block
+   bytes filter_trace_entry(const bytes& traces, uint32_t block_num, const block_id_type& block_id,
+                            const blocks_filter& filter) {
+      if (!trace_columns_log || !filter.filters_traces())
+         return filter_traces(traces, filter);
       state_history_log_header header;
-      auto&                    stream = log.get_entry(block_num, header);
-      uint32_t                 s;
-      stream.read((char*)&s, sizeof(s));
-      bytes compressed(s);
-      if (s)
-         stream.read(compressed.data(), s);
-      result = zlib_decompress(compressed);
+      bytes                    payload;
+      {
+         std::shared_lock<std::shared_mutex> g(log_mtx);
+         if (block_num < trace_columns_log->begin_block() || block_num >= trace_columns_log->end_block())
+            return filter_traces(traces, filter);
+         trace_columns_log->read_entry(block_num, header, payload);
+      }
+      if (header.block_id != block_id)
+         return filter_traces(traces, filter);
+      auto columns = trace_columns::unpack(payload, {trace_column::trx_offset, trace_column::trx_size,
+                                                     trace_column::action_trx, trace_column::account,
+                                                     trace_column::name});
+      return filter_traces(traces, columns, filter);
    }
 
    void get_block(uint32_t block_num, fc::optional<bytes>& result) {
@@ -150,10 +411,12 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    }
 
    fc::optional<chain::block_id_type> get_block_id(uint32_t block_num) {
+      std::shared_lock<std::shared_mutex> g(log_mtx);
       if (trace_log && block_num >= trace_log->begin_block() && block_num < trace_log->end_block())
-         return trace_log->get_block_id(block_num);
+         return trace_log->read_block_id(block_num);
       if (chain_state_log && block_num >= chain_state_log->begin_block() && block_num < chain_state_log->end_block())
-         return chain_state_log->get_block_id(block_num);
+         return chain_state_log->read_block_id(block_num);
+      g.unlock();
       try {
          auto block = chain_plug->chain().fetch_block_by_number(block_num);
          if (block)
@@ -166,14 +429,27 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    struct session : std::enable_shared_from_this<session> {
       std::shared_ptr<state_history_plugin_impl> plugin;
       std::unique_ptr<ws::stream<tcp::socket>>   socket_stream;
+      strand_type                                strand; ///< of the socket
       bool                                       sending  = false;
       bool                                       sent_abi = false;
       std::vector<std::vector<char>>             send_queue;
+      uint32_t                                   reads_in_flight  = 0; ///< results whose log entries are being read
+      uint64_t                                   next_result      = 0; ///< sequence number of the next result built
+      uint64_t                                   next_queued      = 0; ///< of the next result moved to send_queue
+      std::map<uint64_t, std::vector<char>>      ready_results;        ///< read out of order, waiting for earlier ones
       fc::optional<get_blocks_request_v0>        current_request;
+      std::shared_ptr<const session_filter>      filter; ///< of current_request, null if not filtered
       bool                                       need_to_send_update = false;
 
       session(std::shared_ptr<state_history_plugin_impl> plugin)
-          : plugin(std::move(plugin)) {}
+          : plugin(std::move(plugin))
+          , strand(this->plugin->thread_pool->get_executor().get_executor()) {}
+
+      // the session state is kept on the main thread, the socket is only used on its strand of the thread pool
+      template <typename F>
+      void on_strand(F f) {
+         boost::asio::post(strand, std::move(f));
+      }
 
       void start(tcp::socket socket) {
          ilog("incoming connection");
@@ -182,28 +458,34 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          socket_stream->next_layer().set_option(boost::asio::ip::tcp::no_delay(true));
          socket_stream->next_layer().set_option(boost::asio::socket_base::send_buffer_size(1024 * 1024));
          socket_stream->next_layer().set_option(boost::asio::socket_base::receive_buffer_size(1024 * 1024));
-         socket_stream->async_accept([self = shared_from_this()](boost::system::error_code ec) {
-            self->callback(ec, "async_accept", [self] {
-               self->start_read();
-               self->send(state_history_plugin_abi);
-            });
+         on_strand([self = shared_from_this()] {
+            self->socket_stream->async_accept(
+                boost::asio::bind_executor(self->strand, [self](boost::system::error_code ec) {
+                   self->callback(ec, "async_accept", [self] {
+                      self->start_read();
+                      self->send(state_history_plugin_abi);
+                   });
+                }));
          });
       }
 
       void start_read() {
-         auto in_buffer = std::make_shared<boost::beast::flat_buffer>();
-         socket_stream->async_read(
-             *in_buffer, [self = shared_from_this(), in_buffer](boost::system::error_code ec, size_t) {
-                self->callback(ec, "async_read", [self, in_buffer] {
-                   auto d = boost::asio::buffer_cast<char const*>(boost::beast::buffers_front(in_buffer->data()));
-                   auto s = boost::asio::buffer_size(in_buffer->data());
-                   fc::datastream<const char*> ds(d, s);
-                   state_request               req;
-                   fc::raw::unpack(ds, req);
-                   req.visit(*self);
-                   self->start_read();
-                });
-             });
+         on_strand([self = shared_from_this()] {
+            auto in_buffer = std::make_shared<boost::beast::flat_buffer>();
+            self->socket_stream->async_read(
+                *in_buffer,
+                boost::asio::bind_executor(self->strand, [self, in_buffer](boost::system::error_code ec, size_t) {
+                   self->callback(ec, "async_read", [self, in_buffer] {
+                      auto d = boost::asio::buffer_cast<char const*>(boost::beast::buffers_front(in_buffer->data()));
+                      auto s = boost::asio::buffer_size(in_buffer->data());
+                      fc::datastream<const char*> ds(d, s);
+                      state_request               req;
+                      fc::raw::unpack(ds, req);
+                      req.visit(*self);
+                      self->start_read();
+                   });
+                }));
+         });
       }
 
       void send(const char* s) {
@@ -217,23 +499,67 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          send();
       }
 
+      /// results are built while earlier ones are read and sent, up to session_pipeline of them
+      bool pipeline_full() const {
+         return reads_in_flight + ready_results.size() + send_queue.size() >= plugin->session_pipeline;
+      }
+
+      /// queues the result with sequence number seq once the ones before it are queued
+      void queue_result(uint64_t seq, std::vector<char> bin) {
+         ready_results[seq] = std::move(bin);
+         for (auto it = ready_results.begin(); it != ready_results.end() && it->first == next_queued;
+              it = ready_results.erase(it), ++next_queued)
+            send_queue.push_back(std::move(it->second));
+         send();
+      }
+
       void send() {
-         if (sending)
-            return;
-         if (send_queue.empty())
+         if (sending || send_queue.empty())
             return send_update();
          sending = true;
-         socket_stream->binary(sent_abi);
+         // the front of send_queue stays in place until written
+         on_strand([self = shared_from_this(), binary = sent_abi, buffer = boost::asio::buffer(send_queue[0])] {
+            self->socket_stream->binary(binary);
+            self->socket_stream->async_write( //
+                buffer,
+                boost::asio::bind_executor(self->strand, [self](boost::system::error_code ec, size_t) {
+                   self->callback(ec, "async_write", [self] {
+                      self->send_queue.erase(self->send_queue.begin());
+                      self->sending = false;
+                      self->send();
+                   });
+                }));
+         });
          sent_abi = true;
-         socket_stream->async_write( //
-             boost::asio::buffer(send_queue[0]),
-             [self = shared_from_this()](boost::system::error_code ec, size_t) {
-                self->callback(ec, "async_write", [self] {
-                   self->send_queue.erase(self->send_queue.begin());
-                   self->sending = false;
-                   self->send();
-                });
-             });
+         send_update();
+      }
+
+      /// reads the log entries of result on the thread pool, then sends it
+      void read_and_send(get_blocks_result_v0 result, uint32_t block_num, bool traces, bool deltas) {
+         ++reads_in_flight;
+         boost::asio::post(plugin->thread_pool->get_executor(),
+                           [self = shared_from_this(), filter = filter, seq = next_result++, result = std::move(result),
+                            block_num, traces, deltas]() mutable {
+            auto& plugin = *self->plugin;
+            bool  ok     = false;
+            std::vector<char> bin;
+            catch_and_log([&] {
+               if (traces)
+                  plugin.get_log_entry(*plugin.trace_log, block_num, result.traces, filter.get());
+               if (deltas)
+                  plugin.get_log_entry(*plugin.chain_state_log, block_num, result.deltas, filter.get());
+               bin = fc::raw::pack(state_result{std::move(result)});
+               ok  = true;
+            });
+            app().post(priority::medium, [self, ok, seq, bin = std::move(bin)]() mutable {
+               --self->reads_in_flight;
+               if (self->plugin->stopping || !self->plugin->sessions.count(self.get()))
+                  return;
+               if (!ok)
+                  return self->close();
+               self->queue_result(seq, std::move(bin));
+            });
+         });
       }
 
       using result_type = void;
@@ -242,6 +568,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          get_status_result_v0 result;
          result.head              = {chain.head_block_num(), chain.head_block_id()};
          result.last_irreversible = {chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
+         std::shared_lock<std::shared_mutex> g(plugin->log_mtx);
          if (plugin->trace_log) {
             result.trace_begin_block = plugin->trace_log->begin_block();
             result.trace_end_block   = plugin->trace_log->end_block();
@@ -254,6 +581,26 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       }
 
       void operator()(get_blocks_request_v0& req) {
+         filter.reset();
+         start_blocks(req);
+      }
+
+      void operator()(get_blocks_request_v1& req) {
+         filter.reset();
+         if (!req.filter.empty()) {
+            // sessions asking for the same names in another order share their cached entries
+            for (auto* names : {&req.filter.contracts, &req.filter.tables, &req.filter.scopes, &req.filter.actions}) {
+               for (auto* v : {&names->include, &names->exclude}) {
+                  std::sort(v->begin(), v->end());
+                  v->erase(std::unique(v->begin(), v->end()), v->end());
+               }
+            }
+            filter = std::make_shared<const session_filter>(session_filter{req.filter, fc::raw::pack(req.filter)});
+         }
+         start_blocks(req);
+      }
+
+      void start_blocks(get_blocks_request_v0& req) {
          for (auto& cp : req.have_positions) {
             if (req.start_block_num <= cp.block_num)
                continue;
@@ -275,12 +622,19 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
 
       void send_update(get_blocks_result_v0 result) {
          need_to_send_update = true;
-         if (!send_queue.empty() || !current_request || !current_request->max_messages_in_flight)
+         if (pipeline_full() || !current_request || !current_request->max_messages_in_flight)
             return;
          auto& chain = plugin->chain_plug->chain();
          result.last_irreversible = {chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
          uint32_t current =
                current_request->irreversible_only ? result.last_irreversible.block_num : result.head.block_num;
+         // blocks are sent once their entries are in the logs, sessions are updated again when the writer catches up
+         if ((current_request->fetch_traces && plugin->trace_log) ||
+             (current_request->fetch_deltas && plugin->chain_state_log))
+            current = std::min(current, plugin->first_unwritten_block() - 1);
+         bool     read_traces = false;
+         bool     read_deltas = false;
+         uint32_t block_num   = current_request->start_block_num;
          if (current_request->start_block_num <= current &&
              current_request->start_block_num < current_request->end_block_num) {
             auto block_id = plugin->get_block_id(current_request->start_block_num);
@@ -291,22 +645,23 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
                   result.prev_block = block_position{current_request->start_block_num - 1, *prev_block_id};
                if (current_request->fetch_block)
                   plugin->get_block(current_request->start_block_num, result.block);
-               if (current_request->fetch_traces && plugin->trace_log)
-                  plugin->get_log_entry(*plugin->trace_log, current_request->start_block_num, result.traces);
-               if (current_request->fetch_deltas && plugin->chain_state_log)
-                  plugin->get_log_entry(*plugin->chain_state_log, current_request->start_block_num, result.deltas);
+               read_traces = current_request->fetch_traces && plugin->trace_log;
+               read_deltas = current_request->fetch_deltas && plugin->chain_state_log;
             }
             ++current_request->start_block_num;
          }
-         send(std::move(result));
          --current_request->max_messages_in_flight;
          need_to_send_update = current_request->start_block_num <= current &&
                                current_request->start_block_num < current_request->end_block_num;
+         if (read_traces || read_deltas)
+            read_and_send(std::move(result), block_num, read_traces, read_deltas);
+         else
+            queue_result(next_result++, fc::raw::pack(state_result{std::move(result)}));
       }
 
       void send_update(const block_state_ptr& block_state) {
          need_to_send_update = true;
-         if (!send_queue.empty() || !current_request || !current_request->max_messages_in_flight)
+         if (pipeline_full() || !current_request || !current_request->max_messages_in_flight)
             return;
          get_blocks_result_v0 result;
          result.head = {block_state->block_num, block_state->id};
@@ -316,7 +671,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       void send_update(bool changed = false) {
          if (changed)
             need_to_send_update = true;
-         if (!send_queue.empty() || !need_to_send_update || !current_request ||
+         if (pipeline_full() || !need_to_send_update || !current_request ||
              !current_request->max_messages_in_flight)
             return;
          auto& chain = plugin->chain_plug->chain();
@@ -362,8 +717,12 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       }
 
       void close() {
-         socket_stream->next_layer().close();
+         on_strand([self = shared_from_this()] {
+            boost::system::error_code ec;
+            self->socket_stream->next_layer().close(ec);
+         });
          plugin->sessions.erase(this);
+         sessions_metric.set(plugin->sessions.size());
       }
    };
    std::map<session*, std::shared_ptr<session>> sessions;
@@ -393,7 +752,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    }
 
    void do_accept() {
-      auto socket = std::make_shared<tcp::socket>(app().get_io_service());
+      auto socket = std::make_shared<tcp::socket>(thread_pool->get_executor());
       acceptor->async_accept(*socket, [self = shared_from_this(), socket, this](const boost::system::error_code& ec) {
          if (stopping)
             return;
@@ -405,6 +764,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          catch_and_log([&] {
             auto s            = std::make_shared<session>(self);
             sessions[s.get()] = s;
+            sessions_metric.set(sessions.size());
             s->start(std::move(*socket));
          });
          catch_and_log([&] { do_accept(); });
@@ -425,12 +785,15 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    void on_accepted_block(const block_state_ptr& block_state) {
       store_traces(block_state);
       store_chain_state(block_state);
+      blocks_stored_metric.add();
       for (auto& s : sessions) {
          auto& p = s.second;
          if (p) {
             if (p->current_request && block_state->block_num < p->current_request->start_block_num)
                p->current_request->start_block_num = block_state->block_num;
-            p->send_update(block_state);
+            // with a log the session is updated by on_entries_written
+            if (!trace_log && !chain_state_log)
+               p->send_update(block_state);
          }
       }
    }
@@ -463,30 +826,30 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       }
       clear_caches();
 
-      auto& db         = chain_plug->chain().db();
-      auto  traces_bin = zlib_compress_bytes(fc::raw::pack(make_history_context_wrapper(db, trace_debug_mode, traces)));
-      EOS_ASSERT(traces_bin.size() == (uint32_t)traces_bin.size(), plugin_exception, "traces is too big");
-
-      state_history_log_header header{.magic        = ship_magic(ship_current_version),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + traces_bin.size()};
-      trace_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)traces_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!traces_bin.empty())
-            stream.write(traces_bin.data(), traces_bin.size());
-      });
+      auto& db = chain_plug->chain().db();
+      queue_log_entry(*trace_log, "traces", block_state,
+                      fc::raw::pack(make_history_context_wrapper(db, trace_debug_mode, traces)));
    }
 
    void store_chain_state(const block_state_ptr& block_state) {
       if (!chain_state_log)
          return;
-      bool fresh = chain_state_log->begin_block() == chain_state_log->end_block();
+      bool fresh = false;
+      {
+         std::shared_lock<std::shared_mutex> g(log_mtx);
+         fresh = chain_state_log->begin_block() == chain_state_log->end_block();
+      }
+      // a fresh log may still have its first entry waiting to be written
+      fresh = fresh && first_unwritten_block(&*chain_state_log) == std::numeric_limits<uint32_t>::max();
       if (fresh)
          ilog("Placing initial state in block ${n}", ("n", block_state->block->block_num()));
 
-      std::vector<table_delta> deltas;
-      auto&                    db = chain_plug->chain().db();
+      // packed as std::vector<table_delta>, the rows go straight into the entry instead of a buffer of their own each
+      bytes    tables;      ///< packed table_deltas
+      uint32_t num_tables = 0;
+      bytes    rows;        ///< packed rows of the table being processed
+      uint32_t num_rows   = 0;
+      auto&    db         = chain_plug->chain().db();
 
       const auto&                                table_id_index = db.get_index<table_id_multi_index>();
       std::map<uint64_t, const table_id_object*> removed_table_id;
@@ -503,41 +866,54 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          return *it->second;
       };
 
-      auto pack_row          = [&](auto& row) { return fc::raw::pack(make_history_serial_wrapper(db, row)); };
-      auto pack_contract_row = [&](auto& row) {
-         return fc::raw::pack(make_history_context_wrapper(db, get_table_id(row.t_id._id), row));
+      // appends the row as std::pair<bool, bytes>
+      auto add_row = [&](bool present, const auto& wrapper) {
+         uint32_t size = fc::raw::pack_size(wrapper);
+         auto     pos  = rows.size();
+         rows.resize(pos + sizeof(present) + fc::raw::pack_size(fc::unsigned_int(size)) + size);
+         fc::datastream<char*> ds(rows.data() + pos, rows.size() - pos);
+         fc::raw::pack(ds, present);
+         fc::raw::pack(ds, fc::unsigned_int(size));
+         fc::raw::pack(ds, wrapper);
+         ++num_rows;
+      };
+      auto pack_row          = [&](bool present, auto& row) { add_row(present, make_history_serial_wrapper(db, row)); };
+      auto pack_contract_row = [&](bool present, auto& row) {
+         add_row(present, make_history_context_wrapper(db, get_table_id(row.t_id._id), row));
       };
 
       auto process_table = [&](auto* name, auto& index, auto& pack_row) {
+         rows.clear();
+         num_rows = 0;
          if (fresh) {
             if (index.indices().empty())
                return;
-            deltas.push_back({});
-            auto& delta = deltas.back();
-            delta.name  = name;
             for (auto& row : index.indices())
-               delta.rows.obj.emplace_back(true, pack_row(row));
+               pack_row(true, row);
          } else {
             if (index.stack().empty())
                return;
             auto& undo = index.stack().back();
             if (undo.old_values.empty() && undo.new_ids.empty() && undo.removed_values.empty())
                return;
-            deltas.push_back({});
-            auto& delta = deltas.back();
-            delta.name  = name;
             for (auto& old : undo.old_values) {
                auto& row = index.get(old.first);
                if (include_delta(old.second, row))
-                  delta.rows.obj.emplace_back(true, pack_row(row));
+                  pack_row(true, row);
             }
             for (auto& old : undo.removed_values)
-               delta.rows.obj.emplace_back(false, pack_row(old.second));
+               pack_row(false, old.second);
             for (auto id : undo.new_ids) {
                auto& row = index.get(id);
-               delta.rows.obj.emplace_back(true, pack_row(row));
+               pack_row(true, row);
             }
          }
+         FC_ASSERT(num_rows <= 1024 * 1024 * 1024);
+         for (auto& header : {fc::raw::pack(fc::unsigned_int(0)), fc::raw::pack(std::string(name)),
+                              fc::raw::pack(fc::unsigned_int(num_rows))})
+            tables.insert(tables.end(), header.begin(), header.end());
+         tables.insert(tables.end(), rows.begin(), rows.end());
+         ++num_tables;
       };
 
       process_table("account", db.get_index<account_index>(), pack_row);
@@ -551,6 +927,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       process_table("contract_index256", db.get_index<index256_index>(), pack_contract_row);
       process_table("contract_index_double", db.get_index<index_double_index>(), pack_contract_row);
       process_table("contract_index_long_double", db.get_index<index_long_double_index>(), pack_contract_row);
+      process_table("contract_kv", db.get_index<kv_index>(), pack_row);
 
       process_table("global_property", db.get_index<global_property_multi_index>(), pack_row);
       process_table("generated_transaction", db.get_index<generated_transaction_multi_index>(), pack_row);
@@ -564,24 +941,16 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       process_table("resource_limits_state", db.get_index<resource_limits::resource_limits_state_index>(), pack_row);
       process_table("resource_limits_config", db.get_index<resource_limits::resource_limits_config_index>(), pack_row);
 
-      auto deltas_bin = zlib_compress_bytes(fc::raw::pack(deltas));
-      EOS_ASSERT(deltas_bin.size() == (uint32_t)deltas_bin.size(), plugin_exception, "deltas is too big");
-      state_history_log_header header{.magic        = ship_magic(ship_current_version),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + deltas_bin.size()};
-      chain_state_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)deltas_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!deltas_bin.empty())
-            stream.write(deltas_bin.data(), deltas_bin.size());
-      });
+      bytes deltas = fc::raw::pack(fc::unsigned_int(num_tables));
+      deltas.insert(deltas.end(), tables.begin(), tables.end());
+      queue_log_entry(*chain_state_log, "deltas", block_state, std::move(deltas));
    } // store_chain_state
 };   // state_history_plugin_impl
 
 state_history_plugin::state_history_plugin()
     : my(std::make_shared<state_history_plugin_impl>()) {}
 
-state_history_plugin::~state_history_plugin() {}
+state_history_plugin::~state_history_plugin() { my->stop_writer(); }
 
 void state_history_plugin::set_program_options(options_description& cli, options_description& cfg) {
    auto options = cfg.add_options();
@@ -590,11 +959,45 @@ void state_history_plugin::set_program_options(options_description& cli, options
    cli.add_options()("delete-state-history", bpo::bool_switch()->default_value(false), "clear state history files");
    options("trace-history", bpo::bool_switch()->default_value(false), "enable trace history");
    options("chain-state-history", bpo::bool_switch()->default_value(false), "enable chain state history");
+   options("trace-history-columns", bpo::bool_switch()->default_value(false),
+           "also write the actions of the trace history in columns to trace_columns.log, for analytic consumers "
+           "and to filter traces without parsing them; requires trace-history");
    options("state-history-endpoint", bpo::value<string>()->default_value("127.0.0.1:8080"),
            "the endpoint upon which to listen for incoming connections. Caution: only expose this port to "
            "your internal network.");
+   options("state-history-log-stride", bpo::value<uint32_t>()->default_value(0),
+           "split the trace and chain state history logs into segments ending at multiples of this many blocks once "
+           "their last block is irreversible, 0 keeps a single log each");
+   options("max-retained-history-files", bpo::value<uint32_t>()->default_value(std::numeric_limits<uint32_t>::max()),
+           "maximum number of split segments of each state history log to keep, older segments are moved to "
+           "state-history-archive-dir or deleted");
+   options("state-history-retained-dir", bpo::value<bfs::path>()->default_value("retained"),
+           "the location of the split state history log segments, which are still served (absolute path or relative "
+           "to state-history-dir)");
+   options("state-history-archive-dir", bpo::value<bfs::path>()->default_value(""),
+           "the location to move state history log segments beyond max-retained-history-files to (absolute path or "
+           "relative to state-history-dir), empty to delete them");
    options("trace-history-debug-mode", bpo::bool_switch()->default_value(false),
            "enable debug mode for trace history");
+   options("state-history-threads", bpo::value<uint16_t>()->default_value(2),
+           "number of threads running the connections of the state history endpoint and their log reads");
+   options("state-history-read-ahead", bpo::value<uint32_t>()->default_value(8),
+           "number of blocks after one sent to a connection whose log entries are read ahead");
+   options("state-history-session-pipeline", bpo::value<uint32_t>()->default_value(4),
+           "number of results of a connection that are read from the logs concurrently and queued to be sent");
+   options("state-history-filter-cache-size", bpo::value<uint32_t>()->default_value(1024),
+           "number of trace and chain state history entries filtered for connections that are kept for other "
+           "connections with the same filter; 0 to disable");
+   options("state-history-compression-level", bpo::value<int>()->default_value(Z_DEFAULT_COMPRESSION),
+           "zlib compression level of the trace and chain state history entries, from 1 (fastest) to 9 (smallest), "
+           "-1 for the zlib default");
+   options("state-history-dictionary-blocks", bpo::value<uint32_t>()->default_value(0),
+           "train a preset compression dictionary for each history log from the first entries of this many blocks "
+           "and compress the entries written after it with it; 0 to disable. Logs that use a dictionary are not "
+           "readable by versions without support for it");
+   options("state-history-write-queue-size", bpo::value<uint32_t>()->default_value(64),
+           "number of trace and chain state history entries waiting to be compressed and written before block "
+           "processing waits for them");
 }
 
 void state_history_plugin::plugin_initialize(const variables_map& options) {
@@ -605,6 +1008,7 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
       my->chain_plug = app().find_plugin<chain_plugin>();
       EOS_ASSERT(my->chain_plug, chain::missing_chain_plugin_exception, "");
       auto& chain = my->chain_plug->chain();
+      chain.add_trace_consumer();
       my->applied_transaction_connection.emplace(
           chain.applied_transaction.connect([&](std::tuple<const transaction_trace_ptr&, const signed_transaction&> t) {
              my->on_applied_transaction(std::get<0>(t), std::get<1>(t));
@@ -638,12 +1042,52 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
          my->trace_debug_mode = true;
       }
 
+      state_history_log_config log_config;
+      log_config.stride             = options.at("state-history-log-stride").as<uint32_t>();
+      log_config.max_retained_files = options.at("max-retained-history-files").as<uint32_t>();
+      log_config.retained_dir       = options.at("state-history-retained-dir").as<bfs::path>();
+      log_config.archive_dir        = options.at("state-history-archive-dir").as<bfs::path>();
+      if (log_config.retained_dir.is_relative())
+         log_config.retained_dir = state_history_dir / log_config.retained_dir;
+      if (!log_config.archive_dir.empty() && log_config.archive_dir.is_relative())
+         log_config.archive_dir = state_history_dir / log_config.archive_dir;
+
       if (options.at("trace-history").as<bool>())
          my->trace_log.emplace("trace_history", (state_history_dir / "trace_history.log").string(),
-                               (state_history_dir / "trace_history.index").string());
+                               (state_history_dir / "trace_history.index").string(), log_config);
+      if (options.at("trace-history-columns").as<bool>()) {
+         EOS_ASSERT(my->trace_log, plugin_config_exception, "trace-history-columns requires trace-history");
+         my->trace_columns_log.emplace("trace_columns", (state_history_dir / "trace_columns.log").string(),
+                                       (state_history_dir / "trace_columns.index").string(), log_config);
+      }
       if (options.at("chain-state-history").as<bool>())
          my->chain_state_log.emplace("chain_state_history", (state_history_dir / "chain_state_history.log").string(),
-                                     (state_history_dir / "chain_state_history.index").string());
+                                     (state_history_dir / "chain_state_history.index").string(), log_config);
+
+      auto threads = options.at("state-history-threads").as<uint16_t>();
+      EOS_ASSERT(threads > 0, plugin_exception, "state-history-threads must be greater than 0");
+      my->thread_pool.emplace("ship", threads);
+      my->read_ahead_blocks = options.at("state-history-read-ahead").as<uint32_t>();
+      my->max_filter_cache  = options.at("state-history-filter-cache-size").as<uint32_t>();
+      my->session_pipeline  = options.at("state-history-session-pipeline").as<uint32_t>();
+      EOS_ASSERT(my->session_pipeline > 0, plugin_exception, "state-history-session-pipeline must be greater than 0");
+
+      my->compression_level = options.at("state-history-compression-level").as<int>();
+      EOS_ASSERT(my->compression_level == Z_DEFAULT_COMPRESSION ||
+                     (my->compression_level >= 1 && my->compression_level <= 9),
+                 plugin_exception, "state-history-compression-level must be -1 or from 1 to 9");
+      my->dictionary_blocks = options.at("state-history-dictionary-blocks").as<uint32_t>();
+      EOS_ASSERT(my->dictionary_blocks <= 1024, plugin_exception, "state-history-dictionary-blocks must be at most 1024");
+      // the dictionaries are loaded whenever there are any, entries written with one need it to be read
+      if (my->trace_log)
+         my->load_dictionary(*my->trace_log, state_history_dir / "trace_history.dict");
+      if (my->chain_state_log)
+         my->load_dictionary(*my->chain_state_log, state_history_dir / "chain_state_history.dict");
+
+      my->max_write_queue = options.at("state-history-write-queue-size").as<uint32_t>();
+      EOS_ASSERT(my->max_write_queue > 0, plugin_exception, "state-history-write-queue-size must be greater than 0");
+      // started here, the blocks chain_plugin replays on startup are logged before this plugin starts
+      my->start_writer();
    }
    FC_LOG_AND_RETHROW()
 } // state_history_plugin::plugin_initialize
@@ -651,12 +1095,17 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
 void state_history_plugin::plugin_startup() { my->listen(); }
 
 void state_history_plugin::plugin_shutdown() {
+   if (my->applied_transaction_connection)
+      my->chain_plug->chain().remove_trace_consumer();
    my->applied_transaction_connection.reset();
    my->accepted_block_connection.reset();
    my->block_start_connection.reset();
    while (!my->sessions.empty())
       my->sessions.begin()->second->close();
    my->stopping = true;
+   my->stop_writer();
+   if (my->thread_pool)
+      my->thread_pool->stop();
 }
 
 } // namespace eosio
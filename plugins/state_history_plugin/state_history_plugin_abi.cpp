@@ -32,6 +32,25 @@ extern const char* const state_history_plugin_abi = R"({
                 { "name": "fetch_deltas", "type": "bool" }
             ]
         },
+        {
+            "name": "name_filter", "fields": [
+                { "name": "include", "type": "name[]" },
+                { "name": "exclude", "type": "name[]" }
+            ]
+        },
+        {
+            "name": "blocks_filter", "fields": [
+                { "name": "contracts", "type": "name_filter" },
+                { "name": "tables", "type": "name_filter" },
+                { "name": "scopes", "type": "name_filter" },
+                { "name": "actions", "type": "name_filter" }
+            ]
+        },
+        {
+            "name": "get_blocks_request_v1", "base": "get_blocks_request_v0", "fields": [
+                { "name": "filter", "type": "blocks_filter" }
+            ]
+        },
         {
             "name": "get_blocks_ack_request_v0", "fields": [
                 { "name": "num_messages", "type": "uint32" }
@@ -106,6 +125,31 @@ extern const char* const state_history_plugin_abi = R"({
                 { "name": "error_code", "type": "uint64?" }
             ]
         },
+        {
+            "name": "row_access", "fields": [
+                { "name": "code", "type": "name" },
+                { "name": "scope", "type": "name" },
+                { "name": "table", "type": "name" },
+                { "name": "primary_key", "type": "uint64" },
+                { "name": "write", "type": "bool" }
+            ]
+        },
+        {
+            "name": "action_trace_v1", "fields": [
+                { "name": "action_ordinal", "type": "varuint32" },
+                { "name": "creator_action_ordinal", "type": "varuint32" },
+                { "name": "receipt", "type": "action_receipt?" },
+                { "name": "receiver", "type": "name" },
+                { "name": "act", "type": "action" },
+                { "name": "context_free", "type": "bool" },
+                { "name": "elapsed", "type": "int64" },
+                { "name": "console", "type": "string" },
+                { "name": "account_ram_deltas", "type": "account_delta[]" },
+                { "name": "except", "type": "string?" },
+                { "name": "error_code", "type": "uint64?" },
+                { "name": "row_accesses", "type": "row_access[]" }
+            ]
+        },
         {
             "name": "partial_transaction_v0", "fields": [
                 { "name": "expiration", "type": "time_point_sec" },
@@ -249,6 +293,14 @@ extern const char* const state_history_plugin_abi = R"({
                 { "type": "bytes", "name": "value" }
             ]
         },
+        {
+            "name": "contract_kv_v0", "fields": [
+                { "type": "name", "name": "contract" },
+                { "type": "bytes", "name": "key" },
+                { "type": "name", "name": "payer" },
+                { "type": "bytes", "name": "value" }
+            ]
+        },
         {
             "name": "contract_index64_v0", "fields": [
                 { "type": "name", "name": "code" },
@@ -497,11 +549,11 @@ extern const char* const state_history_plugin_abi = R"({
         { "new_type_name": "transaction_id", "type": "checksum256" }
     ],
     "variants": [
-        { "name": "request", "types": ["get_status_request_v0", "get_blocks_request_v0", "get_blocks_ack_request_v0"] },
+        { "name": "request", "types": ["get_status_request_v0", "get_blocks_request_v0", "get_blocks_ack_request_v0", "get_blocks_request_v1"] },
         { "name": "result", "types": ["get_status_result_v0", "get_blocks_result_v0"] },
 
         { "name": "action_receipt", "types": ["action_receipt_v0"] },
-        { "name": "action_trace", "types": ["action_trace_v0"] },
+        { "name": "action_trace", "types": ["action_trace_v0", "action_trace_v1"] },
         { "name": "partial_transaction", "types": ["partial_transaction_v0"] },
         { "name": "transaction_trace", "types": ["transaction_trace_v0"] },
         { "name": "transaction_variant", "types": ["transaction_id", "packed_transaction"] },
@@ -517,6 +569,7 @@ extern const char* const state_history_plugin_abi = R"({
         { "name": "contract_index256", "types": ["contract_index256_v0"] },
         { "name": "contract_index_double", "types": ["contract_index_double_v0"] },
         { "name": "contract_index_long_double", "types": ["contract_index_long_double_v0"] },
+        { "name": "contract_kv", "types": ["contract_kv_v0"] },
         { "name": "chain_config", "types": ["chain_config_v0"] },
         { "name": "global_property", "types": ["global_property_v0", "global_property_v1"] },
         { "name": "generated_transaction", "types": ["generated_transaction_v0"] },
@@ -544,6 +597,7 @@ extern const char* const state_history_plugin_abi = R"({
         { "name": "contract_index256", "type": "contract_index256", "key_names": ["code", "scope", "table", "primary_key"] },
         { "name": "contract_index_double", "type": "contract_index_double", "key_names": ["code", "scope", "table", "primary_key"] },
         { "name": "contract_index_long_double", "type": "contract_index_long_double", "key_names": ["code", "scope", "table", "primary_key"] },
+        { "name": "contract_kv", "type": "contract_kv", "key_names": ["contract", "key"] },
         { "name": "global_property", "type": "global_property", "key_names": [] },
         { "name": "generated_transaction", "type": "generated_transaction", "key_names": ["sender", "sender_id"] },
         { "name": "protocol_state", "type": "protocol_state", "key_names": [] },
@@ -1,34 +1,117 @@
 #include <eosio/trace_api/abi_data_handler.hpp>
 #include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/thread_utils.hpp>
+
+#include <atomic>
+#include <mutex>
 
 namespace eosio::trace_api {
 
+   abi_data_handler::abi_data_handler( exception_handler except_handler, size_t decode_threads )
+   :except_handler( std::move( except_handler ) )
+   ,decode_threads( decode_threads )
+   {
+      if (decode_threads > 0) {
+         thread_pool = std::make_unique<chain::named_thread_pool>( "trcdec", decode_threads );
+      }
+   }
+
+   abi_data_handler::~abi_data_handler() = default;
+
    void abi_data_handler::add_abi( const chain::name& name, const chain::abi_def& abi ) {
       // currently abis are operator provided so no need to protect against abuse
       abi_serializer_by_account.emplace(name,
             std::make_shared<chain::abi_serializer>(abi, chain::abi_serializer::create_yield_function(fc::microseconds::maximum())));
    }
 
-   fc::variant abi_data_handler::process_data(const action_trace_v0& action, const yield_function& yield ) {
-      if (abi_serializer_by_account.count(action.account) > 0) {
-         const auto& serializer_p = abi_serializer_by_account.at(action.account);
+   fc::variant abi_data_handler::decode_data( const action_trace_v0& action, const yield_function& yield ) const {
+      auto itr = abi_serializer_by_account.find(action.account);
+      if (itr != abi_serializer_by_account.end()) {
+         const auto& serializer_p = itr->second;
          auto type_name = serializer_p->get_action_type(action.action);
 
          if (!type_name.empty()) {
+            // abi_serializer expects a yield function that takes a recursion depth
+            auto abi_yield = [yield](size_t recursion_depth) {
+               yield();
+               EOS_ASSERT( recursion_depth < chain::abi_serializer::max_recursion_depth, chain::abi_recursion_depth_exception,
+                           "exceeded max_recursion_depth ${r} ", ("r", chain::abi_serializer::max_recursion_depth) );
+            };
+            return serializer_p->binary_to_variant(type_name, action.data, abi_yield);
+         }
+      }
+
+      return {};
+   }
+
+   fc::variant abi_data_handler::process_data(const action_trace_v0& action, const yield_function& yield ) {
+      try {
+         return decode_data(action, yield);
+      } catch (...) {
+         except_handler(MAKE_EXCEPTION_WITH_CONTEXT(std::current_exception()));
+      }
+
+      return {};
+   }
+
+   std::vector<fc::variant> abi_data_handler::process_data( const std::vector<const action_trace_v0*>& actions, const yield_function& yield ) {
+      std::vector<fc::variant> result(actions.size());
+      if (!thread_pool || actions.size() < min_parallel_batch_size) {
+         for (size_t i = 0; i < actions.size(); ++i) {
+            yield();
+            result[i] = process_data(*actions[i], yield);
+         }
+         return result;
+      }
+
+      // neither yield nor except_handler is expected to be thread safe, the threads take turns calling them and all
+      // of them stop at the first exception yield throws, which is rethrown on the calling thread
+      std::mutex yield_mtx;
+      std::exception_ptr yield_error;
+      std::atomic<bool> stopped = false;
+      auto shared_yield = [&]() {
+         std::lock_guard<std::mutex> g(yield_mtx);
+         if (yield_error) {
+            std::rethrow_exception(yield_error);
+         }
+         try {
+            yield();
+         } catch (...) {
+            yield_error = std::current_exception();
+            stopped = true;
+            throw;
+         }
+      };
+
+      std::mutex except_handler_mtx;
+      std::atomic<size_t> next = 0;
+      auto decode_next = [&]() {
+         for (size_t i = next++; i < actions.size() && !stopped; i = next++) {
             try {
-               // abi_serializer expects a yield function that takes a recursion depth
-               auto abi_yield = [yield](size_t recursion_depth) {
-                  yield();
-                  EOS_ASSERT( recursion_depth < chain::abi_serializer::max_recursion_depth, chain::abi_recursion_depth_exception,
-                              "exceeded max_recursion_depth ${r} ", ("r", chain::abi_serializer::max_recursion_depth) );
-               };
-               return serializer_p->binary_to_variant(type_name, action.data, abi_yield);
+               shared_yield();
+               result[i] = decode_data(*actions[i], shared_yield);
             } catch (...) {
-               except_handler(MAKE_EXCEPTION_WITH_CONTEXT(std::current_exception()));
+               if (!stopped) {
+                  std::lock_guard<std::mutex> g(except_handler_mtx);
+                  except_handler(MAKE_EXCEPTION_WITH_CONTEXT(std::current_exception()));
+               }
             }
          }
+      };
+
+      std::vector<std::future<void>> workers;
+      workers.reserve(decode_threads);
+      for (size_t t = 0; t < decode_threads; ++t) {
+         workers.emplace_back(chain::async_thread_pool(thread_pool->get_executor(), decode_next));
+      }
+      decode_next();
+      for (auto& w : workers) {
+         w.wait();
       }
 
-      return {};
+      if (yield_error) {
+         std::rethrow_exception(yield_error);
+      }
+      return result;
    }
-}
\ No newline at end of file
+}
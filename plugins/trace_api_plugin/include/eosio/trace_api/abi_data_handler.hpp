@@ -7,6 +7,7 @@
 namespace eosio {
    namespace chain {
       struct abi_serializer;
+      class named_thread_pool;
    }
 
    namespace trace_api {
@@ -18,10 +19,13 @@ namespace eosio {
     */
    class abi_data_handler {
    public:
-      explicit abi_data_handler( exception_handler except_handler )
-      :except_handler( std::move( except_handler ) )
-      {
-      }
+      /**
+       * @param except_handler - called with the exceptions of decoding the data of an action
+       * @param decode_threads - the number of worker threads decoding the actions of a batch next to the calling
+       * thread, 0 to decode them on the calling thread only
+       */
+      explicit abi_data_handler( exception_handler except_handler, size_t decode_threads = 0 );
+      ~abi_data_handler();
 
       /**
        * Add an ABI definition to this data handler
@@ -39,6 +43,18 @@ namespace eosio {
        */
       fc::variant process_data( const action_trace_v0& action, const yield_function& yield );
 
+      /**
+       * Given the action traces of a block, produce the variants that represent their `data` fields, decoded on the
+       * worker threads if there are any
+       *
+       * @param actions - traces of the actions
+       * @param yield - a yield function to allow cooperation during long running tasks, it is called by one thread
+       * at a time
+       * @return variants representing the `data` fields of the actions, in the same order as actions
+       * @throws yield_exception if a call to `yield` throws.
+       */
+      std::vector<fc::variant> process_data( const std::vector<const action_trace_v0*>& actions, const yield_function& yield );
+
       /**
        * Utility class that allows mulitple request_handlers to share the same abi_data_handler
        */
@@ -52,11 +68,23 @@ namespace eosio {
             return handler->process_data(action, yield);
          }
 
+         std::vector<fc::variant> process_data( const std::vector<const action_trace_v0*>& actions, const yield_function& yield ) {
+            return handler->process_data(actions, yield);
+         }
+
          std::shared_ptr<abi_data_handler> handler;
       };
 
    private:
+      // decodes the data of action without handling the exceptions of doing so
+      fc::variant decode_data( const action_trace_v0& action, const yield_function& yield ) const;
+
       std::map<chain::name, std::shared_ptr<chain::abi_serializer>> abi_serializer_by_account;
       exception_handler except_handler;
+      const size_t decode_threads;
+      std::unique_ptr<chain::named_thread_pool> thread_pool;
+
+      // batches smaller than this are not worth handing to the worker threads
+      static constexpr size_t min_parallel_batch_size = 32;
    };
 } }
@@ -83,11 +83,21 @@ private:
    void store_block_trace( const chain::block_state_ptr& block_state ) {
       try {
          block_trace_v1 bt = create_block_trace_v1( block_state );
+         // the row accesses of each action, only kept when a trace has any
+         std::vector<std::vector<row_access_v0>> row_accesses;
+         bool has_row_accesses = false;
 
          std::vector<transaction_trace_v1>& traces = bt.transactions_v1;
          traces.reserve( block_state->block->transactions.size() + 1 );
+         auto add_trace = [&]( const cache_trace& t ) {
+            traces.emplace_back( to_transaction_trace_v1( t ));
+            for( auto& rows : to_row_accesses_v0( t )) {
+               has_row_accesses = has_row_accesses || !rows.empty();
+               row_accesses.emplace_back( std::move( rows ));
+            }
+         };
          if( onblock_trace )
-            traces.emplace_back( to_transaction_trace_v1( *onblock_trace ));
+            add_trace( *onblock_trace );
          for( const auto& r : block_state->block->transactions ) {
             transaction_id_type id;
             if( r.trx.contains<transaction_id_type>()) {
@@ -97,12 +107,19 @@ private:
             }
             const auto it = cached_traces.find( id );
             if( it != cached_traces.end() ) {
-               traces.emplace_back( to_transaction_trace_v1( it->second ));
+               add_trace( it->second );
             }
          }
          clear_caches();
 
-         store.append( std::move( bt ) );
+         if( has_row_accesses ) {
+            block_trace_v2 bt2;
+            static_cast<block_trace_v1&>( bt2 ) = std::move( bt );
+            bt2.row_accesses = std::move( row_accesses );
+            store.append( std::move( bt2 ) );
+         } else {
+            store.append( std::move( bt ) );
+         }
 
       } catch( ... ) {
          except_handler( MAKE_EXCEPTION_WITH_CONTEXT( std::current_exception() ) );
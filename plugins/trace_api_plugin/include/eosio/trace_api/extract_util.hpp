@@ -62,6 +62,22 @@ inline transaction_trace_v1 to_transaction_trace_v1( const cache_trace& t ) {
     return r;
 }
 
+/// @return the row accesses of each action of the transaction_trace_v1 of t, in the same order
+inline std::vector<std::vector<row_access_v0>> to_row_accesses_v0( const cache_trace& t ) {
+    std::vector<std::vector<row_access_v0>> r;
+    r.reserve( t.trace->action_traces.size());
+    for( const auto& at : t.trace->action_traces ) {
+        if( !at.context_free ) {
+            auto& rows = r.emplace_back();
+            rows.reserve( at.row_accesses.size());
+            for( const auto& ra : at.row_accesses ) {
+                rows.emplace_back( row_access_v0{ra.code, ra.scope, ra.table, ra.primary_key, ra.write} );
+            }
+        }
+    }
+    return r;
+}
+
 /// @return block_trace_v0 without any transaction_trace_v0
 inline block_trace_v0 create_block_trace_v0( const chain::block_state_ptr& bsp ) {
    block_trace_v0 r;
@@ -15,6 +15,34 @@ namespace eosio { namespace trace_api {
       uint32_t               lib;
    };
 
+   /**
+    * An entry of the transaction id log of a slice, fixed size so the sorted log can be searched in place
+    */
+   struct trx_id_entry_v0 {
+      chain::transaction_id_type id;
+      uint32_t                   block_num;
+   };
+   static constexpr uint32_t trx_id_entry_size = sizeof(chain::transaction_id_type) + sizeof(uint32_t);
+
+   /**
+    * An entry of the account log of a slice, an action of a block that the account received or authorized
+    */
+   struct account_entry_v0 {
+      chain::name account;
+      uint32_t    block_num;
+      uint32_t    action_index; ///< of the action in the block, counting the actions of its transactions in order
+   };
+
+   /**
+    * An entry of the directory of the account index of a slice, locating the posting list of the account
+    */
+   struct account_index_entry_v0 {
+      chain::name account;
+      uint64_t    offset; ///< of the posting list in the index
+      uint32_t    size;   ///< of the posting list in bytes
+   };
+   static constexpr uint32_t account_index_entry_size = sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint32_t);
+
    using metadata_log_entry = fc::static_variant<
       block_entry_v0,
       lib_entry_v0
@@ -24,3 +52,6 @@ namespace eosio { namespace trace_api {
 
 FC_REFLECT(eosio::trace_api::block_entry_v0, (id)(number)(offset));
 FC_REFLECT(eosio::trace_api::lib_entry_v0, (lib));
+FC_REFLECT(eosio::trace_api::trx_id_entry_v0, (id)(block_num));
+FC_REFLECT(eosio::trace_api::account_entry_v0, (account)(block_num)(action_index));
+FC_REFLECT(eosio::trace_api::account_index_entry_v0, (account)(offset)(size));
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 #include <fc/variant.hpp>
 #include <eosio/trace_api/metadata_log.hpp>
 #include <eosio/trace_api/data_log.hpp>
@@ -12,15 +17,32 @@ namespace eosio::trace_api {
       class response_formatter {
       public:
          static fc::variant process_block( const data_log_entry& trace, bool irreversible, const data_handler_function& data_handler, const yield_function& yield );
+
+         /**
+          * @return the transaction trx_id of the block trace with the block it is in, an empty variant if the block
+          * does not have it
+          */
+         static fc::variant process_transaction( const data_log_entry& trace, const chain::transaction_id_type& trx_id, bool irreversible, const data_handler_function& data_handler, const yield_function& yield );
+
+         /**
+          * @return the action at action_index of the block trace with its transaction and block, an empty variant if
+          * the block does not have it or account did not receive or authorize it
+          */
+         static fc::variant process_account_action( const data_log_entry& trace, chain::name account, uint32_t action_index, bool irreversible, const data_handler_function& data_handler, const yield_function& yield );
       };
    }
 
    template<typename LogfileProvider, typename DataHandlerProvider>
    class request_handler {
    public:
-      request_handler(LogfileProvider&& logfile_provider, DataHandlerProvider&& data_handler_provider)
+      /**
+       * @param block_cache_size - the number of irreversible block traces kept for later requests, 0 to read every
+       * block from the logfile_provider
+       */
+      request_handler(LogfileProvider&& logfile_provider, DataHandlerProvider&& data_handler_provider, size_t block_cache_size = 0)
       :logfile_provider(std::move(logfile_provider))
       ,data_handler_provider(std::move(data_handler_provider))
+      ,block_cache_size(block_cache_size)
       {
       }
 
@@ -36,23 +58,207 @@ namespace eosio::trace_api {
        * @throws bad_data_exception when there are issues with the underlying data preventing processing.
        */
       fc::variant get_block_trace( uint32_t block_height, const yield_function& yield = {}) {
-         auto data = logfile_provider.get_block(block_height, yield);
+         auto data = get_block(block_height, yield);
          if (!data) {
             return {};
          }
 
          yield();
 
+         auto data_handler = make_block_data_handler(std::get<0>(*data), yield);
+
+         return detail::response_formatter::process_block(std::get<0>(*data), std::get<1>(*data), data_handler, yield);
+      }
+
+      /**
+       * Fetch the traces of a range of blocks and convert them to a fc::variant for conversion to a final format
+       * (eg JSON)
+       *
+       * @param start_block - the height of the first block whose trace is requested
+       * @param count - the number of blocks in the range
+       * @param yield - a yield function to allow cooperation during long running tasks
+       * @return a properly formatted variant with the traces of the blocks of the range that exist, in block order.
+       * @throws yield_exception if a call to `yield` throws.
+       * @throws bad_data_exception when there are issues with the underlying data preventing processing.
+       */
+      fc::variant get_blocks_trace( uint32_t start_block, uint32_t count, const yield_function& yield = {}) {
+         fc::variants blocks;
+         logfile_provider.get_blocks(start_block, count, [&](uint32_t, data_log_entry&& entry, bool irreversible) -> bool {
+            yield();
+
+            auto data_handler = make_block_data_handler(entry, yield);
+            blocks.emplace_back(detail::response_formatter::process_block(entry, irreversible, data_handler, yield));
+            return true;
+         }, yield);
+
+         return fc::mutable_variant_object()
+            ("blocks", std::move(blocks));
+      }
+
+      /**
+       * Fetch the trace of a given transaction and convert it to a fc::variant for conversion to a final format
+       * (eg JSON)
+       *
+       * @param trx_id - the id of the transaction whose trace is requested
+       * @param yield - a yield function to allow cooperation during long running tasks
+       * @return a properly formatted variant representing the trace of the transaction with the block it is in if
+       * it exists, an empty variant otherwise.
+       * @throws yield_exception if a call to `yield` throws.
+       * @throws bad_data_exception when there are issues with the underlying data preventing processing.
+       */
+      fc::variant get_transaction_trace( const chain::transaction_id_type& trx_id, const yield_function& yield = {}) {
          auto data_handler = [this](const action_trace_v0& action, const yield_function& yield) -> fc::variant {
             return data_handler_provider.process_data(action, yield);
          };
 
-         return detail::response_formatter::process_block(std::get<0>(*data), std::get<1>(*data), data_handler, yield);
+         // the blocks the transaction was appended in, the block of a number may since have been replaced by a fork
+         for (const uint32_t block_height : logfile_provider.get_trx_block_numbers(trx_id, yield)) {
+            auto data = get_block(block_height, yield);
+            if (!data) {
+               continue;
+            }
+
+            yield();
+
+            auto result = detail::response_formatter::process_transaction(std::get<0>(*data), trx_id, std::get<1>(*data), data_handler, yield);
+            if (!result.is_null()) {
+               return result;
+            }
+         }
+         return {};
+      }
+
+      /**
+       * Fetch the actions an account received or authorized, from a given block height, and convert them to a
+       * fc::variant for conversion to a final format (eg JSON)
+       *
+       * @param account - the account whose actions are requested
+       * @param start_block - the lowest block height of the actions
+       * @param limit - the number of actions after which no further blocks are read, the actions of a block are
+       * not split across responses
+       * @param yield - a yield function to allow cooperation during long running tasks
+       * @return a properly formatted variant with the actions and the block height to continue from if there are
+       * more.
+       * @throws yield_exception if a call to `yield` throws.
+       * @throws bad_data_exception when there are issues with the underlying data preventing processing.
+       */
+      fc::variant get_actions( chain::name account, uint32_t start_block, uint32_t limit, const yield_function& yield = {}) {
+         auto data_handler = [this](const action_trace_v0& action, const yield_function& yield) -> fc::variant {
+            return data_handler_provider.process_data(action, yield);
+         };
+
+         fc::variants actions;
+         std::optional<uint32_t> next_block;
+         std::optional<uint32_t> last_block;
+         block_ptr data;
+         logfile_provider.scan_account_actions(account, start_block, [&](uint32_t block_height, uint32_t action_index) -> bool {
+            if (last_block != block_height) {
+               if (actions.size() >= limit) {
+                  next_block = block_height;
+                  return false;
+               }
+               data = get_block(block_height, yield);
+               last_block = block_height;
+            }
+            if (!data) {
+               return true;
+            }
+
+            yield();
+
+            auto result = detail::response_formatter::process_account_action(std::get<0>(*data), account, action_index, std::get<1>(*data), data_handler, yield);
+            if (!result.is_null()) {
+               actions.emplace_back(std::move(result));
+            }
+            return true;
+         }, yield);
+
+         return fc::mutable_variant_object()
+            ("actions", std::move(actions))
+            ("next_block", next_block ? fc::variant(*next_block) : fc::variant());
       }
 
    private:
+      /**
+       * Decode the data of all actions of a block trace in one batch, which the data_handler_provider may spread
+       * across threads, ahead of formatting the block
+       *
+       * @return a data handler returning the decoded data of the actions of trace
+       */
+      data_handler_function make_block_data_handler( const data_log_entry& trace, const yield_function& yield ) {
+         std::vector<const action_trace_v0*> actions;
+         auto collect = [&actions](const auto& transactions) {
+            for (const auto& t : transactions) {
+               for (const auto& a : t.actions) {
+                  actions.push_back(&a);
+               }
+            }
+         };
+         if (trace.contains<block_trace_v0>()) {
+            collect(trace.get<block_trace_v0>().transactions);
+         } else if (trace.contains<block_trace_v1>()) {
+            collect(trace.get<block_trace_v1>().transactions_v1);
+         } else {
+            collect(trace.get<block_trace_v2>().transactions_v1);
+         }
+
+         auto data = data_handler_provider.process_data(actions, yield);
+         auto decoded = std::make_shared<std::unordered_map<const action_trace_v0*, fc::variant>>();
+         decoded->reserve(actions.size());
+         for (size_t i = 0; i < actions.size(); ++i) {
+            decoded->emplace(actions[i], std::move(data[i]));
+         }
+
+         // each action is formatted once, so its data can be moved out
+         return [decoded](const action_trace_v0& action, const yield_function&) -> fc::variant {
+            auto itr = decoded->find(&action);
+            return itr != decoded->end() ? std::move(itr->second) : fc::variant();
+         };
+      }
+
+      using block_ptr = std::shared_ptr<const std::tuple<data_log_entry, bool>>;
+
+      /**
+       * @return the block trace of block_height with its irreversibility, from the cache if it is there
+       */
+      block_ptr get_block( uint32_t block_height, const yield_function& yield ) {
+         if (block_cache_size) {
+            std::lock_guard<std::mutex> g(block_cache_mtx);
+            auto it = block_cache.find(block_height);
+            if (it != block_cache.end()) {
+               block_cache_order.splice(block_cache_order.begin(), block_cache_order, it->second.second);
+               return it->second.first;
+            }
+         }
+
+         auto data = logfile_provider.get_block(block_height, yield);
+         if (!data) {
+            return {};
+         }
+         auto result = std::make_shared<const std::tuple<data_log_entry, bool>>(std::move(*data));
+
+         // a reversible block may still be replaced by a fork
+         if (block_cache_size && std::get<1>(*result)) {
+            std::lock_guard<std::mutex> g(block_cache_mtx);
+            if (block_cache.count(block_height) == 0) {
+               block_cache_order.push_front(block_height);
+               block_cache.emplace(block_height, std::make_pair(result, block_cache_order.begin()));
+               if (block_cache.size() > block_cache_size) {
+                  block_cache.erase(block_cache_order.back());
+                  block_cache_order.pop_back();
+               }
+            }
+         }
+         return result;
+      }
+
       LogfileProvider logfile_provider;
       DataHandlerProvider data_handler_provider;
+
+      const size_t                                                                     block_cache_size;
+      std::mutex                                                                       block_cache_mtx; ///< guards block_cache and block_cache_order
+      std::list<uint32_t>                                                              block_cache_order; ///< most recently used first
+      std::unordered_map<uint32_t, std::pair<block_ptr, std::list<uint32_t>::iterator>> block_cache;
    };
 
 
@@ -4,6 +4,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <exception>
 #include <fc/io/cfile.hpp>
 #include <boost/filesystem.hpp>
 #include <fc/variant.hpp>
@@ -101,7 +102,8 @@ namespace eosio::trace_api {
 
       enum class open_state { read /*read from front to back*/, write /*write to end of file*/ };
       slice_directory(const boost::filesystem::path& slice_dir, uint32_t width, std::optional<uint32_t> minimum_irreversible_history_blocks,
-                      std::optional<uint32_t> minimum_uncompressed_irreversible_history_blocks, size_t compression_seek_point_stride);
+                      std::optional<uint32_t> minimum_uncompressed_irreversible_history_blocks, size_t compression_seek_point_stride,
+                      size_t compression_threads = 1);
 
       /**
        * Return the slice number that would include the passed in block_height
@@ -172,6 +174,91 @@ namespace eosio::trace_api {
        */
       std::optional<compressed_file> find_compressed_trace_slice(uint32_t slice_number, bool open_file = true) const;
 
+      /**
+       * Find or create the transaction id file associated with the indicated slice_number, the trx_id_entry_v0 of
+       * the transactions of its blocks in the order they were appended
+       *
+       * @param slice_number : slice number of the requested slice file
+       * @param state : indicate if the file is going to be written to (appended) or read
+       * @param trx_id_file : the cfile that will be set to the appropriate slice filename
+       *                      and opened to that file
+       * @return the true if file was found (i.e. already existed)
+       */
+      bool find_or_create_trx_id_slice(uint32_t slice_number, open_state state, fc::cfile& trx_id_file) const;
+
+      /**
+       * Find the transaction id file associated with the indicated slice_number
+       *
+       * @param slice_number : slice number of the requested slice file
+       * @param state : indicate if the file is going to be written to (appended) or read
+       * @param trx_id_file : the cfile that will be set to the appropriate slice filename (always)
+       *                      and opened to that file (if it was found)
+       * @param open_file : indicate if the file should be opened (if found) or not
+       * @return the true if file was found (i.e. already existed)
+       */
+      bool find_trx_id_slice(uint32_t slice_number, open_state state, fc::cfile& trx_id_file, bool open_file = true) const;
+
+      /**
+       * Find the sorted transaction id index associated with the indicated slice_number, written by the maintenance
+       * from the transaction id file once the slice is irreversible: an index_header followed by the trx_id_entry_v0
+       * of the slice sorted by id
+       *
+       * @param slice_number : slice number of the requested slice file
+       * @param trx_id_index : the cfile that will be set to the appropriate slice filename (always)
+       *                       and opened to that file (if it was found), positioned after the header
+       * @param open_file : indicate if the file should be opened (if found) or not
+       * @return the true if file was found (i.e. already existed)
+       */
+      bool find_trx_id_index_slice(uint32_t slice_number, fc::cfile& trx_id_index, bool open_file = true) const;
+
+      /**
+       * @return the slice numbers that have a transaction id file or index, highest first
+       */
+      std::vector<uint32_t> trx_id_slice_numbers() const;
+
+      /**
+       * Find or create the account file associated with the indicated slice_number, an account_entry_v0 for each
+       * account that received or authorized an action of its blocks, in the order they were appended
+       *
+       * @param slice_number : slice number of the requested slice file
+       * @param state : indicate if the file is going to be written to (appended) or read
+       * @param account_file : the cfile that will be set to the appropriate slice filename
+       *                       and opened to that file
+       * @return the true if file was found (i.e. already existed)
+       */
+      bool find_or_create_account_slice(uint32_t slice_number, open_state state, fc::cfile& account_file) const;
+
+      /**
+       * Find the account file associated with the indicated slice_number
+       *
+       * @param slice_number : slice number of the requested slice file
+       * @param state : indicate if the file is going to be written to (appended) or read
+       * @param account_file : the cfile that will be set to the appropriate slice filename (always)
+       *                       and opened to that file (if it was found)
+       * @param open_file : indicate if the file should be opened (if found) or not
+       * @return the true if file was found (i.e. already existed)
+       */
+      bool find_account_slice(uint32_t slice_number, open_state state, fc::cfile& account_file, bool open_file = true) const;
+
+      /**
+       * Find the account index associated with the indicated slice_number, written by the maintenance from the
+       * account file once the slice is irreversible: an index_header, the uint32_t number of accounts, an
+       * account_index_entry_v0 for each sorted by account, then the posting list of each, the delta and varint
+       * encoded block numbers and action indexes of its actions
+       *
+       * @param slice_number : slice number of the requested slice file
+       * @param account_index : the cfile that will be set to the appropriate slice filename (always)
+       *                        and opened to that file (if it was found), positioned after the header
+       * @param open_file : indicate if the file should be opened (if found) or not
+       * @return the true if file was found (i.e. already existed)
+       */
+      bool find_account_index_slice(uint32_t slice_number, fc::cfile& account_index, bool open_file = true) const;
+
+      /**
+       * @return the slice numbers that have an account file or index, lowest first
+       */
+      std::vector<uint32_t> account_slice_numbers() const;
+
       /**
        * Find or create a trace and index file pair
        *
@@ -200,7 +287,8 @@ namespace eosio::trace_api {
 
       /**
        * Cleans up all slices that are no longer needed to maintain the minimum number of blocks past lib
-       * Compresses up all slices that can be compressed
+       * Compresses up all slices that can be compressed, several at once with compression_threads
+       * Sorts the transaction ids of all irreversible slices into their indexes
        *
        * @param lib : block number of the current lib
        */
@@ -210,6 +298,7 @@ namespace eosio::trace_api {
       // returns true if slice is found, slice_file will always be set to the appropriate path for
       // the slice_prefix and slice_number, but will only be opened if found
       bool find_slice(const char* slice_prefix, uint32_t slice_number, fc::cfile& slice_file, bool open_file) const;
+      bool find_slice(const char* slice_prefix, const char* slice_ext, uint32_t slice_number, fc::cfile& slice_file, bool open_file) const;
 
       // take an index file that is initialized to a file and open it and write its header
       void create_new_index_slice_file(fc::cfile& index_file) const;
@@ -217,6 +306,18 @@ namespace eosio::trace_api {
       // take an open index slice file and verify its header is valid and prepare the file to be appended to (or read from)
       void validate_existing_index_slice_file(fc::cfile& index_file, open_state state) const;
 
+      // compresses the trace file of a slice and removes it
+      void compress_slice(uint32_t slice_number, const log_handler& log) const;
+
+      // merges the transaction id file of a slice into its sorted index and removes it
+      void sort_trx_id_slice(uint32_t slice_number, const log_handler& log) const;
+
+      // merges the account file of a slice into its index and removes it
+      void sort_account_slice(uint32_t slice_number, const log_handler& log) const;
+
+      // the slice numbers that have a file or an index with slice_prefix, lowest first
+      std::vector<uint32_t> indexed_slice_numbers(const char* slice_prefix) const;
+
       // helper for methods that process irreversible slice files
       template<typename F>
       void process_irreversible_slice_range(uint32_t lib, uint32_t upper_bound_block, std::optional<uint32_t>& lower_bound_slice, F&& f);
@@ -227,7 +328,9 @@ namespace eosio::trace_api {
       std::optional<uint32_t> _last_cleaned_up_slice;
       const std::optional<uint32_t> _minimum_uncompressed_irreversible_history_blocks;
       std::optional<uint32_t> _last_compressed_slice;
+      std::optional<uint32_t> _last_indexed_slice;
       const size_t _compression_seek_point_stride;
+      const size_t _compression_threads;
 
       std::atomic<uint32_t> _best_known_lib{0};
       std::mutex _maintenance_mtx;
@@ -242,11 +345,16 @@ namespace eosio::trace_api {
    class store_provider {
    public:
       using open_state = slice_directory::open_state;
+      using account_action_function = std::function<bool(uint32_t block_num, uint32_t action_index)>;
+      using block_function = std::function<bool(uint32_t block_num, data_log_entry&& entry, bool irreversible)>;
 
       store_provider(const boost::filesystem::path& slice_dir, uint32_t stride_width, std::optional<uint32_t> minimum_irreversible_history_blocks,
-            std::optional<uint32_t> minimum_uncompressed_irreversible_history_blocks, size_t compression_seek_point_stride);
+            std::optional<uint32_t> minimum_uncompressed_irreversible_history_blocks, size_t compression_seek_point_stride,
+            size_t compression_threads = 1, uint32_t group_commit_blocks = 0, bool sync_writes = true);
+      ~store_provider();
 
       void append(const block_trace_v1& bt);
+      void append(const block_trace_v2& bt);
       void append_lib(uint32_t lib);
 
       /**
@@ -257,6 +365,33 @@ namespace eosio::trace_api {
        */
       get_block_t get_block(uint32_t block_height, const yield_function& yield= {});
 
+      /**
+       * Read the traces of a range of blocks, scanning the metadata log and opening the trace file of each slice once
+       * @param start_block : the height of the first block of the range
+       * @param count : the number of blocks in the range
+       * @param fn : called with the block number, the block trace and a flag indicating irreversibility of each
+       *             block of the range that can be read, in block order, returns false to stop reading
+       */
+      void get_blocks(uint32_t start_block, uint32_t count, const block_function& fn, const yield_function& yield= {});
+
+      /**
+       * Find the blocks that a transaction was appended in, by the transaction id files and indexes of the slices
+       * @param trx_id : the id of the transaction
+       * @return the numbers of the blocks, highest slice first. A block may have been forked out since, or
+       *         replaced by one without the transaction
+       */
+      std::vector<uint32_t> get_trx_block_numbers(const chain::transaction_id_type& trx_id, const yield_function& yield= {});
+
+      /**
+       * Scan the actions an account received or authorized, by the account files and indexes of the slices
+       * @param account : the account
+       * @param start_block : the lowest block number of the actions
+       * @param fn : called with the block number and the action index in the block of each action, in block order,
+       *             returns false to stop the scan. A block may have been forked out since, or replaced by one
+       *             without the action
+       */
+      void scan_account_actions(chain::name account, uint32_t start_block, const account_action_function& fn, const yield_function& yield= {});
+
       void start_maintenance_thread( log_handler log ) {
          _slice_directory.start_maintenance_thread( std::move(log) );
       }
@@ -264,8 +399,46 @@ namespace eosio::trace_api {
          _slice_directory.stop_maintenance_thread();
       }
 
+      /**
+       * Start a thread writing what is appended when group_commit_blocks is not 0: all the blocks and libs appended
+       * while it wrote the ones before are written with one write to each file of their slice, synced once, trace
+       * files before the indexes referring to them. Appending waits while group_commit_blocks blocks wait for the
+       * thread, and reads wait for what was appended before them to be written. Without the thread, each block is
+       * written as it is appended.
+       */
+      void start_writer_thread();
+
+      /**
+       * Stop and join the thread writing what is appended, once it wrote all of it
+       */
+      void stop_writer_thread();
 
       protected:
+      // what an append writes: the trace of a block with its metadata and indexes, or a lib entry if lib is set
+      struct pending_write {
+         std::optional<uint32_t> lib;
+         chain::block_id_type    id;
+         uint32_t                block_num = 0;
+         std::vector<char>       trace;     // the packed data_log_entry
+         std::vector<char>       trx_ids;   // the packed trx_id_entry_v0 of its transactions
+         std::vector<char>       accounts;  // the packed account_entry_v0 of the accounts of its actions
+      };
+
+      // appends entry, the block trace bt, to the trace file of its slice with its metadata and indexes
+      void append_block(const data_log_entry& entry, const block_trace_v1& bt);
+
+      // the account entries of the receiver and the authorizers of each action of bt
+      static std::vector<char> pack_accounts(const block_trace_v1& bt);
+
+      // hands w to the writer thread if it runs, writes it otherwise
+      void append_write(pending_write&& w);
+
+      // writes writes in order, at once for each file
+      void write_pending(const std::vector<pending_write>& writes);
+
+      // waits for what was appended to be written, for reads to find it
+      void wait_for_writes();
+
       /**
        * Read the metadata log font-to-back starting at an offset passing each entry to a provided functor/lambda
        *
@@ -351,6 +524,20 @@ namespace eosio::trace_api {
       void validate_existing_index_slice_file(fc::cfile& index, open_state state);
 
       slice_directory _slice_directory;
+
+      const uint32_t _group_commit_blocks;
+      const bool _sync_writes;
+      std::mutex _writer_mtx;
+      std::condition_variable _writer_condition;   // wakes the writer thread
+      std::condition_variable _written_condition;  // wakes appends waiting for room and reads waiting for writes
+      std::thread _writer_thread;
+      bool _writer_running = false;
+      bool _writer_shutdown = false;
+      std::vector<pending_write> _pending;
+      uint32_t _pending_blocks = 0;
+      uint64_t _appended = 0;                      // writes handed to the writer thread
+      uint64_t _written = 0;                       // of the writes handed, those written
+      std::exception_ptr _writer_error;            // rethrown to appends once the writer thread failed
    };
 
 }
@@ -21,6 +21,14 @@ namespace eosio { namespace trace_api {
       chain::bytes                        data = {};
    };
 
+   struct row_access_v0 {
+      chain::name code = {};
+      chain::name scope = {};
+      chain::name table = {};
+      uint64_t    primary_key = 0;
+      bool        write = false;
+   };
+
   struct transaction_trace_v0 {
       using status_type = chain::transaction_receipt_header::status_enum;
 
@@ -52,6 +60,11 @@ namespace eosio { namespace trace_api {
      std::vector<transaction_trace_v1>  transactions_v1 = {};
   };
 
+  /// block trace of a node tracing row accesses
+  struct block_trace_v2 : public block_trace_v1 {
+     std::vector<std::vector<row_access_v0>> row_accesses = {}; ///< of each action of transactions_v1, in order
+  };
+
   struct cache_trace {
       chain::transaction_trace_ptr        trace;
       chain::transaction_header           trx_header;
@@ -62,8 +75,10 @@ namespace eosio { namespace trace_api {
 
 FC_REFLECT(eosio::trace_api::authorization_trace_v0, (account)(permission))
 FC_REFLECT(eosio::trace_api::action_trace_v0, (global_sequence)(receiver)(account)(action)(authorization)(data))
+FC_REFLECT(eosio::trace_api::row_access_v0, (code)(scope)(table)(primary_key)(write))
 FC_REFLECT(eosio::trace_api::transaction_trace_v0, (id)(actions))
 FC_REFLECT_DERIVED(eosio::trace_api::transaction_trace_v1, (eosio::trace_api::transaction_trace_v0), (status)(cpu_usage_us)(net_usage_words)(signatures)(trx_header))
 FC_REFLECT(eosio::trace_api::block_trace_v0, (id)(number)(previous_id)(timestamp)(producer)(transactions))
 FC_REFLECT_DERIVED(eosio::trace_api::block_trace_v1, (eosio::trace_api::block_trace_v0), (transaction_mroot)(action_mroot)(schedule_version)(transactions_v1))
+FC_REFLECT_DERIVED(eosio::trace_api::block_trace_v2, (eosio::trace_api::block_trace_v1), (row_accesses))
 FC_REFLECT(eosio::trace_api::cache_trace, (trace)(trx_header)(trx_signatures))
\ No newline at end of file
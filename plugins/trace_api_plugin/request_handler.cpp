@@ -27,7 +27,58 @@ namespace {
 
    }
 
-   fc::variants process_actions(const std::vector<action_trace_v0>& actions, const data_handler_function& data_handler, const yield_function& yield ) {
+   using block_row_accesses = std::vector<std::vector<row_access_v0>>;
+
+   fc::variants process_row_accesses(const std::vector<row_access_v0>& row_accesses, const yield_function& yield ) {
+      fc::variants result;
+      result.reserve(row_accesses.size());
+      for ( const auto& r: row_accesses) {
+         yield();
+
+         result.emplace_back(fc::mutable_variant_object()
+            ("code", r.code.to_string())
+            ("scope", r.scope.to_string())
+            ("table", r.table.to_string())
+            ("primary_key", r.primary_key)
+            ("write", r.write)
+         );
+      }
+
+      return result;
+   }
+
+   /**
+    * @return the row accesses of the action_count actions of a block from its action first_action, nullptr if the
+    * block trace has none
+    */
+   const std::vector<row_access_v0>* action_row_accesses(const block_row_accesses* rows, size_t first_action, size_t action_count) {
+      if (!rows || first_action + action_count > rows->size()) return nullptr;
+      return rows->data() + first_action;
+   }
+
+   fc::mutable_variant_object process_action(const action_trace_v0& a, const data_handler_function& data_handler, const yield_function& yield, const std::vector<row_access_v0>* rows = nullptr ) {
+      auto action_variant = fc::mutable_variant_object()
+            ("global_sequence", a.global_sequence)
+            ("receiver", a.receiver.to_string())
+            ("account", a.account.to_string())
+            ("action", a.action.to_string())
+            ("authorization", process_authorizations(a.authorization, yield))
+            ("data", fc::to_hex(a.data.data(), a.data.size()));
+
+      auto params = data_handler(a, yield);
+      if (!params.is_null()) {
+         action_variant("params", params);
+      }
+
+      if (rows) {
+         action_variant("row_accesses", process_row_accesses(*rows, yield));
+      }
+
+      return action_variant;
+   }
+
+   /// @param rows - the row accesses of each of actions, nullptr if there are none
+   fc::variants process_actions(const std::vector<action_trace_v0>& actions, const data_handler_function& data_handler, const yield_function& yield, const std::vector<row_access_v0>* rows ) {
       fc::variants result;
       result.reserve(actions.size());
 
@@ -41,60 +92,86 @@ namespace {
       for ( int index : indices) {
          yield();
 
-         const auto& a = actions.at(index);
-         auto action_variant = fc::mutable_variant_object()
-               ("global_sequence", a.global_sequence)
-               ("receiver", a.receiver.to_string())
-               ("account", a.account.to_string())
-               ("action", a.action.to_string())
-               ("authorization", process_authorizations(a.authorization, yield))
-               ("data", fc::to_hex(a.data.data(), a.data.size()));
-
-         auto params = data_handler(a, yield);
-         if (!params.is_null()) {
-            action_variant("params", params);
-         }
-
-         result.emplace_back( std::move(action_variant) );
+         result.emplace_back( process_action(actions.at(index), data_handler, yield, rows ? rows + index : nullptr) );
       }
 
       return result;
 
    }
 
-   fc::variants process_transactions(const std::vector<transaction_trace_v0>& transactions, const data_handler_function& data_handler, const yield_function& yield ) {
+   fc::mutable_variant_object process_transaction(const transaction_trace_v0& t, const data_handler_function& data_handler, const yield_function& yield, const std::vector<row_access_v0>* rows ) {
+      return fc::mutable_variant_object()
+         ("id", t.id.str())
+         ("actions", process_actions(t.actions, data_handler, yield, rows));
+   }
+
+   fc::mutable_variant_object process_transaction(const transaction_trace_v1& t, const data_handler_function& data_handler, const yield_function& yield, const std::vector<row_access_v0>* rows ) {
+      return fc::mutable_variant_object()
+         ("id", t.id.str())
+         ("actions", process_actions(t.actions, data_handler, yield, rows))
+         ("status", t.status)
+         ("cpu_usage_us", t.cpu_usage_us)
+         ("net_usage_words", t.net_usage_words)
+         ("signatures", t.signatures)
+         ("transaction_header", t.trx_header);
+   }
+
+   template<typename TransactionTrace>
+   fc::variants process_transactions(const std::vector<TransactionTrace>& transactions, const data_handler_function& data_handler, const yield_function& yield, const block_row_accesses* rows = nullptr ) {
       fc::variants result;
       result.reserve(transactions.size());
+      size_t first_action = 0;
       for ( const auto& t: transactions) {
          yield();
-
-         result.emplace_back(fc::mutable_variant_object()
-            ("id", t.id.str())
-            ("actions", process_actions(t.actions, data_handler, yield))
-         );
+         result.emplace_back(process_transaction(t, data_handler, yield, action_row_accesses(rows, first_action, t.actions.size())));
+         first_action += t.actions.size();
       }
 
       return result;
    }
 
-    fc::variants process_transactions(const std::vector<transaction_trace_v1>& transactions, const data_handler_function& data_handler, const yield_function& yield ) {
-        fc::variants result;
-        result.reserve(transactions.size());
-        for ( const auto& t: transactions) {
-            yield();
-            result.emplace_back(fc::mutable_variant_object()
-               ("id", t.id.str())
-               ("actions", process_actions(t.actions, data_handler, yield))
-               ("status", t.status)
-               ("cpu_usage_us", t.cpu_usage_us)
-               ("net_usage_words", t.net_usage_words)
-               ("signatures", t.signatures)
-               ("transaction_header", t.trx_header)
-            );
-        }
+   template<typename BlockTrace, typename TransactionTrace>
+   fc::variant process_block_transaction( const BlockTrace& trace, const std::vector<TransactionTrace>& transactions, const eosio::chain::transaction_id_type& trx_id, bool irreversible, const data_handler_function& data_handler, const yield_function& yield, const block_row_accesses* rows = nullptr ) {
+      size_t first_action = 0;
+      for ( const auto& t: transactions) {
+         yield();
+         if (t.id == trx_id) {
+            return process_transaction(t, data_handler, yield, action_row_accesses(rows, first_action, t.actions.size()))
+               ("block_id", trace.id.str())
+               ("block_num", trace.number)
+               ("block_status", irreversible ? "irreversible" : "pending")
+               ("block_timestamp", to_iso8601_datetime(trace.timestamp));
+         }
+         first_action += t.actions.size();
+      }
+      return {};
+   }
 
-        return result;
-    }
+   template<typename BlockTrace, typename TransactionTrace>
+   fc::variant process_block_account_action( const BlockTrace& trace, const std::vector<TransactionTrace>& transactions, eosio::chain::name account, uint32_t action_index, bool irreversible, const data_handler_function& data_handler, const yield_function& yield, const block_row_accesses* rows = nullptr ) {
+      const uint32_t block_action_index = action_index;
+      for ( const auto& t: transactions) {
+         yield();
+         if (action_index >= t.actions.size()) {
+            action_index -= t.actions.size();
+            continue;
+         }
+         const auto& a = t.actions.at(action_index);
+         const bool authorized = std::any_of(a.authorization.begin(), a.authorization.end(), [&account](const authorization_trace_v0& auth) {
+            return auth.account == account;
+         });
+         if (a.receiver != account && !authorized) {
+            return {};
+         }
+         return process_action(a, data_handler, yield, action_row_accesses(rows, block_action_index, 1))
+            ("trx_id", t.id.str())
+            ("block_id", trace.id.str())
+            ("block_num", trace.number)
+            ("block_status", irreversible ? "irreversible" : "pending")
+            ("block_timestamp", to_iso8601_datetime(trace.timestamp));
+      }
+      return {};
+   }
 
 }
 
@@ -110,7 +187,8 @@ namespace eosio::trace_api::detail {
          ("transactions", process_transactions(trace.transactions, data_handler, yield ));
    }
 
-    fc::variant process_block_trace( const block_trace_v1& trace, bool irreversible, const data_handler_function& data_handler, const yield_function& yield ) {
+    /// @param rows - the row accesses of each action of a block_trace_v2, nullptr for a block_trace_v1
+    fc::variant process_block_trace( const block_trace_v1& trace, bool irreversible, const data_handler_function& data_handler, const yield_function& yield, const block_row_accesses* rows = nullptr ) {
         return fc::mutable_variant_object()
         ("id", trace.id.str() )
         ("number", trace.number )
@@ -121,10 +199,40 @@ namespace eosio::trace_api::detail {
         ("transaction_mroot", trace.transaction_mroot)
         ("action_mroot", trace.action_mroot)
         ("schedule_version", trace.schedule_version)
-        ("transactions", process_transactions(trace.transactions_v1, data_handler, yield ));
+        ("transactions", process_transactions(trace.transactions_v1, data_handler, yield, rows ));
     }
     fc::variant response_formatter::process_block( const data_log_entry& trace, bool irreversible, const data_handler_function& data_handler, const yield_function& yield ) {
         if (trace.contains<block_trace_v0>()) return process_block_trace(trace.get<block_trace_v0>(), irreversible, data_handler, yield);
-        else return process_block_trace(trace.get<block_trace_v1>(), irreversible, data_handler, yield);
+        else if (trace.contains<block_trace_v1>()) return process_block_trace(trace.get<block_trace_v1>(), irreversible, data_handler, yield);
+        else {
+            const auto& bt = trace.get<block_trace_v2>();
+            return process_block_trace(bt, irreversible, data_handler, yield, &bt.row_accesses);
+        }
+    }
+
+    fc::variant response_formatter::process_transaction( const data_log_entry& trace, const chain::transaction_id_type& trx_id, bool irreversible, const data_handler_function& data_handler, const yield_function& yield ) {
+        if (trace.contains<block_trace_v0>()) {
+            const auto& bt = trace.get<block_trace_v0>();
+            return process_block_transaction(bt, bt.transactions, trx_id, irreversible, data_handler, yield);
+        } else if (trace.contains<block_trace_v1>()) {
+            const auto& bt = trace.get<block_trace_v1>();
+            return process_block_transaction(bt, bt.transactions_v1, trx_id, irreversible, data_handler, yield);
+        } else {
+            const auto& bt = trace.get<block_trace_v2>();
+            return process_block_transaction(bt, bt.transactions_v1, trx_id, irreversible, data_handler, yield, &bt.row_accesses);
+        }
+    }
+
+    fc::variant response_formatter::process_account_action( const data_log_entry& trace, chain::name account, uint32_t action_index, bool irreversible, const data_handler_function& data_handler, const yield_function& yield ) {
+        if (trace.contains<block_trace_v0>()) {
+            const auto& bt = trace.get<block_trace_v0>();
+            return process_block_account_action(bt, bt.transactions, account, action_index, irreversible, data_handler, yield);
+        } else if (trace.contains<block_trace_v1>()) {
+            const auto& bt = trace.get<block_trace_v1>();
+            return process_block_account_action(bt, bt.transactions_v1, account, action_index, irreversible, data_handler, yield);
+        } else {
+            const auto& bt = trace.get<block_trace_v2>();
+            return process_block_account_action(bt, bt.transactions_v1, account, action_index, irreversible, data_handler, yield, &bt.row_accesses);
+        }
     }
 }
@@ -3,12 +3,18 @@
 #include <fc/variant_object.hpp>
 #include <fc/log/logger_config.hpp>
 
+#include <map>
+#include <set>
+
 namespace {
       static constexpr uint32_t _current_version = 1;
       static constexpr const char* _trace_prefix = "trace_";
       static constexpr const char* _trace_index_prefix = "trace_index_";
+      static constexpr const char* _trace_trx_id_prefix = "trace_trx_";
+      static constexpr const char* _trace_account_prefix = "trace_acct_";
       static constexpr const char* _trace_ext = ".log";
       static constexpr const char* _compressed_trace_ext = ".clog";
+      static constexpr const char* _slice_index_ext = ".idx";
       static constexpr uint _max_filename_size = std::char_traits<char>::length(_trace_index_prefix) + 10 + 1 + 10 + std::char_traits<char>::length(_compressed_trace_ext) + 1; // "trace_index_" + 10-digits + '-' + 10-digits + ".clog" + null-char
 
       std::string make_filename(const char* slice_prefix, const char* slice_ext, uint32_t slice_number, uint32_t slice_width) {
@@ -30,32 +36,310 @@ namespace {
 
 namespace eosio::trace_api {
    namespace bfs = boost::filesystem;
-   store_provider::store_provider(const bfs::path& slice_dir, uint32_t stride_width, std::optional<uint32_t> minimum_irreversible_history_blocks, std::optional<uint32_t> minimum_uncompressed_irreversible_history_blocks, size_t compression_seek_point_stride)
-   : _slice_directory(slice_dir, stride_width, minimum_irreversible_history_blocks, minimum_uncompressed_irreversible_history_blocks, compression_seek_point_stride) {
+
+   namespace {
+      // writes a sorted index of a slice, readers see either the old index or the complete new one
+      void replace_slice_index(const bfs::path& index_path, const std::vector<char>& data) {
+         auto tmp_path = index_path;
+         tmp_path += ".tmp";
+         fc::cfile tmp;
+         tmp.set_file_path(tmp_path);
+         bfs::remove(tmp_path); // left by an interrupted sort
+         tmp.open(fc::cfile::create_or_update_rw_mode);
+         tmp.write(data.data(), data.size());
+         tmp.flush();
+         tmp.sync();
+         tmp.close();
+         bfs::rename(tmp_path, index_path);
+      }
+
+      std::vector<account_entry_v0> read_account_log(fc::cfile& account_file) {
+         std::vector<account_entry_v0> entries;
+         const uint64_t end = file_size(account_file.get_file_path());
+         while (account_file.tellp() < end) {
+            entries.push_back(extract_store<account_entry_v0>(account_file));
+         }
+         return entries;
+      }
+
+      void sort_account_entries(std::vector<account_entry_v0>& entries) {
+         const auto key = [](const account_entry_v0& e) { return std::make_tuple(e.account, e.block_num, e.action_index); };
+         std::sort(entries.begin(), entries.end(), [&key](const account_entry_v0& lhs, const account_entry_v0& rhs) {
+            return key(lhs) < key(rhs);
+         });
+         entries.erase(std::unique(entries.begin(), entries.end(), [&key](const account_entry_v0& lhs, const account_entry_v0& rhs) {
+            return key(lhs) == key(rhs);
+         }), entries.end());
+      }
+
+      // the actions of a posting list, sorted: each is the varint of the difference of its block number from the
+      // one before, then the varint of its action index, or of the difference from the one before in the same block
+      template<typename It>
+      std::vector<char> pack_postings(It begin, It end) {
+         std::vector<char> result;
+         uint32_t block_num = 0;
+         uint32_t action_index = 0;
+         for (auto it = begin; it != end; ++it) {
+            const uint32_t block_delta = it->block_num - block_num;
+            const uint32_t index_value = block_delta ? it->action_index : it->action_index - action_index;
+            const auto posting = fc::raw::pack(std::make_pair(fc::unsigned_int(block_delta), fc::unsigned_int(index_value)));
+            result.insert(result.end(), posting.begin(), posting.end());
+            block_num = it->block_num;
+            action_index = it->action_index;
+         }
+         return result;
+      }
+
+      void unpack_postings(chain::name account, const std::vector<char>& postings, std::vector<account_entry_v0>& entries) {
+         fc::datastream<const char*> ds(postings.data(), postings.size());
+         uint32_t block_num = 0;
+         uint32_t action_index = 0;
+         while (ds.remaining()) {
+            std::pair<fc::unsigned_int, fc::unsigned_int> posting;
+            fc::raw::unpack(ds, posting);
+            action_index = posting.first.value ? posting.second.value : action_index + posting.second.value;
+            block_num += posting.first.value;
+            entries.push_back(account_entry_v0 { .account = account, .block_num = block_num, .action_index = action_index });
+         }
+      }
+
+      // appends the entries of account, or of all accounts if empty, of an open account index to entries
+      void read_account_index(fc::cfile& index, std::optional<chain::name> account, std::vector<account_entry_v0>& entries) {
+         const uint64_t directory_offset = index.tellp() + sizeof(uint32_t);
+         const uint32_t count = extract_store<uint32_t>(index);
+         const auto read_directory_entry = [&index, directory_offset](uint64_t i) {
+            index.seek(directory_offset + i * account_index_entry_size);
+            return extract_store<account_index_entry_v0>(index);
+         };
+         const auto read_postings = [&](const account_index_entry_v0& e) {
+            std::vector<char> postings(e.size);
+            index.seek(e.offset);
+            index.read(postings.data(), postings.size());
+            unpack_postings(e.account, postings, entries);
+         };
+         if (!account) {
+            for (uint64_t i = 0; i < count; ++i) {
+               read_postings(read_directory_entry(i));
+            }
+            return;
+         }
+         uint64_t lower = 0;
+         uint64_t upper = count;
+         while (lower < upper) {
+            const uint64_t mid = lower + (upper - lower) / 2;
+            if (read_directory_entry(mid).account < *account) {
+               lower = mid + 1;
+            } else {
+               upper = mid;
+            }
+         }
+         if (lower < count) {
+            const auto e = read_directory_entry(lower);
+            if (e.account == *account) {
+               read_postings(e);
+            }
+         }
+      }
+   }
+   store_provider::store_provider(const bfs::path& slice_dir, uint32_t stride_width, std::optional<uint32_t> minimum_irreversible_history_blocks, std::optional<uint32_t> minimum_uncompressed_irreversible_history_blocks, size_t compression_seek_point_stride, size_t compression_threads, uint32_t group_commit_blocks, bool sync_writes)
+   : _slice_directory(slice_dir, stride_width, minimum_irreversible_history_blocks, minimum_uncompressed_irreversible_history_blocks, compression_seek_point_stride, compression_threads)
+   , _group_commit_blocks(group_commit_blocks)
+   , _sync_writes(sync_writes) {
+   }
+
+   store_provider::~store_provider() {
+      stop_writer_thread();
    }
 
    void store_provider::append(const block_trace_v1& bt) {
-      fc::cfile trace;
-      fc::cfile index;
-      const uint32_t slice_number = _slice_directory.slice_number(bt.number);
-      _slice_directory.find_or_create_slice_pair(slice_number, open_state::write, trace, index);
-      // storing as static_variant to allow adding other data types to the trace file in the future
-      const uint64_t offset = append_store(data_log_entry { bt }, trace);
+      append_block(data_log_entry { bt }, bt);
+   }
+
+   void store_provider::append(const block_trace_v2& bt) {
+      append_block(data_log_entry { bt }, bt);
+   }
 
-      auto be = metadata_log_entry { block_entry_v0 { .id = bt.id, .number = bt.number, .offset = offset }};
-      append_store(be, index);
+   void store_provider::append_block(const data_log_entry& entry, const block_trace_v1& bt) {
+      // storing as static_variant to allow adding other data types to the trace file in the future
+      pending_write w { .id = bt.id, .block_num = bt.number, .trace = fc::raw::pack(entry) };
+      w.trx_ids.reserve(bt.transactions_v1.size() * trx_id_entry_size);
+      for (const auto& t : bt.transactions_v1) {
+         const auto trx_id = fc::raw::pack(trx_id_entry_v0 { .id = t.id, .block_num = bt.number });
+         w.trx_ids.insert(w.trx_ids.end(), trx_id.begin(), trx_id.end());
+      }
+      w.accounts = pack_accounts(bt);
+      append_write(std::move(w));
    }
 
    void store_provider::append_lib(uint32_t lib) {
-      fc::cfile index;
-      const uint32_t slice_number = _slice_directory.slice_number(lib);
-      _slice_directory.find_or_create_index_slice(slice_number, open_state::write, index);
-      auto le = metadata_log_entry { lib_entry_v0 { .lib = lib }};
-      append_store(le, index);
-      _slice_directory.set_lib(lib);
+      append_write(pending_write { .lib = lib });
+   }
+
+   void store_provider::append_write(pending_write&& w) {
+      std::unique_lock<std::mutex> lock(_writer_mtx);
+      _written_condition.wait(lock, [this, &w]() {
+         return !_writer_running || w.lib || _pending_blocks < _group_commit_blocks;
+      });
+      if (_writer_error) {
+         std::rethrow_exception(_writer_error);
+      }
+      if (_writer_running) {
+         if (!w.lib) {
+            ++_pending_blocks;
+         }
+         _pending.push_back(std::move(w));
+         ++_appended;
+         lock.unlock();
+         _writer_condition.notify_one();
+         return;
+      }
+      lock.unlock();
+      std::vector<pending_write> writes;
+      writes.push_back(std::move(w));
+      write_pending(writes);
+   }
+
+   void store_provider::write_pending(const std::vector<pending_write>& writes) {
+      struct slice_writes {
+         fc::cfile trace;
+         fc::cfile index;
+         bool trace_open = false;
+         bool index_open = false;
+         uint64_t trace_end = 0;
+         std::vector<char> trace_data;
+         std::vector<char> index_data;
+         std::vector<char> trx_id_data;
+         std::vector<char> account_data;
+      };
+      const auto write_file = [this](fc::cfile& file, const std::vector<char>& data) {
+         file.write(data.data(), data.size());
+         file.flush();
+         if (_sync_writes) {
+            file.sync();
+         }
+      };
+
+      std::map<uint32_t, slice_writes> slices;
+      std::optional<uint32_t> lib;
+      for (const auto& w : writes) {
+         if (w.lib) {
+            auto& s = slices[_slice_directory.slice_number(*w.lib)];
+            if (!s.index_open) {
+               _slice_directory.find_or_create_index_slice(_slice_directory.slice_number(*w.lib), open_state::write, s.index);
+               s.index_open = true;
+            }
+            const auto le = fc::raw::pack(metadata_log_entry { lib_entry_v0 { .lib = *w.lib }});
+            s.index_data.insert(s.index_data.end(), le.begin(), le.end());
+            lib = w.lib;
+            continue;
+         }
+         const uint32_t slice_number = _slice_directory.slice_number(w.block_num);
+         auto& s = slices[slice_number];
+         if (!s.trace_open) {
+            if (s.index_open) {
+               _slice_directory.find_or_create_trace_slice(slice_number, open_state::write, s.trace);
+            } else {
+               _slice_directory.find_or_create_slice_pair(slice_number, open_state::write, s.trace, s.index);
+               s.index_open = true;
+            }
+            s.trace_open = true;
+            s.trace_end = s.trace.tellp();
+         }
+         const uint64_t offset = s.trace_end + s.trace_data.size();
+         s.trace_data.insert(s.trace_data.end(), w.trace.begin(), w.trace.end());
+         const auto be = fc::raw::pack(metadata_log_entry { block_entry_v0 { .id = w.id, .number = w.block_num, .offset = offset }});
+         s.index_data.insert(s.index_data.end(), be.begin(), be.end());
+         s.trx_id_data.insert(s.trx_id_data.end(), w.trx_ids.begin(), w.trx_ids.end());
+         s.account_data.insert(s.account_data.end(), w.accounts.begin(), w.accounts.end());
+      }
+
+      // the index entries of a slice are written last, so that a read finding one finds what it refers to
+      for (auto& [slice_number, s] : slices) {
+         if (!s.trace_data.empty()) {
+            write_file(s.trace, s.trace_data);
+         }
+         if (!s.trx_id_data.empty()) {
+            fc::cfile trx_ids;
+            _slice_directory.find_or_create_trx_id_slice(slice_number, open_state::write, trx_ids);
+            write_file(trx_ids, s.trx_id_data);
+         }
+         if (!s.account_data.empty()) {
+            fc::cfile account_file;
+            _slice_directory.find_or_create_account_slice(slice_number, open_state::write, account_file);
+            write_file(account_file, s.account_data);
+         }
+         write_file(s.index, s.index_data);
+      }
+      if (lib) {
+         _slice_directory.set_lib(*lib);
+      }
+   }
+
+   void store_provider::start_writer_thread() {
+      if (_group_commit_blocks == 0) {
+         return;
+      }
+      std::lock_guard<std::mutex> g(_writer_mtx);
+      _writer_running = true;
+      _writer_shutdown = false;
+      _writer_thread = std::thread([this](){
+         fc::set_os_thread_name( "trace-wr" );
+         std::unique_lock<std::mutex> lock(_writer_mtx);
+         while (true) {
+            _writer_condition.wait(lock, [this]() { return !_pending.empty() || _writer_shutdown; });
+            if (_pending.empty()) {
+               break;
+            }
+            // everything appended while the group before was written
+            std::vector<pending_write> group;
+            group.swap(_pending);
+            _pending_blocks = 0;
+            const uint64_t appended = _appended;
+            lock.unlock();
+            _written_condition.notify_all();
+
+            std::exception_ptr error;
+            try {
+               write_pending(group);
+            } catch (...) {
+               error = std::current_exception();
+            }
+            lock.lock();
+            _written = appended;
+            if (error) {
+               // what is not written is dropped, the next append fails
+               _writer_error = error;
+               _pending.clear();
+               _pending_blocks = 0;
+               _written = _appended;
+               break;
+            }
+            _written_condition.notify_all();
+         }
+         _writer_running = false;
+         _written_condition.notify_all();
+      });
+   }
+
+   void store_provider::stop_writer_thread() {
+      {
+         std::lock_guard<std::mutex> g(_writer_mtx);
+         _writer_shutdown = true;
+      }
+      _writer_condition.notify_one();
+      if (_writer_thread.joinable()) {
+         _writer_thread.join();
+      }
+   }
+
+   void store_provider::wait_for_writes() {
+      std::unique_lock<std::mutex> lock(_writer_mtx);
+      const uint64_t appended = _appended;
+      _written_condition.wait(lock, [this, appended]() { return _written >= appended; });
    }
 
    get_block_t store_provider::get_block(uint32_t block_height, const yield_function& yield) {
+      wait_for_writes();
       std::optional<uint64_t> trace_offset;
       bool irreversible = false;
       uint64_t offset = scan_metadata_log_from(block_height, 0, [&block_height, &trace_offset, &irreversible](const metadata_log_entry& e) -> bool {
@@ -83,12 +367,207 @@ namespace eosio::trace_api {
       return std::make_tuple( entry.value(), irreversible );
    }
 
-   slice_directory::slice_directory(const bfs::path& slice_dir, uint32_t width, std::optional<uint32_t> minimum_irreversible_history_blocks, std::optional<uint32_t> minimum_uncompressed_irreversible_history_blocks, size_t compression_seek_point_stride)
+   void store_provider::get_blocks(uint32_t start_block, uint32_t count, const block_function& fn, const yield_function& yield) {
+      wait_for_writes();
+      const uint64_t end_block = std::min<uint64_t>(uint64_t(start_block) + count, uint64_t(std::numeric_limits<uint32_t>::max()) + 1);
+      uint64_t first = start_block;
+      while (first < end_block) {
+         const uint32_t slice_number = _slice_directory.slice_number(first);
+         uint64_t last = first;
+         while (last + 1 < end_block && _slice_directory.slice_number(last + 1) == slice_number) {
+            ++last;
+         }
+
+         // as in get_block, an entry for a block after a lib covering it is ignored
+         std::map<uint32_t, uint64_t> trace_offsets;
+         uint32_t lib = 0;
+         scan_metadata_log_from(first, 0, [&](const metadata_log_entry& e) -> bool {
+            if (e.contains<block_entry_v0>()) {
+               const auto& block = e.get<block_entry_v0>();
+               if (block.number >= first && block.number <= last && block.number > lib) {
+                  trace_offsets[block.number] = block.offset;
+               }
+            } else if (e.contains<lib_entry_v0>()) {
+               lib = std::max(lib, e.get<lib_entry_v0>().lib);
+               if (lib >= last) {
+                  return false;
+               }
+            }
+            return true;
+         }, yield);
+         first = last + 1;
+
+         if (trace_offsets.empty()) {
+            continue;
+         }
+
+         fc::cfile trace;
+         if (_slice_directory.find_trace_slice(slice_number, open_state::read, trace)) {
+            const uint64_t end = file_size(trace.get_file_path());
+            for (const auto& [block_num, offset] : trace_offsets) {
+               if (offset >= end) {
+                  const std::string offset_str = boost::lexical_cast<std::string>(offset);
+                  const std::string bh_str = boost::lexical_cast<std::string>(block_num);
+                  const std::string end_str = boost::lexical_cast<std::string>(end);
+                  throw malformed_slice_file("Requested offset: " + offset_str + " to retrieve block number: " + bh_str + " but this trace file only goes to offset: " + end_str);
+               }
+               yield();
+               trace.seek(offset);
+               if (!fn(block_num, extract_store<data_log_entry>(trace), lib >= block_num)) {
+                  return;
+               }
+            }
+            continue;
+         }
+
+         std::optional<compressed_file> ctrace = _slice_directory.find_compressed_trace_slice(slice_number);
+         if (!ctrace) {
+            const std::string bh_str = boost::lexical_cast<std::string>(trace_offsets.begin()->first);
+            throw malformed_slice_file("Requested block number: " + bh_str + " but this trace file is new, so there are no traces present.");
+         }
+         // the traces of consecutive blocks mostly follow each other, reading on is cheaper than inflating again
+         // from the seek point before each of them
+         std::optional<uint64_t> position;
+         std::vector<char> skipped;
+         for (const auto& [block_num, offset] : trace_offsets) {
+            yield();
+            if (position && *position <= offset) {
+               if (*position < offset) {
+                  skipped.resize(offset - *position);
+                  ctrace->read(skipped.data(), skipped.size());
+               }
+            } else {
+               ctrace->seek(offset);
+            }
+            auto entry = extract_store<data_log_entry>(*ctrace);
+            position = offset + fc::raw::pack_size(entry);
+            if (!fn(block_num, std::move(entry), lib >= block_num)) {
+               return;
+            }
+         }
+      }
+   }
+
+   std::vector<char> store_provider::pack_accounts(const block_trace_v1& bt) {
+      // the receiver and the authorizers of each action, as history_plugin indexed them
+      std::vector<char> data;
+      uint32_t action_index = 0;
+      std::vector<chain::name> accounts;
+      for (const auto& t : bt.transactions_v1) {
+         for (const auto& a : t.actions) {
+            accounts.clear();
+            accounts.push_back(a.receiver);
+            for (const auto& auth : a.authorization) {
+               if (std::find(accounts.begin(), accounts.end(), auth.account) == accounts.end()) {
+                  accounts.push_back(auth.account);
+               }
+            }
+            for (const auto& account : accounts) {
+               const auto entry = fc::raw::pack(account_entry_v0 { .account = account, .block_num = bt.number, .action_index = action_index });
+               data.insert(data.end(), entry.begin(), entry.end());
+            }
+            ++action_index;
+         }
+      }
+      return data;
+   }
+
+   void store_provider::scan_account_actions(chain::name account, uint32_t start_block, const account_action_function& fn, const yield_function& yield) {
+      wait_for_writes();
+      const uint32_t start_slice = _slice_directory.slice_number(start_block);
+      for (const uint32_t slice_number : _slice_directory.account_slice_numbers()) {
+         if (slice_number < start_slice) {
+            continue;
+         }
+         yield();
+         // the actions not yet sorted, only those of the slices that are not irreversible. Read before the index,
+         // which the maintenance writes before it removes them
+         std::vector<account_entry_v0> entries;
+         fc::cfile account_file;
+         if (_slice_directory.find_account_slice(slice_number, open_state::read, account_file)) {
+            for (const auto& e : read_account_log(account_file)) {
+               if (e.account == account) {
+                  entries.push_back(e);
+               }
+            }
+         }
+         fc::cfile index;
+         if (_slice_directory.find_account_index_slice(slice_number, index)) {
+            read_account_index(index, account, entries);
+         }
+         sort_account_entries(entries);
+
+         for (const auto& e : entries) {
+            yield();
+            if (e.block_num >= start_block && !fn(e.block_num, e.action_index)) {
+               return;
+            }
+         }
+      }
+   }
+
+   std::vector<uint32_t> store_provider::get_trx_block_numbers(const chain::transaction_id_type& trx_id, const yield_function& yield) {
+      wait_for_writes();
+      std::vector<uint32_t> result;
+      const auto add_result = [&result](uint32_t block_num) {
+         if (std::find(result.begin(), result.end(), block_num) == result.end()) {
+            result.push_back(block_num);
+         }
+      };
+      for (const uint32_t slice_number : _slice_directory.trx_id_slice_numbers()) {
+         yield();
+         // the ids not yet sorted, only those of the slices that are not irreversible. Read before the index, which
+         // the maintenance writes before it removes them
+         fc::cfile trx_ids;
+         if (_slice_directory.find_trx_id_slice(slice_number, open_state::read, trx_ids)) {
+            const uint64_t end = file_size(trx_ids.get_file_path());
+            while (trx_ids.tellp() < end) {
+               yield();
+               const auto entry = extract_store<trx_id_entry_v0>(trx_ids);
+               if (entry.id == trx_id) {
+                  add_result(entry.block_num);
+               }
+            }
+         }
+
+         fc::cfile index;
+         if (_slice_directory.find_trx_id_index_slice(slice_number, index)) {
+            const uint64_t header_size = index.tellp();
+            const uint64_t count = (file_size(index.get_file_path()) - header_size) / trx_id_entry_size;
+            const auto read_entry = [&index, header_size](uint64_t i) {
+               index.seek(header_size + i * trx_id_entry_size);
+               return extract_store<trx_id_entry_v0>(index);
+            };
+            uint64_t lower = 0;
+            uint64_t upper = count;
+            while (lower < upper) {
+               yield();
+               const uint64_t mid = lower + (upper - lower) / 2;
+               if (read_entry(mid).id < trx_id) {
+                  lower = mid + 1;
+               } else {
+                  upper = mid;
+               }
+            }
+            for (; lower < count; ++lower) {
+               const auto entry = read_entry(lower);
+               if (entry.id != trx_id) {
+                  break;
+               }
+               add_result(entry.block_num);
+            }
+         }
+      }
+      return result;
+   }
+
+   slice_directory::slice_directory(const bfs::path& slice_dir, uint32_t width, std::optional<uint32_t> minimum_irreversible_history_blocks, std::optional<uint32_t> minimum_uncompressed_irreversible_history_blocks, size_t compression_seek_point_stride, size_t compression_threads)
    : _slice_dir(slice_dir)
    , _width(width)
    , _minimum_irreversible_history_blocks(minimum_irreversible_history_blocks)
    , _minimum_uncompressed_irreversible_history_blocks(minimum_uncompressed_irreversible_history_blocks)
    , _compression_seek_point_stride(compression_seek_point_stride)
+   , _compression_threads(std::max<size_t>(compression_threads, 1))
    , _best_known_lib(0) {
       if (!exists(_slice_dir)) {
          bfs::create_directories(slice_dir);
@@ -174,8 +653,210 @@ namespace eosio::trace_api {
       }
    }
 
+   bool slice_directory::find_or_create_trx_id_slice(uint32_t slice_number, open_state state, fc::cfile& trx_id_file) const {
+      const bool found = find_trx_id_slice(slice_number, state, trx_id_file);
+
+      if( !found ) {
+         trx_id_file.open(fc::cfile::create_or_update_rw_mode);
+      }
+
+      return found;
+   }
+
+   bool slice_directory::find_trx_id_slice(uint32_t slice_number, open_state state, fc::cfile& trx_id_file, bool open_file) const {
+      const bool found = find_slice(_trace_trx_id_prefix, slice_number, trx_id_file, open_file);
+
+      if( !found || !open_file ) {
+         return found;
+      }
+
+      if( state == open_state::write ) {
+         trx_id_file.seek_end(0);
+      }
+      return true;
+   }
+
+   bool slice_directory::find_trx_id_index_slice(uint32_t slice_number, fc::cfile& trx_id_index, bool open_file) const {
+      const bool found = find_slice(_trace_trx_id_prefix, _slice_index_ext, slice_number, trx_id_index, open_file);
+      if( !found || !open_file ) {
+         return found;
+      }
+
+      validate_existing_index_slice_file(trx_id_index, open_state::read);
+      return true;
+   }
+
+   bool slice_directory::find_or_create_account_slice(uint32_t slice_number, open_state state, fc::cfile& account_file) const {
+      const bool found = find_account_slice(slice_number, state, account_file);
+
+      if( !found ) {
+         account_file.open(fc::cfile::create_or_update_rw_mode);
+      }
+
+      return found;
+   }
+
+   bool slice_directory::find_account_slice(uint32_t slice_number, open_state state, fc::cfile& account_file, bool open_file) const {
+      const bool found = find_slice(_trace_account_prefix, slice_number, account_file, open_file);
+
+      if( !found || !open_file ) {
+         return found;
+      }
+
+      if( state == open_state::write ) {
+         account_file.seek_end(0);
+      }
+      return true;
+   }
+
+   bool slice_directory::find_account_index_slice(uint32_t slice_number, fc::cfile& account_index, bool open_file) const {
+      const bool found = find_slice(_trace_account_prefix, _slice_index_ext, slice_number, account_index, open_file);
+      if( !found || !open_file ) {
+         return found;
+      }
+
+      validate_existing_index_slice_file(account_index, open_state::read);
+      return true;
+   }
+
+   std::vector<uint32_t> slice_directory::trx_id_slice_numbers() const {
+      std::vector<uint32_t> result = indexed_slice_numbers(_trace_trx_id_prefix);
+      std::reverse(result.begin(), result.end());
+      return result;
+   }
+
+   std::vector<uint32_t> slice_directory::account_slice_numbers() const {
+      return indexed_slice_numbers(_trace_account_prefix);
+   }
+
+   std::vector<uint32_t> slice_directory::indexed_slice_numbers(const char* slice_prefix) const {
+      const std::string prefix = slice_prefix;
+      std::set<uint32_t> slice_numbers;
+      for (const auto& entry : bfs::directory_iterator(_slice_dir)) {
+         const std::string filename = entry.path().filename().generic_string();
+         const std::string ext = entry.path().extension().generic_string();
+         if (filename.compare(0, prefix.size(), prefix) != 0 || (ext != _trace_ext && ext != _slice_index_ext)) {
+            continue;
+         }
+         try {
+            slice_numbers.insert(slice_number(std::stoul(filename.substr(prefix.size(), 10))));
+         } catch (const std::logic_error&) {
+            // not a slice file
+         }
+      }
+      return std::vector<uint32_t>(slice_numbers.begin(), slice_numbers.end());
+   }
+
+   void slice_directory::compress_slice(uint32_t slice_to_compress, const log_handler& log) const {
+      fc::cfile trace;
+      const bool dont_open_file = false;
+      const bool trace_found = find_trace_slice(slice_to_compress, open_state::read, trace, dont_open_file);
+
+      log(std::string("Attempting compression of slice: ") + std::to_string(slice_to_compress));
+
+      if (trace_found) {
+         auto compressed_path = trace.get_file_path();
+         compressed_path.replace_extension(_compressed_trace_ext);
+
+         log(std::string("Compressing: ") + trace.get_file_path().generic_string());
+         compressed_file::process(trace.get_file_path(), compressed_path.generic_string(), _compression_seek_point_stride);
+
+         // after compression is complete, delete the old uncompressed file
+         log(std::string("Removing: ") + trace.get_file_path().generic_string());
+         bfs::remove(trace.get_file_path());
+      }
+   }
+
+   void slice_directory::sort_trx_id_slice(uint32_t slice_number, const log_handler& log) const {
+      fc::cfile trx_ids;
+      if (!find_trx_id_slice(slice_number, open_state::read, trx_ids)) {
+         return;
+      }
+      log(std::string("Sorting: ") + trx_ids.get_file_path().generic_string());
+
+      std::vector<trx_id_entry_v0> entries;
+      const auto read_entries = [&entries](fc::cfile& file) {
+         const uint64_t end = file_size(file.get_file_path());
+         while (file.tellp() < end) {
+            entries.push_back(extract_store<trx_id_entry_v0>(file));
+         }
+      };
+      read_entries(trx_ids);
+      // ids appended after the slice was sorted, e.g. by a replay, are merged into its index
+      fc::cfile index;
+      if (find_trx_id_index_slice(slice_number, index)) {
+         read_entries(index);
+         index.close();
+      }
+      std::sort(entries.begin(), entries.end(), [](const trx_id_entry_v0& lhs, const trx_id_entry_v0& rhs) {
+         return std::tie(lhs.id, lhs.block_num) < std::tie(rhs.id, rhs.block_num);
+      });
+      entries.erase(std::unique(entries.begin(), entries.end(), [](const trx_id_entry_v0& lhs, const trx_id_entry_v0& rhs) {
+         return lhs.id == rhs.id && lhs.block_num == rhs.block_num;
+      }), entries.end());
+
+      std::vector<char> data = fc::raw::pack(index_header { .version = _current_version });
+      data.reserve(data.size() + entries.size() * trx_id_entry_size);
+      for (const auto& e : entries) {
+         const auto entry = fc::raw::pack(e);
+         data.insert(data.end(), entry.begin(), entry.end());
+      }
+      replace_slice_index(index.get_file_path(), data);
+
+      log(std::string("Removing: ") + trx_ids.get_file_path().generic_string());
+      trx_ids.close();
+      bfs::remove(trx_ids.get_file_path());
+   }
+
+   void slice_directory::sort_account_slice(uint32_t slice_number, const log_handler& log) const {
+      fc::cfile accounts;
+      if (!find_account_slice(slice_number, open_state::read, accounts)) {
+         return;
+      }
+      log(std::string("Sorting: ") + accounts.get_file_path().generic_string());
+
+      std::vector<account_entry_v0> entries = read_account_log(accounts);
+      // actions appended after the slice was sorted, e.g. by a replay, are merged into its index
+      fc::cfile index;
+      if (find_account_index_slice(slice_number, index)) {
+         read_account_index(index, {}, entries);
+         index.close();
+      }
+      sort_account_entries(entries);
+
+      // the directory of the accounts, sorted by name, then the posting list of each
+      std::vector<account_index_entry_v0> directory;
+      std::vector<char> postings;
+      for (auto it = entries.begin(); it != entries.end(); ) {
+         const auto end = std::find_if(it, entries.end(), [&it](const account_entry_v0& e) { return e.account != it->account; });
+         const auto list = pack_postings(it, end);
+         directory.push_back(account_index_entry_v0 { .account = it->account, .offset = postings.size(), .size = static_cast<uint32_t>(list.size()) });
+         postings.insert(postings.end(), list.begin(), list.end());
+         it = end;
+      }
+      std::vector<char> data = fc::raw::pack(index_header { .version = _current_version });
+      const auto count = fc::raw::pack(static_cast<uint32_t>(directory.size()));
+      data.insert(data.end(), count.begin(), count.end());
+      const uint64_t postings_offset = data.size() + directory.size() * account_index_entry_size;
+      for (auto& e : directory) {
+         e.offset += postings_offset;
+         const auto entry = fc::raw::pack(e);
+         data.insert(data.end(), entry.begin(), entry.end());
+      }
+      data.insert(data.end(), postings.begin(), postings.end());
+      replace_slice_index(index.get_file_path(), data);
+
+      log(std::string("Removing: ") + accounts.get_file_path().generic_string());
+      accounts.close();
+      bfs::remove(accounts.get_file_path());
+   }
+
    bool slice_directory::find_slice(const char* slice_prefix, uint32_t slice_number, fc::cfile& slice_file, bool open_file) const {
-      auto filename = make_filename(slice_prefix, _trace_ext, slice_number, _width);
+      return find_slice(slice_prefix, _trace_ext, slice_number, slice_file, open_file);
+   }
+
+   bool slice_directory::find_slice(const char* slice_prefix, const char* slice_ext, uint32_t slice_number, fc::cfile& slice_file, bool open_file) const {
+      auto filename = make_filename(slice_prefix, slice_ext, slice_number, _width);
       const path slice_path = _slice_dir / filename;
       slice_file.set_file_path(slice_path);
 
@@ -286,33 +967,73 @@ namespace eosio::trace_api {
                log(std::string("Removing: ") + ctrace->get_file_path().generic_string());
                bfs::remove(ctrace->get_file_path());
             }
+
+            fc::cfile trx_ids;
+            if (find_trx_id_slice(slice_to_clean, open_state::read, trx_ids, dont_open_file)) {
+               log(std::string("Removing: ") + trx_ids.get_file_path().generic_string());
+               bfs::remove(trx_ids.get_file_path());
+            }
+            if (find_trx_id_index_slice(slice_to_clean, trx_ids, dont_open_file)) {
+               log(std::string("Removing: ") + trx_ids.get_file_path().generic_string());
+               bfs::remove(trx_ids.get_file_path());
+            }
+
+            fc::cfile accounts;
+            if (find_account_slice(slice_to_clean, open_state::read, accounts, dont_open_file)) {
+               log(std::string("Removing: ") + accounts.get_file_path().generic_string());
+               bfs::remove(accounts.get_file_path());
+            }
+            if (find_account_index_slice(slice_to_clean, accounts, dont_open_file)) {
+               log(std::string("Removing: ") + accounts.get_file_path().generic_string());
+               bfs::remove(accounts.get_file_path());
+            }
          });
       }
 
+      // the transaction ids and accounts of a slice no longer change once all of its blocks are irreversible
+      process_irreversible_slice_range(lib, 0, _last_indexed_slice, [this, &log](uint32_t slice_to_sort){
+         sort_trx_id_slice(slice_to_sort, log);
+         sort_account_slice(slice_to_sort, log);
+      });
+
       // Only process compression if its configured AND there is a range of irreversible blocks which would not also
       // be deleted
       if (_minimum_uncompressed_irreversible_history_blocks &&
           (!_minimum_irreversible_history_blocks || *_minimum_uncompressed_irreversible_history_blocks < *_minimum_irreversible_history_blocks) )
       {
-         process_irreversible_slice_range(lib, *_minimum_uncompressed_irreversible_history_blocks, _last_compressed_slice, [this, &log](uint32_t slice_to_compress){
-            fc::cfile trace;
-            const bool dont_open_file = false;
-            const bool trace_found = find_trace_slice(slice_to_compress, open_state::read, trace, dont_open_file);
-
-            log(std::string("Attempting compression of slice: ") + std::to_string(slice_to_compress));
-
-            if (trace_found) {
-               auto compressed_path = trace.get_file_path();
-               compressed_path.replace_extension(_compressed_trace_ext);
-
-               log(std::string("Compressing: ") + trace.get_file_path().generic_string());
-               compressed_file::process(trace.get_file_path(), compressed_path.generic_string(), _compression_seek_point_stride);
+         std::vector<uint32_t> slices_to_compress;
+         std::optional<uint32_t> last_slice = _last_compressed_slice;
+         process_irreversible_slice_range(lib, *_minimum_uncompressed_irreversible_history_blocks, last_slice, [&slices_to_compress](uint32_t slice_to_compress){
+            slices_to_compress.push_back(slice_to_compress);
+         });
 
-               // after compression is complete, delete the old uncompressed file
-               log(std::string("Removing: ") + trace.get_file_path().generic_string());
-               bfs::remove(trace.get_file_path());
+         // the slices are compressed by up to _compression_threads threads at once, this one included
+         std::vector<char> compressed(slices_to_compress.size(), false);
+         std::atomic<size_t> next_slice{0};
+         const auto compress_slices = [&]() {
+            for (size_t i = next_slice++; i < slices_to_compress.size(); i = next_slice++) {
+               try {
+                  compress_slice(slices_to_compress[i], log);
+                  compressed[i] = true;
+               } FC_LOG_AND_DROP();
             }
-         });
+         };
+         std::vector<std::thread> threads;
+         for (size_t t = 1; t < std::min<size_t>(_compression_threads, slices_to_compress.size()); ++t) {
+            threads.emplace_back([&compress_slices, t]() {
+               fc::set_os_thread_name( "trace-cmp-" + std::to_string(t) );
+               compress_slices();
+            });
+         }
+         compress_slices();
+         for (auto& thread : threads) {
+            thread.join();
+         }
+
+         // a slice that failed is retried by the next run, with those after it which are already compressed
+         for (size_t i = 0; i < slices_to_compress.size() && compressed[i]; ++i) {
+            _last_compressed_slice = slices_to_compress[i];
+         }
       }
    }
 }
@@ -158,6 +158,15 @@ namespace eosio::trace_api {
          lhs.data == rhs.data;
    }
 
+   bool operator==(const row_access_v0& lhs, const row_access_v0& rhs) {
+      return
+         lhs.code == rhs.code &&
+         lhs.scope == rhs.scope &&
+         lhs.table == rhs.table &&
+         lhs.primary_key == rhs.primary_key &&
+         lhs.write == rhs.write;
+   }
+
    bool operator==(const transaction_trace_v0& lhs,  const transaction_trace_v0& rhs) {
       return
          lhs.id == rhs.id &&
@@ -5,6 +5,8 @@
 
 #include <eosio/trace_api/test_common.hpp>
 
+#include <atomic>
+
 using namespace eosio;
 using namespace eosio::trace_api;
 using namespace eosio::trace_api::test_common;
@@ -123,4 +125,85 @@ BOOST_AUTO_TEST_SUITE(abi_data_handler_tests)
       BOOST_TEST(log_called);
    }
 
+   BOOST_AUTO_TEST_CASE(basic_abi_parallel_batch)
+   {
+      auto abi = chain::abi_def ( {},
+         {
+            { "foo", "", { {"a", "varuint32"}, {"b", "varuint32"}, {"c", "varuint32"}, {"d", "varuint32"} } }
+         },
+         {
+            { "foo"_n, "foo", ""}
+         },
+         {}, {}, {}
+      );
+      abi.version = "eosio::abi/1.";
+
+      std::vector<action_trace_v0> traces;
+      for (uint32_t i = 0; i < 100; ++i) {
+         traces.emplace_back(action_trace_v0 {
+            i, "alice"_n, "alice"_n, "foo"_n, {}, {static_cast<char>(i), 0x01, 0x02, 0x03}
+         });
+      }
+      // one action without enough data to decode
+      traces.emplace_back(action_trace_v0 {
+         100, "alice"_n, "alice"_n, "foo"_n, {}, {0x00, 0x01, 0x02}
+      });
+      std::vector<const action_trace_v0*> actions;
+      for (const auto& t : traces) {
+         actions.push_back(&t);
+      }
+
+      std::atomic<int> log_called = 0;
+      abi_data_handler handler([&log_called](const exception_with_context& ){++log_called;}, 2);
+      handler.add_abi("alice"_n, abi);
+
+      auto actual = handler.process_data(actions, [](){});
+
+      BOOST_REQUIRE_EQUAL(actual.size(), actions.size());
+      for (uint32_t i = 0; i < 100; ++i) {
+         fc::variant expected = fc::mutable_variant_object()
+            ("a", i)
+            ("b", 1)
+            ("c", 2)
+            ("d", 3);
+         BOOST_TEST(to_kv(expected) == to_kv(actual.at(i)), boost::test_tools::per_element());
+      }
+      BOOST_TEST(actual.back().is_null());
+      BOOST_TEST(log_called == 1);
+   }
+
+   BOOST_AUTO_TEST_CASE(parallel_batch_yield_throws)
+   {
+      auto abi = chain::abi_def ( {},
+         {
+            { "foo", "", { {"a", "varuint32"} } }
+         },
+         {
+            { "foo"_n, "foo", ""}
+         },
+         {}, {}, {}
+      );
+      abi.version = "eosio::abi/1.";
+
+      auto trace = action_trace_v0 {
+         0, "alice"_n, "alice"_n, "foo"_n, {}, {0x00}
+      };
+      std::vector<const action_trace_v0*> actions(100, &trace);
+
+      bool log_called = false;
+      abi_data_handler handler([&log_called](const exception_with_context& ){log_called = true;}, 2);
+      handler.add_abi("alice"_n, abi);
+
+      // not thread safe, the handler must not call it concurrently
+      int countdown = 50;
+      yield_function yield = [&countdown]() {
+         if (--countdown == 0) {
+            throw yield_exception("mock");
+         }
+      };
+
+      BOOST_REQUIRE_THROW(handler.process_data(actions, yield), yield_exception);
+      BOOST_TEST(!log_called);
+   }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -116,6 +116,10 @@ struct extraction_test_fixture {
          fixture.data_log.emplace_back(entry);
       }
 
+      void append( const block_trace_v2& entry ) {
+         fixture.data_log.emplace_back(entry);
+      }
+
       void append_lib( uint32_t lib ) {
          fixture.max_lib = std::max(fixture.max_lib, lib);
       }
@@ -389,4 +393,41 @@ BOOST_AUTO_TEST_SUITE(block_extraction)
       BOOST_REQUIRE_EQUAL(data_log.at(0).get<block_trace_v1>(), expected_trace);
    }
 
+   BOOST_FIXTURE_TEST_CASE(row_accesses_transaction_block, extraction_test_fixture)
+   {
+      auto act1 = make_transfer_action( "alice"_n, "bob"_n, "0.0001 SYS"_t, "Memo!" );
+      auto act2 = make_transfer_action( "alice"_n, "bob"_n, "0.0001 SYS"_t, "Memo!" );
+      auto actt1 = make_action_trace( 0, act1, "eosio.token"_n );
+      auto actt2 = make_action_trace( 1, act2, "alice"_n );
+      actt1.row_accesses = {
+         { "eosio.token"_n, "alice"_n, "accounts"_n, 5459781, true },
+         { "eosio.token"_n, "bob"_n, "accounts"_n, 5459781, false }
+      };
+      auto ptrx1 = make_packed_trx( { act1, act2 } );
+
+      signal_applied_transaction(
+            make_transaction_trace( ptrx1.id(), 1, 1, chain::transaction_receipt_header::executed,
+                  { actt1, actt2 } ),
+            ptrx1.get_signed_transaction() );
+
+      auto bsp1 = make_block_state( chain::block_id_type(), 1, 1, "bp.one"_n,
+            { chain::packed_transaction(ptrx1) } );
+      signal_accepted_block( bsp1 );
+
+      const std::vector<std::vector<row_access_v0>> expected_row_accesses = {
+         {
+            { "eosio.token"_n, "alice"_n, "accounts"_n, 5459781, true },
+            { "eosio.token"_n, "bob"_n, "accounts"_n, 5459781, false }
+         },
+         {}
+      };
+
+      BOOST_REQUIRE(data_log.size() == 1);
+      BOOST_REQUIRE(data_log.at(0).contains<block_trace_v2>());
+      const auto& bt = data_log.at(0).get<block_trace_v2>();
+      BOOST_REQUIRE_EQUAL(bt.transactions_v1.size(), 1);
+      BOOST_REQUIRE_EQUAL(bt.transactions_v1.at(0).actions.size(), 2);
+      BOOST_REQUIRE(bt.row_accesses == expected_row_accesses);
+   }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -29,6 +29,27 @@ struct response_test_fixture {
       get_block_t get_block(uint32_t height, const yield_function& yield= {}) {
          return fixture.mock_get_block(height, yield);
       }
+
+      void get_blocks(uint32_t start_block, uint32_t count, const std::function<bool(uint32_t, data_log_entry&&, bool)>& fn, const yield_function& yield= {}) {
+         for (uint32_t height = start_block; height - start_block < count; ++height) {
+            auto data = fixture.mock_get_block(height, yield);
+            if (data && !fn(height, std::move(std::get<0>(*data)), std::get<1>(*data))) {
+               break;
+            }
+         }
+      }
+
+      std::vector<uint32_t> get_trx_block_numbers(const chain::transaction_id_type& trx_id, const yield_function& yield= {}) {
+         return fixture.mock_get_trx_block_numbers(trx_id, yield);
+      }
+
+      void scan_account_actions(chain::name account, uint32_t start_block, const std::function<bool(uint32_t, uint32_t)>& fn, const yield_function& yield= {}) {
+         for (const auto& a : fixture.mock_account_actions(account, start_block)) {
+            if (!fn(a.first, a.second)) {
+               break;
+            }
+         }
+      }
       response_test_fixture& fixture;
    };
 
@@ -46,6 +67,15 @@ struct response_test_fixture {
          return fixture.mock_data_handler(action, yield);
       }
 
+      std::vector<fc::variant> process_data(const std::vector<const action_trace_v0*>& actions, const yield_function& yield) {
+         std::vector<fc::variant> result;
+         for (const auto* action : actions) {
+            yield();
+            result.emplace_back(fixture.mock_data_handler(*action, yield));
+         }
+         return result;
+      }
+
       response_test_fixture& fixture;
    };
 
@@ -63,8 +93,22 @@ struct response_test_fixture {
       return response_impl.get_block_trace( block_height, yield );
    }
 
+   fc::variant get_transaction_trace( const chain::transaction_id_type& trx_id, const yield_function& yield = {} ) {
+      return response_impl.get_transaction_trace( trx_id, yield );
+   }
+
+   fc::variant get_blocks_trace( uint32_t start_block, uint32_t count, const yield_function& yield = {} ) {
+      return response_impl.get_blocks_trace( start_block, count, yield );
+   }
+
+   fc::variant get_actions( chain::name account, uint32_t start_block, uint32_t limit, const yield_function& yield = {} ) {
+      return response_impl.get_actions( account, start_block, limit, yield );
+   }
+
    // fixture data and methods
    std::function<get_block_t(uint32_t, const yield_function&)> mock_get_block;
+   std::function<std::vector<uint32_t>(const chain::transaction_id_type&, const yield_function&)> mock_get_trx_block_numbers;
+   std::function<std::vector<std::pair<uint32_t, uint32_t>>(chain::name, uint32_t)> mock_account_actions;
    std::function<fc::variant(const action_trace_v0&, const yield_function&)> mock_data_handler = default_mock_data_handler;
 
    response_impl_type response_impl;
@@ -605,4 +649,268 @@ BOOST_AUTO_TEST_SUITE(trace_responses)
       BOOST_TEST(to_kv(expected_response) == to_kv(actual_response), boost::test_tools::per_element());
    }
 
+
+   BOOST_FIXTURE_TEST_CASE(transaction_response, response_test_fixture)
+   {
+      auto block_trace = block_trace_v0 {
+         "b000000000000000000000000000000000000000000000000000000000000001"_h,
+         1,
+         "0000000000000000000000000000000000000000000000000000000000000000"_h,
+         chain::block_timestamp_type(0),
+         "bp.one"_n,
+         {
+            {
+               "0000000000000000000000000000000000000000000000000000000000000001"_h,
+               {}
+            },
+            {
+               "0000000000000000000000000000000000000000000000000000000000000002"_h,
+               {
+                  {
+                     0,
+                     "receiver"_n, "contract"_n, "action"_n,
+                     {{ "alice"_n, "active"_n }},
+                     { 0x00, 0x01, 0x02, 0x03 }
+                  }
+               }
+            }
+         }
+      };
+
+      fc::variant expected_response = fc::mutable_variant_object()
+         ("id", "0000000000000000000000000000000000000000000000000000000000000002")
+         ("actions", fc::variants({
+            fc::mutable_variant_object()
+               ("global_sequence", 0)
+               ("receiver", "receiver")
+               ("account", "contract")
+               ("action", "action")
+               ("authorization", fc::variants({
+                  fc::mutable_variant_object()
+                     ("account", "alice")
+                     ("permission", "active")
+               }))
+               ("data", "00010203")
+               ("params", fc::mutable_variant_object()
+                  ("hex", "00010203")
+               )
+         }))
+         ("block_id", "b000000000000000000000000000000000000000000000000000000000000001")
+         ("block_num", 1)
+         ("block_status", "irreversible")
+         ("block_timestamp", "2000-01-01T00:00:00.000Z")
+      ;
+
+      const auto trx_id = "0000000000000000000000000000000000000000000000000000000000000002"_h;
+      // block 3 was appended with the transaction but has since been replaced by one without it
+      mock_get_trx_block_numbers = [&trx_id]( const chain::transaction_id_type& id, const yield_function& ) -> std::vector<uint32_t> {
+         BOOST_TEST(id == trx_id);
+         return { 3, 1 };
+      };
+      mock_get_block = [&block_trace]( uint32_t height, const yield_function& ) -> get_block_t {
+         if (height == 3) {
+            auto replaced = block_trace;
+            replaced.number = 3;
+            replaced.transactions.clear();
+            return std::make_tuple(data_log_entry(replaced), false);
+         }
+         BOOST_TEST(height == 1);
+         return std::make_tuple(data_log_entry(block_trace), true);
+      };
+
+      fc::variant actual_response = get_transaction_trace( trx_id );
+
+      BOOST_TEST(to_kv(expected_response) == to_kv(actual_response), boost::test_tools::per_element());
+   }
+
+   BOOST_FIXTURE_TEST_CASE(missing_transaction_data, response_test_fixture)
+   {
+      mock_get_trx_block_numbers = []( const chain::transaction_id_type&, const yield_function& ) -> std::vector<uint32_t> {
+         return {};
+      };
+
+      fc::variant null_response = get_transaction_trace( "0000000000000000000000000000000000000000000000000000000000000001"_h );
+
+      BOOST_TEST(null_response.is_null());
+   }
+
+
+   BOOST_FIXTURE_TEST_CASE(account_actions_response, response_test_fixture)
+   {
+      const auto make_block = [](uint32_t number) {
+         return block_trace_v0 {
+            "b000000000000000000000000000000000000000000000000000000000000001"_h,
+            number,
+            "0000000000000000000000000000000000000000000000000000000000000000"_h,
+            chain::block_timestamp_type(0),
+            "bp.one"_n,
+            {
+               {
+                  "0000000000000000000000000000000000000000000000000000000000000001"_h,
+                  {
+                     {
+                        0,
+                        "receiver"_n, "contract"_n, "action"_n,
+                        {{ "alice"_n, "active"_n }},
+                        { 0x00, 0x01, 0x02, 0x03 }
+                     }
+                  }
+               },
+               {
+                  "0000000000000000000000000000000000000000000000000000000000000002"_h,
+                  {
+                     {
+                        1,
+                        "bob"_n, "contract"_n, "action"_n,
+                        {{ "bob"_n, "active"_n }},
+                        { 0x04 }
+                     }
+                  }
+               }
+            }
+         };
+      };
+
+      const auto expected_action = [](uint32_t number) {
+         return fc::mutable_variant_object()
+            ("global_sequence", 0)
+            ("receiver", "receiver")
+            ("account", "contract")
+            ("action", "action")
+            ("authorization", fc::variants({
+               fc::mutable_variant_object()
+                  ("account", "alice")
+                  ("permission", "active")
+            }))
+            ("data", "00010203")
+            ("params", fc::mutable_variant_object()
+               ("hex", "00010203")
+            )
+            ("trx_id", "0000000000000000000000000000000000000000000000000000000000000001")
+            ("block_id", "b000000000000000000000000000000000000000000000000000000000000001")
+            ("block_num", number)
+            ("block_status", "pending")
+            ("block_timestamp", "2000-01-01T00:00:00.000Z");
+      };
+
+      // the action at index 1 of block 2 is bob's, e.g. left by a fork, and is not returned
+      mock_account_actions = []( chain::name account, uint32_t start_block ) -> std::vector<std::pair<uint32_t, uint32_t>> {
+         BOOST_TEST(account == "alice"_n);
+         BOOST_TEST(start_block == 1);
+         return { {1, 0}, {2, 0}, {2, 1}, {3, 0} };
+      };
+      mock_get_block = [&make_block]( uint32_t height, const yield_function& ) -> get_block_t {
+         return std::make_tuple(data_log_entry(make_block(height)), false);
+      };
+
+      fc::variant expected_response = fc::mutable_variant_object()
+         ("actions", fc::variants({ expected_action(1), expected_action(2) }))
+         ("next_block", 3);
+
+      fc::variant actual_response = get_actions( "alice"_n, 1, 2 );
+
+      BOOST_TEST(to_kv(expected_response) == to_kv(actual_response), boost::test_tools::per_element());
+
+      expected_response = fc::mutable_variant_object()
+         ("actions", fc::variants({ expected_action(1), expected_action(2), expected_action(3) }))
+         ("next_block", fc::variant());
+
+      actual_response = get_actions( "alice"_n, 1, 10 );
+
+      BOOST_TEST(to_kv(expected_response) == to_kv(actual_response), boost::test_tools::per_element());
+   }
+
+   BOOST_FIXTURE_TEST_CASE(blocks_response, response_test_fixture)
+   {
+      auto make_block = []( uint32_t height ) {
+         return block_trace_v1{
+            {
+               "b000000000000000000000000000000000000000000000000000000000000001"_h,
+               height,
+               "0000000000000000000000000000000000000000000000000000000000000000"_h,
+               chain::block_timestamp_type(0),
+               "bp.one"_n
+            },
+            "0000000000000000000000000000000000000000000000000000000000000000"_h,
+            "0000000000000000000000000000000000000000000000000000000000000000"_h,
+            0,
+            {}
+         };
+      };
+
+      auto expected_block = []( uint32_t height, const char* status ) -> fc::variant {
+         return fc::mutable_variant_object()
+            ("id", "b000000000000000000000000000000000000000000000000000000000000001")
+            ("number", height)
+            ("previous_id", "0000000000000000000000000000000000000000000000000000000000000000")
+            ("status", status)
+            ("timestamp", "2000-01-01T00:00:00.000Z")
+            ("producer", "bp.one")
+            ("transaction_mroot", "0000000000000000000000000000000000000000000000000000000000000000")
+            ("action_mroot", "0000000000000000000000000000000000000000000000000000000000000000")
+            ("schedule_version", 0)
+            ("transactions", fc::variants() );
+      };
+
+      // block 3 is missing
+      mock_get_block = [&make_block]( uint32_t height, const yield_function& ) -> get_block_t {
+         if (height == 3) {
+            return {};
+         }
+         return std::make_tuple(data_log_entry(make_block(height)), height < 3);
+      };
+
+      fc::variant expected_response = fc::mutable_variant_object()
+         ("blocks", fc::variants({ expected_block(1, "irreversible"), expected_block(2, "irreversible"), expected_block(4, "pending") }));
+
+      fc::variant actual_response = get_blocks_trace( 1, 4 );
+
+      BOOST_TEST(to_kv(expected_response) == to_kv(actual_response), boost::test_tools::per_element());
+   }
+
+   BOOST_FIXTURE_TEST_CASE(block_cache, response_test_fixture)
+   {
+      auto make_block = []( uint32_t height ) {
+         return block_trace_v1{
+            {
+               "b000000000000000000000000000000000000000000000000000000000000001"_h,
+               height,
+               "0000000000000000000000000000000000000000000000000000000000000000"_h,
+               chain::block_timestamp_type(0),
+               "bp.one"_n
+            },
+            "0000000000000000000000000000000000000000000000000000000000000000"_h,
+            "0000000000000000000000000000000000000000000000000000000000000000"_h,
+            0,
+            {}
+         };
+      };
+
+      std::map<uint32_t, uint32_t> reads;
+      mock_get_block = [&make_block, &reads]( uint32_t height, const yield_function& ) -> get_block_t {
+         ++reads[height];
+         return std::make_tuple(data_log_entry(make_block(height)), height < 3);
+      };
+
+      response_impl_type cached(mock_logfile_provider(*this), mock_data_handler_provider(*this), 1);
+
+      // irreversible blocks are kept until evicted by another one
+      fc::variant first = cached.get_block_trace( 1 );
+      fc::variant second = cached.get_block_trace( 1 );
+      BOOST_TEST(to_kv(first) == to_kv(second), boost::test_tools::per_element());
+      BOOST_TEST(reads[1] == 1u);
+
+      cached.get_block_trace( 2 );
+      cached.get_block_trace( 1 );
+      BOOST_TEST(reads[2] == 1u);
+      BOOST_TEST(reads[1] == 2u);
+
+      // reversible blocks are read every time
+      cached.get_block_trace( 3 );
+      cached.get_block_trace( 3 );
+      BOOST_TEST(reads[3] == 2u);
+      cached.get_block_trace( 1 );
+      BOOST_TEST(reads[1] == 2u);
+   }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 #include <eosio/trace_api/test_common.hpp>
 #include <eosio/trace_api/store_provider.hpp>
 #include <boost/filesystem.hpp>
+#include <fstream>
 
 using namespace eosio;
 using namespace eosio::trace_api;
@@ -653,6 +654,42 @@ BOOST_AUTO_TEST_SUITE(slice_tests)
       }
    }
 
+   BOOST_FIXTURE_TEST_CASE(slice_dir_compress_parallel, test_fixture)
+   {
+      fc::temp_directory tempdir;
+      const uint32_t width = 10;
+      const uint32_t min_uncompressed_blocks = 5;
+      slice_directory sd(tempdir.path(), width, std::optional<uint32_t>(), std::optional<uint32_t>(min_uncompressed_blocks), 8, 3);
+      fc::cfile file;
+
+      std::set<bfs::path> files;
+      std::vector<std::pair<bfs::path, bfs::path>> trace_paths;
+      for (int i = 0; i < 7 ; i++) {
+         BOOST_REQUIRE(!sd.find_or_create_index_slice(i, open_state::read, file));
+         files.insert(file.get_file_path().filename());
+         BOOST_REQUIRE(create_non_empty_trace_slice(sd, i, file));
+         auto trace_name = file.get_file_path().filename();
+         auto compressed_trace_name = trace_name;
+         compressed_trace_name.replace_extension(".clog");
+         files.insert(trace_name);
+         trace_paths.emplace_back(trace_name, compressed_trace_name);
+      }
+
+      // a lib past the first 5 slices compresses them at once, more slices than threads
+      for (int i = 0; i < 5; i++) {
+         files.erase(trace_paths.at(i).first);
+         files.insert(trace_paths.at(i).second);
+      }
+      sd.run_maintenance_tasks(55, {});
+      verify_directory_contents(tempdir.path(), files);
+
+      // and continues after them
+      files.erase(trace_paths.at(5).first);
+      files.insert(trace_paths.at(5).second);
+      sd.run_maintenance_tasks(65, {});
+      verify_directory_contents(tempdir.path(), files);
+   }
+
    BOOST_FIXTURE_TEST_CASE(slice_dir_compress_and_delete, test_fixture)
    {
       fc::temp_directory tempdir;
@@ -853,4 +890,185 @@ BOOST_AUTO_TEST_SUITE(slice_tests)
       BOOST_REQUIRE(!block2);
    }
 
+   BOOST_FIXTURE_TEST_CASE(test_get_blocks, test_fixture)
+   {
+      fc::temp_directory tempdir;
+      store_provider sp(tempdir.path(), 4, std::optional<uint32_t>(), std::optional<uint32_t>(), 0);
+      sp.append(bt);
+      sp.append_lib(1);
+      sp.append(bt2);
+
+      std::vector<std::tuple<uint32_t, data_log_entry, bool>> blocks;
+      auto collect = [&blocks](uint32_t block_num, data_log_entry&& entry, bool irreversible) {
+         blocks.emplace_back(block_num, std::move(entry), irreversible);
+         return true;
+      };
+
+      // the range spans both slices
+      sp.get_blocks(0, 8, collect);
+      BOOST_REQUIRE_EQUAL(blocks.size(), 2u);
+      BOOST_REQUIRE_EQUAL(std::get<0>(blocks[0]), 1u);
+      BOOST_REQUIRE_EQUAL(std::get<1>(blocks[0]), bt);
+      BOOST_REQUIRE(std::get<2>(blocks[0]));
+      BOOST_REQUIRE_EQUAL(std::get<0>(blocks[1]), 5u);
+      BOOST_REQUIRE_EQUAL(std::get<1>(blocks[1]), bt2);
+      BOOST_REQUIRE(!std::get<2>(blocks[1]));
+
+      blocks.clear();
+      sp.get_blocks(2, 3, collect);
+      BOOST_REQUIRE(blocks.empty());
+
+      blocks.clear();
+      sp.get_blocks(0, 8, [&blocks](uint32_t block_num, data_log_entry&& entry, bool irreversible) {
+         blocks.emplace_back(block_num, std::move(entry), irreversible);
+         return false;
+      });
+      BOOST_REQUIRE_EQUAL(blocks.size(), 1u);
+   }
+
+
+   BOOST_FIXTURE_TEST_CASE(test_get_trx_block_numbers, test_fixture)
+   {
+      fc::temp_directory tempdir;
+      const uint32_t width = 100;
+      store_provider sp(tempdir.path(), width, std::optional<uint32_t>(), std::optional<uint32_t>(), 0);
+      sp.append(bt);
+      sp.append(bt2);
+      const auto trx1 = bt.transactions_v1.at(0).id;
+      const auto trx2 = bt2.transactions_v1.at(0).id;
+      const auto missing_trx = "f000000000000000000000000000000000000000000000000000000000000009"_h;
+
+      const auto verify_lookups = [&](const std::vector<uint32_t>& trx2_blocks) {
+         BOOST_REQUIRE(sp.get_trx_block_numbers(trx1) == std::vector<uint32_t>{ bt.number });
+         BOOST_REQUIRE(sp.get_trx_block_numbers(trx2) == trx2_blocks);
+         BOOST_REQUIRE(sp.get_trx_block_numbers(missing_trx).empty());
+      };
+
+      fc::cfile file;
+      slice_directory sd(tempdir.path(), width, std::optional<uint32_t>(), std::optional<uint32_t>(), 0);
+      BOOST_REQUIRE(sd.find_trx_id_slice(0, open_state::read, file, false));
+      BOOST_REQUIRE(!sd.find_trx_id_index_slice(0, file, false));
+      verify_lookups({ bt2.number });
+
+      // not sorted before all blocks of the slice are irreversible
+      sd.run_maintenance_tasks(width - 1, {});
+      BOOST_REQUIRE(sd.find_trx_id_slice(0, open_state::read, file, false));
+      sd.run_maintenance_tasks(width, {});
+      BOOST_REQUIRE(!sd.find_trx_id_slice(0, open_state::read, file, false));
+      BOOST_REQUIRE(sd.find_trx_id_index_slice(0, file, false));
+      verify_lookups({ bt2.number });
+
+      // appended again after the slice was sorted, e.g. by a replay, and merged into the index
+      auto bt3 = bt2;
+      bt3.number = 7;
+      sp.append(bt3);
+      verify_lookups({ bt3.number, bt2.number });
+      slice_directory sd2(tempdir.path(), width, std::optional<uint32_t>(), std::optional<uint32_t>(), 0);
+      sd2.run_maintenance_tasks(width, {});
+      BOOST_REQUIRE(!sd2.find_trx_id_slice(0, open_state::read, file, false));
+      verify_lookups({ bt2.number, bt3.number });
+   }
+
+
+   BOOST_FIXTURE_TEST_CASE(test_scan_account_actions, test_fixture)
+   {
+      fc::temp_directory tempdir;
+      const uint32_t width = 100;
+      store_provider sp(tempdir.path(), width, std::optional<uint32_t>(), std::optional<uint32_t>(), 0);
+      sp.append(bt);
+      sp.append(bt2);
+      auto bt3 = bt;
+      bt3.number = 150;
+      sp.append(bt3);
+
+      using actions_t = std::vector<std::pair<uint32_t, uint32_t>>;
+      const auto scan = [&sp](chain::name account, uint32_t start_block) {
+         actions_t result;
+         sp.scan_account_actions(account, start_block, [&result](uint32_t block_num, uint32_t action_index) {
+            result.emplace_back(block_num, action_index);
+            return true;
+         });
+         return result;
+      };
+      // alice authorized all actions of bt, bob and eosio.token received one each
+      const auto verify_scans = [&]() {
+         BOOST_REQUIRE(scan("alice"_n, 0) == actions_t({ {1, 0}, {1, 1}, {1, 2}, {150, 0}, {150, 1}, {150, 2} }));
+         BOOST_REQUIRE(scan("alice"_n, 2) == actions_t({ {150, 0}, {150, 1}, {150, 2} }));
+         BOOST_REQUIRE(scan("bob"_n, 0) == actions_t({ {1, 2}, {150, 2} }));
+         BOOST_REQUIRE(scan("eosio.token"_n, 0) == actions_t({ {1, 0}, {150, 0} }));
+         BOOST_REQUIRE(scan("carol"_n, 0).empty());
+      };
+      verify_scans();
+
+      fc::cfile file;
+      slice_directory sd(tempdir.path(), width, std::optional<uint32_t>(), std::optional<uint32_t>(), 0);
+      BOOST_REQUIRE(sd.find_account_slice(0, open_state::read, file, false));
+      sd.run_maintenance_tasks(width, {});
+      BOOST_REQUIRE(!sd.find_account_slice(0, open_state::read, file, false));
+      BOOST_REQUIRE(sd.find_account_index_slice(0, file, false));
+      BOOST_REQUIRE(sd.find_account_slice(1, open_state::read, file, false));
+      verify_scans();
+
+      // the scan stops when told to
+      actions_t stopped;
+      sp.scan_account_actions("alice"_n, 0, [&stopped](uint32_t block_num, uint32_t action_index) {
+         stopped.emplace_back(block_num, action_index);
+         return stopped.size() < 2;
+      });
+      BOOST_REQUIRE(stopped == actions_t({ {1, 0}, {1, 1} }));
+   }
+
+
+   BOOST_FIXTURE_TEST_CASE(test_group_commit, test_fixture)
+   {
+      fc::temp_directory tempdir;
+      const uint32_t width = 4;
+      const auto grouped_dir = tempdir.path() / "grouped";
+      const auto single_dir = tempdir.path() / "single";
+      bfs::create_directories(grouped_dir);
+      bfs::create_directories(single_dir);
+      store_provider grouped(grouped_dir, width, std::optional<uint32_t>(), std::optional<uint32_t>(), 0, 1, 2, false);
+      store_provider single(single_dir, width, std::optional<uint32_t>(), std::optional<uint32_t>(), 0);
+      grouped.start_writer_thread();
+
+      for (uint32_t block_num = 1; block_num <= 10; ++block_num) {
+         auto b = block_num % 2 ? bt : bt2;
+         b.number = block_num;
+         grouped.append(b);
+         single.append(b);
+         if (block_num > 2) {
+            grouped.append_lib(block_num - 2);
+            single.append_lib(block_num - 2);
+         }
+         // reads find what was appended before them
+         const auto block = grouped.get_block(block_num);
+         BOOST_REQUIRE(block);
+         BOOST_REQUIRE_EQUAL(std::get<0>(*block), b);
+         BOOST_REQUIRE(!std::get<1>(*block));
+         const auto trx_blocks = grouped.get_trx_block_numbers(b.transactions_v1.at(0).id);
+         BOOST_REQUIRE(std::find(trx_blocks.begin(), trx_blocks.end(), block_num) != trx_blocks.end());
+      }
+      grouped.stop_writer_thread();
+
+      // written in groups as they would have been one by one, offsets included
+      const auto read_file = [](const bfs::path& p) {
+         std::ifstream in(p.string(), std::ios::binary);
+         return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+      };
+      uint32_t files = 0;
+      for (bfs::directory_iterator it(single_dir), end; it != end; ++it) {
+         const auto grouped_file = grouped_dir / it->path().filename();
+         BOOST_REQUIRE(bfs::exists(grouped_file));
+         BOOST_REQUIRE(read_file(it->path()) == read_file(grouped_file));
+         ++files;
+      }
+      BOOST_REQUIRE_EQUAL(files, uint32_t(std::distance(bfs::directory_iterator(grouped_dir), bfs::directory_iterator())));
+
+      // appended after the thread stopped, written at once
+      auto b = bt;
+      b.number = 11;
+      grouped.append(b);
+      BOOST_REQUIRE(grouped.get_block(11));
+   }
+
 BOOST_AUTO_TEST_SUITE_END()
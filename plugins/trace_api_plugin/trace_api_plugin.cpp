@@ -7,6 +7,8 @@
 
 #include <eosio/trace_api/configuration_utils.hpp>
 
+#include <eosio/chain/async_signal_queue.hpp>
+
 #include <boost/signals2/connection.hpp>
 
 using namespace eosio::trace_api;
@@ -76,6 +78,10 @@ namespace {
          store->append(trace);
       }
 
+      void append( const block_trace_v2& trace ) {
+         store->append(trace);
+      }
+
       void append_lib( uint32_t new_lib ) {
          store->append_lib(new_lib);
       }
@@ -84,6 +90,18 @@ namespace {
          return store->get_block(height, yield);
       }
 
+      void get_blocks(uint32_t start_block, uint32_t count, const typename Store::block_function& fn, const yield_function& yield) {
+         store->get_blocks(start_block, count, fn, yield);
+      }
+
+      std::vector<uint32_t> get_trx_block_numbers(const chain::transaction_id_type& trx_id, const yield_function& yield) {
+         return store->get_trx_block_numbers(trx_id, yield);
+      }
+
+      void scan_account_actions(chain::name account, uint32_t start_block, const typename Store::account_action_function& fn, const yield_function& yield) {
+         store->scan_account_actions(account, start_block, fn, yield);
+      }
+
       std::shared_ptr<Store> store;
    };
 }
@@ -106,6 +124,17 @@ struct trace_api_common_impl {
       cfg_options("trace-minimum-uncompressed-irreversible-history-blocks", boost::program_options::value<int32_t>()->default_value(-1),
                   "Number of blocks to ensure are uncompressed past LIB. Compressed \"slice\" files are still accessible but may carry a performance loss on retrieval\n"
                   "A value of -1 indicates that automatic compression of \"slice\" files will be turned off.");
+      cfg_options("trace-compression-threads", bpo::value<uint16_t>()->default_value(1),
+                  "Number of threads compressing \"slice\" files at once when more than one can be compressed.");
+      cfg_options("trace-compression-seek-point-stride", bpo::value<uint32_t>()->default_value(default_compression_seek_point_stride),
+                  "The number of bytes between seek points in a compressed \"slice\" file. "
+                  "A smaller stride may degrade compression efficiency but increase read efficiency");
+      cfg_options("trace-group-commit-blocks", bpo::value<uint32_t>()->default_value(0),
+                  "Number of blocks whose traces can wait for the thread writing them, which writes all those waiting at once. "
+                  "0 writes the traces of each block as they are extracted");
+      cfg_options("trace-sync-writes", bpo::value<bool>()->default_value(true),
+                  "Sync the \"slice\" files to disk after each write. false leaves it to the operating system, the traces of the "
+                  "last blocks may then be lost if the host stops");
    }
 
    void plugin_initialize(const appbase::variables_map& options) {
@@ -132,12 +161,23 @@ struct trace_api_common_impl {
          minimum_uncompressed_irreversible_history_blocks = uncompressed_blocks;
       }
 
+      compression_seek_point_stride = options.at("trace-compression-seek-point-stride").as<uint32_t>();
+      EOS_ASSERT(compression_seek_point_stride > 0, chain::plugin_config_exception,
+                 "\"trace-compression-seek-point-stride\" must be greater than 0.");
+
+      const uint16_t compression_threads = options.at("trace-compression-threads").as<uint16_t>();
+      EOS_ASSERT(compression_threads > 0, chain::plugin_config_exception,
+                 "\"trace-compression-threads\" must be greater than 0.");
+
       store = std::make_shared<store_provider>(
          trace_dir,
          slice_stride,
          minimum_irreversible_history_blocks,
          minimum_uncompressed_irreversible_history_blocks,
-         compression_seek_point_stride
+         compression_seek_point_stride,
+         compression_threads,
+         options.at("trace-group-commit-blocks").as<uint32_t>(),
+         options.at("trace-sync-writes").as<bool>()
       );
    }
 
@@ -145,9 +185,12 @@ struct trace_api_common_impl {
       store->start_maintenance_thread([](const std::string& msg ){
          fc_dlog( _log, msg );
       });
+      store->start_writer_thread();
    }
 
    void plugin_shutdown() {
+      // the last writes may set the lib for the maintenance
+      store->stop_writer_thread();
       store->stop_maintenance_thread();
    }
 
@@ -159,7 +202,8 @@ struct trace_api_common_impl {
    std::optional<uint32_t> minimum_uncompressed_irreversible_history_blocks;
 
    static constexpr int32_t manual_slice_file_value = -1;
-   static constexpr uint32_t compression_seek_point_stride = 6 * 1024 * 1024; // 6 MiB strides for clog seek points
+   static constexpr uint32_t default_compression_seek_point_stride = 6 * 1024 * 1024; // 6 MiB strides for clog seek points
+   uint32_t compression_seek_point_stride = default_compression_seek_point_stride;
 
    std::shared_ptr<store_provider> store;
 };
@@ -187,12 +231,18 @@ struct trace_api_rpc_plugin_impl : public std::enable_shared_from_this<trace_api
             "Failure to specify this option when there are no trace-rpc-abi configuations will result in an Error.\n"
             "This option is mutually exclusive with trace-rpc-api"
       );
+      cfg_options("trace-rpc-block-cache-size", bpo::value<uint32_t>()->default_value(0),
+                  "Number of irreversible block traces kept decoded for the RPC requests that read them again, "
+                  "saving the decompression of compressed \"slice\" files. 0 to disable.");
+      cfg_options("trace-rpc-decode-threads", bpo::value<uint16_t>()->default_value(0),
+                  "Number of threads decoding the action data of a block trace with the ABIs, next to the thread of the RPC request. "
+                  "0 to decode on the thread of the RPC request only.");
    }
 
    void plugin_initialize(const appbase::variables_map& options) {
       std::shared_ptr<abi_data_handler> data_handler = std::make_shared<abi_data_handler>([](const exception_with_context& e){
          log_exception(e, fc::log_level::debug);
-      });
+      }, options.at("trace-rpc-decode-threads").as<uint16_t>());
 
       if( options.count("trace-rpc-abi") ) {
          EOS_ASSERT(options.count("trace-no-abis") == 0, chain::plugin_config_exception,
@@ -217,7 +267,8 @@ struct trace_api_rpc_plugin_impl : public std::enable_shared_from_this<trace_api
 
       req_handler = std::make_shared<request_handler_t>(
          shared_store_provider<store_provider>(common->store),
-         abi_data_handler::shared_provider(data_handler)
+         abi_data_handler::shared_provider(data_handler),
+         options.at("trace-rpc-block-cache-size").as<uint32_t>()
       );
    }
 
@@ -280,6 +331,163 @@ struct trace_api_rpc_plugin_impl : public std::enable_shared_from_this<trace_api
             http_plugin::handle_exception("trace_api", "get_block", body, cb);
          }
       });
+
+      http.add_async_handler("/v1/trace_api/get_blocks",
+            [wthis=weak_from_this(), max_response_time](std::string, std::string body, url_response_callback cb)
+      {
+         auto that = wthis.lock();
+         if (!that) {
+            return;
+         }
+
+         struct get_blocks_params {
+            uint32_t start_block = 0;
+            uint32_t count = default_get_blocks_count;
+         };
+         auto params = ([&body]() -> std::optional<get_blocks_params> {
+            if (body.empty()) {
+               return {};
+            }
+
+            try {
+               auto input = fc::json::from_string(body).get_object();
+               get_blocks_params result;
+               auto start_block = input["start_block"].as_uint64();
+               if (start_block > std::numeric_limits<uint32_t>::max()) {
+                  return {};
+               }
+               result.start_block = start_block;
+               if (input.contains("count")) {
+                  auto count = input["count"].as_uint64();
+                  if (count == 0 || count > max_get_blocks_count) {
+                     return {};
+                  }
+                  result.count = count;
+               }
+               return result;
+            } catch (...) {
+               return {};
+            }
+         })();
+
+         if (!params) {
+            error_results results{400, "Bad or missing start_block or count"};
+            cb( 400, fc::variant( results ));
+            return;
+         }
+
+         try {
+
+            const auto deadline = that->calc_deadline( max_response_time );
+            auto resp = that->req_handler->get_blocks_trace(params->start_block, params->count, [deadline]() { FC_CHECK_DEADLINE(deadline); });
+            cb( 200, std::move(resp) );
+         } catch (...) {
+            http_plugin::handle_exception("trace_api", "get_blocks", body, cb);
+         }
+      });
+
+      http.add_async_handler("/v1/trace_api/get_transaction_trace",
+            [wthis=weak_from_this(), max_response_time](std::string, std::string body, url_response_callback cb)
+      {
+         auto that = wthis.lock();
+         if (!that) {
+            return;
+         }
+
+         auto trx_id = ([&body]() -> std::optional<chain::transaction_id_type> {
+            if (body.empty()) {
+               return {};
+            }
+
+            try {
+               auto input = fc::json::from_string(body);
+               auto id = input.get_object()["id"].as_string();
+               if (id.size() != sizeof(chain::transaction_id_type) * 2) {
+                  return {};
+               }
+               return chain::transaction_id_type(id);
+            } catch (...) {
+               return {};
+            }
+         })();
+
+         if (!trx_id) {
+            error_results results{400, "Bad or missing id"};
+            cb( 400, fc::variant( results ));
+            return;
+         }
+
+         try {
+
+            const auto deadline = that->calc_deadline( max_response_time );
+            auto resp = that->req_handler->get_transaction_trace(*trx_id, [deadline]() { FC_CHECK_DEADLINE(deadline); });
+            if (resp.is_null()) {
+               error_results results{404, "Transaction trace missing"};
+               cb( 404, fc::variant( results ));
+            } else {
+               cb( 200, std::move(resp) );
+            }
+         } catch (...) {
+            http_plugin::handle_exception("trace_api", "get_transaction_trace", body, cb);
+         }
+      });
+
+      http.add_async_handler("/v1/trace_api/get_actions",
+            [wthis=weak_from_this(), max_response_time](std::string, std::string body, url_response_callback cb)
+      {
+         auto that = wthis.lock();
+         if (!that) {
+            return;
+         }
+
+         struct get_actions_params {
+            chain::name account;
+            uint32_t    start_block = 0;
+            uint32_t    limit = default_get_actions_limit;
+         };
+         auto params = ([&body]() -> std::optional<get_actions_params> {
+            if (body.empty()) {
+               return {};
+            }
+
+            try {
+               auto input = fc::json::from_string(body).get_object();
+               get_actions_params result{ chain::name(input["account"].as_string()) };
+               if (input.contains("start_block")) {
+                  auto start_block = input["start_block"].as_uint64();
+                  if (start_block > std::numeric_limits<uint32_t>::max()) {
+                     return {};
+                  }
+                  result.start_block = start_block;
+               }
+               if (input.contains("limit")) {
+                  auto limit = input["limit"].as_uint64();
+                  if (limit == 0 || limit > max_get_actions_limit) {
+                     return {};
+                  }
+                  result.limit = limit;
+               }
+               return result;
+            } catch (...) {
+               return {};
+            }
+         })();
+
+         if (!params) {
+            error_results results{400, "Bad or missing account, start_block or limit"};
+            cb( 400, fc::variant( results ));
+            return;
+         }
+
+         try {
+
+            const auto deadline = that->calc_deadline( max_response_time );
+            auto resp = that->req_handler->get_actions(params->account, params->start_block, params->limit, [deadline]() { FC_CHECK_DEADLINE(deadline); });
+            cb( 200, std::move(resp) );
+         } catch (...) {
+            http_plugin::handle_exception("trace_api", "get_actions", body, cb);
+         }
+      });
    }
 
    void plugin_shutdown() {
@@ -287,6 +495,11 @@ struct trace_api_rpc_plugin_impl : public std::enable_shared_from_this<trace_api
 
    std::shared_ptr<trace_api_common_impl> common;
 
+   static constexpr uint32_t default_get_blocks_count = 10;
+   static constexpr uint32_t max_get_blocks_count = 100;
+   static constexpr uint32_t default_get_actions_limit = 100;
+   static constexpr uint32_t max_get_actions_limit = 1000;
+
    using request_handler_t = request_handler<shared_store_provider<store_provider>, abi_data_handler::shared_provider>;
    std::shared_ptr<request_handler_t> req_handler;
 };
@@ -297,9 +510,24 @@ struct trace_api_plugin_impl {
 
    static void set_program_options(appbase::options_description& cli, appbase::options_description& cfg) {
       auto cfg_options = cfg.add_options();
+      cfg_options("trace-async-queue-size", bpo::value<uint32_t>()->default_value(0),
+                  "Number of signals queued for the thread extracting traces, which then runs apart from block application. 0 extracts traces within block application");
+      cfg_options("trace-async-overflow-policy", bpo::value<std::string>()->default_value("block"),
+                  "What happens to a signal when trace-async-queue-size signals are queued: \"block\" waits for the extraction to catch up, \"drop\" discards the signal and the traces it carries");
    }
 
    void plugin_initialize(const appbase::variables_map& options) {
+      const uint32_t async_queue_size = options.at("trace-async-queue-size").as<uint32_t>();
+      if( async_queue_size > 0 ) {
+         chain::async_signal_queue::overflow_policy policy;
+         try {
+            policy = chain::to_overflow_policy( options.at("trace-async-overflow-policy").as<std::string>() );
+         } catch( const chain::misc_exception& e ) {
+            EOS_THROW(chain::plugin_config_exception, "${m}", ("m", e.top_message()));
+         }
+         signal_queue = std::make_unique<chain::async_signal_queue>( "trace", async_queue_size, policy );
+      }
+
       auto log_exceptions_and_shutdown = [](const exception_with_context& e) {
          log_exception(e, fc::log_level::error);
          app().quit();
@@ -308,9 +536,19 @@ struct trace_api_plugin_impl {
       extraction = std::make_shared<chain_extraction_t>(shared_store_provider<store_provider>(common->store), log_exceptions_and_shutdown);
 
       auto& chain = app().find_plugin<chain_plugin>()->chain();
+      chain.add_trace_consumer();
 
       applied_transaction_connection.emplace(
          chain.applied_transaction.connect([this](std::tuple<const chain::transaction_trace_ptr&, const chain::signed_transaction&> t) {
+            if( signal_queue ) {
+               // the transaction is only referenced by the signal
+               signal_queue->post([this, trace = std::get<0>(t), trx = std::get<1>(t)]() {
+                  emit_killer([&](){
+                     extraction->signal_applied_transaction(trace, trx);
+                  });
+               });
+               return;
+            }
             emit_killer([&](){
                extraction->signal_applied_transaction(std::get<0>(t), std::get<1>(t));
             });
@@ -318,21 +556,21 @@ struct trace_api_plugin_impl {
 
       block_start_connection.emplace(
             chain.block_start.connect([this](uint32_t block_num) {
-               emit_killer([&](){
+               dispatch([this, block_num](){
                   extraction->signal_block_start(block_num);
                });
             }));
 
       accepted_block_connection.emplace(
          chain.accepted_block.connect([this](const chain::block_state_ptr& p) {
-            emit_killer([&](){
+            dispatch([this, p](){
                extraction->signal_accepted_block(p);
             });
          }));
 
       irreversible_block_connection.emplace(
          chain.irreversible_block.connect([this](const chain::block_state_ptr& p) {
-            emit_killer([&](){
+            dispatch([this, p](){
                extraction->signal_irreversible_block(p);
             });
          }));
@@ -344,13 +582,34 @@ struct trace_api_plugin_impl {
    }
 
    void plugin_shutdown() {
+      if (applied_transaction_connection) {
+         app().find_plugin<chain_plugin>()->chain().remove_trace_consumer();
+         applied_transaction_connection.reset();
+      }
+      block_start_connection.reset();
+      accepted_block_connection.reset();
+      irreversible_block_connection.reset();
+      // the traces of the signals queued are still stored
+      if (signal_queue)
+         signal_queue->stop();
       common->plugin_shutdown();
    }
 
+   /// run f on the signal queue with trace-async-queue-size, within the signal otherwise
+   template<typename F>
+   void dispatch(F&& f) {
+      if (signal_queue) {
+         signal_queue->post([f = std::forward<F>(f)]() { emit_killer(f); });
+      } else {
+         emit_killer(f);
+      }
+   }
+
    std::shared_ptr<trace_api_common_impl> common;
 
    using chain_extraction_t = chain_extraction_impl_type<shared_store_provider<store_provider>>;
    std::shared_ptr<chain_extraction_t> extraction;
+   std::unique_ptr<chain::async_signal_queue> signal_queue;  ///< of the signals, extracted on its thread
 
    fc::optional<scoped_connection>                            applied_transaction_connection;
    fc::optional<scoped_connection>                            block_start_connection;
@@ -12,6 +12,10 @@
 #include <boost/asio/high_resolution_timer.hpp>
 #include <boost/algorithm/clamp.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
 #include <Inline/BasicTypes.h>
 #include <IR/Module.h>
 #include <IR/Validate.h>
@@ -28,10 +32,58 @@ namespace eosio { namespace detail {
   struct txn_test_gen_status {
      string status;
   };
+
+  /// what start_load generates, the weights set the share of each kind of transaction in the mix
+  struct txn_test_gen_load_params {
+     string   salt;
+     uint32_t tps = 1000;
+     uint32_t duration_sec = 60;
+     uint32_t transfer_weight = 1;    ///< eosio.token transfers between the accounts of create_load_accounts
+     uint32_t table_weight = 0;       ///< actions storing, reading and removing table_rows rows
+     uint32_t table_rows = 10;
+     uint32_t fanout_weight = 0;      ///< actions sending fanout_actions inline actions
+     uint32_t fanout_actions = 10;
+     uint32_t deferred_weight = 0;    ///< transfers delayed by deferred_delay_sec
+     uint32_t deferred_delay_sec = 1;
+  };
+
+  struct txn_test_gen_latency {
+     int64_t p50_us = 0;
+     int64_t p90_us = 0;
+     int64_t p99_us = 0;
+     int64_t max_us = 0;
+  };
+
+  struct txn_test_gen_load_report {
+     bool                  running = false;
+     uint64_t              generated = 0;   ///< transactions signed for the load
+     uint64_t              sent = 0;
+     uint64_t              failed = 0;      ///< rejected by the node
+     uint64_t              included = 0;    ///< found in a block accepted by the node
+     uint64_t              in_flight = 0;   ///< sent, neither failed nor included yet
+     int64_t               elapsed_us = 0;  ///< since the first transaction was sent
+     double                sent_tps = 0;
+     double                included_tps = 0;
+     txn_test_gen_latency  inclusion_latency; ///< from sending a transaction to accepting the block including it
+  };
+
+  /// eosio.token transfer action data
+  struct txn_test_gen_transfer {
+     chain::name   from;
+     chain::name   to;
+     chain::asset  quantity;
+     string        memo;
+  };
 }}
 
 FC_REFLECT(eosio::detail::txn_test_gen_empty, );
 FC_REFLECT(eosio::detail::txn_test_gen_status, (status));
+FC_REFLECT(eosio::detail::txn_test_gen_load_params, (salt)(tps)(duration_sec)(transfer_weight)(table_weight)(table_rows)
+                                                    (fanout_weight)(fanout_actions)(deferred_weight)(deferred_delay_sec));
+FC_REFLECT(eosio::detail::txn_test_gen_latency, (p50_us)(p90_us)(p99_us)(max_us));
+FC_REFLECT(eosio::detail::txn_test_gen_load_report, (running)(generated)(sent)(failed)(included)(in_flight)(elapsed_us)
+                                                    (sent_tps)(included_tps)(inclusion_latency));
+FC_REFLECT(eosio::detail::txn_test_gen_transfer, (from)(to)(quantity)(memo));
 
 namespace eosio {
 
@@ -65,6 +117,13 @@ using namespace eosio::chain;
      api_handle->call_name(); \
      eosio::detail::txn_test_gen_empty result;
 
+#define INVOKE_V_R(api_handle, call_name, in_param) \
+     auto status = api_handle->call_name(fc::json::from_string(body).as<in_param>()); \
+     eosio::detail::txn_test_gen_status result = { status };
+
+#define INVOKE_R_V(api_handle, call_name) \
+     auto result = api_handle->call_name();
+
 #define CALL_ASYNC(api_name, api_handle, call_name, INVOKE, http_response_code) \
 {std::string("/v1/" #api_name "/" #call_name), \
    [this](string, string body, url_response_callback cb) mutable { \
@@ -91,6 +150,77 @@ using namespace eosio::chain;
    const auto& vs = fc::json::json::from_string(body).as<fc::variants>(); \
    api_handle->call_name(vs.at(0).as<in_param0>(), vs.at(1).as<in_param1>(), result_handler);
 
+#define INVOKE_ASYNC_R_R_R(api_handle, call_name, in_param0, in_param1, in_param2) \
+   const auto& vs = fc::json::json::from_string(body).as<fc::variants>(); \
+   api_handle->call_name(vs.at(0).as<in_param0>(), vs.at(1).as<in_param1>(), vs.at(2).as<in_param2>(), result_handler);
+
+/**
+ * Contract of the table-heavy and inline fan-out load. The first 4 bytes of the action data are a count: "rows" stores
+ * that many rows then finds, reads and removes them, "fanout" sends that many inline "leaf" actions to itself.
+ */
+static std::string load_contract_wast() {
+   static const char wast[] = R"=====(
+(module
+ (import "env" "read_action_data" (func $read_action_data (param i32 i32) (result i32)))
+ (import "env" "send_inline" (func $send_inline (param i32 i32)))
+ (import "env" "db_store_i64" (func $db_store_i64 (param i64 i64 i64 i64 i32 i32) (result i32)))
+ (import "env" "db_find_i64" (func $db_find_i64 (param i64 i64 i64 i64) (result i32)))
+ (import "env" "db_get_i64" (func $db_get_i64 (param i32 i32 i32) (result i32)))
+ (import "env" "db_remove_i64" (func $db_remove_i64 (param i32)))
+ (memory 1)
+ (export "apply" (func $apply))
+ (func $apply (param $receiver i64) (param $account i64) (param $action i64)
+  (local $i i32)
+  (local $count i32)
+  (local $itr i32)
+  (if (i64.eq (get_local $action) (i64.const ${leaf})) (then (return)))
+  (drop (call $read_action_data (i32.const 32) (i32.const 4)))
+  (set_local $count (i32.load (i32.const 32)))
+  (if (i64.eq (get_local $action) (i64.const ${fanout}))
+   (then
+    ;; packed action receiver::leaf, no authorization and no data
+    (i64.store (i32.const 0) (get_local $receiver))
+    (i64.store (i32.const 8) (i64.const ${leaf}))
+    (i32.store16 (i32.const 16) (i32.const 0))
+    (block $sent
+     (loop $send
+      (br_if $sent (i32.ge_u (get_local $i) (get_local $count)))
+      (call $send_inline (i32.const 0) (i32.const 18))
+      (set_local $i (i32.add (get_local $i) (i32.const 1)))
+      (br $send)
+     )
+    )
+    (return)
+   )
+  )
+  (block $stored
+   (loop $store
+    (br_if $stored (i32.ge_u (get_local $i) (get_local $count)))
+    (drop (call $db_store_i64 (get_local $receiver) (i64.const 1) (get_local $receiver) (i64.extend_u/i32 (get_local $i)) (i32.const 40) (i32.const 8)))
+    (set_local $i (i32.add (get_local $i) (i32.const 1)))
+    (br $store)
+   )
+  )
+  (set_local $i (i32.const 0))
+  (block $removed
+   (loop $remove
+    (br_if $removed (i32.ge_u (get_local $i) (get_local $count)))
+    (set_local $itr (call $db_find_i64 (get_local $receiver) (get_local $receiver) (i64.const 1) (i64.extend_u/i32 (get_local $i))))
+    (drop (call $db_get_i64 (get_local $itr) (i32.const 48) (i32.const 8)))
+    (call $db_remove_i64 (get_local $itr))
+    (set_local $i (i32.add (get_local $i) (i32.const 1)))
+    (br $remove)
+   )
+  )
+ )
+)
+)=====";
+   // names as signed values, which the WAST parser takes for any 64 bits
+   return fc::format_string( wast, fc::mutable_variant_object()
+                                      ("leaf", static_cast<int64_t>(N(leaf).to_uint64_t()))
+                                      ("fanout", static_cast<int64_t>(N(fanout).to_uint64_t())) );
+}
+
 struct txn_test_gen_plugin_impl {
 
    uint64_t _total_us = 0;
@@ -102,6 +232,8 @@ struct txn_test_gen_plugin_impl {
    name                                                 newaccountA;
    name                                                 newaccountB;
    name                                                 newaccountT;
+   name                                                 newaccountL;
+   std::string                                          account_prefix;
 
    void push_next_transaction(const std::shared_ptr<std::vector<signed_transaction>>& trxs, const std::function<void(const fc::exception_ptr&)>& next ) {
       chain_plugin& cp = app().get_plugin<chain_plugin>();
@@ -330,6 +462,22 @@ struct txn_test_gen_plugin_impl {
       });
    }
 
+   block_id_type get_reference_block_id()const {
+      controller& cc = app().get_plugin<chain_plugin>().chain();
+
+      uint32_t reference_block_num = cc.last_irreversible_block_num();
+      if (txn_reference_block_lag >= 0) {
+         reference_block_num = cc.head_block_num();
+         if (reference_block_num <= (uint32_t)txn_reference_block_lag) {
+            reference_block_num = 0;
+         } else {
+            reference_block_num -= (uint32_t)txn_reference_block_lag;
+         }
+      }
+
+      return cc.get_block_id_for_num(reference_block_num);
+   }
+
    void send_transaction(std::function<void(const fc::exception_ptr&)> next, uint64_t nonce_prefix) {
       std::vector<signed_transaction> trxs;
       trxs.reserve(2*batch);
@@ -343,17 +491,7 @@ struct txn_test_gen_plugin_impl {
 
          static uint64_t nonce = static_cast<uint64_t>(fc::time_point::now().sec_since_epoch()) << 32;
 
-         uint32_t reference_block_num = cc.last_irreversible_block_num();
-         if (txn_reference_block_lag >= 0) {
-            reference_block_num = cc.head_block_num();
-            if (reference_block_num <= (uint32_t)txn_reference_block_lag) {
-               reference_block_num = 0;
-            } else {
-               reference_block_num -= (uint32_t)txn_reference_block_lag;
-            }
-         }
-
-         block_id_type reference_block_id = cc.get_block_id_for_num(reference_block_num);
+         block_id_type reference_block_id = get_reference_block_id();
 
          for(unsigned int i = 0; i < batch; ++i) {
          {
@@ -401,8 +539,358 @@ struct txn_test_gen_plugin_impl {
       }
    }
 
+   static constexpr uint32_t max_load_accounts = 31 * 31;
+   static constexpr uint32_t max_load_tps = 100000;
+   static constexpr uint32_t max_load_duration_sec = 3000;
+   static constexpr uint64_t max_load_transactions = 10000000;
+   static constexpr uint32_t max_load_count = 1000;            ///< of table_rows and fanout_actions
+   static constexpr uint32_t load_actions_per_setup_trx = 50;
+   static constexpr uint32_t load_period_ms = 5;
+   static constexpr uint32_t load_chunks_per_thread = 8;        ///< of the pool signed by each thread
+
+   static fc::crypto::private_key load_contract_priv_key() {
+      return fc::crypto::private_key::regenerate(fc::sha256(std::string(64, 'd')));
+   }
+
+   /// shared by the accounts the load is generated from
+   static fc::crypto::private_key load_accounts_priv_key() {
+      return fc::crypto::private_key::regenerate(fc::sha256(std::string(64, 'e')));
+   }
+
+   std::vector<name> load_account_names(uint32_t accounts)const {
+      static const char chars[] = "12345abcdefghijklmnopqrstuvwxyz";
+      std::vector<name> result;
+      result.reserve(accounts);
+      for (uint32_t i = 0; i < accounts; ++i) {
+         result.emplace_back(account_prefix + "u" + chars[i / 31] + chars[i % 31]);
+      }
+      return result;
+   }
+
+   /// create the load contract and accounts accounts funded by the token account of create_test_accounts
+   void create_load_accounts(const std::string& init_name, const std::string& init_priv_key, const uint32_t& accounts, const std::function<void(const fc::exception_ptr&)>& next) {
+      ilog("create_load_accounts");
+      std::vector<signed_transaction> trxs;
+
+      try {
+         EOS_ASSERT( accounts >= 2 && accounts <= max_load_accounts, chain::invalid_http_request,
+                     "accounts must be between 2 and ${m}", ("m", max_load_accounts) );
+         EOS_ASSERT( !load_running, chain::invalid_http_request, "start_load is running" );
+
+         name creator(init_name);
+
+         controller& cc = app().get_plugin<chain_plugin>().chain();
+         auto chainid = app().get_plugin<chain_plugin>().get_chain_id();
+
+         fc::crypto::private_key creator_priv_key = fc::crypto::private_key(init_priv_key);
+         fc::crypto::private_key txn_test_receiver_C_priv_key = fc::crypto::private_key::regenerate(fc::sha256(std::string(64, 'c')));
+         const auto names = load_account_names(accounts);
+
+         signed_transaction trx;
+         auto add_trx = [&](const fc::crypto::private_key& key) {
+            trx.expiration = cc.head_block_time() + fc::seconds(180);
+            trx.set_reference_block(cc.head_block_id());
+            trx.sign(key, chainid);
+            trxs.emplace_back(std::move(trx));
+            trx = signed_transaction();
+         };
+
+         //create the load contract account and the accounts generating the load
+         {
+            auto contract_auth = eosio::chain::authority{1, {{load_contract_priv_key().get_public_key(), 1}}, {}};
+            auto account_auth  = eosio::chain::authority{1, {{load_accounts_priv_key().get_public_key(), 1}}, {}};
+
+            trx.actions.emplace_back(vector<chain::permission_level>{{creator,name("active")}}, newaccount{creator, newaccountL, contract_auth, contract_auth});
+            for (const auto& n : names) {
+               trx.actions.emplace_back(vector<chain::permission_level>{{creator,name("active")}}, newaccount{creator, n, account_auth, account_auth});
+               if (trx.actions.size() == load_actions_per_setup_trx)
+                  add_trx(creator_priv_key);
+            }
+            if (!trx.actions.empty())
+               add_trx(creator_priv_key);
+         }
+
+         //set the load contract
+         {
+            setcode handler;
+            handler.account = newaccountL;
+            const auto wasm = wast_to_wasm(load_contract_wast());
+            handler.code.assign(wasm.begin(), wasm.end());
+            trx.actions.emplace_back(vector<chain::permission_level>{{newaccountL,name("active")}}, handler);
+            add_trx(load_contract_priv_key());
+         }
+
+         //fund the accounts from newaccountT
+         {
+            const auto quantity = asset::from_string("10.0000 CUR");
+            for (const auto& n : names) {
+               trx.actions.emplace_back(vector<chain::permission_level>{{newaccountT,config::active_name}}, newaccountT, N(transfer),
+                                        fc::raw::pack(detail::txn_test_gen_transfer{newaccountT, n, quantity, ""}));
+               if (trx.actions.size() == load_actions_per_setup_trx)
+                  add_trx(txn_test_receiver_C_priv_key);
+            }
+            if (!trx.actions.empty())
+               add_trx(txn_test_receiver_C_priv_key);
+         }
+
+         load_accounts = names;
+      } catch (const fc::exception& e) {
+         next(e.dynamic_copy_exception());
+         return;
+      }
+
+      push_transactions(std::move(trxs), next);
+   }
+
+   /// what the threads signing the transactions of start_load share
+   struct load_plan {
+      explicit load_plan(const chain_id_type& chain_id) : chain_id(chain_id) {}
+
+      detail::txn_test_gen_load_params  params;
+      uint64_t                          total_weight = 0;
+      std::string                       nonce_prefix;
+      std::vector<name>                 accounts;
+      name                              token;
+      name                              contract;
+      asset                             quantity;
+      chain_id_type                     chain_id;
+      block_id_type                     reference_block_id;
+      fc::time_point_sec                expiration;
+      fc::crypto::private_key           key;
+      std::atomic<bool>                 cancelled{false};
+   };
+
+   /// transaction i of the load, its kind picked by the weights
+   static packed_transaction_ptr make_load_transaction(const load_plan& plan, uint64_t i) {
+      const auto& p = plan.params;
+      const uint64_t n = plan.accounts.size();
+      const name from = plan.accounts[i % n];
+      const uint64_t k = i % plan.total_weight;
+
+      signed_transaction trx;
+      if (k < uint64_t(p.transfer_weight) + p.deferred_weight) {
+         // every other account in turn, never from itself
+         const name to = plan.accounts[(i + 1 + (i / n) % (n - 1)) % n];
+         trx.actions.emplace_back(vector<chain::permission_level>{{from,config::active_name}}, plan.token, N(transfer),
+                                  fc::raw::pack(detail::txn_test_gen_transfer{from, to, plan.quantity, ""}));
+         if (k >= p.transfer_weight)
+            trx.delay_sec = p.deferred_delay_sec;
+      } else if (k < uint64_t(p.transfer_weight) + p.deferred_weight + p.table_weight) {
+         trx.actions.emplace_back(vector<chain::permission_level>{{from,config::active_name}}, plan.contract, N(rows), fc::raw::pack(p.table_rows));
+      } else {
+         trx.actions.emplace_back(vector<chain::permission_level>{{from,config::active_name}}, plan.contract, N(fanout), fc::raw::pack(p.fanout_actions));
+      }
+      trx.context_free_actions.emplace_back(action({}, config::null_account_name, name("nonce"), fc::raw::pack(plan.nonce_prefix + std::to_string(i))));
+      trx.set_reference_block(plan.reference_block_id);
+      trx.expiration = plan.expiration;
+      trx.max_net_usage_words = 100;
+      trx.sign(plan.key, plan.chain_id);
+      return std::make_shared<packed_transaction>(std::move(trx));
+   }
+
+   /**
+    * Sign tps * duration_sec transactions on the thread pool, then send them at tps from the main thread. Each is
+    * timed from being sent to the block including it being accepted, see get_load_report.
+    */
+   string start_load(const detail::txn_test_gen_load_params& params) {
+      ilog("Starting load generation");
+      if(load_running)
+         return "start_load already running";
+      if(load_accounts.empty())
+         return "create_load_accounts must be called first";
+      if(params.tps < 1 || params.tps > max_load_tps)
+         return "tps must be between 1 and " + std::to_string(max_load_tps);
+      if(params.duration_sec < 1 || params.duration_sec > max_load_duration_sec)
+         return "duration_sec must be between 1 and " + std::to_string(max_load_duration_sec);
+      if(uint64_t(params.tps) * params.duration_sec > max_load_transactions)
+         return "tps * duration_sec must be at most " + std::to_string(max_load_transactions);
+      if(params.table_rows > max_load_count || params.fanout_actions > max_load_count)
+         return "table_rows and fanout_actions must be at most " + std::to_string(max_load_count);
+      const uint64_t total_weight = uint64_t(params.transfer_weight) + params.deferred_weight + params.table_weight + params.fanout_weight;
+      if(total_weight == 0)
+         return "the weights must not all be 0";
+
+      controller& cc = app().get_plugin<chain_plugin>().chain();
+      auto plan = std::make_shared<load_plan>(app().get_plugin<chain_plugin>().get_chain_id());
+      plan->params = params;
+      plan->total_weight = total_weight;
+      plan->nonce_prefix = params.salt + std::to_string(fc::time_point::now().sec_since_epoch()) + ".";
+      plan->accounts = load_accounts;
+      plan->token = newaccountT;
+      plan->contract = newaccountL;
+      plan->quantity = asset::from_string("0.0001 CUR");
+      plan->reference_block_id = get_reference_block_id();
+      plan->expiration = cc.head_block_time() + fc::seconds(params.duration_sec + 60);
+      plan->key = load_accounts_priv_key();
+
+      const uint64_t total = uint64_t(params.tps) * params.duration_sec;
+      auto pool = std::make_shared<std::vector<packed_transaction_ptr>>(total);
+
+      load_running = true;
+      load_plan_ptr = plan;
+      load_pool.clear();
+      load_tps = params.tps;
+      load_generated = load_sent = load_failed = 0;
+      load_in_flight.clear();
+      load_latencies_us.clear();
+      load_start = load_last_sent = load_last_included = fc::time_point();
+
+      load_thread_pool.emplace( "txnld", thread_pool_size );
+
+      // the last chunk signed starts sending
+      const uint64_t chunks = std::min<uint64_t>( total, uint64_t(thread_pool_size) * load_chunks_per_thread );
+      auto chunks_left = std::make_shared<std::atomic<uint64_t>>( chunks );
+      for (uint64_t c = 0; c < chunks; ++c) {
+         boost::asio::post( load_thread_pool->get_executor(), [this, plan, pool, chunks_left, begin = total * c / chunks, end = total * (c + 1) / chunks]() {
+            for (uint64_t i = begin; i < end && !plan->cancelled; ++i) {
+               (*pool)[i] = make_load_transaction(*plan, i);
+            }
+            if (--*chunks_left == 0 && !plan->cancelled) {
+               app().post(priority::low, [this, plan, pool]() {
+                  if (plan != load_plan_ptr || !load_running)
+                     return;
+                  load_pool = std::move(*pool);
+                  load_generated = load_pool.size();
+                  send_load();
+               });
+            }
+         });
+      }
+
+      ilog("Started load generation; signing ${n} transactions by ${t} load generation threads to send at ${tps} TPS",
+           ("n", total)("t", thread_pool_size)("tps", params.tps));
+      return "success";
+   }
+
+   void arm_load_timer(boost::asio::high_resolution_timer::time_point s) {
+      load_timer->expires_at(s + std::chrono::milliseconds(load_period_ms));
+      load_timer->async_wait([this](const boost::system::error_code& ec) {
+         if(!load_running || ec)
+            return;
+         app().post(priority::low, [this]() {
+            send_load();
+         });
+         arm_load_timer(load_timer->expires_at());
+      });
+   }
+
+   /// send the transactions due by now, on the main thread
+   void send_load() {
+      if(!load_running || load_pool.empty())
+         return;
+
+      chain_plugin& cp = app().get_plugin<chain_plugin>();
+      const auto now = fc::time_point::now();
+      if (load_start == fc::time_point()) {
+         load_start = now;
+         load_timer = std::make_shared<boost::asio::high_resolution_timer>(load_thread_pool->get_executor());
+         arm_load_timer(boost::asio::high_resolution_timer::clock_type::now());
+      }
+
+      const uint64_t due = std::min<uint64_t>( load_pool.size(), (now - load_start).count() * load_tps / 1000000 + 1 );
+      for (; load_sent < due; ++load_sent) {
+         packed_transaction_ptr trx = std::move(load_pool[load_sent]);
+         const auto id = trx->id();
+         load_in_flight.emplace(id, now);
+         cp.accept_transaction( trx, [this, id](const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& result) {
+            if (result.contains<fc::exception_ptr>() || !result.get<transaction_trace_ptr>() || result.get<transaction_trace_ptr>()->except) {
+               app().post(priority::low, [this, id]() {
+                  if (load_in_flight.erase(id))
+                     ++load_failed;
+               });
+            }
+         });
+      }
+      load_last_sent = now;
+
+      if (load_sent == load_pool.size()) {
+         ilog("Load generation sent all ${n} transactions", ("n", load_sent));
+         stop_load_generation();
+      }
+   }
+
+   void on_accepted_block(const block_state_ptr& bsp) {
+      if (load_in_flight.empty())
+         return;
+
+      const auto now = fc::time_point::now();
+      for (const auto& receipt : bsp->block->transactions) {
+         const transaction_id_type id = receipt.trx.contains<transaction_id_type>() ? receipt.trx.get<transaction_id_type>()
+                                                                                    : receipt.trx.get<packed_transaction>().id();
+         auto itr = load_in_flight.find(id);
+         if (itr == load_in_flight.end())
+            continue;
+         load_latencies_us.push_back((now - itr->second).count());
+         load_in_flight.erase(itr);
+         load_last_included = now;
+      }
+   }
+
+   /// stop signing and sending, transactions already sent are still followed into blocks
+   void stop_load_generation() {
+      load_running = false;
+      if (load_plan_ptr)
+         load_plan_ptr->cancelled = true;
+      if (load_timer)
+         load_timer->cancel();
+      if (load_thread_pool)
+         load_thread_pool->stop();
+      // before the io_context of the stopped thread pool goes with the next start_load
+      load_timer.reset();
+      load_pool.clear();
+   }
+
+   void stop_load() {
+      if(!load_running)
+         throw fc::exception(fc::invalid_operation_exception_code);
+      ilog("Stopping load generation");
+      stop_load_generation();
+   }
+
+   detail::txn_test_gen_load_report get_load_report()const {
+      detail::txn_test_gen_load_report report;
+      report.running = load_running;
+      report.generated = load_generated;
+      report.sent = load_sent;
+      report.failed = load_failed;
+      report.included = load_latencies_us.size();
+      report.in_flight = load_in_flight.size();
+      if (load_start != fc::time_point()) {
+         report.elapsed_us = (fc::time_point::now() - load_start).count();
+         const auto sending_us = (load_last_sent - load_start).count();
+         const auto including_us = (load_last_included - load_start).count();
+         report.sent_tps = sending_us > 0 ? report.sent * 1e6 / sending_us : 0;
+         report.included_tps = including_us > 0 ? report.included * 1e6 / including_us : 0;
+      }
+
+      if (!load_latencies_us.empty()) {
+         auto latencies = load_latencies_us;
+         std::sort(latencies.begin(), latencies.end());
+         auto percentile = [&latencies](size_t p) { return latencies[std::min(latencies.size() - 1, latencies.size() * p / 100)]; };
+         report.inclusion_latency = { percentile(50), percentile(90), percentile(99), latencies.back() };
+      }
+      return report;
+   }
+
    bool running{false};
 
+   std::vector<name>                                       load_accounts;   ///< of create_load_accounts
+   std::atomic<bool>                                       load_running{false};
+   std::shared_ptr<load_plan>                              load_plan_ptr;
+   fc::optional<eosio::chain::named_thread_pool>           load_thread_pool;
+   std::shared_ptr<boost::asio::high_resolution_timer>     load_timer;
+   std::vector<packed_transaction_ptr>                     load_pool;       ///< signed, sent in order
+   uint32_t                                                load_tps = 0;
+   uint64_t                                                load_generated = 0;
+   uint64_t                                                load_sent = 0;
+   uint64_t                                                load_failed = 0;
+   fc::time_point                                          load_start;
+   fc::time_point                                          load_last_sent;
+   fc::time_point                                          load_last_included;
+   std::unordered_map<transaction_id_type, fc::time_point> load_in_flight;  ///< sent at
+   std::vector<int64_t>                                    load_latencies_us;
+   fc::optional<boost::signals2::scoped_connection>        accepted_block_connection;
+
    unsigned timer_timeout;
    unsigned batch;
    uint64_t nonce_prefix;
@@ -433,6 +921,8 @@ void txn_test_gen_plugin::plugin_initialize(const variables_map& options) {
       my->newaccountA = eosio::chain::name(thread_pool_account_prefix + "a");
       my->newaccountB = eosio::chain::name(thread_pool_account_prefix + "b");
       my->newaccountT = eosio::chain::name(thread_pool_account_prefix + "t");
+      my->newaccountL = eosio::chain::name(thread_pool_account_prefix + "l");
+      my->account_prefix = thread_pool_account_prefix;
       EOS_ASSERT( my->thread_pool_size > 0, chain::plugin_config_exception,
                   "txn-test-gen-threads ${num} must be greater than 0", ("num", my->thread_pool_size) );
    } FC_LOG_AND_RETHROW()
@@ -442,8 +932,17 @@ void txn_test_gen_plugin::plugin_startup() {
    app().get_plugin<http_plugin>().add_api({
       CALL_ASYNC(txn_test_gen, my, create_test_accounts, INVOKE_ASYNC_R_R(my, create_test_accounts, std::string, std::string), 200),
       CALL(txn_test_gen, my, stop_generation, INVOKE_V_V(my, stop_generation), 200),
-      CALL(txn_test_gen, my, start_generation, INVOKE_V_R_R_R(my, start_generation, std::string, uint64_t, uint64_t), 200)
+      CALL(txn_test_gen, my, start_generation, INVOKE_V_R_R_R(my, start_generation, std::string, uint64_t, uint64_t), 200),
+      CALL_ASYNC(txn_test_gen, my, create_load_accounts, INVOKE_ASYNC_R_R_R(my, create_load_accounts, std::string, std::string, uint32_t), 200),
+      CALL(txn_test_gen, my, start_load, INVOKE_V_R(my, start_load, eosio::detail::txn_test_gen_load_params), 200),
+      CALL(txn_test_gen, my, stop_load, INVOKE_V_V(my, stop_load), 200),
+      CALL(txn_test_gen, my, get_load_report, INVOKE_R_V(my, get_load_report), 200)
    });
+
+   my->accepted_block_connection.emplace( app().get_plugin<chain_plugin>().chain().accepted_block.connect(
+      [this](const chain::block_state_ptr& bsp) {
+         my->on_accepted_block(bsp);
+      } ) );
 }
 
 void txn_test_gen_plugin::plugin_shutdown() {
@@ -452,6 +951,8 @@ void txn_test_gen_plugin::plugin_shutdown() {
    }
    catch(fc::exception& e) {
    }
+   my->stop_load_generation();
+   my->accepted_block_connection.reset();
 }
 
 }
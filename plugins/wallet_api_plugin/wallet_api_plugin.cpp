@@ -70,13 +70,20 @@ void wallet_api_plugin::plugin_startup() {
    // lifetime of plugin is lifetime of application
    auto& wallet_mgr = app().get_plugin<wallet_plugin>().get_wallet_manager();
 
-   app().get_plugin<http_plugin>().add_api({
-       CALL(wallet, wallet_mgr, set_timeout,
-            INVOKE_V_R(wallet_mgr, set_timeout, int64_t), 200),
+   auto& _http_plugin = app().get_plugin<http_plugin>();
+   // the wallet manager signs concurrently, so that signing spreads over the http threads
+   const api_description sign_api{
        CALL(wallet, wallet_mgr, sign_transaction,
             INVOKE_R_R_R_R(wallet_mgr, sign_transaction, chain::signed_transaction, flat_set<public_key_type>, chain::chain_id_type), 201),
        CALL(wallet, wallet_mgr, sign_digest,
-            INVOKE_R_R_R(wallet_mgr, sign_digest, chain::digest_type, public_key_type), 201),
+            INVOKE_R_R_R(wallet_mgr, sign_digest, chain::digest_type, public_key_type), 201)
+   };
+   for( const auto& call : sign_api )
+      _http_plugin.add_async_handler(call.first, call.second);
+
+   _http_plugin.add_api({
+       CALL(wallet, wallet_mgr, set_timeout,
+            INVOKE_V_R(wallet_mgr, set_timeout, int64_t), 200),
        CALL(wallet, wallet_mgr, create,
             INVOKE_R_R(wallet_mgr, create, std::string), 201),
        CALL(wallet, wallet_mgr, open,
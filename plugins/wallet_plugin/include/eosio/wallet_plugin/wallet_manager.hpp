@@ -5,6 +5,8 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 #include <chrono>
+#include <mutex>
+#include <shared_mutex>
 
 namespace fc { class variant; }
 
@@ -15,6 +17,8 @@ namespace wallet {
 ///
 /// The name of the wallet is also used as part of the file name by soft_wallet. See wallet_manager::create.
 /// No const methods because timeout may cause lock_all() to be called.
+/// Thread safe: sign_transaction and sign_digest run concurrently with each other, the methods changing the wallets
+/// wait for them.
 class wallet_manager {
 public:
    wallet_manager();
@@ -127,12 +131,23 @@ public:
 
 private:
    /// Verify timeout has not occurred and reset timeout if not.
-   /// Calls lock_all() if timeout has passed.
+   /// Calls lock_all() if timeout has passed. Called before wallets_mtx is taken.
    void check_timeout();
 
+   void open_wallet(const std::string& name);
+   /// @return the unlocked wallet holding key, nullptr if none, wallets_mtx must be held
+   wallet_api* find_key_owner(const public_key_type& key);
+   /// sign digest with key, wallets_mtx must be held
+   fc::optional<signature_type> try_sign_digest(const chain::digest_type& digest, const public_key_type& key);
+
 private:
    using timepoint_t = std::chrono::time_point<std::chrono::system_clock>;
+   std::shared_mutex wallets_mtx; ///< shared by the signing methods, unique for the methods changing wallets
    std::map<std::string, std::unique_ptr<wallet_api>> wallets;
+   std::mutex key_owners_mtx;
+   std::map<public_key_type, wallet_api*> key_owners; ///< public keys of the unlocked wallets, built when first needed
+   bool key_owners_valid = false; ///< cleared with wallets_mtx held uniquely whenever the wallets may have changed
+   std::mutex timeout_mtx;
    std::chrono::seconds timeout = std::chrono::seconds::max(); ///< how long to wait before calling lock_all()
    mutable timepoint_t timeout_time = timepoint_t::max(); ///< when to call lock_all()
    boost::filesystem::path dir = ".";
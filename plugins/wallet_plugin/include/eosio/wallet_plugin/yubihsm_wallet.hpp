@@ -14,7 +14,8 @@ struct yubihsm_wallet_impl;
 
 class yubihsm_wallet final : public wallet_api {
    public:
-      yubihsm_wallet(const string& connector, const uint16_t authkey);
+      /// @param sessions - opened on unlock, up to that many signatures are computed by the HSM at once
+      yubihsm_wallet(const string& connector, const uint16_t authkey, const uint32_t sessions = 1);
       ~yubihsm_wallet();
 
       private_key_type get_private_key(public_key_type pubkey) const override;
@@ -37,6 +37,7 @@ wallet_manager::~wallet_manager() {
 }
 
 void wallet_manager::set_timeout(const std::chrono::seconds& t) {
+   std::lock_guard<std::mutex> g(timeout_mtx);
    timeout = t;
    auto now = std::chrono::system_clock::now();
    timeout_time = now + timeout;
@@ -45,6 +46,7 @@ void wallet_manager::set_timeout(const std::chrono::seconds& t) {
 }
 
 void wallet_manager::check_timeout() {
+   std::lock_guard<std::mutex> g(timeout_mtx);
    if (timeout_time != timepoint_t::max()) {
       const auto& now = std::chrono::system_clock::now();
       if (now >= timeout_time) {
@@ -56,6 +58,8 @@ void wallet_manager::check_timeout() {
 
 std::string wallet_manager::create(const std::string& name) {
    check_timeout();
+   std::unique_lock<std::shared_mutex> g(wallets_mtx);
+   key_owners_valid = false;
 
    EOS_ASSERT(valid_filename(name), wallet_exception, "Invalid filename, path not allowed in wallet name ${n}", ("n", name));
 
@@ -90,7 +94,12 @@ std::string wallet_manager::create(const std::string& name) {
 
 void wallet_manager::open(const std::string& name) {
    check_timeout();
+   std::unique_lock<std::shared_mutex> g(wallets_mtx);
+   key_owners_valid = false;
+   open_wallet(name);
+}
 
+void wallet_manager::open_wallet(const std::string& name) {
    EOS_ASSERT(valid_filename(name), wallet_exception, "Invalid filename, path not allowed in wallet name ${n}", ("n", name));
 
    wallet_data d;
@@ -112,6 +121,7 @@ void wallet_manager::open(const std::string& name) {
 
 std::vector<std::string> wallet_manager::list_wallets() {
    check_timeout();
+   std::shared_lock<std::shared_mutex> g(wallets_mtx);
    std::vector<std::string> result;
    for (const auto& i : wallets) {
       if (i.second->is_locked()) {
@@ -125,6 +135,7 @@ std::vector<std::string> wallet_manager::list_wallets() {
 
 map<public_key_type,private_key_type> wallet_manager::list_keys(const string& name, const string& pw) {
    check_timeout();
+   std::shared_lock<std::shared_mutex> g(wallets_mtx);
 
    if (wallets.count(name) == 0)
       EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
@@ -137,6 +148,7 @@ map<public_key_type,private_key_type> wallet_manager::list_keys(const string& na
 
 flat_set<public_key_type> wallet_manager::get_public_keys() {
    check_timeout();
+   std::shared_lock<std::shared_mutex> g(wallets_mtx);
    EOS_ASSERT(!wallets.empty(), wallet_not_available_exception, "You don't have any wallet!");
    flat_set<public_key_type> result;
    bool is_all_wallet_locked = true;
@@ -153,6 +165,8 @@ flat_set<public_key_type> wallet_manager::get_public_keys() {
 
 void wallet_manager::lock_all() {
    // no call to check_timeout since we are locking all anyway
+   std::unique_lock<std::shared_mutex> g(wallets_mtx);
+   key_owners_valid = false;
    for (auto& i : wallets) {
       if (!i.second->is_locked()) {
          i.second->lock();
@@ -162,6 +176,8 @@ void wallet_manager::lock_all() {
 
 void wallet_manager::lock(const std::string& name) {
    check_timeout();
+   std::unique_lock<std::shared_mutex> g(wallets_mtx);
+   key_owners_valid = false;
    if (wallets.count(name) == 0) {
       EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
    }
@@ -174,8 +190,10 @@ void wallet_manager::lock(const std::string& name) {
 
 void wallet_manager::unlock(const std::string& name, const std::string& password) {
    check_timeout();
+   std::unique_lock<std::shared_mutex> g(wallets_mtx);
+   key_owners_valid = false;
    if (wallets.count(name) == 0) {
-      open( name );
+      open_wallet( name );
    }
    auto& w = wallets.at(name);
    if (!w->is_locked()) {
@@ -187,6 +205,8 @@ void wallet_manager::unlock(const std::string& name, const std::string& password
 
 void wallet_manager::import_key(const std::string& name, const std::string& wif_key) {
    check_timeout();
+   std::unique_lock<std::shared_mutex> g(wallets_mtx);
+   key_owners_valid = false;
    if (wallets.count(name) == 0) {
       EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
    }
@@ -199,6 +219,8 @@ void wallet_manager::import_key(const std::string& name, const std::string& wif_
 
 void wallet_manager::remove_key(const std::string& name, const std::string& password, const std::string& key) {
    check_timeout();
+   std::unique_lock<std::shared_mutex> g(wallets_mtx);
+   key_owners_valid = false;
    if (wallets.count(name) == 0) {
       EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
    }
@@ -212,6 +234,8 @@ void wallet_manager::remove_key(const std::string& name, const std::string& pass
 
 string wallet_manager::create_key(const std::string& name, const std::string& key_type) {
    check_timeout();
+   std::unique_lock<std::shared_mutex> g(wallets_mtx);
+   key_owners_valid = false;
    if (wallets.count(name) == 0) {
       EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
    }
@@ -224,26 +248,53 @@ string wallet_manager::create_key(const std::string& name, const std::string& ke
    return w->create_key(upper_key_type);
 }
 
+wallet_api* wallet_manager::find_key_owner(const public_key_type& key) {
+   std::lock_guard<std::mutex> g(key_owners_mtx);
+   if (!key_owners_valid) {
+      key_owners.clear();
+      for (const auto& i : wallets) {
+         if (!i.second->is_locked()) {
+            for (const auto& k : i.second->list_public_keys())
+               key_owners.emplace(k, i.second.get());
+         }
+      }
+      key_owners_valid = true;
+   }
+   auto itr = key_owners.find(key);
+   return itr != key_owners.end() ? itr->second : nullptr;
+}
+
+fc::optional<signature_type> wallet_manager::try_sign_digest(const chain::digest_type& digest, const public_key_type& key) {
+   if (auto* w = find_key_owner(key)) {
+      if (!w->is_locked()) {
+         if (auto sig = w->try_sign_digest(digest, key))
+            return sig;
+      }
+   }
+   // a wallet may have locked itself since the keys were listed, e.g. the YubiHSM on losing its connector
+   for (const auto& i : wallets) {
+      if (!i.second->is_locked()) {
+         fc::optional<signature_type> sig = i.second->try_sign_digest(digest, key);
+         if (sig)
+            return sig;
+      }
+   }
+   return {};
+}
+
 chain::signed_transaction
 wallet_manager::sign_transaction(const chain::signed_transaction& txn, const flat_set<public_key_type>& keys, const chain::chain_id_type& id) {
    check_timeout();
+   std::shared_lock<std::shared_mutex> g(wallets_mtx);
    chain::signed_transaction stxn(txn);
+   const auto digest = stxn.sig_digest(id, stxn.context_free_data);
 
    for (const auto& pk : keys) {
-      bool found = false;
-      for (const auto& i : wallets) {
-         if (!i.second->is_locked()) {
-            fc::optional<signature_type> sig = i.second->try_sign_digest(stxn.sig_digest(id, stxn.context_free_data), pk);
-            if (sig) {
-               stxn.signatures.push_back(*sig);
-               found = true;
-               break; // inner for
-            }
-         }
-      }
-      if (!found) {
+      fc::optional<signature_type> sig = try_sign_digest(digest, pk);
+      if (!sig) {
          EOS_THROW(chain::wallet_missing_pub_key_exception, "Public key not found in unlocked wallets ${k}", ("k", pk));
       }
+      stxn.signatures.push_back(*sig);
    }
 
    return stxn;
@@ -252,21 +303,20 @@ wallet_manager::sign_transaction(const chain::signed_transaction& txn, const fla
 chain::signature_type
 wallet_manager::sign_digest(const chain::digest_type& digest, const public_key_type& key) {
    check_timeout();
+   std::shared_lock<std::shared_mutex> g(wallets_mtx);
 
    try {
-      for (const auto& i : wallets) {
-         if (!i.second->is_locked()) {
-            fc::optional<signature_type> sig = i.second->try_sign_digest(digest, key);
-            if (sig)
-               return *sig;
-         }
-      }
+      fc::optional<signature_type> sig = try_sign_digest(digest, key);
+      if (sig)
+         return *sig;
    } FC_LOG_AND_RETHROW();
 
    EOS_THROW(chain::wallet_missing_pub_key_exception, "Public key not found in unlocked wallets ${k}", ("k", key));
 }
 
 void wallet_manager::own_and_use_wallet(const string& name, std::unique_ptr<wallet_api>&& wallet) {
+   std::unique_lock<std::shared_mutex> g(wallets_mtx);
+   key_owners_valid = false;
    if(wallets.find(name) != wallets.end())
       EOS_THROW(wallet_exception, "Tried to use wallet name that already exists.");
    wallets.emplace(name, std::move(wallet));
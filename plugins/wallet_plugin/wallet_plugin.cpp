@@ -31,6 +31,8 @@ void wallet_plugin::set_program_options(options_description& cli, options_descri
           "Override default URL of http://localhost:12345 for connecting to yubihsm-connector")
          ("yubihsm-authkey", bpo::value<uint16_t>()->value_name("key_num"),
           "Enables YubiHSM support using given Authkey")
+         ("yubihsm-sessions", bpo::value<uint32_t>()->default_value(1),
+          "Number of YubiHSM sessions opened on unlock, up to that many signatures are computed by the YubiHSM at once")
          ;
 }
 
@@ -58,7 +60,10 @@ void wallet_plugin::plugin_initialize(const variables_map& options) {
          if(options.count("yubihsm-url"))
             connector_endpoint = options.at("yubihsm-url").as<string>();
          try {
-            wallet_manager_ptr->own_and_use_wallet("YubiHSM", make_unique<yubihsm_wallet>(connector_endpoint, key));
+            const uint32_t sessions = options.at("yubihsm-sessions").as<uint32_t>();
+            EOS_ASSERT(sessions > 0 && sessions <= 16, chain::plugin_config_exception,
+                       "yubihsm-sessions must be between 1 and 16, the sessions a YubiHSM holds");
+            wallet_manager_ptr->own_and_use_wallet("YubiHSM", make_unique<yubihsm_wallet>(connector_endpoint, key, sessions));
          }FC_LOG_AND_RETHROW()
       }
    } FC_LOG_AND_RETHROW()
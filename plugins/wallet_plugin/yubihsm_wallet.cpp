@@ -11,6 +11,10 @@
 #include <boost/asio/posix/stream_descriptor.hpp>
 #include <boost/dll/runtime_symbol_info.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
 namespace eosio { namespace wallet {
 
 using namespace fc::crypto::r1;
@@ -20,7 +24,7 @@ namespace detail {
 struct yubihsm_wallet_impl {
    using key_map_type = map<public_key_type,uint16_t>;
 
-   yubihsm_wallet_impl(const string& ep, const uint16_t ak) : endpoint(ep), authkey(ak) {
+   yubihsm_wallet_impl(const string& ep, const uint16_t ak, const uint32_t ns) : endpoint(ep), authkey(ak), num_sessions(std::max(1u, ns)) {
       yh_rc rc;
       if((rc = yh_init()))
          FC_THROW("yubihsm init failure: ${c}", ("c", yh_strerror(rc)));
@@ -38,7 +42,42 @@ struct yubihsm_wallet_impl {
       return !connector;
    }
 
-   key_map_type::iterator populate_key_map_with_keyid(const uint16_t key_id) {
+   /// take an idle session of the pool, waiting for one if they are all signing, nullptr if the wallet is locked
+   yh_session* acquire_session() {
+      std::unique_lock<std::mutex> g(pool_mtx);
+      pool_cv.wait(g, [&]() { return !idle_sessions.empty() || sessions.empty(); });
+      if(sessions.empty())
+         return nullptr;
+      yh_session* s = idle_sessions.back();
+      idle_sessions.pop_back();
+      return s;
+   }
+
+   void release_session(yh_session* s) {
+      {
+         std::lock_guard<std::mutex> g(pool_mtx);
+         idle_sessions.push_back(s);
+      }
+      pool_cv.notify_all();
+   }
+
+   /// every session authenticates with the same password, so the HSM serves them in parallel
+   yh_session* open_session(const string& password) {
+      yh_rc rc;
+      yh_session* s = nullptr;
+      if((rc = yh_create_session_derived(connector, authkey, (const uint8_t *)password.data(), password.size(), false, &s)))
+         FC_THROW_EXCEPTION(chain::wallet_exception, "Failed to create YubiHSM session: ${m}", ("m", yh_strerror(rc)));
+      {
+         std::lock_guard<std::mutex> g(pool_mtx);
+         sessions.push_back(s);
+         idle_sessions.push_back(s);
+      }
+      if((rc = yh_authenticate_session(s)))
+         FC_THROW_EXCEPTION(chain::wallet_exception, "Failed to authenticate YubiHSM session: ${m}", ("m", yh_strerror(rc)));
+      return s;
+   }
+
+   key_map_type::iterator populate_key_map_with_keyid(yh_session* session, const uint16_t key_id) {
       yh_rc rc;
       size_t blob_sz = 128;
       uint8_t blob[blob_sz];
@@ -64,14 +103,13 @@ struct yubihsm_wallet_impl {
       yh_rc rc;
 
       try {
-         if((rc = yh_init_connector(endpoint.c_str(), &connector)))
+         yh_connector* c = nullptr;
+         if((rc = yh_init_connector(endpoint.c_str(), &c)))
             FC_THROW_EXCEPTION(chain::wallet_exception, "Failled to initialize yubihsm connector URL: ${c}", ("c", yh_strerror(rc)));
+         connector = c;
          if((rc = yh_connect(connector, 0)))
             FC_THROW_EXCEPTION(chain::wallet_exception, "Failed to connect to YubiHSM connector: ${m}", ("m", yh_strerror(rc)));
-         if((rc = yh_create_session_derived(connector, authkey, (const uint8_t *)password.data(), password.size(), false, &session)))
-            FC_THROW_EXCEPTION(chain::wallet_exception, "Failed to create YubiHSM session: ${m}", ("m", yh_strerror(rc)));
-         if((rc = yh_authenticate_session(session)))
-            FC_THROW_EXCEPTION(chain::wallet_exception, "Failed to authenticate YubiHSM session: ${m}", ("m", yh_strerror(rc)));
+         yh_session* session = open_session(password);
 
          yh_object_descriptor authkey_desc;
          if((rc = yh_util_get_object_info(session, authkey, YH_AUTHENTICATION_KEY, &authkey_desc)))
@@ -91,7 +129,10 @@ struct yubihsm_wallet_impl {
             FC_THROW_EXCEPTION(chain::wallet_exception, "yh_util_list_objects failed: ${m}", ("m", yh_strerror(rc)));
 
          for(size_t i = 0; i < found_objects_n; ++i)
-            populate_key_map_with_keyid(found_objs[i].id);
+            populate_key_map_with_keyid(session, found_objs[i].id);
+
+         for(uint32_t i = 1; i < num_sessions; ++i)
+            open_session(password);
       }
       catch(chain::wallet_exception& e) {
          lock();
@@ -102,11 +143,18 @@ struct yubihsm_wallet_impl {
    }
 
    void lock() {
-      if(session) {
-         yh_util_close_session(session);
-         yh_destroy_session(&session);
+      {
+         std::unique_lock<std::mutex> g(pool_mtx);
+         // the signatures in progress finish first
+         pool_cv.wait(g, [&]() { return idle_sessions.size() == sessions.size(); });
+         for(yh_session* s : sessions) {
+            yh_util_close_session(s);
+            yh_destroy_session(&s);
+         }
+         sessions.clear();
+         idle_sessions.clear();
       }
-      session = nullptr;
+      pool_cv.notify_all();
       if(connector)
          yh_disconnect(connector);
       //it would seem like this would leak-- there is no destroy() call for it. But I clearly can't reuse connectors
@@ -120,13 +168,21 @@ struct yubihsm_wallet_impl {
    void prime_keepalive_timer() {
       keepalive_timer.expires_at(std::chrono::steady_clock::now() + std::chrono::seconds(20));
       keepalive_timer.async_wait([this](const boost::system::error_code& ec){
-         if(ec || !session)
+         if(ec || is_locked())
             return;
 
-         uint8_t data, resp;
-         yh_cmd resp_cmd;
-         size_t resp_sz = 1;
-         if(yh_send_secure_msg(session, YHC_ECHO, &data, 1, &resp_cmd, &resp, &resp_sz))
+         // the sessions signing are kept alive by their signing
+         bool failed = false;
+         {
+            std::lock_guard<std::mutex> g(pool_mtx);
+            for(yh_session* s : idle_sessions) {
+               uint8_t data, resp;
+               yh_cmd resp_cmd;
+               size_t resp_sz = 1;
+               failed = failed || yh_send_secure_msg(s, YHC_ECHO, &data, 1, &resp_cmd, &resp, &resp_sz);
+            }
+         }
+         if(failed)
             lock();
          else
             prime_keepalive_timer();
@@ -134,14 +190,22 @@ struct yubihsm_wallet_impl {
    }
 
    fc::optional<signature_type> try_sign_digest(const digest_type d, const public_key_type public_key) {
+      // _keys only changes while no session is taken
+      yh_session* session = acquire_session();
+      if(!session)
+         return fc::optional<signature_type>{};
       auto it = _keys.find(public_key);
-      if(it == _keys.end())
+      if(it == _keys.end()) {
+         release_session(session);
          return fc::optional<signature_type>{};
+      }
 
       size_t der_sig_sz = 128;
       uint8_t der_sig[der_sig_sz];
-      yh_rc rc;
-      if((rc = yh_util_sign_ecdsa(session, it->second, (uint8_t*)d.data(), d.data_size(), der_sig, &der_sig_sz))) {
+      yh_rc rc = yh_util_sign_ecdsa(session, it->second, (uint8_t*)d.data(), d.data_size(), der_sig, &der_sig_sz);
+      const auto pub_key = it->first;
+      release_session(session);
+      if(rc) {
          lock();
          FC_THROW_EXCEPTION(chain::wallet_exception, "yh_util_sign_ecdsa failed: ${m}", ("m", yh_strerror(rc)));
       }
@@ -155,9 +219,11 @@ struct yubihsm_wallet_impl {
 
       char pub_key_shim_data[64];
       fc::datastream<char *> eds(pub_key_shim_data, sizeof(pub_key_shim_data));
-      fc::raw::pack(eds, it->first);
+      fc::raw::pack(eds, pub_key);
       public_key_data* kd = (public_key_data*)(pub_key_shim_data+1);
 
+      // an EC_KEY of its own for each signature, they are computed concurrently
+      fc::ec_key key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
       compact_signature compact_sig;
       compact_sig = signature_from_ecdsa(key, *kd, sig, d);
 
@@ -181,21 +247,31 @@ struct yubihsm_wallet_impl {
       if(yh_string_to_capabilities("sign-ecdsa:export-wrapped", &creation_caps))
          FC_THROW_EXCEPTION(chain::wallet_exception, "Cannot create caps mask");
 
+      yh_session* session = acquire_session();
+      FC_ASSERT(session, "YubiHSM wallet is locked");
       try {
          if((rc = yh_util_generate_ec_key(session, &new_key_id, "keosd created key", authkey_domains, &creation_caps, YH_ALGO_EC_P256)))
             FC_THROW_EXCEPTION(chain::wallet_exception, "yh_util_generate_ec_key failed: ${m}", ("m", yh_strerror(rc)));
-         return populate_key_map_with_keyid(new_key_id)->first;
+         const auto pub_key = populate_key_map_with_keyid(session, new_key_id)->first;
+         release_session(session);
+         return pub_key;
       }
       catch(chain::wallet_exception& e) {
+         release_session(session);
          lock();
          throw;
       }
    }
 
-   yh_connector* connector = nullptr;
-   yh_session* session = nullptr;
+   std::atomic<yh_connector*> connector{nullptr};
    string endpoint;
    uint16_t authkey;
+   const uint32_t num_sessions;
+
+   std::mutex pool_mtx;
+   std::condition_variable pool_cv;            ///< signals sessions returned to idle_sessions and the wallet locking
+   std::vector<yh_session*> sessions;          ///< opened at unlock, empty when locked
+   std::vector<yh_session*> idle_sessions;     ///< of sessions, not signing
 
    map<public_key_type,uint16_t> _keys;
 
@@ -203,13 +279,12 @@ struct yubihsm_wallet_impl {
    uint16_t authkey_domains;
 
    boost::asio::steady_timer keepalive_timer{appbase::app().get_io_service()};
-   fc::ec_key key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
 };
 
 
 }
 
-yubihsm_wallet::yubihsm_wallet(const string& connector, const uint16_t authkey) : my(new detail::yubihsm_wallet_impl(connector, authkey)) {
+yubihsm_wallet::yubihsm_wallet(const string& connector, const uint16_t authkey, const uint32_t sessions) : my(new detail::yubihsm_wallet_impl(connector, authkey, sessions)) {
 }
 
 yubihsm_wallet::~yubihsm_wallet() {
@@ -10,6 +10,8 @@
 
 #include <iostream>
 #include <istream>
+#include <map>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <regex>
@@ -30,9 +32,18 @@ using namespace eosio::chain;
 namespace eosio { namespace client { namespace http {
 
    namespace detail {
+      /// a connection kept open after a keep-alive response, for the next request to the same server
+      struct pooled_connection {
+         std::unique_ptr<tcp::socket>                                          socket;
+         std::unique_ptr<boost::asio::ssl::context>                            ssl_context;
+         std::unique_ptr<boost::asio::ssl::stream<tcp::socket>>                ssl_socket;
+      };
+
       class http_context_impl {
          public:
             boost::asio::io_service ios;
+            /// keyed by scheme, server, port and whether the certificate was verified; used by one thread at a time
+            std::map<std::string, pooled_connection> connections;
       };
 
       void http_context_deleter::operator()(http_context_impl* p) const {
@@ -54,16 +65,57 @@ namespace eosio { namespace client { namespace http {
       boost::asio::connect(sock, endpoints);
    }
 
+   /// the server closed a kept alive connection before responding to the request sent on it
+   struct stale_connection {};
+
+   /// read a body sent with "Transfer-Encoding: chunked" from socket, response holds what was read past the headers
    template<class T>
-   std::string do_txrx(T& socket, boost::asio::streambuf& request_buff, unsigned int& status_code) {
-      // Send the request.
-      boost::asio::write(socket, request_buff);
+   void read_chunked(T& socket, boost::asio::streambuf& response, std::string& body) {
+      std::istream response_stream(&response);
+      for (;;) {
+         boost::asio::read_until(socket, response, "\r\n");
+         std::string size_line;
+         std::getline(response_stream, size_line);
+         const size_t chunk_size = std::stoul(size_line, nullptr, 16);
+         if (chunk_size == 0) {
+            // trailers, if any, end with a blank line
+            for (std::string trailer; ; ) {
+               boost::asio::read_until(socket, response, "\r\n");
+               std::getline(response_stream, trailer);
+               if (trailer == "\r" || trailer.empty())
+                  return;
+            }
+         }
+         if (response.size() < chunk_size + 2)
+            boost::asio::read(socket, response, boost::asio::transfer_exactly(chunk_size + 2 - response.size()));
+         const auto start = body.size();
+         body.resize(start + chunk_size);
+         response_stream.read(&body[start], chunk_size);
+         response.consume(2);
+      }
+   }
 
-      // Read the response status line. The response streambuf will automatically
-      // grow to accommodate the entire line. The growth may be limited by passing
-      // a maximum size to the streambuf constructor.
+   /**
+    * @param reused - socket was kept alive from an earlier request, stale_connection is thrown if the server closed
+    *                 it before sending anything back
+    * @param keep_alive - set to whether the server keeps the connection open after this response
+    */
+   template<class T>
+   std::string do_txrx(T& socket, boost::asio::streambuf& request_buff, unsigned int& status_code, bool reused, bool& keep_alive) {
+      // Send the request, a reused request buffer has to be left intact for the retry on a new connection
       boost::asio::streambuf response;
-      boost::asio::read_until(socket, response, "\r\n");
+      try {
+         boost::asio::write(socket, request_buff.data());
+
+         // Read the response status line. The response streambuf will automatically
+         // grow to accommodate the entire line. The growth may be limited by passing
+         // a maximum size to the streambuf constructor.
+         boost::asio::read_until(socket, response, "\r\n");
+      } catch (const boost::system::system_error&) {
+         if (reused && response.size() == 0)
+            throw stale_connection();
+         throw;
+      }
 
       // Check that response is OK.
       std::istream response_stream(&response);
@@ -81,20 +133,33 @@ namespace eosio { namespace client { namespace http {
       // Process the response headers.
       std::string header;
       int response_content_length = -1;
+      bool chunked = false;
+      keep_alive = http_version == "HTTP/1.1";
       std::regex clregex(R"xx(^content-length:\s+(\d+))xx", std::regex_constants::icase);
+      std::regex connregex(R"xx(^connection:\s*(\S+))xx", std::regex_constants::icase);
+      std::regex teregex(R"xx(^transfer-encoding:\s*chunked)xx", std::regex_constants::icase);
       while (std::getline(response_stream, header) && header != "\r") {
          std::smatch match;
          if(std::regex_search(header, match, clregex))
             response_content_length = std::stoi(match[1]);
+         else if(std::regex_search(header, match, connregex))
+            keep_alive = boost::algorithm::iequals(match.str(1), "keep-alive");
+         else if(std::regex_search(header, match, teregex))
+            chunked = true;
       }
 
       // Attempt to read the response body using the length indicated by the
       // Content-length header. If the header was not present just read all available bytes.
-      if( response_content_length != -1 ) {
+      if( chunked ) {
+         std::string body;
+         read_chunked(socket, response, body);
+         return body;
+      } else if( response_content_length != -1 ) {
          response_content_length -= response.size();
          if( response_content_length > 0 )
             boost::asio::read(socket, response, boost::asio::transfer_exactly(response_content_length));
       } else {
+         keep_alive = false;
          boost::system::error_code ec;
          boost::asio::read(socket, response, boost::asio::transfer_all(), ec);
          EOS_ASSERT(!ec || ec == boost::asio::ssl::error::stream_truncated, http_exception, "Unable to read http response: ${err}", ("err",ec.message()));
@@ -195,11 +260,13 @@ namespace eosio { namespace client { namespace http {
    boost::asio::streambuf request;
    std::ostream request_stream(&request);
    auto host_header_value = format_host_header(url);
-   request_stream << "POST " << url.path << " HTTP/1.0\r\n";
+   // keosd answers a single request per connection, connections to nodeos are kept open for the next request
+   const bool keep_alive = url.scheme != "unix";
+   request_stream << "POST " << url.path << (keep_alive ? " HTTP/1.1\r\n" : " HTTP/1.0\r\n");
    request_stream << "Host: " << host_header_value << "\r\n";
    request_stream << "content-length: " << postjson.size() << "\r\n";
    request_stream << "Accept: */*\r\n";
-   request_stream << "Connection: close\r\n";
+   request_stream << (keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
    // append more customized headers
    std::vector<string>::iterator itr;
    for (itr = cp.headers.begin(); itr != cp.headers.end(); itr++) {
@@ -224,28 +291,59 @@ namespace eosio { namespace client { namespace http {
       if(url.scheme == "unix") {
          boost::asio::local::stream_protocol::socket unix_socket(cp.context->ios);
          unix_socket.connect(boost::asio::local::stream_protocol::endpoint(url.server));
-         re = do_txrx(unix_socket, request, status_code);
-      }
-      else if(url.scheme == "http") {
-         tcp::socket socket(cp.context->ios);
-         do_connect(socket, url);
-         re = do_txrx(socket, request, status_code);
+         bool server_keep_alive = false;
+         re = do_txrx(unix_socket, request, status_code, false, server_keep_alive);
       }
-      else { //https
-         boost::asio::ssl::context ssl_context(boost::asio::ssl::context::sslv23_client);
-         fc::add_platform_root_cas_to_context(ssl_context);
-
-         boost::asio::ssl::stream<boost::asio::ip::tcp::socket> socket(cp.context->ios, ssl_context);
-         SSL_set_tlsext_host_name(socket.native_handle(), url.server.c_str());
-         if(cp.verify_cert) {
-            socket.set_verify_mode(boost::asio::ssl::verify_peer);
-            socket.set_verify_callback(boost::asio::ssl::rfc2818_verification(url.server));
+      else {
+         auto& connections = cp.context->connections;
+         const auto key = url.scheme + "://" + url.server + ":" + url.port + (cp.verify_cert ? "" : "#no-verify");
+         for (;;) {
+            auto itr = connections.find(key);
+            const bool reused = itr != connections.end();
+            if (!reused) {
+               detail::pooled_connection conn;
+               if(url.scheme == "http") {
+                  conn.socket = std::make_unique<tcp::socket>(cp.context->ios);
+                  do_connect(*conn.socket, url);
+               }
+               else { //https
+                  conn.ssl_context = std::make_unique<boost::asio::ssl::context>(boost::asio::ssl::context::sslv23_client);
+                  fc::add_platform_root_cas_to_context(*conn.ssl_context);
+
+                  conn.ssl_socket = std::make_unique<boost::asio::ssl::stream<tcp::socket>>(cp.context->ios, *conn.ssl_context);
+                  SSL_set_tlsext_host_name(conn.ssl_socket->native_handle(), url.server.c_str());
+                  if(cp.verify_cert) {
+                     conn.ssl_socket->set_verify_mode(boost::asio::ssl::verify_peer);
+                     conn.ssl_socket->set_verify_callback(boost::asio::ssl::rfc2818_verification(url.server));
+                  }
+                  do_connect(conn.ssl_socket->next_layer(), url);
+                  conn.ssl_socket->handshake(boost::asio::ssl::stream_base::client);
+               }
+               itr = connections.emplace(key, std::move(conn)).first;
+            }
+
+            bool server_keep_alive = false;
+            try {
+               if (itr->second.socket)
+                  re = do_txrx(*itr->second.socket, request, status_code, reused, server_keep_alive);
+               else
+                  re = do_txrx(*itr->second.ssl_socket, request, status_code, reused, server_keep_alive);
+            } catch (const stale_connection&) {
+               connections.erase(itr);
+               continue; // it timed out on the server, which never saw the request, so send it on a new connection
+            } catch (...) {
+               connections.erase(itr);
+               throw;
+            }
+            if (!server_keep_alive) {
+               if (itr->second.ssl_socket) {
+                  //try and do a clean shutdown; but swallow if this fails (other side could have already gave TCP the ax)
+                  try {itr->second.ssl_socket->shutdown();} catch(...) {}
+               }
+               connections.erase(itr);
+            }
+            break;
          }
-         do_connect(socket.next_layer(), url);
-         socket.handshake(boost::asio::ssl::stream_base::client);
-         re = do_txrx(socket, request, status_code);
-         //try and do a clean shutdown; but swallow if this fails (other side could have already gave TCP the ax)
-         try {socket.shutdown();} catch(...) {}
       }
    } catch ( invalid_http_request& e ) {
       e.append_log( FC_LOG_MESSAGE( info, "Please verify this url is valid: ${url}", ("url", url.scheme + "://" + url.server + ":" + url.port + url.path) ) );
@@ -65,7 +65,10 @@ Options:
 */
 
 #include <pwd.h>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <regex>
 #include <iostream>
@@ -565,6 +568,72 @@ void send_transaction( signed_transaction& trx, packed_transaction::compression_
    }
 }
 
+/// call f(i) for every i in [0, n) from up to num_threads threads, each given the index of its thread
+template<typename F>
+void parallel_for( size_t n, uint32_t num_threads, F&& f ) {
+   std::atomic<size_t> next{0};
+   std::mutex mtx;
+   std::exception_ptr error;
+   auto work = [&]( uint32_t t ) {
+      try {
+         for( size_t i = next++; i < n; i = next++ )
+            f( i, t );
+      } catch( ... ) {
+         std::lock_guard<std::mutex> g( mtx );
+         if( !error ) error = std::current_exception();
+         next = n; // the other threads stop at their next index
+      }
+   };
+   num_threads = std::max<uint32_t>( 1, std::min<size_t>( num_threads, n ) );
+   std::vector<std::thread> threads;
+   for( uint32_t t = 1; t < num_threads; ++t )
+      threads.emplace_back( work, t );
+   work( 0 );
+   for( auto& t : threads )
+      t.join();
+   if( error )
+      std::rethrow_exception( error );
+}
+
+/// the actions of a batch file, each element is an action or an array of the actions of one transaction
+vector<vector<chain::action>> batch_file_actions( const fc::variant& input, uint32_t actions_per_trx,
+                                                  const vector<chain::permission_level>& default_authorization ) {
+   EOSC_ASSERT( input.is_array(), "ERROR: batch file must hold an array of actions" );
+   auto to_action = [&]( const fc::variant& v ) {
+      EOSC_ASSERT( v.is_object(), "ERROR: action ${a} is not an object", ("a", v) );
+      const auto& obj = v.get_object();
+      chain::action act;
+      act.account = obj["account"].as<name>();
+      act.name = obj["name"].as<name>();
+      act.authorization = obj.contains( "authorization" ) ? obj["authorization"].as<vector<chain::permission_level>>()
+                                                          : default_authorization;
+      EOSC_ASSERT( !act.authorization.empty(), "ERROR: action ${a} has no authorization and no -p,--permission was given", ("a", v) );
+      if( obj.contains( "data" ) ) {
+         const auto& data = obj["data"];
+         act.data = data.is_string() ? data.as<bytes>() : variant_to_bin( act.account, act.name, data );
+      }
+      return act;
+   };
+
+   vector<vector<chain::action>> trxs;
+   bool grouping = false; ///< the last transaction is filled from single actions
+   for( const auto& v : input.get_array() ) {
+      if( v.is_array() ) {
+         vector<chain::action> actions;
+         for( const auto& a : v.get_array() )
+            actions.emplace_back( to_action( a ) );
+         trxs.emplace_back( std::move( actions ) );
+         grouping = false;
+      } else {
+         if( !grouping || trxs.back().size() >= actions_per_trx )
+            trxs.emplace_back();
+         trxs.back().emplace_back( to_action( v ) );
+         grouping = true;
+      }
+   }
+   return trxs;
+}
+
 chain::permission_level to_permission_level(const std::string& s) {
    auto at_pos = s.find('@');
    return permission_level { name(s.substr(0, at_pos)), name(s.substr(at_pos + 1)) };
@@ -3435,6 +3504,147 @@ int main( int argc, char** argv ) {
       std::cout << fc::json::to_pretty_string(trxs_result) << std::endl;
    });
 
+   // push batch
+   string batch_file;
+   uint32_t batch_actions_per_trx = 1;
+   uint32_t batch_size = 100;
+   uint32_t batch_concurrency = 4;
+   uint32_t batch_sign_threads = std::max( 1u, std::thread::hardware_concurrency() );
+   vector<string> batch_private_keys;
+   auto batchSubcommand = push->add_subcommand("batch", localized("Build, sign and push many transactions from a file of actions"));
+   batchSubcommand->add_option("file", batch_file, localized("The JSON string or filename defining an array of actions, an element that is an array of actions is one transaction"))->required();
+   batchSubcommand->add_option("--actions-per-trx", batch_actions_per_trx, localized("The number of consecutive actions of the file put in each transaction"), true);
+   batchSubcommand->add_option("--batch-size", batch_size, localized("The number of transactions in each push_transactions request, at most 1000"), true);
+   batchSubcommand->add_option("--concurrency", batch_concurrency, localized("The number of push_transactions requests in flight at once"), true);
+   batchSubcommand->add_option("--sign-threads", batch_sign_threads, localized("The number of threads signing the transactions"), true);
+   batchSubcommand->add_option("-k,--private-key", batch_private_keys, localized("A private key to sign the transactions with instead of ${exec}, may be given multiple times", ("exec", key_store_executable_name)));
+   add_standard_transaction_options(batchSubcommand);
+
+   batchSubcommand->callback([&] {
+      EOSC_ASSERT( batch_actions_per_trx > 0, "ERROR: --actions-per-trx must be positive" );
+      EOSC_ASSERT( batch_size > 0 && batch_size <= 1000, "ERROR: --batch-size must be between 1 and 1000" );
+      EOSC_ASSERT( batch_concurrency > 0 && batch_sign_threads > 0, "ERROR: --concurrency and --sign-threads must be positive" );
+
+      // the ABIs are fetched and the action data serialized here, the resolver cache is not thread safe
+      const auto actions = batch_file_actions( json_from_file_or_string( batch_file, fc::json::parse_type::relaxed_parser ),
+                                               batch_actions_per_trx, get_account_permissions( tx_permission ) );
+
+      // the chain info, reference block, available keys and required keys are fetched once for the whole batch
+      const auto info = get_info();
+      block_id_type ref_block_id = info.last_irreversible_block_id;
+      try {
+         if (!tx_ref_block_num_or_id.empty()) {
+            const auto ref_block = call(get_block_func, fc::mutable_variant_object("block_num_or_id", tx_ref_block_num_or_id));
+            ref_block_id = ref_block["id"].as<block_id_type>();
+         }
+      } EOS_RETHROW_EXCEPTIONS(invalid_ref_block_exception, "Invalid reference block num or id: ${block_num_or_id}", ("block_num_or_id", tx_ref_block_num_or_id));
+
+      const auto nonce_base = fc::time_point::now().time_since_epoch().count();
+      vector<signed_transaction> trxs( actions.size() );
+      for( size_t i = 0; i < actions.size(); ++i ) {
+         auto& trx = trxs[i];
+         trx.actions = actions[i];
+         trx.expiration = info.head_block_time + tx_expiration;
+         trx.set_reference_block( ref_block_id );
+         if( tx_force_unique )
+            trx.context_free_actions.emplace_back( vector<permission_level>{}, config::null_account_name, name("nonce"), fc::raw::pack( nonce_base + i ) );
+         trx.max_cpu_usage_ms = tx_max_cpu_usage;
+         trx.max_net_usage_words = (tx_max_net_usage + 7)/8;
+         trx.delay_sec = delaysec;
+      }
+
+      if( !tx_skip_sign ) {
+         std::map<public_key_type, private_key_type> local_keys;
+         for( const auto& k : batch_private_keys ) {
+            private_key_type priv_key;
+            try {
+               priv_key = private_key_type( k );
+            } EOS_RETHROW_EXCEPTIONS(private_key_type_exception, "Invalid private key")
+            local_keys.emplace( priv_key.get_public_key(), priv_key );
+         }
+         fc::variant available_keys;
+         if( local_keys.empty() ) {
+            available_keys = call( wallet_url, wallet_public_keys );
+         } else {
+            vector<public_key_type> keys;
+            for( const auto& k : local_keys ) keys.push_back( k.first );
+            available_keys = fc::variant( keys );
+         }
+
+         // the keys required depend only on the authorizations of a transaction
+         std::map<flat_set<permission_level>, fc::variant> required_keys;
+         vector<const fc::variant*> trx_keys( trxs.size() );
+         for( size_t i = 0; i < trxs.size(); ++i ) {
+            flat_set<permission_level> auths;
+            for( const auto& a : trxs[i].actions )
+               auths.insert( a.authorization.begin(), a.authorization.end() );
+            auto itr = required_keys.find( auths );
+            if( itr == required_keys.end() ) {
+               const auto result = call( get_required_keys, fc::mutable_variant_object
+                                            ("transaction", (transaction)trxs[i])
+                                            ("available_keys", available_keys) );
+               itr = required_keys.emplace( std::move( auths ), result["required_keys"] ).first;
+            }
+            trx_keys[i] = &itr->second;
+         }
+
+         vector<http_context> contexts( batch_sign_threads );
+         for( auto& c : contexts ) c = create_http_context();
+         parallel_for( trxs.size(), batch_sign_threads, [&]( size_t i, uint32_t t ) {
+            if( !local_keys.empty() ) {
+               for( const auto& k : trx_keys[i]->as<vector<public_key_type>>() )
+                  trxs[i].sign( local_keys.at( k ), info.chain_id );
+            } else {
+               fc::variants sign_args = {fc::variant(trxs[i]), *trx_keys[i], fc::variant(info.chain_id)};
+               connection_param cp( contexts[t], parse_url( wallet_url ) + wallet_sign_trx, no_verify ? false : true, headers );
+               trxs[i] = do_http_call( cp, fc::variant( sign_args ), print_request, print_response ).as<signed_transaction>();
+            }
+         } );
+      }
+
+      if( tx_dont_broadcast ) {
+         if( tx_return_packed ) {
+            vector<packed_transaction> packed;
+            for( const auto& trx : trxs ) packed.emplace_back( trx, packed_transaction::compression_type::none );
+            std::cout << fc::json::to_pretty_string( packed ) << std::endl;
+         } else {
+            std::cout << fc::json::to_pretty_string( trxs ) << std::endl;
+         }
+         return;
+      }
+
+      const size_t num_batches = (trxs.size() + batch_size - 1) / batch_size;
+      vector<fc::variant> results( num_batches );
+      vector<http_context> contexts( batch_concurrency );
+      for( auto& c : contexts ) c = create_http_context();
+      parallel_for( num_batches, batch_concurrency, [&]( size_t b, uint32_t t ) {
+         vector<packed_transaction> packed;
+         for( size_t i = b * batch_size; i < std::min<size_t>( trxs.size(), (b + 1) * batch_size ); ++i )
+            packed.emplace_back( trxs[i], packed_transaction::compression_type::none );
+         connection_param cp( contexts[t], parse_url( url ) + push_txns_func, no_verify ? false : true, headers );
+         results[b] = do_http_call( cp, fc::variant( packed ), print_request, print_response );
+      } );
+
+      // a line for each transaction, in the order of the file
+      size_t failed = 0;
+      for( const auto& r : results ) {
+         for( const auto& trx_result : r.get_array() ) {
+            const auto& processed = trx_result["processed"];
+            auto line = fc::mutable_variant_object( "transaction_id", trx_result["transaction_id"] );
+            if( processed.is_object() && processed.get_object().contains( "error" ) ) {
+               line( "error", processed["error"] );
+            } else if( processed.is_object() && processed.get_object().contains( "except" ) && !processed["except"].is_null() ) {
+               line( "error", processed["except"] );
+            }
+            if( line.find( "error" ) != line.end() ) ++failed;
+            std::cout << fc::json::to_string( line, fc::time_point::maximum() ) << "\n";
+         }
+      }
+      std::cout << std::flush;
+      std::cerr << localized("pushed ${n} transactions, ${f} failed", ("n", trxs.size())("f", failed)) << std::endl;
+      EOSC_ASSERT( failed == 0, "ERROR: ${f} transactions failed", ("f", failed) );
+   });
+
 
    // multisig subcommand
    auto msig = app.add_subcommand("multisig", localized("Multisig contract commands"));
@@ -2,7 +2,8 @@
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/config.hpp>
-#include <eosio/chain/reversible_block_object.hpp>
+#include <eosio/chain/reversible_block_log.hpp>
+#include <eosio/chain/thread_utils.hpp>
 
 #include <fc/io/json.hpp>
 #include <fc/filesystem.hpp>
@@ -15,6 +16,10 @@
 #include <boost/filesystem/path.hpp>
 
 #include <chrono>
+#include <deque>
+#include <future>
+#include <set>
+#include <thread>
 
 #ifndef _WIN32
 #define FOPEN(p, m) fopen(p, m)
@@ -38,6 +43,11 @@ struct blocklog {
    void set_program_options(options_description& cli);
    void initialize(const variables_map& options);
 
+   /// @return the output of the blocks of the batch which pass the filters, one string per block
+   std::vector<std::string> format_blocks(const std::vector<packed_block_view>& batch) const;
+   bool matches(const signed_block& block) const;
+   bool matches(const action& act) const;
+
    bfs::path                        blocks_dir;
    bfs::path                        output_file;
    uint32_t                         first_block = 0;
@@ -47,7 +57,18 @@ struct blocklog {
    bool                             make_index = false;
    bool                             trim_log = false;
    bool                             smoke_test = false;
+   uint32_t                         convert_version = 0;
+   uint32_t                         index_threads = 1;
+   bool                             extract_log = false;
+   bool                             verify_log = false;
+   uint32_t                         verify_threads = 1;
+   uint32_t                         export_threads = 1;
+   std::string                      output_format = "json";
+   std::set<name>                   filter_accounts;
+   std::set<std::pair<name, name>>  filter_actions;
    bool                             help = false;
+
+   static constexpr uint32_t        export_batch_size = 256; ///< blocks formatted together by an export thread
 };
 
 struct report_time {
@@ -79,31 +100,25 @@ void blocklog::read_log() {
       first_block = block_logger.first_block_num();
    }
 
-   optional<chainbase::database> reversible_blocks;
+   optional<reversible_block_log> reversible_blocks;
    try {
-      reversible_blocks.emplace(blocks_dir / config::reversible_blocks_dir_name, chainbase::database::read_only, config::default_reversible_cache_size);
-      reversible_blocks->add_index<reversible_block_index>();
-      const auto& idx = reversible_blocks->get_index<reversible_block_index,by_num>();
-      auto first = idx.lower_bound(end->block_num());
-      auto last = idx.rbegin();
-      if (first != idx.end() && last != idx.rend())
-         ilog( "existing reversible block num ${first} through block num ${last} ", ("first",first->get_block()->block_num())("last",last->get_block()->block_num()) );
+      reversible_blocks.emplace(blocks_dir / config::reversible_blocks_dir_name, true);
+      if (!reversible_blocks->empty() && reversible_blocks->last_block_num() >= end->block_num())
+         ilog( "existing reversible block num ${first} through block num ${last} ",
+               ("first",std::max(reversible_blocks->first_block_num(), end->block_num()))("last",reversible_blocks->last_block_num()) );
       else {
-         elog( "no blocks available in reversible block database: only block_log blocks are available" );
+         elog( "no blocks available in reversible block log: only block_log blocks are available" );
          reversible_blocks.reset();
       }
-   } catch( const std::runtime_error& e ) {
-      if( std::string(e.what()).find("database dirty flag set") != std::string::npos ) {
-         elog( "database dirty flag set (likely due to unclean shutdown): only block_log blocks are available" );
-      } else {
-         throw;
-      }
+   } catch( const fc::exception& e ) {
+      elog( "unable to read reversible block log: only block_log blocks are available\n${details}", ("details", e.to_detail_string()) );
+      reversible_blocks.reset();
    }
 
    std::ofstream output_blocks;
    std::ostream* out;
    if (!output_file.empty()) {
-      output_blocks.open(output_file.generic_string().c_str());
+      output_blocks.open(output_file.generic_string().c_str(), output_format == "binary" ? std::ios::out | std::ios::binary : std::ios::out);
       if (output_blocks.fail()) {
          std::ostringstream ss;
          ss << "Unable to open file '" << output_file.string() << "'";
@@ -116,52 +131,158 @@ void blocklog::read_log() {
 
    if (as_json_array)
       *out << "[";
+   bool contains_obj = false;
+   auto write_blocks = [&](const std::vector<std::string>& blocks) {
+      for (const auto& b : blocks) {
+         if (as_json_array && contains_obj)
+            *out << ",";
+         out->write(b.data(), b.size());
+         contains_obj = true;
+      }
+   };
+
+   // batches are formatted in parallel and written in order, at most 2 batches per thread are pending
+   optional<named_thread_pool> thread_pool;
+   if (export_threads > 1)
+      thread_pool.emplace("export", export_threads);
+   std::deque<std::future<std::vector<std::string>>> pending;
+   std::vector<packed_block_view> batch;
+   auto submit_batch = [&]() {
+      if (batch.empty())
+         return;
+      if (!thread_pool) {
+         write_blocks(format_blocks(batch));
+      } else {
+         pending.emplace_back(async_thread_pool(thread_pool->get_executor(), [this, b{std::move(batch)}]() {
+            return format_blocks(b);
+         }));
+         while (pending.size() > 2 * export_threads) {
+            write_blocks(pending.front().get());
+            pending.pop_front();
+         }
+      }
+      batch.clear();
+   };
+
    uint32_t block_num = (first_block < 1) ? 1 : first_block;
-   signed_block_ptr next;
-   fc::variant pretty_output;
+   while (block_num <= last_block) {
+      auto packed = block_logger.read_packed_block_by_num(block_num);
+      if (!packed)
+         break;
+      batch.emplace_back(std::move(packed));
+      ++block_num;
+      if (batch.size() == export_batch_size)
+         submit_batch();
+   }
+
+   if (reversible_blocks) {
+      signed_block_ptr next;
+      while( (block_num <= last_block) && (next = reversible_blocks->get_block(block_num)) ) {
+         auto data = std::make_shared<std::vector<char>>(fc::raw::pack(*next));
+         packed_block_view packed;
+         packed.data = data->data();
+         packed.size = data->size();
+         packed.owner = std::move(data);
+         batch.emplace_back(std::move(packed));
+         ++block_num;
+         if (batch.size() == export_batch_size)
+            submit_batch();
+      }
+   }
+
+   submit_batch();
+   for (auto& f : pending)
+      write_blocks(f.get());
+   pending.clear();
+
+   if (as_json_array)
+      *out << "]";
+   rt.report();
+}
+
+std::vector<std::string> blocklog::format_blocks(const std::vector<packed_block_view>& batch) const {
+   const bool filtered = !filter_accounts.empty() || !filter_actions.empty();
    const fc::microseconds deadline = fc::seconds(10);
-   auto print_block = [&](signed_block_ptr& next) {
-      abi_serializer::to_variant(*next,
+   std::vector<std::string> result;
+   result.reserve(batch.size());
+   // little endian size followed by the packed signed_block as it is in the log, it is not unpacked unless filtered
+   auto frame = [&](const packed_block_view& packed) {
+      std::string framed(sizeof(uint32_t) + packed.size, '\0');
+      const uint32_t size = packed.size;
+      memcpy(&framed[0], &size, sizeof(size));
+      memcpy(&framed[sizeof(size)], packed.data, packed.size);
+      result.emplace_back(std::move(framed));
+   };
+   for (const auto& packed : batch) {
+      if (output_format == "binary" && !filtered) {
+         frame(packed);
+         continue;
+      }
+
+      signed_block block;
+      fc::datastream<const char*> ds(packed.data, packed.size);
+      fc::raw::unpack(ds, block);
+      if (!matches(block))
+         continue;
+
+      if (output_format == "binary") {
+         frame(packed);
+         continue;
+      }
+
+      fc::variant pretty_output;
+      abi_serializer::to_variant(block,
                                  pretty_output,
                                  []( account_name n ) { return optional<abi_serializer>(); },
                                  abi_serializer::create_yield_function( deadline ));
-      const auto block_id = next->id();
+      const auto block_id = block.id();
       const uint32_t ref_block_prefix = block_id._hash[1];
       const auto enhanced_object = fc::mutable_variant_object
-                 ("block_num",next->block_num())
+                 ("block_num",block.block_num())
                  ("id", block_id)
                  ("ref_block_prefix", ref_block_prefix)
                  (pretty_output.get_object());
       fc::variant v(std::move(enhanced_object));
-      if (no_pretty_print)
-         *out << fc::json::to_string(v, fc::time_point::maximum());
+      if (output_format == "ndjson")
+         result.emplace_back(fc::json::to_string(v, fc::time_point::maximum()) + "\n");
+      else if (no_pretty_print)
+         result.emplace_back(fc::json::to_string(v, fc::time_point::maximum()));
       else
-         *out << fc::json::to_pretty_string(v) << "\n";
-   };
-   bool contains_obj = false;
-   while((block_num <= last_block) && (next = block_logger.read_block_by_num( block_num ))) {
-      if (as_json_array && contains_obj)
-         *out << ",";
-      print_block(next);
-      ++block_num;
-      contains_obj = true;
+         result.emplace_back(fc::json::to_pretty_string(v) + "\n");
    }
+   return result;
+}
 
-   if (reversible_blocks) {
-      const reversible_block_object* obj = nullptr;
-      while( (block_num <= last_block) && (obj = reversible_blocks->find<reversible_block_object,by_num>(block_num)) ) {
-         if (as_json_array && contains_obj)
-            *out << ",";
-         auto next = obj->get_block();
-         print_block(next);
-         ++block_num;
-         contains_obj = true;
+bool blocklog::matches(const signed_block& block) const {
+   if (filter_accounts.empty() && filter_actions.empty())
+      return true;
+   // only the transactions included whole can be filtered, a receipt of a deferred transaction holds just its id
+   for (const auto& receipt : block.transactions) {
+      if (!receipt.trx.contains<packed_transaction>())
+         continue;
+      const auto& trx = receipt.trx.get<packed_transaction>().get_transaction();
+      for (const auto& act : trx.context_free_actions) {
+         if (matches(act))
+            return true;
+      }
+      for (const auto& act : trx.actions) {
+         if (matches(act))
+            return true;
       }
    }
+   return false;
+}
 
-   if (as_json_array)
-      *out << "]";
-   rt.report();
+bool blocklog::matches(const action& act) const {
+   if (filter_actions.count(std::make_pair(act.account, act.name)))
+      return true;
+   if (filter_accounts.count(act.account))
+      return true;
+   for (const auto& auth : act.authorization) {
+      if (filter_accounts.count(auth.actor))
+         return true;
+   }
+   return false;
 }
 
 void blocklog::set_program_options(options_description& cli)
@@ -179,12 +300,30 @@ void blocklog::set_program_options(options_description& cli)
           "Do not pretty print the output.  Useful if piping to jq to improve performance.")
          ("as-json-array", bpo::bool_switch(&as_json_array)->default_value(false),
           "Print out json blocks wrapped in json array (otherwise the output is free-standing json objects).")
+         ("output-format", bpo::value<std::string>(&output_format)->default_value("json"),
+          "Format of the blocks printed: 'json', 'ndjson' for a compact JSON object per line, or 'binary' for each packed signed_block prefixed by its size as a little endian uint32.")
+         ("export-threads", bpo::value<uint32_t>(&export_threads)->default_value(1),
+          "Number of threads converting the blocks printed, blocks are still printed in order.")
+         ("filter-account", bpo::value<std::vector<std::string>>()->composing(),
+          "Print only the blocks with an action of the account or authorized by it. May be specified multiple times.")
+         ("filter-action", bpo::value<std::vector<std::string>>()->composing(),
+          "Print only the blocks with the action, given as account::action. May be specified multiple times, blocks matching any of filter-account and filter-action are printed.")
          ("make-index", bpo::bool_switch(&make_index)->default_value(false),
           "Create blocks.index from blocks.log. Must give 'blocks-dir'. Give 'output-file' relative to current directory or absolute path (default is <blocks-dir>/blocks.index).")
+         ("index-threads", bpo::value<uint32_t>(&index_threads)->default_value(std::max(1u, std::thread::hardware_concurrency())),
+          "Number of threads used by make-index, large block logs are split into regions indexed in parallel.")
          ("trim-blocklog", bpo::bool_switch(&trim_log)->default_value(false),
           "Trim blocks.log and blocks.index. Must give 'blocks-dir' and 'first and/or 'last'.")
+         ("extract-blocklog", bpo::bool_switch(&extract_log)->default_value(false),
+          "Write blocks 'first' to 'last' of blocks.log to a new blocks.log and blocks.index starting at 'first', leaving the original untouched. Must give 'blocks-dir' and 'output-file' as the directory for the extracted files.")
+         ("verify-log", bpo::bool_switch(&verify_log)->default_value(false),
+          "Verify every block of blocks.log: its position against blocks.index, its transaction_mroot and its previous block id. Reports the first corrupt block and exits non-zero if there is one. Must give 'blocks-dir'.")
+         ("verify-threads", bpo::value<uint32_t>(&verify_threads)->default_value(std::max(1u, std::thread::hardware_concurrency())),
+          "Number of threads verifying ranges of the block log in parallel with verify-log.")
          ("smoke-test", bpo::bool_switch(&smoke_test)->default_value(false),
           "Quick test that blocks.log and blocks.index are well formed and agree with each other.")
+         ("convert-version", bpo::value<uint32_t>(&convert_version),
+          "Write blocks.log and blocks.index converted to the given block log version (3 is uncompressed, 4 is compressed). Must give 'blocks-dir' and 'output-file' as the directory for the converted files.")
          ("help,h", bpo::bool_switch(&help)->default_value(false), "Print this help message and exit.")
          ;
 }
@@ -204,6 +343,25 @@ void blocklog::initialize(const variables_map& options) {
          else
             output_file = bld;
       }
+
+      EOS_ASSERT( output_format == "json" || output_format == "ndjson" || output_format == "binary", fc::invalid_arg_exception,
+                  "output-format must be json, ndjson or binary" );
+      EOS_ASSERT( !as_json_array || output_format == "json", fc::invalid_arg_exception,
+                  "as-json-array requires output-format json" );
+      EOS_ASSERT( export_threads > 0, fc::invalid_arg_exception, "export-threads must be positive" );
+
+      if (options.count( "filter-account" )) {
+         for (const auto& a : options.at( "filter-account" ).as<std::vector<std::string>>())
+            filter_accounts.insert(name(a));
+      }
+      if (options.count( "filter-action" )) {
+         for (const auto& a : options.at( "filter-action" ).as<std::vector<std::string>>()) {
+            const auto pos = a.find("::");
+            EOS_ASSERT( pos != std::string::npos, fc::invalid_arg_exception,
+                        "filter-action '${a}' is not of the form account::action", ("a", a) );
+            filter_actions.emplace(name(a.substr(0, pos)), name(a.substr(pos + 2)));
+         }
+      }
    } FC_LOG_AND_RETHROW()
 
 }
@@ -286,6 +444,18 @@ int main(int argc, char** argv) {
          smoke_test(vmap.at("blocks-dir").as<bfs::path>());
          return 0;
       }
+      if (blog.verify_log) {
+         report_time rt("verifying blocklog");
+         const auto result = block_log::verify(vmap.at("blocks-dir").as<bfs::path>(), blog.verify_threads);
+         rt.report();
+         if (result.first_corrupt_block) {
+            elog("block ${n} is corrupt: ${e}, ${v} blocks from ${first} verified",
+                 ("n", *result.first_corrupt_block)("e", result.error)("v", result.blocks_verified)("first", result.first_block_num));
+            return -1;
+         }
+         ilog("verified blocks ${first} to ${last}", ("first", result.first_block_num)("last", result.last_block_num));
+         return 0;
+      }
       if (blog.trim_log) {
          if (blog.first_block == 0 && blog.last_block == std::numeric_limits<uint32_t>::max()) {
             std::cerr << "trim-blocklog does nothing unless specify first and/or last block.";
@@ -301,6 +471,27 @@ int main(int argc, char** argv) {
          }
          return 0;
       }
+      if (blog.extract_log) {
+         if (vmap.count("output-file") == 0) {
+            std::cerr << "extract-blocklog needs 'output-file' to specify the directory for the extracted block log.";
+            return -1;
+         }
+         report_time rt("extracting blocklog");
+         block_log::extract_blocklog(vmap.at("blocks-dir").as<bfs::path>(), vmap.at("output-file").as<bfs::path>(),
+                                     blog.first_block, blog.last_block);
+         rt.report();
+         return 0;
+      }
+      if (blog.convert_version != 0) {
+         if (vmap.count("output-file") == 0) {
+            std::cerr << "convert-version needs 'output-file' to specify the directory for the converted block log.";
+            return -1;
+         }
+         report_time rt("converting blocklog");
+         block_log::convert_version(vmap.at("blocks-dir").as<bfs::path>(), vmap.at("output-file").as<bfs::path>(), blog.convert_version);
+         rt.report();
+         return 0;
+      }
       if (blog.make_index) {
          const bfs::path blocks_dir = vmap.at("blocks-dir").as<bfs::path>();
          bfs::path out_file = blocks_dir / "blocks.index";
@@ -312,7 +503,7 @@ int main(int argc, char** argv) {
          report_time rt("making index");
          const auto log_level = fc::logger::get(DEFAULT_LOGGER).get_log_level();
          fc::logger::get(DEFAULT_LOGGER).set_log_level(fc::log_level::debug);
-         block_log::construct_index(block_file.generic_string(), out_file.generic_string());
+         block_log::construct_index(block_file.generic_string(), out_file.generic_string(), blog.index_threads);
          fc::logger::get(DEFAULT_LOGGER).set_log_level(log_level);
          rt.report();
          return 0;
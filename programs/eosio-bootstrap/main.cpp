@@ -0,0 +1,211 @@
+#include <eosio/net_plugin/protocol.hpp>
+
+#include <fc/crypto/rand.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/exception/diagnostic_information.hpp>
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+using namespace eosio;
+using namespace eosio::chain;
+namespace bpo = boost::program_options;
+using bpo::options_description;
+using bpo::variables_map;
+using boost::asio::ip::tcp;
+
+namespace {
+   // must match net_plugin.cpp
+   constexpr uint16_t net_version_base = 0x04b5;
+   constexpr uint16_t proto_snapshot_bootstrap = 4;
+   constexpr uint32_t max_message_size = 8*1024*1024;
+   constexpr uint32_t go_away_which = 2;           // see protocol net_message
+   constexpr uint32_t snapshot_chunk_which = 11;   // see protocol net_message
+   /// requests kept in flight, the peer answers them in order
+   constexpr uint32_t request_window = 8;
+}
+
+/**
+ * Downloads the snapshot a peer serves with p2p-snapshot-bootstrap-dir over its p2p endpoint. Written to stdout it can
+ * be piped into `nodeos --snapshot /dev/stdin`, which loads it while it is downloaded and then syncs the blocks after
+ * it from its p2p peers as usual.
+ */
+struct bootstrap {
+   void set_program_options(options_description& cli);
+   void run();
+
+   std::string    peer;
+   std::string    chain_id_str;
+   std::string    output = "-";
+   bool           help = false;
+
+private:
+   void send( const net_message& msg );
+   /// @return the next snapshot_chunk_message, skipping the other messages of the peer
+   snapshot_chunk_message receive_chunk();
+   void request( uint64_t offset );
+
+   boost::asio::io_context  ctx;
+   tcp::socket              socket{ctx};
+   block_id_type            block_id;
+};
+
+void bootstrap::set_program_options(options_description& cli)
+{
+   cli.add_options()
+         ("peer", bpo::value<std::string>(&peer)->required(),
+          "host:port of the p2p endpoint of a nodeos serving a snapshot with p2p-snapshot-bootstrap-dir")
+         ("chain-id", bpo::value<std::string>(&chain_id_str)->required(),
+          "chain id of the peer, in hex")
+         ("output", bpo::value<std::string>(&output)->default_value("-"),
+          "file to write the snapshot to, - for stdout")
+         ("help,h", bpo::bool_switch(&help)->default_value(false), "Print this help message and exit.")
+         ;
+}
+
+void bootstrap::send( const net_message& msg ) {
+   const uint32_t size = fc::raw::pack_size( msg );
+   std::vector<char> buffer( sizeof(size) + size );
+   fc::datastream<char*> ds( buffer.data(), buffer.size() );
+   ds.write( reinterpret_cast<const char*>( &size ), sizeof(size) ); // as net_plugin, not variable size encoded
+   fc::raw::pack( ds, msg );
+   boost::asio::write( socket, boost::asio::buffer( buffer ) );
+}
+
+snapshot_chunk_message bootstrap::receive_chunk() {
+   std::vector<char> buffer;
+   while( true ) {
+      uint32_t size = 0;
+      boost::asio::read( socket, boost::asio::buffer( &size, sizeof(size) ) );
+      EOS_ASSERT( size > 0 && size <= max_message_size, fc::invalid_arg_exception, "invalid message size ${s} from peer", ("s", size) );
+      buffer.resize( size );
+      boost::asio::read( socket, boost::asio::buffer( buffer ) );
+
+      fc::datastream<const char*> ds( buffer.data(), buffer.size() );
+      unsigned_int which;
+      fc::raw::unpack( ds, which );
+      if( which == go_away_which ) {
+         go_away_message msg;
+         fc::raw::unpack( ds, msg );
+         EOS_THROW( fc::invalid_operation_exception, "peer closed the connection: ${r}", ("r", reason_str( msg.reason )) );
+      }
+      if( which == snapshot_chunk_which ) {
+         snapshot_chunk_message msg;
+         fc::raw::unpack( ds, msg );
+         return msg;
+      }
+   }
+}
+
+void bootstrap::request( uint64_t offset ) {
+   snapshot_request_message req;
+   req.block_id = block_id;
+   req.offset = offset;
+   send( req );
+}
+
+void bootstrap::run() {
+   const auto colon = peer.rfind( ':' );
+   EOS_ASSERT( colon != std::string::npos, fc::invalid_arg_exception, "peer ${p} is not host:port", ("p", peer) );
+   tcp::resolver resolver( ctx );
+   boost::asio::connect( socket, resolver.resolve( peer.substr( 0, colon ), peer.substr( colon + 1 ) ) );
+
+   handshake_message hello;
+   hello.network_version = net_version_base + proto_snapshot_bootstrap;
+   hello.chain_id = chain_id_type( chain_id_str );
+   fc::rand_pseudo_bytes( hello.node_id.data(), hello.node_id.data_size() );
+   namespace sc = std::chrono;
+   hello.time = sc::duration_cast<sc::nanoseconds>(sc::system_clock::now().time_since_epoch()).count();
+   // unique, so that the peer does not take two bootstraps for duplicate connections
+   hello.p2p_address = "eosio-bootstrap - " + hello.node_id.str().substr( 0, 7 );
+#if defined( __APPLE__ )
+   hello.os = "osx";
+#elif defined( __linux__ )
+   hello.os = "linux";
+#else
+   hello.os = "other";
+#endif
+   hello.agent = "eosio-bootstrap";
+   hello.generation = 1;
+   send( hello );
+
+   std::unique_ptr<std::ofstream> file;
+   if( output != "-" ) file = std::make_unique<std::ofstream>( output, (std::ios::out | std::ios::binary | std::ios::trunc) );
+   std::ostream& out = file ? *file : std::cout;
+
+   request( 0 );
+   auto chunk = receive_chunk();
+   EOS_ASSERT( chunk.size > 0, fc::invalid_operation_exception, "peer ${p} serves no snapshot", ("p", peer) );
+   block_id = chunk.block_id;
+   const uint64_t size = chunk.size;
+   const fc::sha256 integrity_hash = chunk.integrity_hash;
+   const uint64_t chunk_size = chunk.data.size();
+   ilog( "downloading the snapshot of block ${n} ${id}, ${s} bytes, integrity hash ${h}",
+         ("n", block_header::num_from_id( block_id ))("id", block_id)("s", size)("h", integrity_hash) );
+
+   uint64_t next_request = chunk_size;
+   for( uint32_t i = 1; i < request_window && next_request < size; ++i, next_request += chunk_size ) request( next_request );
+
+   uint64_t received = 0;
+   std::vector<char> tail; // the last bytes received, ending with the integrity hash
+   while( true ) {
+      EOS_ASSERT( chunk.size == size && chunk.block_id == block_id && chunk.offset == received && !chunk.data.empty(),
+                  fc::invalid_operation_exception, "peer ${p} no longer serves the snapshot of block ${id}", ("p", peer)("id", block_id) );
+      out.write( chunk.data.data(), chunk.data.size() );
+      received += chunk.data.size();
+      tail.insert( tail.end(), chunk.data.begin(), chunk.data.end() );
+      if( tail.size() > sizeof(fc::sha256) ) tail.erase( tail.begin(), tail.end() - sizeof(fc::sha256) );
+      if( received == size ) break;
+
+      if( next_request < size ) {
+         request( next_request );
+         next_request += chunk_size;
+      }
+      chunk = receive_chunk();
+   }
+   out.flush();
+   EOS_ASSERT( out, fc::invalid_operation_exception, "unable to write the snapshot to ${o}", ("o", output) );
+   EOS_ASSERT( tail.size() == sizeof(fc::sha256) && fc::sha256( tail.data(), tail.size() ) == integrity_hash,
+               fc::invalid_operation_exception, "the snapshot received does not end with its integrity hash ${h}", ("h", integrity_hash) );
+   ilog( "downloaded the snapshot of block ${n}", ("n", block_header::num_from_id( block_id )) );
+}
+
+int main(int argc, char** argv) {
+   options_description cli ("eosio-bootstrap command line options");
+   try {
+      bootstrap boot;
+      boot.set_program_options(cli);
+      variables_map vmap;
+      bpo::store(bpo::parse_command_line(argc, argv, cli), vmap);
+      if (boot.help) {
+         cli.print(std::cerr);
+         return 0;
+      }
+      bpo::notify(vmap);
+      boot.run();
+   } catch( const fc::exception& e ) {
+      elog( "${e}", ("e", e.to_detail_string()));
+      return -1;
+   } catch( const boost::exception& e ) {
+      elog("${e}", ("e",boost::diagnostic_information(e)));
+      return -1;
+   } catch( const std::exception& e ) {
+      elog("${e}", ("e",e.what()));
+      return -1;
+   } catch( ... ) {
+      elog("unknown exception");
+      return -1;
+   }
+
+   return 0;
+}
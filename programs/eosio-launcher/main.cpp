@@ -3,6 +3,9 @@
 #include <math.h>
 #include <sstream>
 #include <regex>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/asio/ip/tcp.hpp>
@@ -47,6 +50,26 @@ using namespace eosio::launcher::config;
 
 const string block_dir = "blocks";
 const string shared_mem_dir = "state";
+const string snapshot_file = "snapshot.bin";
+
+/// call f(i) for every i from 0 to n - 1, on up to threads threads
+template<typename F>
+void parallel_for (size_t n, size_t threads, F&& f) {
+  std::atomic<size_t> next{0};
+  auto work = [&]() {
+    for (size_t i = next++; i < n; i = next++) {
+      f(i);
+    }
+  };
+  vector<std::thread> pool;
+  for (size_t t = 1; t < std::min(threads, n); ++t) {
+    pool.emplace_back(work);
+  }
+  work();
+  for (auto &t : pool) {
+    t.join();
+  }
+}
 
 struct local_identity {
   vector <fc::ip::address> addrs;
@@ -425,6 +448,9 @@ struct launcher_def {
    producer_set_def producer_set;
    string start_temp;
    string start_script;
+   size_t launch_threads = 1;
+   bfs::path snapshot;
+   std::mutex last_run_mtx; ///< nodes are launched concurrently
    fc::optional<uint32_t> max_block_cpu_usage;
    fc::optional<uint32_t> max_transaction_cpu_usage;
    eosio::chain::genesis_state genesis_from_file;
@@ -457,6 +483,7 @@ struct launcher_def {
    void make_ring ();
    void make_star ();
    void make_mesh ();
+   void make_relay ();
    void make_custom ();
    void write_dot_file ();
    void format_ssh (const string &cmd, const string &host_name, string &ssh_cmd_line);
@@ -485,7 +512,7 @@ launcher_def::set_options (bpo::options_description &cfg) {
     ("producers",bpo::value<size_t>(&producers)->default_value(21),"total number of non-bios and non-shared producer instances in this network")
     ("shared-producers",bpo::value<size_t>(&shared_producers)->default_value(0),"total number of shared producers on each non-bios nodes")
     ("mode,m",bpo::value<vector<string>>()->multitoken()->default_value({"any"}, "any"),"connection mode, combination of \"any\", \"producers\", \"specified\", \"none\"")
-    ("shape,s",bpo::value<string>(&shape)->default_value("star"),"network topology, use \"star\" \"mesh\" or give a filename for custom")
+    ("shape,s",bpo::value<string>(&shape)->default_value("star"),"network topology, use \"star\" \"mesh\" \"relay\" or give a filename for custom. \"relay\" meshes the producing nodes and peers every other node with one of them, for large networks")
     ("genesis,g",bpo::value<string>()->default_value("./genesis.json"),"set the path to genesis.json")
     ("skip-signature", bpo::bool_switch(&skip_transaction_signatures)->default_value(false), (string(node_executable_name) + " does not require transaction signatures.").c_str())
     (node_executable_name, bpo::value<string>(&eosd_extra_args), ("forward " + string(node_executable_name) + " command line argument(s) to each instance of " + string(node_executable_name) + ", enclose arg(s) in quotes").c_str())
@@ -504,6 +531,8 @@ launcher_def::set_options (bpo::options_description &cfg) {
     ("gelf-endpoint",bpo::value<string>(&gelf_endpoint)->default_value("10.160.11.21:12201"),"hostname:port or ip:port of GELF endpoint")
     ("template",bpo::value<string>(&start_temp)->default_value("testnet.template"),"the startup script template")
     ("script",bpo::value<string>(&start_script)->default_value("bios_boot.sh"),"the generated startup script name")
+    ("launch-threads",bpo::value<size_t>(&launch_threads)->default_value(1),"number of threads writing the configuration files of the nodes, then deploying and starting them, the nodes of a host one after the other")
+    ("snapshot",bpo::value<bfs::path>(&snapshot),("copy this snapshot to each node and start " + string(node_executable_name) + " from it instead of from genesis").c_str())
     ("max-block-cpu-usage",bpo::value<uint32_t>(),"Provide the \"max-block-cpu-usage\" value to use in the genesis.json file")
     ("max-transaction-cpu-usage",bpo::value<uint32_t>(),"Provide the \"max-transaction-cpu-usage\" value to use in the genesis.json file")
         ;
@@ -575,6 +604,14 @@ launcher_def::initialize (const variables_map &vmap) {
      server_ident_file = vmap["servers"].as<string>();
   }
 
+  if (!snapshot.empty() && !bfs::is_regular_file(snapshot)) {
+    cerr << "snapshot " << snapshot << " does not exist" << endl;
+    exit (-1);
+  }
+  if (launch_threads == 0) {
+    launch_threads = 1;
+  }
+
   retrieve_paired_array_parameters(vmap, "specific-num", "specific-" + string(node_executable_name), specific_nodeos_args);
   retrieve_paired_array_parameters(vmap, "spcfc-inst-num", "spcfc-inst-" + string(node_executable_name), specific_nodeos_installation_paths);
 
@@ -588,7 +625,8 @@ launcher_def::initialize (const variables_map &vmap) {
   if ( ! (shape.empty() ||
           boost::iequals( shape, "ring" ) ||
           boost::iequals( shape, "star" ) ||
-          boost::iequals( shape, "mesh" )) &&
+          boost::iequals( shape, "mesh" ) ||
+          boost::iequals( shape, "relay" )) &&
        host_map_file.empty()) {
     bfs::path src = shape;
     host_map_file = src.stem().string() + "_hosts.json";
@@ -726,6 +764,9 @@ launcher_def::generate () {
   else if (boost::iequals (shape, "mesh")) {
     make_mesh ();
   }
+  else if (boost::iequals (shape, "relay")) {
+    make_relay ();
+  }
   else {
     make_custom ();
   }
@@ -734,11 +775,15 @@ launcher_def::generate () {
      write_setprods_file();
      write_bios_boot();
      init_genesis();
+     vector<tn_node_def*> nodes;
      for (auto &node : network.nodes) {
-        write_config_file(node.second);
-        write_logging_config_file(node.second);
-        write_genesis_file(node.second);
+        nodes.push_back(&node.second);
      }
+     parallel_for(nodes.size(), launch_threads, [&](size_t i) {
+        write_config_file(*nodes[i]);
+        write_logging_config_file(*nodes[i]);
+        write_genesis_file(*nodes[i]);
+     });
   }
   write_dot_file ();
 
@@ -1011,6 +1056,9 @@ launcher_def::deploy_config_files (tn_node_def &node) {
     bfs::copy_file (genesis_source, cfgdir / "genesis.json", bfs::copy_option::overwrite_if_exists);
     bfs::copy_file (logging_source, cfgdir / "logging.json", bfs::copy_option::overwrite_if_exists);
     bfs::copy_file (source, cfgdir / "config.ini", bfs::copy_option::overwrite_if_exists);
+    if (!snapshot.empty()) {
+      bfs::copy_file (snapshot, dd / snapshot_file, bfs::copy_option::overwrite_if_exists);
+    }
   }
   else {
     prep_remote_config_dir (instance, host);
@@ -1044,6 +1092,18 @@ launcher_def::deploy_config_files (tn_node_def &node) {
        cerr << "unable to scp genesis.json file to host " << host->host_name << endl;
        exit(-1);
     }
+
+    if (!snapshot.empty()) {
+      rfile = bfs::path (host->eosio_home) / instance.data_dir_name / snapshot_file;
+
+      scp_cmd_line = compose_scp_command(*host, snapshot, rfile);
+
+      res = boost::process::system (scp_cmd_line);
+      if (res != 0) {
+        cerr << "unable to scp snapshot to host " << host->host_name << endl;
+        exit(-1);
+      }
+    }
   }
   return host;
 }
@@ -1122,7 +1182,7 @@ launcher_def::write_config_file (tn_node_def &node) {
   }
 
   if(!is_bios) {
-     auto &bios_node = network.nodes["bios"];
+     auto &bios_node = network.nodes.find("bios")->second;
      cfg << "p2p-peer-address = " << bios_node.instance->p2p_endpoint<< "\n";
   }
   for (const auto &p : node.peers) {
@@ -1425,6 +1485,34 @@ launcher_def::make_mesh () {
   }
 }
 
+void
+launcher_def::make_relay () {
+  bind_nodes();
+  // the producing nodes are one hop from each other, the connections of every node are bounded by the number of
+  // producing nodes however large the network
+  vector<tn_node_def*> producing;
+  vector<tn_node_def*> relays;
+  for (const auto &alias : aliases) {
+    if (alias == "bios") {
+      continue;
+    }
+    auto &node = network.nodes.find(alias)->second;
+    (node.producers.empty() ? relays : producing).push_back(&node);
+  }
+  if (producing.empty()) {
+    cerr << "the relay shape requires producing nodes" << endl;
+    exit (-1);
+  }
+  for (size_t i = 0; i < producing.size(); ++i) {
+    for (size_t j = i + 1; j < producing.size(); ++j) {
+      producing[i]->peers.push_back(producing[j]->name);
+    }
+  }
+  for (size_t i = 0; i < relays.size(); ++i) {
+    relays[i]->peers.push_back(producing[i % producing.size()]->name);
+  }
+}
+
 void
 launcher_def::make_custom () {
   bfs::path source = shape;
@@ -1572,9 +1660,15 @@ launcher_def::launch (eosd_def &instance, string &gts) {
   }
 
   eosdcmd += " --config-dir " + instance.config_dir_name + " --data-dir " + instance.data_dir_name;
-  eosdcmd += " --genesis-json " + instance.config_dir_name + "/genesis.json";
-  if (gts.length()) {
-    eosdcmd += " --genesis-timestamp " + gts;
+  if (!snapshot.empty()) {
+    // the snapshot holds the chain id and state, there is no genesis to start from
+    eosdcmd += " --snapshot " + (dd / snapshot_file).string();
+  }
+  else {
+    eosdcmd += " --genesis-json " + instance.config_dir_name + "/genesis.json";
+    if (gts.length()) {
+      eosdcmd += " --genesis-timestamp " + gts;
+    }
   }
 
   if (!host->is_local()) {
@@ -1628,6 +1722,7 @@ launcher_def::launch (eosd_def &instance, string &gts) {
     sf << eosdcmd << endl;
     sf.close();
   }
+  std::lock_guard<std::mutex> g(last_run_mtx);
   last_run.running_nodes.emplace_back (move(info));
 }
 
@@ -1866,10 +1961,16 @@ launcher_def::start_all (string &gts, launch_modes mode) {
   case LM_REMOTE:
   case LM_LOCAL: {
 
+    vector<host_def*> hosts;
     for (auto &h : bindings ) {
       if (mode == LM_ALL ||
           (h.is_local() ? mode == LM_LOCAL : mode == LM_REMOTE)) {
-        for (auto &inst : h.instances) {
+        hosts.push_back(&h);
+      }
+    }
+    // the hosts are deployed concurrently, each host's nodes in order
+    parallel_for(hosts.size(), launch_threads, [&](size_t i) {
+        for (auto &inst : hosts[i]->instances) {
           try {
              cerr << "launching " << inst.name << endl;
              launch (inst, gts);
@@ -1882,8 +1983,7 @@ launcher_def::start_all (string &gts, launch_modes mode) {
           }
           sleep (start_delay);
         }
-      }
-    }
+    });
     break;
   }
   }
@@ -0,0 +1,572 @@
+#include <eosio/chain/abi_compiled_decoder.hpp>
+#include <eosio/chain/account_object.hpp>
+#include <eosio/chain/snapshot.hpp>
+#include <eosio/state_history_plugin/state_history_compression.hpp>
+
+#include <fc/crypto/hex.hpp>
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/exception/diagnostic_information.hpp>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using namespace eosio;
+using namespace eosio::chain;
+namespace bfs = boost::filesystem;
+namespace bpo = boost::program_options;
+using bpo::options_description;
+using bpo::variables_map;
+
+/**
+ * The files written, one per contract table, named <code>-<table>.cols, hold the rows of all the scopes of the table:
+ * file_magic followed by row groups, each a packed row_group. The values of a column are strings packed one after the
+ * other with fc::raw and compressed with zlib, so a reader only decompresses the columns it wants. The columns are
+ * scope, primary_key and payer, then value.<field> for each field of the row type in the ABI of the contract holding the
+ * JSON of the field, or value holding the JSON of a row type that is not a struct, and undecoded holding the hex of the
+ * rows that could not be decoded, empty for the others.
+ */
+struct column_chunk {
+   std::string name;
+   bytes       values; ///< compressed
+};
+
+struct row_group {
+   uint32_t                  rows = 0;
+   std::vector<column_chunk> columns;
+};
+FC_REFLECT(column_chunk, (name)(values))
+FC_REFLECT(row_group, (rows)(columns))
+
+static const char file_magic[8] = {'E', 'O', 'S', 'C', 'O', 'L', 'S', '1'};
+
+/// rows of one table, at most row-group-size bytes of it, as packed in the snapshot
+struct table_rows {
+   name        code;
+   name        scope;
+   name        table;
+   uint32_t    num_rows = 0;
+   bytes       rows; ///< packed key_value_object rows
+};
+
+/// the ABI of a contract compiled for decoding its rows, shared by the threads
+struct contract_abi {
+   std::unique_ptr<abi_compiled_decoder>                    decoder; ///< none if the ABI does not unpack
+   std::map<name, abi_compiled_decoder::type_id>            table_types;
+};
+
+/// rows of one table being gathered by a thread into the columns of its next row group
+struct column_buffer {
+   std::vector<std::string>       names;
+   std::map<std::string, size_t>  index; ///< of names
+   std::vector<bytes>             values;
+   std::vector<uint32_t>          counts; ///< values in each column
+   uint32_t                       rows = 0;
+   size_t                         size = 0;
+
+   void add( const std::string& column, const std::string_view& value ) {
+      auto itr = index.find( column );
+      if (itr == index.end()) {
+         itr = index.emplace( column, names.size() ).first;
+         names.push_back( column );
+         values.emplace_back( rows, 0 ); // the empty string of each row before
+         counts.push_back( rows );
+         size += rows;
+      }
+      auto& v = values[itr->second];
+      const auto before = v.size();
+      fc::unsigned_int len( value.size() );
+      v.resize( before + fc::raw::pack_size( len ) + value.size() );
+      fc::datastream<char*> ds( v.data() + before, v.size() - before );
+      fc::raw::pack( ds, len );
+      ds.write( value.data(), value.size() );
+      ++counts[itr->second];
+      size += v.size() - before;
+   }
+
+   void end_row() {
+      ++rows;
+      for (size_t c = 0; c < values.size(); ++c) {
+         for (; counts[c] < rows; ++counts[c]) {
+            values[c].push_back( 0 );
+            ++size;
+         }
+      }
+   }
+};
+
+/// packed rows of a snapshot section read in chunks, a section being too large to be read at once
+class section_stream {
+public:
+   section_stream( std::istream& in, std::streampos pos, uint64_t size )
+   : _in( in ), _remaining( size ), _buffer( 1024*1024 ) {
+      _in.seekg( pos );
+   }
+
+   bool empty() const { return _pos == _end && _remaining == 0; }
+
+   void read( char* out, size_t n ) {
+      while (n > 0) {
+         if (_pos == _end)
+            fill();
+         const auto c = std::min( n, _end - _pos );
+         memcpy( out, _buffer.data() + _pos, c );
+         _pos += c;
+         out += c;
+         n -= c;
+      }
+   }
+
+   void skip( uint64_t n ) {
+      const auto c = std::min<uint64_t>( n, _end - _pos );
+      _pos += c;
+      n -= c;
+      if (n > 0) {
+         EOS_ASSERT( n <= _remaining, snapshot_exception, "contract_tables section ends within a row" );
+         _in.seekg( n, std::ios::cur );
+         _remaining -= n;
+      }
+   }
+
+   template<typename T>
+   T read_pod() {
+      T v;
+      read( reinterpret_cast<char*>( &v ), sizeof( v ) );
+      return v;
+   }
+
+   /// as packed by fc::unsigned_int
+   uint32_t read_varint() {
+      uint64_t v = 0;
+      uint8_t  b = 0, by = 0;
+      do {
+         b = read_pod<uint8_t>();
+         v |= uint64_t( b & 0x7f ) << by;
+         by += 7;
+      } while ((b & 0x80) && by < 32);
+      return static_cast<uint32_t>( v );
+   }
+
+private:
+   void fill() {
+      EOS_ASSERT( _remaining > 0, snapshot_exception, "contract_tables section ends within a row" );
+      const auto n = std::min<uint64_t>( _remaining, _buffer.size() );
+      _in.read( _buffer.data(), n );
+      EOS_ASSERT( _in, snapshot_exception, "unable to read the snapshot" );
+      _remaining -= n;
+      _pos = 0;
+      _end = n;
+   }
+
+   std::istream&     _in;
+   uint64_t          _remaining; ///< not read into the buffer yet
+   std::vector<char> _buffer;
+   size_t            _pos = 0;
+   size_t            _end = 0;
+};
+
+struct snapshot_export {
+   void set_program_options(options_description& cli);
+   void initialize(const variables_map& options);
+   void run();
+
+   bfs::path                    snapshot_file;
+   bfs::path                    output_dir;
+   std::set<name>               codes; ///< all if empty
+   uint32_t                     threads = 1;
+   uint32_t                     row_group_size = 0;
+   int                          compression_level = 6;
+
+   /// ABIs of the accounts from the account_object section
+   std::map<name, bytes>        abis;
+
+   std::mutex                                            abi_mtx;
+   std::map<name, std::shared_ptr<const contract_abi>>   compiled_abis;
+
+   std::mutex                                            files_mtx;
+   std::map<std::string, std::unique_ptr<std::mutex>>    file_mtxs; ///< by file name, the row groups appended in turn
+
+   std::atomic<uint64_t>        rows_written{0};
+
+   void read_abis(istream_snapshot_reader& reader, std::istream& in);
+   std::shared_ptr<const contract_abi> get_abi(name code);
+   void export_rows(const table_rows& t, std::map<std::pair<name, name>, column_buffer>& buffers, size_t& buffered);
+   void write_row_groups(std::map<std::pair<name, name>, column_buffer>& buffers);
+};
+
+struct report_time {
+    report_time(std::string desc)
+    : _start(std::chrono::high_resolution_clock::now())
+    , _desc(desc) {
+    }
+
+    void report() {
+        const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - _start).count() / 1000;
+        ilog("eosio-snapshot-export - ${desc} took ${t} msec", ("desc", _desc)("t", duration));
+    }
+
+    const std::chrono::high_resolution_clock::time_point _start;
+    const std::string                                    _desc;
+};
+
+void snapshot_export::set_program_options(options_description& cli)
+{
+   cli.add_options()
+         ("snapshot,s", bpo::value<bfs::path>()->required(),
+          "the binary snapshot to export the contract tables of, version 2 or later (absolute path or relative to the current directory)")
+         ("output-dir,o", bpo::value<bfs::path>()->required(),
+          "the directory to write the <code>-<table>.cols files to, which must not have any yet (absolute path or relative to the current directory)")
+         ("code", bpo::value<vector<string>>()->composing(),
+          "a contract whose tables to export, may be given more than once, all contracts if not given")
+         ("threads", bpo::value<uint32_t>(&threads)->default_value(std::max(1u, std::thread::hardware_concurrency())),
+          "number of threads decoding and compressing the rows of the tables, while one reads the snapshot")
+         ("row-group-size", bpo::value<uint32_t>(&row_group_size)->default_value(64),
+          "MiB of rows each thread gathers before writing them as row groups, which with the threads bounds the memory used")
+         ("compression-level", bpo::value<int>(&compression_level)->default_value(6),
+          "zlib compression level of the columns, 0 to 9")
+         ("help,h", "Print this help message and exit.")
+         ;
+}
+
+void snapshot_export::initialize(const variables_map& options) {
+   try {
+      auto file = options.at( "snapshot" ).as<bfs::path>();
+      snapshot_file = file.is_relative() ? bfs::current_path() / file : file;
+      file = options.at( "output-dir" ).as<bfs::path>();
+      output_dir = file.is_relative() ? bfs::current_path() / file : file;
+      if (options.count( "code" )) {
+         for (const auto& c : options.at( "code" ).as<vector<string>>())
+            codes.insert( name( c ) );
+      }
+      threads = std::max( threads, 1u );
+      EOS_ASSERT( row_group_size > 0, plugin_config_exception, "row-group-size must be at least 1" );
+      EOS_ASSERT( compression_level >= 0 && compression_level <= 9, plugin_config_exception,
+                  "compression-level must be 0 through 9" );
+
+      if (!bfs::exists( output_dir ))
+         bfs::create_directories( output_dir );
+      for (bfs::directory_iterator enditr, itr{output_dir}; itr != enditr; ++itr) {
+         EOS_ASSERT( itr->path().extension() != ".cols", plugin_config_exception,
+                     "${d} already has exported tables", ("d", output_dir.generic_string()) );
+      }
+   } FC_LOG_AND_RETHROW()
+}
+
+void snapshot_export::read_abis(istream_snapshot_reader& reader, std::istream& in) {
+   // account_object rows as packed in the snapshot, name, creation_date and abi
+   const auto loc = reader.locate_section( detail::snapshot_section_traits<account_object>::section_name() );
+   EOS_ASSERT( loc, snapshot_exception, "snapshot has no account_object section" );
+   section_stream rows( in, loc->pos, loc->size );
+   for (uint64_t r = 0; r < loc->rows; ++r) {
+      const name account( rows.read_pod<uint64_t>() );
+      rows.read_pod<uint32_t>();
+      const uint32_t size = rows.read_varint();
+      if (size == 0 || (!codes.empty() && !codes.count( account ))) {
+         rows.skip( size );
+         continue;
+      }
+      auto& abi = abis[account];
+      abi.resize( size );
+      rows.read( abi.data(), size );
+   }
+}
+
+std::shared_ptr<const contract_abi> snapshot_export::get_abi(name code) {
+   std::lock_guard<std::mutex> g( abi_mtx );
+   auto& result = compiled_abis[code];
+   if (result)
+      return result;
+
+   auto compiled = std::make_shared<contract_abi>();
+   auto itr = abis.find( code );
+   if (itr != abis.end()) {
+      try {
+         abi_def abi;
+         fc::datastream<const char*> ds( itr->second.data(), itr->second.size() );
+         fc::raw::unpack( ds, abi );
+         abi_serializer serializer( abi, abi_serializer::create_yield_function( fc::microseconds::maximum() ) );
+         compiled->decoder = std::make_unique<abi_compiled_decoder>( serializer );
+         for (const auto& t : abi.tables) {
+            const auto type = compiled->decoder->find_type( serializer.get_table_type( t.name ) );
+            if (type != abi_compiled_decoder::invalid_type)
+               compiled->table_types[t.name] = type;
+         }
+      } catch (const fc::exception& e) {
+         wlog( "Ignoring the ABI of ${c}, its rows are exported undecoded: ${e}", ("c", code)("e", e.to_string()) );
+         compiled->decoder.reset();
+      }
+      abis.erase( itr ); // no longer needed
+   }
+   result = std::move( compiled );
+   return result;
+}
+
+void snapshot_export::export_rows(const table_rows& t, std::map<std::pair<name, name>, column_buffer>& buffers, size_t& buffered) {
+   const auto abi = get_abi( t.code );
+   auto type = abi_compiled_decoder::invalid_type;
+   if (abi->decoder) {
+      auto itr = abi->table_types.find( t.table );
+      if (itr != abi->table_types.end())
+         type = itr->second;
+   }
+   const auto yield = abi_serializer::create_yield_function( fc::microseconds::maximum() );
+   const std::string scope = t.scope.to_string();
+
+   auto& buffer = buffers[std::make_pair( t.code, t.table )];
+   const auto before = buffer.size;
+   std::string json;
+   std::vector<std::pair<std::string_view, std::string_view>> fields;
+   fc::datastream<const char*> ds( t.rows.data(), t.rows.size() );
+   for (uint32_t r = 0; r < t.num_rows; ++r) {
+      uint64_t primary_key = 0, payer = 0;
+      bytes value;
+      fc::raw::unpack( ds, primary_key );
+      fc::raw::unpack( ds, payer );
+      fc::raw::unpack( ds, value );
+
+      buffer.add( "scope", scope );
+      buffer.add( "primary_key", std::to_string( primary_key ) );
+      buffer.add( "payer", name( payer ).to_string() );
+      bool decoded = false;
+      if (type != abi_compiled_decoder::invalid_type) {
+         json.clear();
+         try {
+            fc::datastream<const char*> vds( value.data(), value.size() );
+            abi->decoder->to_json( type, vds, json, yield );
+            decoded = vds.remaining() == 0;
+         } catch (const fc::exception&) {
+         }
+         fields.clear();
+         if (decoded && abi_compiled_decoder::split_json_object( json, fields )) {
+            for (const auto& f : fields)
+               buffer.add( "value." + std::string( f.first ), f.second );
+         } else if (decoded) {
+            // split_json_object only takes plain JSON, strings with escapes are taken apart by fc::json
+            const auto obj = fc::json::from_string( json );
+            if (obj.is_object()) {
+               for (const auto& f : obj.get_object())
+                  buffer.add( "value." + f.key(), fc::json::to_string( f.value(), fc::time_point::maximum() ) );
+            } else {
+               buffer.add( "value", json );
+            }
+         }
+      }
+      buffer.add( "undecoded", decoded ? std::string() : fc::to_hex( value.data(), value.size() ) );
+      buffer.end_row();
+   }
+   buffered += buffer.size - before;
+}
+
+void snapshot_export::write_row_groups(std::map<std::pair<name, name>, column_buffer>& buffers) {
+   for (auto& b : buffers) {
+      auto& buffer = b.second;
+      if (buffer.rows == 0)
+         continue;
+      row_group group;
+      group.rows = buffer.rows;
+      for (size_t c = 0; c < buffer.names.size(); ++c) {
+         group.columns.push_back( column_chunk{ buffer.names[c], zlib_compress_bytes( buffer.values[c], compression_level, nullptr ) } );
+         buffer.values[c] = bytes();
+      }
+      const auto packed = fc::raw::pack( group );
+      rows_written += buffer.rows;
+      buffer = column_buffer();
+
+      const auto file_name = b.first.first.to_string() + "-" + b.first.second.to_string() + ".cols";
+      std::mutex* file_mtx = nullptr;
+      {
+         std::lock_guard<std::mutex> g( files_mtx );
+         auto& m = file_mtxs[file_name];
+         if (!m)
+            m = std::make_unique<std::mutex>();
+         file_mtx = m.get();
+      }
+      std::lock_guard<std::mutex> g( *file_mtx );
+      const auto file = output_dir / file_name;
+      const bool created = !bfs::exists( file );
+      std::ofstream out( file.generic_string(), std::ios::binary | std::ios::app );
+      if (created)
+         out.write( file_magic, sizeof( file_magic ) );
+      out.write( packed.data(), packed.size() );
+      EOS_ASSERT( out, plugin_exception, "unable to write ${f}", ("f", file.generic_string()) );
+   }
+   buffers.clear();
+}
+
+void snapshot_export::run() {
+   report_time rt("exporting contract tables");
+   std::ifstream in( snapshot_file.generic_string(), std::ios::binary );
+   EOS_ASSERT( in, plugin_exception, "Unable to open file '${f}'", ("f", snapshot_file.generic_string()) );
+   istream_snapshot_reader reader( in );
+   reader.validate();
+   read_abis( reader, in );
+   ilog( "${n} ABIs", ("n", abis.size()) );
+
+   const auto loc = reader.locate_section( "contract_tables" );
+   EOS_ASSERT( loc, snapshot_exception, "snapshot has no contract_tables section" );
+
+   // one thread reads the section and queues the rows of the tables, the others decode them; the queue holds as many
+   // bytes as the threads gather before writing, which with theirs bounds the memory used
+   const size_t group_bytes = size_t( row_group_size ) * 1024 * 1024;
+   const size_t max_queued = group_bytes * threads;
+   std::mutex queue_mtx;
+   std::condition_variable queue_cv;
+   std::deque<table_rows> queue;
+   size_t queued = 0;
+   bool reading = true;
+   std::atomic<bool> failed{false};
+   std::exception_ptr error;
+   std::mutex error_mtx;
+   auto fail = [&]() {
+      std::lock_guard<std::mutex> g( error_mtx );
+      if (!error)
+         error = std::current_exception();
+      failed = true;
+      queue_cv.notify_all();
+   };
+
+   std::vector<std::thread> workers;
+   for (uint32_t t = 0; t < threads; ++t) {
+      workers.emplace_back( [&]() {
+         try {
+            std::map<std::pair<name, name>, column_buffer> buffers;
+            size_t buffered = 0;
+            while (true) {
+               table_rows rows;
+               {
+                  std::unique_lock<std::mutex> g( queue_mtx );
+                  queue_cv.wait( g, [&]() { return !queue.empty() || !reading || failed; } );
+                  if (failed || queue.empty())
+                     break;
+                  rows = std::move( queue.front() );
+                  queue.pop_front();
+                  queued -= rows.rows.size();
+               }
+               queue_cv.notify_all();
+               export_rows( rows, buffers, buffered );
+               if (buffered >= group_bytes) {
+                  write_row_groups( buffers );
+                  buffered = 0;
+               }
+            }
+            if (!failed)
+               write_row_groups( buffers );
+         } catch (...) {
+            fail();
+         }
+      } );
+   }
+
+   uint64_t tables = 0;
+   try {
+      auto push = [&]( table_rows& rows ) {
+         std::unique_lock<std::mutex> g( queue_mtx );
+         queue_cv.wait( g, [&]() { return queued < max_queued || failed; } );
+         queued += rows.rows.size();
+         queue.push_back( std::move( rows ) );
+         g.unlock();
+         queue_cv.notify_all();
+      };
+
+      // as written by controller, each table_id_object row followed by the count and the rows of the table in the
+      // key_value index and in each of the five secondary indices, of fixed size as their keys
+      constexpr uint64_t secondary_row_sizes[] = { 8+8+8, 8+8+16, 8+8+32, 8+8+8, 8+8+16 };
+      section_stream section( in, loc->pos, loc->size );
+      while (!section.empty() && !failed) {
+         table_rows rows;
+         rows.code  = name( section.read_pod<uint64_t>() );
+         rows.scope = name( section.read_pod<uint64_t>() );
+         rows.table = name( section.read_pod<uint64_t>() );
+         section.read_pod<uint64_t>(); // payer
+         section.read_pod<uint32_t>(); // count
+         const bool wanted = codes.empty() || codes.count( rows.code );
+         ++tables;
+
+         const uint32_t num_rows = section.read_varint();
+         for (uint32_t r = 0; r < num_rows; ++r) {
+            char key[16]; // primary_key and payer
+            section.read( key, sizeof( key ) );
+            const uint32_t size = section.read_varint();
+            if (!wanted) {
+               section.skip( size );
+               continue;
+            }
+            fc::unsigned_int len( size );
+            const auto before = rows.rows.size();
+            rows.rows.resize( before + sizeof( key ) + fc::raw::pack_size( len ) + size );
+            fc::datastream<char*> ds( rows.rows.data() + before, rows.rows.size() - before );
+            ds.write( key, sizeof( key ) );
+            fc::raw::pack( ds, len );
+            section.read( rows.rows.data() + before + ds.tellp(), size );
+            ++rows.num_rows;
+            if (rows.rows.size() >= group_bytes) {
+               table_rows rest{ rows.code, rows.scope, rows.table };
+               push( rows );
+               rows = std::move( rest );
+            }
+         }
+         if (rows.num_rows)
+            push( rows );
+
+         for (auto row_size : secondary_row_sizes)
+            section.skip( section.read_varint() * row_size );
+      }
+   } catch (...) {
+      fail();
+   }
+   {
+      std::lock_guard<std::mutex> g( queue_mtx );
+      reading = false;
+   }
+   queue_cv.notify_all();
+   for (auto& w : workers)
+      w.join();
+   if (error)
+      std::rethrow_exception( error );
+
+   ilog( "${r} rows of ${t} tables written to ${n} files in ${d}",
+         ("r", rows_written.load())("t", tables)("n", file_mtxs.size())("d", output_dir.generic_string()) );
+   rt.report();
+}
+
+int main(int argc, char** argv) {
+   std::ios::sync_with_stdio(false);
+   options_description cli ("eosio-snapshot-export command line options");
+   try {
+      snapshot_export se;
+      se.set_program_options(cli);
+      variables_map vmap;
+      bpo::store(bpo::parse_command_line(argc, argv, cli), vmap);
+      if (vmap.count("help")) {
+         cli.print(std::cerr);
+         return 0;
+      }
+      bpo::notify(vmap);
+      se.initialize(vmap);
+      se.run();
+   } catch( const fc::exception& e ) {
+      elog( "${e}", ("e", e.to_detail_string()));
+      return -1;
+   } catch( const boost::exception& e ) {
+      elog("${e}", ("e",boost::diagnostic_information(e)));
+      return -1;
+   } catch( const std::exception& e ) {
+      elog("${e}", ("e",e.what()));
+      return -1;
+   } catch( ... ) {
+      elog("unknown exception");
+      return -1;
+   }
+
+   return 0;
+}
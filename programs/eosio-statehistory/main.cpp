@@ -0,0 +1,410 @@
+#include <eosio/state_history_plugin/state_history_compression.hpp>
+#include <eosio/state_history_plugin/state_history_log.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/exception/diagnostic_information.hpp>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace eosio;
+using namespace eosio::chain;
+namespace bfs = boost::filesystem;
+namespace bpo = boost::program_options;
+using bpo::options_description;
+using bpo::variables_map;
+
+/// rows of the reconstructed tables, keyed by the fields that identify a row
+using table_rows = std::map<bytes, bytes>;
+
+/// state of the tables selected by filter after block_num, written every checkpoint-interval blocks
+struct state_checkpoint {
+   uint32_t      block_num = 0;
+   block_id_type block_id;
+   std::string   filter;
+   table_rows    rows;
+};
+FC_REFLECT(state_checkpoint, (block_num)(block_id)(filter)(rows))
+
+struct row_change {
+   bool  present = false;
+   bytes key;
+   bytes row;
+};
+
+struct statehistory {
+   void set_program_options(options_description& cli);
+   void initialize(const variables_map& options);
+   void run();
+
+   bfs::path                    state_history_dir;
+   bfs::path                    retained_dir;
+   bfs::path                    checkpoint_dir;
+   bfs::path                    output_file;
+   uint32_t                     block_num = 0;
+   name                         code;
+   fc::optional<name>           table;
+   fc::optional<name>           scope;
+   bool                         kv = false;
+   uint32_t                     checkpoint_interval = 0;
+   uint32_t                     threads = 1;
+   bool                         no_pretty_print = false;
+
+   std::shared_ptr<const bytes> dictionary;
+
+   std::string filter() const {
+      return std::string(kv ? "contract_kv " : "contract_row ") + code.to_string() + " " +
+             (table ? table->to_string() : "*") + " " + (scope ? scope->to_string() : "*");
+   }
+
+   /// the changes to the selected rows in the deltas of block
+   std::vector<row_change> read_changes(const state_history_log& log, uint32_t block) const;
+   fc::optional<state_checkpoint> load_checkpoint(const state_history_log& log) const;
+   void write_checkpoint(const state_checkpoint& checkpoint) const;
+   fc::variant row_to_variant(const bytes& row) const;
+};
+
+struct report_time {
+    report_time(std::string desc)
+    : _start(std::chrono::high_resolution_clock::now())
+    , _desc(desc) {
+    }
+
+    void report() {
+        const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - _start).count() / 1000;
+        ilog("eosio-statehistory - ${desc} took ${t} msec", ("desc", _desc)("t", duration));
+    }
+
+    const std::chrono::high_resolution_clock::time_point _start;
+    const std::string                                    _desc;
+};
+
+void statehistory::set_program_options(options_description& cli)
+{
+   cli.add_options()
+         ("state-history-dir", bpo::value<bfs::path>()->default_value("state-history"),
+          "the location of the state-history directory (absolute path or relative to the current directory)")
+         ("state-history-retained-dir", bpo::value<bfs::path>()->default_value("retained"),
+          "the location of the split state history log segments (absolute path or relative to state-history-dir)")
+         ("block,b", bpo::value<uint32_t>(&block_num)->required(),
+          "the block number after which to reconstruct the tables")
+         ("code", bpo::value<string>()->required(), "the contract whose tables to reconstruct")
+         ("table", bpo::value<string>(), "the table to reconstruct, all tables of code if not given")
+         ("scope", bpo::value<string>(), "the scope to reconstruct, all scopes if not given")
+         ("kv", bpo::bool_switch(&kv)->default_value(false),
+          "reconstruct the key value rows of code instead of its multi index tables, table and scope do not apply")
+         ("checkpoint-dir", bpo::value<bfs::path>(),
+          "the location of state checkpoints (absolute path or relative to the current directory). The latest "
+          "checkpoint of the same tables before block is used as the starting point instead of the first block of the log")
+         ("checkpoint-interval", bpo::value<uint32_t>(&checkpoint_interval)->default_value(0),
+          "write a checkpoint to checkpoint-dir every this many blocks, at block numbers that are multiples of it, 0 for none")
+         ("threads", bpo::value<uint32_t>(&threads)->default_value(std::max(1u, std::thread::hardware_concurrency())),
+          "number of threads reading and decompressing the deltas of the blocks ahead of the one being applied")
+         ("output-file,o", bpo::value<bfs::path>(),
+          "the file to write the rows to (absolute or relative path).  If not specified then output is to stdout.")
+         ("no-pretty-print", bpo::bool_switch(&no_pretty_print)->default_value(false),
+          "Do not pretty print the output.  Useful if piping to jq to improve performance.")
+         ("help,h", "Print this help message and exit.")
+         ;
+}
+
+void statehistory::initialize(const variables_map& options) {
+   try {
+      auto dir = options.at( "state-history-dir" ).as<bfs::path>();
+      state_history_dir = dir.is_relative() ? bfs::current_path() / dir : dir;
+      dir = options.at( "state-history-retained-dir" ).as<bfs::path>();
+      retained_dir = dir.is_relative() ? state_history_dir / dir : dir;
+      if (options.count( "checkpoint-dir" )) {
+         dir = options.at( "checkpoint-dir" ).as<bfs::path>();
+         checkpoint_dir = dir.is_relative() ? bfs::current_path() / dir : dir;
+      }
+      EOS_ASSERT( !checkpoint_interval || !checkpoint_dir.empty(), plugin_config_exception,
+                  "checkpoint-interval needs checkpoint-dir" );
+      if (options.count( "output-file" )) {
+         dir = options.at( "output-file" ).as<bfs::path>();
+         output_file = dir.is_relative() ? bfs::current_path() / dir : dir;
+      }
+      code = name( options.at( "code" ).as<string>() );
+      if (options.count( "table" ))
+         table = name( options.at( "table" ).as<string>() );
+      if (options.count( "scope" ))
+         scope = name( options.at( "scope" ).as<string>() );
+      threads = std::max( threads, 1u );
+
+      const auto dict_file = state_history_dir / "chain_state_history.dict";
+      if (bfs::exists( dict_file )) {
+         auto dict = std::make_shared<bytes>( bfs::file_size( dict_file ) );
+         std::ifstream in( dict_file.generic_string(), std::ios::binary );
+         in.read( dict->data(), dict->size() );
+         EOS_ASSERT( in, plugin_exception, "unable to read ${f}", ("f", dict_file.generic_string()) );
+         dictionary = std::move( dict );
+      }
+   } FC_LOG_AND_RETHROW()
+}
+
+std::vector<row_change> statehistory::read_changes(const state_history_log& log, uint32_t block) const {
+   state_history_log_header header;
+   bytes payload;
+   log.read_entry( block, header, payload );
+   const bool with_dictionary = get_ship_version( header.magic ) >= 1;
+   EOS_ASSERT( !with_dictionary || dictionary, plugin_exception,
+               "block ${b} needs chain_state_history.dict, which is missing", ("b", block) );
+   const auto deltas = unpack_entry_payload( payload, block, with_dictionary ? dictionary.get() : nullptr );
+
+   // as packed by state_history_plugin, std::vector<table_delta> with the rows of contract_row and contract_kv starting
+   // with a version followed by code, scope, table and primary key, or by contract and key
+   const char* const wanted = kv ? "contract_kv" : "contract_row";
+   std::vector<row_change> result;
+   fc::datastream<const char*> ds( deltas.data(), deltas.size() );
+   fc::unsigned_int num_tables;
+   fc::raw::unpack( ds, num_tables );
+   for (uint32_t t = 0; t < num_tables.value; ++t) {
+      fc::unsigned_int struct_version, num_rows;
+      std::string table_name;
+      fc::raw::unpack( ds, struct_version );
+      fc::raw::unpack( ds, table_name );
+      fc::raw::unpack( ds, num_rows );
+      const bool is_wanted = table_name == wanted;
+      for (uint32_t r = 0; r < num_rows.value; ++r) {
+         row_change change;
+         fc::raw::unpack( ds, change.present );
+         if (!is_wanted) {
+            fc::unsigned_int size;
+            fc::raw::unpack( ds, size );
+            ds.skip( size.value );
+            continue;
+         }
+         fc::raw::unpack( ds, change.row );
+         fc::datastream<const char*> row( change.row.data(), change.row.size() );
+         fc::unsigned_int version;
+         uint64_t row_code = 0, row_scope = 0, row_table = 0;
+         fc::raw::unpack( row, version );
+         const auto key_begin = row.pos();
+         fc::raw::unpack( row, row_code );
+         if (name( row_code ) != code)
+            continue;
+         if (kv) {
+            bytes kv_key;
+            fc::raw::unpack( row, kv_key );
+         } else {
+            uint64_t primary_key = 0;
+            fc::raw::unpack( row, row_scope );
+            fc::raw::unpack( row, row_table );
+            fc::raw::unpack( row, primary_key );
+            if ((table && name( row_table ) != *table) || (scope && name( row_scope ) != *scope))
+               continue;
+         }
+         change.key.assign( key_begin, row.pos() );
+         result.push_back( std::move( change ) );
+      }
+   }
+   return result;
+}
+
+fc::optional<state_checkpoint> statehistory::load_checkpoint(const state_history_log& log) const {
+   fc::optional<state_checkpoint> result;
+   if (checkpoint_dir.empty() || !bfs::is_directory( checkpoint_dir ))
+      return result;
+   // checkpoint-<block>.bin of any tables, the latest usable one wins
+   std::map<uint32_t, bfs::path> found;
+   for (bfs::directory_iterator enditr, itr{checkpoint_dir}; itr != enditr; ++itr) {
+      uint32_t num = 0;
+      char tail = 0;
+      if (sscanf( itr->path().filename().generic_string().c_str(), "checkpoint-%u.bi%c", &num, &tail ) == 2 &&
+          num <= block_num && num >= log.begin_block() - 1 && num < log.end_block())
+         found[num] = itr->path();
+   }
+   for (auto itr = found.rbegin(); itr != found.rend(); ++itr) {
+      state_checkpoint checkpoint;
+      try {
+         std::ifstream in( itr->second.generic_string(), std::ios::binary );
+         bytes data( bfs::file_size( itr->second ) );
+         in.read( data.data(), data.size() );
+         fc::datastream<const char*> ds( data.data(), data.size() );
+         fc::raw::unpack( ds, checkpoint );
+      } catch (const fc::exception& e) {
+         wlog( "Ignoring unreadable checkpoint ${f}: ${e}", ("f", itr->second.generic_string())("e", e.to_string()) );
+         continue;
+      }
+      if (checkpoint.filter != filter())
+         continue;
+      // the checkpoint has to be of the blocks in the log, not of a fork they replaced
+      if (checkpoint.block_num >= log.begin_block() && log.read_block_id( checkpoint.block_num ) != checkpoint.block_id) {
+         wlog( "Ignoring checkpoint ${f} of a block not in the log", ("f", itr->second.generic_string()) );
+         continue;
+      }
+      ilog( "Starting from checkpoint ${f}", ("f", itr->second.generic_string()) );
+      result = std::move( checkpoint );
+      break;
+   }
+   return result;
+}
+
+void statehistory::write_checkpoint(const state_checkpoint& checkpoint) const {
+   if (!bfs::is_directory( checkpoint_dir ))
+      bfs::create_directories( checkpoint_dir );
+   const auto file = checkpoint_dir / ("checkpoint-" + std::to_string( checkpoint.block_num ) + ".bin");
+   const auto temp = checkpoint_dir / ("checkpoint-" + std::to_string( checkpoint.block_num ) + ".tmp");
+   const auto data = fc::raw::pack( checkpoint );
+   {
+      std::ofstream out( temp.generic_string(), std::ios::binary | std::ios::trunc );
+      out.write( data.data(), data.size() );
+      EOS_ASSERT( out, plugin_exception, "unable to write ${f}", ("f", temp.generic_string()) );
+   }
+   bfs::rename( temp, file );
+   ilog( "Wrote checkpoint ${f}", ("f", file.generic_string()) );
+}
+
+fc::variant statehistory::row_to_variant(const bytes& row) const {
+   fc::datastream<const char*> ds( row.data(), row.size() );
+   fc::unsigned_int version;
+   fc::raw::unpack( ds, version );
+   fc::mutable_variant_object result;
+   uint64_t contract = 0, payer = 0;
+   fc::raw::unpack( ds, contract );
+   if (kv) {
+      bytes key, value;
+      fc::raw::unpack( ds, key );
+      fc::raw::unpack( ds, payer );
+      fc::raw::unpack( ds, value );
+      result( "contract", name( contract ) )( "key", key )( "payer", name( payer ) )( "value", value );
+   } else {
+      uint64_t row_scope = 0, row_table = 0, primary_key = 0;
+      bytes value;
+      fc::raw::unpack( ds, row_scope );
+      fc::raw::unpack( ds, row_table );
+      fc::raw::unpack( ds, primary_key );
+      fc::raw::unpack( ds, payer );
+      fc::raw::unpack( ds, value );
+      result( "code", name( contract ) )( "scope", name( row_scope ) )( "table", name( row_table ) )
+            ( "primary_key", primary_key )( "payer", name( payer ) )( "value", value );
+   }
+   return fc::variant( std::move( result ) );
+}
+
+void statehistory::run() {
+   report_time rt("reconstructing state");
+   state_history_log_config config;
+   config.retained_dir = retained_dir;
+   config.read_only    = true;
+   state_history_log log( "chain_state_history", (state_history_dir / "chain_state_history.log").string(),
+                          (state_history_dir / "chain_state_history.index").string(), config );
+   EOS_ASSERT( log.begin_block() != log.end_block(), plugin_exception, "chain_state_history.log is empty" );
+   EOS_ASSERT( block_num >= log.begin_block() && block_num < log.end_block(), plugin_exception,
+               "block ${b} is not in chain_state_history.log, which has blocks ${first} through ${last}",
+               ("b", block_num)("first", log.begin_block())("last", log.end_block() - 1) );
+
+   state_checkpoint state;
+   if (auto checkpoint = load_checkpoint( log )) {
+      state = std::move( *checkpoint );
+   } else {
+      // the plugin places the whole state in the first entry of a log it starts
+      ilog( "Starting from block ${b}, the first of chain_state_history.log", ("b", log.begin_block()) );
+      state.block_num = log.begin_block() - 1;
+      state.filter = filter();
+   }
+
+   // the deltas of the next blocks are read and decompressed on threads of their own and applied in order
+   const uint32_t batch_size = threads * 64;
+   for (uint32_t first = state.block_num + 1; first <= block_num; first += batch_size) {
+      const uint32_t count = std::min( batch_size, block_num - first + 1 );
+      std::vector<std::vector<row_change>> changes( count );
+      std::atomic<uint32_t> next{0};
+      std::atomic<bool> failed{false};
+      std::exception_ptr error;
+      std::mutex error_mtx;
+      std::vector<std::thread> workers;
+      for (uint32_t t = 0; t < std::min( threads, count ); ++t) {
+         workers.emplace_back( [&]() {
+            for (uint32_t i = next++; i < count && !failed; i = next++) {
+               try {
+                  changes[i] = read_changes( log, first + i );
+               } catch (...) {
+                  std::lock_guard<std::mutex> g( error_mtx );
+                  error = std::current_exception();
+                  failed = true;
+               }
+            }
+         } );
+      }
+      for (auto& w : workers)
+         w.join();
+      if (error)
+         std::rethrow_exception( error );
+
+      for (uint32_t i = 0; i < count; ++i) {
+         for (auto& change : changes[i]) {
+            if (change.present)
+               state.rows[std::move( change.key )] = std::move( change.row );
+            else
+               state.rows.erase( change.key );
+         }
+         state.block_num = first + i;
+         if (checkpoint_interval && state.block_num % checkpoint_interval == 0 && state.block_num != block_num) {
+            state.block_id = log.read_block_id( state.block_num );
+            write_checkpoint( state );
+         }
+      }
+   }
+   state.block_id = log.read_block_id( block_num );
+   if (!checkpoint_dir.empty() && checkpoint_interval)
+      write_checkpoint( state );
+
+   std::ofstream output_rows;
+   std::ostream* out = &std::cout;
+   if (!output_file.empty()) {
+      output_rows.open( output_file.generic_string().c_str() );
+      EOS_ASSERT( !output_rows.fail(), plugin_exception, "Unable to open file '${f}'", ("f", output_file.generic_string()) );
+      out = &output_rows;
+   }
+   for (const auto& row : state.rows) {
+      const auto v = row_to_variant( row.second );
+      if (no_pretty_print)
+         *out << fc::json::to_string( v, fc::time_point::maximum() ) << "\n";
+      else
+         *out << fc::json::to_pretty_string( v ) << "\n";
+   }
+   ilog( "${n} rows at block ${b} ${id}", ("n", state.rows.size())("b", block_num)("id", state.block_id) );
+   rt.report();
+}
+
+int main(int argc, char** argv) {
+   std::ios::sync_with_stdio(false);
+   options_description cli ("eosio-statehistory command line options");
+   try {
+      statehistory sh;
+      sh.set_program_options(cli);
+      variables_map vmap;
+      bpo::store(bpo::parse_command_line(argc, argv, cli), vmap);
+      if (vmap.count("help")) {
+         cli.print(std::cerr);
+         return 0;
+      }
+      bpo::notify(vmap);
+      sh.initialize(vmap);
+      sh.run();
+   } catch( const fc::exception& e ) {
+      elog( "${e}", ("e", e.to_detail_string()));
+      return -1;
+   } catch( const boost::exception& e ) {
+      elog("${e}", ("e",boost::diagnostic_information(e)));
+      return -1;
+   } catch( const std::exception& e ) {
+      elog("${e}", ("e",e.what()));
+      return -1;
+   } catch( ... ) {
+      elog("unknown exception");
+      return -1;
+   }
+
+   return 0;
+}
@@ -13,6 +13,7 @@
 
 #include <eosio/chain/contract_types.hpp>
 #include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/abi_compiled_decoder.hpp>
 #include <eosio/chain/eosio_contract.hpp>
 #include <eosio/testing/tester.hpp>
 
@@ -51,6 +52,14 @@ void verify_round_trip_conversion( const abi_serializer& abis, const type_name&
    BOOST_REQUIRE_EQUAL(fc::to_hex(bytes), hex);
    auto var2 = abis.binary_to_variant(type, bytes, abi_serializer::create_yield_function( max_serialization_time ));
    BOOST_REQUIRE_EQUAL(fc::json::to_string(var2, fc::time_point::now() + max_serialization_time), expected_json);
+   BOOST_REQUIRE_EQUAL(abi_compiled_decoder(abis).to_json(type, bytes, abi_serializer::create_yield_function( max_serialization_time )), expected_json);
+   BOOST_REQUIRE_EQUAL(fc::json::to_string(abi_compiled_decoder(abis).to_variant(type, bytes, abi_serializer::create_yield_function( max_serialization_time )),
+                                           fc::time_point::now() + max_serialization_time), expected_json);
+   try {
+      BOOST_REQUIRE_EQUAL(fc::to_hex(abi_compiled_decoder(abis).from_json(type, json, abi_serializer::create_yield_function( max_serialization_time ))), hex);
+   } catch( const pack_exception& ) {
+      // json that only variant_to_binary takes
+   }
    auto bytes2 = abis.variant_to_binary(type, var2, abi_serializer::create_yield_function( max_serialization_time ));
    BOOST_REQUIRE_EQUAL(fc::to_hex(bytes2), hex);
 }
@@ -741,6 +750,143 @@ BOOST_AUTO_TEST_CASE(general)
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE(compiled_decoder)
+{ try {
+
+   auto abi = eosio_contract_abi(fc::json::from_string(my_abi).as<abi_def>());
+   abi_serializer abis(abi, abi_serializer::create_yield_function( max_serialization_time ));
+   abi_compiled_decoder decoder(abis);
+
+   BOOST_CHECK( decoder.find_type("A") != abi_compiled_decoder::invalid_type );
+   BOOST_CHECK( decoder.find_type("A[]") != abi_compiled_decoder::invalid_type );
+   BOOST_CHECK( decoder.find_type("no_such_type") == abi_compiled_decoder::invalid_type );
+
+   // every built-in type, through the general test data, must decode exactly like binary_to_variant
+   const char* trx_json = R"=====(
+   {
+     "expiration": "2021-12-20T15:30:21",
+     "ref_block_num": 65535,
+     "ref_block_prefix": 4294967295,
+     "max_net_usage_words": 15,
+     "max_cpu_usage_ms": 43,
+     "delay_sec": 0,
+     "context_free_actions": [],
+     "actions": [{
+        "account": "eosio.token",
+        "name": "transfer",
+        "authorization": [{"actor": "alice", "permission": "active"}],
+        "data": "0e00000000000000"
+     }],
+     "transaction_extensions": []
+   }
+   )=====";
+   auto check = [&]( const type_name& type, const fc::variant& var ) {
+      auto bytes = abis.variant_to_binary(type, var, abi_serializer::create_yield_function( max_serialization_time ));
+      auto expected = fc::json::to_string(abis.binary_to_variant(type, bytes, abi_serializer::create_yield_function( max_serialization_time )),
+                                          fc::time_point::maximum());
+      BOOST_CHECK_EQUAL( expected, decoder.to_json(type, bytes, abi_serializer::create_yield_function( max_serialization_time )) );
+      BOOST_CHECK_EQUAL( expected, fc::json::to_string(decoder.to_variant(type, bytes, abi_serializer::create_yield_function( max_serialization_time )),
+                                                       fc::time_point::maximum()) );
+   };
+   check( "transaction", fc::json::from_string(trx_json) );
+   check( "uint64", fc::variant(uint64_t(0xffffffff)) );
+   check( "uint64", fc::variant(uint64_t(0x100000000)) );
+   check( "int64", fc::variant(int64_t(-5)) );
+   check( "int64", fc::variant(std::numeric_limits<int64_t>::min()) );
+   check( "string", fc::variant("quote \" and \\ and \n") );
+   check( "bytes", fc::variant(bytes()) );
+
+   // recursion is limited the same way as binary_to_variant
+   const char* abi_str = R"=====(
+   {
+     "version": "eosio::abi/1.0",
+     "structs": [
+       {"name": "a", "base": "", "fields": [{"name": "user", "type": "b"}]},
+       {"name": "b", "base": "", "fields": [{"name": "user", "type": "a?"}]}
+     ]
+   }
+   )=====";
+   abi_serializer rabis(fc::json::from_string(abi_str).as<abi_def>(), abi_serializer::create_yield_function( max_serialization_time ));
+   abi_compiled_decoder rdecoder(rabis);
+   bytes nested(64, 1);
+   BOOST_CHECK_THROW( rabis.binary_to_variant("a", nested, abi_serializer::create_yield_function( max_serialization_time )), abi_recursion_depth_exception );
+   BOOST_CHECK_THROW( rdecoder.to_json("a", nested, abi_serializer::create_yield_function( max_serialization_time )), abi_recursion_depth_exception );
+   BOOST_CHECK_THROW( rdecoder.to_variant("a", nested, abi_serializer::create_yield_function( max_serialization_time )), abi_recursion_depth_exception );
+   bytes shallow{1, 1, 0};
+   BOOST_CHECK_EQUAL( fc::json::to_string(rabis.binary_to_variant("a", shallow, abi_serializer::create_yield_function( max_serialization_time )), fc::time_point::maximum()),
+                      rdecoder.to_json("a", shallow, abi_serializer::create_yield_function( max_serialization_time )) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(compiled_encoder)
+{ try {
+
+   const char* abi_str = R"=====(
+   {
+     "version": "eosio::abi/1.1",
+     "types": [{"new_type_name": "account", "type": "name"}],
+     "structs": [
+       {"name": "base", "base": "", "fields": [{"name": "owner", "type": "account"}]},
+       {"name": "s", "base": "base", "fields": [
+          {"name": "flag", "type": "bool"},
+          {"name": "i8", "type": "int8"},
+          {"name": "u16", "type": "uint16"},
+          {"name": "i32", "type": "int32"},
+          {"name": "u64", "type": "uint64"},
+          {"name": "i64", "type": "int64"},
+          {"name": "memo", "type": "string"},
+          {"name": "data", "type": "bytes"},
+          {"name": "quantity", "type": "asset"},
+          {"name": "names", "type": "name[]"},
+          {"name": "opt", "type": "uint32?"},
+          {"name": "v", "type": "v"},
+          {"name": "p", "type": "pair"},
+          {"name": "ext", "type": "uint8$"}
+       ]},
+       {"name": "pair", "base": "", "fields": [{"name": "first", "type": "uint8"}, {"name": "second", "type": "time_point_sec"}]}
+     ],
+     "variants": [{"name": "v", "types": ["uint8", "string"]}]
+   }
+   )=====";
+   abi_serializer abis(fc::json::from_string(abi_str).as<abi_def>(), abi_serializer::create_yield_function( max_serialization_time ));
+   abi_compiled_decoder encoder(abis);
+
+   auto check = [&]( const type_name& type, const std::string& json ) {
+      auto expected = abis.variant_to_binary(type, fc::json::from_string(json), abi_serializer::create_yield_function( max_serialization_time ));
+      BOOST_CHECK_EQUAL( fc::to_hex(expected), fc::to_hex(encoder.from_json(type, json, abi_serializer::create_yield_function( max_serialization_time ))) );
+   };
+   const std::string fields = R"=====("owner": "alice", "flag": true, "i8": -128, "u16": 65535, "i32": -7, "u64": 18446744073709551615,
+      "i64": -9223372036854775808, "memo": "plain memo", "data": "00ff7A", "quantity": "1.0000 SYS", "names": ["bob", "carol"],
+      "opt": null, "v": ["string", "x"], "p": [2, "2021-12-20T15:30:21"])=====";
+   check( "s", "{" + fields + "}" );
+   check( "s", "{" + fields + R"=====(, "ext": 3})=====" );
+   check( "s", R"=====({"p": {"second": "2021-12-20T15:30:21", "first": 1}, "v": ["uint8", 9], "opt": 5, "owner": "bob", "flag": false,
+      "i8": 0, "u16": "17", "i32": 2147483647, "u64": 0, "i64": 0, "memo": "", "data": "", "quantity": "0.01 EOS", "names": []})=====" );
+   check( "uint64", R"=====("12")=====" );
+   check( "uint8", "300" );
+   check( "name[]", "[]" );
+   check( "pair", " [ 1 , \"2021-12-20T15:30:21\" , 7 ] " );
+
+   // what the encoder does not take, variant_to_binary converts or rejects
+   BOOST_CHECK_THROW( encoder.from_json("string", R"=====("escaped \" quote")=====", abi_serializer::create_yield_function( max_serialization_time )), pack_exception );
+   BOOST_CHECK_THROW( encoder.from_json("uint8", "1.5", abi_serializer::create_yield_function( max_serialization_time )), pack_exception );
+   BOOST_CHECK_THROW( encoder.from_json("pair", R"=====({"first": 1, "first": 2, "second": "2021-12-20T15:30:21"})=====", abi_serializer::create_yield_function( max_serialization_time )), pack_exception );
+   BOOST_CHECK_THROW( encoder.from_json("pair", R"=====({"first": 1})=====", abi_serializer::create_yield_function( max_serialization_time )), pack_exception );
+   BOOST_CHECK_THROW( encoder.from_json("s", "[]", abi_serializer::create_yield_function( max_serialization_time )), pack_exception );
+   BOOST_CHECK_THROW( encoder.from_json("uint8", "1 2", abi_serializer::create_yield_function( max_serialization_time )), pack_exception );
+   BOOST_CHECK_THROW( encoder.from_json("v", R"=====(["uint16", 1])=====", abi_serializer::create_yield_function( max_serialization_time )), pack_exception );
+
+   std::vector<std::pair<std::string_view, std::string_view>> members;
+   BOOST_REQUIRE( abi_compiled_decoder::split_json_object( R"=====({"code": "eosio", "args": {"a": [1, {}]}})=====", members ) );
+   BOOST_REQUIRE_EQUAL( 2u, members.size() );
+   BOOST_CHECK_EQUAL( "code", std::string( members[0].first ) );
+   BOOST_CHECK_EQUAL( "\"eosio\"", std::string( members[0].second ) );
+   BOOST_CHECK_EQUAL( R"=====({"a": [1, {}]})=====", std::string( members[1].second ) );
+   members.clear();
+   BOOST_CHECK( !abi_compiled_decoder::split_json_object( "[1]", members ) );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE(abi_cycle)
 { try {
 
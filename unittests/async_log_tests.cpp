@@ -0,0 +1,36 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/async_log.hpp>
+#include <eosio/chain/types.hpp>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+BOOST_AUTO_TEST_SUITE(async_log_tests)
+
+BOOST_AUTO_TEST_CASE( disabled_level_not_evaluated ) {
+   fc::logger l = fc::logger::get( "async_log_test" );
+   l.set_log_level( fc::log_level::info );
+   int evaluated = 0;
+   auto arg = [&evaluated]() { return ++evaluated; };
+   async_dlog( l, "not logged ${n}", "n", arg() );
+   BOOST_CHECK_EQUAL( 0, evaluated );
+   async_ilog( l, "logged ${n}", "n", arg() );
+   BOOST_CHECK_EQUAL( 1, evaluated );
+   async_log::instance().flush();
+}
+
+BOOST_AUTO_TEST_CASE( flush_writes_posted ) {
+   fc::logger l = fc::logger::get( "async_log_test" );
+   l.set_log_level( fc::log_level::info );
+   const auto dropped = async_log::instance().dropped();
+   const block_id_type id = fc::sha256::hash( std::string( "block" ) );
+   for( uint32_t i = 0; i < 100; ++i ) {
+      async_ilog( l, "block #${n} ${id} ${s}", "n", i, "id", short_id{id}, "s", std::string( "memo" ) );
+   }
+   async_log::instance().flush();
+   BOOST_CHECK_EQUAL( dropped, async_log::instance().dropped() );
+   fc::variant v( short_id{id} );
+   BOOST_CHECK_EQUAL( id.str().substr( 8, 16 ), v.as_string() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
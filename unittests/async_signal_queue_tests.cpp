@@ -0,0 +1,66 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/async_signal_queue.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <future>
+#include <vector>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+BOOST_AUTO_TEST_SUITE(async_signal_queue_tests)
+
+BOOST_AUTO_TEST_CASE( runs_in_order ) {
+   std::vector<int> ran;
+   async_signal_queue q( "test", 4, async_signal_queue::overflow_policy::block );
+   for( int i = 0; i < 100; ++i ) {
+      q.post( [&ran, i]() { ran.push_back( i ); } );
+   }
+   q.flush();
+   BOOST_REQUIRE_EQUAL( 100u, ran.size() );
+   for( int i = 0; i < 100; ++i ) BOOST_CHECK_EQUAL( i, ran[i] );
+   BOOST_CHECK_EQUAL( 0u, q.dropped() );
+}
+
+BOOST_AUTO_TEST_CASE( drop_when_full ) {
+   std::promise<void> release;
+   auto released = release.get_future().share();
+   int ran = 0;
+   async_signal_queue q( "test", 2, async_signal_queue::overflow_policy::drop );
+   q.post( [released]() { released.wait(); } );
+   // the first handler may not have been taken yet, so that only one or both of these are queued
+   for( int i = 0; i < 4; ++i ) q.post( [&ran]() { ++ran; } );
+   release.set_value();
+   q.flush();
+   BOOST_CHECK_EQUAL( 4u, ran + q.dropped() );
+   BOOST_CHECK( q.dropped() >= 2u );
+}
+
+BOOST_AUTO_TEST_CASE( stop_runs_queued ) {
+   int ran = 0;
+   {
+      async_signal_queue q( "test", 10, async_signal_queue::overflow_policy::block );
+      for( int i = 0; i < 10; ++i ) q.post( [&ran]() { ++ran; } );
+      q.stop();
+      q.post( [&ran]() { ++ran; } );
+   }
+   BOOST_CHECK_EQUAL( 10, ran );
+}
+
+BOOST_AUTO_TEST_CASE( handler_throwing ) {
+   int ran = 0;
+   async_signal_queue q( "test", 10, async_signal_queue::overflow_policy::block );
+   q.post( []() { throw std::runtime_error( "handler failed" ); } );
+   q.post( [&ran]() { ++ran; } );
+   q.flush();
+   BOOST_CHECK_EQUAL( 1, ran );
+}
+
+BOOST_AUTO_TEST_CASE( overflow_policy_names ) {
+   BOOST_CHECK( async_signal_queue::overflow_policy::block == to_overflow_policy( "block" ) );
+   BOOST_CHECK( async_signal_queue::overflow_policy::drop == to_overflow_policy( "drop" ) );
+   BOOST_CHECK_THROW( to_overflow_policy( "wait" ), misc_exception );
+   BOOST_CHECK_THROW( async_signal_queue( "test", 0, async_signal_queue::overflow_policy::block ), misc_exception );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
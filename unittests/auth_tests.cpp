@@ -521,5 +521,114 @@ BOOST_AUTO_TEST_CASE( linkauth_special ) { try {
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( cached_authorization ) { try {
+   TESTER chain;
+   chain.create_account(N(alice));
+   chain.produce_blocks(2);
+
+   const auto& auth_manager = chain.control->get_authorization_manager();
+   const vector<action> actions{ action( {permission_level{N(alice), config::active_name}}, N(alice), N(foo), bytes() ) };
+   const auto active_pub_key = chain.get_public_key(N(alice), "active");
+   const auto owner_pub_key = chain.get_public_key(N(alice), "owner");
+
+   auth_manager.check_authorization( actions, {active_pub_key} );
+   auth_manager.check_authorization( actions, {active_pub_key} );
+
+   // only the keys checked before are accepted
+   BOOST_CHECK_THROW( auth_manager.check_authorization( actions, {active_pub_key, owner_pub_key} ), tx_irrelevant_sig );
+   BOOST_CHECK_THROW( auth_manager.check_authorization( actions, {owner_pub_key} ), unsatisfied_authorization );
+   auth_manager.check_authorization( actions, {active_pub_key} );
+
+   // a new active key replaces the one checked before
+   const auto new_active_pub_key = chain.get_public_key(N(alice), "new_active");
+   chain.set_authority(N(alice), config::active_name, authority(new_active_pub_key), config::owner_name);
+   chain.produce_blocks(2);
+
+   BOOST_CHECK_THROW( auth_manager.check_authorization( actions, {active_pub_key} ), unsatisfied_authorization );
+   auth_manager.check_authorization( actions, {new_active_pub_key} );
+   auth_manager.check_authorization( actions, {new_active_pub_key} );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( parallel_auth_checks ) { try {
+   tester chain;
+   chain.create_account(N(alice));
+   chain.produce_block();
+
+   const auto new_active_priv_key = chain.get_private_key(N(alice), "new_active");
+   chain.push_reqauth( N(alice), "owner" );
+   chain.set_authority( N(alice), config::active_name, authority(new_active_priv_key.get_public_key()), config::owner_name );
+   // only satisfied once the previous transaction of the block has been applied
+   chain.push_reqauth( N(alice), {permission_level{N(alice), config::active_name}}, {new_active_priv_key} );
+   chain.produce_block();
+
+   fc::temp_directory tempdir;
+   auto conf_genesis = tester::default_config( tempdir );
+   conf_genesis.first.parallel_auth_checks = true;
+   conf_genesis.first.thread_pool_size = 2;
+   tester validator( conf_genesis.first, conf_genesis.second );
+
+   while( validator.control->head_block_num() < chain.control->head_block_num() ) {
+      validator.push_block( chain.control->fetch_block_by_number( validator.control->head_block_num() + 1 ) );
+   }
+   BOOST_CHECK( validator.control->head_block_id() == chain.control->head_block_id() );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( parallel_auth_checks_canceldelay ) { try {
+   tester chain;
+   chain.create_account(N(alice));
+   chain.produce_block();
+
+   signed_transaction delayed;
+   delayed.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, N(alice), N(nothing), bytes() );
+   chain.set_transaction_headers( delayed, tester::DEFAULT_EXPIRATION_DELTA, 60 );
+   delayed.sign( chain.get_private_key(N(alice), "active"), chain.control->get_chain_id() );
+   auto trace = chain.push_transaction( delayed );
+   BOOST_REQUIRE_EQUAL( transaction_receipt::delayed, trace->receipt->status );
+   chain.produce_block();
+
+   auto make_cancel = [&]( uint32_t expiration ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}},
+                                chain::canceldelay{{N(alice), config::active_name}, trace->id} );
+      chain.set_transaction_headers( trx, expiration );
+      trx.sign( chain.get_private_key(N(alice), "active"), chain.control->get_chain_id() );
+      return trx;
+   };
+   chain.push_transaction( make_cancel( tester::DEFAULT_EXPIRATION_DELTA ) );
+   auto b = chain.produce_block();
+
+   // a second canceldelay of the same delayed transaction, satisfied by the state the block starts with only
+   auto copy_b = std::make_shared<signed_block>( b->clone() );
+   copy_b->transactions.emplace_back( copy_b->transactions.back() );
+   copy_b->transactions.back().trx = packed_transaction( make_cancel( tester::DEFAULT_EXPIRATION_DELTA + 1 ) );
+
+   vector<digest_type> trx_digests;
+   for( const auto& a : copy_b->transactions )
+      trx_digests.emplace_back( a.digest() );
+   copy_b->transaction_mroot = merkle( move(trx_digests) );
+
+   auto header_bmroot = digest_type::hash( std::make_pair( copy_b->digest(), chain.control->head_block_state()->blockroot_merkle.get_root() ) );
+   auto sig_digest = digest_type::hash( std::make_pair(header_bmroot, chain.control->head_block_state()->pending_schedule.schedule_hash) );
+   copy_b->producer_signature = chain.get_private_key(b->producer, "active").sign(sig_digest);
+
+   for( bool parallel_auth_checks : { false, true } ) {
+      fc::temp_directory tempdir;
+      auto conf_genesis = tester::default_config( tempdir );
+      conf_genesis.first.parallel_auth_checks = parallel_auth_checks;
+      conf_genesis.first.thread_pool_size = 2;
+      tester validator( conf_genesis.first, conf_genesis.second );
+
+      while( validator.control->head_block_num() + 1 < copy_b->block_num() ) {
+         validator.push_block( chain.control->fetch_block_by_number( validator.control->head_block_num() + 1 ) );
+      }
+      BOOST_REQUIRE_EXCEPTION( validator.push_block( copy_b ), fc::exception, []( const fc::exception& e ) {
+         return e.code() == tx_not_found::code_value;
+      });
+   }
+
+} FC_LOG_AND_RETHROW() }
+
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+
+#include <string>
+
+namespace eosio { namespace benchmark {
+
+   /// a measurement, written as a line of JSON so that runs of different commits can be compared
+   struct result {
+      std::string  benchmark;
+      std::string  unit;             ///< what one iteration does
+      uint64_t     iterations = 0;
+      int64_t      elapsed_us = 0;
+      double       per_second = 0;   ///< iterations per second
+      std::string  version;          ///< of the build measured
+      std::string  wasm_runtime;
+   };
+
+   /// the recorded chain replayed by the replay benchmark, blocks_dir is empty unless --replay-blocks is given
+   struct replay_config {
+      std::string  blocks_dir;
+      std::string  snapshot;                      ///< the replay starts from, from the genesis of the block log when empty
+      uint32_t     last_block = 0;                ///< 0 for the last block of the log
+      uint32_t     slowest = 20;                  ///< transactions reported
+      uint64_t     state_size_mb = 32 * 1024;
+      std::string  report_path;                   ///< of the timings of every block, stdout when empty
+   };
+
+   /// the simulated network of the p2p benchmark, see main.cpp
+   struct net_config {
+      uint32_t     peers = 4;               ///< serving the sync, then one relaying blocks and transactions to the others
+      uint32_t     latency_ms = 0;          ///< of each link between a peer and the node, one way
+      uint32_t     bandwidth_kib = 0;       ///< per second of each link and direction, 0 for unlimited
+      uint32_t     blocks = 1000;           ///< generated and synced, unless --replay-blocks gives recorded ones
+      uint32_t     block_transactions = 20; ///< of each generated block
+      uint32_t     relay_blocks = 50;       ///< relayed one by one after the sync
+      uint32_t     transactions = 2000;     ///< of the flood relayed after the blocks, generated chain only
+      uint32_t     timeout_sec = 120;       ///< of each phase
+      std::string  report_path;             ///< of the latencies and cpu use of each phase, stdout when empty
+   };
+
+   /// default_iterations scaled by --scale, at least 1
+   uint64_t iterations( uint64_t default_iterations );
+
+   const replay_config& replay();
+
+   const net_config& net();
+
+   /// write the result of running benchmark iterations times in elapsed to the --results file, stdout by default
+   void report( const std::string& benchmark, const std::string& unit, uint64_t iterations, const fc::microseconds& elapsed );
+
+   /// time n calls of f(i), i from 0 to n - 1
+   template<typename F>
+   void measure( const std::string& benchmark, const std::string& unit, uint64_t n, F&& f ) {
+      const auto start = fc::time_point::now();
+      for( uint64_t i = 0; i < n; ++i ) f( i );
+      report( benchmark, unit, n, fc::time_point::now() - start );
+   }
+
+} } /// eosio::benchmark
+
+FC_REFLECT( eosio::benchmark::result, (benchmark)(unit)(iterations)(elapsed_us)(per_second)(version)(wasm_runtime) )
@@ -0,0 +1,136 @@
+#include "benchmark.hpp"
+
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/version/version.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+// Each benchmark is a test case, run them with e.g.
+//    chain_benchmarks --run_test=token_benchmarks -- --eos-vm-jit --results=results.jsonl --scale=0.1
+// The WASM runtime is chosen as for unit_test, --results appends the results to a file instead of writing them to
+// stdout and --scale multiplies the iterations of every benchmark.
+//
+// The replay benchmark replays recorded blocks, so that two builds can be compared on the same real traffic:
+//    chain_benchmarks --run_test=replay_benchmarks -- --replay-blocks=<blocks dir> --replay-snapshot=<snapshot.bin>
+// It starts from the snapshot, or from the genesis of the block log without one, and applies the blocks following it
+// up to --replay-last=<block num>, the end of the log by default. --replay-report=<file> receives the apply time of
+// every block and the --replay-slowest=<n> slowest transactions, --replay-state-size=<MiB> sizes the chain state.
+//
+// The p2p benchmark runs net_plugin in process with --net-peers=<n> simulated peers connected over loopback, each link
+// delayed by --net-latency-ms=<ms> and limited to --net-bandwidth-kib=<KiB/s> each way:
+//    chain_benchmarks --run_test=net_benchmarks -- --net-peers=8 --net-latency-ms=50 --net-bandwidth-kib=10240
+// The peers serve the sync of --net-blocks=<n> generated blocks of --net-block-transactions=<n> transactions, or of
+// the blocks of --replay-blocks up to --replay-last, then one of them relays --net-relay-blocks=<n> blocks and a flood
+// of --net-transactions=<n> transactions to the others through the node. --net-report=<file> receives the latencies
+// and the cpu use of the node per message of each phase, --net-timeout=<s> bounds each phase.
+
+namespace eosio { namespace benchmark {
+
+   namespace {
+      std::string    results_path;
+      double         scale = 1.0;
+      std::string    wasm_runtime = "default";
+      replay_config  replay_cfg;
+      net_config     net_cfg;
+   }
+
+   uint64_t iterations( uint64_t default_iterations ) {
+      return std::max<uint64_t>( 1, std::llround( default_iterations * scale ) );
+   }
+
+   const replay_config& replay() {
+      return replay_cfg;
+   }
+
+   const net_config& net() {
+      return net_cfg;
+   }
+
+   void report( const std::string& benchmark, const std::string& unit, uint64_t iterations, const fc::microseconds& elapsed ) {
+      result r{ benchmark, unit, iterations, elapsed.count(),
+                elapsed.count() > 0 ? iterations * 1'000'000.0 / elapsed.count() : 0.0,
+                eosio::version::version_full(), wasm_runtime };
+      const auto line = fc::json::to_string( r, fc::time_point::maximum() );
+      if( results_path.empty() ) {
+         std::cout << line << std::endl;
+      } else {
+         std::ofstream out( results_path, std::ios::app );
+         out << line << std::endl;
+      }
+   }
+
+} } /// eosio::benchmark
+
+void translate_fc_exception(const fc::exception &e) {
+   std::cerr << "\033[33m" <<  e.to_detail_string() << "\033[0m" << std::endl;
+   BOOST_TEST_FAIL("Caught Unexpected Exception");
+}
+
+boost::unit_test::test_suite* init_unit_test_suite(int argc, char* argv[]) {
+   using namespace eosio::benchmark;
+
+   // logging would be measured along with the chain
+   fc::logger::get(DEFAULT_LOGGER).set_log_level(fc::log_level::off);
+
+   const std::string results_arg = "--results=";
+   const std::string scale_arg = "--scale=";
+   std::string value;
+   for (int i = 0; i < argc; i++) {
+      const std::string arg = argv[i];
+      auto matches = [&arg, &value]( const std::string& name ) {
+         if (arg.compare(0, name.size(), name) != 0)
+            return false;
+         value = arg.substr(name.size());
+         return true;
+      };
+      if (matches(results_arg)) {
+         results_path = value;
+      } else if (matches(scale_arg)) {
+         scale = std::stod(value);
+      } else if (matches("--replay-blocks=")) {
+         replay_cfg.blocks_dir = value;
+      } else if (matches("--replay-snapshot=")) {
+         replay_cfg.snapshot = value;
+      } else if (matches("--replay-last=")) {
+         replay_cfg.last_block = std::stoul(value);
+      } else if (matches("--replay-slowest=")) {
+         replay_cfg.slowest = std::stoul(value);
+      } else if (matches("--replay-state-size=")) {
+         replay_cfg.state_size_mb = std::stoull(value);
+      } else if (matches("--replay-report=")) {
+         replay_cfg.report_path = value;
+      } else if (matches("--net-peers=")) {
+         net_cfg.peers = std::stoul(value);
+      } else if (matches("--net-latency-ms=")) {
+         net_cfg.latency_ms = std::stoul(value);
+      } else if (matches("--net-bandwidth-kib=")) {
+         net_cfg.bandwidth_kib = std::stoul(value);
+      } else if (matches("--net-blocks=")) {
+         net_cfg.blocks = std::stoul(value);
+      } else if (matches("--net-block-transactions=")) {
+         net_cfg.block_transactions = std::stoul(value);
+      } else if (matches("--net-relay-blocks=")) {
+         net_cfg.relay_blocks = std::stoul(value);
+      } else if (matches("--net-transactions=")) {
+         net_cfg.transactions = std::stoul(value);
+      } else if (matches("--net-timeout=")) {
+         net_cfg.timeout_sec = std::stoul(value);
+      } else if (matches("--net-report=")) {
+         net_cfg.report_path = value;
+      } else if (arg == "--wabt" || arg == "--eos-vm" || arg == "--eos-vm-jit" || arg == "--eos-vm-oc") {
+         wasm_runtime = arg.substr(2);
+      }
+   }
+
+   boost::unit_test::unit_test_monitor.register_exception_translator<fc::exception>(&translate_fc_exception);
+
+   return nullptr;
+}
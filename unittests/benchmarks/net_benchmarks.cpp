@@ -0,0 +1,723 @@
+#include "benchmark.hpp"
+
+#include <eosio/chain/block_log.hpp>
+#include <eosio/chain/contract_types.hpp>
+#include <eosio/chain_plugin/chain_plugin.hpp>
+#include <eosio/net_plugin/net_plugin.hpp>
+#include <eosio/net_plugin/protocol.hpp>
+#include <eosio/producer_plugin/producer_plugin.hpp>
+#include <eosio/testing/tester.hpp>
+
+#include <appbase/application.hpp>
+
+#include <fc/crypto/rand.hpp>
+#include <fc/io/json.hpp>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include <pthread.h>
+#include <sys/resource.h>
+#include <time.h>
+
+using namespace eosio;
+using namespace eosio::chain;
+using namespace eosio::testing;
+using boost::asio::ip::tcp;
+
+namespace {
+
+   // must match net_plugin.cpp, as in eosio-bootstrap
+   constexpr uint16_t net_version_base = 0x04b5;
+   constexpr uint16_t proto_compact_block = 3;
+   constexpr uint32_t max_message_size = 8*1024*1024;
+   // see protocol net_message
+   constexpr uint32_t handshake_which = 0;
+   constexpr uint32_t go_away_which = 2;
+   constexpr uint32_t sync_request_which = 6;
+   constexpr uint32_t signed_block_which = 7;
+   constexpr uint32_t packed_transaction_which = 8;
+   constexpr uint32_t compact_block_which = 9;
+
+   using steady = std::chrono::steady_clock;
+   using buffer_ptr = std::shared_ptr<const std::vector<char>>;
+
+   /// msg as net_plugin writes it, its size not variable size encoded
+   buffer_ptr frame( const net_message& msg ) {
+      const uint32_t size = fc::raw::pack_size( msg );
+      auto buffer = std::make_shared<std::vector<char>>( sizeof(size) + size );
+      fc::datastream<char*> ds( buffer->data(), buffer->size() );
+      ds.write( reinterpret_cast<const char*>( &size ), sizeof(size) );
+      fc::raw::pack( ds, msg );
+      return buffer;
+   }
+
+   int64_t to_us( steady::duration d ) {
+      return std::chrono::duration_cast<std::chrono::microseconds>( d ).count();
+   }
+
+   /**
+    * A connection to the node over loopback, through a simulated link: what goes through either way takes the time
+    * its bytes need at the bandwidth of the link, behind what went before, then the latency of the link. Reading
+    * waits for the link to be free again so that a node writing faster than the link sees its socket fill up. Only
+    * used from the thread running its io_context.
+    */
+   class simulated_peer : public std::enable_shared_from_this<simulated_peer> {
+   public:
+      using message_handler = std::function<void( simulated_peer& peer, uint32_t which, fc::datastream<const char*>& ds )>;
+
+      simulated_peer( boost::asio::io_context& ctx, steady::duration latency, uint64_t bytes_per_second, message_handler on_message )
+      : socket( ctx ), read_timer( ctx ), write_timer( ctx ), deliver_timer( ctx ),
+        latency( latency ), bytes_per_second( bytes_per_second ), on_message( std::move( on_message ) ) {}
+
+      void connect( const tcp::endpoint& node, buffer_ptr hello ) {
+         socket.async_connect( node, [self = shared_from_this(), hello]( const boost::system::error_code& ec ) {
+            if( ec ) {
+               self->fail( "unable to connect: " + ec.message() );
+               return;
+            }
+            self->socket.set_option( tcp::no_delay( true ) );
+            self->send( hello );
+            self->read_message();
+         } );
+      }
+
+      /// on_sent is called when msg is past the link, as the node starts reading it
+      void send( buffer_ptr msg, std::function<void()> on_sent = {} ) {
+         if( closed ) return;
+         egress_free = std::max( steady::now(), egress_free ) + transfer_time( msg->size() );
+         writes.push_back( queued{ egress_free + latency, std::move( msg ), std::move( on_sent ) } );
+         if( writes.size() == 1 ) write_next();
+      }
+
+      void close() {
+         closed = true;
+         boost::system::error_code ec;
+         socket.close( ec );
+         read_timer.cancel();
+         write_timer.cancel();
+         deliver_timer.cancel();
+      }
+
+      uint64_t    messages = 0; ///< sent and received
+      std::string error;        ///< set once the connection failed
+
+   private:
+      struct queued {
+         steady::time_point     at;
+         buffer_ptr             msg;
+         std::function<void()>  on_sent;
+      };
+
+      steady::duration transfer_time( uint64_t bytes )const {
+         if( bytes_per_second == 0 ) return steady::duration::zero();
+         return std::chrono::duration_cast<steady::duration>( std::chrono::microseconds( bytes * 1'000'000 / bytes_per_second ) );
+      }
+
+      void fail( const std::string& what ) {
+         if( !closed && error.empty() ) error = what;
+         close();
+      }
+
+      void write_next() {
+         if( closed || writes.empty() ) return;
+         if( writes.front().at > steady::now() ) {
+            write_timer.expires_at( writes.front().at );
+            write_timer.async_wait( [self = shared_from_this()]( const boost::system::error_code& ec ) {
+               if( !ec ) self->write_next();
+            } );
+            return;
+         }
+         auto& w = writes.front();
+         if( w.on_sent ) w.on_sent();
+         boost::asio::async_write( socket, boost::asio::buffer( *w.msg ),
+                                   [self = shared_from_this()]( const boost::system::error_code& ec, std::size_t ) {
+            if( ec ) {
+               self->fail( "unable to write: " + ec.message() );
+               return;
+            }
+            ++self->messages;
+            self->writes.pop_front();
+            self->write_next();
+         } );
+      }
+
+      void read_message() {
+         boost::asio::async_read( socket, boost::asio::buffer( &size, sizeof(size) ),
+                                  [self = shared_from_this()]( const boost::system::error_code& ec, std::size_t ) {
+            if( ec ) {
+               self->fail( "unable to read: " + ec.message() );
+               return;
+            }
+            if( self->size == 0 || self->size > max_message_size ) {
+               self->fail( "invalid message size " + std::to_string( self->size ) );
+               return;
+            }
+            auto msg = std::make_shared<std::vector<char>>( self->size );
+            boost::asio::async_read( self->socket, boost::asio::buffer( *msg ),
+                                     [self, msg]( const boost::system::error_code& ec, std::size_t ) {
+               if( ec ) {
+                  self->fail( "unable to read: " + ec.message() );
+                  return;
+               }
+               self->ingress_free = std::max( steady::now(), self->ingress_free ) + self->transfer_time( sizeof(uint32_t) + msg->size() );
+               self->deliveries.push_back( queued{ self->ingress_free + self->latency, msg, {} } );
+               if( self->deliveries.size() == 1 ) self->deliver_next();
+               self->read_after( self->ingress_free );
+            } );
+         } );
+      }
+
+      void read_after( steady::time_point at ) {
+         if( at <= steady::now() ) {
+            read_message();
+            return;
+         }
+         read_timer.expires_at( at );
+         read_timer.async_wait( [self = shared_from_this()]( const boost::system::error_code& ec ) {
+            if( !ec ) self->read_message();
+         } );
+      }
+
+      void deliver_next() {
+         while( !closed && !deliveries.empty() ) {
+            if( deliveries.front().at > steady::now() ) {
+               deliver_timer.expires_at( deliveries.front().at );
+               deliver_timer.async_wait( [self = shared_from_this()]( const boost::system::error_code& ec ) {
+                  if( !ec ) self->deliver_next();
+               } );
+               return;
+            }
+            const auto msg = deliveries.front().msg;
+            deliveries.pop_front();
+            ++messages;
+            try {
+               fc::datastream<const char*> ds( msg->data(), msg->size() );
+               unsigned_int which;
+               fc::raw::unpack( ds, which );
+               if( which.value == go_away_which ) {
+                  go_away_message gam;
+                  fc::raw::unpack( ds, gam );
+                  fail( std::string( "node sent go away: " ) + reason_str( gam.reason ) );
+                  return;
+               }
+               on_message( *this, which.value, ds );
+            } catch( const fc::exception& e ) {
+               fail( e.to_string() );
+            } catch( const std::exception& e ) {
+               fail( e.what() );
+            }
+         }
+      }
+
+      tcp::socket                socket;
+      boost::asio::steady_timer  read_timer;
+      boost::asio::steady_timer  write_timer;
+      boost::asio::steady_timer  deliver_timer;
+      const steady::duration     latency;
+      const uint64_t             bytes_per_second;
+      message_handler            on_message;
+      bool                       closed = false;
+      uint32_t                   size = 0;
+      steady::time_point         egress_free;
+      steady::time_point         ingress_free;
+      std::deque<queued>         writes;
+      std::deque<queued>         deliveries;
+   };
+   using simulated_peer_ptr = std::shared_ptr<simulated_peer>;
+
+   /// the time from when a block or transaction reached the node from one peer to when it reached each of the others
+   class relay_tracker {
+   public:
+      void sent( const fc::sha256& id ) {
+         std::lock_guard<std::mutex> g( mtx );
+         sent_at.emplace( id, steady::now() );
+         if( !first_sent ) first_sent = steady::now();
+      }
+
+      void received( const fc::sha256& id ) {
+         std::lock_guard<std::mutex> g( mtx );
+         const auto it = sent_at.find( id );
+         if( it == sent_at.end() ) return;
+         last_received = steady::now();
+         latencies_us.push_back( to_us( last_received - it->second ) );
+         cv.notify_all();
+      }
+
+      /// @return whether n were received before deadline
+      bool wait_for( uint64_t n, steady::time_point deadline ) {
+         std::unique_lock<std::mutex> g( mtx );
+         return cv.wait_until( g, deadline, [this, n]() { return latencies_us.size() >= n; } );
+      }
+
+      std::mutex                  mtx;
+      std::condition_variable     cv;
+      std::map<fc::sha256, steady::time_point>  sent_at;
+      std::optional<steady::time_point>         first_sent;
+      steady::time_point          last_received;
+      std::vector<int64_t>        latencies_us;
+   };
+
+   struct latency_summary {
+      uint64_t  count = 0;
+      int64_t   p50_us = 0;
+      int64_t   p90_us = 0;
+      int64_t   p99_us = 0;
+      int64_t   max_us = 0;
+   };
+
+   latency_summary summarize( std::vector<int64_t> latencies ) {
+      latency_summary s;
+      if( latencies.empty() ) return s;
+      std::sort( latencies.begin(), latencies.end() );
+      const auto at = [&latencies]( double q ) { return latencies[ std::min<size_t>( latencies.size() - 1, latencies.size() * q ) ]; };
+      s.count = latencies.size();
+      s.p50_us = at( 0.5 );
+      s.p90_us = at( 0.9 );
+      s.p99_us = at( 0.99 );
+      s.max_us = latencies.back();
+      return s;
+   }
+
+   struct phase_report {
+      std::string      phase;
+      uint64_t         messages = 0;              ///< exchanged by the node with the peers
+      int64_t          elapsed_us = 0;
+      int64_t          node_cpu_us = 0;           ///< of the process, less the peers and the benchmark thread
+      double           cpu_us_per_message = 0;
+      latency_summary  latency;                   ///< of the relay to each other peer, empty for the sync
+   };
+
+   struct net_report {
+      uint32_t                   peers = 0;
+      uint32_t                   latency_ms = 0;
+      uint32_t                   bandwidth_kib = 0;
+      bool                       recorded = false;  ///< blocks of --replay-blocks rather than generated
+      uint32_t                   first_block = 0;   ///< synced
+      uint32_t                   last_block = 0;    ///< relayed
+      std::vector<phase_report>  phases;
+   };
+
+   /// cpu time used so far by the process, the peers thread and the calling thread
+   struct cpu_sample {
+      int64_t process_us = 0;
+      int64_t peers_us = 0;
+      int64_t self_us = 0;
+   };
+
+   int64_t thread_cpu_us( clockid_t clock ) {
+      timespec ts{};
+      clock_gettime( clock, &ts );
+      return int64_t( ts.tv_sec ) * 1'000'000 + ts.tv_nsec / 1000;
+   }
+
+   cpu_sample sample_cpu( std::thread& peers_thread ) {
+      cpu_sample s;
+      rusage usage{};
+      getrusage( RUSAGE_SELF, &usage );
+      s.process_us = (int64_t( usage.ru_utime.tv_sec ) + usage.ru_stime.tv_sec) * 1'000'000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+      clockid_t peers_clock;
+      if( pthread_getcpuclockid( peers_thread.native_handle(), &peers_clock ) == 0 ) s.peers_us = thread_cpu_us( peers_clock );
+      s.self_us = thread_cpu_us( CLOCK_THREAD_CPUTIME_ID );
+      return s;
+   }
+
+   /// a port of the loopback interface that nothing listened on a moment ago
+   uint16_t free_port() {
+      boost::asio::io_context ctx;
+      tcp::acceptor acceptor( ctx, tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) );
+      return acceptor.local_endpoint().port();
+   }
+
+   /// distinct valid account names, prefix followed by the digits of n
+   name account_name_of( const std::string& prefix, uint64_t n ) {
+      static const char digits[] = "12345abcdefghijklmnopqrstuvwxyz";
+      std::string s = prefix;
+      for( size_t i = prefix.size(); i < 12; ++i, n /= 31 ) s += digits[n % 31];
+      return name( s );
+   }
+
+   /// creates account, signed by eosio whose key is that of the tester genesis
+   packed_transaction newaccount_transaction( name account, const block_id_type& reference, fc::time_point_sec expiration,
+                                              const chain_id_type& chain_id ) {
+      const auto key = base_tester::get_private_key( config::system_account_name, "active" );
+      const authority auth( key.get_public_key() );
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{ { config::system_account_name, config::active_name } },
+                                newaccount{ config::system_account_name, account, auth, auth } );
+      trx.expiration = expiration;
+      trx.set_reference_block( reference );
+      trx.sign( key, chain_id );
+      return packed_transaction( std::move( trx ) );
+   }
+
+   /// net_plugin, with chain_plugin and producer_plugin, running on its own thread from the blocks of genesis
+   class node {
+   public:
+      node( const fc::path& dir, const genesis_state& genesis, uint32_t peers ) : port( free_port() ) {
+         fc::create_directories( dir );
+         const auto genesis_file = dir / "genesis.json";
+         fc::json::save_to_file( genesis, genesis_file, true );
+         std::vector<std::string> args = {
+            "net_benchmarks",
+            "--data-dir", (dir / "data").generic_string(),
+            "--config-dir", (dir / "config").generic_string(),
+            "--genesis-json", genesis_file.generic_string(),
+            "--p2p-listen-endpoint", "127.0.0.1:" + std::to_string( port ),
+            // all from loopback, the sync peers possibly not yet seen closed when the relay ones connect
+            "--p2p-max-nodes-per-host", std::to_string( 2 * peers + 1 ),
+            "--max-clients", std::to_string( 2 * peers + 1 ),
+         };
+         std::vector<char*> argv;
+         for( auto& a : args ) argv.push_back( a.data() );
+         BOOST_REQUIRE( appbase::app().initialize<chain_plugin, net_plugin, producer_plugin>( argv.size(), argv.data() ) );
+
+         accepted_block = appbase::app().get_plugin<chain_plugin>().chain().accepted_block.connect( [this]( const block_state_ptr& bs ) {
+            std::lock_guard<std::mutex> g( mtx );
+            head_block_num = bs->block_num;
+            head_changed_at = steady::now();
+            cv.notify_all();
+         } );
+         appbase::app().startup();
+         thread = std::thread( []() { appbase::app().exec(); } );
+      }
+
+      ~node() {
+         appbase::app().quit();
+         thread.join();
+         accepted_block.disconnect();
+      }
+
+      tcp::endpoint endpoint()const {
+         return tcp::endpoint( boost::asio::ip::address_v4::loopback(), port );
+      }
+
+      /// @return when block_num was accepted, or nothing if it was not before deadline
+      std::optional<steady::time_point> wait_for_block( uint32_t block_num, steady::time_point deadline ) {
+         std::unique_lock<std::mutex> g( mtx );
+         if( !cv.wait_until( g, deadline, [this, block_num]() { return head_block_num >= block_num; } ) ) return {};
+         return head_changed_at;
+      }
+
+   private:
+      const uint16_t               port;
+      std::thread                  thread;
+      boost::signals2::connection  accepted_block;
+      std::mutex                   mtx;
+      std::condition_variable      cv;
+      uint32_t                     head_block_num = 0;
+      steady::time_point           head_changed_at;
+   };
+
+   /// the simulated peers and the thread running their io_context
+   class peer_network {
+   public:
+      explicit peer_network( const benchmark::net_config& net )
+      : net( net ), work( boost::asio::make_work_guard( ctx ) ), thread( [this]() { ctx.run(); } ) {}
+
+      ~peer_network() {
+         run( [this]() {
+            for( auto& p : peers ) p->close();
+         } );
+         work.reset();
+         ctx.stop();
+         thread.join();
+      }
+
+      /// connects a peer announcing it is at head, which calls on_message with the messages of the node
+      simulated_peer_ptr connect( const tcp::endpoint& node, const block_id_type& head, simulated_peer::message_handler on_message ) {
+         handshake_message hello;
+         hello.network_version = net_version_base + proto_compact_block;
+         hello.chain_id = chain_id;
+         fc::rand_pseudo_bytes( hello.node_id.data(), hello.node_id.data_size() );
+         namespace sc = std::chrono;
+         hello.time = sc::duration_cast<sc::nanoseconds>( sc::system_clock::now().time_since_epoch() ).count();
+         // unique, else the node takes the peers for duplicate connections
+         hello.p2p_address = "net-benchmark - " + hello.node_id.str().substr( 0, 7 );
+         hello.os = "linux";
+         hello.agent = "net-benchmark";
+         hello.generation = 1;
+         hello.head_num = hello.last_irreversible_block_num = block_header::num_from_id( head );
+         hello.head_id = hello.last_irreversible_block_id = head;
+
+         return run( [&]() {
+            auto peer = std::make_shared<simulated_peer>( ctx, std::chrono::milliseconds( net.latency_ms ),
+                                                          uint64_t( net.bandwidth_kib ) * 1024, std::move( on_message ) );
+            peer->connect( node, frame( hello ) );
+            peers.push_back( peer );
+            return peer;
+         } );
+      }
+
+      void close_all() {
+         run( [this]() {
+            for( auto& p : peers ) {
+               closed_messages += p->messages;
+               p->close();
+            }
+            peers.clear();
+         } );
+      }
+
+      /// f run on the peers thread, its result returned
+      template<typename F>
+      auto run( F&& f ) -> decltype( f() ) {
+         std::packaged_task<decltype( f() )()> task( std::forward<F>( f ) );
+         auto result = task.get_future();
+         boost::asio::post( ctx, [&task]() { task(); } );
+         return result.get();
+      }
+
+      /// messages of the peers so far, and the first error of a peer
+      std::pair<uint64_t, std::string> status() {
+         return run( [this]() {
+            std::pair<uint64_t, std::string> s{ closed_messages, {} };
+            for( const auto& p : peers ) {
+               s.first += p->messages;
+               if( s.second.empty() ) s.second = p->error;
+            }
+            return s;
+         } );
+      }
+
+      chain_id_type                    chain_id = chain_id_type::empty_chain_id();
+
+   private:
+      const benchmark::net_config&     net;
+      boost::asio::io_context          ctx;
+      boost::asio::executor_work_guard<boost::asio::io_context::executor_type>  work;
+      std::vector<simulated_peer_ptr>  peers;
+      uint64_t                         closed_messages = 0;  ///< of the peers closed
+
+   public:
+      std::thread                      thread;               ///< declared last, it runs ctx
+   };
+
+}
+
+FC_REFLECT( latency_summary, (count)(p50_us)(p90_us)(p99_us)(max_us) )
+FC_REFLECT( phase_report, (phase)(messages)(elapsed_us)(node_cpu_us)(cpu_us_per_message)(latency) )
+FC_REFLECT( net_report, (peers)(latency_ms)(bandwidth_kib)(recorded)(first_block)(last_block)(phases) )
+
+BOOST_AUTO_TEST_SUITE(net_benchmarks)
+
+// a single case, appbase runs the node once per process
+BOOST_AUTO_TEST_CASE( p2p ) { try {
+   const auto& net = benchmark::net();
+   const auto& replay = benchmark::replay();
+   BOOST_REQUIRE_MESSAGE( net.peers >= 2, "--net-peers must be at least 2, one relaying to the others" );
+   fc::temp_directory tempdir;
+   const auto timeout = std::chrono::seconds( net.timeout_sec );
+
+   // the blocks served and relayed, by number from first_block
+   std::vector<buffer_ptr> frames;
+   std::vector<block_id_type> ids;
+   uint32_t first_block = 2;
+   std::unique_ptr<tester> chain;
+   genesis_state genesis;
+   net_report report{ net.peers, net.latency_ms, net.bandwidth_kib, !replay.blocks_dir.empty() };
+   const auto add_block = [&]( const signed_block_ptr& b ) {
+      frames.push_back( frame( net_message( *b ) ) );
+      ids.push_back( b->calculate_id() );
+   };
+
+   if( !replay.blocks_dir.empty() ) {
+      const auto recorded_genesis = block_log::extract_genesis_state( replay.blocks_dir );
+      BOOST_REQUIRE_MESSAGE( recorded_genesis, "the block log does not start from genesis" );
+      genesis = *recorded_genesis;
+      block_log log( replay.blocks_dir );
+      BOOST_REQUIRE( log.head() );
+      const uint32_t last = replay.last_block ? std::min( replay.last_block, log.head()->block_num() ) : log.head()->block_num();
+      BOOST_REQUIRE_MESSAGE( last > first_block + net.relay_blocks, "the block log holds too few blocks to relay " << net.relay_blocks );
+      for( uint32_t num = first_block; num <= last; ++num ) {
+         const auto b = log.read_block_by_num( num );
+         BOOST_REQUIRE_MESSAGE( b, "block " << num << " is missing from the block log" );
+         add_block( b );
+      }
+   } else {
+      // ending about now, the node only speculates on transactions when its head block is recent
+      auto config = base_tester::default_config( tempdir ).first;
+      config.state_size = 1024ull * 1024 * 1024;
+      config.contracts_console = false;
+      genesis = base_tester::default_genesis();
+      genesis.initial_timestamp = fc::time_point( fc::time_point_sec( fc::time_point::now() ) )
+                                  - fc::milliseconds( config::block_interval_ms * (net.blocks + 2) );
+      chain = std::make_unique<tester>( config, genesis );
+      uint64_t accounts = 0;
+      for( uint32_t i = 0; i < net.blocks; ++i ) {
+         for( uint32_t t = 0; t < net.block_transactions; ++t ) {
+            auto trx = newaccount_transaction( account_name_of( "sync", accounts++ ), chain->control->head_block_id(),
+                                               chain->control->head_block_time() + fc::hours( 1 ), chain->control->get_chain_id() );
+            chain->push_transaction( trx );
+         }
+         add_block( chain->produce_block() );
+      }
+   }
+   const uint32_t sync_blocks = frames.size() - (chain ? 0 : net.relay_blocks);
+   const uint32_t sync_last = first_block + sync_blocks - 1;
+   report.first_block = first_block;
+
+   node n( tempdir.path() / "node", genesis, net.peers );
+   peer_network peers( net );
+   peers.chain_id = genesis.compute_chain_id();
+   const auto frame_of = [&]( uint32_t num ) { return frames.at( num - first_block ); };
+   const auto id_of = [&]( uint32_t num ) { return ids.at( num - first_block ); };
+
+   const auto measure_phase = [&]( const std::string& phase, auto&& f ) {
+      const auto cpu = sample_cpu( peers.thread );
+      const auto before = peers.status().first;
+      const auto start = steady::now();
+      phase_report r = f();
+      r.phase = phase;
+      if( r.elapsed_us == 0 ) r.elapsed_us = to_us( steady::now() - start );
+      const auto status = peers.status();
+      BOOST_REQUIRE_MESSAGE( status.second.empty(), phase << ": " << status.second );
+      const auto after = sample_cpu( peers.thread );
+      r.messages = status.first - before;
+      r.node_cpu_us = (after.process_us - cpu.process_us) - (after.peers_us - cpu.peers_us) - (after.self_us - cpu.self_us);
+      r.cpu_us_per_message = r.messages ? double( r.node_cpu_us ) / r.messages : 0.0;
+      report.phases.push_back( r );
+   };
+
+   // every peer serves the sync, the node requests its spans from them in turn
+   measure_phase( "sync", [&]() {
+      notice_message notice;
+      notice.known_trx.mode = last_irr_catch_up;
+      notice.known_trx.pending = sync_last;
+      notice.known_blocks.mode = last_irr_catch_up;
+      notice.known_blocks.pending = sync_last;
+      const auto notice_frame = frame( notice );
+      const auto serve = [&]( simulated_peer& peer, uint32_t which, fc::datastream<const char*>& ds ) {
+         if( which == handshake_which ) {
+            handshake_message hello;
+            fc::raw::unpack( ds, hello );
+            // as a node ahead of it, the node then asks for the blocks
+            if( hello.head_num < sync_last ) peer.send( notice_frame );
+         } else if( which == sync_request_which ) {
+            sync_request_message req;
+            fc::raw::unpack( ds, req );
+            for( uint32_t num = std::max( req.start_block, first_block ); num <= std::min( req.end_block, sync_last ); ++num ) {
+               peer.send( frame_of( num ) );
+            }
+         }
+      };
+      const auto start = steady::now();
+      for( uint32_t i = 0; i < net.peers; ++i ) peers.connect( n.endpoint(), id_of( sync_last ), serve );
+      const auto synced = n.wait_for_block( sync_last, start + timeout );
+      BOOST_REQUIRE_MESSAGE( synced, "the node did not sync to block " << sync_last << " in " << net.timeout_sec << "s" );
+      const auto elapsed = *synced - start;
+      benchmark::report( "net_sync", "block", sync_blocks, fc::microseconds( to_us( elapsed ) ) );
+      return phase_report{ {}, 0, to_us( elapsed ) };
+   } );
+   peers.close_all();
+
+   // the others take the blocks and transactions relayed by the node from the first
+   relay_tracker blocks_relayed;
+   relay_tracker trxs_relayed;
+   const auto receive = [&]( simulated_peer&, uint32_t which, fc::datastream<const char*>& ds ) {
+      if( which == signed_block_which || which == compact_block_which ) {
+         signed_block_header header; // both start with it
+         fc::raw::unpack( ds, header );
+         blocks_relayed.received( header.calculate_id() );
+      } else if( which == packed_transaction_which ) {
+         packed_transaction trx;
+         fc::raw::unpack( ds, trx );
+         trxs_relayed.received( trx.id() );
+      }
+   };
+   const auto ignore = []( simulated_peer&, uint32_t, fc::datastream<const char*>& ) {};
+   const uint32_t receivers = net.peers - 1;
+   const auto source = peers.connect( n.endpoint(), id_of( sync_last ), ignore );
+   for( uint32_t i = 0; i < receivers; ++i ) peers.connect( n.endpoint(), id_of( sync_last ), receive );
+   // the handshakes done, connections the node is not syncing from are current
+   std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) + 2 * std::chrono::milliseconds( net.latency_ms ) );
+
+   measure_phase( "block_relay", [&]() {
+      const uint32_t relay_count = chain ? net.relay_blocks : frames.size() - sync_blocks;
+      for( uint32_t i = 0; i < relay_count; ++i ) {
+         buffer_ptr block_frame;
+         block_id_type id;
+         if( chain ) {
+            // produced now, at most 5s ahead so that the node does not take it for a block from the future
+            const auto head_time = chain->control->head_block_time();
+            const auto next = head_time + fc::milliseconds( config::block_interval_ms );
+            const auto ahead = next - fc::time_point::now();
+            if( ahead > fc::seconds( 5 ) ) std::this_thread::sleep_for( std::chrono::microseconds( (ahead - fc::seconds( 5 )).count() ) );
+            const auto behind = fc::time_point::now() - head_time;
+            const int64_t slots = std::max<int64_t>( 1, behind.count() / (config::block_interval_ms * 1000) );
+            const auto b = chain->produce_block( fc::milliseconds( config::block_interval_ms * slots ) );
+            block_frame = frame( net_message( *b ) );
+            id = b->calculate_id();
+         } else {
+            block_frame = frame_of( sync_last + 1 + i );
+            id = id_of( sync_last + 1 + i );
+         }
+         peers.run( [&]() {
+            source->send( block_frame, [&blocks_relayed, id]() { blocks_relayed.sent( id ); } );
+         } );
+         BOOST_REQUIRE_MESSAGE( blocks_relayed.wait_for( uint64_t( receivers ) * (i + 1), steady::now() + timeout ),
+                                "block " << block_header::num_from_id( id ) << " was not relayed to all peers in " << net.timeout_sec << "s" );
+         report.last_block = block_header::num_from_id( id );
+      }
+      phase_report r;
+      r.latency = summarize( blocks_relayed.latencies_us );
+      return r;
+   } );
+
+   // recorded transactions are expired
+   if( chain && net.transactions ) {
+      std::vector<buffer_ptr> trx_frames;
+      std::vector<transaction_id_type> trx_ids;
+      for( uint32_t i = 0; i < net.transactions; ++i ) {
+         auto trx = newaccount_transaction( account_name_of( "flood", i ), chain->control->head_block_id(),
+                                            fc::time_point::now() + fc::minutes( 30 ), chain->control->get_chain_id() );
+         trx_ids.push_back( trx.id() );
+         trx_frames.push_back( frame( net_message( std::move( trx ) ) ) );
+      }
+      measure_phase( "transaction_relay", [&]() {
+         peers.run( [&]() {
+            for( uint32_t i = 0; i < trx_frames.size(); ++i ) {
+               source->send( trx_frames[i], [&trxs_relayed, id = trx_ids[i]]() { trxs_relayed.sent( id ); } );
+            }
+         } );
+         const uint64_t expected = uint64_t( receivers ) * net.transactions;
+         const bool relayed = trxs_relayed.wait_for( expected, steady::now() + timeout );
+         std::lock_guard<std::mutex> g( trxs_relayed.mtx );
+         BOOST_CHECK_MESSAGE( relayed, trxs_relayed.latencies_us.size() << " of " << expected << " transactions relayed in "
+                                       << net.timeout_sec << "s" );
+         phase_report r;
+         r.latency = summarize( trxs_relayed.latencies_us );
+         if( trxs_relayed.first_sent && !trxs_relayed.latencies_us.empty() ) {
+            r.elapsed_us = to_us( trxs_relayed.last_received - *trxs_relayed.first_sent );
+            benchmark::report( "net_transaction_relay", "transaction", trxs_relayed.latencies_us.size() / receivers,
+                               fc::microseconds( r.elapsed_us ) );
+         }
+         return r;
+      } );
+   }
+
+   const auto json = fc::json::to_string( report, fc::time_point::maximum() );
+   if( net.report_path.empty() ) {
+      std::cout << json << std::endl;
+   } else {
+      std::ofstream out( net.report_path );
+      out << json << std::endl;
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,154 @@
+#include "benchmark.hpp"
+
+#include <eosio/chain/block_log.hpp>
+#include <eosio/chain/snapshot.hpp>
+#include <eosio/testing/tester.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <queue>
+
+using namespace eosio;
+using namespace eosio::chain;
+using namespace eosio::testing;
+
+namespace {
+
+   struct block_timing {
+      uint32_t  block_num = 0;
+      uint32_t  transactions = 0;
+      int64_t   apply_us = 0;      ///< of pushing the block, validation included
+   };
+
+   struct transaction_timing {
+      transaction_id_type  id;
+      uint32_t             block_num = 0;
+      int64_t              elapsed_us = 0;
+      uint32_t             cpu_usage_us = 0;   ///< billed in the block
+      uint64_t             net_usage = 0;
+
+      bool operator>( const transaction_timing& other )const { return elapsed_us > other.elapsed_us; }
+   };
+
+   struct replay_report {
+      uint32_t                    first_block = 0;
+      uint32_t                    last_block = 0;
+      std::vector<block_timing>   blocks;
+      std::vector<transaction_timing>  slowest;   ///< slowest first
+   };
+
+   /// a chain applying the recorded blocks pushed to it
+   class replay_tester : public base_tester {
+   public:
+      replay_tester( const controller::config& config, const snapshot_reader_ptr& snapshot ) {
+         init( config, snapshot );
+      }
+
+      replay_tester( const controller::config& config, const genesis_state& genesis ) {
+         init( config, genesis );
+      }
+
+      signed_block_ptr produce_block( fc::microseconds skip_time = fc::milliseconds(config::block_interval_ms) )override {
+         return _produce_block(skip_time, false);
+      }
+
+      signed_block_ptr produce_empty_block( fc::microseconds skip_time = fc::milliseconds(config::block_interval_ms) )override {
+         control->abort_block();
+         return _produce_block(skip_time, true);
+      }
+
+      signed_block_ptr finish_block()override {
+         return _finish_block();
+      }
+   };
+
+}
+
+FC_REFLECT( block_timing, (block_num)(transactions)(apply_us) )
+FC_REFLECT( transaction_timing, (id)(block_num)(elapsed_us)(cpu_usage_us)(net_usage) )
+FC_REFLECT( replay_report, (first_block)(last_block)(blocks)(slowest) )
+
+BOOST_AUTO_TEST_SUITE(replay_benchmarks)
+
+BOOST_AUTO_TEST_CASE( replay ) { try {
+   const auto& replay = benchmark::replay();
+   if( replay.blocks_dir.empty() ) {
+      BOOST_TEST_MESSAGE( "no --replay-blocks given, nothing to replay" );
+      return;
+   }
+
+   fc::temp_directory tempdir;
+   auto config = base_tester::default_config( tempdir ).first;
+   config.state_size = replay.state_size_mb * 1024 * 1024;
+   config.contracts_console = false;
+
+   std::unique_ptr<replay_tester> chain;
+   if( !replay.snapshot.empty() ) {
+      std::ifstream in( replay.snapshot, std::ios::in | std::ios::binary );
+      BOOST_REQUIRE_MESSAGE( in.good(), "unable to open snapshot " << replay.snapshot );
+      chain = std::make_unique<replay_tester>( config, std::make_shared<istream_snapshot_reader>( in ) );
+   } else {
+      const auto genesis = block_log::extract_genesis_state( replay.blocks_dir );
+      BOOST_REQUIRE_MESSAGE( genesis, "the block log does not start from genesis, a --replay-snapshot is needed" );
+      chain = std::make_unique<replay_tester>( config, *genesis );
+   }
+
+   block_log log( replay.blocks_dir );
+   BOOST_REQUIRE( log.head() );
+   replay_report report;
+   report.first_block = chain->control->head_block_num() + 1;
+   report.last_block = replay.last_block ? std::min( replay.last_block, log.head()->block_num() ) : log.head()->block_num();
+   BOOST_REQUIRE_MESSAGE( report.first_block >= log.first_block_num() && report.first_block <= report.last_block,
+                          "the block log does not hold block " << report.first_block );
+
+   // the slowest transactions so far, the fastest of them on top
+   std::priority_queue<transaction_timing, std::vector<transaction_timing>, std::greater<transaction_timing>> slowest;
+   uint64_t transactions = 0;
+   auto applied = chain->control->applied_transaction.connect(
+      [&]( std::tuple<const transaction_trace_ptr&, const signed_transaction&> t ) {
+         const auto& trace = std::get<0>( t );
+         ++transactions;
+         if( replay.slowest == 0 ) return;
+         transaction_timing timing{ trace->id, trace->block_num, trace->elapsed.count(),
+                                    trace->receipt ? trace->receipt->cpu_usage_us : 0, trace->net_usage };
+         if( slowest.size() < replay.slowest ) {
+            slowest.push( timing );
+         } else if( timing > slowest.top() ) {
+            slowest.pop();
+            slowest.push( timing );
+         }
+      } );
+
+   report.blocks.reserve( report.last_block - report.first_block + 1 );
+   fc::microseconds total;
+   for( uint32_t num = report.first_block; num <= report.last_block; ++num ) {
+      const auto block = log.read_block_by_num( num );
+      BOOST_REQUIRE_MESSAGE( block, "block " << num << " is missing from the block log" );
+      const auto start = fc::time_point::now();
+      chain->push_block( block );
+      const auto elapsed = fc::time_point::now() - start;
+      total += elapsed;
+      report.blocks.push_back( block_timing{ num, static_cast<uint32_t>( block->transactions.size() ), elapsed.count() } );
+   }
+   applied.disconnect();
+
+   benchmark::report( "replay", "block", report.blocks.size(), total );
+   benchmark::report( "replay_transactions", "transaction", transactions, total );
+
+   for( ; !slowest.empty(); slowest.pop() ) report.slowest.push_back( slowest.top() );
+   std::reverse( report.slowest.begin(), report.slowest.end() );
+   const auto json = fc::json::to_string( report, fc::time_point::maximum() );
+   if( replay.report_path.empty() ) {
+      std::cout << json << std::endl;
+   } else {
+      std::ofstream out( replay.report_path );
+      out << json << std::endl;
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
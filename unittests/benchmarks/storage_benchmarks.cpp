@@ -0,0 +1,122 @@
+#include "benchmark.hpp"
+
+#include <eosio/chain/block_log.hpp>
+#include <eosio/chain/snapshot.hpp>
+#include <eosio/testing/tester.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+using namespace eosio;
+using namespace eosio::chain;
+using namespace eosio::testing;
+
+namespace {
+
+   /// a chain started from a snapshot
+   class snapshot_tester : public base_tester {
+   public:
+      snapshot_tester( const fc::temp_directory& tempdir, const snapshot_reader_ptr& snapshot ) {
+         init( default_config( tempdir ).first, snapshot );
+      }
+
+      signed_block_ptr produce_block( fc::microseconds skip_time = fc::milliseconds(config::block_interval_ms) )override {
+         return _produce_block(skip_time, false);
+      }
+
+      signed_block_ptr produce_empty_block( fc::microseconds skip_time = fc::milliseconds(config::block_interval_ms) )override {
+         control->abort_block();
+         return _produce_block(skip_time, true);
+      }
+
+      signed_block_ptr finish_block()override {
+         return _finish_block();
+      }
+
+      bool validate() { return true; }
+   };
+
+   /// create accounts accounts, each in a block of its own
+   void add_accounts( tester& chain, uint64_t accounts ) {
+      for( uint64_t i = 0; i < accounts; ++i ) {
+         std::string n = "bench";
+         for( uint64_t v = i; n.size() < 12; v /= 26 ) n += static_cast<char>( 'a' + v % 26 );
+         chain.create_account( name( n ) );
+         chain.produce_block();
+      }
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(storage_benchmarks)
+
+BOOST_AUTO_TEST_CASE( block_log_append_read ) { try {
+   tester chain;
+   add_accounts( chain, benchmark::iterations( 1000 ) );
+
+   // the blocks produced after the genesis block, which needs a genesis state to be appended
+   std::vector<signed_block_ptr> blocks;
+   for( uint32_t num = 2; num <= chain.control->head_block_num(); ++num ) {
+      blocks.emplace_back( chain.control->fetch_block_by_number( num ) );
+   }
+
+   fc::temp_directory tempdir;
+   block_log log( tempdir.path() );
+   log.reset( chain.control->get_chain_id(), blocks.front()->block_num() );
+
+   benchmark::measure( "block_log_append", "block", blocks.size(), [&]( uint64_t i ) {
+      log.append( blocks[i] );
+   } );
+   log.flush();
+
+   benchmark::measure( "block_log_read", "block", blocks.size(), [&]( uint64_t i ) {
+      BOOST_REQUIRE( log.read_block_by_num( blocks[i]->block_num() ) );
+   } );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_pack_unpack ) { try {
+   tester chain;
+   add_accounts( chain, benchmark::iterations( 1000 ) );
+
+   std::vector<signed_block_ptr> blocks;
+   for( uint32_t num = 2; num <= chain.control->head_block_num(); ++num ) {
+      blocks.emplace_back( chain.control->fetch_block_by_number( num ) );
+   }
+
+   std::vector<bytes> packed( blocks.size() );
+   benchmark::measure( "block_pack", "block", blocks.size(), [&]( uint64_t i ) {
+      packed[i] = fc::raw::pack( *blocks[i] );
+   } );
+
+   benchmark::measure( "block_unpack", "block", blocks.size(), [&]( uint64_t i ) {
+      fc::datastream<const char*> ds( packed[i].data(), packed[i].size() );
+      signed_block block;
+      fc::raw::unpack( ds, block );
+      BOOST_REQUIRE_EQUAL( block.block_num(), blocks[i]->block_num() );
+   } );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( snapshot_write_read ) { try {
+   tester chain;
+   add_accounts( chain, benchmark::iterations( 1000 ) );
+   chain.control->abort_block();
+
+   std::string snapshot;
+   benchmark::measure( "snapshot_write", "snapshot", benchmark::iterations( 20 ), [&]( uint64_t ) {
+      std::ostringstream out;
+      ostream_snapshot_writer writer( out );
+      chain.control->write_snapshot( std::shared_ptr<snapshot_writer>( &writer, []( snapshot_writer* ) {} ) );
+      writer.finalize();
+      snapshot = out.str();
+   } );
+
+   benchmark::measure( "snapshot_read", "snapshot", benchmark::iterations( 5 ), [&]( uint64_t ) {
+      std::istringstream in( snapshot );
+      fc::temp_directory tempdir;
+      snapshot_tester loaded( tempdir, std::make_shared<istream_snapshot_reader>( in ) );
+      BOOST_REQUIRE_EQUAL( loaded.control->head_block_num(), chain.control->head_block_num() );
+   } );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
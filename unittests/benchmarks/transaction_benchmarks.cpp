@@ -0,0 +1,193 @@
+#include "benchmark.hpp"
+
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/authorization_manager.hpp>
+#include <eosio/testing/tester.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <contracts.hpp>
+
+using namespace eosio;
+using namespace eosio::chain;
+using namespace eosio::testing;
+
+using mvo = fc::mutable_variant_object;
+
+namespace {
+
+   constexpr uint32_t transactions_per_block = 100;
+   constexpr uint32_t billed_cpu_time_us = 100;     ///< billed to each transaction so that a block holds transactions_per_block
+   constexpr uint32_t expiration_sec = 3000;        ///< transactions are signed ahead of the blocks they are pushed in
+
+   /// eosio.token deployed with alice holding all the tokens
+   class token_tester : public tester {
+   public:
+      token_tester() {
+         produce_blocks( 2 );
+
+         create_accounts( { N(alice), N(bob), N(eosio.token) } );
+         produce_blocks( 2 );
+
+         set_code( N(eosio.token), contracts::eosio_token_wasm() );
+         set_abi( N(eosio.token), contracts::eosio_token_abi().data() );
+         produce_block();
+
+         push_action( N(eosio.token), N(create), N(eosio.token), mvo()
+            ("issuer", "eosio.token")
+            ("maximum_supply", "1000000000.0000 TOK") );
+         push_action( N(eosio.token), N(issue), N(eosio.token), mvo()
+            ("to", "eosio.token")
+            ("quantity", "1000000000.0000 TOK")
+            ("memo", "") );
+         push_action( N(eosio.token), N(transfer), N(eosio.token), mvo()
+            ("from", "eosio.token")
+            ("to", "alice")
+            ("quantity", "1000000000.0000 TOK")
+            ("memo", "") );
+         produce_block();
+
+         abi_ser.set_abi( fc::json::from_string( contracts::eosio_token_abi().data() ).as<abi_def>(),
+                          abi_serializer::create_yield_function( abi_serializer_max_time ) );
+      }
+
+      fc::variant transfer_data( uint64_t n )const {
+         return mvo()
+            ("from", "alice")
+            ("to", "bob")
+            ("quantity", "0.0001 TOK")
+            ("memo", std::to_string( n ));
+      }
+
+      action transfer_action( uint64_t n )const {
+         return get_action( N(eosio.token), N(transfer), { {N(alice), config::active_name} }, transfer_data( n ).get_object() );
+      }
+
+      /// a transfer of alice signed by her, the memo makes it unique
+      signed_transaction signed_transfer( uint64_t n ) {
+         signed_transaction trx;
+         trx.actions.emplace_back( transfer_action( n ) );
+         set_transaction_headers( trx, expiration_sec );
+         trx.sign( get_private_key( N(alice), "active" ), control->get_chain_id() );
+         return trx;
+      }
+
+      abi_serializer abi_ser;
+   };
+
+   /// stores, finds, reads and removes rows_per_action rows of 8 bytes in each action
+   constexpr uint32_t rows_per_action = 100;
+   constexpr uint32_t intrinsics_per_action = 4 * rows_per_action;
+
+   const char db_i64_wast[] = R"=====(
+(module
+ (import "env" "db_store_i64" (func $db_store_i64 (param i64 i64 i64 i64 i32 i32) (result i32)))
+ (import "env" "db_find_i64" (func $db_find_i64 (param i64 i64 i64 i64) (result i32)))
+ (import "env" "db_get_i64" (func $db_get_i64 (param i32 i32 i32) (result i32)))
+ (import "env" "db_remove_i64" (func $db_remove_i64 (param i32)))
+ (memory 1)
+ (export "apply" (func $apply))
+ (func $apply (param $receiver i64) (param $account i64) (param $action i64)
+  (local $id i64)
+  (local $itr i32)
+  (block $stored
+   (loop $store
+    (br_if $stored (i64.eq (get_local $id) (i64.const 100)))
+    (drop (call $db_store_i64 (get_local $receiver) (i64.const 1) (get_local $receiver) (get_local $id) (i32.const 0) (i32.const 8)))
+    (set_local $id (i64.add (get_local $id) (i64.const 1)))
+    (br $store)
+   )
+  )
+  (set_local $id (i64.const 0))
+  (block $removed
+   (loop $remove
+    (br_if $removed (i64.eq (get_local $id) (i64.const 100)))
+    (set_local $itr (call $db_find_i64 (get_local $receiver) (get_local $receiver) (i64.const 1) (get_local $id)))
+    (drop (call $db_get_i64 (get_local $itr) (i32.const 16) (i32.const 8)))
+    (call $db_remove_i64 (get_local $itr))
+    (set_local $id (i64.add (get_local $id) (i64.const 1)))
+    (br $remove)
+   )
+  )
+ )
+)
+)=====";
+
+}
+
+BOOST_AUTO_TEST_SUITE(token_benchmarks)
+
+BOOST_FIXTURE_TEST_CASE( token_transfer, token_tester ) { try {
+   const uint64_t n = benchmark::iterations( 20000 );
+
+   std::vector<signed_transaction> trxs;
+   trxs.reserve( n );
+   for( uint64_t i = 0; i < n; ++i ) trxs.emplace_back( signed_transfer( i ) );
+
+   // pushing the transfers and producing the blocks holding them
+   const auto start = fc::time_point::now();
+   for( uint64_t i = 0; i < n; ++i ) {
+      push_transaction( trxs[i], fc::time_point::maximum(), billed_cpu_time_us );
+      if( (i + 1) % transactions_per_block == 0 ) produce_block();
+   }
+   produce_block();
+   benchmark::report( "token_transfer", "transfer", n, fc::time_point::now() - start );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( check_authorization, token_tester ) { try {
+   const vector<action> actions{ transfer_action( 0 ) };
+   const flat_set<public_key_type> keys{ get_public_key( N(alice), "active" ) };
+   const auto& authorization = control->get_authorization_manager();
+
+   benchmark::measure( "check_authorization", "transfer authorization", benchmark::iterations( 200000 ), [&]( uint64_t ) {
+      authorization.check_authorization( actions, keys );
+   } );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( abi_serializer_round_trip, token_tester ) { try {
+   const auto data = transfer_data( 0 );
+   const auto yield = abi_serializer::create_yield_function( abi_serializer_max_time );
+
+   benchmark::measure( "abi_serializer_round_trip", "transfer to binary and back", benchmark::iterations( 100000 ), [&]( uint64_t ) {
+      const auto bin = abi_ser.variant_to_binary( "transfer", data, yield );
+      const auto var = abi_ser.binary_to_variant( "transfer", bin, yield );
+      BOOST_REQUIRE( var.is_object() );
+   } );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(db_benchmarks)
+
+BOOST_FIXTURE_TEST_CASE( db_i64, tester ) { try {
+   produce_blocks( 2 );
+   create_accounts( { N(dbbench) } );
+   produce_block();
+   set_code( N(dbbench), db_i64_wast );
+   produce_block();
+
+   const uint64_t n = benchmark::iterations( 2000 );
+   std::vector<signed_transaction> trxs;
+   trxs.reserve( n );
+   for( uint64_t i = 0; i < n; ++i ) {
+      signed_transaction trx;
+      // the data is ignored by the contract, it makes each transaction unique
+      trx.actions.emplace_back( vector<permission_level>{{N(dbbench), config::active_name}}, N(dbbench), N(run), fc::raw::pack( i ) );
+      set_transaction_headers( trx, expiration_sec );
+      trx.sign( get_private_key( N(dbbench), "active" ), control->get_chain_id() );
+      trxs.emplace_back( std::move( trx ) );
+   }
+
+   const auto start = fc::time_point::now();
+   for( uint64_t i = 0; i < n; ++i ) {
+      push_transaction( trxs[i], fc::time_point::maximum(), billed_cpu_time_us );
+      if( (i + 1) % transactions_per_block == 0 ) produce_block();
+   }
+   produce_block();
+   benchmark::report( "db_i64", "db_*_i64 intrinsic", n * intrinsics_per_action, fc::time_point::now() - start );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,4 +1,5 @@
 #include <boost/test/unit_test.hpp>
+#include <eosio/chain/block_signee_cache.hpp>
 #include <eosio/testing/tester.hpp>
 
 using namespace eosio;
@@ -85,6 +86,24 @@ std::pair<signed_block_ptr, signed_block_ptr> corrupt_trx_in_block(validating_te
    return std::pair<signed_block_ptr, signed_block_ptr>(b, copy_b);
 }
 
+BOOST_AUTO_TEST_CASE(incremental_merkle_matches_merkle_test)
+{
+   // finalize_block builds the transaction and action merkles of a block incrementally
+   vector<digest_type> digests;
+   incremental_merkle accumulator;
+   BOOST_CHECK_EQUAL( merkle( digests ), accumulator.get_root() );
+   for( int i = 0; i < 70; ++i ) {
+      if( i > 0 ) {
+         const auto& l = digests.back();
+         const auto r = digest_type::hash( -i );
+         BOOST_CHECK_EQUAL( digest_type::hash( make_canonical_pair( l, r ) ), hash_canonical_pair( l, r ) );
+      }
+      digests.push_back( digest_type::hash( i ) );
+      accumulator.append( digests.back() );
+      BOOST_CHECK_EQUAL( merkle( digests ), accumulator.get_root() );
+   }
+}
+
 // verify that a block with a transaction with an incorrect signature, is blindly accepted from a trusted producer
 BOOST_AUTO_TEST_CASE(trusted_producer_test)
 {
@@ -281,4 +300,61 @@ BOOST_FIXTURE_TEST_CASE( abort_block_transactions_tester, validating_tester) { t
 
    } FC_LOG_AND_RETHROW() }
 
+/**
+ * Blocks whose key recovery was started ahead of apply, from other copies of the blocks, in any order and more than
+ * once, apply as usual
+ */
+BOOST_AUTO_TEST_CASE(block_recover_keys_ahead_test)
+{ try {
+   fc::temp_directory producer_dir;
+   fc::temp_directory receiving_dir;
+   tester producer_node( producer_dir, true );
+   tester receiving_node( receiving_dir, []( controller::config& cfg ) {
+      cfg.block_validation_pipeline_depth = 4;
+   }, true );
+
+   std::vector<signed_block_ptr> blocks;
+   for( auto a : { N(alice), N(bob), N(carol), N(dave), N(erin), N(frank) } ) {
+      producer_node.create_account( a );
+      blocks.push_back( producer_node.produce_block() );
+   }
+
+   // copies as received from other peers, the last ones beyond the pipeline window
+   for( auto itr = blocks.rbegin(); itr != blocks.rend(); ++itr ) {
+      receiving_node.control->start_block_recover_keys( std::make_shared<signed_block>( **itr ) );
+   }
+   receiving_node.control->start_block_recover_keys( std::make_shared<signed_block>( *blocks.front() ) );
+
+   for( const auto& b : blocks ) {
+      receiving_node.push_block( b );
+      receiving_node.control->start_block_recover_keys( b ); // already in the fork database
+   }
+   BOOST_CHECK_EQUAL( receiving_node.control->head_block_id(), producer_node.control->head_block_id() );
+   BOOST_CHECK( receiving_node.control->get_account( N(frank) ).name == N(frank) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(block_signee_cache_test)
+{ try {
+   tester main;
+   main.produce_block();
+   auto bsp = main.control->head_block_state();
+
+   // recovered once when the block was signed
+   auto& cache = block_signee_cache::instance();
+   const auto before = cache.get_stats();
+   auto keys = cache.recover( bsp->id, bsp->sig_digest(), bsp->header.producer_signature, bsp->additional_signatures );
+   BOOST_CHECK_EQUAL( before.hits + 1, cache.get_stats().hits );
+   BOOST_REQUIRE_EQUAL( 1u, keys.size() );
+   BOOST_CHECK( *keys.begin() == main.get_public_key( config::system_account_name, "active" ) );
+
+   // the same block id applied to another state is recovered again
+   const auto other_digest = digest_type::hash( std::string( "other state" ) );
+   auto other_keys = cache.recover( bsp->id, other_digest, bsp->header.producer_signature, bsp->additional_signatures );
+   BOOST_CHECK_EQUAL( before.misses + 1, cache.get_stats().misses );
+   BOOST_REQUIRE_EQUAL( 1u, other_keys.size() );
+   BOOST_CHECK( *other_keys.begin() != *keys.begin() );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
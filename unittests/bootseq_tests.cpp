@@ -280,7 +280,7 @@ BOOST_FIXTURE_TEST_CASE( bootseq_test, bootseq_tester ) {
 
         // No producers will be set, since the total activated stake is less than 150,000,000
         produce_blocks_for_n_rounds(2); // 2 rounds since new producer schedule is set when the first block of next round is irreversible
-        auto active_schedule = control->head_block_state()->active_schedule;
+        auto active_schedule = *control->head_block_state()->active_schedule;
         BOOST_TEST(active_schedule.producers.size() == 1u);
         BOOST_TEST(active_schedule.producers.front().producer_name == name("eosio"));
 
@@ -295,7 +295,7 @@ BOOST_FIXTURE_TEST_CASE( bootseq_test, bootseq_tester ) {
 
         // Since the total vote stake is more than 150,000,000, the new producer set will be set
         produce_blocks_for_n_rounds(2); // 2 rounds since new producer schedule is set when the first block of next round is irreversible
-        active_schedule = control->head_block_state()->active_schedule;
+        active_schedule = *control->head_block_state()->active_schedule;
         BOOST_REQUIRE(active_schedule.producers.size() == 21);
         BOOST_TEST(active_schedule.producers.at( 0).producer_name == name("proda"));
         BOOST_TEST(active_schedule.producers.at( 1).producer_name == name("prodb"));
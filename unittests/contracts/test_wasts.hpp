@@ -775,3 +775,53 @@ static const std::vector<uint8_t> varuint_memory_flags{
   0x07, 0x09, 0x01, 0x05, 'a', 'p', 'p', 'l', 'y', 0x00, 0x00, // exports
   0x0a, 0x04, 0x01, 0x02, 0x00, 0x0b // code
 };
+
+static const char int128_builtins_wast[] = R"=====(
+(module
+ (import "env" "__multi3" (func $__multi3 (param i32 i64 i64 i64 i64)))
+ (import "env" "__ashlti3" (func $__ashlti3 (param i32 i64 i64 i32)))
+ (import "env" "__lshlti3" (func $__lshlti3 (param i32 i64 i64 i32)))
+ (import "env" "__lshrti3" (func $__lshrti3 (param i32 i64 i64 i32)))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (memory 1)
+ (data (i32.const 0) "int128 mismatch\00")
+ (export "apply" (func $apply))
+ (func $check (param $ret i32) (param $low i64) (param $high i64)
+  (call $eosio_assert (i64.eq (i64.load (get_local $ret)) (get_local $low)) (i32.const 0))
+  (call $eosio_assert (i64.eq (i64.load offset=8 (get_local $ret)) (get_local $high)) (i32.const 0))
+ )
+ (func $apply (param $receiver i64) (param $account i64) (param $action i64)
+  ;; carry into the high half, signed wrap around, and a misaligned result
+  (call $__multi3 (i32.const 32) (i64.const -1) (i64.const 0) (i64.const 2) (i64.const 0))
+  (call $check (i32.const 32) (i64.const -2) (i64.const 1))
+  (call $__multi3 (i32.const 49) (i64.const -1) (i64.const -1) (i64.const -1) (i64.const -1))
+  (call $check (i32.const 49) (i64.const 1) (i64.const 0))
+  (call $__multi3 (i32.const 32) (i64.const 0) (i64.const 0x4000000000000000) (i64.const 4) (i64.const 0))
+  (call $check (i32.const 32) (i64.const 0) (i64.const 0))
+
+  (call $__ashlti3 (i32.const 32) (i64.const 1) (i64.const 0) (i32.const 64))
+  (call $check (i32.const 32) (i64.const 0) (i64.const 1))
+  (call $__lshlti3 (i32.const 32) (i64.const 1) (i64.const 0) (i32.const 127))
+  (call $check (i32.const 32) (i64.const 0) (i64.const 0x8000000000000000))
+  (call $__lshlti3 (i32.const 32) (i64.const 1) (i64.const 1) (i32.const 128))
+  (call $check (i32.const 32) (i64.const 0) (i64.const 0))
+  (call $__lshrti3 (i32.const 32) (i64.const 0) (i64.const 1) (i32.const 63))
+  (call $check (i32.const 32) (i64.const 2) (i64.const 0))
+  (call $__lshrti3 (i32.const 32) (i64.const -1) (i64.const -1) (i32.const 200))
+  (call $check (i32.const 32) (i64.const 0) (i64.const 0))
+ )
+)
+)=====";
+
+static const char current_receiver_wast[] = R"=====(
+(module
+ (import "env" "current_receiver" (func $current_receiver (result i64)))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (memory 1)
+ (data (i32.const 0) "receiver mismatch\00")
+ (export "apply" (func $apply))
+ (func $apply (param $receiver i64) (param $account i64) (param $action i64)
+  (call $eosio_assert (i64.eq (call $current_receiver) (get_local $receiver)) (i32.const 0))
+ )
+)
+)=====";
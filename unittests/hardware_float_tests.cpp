@@ -0,0 +1,134 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/webassembly/hardware_float.hpp>
+
+#include <softfloat.hpp>
+
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace eosio::chain;
+
+namespace {
+
+   template<typename To, typename From>
+   To bit_cast( const From& f ) {
+      static_assert( sizeof(To) == sizeof(From), "bit_cast of different sizes" );
+      To t;
+      std::memcpy( &t, &f, sizeof(t) );
+      return t;
+   }
+
+   std::vector<uint32_t> f32_inputs() {
+      std::vector<uint32_t> v = {
+         0x00000000, 0x80000000,             // zeros
+         0x7f800000, 0xff800000,             // infinities
+         0x7fc00000, 0xffc00000, 0x7f800001, // NaNs, quiet and signaling
+         0x00000001, 0x80000001, 0x007fffff, // subnormals
+         0x00800000, 0x7f7fffff, 0xff7fffff, // smallest normal, largest finite
+         0x3f800000, 0xbf800000, 0x40490fdb, // 1, -1, pi
+         0x3f7fffff, 0x3f800001, 0x34000000  // around 1, epsilon
+      };
+      std::mt19937 gen( 42 );
+      for( int i = 0; i < 500; ++i ) v.push_back( gen() );
+      return v;
+   }
+
+   std::vector<uint64_t> f64_inputs() {
+      std::vector<uint64_t> v = {
+         0x0000000000000000ull, 0x8000000000000000ull,
+         0x7ff0000000000000ull, 0xfff0000000000000ull,
+         0x7ff8000000000000ull, 0xfff8000000000000ull, 0x7ff0000000000001ull,
+         0x0000000000000001ull, 0x8000000000000001ull, 0x000fffffffffffffull,
+         0x0010000000000000ull, 0x7fefffffffffffffull, 0xffefffffffffffffull,
+         0x3ff0000000000000ull, 0xbff0000000000000ull, 0x400921fb54442d18ull,
+         0x3fefffffffffffffull, 0x3ff0000000000001ull, 0x3cb0000000000000ull
+      };
+      std::mt19937_64 gen( 42 );
+      for( int i = 0; i < 500; ++i ) v.push_back( gen() );
+      return v;
+   }
+
+   /// a result of the hardware path must be the bits of softfloat's
+   template<typename HW, typename SF>
+   void check_f32( uint32_t a, uint32_t b, HW&& hw, SF&& sf, const char* op ) {
+      float r;
+      if( !hw( bit_cast<float>( a ), bit_cast<float>( b ), r ) ) return;
+      const uint32_t expected = sf( float32_t{a}, float32_t{b} ).v;
+      BOOST_CHECK_MESSAGE( bit_cast<uint32_t>( r ) == expected,
+                           op << " " << std::hex << a << " " << b << ": " << bit_cast<uint32_t>( r ) << " != " << expected );
+   }
+
+   template<typename HW, typename SF>
+   void check_f64( uint64_t a, uint64_t b, HW&& hw, SF&& sf, const char* op ) {
+      double r;
+      if( !hw( bit_cast<double>( a ), bit_cast<double>( b ), r ) ) return;
+      const uint64_t expected = sf( float64_t{a}, float64_t{b} ).v;
+      BOOST_CHECK_MESSAGE( bit_cast<uint64_t>( r ) == expected,
+                           op << " " << std::hex << a << " " << b << ": " << bit_cast<uint64_t>( r ) << " != " << expected );
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(hardware_float_tests)
+
+BOOST_AUTO_TEST_CASE( f32_matches_softfloat ) {
+   const auto inputs = f32_inputs();
+   for( uint32_t a : inputs ) {
+      for( uint32_t b : inputs ) {
+         check_f32( a, b, hardware_float::f32_add, ::f32_add, "f32_add" );
+         check_f32( a, b, hardware_float::f32_sub, ::f32_sub, "f32_sub" );
+         check_f32( a, b, hardware_float::f32_mul, ::f32_mul, "f32_mul" );
+         check_f32( a, b, hardware_float::f32_div, ::f32_div, "f32_div" );
+      }
+      float r;
+      if( hardware_float::f32_sqrt( bit_cast<float>( a ), r ) ) {
+         BOOST_CHECK_EQUAL( bit_cast<uint32_t>( r ), ::f32_sqrt( float32_t{a} ).v );
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE( f64_matches_softfloat ) {
+   const auto inputs = f64_inputs();
+   for( uint64_t a : inputs ) {
+      for( uint64_t b : inputs ) {
+         check_f64( a, b, hardware_float::f64_add, ::f64_add, "f64_add" );
+         check_f64( a, b, hardware_float::f64_sub, ::f64_sub, "f64_sub" );
+         check_f64( a, b, hardware_float::f64_mul, ::f64_mul, "f64_mul" );
+         check_f64( a, b, hardware_float::f64_div, ::f64_div, "f64_div" );
+      }
+      double r;
+      if( hardware_float::f64_sqrt( bit_cast<double>( a ), r ) ) {
+         BOOST_CHECK_EQUAL( bit_cast<uint64_t>( r ), ::f64_sqrt( float64_t{a} ).v );
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE( nan_results_left_to_softfloat ) {
+   float f;
+   BOOST_CHECK( !hardware_float::f32_add( std::numeric_limits<float>::quiet_NaN(), 1.0f, f ) );
+   BOOST_CHECK( !hardware_float::f32_sub( std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), f ) );
+   BOOST_CHECK( !hardware_float::f32_sqrt( -1.0f, f ) );
+   double d;
+   BOOST_CHECK( !hardware_float::f64_mul( 0.0, std::numeric_limits<double>::infinity(), d ) );
+   BOOST_CHECK( !hardware_float::f64_div( 0.0, 0.0, d ) );
+   BOOST_CHECK( !hardware_float::f64_sqrt( -1.0, d ) );
+}
+
+#if defined(__SSE2_MATH__)
+BOOST_AUTO_TEST_CASE( non_default_mxcsr_left_to_softfloat ) {
+   BOOST_REQUIRE( hardware_float::enabled() );
+   const unsigned int csr = _mm_getcsr();
+   _mm_setcsr( csr | 0x8040 ); // flush to zero, denormals are zero
+   float f;
+   double d;
+   const bool used = hardware_float::enabled() || hardware_float::f32_add( 1.0f, 2.0f, f ) || hardware_float::f64_add( 1.0, 2.0, d );
+   _mm_setcsr( csr );
+   BOOST_CHECK( !used );
+   BOOST_CHECK( hardware_float::f32_add( 1.0f, 2.0f, f ) );
+   BOOST_CHECK_EQUAL( 3.0f, f );
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,71 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/metrics.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+namespace {
+   std::string written() {
+      std::ostringstream out;
+      write_prometheus_metrics( out );
+      return out.str();
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(metrics_tests)
+
+BOOST_AUTO_TEST_CASE( counter_sums_threads ) {
+   metric_counter counter( "test_counter_total", "Counted by the test" );
+   std::vector<std::thread> threads;
+   for( int t = 0; t < 8; ++t ) {
+      threads.emplace_back( [&counter]() { for( int i = 0; i < 10000; ++i ) counter.add(); } );
+   }
+   for( auto& t : threads ) t.join();
+   BOOST_CHECK_EQUAL( 80000u, counter.value() );
+
+   const auto out = written();
+   BOOST_CHECK( out.find( "# HELP test_counter_total Counted by the test\n"
+                          "# TYPE test_counter_total counter\n"
+                          "test_counter_total 80000\n" ) != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( gauge_and_histogram ) {
+   metric_gauge gauge( "test_gauge", "Set by the test" );
+   gauge.set( 10 );
+   gauge.add( -3 );
+   BOOST_CHECK_EQUAL( 7, gauge.value() );
+
+   metric_histogram histogram( "test_histogram", "Observed by the test", { 10, 100 } );
+   histogram.observe( 5 );
+   histogram.observe( 10 );
+   histogram.observe( 50 );
+   histogram.observe( 1000 );
+
+   const auto out = written();
+   BOOST_CHECK( out.find( "test_gauge 7\n" ) != std::string::npos );
+   BOOST_CHECK( out.find( "# TYPE test_histogram histogram\n"
+                          "test_histogram_bucket{le=\"10\"} 2\n"
+                          "test_histogram_bucket{le=\"100\"} 3\n"
+                          "test_histogram_bucket{le=\"+Inf\"} 4\n"
+                          "test_histogram_sum 1065\n"
+                          "test_histogram_count 4\n" ) != std::string::npos );
+   // in the order of the names
+   BOOST_CHECK( out.find( "test_gauge" ) < out.find( "test_histogram" ) );
+}
+
+BOOST_AUTO_TEST_CASE( registered_for_lifetime ) {
+   {
+      metric_counter counter( "test_scoped_total", "Counted by the test" );
+      BOOST_CHECK_THROW( metric_counter( "test_scoped_total", "Counted twice" ), misc_exception );
+      BOOST_CHECK( written().find( "test_scoped_total" ) != std::string::npos );
+   }
+   BOOST_CHECK( written().find( "test_scoped_total" ) == std::string::npos );
+   metric_counter again( "test_scoped_total", "Counted by the test" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,7 @@
 #include <eosio/chain/asset.hpp>
 #include <eosio/chain/authority.hpp>
 #include <eosio/chain/authority_checker.hpp>
+#include <eosio/chain/signature_recovery_cache.hpp>
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/thread_utils.hpp>
 #include <eosio/testing/tester.hpp>
@@ -756,6 +757,19 @@ BOOST_AUTO_TEST_CASE(transaction_test) { try {
    BOOST_CHECK_EQUAL(pkt.get_signed_transaction().id(), pkt2.get_signed_transaction().id());
    BOOST_CHECK_EQUAL(pkt.get_signed_transaction().id(), pkt2.id());
 
+#ifdef EOSIO_ZSTD_COMPRESSION_ENABLED
+   packed_transaction pkt_zstd(trx, packed_transaction::compression_type::zstd);
+   BOOST_CHECK_EQUAL(trx.id(), pkt_zstd.id());
+   bytes raw_zstd = pkt_zstd.get_raw_transaction();
+   BOOST_CHECK_EQUAL(raw.size(), raw_zstd.size());
+   BOOST_CHECK_EQUAL(true, std::equal(raw.begin(), raw.end(), raw_zstd.begin()));
+   bytes truncated( pkt_zstd.get_packed_transaction().begin(), pkt_zstd.get_packed_transaction().end() - 1 );
+   BOOST_CHECK_THROW( packed_transaction( std::move(truncated), vector<signature_type>(trx.signatures), bytes(),
+                                          packed_transaction::compression_type::zstd ), tx_decompression_error );
+#else
+   BOOST_CHECK_THROW( packed_transaction(trx, packed_transaction::compression_type::zstd), unknown_transaction_compression );
+#endif
+
    flat_set<public_key_type> keys;
    auto cpu_time1 = pkt.get_signed_transaction().get_signature_keys(test.control->get_chain_id(), fc::time_point::maximum(), keys);
    BOOST_CHECK_EQUAL(1u, keys.size());
@@ -808,6 +822,13 @@ BOOST_AUTO_TEST_CASE(transaction_test) { try {
    BOOST_CHECK_EQUAL(1u, keys.size());
    BOOST_CHECK_EQUAL(public_key, *keys.begin());
 
+   // copies share the unpacked transaction
+   packed_transaction pkt6(pkt4);
+   BOOST_CHECK(pkt6.shares_unpacked(pkt4));
+   BOOST_CHECK(!pkt3.shares_unpacked(pkt4));
+   BOOST_CHECK_EQUAL(pkt4.id(), pkt6.id());
+   BOOST_CHECK(pkt4 == pkt6);
+
 } FC_LOG_AND_RETHROW() }
 
 
@@ -839,6 +860,34 @@ BOOST_AUTO_TEST_CASE(signed_int_test) { try {
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE(permission_level_pack_test) { try {
+   const vector<permission_level> auths{ {N(alice), N(active)}, {N(bob), N(owner)}, {N(carol), N(custom)} };
+
+   // the same bytes as packing the names one by one
+   bytes expected = fc::raw::pack( fc::unsigned_int( 3 ) );
+   for( const auto& a : auths ) {
+      for( const auto& n : { a.actor, a.permission } ) {
+         const bytes packed = fc::raw::pack( n );
+         expected.insert( expected.end(), packed.begin(), packed.end() );
+      }
+   }
+   const bytes packed = fc::raw::pack( auths );
+   BOOST_CHECK_EQUAL( fc::raw::pack_size( auths ), expected.size() );
+   BOOST_CHECK( packed == expected );
+   BOOST_CHECK( fc::raw::unpack<vector<permission_level>>( packed ) == auths );
+   BOOST_CHECK( fc::raw::unpack<permission_level>( fc::raw::pack( auths[1] ) ) == auths[1] );
+
+   const action act( auths, N(eosio.token), N(transfer), bytes{ 'a', 'b' } );
+   const auto act2 = fc::raw::unpack<action>( fc::raw::pack( act ) );
+   BOOST_CHECK( act2.authorization == auths );
+   BOOST_CHECK( act2.data == act.data );
+
+   // a size larger than the data left is rejected before allocating for it
+   bytes truncated( packed.begin(), packed.end() - 1 );
+   BOOST_CHECK_THROW( fc::raw::unpack<vector<permission_level>>( truncated ), fc::assert_exception );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE(transaction_metadata_test) { try {
 
    testing::TESTER test;
@@ -912,10 +961,45 @@ BOOST_AUTO_TEST_CASE(transaction_metadata_test) { try {
       BOOST_CHECK_EQUAL(1u, keys3.size());
       BOOST_CHECK_EQUAL(public_key, *keys3.begin());
 
+      // batch recovery, duplicate transactions recovered once
+      auto batch = transaction_metadata::start_recover_keys( {ptrx, ptrx2, ptrx, ptrx2}, thread_pool.get_executor(),
+                                                             test.control->get_chain_id(), fc::microseconds::maximum(), 3 );
+      BOOST_REQUIRE_EQUAL(4u, batch.size());
+      for( size_t i = 0; i < batch.size(); ++i ) {
+         const auto& bkeys = batch.get( i )->recovered_keys();
+         BOOST_CHECK_EQUAL(1u, bkeys.size());
+         BOOST_CHECK_EQUAL(public_key, *bkeys.begin());
+         BOOST_CHECK_EQUAL(trx.id(), batch.get( i )->id());
+      }
+      BOOST_CHECK( batch.get( 0 ) == batch.get( 2 ) );
+      BOOST_CHECK( batch.get( 1 ) == batch.get( 3 ) );
+
       thread_pool.stop();
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE(signature_recovery_cache_test) { try {
+   auto private_key = fc::crypto::private_key::generate();
+   const auto digest = digest_type::hash( std::string( "signature_recovery_cache_test" ) );
+   const auto sig = private_key.sign( digest );
+
+   auto& cache = signature_recovery_cache::instance();
+   const auto before = cache.get_stats();
+   BOOST_CHECK_EQUAL( private_key.get_public_key(), cache.recover( sig, digest ) );
+   BOOST_CHECK_EQUAL( before.misses + 1, cache.get_stats().misses );
+
+   // a key recovered with the canonical check is returned to a recovery without it
+   BOOST_CHECK_EQUAL( private_key.get_public_key(), cache.recover( sig, digest, false ) );
+   BOOST_CHECK_EQUAL( private_key.get_public_key(), cache.recover( sig, digest ) );
+   BOOST_CHECK_EQUAL( before.hits + 2, cache.get_stats().hits );
+
+   // another digest is another key
+   const auto other_digest = digest_type::hash( std::string( "other digest" ) );
+   BOOST_CHECK( public_key_type( sig, other_digest ) == cache.recover( sig, other_digest ) );
+   BOOST_CHECK( private_key.get_public_key() != cache.recover( sig, other_digest ) );
+   BOOST_CHECK_EQUAL( before.misses + 2, cache.get_stats().misses );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE(reflector_init_test) {
    try {
 
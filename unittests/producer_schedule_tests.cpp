@@ -37,7 +37,7 @@ BOOST_AUTO_TEST_SUITE(producer_schedule_tests)
    // However, it won't be applied until the effective block num is deemed irreversible
    uint64_t calc_block_num_of_next_round_first_block(const controller& control){
       auto res = control.head_block_num() + 1;
-      const auto blocks_per_round = control.head_block_state()->active_schedule.producers.size() * config::producer_repetitions;
+      const auto blocks_per_round = control.head_block_state()->active_schedule->producers.size() * config::producer_repetitions;
       while((res % blocks_per_round) != 0) {
          res++;
       }
@@ -50,7 +50,7 @@ BOOST_AUTO_TEST_SUITE(producer_schedule_tests)
       const auto& confirm_schedule_correctness = [&](const vector<producer_key>& new_prod_schd, const uint64_t eff_new_prod_schd_block_num)  {
          const uint32_t check_duration = 1000; // number of blocks
          for (uint32_t i = 0; i < check_duration; ++i) {
-            const auto current_schedule = control->head_block_state()->active_schedule.producers;
+            const auto current_schedule = control->head_block_state()->active_schedule->producers;
             const auto& current_absolute_slot = control->get_global_properties().proposed_schedule_block_num;
             // Determine expected producer
             const auto& expected_producer = get_expected_producer(current_schedule, *current_absolute_slot + 1);
@@ -264,6 +264,35 @@ BOOST_FIXTURE_TEST_CASE( producer_schedule_promotion_test, TESTER ) try {
    BOOST_REQUIRE_EQUAL( validate(), true );
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( producer_schedule_shared_between_blocks, TESTER ) try {
+   create_accounts( {N(alice),N(bob)} );
+   produce_block();
+   set_producers( {N(alice),N(bob)} );
+
+   // a block header state shares the schedules of the previous one unless they changed
+   bool promoted = false;
+   auto prev = control->head_block_state();
+   for( int i = 0; i < 12; ++i ) {
+      produce_block();
+      const auto head = control->head_block_state();
+      if( head->active_schedule->version == prev->active_schedule->version ) {
+         BOOST_CHECK( head->active_schedule.shares( prev->active_schedule ) );
+      } else {
+         BOOST_CHECK( head->active_schedule.shares( prev->pending_schedule.schedule ) );
+         promoted = true;
+      }
+      if( head->pending_schedule.schedule->version == prev->pending_schedule.schedule->version &&
+          head->pending_schedule.schedule->producers.size() == prev->pending_schedule.schedule->producers.size() ) {
+         BOOST_CHECK( head->pending_schedule.schedule.shares( prev->pending_schedule.schedule ) );
+      }
+      prev = head;
+   }
+   BOOST_CHECK( promoted );
+   BOOST_CHECK_EQUAL( 2u, control->active_producers().producers.size() );
+
+   BOOST_REQUIRE_EQUAL( validate(), true );
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE( producer_schedule_reduction, tester ) try {
    create_accounts( {N(alice),N(bob),N(carol)} );
    while (control->head_block_num() < 3) {
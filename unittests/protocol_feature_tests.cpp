@@ -160,6 +160,43 @@ BOOST_AUTO_TEST_CASE( double_activation ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_AUTO_TEST_CASE( activated_builtins_bitset ) try {
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+   const auto& pfm = c.control->get_protocol_feature_manager();
+
+   // the bitset must agree with the activation block numbers, with and without a pending block
+   auto check = [&]( bool pending ) {
+      const uint32_t current_block_num = c.control->head_block_num() + (pending ? 1 : 0);
+      for( const auto& f : builtin_protocol_feature_codenames ) {
+         BOOST_CHECK_EQUAL( pfm.is_builtin_activated( f.first, current_block_num ), c.control->is_builtin_activated( f.first ) );
+      }
+   };
+   check( true );
+
+   auto d = pfm.get_builtin_digest( builtin_protocol_feature_t::only_link_to_existing_permission );
+   BOOST_REQUIRE( d );
+   c.preactivate_protocol_features( {*d} );
+   c.produce_block();
+   check( true );
+   BOOST_CHECK( c.control->is_builtin_activated( builtin_protocol_feature_t::only_link_to_existing_permission ) );
+   BOOST_CHECK( pfm.activated_builtins().test( static_cast<size_t>( builtin_protocol_feature_t::only_link_to_existing_permission ) ) );
+
+   // scheduled for the pending block and rolled back with it
+   auto d2 = pfm.get_builtin_digest( builtin_protocol_feature_t::replace_deferred );
+   BOOST_REQUIRE( d2 );
+   c.preactivate_protocol_features( {*d2} );
+   c.produce_block();
+   c.control->abort_block();
+   c.control->start_block( c.control->head_block_time() + fc::milliseconds(config::block_interval_ms), 0, {*d2} );
+   check( true );
+   BOOST_CHECK( c.control->is_builtin_activated( builtin_protocol_feature_t::replace_deferred ) );
+   c.control->abort_block();
+   check( false );
+   BOOST_CHECK( !c.control->is_builtin_activated( builtin_protocol_feature_t::replace_deferred ) );
+   BOOST_CHECK( c.control->is_builtin_activated( builtin_protocol_feature_t::only_link_to_existing_permission ) );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_CASE( require_preactivation_test ) try {
    tester c( setup_policy::preactivate_feature_and_new_bios );
    const auto& pfm = c.control->get_protocol_feature_manager();
@@ -1058,6 +1095,227 @@ BOOST_AUTO_TEST_CASE( get_sender_test ) { try {
    );
 } FC_LOG_AND_RETHROW() }
 
+static const char batched_db_reads_wast[] = R"=====(
+(module
+ (import "env" "db_store_i64" (func $db_store_i64 (param i64 i64 i64 i64 i32 i32) (result i32)))
+ (import "env" "db_lowerbound_i64" (func $db_lowerbound_i64 (param i64 i64 i64 i64) (result i32)))
+ (import "env" "db_end_i64" (func $db_end_i64 (param i64 i64 i64) (result i32)))
+ (import "env" "db_get_range_i64" (func $db_get_range_i64 (param i32 i32 i32 i32 i32) (result i32)))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (memory 1)
+ (data (i32.const 0) "ab")
+ (data (i32.const 16) "range mismatch\00")
+ (export "apply" (func $apply))
+ (func $apply (param $receiver i64) (param $account i64) (param $action i64)
+  (local $itr i32)
+  (drop (call $db_store_i64 (get_local $receiver) (i64.const 1) (get_local $receiver) (i64.const 1) (i32.const 0) (i32.const 1)))
+  (drop (call $db_store_i64 (get_local $receiver) (i64.const 1) (get_local $receiver) (i64.const 2) (i32.const 0) (i32.const 2)))
+  (drop (call $db_store_i64 (get_local $receiver) (i64.const 1) (get_local $receiver) (i64.const 3) (i32.const 0) (i32.const 0)))
+  (set_local $itr (call $db_lowerbound_i64 (get_local $receiver) (get_local $receiver) (i64.const 1) (i64.const 0)))
+
+  ;; nothing is copied when the first row does not fit, the next iterator is the one passed
+  (call $eosio_assert (i32.eqz (call $db_get_range_i64 (get_local $itr) (i32.const 48) (i32.const 64) (i32.const 12) (i32.const 10))) (i32.const 16))
+  (call $eosio_assert (i32.eq (i32.load (i32.const 48)) (get_local $itr)) (i32.const 16))
+
+  ;; primary key, value size and value of rows 1 and 2
+  (call $eosio_assert (i32.eq (call $db_get_range_i64 (get_local $itr) (i32.const 48) (i32.const 64) (i32.const 100) (i32.const 2)) (i32.const 2)) (i32.const 16))
+  (call $eosio_assert (i64.eq (i64.load (i32.const 64)) (i64.const 1)) (i32.const 16))
+  (call $eosio_assert (i32.eq (i32.load (i32.const 72)) (i32.const 1)) (i32.const 16))
+  (call $eosio_assert (i32.eq (i32.load8_u (i32.const 76)) (i32.const 0x61)) (i32.const 16))
+  (call $eosio_assert (i64.eq (i64.load (i32.const 77)) (i64.const 2)) (i32.const 16))
+  (call $eosio_assert (i32.eq (i32.load (i32.const 85)) (i32.const 2)) (i32.const 16))
+  (call $eosio_assert (i32.eq (i32.load16_u (i32.const 89)) (i32.const 0x6261)) (i32.const 16))
+
+  ;; the rest of the table, after which the next iterator is the end iterator
+  (call $eosio_assert (i32.eq (call $db_get_range_i64 (i32.load (i32.const 48)) (i32.const 48) (i32.const 64) (i32.const 100) (i32.const 10)) (i32.const 1)) (i32.const 16))
+  (call $eosio_assert (i64.eq (i64.load (i32.const 64)) (i64.const 3)) (i32.const 16))
+  (call $eosio_assert (i32.eqz (i32.load (i32.const 72))) (i32.const 16))
+  (call $eosio_assert (i32.eq (i32.load (i32.const 48)) (call $db_end_i64 (get_local $receiver) (get_local $receiver) (i64.const 1))) (i32.const 16))
+ )
+)
+)=====";
+
+BOOST_AUTO_TEST_CASE( batched_db_reads_test ) { try {
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+
+   const auto& tester1_account = account_name("tester1");
+   c.create_accounts( {tester1_account} );
+   c.produce_block();
+
+   BOOST_CHECK_EXCEPTION(  c.set_code( tester1_account, batched_db_reads_wast ),
+                           wasm_exception,
+                           fc_exception_message_is( "env.db_get_range_i64 unresolveable" ) );
+
+   const auto& pfm = c.control->get_protocol_feature_manager();
+   const auto& d = pfm.get_builtin_digest( builtin_protocol_feature_t::batched_db_reads );
+   BOOST_REQUIRE( d );
+
+   c.preactivate_protocol_features( {*d} );
+   c.produce_block();
+
+   c.set_code( tester1_account, batched_db_reads_wast );
+   c.produce_block();
+
+   signed_transaction trx;
+   trx.actions.emplace_back( vector<permission_level>{{tester1_account, config::active_name}}, tester1_account, name(), bytes{} );
+   c.set_transaction_headers( trx );
+   trx.sign( c.get_private_key( tester1_account, "active" ), c.control->get_chain_id() );
+   c.push_transaction( trx );
+   c.produce_block();
+
+   BOOST_REQUIRE_EQUAL( true, c.chain_has_transaction( trx.id() ) );
+} FC_LOG_AND_RETHROW() }
+
+static const char kv_database_wast[] = R"=====(
+(module
+ (import "env" "kv_set" (func $kv_set (param i32 i32 i32 i32 i64)))
+ (import "env" "kv_erase" (func $kv_erase (param i32 i32) (result i32)))
+ (import "env" "kv_get" (func $kv_get (param i64 i32 i32 i32 i32) (result i32)))
+ (import "env" "kv_it_create" (func $kv_it_create (param i64 i32 i32) (result i32)))
+ (import "env" "kv_it_destroy" (func $kv_it_destroy (param i32)))
+ (import "env" "kv_it_lower_bound" (func $kv_it_lower_bound (param i32 i32 i32) (result i32)))
+ (import "env" "kv_it_next" (func $kv_it_next (param i32) (result i32)))
+ (import "env" "kv_it_prev" (func $kv_it_prev (param i32) (result i32)))
+ (import "env" "kv_it_key" (func $kv_it_key (param i32 i32 i32) (result i32)))
+ (import "env" "kv_it_value" (func $kv_it_value (param i32 i32 i32) (result i32)))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (memory 1)
+ (data (i32.const 0) "a1a2b1")
+ (data (i32.const 16) "kv mismatch\00")
+ (data (i32.const 32) "xyz")
+ (export "apply" (func $apply))
+ (func $apply (param $receiver i64) (param $account i64) (param $action i64)
+  (local $itr i32)
+  ;; a1 = x, a2 = yz, b1 = xyz, a = empty
+  (call $kv_set (i32.const 0) (i32.const 2) (i32.const 32) (i32.const 1) (get_local $receiver))
+  (call $kv_set (i32.const 2) (i32.const 2) (i32.const 33) (i32.const 2) (get_local $receiver))
+  (call $kv_set (i32.const 4) (i32.const 2) (i32.const 32) (i32.const 3) (get_local $receiver))
+  (call $kv_set (i32.const 0) (i32.const 1) (i32.const 32) (i32.const 0) (get_local $receiver))
+
+  (call $eosio_assert (i32.eq (call $kv_get (get_local $receiver) (i32.const 2) (i32.const 2) (i32.const 64) (i32.const 8)) (i32.const 2)) (i32.const 16))
+  (call $eosio_assert (i32.eq (i32.load16_u (i32.const 64)) (i32.const 0x7a79)) (i32.const 16))
+  (call $eosio_assert (i32.eq (call $kv_get (get_local $receiver) (i32.const 4) (i32.const 1) (i32.const 64) (i32.const 8)) (i32.const -1)) (i32.const 16))
+
+  ;; the keys starting with a, in order: a, a1, a2
+  (set_local $itr (call $kv_it_create (get_local $receiver) (i32.const 0) (i32.const 1)))
+  (call $eosio_assert (i32.eq (call $kv_it_key (get_local $itr) (i32.const 64) (i32.const 8)) (i32.const 1)) (i32.const 16))
+  (call $eosio_assert (i32.eqz (call $kv_it_next (get_local $itr))) (i32.const 16))
+  (call $eosio_assert (i32.eq (call $kv_it_key (get_local $itr) (i32.const 64) (i32.const 8)) (i32.const 2)) (i32.const 16))
+  (call $eosio_assert (i32.eq (i32.load16_u (i32.const 64)) (i32.const 0x3161)) (i32.const 16))
+
+  ;; erasing the next key while iterating, b1 does not start with the prefix
+  (call $eosio_assert (i32.eq (call $kv_erase (i32.const 2) (i32.const 2)) (i32.const 1)) (i32.const 16))
+  (call $eosio_assert (i32.eq (call $kv_it_next (get_local $itr)) (i32.const -1)) (i32.const 16))
+  (call $eosio_assert (i32.eq (call $kv_it_key (get_local $itr) (i32.const 64) (i32.const 8)) (i32.const -1)) (i32.const 16))
+
+  ;; back from the end to a1
+  (call $eosio_assert (i32.eqz (call $kv_it_prev (get_local $itr))) (i32.const 16))
+  (call $eosio_assert (i32.eq (call $kv_it_value (get_local $itr) (i32.const 64) (i32.const 8)) (i32.const 1)) (i32.const 16))
+  (call $eosio_assert (i32.eq (i32.load8_u (i32.const 64)) (i32.const 0x78)) (i32.const 16))
+
+  (call $eosio_assert (i32.eq (call $kv_it_lower_bound (get_local $itr) (i32.const 4) (i32.const 2)) (i32.const -1)) (i32.const 16))
+  (call $eosio_assert (i32.eqz (call $kv_it_lower_bound (get_local $itr) (i32.const 4) (i32.const 0))) (i32.const 16))
+  (call $eosio_assert (i32.eq (call $kv_it_key (get_local $itr) (i32.const 64) (i32.const 8)) (i32.const 1)) (i32.const 16))
+  (call $eosio_assert (i32.eq (call $kv_it_prev (get_local $itr)) (i32.const -1)) (i32.const 16))
+
+  (call $eosio_assert (i32.eqz (call $kv_erase (i32.const 2) (i32.const 2))) (i32.const 16))
+  (call $kv_it_destroy (get_local $itr))
+ )
+)
+)=====";
+
+BOOST_AUTO_TEST_CASE( kv_database_test ) { try {
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+
+   const auto& tester1_account = account_name("tester1");
+   c.create_accounts( {tester1_account} );
+   c.produce_block();
+
+   BOOST_CHECK_EXCEPTION(  c.set_code( tester1_account, kv_database_wast ),
+                           wasm_exception,
+                           fc_exception_message_is( "env.kv_set unresolveable" ) );
+
+   const auto& pfm = c.control->get_protocol_feature_manager();
+   const auto& d = pfm.get_builtin_digest( builtin_protocol_feature_t::kv_database );
+   BOOST_REQUIRE( d );
+
+   c.preactivate_protocol_features( {*d} );
+   c.produce_block();
+
+   c.set_code( tester1_account, kv_database_wast );
+   c.produce_block();
+
+   const auto ram_before = c.control->get_resource_limits_manager().get_account_ram_usage( tester1_account );
+
+   signed_transaction trx;
+   trx.actions.emplace_back( vector<permission_level>{{tester1_account, config::active_name}}, tester1_account, name(), bytes{} );
+   c.set_transaction_headers( trx );
+   trx.sign( c.get_private_key( tester1_account, "active" ), c.control->get_chain_id() );
+   c.push_transaction( trx );
+   c.produce_block();
+
+   BOOST_REQUIRE_EQUAL( true, c.chain_has_transaction( trx.id() ) );
+
+   const auto& idx = c.control->db().get_index<kv_index, by_kv_key>();
+   auto itr = idx.find( boost::make_tuple( tester1_account, std::string_view( "b1" ) ) );
+   BOOST_REQUIRE( itr != idx.end() );
+   BOOST_CHECK_EQUAL( "xyz", std::string( itr->kv_value.data(), itr->kv_value.size() ) );
+   BOOST_CHECK( idx.find( boost::make_tuple( tester1_account, std::string_view( "a2" ) ) ) == idx.end() );
+
+   // a, a1 and b1 are left
+   const int64_t billed = 3 * config::billable_size_v<kv_object> + (1 + 0) + (2 + 1) + (2 + 3);
+   BOOST_CHECK_EQUAL( ram_before + billed, c.control->get_resource_limits_manager().get_account_ram_usage( tester1_account ) );
+} FC_LOG_AND_RETHROW() }
+
+static const char sha256_batch_wast[] = R"=====(
+(module
+ (import "env" "sha256_batch" (func $sha256_batch (param i32 i32 i32 i32) (result i32)))
+ (import "env" "assert_sha256" (func $assert_sha256 (param i32 i32 i32)))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (memory 1)
+ ;; the buffers "ab" and "", each after its size
+ (data (i32.const 0) "\02\00\00\00ab\00\00\00\00")
+ (data (i32.const 16) "batch mismatch\00")
+ (export "apply" (func $apply))
+ (func $apply (param $receiver i64) (param $account i64) (param $action i64)
+  (call $eosio_assert (i32.eq (call $sha256_batch (i32.const 0) (i32.const 10) (i32.const 64) (i32.const 64)) (i32.const 2)) (i32.const 16))
+  (call $assert_sha256 (i32.const 4) (i32.const 2) (i32.const 64))
+  (call $assert_sha256 (i32.const 6) (i32.const 0) (i32.const 96))
+ )
+)
+)=====";
+
+BOOST_AUTO_TEST_CASE( sha256_batch_test ) { try {
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+
+   const auto& tester1_account = account_name("tester1");
+   c.create_accounts( {tester1_account} );
+   c.produce_block();
+
+   BOOST_CHECK_EXCEPTION(  c.set_code( tester1_account, sha256_batch_wast ),
+                           wasm_exception,
+                           fc_exception_message_is( "env.sha256_batch unresolveable" ) );
+
+   const auto& pfm = c.control->get_protocol_feature_manager();
+   const auto& d = pfm.get_builtin_digest( builtin_protocol_feature_t::sha256_batch );
+   BOOST_REQUIRE( d );
+
+   c.preactivate_protocol_features( {*d} );
+   c.produce_block();
+
+   c.set_code( tester1_account, sha256_batch_wast );
+   c.produce_block();
+
+   signed_transaction trx;
+   trx.actions.emplace_back( vector<permission_level>{{tester1_account, config::active_name}}, tester1_account, name(), bytes{} );
+   c.set_transaction_headers( trx );
+   trx.sign( c.get_private_key( tester1_account, "active" ), c.control->get_chain_id() );
+   c.push_transaction( trx );
+   c.produce_block();
+
+   BOOST_REQUIRE_EQUAL( true, c.chain_has_transaction( trx.id() ) );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( ram_restrictions_test ) { try {
    tester c( setup_policy::preactivate_feature_and_new_bios );
 
@@ -1587,7 +1845,7 @@ BOOST_AUTO_TEST_CASE( producer_schedule_change_extension_test ) { try {
       emplace_extension(
               bad_block->header_extensions,
               producer_schedule_change_extension::extension_id(),
-              fc::raw::pack(std::make_pair(hbs->active_schedule.version + 1, std::vector<char>{}))
+              fc::raw::pack(std::make_pair(hbs->active_schedule->version + 1, std::vector<char>{}))
       );
 
       // re-sign the bad block
@@ -1607,7 +1865,7 @@ BOOST_AUTO_TEST_CASE( producer_schedule_change_extension_test ) { try {
 
       // create a bad block that has the producer schedule change extension before the feature upgrade
       auto bad_block = std::make_shared<signed_block>(last_legacy_block->clone());
-      bad_block->new_producers = legacy::producer_schedule_type{hbs->active_schedule.version + 1, {}};
+      bad_block->new_producers = legacy::producer_schedule_type{hbs->active_schedule->version + 1, {}};
 
       // re-sign the bad block
       auto header_bmroot = digest_type::hash( std::make_pair( bad_block->digest(), remote.control->head_block_state()->blockroot_merkle ) );
@@ -1634,7 +1892,7 @@ BOOST_AUTO_TEST_CASE( producer_schedule_change_extension_test ) { try {
       emplace_extension(
               bad_block->header_extensions,
               producer_schedule_change_extension::extension_id(),
-              fc::raw::pack(std::make_pair(hbs->active_schedule.version + 1, std::vector<char>{}))
+              fc::raw::pack(std::make_pair(hbs->active_schedule->version + 1, std::vector<char>{}))
       );
 
       // re-sign the bad block
@@ -1654,7 +1912,7 @@ BOOST_AUTO_TEST_CASE( producer_schedule_change_extension_test ) { try {
 
       // create a bad block that has the producer schedule change extension before the feature upgrade
       auto bad_block = std::make_shared<signed_block>(first_new_block->clone());
-      bad_block->new_producers = legacy::producer_schedule_type{hbs->active_schedule.version + 1, {}};
+      bad_block->new_producers = legacy::producer_schedule_type{hbs->active_schedule->version + 1, {}};
 
       // re-sign the bad block
       auto header_bmroot = digest_type::hash( std::make_pair( bad_block->digest(), remote.control->head_block_state()->blockroot_merkle ) );
@@ -1739,4 +1997,62 @@ BOOST_AUTO_TEST_CASE( wtmsig_block_signing_inflight_extension_test ) { try {
 
 } FC_LOG_AND_RETHROW() }
 
+#ifdef EOSIO_ZSTD_COMPRESSION_ENABLED
+BOOST_AUTO_TEST_CASE( zstd_transaction_compression_test ) { try {
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+
+   const auto& tester1_account = account_name("tester1");
+   c.create_accounts( {tester1_account} );
+   c.produce_block();
+
+   // large and repetitive, as batch transactions are
+   auto make_trx = [&]( char fill ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{tester1_account, config::active_name}}, tester1_account, name("batch"),
+                                bytes( 8192, fill ) );
+      c.set_transaction_headers( trx );
+      trx.sign( c.get_private_key( tester1_account, "active" ), c.control->get_chain_id() );
+      return trx;
+   };
+
+   auto trx1 = make_trx( 'a' );
+   packed_transaction ptrx1( trx1, packed_transaction::compression_type::zstd );
+   BOOST_CHECK( ptrx1.get_packed_transaction().size() < 1024 );
+   BOOST_CHECK_EQUAL( trx1.id(), ptrx1.id() );
+   BOOST_CHECK_THROW( c.push_transaction( ptrx1 ), unknown_transaction_compression );
+
+   const auto& pfm = c.control->get_protocol_feature_manager();
+   const auto& d = pfm.get_builtin_digest( builtin_protocol_feature_t::zstd_transaction_compression );
+   BOOST_REQUIRE( d );
+
+   c.preactivate_protocol_features( {*d} );
+   c.produce_block();
+
+   auto trx2 = make_trx( 'b' );
+   packed_transaction ptrx2( trx2, packed_transaction::compression_type::zstd );
+   c.push_transaction( ptrx2 );
+   c.produce_block();
+
+   BOOST_REQUIRE_EQUAL( true, c.chain_has_transaction( trx2.id() ) );
+
+   // billed by its compressed size
+   const auto& receipt = c.get_transaction_receipt( trx2.id() );
+   BOOST_CHECK( receipt.net_usage_words * 8u < 1024u );
+
+} FC_LOG_AND_RETHROW() }
+#else
+BOOST_AUTO_TEST_CASE( zstd_transaction_compression_disabled_test ) { try {
+   tester c( setup_policy::preactivate_feature_and_new_bios );
+
+   const auto& pfm = c.control->get_protocol_feature_manager();
+   const auto& d = pfm.get_builtin_digest( builtin_protocol_feature_t::zstd_transaction_compression );
+   BOOST_REQUIRE( d );
+   BOOST_CHECK( !pfm.get_protocol_feature_set().get_protocol_feature( *d ).enabled );
+
+   // unable to unpack zstd compressed transactions, the build refuses to activate the feature
+   BOOST_CHECK_EXCEPTION( c.preactivate_protocol_features( {*d} ), protocol_feature_exception,
+                          fc_exception_message_is( std::string("protocol feature with digest '") + std::string(*d) + "' is disabled" ) );
+} FC_LOG_AND_RETHROW() }
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
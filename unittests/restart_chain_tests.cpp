@@ -1,7 +1,9 @@
+#include <fstream>
 #include <sstream>
 
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/reversible_block_log.hpp>
 #include <eosio/chain/snapshot.hpp>
 #include <eosio/testing/tester.hpp>
 
@@ -11,6 +13,8 @@
 #include <contracts.hpp>
 #include <snapshots.hpp>
 
+#include "fork_test_utilities.hpp"
+
 using namespace eosio;
 using namespace testing;
 using namespace chain;
@@ -78,4 +82,353 @@ BOOST_AUTO_TEST_CASE(test_restart_with_different_chain_id)
    BOOST_REQUIRE_EXCEPTION(other.open(chain_id), chain_id_type_exception, fc_exception_message_starts_with("chain ID in state "));
 }
 
+BOOST_AUTO_TEST_CASE(test_block_log_convert_version)
+{
+   tester chain;
+   chain.create_accounts( {N(alice), N(bob)} );
+   chain.produce_blocks(10);
+   chain.close();
+
+   const auto blocks_dir = chain.get_config().blocks_dir;
+   fc::temp_directory temp;
+   const auto v3_dir = temp.path() / "v3";
+   const auto v4_dir = temp.path() / "v4";
+
+   block_log::convert_version( blocks_dir, v3_dir, 3 );
+   block_log::convert_version( v3_dir, v4_dir, 4 );
+
+   block_log original( blocks_dir );
+   block_log v3( v3_dir );
+   block_log v4( v4_dir );
+   BOOST_REQUIRE( original.head() );
+   BOOST_CHECK_EQUAL( v3.head_id(), original.head_id() );
+   BOOST_CHECK_EQUAL( v4.head_id(), original.head_id() );
+   BOOST_CHECK_EQUAL( v4.first_block_num(), original.first_block_num() );
+   BOOST_CHECK_EQUAL( block_log::extract_chain_id( v3_dir ), block_log::extract_chain_id( blocks_dir ) );
+
+   for( uint32_t num = original.first_block_num(); num <= original.head()->block_num(); ++num ) {
+      const auto expected = fc::raw::pack( *original.read_block_by_num( num ) );
+      BOOST_CHECK( fc::raw::pack( *v3.read_block_by_num( num ) ) == expected );
+      BOOST_CHECK( fc::raw::pack( *v4.read_block_by_num( num ) ) == expected );
+      BOOST_CHECK_EQUAL( v4.read_block_id_by_num( num ), original.read_block_id_by_num( num ) );
+
+      for( const block_log* log : { &v3, &v4 } ) {
+         auto packed = log->read_packed_block_by_num( num );
+         BOOST_REQUIRE( packed );
+         BOOST_CHECK( std::vector<char>( packed.data, packed.data + packed.size ) == expected );
+      }
+   }
+   BOOST_CHECK( !v3.read_packed_block_by_num( original.head()->block_num() + 1 ) );
+}
+
+BOOST_AUTO_TEST_CASE(test_block_log_new_version)
+{
+   auto log_version = []( const fc::path& file_name ) {
+      std::ifstream in( file_name.generic_string(), std::ios::binary );
+      uint32_t version = 0;
+      in.read( (char*)&version, sizeof(version) );
+      return version;
+   };
+
+   // new block logs and their split segments are version 3 unless version 4 is configured
+   for( uint32_t version : { 3u, 4u } ) {
+      fc::temp_directory tempdir;
+      tester chain( tempdir, [version](controller::config& cfg) {
+         cfg.blocks_log_config.stride = 5;
+         if( version != 3 )
+            cfg.blocks_log_config.version = version;
+      }, true );
+      chain.produce_blocks( 12 );
+      const auto cfg = chain.get_config();
+      chain.close();
+
+      BOOST_CHECK_EQUAL( log_version( cfg.blocks_dir / "blocks.log" ), version );
+      BOOST_CHECK_EQUAL( log_version( cfg.blocks_dir / "retained" / "blocks-1-5.log" ), version );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(test_block_log_verify)
+{
+   tester chain;
+   chain.create_accounts( {N(alice), N(bob)} );
+   chain.produce_blocks(30);
+   chain.close();
+
+   const auto blocks_dir = chain.get_config().blocks_dir;
+   uint64_t corrupt_pos = 0;
+   uint32_t head_num = 0;
+   {
+      block_log log( blocks_dir );
+      head_num = log.head()->block_num();
+      corrupt_pos = log.get_block_pos( 17 );
+   }
+   for( uint32_t threads : { 1, 3, 64 } ) {
+      const auto result = block_log::verify( blocks_dir, threads );
+      BOOST_CHECK( !result.first_corrupt_block );
+      BOOST_CHECK_EQUAL( result.first_block_num, 1u );
+      BOOST_CHECK_EQUAL( result.last_block_num, head_num );
+      BOOST_CHECK_EQUAL( result.blocks_verified, head_num );
+   }
+
+   // a byte of the previous block id of block 17, past the block number it starts with
+   {
+      std::fstream f( (blocks_dir / "blocks.log").generic_string(), std::ios::in | std::ios::out | std::ios::binary );
+      f.seekg( corrupt_pos + 20 );
+      const char c = f.get() ^ 0x01;
+      f.seekp( corrupt_pos + 20 );
+      f.put( c );
+   }
+   for( uint32_t threads : { 1, 3, 64 } ) {
+      const auto result = block_log::verify( blocks_dir, threads );
+      BOOST_REQUIRE( result.first_corrupt_block );
+      BOOST_CHECK_EQUAL( *result.first_corrupt_block, 17u );
+      BOOST_CHECK_EQUAL( result.blocks_verified, 16u );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(test_extract_block_log)
+{
+   tester chain;
+   chain.create_accounts( {N(alice), N(bob)} );
+   chain.produce_blocks(30);
+   chain.close();
+
+   const auto blocks_dir = chain.get_config().blocks_dir;
+   fc::temp_directory temp;
+   const auto middle_dir = temp.path() / "middle";
+   const auto tail_dir = temp.path() / "tail";
+   block_log::extract_blocklog( blocks_dir, middle_dir, 10, 20 );
+   block_log::extract_blocklog( blocks_dir, tail_dir, 15, std::numeric_limits<uint32_t>::max() );
+
+   block_log original( blocks_dir );
+   block_log middle( middle_dir );
+   block_log tail( tail_dir );
+   BOOST_CHECK_EQUAL( middle.first_block_num(), 10u );
+   BOOST_CHECK_EQUAL( middle.head()->block_num(), 20u );
+   BOOST_CHECK_EQUAL( tail.first_block_num(), 15u );
+   BOOST_CHECK_EQUAL( tail.head_id(), original.head_id() );
+   BOOST_CHECK_EQUAL( block_log::extract_chain_id( tail_dir ), block_log::extract_chain_id( blocks_dir ) );
+   for( uint32_t num = 10; num <= original.head()->block_num(); ++num ) {
+      if( num <= 20 )
+         BOOST_CHECK_EQUAL( middle.read_block_id_by_num( num ), original.read_block_id_by_num( num ) );
+      if( num >= 15 )
+         BOOST_CHECK_EQUAL( tail.read_block_id_by_num( num ), original.read_block_id_by_num( num ) );
+   }
+   BOOST_CHECK( !block_log::verify( middle_dir ).first_corrupt_block );
+   BOOST_CHECK( !block_log::verify( tail_dir, 4 ).first_corrupt_block );
+}
+
+BOOST_AUTO_TEST_CASE(test_split_block_log)
+{
+   fc::temp_directory tempdir;
+   tester chain( tempdir, [](controller::config& cfg) {
+      cfg.blocks_log_config.stride = 20;
+      cfg.blocks_log_config.max_retained_files = 2;
+      cfg.blocks_log_config.archive_dir = "archive";
+   }, true );
+
+   std::map<uint32_t, block_id_type> ids;
+   for( int i = 0; i < 100; ++i ) {
+      auto b = chain.produce_block();
+      ids[b->block_num()] = b->id();
+   }
+   const auto cfg = chain.get_config();
+   const uint32_t lib = chain.control->last_irreversible_block_num();
+   BOOST_REQUIRE_GT( lib, 80u );
+   chain.close();
+
+   BOOST_CHECK( fc::exists( cfg.blocks_dir / "archive" / "blocks-1-20.log" ) );
+   BOOST_CHECK( fc::exists( cfg.blocks_dir / "archive" / "blocks-1-20.index" ) );
+
+   uint32_t first_num = 0;
+   {
+      block_log log( cfg.blocks_dir, cfg.blocks_log_config );
+      BOOST_REQUIRE( log.head() );
+      const uint32_t head_num = log.head()->block_num();
+      first_num = log.first_retained_block_num();
+      BOOST_CHECK_EQUAL( first_num, (head_num - 1) / 20 * 20 + 1 - 2 * 20 );
+      BOOST_CHECK_EQUAL( log.first_block_num(), first_num + 2 * 20 );
+      BOOST_CHECK( !log.read_block_by_num( first_num - 1 ) );
+      for( uint32_t num = first_num; num <= head_num; ++num ) {
+         auto b = log.read_block_by_num( num );
+         BOOST_REQUIRE( b );
+         BOOST_CHECK_EQUAL( b->id(), ids[num] );
+         BOOST_CHECK_EQUAL( log.read_block_id_by_num( num ), ids[num] );
+      }
+   }
+
+   // the chain restarts on the newest segment and keeps reading the retained ones
+   chain.open();
+   BOOST_CHECK_EQUAL( chain.control->fetch_block_by_number( first_num )->id(), ids[first_num] );
+   chain.produce_blocks( 30 );
+}
+
+BOOST_AUTO_TEST_CASE(test_block_log_background_writer)
+{
+   fc::temp_directory tempdir;
+   tester chain( tempdir, [](controller::config& cfg) {
+      cfg.blocks_log_config.write_queue_size = 4;
+      cfg.blocks_log_config.fsync_interval = 3;
+   }, true );
+
+   std::map<uint32_t, block_id_type> ids;
+   for( int i = 0; i < 50; ++i ) {
+      auto b = chain.produce_block();
+      ids[b->block_num()] = b->id();
+      // irreversible blocks are readable whether or not the writer got to them yet
+      const uint32_t lib = chain.control->last_irreversible_block_num();
+      if( ids.count( lib ) ) {
+         BOOST_CHECK_EQUAL( chain.control->fetch_block_by_number( lib )->id(), ids[lib] );
+         BOOST_CHECK( chain.control->fetch_packed_block_by_number( lib ) );
+      }
+   }
+   const uint32_t lib = chain.control->last_irreversible_block_num();
+   const auto cfg = chain.get_config();
+   chain.close();
+
+   {
+      block_log log( cfg.blocks_dir );
+      BOOST_REQUIRE( log.head() );
+      BOOST_CHECK_EQUAL( log.head()->block_num(), lib );
+      for( uint32_t num = 2; num <= lib; ++num )
+         BOOST_CHECK_EQUAL( log.read_block_id_by_num( num ), ids[num] );
+   }
+
+   chain.open();
+   chain.produce_blocks( 10 );
+}
+
+BOOST_AUTO_TEST_CASE(test_reversible_block_log)
+{
+   tester chain;
+   std::vector<signed_block_ptr> blocks;
+   for( int i = 0; i < 10; ++i )
+      blocks.push_back( chain.produce_block() );
+   const uint32_t first = blocks.front()->block_num();
+
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / config::reversible_blocks_dir_name;
+   {
+      reversible_block_log log( dir );
+      BOOST_CHECK( log.empty() );
+      for( const auto& b : blocks )
+         log.append( b, b->id() );
+      log.remove_through( first + 1 );
+      log.remove_from( first + 8 );
+      // replacing a block drops the ones after it
+      log.append( blocks[5], blocks[5]->id() );
+      BOOST_CHECK_EQUAL( log.first_block_num(), first + 2 );
+      BOOST_CHECK_EQUAL( log.last_block_num(), first + 5 );
+   }
+
+   {
+      reversible_block_log log( dir );
+      BOOST_CHECK( !log.truncated_on_open() );
+      // irreversible blocks are only dropped from memory, so they come back until the owner removes them again
+      BOOST_CHECK_EQUAL( log.first_block_num(), first );
+      BOOST_CHECK_EQUAL( log.last_block_num(), first + 5 );
+      for( uint32_t i = 0; i <= 5; ++i ) {
+         BOOST_CHECK_EQUAL( *log.get_block_id( first + i ), blocks[i]->id() );
+         BOOST_CHECK_EQUAL( log.get_block( first + i )->id(), blocks[i]->id() );
+      }
+      BOOST_CHECK( !log.get_block( first + 6 ) );
+   }
+
+   // a partially written record is dropped
+   const auto file = dir / config::reversible_blocks_filename;
+   boost::filesystem::resize_file( file, boost::filesystem::file_size( file ) - 1 );
+   {
+      reversible_block_log log( dir );
+      BOOST_CHECK( log.truncated_on_open() );
+      // without the last record, the blocks removed by remove_from are gone but block first + 5 was not replaced yet
+      BOOST_CHECK_EQUAL( log.last_block_num(), first + 7 );
+      log.append( blocks[5], blocks[5]->id() );
+   }
+   {
+      reversible_block_log log( dir );
+      BOOST_CHECK( !log.truncated_on_open() );
+      BOOST_CHECK_EQUAL( log.last_block_num(), first + 5 );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(test_fork_db_checkpoint)
+{
+   fc::temp_directory tempdir;
+   tester chain( tempdir, [](controller::config& cfg) {
+      cfg.fork_db_checkpoint_interval = 5;
+   }, true );
+
+   chain.produce_blocks( 22 );
+   const auto cfg = chain.get_config();
+   const auto checkpoint = cfg.state_dir / config::forkdb_checkpoint_filename;
+   BOOST_REQUIRE( fc::exists( checkpoint ) );
+   const auto saved = tempdir.path() / "saved_checkpoint";
+   fc::copy( checkpoint, saved );
+   const auto head_id = chain.control->head_block_id();
+   chain.close();
+   BOOST_CHECK( !fc::exists( checkpoint ) );
+
+   // leave only what an unclean shutdown would, the checkpoint but neither fork_db.dat nor a usable state
+   fc::remove( cfg.state_dir / config::forkdb_filename );
+   fc::remove( cfg.state_dir / "shared_memory.bin" );
+   fc::remove( cfg.state_dir / "shared_memory.meta" );
+   fc::rename( saved, checkpoint );
+
+   chain.open( tester::default_genesis() );
+   BOOST_CHECK( !fc::exists( checkpoint ) );
+   BOOST_CHECK_EQUAL( chain.control->head_block_id(), head_id );
+   chain.produce_blocks( 5 );
+}
+
+BOOST_AUTO_TEST_CASE(test_fork_db_stale_checkpoint)
+{
+   fc::temp_directory a_dir;
+   fc::temp_directory b_dir;
+   tester a_node( a_dir, [](controller::config& cfg) {
+      cfg.fork_db_checkpoint_interval = 1;
+   }, true );
+   tester b_node( b_dir, true );
+
+   // producers that keep the last irreversible block behind the head, so forks are possible
+   a_node.execute_setup_policy( setup_policy::full );
+   a_node.create_accounts( {N(alice), N(bob), N(carol)} );
+   a_node.set_producers( {N(alice), N(bob), N(carol)} );
+   BOOST_REQUIRE( produce_until_blocks_from( a_node, {N(alice), N(bob), N(carol)}, 300 ) );
+   push_blocks( a_node, b_node );
+   const uint32_t fork_num = a_node.control->head_block_num();
+
+   // the checkpoint of a node on a branch the rest of the chain abandons
+   a_node.produce_blocks( 24 );
+   const uint32_t checkpoint_root = a_node.control->last_irreversible_block_num();
+   const uint32_t checkpoint_head = a_node.control->head_block_num();
+   const auto stale = a_dir.path() / "stale_fork_db.dat";
+   fc::copy( a_node.get_config().state_dir / config::forkdb_checkpoint_filename, stale );
+
+   b_node.produce_block( fc::milliseconds( config::block_interval_ms * 2 ) );
+   while( b_node.control->last_irreversible_block_num() <= std::max( checkpoint_root, fork_num ) )
+      b_node.produce_block();
+   BOOST_REQUIRE_LE( b_node.control->last_irreversible_block_num(), checkpoint_head );
+   const auto head_id = b_node.control->head_block_id();
+   const auto cfg = b_node.get_config();
+   b_node.close();
+
+   auto leave_unclean = [&]( const char* fork_db_name ) {
+      fc::remove( cfg.state_dir / config::forkdb_filename );
+      fc::remove( cfg.state_dir / "shared_memory.bin" );
+      fc::remove( cfg.state_dir / "shared_memory.meta" );
+      fc::copy( stale, cfg.state_dir / fork_db_name );
+   };
+
+   // the same fork database written by a clean close does not match the block log
+   leave_unclean( config::forkdb_filename );
+   BOOST_REQUIRE_THROW( b_node.open( tester::default_genesis() ), fork_database_exception );
+   b_node.close();
+
+   // a checkpoint may be stale, so the fork database is reset to the replayed last irreversible block
+   leave_unclean( config::forkdb_checkpoint_filename );
+   b_node.open( tester::default_genesis() );
+   BOOST_CHECK_EQUAL( b_node.control->head_block_id(), head_id );
+   b_node.produce_blocks( 5 );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
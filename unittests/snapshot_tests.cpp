@@ -3,6 +3,7 @@
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/snapshot_delta.hpp>
 #include <eosio/testing/tester.hpp>
 
 #include <boost/mpl/list.hpp>
@@ -167,9 +168,56 @@ struct buffered_snapshot_suite {
    }
 };
 
+struct json_stream_snapshot_suite {
+   using writer_t = variant_snapshot_writer;
+   using reader_t = istream_json_snapshot_reader;
+   using write_storage_t = fc::mutable_variant_object;
+   using snapshot_t = std::string;
+   using read_storage_t = std::istringstream;
+
+   struct writer : public writer_t {
+      writer( const std::shared_ptr<write_storage_t>& storage )
+      :writer_t(*storage)
+      ,storage(storage)
+      {
+
+      }
+
+      std::shared_ptr<write_storage_t> storage;
+   };
+
+   struct reader : public reader_t {
+      explicit reader(const std::shared_ptr<read_storage_t>& storage)
+      :reader_t(*storage)
+      ,storage(storage)
+      {}
+
+      std::shared_ptr<read_storage_t> storage;
+   };
+
+
+   static auto get_writer() {
+      return std::make_shared<writer>(std::make_shared<write_storage_t>());
+   }
+
+   static auto finalize(const std::shared_ptr<writer>& w) {
+      w->finalize();
+      return fc::json::to_string(fc::variant(*w->storage), fc::time_point::maximum());
+   }
+
+   static auto get_reader( const snapshot_t& buffer) {
+      return std::make_shared<reader>(std::make_shared<read_storage_t>(buffer));
+   }
+
+   template<typename Snapshot>
+   static snapshot_t load_from_file() {
+      return fc::json::to_string(Snapshot::json(), fc::time_point::maximum());
+   }
+};
+
 BOOST_AUTO_TEST_SUITE(snapshot_tests)
 
-using snapshot_suites = boost::mpl::list<variant_snapshot_suite, buffered_snapshot_suite>;
+using snapshot_suites = boost::mpl::list<variant_snapshot_suite, buffered_snapshot_suite, json_stream_snapshot_suite>;
 
 namespace {
    void variant_diff_helper(const fc::variant& lhs, const fc::variant& rhs, std::function<void(const std::string&, const fc::variant&, const fc::variant&)>&& out){
@@ -583,4 +631,164 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_restart_with_existing_state_and_truncated_blo
    verify_integrity_hash<SNAPSHOT_SUITE>(*chain.control, *snap_chain.control);
 }
 
+namespace {
+   /// stream buffer over a string that cannot seek, like a pipe
+   class forward_only_buf : public std::streambuf {
+   public:
+      explicit forward_only_buf(std::string& data) {
+         setg(data.data(), data.data(), data.data() + data.size());
+      }
+   };
+}
+
+BOOST_AUTO_TEST_CASE(test_compressed_snapshot)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), contracts::snapshot_test_wasm());
+   chain.set_abi(N(snapshot), contracts::snapshot_test_abi().data());
+   chain.produce_blocks(1);
+
+   for (int itr = 0; itr < 5; itr++) {
+      chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+                        ( "value", 1 )
+                        );
+      chain.produce_block();
+   }
+   chain.control->abort_block();
+
+   std::ostringstream out;
+   auto writer = std::make_shared<compressed_ostream_snapshot_writer>(out);
+   chain.control->write_snapshot(writer);
+   writer->finalize();
+   BOOST_REQUIRE_EQUAL(writer->integrity_hash().str(), chain.control->calculate_integrity_hash().str());
+   auto snapshot = out.str();
+
+   int ordinal = 1;
+   {
+      // from a stream that can seek
+      auto in = std::make_shared<std::istringstream>(snapshot);
+      auto reader = std::make_shared<compressed_istream_snapshot_reader>(*in);
+      reader->validate();
+      BOOST_REQUIRE_EQUAL(controller::extract_chain_id(*reader), chain.control->get_chain_id());
+      reader->return_to_header();
+
+      snapshotted_tester snap_chain(chain.get_config(), reader, ordinal++);
+      verify_integrity_hash<buffered_snapshot_suite>(*chain.control, *snap_chain.control);
+   }
+
+   {
+      // from a stream that cannot seek, the sections read for the chain id are kept in memory
+      forward_only_buf buf(snapshot);
+      std::istream in(&buf);
+      auto reader = std::make_shared<compressed_istream_snapshot_reader>(in);
+      reader->validate();
+      BOOST_REQUIRE_EQUAL(controller::extract_chain_id(*reader), chain.control->get_chain_id());
+      reader->return_to_header();
+
+      snapshotted_tester snap_chain(chain.get_config(), reader, ordinal++);
+      verify_integrity_hash<buffered_snapshot_suite>(*chain.control, *snap_chain.control);
+
+      // sections already read from the stream are gone
+      BOOST_REQUIRE_THROW(reader->read_section<chain_snapshot_header>([]( auto& ){}), snapshot_exception);
+
+      auto block = chain.produce_block();
+      chain.control->abort_block();
+      snap_chain.push_block(block);
+      verify_integrity_hash<buffered_snapshot_suite>(*chain.control, *snap_chain.control);
+   }
+
+   {
+      // a damaged chunk is detected when it is decompressed
+      auto damaged = snapshot;
+      damaged[damaged.size() / 2] ^= 0x5a;
+      auto in = std::make_shared<std::istringstream>(damaged);
+      auto reader = std::make_shared<compressed_istream_snapshot_reader>(*in);
+      reader->validate();
+      BOOST_REQUIRE_THROW(snapshotted_tester(chain.get_config(), reader, ordinal++), fc::exception);
+   }
+}
+
+BOOST_AUTO_TEST_CASE(test_delta_snapshot)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), contracts::snapshot_test_wasm());
+   chain.set_abi(N(snapshot), contracts::snapshot_test_abi().data());
+   chain.produce_blocks(1);
+
+   auto increment = [&chain]() {
+      chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+                        ( "value", 1 )
+                        );
+      chain.produce_block();
+      chain.control->abort_block();
+   };
+
+   auto write = [&chain]( const fc::optional<snapshot_manifest>& base, snapshot_manifest& manifest ) {
+      std::ostringstream out;
+      auto writer = std::make_shared<ostream_snapshot_writer>(out);
+      auto delta = std::make_shared<snapshot_delta_writer>(writer, base);
+      chain.control->write_snapshot(delta);
+      delta->finalize();
+      writer->finalize();
+      manifest = delta->manifest();
+      return out.str();
+   };
+
+   auto write_full = [&chain]() {
+      std::ostringstream out;
+      auto writer = std::make_shared<ostream_snapshot_writer>(out);
+      chain.control->write_snapshot(writer);
+      writer->finalize();
+      return out.str();
+   };
+
+   auto apply = []( const std::string& base, const std::string& delta, const fc::optional<fc::sha256>& base_hash ) {
+      std::istringstream base_in(base);
+      std::istringstream delta_in(delta);
+      std::ostringstream out;
+      apply_snapshot_delta(base_in, delta_in, out, base_hash);
+      return out.str();
+   };
+
+   increment();
+   snapshot_manifest m0;
+   const auto full = write({}, m0);
+   BOOST_REQUIRE_EQUAL(m0.integrity_hash.str(), chain.control->calculate_integrity_hash().str());
+   BOOST_REQUIRE(full == write_full());
+
+   increment();
+   snapshot_manifest m1;
+   const auto delta1 = write(m0, m1);
+   BOOST_REQUIRE_LT(delta1.size(), full.size());
+
+   increment();
+   snapshot_manifest m2;
+   const auto delta2 = write(m1, m2);
+   BOOST_REQUIRE_EQUAL(m2.integrity_hash.str(), chain.control->calculate_integrity_hash().str());
+
+   {
+      std::istringstream in(delta2);
+      BOOST_REQUIRE(is_snapshot_delta(in));
+      std::istringstream full_in(full);
+      BOOST_REQUIRE(!is_snapshot_delta(full_in));
+   }
+
+   // applying the chain of deltas gives the same snapshot as a full one
+   const auto merged = apply(apply(full, delta1, m0.integrity_hash), delta2, m1.integrity_hash);
+   BOOST_REQUIRE(merged == write_full());
+
+   snapshotted_tester snap_chain(chain.get_config(), buffered_snapshot_suite::get_reader(merged), 1);
+   verify_integrity_hash<buffered_snapshot_suite>(*chain.control, *snap_chain.control);
+
+   // a delta only applies to its own base
+   BOOST_REQUIRE_THROW(apply(full, delta2, m0.integrity_hash), snapshot_exception);
+   BOOST_REQUIRE_THROW(apply(full, delta2, {}), snapshot_exception);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
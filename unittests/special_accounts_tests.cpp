@@ -44,7 +44,7 @@ BOOST_FIXTURE_TEST_CASE(accounts_exists, tester)
       auto producers = chain1_db.find<account_object, by_name>(config::producers_account_name);
       BOOST_CHECK(producers != nullptr);
 
-      const auto& active_producers = control->head_block_state()->active_schedule;
+      const auto& active_producers = *control->head_block_state()->active_schedule;
 
       const auto& producers_active_authority = chain1_db.get<permission_object, by_owner>(boost::make_tuple(config::producers_account_name, config::active_name));
       auto expected_threshold = (active_producers.producers.size() * 2)/3 + 1;
@@ -0,0 +1,131 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/state_sequence.hpp>
+#include <fc/filesystem.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+BOOST_AUTO_TEST_SUITE(state_sequence_tests)
+
+BOOST_AUTO_TEST_CASE( publishes_block_boundaries ) {
+   fc::temp_directory tempdir;
+   const auto file = (tempdir.path() / "state_sequence.dat").generic_string();
+
+   state_sequence_writer writer( file );
+   state_sequence_reader reader( file );
+   BOOST_CHECK( writer.writing() );
+   BOOST_CHECK( !reader.consistent( reader.begin() ) );
+
+   writer.end_write( 5 );
+   BOOST_CHECK( !writer.writing() );
+   auto s = reader.begin();
+   BOOST_CHECK( reader.consistent( s ) );
+   BOOST_CHECK_EQUAL( 5u, reader.head_block_num() );
+
+   // a read overlapping a write is not consistent, even once the write is done
+   writer.begin_write();
+   writer.begin_write();
+   BOOST_CHECK( !reader.consistent( s ) );
+   writer.end_write( 6 );
+   writer.end_write( 7 );
+   BOOST_CHECK( !reader.consistent( s ) );
+   s = reader.begin();
+   BOOST_CHECK( reader.consistent( s ) );
+   BOOST_CHECK_EQUAL( 6u, reader.head_block_num() );
+}
+
+BOOST_AUTO_TEST_CASE( reopened_writer_carries_on ) {
+   fc::temp_directory tempdir;
+   const auto file = (tempdir.path() / "state_sequence.dat").generic_string();
+
+   uint64_t s = 0;
+   {
+      state_sequence_writer writer( file );
+      writer.end_write( 1 );
+      state_sequence_reader reader( file );
+      s = reader.begin();
+   }
+   state_sequence_writer writer( file );
+   state_sequence_reader reader( file );
+   BOOST_CHECK( writer.writing() );
+   writer.end_write( 1 );
+   BOOST_CHECK( !reader.consistent( s ) );
+   BOOST_CHECK( reader.begin() > s );
+
+   BOOST_CHECK_THROW( state_sequence_reader( (tempdir.path() / "missing.dat").generic_string() ), database_exception );
+}
+
+BOOST_AUTO_TEST_CASE( read_retries_racing_writes ) {
+   fc::temp_directory tempdir;
+   const auto file = (tempdir.path() / "state_sequence.dat").generic_string();
+
+   state_sequence_writer writer( file );
+   state_sequence_reader reader( file );
+   BOOST_CHECK_THROW( reader.read( []() { return 1; }, 10 ), state_sequence_exception );
+
+   writer.end_write( 1 );
+   uint32_t calls = 0;
+   auto r = reader.read( [&]() {
+      // a write racing the first call
+      if( ++calls == 1 ) {
+         writer.begin_write();
+         writer.end_write( 2 );
+      }
+      return reader.head_block_num();
+   } );
+   BOOST_CHECK_EQUAL( 2u, calls );
+   BOOST_CHECK_EQUAL( 2u, r );
+
+   // thrown during a racing write, retried
+   calls = 0;
+   r = reader.read( [&]() -> uint32_t {
+      if( ++calls == 1 ) {
+         writer.begin_write();
+         writer.end_write( 3 );
+         throw std::runtime_error( "torn read" );
+      }
+      return reader.head_block_num();
+   } );
+   BOOST_CHECK_EQUAL( 2u, calls );
+   BOOST_CHECK_EQUAL( 3u, r );
+
+   // thrown on a consistent read, rethrown
+   BOOST_CHECK_THROW( reader.read( []() -> int { throw std::runtime_error( "not found" ); } ), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( reads_while_written_from_another_thread ) {
+   fc::temp_directory tempdir;
+   const auto file = (tempdir.path() / "state_sequence.dat").generic_string();
+
+   state_sequence_writer writer( file );
+   state_sequence_reader reader( file );
+   std::atomic<uint64_t> state[2] = {};
+   writer.end_write( 0 );
+
+   std::atomic<bool> done{false};
+   std::thread t( [&]() {
+      for( uint32_t n = 1; n <= 10000; ++n ) {
+         writer.begin_write();
+         state[0].store( n, std::memory_order_relaxed );
+         state[1].store( n, std::memory_order_relaxed );
+         writer.end_write( n );
+      }
+      done = true;
+   } );
+   while( !done ) {
+      try {
+         const auto r = reader.read( [&]() {
+            return std::make_pair( state[0].load( std::memory_order_relaxed ), state[1].load( std::memory_order_relaxed ) );
+         } );
+         BOOST_REQUIRE_EQUAL( r.first, r.second );
+      } catch( const state_sequence_exception& ) {}
+   }
+   t.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
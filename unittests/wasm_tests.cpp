@@ -2,10 +2,12 @@
 #include <utility>
 
 #include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/account_object.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/resource_limits.hpp>
 #include <eosio/chain/wasm_eosio_constraints.hpp>
+#include <eosio/chain/wasm_eosio_injection.hpp>
 #include <eosio/chain/wast_to_wasm.hpp>
 #include <eosio/testing/tester.hpp>
 
@@ -510,6 +512,58 @@ BOOST_FIXTURE_TEST_CASE(misaligned_tests, tester ) try {
    check_aligned(misaligned_const_ref_wast);
 } FC_LOG_AND_RETHROW()
 
+// the 128-bit builtins EOS VM OC emits inline give what the host functions give
+BOOST_FIXTURE_TEST_CASE( int128_builtins, TESTER ) try {
+   produce_blocks(2);
+   create_accounts( {N(int128)} );
+   produce_block();
+
+   set_code(N(int128), int128_builtins_wast);
+   produce_blocks(1);
+
+   signed_transaction trx;
+   action act;
+   act.account = N(int128);
+   act.name = N();
+   act.authorization = vector<permission_level>{{N(int128),config::active_name}};
+   trx.actions.push_back(act);
+
+   set_transaction_headers(trx);
+   trx.sign(get_private_key( N(int128), "active" ), control->get_chain_id());
+   push_transaction(trx);
+   produce_block();
+
+   BOOST_REQUIRE_EQUAL(true, chain_has_transaction(trx.id()));
+} FC_LOG_AND_RETHROW()
+
+// current_receiver, which EOS VM OC emits inline, is the receiver of each action run on a different account
+BOOST_FIXTURE_TEST_CASE( current_receiver_inline, TESTER ) try {
+   produce_blocks(2);
+   create_accounts( {N(receiver1), N(receiver2)} );
+   produce_block();
+
+   set_code(N(receiver1), current_receiver_wast);
+   set_code(N(receiver2), current_receiver_wast);
+   produce_blocks(1);
+
+   signed_transaction trx;
+   for( auto receiver : { N(receiver1), N(receiver2), N(receiver1) } ) {
+      action act;
+      act.account = receiver;
+      act.name = N();
+      act.authorization = vector<permission_level>{{receiver,config::active_name}};
+      trx.actions.push_back(act);
+   }
+
+   set_transaction_headers(trx);
+   trx.sign(get_private_key( N(receiver1), "active" ), control->get_chain_id());
+   trx.sign(get_private_key( N(receiver2), "active" ), control->get_chain_id());
+   push_transaction(trx);
+   produce_block();
+
+   BOOST_REQUIRE_EQUAL(true, chain_has_transaction(trx.id()));
+} FC_LOG_AND_RETHROW()
+
 /**
  * Make sure WASM "start" method is used correctly
  */
@@ -537,6 +591,111 @@ BOOST_FIXTURE_TEST_CASE( check_entry_behavior, TESTER ) try {
    BOOST_CHECK_EQUAL(transaction_receipt::executed, receipt.status);
 } FC_LOG_AND_RETHROW()
 
+static const char noop_wast[] = R"=====(
+(module
+ (export "apply" (func $apply))
+ (func $apply (param $0 i64) (param $1 i64) (param $2 i64))
+)
+)=====";
+
+BOOST_FIXTURE_TEST_CASE( wasm_cache_size_limit, TESTER ) try {
+   produce_blocks(2);
+   create_accounts( {N(entrycheck), N(noop)} );
+   produce_block();
+
+   set_code(N(entrycheck), entry_wast);
+   set_code(N(noop), noop_wast);
+   produce_blocks(1);
+
+   auto run = [&]( account_name contract ) {
+      signed_transaction trx;
+      action act;
+      act.account = contract;
+      act.name = N();
+      act.authorization = vector<permission_level>{{contract,config::active_name}};
+      trx.actions.push_back(act);
+      set_transaction_headers(trx);
+      trx.sign(get_private_key( contract, "active" ), control->get_chain_id());
+      push_transaction(trx);
+      produce_block();
+   };
+
+   // every module built evicts the one cached before it
+   control->get_wasm_interface().set_cache_size(1);
+   for( int i = 0; i < 2; ++i ) {
+      run(N(entrycheck));
+      run(N(noop));
+   }
+   auto stats = control->get_wasm_interface().get_cache_stats();
+   BOOST_CHECK_LE(stats.modules, 1u);
+   BOOST_CHECK_GE(stats.evictions, 3u);
+   BOOST_CHECK_EQUAL(1u, stats.max_bytes);
+
+   // without a limit both are kept
+   control->get_wasm_interface().set_cache_size(0);
+   const auto evictions = stats.evictions;
+   run(N(entrycheck));
+   run(N(noop));
+   run(N(entrycheck));
+   stats = control->get_wasm_interface().get_cache_stats();
+   BOOST_CHECK_EQUAL(evictions, stats.evictions);
+   BOOST_CHECK_GE(stats.hits, 1u);
+} FC_LOG_AND_RETHROW()
+
+#ifdef EOSIO_EOS_VM_OC_RUNTIME_ENABLED
+BOOST_AUTO_TEST_CASE( eosvmoc_tierup_threshold ) try {
+   fc::temp_directory tempdir;
+   auto conf_genesis = tester::default_config( tempdir );
+   // EOS VM OC can't be the baseline runtime of its own tier-up
+   if( conf_genesis.first.wasm_runtime == wasm_interface::vm_type::eos_vm_oc )
+      return;
+   conf_genesis.first.eosvmoc_tierup = true;
+   conf_genesis.first.eosvmoc_config.tierup_threshold = 3;
+   tester chain( conf_genesis.first, conf_genesis.second );
+
+   chain.create_accounts( {N(entrycheck), N(noop)} );
+   chain.set_code(N(entrycheck), entry_wast);
+   chain.set_code(N(noop), noop_wast);
+   chain.produce_block();
+
+   auto run = [&]( account_name contract ) {
+      signed_transaction trx;
+      action act;
+      act.account = contract;
+      act.name = N();
+      act.authorization = vector<permission_level>{{contract,config::active_name}};
+      trx.actions.push_back(act);
+      chain.set_transaction_headers(trx);
+      trx.sign(chain.get_private_key( contract, "active" ), chain.control->get_chain_id());
+      chain.push_transaction(trx);
+      chain.produce_block();
+   };
+   // of the modules of the baseline runtime
+   auto& wasmif = chain.control->get_wasm_interface();
+   auto baseline_runs = [&]() {
+      const auto stats = wasmif.get_cache_stats();
+      return stats.hits + stats.misses;
+   };
+
+   for( int i = 0; i < 2; ++i ) {
+      run(N(entrycheck));
+      run(N(noop));
+   }
+
+   // compiled ahead of reaching the threshold, so run by EOS VM OC
+   const auto& noop_code = chain.control->db().get<account_metadata_object,by_name>(N(noop)).code_hash;
+   BOOST_REQUIRE_EQUAL( 1u, wasmif.compile_ahead( {noop_code}, fc::time_point::now() + fc::seconds(60) ) );
+   auto runs = baseline_runs();
+   run(N(noop));
+   BOOST_CHECK_EQUAL( runs, baseline_runs() );
+
+   // not compiled, so still run by the baseline runtime below the threshold
+   runs = baseline_runs();
+   run(N(entrycheck));
+   BOOST_CHECK_EQUAL( runs + 1, baseline_runs() );
+} FC_LOG_AND_RETHROW()
+#endif
+
 BOOST_FIXTURE_TEST_CASE( check_entry_behavior_2, TESTER ) try {
    produce_blocks(2);
    create_accounts( {N(entrycheck)} );
@@ -1894,6 +2053,51 @@ BOOST_AUTO_TEST_CASE( code_size )  try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_AUTO_TEST_CASE( fused_local_ops )  try {
+   using namespace IR;
+   using namespace Serialization;
+   const auto wasm = wast_to_wasm( R"=====(
+(module
+ (export "apply" (func $apply))
+ (func $apply (param i64 i64 i64) (local i32 i32)
+   i32.const 1
+   set_local 3
+   get_local 3
+   tee_local 4
+   drop
+   get_local 4
+   set_local 3
+   get_local 4
+   set_local 3
+ )
+)
+)=====" );
+
+   Module module;
+   MemoryInputStream stream( wasm.data(), wasm.size() );
+   WASM::serialize( stream, module );
+   wasm_injections::local_op_fusion::fuse( module );
+
+   std::vector<std::string> ops;
+   wasm_ops::EOSIO_OperatorDecoderStream<wasm_ops::op_types<>> decoder( module.functions.defs.at(0).code );
+   while( decoder )
+      ops.push_back( decoder.decodeOp()->to_string() );
+   const std::vector<std::string> expected = {
+      "i32_const i32 : 1", "tee_local i32 : 3", "tee_local i32 : 4", // tee_local 4, drop, get_local 4 fused in turn
+      "set_local i32 : 3", "get_local i32 : 4", "set_local i32 : 3", "end"
+   };
+   BOOST_CHECK_EQUAL_COLLECTIONS( ops.begin(), ops.end(), expected.begin(), expected.end() );
+
+   // still a valid module
+   ArrayOutputStream outstream;
+   WASM::serialize( outstream, module );
+   const auto fused = outstream.getBytes();
+   Module reparsed;
+   MemoryInputStream fused_stream( fused.data(), fused.size() );
+   BOOST_CHECK_NO_THROW( WASM::serialize( fused_stream, reparsed ) );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_CASE( billed_cpu_test ) try {
 
    fc::temp_directory tempdir;
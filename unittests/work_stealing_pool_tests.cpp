@@ -0,0 +1,102 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/thread_utils.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace eosio;
+using namespace eosio::chain;
+
+BOOST_AUTO_TEST_SUITE(work_stealing_pool_tests)
+
+BOOST_AUTO_TEST_CASE( runs_all_tasks ) {
+   work_stealing_pool pool( "test", 4 );
+   std::vector<std::future<int>> results;
+   for( int i = 0; i < 10000; ++i ) {
+      results.emplace_back( async_thread_pool( pool, [i]() { return i * 2; } ) );
+   }
+   for( int i = 0; i < 10000; ++i ) BOOST_CHECK_EQUAL( i * 2, results[i].get() );
+
+   std::atomic<int> ran{0};
+   std::vector<std::future<void>> done;
+   for( int i = 0; i < 100; ++i ) {
+      done.emplace_back( async_thread_pool( pool, [&ran]() { ++ran; } ) );
+   }
+   for( auto& d : done ) d.get();
+   BOOST_CHECK_EQUAL( 100, ran.load() );
+}
+
+BOOST_AUTO_TEST_CASE( runs_in_order_on_one_thread ) {
+   work_stealing_pool pool( "test", 1 );
+   std::vector<int> ran;
+   std::vector<std::future<void>> done;
+   for( int i = 0; i < 100; ++i ) {
+      done.emplace_back( async_thread_pool( pool, [&ran, i]() { ran.push_back( i ); } ) );
+   }
+   for( auto& d : done ) d.get();
+   BOOST_REQUIRE_EQUAL( 100u, ran.size() );
+   for( int i = 0; i < 100; ++i ) BOOST_CHECK_EQUAL( i, ran[i] );
+}
+
+BOOST_AUTO_TEST_CASE( forwards_exceptions ) {
+   work_stealing_pool pool( "test", 2 );
+   auto f = async_thread_pool( pool, []() -> int { throw std::runtime_error( "task failed" ); } );
+   BOOST_CHECK_THROW( f.get(), std::runtime_error );
+   // the thread is still there for the next task
+   BOOST_CHECK_EQUAL( 1, async_thread_pool( pool, []() { return 1; } ).get() );
+}
+
+BOOST_AUTO_TEST_CASE( large_and_nested_tasks ) {
+   work_stealing_pool pool( "test", 2 );
+   std::array<char, work_stealing_pool::task_size * 2> large{};
+   large[0] = 7;
+   BOOST_CHECK_EQUAL( 7, async_thread_pool( pool, [large]() { return int( large[0] ); } ).get() );
+
+   // queued on the queue of the thread submitting it
+   auto outer = async_thread_pool( pool, [&pool]() { return async_thread_pool( pool, []() { return 5; } ); } );
+   BOOST_CHECK_EQUAL( 5, outer.get().get() );
+}
+
+BOOST_AUTO_TEST_CASE( full_queues_run_on_submitting_thread ) {
+   work_stealing_pool pool( "test", 1 );
+   std::promise<void> started, release;
+   auto released = release.get_future().share();
+   auto blocked = async_thread_pool( pool, [&started, released]() { started.set_value(); released.wait(); } );
+   started.get_future().wait();
+   std::vector<std::future<std::thread::id>> queued;
+   for( size_t i = 0; i < work_stealing_pool::queue_capacity + 1; ++i ) {
+      queued.emplace_back( async_thread_pool( pool, []() { return std::this_thread::get_id(); } ) );
+   }
+   BOOST_REQUIRE( queued.back().wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready );
+   BOOST_CHECK( queued.back().get() == std::this_thread::get_id() );
+   release.set_value();
+   blocked.get();
+   queued.pop_back();
+   for( auto& q : queued ) BOOST_CHECK( q.get() != std::this_thread::get_id() );
+}
+
+BOOST_AUTO_TEST_CASE( stop_drops_tasks_not_started ) {
+   work_stealing_pool pool( "test", 1 );
+   std::promise<void> started, release;
+   auto released = release.get_future().share();
+   auto running = async_thread_pool( pool, [&started, released]() { started.set_value(); released.wait(); } );
+   auto waiting = async_thread_pool( pool, []() { return 1; } );
+   started.get_future().wait();
+   std::thread t( [&pool]() { pool.stop(); } );
+   // for stop() to be waiting on the running task
+   std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+   release.set_value();
+   t.join();
+   running.get();
+   BOOST_CHECK_THROW( waiting.get(), std::future_error );
+
+   auto after_stop = async_thread_pool( pool, []() { return 1; } );
+   BOOST_CHECK_THROW( after_stop.get(), std::future_error );
+}
+
+BOOST_AUTO_TEST_SUITE_END()